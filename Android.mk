@@ -167,6 +167,10 @@ test-art-host-oat-interpreter: $(ART_TEST_HOST_OAT_INTERPRETER_TARGETS)
 test-art-host-oat: test-art-host-oat-default test-art-host-oat-interpreter
 	@echo test-art-host-oat PASSED
 
+# "mm test-art-host-benchmark" to print the results of the benchmarks on host
+.PHONY: test-art-host-benchmark
+test-art-host-benchmark: $(ART_TEST_HOST_BENCHMARK_TARGETS)
+
 define declare-test-art-host-run-test
 .PHONY: test-art-host-run-test-default-$(1)
 test-art-host-run-test-default-$(1): test-art-host-dependencies
@@ -225,6 +229,10 @@ test-art-target-gtest: $(ART_TARGET_TEST_TARGETS)
 test-art-target-oat: $(ART_TEST_TARGET_OAT_TARGETS)
 	@echo test-art-target-oat PASSED
 
+# "mm test-art-target-benchmark" to print the results of the benchmarks on the device
+.PHONY: test-art-target-benchmark
+test-art-target-benchmark: $(ART_TEST_TARGET_BENCHMARK_TARGETS)
+
 define declare-test-art-target-run-test
 .PHONY: test-art-target-run-test-$(1)
 test-art-target-run-test-$(1): test-art-target-sync
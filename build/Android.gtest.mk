@@ -17,44 +17,66 @@
 LOCAL_PATH := art
 
 TEST_COMMON_SRC_FILES := \
+	compiler/dex/arena_bit_vector_test.cc \
 	compiler/driver/compiler_driver_test.cc \
+	compiler/elf_object_linker_test.cc \
 	compiler/elf_writer_test.cc \
+	compiler/gc_map_builder_test.cc \
 	compiler/image_test.cc \
 	compiler/jni/jni_compiler_test.cc \
 	compiler/oat_test.cc \
 	compiler/output_stream_test.cc \
 	compiler/utils/dedupe_set_test.cc \
+	compiler/utils/swap_space_test.cc \
 	compiler/utils/arm/managed_register_arm_test.cc \
 	compiler/utils/x86/managed_register_x86_test.cc \
+	runtime/allocation_profiler_test.cc \
 	runtime/barrier_test.cc \
+	runtime/base/arena_allocator_test.cc \
+	runtime/base/hash_set_test.cc \
 	runtime/base/histogram_test.cc \
 	runtime/base/mutex_test.cc \
+	runtime/base/sharded_histogram_test.cc \
 	runtime/base/timing_logger_test.cc \
 	runtime/base/unix_file/fd_file_test.cc \
 	runtime/base/unix_file/mapped_file_test.cc \
 	runtime/base/unix_file/null_file_test.cc \
 	runtime/base/unix_file/random_access_file_utils_test.cc \
 	runtime/base/unix_file/string_file_test.cc \
+	runtime/catch_handler_cache_test.cc \
 	runtime/class_linker_test.cc \
 	runtime/dex_file_test.cc \
 	runtime/dex_instruction_visitor_test.cc \
 	runtime/dex_method_iterator_test.cc \
 	runtime/entrypoints/math_entrypoints_test.cc \
 	runtime/exception_test.cc \
+	runtime/gc/accounting/card_table_test.cc \
+	runtime/gc/accounting/mod_union_table_test.cc \
 	runtime/gc/accounting/space_bitmap_test.cc \
+	runtime/gc/accounting/work_stealing_deque_test.cc \
+	runtime/gc/allocation_site_table_test.cc \
 	runtime/gc/heap_test.cc \
 	runtime/gc/space/space_test.cc \
 	runtime/gtest_test.cc \
 	runtime/indenter_test.cc \
 	runtime/indirect_reference_table_test.cc \
+	runtime/inline_cache_test.cc \
 	runtime/intern_table_test.cc \
 	runtime/jni_internal_test.cc \
+	runtime/lock_profiler_test.cc \
+	runtime/leb128_test.cc \
+	runtime/mapping_table_test.cc \
 	runtime/mem_map_test.cc \
+	runtime/metrics_test.cc \
 	runtime/mirror/dex_cache_test.cc \
 	runtime/mirror/object_test.cc \
+	runtime/native_thread_pool_test.cc \
 	runtime/reference_table_test.cc \
 	runtime/runtime_test.cc \
+	runtime/sampling_profiler_test.cc \
 	runtime/thread_pool_test.cc \
+	runtime/transaction_test.cc \
+	runtime/utf_test.cc \
 	runtime/utils_test.cc \
 	runtime/verifier/method_verifier_test.cc \
 	runtime/verifier/reg_type_test.cc \
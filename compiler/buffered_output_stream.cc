@@ -17,6 +17,7 @@
 #include "buffered_output_stream.h"
 
 #include <string.h>
+#include <sys/uio.h>
 
 namespace art {
 
@@ -25,8 +26,14 @@ BufferedOutputStream::BufferedOutputStream(OutputStream* out)
 
 bool BufferedOutputStream::WriteFully(const void* buffer, int64_t byte_count) {
   if (byte_count > kBufferSize) {
-    Flush();
-    return out_->WriteFully(buffer, byte_count);
+    struct iovec iov[2];
+    iov[0].iov_base = &buffer_[0];
+    iov[0].iov_len = used_;
+    iov[1].iov_base = const_cast<void*>(buffer);
+    iov[1].iov_len = byte_count;
+    bool empty = (used_ == 0);
+    used_ = 0;
+    return empty ? out_->WriteFully(buffer, byte_count) : out_->WriteFullyV(iov, 2);
   }
   if (used_ + byte_count > kBufferSize) {
     bool success = Flush();
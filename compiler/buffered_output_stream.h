@@ -28,15 +28,18 @@ class BufferedOutputStream : public OutputStream {
   explicit BufferedOutputStream(OutputStream* out);
 
   virtual ~BufferedOutputStream() {
+    Flush();
     delete out_;
   }
 
+  // Copies small writes into the buffer. Larger ones are handed to out_ together with the
+  // buffered bytes in one WriteFullyV, without being copied.
   virtual bool WriteFully(const void* buffer, int64_t byte_count);
 
   virtual off_t Seek(off_t offset, Whence whence);
 
  private:
-  static const size_t kBufferSize = 8 * KB;
+  static const size_t kBufferSize = 64 * KB;
 
   bool Flush();
 
@@ -16,21 +16,30 @@
 
 #include "compiled_method.h"
 #include "driver/compiler_driver.h"
+#include "elf_object_linker.h"
 
 namespace art {
 
 CompiledCode::CompiledCode(CompilerDriver* compiler_driver, InstructionSet instruction_set,
                            const std::vector<uint8_t>& code)
-    : compiler_driver_(compiler_driver), instruction_set_(instruction_set), code_(nullptr) {
+    : compiler_driver_(compiler_driver), instruction_set_(instruction_set), code_(nullptr),
+      is_elf_object_(false) {
   SetCode(code);
 }
 
 CompiledCode::CompiledCode(CompilerDriver* compiler_driver, InstructionSet instruction_set,
                            const std::string& elf_object, const std::string& symbol)
-    : compiler_driver_(compiler_driver), instruction_set_(instruction_set), symbol_(symbol) {
+    : compiler_driver_(compiler_driver), instruction_set_(instruction_set), symbol_(symbol),
+      is_elf_object_(false) {
   CHECK_NE(elf_object.size(), 0U);
   CHECK_NE(symbol.size(), 0U);
-  std::vector<uint8_t> temp_code(elf_object.size());
+  std::vector<uint8_t> temp_code;
+  if (ElfObjectLinker::Link(elf_object, symbol, instruction_set, &temp_code)) {
+    SetCode(temp_code);
+    return;
+  }
+  is_elf_object_ = true;
+  temp_code.resize(elf_object.size());
   for (size_t i = 0; i < elf_object.size(); ++i) {
     temp_code[i] = elf_object[i];
   }
@@ -129,7 +138,7 @@ CompiledMethod::CompiledMethod(CompilerDriver& driver,
       core_spill_mask_(core_spill_mask), fp_spill_mask_(fp_spill_mask),
   mapping_table_(driver.DeduplicateMappingTable(mapping_table)),
   vmap_table_(driver.DeduplicateVMapTable(vmap_table)),
-  gc_map_(driver.DeduplicateGCMap(native_gc_map)) {
+  gc_map_(driver.DeduplicateGCMap(native_gc_map)), dependency_hash_(0) {
 }
 
 CompiledMethod::CompiledMethod(CompilerDriver& driver,
@@ -140,7 +149,7 @@ CompiledMethod::CompiledMethod(CompilerDriver& driver,
                                const uint32_t fp_spill_mask)
     : CompiledCode(&driver, instruction_set, code),
       frame_size_in_bytes_(frame_size_in_bytes),
-      core_spill_mask_(core_spill_mask), fp_spill_mask_(fp_spill_mask) {
+      core_spill_mask_(core_spill_mask), fp_spill_mask_(fp_spill_mask), dependency_hash_(0) {
   mapping_table_ = driver.DeduplicateMappingTable(std::vector<uint8_t>());
   vmap_table_ = driver.DeduplicateVMapTable(std::vector<uint8_t>());
   gc_map_ = driver.DeduplicateGCMap(std::vector<uint8_t>());
@@ -152,7 +161,7 @@ CompiledMethod::CompiledMethod(CompilerDriver& driver, InstructionSet instructio
                                const std::string& symbol)
     : CompiledCode(&driver, instruction_set, code, symbol),
       frame_size_in_bytes_(kStackAlignment), core_spill_mask_(0),
-      fp_spill_mask_(0), gc_map_(driver.DeduplicateGCMap(gc_map)) {
+      fp_spill_mask_(0), gc_map_(driver.DeduplicateGCMap(gc_map)), dependency_hash_(0) {
   mapping_table_ = driver.DeduplicateMappingTable(std::vector<uint8_t>());
   vmap_table_ = driver.DeduplicateVMapTable(std::vector<uint8_t>());
 }
@@ -161,7 +170,7 @@ CompiledMethod::CompiledMethod(CompilerDriver& driver, InstructionSet instructio
                                const std::string& code, const std::string& symbol)
     : CompiledCode(&driver, instruction_set, code, symbol),
       frame_size_in_bytes_(kStackAlignment), core_spill_mask_(0),
-      fp_spill_mask_(0) {
+      fp_spill_mask_(0), dependency_hash_(0) {
   mapping_table_ = driver.DeduplicateMappingTable(std::vector<uint8_t>());
   vmap_table_ = driver.DeduplicateVMapTable(std::vector<uint8_t>());
   gc_map_ = driver.DeduplicateGCMap(std::vector<uint8_t>());
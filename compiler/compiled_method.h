@@ -22,6 +22,7 @@
 
 #include "instruction_set.h"
 #include "utils.h"
+#include "utils/swap_space.h"
 #include "UniquePtr.h"
 
 namespace llvm {
@@ -46,7 +47,7 @@ class CompiledCode {
     return instruction_set_;
   }
 
-  const std::vector<uint8_t>& GetCode() const {
+  const SwapVector<uint8_t>& GetCode() const {
     return *code_;
   }
 
@@ -73,6 +74,11 @@ class CompiledCode {
                                  InstructionSet instruction_set);
 
 #if defined(ART_USE_PORTABLE_COMPILER)
+  // Whether the code is an ELF object left for MCLinker, rather than code ElfObjectLinker linked
+  // that is laid out like Quick's.
+  bool IsElfObject() const {
+    return is_elf_object_;
+  }
   const std::string& GetSymbol() const;
   const std::vector<uint32_t>& GetOatdataOffsetsToCompliledCodeOffset() const;
   void AddOatdataOffsetToCompliledCodeOffset(uint32_t offset);
@@ -84,11 +90,14 @@ class CompiledCode {
   const InstructionSet instruction_set_;
 
   // Used to store the PIC code for Quick and an ELF image for portable.
-  std::vector<uint8_t>* code_;
+  SwapVector<uint8_t>* code_;
 
   // Used for the Portable ELF symbol name.
   const std::string symbol_;
 
+  // Whether code_ holds the Portable ELF object named by symbol_.
+  bool is_elf_object_;
+
   // There are offsets from the oatdata symbol to where the offset to
   // the compiled method will be found. These are computed by the
   // OatWriter and then used by the ElfWriter to add relocations so
@@ -139,21 +148,31 @@ class CompiledMethod : public CompiledCode {
     return fp_spill_mask_;
   }
 
-  const std::vector<uint8_t>& GetMappingTable() const {
+  const SwapVector<uint8_t>& GetMappingTable() const {
     DCHECK(mapping_table_ != nullptr);
     return *mapping_table_;
   }
 
-  const std::vector<uint8_t>& GetVmapTable() const {
+  const SwapVector<uint8_t>& GetVmapTable() const {
     DCHECK(vmap_table_ != nullptr);
     return *vmap_table_;
   }
 
-  const std::vector<uint8_t>& GetGcMap() const {
+  const SwapVector<uint8_t>& GetGcMap() const {
     DCHECK(gc_map_ != nullptr);
     return *gc_map_;
   }
 
+  // A hash of the code item and of the resolved dependencies of the method, recorded in the oat
+  // file for the next compilation to reuse this code. 0 if there is none.
+  uint64_t GetDependencyHash() const {
+    return dependency_hash_;
+  }
+
+  void SetDependencyHash(uint64_t dependency_hash) {
+    dependency_hash_ = dependency_hash;
+  }
+
  private:
   // For quick code, the size of the activation used by the code.
   const size_t frame_size_in_bytes_;
@@ -163,12 +182,13 @@ class CompiledMethod : public CompiledCode {
   const uint32_t fp_spill_mask_;
   // For quick code, a uleb128 encoded map from native PC offset to dex PC aswell as dex PC to
   // native PC offset. Size prefixed.
-  std::vector<uint8_t>* mapping_table_;
+  SwapVector<uint8_t>* mapping_table_;
   // For quick code, a uleb128 encoded map from GPR/FPR register to dex register. Size prefixed.
-  std::vector<uint8_t>* vmap_table_;
+  SwapVector<uint8_t>* vmap_table_;
   // For quick code, a map keyed by native PC indices to bitmaps describing what dalvik registers
   // are live. For portable code, the key is a dalvik PC.
-  std::vector<uint8_t>* gc_map_;
+  SwapVector<uint8_t>* gc_map_;
+  uint64_t dependency_hash_;
 };
 
 }  // namespace art
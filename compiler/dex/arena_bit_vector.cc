@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include "compiler_internals.h"
 #include "dex_file-inl.h"
 
@@ -35,9 +37,51 @@ ArenaBitVector::ArenaBitVector(ArenaAllocator* arena, unsigned int start_bits,
      expandable_(expandable),
      kind_(kind),
      storage_size_((start_bits + 31) >> 5),
-     storage_(static_cast<uint32_t*>(arena_->Alloc(storage_size_ * sizeof(uint32_t),
-                                                   ArenaAllocator::kAllocGrowableBitMap))) {
+     storage_(NULL),
+     sparse_(false),
+     num_indices_(0),
+     sparse_capacity_(0),
+     indices_(NULL),
+     scratch_indices_(NULL) {
   DCHECK_EQ(sizeof(storage_[0]), 4U);    // Assuming 32-bit units.
+  if (!expandable_ && storage_size_ >= kMinSparseWords) {
+    sparse_ = true;
+    sparse_capacity_ = storage_size_ / 2;
+    indices_ = static_cast<uint32_t*>(arena_->Alloc(2 * sparse_capacity_ * sizeof(uint32_t),
+                                                    ArenaAllocator::kAllocGrowableBitMap));
+    scratch_indices_ = indices_ + sparse_capacity_;
+  } else {
+    storage_ = static_cast<uint32_t*>(arena_->Alloc(storage_size_ * sizeof(uint32_t),
+                                                   ArenaAllocator::kAllocGrowableBitMap));
+  }
+}
+
+void ArenaBitVector::Densify() {
+  DCHECK(sparse_);
+  if (storage_ == NULL) {
+    storage_ = static_cast<uint32_t*>(arena_->Alloc(storage_size_ * sizeof(uint32_t),
+                                                   ArenaAllocator::kAllocGrowableBitMap));
+  } else {
+    // Left over from the last time the vector was dense.
+    memset(storage_, 0, storage_size_ * sizeof(uint32_t));
+  }
+  for (uint32_t i = 0; i < num_indices_; i++) {
+    storage_[indices_[i] >> 5] |= check_masks[indices_[i] & 0x1f];
+  }
+  sparse_ = false;
+}
+
+bool ArenaBitVector::IsSparseBitSet(unsigned int num) const {
+  return std::binary_search(indices_, indices_ + num_indices_, num);
+}
+
+uint32_t ArenaBitVector::SparseWord(uint32_t idx, const uint32_t** next, const uint32_t* end) {
+  uint32_t word = 0;
+  while (*next != end && (**next >> 5) == idx) {
+    word |= check_masks[**next & 0x1f];
+    ++*next;
+  }
+  return word;
 }
 
 /*
@@ -45,6 +89,9 @@ ArenaBitVector::ArenaBitVector(ArenaAllocator* arena, unsigned int start_bits,
  */
 bool ArenaBitVector::IsBitSet(unsigned int num) {
   DCHECK_LT(num, storage_size_ * sizeof(uint32_t) * 8);
+  if (sparse_) {
+    return IsSparseBitSet(num);
+  }
 
   unsigned int val = storage_[num >> 5] & check_masks[num & 0x1f];
   return (val != 0);
@@ -52,7 +99,13 @@ bool ArenaBitVector::IsBitSet(unsigned int num) {
 
 // Mark all bits bit as "clear".
 void ArenaBitVector::ClearAllBits() {
-  memset(storage_, 0, storage_size_ * sizeof(uint32_t));
+  if (CanBeSparse()) {
+    // The dense storage is cleared if the vector ever becomes dense again.
+    sparse_ = true;
+    num_indices_ = 0;
+  } else {
+    memset(storage_, 0, storage_size_ * sizeof(uint32_t));
+  }
 }
 
 // Mark the specified bit as "set".
@@ -61,6 +114,23 @@ void ArenaBitVector::ClearAllBits() {
  * not using it badly or change resize mechanism.
  */
 void ArenaBitVector::SetBit(unsigned int num) {
+  if (sparse_) {
+    DCHECK_LT(num, storage_size_ * sizeof(uint32_t) * 8)
+        << "Attempted to expand a non-expandable bitmap to position " << num;
+    uint32_t* end = indices_ + num_indices_;
+    uint32_t* pos = std::lower_bound(indices_, end, num);
+    if (pos != end && *pos == num) {
+      return;
+    }
+    if (num_indices_ < sparse_capacity_) {
+      memmove(pos + 1, pos, (end - pos) * sizeof(uint32_t));
+      *pos = num;
+      num_indices_++;
+      return;
+    }
+    Densify();
+  }
+
   if (num >= storage_size_ * sizeof(uint32_t) * 8) {
     DCHECK(expandable_) << "Attempted to expand a non-expandable bitmap to position " << num;
 
@@ -84,21 +154,72 @@ void ArenaBitVector::SetBit(unsigned int num) {
 // Mark the specified bit as "unset".
 void ArenaBitVector::ClearBit(unsigned int num) {
   DCHECK_LT(num, storage_size_ * sizeof(uint32_t) * 8);
+  if (sparse_) {
+    uint32_t* end = indices_ + num_indices_;
+    uint32_t* pos = std::lower_bound(indices_, end, num);
+    if (pos != end && *pos == num) {
+      memmove(pos, pos + 1, (end - pos - 1) * sizeof(uint32_t));
+      num_indices_--;
+    }
+    return;
+  }
   storage_[num >> 5] &= ~check_masks[num & 0x1f];
 }
 
+/*
+ * The dense loops below only touch the words through local restrict pointers, so that the
+ * compiler can vectorize them.
+ */
+
 // Copy a whole vector to the other. Sizes must match.
 void ArenaBitVector::Copy(ArenaBitVector* src) {
   DCHECK_EQ(storage_size_, src->GetStorageSize());
-  memcpy(storage_, src->GetRawStorage(), sizeof(uint32_t) * storage_size_);
+  if (src->sparse_) {
+    DCHECK(CanBeSparse());
+    sparse_ = true;
+    num_indices_ = src->num_indices_;
+    memcpy(indices_, src->indices_, num_indices_ * sizeof(uint32_t));
+    return;
+  }
+  if (storage_ == NULL) {
+    storage_ = static_cast<uint32_t*>(arena_->Alloc(storage_size_ * sizeof(uint32_t),
+                                                   ArenaAllocator::kAllocGrowableBitMap));
+  }
+  sparse_ = false;
+  memcpy(storage_, src->storage_, sizeof(uint32_t) * storage_size_);
 }
 
 // Intersect with another bit vector.  Sizes and expandability must be the same.
 void ArenaBitVector::Intersect(const ArenaBitVector* src) {
   DCHECK_EQ(storage_size_, src->GetStorageSize());
   DCHECK_EQ(expandable_, src->IsExpandable());
-  for (unsigned int idx = 0; idx < storage_size_; idx++) {
-    storage_[idx] &= src->GetRawStorageWord(idx);
+  if (sparse_) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < num_indices_; i++) {
+      uint32_t idx = indices_[i];
+      if (src->sparse_ ? src->IsSparseBitSet(idx)
+                       : (src->storage_[idx >> 5] & check_masks[idx & 0x1f]) != 0) {
+        indices_[kept++] = idx;
+      }
+    }
+    num_indices_ = kept;
+  } else if (src->sparse_) {
+    // The intersection is a subset of src, so it fits the list.
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < src->num_indices_; i++) {
+      uint32_t idx = src->indices_[i];
+      if ((storage_[idx >> 5] & check_masks[idx & 0x1f]) != 0) {
+        indices_[kept++] = idx;
+      }
+    }
+    num_indices_ = kept;
+    sparse_ = true;
+  } else {
+    uint32_t* __restrict dest = storage_;
+    const uint32_t* __restrict other = src->storage_;
+    for (uint32_t idx = 0; idx < storage_size_; idx++) {
+      dest[idx] &= other[idx];
+    }
   }
 }
 
@@ -108,13 +229,107 @@ void ArenaBitVector::Intersect(const ArenaBitVector* src) {
 void ArenaBitVector::Union(const ArenaBitVector* src) {
   DCHECK_EQ(storage_size_, src->GetStorageSize());
   DCHECK_EQ(expandable_, src->IsExpandable());
-  for (unsigned int idx = 0; idx < storage_size_; idx++) {
-    storage_[idx] |= src->GetRawStorageWord(idx);
+  if (src->sparse_) {
+    if (sparse_) {
+      // Merge the sorted lists, unless the union doesn't fit.
+      const uint32_t* a = indices_;
+      const uint32_t* a_end = indices_ + num_indices_;
+      const uint32_t* b = src->indices_;
+      const uint32_t* b_end = src->indices_ + src->num_indices_;
+      uint32_t count = 0;
+      while ((a != a_end || b != b_end) && count < sparse_capacity_) {
+        if (b == b_end || (a != a_end && *a < *b)) {
+          scratch_indices_[count++] = *a++;
+        } else {
+          if (a != a_end && *a == *b) {
+            ++a;
+          }
+          scratch_indices_[count++] = *b++;
+        }
+      }
+      if (a == a_end && b == b_end) {
+        std::swap(indices_, scratch_indices_);
+        num_indices_ = count;
+        return;
+      }
+      Densify();
+    }
+    for (uint32_t i = 0; i < src->num_indices_; i++) {
+      storage_[src->indices_[i] >> 5] |= check_masks[src->indices_[i] & 0x1f];
+    }
+    return;
+  }
+  if (sparse_) {
+    Densify();
+  }
+  uint32_t* __restrict dest = storage_;
+  const uint32_t* __restrict other = src->storage_;
+  for (uint32_t idx = 0; idx < storage_size_; idx++) {
+    dest[idx] |= other[idx];
+  }
+}
+
+void ArenaBitVector::UnionDifference(const ArenaBitVector* src1, const ArenaBitVector* src2) {
+  DCHECK_EQ(storage_size_, src1->GetStorageSize());
+  DCHECK_EQ(storage_size_, src2->GetStorageSize());
+  if (src1->sparse_) {
+    for (uint32_t i = 0; i < src1->num_indices_; i++) {
+      uint32_t idx = src1->indices_[i];
+      if (src2->sparse_ ? !src2->IsSparseBitSet(idx)
+                        : (src2->storage_[idx >> 5] & check_masks[idx & 0x1f]) == 0) {
+        SetBit(idx);
+      }
+    }
+    return;
+  }
+  if (sparse_) {
+    Densify();
+  }
+  uint32_t* __restrict dest = storage_;
+  const uint32_t* __restrict other1 = src1->storage_;
+  if (src2->sparse_) {
+    const uint32_t* next = src2->indices_;
+    const uint32_t* end = src2->indices_ + src2->num_indices_;
+    for (uint32_t idx = 0; idx < storage_size_; idx++) {
+      dest[idx] |= other1[idx] & ~SparseWord(idx, &next, end);
+    }
+    return;
+  }
+  const uint32_t* __restrict other2 = src2->storage_;
+  for (uint32_t idx = 0; idx < storage_size_; idx++) {
+    dest[idx] |= other1[idx] & ~other2[idx];
   }
 }
 
+bool ArenaBitVector::Equal(const ArenaBitVector* src) const {
+  if (storage_size_ != src->GetStorageSize() || expandable_ != src->IsExpandable()) {
+    return false;
+  }
+  if (sparse_ && src->sparse_) {
+    return num_indices_ == src->num_indices_ &&
+        memcmp(indices_, src->indices_, num_indices_ * sizeof(uint32_t)) == 0;
+  }
+  if (!sparse_ && !src->sparse_) {
+    return memcmp(storage_, src->storage_, storage_size_ * sizeof(uint32_t)) == 0;
+  }
+  // Compare the words the sparse one would have with those of the dense one.
+  const ArenaBitVector* sparse = sparse_ ? this : src;
+  const ArenaBitVector* dense = sparse_ ? src : this;
+  const uint32_t* next = sparse->indices_;
+  const uint32_t* end = sparse->indices_ + sparse->num_indices_;
+  for (uint32_t idx = 0; idx < storage_size_; idx++) {
+    if (dense->storage_[idx] != SparseWord(idx, &next, end)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Count the number of bits that are set.
 int ArenaBitVector::NumSetBits() {
+  if (sparse_) {
+    return num_indices_;
+  }
   unsigned int count = 0;
 
   for (unsigned int word = 0; word < storage_size_; word++) {
@@ -130,6 +345,9 @@ int ArenaBitVector::NumSetBits() {
  */
 void ArenaBitVector::SetInitialBits(unsigned int num_bits) {
   DCHECK_LE(((num_bits + 31) >> 5), storage_size_);
+  if (sparse_) {
+    Densify();
+  }
   unsigned int idx;
   for (idx = 0; idx < (num_bits >> 5); idx++) {
     storage_[idx] = -1;
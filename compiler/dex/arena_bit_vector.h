@@ -20,13 +20,22 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "compiler_enums.h"
-#include "arena_allocator.h"
+#include "base/arena_allocator.h"
+#include "utils.h"
 
 namespace art {
 
 /*
  * Expanding bitmap, used for tracking resources.  Bits are numbered starting
  * from zero.  All operations on a BitVector are unsynchronized.
+ *
+ * Non-expandable vectors of at least kMinSparseWords words start out sparse, as
+ * a sorted list of the indices of their set bits, and switch to the dense
+ * bitmap once the list fills up.  The list holds at most half as many indices
+ * as the bitmap has words, so that its two buffers take the room of the bitmap.
+ * This keeps the dominance frontiers, def-block and liveness sets of methods
+ * with thousands of blocks and registers cheap to iterate and merge, as most of
+ * them only have a handful of bits set.
  */
 class ArenaBitVector {
   public:
@@ -34,15 +43,24 @@ class ArenaBitVector {
       public:
         explicit Iterator(ArenaBitVector* bit_vector)
           : p_bits_(bit_vector),
-            bit_storage_(bit_vector->GetRawStorage()),
+            sparse_(bit_vector->sparse_),
+            bit_storage_(bit_vector->storage_),
+            indices_(bit_vector->indices_),
             bit_index_(0),
             bit_size_(p_bits_->storage_size_ * sizeof(uint32_t) * 8) {}
 
         // Return the position of the next set bit.  -1 means end-of-element reached.
         int Next() {
           // Did anything obviously change since we started?
-          DCHECK_EQ(bit_size_, p_bits_->GetStorageSize() * sizeof(uint32_t) * 8);
-          DCHECK_EQ(bit_storage_, p_bits_->GetRawStorage());
+          DCHECK_EQ(sparse_, p_bits_->sparse_);
+          DCHECK_EQ(bit_storage_, p_bits_->storage_);
+          DCHECK_EQ(indices_, p_bits_->indices_);
+
+          if (sparse_) {
+            // bit_index_ is the position in the list of indices.
+            if (bit_index_ >= p_bits_->num_indices_) return -1;
+            return indices_[bit_index_++];
+          }
 
           if (bit_index_ >= bit_size_) return -1;
 
@@ -74,11 +92,16 @@ class ArenaBitVector {
 
       private:
         ArenaBitVector* const p_bits_;
-        uint32_t* const bit_storage_;
+        const bool sparse_;
+        const uint32_t* const bit_storage_;
+        const uint32_t* const indices_;
         uint32_t bit_index_;              // Current index (size in bits).
         const uint32_t bit_size_;       // Size of vector in bits.
     };
 
+    // Vectors of fewer words are always dense, merging them is as cheap as it gets.
+    static constexpr uint32_t kMinSparseWords = 4;
+
     ArenaBitVector(ArenaAllocator* arena, unsigned int start_bits, bool expandable,
                    OatBitMapKind kind = kBitMapMisc);
     ~ArenaBitVector() {}
@@ -98,29 +121,37 @@ class ArenaBitVector {
     void Copy(ArenaBitVector* src);
     void Intersect(const ArenaBitVector* src2);
     void Union(const ArenaBitVector* src);
+    // Union with the bits of src1 that aren't set in src2.
+    void UnionDifference(const ArenaBitVector* src1, const ArenaBitVector* src2);
     // Are we equal to another bit vector?  Note: expandability attributes must also match.
-    bool Equal(const ArenaBitVector* src) {
-      return (storage_size_ == src->GetStorageSize()) &&
-        (expandable_ == src->IsExpandable()) &&
-        (memcmp(storage_, src->GetRawStorage(), storage_size_ * 4) == 0);
-    }
+    bool Equal(const ArenaBitVector* src) const;
     int NumSetBits();
 
     uint32_t GetStorageSize() const { return storage_size_; }
     bool IsExpandable() const { return expandable_; }
-    uint32_t GetRawStorageWord(size_t idx) const { return storage_[idx]; }
-    uint32_t* GetRawStorage() { return storage_; }
-    const uint32_t* GetRawStorage() const { return storage_; }
+    bool IsSparse() const { return sparse_; }
 
   private:
+    bool CanBeSparse() const { return indices_ != NULL; }
+    bool IsSparseBitSet(unsigned int num) const;
+    // Returns the word of a sparse vector holding the bits of idx for the indices from *next on,
+    // the indices of which being visited in increasing word order.
+    static uint32_t SparseWord(uint32_t idx, const uint32_t** next, const uint32_t* end);
+    // Switches to the dense bitmap, keeping the bits set.
+    void Densify();
+
     ArenaAllocator* const arena_;
     const bool expandable_;         // expand bitmap if we run out?
     const OatBitMapKind kind_;      // for memory use tuning.
     uint32_t   storage_size_;       // current size, in 32-bit words.
-    uint32_t*  storage_;
+    uint32_t*  storage_;            // NULL until a sparse vector first becomes dense.
+    bool       sparse_;             // are the set bits those of indices_?
+    uint32_t   num_indices_;
+    uint32_t   sparse_capacity_;
+    uint32_t*  indices_;            // sorted, NULL for vectors that are always dense.
+    uint32_t*  scratch_indices_;    // where unions are merged to before swapping with indices_.
 };
 
-
 }  // namespace art
 
 #endif  // ART_COMPILER_DEX_ARENA_BIT_VECTOR_H_
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "arena_bit_vector.h"
+
+#include <stdlib.h>
+
+#include <set>
+#include <vector>
+
+#include "base/logging.h"
+#include "gtest/gtest.h"
+#include "utils.h"
+
+namespace art {
+
+static const unsigned int kNumBits = 1024;
+
+static void ExpectSameBits(const std::set<unsigned int>& expected, ArenaBitVector* bits) {
+  EXPECT_EQ(expected.size(), static_cast<size_t>(bits->NumSetBits()));
+  ArenaBitVector::Iterator iterator(bits);
+  for (unsigned int bit : expected) {
+    EXPECT_TRUE(bits->IsBitSet(bit)) << bit;
+    EXPECT_EQ(static_cast<int>(bit), iterator.Next());
+  }
+  EXPECT_EQ(-1, iterator.Next());
+}
+
+TEST(ArenaBitVector, SwitchesToDenseWhenFull) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  ArenaBitVector bits(&arena, kNumBits, false);
+  ASSERT_TRUE(bits.IsSparse());
+  std::set<unsigned int> expected;
+  // Set in decreasing order, so that each index goes at the start of the list.
+  for (unsigned int bit = kNumBits - 1; bits.IsSparse(); bit -= 7) {
+    bits.SetBit(bit);
+    expected.insert(bit);
+  }
+  EXPECT_EQ(kNumBits / 64 + 1, expected.size());
+  ExpectSameBits(expected, &bits);
+  // Clearing brings back the list.
+  bits.ClearAllBits();
+  EXPECT_TRUE(bits.IsSparse());
+  ExpectSameBits(std::set<unsigned int>(), &bits);
+  bits.SetBit(5);
+  bits.SetBit(3);
+  bits.ClearBit(5);
+  bits.ClearBit(4);
+  expected.clear();
+  expected.insert(3);
+  ExpectSameBits(expected, &bits);
+
+  // Small and expandable vectors are always dense.
+  const unsigned int kMaxDenseOnlyBits = 32 * (ArenaBitVector::kMinSparseWords - 1);
+  EXPECT_FALSE(ArenaBitVector(&arena, kMaxDenseOnlyBits, false).IsSparse());
+  EXPECT_FALSE(ArenaBitVector(&arena, kNumBits, true).IsSparse());
+}
+
+// Checks the operations against sets, on vectors with increasingly many bits so that they are
+// sparse or dense in all the combinations.
+TEST(ArenaBitVector, MatchesSets) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  srand(42);
+  for (unsigned int num_set : { 0u, 1u, 4u, 15u, 16u, 17u, 100u, 600u }) {
+    std::vector<std::set<unsigned int> > sets(3);
+    std::vector<ArenaBitVector*> vectors;
+    for (size_t i = 0; i < sets.size(); ++i) {
+      vectors.push_back(new (&arena) ArenaBitVector(&arena, kNumBits, false));
+      for (unsigned int j = 0; j < num_set * (i + 1) / 2; ++j) {
+        unsigned int bit = rand() % kNumBits;
+        sets[i].insert(bit);
+        vectors[i]->SetBit(bit);
+      }
+      ExpectSameBits(sets[i], vectors[i]);
+    }
+
+    ArenaBitVector* result = new (&arena) ArenaBitVector(&arena, kNumBits, false);
+    for (size_t i = 0; i < sets.size(); ++i) {
+      for (size_t j = 0; j < sets.size(); ++j) {
+        std::set<unsigned int> expected(sets[i]);
+        expected.insert(sets[j].begin(), sets[j].end());
+        result->Copy(vectors[i]);
+        EXPECT_TRUE(result->Equal(vectors[i]));
+        result->Union(vectors[j]);
+        ExpectSameBits(expected, result);
+
+        expected.clear();
+        for (unsigned int bit : sets[i]) {
+          if (sets[j].count(bit) != 0) {
+            expected.insert(bit);
+          }
+        }
+        result->Copy(vectors[i]);
+        result->Intersect(vectors[j]);
+        ExpectSameBits(expected, result);
+        EXPECT_EQ(sets[i] == sets[j], vectors[i]->Equal(vectors[j]));
+
+        // result U= i & ~j, starting from the third set.
+        expected = sets[2];
+        for (unsigned int bit : sets[i]) {
+          if (sets[j].count(bit) == 0) {
+            expected.insert(bit);
+          }
+        }
+        result->Copy(vectors[2]);
+        result->UnionDifference(vectors[i], vectors[j]);
+        ExpectSameBits(expected, result);
+      }
+    }
+  }
+}
+
+// Places the phis of a generated method with a long chain of diamonds, the blocks of which only
+// have a couple of blocks in their dominance frontiers, as MIRGraph::InsertPhiNodes does.
+TEST(ArenaBitVector, PhiPlacementOfLargeMethod) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  const unsigned int kNumBlocks = 16 * 1024;
+  const unsigned int kNumRegisters = 256;
+  // Block 3 * i + 1 and 3 * i + 2 are the sides of the diamond ending with block 3 * i + 3.
+  std::vector<ArenaBitVector*> dom_frontier;
+  for (unsigned int block = 0; block < kNumBlocks; ++block) {
+    dom_frontier.push_back(new (&arena) ArenaBitVector(&arena, kNumBlocks, false));
+    if (block % 3 != 0 && block + 2 < kNumBlocks) {
+      dom_frontier[block]->SetBit(block - block % 3 + 3);
+    }
+  }
+  ArenaBitVector* input_blocks = new (&arena) ArenaBitVector(&arena, kNumBlocks, false);
+  ArenaBitVector* phi_blocks = new (&arena) ArenaBitVector(&arena, kNumBlocks, false);
+  uint64_t start_ns = NanoTime();
+  size_t num_phis = 0;
+  for (unsigned int reg = 0; reg < kNumRegisters; ++reg) {
+    // Each register is defined on one side of a few diamonds.
+    input_blocks->ClearAllBits();
+    for (unsigned int block = 3 * reg + 1; block < kNumBlocks; block += 3 * kNumRegisters) {
+      input_blocks->SetBit(block);
+    }
+    phi_blocks->ClearAllBits();
+    ArenaBitVector::Iterator iterator(input_blocks);
+    for (int block = iterator.Next(); block != -1; block = iterator.Next()) {
+      phi_blocks->Union(dom_frontier[block]);
+    }
+    EXPECT_EQ(input_blocks->NumSetBits(), phi_blocks->NumSetBits());
+    num_phis += phi_blocks->NumSetBits();
+  }
+  EXPECT_LT(0U, num_phis);
+  LOG(INFO) << "Placed " << num_phis << " phis for " << kNumRegisters << " registers of "
+            << kNumBlocks << " blocks in " << PrettyDuration(NanoTime() - start_ns);
+}
+
+}  // namespace art
@@ -18,7 +18,7 @@
 #define ART_COMPILER_DEX_BACKEND_H_
 
 #include "compiled_method.h"
-#include "arena_allocator.h"
+#include "base/arena_allocator.h"
 
 namespace art {
 
@@ -114,6 +114,7 @@ enum ExtendedMIROpcode {
   kMirOpCheck,
   kMirOpCheckPart2,
   kMirOpSelect,
+  kMirOpSumIntArray,
   kMirOpLast,
 };
 
@@ -126,6 +127,8 @@ enum MIROptimizationFlagPositons {
   kMIRInlinedPred,                    // Invoke is inlined via prediction.
   kMIRCallee,                         // Instruction is inlined from callee.
   kMIRIgnoreSuspendCheck,
+  kMIRIgnoreClInitCheck,              // Static storage is known to be initialized.
+  kMIRIgnoreCardMark,                 // Stored reference needs no card mark.
   kMIRDup,
   kMIRMark,                           // Temporary node mark.
 };
@@ -19,8 +19,8 @@
 
 #include <vector>
 #include <llvm/IR/Module.h>
-#include "arena_allocator.h"
 #include "backend.h"
+#include "base/arena_allocator.h"
 #include "compiler_enums.h"
 #include "dex/quick/mir_to_lir.h"
 #include "dex_instruction.h"
@@ -28,6 +28,7 @@
 #include "driver/dex_compilation_unit.h"
 #include "llvm/intrinsic_helper.h"
 #include "llvm/ir_builder.h"
+#include "method_compile_stats.h"
 #include "safe_map.h"
 
 namespace art {
@@ -66,9 +67,18 @@ struct CompilationUnit {
       num_regs(0),
       num_compiler_temps(0),
       compiler_flip_match(false),
+      compile_stats(NULL),
       arena(pool),
       mir_graph(NULL),
       cg(NULL) {}
+
+  // Charges the time since the previous pass to pass, with --dump-method-stats.
+  void EndPass(const char* pass) {
+    if (compile_stats != NULL) {
+      compile_stats->EndPass(pass);
+    }
+  }
+
   /*
    * Fields needed/generated by common frontend and generally used throughout
    * the compiler.
@@ -104,6 +114,9 @@ struct CompilationUnit {
   // Flips sense of compiler_method_match - apply flags if doesn't match.
   bool compiler_flip_match;
 
+  // Where the time goes, NULL unless the driver records the stats of its compilations.
+  MethodCompileStats* compile_stats;
+
   // TODO: move memory management to mir_graph, or just switch to using standard containers.
   ArenaAllocator arena;
 
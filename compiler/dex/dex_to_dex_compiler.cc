@@ -16,6 +16,7 @@
 
 #include "base/logging.h"
 #include "base/mutex.h"
+#include "class_linker.h"
 #include "dex_file-inl.h"
 #include "dex_instruction-inl.h"
 #include "driver/compiler_driver.h"
@@ -24,6 +25,7 @@
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/dex_cache.h"
+#include "scoped_thread_state_change.h"
 
 namespace art {
 namespace optimizer {
@@ -79,6 +81,13 @@ class DexCompiler {
   void CompileInstanceFieldAccess(Instruction* inst, uint32_t dex_pc,
                                   Instruction::Code new_opcode, bool is_put);
 
+  // Compiles a static field access into a quick static field access. Only the fields of the
+  // class declaring the compiled method are quickened: the class is being initialized or is
+  // initialized whenever the method runs, so the access needs no initialization check and the
+  // field offset is relative to the class of the method.
+  void CompileStaticFieldAccess(Instruction* inst, uint32_t dex_pc,
+                                Instruction::Code new_opcode, bool is_put);
+
   // Compiles a virtual method invocation into a quick virtual method invocation.
   // The method index is replaced by the vtable index where the corresponding
   // AbstractMethod can be found. Therefore, this does not involve any resolution
@@ -88,6 +97,12 @@ class DexCompiler {
   void CompileInvokeVirtual(Instruction* inst, uint32_t dex_pc,
                             Instruction::Code new_opcode, bool is_range);
 
+  // Compiles a super method invocation into a quick super method invocation. The method index
+  // is replaced by the vtable index of the invoked method in the vtable of the super class of
+  // the compiled method's class.
+  void CompileInvokeSuper(Instruction* inst, uint32_t dex_pc,
+                          Instruction::Code new_opcode, bool is_range);
+
   CompilerDriver& driver_;
   const DexCompilationUnit& unit_;
   const DexToDexCompilationLevel dex_to_dex_compilation_level_;
@@ -143,6 +158,44 @@ void DexCompiler::Compile() {
         CompileInstanceFieldAccess(inst, dex_pc, Instruction::IPUT_OBJECT_QUICK, true);
         break;
 
+      case Instruction::SGET:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SGET_QUICK, false);
+        break;
+
+      case Instruction::SGET_WIDE:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SGET_WIDE_QUICK, false);
+        break;
+
+      case Instruction::SGET_OBJECT:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SGET_OBJECT_QUICK, false);
+        break;
+
+      case Instruction::SPUT:
+      case Instruction::SPUT_BOOLEAN:
+      case Instruction::SPUT_BYTE:
+      case Instruction::SPUT_CHAR:
+      case Instruction::SPUT_SHORT:
+        // These opcodes have the same implementation in interpreter so group
+        // them under SPUT_QUICK.
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SPUT_QUICK, true);
+        break;
+
+      case Instruction::SPUT_WIDE:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SPUT_WIDE_QUICK, true);
+        break;
+
+      case Instruction::SPUT_OBJECT:
+        CompileStaticFieldAccess(inst, dex_pc, Instruction::SPUT_OBJECT_QUICK, true);
+        break;
+
+      case Instruction::INVOKE_SUPER:
+        CompileInvokeSuper(inst, dex_pc, Instruction::INVOKE_SUPER_QUICK, false);
+        break;
+
+      case Instruction::INVOKE_SUPER_RANGE:
+        CompileInvokeSuper(inst, dex_pc, Instruction::INVOKE_SUPER_RANGE_QUICK, true);
+        break;
+
       case Instruction::INVOKE_VIRTUAL:
         CompileInvokeVirtual(inst, dex_pc, Instruction::INVOKE_VIRTUAL_QUICK, false);
         break;
@@ -232,6 +285,84 @@ void DexCompiler::CompileInstanceFieldAccess(Instruction* inst,
   }
 }
 
+void DexCompiler::CompileStaticFieldAccess(Instruction* inst,
+                                           uint32_t dex_pc,
+                                           Instruction::Code new_opcode,
+                                           bool is_put) {
+  if (!kEnableQuickening || !PerformOptimizations()) {
+    return;
+  }
+  uint32_t field_idx = inst->VRegB_21c();
+  int field_offset;
+  int ssb_index;
+  bool is_referrers_class;
+  bool is_volatile;
+  bool fast_path = driver_.ComputeStaticFieldInfo(field_idx, &unit_, field_offset, ssb_index,
+                                                  is_referrers_class, is_volatile, is_put);
+  if (fast_path && is_referrers_class && !is_volatile && IsUint(16, field_offset)) {
+    VLOG(compiler) << "Quickening " << Instruction::Name(inst->Opcode())
+                   << " to " << Instruction::Name(new_opcode)
+                   << " by replacing field index " << field_idx
+                   << " by field offset " << field_offset
+                   << " at dex pc " << StringPrintf("0x%x", dex_pc) << " in method "
+                   << PrettyMethod(unit_.GetDexMethodIndex(), GetDexFile(), true);
+    // We are modifying 4 consecutive bytes.
+    inst->SetOpcode(new_opcode);
+    // Replace field index by field offset.
+    inst->SetVRegB_21c(static_cast<uint16_t>(field_offset));
+  }
+}
+
+void DexCompiler::CompileInvokeSuper(Instruction* inst,
+                                     uint32_t dex_pc,
+                                     Instruction::Code new_opcode,
+                                     bool is_range) {
+  if (!kEnableQuickening || !PerformOptimizations()) {
+    return;
+  }
+  uint32_t method_idx = is_range ? inst->VRegB_3rc() : inst->VRegB_35c();
+  MethodReference target_method(&GetDexFile(), method_idx);
+  InvokeType invoke_type = kSuper;
+  int vtable_idx;
+  uintptr_t direct_code;
+  uintptr_t direct_method;
+  bool fast_path = driver_.ComputeInvokeInfo(&unit_, dex_pc, invoke_type,
+                                             target_method, vtable_idx,
+                                             direct_code, direct_method,
+                                             false);
+  // The only fast path of a super call is its sharpening into a direct call, which checks that
+  // the resolved method is in the vtable of its class at its method index.
+  if (!fast_path || invoke_type != kDirect) {
+    return;
+  }
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    mirror::ArtMethod* resolved_method =
+        unit_.GetClassLinker()->FindDexCache(GetDexFile())->GetResolvedMethod(method_idx);
+    if (resolved_method == NULL) {
+      return;
+    }
+    vtable_idx = resolved_method->GetMethodIndex();
+  }
+  if (IsUint(16, vtable_idx)) {
+    VLOG(compiler) << "Quickening " << Instruction::Name(inst->Opcode())
+                   << "(" << PrettyMethod(method_idx, GetDexFile(), true) << ")"
+                   << " to " << Instruction::Name(new_opcode)
+                   << " by replacing method index " << method_idx
+                   << " by vtable index " << vtable_idx
+                   << " at dex pc " << StringPrintf("0x%x", dex_pc) << " in method "
+                   << PrettyMethod(unit_.GetDexMethodIndex(), GetDexFile(), true);
+    // We are modifying 4 consecutive bytes.
+    inst->SetOpcode(new_opcode);
+    // Replace method index by vtable index.
+    if (is_range) {
+      inst->SetVRegB_3rc(static_cast<uint16_t>(vtable_idx));
+    } else {
+      inst->SetVRegB_35c(static_cast<uint16_t>(vtable_idx));
+    }
+  }
+}
+
 void DexCompiler::CompileInvokeVirtual(Instruction* inst,
                                 uint32_t dex_pc,
                                 Instruction::Code new_opcode,
@@ -83,6 +83,19 @@ static uint32_t kCompilerOptimizerDisableFlags = 0 |  // Disable specific optimi
   // (1 << kBBOpt) |
   // (1 << kMatch) |
   // (1 << kPromoteCompilerTemps) |
+  // (1 << kMethodInlining) |
+  // (1 << kRangeCheckElimination) |
+  // (1 << kGlobalValueNumbering) |
+  // (1 << kLoopWeightedPromotion) |
+  // (1 << kSuspendCheckElimination) |
+  // (1 << kListScheduling) |
+  // (1 << kScalarReplacement) |
+  // (1 << kCardMarkElimination) |
+  // (1 << kImplicitNullChecks) |
+  // (1 << kImplicitStackOverflowChecks) |
+  (1 << kImplicitSuspendChecks) |
+  // (1 << kConstantFolding) |
+  // (1 << kLoopVectorization) |
   0;
 
 static uint32_t kCompilerDebugFlags = 0 |     // Enable debug/testing modes
@@ -106,6 +119,19 @@ static uint32_t kCompilerDebugFlags = 0 |     // Enable debug/testing modes
   // (1 << kDebugShowFilterStats) |
   0;
 
+static size_t CountMirs(const MIRGraph* mir_graph) {
+  size_t num_mirs = 0;
+  for (size_t i = 0; i < mir_graph->GetBasicBlockListCount(); ++i) {
+    BasicBlock* bb = mir_graph->GetBasicBlock(i);
+    if (bb != NULL) {
+      for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+        ++num_mirs;
+      }
+    }
+  }
+  return num_mirs;
+}
+
 static CompiledMethod* CompileMethod(CompilerDriver& compiler,
                                      const CompilerBackend compiler_backend,
                                      const DexFile::CodeItem* code_item,
@@ -120,6 +146,12 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
 
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   CompilationUnit cu(&compiler.GetArenaPool());
+  MethodCompileStatsTable* compile_stats_table = compiler.GetMethodCompileStats();
+  UniquePtr<MethodCompileStats> compile_stats;
+  if (compile_stats_table != NULL) {
+    compile_stats.reset(new MethodCompileStats(PrettyMethod(method_idx, dex_file)));
+    cu.compile_stats = compile_stats.get();
+  }
 
   cu.compiler_driver = &compiler;
   cu.class_linker = class_linker;
@@ -153,6 +185,8 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
   if (compiler_backend == kPortable) {
     // Fused long branches not currently usseful in bitcode.
     cu.disable_opt |= (1 << kBranchFusing);
+    // Nor is there a bitcode lowering of the vectorized loops.
+    cu.disable_opt |= (1 << kLoopVectorization);
   }
 
   if (cu.instruction_set == kMips) {
@@ -167,7 +201,22 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
         (1 << kSafeOptimizations) |
         (1 << kBBOpt) |
         (1 << kMatch) |
-        (1 << kPromoteCompilerTemps));
+        (1 << kPromoteCompilerTemps) |
+        (1 << kMethodInlining) |
+        (1 << kRangeCheckElimination) |
+        (1 << kGlobalValueNumbering) |
+        (1 << kSuspendCheckElimination) |
+        (1 << kScalarReplacement) |
+        (1 << kConstantFolding) |
+        (1 << kLoopVectorization));
+  }
+
+  if (cu.instruction_set != kThumb2) {
+    // Only the arm backend has latencies to schedule with.
+    cu.disable_opt |= (1 << kListScheduling);
+    // Only the arm runtime turns faults of null accesses into exceptions.
+    cu.disable_opt |= (1 << kImplicitNullChecks) | (1 << kImplicitStackOverflowChecks) |
+        (1 << kImplicitSuspendChecks);
   }
 
   cu.mir_graph.reset(new MIRGraph(&cu, &cu.arena));
@@ -180,6 +229,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
   /* Build the raw MIR graph */
   cu.mir_graph->InlineMethod(code_item, access_flags, invoke_type, class_def_idx, method_idx,
                               class_loader, dex_file);
+  cu.EndPass("build MIR graph");
 
 #if !defined(ART_USE_PORTABLE_COMPILER)
   if (cu.mir_graph->SkipCompilation(Runtime::Current()->GetCompilerFilter())) {
@@ -187,26 +237,49 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
   }
 #endif
 
+  /* Replace calls of trivial methods by their bodies */
+  cu.mir_graph->InlineCalls();
+  cu.EndPass("inlining");
+
   /* Do a code layout pass */
   cu.mir_graph->CodeLayout();
+  cu.EndPass("code layout");
 
   /* Perform SSA transformation for the whole method */
   cu.mir_graph->SSATransformation();
+  cu.EndPass("SSA and dataflow");
+
+  /* Replace the fields of objects which don't escape by registers */
+  cu.mir_graph->ScalarReplacement();
+  cu.EndPass("scalar replacement");
 
   /* Do constant propagation */
   cu.mir_graph->PropagateConstants();
+  cu.EndPass("constant propagation");
+
+  /* Drop the card marks of stores the GC doesn't need to see */
+  cu.mir_graph->CardMarkElimination();
+  cu.EndPass("card mark elimination");
 
   /* Count uses */
   cu.mir_graph->MethodUseCount();
+  cu.EndPass("use counts");
 
   /* Perform null check elimination */
   cu.mir_graph->NullCheckElimination();
+  cu.EndPass("null check elimination");
+
+  /* Eliminate range and suspend checks in counted loops, and vectorize them */
+  cu.mir_graph->CountedLoopOptimization();
+  cu.EndPass("counted loops");
 
   /* Combine basic blocks where possible */
   cu.mir_graph->BasicBlockCombine();
+  cu.EndPass("basic block combine");
 
   /* Do some basic block optimizations */
   cu.mir_graph->BasicBlockOptimization();
+  cu.EndPass("basic block optimization");
 
   if (cu.enable_debug & (1 << kDebugDumpCheckStats)) {
     cu.mir_graph->DumpCheckStats();
@@ -218,6 +291,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
 
   /* Set up regLocation[] array to describe values - one for each ssa_name. */
   cu.mir_graph->BuildRegLocations();
+  cu.EndPass("register locations");
 
   CompiledMethod* result = NULL;
 
@@ -246,6 +320,7 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
   cu.cg->Materialize();
 
   result = cu.cg->GetCompiledMethod();
+  cu.EndPass("compiled method");
 
   if (result) {
     VLOG(compiler) << "Compiled " << PrettyMethod(method_idx, dex_file);
@@ -265,6 +340,12 @@ static CompiledMethod* CompileMethod(CompilerDriver& compiler,
               << " " << PrettyMethod(method_idx, dex_file);
   }
 
+  if (compile_stats_table != NULL && result != NULL) {
+    compile_stats->mir_count = CountMirs(cu.mir_graph.get());
+    compile_stats->arena_bytes = cu.arena.BytesUsed();
+    compile_stats_table->Add(*compile_stats);
+  }
+
   return result;
 }
 
@@ -56,6 +56,19 @@ enum opt_control_vector {
   kMatch,
   kPromoteCompilerTemps,
   kBranchFusing,
+  kMethodInlining,
+  kRangeCheckElimination,
+  kGlobalValueNumbering,
+  kLoopWeightedPromotion,
+  kSuspendCheckElimination,
+  kListScheduling,
+  kScalarReplacement,
+  kCardMarkElimination,
+  kImplicitNullChecks,
+  kImplicitStackOverflowChecks,
+  kImplicitSuspendChecks,
+  kConstantFolding,
+  kLoopVectorization,
 };
 
 // Force code generation paths for testing.
@@ -20,7 +20,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "compiler_enums.h"
-#include "arena_allocator.h"
+#include "base/arena_allocator.h"
 
 namespace art {
 
@@ -40,6 +40,8 @@ enum OatListKind {
   kGrowableArrayFillArrayData,
   kGrowableArraySuccessorBlocks,
   kGrowableArrayPredecessors,
+  kGrowableArrayIDominated,
+  kGrowableArrayDomFrontier,
   kGNumListKinds
 };
 
@@ -150,6 +152,12 @@ class GrowableArray {
 
     size_t Size() const { return num_used_; }
 
+    // Drops the elements from index new_size on.
+    void SetSize(size_t new_size) {
+      DCHECK_LE(new_size, num_used_);
+      num_used_ = new_size;
+    }
+
     T* GetRawStorage() const { return elem_list_; }
 
     static void* operator new(size_t size, ArenaAllocator* arena) {
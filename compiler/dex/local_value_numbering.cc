@@ -18,6 +18,56 @@
 
 namespace art {
 
+bool LocalValueNumbering::IsVolatileInstanceField(uint32_t field_idx, bool is_put) {
+  int field_offset;
+  bool is_volatile;
+  // Leaves is_volatile set if the field can't be resolved.
+  cu_->compiler_driver->ComputeInstanceFieldInfo(field_idx,
+                                                 cu_->mir_graph->GetCurrentDexCompilationUnit(),
+                                                 field_offset, is_volatile, is_put);
+  return is_volatile;
+}
+
+/*
+ * Accessing a static field of another class checks that the class is initialized and may run
+ * its <clinit>, which can change any memory.  A later access through the same static storage
+ * base doesn't need the check if this one dominates it, nor does any access to a class the
+ * compiler already knows to be initialized.
+ */
+void LocalValueNumbering::HandleStaticFieldAccess(MIR* mir, bool is_put) {
+  int field_offset;
+  int ssb_index;
+  bool is_referrers_class;
+  bool is_volatile;
+  bool is_initialized;
+  bool fast_path = cu_->compiler_driver->ComputeStaticFieldInfo(
+      mir->dalvikInsn.vB, cu_->mir_graph->GetCurrentDexCompilationUnit(), field_offset, ssb_index,
+      is_referrers_class, is_volatile, is_put, &is_initialized);
+  if (!fast_path) {
+    // The runtime helper initializes the class.
+    KillAllMemory();
+  } else if (is_initialized) {
+    // No <clinit> can run.
+    mir->optimization_flags |= MIR_IGNORE_CLINIT_CHECK;
+    mir->meta.throw_insn->optimization_flags |= MIR_IGNORE_CLINIT_CHECK;
+  } else if (!is_referrers_class) {
+    DCHECK_GE(ssb_index, 0);
+    uint16_t ssb = static_cast<uint16_t>(ssb_index);
+    if (clinit_checked_.find(ssb) != clinit_checked_.end()) {
+      if (cu_->verbose) {
+        LOG(INFO) << "Removing class initialization check for 0x" << std::hex << mir->offset;
+      }
+      mir->optimization_flags |= MIR_IGNORE_CLINIT_CHECK;
+      mir->meta.throw_insn->optimization_flags |= MIR_IGNORE_CLINIT_CHECK;
+    } else {
+      clinit_checked_.insert(ssb);
+      KillAllMemory();
+    }
+  }
+  if (is_volatile) {
+    KillAllMemory();
+  }
+}
 
 uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
   uint16_t res = NO_VALUE;
@@ -28,8 +78,6 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::RETURN:
     case Instruction::RETURN_OBJECT:
     case Instruction::RETURN_WIDE:
-    case Instruction::MONITOR_ENTER:
-    case Instruction::MONITOR_EXIT:
     case Instruction::GOTO:
     case Instruction::GOTO_16:
     case Instruction::GOTO_32:
@@ -52,6 +100,16 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::IF_GEZ:
     case Instruction::IF_GTZ:
     case Instruction::IF_LEZ:
+    case kMirOpFusedCmplFloat:
+    case kMirOpFusedCmpgFloat:
+    case kMirOpFusedCmplDouble:
+    case kMirOpFusedCmpgDouble:
+    case kMirOpFusedCmpLong:
+      // Nothing defined - take no action.
+      break;
+
+    case Instruction::MONITOR_ENTER:
+    case Instruction::MONITOR_EXIT:
     case Instruction::INVOKE_STATIC_RANGE:
     case Instruction::INVOKE_STATIC:
     case Instruction::INVOKE_DIRECT:
@@ -62,19 +120,14 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::INVOKE_SUPER_RANGE:
     case Instruction::INVOKE_INTERFACE:
     case Instruction::INVOKE_INTERFACE_RANGE:
-    case kMirOpFusedCmplFloat:
-    case kMirOpFusedCmpgFloat:
-    case kMirOpFusedCmplDouble:
-    case kMirOpFusedCmpgDouble:
-    case kMirOpFusedCmpLong:
-      // Nothing defined - take no action.
+      // Nothing defined, but other code may change any memory first.
+      KillAllMemory();
       break;
 
     case Instruction::MOVE_EXCEPTION:
     case Instruction::MOVE_RESULT:
     case Instruction::MOVE_RESULT_OBJECT:
     case Instruction::INSTANCE_OF:
-    case Instruction::NEW_INSTANCE:
     case Instruction::CONST_STRING:
     case Instruction::CONST_STRING_JUMBO:
     case Instruction::CONST_CLASS:
@@ -84,6 +137,14 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         SetOperandValue(mir->ssa_rep->defs[0], res);
       }
       break;
+    case Instruction::NEW_INSTANCE: {
+        // May run the class initializer. The result is unique.
+        KillAllMemory();
+        uint16_t res = GetOperandValue(mir->ssa_rep->defs[0]);
+        SetOperandValue(mir->ssa_rep->defs[0], res);
+      }
+      break;
+
     case Instruction::MOVE_RESULT_WIDE: {
         // 1 wide result, treat as unique each time, use result s_reg - will be unique.
         uint16_t res = GetOperandValueWide(mir->ssa_rep->defs[0]);
@@ -93,8 +154,8 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
 
     case kMirOpPhi:
       /*
-       * Because we'll only see phi nodes at the beginning of an extended basic block,
-       * we can ignore them.  Revisit if we shift to global value numbering.
+       * Phi nodes only appear at merge points.  The defined s_reg gets a unique value on its
+       * first use, which is conservative even when all operands have the same value.
        */
       break;
 
@@ -383,8 +444,9 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         mir->meta.throw_insn->optimization_flags |= mir->optimization_flags;
         // Use side effect to note range check completed.
         (void)LookupValue(ARRAY_REF, array, index, NO_VALUE);
-        // Establish value number for loaded register. Note use of memory version.
-        uint16_t memory_version = GetMemoryVersion(array, NO_VALUE);
+        // Establish value number for loaded register. Note use of memory version, which is shared
+        // by all arrays since any two may alias.
+        uint16_t memory_version = GetMemoryVersion(NO_VALUE, NO_VALUE);
         uint16_t res = LookupValue(ARRAY_REF, array, index, memory_version);
         if (opcode == Instruction::AGET_WIDE) {
           SetOperandValueWide(mir->ssa_rep->defs[0], res);
@@ -423,7 +485,7 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         // Use side effect to note range check completed.
         (void)LookupValue(ARRAY_REF, array, index, NO_VALUE);
         // Rev the memory version
-        AdvanceMemoryVersion(array, NO_VALUE);
+        AdvanceMemoryVersion(NO_VALUE, NO_VALUE);
       }
       break;
 
@@ -445,7 +507,11 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         }
         mir->meta.throw_insn->optimization_flags |= mir->optimization_flags;
         uint16_t field_ref = mir->dalvikInsn.vC;
-        uint16_t memory_version = GetMemoryVersion(base, field_ref);
+        if (IsVolatileInstanceField(field_ref, false)) {
+          KillAllMemory();
+        }
+        // The memory version is per field, not per object, since base values may alias.
+        uint16_t memory_version = GetMemoryVersion(NO_VALUE, field_ref);
         if (opcode == Instruction::IGET_WIDE) {
           uint16_t res = LookupValue(Instruction::IGET_WIDE, base, field_ref, memory_version);
           SetOperandValueWide(mir->ssa_rep->defs[0], res);
@@ -475,7 +541,10 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
         }
         mir->meta.throw_insn->optimization_flags |= mir->optimization_flags;
         uint16_t field_ref = mir->dalvikInsn.vC;
-        AdvanceMemoryVersion(base, field_ref);
+        if (IsVolatileInstanceField(field_ref, true)) {
+          KillAllMemory();
+        }
+        AdvanceMemoryVersion(NO_VALUE, field_ref);
       }
       break;
 
@@ -486,6 +555,7 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::SGET_CHAR:
     case Instruction::SGET_SHORT:
     case Instruction::SGET_WIDE: {
+        HandleStaticFieldAccess(mir, false);
         uint16_t field_ref = mir->dalvikInsn.vB;
         uint16_t memory_version = GetMemoryVersion(NO_VALUE, field_ref);
         if (opcode == Instruction::SGET_WIDE) {
@@ -505,6 +575,7 @@ uint16_t LocalValueNumbering::GetValueNumber(MIR* mir) {
     case Instruction::SPUT_CHAR:
     case Instruction::SPUT_SHORT:
     case Instruction::SPUT_WIDE: {
+        HandleStaticFieldAccess(mir, true);
         uint16_t field_ref = mir->dalvikInsn.vB;
         AdvanceMemoryVersion(NO_VALUE, field_ref);
       }
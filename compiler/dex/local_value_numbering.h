@@ -25,15 +25,32 @@
 namespace art {
 
 // Key is s_reg, value is value name.
-typedef SafeMap<uint16_t, uint16_t> SregValueMap;
+typedef SafeMap<uint16_t, uint16_t, std::less<uint16_t>,
+                ArenaAllocatorAdapter<std::pair<const uint16_t, uint16_t> > > SregValueMap;
 // Key is concatenation of quad, value is value name.
-typedef SafeMap<uint64_t, uint16_t> ValueMap;
+typedef SafeMap<uint64_t, uint16_t, std::less<uint64_t>,
+                ArenaAllocatorAdapter<std::pair<const uint64_t, uint16_t> > > ValueMap;
 // Key represents a memory address, value is generation.
-typedef SafeMap<uint32_t, uint16_t> MemoryVersionMap;
+typedef SafeMap<uint32_t, uint16_t, std::less<uint32_t>,
+                ArenaAllocatorAdapter<std::pair<const uint32_t, uint16_t> > > MemoryVersionMap;
+typedef std::set<uint16_t, std::less<uint16_t>, ArenaAllocatorAdapter<uint16_t> > ValueSet;
 
 class LocalValueNumbering {
  public:
-  explicit LocalValueNumbering(CompilationUnit* cu) : cu_(cu) {}
+  // The maps are allocated from arena, or from the heap if it is NULL.
+  LocalValueNumbering(CompilationUnit* cu, ArenaAllocator* arena)
+      : cu_(cu),
+        sreg_value_map_(ArenaAllocatorAdapter<uint16_t>(arena)),
+        sreg_wide_value_map_(ArenaAllocatorAdapter<uint16_t>(arena)),
+        value_map_(ArenaAllocatorAdapter<uint16_t>(arena)),
+        memory_version_map_(ArenaAllocatorAdapter<uint16_t>(arena)),
+        memory_version_counter_(0),
+        memory_epoch_(0),
+        null_checked_(std::less<uint16_t>(), ArenaAllocatorAdapter<uint16_t>(arena)),
+        clinit_checked_(std::less<uint16_t>(), ArenaAllocatorAdapter<uint16_t>(arena)) {}
+
+  // The implicit copy constructor is used by global value numbering: a dominator tree child starts
+  // with a copy of the state its immediate dominator had at its end, allocated the same way.
 
   static uint64_t BuildKey(uint16_t op, uint16_t operand1, uint16_t operand2, uint16_t modifier) {
     return (static_cast<uint64_t>(op) << 48 | static_cast<uint64_t>(operand1) << 32 |
@@ -64,7 +81,7 @@ class LocalValueNumbering {
     uint16_t res;
     MemoryVersionMap::iterator it = memory_version_map_.find(key);
     if (it == memory_version_map_.end()) {
-      res = 0;
+      res = memory_epoch_;
       memory_version_map_.Put(key, res);
     } else {
       res = it->second;
@@ -74,12 +91,14 @@ class LocalValueNumbering {
 
   void AdvanceMemoryVersion(uint16_t base, uint16_t field) {
     uint32_t key = (base << 16) | field;
-    MemoryVersionMap::iterator it = memory_version_map_.find(key);
-    if (it == memory_version_map_.end()) {
-      memory_version_map_.Put(key, 0);
-    } else {
-      it->second++;
-    }
+    memory_version_map_.Overwrite(key, ++memory_version_counter_);
+  };
+
+  // Forget everything known about memory, e.g. after a call. Loads numbered afterwards never match
+  // loads numbered before.
+  void KillAllMemory() {
+    memory_version_map_.clear();
+    memory_epoch_ = ++memory_version_counter_;
   };
 
   void SetOperandValue(uint16_t s_reg, uint16_t value) {
@@ -129,12 +148,21 @@ class LocalValueNumbering {
   uint16_t GetValueNumber(MIR* mir);
 
  private:
+  bool IsVolatileInstanceField(uint32_t field_idx, bool is_put);
+  void HandleStaticFieldAccess(MIR* mir, bool is_put);
+
   CompilationUnit* const cu_;
   SregValueMap sreg_value_map_;
   SregValueMap sreg_wide_value_map_;
   ValueMap value_map_;
   MemoryVersionMap memory_version_map_;
-  std::set<uint16_t> null_checked_;
+  // Source of unique memory versions, never reset.
+  uint16_t memory_version_counter_;
+  // Version of every location not in memory_version_map_.
+  uint16_t memory_epoch_;
+  ValueSet null_checked_;
+  // Static storage base indexes whose class is known to be initialized.
+  ValueSet clinit_checked_;
 };
 
 }  // namespace art
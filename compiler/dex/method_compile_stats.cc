@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "method_compile_stats.h"
+
+#include <algorithm>
+#include <ostream>
+
+#include "base/stringprintf.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+MethodCompileStats::MethodCompileStats(const std::string& method)
+    : method(method),
+      mir_count(0),
+      lir_count(0),
+      assembler_retries(0),
+      arena_bytes(0),
+      start_ns(NanoTime()),
+      total_ns(0),
+      last_pass_end_ns_(start_ns) {
+}
+
+void MethodCompileStats::EndPass(const char* pass) {
+  uint64_t now_ns = NanoTime();
+  pass_ns.push_back(std::make_pair(pass, now_ns - last_pass_end_ns_));
+  last_pass_end_ns_ = now_ns;
+  total_ns = now_ns - start_ns;
+}
+
+static bool IsFaster(const MethodCompileStats& lhs, const MethodCompileStats& rhs) {
+  // Makes the heap a min-heap, the fastest of the slowest methods is the one replaced.
+  return lhs.total_ns > rhs.total_ns;
+}
+
+MethodCompileStatsTable::MethodCompileStatsTable(size_t max_slowest_methods)
+    : max_slowest_methods_(max_slowest_methods),
+      lock_("method compile stats lock"),
+      num_methods_(0),
+      total_ns_(0),
+      total_arena_bytes_(0) {
+}
+
+void MethodCompileStatsTable::Add(const MethodCompileStats& stats) {
+  MutexLock mu(Thread::Current(), lock_);
+  ++num_methods_;
+  total_ns_ += stats.total_ns;
+  total_arena_bytes_ += stats.arena_bytes;
+  for (size_t i = 0; i < stats.pass_ns.size(); ++i) {
+    SafeMap<std::string, uint64_t>::iterator it = pass_ns_.find(stats.pass_ns[i].first);
+    if (it == pass_ns_.end()) {
+      pass_ns_.Put(stats.pass_ns[i].first, stats.pass_ns[i].second);
+    } else {
+      it->second += stats.pass_ns[i].second;
+    }
+  }
+  if (max_slowest_methods_ == 0) {
+    return;
+  }
+  if (slowest_methods_.size() == max_slowest_methods_) {
+    if (stats.total_ns <= slowest_methods_.front().total_ns) {
+      return;
+    }
+    std::pop_heap(slowest_methods_.begin(), slowest_methods_.end(), IsFaster);
+    slowest_methods_.pop_back();
+  }
+  slowest_methods_.push_back(stats);
+  std::push_heap(slowest_methods_.begin(), slowest_methods_.end(), IsFaster);
+}
+
+void MethodCompileStatsTable::Dump(std::ostream& os) const {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Compiled " << num_methods_ << " methods in " << PrettyDuration(total_ns_) << " using "
+     << PrettySize(total_arena_bytes_) << " of arena memory\n";
+  os << "By pass:\n";
+  for (SafeMap<std::string, uint64_t>::const_iterator it = pass_ns_.begin();
+       it != pass_ns_.end(); ++it) {
+    os << StringPrintf("  %-24s %8.2f%% ", it->first.c_str(),
+                       (total_ns_ == 0) ? 0.0 : it->second * 100.0 / total_ns_)
+       << PrettyDuration(it->second) << "\n";
+  }
+  std::vector<MethodCompileStats> slowest_methods(slowest_methods_);
+  std::sort_heap(slowest_methods.begin(), slowest_methods.end(), IsFaster);
+  os << "Slowest " << slowest_methods.size() << " methods:\n";
+  for (size_t i = 0; i < slowest_methods.size(); ++i) {
+    const MethodCompileStats& stats = slowest_methods[i];
+    os << "  " << PrettyDuration(stats.total_ns) << " " << stats.method << ": "
+       << stats.mir_count << " MIRs, " << stats.lir_count << " LIRs, "
+       << stats.assembler_retries << " assembler retries, " << PrettySize(stats.arena_bytes)
+       << " of arena memory\n    ";
+    for (size_t j = 0; j < stats.pass_ns.size(); ++j) {
+      os << ((j == 0) ? "" : ", ") << stats.pass_ns[j].first << " "
+         << PrettyDuration(stats.pass_ns[j].second);
+    }
+    os << "\n";
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_DEX_METHOD_COMPILE_STATS_H_
+#define ART_COMPILER_DEX_METHOD_COMPILE_STATS_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "safe_map.h"
+
+namespace art {
+
+// Where the time of compiling one method went, pass by pass, and how big it got.
+struct MethodCompileStats {
+  explicit MethodCompileStats(const std::string& method);
+
+  // Charges the time since the end of the previous pass, or since the start, to pass, which must
+  // be a literal.
+  void EndPass(const char* pass);
+
+  std::string method;
+  size_t mir_count;
+  size_t lir_count;
+  size_t assembler_retries;
+  size_t arena_bytes;
+  uint64_t start_ns;
+  uint64_t total_ns;
+  std::vector<std::pair<const char*, uint64_t> > pass_ns;
+
+ private:
+  uint64_t last_pass_end_ns_;
+};
+
+// The quick compilations of dex2oat --dump-method-stats: the time of all of them by pass, and the
+// slowest ones in detail, to find the methods that blow the compile time budget.
+class MethodCompileStatsTable {
+ public:
+  explicit MethodCompileStatsTable(size_t max_slowest_methods);
+
+  void Add(const MethodCompileStats& stats) LOCKS_EXCLUDED(lock_);
+
+  void Dump(std::ostream& os) const LOCKS_EXCLUDED(lock_);
+
+ private:
+  const size_t max_slowest_methods_;
+
+  mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  size_t num_methods_ GUARDED_BY(lock_);
+  uint64_t total_ns_ GUARDED_BY(lock_);
+  uint64_t total_arena_bytes_ GUARDED_BY(lock_);
+  SafeMap<std::string, uint64_t> pass_ns_ GUARDED_BY(lock_);
+  // A heap of the slowest methods, the fastest of them first.
+  std::vector<MethodCompileStats> slowest_methods_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(MethodCompileStatsTable);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_DEX_METHOD_COMPILE_STATS_H_
@@ -831,6 +831,9 @@ const uint32_t MIRGraph::analysis_attributes_[kMirOpLast] = {
 
   // 113 MIR_SELECT
   AN_NONE,
+
+  // 114 MIR_SUM_INT_ARRAY
+  AN_ARRAYOP,
 };
 
 struct MethodStats {
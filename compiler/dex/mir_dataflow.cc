@@ -840,6 +840,9 @@ const int MIRGraph::oat_data_flow_attributes_[kMirOpLast] = {
 
   // 113 MIR_SELECT
   DF_DA | DF_UB,
+
+  // 114 MIR_SUM_INT_ARRAY
+  DF_DA | DF_UA | DF_UB | DF_UC | DF_CORE_A | DF_REF_B | DF_CORE_C,
 };
 
 /* Return the base virtual register for a SSA name */
@@ -1287,6 +1290,10 @@ void MIRGraph::MethodUseCount() {
   if (cu_->disable_opt & (1 << kPromoteRegs)) {
     return;
   }
+  // Give uses inside loops more weight so that loop values win the promoted registers.
+  if (!(cu_->disable_opt & (1 << kLoopWeightedPromotion))) {
+    ComputeLoopNestingDepths();
+  }
   AllNodesIterator iter(this, false /* not iterative */);
   for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
     CountUses(bb);
@@ -69,6 +69,7 @@ const char* MIRGraph::extended_mir_op_names_[kMirOpLast - kMirOpFirst] = {
   "Check1",
   "Check2",
   "Select",
+  "SumIntArray",
 };
 
 MIRGraph::MIRGraph(CompilationUnit* cu, ArenaAllocator* arena)
@@ -81,6 +82,8 @@ MIRGraph::MIRGraph(CompilationUnit* cu, ArenaAllocator* arena)
       ssa_last_defs_(NULL),
       is_constant_v_(NULL),
       constant_values_(NULL),
+      constant_lattice_(NULL),
+      block_feasibility_(NULL),
       use_counts_(arena, 256, kGrowableArrayMisc),
       raw_use_counts_(arena, 256, kGrowableArrayMisc),
       num_reachable_blocks_(0),
@@ -89,7 +92,6 @@ MIRGraph::MIRGraph(CompilationUnit* cu, ArenaAllocator* arena)
       dom_post_order_traversal_(NULL),
       i_dom_list_(NULL),
       def_block_matrix_(NULL),
-      temp_block_v_(NULL),
       temp_dalvik_register_v_(NULL),
       temp_ssa_register_v_(NULL),
       block_list_(arena, 100, kGrowableArrayBlockList),
@@ -1144,6 +1146,8 @@ BasicBlock* MIRGraph::NewMemBB(BBType block_type, int block_id) {
                                                           ArenaAllocator::kAllocBB));
   bb->block_type = block_type;
   bb->id = block_id;
+  bb->dom_pre_order = -1;
+  bb->dom_last_descendant = -1;
   // TUNING: better estimate of the exit block predecessors?
   bb->predecessors = new (arena_) GrowableArray<BasicBlock*>(arena_,
                                                              (block_type == kExitBlock) ? 2048 : 2,
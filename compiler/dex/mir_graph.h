@@ -179,6 +179,8 @@ enum OatMethodAttributes {
 #define MIR_INLINED_PRED                (1 << kMIRInlinedPred)
 #define MIR_CALLEE                      (1 << kMIRCallee)
 #define MIR_IGNORE_SUSPEND_CHECK        (1 << kMIRIgnoreSuspendCheck)
+#define MIR_IGNORE_CLINIT_CHECK         (1 << kMIRIgnoreClInitCheck)
+#define MIR_IGNORE_CARD_MARK            (1 << kMIRIgnoreCardMark)
 #define MIR_DUP                         (1 << kMIRDup)
 
 #define BLOCK_NAME_LEN 80
@@ -254,6 +256,8 @@ struct SuccessorBlockInfo;
 struct BasicBlock {
   int id;
   int dfs_id;
+  int dom_pre_order;                // In the dominator tree, -1 for unreachable blocks.
+  int dom_last_descendant;          // Largest dom_pre_order of the blocks it dominates.
   bool visited;
   bool hidden;
   bool catch_entry;
@@ -271,9 +275,8 @@ struct BasicBlock {
   BasicBlock* i_dom;                // Immediate dominator.
   BasicBlockDataFlow* data_flow_info;
   GrowableArray<BasicBlock*>* predecessors;
-  ArenaBitVector* dominators;
-  ArenaBitVector* i_dominated;      // Set nodes being immediately dominated.
-  ArenaBitVector* dom_frontier;     // Dominance frontier.
+  GrowableArray<BasicBlock*>* i_dominated;   // Nodes being immediately dominated.
+  GrowableArray<BasicBlock*>* dom_frontier;  // Dominance frontier.
   struct {                          // For one-to-many successors like.
     BlockListType block_list_type;  // switch and exception handling.
     GrowableArray<SuccessorBlockInfo*>* blocks;
@@ -417,6 +420,12 @@ class MIRGraph {
     return dom_post_order_traversal_;
   }
 
+  // Does a dominate b?  Only valid after ComputeDominators, false if either is unreachable.
+  bool Dominates(const BasicBlock* a, const BasicBlock* b) const {
+    return b->dom_pre_order >= 0 && a->dom_pre_order <= b->dom_pre_order &&
+        b->dom_pre_order <= a->dom_last_descendant;
+  }
+
   int GetDefCount() const {
     return def_count_;
   }
@@ -578,8 +587,11 @@ class MIRGraph {
   void VerifyDataflow();
   void MethodUseCount();
   void SSATransformation();
-  void CheckForDominanceFrontier(BasicBlock* dom_bb, const BasicBlock* succ_bb);
   void NullCheckElimination();
+  void InlineCalls();
+  void ScalarReplacement();
+  void CardMarkElimination();
+  void CountedLoopOptimization();
   bool SetFp(int index, bool is_fp);
   bool SetCore(int index, bool is_core);
   bool SetRef(int index, bool is_ref);
@@ -654,24 +666,52 @@ class MIRGraph {
   void ComputeDefBlockMatrix();
   void ComputeDomPostOrderTraversal(BasicBlock* bb);
   void ComputeDominators();
+  void ComputeLoopNestingDepths();
   void InsertPhiNodes();
   void DoDFSPreOrderSSARename(BasicBlock* block);
   void SetConstant(int32_t ssa_reg, int value);
   void SetConstantWide(int ssa_reg, int64_t value);
   int GetSSAUseCount(int s_reg);
-  bool BasicBlockOpt(BasicBlock* bb);
+  bool BasicBlockOpt(BasicBlock* bb, bool local_value_numbering);
+  bool GlobalValueNumbering();
   bool EliminateNullChecks(BasicBlock* bb);
+  bool InlineCall(BasicBlock* bb, MIR* mir);
+  bool ReplaceAllocation(BasicBlock* bb, MIR* alloc,
+                         const std::vector<int, ArenaAllocatorAdapter<int> >& use_counts);
+  void MarkReachableAvoiding(BasicBlock* bb, const BasicBlock* avoid, ArenaBitVector* reached);
+  bool FindCountedLoop(BasicBlock* bb, MIR** ssa_defs, BasicBlock** ssa_def_blocks,
+                       int* index_sreg, int* bound_sreg, int32_t* min_start, ArenaBitVector* body);
+  bool IsIncrementByOne(const MIR* mir, int sreg) const;
+  void EliminateLoopRangeChecks(BasicBlock* bb, MIR** ssa_defs, BasicBlock** ssa_def_blocks,
+                                ArenaBitVector* body);
+  void EliminateShortLoopSuspendChecks(BasicBlock* bb, MIR** ssa_defs,
+                                       BasicBlock** ssa_def_blocks, ArenaBitVector* body);
+  void VectorizeSumLoop(BasicBlock* bb, MIR** ssa_defs, BasicBlock** ssa_def_blocks,
+                        ArenaBitVector* body);
   void NullCheckEliminationInit(BasicBlock* bb);
   bool BuildExtendedBBList(struct BasicBlock* bb);
   bool FillDefBlockMatrix(BasicBlock* bb);
   void InitializeDominationInfo(BasicBlock* bb);
   bool ComputeblockIDom(BasicBlock* bb);
-  bool ComputeBlockDominators(BasicBlock* bb);
   bool SetDominators(BasicBlock* bb);
   bool ComputeBlockLiveIns(BasicBlock* bb);
   bool InsertPhiNodeOperands(BasicBlock* bb);
   bool ComputeDominanceFrontier(BasicBlock* bb);
   void DoConstantPropogation(BasicBlock* bb);
+  bool LowerConstantLattice(int s_reg, bool overdefined, int32_t value);
+  bool LowerConstantDefs(MIR* mir, bool overdefined, int64_t value);
+  uint8_t ConstantOperand(const MIR* mir, int index, bool wide, int64_t* value) const;
+  int ConstantBinaryOperands(const MIR* mir, Instruction::Code op, bool literal, bool reversed,
+                             uint8_t* states, int64_t* values) const;
+  bool PropagateConstantsInMIR(BasicBlock* bb, MIR* mir);
+  bool IsFeasibleEdge(const BasicBlock* pred, const BasicBlock* succ) const;
+  uint8_t FeasibleExits(const BasicBlock* bb) const;
+  void MarkBlockFeasible(BasicBlock* bb, bool* change);
+  bool PropagateConstantsInBlock(BasicBlock* bb);
+  void RemoveEdge(BasicBlock* pred, BasicBlock* succ);
+  bool FoldConstantBranches();
+  void FoldConstantArithmetic(BasicBlock* bb);
+  void EliminateDeadConstants();
   void CountChecks(BasicBlock* bb);
   bool CombineBlocks(BasicBlock* bb);
   void AnalyzeBlock(BasicBlock* bb, struct MethodStats* stats);
@@ -685,6 +725,8 @@ class MIRGraph {
   int* ssa_last_defs_;              // length == method->registers_size
   ArenaBitVector* is_constant_v_;   // length == num_ssa_reg
   int* constant_values_;            // length == num_ssa_reg
+  uint8_t* constant_lattice_;       // length == num_ssa_reg
+  uint8_t* block_feasibility_;      // length == num_blocks
   // Use counts of ssa names.
   GrowableArray<uint32_t> use_counts_;      // Weighted by nesting depth
   GrowableArray<uint32_t> raw_use_counts_;  // Not weighted
@@ -694,7 +736,6 @@ class MIRGraph {
   GrowableArray<int>* dom_post_order_traversal_;
   int* i_dom_list_;
   ArenaBitVector** def_block_matrix_;    // num_dalvik_register x num_blocks.
-  ArenaBitVector* temp_block_v_;
   ArenaBitVector* temp_dalvik_register_v_;
   ArenaBitVector* temp_ssa_register_v_;  // num_ssa_regs.
   static const int kInvalidEntry = -1;
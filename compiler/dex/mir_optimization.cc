@@ -20,6 +20,16 @@
 
 namespace art {
 
+// Larger callees are never a single instruction and a return.
+static const uint32_t kMaxInlineCodeUnits = 4;
+
+// Counted loops running at most this many times need no suspend check on their back edges.
+static const int64_t kMaxSuspendFreeLoopTrips = 64;
+
+// Constructors of replaced allocations may chain up to java.lang.Object's through at most this
+// many constructors.
+static const int kMaxConstructorDepth = 4;
+
 static unsigned int Predecessors(BasicBlock* bb) {
   return bb->predecessors->Size();
 }
@@ -92,13 +102,850 @@ void MIRGraph::DoConstantPropogation(BasicBlock* bb) {
   /* TODO: implement code to handle arithmetic operations */
 }
 
+/*
+ * Sparse conditional constant propagation: each SSA name is undefined until a reachable
+ * definition is seen, then constant while all of them agree, then overdefined.  Blocks are only
+ * reachable through the edges of branches whose conditions can vary, so a phi ignores the values
+ * coming in from branches found never taken.  Only int and long arithmetic is evaluated.
+ */
+enum ConstantLatticeState {
+  kLatticeUndefined = 0,
+  kLatticeConstant,
+  kLatticeOverdefined,
+};
+
+enum BlockFeasibility {
+  kBlockFeasible = 1,
+  kTakenFeasible = 2,
+  kFallThroughFeasible = 4,
+};
+
+/*
+ * The 23x opcode computing the int or long arithmetic of opcode, NOP if it isn't one.  Literal
+ * forms take vC as their second operand, or as their first when reversed is set.
+ */
+static Instruction::Code BinaryArithOp(Instruction::Code opcode, bool* literal, bool* reversed) {
+  *literal = false;
+  *reversed = false;
+  switch (opcode) {
+    case Instruction::RSUB_INT:
+    case Instruction::RSUB_INT_LIT8:
+      *literal = true;
+      *reversed = true;
+      return Instruction::SUB_INT;
+    case Instruction::ADD_INT_LIT16:
+    case Instruction::ADD_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::ADD_INT:
+    case Instruction::ADD_INT_2ADDR:
+      return Instruction::ADD_INT;
+    case Instruction::SUB_INT:
+    case Instruction::SUB_INT_2ADDR:
+      return Instruction::SUB_INT;
+    case Instruction::MUL_INT_LIT16:
+    case Instruction::MUL_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::MUL_INT:
+    case Instruction::MUL_INT_2ADDR:
+      return Instruction::MUL_INT;
+    case Instruction::DIV_INT_LIT16:
+    case Instruction::DIV_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::DIV_INT:
+    case Instruction::DIV_INT_2ADDR:
+      return Instruction::DIV_INT;
+    case Instruction::REM_INT_LIT16:
+    case Instruction::REM_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::REM_INT:
+    case Instruction::REM_INT_2ADDR:
+      return Instruction::REM_INT;
+    case Instruction::AND_INT_LIT16:
+    case Instruction::AND_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::AND_INT:
+    case Instruction::AND_INT_2ADDR:
+      return Instruction::AND_INT;
+    case Instruction::OR_INT_LIT16:
+    case Instruction::OR_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::OR_INT:
+    case Instruction::OR_INT_2ADDR:
+      return Instruction::OR_INT;
+    case Instruction::XOR_INT_LIT16:
+    case Instruction::XOR_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::XOR_INT:
+    case Instruction::XOR_INT_2ADDR:
+      return Instruction::XOR_INT;
+    case Instruction::SHL_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::SHL_INT:
+    case Instruction::SHL_INT_2ADDR:
+      return Instruction::SHL_INT;
+    case Instruction::SHR_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::SHR_INT:
+    case Instruction::SHR_INT_2ADDR:
+      return Instruction::SHR_INT;
+    case Instruction::USHR_INT_LIT8:
+      *literal = true;
+      // Fall-through.
+    case Instruction::USHR_INT:
+    case Instruction::USHR_INT_2ADDR:
+      return Instruction::USHR_INT;
+    case Instruction::ADD_LONG:
+    case Instruction::ADD_LONG_2ADDR:
+      return Instruction::ADD_LONG;
+    case Instruction::SUB_LONG:
+    case Instruction::SUB_LONG_2ADDR:
+      return Instruction::SUB_LONG;
+    case Instruction::MUL_LONG:
+    case Instruction::MUL_LONG_2ADDR:
+      return Instruction::MUL_LONG;
+    case Instruction::DIV_LONG:
+    case Instruction::DIV_LONG_2ADDR:
+      return Instruction::DIV_LONG;
+    case Instruction::REM_LONG:
+    case Instruction::REM_LONG_2ADDR:
+      return Instruction::REM_LONG;
+    case Instruction::AND_LONG:
+    case Instruction::AND_LONG_2ADDR:
+      return Instruction::AND_LONG;
+    case Instruction::OR_LONG:
+    case Instruction::OR_LONG_2ADDR:
+      return Instruction::OR_LONG;
+    case Instruction::XOR_LONG:
+    case Instruction::XOR_LONG_2ADDR:
+      return Instruction::XOR_LONG;
+    case Instruction::SHL_LONG:
+    case Instruction::SHL_LONG_2ADDR:
+      return Instruction::SHL_LONG;
+    case Instruction::SHR_LONG:
+    case Instruction::SHR_LONG_2ADDR:
+      return Instruction::SHR_LONG;
+    case Instruction::USHR_LONG:
+    case Instruction::USHR_LONG_2ADDR:
+      return Instruction::USHR_LONG;
+    case Instruction::CMP_LONG:
+      return Instruction::CMP_LONG;
+    default:
+      return Instruction::NOP;
+  }
+}
+
+static bool IsLongOperandOp(Instruction::Code op) {
+  return (op >= Instruction::ADD_LONG && op <= Instruction::USHR_LONG) ||
+      (op == Instruction::CMP_LONG);
+}
+
+static bool IsLongShiftOp(Instruction::Code op) {
+  return (op == Instruction::SHL_LONG) || (op == Instruction::SHR_LONG) ||
+      (op == Instruction::USHR_LONG);
+}
+
+/* Computes op on constants, returns false if it throws. Int results are sign-extended. */
+static bool FoldBinaryArithOp(Instruction::Code op, int64_t lhs, int64_t rhs, int64_t* result) {
+  int32_t a = static_cast<int32_t>(lhs);
+  int32_t b = static_cast<int32_t>(rhs);
+  uint64_t ulhs = static_cast<uint64_t>(lhs);
+  uint64_t urhs = static_cast<uint64_t>(rhs);
+  switch (op) {
+    case Instruction::ADD_INT: a = static_cast<int32_t>(static_cast<uint32_t>(a) + b); break;
+    case Instruction::SUB_INT: a = static_cast<int32_t>(static_cast<uint32_t>(a) - b); break;
+    case Instruction::MUL_INT: a = static_cast<int32_t>(static_cast<uint32_t>(a) * b); break;
+    case Instruction::DIV_INT:
+      if (b == 0) {
+        return false;
+      }
+      // Integer.MIN_VALUE / -1 overflows back to Integer.MIN_VALUE.
+      a = (b == -1) ? static_cast<int32_t>(0u - static_cast<uint32_t>(a)) : a / b;
+      break;
+    case Instruction::REM_INT:
+      if (b == 0) {
+        return false;
+      }
+      a = (b == -1) ? 0 : a % b;
+      break;
+    case Instruction::AND_INT: a &= b; break;
+    case Instruction::OR_INT: a |= b; break;
+    case Instruction::XOR_INT: a ^= b; break;
+    case Instruction::SHL_INT:
+      a = static_cast<int32_t>(static_cast<uint32_t>(a) << (b & 31));
+      break;
+    case Instruction::SHR_INT: a >>= (b & 31); break;
+    case Instruction::USHR_INT:
+      a = static_cast<int32_t>(static_cast<uint32_t>(a) >> (b & 31));
+      break;
+    case Instruction::ADD_LONG: *result = static_cast<int64_t>(ulhs + urhs); return true;
+    case Instruction::SUB_LONG: *result = static_cast<int64_t>(ulhs - urhs); return true;
+    case Instruction::MUL_LONG: *result = static_cast<int64_t>(ulhs * urhs); return true;
+    case Instruction::DIV_LONG:
+      if (rhs == 0) {
+        return false;
+      }
+      *result = (rhs == -1) ? static_cast<int64_t>(0u - ulhs) : lhs / rhs;
+      return true;
+    case Instruction::REM_LONG:
+      if (rhs == 0) {
+        return false;
+      }
+      *result = (rhs == -1) ? 0 : lhs % rhs;
+      return true;
+    case Instruction::AND_LONG: *result = lhs & rhs; return true;
+    case Instruction::OR_LONG: *result = lhs | rhs; return true;
+    case Instruction::XOR_LONG: *result = lhs ^ rhs; return true;
+    case Instruction::SHL_LONG: *result = static_cast<int64_t>(ulhs << (b & 63)); return true;
+    case Instruction::SHR_LONG: *result = lhs >> (b & 63); return true;
+    case Instruction::USHR_LONG: *result = static_cast<int64_t>(ulhs >> (b & 63)); return true;
+    case Instruction::CMP_LONG: a = (lhs < rhs) ? -1 : ((lhs > rhs) ? 1 : 0); break;
+    default:
+      LOG(FATAL) << "Unexpected opcode " << op;
+      return false;
+  }
+  *result = a;
+  return true;
+}
+
+/* Whether op gives value whatever its other operand, as x * 0 does. */
+static bool IsAbsorbingOperand(Instruction::Code op, int64_t value) {
+  switch (op) {
+    case Instruction::MUL_INT:
+    case Instruction::AND_INT:
+      return static_cast<int32_t>(value) == 0;
+    case Instruction::OR_INT:
+      return static_cast<int32_t>(value) == -1;
+    case Instruction::MUL_LONG:
+    case Instruction::AND_LONG:
+      return value == 0;
+    case Instruction::OR_LONG:
+      return value == -1;
+    default:
+      return false;
+  }
+}
+
+/* Whether op gives its other operand when value is its second operand, or its first if first. */
+static bool IsIdentityOperand(Instruction::Code op, int64_t value, bool first) {
+  int32_t int_value = static_cast<int32_t>(value);
+  switch (op) {
+    case Instruction::ADD_INT:
+    case Instruction::OR_INT:
+    case Instruction::XOR_INT:
+      return int_value == 0;
+    case Instruction::MUL_INT:
+      return int_value == 1;
+    case Instruction::AND_INT:
+      return int_value == -1;
+    case Instruction::SUB_INT:
+    case Instruction::SHL_INT:
+    case Instruction::SHR_INT:
+    case Instruction::USHR_INT:
+      return !first && (int_value & 31) == 0;
+    case Instruction::DIV_INT:
+      return !first && int_value == 1;
+    case Instruction::ADD_LONG:
+    case Instruction::OR_LONG:
+    case Instruction::XOR_LONG:
+      return value == 0;
+    case Instruction::MUL_LONG:
+      return value == 1;
+    case Instruction::AND_LONG:
+      return value == -1;
+    case Instruction::SUB_LONG:
+      return !first && value == 0;
+    case Instruction::SHL_LONG:
+    case Instruction::SHR_LONG:
+    case Instruction::USHR_LONG:
+      return !first && (int_value & 63) == 0;
+    case Instruction::DIV_LONG:
+      return !first && value == 1;
+    default:
+      return false;
+  }
+}
+
+/* Computes the int or long conversion or negation opcode, returns false for the other opcodes. */
+static bool FoldUnaryArithOp(Instruction::Code opcode, int64_t operand, int64_t* result) {
+  int32_t value = static_cast<int32_t>(operand);
+  switch (opcode) {
+    case Instruction::NEG_INT:
+      *result = static_cast<int32_t>(0u - static_cast<uint32_t>(value));
+      break;
+    case Instruction::NOT_INT: *result = ~value; break;
+    case Instruction::NEG_LONG:
+      *result = static_cast<int64_t>(0u - static_cast<uint64_t>(operand));
+      break;
+    case Instruction::NOT_LONG: *result = ~operand; break;
+    case Instruction::INT_TO_LONG: *result = value; break;
+    case Instruction::LONG_TO_INT: *result = value; break;
+    case Instruction::INT_TO_BYTE: *result = static_cast<int8_t>(value); break;
+    case Instruction::INT_TO_CHAR: *result = static_cast<uint16_t>(value); break;
+    case Instruction::INT_TO_SHORT: *result = static_cast<int16_t>(value); break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+static bool IsUnaryArithOp(Instruction::Code opcode) {
+  int64_t unused;
+  return FoldUnaryArithOp(opcode, 0, &unused);
+}
+
+static bool IsConditionalBranch(Instruction::Code opcode) {
+  return (opcode >= Instruction::IF_EQ) && (opcode <= Instruction::IF_LEZ);
+}
+
+static bool EvaluateBranch(Instruction::Code opcode, int32_t src1, int32_t src2) {
+  switch (opcode) {
+    case Instruction::IF_EQ: return src1 == src2;
+    case Instruction::IF_NE: return src1 != src2;
+    case Instruction::IF_LT: return src1 < src2;
+    case Instruction::IF_GE: return src1 >= src2;
+    case Instruction::IF_GT: return src1 > src2;
+    case Instruction::IF_LE: return src1 <= src2;
+    case Instruction::IF_EQZ: return src1 == 0;
+    case Instruction::IF_NEZ: return src1 != 0;
+    case Instruction::IF_LTZ: return src1 < 0;
+    case Instruction::IF_GEZ: return src1 >= 0;
+    case Instruction::IF_GTZ: return src1 > 0;
+    case Instruction::IF_LEZ: return src1 <= 0;
+    default:
+      LOG(FATAL) << "Unexpected opcode " << opcode;
+      return false;
+  }
+}
+
+bool MIRGraph::LowerConstantLattice(int s_reg, bool overdefined, int32_t value) {
+  uint8_t state = constant_lattice_[s_reg];
+  if (state == kLatticeOverdefined) {
+    return false;
+  }
+  if (!overdefined && state == kLatticeConstant && constant_values_[s_reg] == value) {
+    return false;
+  }
+  if (!overdefined && state == kLatticeUndefined) {
+    constant_lattice_[s_reg] = kLatticeConstant;
+    constant_values_[s_reg] = value;
+  } else {
+    constant_lattice_[s_reg] = kLatticeOverdefined;
+  }
+  return true;
+}
+
+/* Lowers the defs of mir to value, or to overdefined. Returns true if any of them changed. */
+bool MIRGraph::LowerConstantDefs(MIR* mir, bool overdefined, int64_t value) {
+  bool change = LowerConstantLattice(mir->ssa_rep->defs[0], overdefined, Low32Bits(value));
+  if (mir->ssa_rep->num_defs == 2) {
+    change |= LowerConstantLattice(mir->ssa_rep->defs[1], overdefined, High32Bits(value));
+  }
+  return change;
+}
+
+/* The state of the operand at uses[index], setting value if constant. */
+uint8_t MIRGraph::ConstantOperand(const MIR* mir, int index, bool wide, int64_t* value) const {
+  int s_reg = mir->ssa_rep->uses[index];
+  uint8_t state = constant_lattice_[s_reg];
+  if (wide) {
+    int high_s_reg = mir->ssa_rep->uses[index + 1];
+    state = std::max(state, constant_lattice_[high_s_reg]);
+    *value = (static_cast<int64_t>(constant_values_[high_s_reg]) << 32) |
+        Low32Bits(static_cast<int64_t>(constant_values_[s_reg]));
+  } else {
+    *value = constant_values_[s_reg];
+  }
+  return state;
+}
+
+/*
+ * The operands of the arithmetic op of mir as found by BinaryArithOp.  Returns the index in uses
+ * of the operand replacing the result if the other is an identity of op, -1 if there is none.
+ */
+int MIRGraph::ConstantBinaryOperands(const MIR* mir, Instruction::Code op, bool literal,
+                                     bool reversed, uint8_t* states, int64_t* values) const {
+  bool wide = IsLongOperandOp(op);
+  int rhs_index = wide ? 2 : 1;
+  int identity = -1;
+  states[0] = ConstantOperand(mir, 0, wide, &values[0]);
+  if (literal) {
+    states[1] = kLatticeConstant;
+    values[1] = static_cast<int32_t>(mir->dalvikInsn.vC);
+    if (reversed) {
+      std::swap(states[0], states[1]);
+      std::swap(values[0], values[1]);
+    } else if (IsIdentityOperand(op, values[1], false)) {
+      identity = 0;
+    }
+    return identity;
+  }
+  states[1] = ConstantOperand(mir, rhs_index, wide && !IsLongShiftOp(op), &values[1]);
+  if (op == Instruction::CMP_LONG) {
+    return -1;
+  }
+  if (states[1] == kLatticeConstant && IsIdentityOperand(op, values[1], false)) {
+    identity = 0;
+  } else if (states[0] == kLatticeConstant && IsIdentityOperand(op, values[0], true)) {
+    identity = rhs_index;
+  }
+  return identity;
+}
+
+/* The value set by a MIR with the DF_SETS_CONST attribute, returns false if it isn't known. */
+static bool GetConstantOf(const MIR* mir, int64_t* value) {
+  int32_t vB = static_cast<int32_t>(mir->dalvikInsn.vB);
+  switch (mir->dalvikInsn.opcode) {
+    case Instruction::CONST_4:
+    case Instruction::CONST_16:
+    case Instruction::CONST:
+    case Instruction::CONST_WIDE_16:
+    case Instruction::CONST_WIDE_32:
+      *value = vB;
+      return true;
+    case Instruction::CONST_HIGH16:
+      *value = vB << 16;
+      return true;
+    case Instruction::CONST_WIDE:
+      *value = mir->dalvikInsn.vB_wide;
+      return true;
+    case Instruction::CONST_WIDE_HIGH16:
+      *value = static_cast<int64_t>(vB) << 48;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool MIRGraph::PropagateConstantsInMIR(BasicBlock* bb, MIR* mir) {
+  SSARepresentation* ssa_rep = mir->ssa_rep;
+  if (ssa_rep == NULL || ssa_rep->num_defs == 0) {
+    return false;
+  }
+  Instruction::Code opcode = mir->dalvikInsn.opcode;
+  int df_attributes = oat_data_flow_attributes_[opcode];
+  if (static_cast<int>(opcode) == kMirOpPhi) {
+    // Meet of the values coming in through the edges which may be taken.
+    int* incoming = reinterpret_cast<int*>(mir->dalvikInsn.vB);
+    bool change = false;
+    for (int i = 0; i < ssa_rep->num_uses; i++) {
+      if (IsFeasibleEdge(GetBasicBlock(incoming[i]), bb)) {
+        uint8_t state = constant_lattice_[ssa_rep->uses[i]];
+        if (state != kLatticeUndefined) {
+          change |= LowerConstantLattice(ssa_rep->defs[0], state == kLatticeOverdefined,
+                                         constant_values_[ssa_rep->uses[i]]);
+        }
+      }
+    }
+    return change;
+  }
+  if (df_attributes & DF_SETS_CONST) {
+    int64_t value;
+    if (GetConstantOf(mir, &value)) {
+      return LowerConstantDefs(mir, false, value);
+    }
+    return LowerConstantDefs(mir, true, 0);
+  }
+  if ((df_attributes & DF_IS_MOVE) && ssa_rep->num_uses == ssa_rep->num_defs) {
+    bool change = false;
+    for (int i = 0; i < ssa_rep->num_defs; i++) {
+      uint8_t state = constant_lattice_[ssa_rep->uses[i]];
+      if (state != kLatticeUndefined) {
+        change |= LowerConstantLattice(ssa_rep->defs[i], state == kLatticeOverdefined,
+                                       constant_values_[ssa_rep->uses[i]]);
+      }
+    }
+    return change;
+  }
+  bool literal;
+  bool reversed;
+  Instruction::Code op = BinaryArithOp(opcode, &literal, &reversed);
+  if (op != Instruction::NOP) {
+    uint8_t states[2];
+    int64_t values[2];
+    ConstantBinaryOperands(mir, op, literal, reversed, states, values);
+    for (int i = 0; i < 2; i++) {
+      if (states[i] == kLatticeConstant && IsAbsorbingOperand(op, values[i])) {
+        return LowerConstantDefs(mir, false, values[i]);
+      }
+    }
+    if (states[0] == kLatticeOverdefined || states[1] == kLatticeOverdefined) {
+      return LowerConstantDefs(mir, true, 0);
+    }
+    if (states[0] == kLatticeUndefined || states[1] == kLatticeUndefined) {
+      return false;
+    }
+    int64_t result = 0;
+    bool folds = FoldBinaryArithOp(op, values[0], values[1], &result);
+    return LowerConstantDefs(mir, !folds, result);
+  }
+  if (IsUnaryArithOp(opcode)) {
+    bool wide = (opcode == Instruction::NEG_LONG) || (opcode == Instruction::NOT_LONG) ||
+        (opcode == Instruction::LONG_TO_INT);
+    int64_t value;
+    uint8_t state = ConstantOperand(mir, 0, wide, &value);
+    if (state == kLatticeUndefined) {
+      return false;
+    }
+    int64_t result = 0;
+    FoldUnaryArithOp(opcode, value, &result);
+    return LowerConstantDefs(mir, state == kLatticeOverdefined, result);
+  }
+  return LowerConstantDefs(mir, true, 0);
+}
+
+bool MIRGraph::IsFeasibleEdge(const BasicBlock* pred, const BasicBlock* succ) const {
+  uint8_t flags = block_feasibility_[pred->id];
+  if ((flags & kBlockFeasible) == 0) {
+    return false;
+  }
+  if ((pred->taken == succ && (flags & kTakenFeasible) != 0) ||
+      (pred->fall_through == succ && (flags & kFallThroughFeasible) != 0)) {
+    return true;
+  }
+  if (pred->successor_block_list.block_list_type != kNotUsed) {
+    GrowableArray<SuccessorBlockInfo*>::Iterator iterator(pred->successor_block_list.blocks);
+    for (SuccessorBlockInfo* info = iterator.Next(); info != NULL; info = iterator.Next()) {
+      if (info->block == succ) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* The kTakenFeasible and kFallThroughFeasible flags of the edges bb may leave through. */
+uint8_t MIRGraph::FeasibleExits(const BasicBlock* bb) const {
+  MIR* last = bb->last_mir_insn;
+  if (last == NULL || !IsConditionalBranch(last->dalvikInsn.opcode) || last->ssa_rep == NULL) {
+    return kTakenFeasible | kFallThroughFeasible;
+  }
+  int64_t src1;
+  int64_t src2 = 0;
+  uint8_t state = ConstantOperand(last, 0, false, &src1);
+  if (last->ssa_rep->num_uses == 2) {
+    state = std::max(state, ConstantOperand(last, 1, false, &src2));
+  }
+  // An operand still undefined can't be, the branch is taken as varying rather than waited for.
+  if (state != kLatticeConstant) {
+    return kTakenFeasible | kFallThroughFeasible;
+  }
+  bool is_taken = EvaluateBranch(last->dalvikInsn.opcode, static_cast<int32_t>(src1),
+                                 static_cast<int32_t>(src2));
+  return is_taken ? kTakenFeasible : kFallThroughFeasible;
+}
+
+void MIRGraph::MarkBlockFeasible(BasicBlock* bb, bool* change) {
+  if (bb != NULL && (block_feasibility_[bb->id] & kBlockFeasible) == 0) {
+    block_feasibility_[bb->id] |= kBlockFeasible;
+    *change = true;
+  }
+}
+
+bool MIRGraph::PropagateConstantsInBlock(BasicBlock* bb) {
+  uint8_t flags = block_feasibility_[bb->id];
+  if ((flags & kBlockFeasible) == 0) {
+    return false;
+  }
+  bool change = false;
+  for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+    change |= PropagateConstantsInMIR(bb, mir);
+  }
+  uint8_t exits = FeasibleExits(bb);
+  if ((exits & ~flags) != 0) {
+    block_feasibility_[bb->id] |= exits;
+    change = true;
+  }
+  if (exits & kTakenFeasible) {
+    MarkBlockFeasible(bb->taken, &change);
+  }
+  if (exits & kFallThroughFeasible) {
+    MarkBlockFeasible(bb->fall_through, &change);
+  }
+  if (bb->successor_block_list.block_list_type != kNotUsed) {
+    GrowableArray<SuccessorBlockInfo*>::Iterator iterator(bb->successor_block_list.blocks);
+    for (SuccessorBlockInfo* info = iterator.Next(); info != NULL; info = iterator.Next()) {
+      MarkBlockFeasible(info->block, &change);
+    }
+  }
+  return change;
+}
+
+/* Drops pred from the predecessors of succ, with the phi operands coming in from it. */
+void MIRGraph::RemoveEdge(BasicBlock* pred, BasicBlock* succ) {
+  succ->predecessors->Delete(pred);
+  for (MIR* mir = succ->first_mir_insn; mir != NULL; mir = mir->next) {
+    if (static_cast<int>(mir->dalvikInsn.opcode) != kMirOpPhi) {
+      continue;
+    }
+    int* incoming = reinterpret_cast<int*>(mir->dalvikInsn.vB);
+    for (int i = 0; i < mir->ssa_rep->num_uses; i++) {
+      if (incoming[i] == pred->id) {
+        int last_slot = mir->ssa_rep->num_uses - 1;
+        mir->ssa_rep->uses[i] = mir->ssa_rep->uses[last_slot];
+        incoming[i] = incoming[last_slot];
+        mir->ssa_rep->num_uses--;
+        break;
+      }
+    }
+  }
+}
+
+/*
+ * Turns the branches never or always taken into a nop or a goto and kills the blocks no taken
+ * edge leads to.  Returns true if the CFG changed.
+ */
+bool MIRGraph::FoldConstantBranches() {
+  bool cfg_changed = false;
+  ReachableNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    uint8_t flags = block_feasibility_[bb->id];
+    MIR* last = bb->last_mir_insn;
+    if ((flags & kBlockFeasible) == 0 || last == NULL ||
+        !IsConditionalBranch(last->dalvikInsn.opcode) || bb->taken == bb->fall_through) {
+      continue;
+    }
+    if ((flags & (kTakenFeasible | kFallThroughFeasible)) == kTakenFeasible) {
+      last->dalvikInsn.opcode = Instruction::GOTO;
+      RemoveEdge(bb, bb->fall_through);
+      bb->fall_through = NULL;
+    } else if ((flags & (kTakenFeasible | kFallThroughFeasible)) == kFallThroughFeasible) {
+      last->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+      RemoveEdge(bb, bb->taken);
+      bb->taken = NULL;
+    } else {
+      continue;
+    }
+    last->ssa_rep->num_uses = 0;
+    bb->conditional_branch = false;
+    cfg_changed = true;
+  }
+  // The blocks left without feasible predecessors are only reached from each other.
+  ReachableNodesIterator kill_iter(this, false /* not iterative */);
+  for (BasicBlock* bb = kill_iter.Next(); bb != NULL; bb = kill_iter.Next()) {
+    if (bb->block_type != kDalvikByteCode || (block_feasibility_[bb->id] & kBlockFeasible) != 0) {
+      continue;
+    }
+    BasicBlock* succs[2] = { bb->taken, bb->fall_through };
+    for (int i = 0; i < 2; i++) {
+      if (succs[i] != NULL && (block_feasibility_[succs[i]->id] & kBlockFeasible) != 0) {
+        RemoveEdge(bb, succs[i]);
+      }
+    }
+    if (bb->successor_block_list.block_list_type != kNotUsed) {
+      GrowableArray<SuccessorBlockInfo*>::Iterator iterator(bb->successor_block_list.blocks);
+      for (SuccessorBlockInfo* info = iterator.Next(); info != NULL; info = iterator.Next()) {
+        if ((block_feasibility_[info->block->id] & kBlockFeasible) != 0) {
+          RemoveEdge(bb, info->block);
+        }
+      }
+    }
+    bb->block_type = kDead;
+    cfg_changed = true;
+  }
+  return cfg_changed;
+}
+
+/* Replaces the arithmetic of constant results by constants, and x + 0 and the like by moves. */
+void MIRGraph::FoldConstantArithmetic(BasicBlock* bb) {
+  for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+    SSARepresentation* ssa_rep = mir->ssa_rep;
+    Instruction::Code opcode = mir->dalvikInsn.opcode;
+    bool literal;
+    bool reversed;
+    Instruction::Code op = BinaryArithOp(opcode, &literal, &reversed);
+    if (ssa_rep == NULL || (op == Instruction::NOP && !IsUnaryArithOp(opcode))) {
+      continue;
+    }
+    bool wide = (ssa_rep->num_defs == 2);
+    if (constant_lattice_[ssa_rep->defs[0]] == kLatticeConstant &&
+        (!wide || constant_lattice_[ssa_rep->defs[1]] == kLatticeConstant)) {
+      int64_t value = Low32Bits(static_cast<int64_t>(constant_values_[ssa_rep->defs[0]]));
+      if (wide) {
+        value |= static_cast<int64_t>(constant_values_[ssa_rep->defs[1]]) << 32;
+        mir->dalvikInsn.opcode = Instruction::CONST_WIDE;
+        mir->dalvikInsn.vB_wide = value;
+      } else {
+        mir->dalvikInsn.opcode = Instruction::CONST;
+        mir->dalvikInsn.vB = static_cast<int32_t>(value);
+      }
+      ssa_rep->num_uses = 0;
+      continue;
+    }
+    if (op == Instruction::NOP) {
+      continue;
+    }
+    uint8_t states[2];
+    int64_t values[2];
+    int identity = ConstantBinaryOperands(mir, op, literal, reversed, states, values);
+    if (identity < 0) {
+      continue;
+    }
+    ssa_rep->uses[0] = ssa_rep->uses[identity];
+    if (wide) {
+      ssa_rep->uses[1] = ssa_rep->uses[identity + 1];
+    }
+    ssa_rep->num_uses = wide ? 2 : 1;
+    mir->dalvikInsn.opcode = wide ? Instruction::MOVE_WIDE : Instruction::MOVE;
+    mir->dalvikInsn.vB = SRegToVReg(ssa_rep->uses[0]);
+  }
+}
+
+/*
+ * Whether dropping mir only drops its defs.  A zero constant may be a null which the GC map of a
+ * later safepoint expects in its vreg, so it stays.
+ */
+static bool IsRemovableIfUnused(const MIR* mir) {
+  Instruction::Code opcode = mir->dalvikInsn.opcode;
+  bool literal;
+  bool reversed;
+  switch (BinaryArithOp(opcode, &literal, &reversed)) {
+    case Instruction::NOP:
+      break;
+    case Instruction::DIV_INT:
+    case Instruction::REM_INT:
+    case Instruction::DIV_LONG:
+    case Instruction::REM_LONG:
+      return false;
+    default:
+      return true;
+  }
+  switch (opcode) {
+    case Instruction::CONST_4:
+    case Instruction::CONST_16:
+    case Instruction::CONST:
+    case Instruction::CONST_HIGH16:
+      return mir->dalvikInsn.vB != 0;
+    case Instruction::CONST_WIDE_16:
+    case Instruction::CONST_WIDE_32:
+    case Instruction::CONST_WIDE:
+    case Instruction::CONST_WIDE_HIGH16:
+      return true;
+    default:
+      return IsUnaryArithOp(opcode);
+  }
+}
+
+/* Drops the constants and arithmetic whose results are never used, transitively. */
+void MIRGraph::EliminateDeadConstants() {
+  int num_ssa_regs = GetNumSSARegs();
+  std::vector<int, ArenaAllocatorAdapter<int> > use_counts(num_ssa_regs, 0,
+                                                           ArenaAllocatorAdapter<int>(arena_));
+  std::vector<MIR*, ArenaAllocatorAdapter<MIR*> > def_mirs(num_ssa_regs, NULL,
+                                                          ArenaAllocatorAdapter<MIR*>(arena_));
+  std::vector<MIR*, ArenaAllocatorAdapter<MIR*> > worklist((ArenaAllocatorAdapter<MIR*>(arena_)));
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    if (bb->block_type == kDead) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      if (mir->ssa_rep == NULL) {
+        continue;
+      }
+      for (int i = 0; i < mir->ssa_rep->num_uses; i++) {
+        use_counts[mir->ssa_rep->uses[i]]++;
+      }
+      if (IsRemovableIfUnused(mir)) {
+        for (int i = 0; i < mir->ssa_rep->num_defs; i++) {
+          def_mirs[mir->ssa_rep->defs[i]] = mir;
+        }
+        worklist.push_back(mir);
+      }
+    }
+  }
+  while (!worklist.empty()) {
+    MIR* mir = worklist.back();
+    worklist.pop_back();
+    SSARepresentation* ssa_rep = mir->ssa_rep;
+    if (ssa_rep->num_defs == 0 || use_counts[ssa_rep->defs[0]] != 0 ||
+        (ssa_rep->num_defs == 2 && use_counts[ssa_rep->defs[1]] != 0)) {
+      continue;
+    }
+    for (int i = 0; i < ssa_rep->num_uses; i++) {
+      int s_reg = ssa_rep->uses[i];
+      if (--use_counts[s_reg] == 0 && def_mirs[s_reg] != NULL) {
+        worklist.push_back(def_mirs[s_reg]);
+      }
+    }
+    mir->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+    ssa_rep->num_uses = 0;
+    ssa_rep->num_defs = 0;
+  }
+}
+
 void MIRGraph::PropagateConstants() {
   is_constant_v_ = new (arena_) ArenaBitVector(arena_, GetNumSSARegs(), false);
   constant_values_ = static_cast<int*>(arena_->Alloc(sizeof(int) * GetNumSSARegs(),
                                                      ArenaAllocator::kAllocDFInfo));
-  AllNodesIterator iter(this, false /* not iterative */);
-  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
-    DoConstantPropogation(bb);
+  if (cu_->disable_opt & (1 << kConstantFolding)) {
+    AllNodesIterator iter(this, false /* not iterative */);
+    for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+      DoConstantPropogation(bb);
+    }
+    return;
+  }
+  constant_lattice_ = static_cast<uint8_t*>(arena_->Alloc(GetNumSSARegs(),
+                                                          ArenaAllocator::kAllocDFInfo));
+  block_feasibility_ = static_cast<uint8_t*>(arena_->Alloc(GetNumBlocks(),
+                                                           ArenaAllocator::kAllocDFInfo));
+  // The names without a reachable def, the incoming arguments among them, may hold anything.
+  memset(constant_lattice_, kLatticeOverdefined, GetNumSSARegs());
+  ReachableNodesIterator init_iter(this, false /* not iterative */);
+  for (BasicBlock* bb = init_iter.Next(); bb != NULL; bb = init_iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      for (int i = 0; mir->ssa_rep != NULL && i < mir->ssa_rep->num_defs; i++) {
+        constant_lattice_[mir->ssa_rep->defs[i]] = kLatticeUndefined;
+      }
+    }
+  }
+  block_feasibility_[GetEntryBlock()->id] = kBlockFeasible;
+
+  ReversePostOrderDfsIterator iter(this, true /* iterative */);
+  bool change = false;
+  for (BasicBlock* bb = iter.Next(false); bb != NULL; bb = iter.Next(change)) {
+    change = PropagateConstantsInBlock(bb);
+  }
+
+  bool cfg_changed = FoldConstantBranches();
+  AllNodesIterator fold_iter(this, false /* not iterative */);
+  for (BasicBlock* bb = fold_iter.Next(); bb != NULL; bb = fold_iter.Next()) {
+    if (bb->block_type == kDalvikByteCode) {
+      FoldConstantArithmetic(bb);
+    }
+  }
+  EliminateDeadConstants();
+
+  // Only the constants and moves of constants are known to the code generators.
+  AllNodesIterator record_iter(this, false /* not iterative */);
+  for (BasicBlock* bb = record_iter.Next(); bb != NULL; bb = record_iter.Next()) {
+    if (bb->block_type == kDead) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      int df_attributes = oat_data_flow_attributes_[mir->dalvikInsn.opcode];
+      if (mir->ssa_rep == NULL || (df_attributes & (DF_SETS_CONST | DF_IS_MOVE)) == 0) {
+        continue;
+      }
+      for (int i = 0; i < mir->ssa_rep->num_defs; i++) {
+        if (constant_lattice_[mir->ssa_rep->defs[i]] == kLatticeConstant) {
+          is_constant_v_->SetBit(mir->ssa_rep->defs[i]);
+        }
+      }
+    }
+  }
+
+  if (cfg_changed) {
+    ComputeDFSOrders();
+    ComputeDominators();
   }
 }
 
@@ -209,16 +1056,18 @@ int MIRGraph::GetSSAUseCount(int s_reg) {
 
 
 /* Do some MIR-level extended basic block optimizations */
-bool MIRGraph::BasicBlockOpt(BasicBlock* bb) {
+bool MIRGraph::BasicBlockOpt(BasicBlock* bb, bool local_value_numbering) {
   if (bb->block_type == kDead) {
     return true;
   }
   int num_temps = 0;
-  LocalValueNumbering local_valnum(cu_);
+  LocalValueNumbering local_valnum(cu_, arena_);
   while (bb != NULL) {
     for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
-      // TUNING: use the returned value number for CSE.
-      local_valnum.GetValueNumber(mir);
+      if (local_value_numbering) {
+        // TUNING: use the returned value number for CSE.
+        local_valnum.GetValueNumber(mir);
+      }
       // Look for interesting opcodes, skip otherwise
       Instruction::Code opcode = mir->dalvikInsn.opcode;
       switch (opcode) {
@@ -777,33 +1626,982 @@ void MIRGraph::NullCheckElimination() {
   }
 }
 
-void MIRGraph::BasicBlockCombine() {
-  PreOrderDfsIterator iter(this, false /* not iterative */);
-  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
-    CombineBlocks(bb);
+/* Mark the blocks reachable from bb, including exception edges, without going through avoid */
+void MIRGraph::MarkReachableAvoiding(BasicBlock* bb, const BasicBlock* avoid,
+                                     ArenaBitVector* reached) {
+  GrowableArray<BasicBlock*> work_list(arena_, 16, kGrowableArrayMisc);
+  if (bb != avoid && !reached->IsBitSet(bb->id)) {
+    reached->SetBit(bb->id);
+    work_list.Insert(bb);
   }
-  if (cu_->enable_debug & (1 << kDebugDumpCFG)) {
-    DumpCFG("/sdcard/5_post_bbcombine_cfg/", false);
+  for (size_t idx = 0; idx < work_list.Size(); idx++) {
+    BasicBlock* cur = work_list.Get(idx);
+    BasicBlock* succs[2] = { cur->taken, cur->fall_through };
+    for (size_t i = 0; i < 2; i++) {
+      if (succs[i] != NULL && succs[i] != avoid && !reached->IsBitSet(succs[i]->id)) {
+        reached->SetBit(succs[i]->id);
+        work_list.Insert(succs[i]);
+      }
+    }
+    if (cur->successor_block_list.block_list_type != kNotUsed) {
+      GrowableArray<SuccessorBlockInfo*>::Iterator iterator(cur->successor_block_list.blocks);
+      while (true) {
+        SuccessorBlockInfo* successor_block_info = iterator.Next();
+        if (successor_block_info == NULL) break;
+        BasicBlock* succ_bb = successor_block_info->block;
+        if (succ_bb != avoid && !reached->IsBitSet(succ_bb->id)) {
+          reached->SetBit(succ_bb->id);
+          work_list.Insert(succ_bb);
+        }
+      }
+    }
   }
 }
 
-void MIRGraph::CodeLayout() {
-  if (cu_->enable_debug & (1 << kDebugVerifyDataflow)) {
-    VerifyDataflow();
-  }
-  AllNodesIterator iter(this, false /* not iterative */);
-  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
-    LayoutBlocks(bb);
+/*
+ * Decode the compare ending a loop test block.  On success index_sreg and bound_sreg hold the
+ * operands of an "index < bound" test, in_loop_bb the successor taken while it holds.
+ */
+static bool DecodeLoopTest(BasicBlock* bb, int* index_sreg, int* bound_sreg,
+                           BasicBlock** in_loop_bb, BasicBlock** exit_bb) {
+  MIR* test = bb->last_mir_insn;
+  if (test == NULL || test->ssa_rep == NULL || bb->taken == NULL || bb->fall_through == NULL ||
+      bb->taken == bb->fall_through) {
+    return false;
   }
-  if (cu_->enable_debug & (1 << kDebugDumpCFG)) {
-    DumpCFG("/sdcard/2_post_layout_cfg/", true);
+  switch (test->dalvikInsn.opcode) {
+    case Instruction::IF_GE:  // Exit if i >= n.
+      *index_sreg = test->ssa_rep->uses[0];
+      *bound_sreg = test->ssa_rep->uses[1];
+      *in_loop_bb = bb->fall_through;
+      *exit_bb = bb->taken;
+      return true;
+    case Instruction::IF_LT:  // Continue if i < n.
+      *index_sreg = test->ssa_rep->uses[0];
+      *bound_sreg = test->ssa_rep->uses[1];
+      *in_loop_bb = bb->taken;
+      *exit_bb = bb->fall_through;
+      return true;
+    case Instruction::IF_LE:  // Exit if n <= i.
+      *index_sreg = test->ssa_rep->uses[1];
+      *bound_sreg = test->ssa_rep->uses[0];
+      *in_loop_bb = bb->fall_through;
+      *exit_bb = bb->taken;
+      return true;
+    case Instruction::IF_GT:  // Continue if n > i.
+      *index_sreg = test->ssa_rep->uses[1];
+      *bound_sreg = test->ssa_rep->uses[0];
+      *in_loop_bb = bb->taken;
+      *exit_bb = bb->fall_through;
+      return true;
+    default:
+      return false;
   }
 }
 
-void MIRGraph::DumpCheckStats() {
-  Checkstats* stats =
-      static_cast<Checkstats*>(arena_->Alloc(sizeof(Checkstats), ArenaAllocator::kAllocDFInfo));
-  checkstats_ = stats;
+/*
+ * Look for the test of a counted loop at the end of bb:
+ *
+ *   bb:   i = Phi(c, i + 1, ...)     c constant from outside the loop
+ *         if-ge i, n -> exit          or any equivalent compare
+ *   body: ...
+ *
+ * Blocks entered through the in-loop successor of bb, which can't be reached from the exit
+ * successor or from an exception edge of bb without going through bb again, only run while
+ * i < n for the current value of i.  They are marked in body.  An increment of i in one of them
+ * can't overflow, so i only grows by one from its smallest start value, returned in min_start,
+ * on each trip.  Returns false if bb doesn't end such a loop.
+ */
+bool MIRGraph::FindCountedLoop(BasicBlock* bb, MIR** ssa_defs, BasicBlock** ssa_def_blocks,
+                               int* index_sreg, int* bound_sreg, int32_t* min_start,
+                               ArenaBitVector* body) {
+  BasicBlock* in_loop_bb;
+  BasicBlock* exit_bb;
+  if (!DecodeLoopTest(bb, index_sreg, bound_sreg, &in_loop_bb, &exit_bb)) {
+    return false;
+  }
+  MIR* phi = ssa_defs[*index_sreg];
+  if (phi == NULL || static_cast<int>(phi->dalvikInsn.opcode) != kMirOpPhi ||
+      ssa_def_blocks[*index_sreg] != bb) {
+    return false;
+  }
+
+  // Blocks which only run while the compare holds.
+  ArenaBitVector* from_exit =
+      new (arena_) ArenaBitVector(arena_, GetNumBlocks(), false, kBitMapMisc);
+  body->ClearAllBits();
+  MarkReachableAvoiding(in_loop_bb, bb, body);
+  MarkReachableAvoiding(exit_bb, bb, from_exit);
+  // Exceptions thrown in bb before the compare bypass it too.
+  if (bb->successor_block_list.block_list_type != kNotUsed) {
+    GrowableArray<SuccessorBlockInfo*>::Iterator iterator(bb->successor_block_list.blocks);
+    while (true) {
+      SuccessorBlockInfo* successor_block_info = iterator.Next();
+      if (successor_block_info == NULL) break;
+      MarkReachableAvoiding(successor_block_info->block, bb, from_exit);
+    }
+  }
+  ArenaBitVector::Iterator iter(from_exit);
+  for (int block_id = iter.Next(); block_id != -1; block_id = iter.Next()) {
+    body->ClearBit(block_id);
+  }
+
+  // Every value flowing into the Phi must be a constant from outside the loop or an i + 1 from
+  // the body. A constant from the body would restart the count.
+  bool has_start = false;
+  int* incoming = reinterpret_cast<int*>(phi->dalvikInsn.vB);
+  for (int i = 0; i < phi->ssa_rep->num_uses; i++) {
+    int use = phi->ssa_rep->uses[i];
+    if (IsConst(use)) {
+      if (incoming[i] == bb->id || body->IsBitSet(incoming[i])) {
+        return false;
+      }
+      if (!has_start || ConstantValue(use) < *min_start) {
+        *min_start = ConstantValue(use);
+      }
+      has_start = true;
+      continue;
+    }
+    MIR* inc = ssa_defs[use];
+    if (inc == NULL || !body->IsBitSet(ssa_def_blocks[use]->id) ||
+        !IsIncrementByOne(inc, *index_sreg)) {
+      return false;
+    }
+  }
+  return has_start;
+}
+
+/* Is mir "sreg + 1"? */
+bool MIRGraph::IsIncrementByOne(const MIR* mir, int sreg) const {
+  switch (mir->dalvikInsn.opcode) {
+    case Instruction::ADD_INT_LIT8:
+    case Instruction::ADD_INT_LIT16:
+      return (mir->ssa_rep->uses[0] == sreg) &&
+          (static_cast<int32_t>(mir->dalvikInsn.vC) == 1);
+    case Instruction::ADD_INT:
+    case Instruction::ADD_INT_2ADDR:
+      return ((mir->ssa_rep->uses[0] == sreg) && IsConst(mir->ssa_rep->uses[1]) &&
+              ConstantValue(mir->ssa_rep->uses[1]) == 1) ||
+          ((mir->ssa_rep->uses[1] == sreg) && IsConst(mir->ssa_rep->uses[0]) &&
+           ConstantValue(mir->ssa_rep->uses[0]) == 1);
+    default:
+      return false;
+  }
+}
+
+/*
+ * In a counted loop whose bound is an array length and whose index starts at 0 or above, range
+ * checks of the array indexed by the loop counter in the body are redundant:
+ *
+ *   bb:   i = Phi(c, i + 1, ...)     c constant >= 0
+ *         n = array-length arr
+ *         if-ge i, n -> exit
+ *   body: aget vX, arr, i
+ */
+void MIRGraph::EliminateLoopRangeChecks(BasicBlock* bb, MIR** ssa_defs,
+                                        BasicBlock** ssa_def_blocks, ArenaBitVector* body) {
+  int index_sreg;
+  int length_sreg;
+  int32_t min_start;
+  if (!FindCountedLoop(bb, ssa_defs, ssa_def_blocks, &index_sreg, &length_sreg, &min_start,
+                       body) || min_start < 0) {
+    return;
+  }
+  MIR* length = ssa_defs[length_sreg];
+  if (length == NULL || length->dalvikInsn.opcode != Instruction::ARRAY_LENGTH) {
+    return;
+  }
+  int array_sreg = length->ssa_rep->uses[0];
+
+  ArenaBitVector::Iterator iter(body);
+  for (int block_id = iter.Next(); block_id != -1; block_id = iter.Next()) {
+    BasicBlock* body_bb = GetBasicBlock(block_id);
+    for (MIR* mir = body_bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      if (mir->ssa_rep == NULL) {
+        continue;
+      }
+      int df_attributes = oat_data_flow_attributes_[mir->dalvikInsn.opcode];
+      int index_use;
+      if (df_attributes & DF_RANGE_CHK_1) {
+        index_use = 1;
+      } else if (df_attributes & DF_RANGE_CHK_2) {
+        index_use = 2;
+      } else if (df_attributes & DF_RANGE_CHK_3) {
+        index_use = 3;
+      } else {
+        continue;
+      }
+      // The array precedes the index in the uses.
+      if (mir->ssa_rep->uses[index_use] == index_sreg &&
+          mir->ssa_rep->uses[index_use - 1] == array_sreg) {
+        mir->optimization_flags |= MIR_IGNORE_RANGE_CHECK;
+      }
+    }
+  }
+}
+
+/*
+ * A counted loop with a constant bound runs at most kMaxSuspendFreeLoopTrips times, drop the
+ * suspend checks of its back edges.  Other backward branches in the body, including those of
+ * inner loops, keep theirs, so a thread still reaches a suspend point in bounded time.
+ */
+void MIRGraph::EliminateShortLoopSuspendChecks(BasicBlock* bb, MIR** ssa_defs,
+                                               BasicBlock** ssa_def_blocks,
+                                               ArenaBitVector* body) {
+  int index_sreg;
+  int bound_sreg;
+  int32_t min_start;
+  if (!FindCountedLoop(bb, ssa_defs, ssa_def_blocks, &index_sreg, &bound_sreg, &min_start,
+                       body) || !IsConst(bound_sreg)) {
+    return;
+  }
+  int64_t max_trips = static_cast<int64_t>(ConstantValue(bound_sreg)) - min_start;
+  if (max_trips > kMaxSuspendFreeLoopTrips) {
+    return;
+  }
+  ArenaBitVector::Iterator iter(body);
+  for (int block_id = iter.Next(); block_id != -1; block_id = iter.Next()) {
+    BasicBlock* body_bb = GetBasicBlock(block_id);
+    MIR* branch = body_bb->last_mir_insn;
+    if (branch == NULL || (body_bb->taken != bb && body_bb->fall_through != bb)) {
+      continue;
+    }
+    if (static_cast<int>(branch->dalvikInsn.opcode) < kMirOpFirst &&
+        (Instruction::FlagsOf(branch->dalvikInsn.opcode) & Instruction::kBranch) != 0) {
+      if (cu_->verbose) {
+        LOG(INFO) << "Suppressed suspend check on short loop back edge at 0x" << std::hex
+                  << branch->offset;
+      }
+      branch->optimization_flags |= MIR_IGNORE_SUSPEND_CHECK;
+    }
+  }
+}
+
+/*
+ * Replace the body of a loop summing the elements of an int array by a kMirOpSumIntArray, which
+ * the backend lowers to a loop adding several elements at a time with the vector unit:
+ *
+ *   bb:   i = Phi(c, i')             s = Phi(s0, s')
+ *         n = array-length arr       or defined before the loop
+ *         if-ge i, n -> exit
+ *   body: aget x, arr, i             null and range checks eliminated
+ *         add-int s', s, x
+ *         add-int/lit8 i', i, 1
+ *         goto bb
+ *
+ * becomes SumIntArray s', i' = s, arr, i, n, adding arr[i] to arr[i' - 1] to s with i' at most n.
+ * The backend bounds the elements summed by one SumIntArray so that the loop still reaches its
+ * suspend check in bounded time.  Nothing else may run in the loop, as it now runs fewer trips,
+ * and x must be dead at the loop head, as it is no longer written.
+ */
+void MIRGraph::VectorizeSumLoop(BasicBlock* bb, MIR** ssa_defs, BasicBlock** ssa_def_blocks,
+                                ArenaBitVector* body) {
+  int index_sreg;
+  int bound_sreg;
+  int32_t min_start;
+  if (!FindCountedLoop(bb, ssa_defs, ssa_def_blocks, &index_sreg, &bound_sreg, &min_start,
+                       body) || min_start < 0 || body->NumSetBits() != 1) {
+    return;
+  }
+  ArenaBitVector::Iterator body_iter(body);
+  BasicBlock* body_bb = GetBasicBlock(body_iter.Next());
+  if (body_bb->predecessors->Size() != 1 ||
+      !((body_bb->taken == bb && body_bb->fall_through == NULL) ||
+        (body_bb->fall_through == bb && body_bb->taken == NULL))) {
+    return;
+  }
+  MIR* load = body_bb->first_mir_insn;
+  if (load == NULL || load->dalvikInsn.opcode != Instruction::AGET ||
+      load->ssa_rep->uses[1] != index_sreg ||
+      (load->optimization_flags & (MIR_IGNORE_NULL_CHECK | MIR_IGNORE_RANGE_CHECK)) !=
+      (MIR_IGNORE_NULL_CHECK | MIR_IGNORE_RANGE_CHECK)) {
+    return;
+  }
+  int array_sreg = load->ssa_rep->uses[0];
+  int element_sreg = load->ssa_rep->defs[0];
+  MIR* length = ssa_defs[bound_sreg];
+  if (length == NULL || length->dalvikInsn.opcode != Instruction::ARRAY_LENGTH ||
+      length->ssa_rep->uses[0] != array_sreg) {
+    return;
+  }
+  MIR* add = load->next;
+  if (add == NULL || (add->dalvikInsn.opcode != Instruction::ADD_INT &&
+                      add->dalvikInsn.opcode != Instruction::ADD_INT_2ADDR)) {
+    return;
+  }
+  int sum_sreg;
+  if (add->ssa_rep->uses[0] == element_sreg) {
+    sum_sreg = add->ssa_rep->uses[1];
+  } else if (add->ssa_rep->uses[1] == element_sreg) {
+    sum_sreg = add->ssa_rep->uses[0];
+  } else {
+    return;
+  }
+  MIR* inc = add->next;
+  if (sum_sreg == element_sreg || inc == NULL || !IsIncrementByOne(inc, index_sreg)) {
+    return;
+  }
+  MIR* branch = inc->next;
+  if (branch != NULL && (branch->next != NULL ||
+                         (branch->dalvikInsn.opcode != Instruction::GOTO &&
+                          branch->dalvikInsn.opcode != Instruction::GOTO_16 &&
+                          branch->dalvikInsn.opcode != Instruction::GOTO_32))) {
+    return;
+  }
+  // The sum must be carried around the loop, the array revisited unchanged on every trip, and
+  // the test block must do nothing but the test.
+  int new_sum_sreg = add->ssa_rep->defs[0];
+  bool sum_carried = false;
+  for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+    if (static_cast<int>(mir->dalvikInsn.opcode) == kMirOpPhi) {
+      int def = mir->ssa_rep->defs[0];
+      if (def == array_sreg) {
+        return;
+      }
+      for (int i = 0; i < mir->ssa_rep->num_uses; i++) {
+        int use = mir->ssa_rep->uses[i];
+        if (use == element_sreg) {
+          return;
+        }
+        if (def == sum_sreg && use == new_sum_sreg) {
+          sum_carried = true;
+        }
+      }
+    } else if (mir != bb->last_mir_insn && mir != length &&
+               static_cast<int>(mir->dalvikInsn.opcode) != kMirOpNop) {
+      return;
+    }
+  }
+  if (!sum_carried) {
+    return;
+  }
+  if (cu_->verbose) {
+    LOG(INFO) << "Vectorized int array sum loop at 0x" << std::hex << load->offset;
+  }
+
+  SSARepresentation* ssa_rep = load->ssa_rep;
+  ssa_rep->num_uses = 4;
+  ssa_rep->uses = static_cast<int*>(arena_->Alloc(sizeof(int) * 4, ArenaAllocator::kAllocDFInfo));
+  ssa_rep->fp_use =
+      static_cast<bool*>(arena_->Alloc(sizeof(bool) * 4, ArenaAllocator::kAllocDFInfo));
+  ssa_rep->uses[0] = sum_sreg;
+  ssa_rep->uses[1] = array_sreg;
+  ssa_rep->uses[2] = index_sreg;
+  ssa_rep->uses[3] = bound_sreg;
+  ssa_rep->num_defs = 2;
+  ssa_rep->defs = static_cast<int*>(arena_->Alloc(sizeof(int) * 2, ArenaAllocator::kAllocDFInfo));
+  ssa_rep->fp_def =
+      static_cast<bool*>(arena_->Alloc(sizeof(bool) * 2, ArenaAllocator::kAllocDFInfo));
+  ssa_rep->defs[0] = new_sum_sreg;
+  ssa_rep->defs[1] = inc->ssa_rep->defs[0];
+  for (int i = 0; i < 4; i++) {
+    ssa_rep->fp_use[i] = false;
+  }
+  ssa_rep->fp_def[0] = false;
+  ssa_rep->fp_def[1] = false;
+  load->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpSumIntArray);
+  add->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+  inc->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+  ssa_defs[element_sreg] = NULL;
+  ssa_defs[ssa_rep->defs[0]] = load;
+  ssa_defs[ssa_rep->defs[1]] = load;
+}
+
+/* Optimize counted loops, see FindCountedLoop */
+void MIRGraph::CountedLoopOptimization() {
+  bool range_checks = !(cu_->disable_opt & (1 << kRangeCheckElimination));
+  bool suspend_checks = !(cu_->disable_opt & (1 << kSuspendCheckElimination));
+  bool vectorize = !(cu_->disable_opt & (1 << kLoopVectorization));
+  if (!range_checks && !suspend_checks && !vectorize) {
+    return;
+  }
+  // Map SSA names to the MIRs defining them.
+  int num_ssa_regs = GetNumSSARegs();
+  MIR** ssa_defs = static_cast<MIR**>(arena_->Alloc(sizeof(MIR*) * num_ssa_regs,
+                                                     ArenaAllocator::kAllocMisc));
+  BasicBlock** ssa_def_blocks =
+      static_cast<BasicBlock**>(arena_->Alloc(sizeof(BasicBlock*) * num_ssa_regs,
+                                              ArenaAllocator::kAllocMisc));
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      if (mir->ssa_rep != NULL) {
+        for (int i = 0; i < mir->ssa_rep->num_defs; i++) {
+          ssa_defs[mir->ssa_rep->defs[i]] = mir;
+          ssa_def_blocks[mir->ssa_rep->defs[i]] = bb;
+        }
+      }
+    }
+  }
+  ArenaBitVector* body = new (arena_) ArenaBitVector(arena_, GetNumBlocks(), false, kBitMapMisc);
+  AllNodesIterator iter2(this, false /* not iterative */);
+  for (BasicBlock* bb = iter2.Next(); bb != NULL; bb = iter2.Next()) {
+    if (bb->block_type == kDalvikByteCode) {
+      if (range_checks) {
+        EliminateLoopRangeChecks(bb, ssa_defs, ssa_def_blocks, body);
+      }
+      if (suspend_checks) {
+        EliminateShortLoopSuspendChecks(bb, ssa_defs, ssa_def_blocks, body);
+      }
+      if (vectorize) {
+        VectorizeSumLoop(bb, ssa_defs, ssa_def_blocks, body);
+      }
+    }
+  }
+}
+
+/* Caller's vreg holding the given word of the arguments of an invoke */
+static uint32_t InvokeArgVReg(const MIR* mir, uint32_t word) {
+  int flags = MIRGraph::oat_data_flow_attributes_[mir->dalvikInsn.opcode];
+  return (flags & DF_FORMAT_3RC) ? mir->dalvikInsn.vC + word : mir->dalvikInsn.arg[word];
+}
+
+/*
+ * Replace an invoke of a method which is a single instruction and a return by that instruction,
+ * reading and writing the caller's registers.  Instance methods are only inlined when the
+ * instruction is a field access on "this", whose null check stands in for the one of the invoke.
+ * A NullPointerException thrown there is reported at the dex pc of the invoke, just as if the
+ * call had been made.  Static methods are inlined when they return an argument or a constant,
+ * or nothing.
+ */
+bool MIRGraph::InlineCall(BasicBlock* bb, MIR* mir) {
+  InvokeType type;
+  switch (mir->dalvikInsn.opcode) {
+    case Instruction::INVOKE_STATIC:
+    case Instruction::INVOKE_STATIC_RANGE:
+      type = kStatic;
+      break;
+    case Instruction::INVOKE_DIRECT:
+    case Instruction::INVOKE_DIRECT_RANGE:
+      type = kDirect;
+      break;
+    case Instruction::INVOKE_VIRTUAL:
+    case Instruction::INVOKE_VIRTUAL_RANGE:
+      type = kVirtual;
+      break;
+    case Instruction::INVOKE_SUPER:
+    case Instruction::INVOKE_SUPER_RANGE:
+      type = kSuper;
+      break;
+    case Instruction::INVOKE_INTERFACE:
+    case Instruction::INVOKE_INTERFACE_RANGE:
+      type = kInterface;
+      break;
+    default:
+      return false;
+  }
+  bool is_static = (type == kStatic);
+  uint32_t method_idx = mir->dalvikInsn.vB;
+  const DexFile::CodeItem* code_item =
+      cu_->compiler_driver->ComputeInlineTarget(GetCurrentDexCompilationUnit(), mir->offset, type,
+                                                method_idx);
+  if (code_item == NULL || code_item->tries_size_ != 0 ||
+      code_item->insns_size_in_code_units_ > kMaxInlineCodeUnits) {
+    return false;
+  }
+  const Instruction* first = Instruction::At(code_item->insns_);
+  const Instruction* second = NULL;
+  if (first->SizeInCodeUnits() < code_item->insns_size_in_code_units_) {
+    second = first->Next();
+    if (first->SizeInCodeUnits() + second->SizeInCodeUnits() !=
+        code_item->insns_size_in_code_units_) {
+      return false;
+    }
+  }
+  DecodedInstruction insn(first);
+  // Callee vreg of the first argument word.
+  uint32_t ins_base = code_item->registers_size_ - code_item->ins_size_;
+  MIR* move_result = FindMoveResult(bb, mir);
+  DecodedInstruction* new_insn = &mir->dalvikInsn;
+  if (is_static && second == NULL && insn.opcode == Instruction::RETURN_VOID) {
+    new_insn->opcode = static_cast<Instruction::Code>(kMirOpNop);
+  } else if (is_static && second == NULL && move_result != NULL &&
+             (insn.opcode == Instruction::RETURN || insn.opcode == Instruction::RETURN_WIDE ||
+              insn.opcode == Instruction::RETURN_OBJECT) && insn.vA >= ins_base) {
+    // Return an argument.
+    new_insn->opcode = (insn.opcode == Instruction::RETURN) ? Instruction::MOVE :
+        ((insn.opcode == Instruction::RETURN_WIDE) ? Instruction::MOVE_WIDE :
+         Instruction::MOVE_OBJECT);
+    new_insn->vB = InvokeArgVReg(mir, insn.vA - ins_base);
+  } else if (is_static && second != NULL && move_result != NULL &&
+             (insn.opcode == Instruction::CONST_4 || insn.opcode == Instruction::CONST_16 ||
+              insn.opcode == Instruction::CONST) &&
+             (second->Opcode() == Instruction::RETURN ||
+              (second->Opcode() == Instruction::RETURN_OBJECT && insn.vB == 0)) &&
+             second->VRegA_11x() == insn.vA) {
+    new_insn->opcode = Instruction::CONST;
+    new_insn->vB = insn.vB;
+  } else if (!is_static && second != NULL && (insn.opcode >= Instruction::IGET &&
+             insn.opcode <= Instruction::IGET_SHORT) && insn.vB == ins_base &&
+             move_result != NULL && second->IsReturn() && second->VRegA_11x() == insn.vA) {
+    // Getter of a field of "this".
+    int field_offset;
+    bool is_volatile;
+    if (!cu_->compiler_driver->ComputeInstanceFieldInfo(insn.vC, GetCurrentDexCompilationUnit(),
+                                                        field_offset, is_volatile, false)) {
+      return false;
+    }
+    new_insn->opcode = insn.opcode;
+    new_insn->vB = InvokeArgVReg(mir, 0);
+    new_insn->vC = insn.vC;
+  } else if (!is_static && second != NULL && (insn.opcode >= Instruction::IPUT &&
+             insn.opcode <= Instruction::IPUT_SHORT) && insn.vB == ins_base &&
+             insn.vA > ins_base && second->Opcode() == Instruction::RETURN_VOID) {
+    // Setter of a field of "this" from another argument.
+    int field_offset;
+    bool is_volatile;
+    if (!cu_->compiler_driver->ComputeInstanceFieldInfo(insn.vC, GetCurrentDexCompilationUnit(),
+                                                        field_offset, is_volatile, true)) {
+      return false;
+    }
+    new_insn->opcode = insn.opcode;
+    new_insn->vA = InvokeArgVReg(mir, insn.vA - ins_base);
+    new_insn->vB = InvokeArgVReg(mir, 0);
+    new_insn->vC = insn.vC;
+  } else {
+    return false;
+  }
+  if (move_result != NULL) {
+    // The inlined instruction defines the target of the move-result, which goes away.
+    if (new_insn->opcode < kNumPackedOpcodes) {
+      new_insn->vA = move_result->dalvikInsn.vA;
+    }
+    move_result->dalvikInsn.opcode = static_cast<Instruction::Code>(kMirOpNop);
+  }
+  mir->optimization_flags |= MIR_INLINED;
+  if (cu_->verbose) {
+    LOG(INFO) << "Inlined " << PrettyMethod(method_idx, *cu_->dex_file) << " at 0x"
+              << std::hex << mir->offset;
+  }
+  return true;
+}
+
+void MIRGraph::InlineCalls() {
+  if (cu_->disable_opt & (1 << kMethodInlining)) {
+    return;
+  }
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    if (bb->block_type != kDalvikByteCode) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      InlineCall(bb, mir);
+    }
+  }
+}
+
+namespace {
+
+// An argument of a constructor stored into a field of "this".
+struct ConstructorStore {
+  uint32_t field_idx;
+  uint32_t arg_word;
+  bool wide;
+};
+
+// A value known to be in a field of an object being replaced.
+struct FieldValue {
+  int s_reg_low;
+  int s_reg_high;
+  bool wide;
+  // False once the register holding the value is redefined.
+  bool available;
+};
+
+// How an instruction using an object being replaced is rewritten.
+struct FieldAccessRewrite {
+  MIR* mir;
+  Instruction::Code opcode;  // kMirOpNop, CONST, CONST_WIDE or a move of the field value.
+  FieldValue value;
+};
+
+typedef std::vector<ConstructorStore, ArenaAllocatorAdapter<ConstructorStore> >
+    ConstructorStoreVector;
+
+}  // namespace
+
+/*
+ * Is the constructor method_idx free of effects besides storing some of its arguments into
+ * fields of "this"? That is, once it has called a constructor for which this holds too with no
+ * argument besides "this", up to java.lang.Object's. The stores are collected into stores, or
+ * not allowed if it is NULL.
+ */
+static bool ParseConstructor(CompilationUnit* cu, const DexCompilationUnit* m_unit,
+                             uint32_t dex_pc, uint32_t method_idx, int depth,
+                             ConstructorStoreVector* stores) {
+  const DexFile& dex_file = *cu->dex_file;
+  const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  if (strcmp(dex_file.GetMethodName(method_id), "<init>") != 0) {
+    return false;
+  }
+  if (strcmp(dex_file.GetMethodDeclaringClassDescriptor(method_id), "Ljava/lang/Object;") == 0) {
+    return true;  // Object's constructor is empty.
+  }
+  if (depth == kMaxConstructorDepth) {
+    return false;
+  }
+  const DexFile::CodeItem* code_item =
+      cu->compiler_driver->ComputeInlineTarget(m_unit, dex_pc, kDirect, method_idx);
+  if (code_item == NULL || code_item->tries_size_ != 0) {
+    return false;
+  }
+  uint32_t ins_base = code_item->registers_size_ - code_item->ins_size_;
+  bool called_super = false;
+  uint32_t offset = 0;
+  while (offset < code_item->insns_size_in_code_units_) {
+    const Instruction* inst = Instruction::At(code_item->insns_ + offset);
+    switch (inst->Opcode()) {
+      case Instruction::RETURN_VOID:
+        return called_super;
+      case Instruction::INVOKE_DIRECT:
+        if (called_super || inst->VRegA_35c() != 1 || inst->VRegC_35c() != ins_base ||
+            !ParseConstructor(cu, m_unit, dex_pc, inst->VRegB_35c(), depth + 1, NULL)) {
+          return false;
+        }
+        called_super = true;
+        break;
+      case Instruction::IPUT:
+      case Instruction::IPUT_WIDE:
+      case Instruction::IPUT_OBJECT: {
+        // The arguments are never redefined as nothing else is allowed.
+        if (stores == NULL || !called_super || inst->VRegB_22c() != ins_base ||
+            inst->VRegA_22c() <= ins_base) {
+          return false;
+        }
+        ConstructorStore store = { inst->VRegC_22c(), inst->VRegA_22c() - ins_base,
+                                   inst->Opcode() == Instruction::IPUT_WIDE };
+        stores->push_back(store);
+        break;
+      }
+      default:
+        return false;
+    }
+    offset += inst->SizeInCodeUnits();
+  }
+  return false;
+}
+
+/*
+ * Replace the allocation alloc of bb and the accesses to the fields of its object by moves of
+ * the values stored into the fields, if the object is only used in the extended basic block
+ * starting at bb, by field accesses and a constructor it is allowed to drop. A field access is
+ * only replaced while the register the stored value came from still holds it, since values
+ * live in their Dalvik register's home location. The allocation itself becomes a load of null.
+ */
+bool MIRGraph::ReplaceAllocation(BasicBlock* bb, MIR* alloc,
+                                 const std::vector<int, ArenaAllocatorAdapter<int> >& use_counts) {
+  const int obj = alloc->ssa_rep->defs[0];
+  DexCompilationUnit* m_unit = GetCurrentDexCompilationUnit();
+  if (!cu_->compiler_driver->CanEliminateAllocation(m_unit, alloc->dalvikInsn.vB)) {
+    return false;
+  }
+  typedef SafeMap<int, FieldValue, std::less<int>,
+                  ArenaAllocatorAdapter<std::pair<const int, FieldValue> > > FieldMap;
+  FieldMap fields((ArenaAllocatorAdapter<int>(arena_)));  // Indexed by field offset.
+  std::vector<FieldAccessRewrite, ArenaAllocatorAdapter<FieldAccessRewrite> > rewrites(
+      (ArenaAllocatorAdapter<FieldAccessRewrite>(arena_)));
+  int uses_seen = 0;
+  bool constructed = false;
+  BasicBlock* tbb = bb;
+  for (MIR* mir = alloc->next; tbb != NULL; mir = (mir == NULL) ? NULL : mir->next) {
+    if (mir == NULL) {
+      tbb = NextDominatedBlock(tbb);
+      if (tbb == NULL || tbb == bb) {
+        break;
+      }
+      mir = tbb->first_mir_insn;
+      if (mir == NULL) {
+        continue;
+      }
+    }
+    SSARepresentation* ssa_rep = mir->ssa_rep;
+    if (ssa_rep == NULL) {
+      continue;
+    }
+    int obj_uses = 0;
+    for (int i = 0; i < ssa_rep->num_uses; i++) {
+      if (ssa_rep->uses[i] == obj) {
+        obj_uses++;
+      }
+    }
+    if (obj_uses != 0) {
+      uses_seen += obj_uses;
+      Instruction::Code opcode = mir->dalvikInsn.opcode;
+      bool wide = (opcode == Instruction::IPUT_WIDE || opcode == Instruction::IGET_WIDE);
+      int field_offset;
+      bool is_volatile;
+      switch (opcode) {
+        case Instruction::IPUT:
+        case Instruction::IPUT_WIDE:
+        case Instruction::IPUT_OBJECT: {
+          // The object may only be the base, storing it makes it escape.
+          if (obj_uses != 1 || ssa_rep->uses[ssa_rep->num_uses - 1] != obj ||
+              !cu_->compiler_driver->ComputeInstanceFieldInfo(mir->dalvikInsn.vC, m_unit,
+                                                              field_offset, is_volatile, true)) {
+            return false;
+          }
+          FieldValue value = { ssa_rep->uses[0], wide ? ssa_rep->uses[1] : INVALID_SREG, wide,
+                               true };
+          fields.Overwrite(field_offset, value);
+          FieldAccessRewrite rewrite = { mir, static_cast<Instruction::Code>(kMirOpNop), value };
+          rewrites.push_back(rewrite);
+          break;
+        }
+        case Instruction::IGET:
+        case Instruction::IGET_WIDE:
+        case Instruction::IGET_OBJECT: {
+          if (!cu_->compiler_driver->ComputeInstanceFieldInfo(mir->dalvikInsn.vC, m_unit,
+                                                              field_offset, is_volatile, false)) {
+            return false;
+          }
+          FieldAccessRewrite rewrite = { mir, wide ? Instruction::CONST_WIDE : Instruction::CONST,
+                                         { INVALID_SREG, INVALID_SREG, wide, true } };
+          FieldMap::iterator it = fields.find(field_offset);
+          if (it != fields.end()) {
+            if (!it->second.available || it->second.wide != wide) {
+              return false;
+            }
+            rewrite.opcode = wide ? Instruction::MOVE_WIDE :
+                ((opcode == Instruction::IGET_OBJECT) ? Instruction::MOVE_OBJECT :
+                 Instruction::MOVE);
+            rewrite.value = it->second;
+          }  // Else the field still has its default value.
+          rewrites.push_back(rewrite);
+          break;
+        }
+        case Instruction::INVOKE_DIRECT:
+        case Instruction::INVOKE_DIRECT_RANGE: {
+          ConstructorStoreVector stores((ArenaAllocatorAdapter<ConstructorStore>(arena_)));
+          if (constructed || obj_uses != 1 || ssa_rep->uses[0] != obj ||
+              !ParseConstructor(cu_, m_unit, mir->offset, mir->dalvikInsn.vB, 0, &stores)) {
+            return false;
+          }
+          for (size_t i = 0; i < stores.size(); i++) {
+            const ConstructorStore& store = stores[i];
+            if (store.arg_word + (store.wide ? 1 : 0) >= static_cast<uint32_t>(ssa_rep->num_uses) ||
+                !cu_->compiler_driver->ComputeInstanceFieldInfo(store.field_idx, m_unit,
+                                                                field_offset, is_volatile, true)) {
+              return false;
+            }
+            FieldValue value = { ssa_rep->uses[store.arg_word],
+                                 store.wide ? ssa_rep->uses[store.arg_word + 1] : INVALID_SREG,
+                                 store.wide, true };
+            fields.Overwrite(field_offset, value);
+          }
+          constructed = true;
+          FieldAccessRewrite rewrite = { mir, static_cast<Instruction::Code>(kMirOpNop),
+                                         { INVALID_SREG, INVALID_SREG, false, false } };
+          rewrites.push_back(rewrite);
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+    // Field values whose register this instruction redefines can no longer be moved from it.
+    for (int i = 0; i < ssa_rep->num_defs; i++) {
+      int v_reg = SRegToVReg(ssa_rep->defs[i]);
+      for (FieldMap::iterator it = fields.begin(); it != fields.end(); ++it) {
+        if (SRegToVReg(it->second.s_reg_low) == v_reg ||
+            (it->second.wide && SRegToVReg(it->second.s_reg_high) == v_reg)) {
+          it->second.available = false;
+        }
+      }
+    }
+  }
+  if (uses_seen != use_counts[obj]) {
+    return false;  // Used beyond the extended basic block.
+  }
+  for (size_t i = 0; i < rewrites.size(); i++) {
+    const FieldAccessRewrite& rewrite = rewrites[i];
+    MIR* mir = rewrite.mir;
+    mir->dalvikInsn.opcode = rewrite.opcode;
+    SSARepresentation* ssa_rep = mir->ssa_rep;
+    switch (static_cast<int>(rewrite.opcode)) {
+      case kMirOpNop:
+        ssa_rep->num_uses = 0;
+        ssa_rep->num_defs = 0;
+        break;
+      case Instruction::CONST:
+        mir->dalvikInsn.vB = 0;
+        ssa_rep->num_uses = 0;
+        break;
+      case Instruction::CONST_WIDE:
+        mir->dalvikInsn.vB_wide = 0;
+        ssa_rep->num_uses = 0;
+        break;
+      default: {
+        int num_uses = rewrite.value.wide ? 2 : 1;
+        ssa_rep->uses =
+            static_cast<int*>(arena_->Alloc(sizeof(int) * num_uses, ArenaAllocator::kAllocDFInfo));
+        ssa_rep->fp_use =
+            static_cast<bool*>(arena_->Alloc(sizeof(bool) * num_uses,
+                                             ArenaAllocator::kAllocDFInfo));
+        ssa_rep->uses[0] = rewrite.value.s_reg_low;
+        ssa_rep->fp_use[0] = false;
+        if (rewrite.value.wide) {
+          ssa_rep->uses[1] = rewrite.value.s_reg_high;
+          ssa_rep->fp_use[1] = false;
+        }
+        ssa_rep->num_uses = num_uses;
+        mir->dalvikInsn.vB = SRegToVReg(rewrite.value.s_reg_low);
+        break;
+      }
+    }
+  }
+  // The verifier's GC map still holds the object's register as a reference at later safepoints,
+  // so it must hold null rather than whatever it held before.
+  alloc->dalvikInsn.opcode = Instruction::CONST;
+  alloc->dalvikInsn.vB = 0;
+  if (cu_->verbose) {
+    LOG(INFO) << "Replaced allocation at 0x" << std::hex << alloc->offset << " by registers";
+  }
+  return true;
+}
+
+void MIRGraph::ScalarReplacement() {
+  if (cu_->disable_opt & (1 << kScalarReplacement)) {
+    return;
+  }
+  std::vector<int, ArenaAllocatorAdapter<int> > use_counts(GetNumSSARegs(), 0,
+                                                           ArenaAllocatorAdapter<int>(arena_));
+  bool has_allocations = false;
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      if (mir->ssa_rep == NULL) {
+        continue;
+      }
+      if (mir->dalvikInsn.opcode == Instruction::NEW_INSTANCE) {
+        has_allocations = true;
+      }
+      for (int i = 0; i < mir->ssa_rep->num_uses; i++) {
+        use_counts[mir->ssa_rep->uses[i]]++;
+      }
+    }
+  }
+  if (!has_allocations) {
+    return;
+  }
+  AllNodesIterator replace_iter(this, false /* not iterative */);
+  for (BasicBlock* bb = replace_iter.Next(); bb != NULL; bb = replace_iter.Next()) {
+    if (bb->block_type != kDalvikByteCode) {
+      continue;
+    }
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      if (mir->dalvikInsn.opcode == Instruction::NEW_INSTANCE && mir->ssa_rep != NULL) {
+        ReplaceAllocation(bb, mir, use_counts);
+      }
+    }
+  }
+}
+
+/*
+ * Can mir neither suspend the thread nor call code that may allocate? Objects allocated by a
+ * thread are young until its next GC point, so stores into them need no card mark.
+ */
+static bool IsFreeOfGcPoints(CompilationUnit* cu, const DexCompilationUnit* m_unit, MIR* mir) {
+  Instruction::Code opcode = mir->dalvikInsn.opcode;
+  if ((opcode >= Instruction::MOVE && opcode <= Instruction::MOVE_OBJECT_16) ||
+      (opcode >= Instruction::CONST_4 && opcode <= Instruction::CONST_WIDE_HIGH16) ||
+      (opcode >= Instruction::CMPL_FLOAT && opcode <= Instruction::CMP_LONG) ||
+      (opcode >= Instruction::AGET && opcode <= Instruction::APUT_SHORT) ||
+      (opcode >= Instruction::NEG_INT && opcode <= Instruction::USHR_INT_LIT8) ||
+      opcode == Instruction::ARRAY_LENGTH || opcode == Instruction::NOP ||
+      opcode == static_cast<Instruction::Code>(kMirOpNop) ||
+      opcode == static_cast<Instruction::Code>(kMirOpPhi)) {
+    return true;  // The helpers some of these call on some targets neither suspend nor allocate.
+  }
+  if (opcode >= Instruction::IGET && opcode <= Instruction::IPUT_SHORT) {
+    // The slow paths resolve the field.
+    int field_offset;
+    bool is_volatile;
+    bool is_put = (opcode >= Instruction::IPUT);
+    return cu->compiler_driver->ComputeInstanceFieldInfo(mir->dalvikInsn.vC, m_unit,
+                                                         field_offset, is_volatile, is_put);
+  }
+  return false;
+}
+
+/*
+ * Flag the reference stores which need no card mark: those of null, and those into objects
+ * allocated in the same basic block with no GC point since. The GC scans a young object as a
+ * whole when it finds it, so only stores into objects it may already have scanned need to dirty
+ * a card. An object is young until a GC point or until it is stored somewhere else, where a
+ * concurrent GC could reach it. Objects of tenured allocation sites, which sticky GCs treat as
+ * old, are allocated with their card already dirty.
+ */
+void MIRGraph::CardMarkElimination() {
+  if (cu_->disable_opt & (1 << kCardMarkElimination)) {
+    return;
+  }
+  DexCompilationUnit* m_unit = GetCurrentDexCompilationUnit();
+  // SSA names of the objects allocated since the last GC point.
+  std::set<int, std::less<int>, ArenaAllocatorAdapter<int> > young(
+      std::less<int>(), (ArenaAllocatorAdapter<int>(arena_)));
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    young.clear();
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      SSARepresentation* ssa_rep = mir->ssa_rep;
+      if (ssa_rep == NULL) {
+        continue;
+      }
+      Instruction::Code opcode = mir->dalvikInsn.opcode;
+      if (opcode == Instruction::IPUT_OBJECT || opcode == Instruction::APUT_OBJECT ||
+          opcode == Instruction::SPUT_OBJECT) {
+        int value = ssa_rep->uses[0];
+        bool is_young_target = (opcode != Instruction::SPUT_OBJECT) &&
+            (young.find(ssa_rep->uses[1]) != young.end());
+        bool eliminated = (IsConst(value) && ConstantValue(value) == 0) || is_young_target;
+        if (eliminated) {
+          mir->optimization_flags |= MIR_IGNORE_CARD_MARK;
+        }
+        cu_->compiler_driver->RecordCardMark(eliminated);
+        young.erase(value);  // Reachable from the heap.
+      }
+      if (!IsFreeOfGcPoints(cu_, m_unit, mir)) {
+        young.clear();
+      }
+      if (opcode == Instruction::NEW_INSTANCE || opcode == Instruction::NEW_ARRAY) {
+        young.insert(ssa_rep->defs[0]);
+      } else if ((opcode == Instruction::MOVE_OBJECT || opcode == Instruction::MOVE_OBJECT_FROM16 ||
+                  opcode == Instruction::MOVE_OBJECT_16) &&
+                 young.find(ssa_rep->uses[0]) != young.end()) {
+        young.insert(ssa_rep->defs[0]);
+      }
+    }
+  }
+}
+
+void MIRGraph::BasicBlockCombine() {
+  PreOrderDfsIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    CombineBlocks(bb);
+  }
+  if (cu_->enable_debug & (1 << kDebugDumpCFG)) {
+    DumpCFG("/sdcard/5_post_bbcombine_cfg/", false);
+  }
+}
+
+void MIRGraph::CodeLayout() {
+  if (cu_->enable_debug & (1 << kDebugVerifyDataflow)) {
+    VerifyDataflow();
+  }
+  AllNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
+    LayoutBlocks(bb);
+  }
+  if (cu_->enable_debug & (1 << kDebugDumpCFG)) {
+    DumpCFG("/sdcard/2_post_layout_cfg/", true);
+  }
+}
+
+void MIRGraph::DumpCheckStats() {
+  Checkstats* stats =
+      static_cast<Checkstats*>(arena_->Alloc(sizeof(Checkstats), ArenaAllocator::kAllocDFInfo));
+  checkstats_ = stats;
   AllNodesIterator iter(this, false /* not iterative */);
   for (BasicBlock* bb = iter.Next(); bb != NULL; bb = iter.Next()) {
     CountChecks(bb);
@@ -854,9 +2652,83 @@ bool MIRGraph::BuildExtendedBBList(struct BasicBlock* bb) {
 }
 
 
+/*
+ * Value number the whole method along the dominator tree.  Each block starts out with what was
+ * known at the end of its immediate dominator, so null, range and class initialization checks
+ * done on every path to a block aren't repeated in it.  Loads are only numbered as in the
+ * dominator if it is also the sole predecessor, other paths may have stored to memory.  Returns
+ * false without changing anything if the method is too big for 16 bit value names.
+ */
+bool MIRGraph::GlobalValueNumbering() {
+  size_t num_mirs = 0;
+  AllNodesIterator count_iter(this, false /* not iterative */);
+  for (BasicBlock* bb = count_iter.Next(); bb != NULL; bb = count_iter.Next()) {
+    for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+      num_mirs++;
+    }
+  }
+  // A MIR creates at most four value names and one memory version, s_regs one name each.
+  if (num_mirs * 4 + GetNumSSARegs() >= ARRAY_REF) {
+    return false;
+  }
+  // State at the end of each block, only kept until all its dominator tree children started.
+  std::vector<LocalValueNumbering*, ArenaAllocatorAdapter<LocalValueNumbering*> > block_states(
+      GetBasicBlockListCount(), NULL, ArenaAllocatorAdapter<LocalValueNumbering*>(arena_));
+  std::vector<int, ArenaAllocatorAdapter<int> > pending_children(
+      GetBasicBlockListCount(), 0, ArenaAllocatorAdapter<int>(arena_));
+  std::vector<BasicBlock*, ArenaAllocatorAdapter<BasicBlock*> > work_stack(
+      (ArenaAllocatorAdapter<BasicBlock*>(arena_)));
+  work_stack.push_back(GetEntryBlock());
+  while (!work_stack.empty()) {
+    BasicBlock* bb = work_stack.back();
+    work_stack.pop_back();
+    BasicBlock* i_dom = bb->i_dom;
+    LocalValueNumbering* valnum;
+    if (i_dom == NULL) {
+      // The states are on the heap, the copies made for each child would add up in the arena.
+      valnum = new LocalValueNumbering(cu_, NULL);
+    } else {
+      valnum = new LocalValueNumbering(*block_states[i_dom->id]);
+      if (--pending_children[i_dom->id] == 0) {
+        delete block_states[i_dom->id];
+        block_states[i_dom->id] = NULL;
+      }
+      if (bb->predecessors->Size() != 1 || bb->predecessors->Get(0) != i_dom) {
+        valnum->KillAllMemory();
+      }
+    }
+    /*
+     * CombineBlocks doesn't update the dominator tree, a block it killed still links its former
+     * children to the block which took over its MIRs.
+     */
+    if (bb->block_type != kDead) {
+      for (MIR* mir = bb->first_mir_insn; mir != NULL; mir = mir->next) {
+        valnum->GetValueNumber(mir);
+      }
+    }
+    int num_children = 0;
+    if (bb->i_dominated != NULL) {
+      GrowableArray<BasicBlock*>::Iterator iter(bb->i_dominated);
+      for (BasicBlock* child = iter.Next(); child != NULL; child = iter.Next()) {
+        work_stack.push_back(child);
+        num_children++;
+      }
+    }
+    if (num_children == 0) {
+      delete valnum;
+    } else {
+      block_states[bb->id] = valnum;
+      pending_children[bb->id] = num_children;
+    }
+  }
+  return true;
+}
+
 void MIRGraph::BasicBlockOptimization() {
   if (!(cu_->disable_opt & (1 << kBBOpt))) {
     DCHECK_EQ(cu_->num_compiler_temps, 0);
+    bool global_value_numbering = ((cu_->disable_opt & (1 << kGlobalValueNumbering)) == 0) &&
+        GlobalValueNumbering();
     ClearAllVisitedFlags();
     PreOrderDfsIterator iter2(this, false /* not iterative */);
     for (BasicBlock* bb = iter2.Next(); bb != NULL; bb = iter2.Next()) {
@@ -864,7 +2736,7 @@ void MIRGraph::BasicBlockOptimization() {
     }
     // Perform extended basic block optimizations.
     for (unsigned int i = 0; i < extended_basic_blocks_.size(); i++) {
-      BasicBlockOpt(extended_basic_blocks_[i]);
+      BasicBlockOpt(extended_basic_blocks_[i], !global_value_numbering);
     }
   }
   if (cu_->enable_debug & (1 << kDebugDumpCFG)) {
@@ -448,6 +448,13 @@ enum ArmOpcode {
   kThumb2LdrdPcRel8,  // ldrd rt, rt2, pc +-/1024.
   kThumb2LdrdI8,     // ldrd rt, rt2, [rn +-/1024].
   kThumb2StrdI8,     // strd rt, rt2, [rn +-/1024].
+  kThumb2Ldrexd,     // ldrexd [111010001101] rn[19-16] rt[15-12] rt2[11-8] [01111111].
+  kThumb2Strexd,     // strexd [111010001100] rn[19-16] rt[15-12] rt2[11-8] [0111] rd[3-0].
+  kThumb2SdivRRR,    // sdiv [111110111001] rn[19..16] [1111] rd[11..8] [1111] rm[3..0].
+  kThumb2UdivRRR,    // udiv [111110111011] rn[19..16] [1111] rd[11..8] [1111] rm[3..0].
+  kThumb2Mls,        // mls [111110110000] rn[19-16] ra[15-12] rd[11-8] [0001] rm[3-0].
+  kThumb2Vld1WB,     // vld1.32 {dd}, [rn]! [111110010D10] rn[19-16] dd[15-12] [011110001101].
+  kThumb2VaddI32,    // vadd.i32 [111011110D10] dn[19-16] dd[15-12] [1000] N [0] M [0] dm[3-0].
   kArmLast,
 };
 
@@ -494,6 +501,18 @@ struct ArmEncodingMap {
   int size;   // Note: size is in bytes.
 };
 
+// Result latencies, in cycles, of the instruction classes the list scheduler tells apart.
+struct ArmLatencyModel {
+  const char* core;
+  int alu;
+  int multiply;
+  int load;
+  int fp_add;
+  int fp_multiply;
+  int fp_divide;  // Also square root.
+  int divide;  // Integer, only scheduled with the "div" feature.
+};
+
 }  // namespace art
 
 #endif  // ART_COMPILER_DEX_QUICK_ARM_ARM_LIR_H_
@@ -987,6 +987,37 @@ const ArmEncodingMap ArmMir2Lir::EncodingMap[kArmLast] = {
                  kFmtBitBlt, 7, 0,
                  IS_QUAD_OP | REG_USE0 | REG_USE1 | REG_USE2 | IS_STORE,
                  "strd", "!0C, !1C, [!2C, #!3E]", 4),
+    ENCODING_MAP(kThumb2Ldrexd,      0xe8d0007f,
+                 kFmtBitBlt, 15, 12, kFmtBitBlt, 11, 8, kFmtBitBlt, 19, 16,
+                 kFmtUnused, -1, -1, IS_TERTIARY_OP | REG_DEF01_USE2 | IS_LOAD,
+                 "ldrexd", "!0C, !1C, [!2C]", 4),
+    ENCODING_MAP(kThumb2Strexd,      0xe8c00070,
+                 kFmtBitBlt, 3, 0, kFmtBitBlt, 15, 12, kFmtBitBlt, 11, 8,
+                 kFmtBitBlt, 19, 16,
+                 IS_QUAD_OP | REG_DEF0 | REG_USE1 | REG_USE2 | REG_USE3 | IS_STORE,
+                 "strexd", "!0C, !1C, !2C, [!3C]", 4),
+    ENCODING_MAP(kThumb2SdivRRR,  0xfb90f0f0,
+                 kFmtBitBlt, 11, 8, kFmtBitBlt, 19, 16, kFmtBitBlt, 3, 0,
+                 kFmtUnused, -1, -1, IS_TERTIARY_OP | REG_DEF0_USE12,
+                 "sdiv", "!0C, !1C, !2C", 4),
+    ENCODING_MAP(kThumb2UdivRRR,  0xfbb0f0f0,
+                 kFmtBitBlt, 11, 8, kFmtBitBlt, 19, 16, kFmtBitBlt, 3, 0,
+                 kFmtUnused, -1, -1, IS_TERTIARY_OP | REG_DEF0_USE12,
+                 "udiv", "!0C, !1C, !2C", 4),
+    ENCODING_MAP(kThumb2Mls,  0xfb000010,
+                 kFmtBitBlt, 11, 8, kFmtBitBlt, 19, 16, kFmtBitBlt, 3, 0,
+                 kFmtBitBlt, 15, 12,
+                 IS_QUAD_OP | REG_DEF0 | REG_USE1 | REG_USE2 | REG_USE3,
+                 "mls", "!0C, !1C, !2C, !3C", 4),
+    ENCODING_MAP(kThumb2Vld1WB,  0xf920078d,
+                 kFmtDfp, 22, 12, kFmtBitBlt, 19, 16, kFmtUnused, -1, -1,
+                 kFmtUnused, -1, -1,
+                 IS_BINARY_OP | REG_DEF0 | REG_DEF1 | REG_USE1 | IS_LOAD,
+                 "vld1.32", "{!0S}, [!1C]!!", 4),
+    ENCODING_MAP(kThumb2VaddI32,  0xef200800,
+                 kFmtDfp, 22, 12, kFmtDfp, 7, 16, kFmtDfp, 5, 0,
+                 kFmtUnused, -1, -1, IS_TERTIARY_OP | REG_DEF0_USE12,
+                 "vadd.i32", "!0S, !1S, !2S", 4),
 };
 
 /*
@@ -998,393 +1029,379 @@ const ArmEncodingMap ArmMir2Lir::EncodingMap[kArmLast] = {
 #define PADDING_MOV_R5_R5               0x1C2D
 
 /*
- * Assemble the LIR into binary instruction format.  Note that we may
- * discover that pc-relative displacements may not fit the selected
- * instruction.
+ * Fix up the pc-relative operands of lir.  For PC-relative displacements we
+ * won't know if the selected instruction will work until late (i.e. - now).
+ * If something doesn't fit, we must replace the short-form operation with a
+ * longer-form one.  That moves the code which follows, so AssembleLIR
+ * recomputes the offsets from here on and visits the fixups again.  Of
+ * course, the patching itself may cause new overflows so this is an
+ * iterative process.
  */
-AssemblerStatus ArmMir2Lir::AssembleInstructions(uintptr_t start_addr) {
-  LIR* lir;
+AssemblerStatus ArmMir2Lir::FixupInstruction(LIR* lir, uintptr_t start_addr) {
   AssemblerStatus res = kSuccess;  // Assume success
-
-  for (lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
-    if (lir->opcode < 0) {
-      /* 1 means padding is needed */
-      if ((lir->opcode == kPseudoPseudoAlign4) && (lir->operands[0] == 1)) {
-        code_buffer_.push_back(PADDING_MOV_R5_R5 & 0xFF);
-        code_buffer_.push_back((PADDING_MOV_R5_R5 >> 8) & 0xFF);
-      }
-      continue;
-    }
-
-    if (lir->flags.is_nop) {
-      continue;
-    }
-
+  if (lir->opcode == kThumbLdrPcRel ||
+      lir->opcode == kThumb2LdrPcRel12 ||
+      lir->opcode == kThumbAddPcRel ||
+      lir->opcode == kThumb2LdrdPcRel8 ||
+      ((lir->opcode == kThumb2Vldrd) && (lir->operands[1] == r15pc)) ||
+      ((lir->opcode == kThumb2Vldrs) && (lir->operands[1] == r15pc))) {
     /*
-     * For PC-relative displacements we won't know if the
-     * selected instruction will work until late (i.e. - now).
-     * If something doesn't fit, we must replace the short-form
-     * operation with a longer-form one.  Note, though, that this
-     * can change code we've already processed, so we'll need to
-     * re-calculate offsets and restart.  To limit the number of
-     * restarts, the entire list will be scanned and patched.
-     * Of course, the patching itself may cause new overflows so this
-     * is an iterative process.
+     * PC-relative loads are mostly used to load immediates
+     * that are too large to materialize directly in one shot.
+     * However, if the load displacement exceeds the limit,
+     * we revert to a multiple-instruction materialization sequence.
      */
-    if (lir->flags.pcRelFixup) {
-      if (lir->opcode == kThumbLdrPcRel ||
-          lir->opcode == kThumb2LdrPcRel12 ||
-          lir->opcode == kThumbAddPcRel ||
-          lir->opcode == kThumb2LdrdPcRel8 ||
-          ((lir->opcode == kThumb2Vldrd) && (lir->operands[1] == r15pc)) ||
-          ((lir->opcode == kThumb2Vldrs) && (lir->operands[1] == r15pc))) {
-        /*
-         * PC-relative loads are mostly used to load immediates
-         * that are too large to materialize directly in one shot.
-         * However, if the load displacement exceeds the limit,
-         * we revert to a multiple-instruction materialization sequence.
-         */
-        LIR *lir_target = lir->target;
-        uintptr_t pc = (lir->offset + 4) & ~3;
-        uintptr_t target = lir_target->offset;
-        int delta = target - pc;
-        if (delta & 0x3) {
-          LOG(FATAL) << "PC-rel offset not multiple of 4: " << delta;
-        }
-        // First, a sanity check for cases we shouldn't see now
-        if (((lir->opcode == kThumbAddPcRel) && (delta > 1020)) ||
-            ((lir->opcode == kThumbLdrPcRel) && (delta > 1020))) {
-          // Shouldn't happen in current codegen.
-          LOG(FATAL) << "Unexpected pc-rel offset " << delta;
-        }
-        // Now, check for the difficult cases
-        if (((lir->opcode == kThumb2LdrPcRel12) && (delta > 4091)) ||
-            ((lir->opcode == kThumb2LdrdPcRel8) && (delta > 1020)) ||
-            ((lir->opcode == kThumb2Vldrs) && (delta > 1020)) ||
-            ((lir->opcode == kThumb2Vldrd) && (delta > 1020))) {
-          /*
-           * Note: because rARM_LR may be used to fix up out-of-range
-           * vldrs/vldrd we include REG_DEF_LR in the resource
-           * masks for these instructions.
-           */
-          int base_reg = ((lir->opcode == kThumb2LdrdPcRel8) || (lir->opcode == kThumb2LdrPcRel12))
-              ?  lir->operands[0] : rARM_LR;
+    LIR *lir_target = lir->target;
+    uintptr_t pc = (lir->offset + 4) & ~3;
+    uintptr_t target = lir_target->offset;
+    int delta = target - pc;
+    if (delta & 0x3) {
+      LOG(FATAL) << "PC-rel offset not multiple of 4: " << delta;
+    }
+    // First, a sanity check for cases we shouldn't see now
+    if (((lir->opcode == kThumbAddPcRel) && (delta > 1020)) ||
+        ((lir->opcode == kThumbLdrPcRel) && (delta > 1020))) {
+      // Shouldn't happen in current codegen.
+      LOG(FATAL) << "Unexpected pc-rel offset " << delta;
+    }
+    // Now, check for the difficult cases
+    if (((lir->opcode == kThumb2LdrPcRel12) && (delta > 4091)) ||
+        ((lir->opcode == kThumb2LdrdPcRel8) && (delta > 1020)) ||
+        ((lir->opcode == kThumb2Vldrs) && (delta > 1020)) ||
+        ((lir->opcode == kThumb2Vldrd) && (delta > 1020))) {
+      /*
+       * Note: because rARM_LR may be used to fix up out-of-range
+       * vldrs/vldrd we include REG_DEF_LR in the resource
+       * masks for these instructions.
+       */
+      int base_reg = ((lir->opcode == kThumb2LdrdPcRel8) || (lir->opcode == kThumb2LdrPcRel12))
+          ?  lir->operands[0] : rARM_LR;
 
-          // Add new Adr to generate the address.
-          LIR* new_adr = RawLIR(lir->dalvik_offset, kThumb2Adr,
-                     base_reg, 0, 0, 0, 0, lir->target);
-          InsertLIRBefore(lir, new_adr);
+      // Add new Adr to generate the address.
+      LIR* new_adr = RawLIR(lir->dalvik_offset, kThumb2Adr,
+                 base_reg, 0, 0, 0, 0, lir->target);
+      InsertLIRBefore(lir, new_adr);
 
-          // Convert to normal load.
-          if (lir->opcode == kThumb2LdrPcRel12) {
-            lir->opcode = kThumb2LdrRRI12;
-          } else if (lir->opcode == kThumb2LdrdPcRel8) {
-            lir->opcode = kThumb2LdrdI8;
-          }
-          // Change the load to be relative to the new Adr base.
-          if (lir->opcode == kThumb2LdrdI8) {
-            lir->operands[3] = 0;
-            lir->operands[2] = base_reg;
-          } else {
-            lir->operands[2] = 0;
-            lir->operands[1] = base_reg;
-          }
-          SetupResourceMasks(lir);
-          res = kRetryAll;
-        } else {
-          if ((lir->opcode == kThumb2Vldrs) ||
-              (lir->opcode == kThumb2Vldrd) ||
-              (lir->opcode == kThumb2LdrdPcRel8)) {
-            lir->operands[2] = delta >> 2;
-          } else {
-            lir->operands[1] = (lir->opcode == kThumb2LdrPcRel12) ?  delta :
-                delta >> 2;
-          }
-        }
-      } else if (lir->opcode == kThumb2Cbnz || lir->opcode == kThumb2Cbz) {
-        LIR *target_lir = lir->target;
-        uintptr_t pc = lir->offset + 4;
-        uintptr_t target = target_lir->offset;
-        int delta = target - pc;
-        if (delta > 126 || delta < 0) {
-          /*
-           * Convert to cmp rx,#0 / b[eq/ne] tgt pair
-           * Make new branch instruction and insert after
-           */
-          LIR* new_inst =
-            RawLIR(lir->dalvik_offset, kThumbBCond, 0,
-                   (lir->opcode == kThumb2Cbz) ? kArmCondEq : kArmCondNe,
-                   0, 0, 0, lir->target);
-          InsertLIRAfter(lir, new_inst);
-          /* Convert the cb[n]z to a cmp rx, #0 ] */
-          lir->opcode = kThumbCmpRI8;
-          /* operand[0] is src1 in both cb[n]z & CmpRI8 */
-          lir->operands[1] = 0;
-          lir->target = 0;
-          SetupResourceMasks(lir);
-          res = kRetryAll;
-        } else {
-          lir->operands[1] = delta >> 1;
-        }
-      } else if (lir->opcode == kThumb2Push || lir->opcode == kThumb2Pop) {
-        if (__builtin_popcount(lir->operands[0]) == 1) {
-          /*
-           * The standard push/pop multiple instruction
-           * requires at least two registers in the list.
-           * If we've got just one, switch to the single-reg
-           * encoding.
-           */
-          lir->opcode = (lir->opcode == kThumb2Push) ? kThumb2Push1 :
-              kThumb2Pop1;
-          int reg = 0;
-          while (lir->operands[0]) {
-            if (lir->operands[0] & 0x1) {
-              break;
-            } else {
-              reg++;
-              lir->operands[0] >>= 1;
-            }
-          }
-          lir->operands[0] = reg;
-          SetupResourceMasks(lir);
-          res = kRetryAll;
-        }
-      } else if (lir->opcode == kThumbBCond || lir->opcode == kThumb2BCond) {
-        LIR *target_lir = lir->target;
-        int delta = 0;
-        DCHECK(target_lir);
-        uintptr_t pc = lir->offset + 4;
-        uintptr_t target = target_lir->offset;
-        delta = target - pc;
-        if ((lir->opcode == kThumbBCond) && (delta > 254 || delta < -256)) {
-          lir->opcode = kThumb2BCond;
-          SetupResourceMasks(lir);
-          res = kRetryAll;
-        }
-        lir->operands[0] = delta >> 1;
-      } else if (lir->opcode == kThumb2BUncond) {
-        LIR *target_lir = lir->target;
-        uintptr_t pc = lir->offset + 4;
-        uintptr_t target = target_lir->offset;
-        int delta = target - pc;
-        lir->operands[0] = delta >> 1;
-        if (!(cu_->disable_opt & (1 << kSafeOptimizations)) &&
-          lir->operands[0] == 0) {  // Useless branch
-          lir->flags.is_nop = true;
-          res = kRetryAll;
-        }
-      } else if (lir->opcode == kThumbBUncond) {
-        LIR *target_lir = lir->target;
-        uintptr_t pc = lir->offset + 4;
-        uintptr_t target = target_lir->offset;
-        int delta = target - pc;
-        if (delta > 2046 || delta < -2048) {
-          // Convert to Thumb2BCond w/ kArmCondAl
-          lir->opcode = kThumb2BUncond;
-          lir->operands[0] = 0;
-          SetupResourceMasks(lir);
-          res = kRetryAll;
+      // Convert to normal load.
+      if (lir->opcode == kThumb2LdrPcRel12) {
+        lir->opcode = kThumb2LdrRRI12;
+      } else if (lir->opcode == kThumb2LdrdPcRel8) {
+        lir->opcode = kThumb2LdrdI8;
+      }
+      // Change the load to be relative to the new Adr base.
+      if (lir->opcode == kThumb2LdrdI8) {
+        lir->operands[3] = 0;
+        lir->operands[2] = base_reg;
+      } else {
+        lir->operands[2] = 0;
+        lir->operands[1] = base_reg;
+      }
+      SetupResourceMasks(lir);
+      res = kRetryAll;
+    } else {
+      if ((lir->opcode == kThumb2Vldrs) ||
+          (lir->opcode == kThumb2Vldrd) ||
+          (lir->opcode == kThumb2LdrdPcRel8)) {
+        lir->operands[2] = delta >> 2;
+      } else {
+        lir->operands[1] = (lir->opcode == kThumb2LdrPcRel12) ?  delta :
+            delta >> 2;
+      }
+    }
+  } else if (lir->opcode == kThumb2Cbnz || lir->opcode == kThumb2Cbz) {
+    LIR *target_lir = lir->target;
+    uintptr_t pc = lir->offset + 4;
+    uintptr_t target = target_lir->offset;
+    int delta = target - pc;
+    if (delta > 126 || delta < 0) {
+      /*
+       * Convert to cmp rx,#0 / b[eq/ne] tgt pair
+       * Make new branch instruction and insert after
+       */
+      LIR* new_inst =
+        RawLIR(lir->dalvik_offset, kThumbBCond, 0,
+               (lir->opcode == kThumb2Cbz) ? kArmCondEq : kArmCondNe,
+               0, 0, 0, lir->target);
+      InsertLIRAfter(lir, new_inst);
+      /* Convert the cb[n]z to a cmp rx, #0 ] */
+      lir->opcode = kThumbCmpRI8;
+      /* operand[0] is src1 in both cb[n]z & CmpRI8 */
+      lir->operands[1] = 0;
+      lir->target = 0;
+      SetupResourceMasks(lir);
+      res = kRetryAll;
+    } else {
+      lir->operands[1] = delta >> 1;
+    }
+  } else if (lir->opcode == kThumb2Push || lir->opcode == kThumb2Pop) {
+    if (__builtin_popcount(lir->operands[0]) == 1) {
+      /*
+       * The standard push/pop multiple instruction
+       * requires at least two registers in the list.
+       * If we've got just one, switch to the single-reg
+       * encoding.
+       */
+      lir->opcode = (lir->opcode == kThumb2Push) ? kThumb2Push1 :
+          kThumb2Pop1;
+      int reg = 0;
+      while (lir->operands[0]) {
+        if (lir->operands[0] & 0x1) {
+          break;
         } else {
-          lir->operands[0] = delta >> 1;
-          if (!(cu_->disable_opt & (1 << kSafeOptimizations)) &&
-            lir->operands[0] == -1) {  // Useless branch
-            lir->flags.is_nop = true;
-            res = kRetryAll;
-          }
+          reg++;
+          lir->operands[0] >>= 1;
         }
-      } else if (lir->opcode == kThumbBlx1) {
-        DCHECK(NEXT_LIR(lir)->opcode == kThumbBlx2);
-        /* cur_pc is Thumb */
-        uintptr_t cur_pc = (start_addr + lir->offset + 4) & ~3;
-        uintptr_t target = lir->operands[1];
+      }
+      lir->operands[0] = reg;
+      SetupResourceMasks(lir);
+      res = kRetryAll;
+    }
+  } else if (lir->opcode == kThumbBCond || lir->opcode == kThumb2BCond) {
+    LIR *target_lir = lir->target;
+    int delta = 0;
+    DCHECK(target_lir);
+    uintptr_t pc = lir->offset + 4;
+    uintptr_t target = target_lir->offset;
+    delta = target - pc;
+    if ((lir->opcode == kThumbBCond) && (delta > 254 || delta < -256)) {
+      lir->opcode = kThumb2BCond;
+      SetupResourceMasks(lir);
+      res = kRetryAll;
+    }
+    lir->operands[0] = delta >> 1;
+  } else if (lir->opcode == kThumb2BUncond) {
+    LIR *target_lir = lir->target;
+    uintptr_t pc = lir->offset + 4;
+    uintptr_t target = target_lir->offset;
+    int delta = target - pc;
+    lir->operands[0] = delta >> 1;
+    if (!(cu_->disable_opt & (1 << kSafeOptimizations)) &&
+      lir->operands[0] == 0) {  // Useless branch
+      lir->flags.is_nop = true;
+      res = kRetryAll;
+    }
+  } else if (lir->opcode == kThumbBUncond) {
+    LIR *target_lir = lir->target;
+    uintptr_t pc = lir->offset + 4;
+    uintptr_t target = target_lir->offset;
+    int delta = target - pc;
+    if (delta > 2046 || delta < -2048) {
+      // Convert to Thumb2BCond w/ kArmCondAl
+      lir->opcode = kThumb2BUncond;
+      lir->operands[0] = 0;
+      SetupResourceMasks(lir);
+      res = kRetryAll;
+    } else {
+      lir->operands[0] = delta >> 1;
+      if (!(cu_->disable_opt & (1 << kSafeOptimizations)) &&
+        lir->operands[0] == -1) {  // Useless branch
+        lir->flags.is_nop = true;
+        res = kRetryAll;
+      }
+    }
+  } else if (lir->opcode == kThumbBlx1) {
+    DCHECK(NEXT_LIR(lir)->opcode == kThumbBlx2);
+    /* cur_pc is Thumb */
+    uintptr_t cur_pc = (start_addr + lir->offset + 4) & ~3;
+    uintptr_t target = lir->operands[1];
 
-        /* Match bit[1] in target with base */
-        if (cur_pc & 0x2) {
-          target |= 0x2;
-        }
-        int delta = target - cur_pc;
-        DCHECK((delta >= -(1<<22)) && (delta <= ((1<<22)-2)));
+    /* Match bit[1] in target with base */
+    if (cur_pc & 0x2) {
+      target |= 0x2;
+    }
+    int delta = target - cur_pc;
+    DCHECK((delta >= -(1<<22)) && (delta <= ((1<<22)-2)));
 
-        lir->operands[0] = (delta >> 12) & 0x7ff;
-        NEXT_LIR(lir)->operands[0] = (delta>> 1) & 0x7ff;
-      } else if (lir->opcode == kThumbBl1) {
-        DCHECK(NEXT_LIR(lir)->opcode == kThumbBl2);
-        /* Both cur_pc and target are Thumb */
-        uintptr_t cur_pc = start_addr + lir->offset + 4;
-        uintptr_t target = lir->operands[1];
+    lir->operands[0] = (delta >> 12) & 0x7ff;
+    NEXT_LIR(lir)->operands[0] = (delta>> 1) & 0x7ff;
+  } else if (lir->opcode == kThumbBl1) {
+    DCHECK(NEXT_LIR(lir)->opcode == kThumbBl2);
+    /* Both cur_pc and target are Thumb */
+    uintptr_t cur_pc = start_addr + lir->offset + 4;
+    uintptr_t target = lir->operands[1];
 
-        int delta = target - cur_pc;
-        DCHECK((delta >= -(1<<22)) && (delta <= ((1<<22)-2)));
+    int delta = target - cur_pc;
+    DCHECK((delta >= -(1<<22)) && (delta <= ((1<<22)-2)));
 
-        lir->operands[0] = (delta >> 12) & 0x7ff;
-        NEXT_LIR(lir)->operands[0] = (delta>> 1) & 0x7ff;
-      } else if (lir->opcode == kThumb2Adr) {
-        SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[2]);
-        LIR* target = lir->target;
-        int target_disp = tab_rec ? tab_rec->offset
-                    : target->offset;
-        int disp = target_disp - ((lir->offset + 4) & ~3);
-        if (disp < 4096) {
-          lir->operands[1] = disp;
-        } else {
-          // convert to ldimm16l, ldimm16h, add tgt, pc, operands[0]
-          // TUNING: if this case fires often, it can be improved.  Not expected to be common.
-          LIR *new_mov16L =
-              RawLIR(lir->dalvik_offset, kThumb2MovImm16LST,
-                     lir->operands[0], 0, reinterpret_cast<uintptr_t>(lir),
-                     reinterpret_cast<uintptr_t>(tab_rec), 0, lir->target);
-          InsertLIRBefore(lir, new_mov16L);
-          LIR *new_mov16H =
-              RawLIR(lir->dalvik_offset, kThumb2MovImm16HST,
-                     lir->operands[0], 0, reinterpret_cast<uintptr_t>(lir),
-                     reinterpret_cast<uintptr_t>(tab_rec), 0, lir->target);
-          InsertLIRBefore(lir, new_mov16H);
-          if (ARM_LOWREG(lir->operands[0])) {
-            lir->opcode = kThumbAddRRLH;
-          } else {
-            lir->opcode = kThumbAddRRHH;
-          }
-          lir->operands[1] = rARM_PC;
-          SetupResourceMasks(lir);
-          res = kRetryAll;
-        }
-      } else if (lir->opcode == kThumb2MovImm16LST) {
-        // operands[1] should hold disp, [2] has add, [3] has tab_rec
-        LIR *addPCInst = reinterpret_cast<LIR*>(lir->operands[2]);
-        SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
-        // If tab_rec is null, this is a literal load. Use target
-        LIR* target = lir->target;
-        int target_disp = tab_rec ? tab_rec->offset : target->offset;
-        lir->operands[1] = (target_disp - (addPCInst->offset + 4)) & 0xffff;
-      } else if (lir->opcode == kThumb2MovImm16HST) {
-        // operands[1] should hold disp, [2] has add, [3] has tab_rec
-        LIR *addPCInst = reinterpret_cast<LIR*>(lir->operands[2]);
-        SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
-        // If tab_rec is null, this is a literal load. Use target
-        LIR* target = lir->target;
-        int target_disp = tab_rec ? tab_rec->offset : target->offset;
-        lir->operands[1] =
-            ((target_disp - (addPCInst->offset + 4)) >> 16) & 0xffff;
+    lir->operands[0] = (delta >> 12) & 0x7ff;
+    NEXT_LIR(lir)->operands[0] = (delta>> 1) & 0x7ff;
+  } else if (lir->opcode == kThumb2Adr) {
+    SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[2]);
+    LIR* target = lir->target;
+    int target_disp = tab_rec ? tab_rec->offset
+                : target->offset;
+    int disp = target_disp - ((lir->offset + 4) & ~3);
+    if (disp < 4096) {
+      lir->operands[1] = disp;
+    } else {
+      // convert to ldimm16l, ldimm16h, add tgt, pc, operands[0]
+      // TUNING: if this case fires often, it can be improved.  Not expected to be common.
+      LIR *new_mov16L =
+          RawLIR(lir->dalvik_offset, kThumb2MovImm16LST,
+                 lir->operands[0], 0, reinterpret_cast<uintptr_t>(lir),
+                 reinterpret_cast<uintptr_t>(tab_rec), 0, lir->target);
+      InsertLIRBefore(lir, new_mov16L);
+      LIR *new_mov16H =
+          RawLIR(lir->dalvik_offset, kThumb2MovImm16HST,
+                 lir->operands[0], 0, reinterpret_cast<uintptr_t>(lir),
+                 reinterpret_cast<uintptr_t>(tab_rec), 0, lir->target);
+      InsertLIRBefore(lir, new_mov16H);
+      if (ARM_LOWREG(lir->operands[0])) {
+        lir->opcode = kThumbAddRRLH;
+      } else {
+        lir->opcode = kThumbAddRRHH;
       }
+      lir->operands[1] = rARM_PC;
+      SetupResourceMasks(lir);
+      res = kRetryAll;
     }
-    /*
-     * If one of the pc-relative instructions expanded we'll have
-     * to make another pass.  Don't bother to fully assemble the
-     * instruction.
-     */
-    if (res != kSuccess) {
-      continue;
+  } else if (lir->opcode == kThumb2MovImm16LST) {
+    // operands[1] should hold disp, [2] has add, [3] has tab_rec
+    LIR *addPCInst = reinterpret_cast<LIR*>(lir->operands[2]);
+    SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
+    // If tab_rec is null, this is a literal load. Use target
+    LIR* target = lir->target;
+    int target_disp = tab_rec ? tab_rec->offset : target->offset;
+    lir->operands[1] = (target_disp - (addPCInst->offset + 4)) & 0xffff;
+  } else if (lir->opcode == kThumb2MovImm16HST) {
+    // operands[1] should hold disp, [2] has add, [3] has tab_rec
+    LIR *addPCInst = reinterpret_cast<LIR*>(lir->operands[2]);
+    SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
+    // If tab_rec is null, this is a literal load. Use target
+    LIR* target = lir->target;
+    int target_disp = tab_rec ? tab_rec->offset : target->offset;
+    lir->operands[1] =
+        ((target_disp - (addPCInst->offset + 4)) >> 16) & 0xffff;
+  }
+  return res;
+}
+
+/*
+ * Assemble the LIR into binary instruction format.  Its pc-relative
+ * displacements have been fixed up by FixupInstruction.
+ */
+void ArmMir2Lir::EncodeInstruction(LIR* lir) {
+  if (lir->opcode < 0) {
+    /* 1 means padding is needed */
+    if ((lir->opcode == kPseudoPseudoAlign4) && (lir->operands[0] == 1)) {
+      code_buffer_.push_back(PADDING_MOV_R5_R5 & 0xFF);
+      code_buffer_.push_back((PADDING_MOV_R5_R5 >> 8) & 0xFF);
     }
-    const ArmEncodingMap *encoder = &EncodingMap[lir->opcode];
-    uint32_t bits = encoder->skeleton;
-    int i;
-    for (i = 0; i < 4; i++) {
-      uint32_t operand;
-      uint32_t value;
-      operand = lir->operands[i];
-      switch (encoder->field_loc[i].kind) {
-        case kFmtUnused:
-          break;
-        case kFmtFPImm:
-          value = ((operand & 0xF0) >> 4) << encoder->field_loc[i].end;
-          value |= (operand & 0x0F) << encoder->field_loc[i].start;
-          bits |= value;
-          break;
-        case kFmtBrOffset:
-          value = ((operand  & 0x80000) >> 19) << 26;
-          value |= ((operand & 0x40000) >> 18) << 11;
-          value |= ((operand & 0x20000) >> 17) << 13;
-          value |= ((operand & 0x1f800) >> 11) << 16;
-          value |= (operand  & 0x007ff);
-          bits |= value;
-          break;
-        case kFmtShift5:
-          value = ((operand & 0x1c) >> 2) << 12;
-          value |= (operand & 0x03) << 6;
-          bits |= value;
-          break;
-        case kFmtShift:
-          value = ((operand & 0x70) >> 4) << 12;
-          value |= (operand & 0x0f) << 4;
-          bits |= value;
-          break;
-        case kFmtBWidth:
-          value = operand - 1;
-          bits |= value;
-          break;
-        case kFmtLsb:
-          value = ((operand & 0x1c) >> 2) << 12;
-          value |= (operand & 0x03) << 6;
-          bits |= value;
-          break;
-        case kFmtImm6:
-          value = ((operand & 0x20) >> 5) << 9;
-          value |= (operand & 0x1f) << 3;
-          bits |= value;
-          break;
-        case kFmtBitBlt:
-          value = (operand << encoder->field_loc[i].start) &
-              ((1 << (encoder->field_loc[i].end + 1)) - 1);
-          bits |= value;
-          break;
-        case kFmtDfp: {
-          DCHECK(ARM_DOUBLEREG(operand));
-          DCHECK_EQ((operand & 0x1), 0U);
-          int reg_name = (operand & ARM_FP_REG_MASK) >> 1;
-          /* Snag the 1-bit slice and position it */
-          value = ((reg_name & 0x10) >> 4) << encoder->field_loc[i].end;
-          /* Extract and position the 4-bit slice */
-          value |= (reg_name & 0x0f) << encoder->field_loc[i].start;
-          bits |= value;
-          break;
-        }
-        case kFmtSfp:
-          DCHECK(ARM_SINGLEREG(operand));
-          /* Snag the 1-bit slice and position it */
-          value = (operand & 0x1) << encoder->field_loc[i].end;
-          /* Extract and position the 4-bit slice */
-          value |= ((operand & 0x1e) >> 1) << encoder->field_loc[i].start;
-          bits |= value;
-          break;
-        case kFmtImm12:
-        case kFmtModImm:
-          value = ((operand & 0x800) >> 11) << 26;
-          value |= ((operand & 0x700) >> 8) << 12;
-          value |= operand & 0x0ff;
-          bits |= value;
-          break;
-        case kFmtImm16:
-          value = ((operand & 0x0800) >> 11) << 26;
-          value |= ((operand & 0xf000) >> 12) << 16;
-          value |= ((operand & 0x0700) >> 8) << 12;
-          value |= operand & 0x0ff;
-          bits |= value;
-          break;
-        case kFmtOff24: {
-          uint32_t signbit = (operand >> 31) & 0x1;
-          uint32_t i1 = (operand >> 22) & 0x1;
-          uint32_t i2 = (operand >> 21) & 0x1;
-          uint32_t imm10 = (operand >> 11) & 0x03ff;
-          uint32_t imm11 = operand & 0x07ff;
-          uint32_t j1 = (i1 ^ signbit) ? 0 : 1;
-          uint32_t j2 = (i2 ^ signbit) ? 0 : 1;
-          value = (signbit << 26) | (j1 << 13) | (j2 << 11) | (imm10 << 16) |
-              imm11;
-          bits |= value;
-          }
-          break;
-        default:
-          LOG(FATAL) << "Bad fmt:" << encoder->field_loc[i].kind;
+    return;
+  }
+
+  if (lir->flags.is_nop) {
+    return;
+  }
+
+  const ArmEncodingMap *encoder = &EncodingMap[lir->opcode];
+  uint32_t bits = encoder->skeleton;
+  int i;
+  for (i = 0; i < 4; i++) {
+    uint32_t operand;
+    uint32_t value;
+    operand = lir->operands[i];
+    switch (encoder->field_loc[i].kind) {
+      case kFmtUnused:
+        break;
+      case kFmtFPImm:
+        value = ((operand & 0xF0) >> 4) << encoder->field_loc[i].end;
+        value |= (operand & 0x0F) << encoder->field_loc[i].start;
+        bits |= value;
+        break;
+      case kFmtBrOffset:
+        value = ((operand  & 0x80000) >> 19) << 26;
+        value |= ((operand & 0x40000) >> 18) << 11;
+        value |= ((operand & 0x20000) >> 17) << 13;
+        value |= ((operand & 0x1f800) >> 11) << 16;
+        value |= (operand  & 0x007ff);
+        bits |= value;
+        break;
+      case kFmtShift5:
+        value = ((operand & 0x1c) >> 2) << 12;
+        value |= (operand & 0x03) << 6;
+        bits |= value;
+        break;
+      case kFmtShift:
+        value = ((operand & 0x70) >> 4) << 12;
+        value |= (operand & 0x0f) << 4;
+        bits |= value;
+        break;
+      case kFmtBWidth:
+        value = operand - 1;
+        bits |= value;
+        break;
+      case kFmtLsb:
+        value = ((operand & 0x1c) >> 2) << 12;
+        value |= (operand & 0x03) << 6;
+        bits |= value;
+        break;
+      case kFmtImm6:
+        value = ((operand & 0x20) >> 5) << 9;
+        value |= (operand & 0x1f) << 3;
+        bits |= value;
+        break;
+      case kFmtBitBlt:
+        value = (operand << encoder->field_loc[i].start) &
+            ((1 << (encoder->field_loc[i].end + 1)) - 1);
+        bits |= value;
+        break;
+      case kFmtDfp: {
+        DCHECK(ARM_DOUBLEREG(operand));
+        DCHECK_EQ((operand & 0x1), 0U);
+        int reg_name = (operand & ARM_FP_REG_MASK) >> 1;
+        /* Snag the 1-bit slice and position it */
+        value = ((reg_name & 0x10) >> 4) << encoder->field_loc[i].end;
+        /* Extract and position the 4-bit slice */
+        value |= (reg_name & 0x0f) << encoder->field_loc[i].start;
+        bits |= value;
+        break;
       }
+      case kFmtSfp:
+        DCHECK(ARM_SINGLEREG(operand));
+        /* Snag the 1-bit slice and position it */
+        value = (operand & 0x1) << encoder->field_loc[i].end;
+        /* Extract and position the 4-bit slice */
+        value |= ((operand & 0x1e) >> 1) << encoder->field_loc[i].start;
+        bits |= value;
+        break;
+      case kFmtImm12:
+      case kFmtModImm:
+        value = ((operand & 0x800) >> 11) << 26;
+        value |= ((operand & 0x700) >> 8) << 12;
+        value |= operand & 0x0ff;
+        bits |= value;
+        break;
+      case kFmtImm16:
+        value = ((operand & 0x0800) >> 11) << 26;
+        value |= ((operand & 0xf000) >> 12) << 16;
+        value |= ((operand & 0x0700) >> 8) << 12;
+        value |= operand & 0x0ff;
+        bits |= value;
+        break;
+      case kFmtOff24: {
+        uint32_t signbit = (operand >> 31) & 0x1;
+        uint32_t i1 = (operand >> 22) & 0x1;
+        uint32_t i2 = (operand >> 21) & 0x1;
+        uint32_t imm10 = (operand >> 11) & 0x03ff;
+        uint32_t imm11 = operand & 0x07ff;
+        uint32_t j1 = (i1 ^ signbit) ? 0 : 1;
+        uint32_t j2 = (i2 ^ signbit) ? 0 : 1;
+        value = (signbit << 26) | (j1 << 13) | (j2 << 11) | (imm10 << 16) |
+            imm11;
+        bits |= value;
+        }
+        break;
+      default:
+        LOG(FATAL) << "Bad fmt:" << encoder->field_loc[i].kind;
     }
-    if (encoder->size == 4) {
-      code_buffer_.push_back((bits >> 16) & 0xff);
-      code_buffer_.push_back((bits >> 24) & 0xff);
-    }
-    code_buffer_.push_back(bits & 0xff);
-    code_buffer_.push_back((bits >> 8) & 0xff);
   }
-  return res;
+  if (encoder->size == 4) {
+    code_buffer_.push_back((bits >> 16) & 0xff);
+    code_buffer_.push_back((bits >> 24) & 0xff);
+  }
+  code_buffer_.push_back(bits & 0xff);
+  code_buffer_.push_back((bits >> 8) & 0xff);
 }
 
 int ArmMir2Lir::GetInsnSize(LIR* lir) {
@@ -289,76 +289,7 @@ void ArmMir2Lir::GenSpecialCase(BasicBlock* bb, MIR* mir,
   }
 }
 
-/*
- * The sparse table in the literal pool is an array of <key,displacement>
- * pairs.  For each set, we'll load them as a pair using ldmia.
- * This means that the register number of the temp we use for the key
- * must be lower than the reg for the displacement.
- *
- * The test loop will look something like:
- *
- *   adr   rBase, <table>
- *   ldr   r_val, [rARM_SP, v_reg_off]
- *   mov   r_idx, #table_size
- * lp:
- *   ldmia rBase!, {r_key, r_disp}
- *   sub   r_idx, #1
- *   cmp   r_val, r_key
- *   ifeq
- *   add   rARM_PC, r_disp   ; This is the branch from which we compute displacement
- *   cbnz  r_idx, lp
- */
-void ArmMir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
-                                 RegLocation rl_src) {
-  const uint16_t* table = cu_->insns + current_dalvik_offset_ + table_offset;
-  if (cu_->verbose) {
-    DumpSparseSwitchTable(table);
-  }
-  // Add the table to the list - we'll process it later
-  SwitchTable *tab_rec =
-      static_cast<SwitchTable*>(arena_->Alloc(sizeof(SwitchTable), ArenaAllocator::kAllocData));
-  tab_rec->table = table;
-  tab_rec->vaddr = current_dalvik_offset_;
-  int size = table[1];
-  tab_rec->targets = static_cast<LIR**>(arena_->Alloc(size * sizeof(LIR*),
-                                                      ArenaAllocator::kAllocLIR));
-  switch_tables_.Insert(tab_rec);
-
-  // Get the switch value
-  rl_src = LoadValue(rl_src, kCoreReg);
-  int rBase = AllocTemp();
-  /* Allocate key and disp temps */
-  int r_key = AllocTemp();
-  int r_disp = AllocTemp();
-  // Make sure r_key's register number is less than r_disp's number for ldmia
-  if (r_key > r_disp) {
-    int tmp = r_disp;
-    r_disp = r_key;
-    r_key = tmp;
-  }
-  // Materialize a pointer to the switch table
-  NewLIR3(kThumb2Adr, rBase, 0, reinterpret_cast<uintptr_t>(tab_rec));
-  // Set up r_idx
-  int r_idx = AllocTemp();
-  LoadConstant(r_idx, size);
-  // Establish loop branch target
-  LIR* target = NewLIR0(kPseudoTargetLabel);
-  // Load next key/disp
-  NewLIR2(kThumb2LdmiaWB, rBase, (1 << r_key) | (1 << r_disp));
-  OpRegReg(kOpCmp, r_key, rl_src.low_reg);
-  // Go if match. NOTE: No instruction set switch here - must stay Thumb2
-  OpIT(kCondEq, "");
-  LIR* switch_branch = NewLIR1(kThumb2AddPCR, r_disp);
-  tab_rec->anchor = switch_branch;
-  // Needs to use setflags encoding here
-  NewLIR3(kThumb2SubsRRI12, r_idx, r_idx, 1);
-  OpCondBranch(kCondNe, target);
-}
-
-
-void ArmMir2Lir::GenPackedSwitch(MIR* mir, uint32_t table_offset,
-                                 RegLocation rl_src) {
-  const uint16_t* table = cu_->insns + current_dalvik_offset_ + table_offset;
+void ArmMir2Lir::GenPackedSwitch(MIR* mir, const uint16_t* table, RegLocation rl_src) {
   if (cu_->verbose) {
     DumpPackedSwitchTable(table);
   }
@@ -401,6 +332,11 @@ void ArmMir2Lir::GenPackedSwitch(MIR* mir, uint32_t table_offset,
   /* branch_over target here */
   LIR* target = NewLIR0(kPseudoTargetLabel);
   branch_over->target = target;
+  FreeTemp(table_base);
+  FreeTemp(disp_reg);
+  if (keyReg != rl_src.low_reg) {
+    FreeTemp(keyReg);
+  }
 }
 
 /*
@@ -460,8 +396,9 @@ void ArmMir2Lir::GenFillArrayData(uint32_t table_offset, RegLocation rl_src) {
  * a recurse count of 0.
  *
  * A minor complication is that there is a field in the lock word
- * unrelated to locking: the hash state.  This field must be ignored, but
- * preserved.
+ * unrelated to locking: the hash state.  A hashed word holds the hash
+ * code where a thin lock holds its owner, so the fast paths only take
+ * unhashed words and leave hashed ones to the runtime.
  *
  */
 void ArmMir2Lir::GenMonitorEnter(int opt_flags, RegLocation rl_src) {
@@ -506,12 +443,10 @@ void ArmMir2Lir::GenMonitorExit(int opt_flags, RegLocation rl_src) {
   GenNullCheck(rl_src.s_reg_low, r0, opt_flags);
   LoadWordDisp(r0, mirror::Object::MonitorOffset().Int32Value(), r1);  // Get lock
   LoadWordDisp(rARM_SELF, Thread::ThinLockIdOffset().Int32Value(), r2);
-  // Is lock unheld on lock or held by us (==thread_id) on unlock?
-  OpRegRegImm(kOpAnd, r3, r1,
-              (LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT));
-  // Align owner
+  LoadConstant(r3, 0);
+  // Is lock held by us (==thread_id) with no recursion? A thin lock is never held on a hashed
+  // word, so the whole word is compared.
   OpRegImm(kOpLsl, r2, LW_LOCK_OWNER_SHIFT);
-  NewLIR3(kThumb2Bfc, r1, LW_HASH_STATE_SHIFT, LW_LOCK_OWNER_SHIFT - 1);
   OpRegReg(kOpSub, r1, r2);
   OpIT(kCondEq, "EE");
   StoreWordDisp(r0, mirror::Object::MonitorOffset().Int32Value(), r3);
@@ -571,8 +506,18 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
   bool skip_overflow_check = (mir_graph_->MethodIsLeaf() &&
                             (static_cast<size_t>(frame_size_) <
                             Thread::kStackOverflowReservedBytes));
+  /*
+   * Frames smaller than the guard page below the stack may probe the stack instead: the probe
+   * faults once it reaches the guard page and the fault handler throws the StackOverflowError.
+   */
+  bool implicit_overflow_check = !skip_overflow_check &&
+      !(cu_->disable_opt & (1 << kImplicitStackOverflowChecks)) && (frame_size_ < kPageSize);
   NewLIR0(kPseudoMethodEntry);
-  if (!skip_overflow_check) {
+  if (implicit_overflow_check) {
+    /* Probe the stack before anything is pushed, so the fault is taken in the caller's frame */
+    OpRegRegImm(kOpSub, r12, rARM_SP, Thread::kStackOverflowReservedBytes);
+    LoadWordDisp(r12, 0, r12);
+  } else if (!skip_overflow_check) {
     /* Load stack limit */
     LoadWordDisp(rARM_SELF, Thread::StackEndOffset().Int32Value(), r12);
   }
@@ -587,7 +532,7 @@ void ArmMir2Lir::GenEntrySequence(RegLocation* ArgLocs, RegLocation rl_method) {
      */
     NewLIR1(kThumb2VPushCS, num_fp_spills_);
   }
-  if (!skip_overflow_check) {
+  if (!skip_overflow_check && !implicit_overflow_check) {
     OpRegRegImm(kOpSub, rARM_LR, rARM_SP, frame_size_ - (spill_count * 4));
     GenRegRegCheck(kCondCc, rARM_LR, r12, kThrowStackOverflow);
     OpRegCopy(rARM_SP, rARM_LR);     // Establish stack
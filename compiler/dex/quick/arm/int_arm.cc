@@ -388,72 +388,73 @@ void ArmMir2Lir::OpRegCopyWide(int dest_lo, int dest_hi, int src_lo,
   }
 }
 
-// Table of magic divisors
-struct MagicTable {
-  uint32_t magic;
-  uint32_t shift;
-  DividePattern pattern;
-};
-
-static const MagicTable magic_table[] = {
-  {0, 0, DivideNone},        // 0
-  {0, 0, DivideNone},        // 1
-  {0, 0, DivideNone},        // 2
-  {0x55555556, 0, Divide3},  // 3
-  {0, 0, DivideNone},        // 4
-  {0x66666667, 1, Divide5},  // 5
-  {0x2AAAAAAB, 0, Divide3},  // 6
-  {0x92492493, 2, Divide7},  // 7
-  {0, 0, DivideNone},        // 8
-  {0x38E38E39, 1, Divide5},  // 9
-  {0x66666667, 2, Divide5},  // 10
-  {0x2E8BA2E9, 1, Divide5},  // 11
-  {0x2AAAAAAB, 1, Divide5},  // 12
-  {0x4EC4EC4F, 2, Divide5},  // 13
-  {0x92492493, 3, Divide7},  // 14
-  {0x88888889, 3, Divide7},  // 15
-};
-
-// Integer division by constant via reciprocal multiply (Hacker's Delight, 10-4)
+// Computes the magic number and shift of a signed division by divisor >= 2 that isn't a power of
+// two, the division then being a multiply high by the magic number (Hacker's Delight, 10-1).
+static void ComputeMagicAndShift(int32_t divisor, int32_t* magic, int* shift) {
+  const uint32_t two31 = 0x80000000U;
+  uint32_t ad = divisor;
+  uint32_t anc = two31 - 1 - two31 % ad;  // Absolute value of nc.
+  int p = 31;
+  uint32_t q1 = two31 / anc;
+  uint32_t r1 = two31 - q1 * anc;
+  uint32_t q2 = two31 / ad;
+  uint32_t r2 = two31 - q2 * ad;
+  uint32_t delta;
+  do {
+    p++;
+    q1 <<= 1;
+    r1 <<= 1;
+    if (r1 >= anc) {
+      q1++;
+      r1 -= anc;
+    }
+    q2 <<= 1;
+    r2 <<= 1;
+    if (r2 >= ad) {
+      q2++;
+      r2 -= ad;
+    }
+    delta = ad - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+  *magic = static_cast<int32_t>(q2 + 1);
+  *shift = p - 32;
+}
+
+// Integer division by constant via reciprocal multiply (Hacker's Delight, 10-4), the remainder
+// then being src - quotient * lit. Even with hardware divide, a multiply and a few ALU operations
+// are faster than sdiv.
 bool ArmMir2Lir::SmallLiteralDivRem(Instruction::Code dalvik_opcode, bool is_div,
                                     RegLocation rl_src, RegLocation rl_dest, int lit) {
-  if ((lit < 0) || (lit >= static_cast<int>(sizeof(magic_table)/sizeof(magic_table[0])))) {
-    return false;
-  }
-  DividePattern pattern = magic_table[lit].pattern;
-  if (pattern == DivideNone) {
-    return false;
-  }
-  // Tuning: add rem patterns
-  if (!is_div) {
+  // Powers of two are handled by HandleEasyDivRem.
+  if (lit < 3) {
     return false;
   }
+  int32_t magic;
+  int shift;
+  ComputeMagicAndShift(lit, &magic, &shift);
 
   int r_magic = AllocTemp();
-  LoadConstant(r_magic, magic_table[lit].magic);
+  LoadConstant(r_magic, magic);
   rl_src = LoadValue(rl_src, kCoreReg);
   RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
   int r_hi = AllocTemp();
   int r_lo = AllocTemp();
   NewLIR4(kThumb2Smull, r_lo, r_hi, r_magic, rl_src.low_reg);
-  switch (pattern) {
-    case Divide3:
-      OpRegRegRegShift(kOpSub, rl_result.low_reg, r_hi,
-               rl_src.low_reg, EncodeShift(kArmAsr, 31));
-      break;
-    case Divide5:
-      OpRegRegImm(kOpAsr, r_lo, rl_src.low_reg, 31);
-      OpRegRegRegShift(kOpRsub, rl_result.low_reg, r_lo, r_hi,
-               EncodeShift(kArmAsr, magic_table[lit].shift));
-      break;
-    case Divide7:
-      OpRegReg(kOpAdd, r_hi, rl_src.low_reg);
-      OpRegRegImm(kOpAsr, r_lo, rl_src.low_reg, 31);
-      OpRegRegRegShift(kOpRsub, rl_result.low_reg, r_lo, r_hi,
-               EncodeShift(kArmAsr, magic_table[lit].shift));
-      break;
-    default:
-      LOG(FATAL) << "Unexpected pattern: " << pattern;
+  if (magic < 0) {
+    OpRegReg(kOpAdd, r_hi, rl_src.low_reg);
+  }
+  // The quotient is the high word shifted, plus one for negative sources. Keep the source for the
+  // remainder, rl_result may share its register.
+  int r_quotient = is_div ? rl_result.low_reg : r_hi;
+  if (shift == 0) {
+    OpRegRegRegShift(kOpSub, r_quotient, r_hi, rl_src.low_reg, EncodeShift(kArmAsr, 31));
+  } else {
+    OpRegRegImm(kOpAsr, r_lo, rl_src.low_reg, 31);
+    OpRegRegRegShift(kOpRsub, r_quotient, r_lo, r_hi, EncodeShift(kArmAsr, shift));
+  }
+  if (!is_div) {
+    LoadConstant(r_magic, lit);
+    NewLIR4(kThumb2Mls, rl_result.low_reg, r_quotient, r_magic, rl_src.low_reg);
   }
   StoreValue(rl_dest, rl_result);
   return true;
@@ -467,14 +468,28 @@ LIR* ArmMir2Lir::GenRegMemCheck(ConditionCode c_code,
 
 RegLocation ArmMir2Lir::GenDivRemLit(RegLocation rl_dest, int reg1, int lit,
                                      bool is_div) {
-  LOG(FATAL) << "Unexpected use of GenDivRemLit for Arm";
-  return rl_dest;
+  int t_reg = AllocTemp();
+  LoadConstant(t_reg, lit);
+  RegLocation rl_result = GenDivRem(rl_dest, reg1, t_reg, is_div);
+  FreeTemp(t_reg);
+  return rl_result;
 }
 
+// sdiv gives 0x80000000 for 0x80000000 / -1, as Java does, and the remainder is then 0. The caller
+// checks for a zero divisor.
 RegLocation ArmMir2Lir::GenDivRem(RegLocation rl_dest, int reg1, int reg2,
                                   bool is_div) {
-  LOG(FATAL) << "Unexpected use of GenDivRem for Arm";
-  return rl_dest;
+  DCHECK(has_divide_);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  if (is_div) {
+    NewLIR3(kThumb2SdivRRR, rl_result.low_reg, reg1, reg2);
+  } else {
+    int t_reg = AllocTemp();
+    NewLIR3(kThumb2SdivRRR, t_reg, reg1, reg2);
+    NewLIR4(kThumb2Mls, rl_result.low_reg, t_reg, reg2, reg1);
+    FreeTemp(t_reg);
+  }
+  return rl_result;
 }
 
 bool ArmMir2Lir::GenInlinedMinMaxInt(CallInfo* info, bool is_min) {
@@ -561,6 +576,73 @@ bool ArmMir2Lir::GenInlinedCas32(CallInfo* info, bool need_write_barrier) {
   return true;
 }
 
+bool ArmMir2Lir::GenInlinedCas64(CallInfo* info) {
+  DCHECK_EQ(cu_->instruction_set, kThumb2);
+  // Unused - RegLocation rl_src_unsafe = info->args[0];
+  RegLocation rl_src_obj = info->args[1];  // Object - known non-null
+  RegLocation rl_src_offset = info->args[2];  // long low
+  rl_src_offset.wide = 0;  // ignore high half in info->args[3]
+  RegLocation rl_src_expected = info->args[4];  // long, high half in info->args[5]
+  RegLocation rl_src_new_value = info->args[6];  // long, high half in info->args[7]
+  RegLocation rl_dest = InlineTarget(info);  // boolean place for result
+
+  // Release store semantics, get the barrier out of the way.  TODO: revisit
+  GenMemBarrier(kStoreLoad);
+
+  // The exclusive pair and the address leave too few core temps for both longs, so they wait
+  // in double registers and are moved over when compared or stored.
+  RegLocation rl_expected = LoadValueWide(rl_src_expected, kFPReg);
+  RegLocation rl_new_value = LoadValueWide(rl_src_new_value, kFPReg);
+  RegLocation rl_object = LoadValue(rl_src_obj, kCoreReg);
+  RegLocation rl_offset = LoadValue(rl_src_offset, kCoreReg);
+
+  int r_ptr = AllocTemp();
+  OpRegRegReg(kOpAdd, r_ptr, rl_object.low_reg, rl_offset.low_reg);
+
+  // Free now unneeded rl_object and rl_offset to give more temps.
+  ClobberSReg(rl_object.s_reg_low);
+  FreeTemp(rl_object.low_reg);
+  ClobberSReg(rl_offset.s_reg_low);
+  FreeTemp(rl_offset.low_reg);
+
+  // do {
+  //   r_old := [r_ptr] exclusive
+  //   if (r_old != expected) goto mismatch
+  //   status := ([r_ptr] <- new_value exclusive)
+  // } while (status != 0)
+  int r_old_lo = AllocTemp();
+  int r_old_hi = AllocTemp();
+  int r_lo = AllocTemp();
+  int r_hi = AllocTemp();
+  LIR* retry = NewLIR0(kPseudoTargetLabel);
+  NewLIR3(kThumb2Ldrexd, r_old_lo, r_old_hi, r_ptr);
+  NewLIR3(kThumb2Fmrrd, r_lo, r_hi, S2d(rl_expected.low_reg, rl_expected.high_reg));
+  OpRegReg(kOpCmp, r_old_lo, r_lo);
+  OpIT(kCondEq, "");
+  OpRegReg(kOpCmp /* eq */, r_old_hi, r_hi);
+  LIR* mismatch = OpCondBranch(kCondNe, NULL);
+  NewLIR3(kThumb2Fmrrd, r_lo, r_hi, S2d(rl_new_value.low_reg, rl_new_value.high_reg));
+  NewLIR4(kThumb2Strexd, r_old_lo /* status */, r_lo, r_hi, r_ptr);
+  OpRegImm(kOpCmp, r_old_lo, 0);
+  OpCondBranch(kCondNe, retry);
+  FreeTemp(r_ptr);
+  FreeTemp(r_old_lo);
+  FreeTemp(r_old_hi);
+  FreeTemp(r_lo);
+  FreeTemp(r_hi);
+
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  LoadConstant(rl_result.low_reg, 1);
+  LIR* done = OpUnconditionalBranch(NULL);
+  mismatch->target = NewLIR0(kPseudoTargetLabel);
+  // Drop the exclusive access of the failed compare.
+  NewLIR0(kThumb2Clrex);
+  LoadConstant(rl_result.low_reg, 0);
+  done->target = NewLIR0(kPseudoTargetLabel);
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
 LIR* ArmMir2Lir::OpPcRelLoad(int reg, LIR* target) {
   return RawLIR(current_dalvik_offset_, kThumb2LdrPcRel12, reg, 0, 0, 0, 0, target);
 }
@@ -984,7 +1066,7 @@ void ArmMir2Lir::GenArrayObjPut(int opt_flags, RegLocation rl_array,
   StoreBaseIndexed(r_ptr, r_index, r_value, scale, kWord);
   FreeTemp(r_ptr);
   FreeTemp(r_index);
-  if (!mir_graph_->IsConstantNullRef(rl_src)) {
+  if (!(opt_flags & MIR_IGNORE_CARD_MARK) && !mir_graph_->IsConstantNullRef(rl_src)) {
     MarkGCCard(r_value, r_array);
   }
 }
@@ -1147,4 +1229,58 @@ void ArmMir2Lir::GenArithImmOpLong(Instruction::Code opcode,
   StoreValueWide(rl_dest, rl_result);
 }
 
+/*
+ * With NEON, adds four elements per trip into two vector accumulators, the first starting with s
+ * in its low lane, and leaves the last ones to the scalar loop.
+ */
+void ArmMir2Lir::GenSumIntArray(MIR* mir) {
+  if (!has_neon_) {
+    Mir2Lir::GenSumIntArray(mir);
+    return;
+  }
+  int r_ptr;
+  int r_end;
+  RegLocation rl_result = LoadSumIntArrayRange(mir, &r_ptr, &r_end);
+  int r_acc0 = AllocTempDouble();
+  int r_acc1 = AllocTempDouble();
+  int r_vec0 = AllocTempDouble();
+  int r_vec1 = AllocTempDouble();
+  int d_acc0 = S2d(r_acc0, r_acc0 + 1);
+  int d_acc1 = S2d(r_acc1, r_acc1 + 1);
+  int d_vec0 = S2d(r_vec0, r_vec0 + 1);
+  int d_vec1 = S2d(r_vec1, r_vec1 + 1);
+  int t_reg1 = AllocTemp();
+  int t_reg2 = AllocTemp();
+  LoadConstant(t_reg1, 0);
+  NewLIR3(kThumb2Fmdrr, d_acc0, rl_result.low_reg, t_reg1);
+  NewLIR3(kThumb2Fmdrr, d_acc1, t_reg1, t_reg1);
+  // The vector loop runs while four elements are left.
+  OpRegRegImm(kOpSub, t_reg1, r_end, 4 * sizeof(int32_t));
+  LIR* branch = OpCmpBranch(kCondHi, r_ptr, t_reg1, NULL);
+  LIR* loop = NewLIR0(kPseudoTargetLabel);
+  NewLIR2(kThumb2Vld1WB, d_vec0, r_ptr);
+  NewLIR2(kThumb2Vld1WB, d_vec1, r_ptr);
+  NewLIR3(kThumb2VaddI32, d_acc0, d_acc0, d_vec0);
+  NewLIR3(kThumb2VaddI32, d_acc1, d_acc1, d_vec1);
+  OpCmpBranch(kCondLs, r_ptr, t_reg1, loop);
+  branch->target = NewLIR0(kPseudoTargetLabel);
+  NewLIR3(kThumb2VaddI32, d_acc0, d_acc0, d_acc1);
+  NewLIR3(kThumb2Fmrrd, t_reg1, t_reg2, d_acc0);
+  OpRegRegReg(kOpAdd, rl_result.low_reg, t_reg1, t_reg2);
+  FreeTemp(t_reg1);
+  FreeTemp(t_reg2);
+  GenSumIntArrayElements(rl_result.low_reg, r_ptr, r_end);
+  StoreValue(mir_graph_->GetDest(mir), rl_result);
+  FreeTemp(r_ptr);
+  FreeTemp(r_end);
+  FreeTemp(r_acc0);
+  FreeTemp(r_acc0 + 1);
+  FreeTemp(r_acc1);
+  FreeTemp(r_acc1 + 1);
+  FreeTemp(r_vec0);
+  FreeTemp(r_vec0 + 1);
+  FreeTemp(r_vec1);
+  FreeTemp(r_vec1 + 1);
+}
+
 }  // namespace art
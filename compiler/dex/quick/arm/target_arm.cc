@@ -15,6 +15,7 @@
  */
 
 #include <string>
+#include <vector>
 
 #include "arm_lir.h"
 #include "codegen_arm.h"
@@ -26,6 +27,13 @@ namespace art {
 static int core_regs[] = {r0, r1, r2, r3, rARM_SUSPEND, r5, r6, r7, r8, rARM_SELF, r10,
                          r11, r12, rARM_SP, rARM_LR, rARM_PC};
 static int ReservedRegs[] = {rARM_SUSPEND, rARM_SELF, rARM_SP, rARM_LR, rARM_PC};
+// The first model is for cores the instruction set features don't name.
+static const ArmLatencyModel kLatencyModels[] = {
+  { "generic",    1, 3, 3, 4, 5, 20, 12 },
+  { "cortex-a9",  1, 4, 3, 4, 5, 25, 12 },
+  { "cortex-a15", 1, 3, 4, 4, 5, 18, 12 },
+};
+
 static int FpRegs[] = {fr0, fr1, fr2, fr3, fr4, fr5, fr6, fr7,
                        fr8, fr9, fr10, fr11, fr12, fr13, fr14, fr15,
                        fr16, fr17, fr18, fr19, fr20, fr21, fr22, fr23,
@@ -160,6 +168,11 @@ void ArmMir2Lir::SetupTargetResourceMasks(LIR* lir) {
     lir->def_mask = ENCODE_ALL;
   }
 
+  /* Keep vcmp ordered with the fmstat copying the flags it sets */
+  if (opcode == kThumb2Vcmps || opcode == kThumb2Vcmpd) {
+    lir->def_mask |= ENCODE_CCODE;
+  }
+
   if (flags & REG_USE_LIST0) {
     lir->use_mask |= ENCODE_ARM_REG_LIST(lir->operands[0]);
   }
@@ -489,8 +502,55 @@ bool ArmMir2Lir::IsUnconditionalBranch(LIR* lir) {
   return ((lir->opcode == kThumbBUncond) || (lir->opcode == kThumb2BUncond));
 }
 
+int ArmMir2Lir::GetInstructionLatency(LIR* lir) {
+  if (EncodingMap[lir->opcode].flags & IS_LOAD) {
+    return latency_model_->load;
+  }
+  switch (lir->opcode) {
+    case kThumbMul:
+    case kThumb2MulRRR:
+    case kThumb2Mla:
+    case kThumb2Mls:
+    case kThumb2Umull:
+    case kThumb2Smull:
+      return latency_model_->multiply;
+    case kThumb2Vadds:
+    case kThumb2Vaddd:
+    case kThumb2Vsubs:
+    case kThumb2Vsubd:
+    case kThumb2VcvtIF:
+    case kThumb2VcvtID:
+    case kThumb2VcvtFI:
+    case kThumb2VcvtDI:
+    case kThumb2VcvtFd:
+    case kThumb2VcvtDF:
+    case kThumb2VaddI32:
+      return latency_model_->fp_add;
+    case kThumb2Vmuls:
+    case kThumb2Vmuld:
+      return latency_model_->fp_multiply;
+    case kThumb2Vdivs:
+    case kThumb2Vdivd:
+    case kThumb2Vsqrts:
+    case kThumb2Vsqrtd:
+      return latency_model_->fp_divide;
+    case kThumb2SdivRRR:
+    case kThumb2UdivRRR:
+      return latency_model_->divide;
+    default:
+      return latency_model_->alu;
+  }
+}
+
+bool ArmMir2Lir::HasHardwareDivide() {
+  return has_divide_;
+}
+
 ArmMir2Lir::ArmMir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator* arena)
-    : Mir2Lir(cu, mir_graph, arena) {
+    : Mir2Lir(cu, mir_graph, arena),
+      latency_model_(&kLatencyModels[0]),
+      has_divide_(false),
+      has_neon_(false) {
   // Sanity check - make sure encoding map lines up.
   for (int i = 0; i < kArmLast; i++) {
     if (ArmMir2Lir::EncodingMap[i].opcode != i) {
@@ -499,6 +559,21 @@ ArmMir2Lir::ArmMir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator*
                  << static_cast<int>(ArmMir2Lir::EncodingMap[i].opcode);
     }
   }
+  std::vector<std::string> features;
+  Split(cu->compiler_driver->GetInstructionSetFeatures(), ',', features);
+  for (size_t i = 0; i < features.size(); ++i) {
+    if (features[i] == "div") {
+      has_divide_ = true;
+    }
+    if (features[i] == "neon") {
+      has_neon_ = true;
+    }
+    for (size_t j = 0; j < arraysize(kLatencyModels); ++j) {
+      if (features[i] == kLatencyModels[j].core) {
+        latency_model_ = &kLatencyModels[j];
+      }
+    }
+  }
 }
 
 Mir2Lir* ArmCodeGenerator(CompilationUnit* const cu, MIRGraph* const mir_graph,
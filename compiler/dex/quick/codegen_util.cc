@@ -16,7 +16,7 @@
 
 #include "dex/compiler_internals.h"
 #include "dex_file-inl.h"
-#include "gc_map.h"
+#include "gc_map_builder.h"
 #include "mapping_table.h"
 #include "mir_to_lir-inl.h"
 #include "verifier/dex_gc_map.h"
@@ -421,30 +421,16 @@ void Mir2Lir::InstallSwitchTables() {
     if (cu_->verbose) {
       LOG(INFO) << "Switch table for offset 0x" << std::hex << bx_offset;
     }
-    if (tab_rec->table[0] == Instruction::kSparseSwitchSignature) {
-      const int* keys = reinterpret_cast<const int*>(&(tab_rec->table[2]));
-      for (int elems = 0; elems < tab_rec->table[1]; elems++) {
-        int disp = tab_rec->targets[elems]->offset - bx_offset;
-        if (cu_->verbose) {
-          LOG(INFO) << "  Case[" << elems << "] key: 0x"
-                    << std::hex << keys[elems] << ", disp: 0x"
-                    << std::hex << disp;
-        }
-        PushWord(code_buffer_, keys[elems]);
-        PushWord(code_buffer_,
-          tab_rec->targets[elems]->offset - bx_offset);
-      }
-    } else {
-      DCHECK_EQ(static_cast<int>(tab_rec->table[0]),
-                static_cast<int>(Instruction::kPackedSwitchSignature));
-      for (int elems = 0; elems < tab_rec->table[1]; elems++) {
-        int disp = tab_rec->targets[elems]->offset - bx_offset;
-        if (cu_->verbose) {
-          LOG(INFO) << "  Case[" << elems << "] disp: 0x"
-                    << std::hex << disp;
-        }
-        PushWord(code_buffer_, tab_rec->targets[elems]->offset - bx_offset);
+    // Sparse switches are lowered to compares, jump tables and bit tests by GenSwitch.
+    DCHECK_EQ(static_cast<int>(tab_rec->table[0]),
+              static_cast<int>(Instruction::kPackedSwitchSignature));
+    for (int elems = 0; elems < tab_rec->table[1]; elems++) {
+      int disp = tab_rec->targets[elems]->offset - bx_offset;
+      if (cu_->verbose) {
+        LOG(INFO) << "  Case[" << elems << "] disp: 0x"
+                  << std::hex << disp;
       }
+      PushWord(code_buffer_, tab_rec->targets[elems]->offset - bx_offset);
     }
   }
 }
@@ -524,8 +510,36 @@ void Mir2Lir::CreateMappingTables() {
   CHECK_EQ(dex2pc_mapping_table_.size() & 1, 0U);
   uint32_t total_entries = (pc2dex_mapping_table_.size() + dex2pc_mapping_table_.size()) / 2;
   uint32_t pc2dex_entries = pc2dex_mapping_table_.size() / 2;
+  // Checkpoint every MappingTable::kCheckpointInterval-th entry but the first of each list, with
+  // the entry's native pc offset and its offset from the start of the entries.
+  std::vector<uint32_t> checkpoints;
+  uint32_t entry_offset = 0;
+  uint32_t num_pc2dex_checkpoints = 0;
+  for (size_t list = 0; list < 2; ++list) {
+    const std::vector<uint32_t>& entries = (list == 0) ? pc2dex_mapping_table_
+                                                       : dex2pc_mapping_table_;
+    for (size_t i = 0; i < entries.size(); i += 2) {
+      if (i != 0) {
+        // Lookups by native pc rely on the entries being sorted.
+        CHECK_LE(entries[i - 2], entries[i]);
+        if ((i / 2) % MappingTable::kCheckpointInterval == 0) {
+          checkpoints.push_back(entries[i]);
+          checkpoints.push_back(entry_offset);
+        }
+      }
+      entry_offset += UnsignedLeb128Size(entries[i]) + UnsignedLeb128Size(entries[i + 1]);
+    }
+    if (list == 0) {
+      num_pc2dex_checkpoints = checkpoints.size() / 2;
+    }
+  }
   encoded_mapping_table_.PushBack(total_entries);
   encoded_mapping_table_.PushBack(pc2dex_entries);
+  encoded_mapping_table_.PushBack(num_pc2dex_checkpoints);
+  encoded_mapping_table_.PushBack(checkpoints.size() / 2 - num_pc2dex_checkpoints);
+  for (size_t i = 0; i < checkpoints.size(); ++i) {
+    encoded_mapping_table_.PushBackFixed32(checkpoints[i]);
+  }
   encoded_mapping_table_.InsertBack(pc2dex_mapping_table_.begin(), pc2dex_mapping_table_.end());
   encoded_mapping_table_.InsertBack(dex2pc_mapping_table_.begin(), dex2pc_mapping_table_.end());
   if (kIsDebugBuild) {
@@ -546,86 +560,17 @@ void Mir2Lir::CreateMappingTables() {
       ++i;
       CHECK_EQ(dex2pc_mapping_table_.at(i), it2.DexPc());
     }
-  }
-}
-
-class NativePcToReferenceMapBuilder {
- public:
-  NativePcToReferenceMapBuilder(std::vector<uint8_t>* table,
-                                size_t entries, uint32_t max_native_offset,
-                                size_t references_width) : entries_(entries),
-                                references_width_(references_width), in_use_(entries),
-                                table_(table) {
-    // Compute width in bytes needed to hold max_native_offset.
-    native_offset_width_ = 0;
-    while (max_native_offset != 0) {
-      native_offset_width_++;
-      max_native_offset >>= 8;
-    }
-    // Resize table and set up header.
-    table->resize((EntryWidth() * entries) + sizeof(uint32_t));
-    CHECK_LT(native_offset_width_, 1U << 3);
-    (*table)[0] = native_offset_width_ & 7;
-    CHECK_LT(references_width_, 1U << 13);
-    (*table)[0] |= (references_width_ << 3) & 0xFF;
-    (*table)[1] = (references_width_ >> 5) & 0xFF;
-    CHECK_LT(entries, 1U << 16);
-    (*table)[2] = entries & 0xFF;
-    (*table)[3] = (entries >> 8) & 0xFF;
-  }
-
-  void AddEntry(uint32_t native_offset, const uint8_t* references) {
-    size_t table_index = TableIndex(native_offset);
-    while (in_use_[table_index]) {
-      table_index = (table_index + 1) % entries_;
-    }
-    in_use_[table_index] = true;
-    SetNativeOffset(table_index, native_offset);
-    DCHECK_EQ(native_offset, GetNativeOffset(table_index));
-    SetReferences(table_index, references);
-  }
-
- private:
-  size_t TableIndex(uint32_t native_offset) {
-    return NativePcOffsetToReferenceMap::Hash(native_offset) % entries_;
-  }
-
-  uint32_t GetNativeOffset(size_t table_index) {
-    uint32_t native_offset = 0;
-    size_t table_offset = (table_index * EntryWidth()) + sizeof(uint32_t);
-    for (size_t i = 0; i < native_offset_width_; i++) {
-      native_offset |= (*table_)[table_offset + i] << (i * 8);
+    // And that the checkpointed lookups start at or before the first match.
+    for (uint32_t i = 0; i < pc2dex_mapping_table_.size(); i += 2) {
+      MappingTable::PcToDexIterator from = table.PcToDexFrom(pc2dex_mapping_table_[i]);
+      CHECK_LE(from.NativePcOffset(), pc2dex_mapping_table_[i]);
     }
-    return native_offset;
-  }
-
-  void SetNativeOffset(size_t table_index, uint32_t native_offset) {
-    size_t table_offset = (table_index * EntryWidth()) + sizeof(uint32_t);
-    for (size_t i = 0; i < native_offset_width_; i++) {
-      (*table_)[table_offset + i] = (native_offset >> (i * 8)) & 0xFF;
+    for (uint32_t i = 0; i < dex2pc_mapping_table_.size(); i += 2) {
+      MappingTable::DexToPcIterator from = table.DexToPcFrom(dex2pc_mapping_table_[i]);
+      CHECK_LE(from.NativePcOffset(), dex2pc_mapping_table_[i]);
     }
   }
-
-  void SetReferences(size_t table_index, const uint8_t* references) {
-    size_t table_offset = (table_index * EntryWidth()) + sizeof(uint32_t);
-    memcpy(&(*table_)[table_offset + native_offset_width_], references, references_width_);
-  }
-
-  size_t EntryWidth() const {
-    return native_offset_width_ + references_width_;
-  }
-
-  // Number of entries in the table.
-  const size_t entries_;
-  // Number of bytes used to encode the reference bitmap.
-  const size_t references_width_;
-  // Number of bytes used to encode a native offset.
-  size_t native_offset_width_;
-  // Entries that are in use.
-  std::vector<bool> in_use_;
-  // The table we're building.
-  std::vector<uint8_t>* const table_;
-};
+}
 
 void Mir2Lir::CreateNativeGcMap() {
   const std::vector<uint32_t>& mapping_table = pc2dex_mapping_table_;
@@ -651,6 +596,7 @@ void Mir2Lir::CreateNativeGcMap() {
     CHECK(references != NULL) << "Missing ref for dex pc 0x" << std::hex << dex_pc;
     native_gc_map_builder.AddEntry(native_offset, references);
   }
+  native_gc_map_builder.Finish();
 }
 
 /* Determine the offset of each literal field */
@@ -667,13 +613,9 @@ int Mir2Lir::AssignSwitchTablesOffset(int offset) {
     Mir2Lir::SwitchTable *tab_rec = iterator.Next();
     if (tab_rec == NULL) break;
     tab_rec->offset = offset;
-    if (tab_rec->table[0] == Instruction::kSparseSwitchSignature) {
-      offset += tab_rec->table[1] * (sizeof(int) * 2);
-    } else {
-      DCHECK_EQ(static_cast<int>(tab_rec->table[0]),
-                static_cast<int>(Instruction::kPackedSwitchSignature));
-      offset += tab_rec->table[1] * sizeof(int);
-    }
+    DCHECK_EQ(static_cast<int>(tab_rec->table[0]),
+              static_cast<int>(Instruction::kPackedSwitchSignature));
+    offset += tab_rec->table[1] * sizeof(int);
   }
   return offset;
 }
@@ -691,12 +633,12 @@ int Mir2Lir::AssignFillArrayDataOffset(int offset) {
   return offset;
 }
 
-// LIR offset assignment.
-int Mir2Lir::AssignInsnOffsets() {
+// LIR offset assignment, from start on which keeps its offset.
+int Mir2Lir::AssignInsnOffsets(LIR* start) {
   LIR* lir;
-  int offset = 0;
+  int offset = (start != first_lir_insn_) ? start->offset : 0;
 
-  for (lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
+  for (lir = start; lir != NULL; lir = NEXT_LIR(lir)) {
     lir->offset = offset;
     if (lir->opcode >= 0) {
       if (!lir->flags.is_nop) {
@@ -717,11 +659,11 @@ int Mir2Lir::AssignInsnOffsets() {
 }
 
 /*
- * Walk the compilation unit and assign offsets to instructions
+ * Walk the compilation unit from start on and assign offsets to instructions
  * and literals and compute the total size of the compiled unit.
  */
-void Mir2Lir::AssignOffsets() {
-  int offset = AssignInsnOffsets();
+void Mir2Lir::AssignOffsets(LIR* start) {
+  int offset = AssignInsnOffsets(start);
 
   /* Const values have to be word aligned */
   offset = (offset + 3) & ~3;
@@ -738,35 +680,71 @@ void Mir2Lir::AssignOffsets() {
   total_size_ = offset;
 }
 
+// Appends the instructions from start on which need pc-relative fixup to fixups_.
+void Mir2Lir::LinkFixups(LIR* start) {
+  for (LIR* lir = start; lir != NULL; lir = NEXT_LIR(lir)) {
+    if (lir->opcode >= 0 && lir->flags.pcRelFixup && !lir->flags.is_nop) {
+      fixups_.Insert(lir);
+    }
+  }
+}
+
 /*
  * Go over each instruction in the list and calculate the offset from the top
  * before sending them off to the assembler. If out-of-range branch distance is
  * seen rearrange the instructions a bit to correct it.
  */
 void Mir2Lir::AssembleLIR() {
-  AssignOffsets();
+  AssignOffsets(first_lir_insn_);
+  LinkFixups(first_lir_insn_);
   int assembler_retries = 0;
   /*
-   * Assemble here.  Note that we generate code with optimistic assumptions
-   * and if found now to work, we'll have to redo the sequence and retry.
+   * Fix up here.  Note that we generate code with optimistic assumptions and
+   * if found not to work, the instructions are widened or replaced by longer
+   * sequences.  Only the instructions on the fixup list are visited again
+   * until they all fit, and the offsets and the fixup list are only redone
+   * from the first instruction that changed.  Nothing is encoded before the
+   * layout is final.
    */
-
   while (true) {
-    AssemblerStatus res = AssembleInstructions(0);
-    if (res == kSuccess) {
+    size_t num_fixups = fixups_.Size();
+    size_t first_changed = num_fixups;
+    for (size_t i = 0; i < num_fixups; i++) {
+      LIR* lir = fixups_.Get(i);
+      if (!lir->flags.is_nop && FixupInstruction(lir, 0) != kSuccess &&
+          first_changed == num_fixups) {
+        first_changed = i;
+      }
+    }
+    if (first_changed == num_fixups) {
       break;
-    } else {
-      assembler_retries++;
-      if (assembler_retries > MAX_ASSEMBLER_RETRIES) {
-        CodegenDump();
-        LOG(FATAL) << "Assembler error - too many retries";
+    }
+    assembler_retries++;
+    if (assembler_retries > MAX_ASSEMBLER_RETRIES) {
+      CodegenDump();
+      LOG(FATAL) << "Assembler error - too many retries";
+    }
+    // New instructions go right before or after the one that changed, the fixup before it and
+    // everything ahead of that keep their offsets.
+    size_t keep = (first_changed == 0) ? 0 : first_changed - 1;
+    LIR* restart = (keep == 0) ? first_lir_insn_ : fixups_.Get(keep);
+    fixups_.SetSize(keep);
+    AssignOffsets(restart);
+    LinkFixups(restart);
+  }
+  if (cu_->compile_stats != NULL) {
+    cu_->compile_stats->assembler_retries = assembler_retries;
+    for (LIR* lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
+      if (!lir->flags.is_nop) {
+        cu_->compile_stats->lir_count++;
       }
-      // Redo offsets and try again
-      AssignOffsets();
-      code_buffer_.clear();
     }
   }
 
+  for (LIR* lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
+    EncodeInstruction(lir);
+  }
+
   // Install literals
   InstallLiteralPools();
 
@@ -814,17 +792,6 @@ void Mir2Lir::MarkPackedCaseLabels(Mir2Lir::SwitchTable *tab_rec) {
   }
 }
 
-void Mir2Lir::MarkSparseCaseLabels(Mir2Lir::SwitchTable *tab_rec) {
-  const uint16_t* table = tab_rec->table;
-  int base_vaddr = tab_rec->vaddr;
-  int entries = table[1];
-  const int* keys = reinterpret_cast<const int*>(&table[2]);
-  const int* targets = &keys[entries];
-  for (int i = 0; i < entries; i++) {
-    tab_rec->targets[i] = InsertCaseLabel(base_vaddr + targets[i], keys[i]);
-  }
-}
-
 void Mir2Lir::ProcessSwitchTables() {
   GrowableArray<SwitchTable*>::Iterator iterator(&switch_tables_);
   while (true) {
@@ -832,8 +799,6 @@ void Mir2Lir::ProcessSwitchTables() {
     if (tab_rec == NULL) break;
     if (tab_rec->table[0] == Instruction::kPackedSwitchSignature) {
       MarkPackedCaseLabels(tab_rec);
-    } else if (tab_rec->table[0] == Instruction::kSparseSwitchSignature) {
-      MarkSparseCaseLabels(tab_rec);
     } else {
       LOG(FATAL) << "Invalid switch table";
     }
@@ -949,6 +914,7 @@ Mir2Lir::Mir2Lir(CompilationUnit* cu, MIRGraph* mir_graph, ArenaAllocator* arena
       throw_launchpads_(arena, 2048, kGrowableArrayThrowLaunchPads),
       suspend_launchpads_(arena, 4, kGrowableArraySuspendLaunchPads),
       intrinsic_launchpads_(arena, 2048, kGrowableArrayMisc),
+      fixups_(arena, 256, kGrowableArrayMisc),
       data_offset_(0),
       total_size_(0),
       block_label_list_(NULL),
@@ -972,6 +938,7 @@ void Mir2Lir::Materialize() {
 
   /* Allocate Registers using simple local allocation scheme */
   SimpleRegAlloc();
+  cu_->EndPass("register allocation");
 
   if (mir_graph_->IsSpecialCase()) {
       /*
@@ -986,6 +953,7 @@ void Mir2Lir::Materialize() {
   if (first_lir_insn_ == NULL) {
     MethodMIR2LIR();
   }
+  cu_->EndPass("MIR to LIR");
 
   /* Method is not empty */
   if (first_lir_insn_) {
@@ -994,6 +962,7 @@ void Mir2Lir::Materialize() {
 
     /* Convert LIR into machine code. */
     AssembleLIR();
+    cu_->EndPass("assembly");
 
     if (cu_->verbose) {
       CodegenDump();
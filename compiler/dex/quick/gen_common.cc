@@ -73,6 +73,32 @@ LIR* Mir2Lir::GenNullCheck(int s_reg, int m_reg, int opt_flags) {
   return GenImmedCheck(kCondEq, m_reg, 0, kThrowNullPointer);
 }
 
+/*
+ * Null-check m_reg for a memory access at offset from it. Returns true if the check is left to
+ * the access faulting within the first page, in which case the access must be the last LIR
+ * generated before MarkImplicitNullCheck.
+ */
+bool Mir2Lir::GenAccessNullCheck(int s_reg, int m_reg, int offset, int opt_flags) {
+  if (!(cu_->disable_opt & (1 << kNullCheckElimination)) &&
+    opt_flags & MIR_IGNORE_NULL_CHECK) {
+    return false;
+  }
+  if (!(cu_->disable_opt & (1 << kImplicitNullChecks)) && offset >= 0 && offset < kPageSize) {
+    return true;
+  }
+  GenNullCheck(s_reg, m_reg, opt_flags);
+  return false;
+}
+
+/*
+ * Map the native pc following the last LIR, an access left to fault on a null reference, to the
+ * current dex pc. The fault handler makes the access look like a call to the throw entrypoint
+ * returning there.
+ */
+void Mir2Lir::MarkImplicitNullCheck() {
+  MarkSafepointPC(last_lir_insn_);
+}
+
 /* Perform check on two registers */
 LIR* Mir2Lir::GenRegRegCheck(ConditionCode c_code, int reg1, int reg2,
                              ThrowKind kind) {
@@ -168,6 +194,206 @@ void Mir2Lir::GenCompareZeroAndBranch(Instruction::Code opcode, RegLocation rl_s
   OpUnconditionalBranch(fall_through);
 }
 
+// Switches of fewer cases are lowered to compares, and jump tables are at least this full.
+static const int kMinJumpTableCases = 4;
+static const int kJumpTableSlotsPerCase = 2;
+static const int64_t kMaxJumpTableSlots = 1024;
+// Runs of at least this many keys within the bits of a word going to one case are bit tested.
+static const int kMinBitTestCases = 3;
+// Larger ranges of clusters are split in two by a compare with the middle one.
+static const int kMaxLinearClusters = 3;
+
+struct Mir2Lir::SwitchLowering {
+  MIR* mir;
+  RegLocation rl_src;         // In a core register.
+  const int32_t* keys;        // Sorted.
+  const int* targets;         // Relative to the switch opcode.
+  int default_target;
+  LIR* default_label;
+  const SwitchCluster* clusters;
+};
+
+typedef std::vector<Mir2Lir::SwitchCluster, ArenaAllocatorAdapter<Mir2Lir::SwitchCluster> >
+    SwitchClusterVector;
+
+/* Groups the sorted keys of a switch into the clusters lowered together. */
+static void FindSwitchClusters(const int32_t* keys, const int* targets, int num_cases,
+                               SwitchClusterVector* clusters) {
+  int first = 0;
+  while (first < num_cases) {
+    Mir2Lir::SwitchCluster cluster = { Mir2Lir::kSwitchCompare, first, first };
+    // The longest run dense enough for a jump table.
+    int last_dense = first;
+    for (int i = first + 1; i < num_cases; i++) {
+      int64_t slots = static_cast<int64_t>(keys[i]) - keys[first] + 1;
+      if (slots > kMaxJumpTableSlots) {
+        break;
+      }
+      if ((i - first + 1) * kJumpTableSlotsPerCase >= slots) {
+        last_dense = i;
+      }
+    }
+    int last_bit = first;
+    while (last_bit + 1 < num_cases && targets[last_bit + 1] == targets[first] &&
+           static_cast<int64_t>(keys[last_bit + 1]) - keys[first] < 32) {
+      last_bit++;
+    }
+    if (last_dense - first + 1 >= kMinJumpTableCases) {
+      cluster.kind = Mir2Lir::kSwitchJumpTable;
+      cluster.last_case = last_dense;
+    } else if (last_bit - first + 1 >= kMinBitTestCases) {
+      cluster.kind = Mir2Lir::kSwitchBitTest;
+      cluster.last_case = last_bit;
+    }
+    clusters->push_back(cluster);
+    first = cluster.last_case + 1;
+  }
+}
+
+/*
+ * Lowers a packed or sparse switch.  The sparse keys are compared with, the runs of dense keys
+ * get a jump table and the runs of close keys going to one case a bit test, and the clusters of
+ * keys are searched for with a balanced tree of compares.  A packed switch of enough cases is a
+ * single jump table.
+ */
+void Mir2Lir::GenSwitch(MIR* mir, BasicBlock* bb, uint32_t table_offset, RegLocation rl_src) {
+  const uint16_t* table = cu_->insns + current_dalvik_offset_ + table_offset;
+  bool packed = (table[0] == Instruction::kPackedSwitchSignature);
+  int num_cases = table[1];
+  if (num_cases == 0) {
+    // Every key goes to the default case, which is the fall through.
+    return;
+  }
+  if (packed && num_cases >= kMinJumpTableCases) {
+    GenPackedSwitch(mir, table, rl_src);
+    return;
+  }
+  SwitchLowering lowering;
+  lowering.mir = mir;
+  lowering.default_target = bb->fall_through->start_offset - current_dalvik_offset_;
+  lowering.default_label = &block_label_list_[bb->fall_through->id];
+  if (packed) {
+    if (cu_->verbose) {
+      DumpPackedSwitchTable(table);
+    }
+    int32_t* keys = static_cast<int32_t*>(arena_->Alloc(num_cases * sizeof(int32_t),
+                                                        ArenaAllocator::kAllocData));
+    int32_t low_key = s4FromSwitchData(&table[2]);
+    for (int i = 0; i < num_cases; i++) {
+      keys[i] = low_key + i;
+    }
+    lowering.keys = keys;
+    lowering.targets = reinterpret_cast<const int*>(&table[4]);
+  } else {
+    DCHECK_EQ(static_cast<int>(table[0]), static_cast<int>(Instruction::kSparseSwitchSignature));
+    if (cu_->verbose) {
+      DumpSparseSwitchTable(table);
+    }
+    lowering.keys = reinterpret_cast<const int32_t*>(&table[2]);
+    lowering.targets = &lowering.keys[num_cases];
+  }
+  SwitchClusterVector clusters((ArenaAllocatorAdapter<SwitchCluster>(arena_)));
+  FindSwitchClusters(lowering.keys, lowering.targets, num_cases, &clusters);
+  lowering.clusters = &clusters[0];
+
+  bool has_bit_tests = false;
+  for (size_t i = 0; i < clusters.size(); i++) {
+    has_bit_tests |= (clusters[i].kind == kSwitchBitTest);
+  }
+  // X86 shifts by ECX only, the key must be elsewhere.
+  bool x86_bit_tests = has_bit_tests && (cu_->instruction_set == kX86);
+  if (x86_bit_tests) {
+    FlushAllRegs();
+    LockTemp(TargetReg(kCount));
+  }
+  lowering.rl_src = LoadValue(rl_src, kCoreReg);
+  if (x86_bit_tests) {
+    FreeTemp(TargetReg(kCount));
+  }
+  GenSwitchClusters(lowering, 0, clusters.size() - 1, true);
+}
+
+/*
+ * Tests the keys of clusters first to last, branching to the default case if none matches
+ * unless falls_out is set, in which case the code following the switch does.
+ */
+void Mir2Lir::GenSwitchClusters(const SwitchLowering& lowering, int first, int last,
+                                bool falls_out) {
+  if (last - first < kMaxLinearClusters) {
+    for (int i = first; i <= last; i++) {
+      GenSwitchCluster(lowering, lowering.clusters[i]);
+    }
+    if (!falls_out) {
+      OpUnconditionalBranch(lowering.default_label);
+    }
+    return;
+  }
+  int middle = (first + last + 1) / 2;
+  int32_t middle_key = lowering.keys[lowering.clusters[middle].first_case];
+  LIR* branch_low = OpCmpImmBranch(kCondLt, lowering.rl_src.low_reg, middle_key, NULL);
+  GenSwitchClusters(lowering, middle, last, false);
+  branch_low->target = NewLIR0(kPseudoTargetLabel);
+  GenSwitchClusters(lowering, first, middle - 1, falls_out);
+}
+
+void Mir2Lir::GenSwitchCluster(const SwitchLowering& lowering, const SwitchCluster& cluster) {
+  const int32_t* keys = lowering.keys;
+  const int* targets = lowering.targets;
+  int r_key = lowering.rl_src.low_reg;
+  int32_t low_key = keys[cluster.first_case];
+  LIR* target = &block_label_list_[
+      mir_graph_->FindBlock(current_dalvik_offset_ + targets[cluster.first_case])->id];
+  switch (cluster.kind) {
+    case kSwitchCompare:
+      OpCmpImmBranch(kCondEq, r_key, low_key, target);
+      break;
+    case kSwitchBitTest: {
+      uint32_t mask = 0;
+      for (int i = cluster.first_case; i <= cluster.last_case; i++) {
+        mask |= 1u << (keys[i] - low_key);
+      }
+      int r_bit_index;
+      if (cu_->instruction_set == kX86) {
+        r_bit_index = TargetReg(kCount);
+        LockTemp(r_bit_index);
+      } else {
+        r_bit_index = AllocTemp();
+      }
+      OpRegRegImm(kOpSub, r_bit_index, r_key, low_key);
+      LIR* branch_over = OpCmpImmBranch(kCondHi, r_bit_index, 31, NULL);
+      int r_bit = AllocTemp();
+      LoadConstant(r_bit, 1);
+      OpRegRegReg(kOpLsl, r_bit, r_bit, r_bit_index);
+      OpRegImm(kOpAnd, r_bit, mask);
+      OpCmpImmBranch(kCondNe, r_bit, 0, target);
+      branch_over->target = NewLIR0(kPseudoTargetLabel);
+      FreeTemp(r_bit);
+      FreeTemp(r_bit_index);
+      break;
+    }
+    case kSwitchJumpTable: {
+      // A packed table of the run, its missing keys going to the default case.
+      int num_slots = keys[cluster.last_case] - low_key + 1;
+      uint16_t* table = static_cast<uint16_t*>(arena_->Alloc((4 + 2 * num_slots) * sizeof(uint16_t),
+                                                           ArenaAllocator::kAllocData));
+      table[0] = Instruction::kPackedSwitchSignature;
+      table[1] = num_slots;
+      memcpy(&table[2], &low_key, sizeof(low_key));
+      int* slot_targets = reinterpret_cast<int*>(&table[4]);
+      for (int i = 0; i < num_slots; i++) {
+        slot_targets[i] = lowering.default_target;
+      }
+      for (int i = cluster.first_case; i <= cluster.last_case; i++) {
+        slot_targets[keys[i] - low_key] = targets[i];
+      }
+      GenPackedSwitch(lowering.mir, table, lowering.rl_src);
+      break;
+    }
+    default:
+      LOG(FATAL) << "Unexpected switch cluster kind " << cluster.kind;
+  }
+}
+
 void Mir2Lir::GenIntToLong(RegLocation rl_dest, RegLocation rl_src) {
   RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
   if (rl_src.location == kLocPhysReg) {
@@ -331,15 +557,17 @@ void Mir2Lir::GenFilledNewArray(CallInfo* info) {
   }
 }
 
-void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_double,
-                      bool is_object) {
+void Mir2Lir::GenSput(uint32_t field_idx, int opt_flags, RegLocation rl_src,
+                      bool is_long_or_double, bool is_object) {
   int field_offset;
   int ssb_index;
   bool is_volatile;
   bool is_referrers_class;
+  bool is_initialized;
+  uintptr_t direct_storage;
   bool fast_path = cu_->compiler_driver->ComputeStaticFieldInfo(
       field_idx, mir_graph_->GetCurrentDexCompilationUnit(), field_offset, ssb_index,
-      is_referrers_class, is_volatile, true);
+      is_referrers_class, is_volatile, true, &is_initialized, &direct_storage);
   if (fast_path && !SLOW_FIELD_PATH) {
     DCHECK_GE(field_offset, 0);
     int rBase;
@@ -352,6 +580,25 @@ void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_do
       if (IsTemp(rl_method.low_reg)) {
         FreeTemp(rl_method.low_reg);
       }
+    } else if (is_initialized && direct_storage != 0) {
+      // Fast path, the other class is initialized in the boot image, which it never leaves.
+      rBase = AllocTemp();
+      LoadConstant(rBase, static_cast<int>(direct_storage));
+    } else if (is_initialized || (opt_flags & MIR_IGNORE_CLINIT_CHECK) != 0) {
+      // Medium path, but the other class was initialized when compiling the boot image or by a
+      // dominating access, so its static storage base is already in the dex cache.
+      DCHECK_GE(ssb_index, 0);
+      RegLocation rl_method  = LoadCurrMethod();
+      rBase = AllocTemp();
+      LoadWordDisp(rl_method.low_reg,
+                   mirror::ArtMethod::DexCacheInitializedStaticStorageOffset().Int32Value(),
+                   rBase);
+      LoadWordDisp(rBase,
+                   mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value() +
+                   sizeof(int32_t*) * ssb_index, rBase);
+      if (IsTemp(rl_method.low_reg)) {
+        FreeTemp(rl_method.low_reg);
+      }
     } else {
       // Medium path, static storage base in a different class which requires checks that the other
       // class is initialized.
@@ -403,7 +650,8 @@ void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_do
     if (is_volatile) {
       GenMemBarrier(kStoreLoad);
     }
-    if (is_object && !mir_graph_->IsConstantNullRef(rl_src)) {
+    if (is_object && !(opt_flags & MIR_IGNORE_CARD_MARK) &&
+        !mir_graph_->IsConstantNullRef(rl_src)) {
       MarkGCCard(rl_src.low_reg, rBase);
     }
     FreeTemp(rBase);
@@ -417,15 +665,17 @@ void Mir2Lir::GenSput(uint32_t field_idx, RegLocation rl_src, bool is_long_or_do
   }
 }
 
-void Mir2Lir::GenSget(uint32_t field_idx, RegLocation rl_dest,
+void Mir2Lir::GenSget(uint32_t field_idx, int opt_flags, RegLocation rl_dest,
                       bool is_long_or_double, bool is_object) {
   int field_offset;
   int ssb_index;
   bool is_volatile;
   bool is_referrers_class;
+  bool is_initialized;
+  uintptr_t direct_storage;
   bool fast_path = cu_->compiler_driver->ComputeStaticFieldInfo(
       field_idx, mir_graph_->GetCurrentDexCompilationUnit(), field_offset, ssb_index,
-      is_referrers_class, is_volatile, false);
+      is_referrers_class, is_volatile, false, &is_initialized, &direct_storage);
   if (fast_path && !SLOW_FIELD_PATH) {
     DCHECK_GE(field_offset, 0);
     int rBase;
@@ -435,6 +685,21 @@ void Mir2Lir::GenSget(uint32_t field_idx, RegLocation rl_dest,
       rBase = AllocTemp();
       LoadWordDisp(rl_method.low_reg,
                    mirror::ArtMethod::DeclaringClassOffset().Int32Value(), rBase);
+    } else if (is_initialized && direct_storage != 0) {
+      // Fast path, the other class is initialized in the boot image, which it never leaves.
+      rBase = AllocTemp();
+      LoadConstant(rBase, static_cast<int>(direct_storage));
+    } else if (is_initialized || (opt_flags & MIR_IGNORE_CLINIT_CHECK) != 0) {
+      // Medium path, but the other class was initialized when compiling the boot image or by a
+      // dominating access, so its static storage base is already in the dex cache.
+      DCHECK_GE(ssb_index, 0);
+      RegLocation rl_method  = LoadCurrMethod();
+      rBase = AllocTemp();
+      LoadWordDisp(rl_method.low_reg,
+                   mirror::ArtMethod::DexCacheInitializedStaticStorageOffset().Int32Value(),
+                   rBase);
+      LoadWordDisp(rBase, mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value() +
+                   sizeof(int32_t*) * ssb_index, rBase);
     } else {
       // Medium path, static storage base in a different class which requires checks that the other
       // class is initialized
@@ -657,7 +922,8 @@ void Mir2Lir::GenIGet(uint32_t field_idx, int opt_flags, OpSize size,
     rl_obj = LoadValue(rl_obj, kCoreReg);
     if (is_long_or_double) {
       DCHECK(rl_dest.wide);
-      GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
+      bool implicit_null_check =
+          GenAccessNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, field_offset, opt_flags);
       if (cu_->instruction_set == kX86) {
         rl_result = EvalLoc(rl_dest, reg_class, true);
         GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
@@ -671,6 +937,9 @@ void Mir2Lir::GenIGet(uint32_t field_idx, int opt_flags, OpSize size,
         OpRegRegImm(kOpAdd, reg_ptr, rl_obj.low_reg, field_offset);
         rl_result = EvalLoc(rl_dest, reg_class, true);
         LoadBaseDispWide(reg_ptr, 0, rl_result.low_reg, rl_result.high_reg, INVALID_SREG);
+        if (implicit_null_check) {
+          MarkImplicitNullCheck();
+        }
         if (is_volatile) {
           GenMemBarrier(kLoadLoad);
         }
@@ -679,9 +948,13 @@ void Mir2Lir::GenIGet(uint32_t field_idx, int opt_flags, OpSize size,
       StoreValueWide(rl_dest, rl_result);
     } else {
       rl_result = EvalLoc(rl_dest, reg_class, true);
-      GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
+      bool implicit_null_check =
+          GenAccessNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, field_offset, opt_flags);
       LoadBaseDisp(rl_obj.low_reg, field_offset, rl_result.low_reg,
                    kWord, rl_obj.s_reg_low);
+      if (implicit_null_check) {
+        MarkImplicitNullCheck();
+      }
       if (is_volatile) {
         GenMemBarrier(kLoadLoad);
       }
@@ -718,28 +991,37 @@ void Mir2Lir::GenIPut(uint32_t field_idx, int opt_flags, OpSize size,
     if (is_long_or_double) {
       int reg_ptr;
       rl_src = LoadValueWide(rl_src, kAnyReg);
-      GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
+      bool implicit_null_check =
+          GenAccessNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, field_offset, opt_flags);
       reg_ptr = AllocTemp();
       OpRegRegImm(kOpAdd, reg_ptr, rl_obj.low_reg, field_offset);
       if (is_volatile) {
         GenMemBarrier(kStoreStore);
       }
       StoreBaseDispWide(reg_ptr, 0, rl_src.low_reg, rl_src.high_reg);
+      if (implicit_null_check) {
+        MarkImplicitNullCheck();
+      }
       if (is_volatile) {
         GenMemBarrier(kLoadLoad);
       }
       FreeTemp(reg_ptr);
     } else {
       rl_src = LoadValue(rl_src, reg_class);
-      GenNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, opt_flags);
+      bool implicit_null_check =
+          GenAccessNullCheck(rl_obj.s_reg_low, rl_obj.low_reg, field_offset, opt_flags);
       if (is_volatile) {
         GenMemBarrier(kStoreStore);
       }
       StoreBaseDisp(rl_obj.low_reg, field_offset, rl_src.low_reg, kWord);
+      if (implicit_null_check) {
+        MarkImplicitNullCheck();
+      }
       if (is_volatile) {
         GenMemBarrier(kLoadLoad);
       }
-      if (is_object && !mir_graph_->IsConstantNullRef(rl_src)) {
+      if (is_object && !(opt_flags & MIR_IGNORE_CARD_MARK) &&
+          !mir_graph_->IsConstantNullRef(rl_src)) {
         MarkGCCard(rl_src.low_reg, rl_obj.low_reg);
       }
     }
@@ -942,6 +1224,24 @@ void Mir2Lir::GenInstanceofFinal(bool use_declaring_class, uint32_t type_idx, Re
   StoreValue(rl_dest, rl_result);
 }
 
+// Probes the calling thread's subtype check cache, see Thread::InSubtypeCheckCache. Returns the
+// branch, to be given a target, taken if the cache has the pair of classes.
+LIR* Mir2Lir::GenSubtypeCheckCacheHit(int sub_class_reg, int super_class_reg, int entry_reg,
+                                      int temp_reg) {
+  DCHECK_NE(cu_->instruction_set, kX86);
+  OpRegRegReg(kOpXor, entry_reg, sub_class_reg, super_class_reg);
+  OpRegImm(kOpAnd, entry_reg, Thread::kSubtypeCheckCacheMask);
+  OpRegReg(kOpAdd, entry_reg, TargetReg(kSelf));
+  LoadConstant(temp_reg, Thread::SubtypeCheckCacheOffset().Int32Value());
+  OpRegReg(kOpAdd, entry_reg, temp_reg);
+  LoadWordDisp(entry_reg, OFFSETOF_MEMBER(Thread::SubtypeCheckCacheEntry, sub_class), temp_reg);
+  LIR* miss = OpCmpBranch(kCondNe, temp_reg, sub_class_reg, NULL);
+  LoadWordDisp(entry_reg, OFFSETOF_MEMBER(Thread::SubtypeCheckCacheEntry, super_class), temp_reg);
+  LIR* hit = OpCmpBranch(kCondEq, temp_reg, super_class_reg, NULL);
+  miss->target = NewLIR0(kPseudoTargetLabel);
+  return hit;
+}
+
 void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_known_final,
                                          bool type_known_abstract, bool use_declaring_class,
                                          bool can_assume_type_is_in_dex_cache,
@@ -998,6 +1298,7 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
   LoadWordDisp(TargetReg(kArg0),  mirror::Object::ClassOffset().Int32Value(), TargetReg(kArg1));
   /* kArg0 is ref, kArg1 is ref->klass_, kArg2 is class */
   LIR* branchover = NULL;
+  LIR* cache_hit = NULL;
   if (type_known_final) {
     // rl_result == ref == null == 0.
     if (cu_->instruction_set == kThumb2) {
@@ -1011,32 +1312,24 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
       LoadConstant(rl_result.low_reg, 1);     // eq case - load true
     }
   } else {
-    if (cu_->instruction_set == kThumb2) {
+    /* Uses branchovers */
+    LoadConstant(rl_result.low_reg, 1);     // assume true
+    if (!type_known_abstract) {
+      branchover = OpCmpBranch(kCondEq, TargetReg(kArg1), TargetReg(kArg2), NULL);
+    }
+    if (cu_->instruction_set != kX86) {
+      // x86 has no self register to index the cache with.
+      int r_tmp = AllocTemp();
+      cache_hit = GenSubtypeCheckCacheHit(TargetReg(kArg1), TargetReg(kArg2), TargetReg(kArg3),
+                                          r_tmp);
+      FreeTemp(r_tmp);
       int r_tgt = LoadHelper(QUICK_ENTRYPOINT_OFFSET(pInstanceofNonTrivial));
-      if (!type_known_abstract) {
-      /* Uses conditional nullification */
-        OpRegReg(kOpCmp, TargetReg(kArg1), TargetReg(kArg2));  // Same?
-        OpIT(kCondEq, "EE");   // if-convert the test
-        LoadConstant(TargetReg(kArg0), 1);     // .eq case - load true
-      }
       OpRegCopy(TargetReg(kArg0), TargetReg(kArg2));    // .ne case - arg0 <= class
       OpReg(kOpBlx, r_tgt);    // .ne case: helper(class, ref->class)
       FreeTemp(r_tgt);
     } else {
-      if (!type_known_abstract) {
-        /* Uses branchovers */
-        LoadConstant(rl_result.low_reg, 1);     // assume true
-        branchover = OpCmpBranch(kCondEq, TargetReg(kArg1), TargetReg(kArg2), NULL);
-      }
-      if (cu_->instruction_set != kX86) {
-        int r_tgt = LoadHelper(QUICK_ENTRYPOINT_OFFSET(pInstanceofNonTrivial));
-        OpRegCopy(TargetReg(kArg0), TargetReg(kArg2));    // .ne case - arg0 <= class
-        OpReg(kOpBlx, r_tgt);    // .ne case: helper(class, ref->class)
-        FreeTemp(r_tgt);
-      } else {
-        OpRegCopy(TargetReg(kArg0), TargetReg(kArg2));
-        OpThreadMem(kOpBlx, QUICK_ENTRYPOINT_OFFSET(pInstanceofNonTrivial));
-      }
+      OpRegCopy(TargetReg(kArg0), TargetReg(kArg2));
+      OpThreadMem(kOpBlx, QUICK_ENTRYPOINT_OFFSET(pInstanceofNonTrivial));
     }
   }
   // TODO: only clobber when type isn't final?
@@ -1048,6 +1341,9 @@ void Mir2Lir::GenInstanceofCallingHelper(bool needs_access_check, bool type_know
   if (branchover != NULL) {
     branchover->target = target;
   }
+  if (cache_hit != NULL) {
+    cache_hit->target = target;
+  }
 }
 
 void Mir2Lir::GenInstanceof(uint32_t type_idx, RegLocation rl_dest, RegLocation rl_src) {
@@ -1135,6 +1431,12 @@ void Mir2Lir::GenCheckCast(uint32_t insn_idx, uint32_t type_idx, RegLocation rl_
   if (!type_known_abstract) {
     branch2 = OpCmpBranch(kCondEq, TargetReg(kArg1), class_reg, NULL);
   }
+  LIR* cache_hit = NULL;
+  if (cu_->instruction_set != kX86) {
+    int r_tmp = AllocTemp();
+    cache_hit = GenSubtypeCheckCacheHit(TargetReg(kArg1), class_reg, TargetReg(kArg3), r_tmp);
+    FreeTemp(r_tmp);
+  }
   CallRuntimeHelperRegReg(QUICK_ENTRYPOINT_OFFSET(pCheckCast), TargetReg(kArg1),
                           TargetReg(kArg2), true);
   /* branch target here */
@@ -1143,6 +1445,9 @@ void Mir2Lir::GenCheckCast(uint32_t insn_idx, uint32_t type_idx, RegLocation rl_
   if (branch2 != NULL) {
     branch2->target = target;
   }
+  if (cache_hit != NULL) {
+    cache_hit->target = target;
+  }
 }
 
 void Mir2Lir::GenLong3Addr(OpKind first_op, OpKind second_op, RegLocation rl_dest,
@@ -1321,7 +1626,7 @@ void Mir2Lir::GenArithOpInt(Instruction::Code opcode, RegLocation rl_dest,
     }
     StoreValue(rl_dest, rl_result);
   } else {
-    if (cu_->instruction_set == kMips) {
+    if (HasHardwareDivide()) {
       rl_src1 = LoadValue(rl_src1, kCoreReg);
       rl_src2 = LoadValue(rl_src2, kCoreReg);
       if (check_zero) {
@@ -1575,7 +1880,7 @@ void Mir2Lir::GenArithOpIntLit(Instruction::Code opcode, RegLocation rl_dest, Re
       if (HandleEasyDivRem(opcode, is_div, rl_src, rl_dest, lit)) {
         return;
       }
-      if (cu_->instruction_set == kMips) {
+      if (HasHardwareDivide()) {
         rl_src = LoadValue(rl_src, kCoreReg);
         rl_result = GenDivRemLit(rl_dest, rl_src.low_reg, lit, is_div);
       } else {
@@ -1653,7 +1958,7 @@ void Mir2Lir::GenArithOpLong(Instruction::Code opcode, RegLocation rl_dest,
       break;
     case Instruction::MUL_LONG:
     case Instruction::MUL_LONG_2ADDR:
-      if (cu_->instruction_set == kThumb2) {
+      if (cu_->instruction_set != kMips) {
         GenMulLong(rl_dest, rl_src1, rl_src2);
         return;
       } else {
@@ -1764,6 +2069,10 @@ void Mir2Lir::GenSuspendTest(int opt_flags) {
     return;
   }
   FlushAllRegs();
+  if (!(cu_->disable_opt & (1 << kImplicitSuspendChecks))) {
+    GenImplicitSuspendTest();
+    return;
+  }
   LIR* branch = OpTestSuspend(NULL);
   LIR* ret_lab = NewLIR0(kPseudoTargetLabel);
   LIR* target = RawLIR(current_dalvik_offset_, kPseudoSuspendTarget,
@@ -1772,12 +2081,36 @@ void Mir2Lir::GenSuspendTest(int opt_flags) {
   suspend_launchpads_.Insert(target);
 }
 
+/*
+ * Load through the thread's suspend trigger, which the runtime clears to request a suspend
+ * check. The fault handler recognizes the faulting sequence by its encoding, so it must be
+ * exactly "ldr.w r12, [r9, #trigger]; ldr.w r12, [r12]", and makes it call the implicit suspend
+ * entrypoint, which preserves all registers.
+ */
+void Mir2Lir::GenImplicitSuspendTest() {
+  DCHECK_EQ(cu_->instruction_set, kThumb2);
+  Clobber(r12);
+  LockTemp(r12);
+  LIR* load_trigger = LoadWordDisp(rARM_SELF, Thread::SuspendTriggerOffset().Int32Value(), r12);
+  // Keep the loads together and in place.
+  load_trigger->def_mask = ENCODE_ALL;
+  LoadWordDisp(r12, 0, r12);
+  MarkSafepointPC(last_lir_insn_);
+  FreeTemp(r12);
+}
+
 /* Check if we need to check for pending suspend request */
 void Mir2Lir::GenSuspendTestAndBranch(int opt_flags, LIR* target) {
   if (NO_SUSPEND || (opt_flags & MIR_IGNORE_SUSPEND_CHECK)) {
     OpUnconditionalBranch(target);
     return;
   }
+  if (!(cu_->disable_opt & (1 << kImplicitSuspendChecks))) {
+    FlushAllRegs();
+    GenImplicitSuspendTest();
+    OpUnconditionalBranch(target);
+    return;
+  }
   OpTestSuspend(target);
   LIR* launch_pad =
       RawLIR(current_dalvik_offset_, kPseudoSuspendTarget,
@@ -1787,4 +2120,71 @@ void Mir2Lir::GenSuspendTestAndBranch(int opt_flags, LIR* target) {
   suspend_launchpads_.Insert(launch_pad);
 }
 
+/*
+ * Elements summed by one kMirOpSumIntArray, so that the loop it came from still reaches its
+ * suspend check every few microseconds.
+ */
+static const int kMaxSumIntArrayElements = 4096;
+
+/*
+ * Sets up the elements summed by a kMirOpSumIntArray s', i' = s, arr, i, n: stores
+ * i' = min(n, i + kMaxSumIntArrayElements), points r_ptr at arr[i] and r_end at arr[i'], and
+ * returns s' holding s.  i + kMaxSumIntArrayElements doesn't overflow as i < n, and no int array
+ * is within kMaxSumIntArrayElements of the largest length.
+ */
+RegLocation Mir2Lir::LoadSumIntArrayRange(MIR* mir, int* r_ptr, int* r_end) {
+  int data_offset = mirror::Array::DataOffset(sizeof(int32_t)).Int32Value();
+  RegLocation rl_index = mir_graph_->GetSrc(mir, 2);
+  *r_ptr = AllocTemp();
+  LoadValueDirect(rl_index, *r_ptr);
+  RegLocation rl_array = LoadValue(mir_graph_->GetSrc(mir, 1), kCoreReg);
+  OpRegImm(kOpLsl, *r_ptr, 2);
+  OpRegReg(kOpAdd, *r_ptr, rl_array.low_reg);
+  OpRegImm(kOpAdd, *r_ptr, data_offset);
+  // i' may share the register of i, which is dead past here.
+  RegLocation rl_index_dest = mir_graph_->reg_location_[mir->ssa_rep->defs[1]];
+  RegLocation rl_index_result = EvalLoc(rl_index_dest, kCoreReg, true);
+  LoadValueDirect(rl_index, rl_index_result.low_reg);
+  OpRegImm(kOpAdd, rl_index_result.low_reg, kMaxSumIntArrayElements);
+  RegLocation rl_bound = LoadValue(mir_graph_->GetSrc(mir, 3), kCoreReg);
+  LIR* branch = OpCmpBranch(kCondLe, rl_index_result.low_reg, rl_bound.low_reg, NULL);
+  OpRegCopy(rl_index_result.low_reg, rl_bound.low_reg);
+  branch->target = NewLIR0(kPseudoTargetLabel);
+  FreeTemp(rl_bound.low_reg);
+  *r_end = AllocTemp();
+  OpRegCopy(*r_end, rl_index_result.low_reg);
+  OpRegImm(kOpLsl, *r_end, 2);
+  OpRegReg(kOpAdd, *r_end, rl_array.low_reg);
+  OpRegImm(kOpAdd, *r_end, data_offset);
+  StoreValue(rl_index_dest, rl_index_result);
+  FreeTemp(rl_array.low_reg);
+  FreeTemp(rl_index_result.low_reg);
+  RegLocation rl_result = EvalLoc(mir_graph_->GetDest(mir), kCoreReg, true);
+  LoadValueDirect(mir_graph_->GetSrc(mir, 0), rl_result.low_reg);
+  return rl_result;
+}
+
+/* Adds the ints from r_ptr up to r_end to r_sum, advancing r_ptr */
+void Mir2Lir::GenSumIntArrayElements(int r_sum, int r_ptr, int r_end) {
+  LIR* branch = OpCmpBranch(kCondEq, r_ptr, r_end, NULL);
+  LIR* loop = NewLIR0(kPseudoTargetLabel);
+  int t_reg = AllocTemp();
+  LoadWordDisp(r_ptr, 0, t_reg);
+  OpRegReg(kOpAdd, r_sum, t_reg);
+  OpRegImm(kOpAdd, r_ptr, sizeof(int32_t));
+  OpCmpBranch(kCondNe, r_ptr, r_end, loop);
+  branch->target = NewLIR0(kPseudoTargetLabel);
+  FreeTemp(t_reg);
+}
+
+void Mir2Lir::GenSumIntArray(MIR* mir) {
+  int r_ptr;
+  int r_end;
+  RegLocation rl_result = LoadSumIntArrayRange(mir, &r_ptr, &r_end);
+  GenSumIntArrayElements(rl_result.low_reg, r_ptr, r_end);
+  StoreValue(mir_graph_->GetDest(mir), rl_result);
+  FreeTemp(r_ptr);
+  FreeTemp(r_end);
+}
+
 }  // namespace art
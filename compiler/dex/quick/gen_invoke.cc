@@ -19,6 +19,7 @@
 #include "entrypoints/quick/quick_entrypoints.h"
 #include "invoke_type.h"
 #include "mirror/array.h"
+#include "mirror/class.h"
 #include "mirror/string.h"
 #include "mir_to_lir-inl.h"
 #include "x86/codegen_x86.h"
@@ -448,12 +449,18 @@ static int NextVCallInsn(CompilationUnit* cu, CallInfo* info,
       cg->LoadValueDirectFixed(rl_arg, cg->TargetReg(kArg1));
       break;
     }
-    case 1:  // Is "this" null? [use kArg1]
-      cg->GenNullCheck(info->args[0].s_reg_low, cg->TargetReg(kArg1), info->opt_flags);
+    case 1: {  // Is "this" null? [use kArg1]
+      bool implicit_null_check =
+          cg->GenAccessNullCheck(info->args[0].s_reg_low, cg->TargetReg(kArg1),
+                                 mirror::Object::ClassOffset().Int32Value(), info->opt_flags);
       // get this->klass_ [use kArg1, set kInvokeTgt]
       cg->LoadWordDisp(cg->TargetReg(kArg1), mirror::Object::ClassOffset().Int32Value(),
                        cg->TargetReg(kInvokeTgt));
+      if (implicit_null_check) {
+        cg->MarkImplicitNullCheck();
+      }
       break;
+    }
     case 2:  // Get this->klass_->vtable [usr kInvokeTgt, set kInvokeTgt]
       cg->LoadWordDisp(cg->TargetReg(kInvokeTgt), mirror::Class::VTableOffset().Int32Value(),
                        cg->TargetReg(kInvokeTgt));
@@ -477,6 +484,69 @@ static int NextVCallInsn(CompilationUnit* cu, CallInfo* info,
   return state + 1;
 }
 
+/*
+ * Emit the next instruction in a guarded direct call to a virtual method which no class
+ * overrode at compile time. The target Method* is loaded from the dex cache as for a direct
+ * call, the vtable is only used once the runtime has linked a class overriding the target.
+ * As in NextVCallInsn, "this" is loaded into kArg1 here rather than by LoadArgRegs.
+ */
+static int NextLeafVCallInsn(CompilationUnit* cu, CallInfo* info,
+                             int state, const MethodReference& target_method,
+                             uint32_t vtable_idx, uintptr_t unused, uintptr_t unused2,
+                             InvokeType unused3) {
+  Mir2Lir* cg = static_cast<Mir2Lir*>(cu->cg.get());
+  switch (state) {
+    case 0: {  // Get "this" [set kArg1]
+      RegLocation  rl_arg = info->args[0];
+      cg->LoadValueDirectFixed(rl_arg, cg->TargetReg(kArg1));
+      break;
+    }
+    case 1:  // Is "this" null? [use kArg1]
+      cg->GenNullCheck(info->args[0].s_reg_low, cg->TargetReg(kArg1), info->opt_flags);
+      // Get the current Method* [set kArg0]
+      cg->LoadCurrMethodDirect(cg->TargetReg(kArg0));
+      break;
+    case 2:  // Get method->dex_cache_resolved_methods_ [use and set kArg0]
+      cg->LoadWordDisp(cg->TargetReg(kArg0),
+        mirror::ArtMethod::DexCacheResolvedMethodsOffset().Int32Value(), cg->TargetReg(kArg0));
+      break;
+    case 3:  // Grab target method* [use and set kArg0]
+      CHECK_EQ(cu->dex_file, target_method.dex_file);
+      cg->LoadWordDisp(cg->TargetReg(kArg0),
+                       mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value() +
+                           (target_method.dex_method_index * 4),
+                       cg->TargetReg(kArg0));
+      break;
+    case 4: {  // Has the target been overridden since? [use kArg0 and kArg1, set kArg0]
+      cg->LoadWordDisp(cg->TargetReg(kArg0), mirror::ArtMethod::AccessFlagsOffset().Int32Value(),
+                       cg->TargetReg(kInvokeTgt));
+      // Shift the overridden flag into the sign bit, which needs no temp for a mask.
+      cg->OpRegRegImm(kOpLsl, cg->TargetReg(kInvokeTgt), cg->TargetReg(kInvokeTgt),
+                      31 - CTZ(kAccOverridden));
+      LIR* not_overridden = cg->OpCmpImmBranch(kCondGe, cg->TargetReg(kInvokeTgt), 0, NULL);
+      // Dispatch on this->klass_->vtable as NextVCallInsn does.
+      cg->LoadWordDisp(cg->TargetReg(kArg1), mirror::Object::ClassOffset().Int32Value(),
+                       cg->TargetReg(kInvokeTgt));
+      cg->LoadWordDisp(cg->TargetReg(kInvokeTgt), mirror::Class::VTableOffset().Int32Value(),
+                       cg->TargetReg(kInvokeTgt));
+      cg->LoadWordDisp(cg->TargetReg(kInvokeTgt), (vtable_idx * 4) +
+                       mirror::Array::DataOffset(sizeof(mirror::Object*)).Int32Value(),
+                       cg->TargetReg(kArg0));
+      not_overridden->target = cg->NewLIR0(kPseudoTargetLabel);
+      break;
+    }
+    case 5:  // Get the compiled code address [uses kArg0, sets kInvokeTgt]
+      DCHECK_NE(cu->instruction_set, kX86);
+      cg->LoadWordDisp(cg->TargetReg(kArg0),
+                       mirror::ArtMethod::GetEntryPointFromCompiledCodeOffset().Int32Value(),
+                       cg->TargetReg(kInvokeTgt));
+      break;
+    default:
+      return -1;
+  }
+  return state + 1;
+}
+
 /*
  * All invoke-interface calls bounce off of art_quick_invoke_interface_trampoline,
  * which will locate the target and continue on via a tail call.
@@ -1089,6 +1159,87 @@ bool Mir2Lir::GenInlinedIndexOf(CallInfo* info, bool zero_based) {
   return true;
 }
 
+/*
+ * Fast System.arraycopy for char and short arrays, copied with memcpy.  Null,
+ * mismatched or object arrays, bad bounds and copies within one array, which
+ * may overlap, bail to the standard library code.
+ */
+bool Mir2Lir::GenInlinedArrayCopy(CallInfo* info) {
+  if (cu_->instruction_set != kThumb2) {
+    // TODO - add Mips and X86 implementations
+    return false;
+  }
+  // The launch pad retries the call with the arguments from their home locations.
+  FlushAllRegs();
+  ClobberCalleeSave();
+  LockCallTemps();  // Using fixed registers
+  int reg_dst = TargetReg(kArg0);
+  int reg_src = TargetReg(kArg1);
+  int reg_length = TargetReg(kArg2);
+  int reg_pos = TargetReg(kArg3);
+  int reg_tmp = AllocTemp();
+
+  RegLocation rl_src = info->args[0];
+  RegLocation rl_src_pos = info->args[1];
+  RegLocation rl_dst = info->args[2];
+  RegLocation rl_dst_pos = info->args[3];
+  RegLocation rl_length = info->args[4];
+  int class_offset = mirror::Object::ClassOffset().Int32Value();
+  int length_offset = mirror::Array::LengthOffset().Int32Value();
+  int data_offset = mirror::Array::DataOffset(sizeof(uint16_t)).Int32Value();
+
+  LIR* launch_pad = RawLIR(0, kPseudoIntrinsicRetry, reinterpret_cast<uintptr_t>(info));
+  intrinsic_launchpads_.Insert(launch_pad);
+  LoadValueDirectFixed(rl_src, reg_src);
+  LoadValueDirectFixed(rl_dst, reg_dst);
+  OpCmpImmBranch(kCondEq, reg_src, 0, launch_pad);
+  OpCmpImmBranch(kCondEq, reg_dst, 0, launch_pad);
+  OpCmpBranch(kCondEq, reg_src, reg_dst, launch_pad);
+  // Both arrays must be of the same class, with a char or short component type.
+  LoadWordDisp(reg_src, class_offset, reg_pos);
+  LoadWordDisp(reg_dst, class_offset, reg_tmp);
+  OpCmpBranch(kCondNe, reg_pos, reg_tmp, launch_pad);
+  LoadWordDisp(reg_pos, mirror::Class::ComponentTypeOffset().Int32Value(), reg_pos);
+  OpCmpImmBranch(kCondEq, reg_pos, 0, launch_pad);
+  LoadWordDisp(reg_pos, mirror::Class::PrimitiveTypeOffset().Int32Value(), reg_pos);
+  COMPILE_ASSERT(Primitive::kPrimShort == Primitive::kPrimChar + 1, char_and_short_adjacent);
+  OpRegImm(kOpSub, reg_pos, Primitive::kPrimChar);
+  OpCmpImmBranch(kCondHi, reg_pos, 1, launch_pad);
+
+  LoadValueDirectFixed(rl_length, reg_length);
+  OpCmpImmBranch(kCondLt, reg_length, 0, launch_pad);
+  // Check the source range and point reg_src at its start.
+  LoadValueDirectFixed(rl_src_pos, reg_pos);
+  OpCmpImmBranch(kCondLt, reg_pos, 0, launch_pad);
+  LoadWordDisp(reg_src, length_offset, reg_tmp);
+  OpRegReg(kOpSub, reg_tmp, reg_length);
+  OpCmpBranch(kCondGt, reg_pos, reg_tmp, launch_pad);
+  OpRegRegImm(kOpLsl, reg_pos, reg_pos, 1);
+  OpRegReg(kOpAdd, reg_src, reg_pos);
+  OpRegImm(kOpAdd, reg_src, data_offset);
+  // Likewise for the destination.
+  LoadValueDirectFixed(rl_dst_pos, reg_pos);
+  OpCmpImmBranch(kCondLt, reg_pos, 0, launch_pad);
+  LoadWordDisp(reg_dst, length_offset, reg_tmp);
+  OpRegReg(kOpSub, reg_tmp, reg_length);
+  OpCmpBranch(kCondGt, reg_pos, reg_tmp, launch_pad);
+  OpRegRegImm(kOpLsl, reg_pos, reg_pos, 1);
+  OpRegReg(kOpAdd, reg_dst, reg_pos);
+  OpRegImm(kOpAdd, reg_dst, data_offset);
+  FreeTemp(reg_tmp);
+
+  OpRegRegImm(kOpLsl, reg_length, reg_length, 1);
+  // NOTE: not a safepoint
+  int r_tgt = LoadHelper(QUICK_ENTRYPOINT_OFFSET(pMemcpy));
+  OpReg(kOpBlx, r_tgt);
+  LIR* resume_tgt = NewLIR0(kPseudoTargetLabel);
+  launch_pad->operands[2] = reinterpret_cast<uintptr_t>(resume_tgt);
+  FreeCallTemps();
+  // Record that we've already inlined
+  info->opt_flags |= MIR_INLINED;
+  return true;
+}
+
 /* Fast string.compareTo(Ljava/lang/string;)I. */
 bool Mir2Lir::GenInlinedStringCompareTo(CallInfo* info) {
   if (cu_->instruction_set == kMips) {
@@ -1126,6 +1277,69 @@ bool Mir2Lir::GenInlinedStringCompareTo(CallInfo* info) {
   return true;
 }
 
+/*
+ * Fast String.equals(Ljava/lang/Object;)Z.  A null comp or one that isn't a
+ * String is handled by the helper.
+ */
+bool Mir2Lir::GenInlinedStringEquals(CallInfo* info) {
+  if (cu_->instruction_set == kMips) {
+    // TODO - add Mips implementation
+    return false;
+  }
+  ClobberCalleeSave();
+  LockCallTemps();  // Using fixed registers
+  int reg_this = TargetReg(kArg0);
+  int reg_cmp = TargetReg(kArg1);
+
+  RegLocation rl_this = info->args[0];
+  RegLocation rl_cmp = info->args[1];
+  LoadValueDirectFixed(rl_this, reg_this);
+  LoadValueDirectFixed(rl_cmp, reg_cmp);
+  int r_tgt = (cu_->instruction_set != kX86) ?
+      LoadHelper(QUICK_ENTRYPOINT_OFFSET(pStringEquals)) : 0;
+  GenNullCheck(rl_this.s_reg_low, reg_this, info->opt_flags);
+  // NOTE: not a safepoint
+  if (cu_->instruction_set != kX86) {
+    OpReg(kOpBlx, r_tgt);
+  } else {
+    OpThreadMem(kOpBlx, QUICK_ENTRYPOINT_OFFSET(pStringEquals));
+  }
+  // Record that we've already inlined & null checked
+  info->opt_flags |= (MIR_INLINED | MIR_IGNORE_NULL_CHECK);
+  RegLocation rl_return = GetReturn(false);
+  RegLocation rl_dest = InlineTarget(info);
+  StoreValue(rl_dest, rl_return);
+  return true;
+}
+
+/*
+ * Fast String.hashCode()I.  Returns the cached hash code, bails to the
+ * standard library code to compute it when it is still 0.
+ */
+bool Mir2Lir::GenInlinedStringHashCode(CallInfo* info) {
+  ClobberCalleeSave();  // The retry calls out
+  LockCallTemps();  // Using fixed registers
+  int reg_ptr = TargetReg(kArg1);
+  int reg_hash = TargetReg(kRet0);
+
+  RegLocation rl_obj = info->args[0];
+  LoadValueDirectFixed(rl_obj, reg_ptr);
+  GenNullCheck(rl_obj.s_reg_low, reg_ptr, info->opt_flags);
+  LoadWordDisp(reg_ptr, mirror::String::HashCodeOffset().Int32Value(), reg_hash);
+  LIR* launch_pad = RawLIR(0, kPseudoIntrinsicRetry, reinterpret_cast<uintptr_t>(info));
+  intrinsic_launchpads_.Insert(launch_pad);
+  OpCmpImmBranch(kCondEq, reg_hash, 0, launch_pad);
+  // The call's result arrives in the same register, both paths store it below
+  LIR* resume_tgt = NewLIR0(kPseudoTargetLabel);
+  launch_pad->operands[2] = reinterpret_cast<uintptr_t>(resume_tgt);
+  // Record that we've already inlined & null checked
+  info->opt_flags |= (MIR_INLINED | MIR_IGNORE_NULL_CHECK);
+  RegLocation rl_return = GetReturn(false);
+  RegLocation rl_dest = InlineTarget(info);
+  StoreValue(rl_dest, rl_return);
+  return true;
+}
+
 bool Mir2Lir::GenInlinedCurrentThread(CallInfo* info) {
   RegLocation rl_dest = InlineTarget(info);
   RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
@@ -1140,6 +1354,46 @@ bool Mir2Lir::GenInlinedCurrentThread(CallInfo* info) {
   return true;
 }
 
+bool Mir2Lir::GenInlinedVMSupportsCS8(CallInfo* info) {
+  // Must agree with QuasiAtomic::LongAtomicsUseMutexes for the target.
+  RegLocation rl_dest = InlineTarget(info);
+  RegLocation rl_result = EvalLoc(rl_dest, kCoreReg, true);
+  LoadConstant(rl_result.low_reg, (cu_->instruction_set == kMips) ? 0 : 1);
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+/*
+ * Fast System.identityHashCode, reading the hash code of a hashed thin lock
+ * word.  Null objects, unhashed words and inflated locks bail to the native
+ * method, which generates the hash code if needed.
+ */
+bool Mir2Lir::GenInlinedIdentityHashCode(CallInfo* info) {
+  // The launch pad retries the call with the argument from its home location.
+  FlushAllRegs();
+  LockCallTemps();  // Using fixed registers
+  int reg_obj = TargetReg(kArg1);
+  int reg_shape = TargetReg(kArg2);
+  int reg_result = TargetReg(kRet0);
+  LIR* launch_pad = RawLIR(0, kPseudoIntrinsicRetry, reinterpret_cast<uintptr_t>(info));
+  intrinsic_launchpads_.Insert(launch_pad);
+  LoadValueDirectFixed(info->args[0], reg_obj);
+  OpCmpImmBranch(kCondEq, reg_obj, 0, launch_pad);
+  LoadWordDisp(reg_obj, mirror::Object::MonitorOffset().Int32Value(), reg_result);
+  OpRegRegImm(kOpAnd, reg_shape, reg_result,
+              (LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT) | LW_SHAPE_FAT);
+  OpCmpImmBranch(kCondNe, reg_shape, LW_HASH_STATE_HASHED << LW_HASH_STATE_SHIFT, launch_pad);
+  OpRegImm(kOpLsr, reg_result, LW_HASH_CODE_SHIFT);
+  LIR* resume_tgt = NewLIR0(kPseudoTargetLabel);
+  launch_pad->operands[2] = reinterpret_cast<uintptr_t>(resume_tgt);
+  FreeCallTemps();
+  // Record that we've already inlined
+  info->opt_flags |= MIR_INLINED;
+  RegLocation rl_return = GetReturn(false);
+  StoreValue(InlineTarget(info), rl_return);
+  return true;
+}
+
 bool Mir2Lir::GenInlinedUnsafeGet(CallInfo* info,
                                   bool is_long, bool is_volatile) {
   if (cu_->instruction_set == kMips) {
@@ -1269,23 +1523,43 @@ bool Mir2Lir::GenIntrinsic(CallInfo* info) {
     if (tgt_method == "int java.lang.String.compareTo(java.lang.String)") {
       return GenInlinedStringCompareTo(info);
     }
-    if (tgt_method == "boolean java.lang.String.is_empty()") {
+    if (tgt_method == "boolean java.lang.String.equals(java.lang.Object)") {
+      return GenInlinedStringEquals(info);
+    }
+    if (tgt_method == "int java.lang.String.hashCode()") {
+      return GenInlinedStringHashCode(info);
+    }
+    if (tgt_method == "boolean java.lang.String.isEmpty()") {
       return GenInlinedStringIsEmptyOrLength(info, true /* is_empty */);
     }
-    if (tgt_method == "int java.lang.String.index_of(int, int)") {
+    if (tgt_method == "int java.lang.String.indexOf(int, int)") {
       return GenInlinedIndexOf(info, false /* base 0 */);
     }
-    if (tgt_method == "int java.lang.String.index_of(int)") {
+    if (tgt_method == "int java.lang.String.indexOf(int)") {
       return GenInlinedIndexOf(info, true /* base 0 */);
     }
     if (tgt_method == "int java.lang.String.length()") {
       return GenInlinedStringIsEmptyOrLength(info, false /* is_empty */);
     }
+  } else if (tgt_methods_declaring_class.starts_with("Ljava/lang/System;")) {
+    std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
+    if (tgt_method ==
+        "void java.lang.System.arraycopy(java.lang.Object, int, java.lang.Object, int, int)") {
+      return GenInlinedArrayCopy(info);
+    }
+    if (tgt_method == "int java.lang.System.identityHashCode(java.lang.Object)") {
+      return GenInlinedIdentityHashCode(info);
+    }
   } else if (tgt_methods_declaring_class.starts_with("Ljava/lang/Thread;")) {
     std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
     if (tgt_method == "java.lang.Thread java.lang.Thread.currentThread()") {
       return GenInlinedCurrentThread(info);
     }
+  } else if (tgt_methods_declaring_class.starts_with("Ljava/util/concurrent/atomic/AtomicLong;")) {
+    std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
+    if (tgt_method == "boolean java.util.concurrent.atomic.AtomicLong.VMSupportsCS8()") {
+      return GenInlinedVMSupportsCS8(info);
+    }
   } else if (tgt_methods_declaring_class.starts_with("Lsun/misc/Unsafe;")) {
     std::string tgt_method(PrettyMethod(info->index, *cu_->dex_file));
     if (tgt_method == "boolean sun.misc.Unsafe.compareAndSwapInt(java.lang.Object, long, int, int)") {
@@ -1294,6 +1568,9 @@ bool Mir2Lir::GenIntrinsic(CallInfo* info) {
     if (tgt_method == "boolean sun.misc.Unsafe.compareAndSwapObject(java.lang.Object, long, java.lang.Object, java.lang.Object)") {
       return GenInlinedCas32(info, true);
     }
+    if (tgt_method == "boolean sun.misc.Unsafe.compareAndSwapLong(java.lang.Object, long, long, long)") {
+      return GenInlinedCas64(info);
+    }
     if (tgt_method == "int sun.misc.Unsafe.getInt(java.lang.Object, long)") {
       return GenInlinedUnsafeGet(info, false /* is_long */, false /* is_volatile */);
     }
@@ -1399,7 +1676,14 @@ void Mir2Lir::GenInvoke(CallInfo* info) {
     skip_this = false;
   } else {
     DCHECK_EQ(info->type, kVirtual);
-    next_call_insn = fast_path ? NextVCallInsn : NextVCallInsnSP;
+    // Call targets nothing overrides directly. x86 has no call temp left for the guard, its
+    // kInvokeTgt is kArg0.
+    if (fast_path && cu_->instruction_set != kX86 &&
+        cu_->compiler_driver->IsLeafMethod(cUnit, target_method)) {
+      next_call_insn = NextLeafVCallInsn;
+    } else {
+      next_call_insn = fast_path ? NextVCallInsn : NextVCallInsnSP;
+    }
     skip_this = fast_path;
   }
   if (!info->is_range) {
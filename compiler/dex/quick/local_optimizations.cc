@@ -28,6 +28,7 @@ namespace art {
 #define MAX_HOIST_DISTANCE 20
 #define LDLD_DISTANCE 4
 #define LD_LATENCY 2
+#define MAX_SCHEDULE_DISTANCE 64
 
 static bool IsDalvikRegisterClobbered(LIR* lir1, LIR* lir2) {
   int reg1Lo = DECODE_ALIAS_INFO_REG(lir1->alias_info);
@@ -38,6 +39,31 @@ static bool IsDalvikRegisterClobbered(LIR* lir1, LIR* lir2) {
   return (reg1Lo == reg2Lo) || (reg1Lo == reg2Hi) || (reg1Hi == reg2Lo);
 }
 
+/*
+ * Check whether check_lir, which follows this_lir, has to stay after it:
+ * they have a register or ccode dependency, or one of them writes memory
+ * the other one may access.
+ */
+static bool IsScheduleDependent(LIR* this_lir, LIR* check_lir) {
+  if (CHECK_REG_DEP(check_lir->use_mask & ~ENCODE_MEM, check_lir->def_mask & ~ENCODE_MEM,
+                    this_lir)) {
+    return true;
+  }
+  uint64_t this_mem_mask = (this_lir->use_mask | this_lir->def_mask) & ENCODE_MEM;
+  uint64_t check_mem_mask = (check_lir->use_mask | check_lir->def_mask) & ENCODE_MEM;
+  uint64_t alias_condition = ((this_lir->def_mask & check_mem_mask) |
+                              (check_lir->def_mask & this_mem_mask)) & ENCODE_MEM;
+  if (alias_condition == 0) {
+    return false;
+  }
+  /* We can fully disambiguate Dalvik references */
+  if (this_mem_mask == ENCODE_DALVIK_REG && check_mem_mask == ENCODE_DALVIK_REG) {
+    return (check_lir->alias_info == this_lir->alias_info) ||
+        IsDalvikRegisterClobbered(this_lir, check_lir);
+  }
+  return true;
+}
+
 /* Convert a more expensive instruction (ie load) into a move */
 void Mir2Lir::ConvertMemOpIntoMove(LIR* orig_lir, int dest, int src) {
   /* Insert a move to replace the load */
@@ -291,10 +317,10 @@ void Mir2Lir::ApplyLoadHoisting(LIR* head_lir, LIR* tail_lir) {
     }
 
     uint64_t target_flags = GetTargetInstFlags(this_lir->opcode);
-    /* Skip non-interesting instructions */
+    /* Skip non-interesting instructions, and implicit null checks which must stay at their pc */
     if ((this_lir->flags.is_nop == true) ||
         ((target_flags & (REG_DEF0 | REG_DEF1)) == (REG_DEF0 | REG_DEF1)) ||
-        !(target_flags & IS_LOAD)) {
+        !(target_flags & IS_LOAD) || (this_lir->def_mask == ENCODE_ALL)) {
       continue;
     }
 
@@ -459,6 +485,149 @@ void Mir2Lir::ApplyLoadHoisting(LIR* head_lir, LIR* tail_lir) {
   }
 }
 
+/*
+ * List schedule a run of instructions that are free to move past each
+ * other bar their dependencies. A single issue core is modelled: each
+ * step issues the instruction that can start the soonest, preferring the
+ * one heading the longest latency path to the end of the run and then
+ * the original order.
+ */
+void Mir2Lir::ScheduleRegion(LIR** region, int count) {
+  if (count < 2) {
+    return;
+  }
+  DCHECK_LE(count, MAX_SCHEDULE_DISTANCE);
+  uint64_t preds[MAX_SCHEDULE_DISTANCE];
+  uint64_t succs[MAX_SCHEDULE_DISTANCE];
+  int latency[MAX_SCHEDULE_DISTANCE];
+  int height[MAX_SCHEDULE_DISTANCE];
+  int ready_cycle[MAX_SCHEDULE_DISTANCE];
+  for (int i = 0; i < count; i++) {
+    preds[i] = succs[i] = 0;
+    ready_cycle[i] = 0;
+    /* Dead instructions don't issue and their resource masks are stale */
+    latency[i] = region[i]->flags.is_nop ? 0 : GetInstructionLatency(region[i]);
+    if (region[i]->flags.is_nop) {
+      continue;
+    }
+    for (int j = 0; j < i; j++) {
+      if (!region[j]->flags.is_nop && IsScheduleDependent(region[j], region[i])) {
+        preds[i] |= 1ULL << j;
+        succs[j] |= 1ULL << i;
+      }
+    }
+  }
+
+  /* Only a use of a register the predecessor defines waits for its result */
+#define EDGE_LATENCY(from, to) \
+  (((region[from]->def_mask & region[to]->use_mask & ~ENCODE_MEM) != 0) ? latency[from] : 1)
+
+  for (int i = count - 1; i >= 0; i--) {
+    height[i] = latency[i];
+    for (int j = i + 1; j < count; j++) {
+      if (succs[i] & (1ULL << j)) {
+        height[i] = std::max(height[i], EDGE_LATENCY(i, j) + height[j]);
+      }
+    }
+  }
+
+  LIR* order[MAX_SCHEDULE_DISTANCE];
+  uint64_t scheduled = 0;
+  bool reordered = false;
+  int cycle = 0;
+  for (int n = 0; n < count; n++) {
+    int best = -1;
+    int best_stall = 0;
+    for (int i = 0; i < count; i++) {
+      if ((scheduled & (1ULL << i)) || (preds[i] & ~scheduled)) {
+        continue;
+      }
+      int stall = std::max(ready_cycle[i] - cycle, 0);
+      if (best == -1 || stall < best_stall ||
+          (stall == best_stall && height[i] > height[best])) {
+        best = i;
+        best_stall = stall;
+      }
+    }
+    DCHECK_NE(best, -1);
+    order[n] = region[best];
+    reordered |= (best != n);
+    scheduled |= 1ULL << best;
+    cycle += best_stall;
+    for (int j = best + 1; j < count; j++) {
+      if (succs[best] & (1ULL << j)) {
+        ready_cycle[j] = std::max(ready_cycle[j], cycle + EDGE_LATENCY(best, j));
+      }
+    }
+    if (latency[best] != 0) {
+      cycle++;
+    }
+  }
+#undef EDGE_LATENCY
+
+  if (!reordered) {
+    return;
+  }
+  LIR* prev_lir = PREV_LIR(region[0]);
+  LIR* next_lir = NEXT_LIR(region[count - 1]);
+  for (int n = 0; n < count; n++) {
+    prev_lir->next = order[n];
+    order[n]->prev = prev_lir;
+    prev_lir = order[n];
+  }
+  prev_lir->next = next_lir;
+  next_lir->prev = prev_lir;
+}
+
+/*
+ * Reorder the instructions of the superblock to hide the latencies of
+ * loads, multiplies and floating point operations. Labels, branches,
+ * barriers and IT blocks stay in place and split the superblock into
+ * runs that are scheduled independently.
+ */
+void Mir2Lir::ApplyListScheduling(LIR* head_lir, LIR* tail_lir) {
+  LIR* region[MAX_SCHEDULE_DISTANCE];
+  int count = 0;
+  int it_insns = 0;
+
+  if (head_lir == tail_lir) {
+    return;
+  }
+
+  LIR* next_lir;
+  for (LIR* this_lir = NEXT_LIR(head_lir); this_lir != tail_lir; this_lir = next_lir) {
+    /* Scheduling the run may move this_lir */
+    next_lir = NEXT_LIR(this_lir);
+    bool fixed;
+    if (it_insns > 0) {
+      /* The instructions of an IT block are predicated on it */
+      it_insns--;
+      fixed = true;
+    } else if (is_pseudo_opcode(this_lir->opcode)) {
+      fixed = true;
+    } else {
+      uint64_t target_flags = GetTargetInstFlags(this_lir->opcode);
+      fixed = (target_flags & IS_BRANCH) || (this_lir->def_mask == ENCODE_ALL) ||
+          (this_lir->use_mask == ENCODE_ALL);
+      if (target_flags & IS_IT) {
+        /* The lowest set bit of the mask ends the block */
+        it_insns = 4 - CTZ(this_lir->operands[1]);
+      }
+    }
+    if (fixed) {
+      ScheduleRegion(region, count);
+      count = 0;
+      continue;
+    }
+    region[count++] = this_lir;
+    if (count == MAX_SCHEDULE_DISTANCE) {
+      ScheduleRegion(region, count);
+      count = 0;
+    }
+  }
+  ScheduleRegion(region, count);
+}
+
 void Mir2Lir::ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir) {
   if (!(cu_->disable_opt & (1 << kLoadStoreElimination))) {
     ApplyLoadStoreElimination(head_lir, tail_lir);
@@ -466,6 +635,9 @@ void Mir2Lir::ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir) {
   if (!(cu_->disable_opt & (1 << kLoadHoisting))) {
     ApplyLoadHoisting(head_lir, tail_lir);
   }
+  if (!(cu_->disable_opt & (1 << kListScheduling))) {
+    ApplyListScheduling(head_lir, tail_lir);
+  }
 }
 
 /*
@@ -507,203 +507,194 @@ void MipsMir2Lir::ConvertShortToLongBranch(LIR* lir) {
 }
 
 /*
- * Assemble the LIR into binary instruction format.  Note that we may
- * discover that pc-relative displacements may not fit the selected
- * instruction.  In those cases we will try to substitute a new code
- * sequence or request that the trace be shortened and retried.
+ * Fix up the pc-relative operands of lir.  Note that we may discover that
+ * pc-relative displacements may not fit the selected instruction.  In those
+ * cases we substitute a new code sequence, and AssembleLIR recomputes the
+ * offsets of the code that follows and visits the fixups again.
  */
-AssemblerStatus MipsMir2Lir::AssembleInstructions(uintptr_t start_addr) {
-  LIR *lir;
+AssemblerStatus MipsMir2Lir::FixupInstruction(LIR* lir, uintptr_t start_addr) {
   AssemblerStatus res = kSuccess;  // Assume success
-
-  for (lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
-    if (lir->opcode < 0) {
-      continue;
+  if (lir->opcode == kMipsDelta) {
+    /*
+     * The "Delta" pseudo-ops load the difference between
+     * two pc-relative locations into a the target register
+     * found in operands[0].  The delta is determined by
+     * (label2 - label1), where label1 is a standard
+     * kPseudoTargetLabel and is stored in operands[2].
+     * If operands[3] is null, then label2 is a kPseudoTargetLabel
+     * and is found in lir->target.  If operands[3] is non-NULL,
+     * then it is a Switch/Data table.
+     */
+    int offset1 = (reinterpret_cast<LIR*>(lir->operands[2]))->offset;
+    SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
+    int offset2 = tab_rec ? tab_rec->offset : lir->target->offset;
+    int delta = offset2 - offset1;
+    if ((delta & 0xffff) == delta && ((delta & 0x8000) == 0)) {
+      // Fits
+      lir->operands[1] = delta;
+    } else {
+      // Doesn't fit - must expand to kMipsDelta[Hi|Lo] pair
+      LIR *new_delta_hi =
+          RawLIR(lir->dalvik_offset, kMipsDeltaHi,
+                 lir->operands[0], 0, lir->operands[2],
+                 lir->operands[3], 0, lir->target);
+      InsertLIRBefore(lir, new_delta_hi);
+      LIR *new_delta_lo =
+          RawLIR(lir->dalvik_offset, kMipsDeltaLo,
+                 lir->operands[0], 0, lir->operands[2],
+                 lir->operands[3], 0, lir->target);
+      InsertLIRBefore(lir, new_delta_lo);
+      LIR *new_addu =
+          RawLIR(lir->dalvik_offset, kMipsAddu,
+                 lir->operands[0], lir->operands[0], r_RA);
+      InsertLIRBefore(lir, new_addu);
+      lir->flags.is_nop = true;
+      res = kRetryAll;
+    }
+  } else if (lir->opcode == kMipsDeltaLo) {
+    int offset1 = (reinterpret_cast<LIR*>(lir->operands[2]))->offset;
+    SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
+    int offset2 = tab_rec ? tab_rec->offset : lir->target->offset;
+    int delta = offset2 - offset1;
+    lir->operands[1] = delta & 0xffff;
+  } else if (lir->opcode == kMipsDeltaHi) {
+    int offset1 = (reinterpret_cast<LIR*>(lir->operands[2]))->offset;
+    SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
+    int offset2 = tab_rec ? tab_rec->offset : lir->target->offset;
+    int delta = offset2 - offset1;
+    lir->operands[1] = (delta >> 16) & 0xffff;
+  } else if (lir->opcode == kMipsB || lir->opcode == kMipsBal) {
+    LIR *target_lir = lir->target;
+    uintptr_t pc = lir->offset + 4;
+    uintptr_t target = target_lir->offset;
+    int delta = target - pc;
+    if (delta & 0x3) {
+      LOG(FATAL) << "PC-rel offset not multiple of 4: " << delta;
+    }
+    if (delta > 131068 || delta < -131069) {
+      res = kRetryAll;
+      ConvertShortToLongBranch(lir);
+    } else {
+      lir->operands[0] = delta >> 2;
+    }
+  } else if (lir->opcode >= kMipsBeqz && lir->opcode <= kMipsBnez) {
+    LIR *target_lir = lir->target;
+    uintptr_t pc = lir->offset + 4;
+    uintptr_t target = target_lir->offset;
+    int delta = target - pc;
+    if (delta & 0x3) {
+      LOG(FATAL) << "PC-rel offset not multiple of 4: " << delta;
     }
+    if (delta > 131068 || delta < -131069) {
+      res = kRetryAll;
+      ConvertShortToLongBranch(lir);
+    } else {
+      lir->operands[1] = delta >> 2;
+    }
+  } else if (lir->opcode == kMipsBeq || lir->opcode == kMipsBne) {
+    LIR *target_lir = lir->target;
+    uintptr_t pc = lir->offset + 4;
+    uintptr_t target = target_lir->offset;
+    int delta = target - pc;
+    if (delta & 0x3) {
+      LOG(FATAL) << "PC-rel offset not multiple of 4: " << delta;
+    }
+    if (delta > 131068 || delta < -131069) {
+      res = kRetryAll;
+      ConvertShortToLongBranch(lir);
+    } else {
+      lir->operands[2] = delta >> 2;
+    }
+  } else if (lir->opcode == kMipsJal) {
+    uintptr_t cur_pc = (start_addr + lir->offset + 4) & ~3;
+    uintptr_t target = lir->operands[0];
+    /* ensure PC-region branch can be used */
+    DCHECK_EQ((cur_pc & 0xF0000000), (target & 0xF0000000));
+    if (target & 0x3) {
+      LOG(FATAL) << "Jump target not multiple of 4: " << target;
+    }
+    lir->operands[0] =  target >> 2;
+  } else if (lir->opcode == kMipsLahi) { /* ld address hi (via lui) */
+    LIR *target_lir = lir->target;
+    uintptr_t target = start_addr + target_lir->offset;
+    lir->operands[1] = target >> 16;
+  } else if (lir->opcode == kMipsLalo) { /* ld address lo (via ori) */
+    LIR *target_lir = lir->target;
+    uintptr_t target = start_addr + target_lir->offset;
+    lir->operands[2] = lir->operands[2] + target;
+  }
+  return res;
+}
 
+/*
+ * Assemble the LIR into binary instruction format.  Its pc-relative
+ * displacements have been fixed up by FixupInstruction.
+ */
+void MipsMir2Lir::EncodeInstruction(LIR* lir) {
+  if (lir->opcode < 0) {
+    return;
+  }
 
-    if (lir->flags.is_nop) {
-      continue;
-    }
+  if (lir->flags.is_nop) {
+    return;
+  }
 
-    if (lir->flags.pcRelFixup) {
-      if (lir->opcode == kMipsDelta) {
-        /*
-         * The "Delta" pseudo-ops load the difference between
-         * two pc-relative locations into a the target register
-         * found in operands[0].  The delta is determined by
-         * (label2 - label1), where label1 is a standard
-         * kPseudoTargetLabel and is stored in operands[2].
-         * If operands[3] is null, then label2 is a kPseudoTargetLabel
-         * and is found in lir->target.  If operands[3] is non-NULL,
-         * then it is a Switch/Data table.
-         */
-        int offset1 = (reinterpret_cast<LIR*>(lir->operands[2]))->offset;
-        SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
-        int offset2 = tab_rec ? tab_rec->offset : lir->target->offset;
-        int delta = offset2 - offset1;
-        if ((delta & 0xffff) == delta && ((delta & 0x8000) == 0)) {
-          // Fits
-          lir->operands[1] = delta;
-        } else {
-          // Doesn't fit - must expand to kMipsDelta[Hi|Lo] pair
-          LIR *new_delta_hi =
-              RawLIR(lir->dalvik_offset, kMipsDeltaHi,
-                     lir->operands[0], 0, lir->operands[2],
-                     lir->operands[3], 0, lir->target);
-          InsertLIRBefore(lir, new_delta_hi);
-          LIR *new_delta_lo =
-              RawLIR(lir->dalvik_offset, kMipsDeltaLo,
-                     lir->operands[0], 0, lir->operands[2],
-                     lir->operands[3], 0, lir->target);
-          InsertLIRBefore(lir, new_delta_lo);
-          LIR *new_addu =
-              RawLIR(lir->dalvik_offset, kMipsAddu,
-                     lir->operands[0], lir->operands[0], r_RA);
-          InsertLIRBefore(lir, new_addu);
-          lir->flags.is_nop = true;
-          res = kRetryAll;
-        }
-      } else if (lir->opcode == kMipsDeltaLo) {
-        int offset1 = (reinterpret_cast<LIR*>(lir->operands[2]))->offset;
-        SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
-        int offset2 = tab_rec ? tab_rec->offset : lir->target->offset;
-        int delta = offset2 - offset1;
-        lir->operands[1] = delta & 0xffff;
-      } else if (lir->opcode == kMipsDeltaHi) {
-        int offset1 = (reinterpret_cast<LIR*>(lir->operands[2]))->offset;
-        SwitchTable *tab_rec = reinterpret_cast<SwitchTable*>(lir->operands[3]);
-        int offset2 = tab_rec ? tab_rec->offset : lir->target->offset;
-        int delta = offset2 - offset1;
-        lir->operands[1] = (delta >> 16) & 0xffff;
-      } else if (lir->opcode == kMipsB || lir->opcode == kMipsBal) {
-        LIR *target_lir = lir->target;
-        uintptr_t pc = lir->offset + 4;
-        uintptr_t target = target_lir->offset;
-        int delta = target - pc;
-        if (delta & 0x3) {
-          LOG(FATAL) << "PC-rel offset not multiple of 4: " << delta;
-        }
-        if (delta > 131068 || delta < -131069) {
-          res = kRetryAll;
-          ConvertShortToLongBranch(lir);
+  const MipsEncodingMap *encoder = &EncodingMap[lir->opcode];
+  uint32_t bits = encoder->skeleton;
+  int i;
+  for (i = 0; i < 4; i++) {
+    uint32_t operand;
+    uint32_t value;
+    operand = lir->operands[i];
+    switch (encoder->field_loc[i].kind) {
+      case kFmtUnused:
+        break;
+      case kFmtBitBlt:
+        if (encoder->field_loc[i].start == 0 && encoder->field_loc[i].end == 31) {
+          value = operand;
         } else {
-          lir->operands[0] = delta >> 2;
-        }
-      } else if (lir->opcode >= kMipsBeqz && lir->opcode <= kMipsBnez) {
-        LIR *target_lir = lir->target;
-        uintptr_t pc = lir->offset + 4;
-        uintptr_t target = target_lir->offset;
-        int delta = target - pc;
-        if (delta & 0x3) {
-          LOG(FATAL) << "PC-rel offset not multiple of 4: " << delta;
-        }
-        if (delta > 131068 || delta < -131069) {
-          res = kRetryAll;
-          ConvertShortToLongBranch(lir);
-        } else {
-          lir->operands[1] = delta >> 2;
-        }
-      } else if (lir->opcode == kMipsBeq || lir->opcode == kMipsBne) {
-        LIR *target_lir = lir->target;
-        uintptr_t pc = lir->offset + 4;
-        uintptr_t target = target_lir->offset;
-        int delta = target - pc;
-        if (delta & 0x3) {
-          LOG(FATAL) << "PC-rel offset not multiple of 4: " << delta;
-        }
-        if (delta > 131068 || delta < -131069) {
-          res = kRetryAll;
-          ConvertShortToLongBranch(lir);
-        } else {
-          lir->operands[2] = delta >> 2;
-        }
-      } else if (lir->opcode == kMipsJal) {
-        uintptr_t cur_pc = (start_addr + lir->offset + 4) & ~3;
-        uintptr_t target = lir->operands[0];
-        /* ensure PC-region branch can be used */
-        DCHECK_EQ((cur_pc & 0xF0000000), (target & 0xF0000000));
-        if (target & 0x3) {
-          LOG(FATAL) << "Jump target not multiple of 4: " << target;
-        }
-        lir->operands[0] =  target >> 2;
-      } else if (lir->opcode == kMipsLahi) { /* ld address hi (via lui) */
-        LIR *target_lir = lir->target;
-        uintptr_t target = start_addr + target_lir->offset;
-        lir->operands[1] = target >> 16;
-      } else if (lir->opcode == kMipsLalo) { /* ld address lo (via ori) */
-        LIR *target_lir = lir->target;
-        uintptr_t target = start_addr + target_lir->offset;
-        lir->operands[2] = lir->operands[2] + target;
-      }
-    }
-
-    /*
-     * If one of the pc-relative instructions expanded we'll have
-     * to make another pass.  Don't bother to fully assemble the
-     * instruction.
-     */
-    if (res != kSuccess) {
-      continue;
-    }
-    const MipsEncodingMap *encoder = &EncodingMap[lir->opcode];
-    uint32_t bits = encoder->skeleton;
-    int i;
-    for (i = 0; i < 4; i++) {
-      uint32_t operand;
-      uint32_t value;
-      operand = lir->operands[i];
-      switch (encoder->field_loc[i].kind) {
-        case kFmtUnused:
-          break;
-        case kFmtBitBlt:
-          if (encoder->field_loc[i].start == 0 && encoder->field_loc[i].end == 31) {
-            value = operand;
-          } else {
-            value = (operand << encoder->field_loc[i].start) &
-                ((1 << (encoder->field_loc[i].end + 1)) - 1);
-          }
-          bits |= value;
-          break;
-        case kFmtBlt5_2:
-          value = (operand & 0x1f);
-          bits |= (value << encoder->field_loc[i].start);
-          bits |= (value << encoder->field_loc[i].end);
-          break;
-        case kFmtDfp: {
-          DCHECK(MIPS_DOUBLEREG(operand));
-          DCHECK_EQ((operand & 0x1), 0U);
-          value = ((operand & MIPS_FP_REG_MASK) << encoder->field_loc[i].start) &
+          value = (operand << encoder->field_loc[i].start) &
               ((1 << (encoder->field_loc[i].end + 1)) - 1);
-          bits |= value;
-          break;
         }
-        case kFmtSfp:
-          DCHECK(MIPS_SINGLEREG(operand));
-          value = ((operand & MIPS_FP_REG_MASK) << encoder->field_loc[i].start) &
-              ((1 << (encoder->field_loc[i].end + 1)) - 1);
-          bits |= value;
-          break;
-        default:
-          LOG(FATAL) << "Bad encoder format: " << encoder->field_loc[i].kind;
+        bits |= value;
+        break;
+      case kFmtBlt5_2:
+        value = (operand & 0x1f);
+        bits |= (value << encoder->field_loc[i].start);
+        bits |= (value << encoder->field_loc[i].end);
+        break;
+      case kFmtDfp: {
+        DCHECK(MIPS_DOUBLEREG(operand));
+        DCHECK_EQ((operand & 0x1), 0U);
+        value = ((operand & MIPS_FP_REG_MASK) << encoder->field_loc[i].start) &
+            ((1 << (encoder->field_loc[i].end + 1)) - 1);
+        bits |= value;
+        break;
       }
+      case kFmtSfp:
+        DCHECK(MIPS_SINGLEREG(operand));
+        value = ((operand & MIPS_FP_REG_MASK) << encoder->field_loc[i].start) &
+            ((1 << (encoder->field_loc[i].end + 1)) - 1);
+        bits |= value;
+        break;
+      default:
+        LOG(FATAL) << "Bad encoder format: " << encoder->field_loc[i].kind;
     }
-    // We only support little-endian MIPS.
+  }
+  // We only support little-endian MIPS.
+  code_buffer_.push_back(bits & 0xff);
+  code_buffer_.push_back((bits >> 8) & 0xff);
+  code_buffer_.push_back((bits >> 16) & 0xff);
+  code_buffer_.push_back((bits >> 24) & 0xff);
+  // TUNING: replace with proper delay slot handling
+  if (encoder->size == 8) {
+    const MipsEncodingMap *encoder = &EncodingMap[kMipsNop];
+    uint32_t bits = encoder->skeleton;
     code_buffer_.push_back(bits & 0xff);
     code_buffer_.push_back((bits >> 8) & 0xff);
     code_buffer_.push_back((bits >> 16) & 0xff);
     code_buffer_.push_back((bits >> 24) & 0xff);
-    // TUNING: replace with proper delay slot handling
-    if (encoder->size == 8) {
-      const MipsEncodingMap *encoder = &EncodingMap[kMipsNop];
-      uint32_t bits = encoder->skeleton;
-      code_buffer_.push_back(bits & 0xff);
-      code_buffer_.push_back((bits >> 8) & 0xff);
-      code_buffer_.push_back((bits >> 16) & 0xff);
-      code_buffer_.push_back((bits >> 24) & 0xff);
-    }
   }
-  return res;
 }
 
 int MipsMir2Lir::GetInsnSize(LIR* lir) {
@@ -39,93 +39,6 @@ void MipsMir2Lir::GenSpecialCase(BasicBlock* bb, MIR* mir,
  * switch table offsets (which will happen after final assembly and all
  * labels are fixed).
  *
- * The test loop will look something like:
- *
- *   ori   rEnd, r_ZERO, #table_size  ; size in bytes
- *   jal   BaseLabel         ; stores "return address" (BaseLabel) in r_RA
- *   nop                     ; opportunistically fill
- * BaseLabel:
- *   addiu rBase, r_RA, <table> - <BaseLabel>  ; table relative to BaseLabel
-     addu  rEnd, rEnd, rBase                   ; end of table
- *   lw    r_val, [rSP, v_reg_off]                ; Test Value
- * loop:
- *   beq   rBase, rEnd, done
- *   lw    r_key, 0(rBase)
- *   addu  rBase, 8
- *   bne   r_val, r_key, loop
- *   lw    r_disp, -4(rBase)
- *   addu  r_RA, r_disp
- *   jr    r_RA
- * done:
- *
- */
-void MipsMir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
-                                  RegLocation rl_src) {
-  const uint16_t* table = cu_->insns + current_dalvik_offset_ + table_offset;
-  if (cu_->verbose) {
-    DumpSparseSwitchTable(table);
-  }
-  // Add the table to the list - we'll process it later
-  SwitchTable *tab_rec =
-      static_cast<SwitchTable*>(arena_->Alloc(sizeof(SwitchTable), ArenaAllocator::kAllocData));
-  tab_rec->table = table;
-  tab_rec->vaddr = current_dalvik_offset_;
-  int elements = table[1];
-  tab_rec->targets =
-      static_cast<LIR**>(arena_->Alloc(elements * sizeof(LIR*), ArenaAllocator::kAllocLIR));
-  switch_tables_.Insert(tab_rec);
-
-  // The table is composed of 8-byte key/disp pairs
-  int byte_size = elements * 8;
-
-  int size_hi = byte_size >> 16;
-  int size_lo = byte_size & 0xffff;
-
-  int rEnd = AllocTemp();
-  if (size_hi) {
-    NewLIR2(kMipsLui, rEnd, size_hi);
-  }
-  // Must prevent code motion for the curr pc pair
-  GenBarrier();  // Scheduling barrier
-  NewLIR0(kMipsCurrPC);  // Really a jal to .+8
-  // Now, fill the branch delay slot
-  if (size_hi) {
-    NewLIR3(kMipsOri, rEnd, rEnd, size_lo);
-  } else {
-    NewLIR3(kMipsOri, rEnd, r_ZERO, size_lo);
-  }
-  GenBarrier();  // Scheduling barrier
-
-  // Construct BaseLabel and set up table base register
-  LIR* base_label = NewLIR0(kPseudoTargetLabel);
-  // Remember base label so offsets can be computed later
-  tab_rec->anchor = base_label;
-  int rBase = AllocTemp();
-  NewLIR4(kMipsDelta, rBase, 0, reinterpret_cast<uintptr_t>(base_label),
-          reinterpret_cast<uintptr_t>(tab_rec));
-  OpRegRegReg(kOpAdd, rEnd, rEnd, rBase);
-
-  // Grab switch test value
-  rl_src = LoadValue(rl_src, kCoreReg);
-
-  // Test loop
-  int r_key = AllocTemp();
-  LIR* loop_label = NewLIR0(kPseudoTargetLabel);
-  LIR* exit_branch = OpCmpBranch(kCondEq, rBase, rEnd, NULL);
-  LoadWordDisp(rBase, 0, r_key);
-  OpRegImm(kOpAdd, rBase, 8);
-  OpCmpBranch(kCondNe, rl_src.low_reg, r_key, loop_label);
-  int r_disp = AllocTemp();
-  LoadWordDisp(rBase, -4, r_disp);
-  OpRegRegReg(kOpAdd, r_RA, r_RA, r_disp);
-  OpReg(kOpBx, r_RA);
-
-  // Loop exit
-  LIR* exit_label = NewLIR0(kPseudoTargetLabel);
-  exit_branch->target = exit_label;
-}
-
-/*
  * Code pattern will look something like:
  *
  *   lw    r_val
@@ -138,9 +51,7 @@ void MipsMir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
  *   jr    r_RA
  * done:
  */
-void MipsMir2Lir::GenPackedSwitch(MIR* mir, uint32_t table_offset,
-                                  RegLocation rl_src) {
-  const uint16_t* table = cu_->insns + current_dalvik_offset_ + table_offset;
+void MipsMir2Lir::GenPackedSwitch(MIR* mir, const uint16_t* table, RegLocation rl_src) {
   if (cu_->verbose) {
     DumpPackedSwitchTable(table);
   }
@@ -210,6 +121,11 @@ void MipsMir2Lir::GenPackedSwitch(MIR* mir, uint32_t table_offset,
   /* branch_over target here */
   LIR* target = NewLIR0(kPseudoTargetLabel);
   branch_over->target = target;
+  FreeTemp(rBase);
+  FreeTemp(r_disp);
+  if (r_key != rl_src.low_reg) {
+    FreeTemp(r_key);
+  }
 }
 
 /*
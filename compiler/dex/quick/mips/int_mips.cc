@@ -263,6 +263,11 @@ bool MipsMir2Lir::GenInlinedCas32(CallInfo* info, bool need_write_barrier) {
   return false;
 }
 
+bool MipsMir2Lir::GenInlinedCas64(CallInfo* info) {
+  DCHECK_NE(cu_->instruction_set, kThumb2);
+  return false;
+}
+
 bool MipsMir2Lir::GenInlinedSqrt(CallInfo* info) {
   DCHECK_NE(cu_->instruction_set, kThumb2);
   return false;
@@ -606,7 +611,7 @@ void MipsMir2Lir::GenArrayObjPut(int opt_flags, RegLocation rl_array,
   StoreBaseIndexed(r_ptr, r_index, r_value, scale, kWord);
   FreeTemp(r_ptr);
   FreeTemp(r_index);
-  if (!mir_graph_->IsConstantNullRef(rl_src)) {
+  if (!(opt_flags & MIR_IGNORE_CARD_MARK) && !mir_graph_->IsConstantNullRef(rl_src)) {
     MarkGCCard(r_value, r_array);
   }
 }
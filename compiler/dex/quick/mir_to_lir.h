@@ -23,7 +23,7 @@
 #include "dex/compiler_ir.h"
 #include "dex/backend.h"
 #include "dex/growable_array.h"
-#include "dex/arena_allocator.h"
+#include "base/arena_allocator.h"
 #include "driver/compiler_driver.h"
 #include "leb128_encoder.h"
 #include "safe_map.h"
@@ -170,12 +170,27 @@ class Mir2Lir : public Backend {
   public:
     struct SwitchTable {
       int offset;
-      const uint16_t* table;      // Original dex table.
+      const uint16_t* table;      // Packed dex table, or one made for keys of a sparse switch.
       int vaddr;                  // Dalvik offset of switch opcode.
       LIR* anchor;                // Reference instruction for relative offsets.
       LIR** targets;              // Array of case targets.
     };
 
+    enum SwitchClusterKind {
+      kSwitchCompare,
+      kSwitchBitTest,
+      kSwitchJumpTable,
+    };
+
+    // Cases of a switch lowered together by GenSwitch.
+    struct SwitchCluster {
+      SwitchClusterKind kind;
+      int first_case;
+      int last_case;
+    };
+
+    struct SwitchLowering;
+
     struct FillArrayData {
       int offset;
       const uint16_t* table;      // Original dex table.
@@ -291,16 +306,18 @@ class Mir2Lir : public Backend {
     int AssignLiteralOffset(int offset);
     int AssignSwitchTablesOffset(int offset);
     int AssignFillArrayDataOffset(int offset);
-    int AssignInsnOffsets();
-    void AssignOffsets();
+    int AssignInsnOffsets(LIR* start);
+    void AssignOffsets(LIR* start);
+    void LinkFixups(LIR* start);
     LIR* InsertCaseLabel(int vaddr, int keyVal);
     void MarkPackedCaseLabels(Mir2Lir::SwitchTable *tab_rec);
-    void MarkSparseCaseLabels(Mir2Lir::SwitchTable *tab_rec);
 
     // Shared by all targets - implemented in local_optimizations.cc
     void ConvertMemOpIntoMove(LIR* orig_lir, int dest, int src);
     void ApplyLoadStoreElimination(LIR* head_lir, LIR* tail_lir);
     void ApplyLoadHoisting(LIR* head_lir, LIR* tail_lir);
+    void ApplyListScheduling(LIR* head_lir, LIR* tail_lir);
+    void ScheduleRegion(LIR** region, int count);
     void ApplyLocalOptimizations(LIR* head_lir, LIR* tail_lir);
     void RemoveRedundantBranches();
 
@@ -387,21 +404,27 @@ class Mir2Lir : public Backend {
     LIR* GenImmedCheck(ConditionCode c_code, int reg, int imm_val,
                        ThrowKind kind);
     LIR* GenNullCheck(int s_reg, int m_reg, int opt_flags);
+    bool GenAccessNullCheck(int s_reg, int m_reg, int offset, int opt_flags);
+    void MarkImplicitNullCheck();
+    void GenImplicitSuspendTest();
     LIR* GenRegRegCheck(ConditionCode c_code, int reg1, int reg2,
                         ThrowKind kind);
     void GenCompareAndBranch(Instruction::Code opcode, RegLocation rl_src1,
                              RegLocation rl_src2, LIR* taken, LIR* fall_through);
     void GenCompareZeroAndBranch(Instruction::Code opcode, RegLocation rl_src,
                                  LIR* taken, LIR* fall_through);
+    void GenSwitch(MIR* mir, BasicBlock* bb, uint32_t table_offset, RegLocation rl_src);
+    void GenSwitchClusters(const SwitchLowering& lowering, int first, int last, bool falls_out);
+    void GenSwitchCluster(const SwitchLowering& lowering, const SwitchCluster& cluster);
     void GenIntToLong(RegLocation rl_dest, RegLocation rl_src);
     void GenIntNarrowing(Instruction::Code opcode, RegLocation rl_dest,
                          RegLocation rl_src);
     void GenNewArray(uint32_t type_idx, RegLocation rl_dest,
                      RegLocation rl_src);
     void GenFilledNewArray(CallInfo* info);
-    void GenSput(uint32_t field_idx, RegLocation rl_src,
+    void GenSput(uint32_t field_idx, int opt_flags, RegLocation rl_src,
                  bool is_long_or_double, bool is_object);
-    void GenSget(uint32_t field_idx, RegLocation rl_dest,
+    void GenSget(uint32_t field_idx, int opt_flags, RegLocation rl_dest,
                  bool is_long_or_double, bool is_object);
     void GenIGet(uint32_t field_idx, int opt_flags, OpSize size,
                  RegLocation rl_dest, RegLocation rl_obj, bool is_long_or_double, bool is_object);
@@ -429,6 +452,10 @@ class Mir2Lir : public Backend {
                            RegLocation rl_src);
     void GenSuspendTest(int opt_flags);
     void GenSuspendTestAndBranch(int opt_flags, LIR* target);
+    // Lowers a kMirOpSumIntArray one element at a time, targets with a vector unit override it.
+    virtual void GenSumIntArray(MIR* mir);
+    RegLocation LoadSumIntArrayRange(MIR* mir, int* r_ptr, int* r_end);
+    void GenSumIntArrayElements(int r_sum, int r_ptr, int r_end);
 
     // Shared by all targets - implemented in gen_invoke.cc.
     int CallHelperSetup(ThreadOffset helper_offset);
@@ -487,8 +514,13 @@ class Mir2Lir : public Backend {
     bool GenInlinedFloatCvt(CallInfo* info);
     bool GenInlinedDoubleCvt(CallInfo* info);
     bool GenInlinedIndexOf(CallInfo* info, bool zero_based);
+    bool GenInlinedArrayCopy(CallInfo* info);
     bool GenInlinedStringCompareTo(CallInfo* info);
+    bool GenInlinedStringEquals(CallInfo* info);
+    bool GenInlinedStringHashCode(CallInfo* info);
     bool GenInlinedCurrentThread(CallInfo* info);
+    bool GenInlinedVMSupportsCS8(CallInfo* info);
+    bool GenInlinedIdentityHashCode(CallInfo* info);
     bool GenInlinedUnsafeGet(CallInfo* info, bool is_long, bool is_volatile);
     bool GenInlinedUnsafePut(CallInfo* info, bool is_long, bool is_object,
                              bool is_volatile, bool is_ordered);
@@ -570,7 +602,8 @@ class Mir2Lir : public Backend {
     virtual void CompilerInitializeRegAlloc() = 0;
 
     // Required for target - miscellaneous.
-    virtual AssemblerStatus AssembleInstructions(uintptr_t start_addr) = 0;
+    virtual AssemblerStatus FixupInstruction(LIR* lir, uintptr_t start_addr) = 0;
+    virtual void EncodeInstruction(LIR* lir) = 0;
     virtual void DumpResourceMask(LIR* lir, uint64_t mask, const char* prefix) = 0;
     virtual void SetupTargetResourceMasks(LIR* lir) = 0;
     virtual const char* GetTargetInstFmt(int opcode) = 0;
@@ -580,6 +613,15 @@ class Mir2Lir : public Backend {
     virtual uint64_t GetTargetInstFlags(int opcode) = 0;
     virtual int GetInsnSize(LIR* lir) = 0;
     virtual bool IsUnconditionalBranch(LIR* lir) = 0;
+    // Cycles until the result of lir can be used, for the list scheduler.
+    virtual int GetInstructionLatency(LIR* lir) {
+      return 1;
+    }
+    // If true, div and rem are generated with GenDivRem and GenDivRemLit rather than calls to
+    // pIdivmod.
+    virtual bool HasHardwareDivide() {
+      return false;
+    }
 
     // Required for target - Dalvik-level generators.
     virtual void GenArithImmOpLong(Instruction::Code opcode, RegLocation rl_dest,
@@ -600,6 +642,7 @@ class Mir2Lir : public Backend {
     virtual void GenConversion(Instruction::Code opcode, RegLocation rl_dest,
                                RegLocation rl_src) = 0;
     virtual bool GenInlinedCas32(CallInfo* info, bool need_write_barrier) = 0;
+    virtual bool GenInlinedCas64(CallInfo* info) = 0;
     virtual bool GenInlinedMinMaxInt(CallInfo* info, bool is_min) = 0;
     virtual bool GenInlinedSqrt(CallInfo* info) = 0;
     virtual void GenNegLong(RegLocation rl_dest, RegLocation rl_src) = 0;
@@ -636,10 +679,8 @@ class Mir2Lir : public Backend {
                                                int second_bit) = 0;
     virtual void GenNegDouble(RegLocation rl_dest, RegLocation rl_src) = 0;
     virtual void GenNegFloat(RegLocation rl_dest, RegLocation rl_src) = 0;
-    virtual void GenPackedSwitch(MIR* mir, uint32_t table_offset,
-                                 RegLocation rl_src) = 0;
-    virtual void GenSparseSwitch(MIR* mir, uint32_t table_offset,
-                                 RegLocation rl_src) = 0;
+    // Jumps through table, a packed switch table, falling through for the keys out of it.
+    virtual void GenPackedSwitch(MIR* mir, const uint16_t* table, RegLocation rl_src) = 0;
     virtual void GenSpecialCase(BasicBlock* bb, MIR* mir,
                                 SpecialCaseHandler special_case) = 0;
     virtual void GenArrayObjPut(int opt_flags, RegLocation rl_array,
@@ -706,6 +747,8 @@ class Mir2Lir : public Backend {
                                     bool can_assume_type_is_in_dex_cache,
                                     uint32_t type_idx, RegLocation rl_dest,
                                     RegLocation rl_src);
+    LIR* GenSubtypeCheckCacheHit(int sub_class_reg, int super_class_reg, int entry_reg,
+                                 int temp_reg);
 
     void ClobberBody(RegisterInfo* p);
     void ResetDefBody(RegisterInfo* p) {
@@ -727,6 +770,7 @@ class Mir2Lir : public Backend {
     GrowableArray<LIR*> throw_launchpads_;
     GrowableArray<LIR*> suspend_launchpads_;
     GrowableArray<LIR*> intrinsic_launchpads_;
+    GrowableArray<LIR*> fixups_;  // Instructions needing pc-relative fixup, in code order.
     SafeMap<unsigned int, LIR*> boundary_map_;  // boundary lookup cache.
     /*
      * Holds mapping from native PC to dex PC for safepoints where we may deoptimize.
@@ -208,6 +208,9 @@ ENCODING_MAP(Cmp, IS_LOAD, 0, 0,
   SHIFT_ENCODING_MAP(Sar, 0x7),
 #undef SHIFT_ENCODING_MAP
 
+  { kX86Shld32RRI, kRegRegImmStore, IS_TERTIARY_OP | REG_DEF0_USE01 | SETS_CCODES, { 0, 0, 0x0F, 0xA4, 0, 0, 0, 1 }, "Shld32RRI", "!0r,!1r,!2d" },
+  { kX86Shrd32RRI, kRegRegImmStore, IS_TERTIARY_OP | REG_DEF0_USE01 | SETS_CCODES, { 0, 0, 0x0F, 0xAC, 0, 0, 0, 1 }, "Shrd32RRI", "!0r,!1r,!2d" },
+
   { kX86Cmc, kNullary, NO_OPERAND, { 0, 0, 0xF5, 0, 0, 0, 0, 0}, "Cmc", "" },
 
   { kX86Test8RI,  kRegImm,             IS_BINARY_OP   | REG_USE0  | SETS_CCODES, { 0,    0, 0xF6, 0, 0, 0, 0, 1}, "Test8RI", "!0r,!1d" },
@@ -284,11 +287,14 @@ ENCODING_MAP(Cmp, IS_LOAD, 0, 0,
 
   { kX86PsrlqRI, kRegImm, IS_BINARY_OP | REG_DEF0_USE0, { 0x66, 0, 0x0F, 0x73, 0, 2, 0, 1 }, "PsrlqRI", "!0r,!1d" },
   { kX86PsllqRI, kRegImm, IS_BINARY_OP | REG_DEF0_USE0, { 0x66, 0, 0x0F, 0x73, 0, 6, 0, 1 }, "PsllqRI", "!0r,!1d" },
+  { kX86PsrldqRI, kRegImm, IS_BINARY_OP | REG_DEF0_USE0, { 0x66, 0, 0x0F, 0x73, 0, 3, 0, 1 }, "PsrldqRI", "!0r,!1d" },
 
   EXT_0F_ENCODING_MAP(Movdxr,    0x66, 0x6E, REG_DEF0),
   { kX86MovdrxRR, kRegRegStore, IS_BINARY_OP | REG_DEF0   | REG_USE01,  { 0x66, 0, 0x0F, 0x7E, 0, 0, 0, 0 }, "MovdrxRR", "!0r,!1r" },
   { kX86MovdrxMR, kMemReg,      IS_STORE | IS_TERTIARY_OP | REG_USE02,  { 0x66, 0, 0x0F, 0x7E, 0, 0, 0, 0 }, "MovdrxMR", "[!0r+!1d],!2r" },
   { kX86MovdrxAR, kArrayReg,    IS_STORE | IS_QUIN_OP     | REG_USE014, { 0x66, 0, 0x0F, 0x7E, 0, 0, 0, 0 }, "MovdrxAR", "[!0r+!1r<<!2d+!3d],!4r" },
+  EXT_0F_ENCODING_MAP(Movdqu,    0xF3, 0x6F, REG_DEF0),
+  EXT_0F_ENCODING_MAP(Paddd,     0x66, 0xFE, REG_DEF0),
 
   { kX86Set8R, kRegCond,              IS_BINARY_OP   | REG_DEF0  | USES_CCODES, { 0, 0, 0x0F, 0x90, 0, 0, 0, 0 }, "Set8R", "!1c !0r" },
   { kX86Set8M, kMemCond,   IS_STORE | IS_TERTIARY_OP | REG_USE0  | USES_CCODES, { 0, 0, 0x0F, 0x90, 0, 0, 0, 0 }, "Set8M", "!2c [!0r+!1d]" },
@@ -372,6 +378,7 @@ int X86Mir2Lir::GetInsnSize(LIR* lir) {
     case kNullary:
       return 1;  // 1 byte of opcode
     case kReg:  // lir operands - 0: reg
+    case kRegRegReg:  // lir operands - 0: reg, the others are implicit
       return ComputeSize(entry, 0, 0, false);
     case kMem:  // lir operands - 0: base, 1: disp
       return ComputeSize(entry, lir->operands[0], lir->operands[1], false);
@@ -410,6 +417,7 @@ int X86Mir2Lir::GetInsnSize(LIR* lir) {
     case kThreadImm:  // lir operands - 0: disp, 1: imm
       return ComputeSize(entry, 0, 0x12345678, false);  // displacement size is always 32bit
     case kRegRegImm:  // lir operands - 0: reg, 1: reg, 2: imm
+    case kRegRegImmStore:  // lir operands - 0: reg2, 1: reg1, 2: imm
       return ComputeSize(entry, 0, 0, false);
     case kRegMemImm:  // lir operands - 0: reg, 1: base, 2: disp, 3: imm
       return ComputeSize(entry, lir->operands[1], lir->operands[2], false);
@@ -1158,240 +1166,237 @@ void X86Mir2Lir::EmitUnimplemented(const X86EncodingMap* entry, LIR* lir) {
 }
 
 /*
- * Assemble the LIR into binary instruction format.  Note that we may
- * discover that pc-relative displacements may not fit the selected
- * instruction.  In those cases we will try to substitute a new code
- * sequence or request that the trace be shortened and retried.
+ * Fix up the pc-relative operands of lir.  Note that we may discover that
+ * pc-relative displacements may not fit the selected instruction.  In those
+ * cases we substitute a longer form, and AssembleLIR recomputes the offsets
+ * of the code that follows and visits the fixups again.
  */
-AssemblerStatus X86Mir2Lir::AssembleInstructions(uintptr_t start_addr) {
-  LIR *lir;
+AssemblerStatus X86Mir2Lir::FixupInstruction(LIR* lir, uintptr_t start_addr) {
   AssemblerStatus res = kSuccess;  // Assume success
 
   const bool kVerbosePcFixup = false;
-  for (lir = first_lir_insn_; lir != NULL; lir = NEXT_LIR(lir)) {
-    if (lir->opcode < 0) {
-      continue;
+  switch (lir->opcode) {
+    case kX86Jcc8: {
+      LIR *target_lir = lir->target;
+      DCHECK(target_lir != NULL);
+      int delta = 0;
+      uintptr_t pc;
+      if (IS_SIMM8(lir->operands[0])) {
+        pc = lir->offset + 2 /* opcode + rel8 */;
+      } else {
+        pc = lir->offset + 6 /* 2 byte opcode + rel32 */;
+      }
+      uintptr_t target = target_lir->offset;
+      delta = target - pc;
+      if (IS_SIMM8(delta) != IS_SIMM8(lir->operands[0])) {
+        if (kVerbosePcFixup) {
+          LOG(INFO) << "Retry for JCC growth at " << lir->offset
+              << " delta: " << delta << " old delta: " << lir->operands[0];
+        }
+        lir->opcode = kX86Jcc32;
+        SetupResourceMasks(lir);
+        res = kRetryAll;
+      }
+      if (kVerbosePcFixup) {
+        LOG(INFO) << "Source:";
+        DumpLIRInsn(lir, 0);
+        LOG(INFO) << "Target:";
+        DumpLIRInsn(target_lir, 0);
+        LOG(INFO) << "Delta " << delta;
+      }
+      lir->operands[0] = delta;
+      break;
     }
-
-    if (lir->flags.is_nop) {
-      continue;
+    case kX86Jcc32: {
+      LIR *target_lir = lir->target;
+      DCHECK(target_lir != NULL);
+      uintptr_t pc = lir->offset + 6 /* 2 byte opcode + rel32 */;
+      uintptr_t target = target_lir->offset;
+      int delta = target - pc;
+      if (kVerbosePcFixup) {
+        LOG(INFO) << "Source:";
+        DumpLIRInsn(lir, 0);
+        LOG(INFO) << "Target:";
+        DumpLIRInsn(target_lir, 0);
+        LOG(INFO) << "Delta " << delta;
+      }
+      lir->operands[0] = delta;
+      break;
     }
-
-    if (lir->flags.pcRelFixup) {
-      switch (lir->opcode) {
-        case kX86Jcc8: {
-          LIR *target_lir = lir->target;
-          DCHECK(target_lir != NULL);
-          int delta = 0;
-          uintptr_t pc;
-          if (IS_SIMM8(lir->operands[0])) {
-            pc = lir->offset + 2 /* opcode + rel8 */;
-          } else {
-            pc = lir->offset + 6 /* 2 byte opcode + rel32 */;
-          }
-          uintptr_t target = target_lir->offset;
-          delta = target - pc;
-          if (IS_SIMM8(delta) != IS_SIMM8(lir->operands[0])) {
-            if (kVerbosePcFixup) {
-              LOG(INFO) << "Retry for JCC growth at " << lir->offset
-                  << " delta: " << delta << " old delta: " << lir->operands[0];
-            }
-            lir->opcode = kX86Jcc32;
-            SetupResourceMasks(lir);
-            res = kRetryAll;
-          }
-          if (kVerbosePcFixup) {
-            LOG(INFO) << "Source:";
-            DumpLIRInsn(lir, 0);
-            LOG(INFO) << "Target:";
-            DumpLIRInsn(target_lir, 0);
-            LOG(INFO) << "Delta " << delta;
-          }
-          lir->operands[0] = delta;
-          break;
-        }
-        case kX86Jcc32: {
-          LIR *target_lir = lir->target;
-          DCHECK(target_lir != NULL);
-          uintptr_t pc = lir->offset + 6 /* 2 byte opcode + rel32 */;
-          uintptr_t target = target_lir->offset;
-          int delta = target - pc;
-          if (kVerbosePcFixup) {
-            LOG(INFO) << "Source:";
-            DumpLIRInsn(lir, 0);
-            LOG(INFO) << "Target:";
-            DumpLIRInsn(target_lir, 0);
-            LOG(INFO) << "Delta " << delta;
-          }
-          lir->operands[0] = delta;
-          break;
-        }
-        case kX86Jmp8: {
-          LIR *target_lir = lir->target;
-          DCHECK(target_lir != NULL);
-          int delta = 0;
-          uintptr_t pc;
-          if (IS_SIMM8(lir->operands[0])) {
-            pc = lir->offset + 2 /* opcode + rel8 */;
-          } else {
-            pc = lir->offset + 5 /* opcode + rel32 */;
-          }
-          uintptr_t target = target_lir->offset;
-          delta = target - pc;
-          if (!(cu_->disable_opt & (1 << kSafeOptimizations)) && delta == 0) {
-            // Useless branch
-            lir->flags.is_nop = true;
-            if (kVerbosePcFixup) {
-              LOG(INFO) << "Retry for useless branch at " << lir->offset;
-            }
-            res = kRetryAll;
-          } else if (IS_SIMM8(delta) != IS_SIMM8(lir->operands[0])) {
-            if (kVerbosePcFixup) {
-              LOG(INFO) << "Retry for JMP growth at " << lir->offset;
-            }
-            lir->opcode = kX86Jmp32;
-            SetupResourceMasks(lir);
-            res = kRetryAll;
-          }
-          lir->operands[0] = delta;
-          break;
+    case kX86Jmp8: {
+      LIR *target_lir = lir->target;
+      DCHECK(target_lir != NULL);
+      int delta = 0;
+      uintptr_t pc;
+      if (IS_SIMM8(lir->operands[0])) {
+        pc = lir->offset + 2 /* opcode + rel8 */;
+      } else {
+        pc = lir->offset + 5 /* opcode + rel32 */;
+      }
+      uintptr_t target = target_lir->offset;
+      delta = target - pc;
+      if (!(cu_->disable_opt & (1 << kSafeOptimizations)) && delta == 0) {
+        // Useless branch
+        lir->flags.is_nop = true;
+        if (kVerbosePcFixup) {
+          LOG(INFO) << "Retry for useless branch at " << lir->offset;
         }
-        case kX86Jmp32: {
-          LIR *target_lir = lir->target;
-          DCHECK(target_lir != NULL);
-          uintptr_t pc = lir->offset + 5 /* opcode + rel32 */;
-          uintptr_t target = target_lir->offset;
-          int delta = target - pc;
-          lir->operands[0] = delta;
-          break;
+        res = kRetryAll;
+      } else if (IS_SIMM8(delta) != IS_SIMM8(lir->operands[0])) {
+        if (kVerbosePcFixup) {
+          LOG(INFO) << "Retry for JMP growth at " << lir->offset;
         }
-        default:
-          break;
+        lir->opcode = kX86Jmp32;
+        SetupResourceMasks(lir);
+        res = kRetryAll;
       }
+      lir->operands[0] = delta;
+      break;
     }
-
-    /*
-     * If one of the pc-relative instructions expanded we'll have
-     * to make another pass.  Don't bother to fully assemble the
-     * instruction.
-     */
-    if (res != kSuccess) {
-      continue;
+    case kX86Jmp32: {
+      LIR *target_lir = lir->target;
+      DCHECK(target_lir != NULL);
+      uintptr_t pc = lir->offset + 5 /* opcode + rel32 */;
+      uintptr_t target = target_lir->offset;
+      int delta = target - pc;
+      lir->operands[0] = delta;
+      break;
     }
-    CHECK_EQ(static_cast<size_t>(lir->offset), code_buffer_.size());
-    const X86EncodingMap *entry = &X86Mir2Lir::EncodingMap[lir->opcode];
-    size_t starting_cbuf_size = code_buffer_.size();
-    switch (entry->kind) {
-      case kData:  // 4 bytes of data
-        code_buffer_.push_back(lir->operands[0]);
-        break;
-      case kNullary:  // 1 byte of opcode
-        DCHECK_EQ(0, entry->skeleton.prefix1);
-        DCHECK_EQ(0, entry->skeleton.prefix2);
-        code_buffer_.push_back(entry->skeleton.opcode);
-        if (entry->skeleton.extra_opcode1 != 0) {
-          code_buffer_.push_back(entry->skeleton.extra_opcode1);
-          if (entry->skeleton.extra_opcode2 != 0) {
-            code_buffer_.push_back(entry->skeleton.extra_opcode2);
-          }
-        } else {
-          DCHECK_EQ(0, entry->skeleton.extra_opcode2);
+    default:
+      break;
+  }
+  return res;
+}
+
+/*
+ * Assemble the LIR into binary instruction format.  Its pc-relative
+ * displacements have been fixed up by FixupInstruction.
+ */
+void X86Mir2Lir::EncodeInstruction(LIR* lir) {
+  if (lir->opcode < 0) {
+    return;
+  }
+
+  if (lir->flags.is_nop) {
+    return;
+  }
+
+  CHECK_EQ(static_cast<size_t>(lir->offset), code_buffer_.size());
+  const X86EncodingMap *entry = &X86Mir2Lir::EncodingMap[lir->opcode];
+  size_t starting_cbuf_size = code_buffer_.size();
+  switch (entry->kind) {
+    case kData:  // 4 bytes of data
+      code_buffer_.push_back(lir->operands[0]);
+      break;
+    case kNullary:  // 1 byte of opcode
+      DCHECK_EQ(0, entry->skeleton.prefix1);
+      DCHECK_EQ(0, entry->skeleton.prefix2);
+      code_buffer_.push_back(entry->skeleton.opcode);
+      if (entry->skeleton.extra_opcode1 != 0) {
+        code_buffer_.push_back(entry->skeleton.extra_opcode1);
+        if (entry->skeleton.extra_opcode2 != 0) {
+          code_buffer_.push_back(entry->skeleton.extra_opcode2);
         }
-        DCHECK_EQ(0, entry->skeleton.modrm_opcode);
-        DCHECK_EQ(0, entry->skeleton.ax_opcode);
-        DCHECK_EQ(0, entry->skeleton.immediate_bytes);
-        break;
-      case kReg:  // lir operands - 0: reg
-        EmitOpReg(entry, lir->operands[0]);
-        break;
-      case kMem:  // lir operands - 0: base, 1: disp
-        EmitOpMem(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kMemReg:  // lir operands - 0: base, 1: disp, 2: reg
-        EmitMemReg(entry, lir->operands[0], lir->operands[1], lir->operands[2]);
-        break;
-      case kArrayReg:  // lir operands - 0: base, 1: index, 2: scale, 3: disp, 4: reg
-        EmitArrayReg(entry, lir->operands[0], lir->operands[1], lir->operands[2],
-                     lir->operands[3], lir->operands[4]);
-        break;
-      case kRegMem:  // lir operands - 0: reg, 1: base, 2: disp
-        EmitRegMem(entry, lir->operands[0], lir->operands[1], lir->operands[2]);
-        break;
-      case kRegArray:  // lir operands - 0: reg, 1: base, 2: index, 3: scale, 4: disp
-        EmitRegArray(entry, lir->operands[0], lir->operands[1], lir->operands[2],
-                     lir->operands[3], lir->operands[4]);
-        break;
-      case kRegThread:  // lir operands - 0: reg, 1: disp
-        EmitRegThread(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kRegReg:  // lir operands - 0: reg1, 1: reg2
-        EmitRegReg(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kRegRegStore:  // lir operands - 0: reg2, 1: reg1
-        EmitRegReg(entry, lir->operands[1], lir->operands[0]);
-        break;
-      case kRegRegImm:
-        EmitRegRegImm(entry, lir->operands[0], lir->operands[1], lir->operands[2]);
-        break;
-      case kRegImm:  // lir operands - 0: reg, 1: immediate
-        EmitRegImm(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kThreadImm:  // lir operands - 0: disp, 1: immediate
-        EmitThreadImm(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kMovRegImm:  // lir operands - 0: reg, 1: immediate
-        EmitMovRegImm(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kShiftRegImm:  // lir operands - 0: reg, 1: immediate
-        EmitShiftRegImm(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kShiftRegCl:  // lir operands - 0: reg, 1: cl
-        EmitShiftRegCl(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kRegCond:  // lir operands - 0: reg, 1: condition
-        EmitRegCond(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kJmp:  // lir operands - 0: rel
-        if (entry->opcode == kX86JmpT) {
-          // This works since the instruction format for jmp and call is basically the same and
-          // EmitCallThread loads opcode info.
+      } else {
+        DCHECK_EQ(0, entry->skeleton.extra_opcode2);
+      }
+      DCHECK_EQ(0, entry->skeleton.modrm_opcode);
+      DCHECK_EQ(0, entry->skeleton.ax_opcode);
+      DCHECK_EQ(0, entry->skeleton.immediate_bytes);
+      break;
+    case kReg:  // lir operands - 0: reg
+    case kRegRegReg:  // lir operands - 0: reg, the others are implicit
+      EmitOpReg(entry, lir->operands[0]);
+      break;
+    case kMem:  // lir operands - 0: base, 1: disp
+      EmitOpMem(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kMemReg:  // lir operands - 0: base, 1: disp, 2: reg
+      EmitMemReg(entry, lir->operands[0], lir->operands[1], lir->operands[2]);
+      break;
+    case kArrayReg:  // lir operands - 0: base, 1: index, 2: scale, 3: disp, 4: reg
+      EmitArrayReg(entry, lir->operands[0], lir->operands[1], lir->operands[2],
+                   lir->operands[3], lir->operands[4]);
+      break;
+    case kRegMem:  // lir operands - 0: reg, 1: base, 2: disp
+      EmitRegMem(entry, lir->operands[0], lir->operands[1], lir->operands[2]);
+      break;
+    case kRegArray:  // lir operands - 0: reg, 1: base, 2: index, 3: scale, 4: disp
+      EmitRegArray(entry, lir->operands[0], lir->operands[1], lir->operands[2],
+                   lir->operands[3], lir->operands[4]);
+      break;
+    case kRegThread:  // lir operands - 0: reg, 1: disp
+      EmitRegThread(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kRegReg:  // lir operands - 0: reg1, 1: reg2
+      EmitRegReg(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kRegRegStore:  // lir operands - 0: reg2, 1: reg1
+      EmitRegReg(entry, lir->operands[1], lir->operands[0]);
+      break;
+    case kRegRegImm:
+      EmitRegRegImm(entry, lir->operands[0], lir->operands[1], lir->operands[2]);
+      break;
+    case kRegRegImmStore:  // lir operands - 0: reg2, 1: reg1, 2: imm
+      EmitRegRegImm(entry, lir->operands[1], lir->operands[0], lir->operands[2]);
+      break;
+    case kRegImm:  // lir operands - 0: reg, 1: immediate
+      EmitRegImm(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kThreadImm:  // lir operands - 0: disp, 1: immediate
+      EmitThreadImm(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kMovRegImm:  // lir operands - 0: reg, 1: immediate
+      EmitMovRegImm(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kShiftRegImm:  // lir operands - 0: reg, 1: immediate
+      EmitShiftRegImm(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kShiftRegCl:  // lir operands - 0: reg, 1: cl
+      EmitShiftRegCl(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kRegCond:  // lir operands - 0: reg, 1: condition
+      EmitRegCond(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kJmp:  // lir operands - 0: rel
+      if (entry->opcode == kX86JmpT) {
+        // This works since the instruction format for jmp and call is basically the same and
+        // EmitCallThread loads opcode info.
+        EmitCallThread(entry, lir->operands[0]);
+      } else {
+        EmitJmp(entry, lir->operands[0]);
+      }
+      break;
+    case kJcc:  // lir operands - 0: rel, 1: CC, target assigned
+      EmitJcc(entry, lir->operands[0], lir->operands[1]);
+      break;
+    case kCall:
+      switch (entry->opcode) {
+        case kX86CallM:  // lir operands - 0: base, 1: disp
+          EmitCallMem(entry, lir->operands[0], lir->operands[1]);
+          break;
+        case kX86CallT:  // lir operands - 0: disp
           EmitCallThread(entry, lir->operands[0]);
-        } else {
-          EmitJmp(entry, lir->operands[0]);
-        }
-        break;
-      case kJcc:  // lir operands - 0: rel, 1: CC, target assigned
-        EmitJcc(entry, lir->operands[0], lir->operands[1]);
-        break;
-      case kCall:
-        switch (entry->opcode) {
-          case kX86CallM:  // lir operands - 0: base, 1: disp
-            EmitCallMem(entry, lir->operands[0], lir->operands[1]);
-            break;
-          case kX86CallT:  // lir operands - 0: disp
-            EmitCallThread(entry, lir->operands[0]);
-            break;
-          default:
-            EmitUnimplemented(entry, lir);
-            break;
-        }
-        break;
-      case kPcRel:  // lir operands - 0: reg, 1: base, 2: index, 3: scale, 4: table
-        EmitPcRel(entry, lir->operands[0], lir->operands[1], lir->operands[2],
-                  lir->operands[3], lir->operands[4]);
-        break;
-      case kMacro:
-        EmitMacro(entry, lir->operands[0], lir->offset);
-        break;
-      default:
-        EmitUnimplemented(entry, lir);
-        break;
-    }
-    CHECK_EQ(static_cast<size_t>(GetInsnSize(lir)),
-             code_buffer_.size() - starting_cbuf_size)
-        << "Instruction size mismatch for entry: " << X86Mir2Lir::EncodingMap[lir->opcode].name;
+          break;
+        default:
+          EmitUnimplemented(entry, lir);
+          break;
+      }
+      break;
+    case kPcRel:  // lir operands - 0: reg, 1: base, 2: index, 3: scale, 4: table
+      EmitPcRel(entry, lir->operands[0], lir->operands[1], lir->operands[2],
+                lir->operands[3], lir->operands[4]);
+      break;
+    case kMacro:
+      EmitMacro(entry, lir->operands[0], lir->offset);
+      break;
+    default:
+      EmitUnimplemented(entry, lir);
+      break;
   }
-  return res;
+  CHECK_EQ(static_cast<size_t>(GetInsnSize(lir)),
+           code_buffer_.size() - starting_cbuf_size)
+      << "Instruction size mismatch for entry: " << X86Mir2Lir::EncodingMap[lir->opcode].name;
 }
 
 }  // namespace art
@@ -27,29 +27,6 @@ void X86Mir2Lir::GenSpecialCase(BasicBlock* bb, MIR* mir,
   // TODO
 }
 
-/*
- * The sparse table in the literal pool is an array of <key,displacement>
- * pairs.
- */
-void X86Mir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
-                                 RegLocation rl_src) {
-  const uint16_t* table = cu_->insns + current_dalvik_offset_ + table_offset;
-  if (cu_->verbose) {
-    DumpSparseSwitchTable(table);
-  }
-  int entries = table[1];
-  const int* keys = reinterpret_cast<const int*>(&table[2]);
-  const int* targets = &keys[entries];
-  rl_src = LoadValue(rl_src, kCoreReg);
-  for (int i = 0; i < entries; i++) {
-    int key = keys[i];
-    BasicBlock* case_block =
-        mir_graph_->FindBlock(current_dalvik_offset_ + targets[i]);
-    OpCmpImmBranch(kCondEq, rl_src.low_reg, key,
-                   &block_label_list_[case_block->id]);
-  }
-}
-
 /*
  * Code pattern will look something like:
  *
@@ -66,9 +43,7 @@ void X86Mir2Lir::GenSparseSwitch(MIR* mir, uint32_t table_offset,
  * jmp  r_start_of_method
  * done:
  */
-void X86Mir2Lir::GenPackedSwitch(MIR* mir, uint32_t table_offset,
-                                 RegLocation rl_src) {
-  const uint16_t* table = cu_->insns + current_dalvik_offset_ + table_offset;
+void X86Mir2Lir::GenPackedSwitch(MIR* mir, const uint16_t* table, RegLocation rl_src) {
   if (cu_->verbose) {
     DumpPackedSwitchTable(table);
   }
@@ -114,6 +89,11 @@ void X86Mir2Lir::GenPackedSwitch(MIR* mir, uint32_t table_offset,
   /* branch_over target here */
   LIR* target = NewLIR0(kPseudoTargetLabel);
   branch_over->target = target;
+  FreeTemp(start_of_method_reg);
+  FreeTemp(disp_reg);
+  if (keyReg != rl_src.low_reg) {
+    FreeTemp(keyReg);
+  }
 }
 
 /*
@@ -156,7 +136,7 @@ void X86Mir2Lir::GenMonitorEnter(int opt_flags, RegLocation rl_src) {
   LockCallTemps();  // Prepare for explicit register usage
   GenNullCheck(rl_src.s_reg_low, rCX, opt_flags);
   // If lock is unheld, try to grab it quickly with compare and exchange
-  // TODO: copy and clear hash state?
+  // A hashed lock word isn't 0, so it takes the expensive route.
   NewLIR2(kX86Mov32RT, rDX, Thread::ThinLockIdOffset().Int32Value());
   NewLIR2(kX86Sal32RI, rDX, LW_LOCK_OWNER_SHIFT);
   NewLIR2(kX86Xor32RR, rAX, rAX);
@@ -173,7 +153,6 @@ void X86Mir2Lir::GenMonitorExit(int opt_flags, RegLocation rl_src) {
   LockCallTemps();  // Prepare for explicit register usage
   GenNullCheck(rl_src.s_reg_low, rAX, opt_flags);
   // If lock is held by the current thread, clear it to quickly release it
-  // TODO: clear hash state?
   NewLIR2(kX86Mov32RT, rDX, Thread::ThinLockIdOffset().Int32Value());
   NewLIR2(kX86Sal32RI, rDX, LW_LOCK_OWNER_SHIFT);
   NewLIR3(kX86Mov32RM, rCX, rAX, mirror::Object::MonitorOffset().Int32Value());
@@ -197,9 +197,25 @@ void X86Mir2Lir::GenConversion(Instruction::Code opcode, RegLocation rl_dest,
       StoreValue(rl_dest, rl_result);
       return;
     }
-    case Instruction::LONG_TO_DOUBLE:
-      GenConversionCall(QUICK_ENTRYPOINT_OFFSET(pL2d), rl_dest, rl_src);
+    case Instruction::LONG_TO_DOUBLE: {
+      rl_src = LoadValueWide(rl_src, kCoreReg);
+      rl_result = EvalLoc(rl_dest, kFPReg, true);
+      int r_dest = S2d(rl_result.low_reg, rl_result.high_reg);
+      int low_reg = AllocTempDouble();
+      int const_reg = AllocTempDouble();
+      // Converts the unsigned low word by setting it as the mantissa of 2^52 and subtracting
+      // 2^52, and the high word with cvtsi2sd. Only the final add rounds.
+      NewLIR2(kX86MovdxrRR, low_reg, rl_src.low_reg);
+      LoadConstantWide(const_reg, const_reg + 1, 0x4330000000000000LL);  // 2^52
+      NewLIR2(kX86OrpsRR, low_reg, const_reg);
+      NewLIR2(kX86SubsdRR, low_reg | X86_FP_DOUBLE, const_reg | X86_FP_DOUBLE);
+      NewLIR2(kX86Cvtsi2sdRR, r_dest, rl_src.high_reg);
+      LoadConstantWide(const_reg, const_reg + 1, 0x41f0000000000000LL);  // 2^32
+      NewLIR2(kX86MulsdRR, r_dest, const_reg | X86_FP_DOUBLE);
+      NewLIR2(kX86AddsdRR, r_dest, low_reg | X86_FP_DOUBLE);
+      StoreValueWide(rl_dest, rl_result);
       return;
+    }
     case Instruction::LONG_TO_FLOAT:
       // TODO: inline by using memory as a 64-bit source. Be careful about promoted registers.
       GenConversionCall(QUICK_ENTRYPOINT_OFFSET(pL2f), rl_dest, rl_src);
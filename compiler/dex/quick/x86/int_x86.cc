@@ -246,6 +246,41 @@ void X86Mir2Lir::OpTlsCmp(ThreadOffset offset, int val) {
 
 bool X86Mir2Lir::GenInlinedCas32(CallInfo* info, bool need_write_barrier) {
   DCHECK_NE(cu_->instruction_set, kThumb2);
+  // Unused - RegLocation rl_src_unsafe = info->args[0];
+  RegLocation rl_src_obj = info->args[1];  // Object - known non-null
+  RegLocation rl_src_offset = info->args[2];  // long low
+  rl_src_offset.wide = 0;  // ignore high half in info->args[3]
+  RegLocation rl_src_expected = info->args[4];  // int or Object
+  RegLocation rl_src_new_value = info->args[5];  // int or Object
+  RegLocation rl_dest = InlineTarget(info);  // boolean place for result
+
+  if (need_write_barrier && !mir_graph_->IsConstantNullRef(rl_src_new_value)) {
+    // Mark card for object assuming new value is stored, while there are temps to do it with.
+    RegLocation rl_object = LoadValue(rl_src_obj, kCoreReg);
+    RegLocation rl_new_value = LoadValue(rl_src_new_value, kCoreReg);
+    MarkGCCard(rl_new_value.low_reg, rl_object.low_reg);
+  }
+
+  // cmpxchg compares with and loads the old value into EAX, so all call temps are used.
+  FlushAllRegs();
+  LockCallTemps();  // Prepare for explicit register usage
+  LoadValueDirectFixed(rl_src_expected, rAX);
+  LoadValueDirectFixed(rl_src_obj, rCX);
+  LoadValueDirectFixed(rl_src_offset, rDX);
+  LoadValueDirectFixed(rl_src_new_value, rBX);
+  // The lock prefix makes it a full barrier, no other is needed.
+  NewLIR5(kX86LockCmpxchgAR, rCX, rDX, 0, 0, rBX);
+  NewLIR2(kX86Set8R, rAX, kX86CondZ);  // EAX = stored ? 1 : 0
+  NewLIR2(kX86Movzx8RR, rAX, rAX);
+  FreeCallTemps();
+  RegLocation rl_result = GetReturn(false);
+  StoreValue(rl_dest, rl_result);
+  return true;
+}
+
+bool X86Mir2Lir::GenInlinedCas64(CallInfo* info) {
+  DCHECK_NE(cu_->instruction_set, kThumb2);
+  // cmpxchg8b needs EAX, EBX, ECX and EDX for the values, leaving no temp for the address.
   return false;
 }
 
@@ -308,8 +343,23 @@ LIR* X86Mir2Lir::OpIT(ConditionCode cond, const char* guide) {
 
 void X86Mir2Lir::GenMulLong(RegLocation rl_dest, RegLocation rl_src1,
                             RegLocation rl_src2) {
-  LOG(FATAL) << "Unexpected use of GenX86Long for x86";
+  // TODO: fixed register usage here as we only have 4 temps and temporary allocation isn't smart
+  // enough.
+  FlushAllRegs();
+  LockCallTemps();  // Prepare for explicit register usage
+  LoadValueDirectWideFixed(rl_src1, r0, r1);
+  LoadValueDirectWideFixed(rl_src2, r3, r2);
+  // Compute (r2:r0) = (r1:r0) * (r2:r3), the cross products only contribute to the high word.
+  OpRegReg(kOpMul, r1, r3);  // r1 = hi1 * lo2
+  OpRegReg(kOpMul, r2, r0);  // r2 = hi2 * lo1
+  OpRegReg(kOpAdd, r1, r2);  // r1 = r1 + r2
+  NewLIR1(kX86Mul32DaR, r3);  // r2:r0 = lo1 * lo2
+  OpRegReg(kOpAdd, r2, r1);  // r2 = r2 + r1
+  RegLocation rl_result = {kLocPhysReg, 1, 0, 0, 0, 0, 0, 0, 1, r0, r2,
+                          INVALID_SREG, INVALID_SREG};
+  StoreValueWide(rl_dest, rl_result);
 }
+
 void X86Mir2Lir::GenAddLong(RegLocation rl_dest, RegLocation rl_src1,
                          RegLocation rl_src2) {
   // TODO: fixed register usage here as we only have 4 temps and temporary allocation isn't smart
@@ -553,15 +603,69 @@ void X86Mir2Lir::GenArrayObjPut(int opt_flags, RegLocation rl_array,
   StoreBaseIndexedDisp(r_array, r_index, scale,
                        data_offset, r_value, INVALID_REG, kWord, INVALID_SREG);
   FreeTemp(r_index);
-  if (!mir_graph_->IsConstantNullRef(rl_src)) {
+  if (!(opt_flags & MIR_IGNORE_CARD_MARK) && !mir_graph_->IsConstantNullRef(rl_src)) {
     MarkGCCard(r_value, r_array);
   }
 }
 
 void X86Mir2Lir::GenShiftImmOpLong(Instruction::Code opcode, RegLocation rl_dest,
                                    RegLocation rl_src1, RegLocation rl_shift) {
-  // Default implementation is just to ignore the constant case.
-  GenShiftOpLong(opcode, rl_dest, rl_src1, rl_shift);
+  // Per spec, we only care about low 6 bits of shift amount.
+  int shift_amount = mir_graph_->ConstantValue(rl_shift) & 0x3f;
+  if (shift_amount == 0) {
+    rl_src1 = LoadValueWide(rl_src1, kCoreReg);
+    StoreValueWide(rl_dest, rl_src1);
+    return;
+  }
+  FlushAllRegs();
+  LockCallTemps();  // Prepare for explicit register usage
+  LoadValueDirectWideFixed(rl_src1, r0, r1);
+  switch (opcode) {
+    case Instruction::SHL_LONG:
+    case Instruction::SHL_LONG_2ADDR:
+      if (shift_amount < 32) {
+        NewLIR3(kX86Shld32RRI, r1, r0, shift_amount);
+        OpRegImm(kOpLsl, r0, shift_amount);
+      } else {
+        OpRegCopy(r1, r0);
+        if (shift_amount > 32) {
+          OpRegImm(kOpLsl, r1, shift_amount - 32);
+        }
+        LoadConstant(r0, 0);
+      }
+      break;
+    case Instruction::SHR_LONG:
+    case Instruction::SHR_LONG_2ADDR:
+      if (shift_amount < 32) {
+        NewLIR3(kX86Shrd32RRI, r0, r1, shift_amount);
+        OpRegImm(kOpAsr, r1, shift_amount);
+      } else {
+        OpRegCopy(r0, r1);
+        if (shift_amount > 32) {
+          OpRegImm(kOpAsr, r0, shift_amount - 32);
+        }
+        OpRegImm(kOpAsr, r1, 31);
+      }
+      break;
+    case Instruction::USHR_LONG:
+    case Instruction::USHR_LONG_2ADDR:
+      if (shift_amount < 32) {
+        NewLIR3(kX86Shrd32RRI, r0, r1, shift_amount);
+        OpRegImm(kOpLsr, r1, shift_amount);
+      } else {
+        OpRegCopy(r0, r1);
+        if (shift_amount > 32) {
+          OpRegImm(kOpLsr, r0, shift_amount - 32);
+        }
+        LoadConstant(r1, 0);
+      }
+      break;
+    default:
+      LOG(FATAL) << "Unexpected case";
+  }
+  RegLocation rl_result = {kLocPhysReg, 1, 0, 0, 0, 0, 0, 0, 1, r0, r1,
+                          INVALID_SREG, INVALID_SREG};
+  StoreValueWide(rl_dest, rl_result);
 }
 
 void X86Mir2Lir::GenArithImmOpLong(Instruction::Code opcode,
@@ -570,4 +674,46 @@ void X86Mir2Lir::GenArithImmOpLong(Instruction::Code opcode,
   GenArithOpLong(opcode, rl_dest, rl_src1, rl_src2);
 }
 
+void X86Mir2Lir::GenSumIntArray(MIR* mir) {
+  int r_ptr;
+  int r_end;
+  RegLocation rl_result = LoadSumIntArrayRange(mir, &r_ptr, &r_end);
+  int r_acc0 = AllocTempFloat();
+  int r_acc1 = AllocTempFloat();
+  int r_vec0 = AllocTempFloat();
+  int r_vec1 = AllocTempFloat();
+  NewLIR2(kX86MovdxrRR, r_acc0, rl_result.low_reg);
+  NewLIR2(kX86XorpsRR, r_acc1, r_acc1);
+  // The vector loop runs while eight elements are left.
+  int t_reg = AllocTemp();
+  OpRegRegImm(kOpSub, t_reg, r_end, 8 * sizeof(int32_t));
+  LIR* branch = OpCmpBranch(kCondHi, r_ptr, t_reg, NULL);
+  LIR* loop = NewLIR0(kPseudoTargetLabel);
+  NewLIR3(kX86MovdquRM, r_vec0, r_ptr, 0);
+  NewLIR3(kX86MovdquRM, r_vec1, r_ptr, 4 * sizeof(int32_t));
+  NewLIR2(kX86PadddRR, r_acc0, r_vec0);
+  NewLIR2(kX86PadddRR, r_acc1, r_vec1);
+  OpRegImm(kOpAdd, r_ptr, 8 * sizeof(int32_t));
+  OpCmpBranch(kCondLs, r_ptr, t_reg, loop);
+  branch->target = NewLIR0(kPseudoTargetLabel);
+  FreeTemp(t_reg);
+  // Folds the eight partial sums into the low int of acc0.
+  NewLIR2(kX86PadddRR, r_acc0, r_acc1);
+  NewLIR2(kX86MovdquRR, r_acc1, r_acc0);
+  NewLIR2(kX86PsrldqRI, r_acc1, 8);
+  NewLIR2(kX86PadddRR, r_acc0, r_acc1);
+  NewLIR2(kX86MovdquRR, r_acc1, r_acc0);
+  NewLIR2(kX86PsrlqRI, r_acc1, 32);
+  NewLIR2(kX86PadddRR, r_acc0, r_acc1);
+  NewLIR2(kX86MovdrxRR, rl_result.low_reg, r_acc0);
+  GenSumIntArrayElements(rl_result.low_reg, r_ptr, r_end);
+  StoreValue(mir_graph_->GetDest(mir), rl_result);
+  FreeTemp(r_ptr);
+  FreeTemp(r_end);
+  FreeTemp(r_acc0);
+  FreeTemp(r_acc1);
+  FreeTemp(r_vec0);
+  FreeTemp(r_vec1);
+}
+
 }  // namespace art
@@ -300,6 +300,8 @@ enum X86OpCode {
   BinaryShiftOpCode(kX86Shr),
   BinaryShiftOpCode(kX86Sar),
 #undef BinaryShiftOpcode
+  kX86Shld32RRI,  // shld reg1, reg2, #imm; lir operands - 0: reg1, 1: reg2, 2: imm
+  kX86Shrd32RRI,  // shrd reg1, reg2, #imm; lir operands - 0: reg1, 1: reg2, 2: imm
   kX86Cmc,
 #define UnaryOpcode(opcode, reg, mem, array) \
   opcode ## 8 ## reg, opcode ## 8 ## mem, opcode ## 8 ## array, \
@@ -346,8 +348,11 @@ enum X86OpCode {
   Binary0fOpCode(kX86Divss),    // float divide
   kX86PsrlqRI,                  // right shift of floating point registers
   kX86PsllqRI,                  // left shift of floating point registers
+  kX86PsrldqRI,                 // right shift of the bytes of floating point registers
   Binary0fOpCode(kX86Movdxr),   // move into xmm from gpr
   kX86MovdrxRR, kX86MovdrxMR, kX86MovdrxAR,  // move into reg from xmm
+  Binary0fOpCode(kX86Movdqu),   // unaligned move of 128 bits into xmm
+  Binary0fOpCode(kX86Paddd),    // add of the four ints of xmm registers
   kX86Set8R, kX86Set8M, kX86Set8A,  // set byte depending on condition operand
   kX86Mfence,                   // memory barrier
   Binary0fOpCode(kX86Imul16),   // 16bit multiply
@@ -388,6 +393,7 @@ enum X86EncodingKind {
   kRegRegStore,                            // RR following the store modrm reg-reg encoding rather than the load.
   kRegImm, kMemImm, kArrayImm, kThreadImm,  // RI, MI, AI and TI instruction kinds.
   kRegRegImm, kRegMemImm, kRegArrayImm,    // RRI, RMI and RAI instruction kinds.
+  kRegRegImmStore,                         // RRI following the store modrm reg-reg encoding rather than the load.
   kMovRegImm,                              // Shorter form move RI.
   kShiftRegImm, kShiftMemImm, kShiftArrayImm,  // Shift opcode with immediate.
   kShiftRegCl, kShiftMemCl, kShiftArrayCl,     // Shift opcode with register CL.
@@ -175,113 +175,83 @@ void MIRGraph::ComputeDomPostOrderTraversal(BasicBlock* bb) {
     dom_post_order_traversal_->Reset();
   }
   ClearAllVisitedFlags();
-  std::vector<std::pair<BasicBlock*, ArenaBitVector::Iterator*> > work_stack;
+  // Also numbers the blocks in pre-order, so that the blocks a block dominates are those numbered
+  // from it to its last descendant.
+  int num_visited = 0;
+  typedef GrowableArray<BasicBlock*>::Iterator ChildIterator;
+  std::vector<std::pair<BasicBlock*, ChildIterator> > work_stack;
   bb->visited = true;
-  work_stack.push_back(std::make_pair(bb, new (arena_) ArenaBitVector::Iterator(bb->i_dominated)));
+  bb->dom_pre_order = num_visited++;
+  work_stack.push_back(std::make_pair(bb, ChildIterator(bb->i_dominated)));
   while (!work_stack.empty()) {
-    std::pair<BasicBlock*, ArenaBitVector::Iterator*> curr = work_stack.back();
-    BasicBlock* curr_bb = curr.first;
-    ArenaBitVector::Iterator* curr_idom_iter = curr.second;
-    int bb_idx = curr_idom_iter->Next();
-    while ((bb_idx != -1) && (NeedsVisit(GetBasicBlock(bb_idx)) == NULL)) {
-      bb_idx = curr_idom_iter->Next();
+    BasicBlock* curr_bb = work_stack.back().first;
+    ChildIterator* curr_idom_iter = &work_stack.back().second;
+    BasicBlock* new_bb = curr_idom_iter->Next();
+    while ((new_bb != NULL) && (NeedsVisit(new_bb) == NULL)) {
+      new_bb = curr_idom_iter->Next();
     }
-    if (bb_idx != -1) {
-      BasicBlock* new_bb = GetBasicBlock(bb_idx);
+    if (new_bb != NULL) {
       new_bb->visited = true;
-      work_stack.push_back(
-          std::make_pair(new_bb, new (arena_) ArenaBitVector::Iterator(new_bb->i_dominated)));
+      new_bb->dom_pre_order = num_visited++;
+      work_stack.push_back(std::make_pair(new_bb, ChildIterator(new_bb->i_dominated)));
     } else {
       // no successor/next
       dom_post_order_traversal_->Insert(curr_bb->id);
+      curr_bb->dom_last_descendant = num_visited - 1;
       work_stack.pop_back();
+    }
+  }
 
-      /* hacky loop detection */
-      if (curr_bb->taken && curr_bb->dominators->IsBitSet(curr_bb->taken->id)) {
-        attributes_ |= METHOD_HAS_LOOP;
-      }
+  /* hacky loop detection */
+  for (size_t i = 0; i < dom_post_order_traversal_->Size(); i++) {
+    BasicBlock* curr_bb = GetBasicBlock(dom_post_order_traversal_->Get(i));
+    if (curr_bb->taken && Dominates(curr_bb->taken, curr_bb)) {
+      attributes_ |= METHOD_HAS_LOOP;
     }
   }
 }
 
-void MIRGraph::CheckForDominanceFrontier(BasicBlock* dom_bb,
-                                         const BasicBlock* succ_bb) {
+/*
+ * Worker function to compute the dominance frontier, as in "A Simple, Fast Dominance
+ * Algorithm" by Cooper, Harvey and Kennedy: a join block is in the frontier of the blocks
+ * dominating one of its predecessors but not strictly dominating the join block.
+ */
+bool MIRGraph::ComputeDominanceFrontier(BasicBlock* bb) {
   /*
    * TODO - evaluate whether phi will ever need to be inserted into exit
    * blocks.
    */
-  if (succ_bb->i_dom != dom_bb &&
-    succ_bb->block_type == kDalvikByteCode &&
-    succ_bb->hidden == false) {
-    dom_bb->dom_frontier->SetBit(succ_bb->id);
-  }
-}
-
-/* Worker function to compute the dominance frontier */
-bool MIRGraph::ComputeDominanceFrontier(BasicBlock* bb) {
-  /* Calculate DF_local */
-  if (bb->taken) {
-    CheckForDominanceFrontier(bb, bb->taken);
-  }
-  if (bb->fall_through) {
-    CheckForDominanceFrontier(bb, bb->fall_through);
-  }
-  if (bb->successor_block_list.block_list_type != kNotUsed) {
-    GrowableArray<SuccessorBlockInfo*>::Iterator iterator(bb->successor_block_list.blocks);
-      while (true) {
-        SuccessorBlockInfo *successor_block_info = iterator.Next();
-        if (successor_block_info == NULL) {
-          break;
-        }
-        BasicBlock* succ_bb = successor_block_info->block;
-        CheckForDominanceFrontier(bb, succ_bb);
-      }
+  if (bb->predecessors->Size() < 2 || bb->block_type != kDalvikByteCode || bb->hidden) {
+    return false;
   }
-
-  /* Calculate DF_up */
-  ArenaBitVector::Iterator bv_iterator(bb->i_dominated);
-  while (true) {
-    // TUNING: hot call to BitVectorIteratorNext
-    int dominated_idx = bv_iterator.Next();
-    if (dominated_idx == -1) {
-      break;
+  GrowableArray<BasicBlock*>::Iterator iter(bb->predecessors);
+  for (BasicBlock* pred = iter.Next(); pred != NULL; pred = iter.Next()) {
+    if (pred->dom_pre_order == NOTVISITED) {
+      continue;
     }
-    BasicBlock* dominated_bb = GetBasicBlock(dominated_idx);
-    ArenaBitVector::Iterator df_iterator(dominated_bb->dom_frontier);
-    while (true) {
-      // TUNING: hot call to BitVectorIteratorNext
-      int df_up_idx = df_iterator.Next();
-      if (df_up_idx == -1) {
+    for (BasicBlock* runner = pred; runner != bb->i_dom; runner = runner->i_dom) {
+      GrowableArray<BasicBlock*>* frontier = runner->dom_frontier;
+      // The walk from another predecessor already went up from here.
+      if (frontier->Size() != 0 && frontier->Get(frontier->Size() - 1) == bb) {
         break;
       }
-      BasicBlock* df_up_block = GetBasicBlock(df_up_idx);
-      CheckForDominanceFrontier(bb, df_up_block);
+      frontier->Insert(bb);
     }
   }
-
-  return true;
+  return false;
 }
 
 /* Worker function for initializing domination-related data structures */
 void MIRGraph::InitializeDominationInfo(BasicBlock* bb) {
-  int num_total_blocks = GetBasicBlockListCount();
-
-  if (bb->dominators == NULL) {
-    bb->dominators = new (arena_) ArenaBitVector(arena_, num_total_blocks,
-                                                 false /* expandable */, kBitMapDominators);
-    bb->i_dominated = new (arena_) ArenaBitVector(arena_, num_total_blocks,
-                                                  false /* expandable */, kBitMapIDominated);
-    bb->dom_frontier = new (arena_) ArenaBitVector(arena_, num_total_blocks,
-                                                   false /* expandable */, kBitMapDomFrontier);
+  if (bb->i_dominated == NULL) {
+    bb->i_dominated = new (arena_) GrowableArray<BasicBlock*>(arena_, 2,
+                                                              kGrowableArrayIDominated);
+    bb->dom_frontier = new (arena_) GrowableArray<BasicBlock*>(arena_, 2,
+                                                               kGrowableArrayDomFrontier);
   } else {
-    bb->dominators->ClearAllBits();
-    bb->i_dominated->ClearAllBits();
-    bb->dom_frontier->ClearAllBits();
+    bb->i_dominated->Reset();
+    bb->dom_frontier->Reset();
   }
-  /* Set all bits in the dominator vector */
-  bb->dominators->SetInitialBits(num_total_blocks);
-
-  return;
 }
 
 /*
@@ -347,17 +317,6 @@ bool MIRGraph::ComputeblockIDom(BasicBlock* bb) {
   return false;
 }
 
-/* Worker function to compute each block's domintors */
-bool MIRGraph::ComputeBlockDominators(BasicBlock* bb) {
-  if (bb == GetEntryBlock()) {
-    bb->dominators->ClearAllBits();
-  } else {
-    bb->dominators->Copy(bb->i_dom->dominators);
-  }
-  bb->dominators->SetBit(bb->id);
-  return false;
-}
-
 bool MIRGraph::SetDominators(BasicBlock* bb) {
   if (bb != GetEntryBlock()) {
     int idom_dfs_idx = i_dom_list_[bb->dfs_id];
@@ -366,15 +325,24 @@ bool MIRGraph::SetDominators(BasicBlock* bb) {
     BasicBlock* i_dom = GetBasicBlock(i_dom_idx);
     bb->i_dom = i_dom;
     /* Add bb to the i_dominated set of the immediate dominator block */
-    i_dom->i_dominated->SetBit(bb->id);
+    i_dom->i_dominated->Insert(bb);
   }
   return false;
 }
 
-/* Compute dominators, immediate dominator, and dominance fronter */
+/*
+ * Compute the immediate dominators, and the dominance frontiers.  No block keeps the
+ * whole set of its dominators, Dominates() answers from the numbering of the dominator tree.
+ */
 void MIRGraph::ComputeDominators() {
   int num_reachable_blocks = num_reachable_blocks_;
-  int num_total_blocks = GetBasicBlockListCount();
+
+  /* Unreachable blocks keep this numbering */
+  AllNodesIterator all_iter(this, false /* not iterative */);
+  for (BasicBlock* bb = all_iter.Next(); bb != NULL; bb = all_iter.Next()) {
+    bb->dom_pre_order = NOTVISITED;
+    bb->dom_last_descendant = NOTVISITED;
+  }
 
   /* Initialize domination-related data structures */
   ReachableNodesIterator iter(this, false /* not iterative */);
@@ -402,16 +370,6 @@ void MIRGraph::ComputeDominators() {
     change = ComputeblockIDom(bb);
   }
 
-  /* Set the dominator for the root node */
-  GetEntryBlock()->dominators->ClearAllBits();
-  GetEntryBlock()->dominators->SetBit(GetEntryBlock()->id);
-
-  if (temp_block_v_ == NULL) {
-    temp_block_v_ = new (arena_) ArenaBitVector(arena_, num_total_blocks,
-                                                false /* expandable */, kBitMapTmpBlockV);
-  } else {
-    temp_block_v_->ClearAllBits();
-  }
   GetEntryBlock()->i_dom = NULL;
 
   ReachableNodesIterator iter3(this, false /* not iterative */);
@@ -419,22 +377,65 @@ void MIRGraph::ComputeDominators() {
     SetDominators(bb);
   }
 
-  ReversePostOrderDfsIterator iter4(this, false /* not iterative */);
+  // Number the dominator tree, then compute the dominance frontier for each block.
+  ComputeDomPostOrderTraversal(GetEntryBlock());
+  ReachableNodesIterator iter4(this, false /* not iterative */);
   for (BasicBlock* bb = iter4.Next(); bb != NULL; bb = iter4.Next()) {
-    ComputeBlockDominators(bb);
+    ComputeDominanceFrontier(bb);
   }
+}
 
-  // Compute the dominance frontier for each block.
-  ComputeDomPostOrderTraversal(GetEntryBlock());
-  PostOrderDOMIterator iter5(this, false /* not iterative */);
-  for (BasicBlock* bb = iter5.Next(); bb != NULL; bb = iter5.Next()) {
-    ComputeDominanceFrontier(bb);
+/*
+ * Set the nesting depth of every reachable block to the number of natural loops containing it.
+ * A loop is identified by its header, a block which dominates one of its predecessors, and
+ * contains every block which reaches such a back edge without passing through the header.  Loops
+ * sharing a header are counted once.  Requires the dominator info.
+ */
+void MIRGraph::ComputeLoopNestingDepths() {
+  ArenaBitVector* loop_blocks = new (arena_) ArenaBitVector(arena_, GetBasicBlockListCount(),
+                                                            false /* expandable */,
+                                                            kBitMapTmpBlocks);
+  std::vector<BasicBlock*> work_stack;
+  ReachableNodesIterator iter(this, false /* not iterative */);
+  for (BasicBlock* header = iter.Next(); header != NULL; header = iter.Next()) {
+    bool is_header = false;
+    loop_blocks->ClearAllBits();
+    loop_blocks->SetBit(header->id);
+    GrowableArray<BasicBlock*>::Iterator pred_iter(header->predecessors);
+    for (BasicBlock* pred = pred_iter.Next(); pred != NULL; pred = pred_iter.Next()) {
+      if (Dominates(header, pred)) {
+        // Back edge, possibly from the header itself.
+        is_header = true;
+        if (!loop_blocks->IsBitSet(pred->id)) {
+          loop_blocks->SetBit(pred->id);
+          work_stack.push_back(pred);
+        }
+      }
+    }
+    if (!is_header) {
+      continue;
+    }
+    while (!work_stack.empty()) {
+      BasicBlock* bb = work_stack.back();
+      work_stack.pop_back();
+      GrowableArray<BasicBlock*>::Iterator body_iter(bb->predecessors);
+      for (BasicBlock* pred = body_iter.Next(); pred != NULL; pred = body_iter.Next()) {
+        // Unreachable predecessors aren't part of the loop.
+        if (pred->dom_pre_order != NOTVISITED && !loop_blocks->IsBitSet(pred->id)) {
+          loop_blocks->SetBit(pred->id);
+          work_stack.push_back(pred);
+        }
+      }
+    }
+    ArenaBitVector::Iterator body_bits(loop_blocks);
+    for (int block_id = body_bits.Next(); block_id != -1; block_id = body_bits.Next()) {
+      GetBasicBlock(block_id)->nesting_depth++;
+    }
   }
 }
 
 /*
  * Perform dest U= src1 ^ ~src2
- * This is probably not general enough to be placed in BitVector.[ch].
  */
 void MIRGraph::ComputeSuccLineIn(ArenaBitVector* dest, const ArenaBitVector* src1,
                                  const ArenaBitVector* src2) {
@@ -445,10 +446,7 @@ void MIRGraph::ComputeSuccLineIn(ArenaBitVector* dest, const ArenaBitVector* src
     LOG(FATAL) << "Incompatible set properties";
   }
 
-  unsigned int idx;
-  for (idx = 0; idx < dest->GetStorageSize(); idx++) {
-    dest->GetRawStorage()[idx] |= src1->GetRawStorageWord(idx) & ~(src2->GetRawStorageWord(idx));
-  }
+  dest->UnionDifference(src1, src2);
 }
 
 /*
@@ -530,9 +528,11 @@ void MIRGraph::InsertPhiNodes() {
         BasicBlock* def_bb = GetBasicBlock(idx);
 
         /* Merge the dominance frontier to tmp_blocks */
-        // TUNING: hot call to Union().
         if (def_bb->dom_frontier != NULL) {
-          tmp_blocks->Union(def_bb->dom_frontier);
+          GrowableArray<BasicBlock*>::Iterator df_iter(def_bb->dom_frontier);
+          for (BasicBlock* df_bb = df_iter.Next(); df_bb != NULL; df_bb = df_iter.Next()) {
+            tmp_blocks->SetBit(df_bb->id);
+          }
         }
       }
       if (!phi_blocks->Equal(tmp_blocks)) {
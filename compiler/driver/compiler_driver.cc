@@ -19,19 +19,28 @@
 #define ATRACE_TAG ATRACE_TAG_DALVIK
 #include <utils/Trace.h>
 
+#include <algorithm>
+#include <ostream>
 #include <vector>
 #include <unistd.h>
 
 #include "base/stl_util.h"
 #include "base/timing_logger.h"
 #include "class_linker.h"
+#include "dex/method_compile_stats.h"
 #include "dex_compilation_unit.h"
 #include "dex_file-inl.h"
+#include "dex_instruction.h"
+#include "gc_map.h"
+#include "jit/jit.h"
 #include "jni_internal.h"
+#include "leb128.h"
+#include "mapping_table.h"
 #include "object_utils.h"
 #include "runtime.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap.h"
+#include "gc/heap.h"
 #include "gc/space/space.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
@@ -46,13 +55,14 @@
 #include "thread.h"
 #include "thread_pool.h"
 #include "trampolines/trampoline_compiler.h"
+#include "transaction.h"
 #include "verifier/method_verifier.h"
+#include "vmap_table.h"
 
 #if defined(ART_USE_PORTABLE_COMPILER)
 #include "elf_writer_mclinker.h"
-#else
-#include "elf_writer_quick.h"
 #endif
+#include "elf_writer_quick.h"
 
 namespace art {
 
@@ -76,8 +86,12 @@ class AOTCompilationStats {
         resolved_types_(0), unresolved_types_(0),
         resolved_instance_fields_(0), unresolved_instance_fields_(0),
         resolved_local_static_fields_(0), resolved_static_fields_(0), unresolved_static_fields_(0),
-        type_based_devirtualization_(0),
-        safe_casts_(0), not_safe_casts_(0) {
+        type_based_devirtualization_(0), leaf_method_devirtualization_(0),
+        safe_casts_(0), not_safe_casts_(0),
+        card_marks_eliminated_(0), card_marks_kept_(0),
+        methods_in_profile_(0), methods_not_in_profile_(0),
+        methods_reused_(0), methods_not_reused_(0),
+        methods_deduplicated_(0), methods_not_deduplicated_(0) {
     for (size_t i = 0; i <= kMaxInvokeType; i++) {
       resolved_methods_[i] = 0;
       unresolved_methods_[i] = 0;
@@ -97,6 +111,12 @@ class AOTCompilationStats {
     DumpStat(resolved_local_static_fields_, resolved_static_fields_ + unresolved_static_fields_,
              "static fields local to a class");
     DumpStat(safe_casts_, not_safe_casts_, "check-casts removed based on type information");
+    DumpStat(card_marks_eliminated_, card_marks_kept_, "reference store card marks removed");
+    DumpStat(methods_in_profile_, methods_not_in_profile_,
+             "methods compiled because they are in the profile");
+    DumpStat(methods_reused_, methods_not_reused_, "methods reused from the previous oat file");
+    DumpStat(methods_deduplicated_, methods_not_deduplicated_,
+             "methods copied from an identical method compiled before");
     // Note, the code below subtracts the stat value so that when added to the stat value we have
     // 100% of samples. TODO: clean this up.
     DumpStat(type_based_devirtualization_,
@@ -104,6 +124,10 @@ class AOTCompilationStats {
              resolved_methods_[kInterface] + unresolved_methods_[kInterface] -
              type_based_devirtualization_,
              "virtual/interface calls made direct based on type information");
+    DumpStat(leaf_method_devirtualization_,
+             resolved_methods_[kVirtual] + unresolved_methods_[kVirtual] -
+             leaf_method_devirtualization_,
+             "virtual calls made guarded direct calls to methods without overrides");
 
     for (size_t i = 0; i <= kMaxInvokeType; i++) {
       std::ostringstream oss;
@@ -201,6 +225,12 @@ class AOTCompilationStats {
     type_based_devirtualization_++;
   }
 
+  // Indicate that a virtual call was made a guarded direct call as its target has no override.
+  void LeafMethodDevirtualization() {
+    STATS_LOCK();
+    leaf_method_devirtualization_++;
+  }
+
   // Indicate that a method of the given type was resolved at compile time.
   void ResolvedMethod(InvokeType type) {
     DCHECK_LE(type, kMaxInvokeType);
@@ -250,6 +280,54 @@ class AOTCompilationStats {
     not_safe_casts_++;
   }
 
+  // A reference store was found to need no card mark.
+  void CardMarkEliminated() {
+    STATS_LOCK();
+    card_marks_eliminated_++;
+  }
+
+  // A reference store needs its card mark.
+  void CardMarkKept() {
+    STATS_LOCK();
+    card_marks_kept_++;
+  }
+
+  // A method was compiled as it is in the profile.
+  void MethodInProfile() {
+    STATS_LOCK();
+    methods_in_profile_++;
+  }
+
+  // A method which could have been compiled was left out as it isn't in the profile.
+  void MethodNotInProfile() {
+    STATS_LOCK();
+    methods_not_in_profile_++;
+  }
+
+  // The code of a method was copied from the previous oat file.
+  void MethodReused() {
+    STATS_LOCK();
+    methods_reused_++;
+  }
+
+  // A method changed, or one of its dependencies did, since the previous oat file.
+  void MethodNotReused() {
+    STATS_LOCK();
+    methods_not_reused_++;
+  }
+
+  // The code of a method was copied from a method with the same dedupe key.
+  void MethodDeduplicated() {
+    STATS_LOCK();
+    methods_deduplicated_++;
+  }
+
+  // A method was compiled, as none before had its dedupe key or its code may depend on its class.
+  void MethodNotDeduplicated() {
+    STATS_LOCK();
+    methods_not_deduplicated_++;
+  }
+
  private:
   Mutex stats_lock_;
 
@@ -270,6 +348,8 @@ class AOTCompilationStats {
   size_t unresolved_static_fields_;
   // Type based devirtualization for invoke interface and virtual.
   size_t type_based_devirtualization_;
+  // Guarded devirtualization of invoke virtual based on the class hierarchy.
+  size_t leaf_method_devirtualization_;
 
   size_t resolved_methods_[kMaxInvokeType + 1];
   size_t unresolved_methods_[kMaxInvokeType + 1];
@@ -280,6 +360,18 @@ class AOTCompilationStats {
   size_t safe_casts_;
   size_t not_safe_casts_;
 
+  size_t card_marks_eliminated_;
+  size_t card_marks_kept_;
+
+  size_t methods_in_profile_;
+  size_t methods_not_in_profile_;
+
+  size_t methods_reused_;
+  size_t methods_not_reused_;
+
+  size_t methods_deduplicated_;
+  size_t methods_not_deduplicated_;
+
   DISALLOW_COPY_AND_ASSIGN(AOTCompilationStats);
 };
 
@@ -337,12 +429,13 @@ extern "C" void compilerLLVMSetBitcodeFileName(art::CompilerDriver& driver,
 
 CompilerDriver::CompilerDriver(CompilerBackend compiler_backend, InstructionSet instruction_set,
                                bool image, DescriptorSet* image_classes, size_t thread_count,
-                               bool dump_stats)
+                               bool dump_stats, int swap_fd)
     : compiler_backend_(compiler_backend),
       instruction_set_(instruction_set),
       freezing_constructor_lock_("freezing constructor lock"),
       compiled_classes_lock_("compiled classes lock"),
       compiled_methods_lock_("compiled method lock"),
+      dedupe_methods_lock_("dedupe methods lock"),
       image_(image),
       image_classes_(image_classes),
       thread_count_(thread_count),
@@ -355,7 +448,13 @@ CompilerDriver::CompilerDriver(CompilerBackend compiler_backend, InstructionSet
       jni_compiler_(NULL),
       compiler_enable_auto_elf_loading_(NULL),
       compiler_get_method_code_addr_(NULL),
-      support_boot_image_fixup_(true) {
+      support_boot_image_fixup_(true),
+      snapshot_class_initialization_(false),
+      swap_space_(swap_fd == -1 ? NULL : new SwapSpace(swap_fd)),
+      dedupe_code_("dedupe code", SwapAllocator<uint8_t>(swap_space_.get())),
+      dedupe_mapping_table_("dedupe mapping table", SwapAllocator<uint8_t>(swap_space_.get())),
+      dedupe_vmap_table_("dedupe vmap table", SwapAllocator<uint8_t>(swap_space_.get())),
+      dedupe_gc_map_("dedupe gc map", SwapAllocator<uint8_t>(swap_space_.get())) {
 
   CHECK_PTHREAD_CALL(pthread_key_create, (&tls_key_, NULL), "compiler tls key");
 
@@ -394,19 +493,19 @@ CompilerDriver::CompilerDriver(CompilerBackend compiler_backend, InstructionSet
   }
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateCode(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateCode(const std::vector<uint8_t>& code) {
   return dedupe_code_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateMappingTable(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateMappingTable(const std::vector<uint8_t>& code) {
   return dedupe_mapping_table_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateVMapTable(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateVMapTable(const std::vector<uint8_t>& code) {
   return dedupe_vmap_table_.Add(Thread::Current(), code);
 }
 
-std::vector<uint8_t>* CompilerDriver::DeduplicateGCMap(const std::vector<uint8_t>& code) {
+SwapVector<uint8_t>* CompilerDriver::DeduplicateGCMap(const std::vector<uint8_t>& code) {
   return dedupe_gc_map_.Add(Thread::Current(), code);
 }
 
@@ -428,6 +527,10 @@ CompilerDriver::~CompilerDriver() {
     MutexLock mu(self, compiled_methods_lock_);
     STLDeleteElements(&methods_to_patch_);
   }
+  for (PreviousDexFileTable::iterator it = previous_dex_files_.begin();
+       it != previous_dex_files_.end(); ++it) {
+    delete it->second.second;
+  }
   CHECK_PTHREAD_CALL(pthread_key_delete, (tls_key_), "delete tls key");
   typedef void (*UninitCompilerContextFn)(CompilerDriver&);
   UninitCompilerContextFn uninit_compiler_context;
@@ -489,11 +592,39 @@ void CompilerDriver::CompileAll(jobject class_loader,
                                 const std::vector<const DexFile*>& dex_files,
                                 base::TimingLogger& timings) {
   DCHECK(!Runtime::Current()->IsStarted());
-  UniquePtr<ThreadPool> thread_pool(new ThreadPool(thread_count_ - 1));
+  UniquePtr<ThreadPool> thread_pool(new ThreadPool(thread_count_ - 1, true));
+  Runtime::Current()->SetUpThreadScheduling(thread_pool.get(), Runtime::kCompilerThreads);
   PreCompile(class_loader, dex_files, *thread_pool.get(), timings);
   Compile(class_loader, dex_files, *thread_pool.get(), timings);
   if (dump_stats_) {
     stats_->Dump();
+    Thread* self = Thread::Current();
+    LOG(INFO) << "Dedupe code: " << dedupe_code_.DumpStats(self);
+    LOG(INFO) << "Dedupe mapping tables: " << dedupe_mapping_table_.DumpStats(self);
+    LOG(INFO) << "Dedupe vmap tables: " << dedupe_vmap_table_.DumpStats(self);
+    LOG(INFO) << "Dedupe GC maps: " << dedupe_gc_map_.DumpStats(self);
+  }
+  if (method_compile_stats_.get() != NULL) {
+    LOG(INFO) << Dumpable<MethodCompileStatsTable>(*method_compile_stats_);
+  }
+}
+
+void CompilerDriver::EnableMethodCompileStats(size_t max_slowest_methods) {
+  method_compile_stats_.reset(new MethodCompileStatsTable(max_slowest_methods));
+}
+
+void CompilerDriver::SetPreviousOatFile(const OatFile* previous_oat_file) {
+  CHECK(RecordsDependencyHashes());
+  previous_oat_file_.reset(previous_oat_file);
+  std::vector<const OatFile::OatDexFile*> oat_dex_files = previous_oat_file->GetOatDexFiles();
+  for (size_t i = 0; i < oat_dex_files.size(); ++i) {
+    const DexFile* dex_file = oat_dex_files[i]->OpenDexFile();
+    if (dex_file == NULL) {
+      LOG(WARNING) << "Failed to open " << oat_dex_files[i]->GetDexFileLocation() << " from "
+                   << previous_oat_file->GetLocation() << ", its methods will be compiled";
+      continue;
+    }
+    previous_dex_files_.Put(dex_file->GetLocation(), std::make_pair(oat_dex_files[i], dex_file));
   }
 }
 
@@ -574,6 +705,149 @@ void CompilerDriver::CompileOne(const mirror::ArtMethod* method, base::TimingLog
   self->TransitionFromSuspendedToRunnable();
 }
 
+CompiledMethod* CompilerDriver::CompileJitMethod(Thread* self, mirror::ArtMethod* method) {
+  jobject jclass_loader;
+  const DexFile* dex_file;
+  uint16_t class_def_idx;
+  const DexFile::CodeItem* code_item;
+  uint32_t access_flags;
+  InvokeType invoke_type;
+  uint32_t method_idx = method->GetDexMethodIndex();
+  {
+    ScopedObjectAccess soa(self);
+    mirror::ClassLoader* class_loader = method->GetDeclaringClass()->GetClassLoader();
+    ScopedLocalRef<jobject>
+      local_class_loader(soa.Env(), soa.AddLocalReference<jobject>(class_loader));
+    jclass_loader = soa.Env()->NewGlobalRef(local_class_loader.get());
+    MethodHelper mh(method);
+    dex_file = &mh.GetDexFile();
+    class_def_idx = mh.GetClassDefIndex();
+    code_item = mh.GetCodeItem();
+    access_flags = method->GetAccessFlags();
+    invoke_type = method->GetInvokeType();
+    // The class was verified before the runtime kept the verifier's information for the
+    // compiler, verify the method again to get its GC map.
+    verifier::MethodVerifier verifier(dex_file, mh.GetDexCache(), class_loader,
+                                      &mh.GetClassDef(), code_item, method_idx, method,
+                                      access_flags, false, true);
+    if (!verifier.Verify()) {
+      soa.Env()->DeleteGlobalRef(jclass_loader);
+      return NULL;
+    }
+  }
+  CompileMethod(code_item, access_flags, invoke_type, class_def_idx, method_idx, jclass_loader,
+                *dex_file, kDontDexToDexCompile);
+  self->GetJniEnv()->DeleteGlobalRef(jclass_loader);
+
+  MutexLock mu(self, compiled_methods_lock_);
+  MethodTable::iterator it = compiled_methods_.find(MethodReference(dex_file, method_idx));
+  if (it == compiled_methods_.end()) {
+    return NULL;
+  }
+  CompiledMethod* compiled_method = it->second;
+  compiled_methods_.erase(it);
+  return compiled_method;
+}
+
+class ParallelCompilationManager {
+ public:
+  typedef void Callback(const ParallelCompilationManager* manager, size_t index);
+
+  ParallelCompilationManager(ClassLinker* class_linker,
+                             jobject class_loader,
+                             CompilerDriver* compiler,
+                             const DexFile* dex_file,
+                             ThreadPool& thread_pool)
+    : index_(0),
+      class_linker_(class_linker),
+      class_loader_(class_loader),
+      compiler_(compiler),
+      dex_file_(dex_file),
+      thread_pool_(&thread_pool) {}
+
+  ClassLinker* GetClassLinker() const {
+    CHECK(class_linker_ != NULL);
+    return class_linker_;
+  }
+
+  jobject GetClassLoader() const {
+    return class_loader_;
+  }
+
+  CompilerDriver* GetCompiler() const {
+    CHECK(compiler_ != NULL);
+    return compiler_;
+  }
+
+  const DexFile* GetDexFile() const {
+    CHECK(dex_file_ != NULL);
+    return dex_file_;
+  }
+
+  void ForAll(size_t begin, size_t end, Callback callback, size_t work_units) {
+    Thread* self = Thread::Current();
+    self->AssertNoPendingException();
+    CHECK_GT(work_units, 0U);
+
+    std::vector<ForAllClosure*> closures(work_units);
+    index_ = begin;
+    for (size_t i = 0; i < work_units; ++i) {
+      closures[i] = new ForAllClosure(this, end, callback);
+      thread_pool_->AddTask(self, closures[i]);
+    }
+    thread_pool_->StartWorkers(self);
+
+    // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
+    // thread destructor's called below perform join).
+    CHECK_NE(self->GetState(), kRunnable);
+
+    // Wait for all the worker threads to finish.
+    thread_pool_->Wait(self, true, false);
+  }
+
+  size_t NextIndex() {
+    return index_.fetch_add(1);
+  }
+
+ private:
+  class ForAllClosure : public Task {
+   public:
+    ForAllClosure(ParallelCompilationManager* manager, size_t end, Callback* callback)
+        : manager_(manager),
+          end_(end),
+          callback_(callback) {}
+
+    virtual void Run(Thread* self) {
+      while (true) {
+        const size_t index = manager_->NextIndex();
+        if (UNLIKELY(index >= end_)) {
+          break;
+        }
+        callback_(manager_, index);
+        self->AssertNoPendingException();
+      }
+    }
+
+    virtual void Finalize() {
+      delete this;
+    }
+
+   private:
+    ParallelCompilationManager* const manager_;
+    const size_t end_;
+    const Callback* const callback_;
+  };
+
+  AtomicInteger index_;
+  ClassLinker* const class_linker_;
+  const jobject class_loader_;
+  CompilerDriver* const compiler_;
+  const DexFile* const dex_file_;
+  ThreadPool* const thread_pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelCompilationManager);
+};
+
 void CompilerDriver::Resolve(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                              ThreadPool& thread_pool, base::TimingLogger& timings) {
   for (size_t i = 0; i != dex_files.size(); ++i) {
@@ -585,7 +859,7 @@ void CompilerDriver::Resolve(jobject class_loader, const std::vector<const DexFi
 
 void CompilerDriver::PreCompile(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                                 ThreadPool& thread_pool, base::TimingLogger& timings) {
-  LoadImageClasses(timings);
+  LoadImageClasses(thread_pool, timings);
 
   Resolve(class_loader, dex_files, thread_pool, timings);
 
@@ -593,9 +867,21 @@ void CompilerDriver::PreCompile(jobject class_loader, const std::vector<const De
 
   InitializeClasses(class_loader, dex_files, thread_pool, timings);
 
+  if (IsImage() && image_classes_.get() != NULL) {
+    for (const std::string& descriptor : snapshot_initialized_classes_) {
+      image_classes_->insert(descriptor);
+    }
+    VLOG(compiler) << "Snapshotted the initialization of " << snapshot_initialized_classes_.size()
+                   << " classes outside of the image classes";
+  }
+
   UpdateImageClasses(timings);
 }
 
+void CompilerDriver::AddSnapshotInitializedClass(const char* descriptor) {
+  snapshot_initialized_classes_.push_back(descriptor);
+}
+
 bool CompilerDriver::IsImageClass(const char* descriptor) const {
   DCHECK(descriptor != NULL);
   if (!IsImage()) {
@@ -643,20 +929,31 @@ static void ResolveExceptionsForMethod(MethodHelper* mh,
   }
 }
 
+// The classes whose catch blocks have been looked at, and the exception types they reference
+// that are still to be resolved.
+struct CatchBlockExceptions {
+  std::set<mirror::Class*> visited_classes;
+  std::set<std::pair<uint16_t, const DexFile*> > unresolved_types;
+};
+
 static bool ResolveCatchBlockExceptionsClassVisitor(mirror::Class* c, void* arg)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  std::set<std::pair<uint16_t, const DexFile*> >* exceptions_to_resolve =
-      reinterpret_cast<std::set<std::pair<uint16_t, const DexFile*> >*>(arg);
+  CatchBlockExceptions* exceptions = reinterpret_cast<CatchBlockExceptions*>(arg);
+  // Classes don't move and their catch blocks don't change, so only the classes loaded since the
+  // previous walk are looked at.
+  if (!exceptions->visited_classes.insert(c).second) {
+    return true;
+  }
   MethodHelper mh;
   for (size_t i = 0; i < c->NumVirtualMethods(); ++i) {
     mirror::ArtMethod* m = c->GetVirtualMethod(i);
     mh.ChangeMethod(m);
-    ResolveExceptionsForMethod(&mh, *exceptions_to_resolve);
+    ResolveExceptionsForMethod(&mh, exceptions->unresolved_types);
   }
   for (size_t i = 0; i < c->NumDirectMethods(); ++i) {
     mirror::ArtMethod* m = c->GetDirectMethod(i);
     mh.ChangeMethod(m);
-    ResolveExceptionsForMethod(&mh, *exceptions_to_resolve);
+    ResolveExceptionsForMethod(&mh, exceptions->unresolved_types);
   }
   return true;
 }
@@ -669,18 +966,48 @@ static bool RecordImageClassesVisitor(mirror::Class* klass, void* arg)
   return true;
 }
 
+// Loads the class of a class def of the boot class path if it is an image class. The image classes
+// of a dex file are loaded on all the threads, the class linker waiting for a class another
+// thread is loading.
+static void LoadImageClass(const ParallelCompilationManager* manager, size_t class_def_index)
+    LOCKS_EXCLUDED(Locks::mutator_lock_) {
+  const DexFile& dex_file = *manager->GetDexFile();
+  const char* descriptor = dex_file.GetClassDescriptor(dex_file.GetClassDef(class_def_index));
+  if (!manager->GetCompiler()->IsImageClass(descriptor)) {
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* klass = manager->GetClassLinker()->FindSystemClass(descriptor);
+  if (klass == NULL) {
+    // The serial pass after this one loads it again, which reports the failure and drops it.
+    soa.Self()->ClearException();
+  }
+}
+
 // Make a list of descriptors for classes to include in the image
-void CompilerDriver::LoadImageClasses(base::TimingLogger& timings)
+void CompilerDriver::LoadImageClasses(ThreadPool& thread_pool, base::TimingLogger& timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_) {
   if (!IsImage()) {
     return;
   }
 
+  // Load the classes explicitly listed in the file that have a class def in the boot class path
+  // in parallel, image_classes_ is only read until they are all loaded.
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  const std::vector<const DexFile*>& boot_class_path = class_linker->GetBootClassPath();
+  for (size_t i = 0; i != boot_class_path.size(); ++i) {
+    const DexFile* dex_file = boot_class_path[i];
+    ParallelCompilationManager context(class_linker, NULL, this, dex_file, thread_pool);
+    // TODO: strdup memory leak.
+    timings.NewSplit(strdup(("LoadImageClasses " + dex_file->GetLocation()).c_str()));
+    context.ForAll(0, dex_file->NumClassDefs(), LoadImageClass, thread_count_);
+  }
+
+  // Then look them all up, which loads the others, such as array classes, and drops those that
+  // can't be loaded.
   timings.NewSplit("LoadImageClasses");
-  // Make a first class to load all classes explicitly listed in the file
   Thread* self = Thread::Current();
   ScopedObjectAccess soa(self);
-  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   for (auto it = image_classes_->begin(), end = image_classes_->end(); it != end;) {
     std::string descriptor(*it);
     SirtRef<mirror::Class> klass(self, class_linker->FindSystemClass(descriptor.c_str()));
@@ -696,14 +1023,14 @@ void CompilerDriver::LoadImageClasses(base::TimingLogger& timings)
   // Resolve exception classes referenced by the loaded classes. The catch logic assumes
   // exceptions are resolved by the verifier when there is a catch block in an interested method.
   // Do this here so that exception classes appear to have been specified image classes.
-  std::set<std::pair<uint16_t, const DexFile*> > unresolved_exception_types;
+  timings.NewSplit("ResolveImageClassExceptions");
+  CatchBlockExceptions exceptions;
   SirtRef<mirror::Class> java_lang_Throwable(self,
                                      class_linker->FindSystemClass("Ljava/lang/Throwable;"));
   do {
-    unresolved_exception_types.clear();
-    class_linker->VisitClasses(ResolveCatchBlockExceptionsClassVisitor,
-                               &unresolved_exception_types);
-    for (const std::pair<uint16_t, const DexFile*>& exception_type : unresolved_exception_types) {
+    exceptions.unresolved_types.clear();
+    class_linker->VisitClasses(ResolveCatchBlockExceptionsClassVisitor, &exceptions);
+    for (const std::pair<uint16_t, const DexFile*>& exception_type : exceptions.unresolved_types) {
       uint16_t exception_type_idx = exception_type.first;
       const DexFile* dex_file = exception_type.second;
       mirror::DexCache* dex_cache = class_linker->FindDexCache(*dex_file);
@@ -719,11 +1046,12 @@ void CompilerDriver::LoadImageClasses(base::TimingLogger& timings)
     }
     // Resolving exceptions may load classes that reference more exceptions, iterate until no
     // more are found
-  } while (!unresolved_exception_types.empty());
+  } while (!exceptions.unresolved_types.empty());
 
   // We walk the roots looking for classes so that we'll pick up the
   // above classes plus any classes them depend on such super
   // classes, interfaces, and the required ClassLinker roots.
+  timings.NewSplit("RecordImageClasses");
   class_linker->VisitClasses(RecordImageClassesVisitor, image_classes_.get());
 
   CHECK_NE(image_classes_->size(), 0U);
@@ -754,13 +1082,13 @@ static void MaybeAddToImageClasses(mirror::Class* klass, CompilerDriver::Descrip
 void CompilerDriver::FindClinitImageClassesCallback(mirror::Object* object, void* arg) {
   DCHECK(object != NULL);
   DCHECK(arg != NULL);
-  CompilerDriver* compiler_driver = reinterpret_cast<CompilerDriver*>(arg);
-  MaybeAddToImageClasses(object->GetClass(), compiler_driver->image_classes_.get());
+  std::set<mirror::Class*>* classes = reinterpret_cast<std::set<mirror::Class*>*>(arg);
+  classes->insert(object->GetClass());
 }
 
 void CompilerDriver::UpdateImageClasses(base::TimingLogger& timings) {
   if (IsImage()) {
-    timings.NewSplit("UpdateImageClasses");
+    timings.NewSplit("FindClinitImageClasses");
 
     // Update image_classes_ with classes for objects created by <clinit> methods.
     Thread* self = Thread::Current();
@@ -769,7 +1097,15 @@ void CompilerDriver::UpdateImageClasses(base::TimingLogger& timings) {
     // TODO: Image spaces only?
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
     heap->FlushAllocStack();
-    heap->GetLiveBitmap()->Walk(FindClinitImageClassesCallback, this);
+    // The heap holds far more objects than classes, so the walk only collects the classes and the
+    // descriptors of each are looked up once.
+    std::set<mirror::Class*> classes;
+    heap->GetLiveBitmap()->Walk(FindClinitImageClassesCallback, &classes);
+
+    timings.NewSplit("UpdateImageClasses");
+    for (mirror::Class* klass : classes) {
+      MaybeAddToImageClasses(klass, image_classes_.get());
+    }
     self->EndAssertNoThreadSuspension(old_cause);
   }
 }
@@ -901,6 +1237,19 @@ static mirror::Class* ComputeCompilingMethodsClass(ScopedObjectAccess& soa,
                                               dex_cache, class_loader);
 }
 
+bool CompilerDriver::CanEliminateAllocation(const DexCompilationUnit* mUnit, uint32_t type_idx) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::DexCache* dex_cache = mUnit->GetClassLinker()->FindDexCache(*mUnit->GetDexFile());
+  mirror::Class* klass = dex_cache->GetResolvedType(type_idx);
+  if (klass == NULL) {
+    return false;
+  }
+  mirror::Class* referrer_class = ComputeCompilingMethodsClass(soa, dex_cache, mUnit);
+  return referrer_class != NULL && referrer_class->CanAccess(klass) && klass->IsInstantiable() &&
+      klass->IsInitialized() && !klass->IsFinalizable() && !klass->IsReferenceClass() &&
+      !klass->IsStringClass() && !klass->IsClassClass();
+}
+
 static mirror::ArtField* ComputeFieldReferencedFromCompilingMethod(ScopedObjectAccess& soa,
                                                                 const DexCompilationUnit* mUnit,
                                                                 uint32_t field_idx)
@@ -972,13 +1321,18 @@ bool CompilerDriver::ComputeInstanceFieldInfo(uint32_t field_idx, const DexCompi
 bool CompilerDriver::ComputeStaticFieldInfo(uint32_t field_idx, const DexCompilationUnit* mUnit,
                                             int& field_offset, int& ssb_index,
                                             bool& is_referrers_class, bool& is_volatile,
-                                            bool is_put) {
+                                            bool is_put, bool* is_initialized,
+                                            uintptr_t* direct_storage) {
   ScopedObjectAccess soa(Thread::Current());
   // Conservative defaults.
   field_offset = -1;
   ssb_index = -1;
   is_referrers_class = false;
   is_volatile = true;
+  if (is_initialized != NULL) {
+    *is_initialized = false;
+    *direct_storage = 0;
+  }
   // Try to resolve field and ignore if an Incompatible Class Change Error (ie isn't static).
   mirror::ArtField* resolved_field = ComputeFieldReferencedFromCompilingMethod(soa, mUnit, field_idx);
   if (resolved_field != NULL && resolved_field->IsStatic()) {
@@ -1024,6 +1378,10 @@ bool CompilerDriver::ComputeStaticFieldInfo(uint32_t field_idx, const DexCompila
             ssb_index = fields_class->GetDexTypeIndex();
             field_offset = resolved_field->GetOffset().Int32Value();
             is_volatile = resolved_field->IsVolatile();
+            if (is_initialized != NULL) {
+              ComputeStaticStorageInitialized(fields_class, dex_cache, ssb_index, is_initialized,
+                                              direct_storage);
+            }
             stats_->ResolvedStaticField();
             return true;
           }
@@ -1039,6 +1397,10 @@ bool CompilerDriver::ComputeStaticFieldInfo(uint32_t field_idx, const DexCompila
               ssb_index = mUnit->GetDexFile()->GetIndexForTypeId(*type_id);
               field_offset = resolved_field->GetOffset().Int32Value();
               is_volatile = resolved_field->IsVolatile();
+              if (is_initialized != NULL) {
+                ComputeStaticStorageInitialized(fields_class, dex_cache, ssb_index,
+                                                is_initialized, direct_storage);
+              }
               stats_->ResolvedStaticField();
               return true;
             }
@@ -1055,6 +1417,31 @@ bool CompilerDriver::ComputeStaticFieldInfo(uint32_t field_idx, const DexCompila
   return false;  // Incomplete knowledge needs slow path.
 }
 
+void CompilerDriver::ComputeStaticStorageInitialized(mirror::Class* fields_class,
+                                                     mirror::DexCache* dex_cache,
+                                                     int ssb_index, bool* is_initialized,
+                                                     uintptr_t* direct_storage) {
+  if (!fields_class->IsInitialized()) {
+    return;
+  }
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  bool compiling_boot = heap->GetContinuousSpaces().size() == 1;
+  if (compiling_boot) {
+    // The image writer keeps the static storage entries of the image classes initialized at
+    // compile time, entries of other dex caches are only filled in at run time.
+    ClassHelper kh(fields_class);
+    *is_initialized = IsImageClass(kh.GetDescriptor()) &&
+        dex_cache->GetInitializedStaticStorage()->Get(ssb_index) == fields_class;
+  } else {
+    gc::space::ContinuousSpace* space = heap->FindContinuousSpaceFromObject(fields_class, true);
+    if (space != NULL && space->IsImageSpace()) {
+      // A class of the boot image stays at its address, and stays initialized.
+      *is_initialized = true;
+      *direct_storage = reinterpret_cast<uintptr_t>(fields_class);
+    }
+  }
+}
+
 void CompilerDriver::GetCodeAndMethodForDirectCall(InvokeType type, InvokeType sharp_type,
                                                    mirror::Class* referrer_class,
                                                    mirror::ArtMethod* method,
@@ -1106,7 +1493,12 @@ void CompilerDriver::GetCodeAndMethodForDirectCall(InvokeType type, InvokeType s
     if (Runtime::Current()->GetHeap()->FindSpaceFromObject(method, false)->IsImageSpace()) {
       direct_method = reinterpret_cast<uintptr_t>(method);
     }
-    direct_code = reinterpret_cast<uintptr_t>(method->GetEntryPointFromCompiledCode());
+    const void* code = method->GetEntryPointFromCompiledCode();
+    // Calls to JIT code aren't patched when the code cache evicts it.
+    jit::Jit* jit = Runtime::Current()->GetJit();
+    if (jit == NULL || !jit->GetCodeCache()->Contains(code)) {
+      direct_code = reinterpret_cast<uintptr_t>(code);
+    }
   }
 }
 
@@ -1289,6 +1681,63 @@ bool CompilerDriver::ComputeInvokeInfo(const DexCompilationUnit* mUnit, const ui
   return false;  // Incomplete knowledge needs slow path.
 }
 
+bool CompilerDriver::IsLeafMethod(const DexCompilationUnit* mUnit,
+                                  const MethodReference& target_method) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::DexCache* dex_cache = mUnit->GetClassLinker()->FindDexCache(*target_method.dex_file);
+  mirror::ArtMethod* resolved_method =
+      dex_cache->GetResolvedMethod(target_method.dex_method_index);
+  // Every class of the compiled dex files is linked by the resolution pass, so the overridden
+  // flag covers the whole program being compiled. Classes loaded later set it at runtime, which
+  // is what the generated code checks.
+  if (resolved_method == NULL || resolved_method->IsAbstract() ||
+      resolved_method->IsOverridden() || resolved_method->GetDeclaringClass()->IsInterface()) {
+    return false;
+  }
+  stats_->LeafMethodDevirtualization();
+  return true;
+}
+
+const DexFile::CodeItem* CompilerDriver::ComputeInlineTarget(const DexCompilationUnit* mUnit,
+                                                             const uint32_t dex_pc,
+                                                             InvokeType type,
+                                                             uint32_t method_idx) {
+  MethodReference target_method(mUnit->GetDexFile(), method_idx);
+  int vtable_idx;
+  uintptr_t direct_code;
+  uintptr_t direct_method;
+  if (!ComputeInvokeInfo(mUnit, dex_pc, type, target_method, vtable_idx, direct_code,
+                         direct_method, false)) {
+    return NULL;
+  }
+  // Anything still dispatched may reach more than one method.
+  if ((type != kDirect && type != kStatic) || target_method.dex_file != mUnit->GetDexFile()) {
+    return NULL;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  // ComputeInvokeInfo resolved the target into the dex cache.
+  mirror::DexCache* dex_cache = mUnit->GetClassLinker()->FindDexCache(*mUnit->GetDexFile());
+  mirror::ArtMethod* target = dex_cache->GetResolvedMethod(target_method.dex_method_index);
+  if (target == NULL || target->IsNative() || target->IsAbstract() ||
+      target->IsSynchronized() || target->IsStatic() != (type == kStatic) ||
+      target->GetDeclaringClass()->GetDexCache()->GetDexFile() != mUnit->GetDexFile()) {
+    return NULL;
+  }
+  // Methods which aren't compiled may be quickened by the DEX-to-DEX compiler while we read them.
+  MethodReference target_ref(mUnit->GetDexFile(), target->GetDexMethodIndex());
+  if (!verifier::MethodVerifier::IsCandidateForCompilation(target_ref,
+                                                           target->GetAccessFlags())) {
+    return NULL;
+  }
+  if (target->IsStatic()) {
+    mirror::Class* referrer_class = ComputeCompilingMethodsClass(soa, dex_cache, mUnit);
+    if (target->GetDeclaringClass() != referrer_class) {
+      return NULL;
+    }
+  }
+  return mUnit->GetDexFile()->GetCodeItem(target->GetCodeItemOffset());
+}
+
 bool CompilerDriver::IsSafeCast(const MethodReference& mr, uint32_t dex_pc) {
   bool result = verifier::MethodVerifier::IsSafeCast(mr, dex_pc);
   if (result) {
@@ -1299,6 +1748,14 @@ bool CompilerDriver::IsSafeCast(const MethodReference& mr, uint32_t dex_pc) {
   return result;
 }
 
+void CompilerDriver::RecordCardMark(bool eliminated) {
+  if (eliminated) {
+    stats_->CardMarkEliminated();
+  } else {
+    stats_->CardMarkKept();
+  }
+}
+
 
 void CompilerDriver::AddCodePatch(const DexFile* dex_file,
                                   uint16_t referrer_class_def_idx,
@@ -1333,105 +1790,6 @@ void CompilerDriver::AddMethodPatch(const DexFile* dex_file,
                                                    literal_offset));
 }
 
-class ParallelCompilationManager {
- public:
-  typedef void Callback(const ParallelCompilationManager* manager, size_t index);
-
-  ParallelCompilationManager(ClassLinker* class_linker,
-                             jobject class_loader,
-                             CompilerDriver* compiler,
-                             const DexFile* dex_file,
-                             ThreadPool& thread_pool)
-    : index_(0),
-      class_linker_(class_linker),
-      class_loader_(class_loader),
-      compiler_(compiler),
-      dex_file_(dex_file),
-      thread_pool_(&thread_pool) {}
-
-  ClassLinker* GetClassLinker() const {
-    CHECK(class_linker_ != NULL);
-    return class_linker_;
-  }
-
-  jobject GetClassLoader() const {
-    return class_loader_;
-  }
-
-  CompilerDriver* GetCompiler() const {
-    CHECK(compiler_ != NULL);
-    return compiler_;
-  }
-
-  const DexFile* GetDexFile() const {
-    CHECK(dex_file_ != NULL);
-    return dex_file_;
-  }
-
-  void ForAll(size_t begin, size_t end, Callback callback, size_t work_units) {
-    Thread* self = Thread::Current();
-    self->AssertNoPendingException();
-    CHECK_GT(work_units, 0U);
-
-    std::vector<ForAllClosure*> closures(work_units);
-    index_ = begin;
-    for (size_t i = 0; i < work_units; ++i) {
-      closures[i] = new ForAllClosure(this, end, callback);
-      thread_pool_->AddTask(self, closures[i]);
-    }
-    thread_pool_->StartWorkers(self);
-
-    // Ensure we're suspended while we're blocked waiting for the other threads to finish (worker
-    // thread destructor's called below perform join).
-    CHECK_NE(self->GetState(), kRunnable);
-
-    // Wait for all the worker threads to finish.
-    thread_pool_->Wait(self, true, false);
-  }
-
-  size_t NextIndex() {
-    return index_.fetch_add(1);
-  }
-
- private:
-  class ForAllClosure : public Task {
-   public:
-    ForAllClosure(ParallelCompilationManager* manager, size_t end, Callback* callback)
-        : manager_(manager),
-          end_(end),
-          callback_(callback) {}
-
-    virtual void Run(Thread* self) {
-      while (true) {
-        const size_t index = manager_->NextIndex();
-        if (UNLIKELY(index >= end_)) {
-          break;
-        }
-        callback_(manager_, index);
-        self->AssertNoPendingException();
-      }
-    }
-
-    virtual void Finalize() {
-      delete this;
-    }
-
-   private:
-    ParallelCompilationManager* const manager_;
-    const size_t end_;
-    const Callback* const callback_;
-  };
-
-  AtomicInteger index_;
-  ClassLinker* const class_linker_;
-  const jobject class_loader_;
-  CompilerDriver* const compiler_;
-  const DexFile* const dex_file_;
-  ThreadPool* const thread_pool_;
-
-  DISALLOW_COPY_AND_ASSIGN(ParallelCompilationManager);
-};
-
 // Return true if the class should be skipped during compilation.
 //
 // The first case where we skip is for redundant class definitions in
@@ -2140,9 +2498,12 @@ static void InitializeClass(const ParallelCompilationManager* manager, size_t cl
         manager->GetClassLinker()->EnsureInitialized(klass, false, true);
         if (!klass->IsInitialized()) {
           // We need to initialize static fields, we only do this for image classes that aren't
-          // black listed or marked with the $NoPreloadHolder.
-          bool can_init_static_fields = manager->GetCompiler()->IsImage() &&
-              manager->GetCompiler()->IsImageClass(descriptor);
+          // black listed or marked with the $NoPreloadHolder. With class initialization
+          // snapshotting every other boot class is tried too.
+          CompilerDriver* driver = manager->GetCompiler();
+          bool is_image_class = driver->IsImageClass(descriptor);
+          bool can_init_static_fields = driver->IsImage() &&
+              (is_image_class || driver->GetSnapshotClassInitialization());
           if (can_init_static_fields) {
             // NoPreloadHolder inner class implies this should not be initialized early.
             bool is_black_listed = StringPiece(descriptor).ends_with("$NoPreloadHolder;");
@@ -2164,7 +2525,21 @@ static void InitializeClass(const ParallelCompilationManager* manager, size_t cl
                 fields->Get(0)->SetObj(klass, manager->GetClassLinker()->FindPrimitiveClass('V'));
                 klass->SetStatus(mirror::Class::kStatusInitialized, soa.Self());
               } else {
+                // Run the initializers in a transaction so that whatever they did can be undone
+                // if they fail or do something that can't be part of an image.
+                Transaction transaction;
+                soa.Self()->SetTransaction(&transaction);
                 manager->GetClassLinker()->EnsureInitialized(klass, true, true);
+                soa.Self()->SetTransaction(NULL);
+                if (transaction.IsAborted() || !klass->IsInitialized()) {
+                  VLOG(compiler) << "Rolling back initialization of " << descriptor << ": "
+                                 << (transaction.IsAborted() ? transaction.GetAbortMessage()
+                                                             : "initializer failed");
+                  transaction.Rollback();
+                  soa.Self()->ClearException();
+                } else if (!is_image_class) {
+                  driver->AddSnapshotInitializedClass(descriptor);
+                }
               }
             }
           }
@@ -2200,7 +2575,11 @@ void CompilerDriver::InitializeClasses(jobject jni_class_loader, const DexFile&
 #endif
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   ParallelCompilationManager context(class_linker, jni_class_loader, this, &dex_file, thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), InitializeClass, thread_count_);
+  // Initializers run in a transaction may be rolled back, until then other threads could observe
+  // their classes as initialized and use their statics or initialize subclasses on top of them.
+  // Image compiles, the only ones that run initializers in a transaction, use a single thread.
+  const size_t init_thread_count = IsImage() ? 1U : thread_count_;
+  context.ForAll(0, dex_file.NumClassDefs(), InitializeClass, init_thread_count);
 }
 
 void CompilerDriver::InitializeClasses(jobject class_loader,
@@ -2222,7 +2601,8 @@ void CompilerDriver::Compile(jobject class_loader, const std::vector<const DexFi
   }
 }
 
-void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, size_t class_def_index) {
+void CompilerDriver::CollectMethodsToCompile(const ParallelCompilationManager* manager,
+                                             size_t class_def_index) {
   ATRACE_CALL();
   jobject jclass_loader = manager->GetClassLoader();
   const DexFile& dex_file = *manager->GetDexFile();
@@ -2257,49 +2637,107 @@ void CompilerDriver::CompileClass(const ParallelCompilationManager* manager, siz
   while (it.HasNextInstanceField()) {
     it.Next();
   }
-  CompilerDriver* driver = manager->GetCompiler();
-  // Compile direct methods
-  int64_t previous_direct_method_idx = -1;
-  while (it.HasNextDirectMethod()) {
-    uint32_t method_idx = it.GetMemberIndex();
-    if (method_idx == previous_direct_method_idx) {
-      // smali can create dex files with two encoded_methods sharing the same method_idx
-      // http://code.google.com/p/smali/issues/detail?id=119
-      it.Next();
-      continue;
+  // Each class has its own vector, so threads collecting different classes don't race.
+  std::vector<MethodToCompile>& methods =
+      manager->GetCompiler()->class_methods_to_compile_[class_def_index];
+  // Direct methods, then virtual methods.
+  int64_t previous_method_idx = -1;
+  bool direct = true;
+  while (it.HasNextDirectMethod() || it.HasNextVirtualMethod()) {
+    if (direct && !it.HasNextDirectMethod()) {
+      direct = false;
+      previous_method_idx = -1;
     }
-    previous_direct_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
-    it.Next();
-  }
-  // Compile virtual methods
-  int64_t previous_virtual_method_idx = -1;
-  while (it.HasNextVirtualMethod()) {
     uint32_t method_idx = it.GetMemberIndex();
-    if (method_idx == previous_virtual_method_idx) {
+    if (method_idx == previous_method_idx) {
       // smali can create dex files with two encoded_methods sharing the same method_idx
       // http://code.google.com/p/smali/issues/detail?id=119
       it.Next();
       continue;
     }
-    previous_virtual_method_idx = method_idx;
-    driver->CompileMethod(it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
-                          it.GetMethodInvokeType(class_def), class_def_index,
-                          method_idx, jclass_loader, dex_file, dex_to_dex_compilation_level);
+    previous_method_idx = method_idx;
+    MethodToCompile method = { it.GetMethodCodeItem(), it.GetMemberAccessFlags(),
+                               it.GetMethodInvokeType(class_def),
+                               static_cast<uint16_t>(class_def_index), method_idx,
+                               dex_to_dex_compilation_level, 0 };
+    methods.push_back(method);
     it.Next();
   }
   DCHECK(!it.HasNext());
 }
 
+void CompilerDriver::CompileMethodToCompile(const ParallelCompilationManager* manager,
+                                            size_t index) {
+  ATRACE_CALL();
+  CompilerDriver* driver = manager->GetCompiler();
+  MethodToCompile& method = driver->methods_to_compile_[index];
+  uint64_t start_ns = NanoTime();
+  driver->CompileMethod(method.code_item, method.access_flags, method.invoke_type,
+                        method.class_def_idx, method.method_idx, manager->GetClassLoader(),
+                        *manager->GetDexFile(), method.dex_to_dex_compilation_level);
+  method.duration_ns = NanoTime() - start_ns;
+}
+
+// A method's number of code units stands for its compilation time, only known afterwards.
+static size_t CodeUnitsToCompile(const DexFile::CodeItem* code_item) {
+  return (code_item == NULL) ? 0 : code_item->insns_size_in_code_units_;
+}
+
 void CompilerDriver::CompileDexFile(jobject class_loader, const DexFile& dex_file,
                                     ThreadPool& thread_pool, base::TimingLogger& timings) {
   // TODO: strdup memory leak.
   timings.NewSplit(strdup(("Compile " + dex_file.GetLocation()).c_str()));
+  uint64_t start_ns = NanoTime();
   ParallelCompilationManager context(Runtime::Current()->GetClassLinker(), class_loader, this,
                                      &dex_file, thread_pool);
-  context.ForAll(0, dex_file.NumClassDefs(), CompilerDriver::CompileClass, thread_count_);
+  // A class is too coarse a unit of work: one with a large method, or many methods, would keep
+  // its thread compiling long after the others ran out of classes.
+  class_methods_to_compile_.resize(dex_file.NumClassDefs());
+  context.ForAll(0, dex_file.NumClassDefs(), CompilerDriver::CollectMethodsToCompile,
+                 thread_count_);
+  for (size_t i = 0; i < class_methods_to_compile_.size(); ++i) {
+    methods_to_compile_.insert(methods_to_compile_.end(), class_methods_to_compile_[i].begin(),
+                               class_methods_to_compile_[i].end());
+  }
+  class_methods_to_compile_.clear();
+  // Stable, so that the compilation order only depends on the dex file.
+  std::stable_sort(methods_to_compile_.begin(), methods_to_compile_.end(),
+                   [](const MethodToCompile& lhs, const MethodToCompile& rhs) {
+                     return CodeUnitsToCompile(lhs.code_item) > CodeUnitsToCompile(rhs.code_item);
+                   });
+  context.ForAll(0, methods_to_compile_.size(), CompilerDriver::CompileMethodToCompile,
+                 thread_count_);
+
+  CompileBalance balance;
+  balance.dex_file_location = dex_file.GetLocation();
+  balance.num_methods = methods_to_compile_.size();
+  balance.wall_ns = NanoTime() - start_ns;
+  balance.work_ns = 0;
+  balance.slowest_method_ns = 0;
+  for (size_t i = 0; i < methods_to_compile_.size(); ++i) {
+    const MethodToCompile& method = methods_to_compile_[i];
+    balance.work_ns += method.duration_ns;
+    if (method.duration_ns > balance.slowest_method_ns) {
+      balance.slowest_method_ns = method.duration_ns;
+      balance.slowest_method = PrettyMethod(method.method_idx, dex_file);
+    }
+  }
+  compile_balances_.push_back(balance);
+  methods_to_compile_.clear();
+}
+
+void CompilerDriver::DumpCompileBalance(std::ostream& os) const {
+  for (size_t i = 0; i < compile_balances_.size(); ++i) {
+    const CompileBalance& balance = compile_balances_[i];
+    os << "Compiled " << balance.num_methods << " methods of " << balance.dex_file_location
+       << " in " << PrettyDuration(balance.wall_ns) << " on " << thread_count_
+       << " threads, evenly spread " << PrettyDuration(balance.work_ns / thread_count_)
+       << ", slowest method " << PrettyDuration(balance.slowest_method_ns);
+    if (!balance.slowest_method.empty()) {
+      os << " " << balance.slowest_method;
+    }
+    os << "\n";
+  }
 }
 
 void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t access_flags,
@@ -2317,21 +2755,57 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
   } else {
     MethodReference method_ref(&dex_file, method_idx);
     bool compile = verifier::MethodVerifier::IsCandidateForCompilation(method_ref, access_flags);
+    if (compile && profiled_methods_.get() != NULL) {
+      compile = profiled_methods_->find(PrettyMethod(method_idx, dex_file)) !=
+          profiled_methods_->end();
+      if (compile) {
+        stats_->MethodInProfile();
+      } else {
+        stats_->MethodNotInProfile();
+      }
+    }
 
     if (compile) {
-      CompilerFn compiler = compiler_;
+      uint64_t dependency_hash = 0;
+      if (RecordsDependencyHashes()) {
+        dependency_hash = ComputeDependencyHash(code_item, access_flags, class_def_idx, method_idx,
+                                                class_loader, dex_file);
+        if (previous_oat_file_.get() != NULL) {
+          compiled_method = ReusePreviousCompiledMethod(class_def_idx, method_idx, dex_file,
+                                                        dependency_hash);
+        }
+      }
+      uint64_t dedupe_key = 0;
+      bool dedupe = false;
+      if (compiled_method == NULL && DeduplicatesMethods()) {
+        dedupe = ComputeDedupeKey(code_item, access_flags, class_def_idx, method_idx,
+                                  class_loader, dex_file, &dedupe_key);
+        if (dedupe) {
+          compiled_method = FindDeduplicatedMethod(dedupe_key, code_item);
+        }
+        if (compiled_method == NULL) {
+          stats_->MethodNotDeduplicated();
+        }
+      }
 #ifdef ART_SEA_IR_MODE
-      bool use_sea = Runtime::Current()->IsSeaIRMode();
-      use_sea = use_sea &&
-          (std::string::npos != PrettyMethod(method_idx, dex_file).find("fibonacci"));
-      if (use_sea) {
-        compiler = sea_ir_compiler_;
-        LOG(INFO) << "Using SEA IR to compile..." << std::endl;
+      // The SEA IR backend returns NULL for the methods it doesn't support yet.
+      if (compiled_method == NULL && sea_ir_compiler_ != NULL && hot_methods_.get() != NULL &&
+          hot_methods_->find(PrettyMethod(method_idx, dex_file)) != hot_methods_->end()) {
+        compiled_method = (*sea_ir_compiler_)(*this, code_item, access_flags, invoke_type,
+                                              class_def_idx, method_idx, class_loader, dex_file);
       }
 #endif
       // NOTE: if compiler declines to compile this method, it will return NULL.
-      compiled_method = (*compiler)(*this, code_item, access_flags, invoke_type, class_def_idx,
-                                    method_idx, class_loader, dex_file);
+      if (compiled_method == NULL) {
+        compiled_method = (*compiler_)(*this, code_item, access_flags, invoke_type, class_def_idx,
+                                       method_idx, class_loader, dex_file);
+        if (compiled_method != NULL && dedupe) {
+          AddDeduplicatedMethod(dedupe_key, code_item, compiled_method);
+        }
+      }
+      if (compiled_method != NULL) {
+        compiled_method->SetDependencyHash(dependency_hash);
+      }
     } else if (dex_to_dex_compilation_level != kDontDexToDexCompile) {
       // TODO: add a mode to disable DEX-to-DEX compilation ?
       (*dex_to_dex_compiler_)(*this, code_item, access_flags,
@@ -2369,6 +2843,441 @@ void CompilerDriver::CompileMethod(const DexFile::CodeItem* code_item, uint32_t
   }
 }
 
+// FNV-1a, 64 bits leave an accidental collision between two versions of a method unlikely.
+class DependencyHasher {
+ public:
+  DependencyHasher() : hash_(UINT64_C(14695981039346656037)) {}
+
+  void UpdateBytes(const void* data, size_t length) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * UINT64_C(1099511628211);
+    }
+  }
+
+  void UpdateWord(uint32_t word) {
+    UpdateBytes(&word, sizeof(word));
+  }
+
+  void UpdateString(const char* string) {
+    UpdateBytes(string, strlen(string) + 1);
+  }
+
+  // 0 stands for no hash.
+  uint64_t GetHash() const {
+    return (hash_ == 0) ? 1 : hash_;
+  }
+
+ private:
+  uint64_t hash_;
+};
+
+// Hashes a code item but for its debug info, which the compiled code doesn't depend on.
+static void HashCodeItem(const DexFile::CodeItem* code_item, DependencyHasher* hasher) {
+  hasher->UpdateWord(code_item->registers_size_);
+  hasher->UpdateWord(code_item->ins_size_);
+  hasher->UpdateWord(code_item->outs_size_);
+  hasher->UpdateWord(code_item->tries_size_);
+  hasher->UpdateWord(code_item->insns_size_in_code_units_);
+  hasher->UpdateBytes(code_item->insns_, code_item->insns_size_in_code_units_ * sizeof(uint16_t));
+  if (code_item->tries_size_ == 0) {
+    return;
+  }
+  // The try items are followed by the encoded catch handlers.
+  const byte* tries = reinterpret_cast<const byte*>(DexFile::GetTryItems(*code_item, 0));
+  const byte* handlers_end = DexFile::GetCatchHandlerData(*code_item, 0);
+  size_t num_encoded_catch_handlers = DecodeUnsignedLeb128(&handlers_end);
+  for (size_t i = 0; i < num_encoded_catch_handlers; ++i) {
+    int32_t encoded_catch_handler_size = DecodeSignedLeb128(&handlers_end);
+    for (int32_t j = 0; j < abs(encoded_catch_handler_size); ++j) {
+      DecodeUnsignedLeb128(&handlers_end);  // Type index.
+      DecodeUnsignedLeb128(&handlers_end);  // Address.
+    }
+    if (encoded_catch_handler_size <= 0) {
+      DecodeUnsignedLeb128(&handlers_end);  // Catch all address.
+    }
+  }
+  hasher->UpdateBytes(tries, handlers_end - tries);
+}
+
+// Hashes what the code compiled from dex_file may depend on of a class: its descriptor, access
+// flags and status, and the type index that finds it from dex_file.
+static void HashResolvedClass(const DexFile& dex_file, mirror::DexCache* dex_cache,
+                              mirror::Class* klass, DependencyHasher* hasher)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const char* descriptor = ClassHelper(klass).GetDescriptor();
+  hasher->UpdateString(descriptor);
+  hasher->UpdateWord(klass->GetAccessFlags());
+  hasher->UpdateWord(klass->GetStatus());
+  uint32_t type_idx = DexFile::kDexNoIndex;
+  if (klass->GetDexCache() == dex_cache) {
+    type_idx = klass->GetDexTypeIndex();
+  } else {
+    const DexFile::StringId* string_id = dex_file.FindStringId(descriptor);
+    if (string_id != NULL) {
+      const DexFile::TypeId* type_id =
+          dex_file.FindTypeId(dex_file.GetIndexForStringId(*string_id));
+      if (type_id != NULL) {
+        type_idx = dex_file.GetIndexForTypeId(*type_id);
+      }
+    }
+  }
+  hasher->UpdateWord(type_idx);
+}
+
+// Checks the references hashed for CompilerDriver::ComputeDedupeKey, whose code may be copied to
+// a method of another class. Access to a public member of a public class is the same from any
+// class, so the code only depends on whether a reference is to the referrer's own class.
+class ReferrerCheck {
+ public:
+  explicit ReferrerCheck(mirror::Class* referrer) : referrer_(referrer), independent_(true) {}
+
+  void CheckClass(mirror::Class* klass, uint32_t member_access_flags, DependencyHasher* hasher)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    hasher->UpdateWord(klass == referrer_);
+    if (!klass->IsPublic() || (member_access_flags & kAccPublic) == 0) {
+      independent_ = false;
+    }
+  }
+
+  void SetDependent() {
+    independent_ = false;
+  }
+
+  bool IsIndependent() const {
+    return independent_;
+  }
+
+ private:
+  mirror::Class* const referrer_;
+  bool independent_;
+};
+
+static void HashType(const DexFile& dex_file, mirror::DexCache* dex_cache,
+                     mirror::ClassLoader* class_loader, uint32_t type_idx,
+                     ReferrerCheck* check, DependencyHasher* hasher)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  hasher->UpdateString(dex_file.StringByTypeIdx(type_idx));
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::Class* klass = class_linker->ResolveType(dex_file, type_idx, dex_cache, class_loader);
+  if (klass == NULL) {
+    Thread::Current()->ClearException();
+    hasher->UpdateWord(0);
+    return;
+  }
+  HashResolvedClass(dex_file, dex_cache, klass, hasher);
+  if (check != NULL) {
+    check->CheckClass(klass, kAccPublic, hasher);
+  }
+}
+
+static void HashField(const DexFile& dex_file, mirror::DexCache* dex_cache,
+                      mirror::ClassLoader* class_loader, uint32_t field_idx, bool is_static,
+                      ReferrerCheck* check, DependencyHasher* hasher)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const DexFile::FieldId& field_id = dex_file.GetFieldId(field_idx);
+  hasher->UpdateString(dex_file.StringByTypeIdx(field_id.class_idx_));
+  hasher->UpdateString(dex_file.GetFieldName(field_id));
+  hasher->UpdateString(dex_file.GetFieldTypeDescriptor(field_id));
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::ArtField* field = class_linker->ResolveField(dex_file, field_idx, dex_cache,
+                                                       class_loader, is_static);
+  if (field == NULL) {
+    Thread::Current()->ClearException();
+    hasher->UpdateWord(0);
+    return;
+  }
+  hasher->UpdateWord(field->GetAccessFlags());
+  hasher->UpdateWord(field->GetOffset().Uint32Value());
+  HashResolvedClass(dex_file, dex_cache, field->GetDeclaringClass(), hasher);
+  if (check != NULL) {
+    check->CheckClass(field->GetDeclaringClass(), field->GetAccessFlags(), hasher);
+  }
+}
+
+// Also hashes the code of the methods of dex_file, which the compilation may copy into the caller.
+static void HashResolvedMethod(const DexFile& dex_file, mirror::DexCache* dex_cache,
+                               mirror::ArtMethod* method, DependencyHasher* hasher)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  hasher->UpdateWord(method->GetAccessFlags());
+  hasher->UpdateWord(method->GetMethodIndex());
+  hasher->UpdateWord(method->GetDexMethodIndex());
+  mirror::Class* declaring_class = method->GetDeclaringClass();
+  HashResolvedClass(dex_file, dex_cache, declaring_class, hasher);
+  if (declaring_class->GetDexCache() == dex_cache && method->GetCodeItemOffset() != 0) {
+    HashCodeItem(dex_file.GetCodeItem(method->GetCodeItemOffset()), hasher);
+  }
+}
+
+static void HashMethod(const DexFile& dex_file, mirror::DexCache* dex_cache,
+                       mirror::ClassLoader* class_loader, uint32_t method_idx, InvokeType type,
+                       ReferrerCheck* check, DependencyHasher* hasher)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  hasher->UpdateString(dex_file.StringByTypeIdx(method_id.class_idx_));
+  hasher->UpdateString(dex_file.GetMethodName(method_id));
+  hasher->UpdateString(dex_file.GetMethodSignature(method_id).c_str());
+  hasher->UpdateWord(type);
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::ArtMethod* method = class_linker->ResolveMethod(dex_file, method_idx, dex_cache,
+                                                          class_loader, NULL, type);
+  if (method == NULL) {
+    Thread::Current()->ClearException();
+    hasher->UpdateWord(0);
+    return;
+  }
+  HashResolvedMethod(dex_file, dex_cache, method, hasher);
+  if (check != NULL) {
+    check->CheckClass(method->GetDeclaringClass(), method->GetAccessFlags(), hasher);
+  }
+}
+
+// Hashes what the instructions of the code item reference. With a check, also finds whether the
+// compiled code would be the same in a method of another class.
+static void HashInstructions(const DexFile& dex_file, mirror::DexCache* dex_cache,
+                             mirror::ClassLoader* class_loader, const MethodReference& method_ref,
+                             const DexFile::CodeItem* code_item, ReferrerCheck* check,
+                             DependencyHasher* hasher)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const Instruction* inst = Instruction::At(code_item->insns_);
+  for (uint32_t dex_pc = 0; dex_pc < code_item->insns_size_in_code_units_;
+       dex_pc += inst->SizeInCodeUnits(), inst = inst->Next()) {
+    Instruction::Code opcode = inst->Opcode();
+    DecodedInstruction dec_insn(inst);
+    switch (opcode) {
+      case Instruction::CONST_STRING:
+      case Instruction::CONST_STRING_JUMBO:
+        hasher->UpdateString(dex_file.StringDataByIdx(dec_insn.vB));
+        break;
+      case Instruction::CHECK_CAST:
+        hasher->UpdateWord(verifier::MethodVerifier::IsSafeCast(method_ref, dex_pc));
+        // Fall-through.
+      case Instruction::CONST_CLASS:
+      case Instruction::NEW_INSTANCE:
+      case Instruction::FILLED_NEW_ARRAY:
+      case Instruction::FILLED_NEW_ARRAY_RANGE:
+        HashType(dex_file, dex_cache, class_loader, dec_insn.vB, check, hasher);
+        break;
+      case Instruction::INSTANCE_OF:
+      case Instruction::NEW_ARRAY:
+        HashType(dex_file, dex_cache, class_loader, dec_insn.vC, check, hasher);
+        break;
+      case Instruction::IGET ... Instruction::IPUT_SHORT:
+        HashField(dex_file, dex_cache, class_loader, dec_insn.vC, false, check, hasher);
+        break;
+      case Instruction::SGET ... Instruction::SPUT_SHORT:
+        HashField(dex_file, dex_cache, class_loader, dec_insn.vB, true, check, hasher);
+        break;
+      case Instruction::INVOKE_VIRTUAL:
+      case Instruction::INVOKE_VIRTUAL_RANGE:
+      case Instruction::INVOKE_INTERFACE:
+      case Instruction::INVOKE_INTERFACE_RANGE: {
+        InvokeType type = (opcode == Instruction::INVOKE_VIRTUAL ||
+                           opcode == Instruction::INVOKE_VIRTUAL_RANGE) ? kVirtual : kInterface;
+        HashMethod(dex_file, dex_cache, class_loader, dec_insn.vB, type, check, hasher);
+        // The verifier may have found the one method the call reaches.
+        const MethodReference* devirt_target =
+            verifier::MethodVerifier::GetDevirtMap(method_ref, dex_pc);
+        if (devirt_target != NULL) {
+          if (check == NULL) {
+            hasher->UpdateString(devirt_target->dex_file->GetLocation().c_str());
+            hasher->UpdateWord(devirt_target->dex_method_index);
+          } else if (devirt_target->dex_file != &dex_file) {
+            // Sharpening then looks the target up in the dex file of the referrer.
+            check->SetDependent();
+          }
+          if (devirt_target->dex_file == &dex_file) {
+            HashMethod(dex_file, dex_cache, class_loader, devirt_target->dex_method_index,
+                       kDirect, check, hasher);
+          }
+        }
+        break;
+      }
+      case Instruction::INVOKE_SUPER:
+      case Instruction::INVOKE_SUPER_RANGE:
+        // Sharpening depends on the referrer's superclasses.
+        if (check != NULL) {
+          check->SetDependent();
+        }
+        HashMethod(dex_file, dex_cache, class_loader, dec_insn.vB, kSuper, check, hasher);
+        break;
+      case Instruction::INVOKE_DIRECT:
+      case Instruction::INVOKE_DIRECT_RANGE:
+        HashMethod(dex_file, dex_cache, class_loader, dec_insn.vB, kDirect, check, hasher);
+        break;
+      case Instruction::INVOKE_STATIC:
+      case Instruction::INVOKE_STATIC_RANGE:
+        HashMethod(dex_file, dex_cache, class_loader, dec_insn.vB, kStatic, check, hasher);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+uint64_t CompilerDriver::ComputeDependencyHash(const DexFile::CodeItem* code_item,
+                                               uint32_t access_flags, uint16_t class_def_idx,
+                                               uint32_t method_idx, jobject jclass_loader,
+                                               const DexFile& dex_file) {
+  DependencyHasher hasher;
+  hasher.UpdateWord(instruction_set_);
+  hasher.UpdateString(instruction_set_features_.c_str());
+  hasher.UpdateWord(method_idx);
+  hasher.UpdateWord(access_flags);
+  HashCodeItem(code_item, &hasher);
+
+  MethodReference method_ref(&dex_file, method_idx);
+  const std::vector<uint8_t>* dex_gc_map = verifier::MethodVerifier::GetDexGcMap(method_ref);
+  if (dex_gc_map != NULL) {
+    hasher.UpdateBytes(&(*dex_gc_map)[0], dex_gc_map->size());
+  }
+
+  ScopedObjectAccess soa(Thread::Current());
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::DexCache* dex_cache = class_linker->FindDexCache(dex_file);
+  mirror::ClassLoader* class_loader = soa.Decode<mirror::ClassLoader*>(jclass_loader);
+  HashType(dex_file, dex_cache, class_loader, dex_file.GetClassDef(class_def_idx).class_idx_,
+           NULL, &hasher);
+  HashInstructions(dex_file, dex_cache, class_loader, method_ref, code_item, NULL, &hasher);
+  return hasher.GetHash();
+}
+
+bool CompilerDriver::ComputeDedupeKey(const DexFile::CodeItem* code_item, uint32_t access_flags,
+                                      uint16_t class_def_idx, uint32_t method_idx,
+                                      jobject jclass_loader, const DexFile& dex_file,
+                                      uint64_t* key) {
+  DependencyHasher hasher;
+  hasher.UpdateWord(access_flags);
+  const DexFile::MethodId& method_id = dex_file.GetMethodId(method_idx);
+  hasher.UpdateString(dex_file.GetMethodShorty(method_id));
+  HashCodeItem(code_item, &hasher);
+  if ((access_flags & kAccConstructor) != 0) {
+    hasher.UpdateWord(RequiresConstructorBarrier(Thread::Current(), &dex_file, class_def_idx));
+  }
+
+  MethodReference method_ref(&dex_file, method_idx);
+  const std::vector<uint8_t>* dex_gc_map = verifier::MethodVerifier::GetDexGcMap(method_ref);
+  if (dex_gc_map != NULL) {
+    hasher.UpdateBytes(&(*dex_gc_map)[0], dex_gc_map->size());
+  }
+
+  ScopedObjectAccess soa(Thread::Current());
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::DexCache* dex_cache = class_linker->FindDexCache(dex_file);
+  mirror::ClassLoader* class_loader = soa.Decode<mirror::ClassLoader*>(jclass_loader);
+  mirror::Class* referrer = class_linker->ResolveType(dex_file, method_id.class_idx_, dex_cache,
+                                                      class_loader);
+  if (referrer == NULL) {
+    soa.Self()->ClearException();
+    return false;
+  }
+  ReferrerCheck check(referrer);
+  HashInstructions(dex_file, dex_cache, class_loader, method_ref, code_item, &check, &hasher);
+  *key = hasher.GetHash();
+  return check.IsIndependent();
+}
+
+// Rules out a collision of the dedupe keys of methods with different code.
+static bool CodeItemsEqual(const DexFile::CodeItem* a, const DexFile::CodeItem* b) {
+  return a->registers_size_ == b->registers_size_ && a->ins_size_ == b->ins_size_ &&
+      a->outs_size_ == b->outs_size_ && a->tries_size_ == b->tries_size_ &&
+      a->insns_size_in_code_units_ == b->insns_size_in_code_units_ &&
+      memcmp(a->insns_, b->insns_, a->insns_size_in_code_units_ * sizeof(uint16_t)) == 0;
+}
+
+CompiledMethod* CompilerDriver::FindDeduplicatedMethod(uint64_t key,
+                                                       const DexFile::CodeItem* code_item) {
+  const CompiledMethod* compiled_method = NULL;
+  {
+    MutexLock mu(Thread::Current(), dedupe_methods_lock_);
+    DedupeMethodTable::const_iterator it = dedupe_methods_.find(key);
+    if (it != dedupe_methods_.end() && CodeItemsEqual(it->second.first, code_item)) {
+      compiled_method = it->second.second;
+    }
+  }
+  if (compiled_method == NULL) {
+    return NULL;
+  }
+  stats_->MethodDeduplicated();
+  // The copy points at the same deduplicated arrays, so the oat writer gives it the same code.
+  return new CompiledMethod(*compiled_method);
+}
+
+void CompilerDriver::AddDeduplicatedMethod(uint64_t key, const DexFile::CodeItem* code_item,
+                                           const CompiledMethod* compiled_method) {
+  MutexLock mu(Thread::Current(), dedupe_methods_lock_);
+  // Another thread may have compiled the same method meanwhile, either copy will do.
+  if (dedupe_methods_.find(key) == dedupe_methods_.end()) {
+    dedupe_methods_.Put(key, std::make_pair(code_item, compiled_method));
+  }
+}
+
+CompiledMethod* CompilerDriver::ReusePreviousCompiledMethod(uint16_t class_def_idx,
+                                                            uint32_t method_idx,
+                                                            const DexFile& dex_file,
+                                                            uint64_t dependency_hash) {
+  PreviousDexFileTable::const_iterator it = previous_dex_files_.find(dex_file.GetLocation());
+  uint64_t previous_hash;
+  if (it == previous_dex_files_.end() ||
+      !it->second.first->FindMethodDependencyHash(method_idx, &previous_hash) ||
+      previous_hash != dependency_hash) {
+    stats_->MethodNotReused();
+    return NULL;
+  }
+  // The hash covers the descriptor of the class and the method index, which find the method in
+  // the previous dex file.
+  const OatFile::OatDexFile* previous_oat_dex_file = it->second.first;
+  const DexFile* previous_dex_file = it->second.second;
+  const char* descriptor = dex_file.GetClassDescriptor(dex_file.GetClassDef(class_def_idx));
+  const DexFile::ClassDef* previous_class_def = previous_dex_file->FindClassDef(descriptor);
+  CHECK(previous_class_def != NULL) << PrettyMethod(method_idx, dex_file);
+  ClassDataItemIterator class_it(*previous_dex_file,
+                                 previous_dex_file->GetClassData(*previous_class_def));
+  while (class_it.HasNextStaticField() || class_it.HasNextInstanceField()) {
+    class_it.Next();
+  }
+  // Direct methods come first, followed by virtual methods, as in the OatClass.
+  size_t class_def_method_index = 0;
+  while (class_it.HasNext() && class_it.GetMemberIndex() != method_idx) {
+    ++class_def_method_index;
+    class_it.Next();
+  }
+  CHECK(class_it.HasNext()) << PrettyMethod(method_idx, dex_file);
+  uint16_t previous_class_def_idx = previous_dex_file->GetIndexForClassDef(*previous_class_def);
+  UniquePtr<const OatFile::OatClass> previous_oat_class(
+      previous_oat_dex_file->GetOatClass(previous_class_def_idx));
+  const OatFile::OatMethod previous_oat_method =
+      previous_oat_class->GetOatMethod(class_def_method_index);
+  if (previous_oat_method.GetCode() == NULL) {
+    stats_->MethodNotReused();
+    return NULL;
+  }
+
+  // Thumb2 code pointers have the low bit set, see CompiledCode::CodeDelta.
+  const uint8_t* code = reinterpret_cast<const uint8_t*>(
+      reinterpret_cast<uintptr_t>(previous_oat_method.GetCode()) & ~static_cast<uintptr_t>(1));
+  std::vector<uint8_t> code_copy(code, code + previous_oat_method.GetCodeSize());
+  const uint8_t* mapping_table = previous_oat_method.GetMappingTable();
+  std::vector<uint8_t> mapping_table_copy(mapping_table, mapping_table +
+                                          MappingTable(mapping_table).EncodedSize());
+  std::vector<uint8_t> vmap_table_copy;
+  const uint8_t* vmap_table = previous_oat_method.GetVmapTable();
+  if (vmap_table != NULL) {
+    vmap_table_copy.assign(vmap_table, vmap_table + VmapTable(vmap_table).EncodedSize());
+  }
+  std::vector<uint8_t> gc_map_copy;
+  const uint8_t* gc_map = previous_oat_method.GetNativeGcMap();
+  if (gc_map != NULL) {
+    gc_map_copy.assign(gc_map, gc_map + NativePcOffsetToReferenceMap(gc_map).EncodedSize());
+  }
+  stats_->MethodReused();
+  return new CompiledMethod(*this, instruction_set_, code_copy,
+                            previous_oat_method.GetFrameSizeInBytes(),
+                            previous_oat_method.GetCoreSpillMask(),
+                            previous_oat_method.GetFpSpillMask(),
+                            mapping_table_copy, vmap_table_copy, gc_map_copy);
+}
+
 CompiledClass* CompilerDriver::GetCompiledClass(ClassReference ref) const {
   MutexLock mu(Thread::Current(), compiled_classes_lock_);
   ClassTable::const_iterator it = compiled_classes_.find(ref);
@@ -2444,7 +3353,23 @@ bool CompilerDriver::WriteElf(const std::string& android_root,
                               art::File* file)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
 #if defined(ART_USE_PORTABLE_COMPILER)
-  return art::ElfWriterMclinker::Create(file, oat_writer, dex_files, android_root, is_host, *this);
+  // MCLinker is only needed for the methods ElfObjectLinker couldn't link.
+  bool has_elf_objects = false;
+  {
+    MutexLock mu(Thread::Current(), compiled_methods_lock_);
+    for (MethodTable::const_iterator it = compiled_methods_.begin();
+         it != compiled_methods_.end(); ++it) {
+      if (it->second->IsElfObject()) {
+        has_elf_objects = true;
+        break;
+      }
+    }
+  }
+  if (has_elf_objects) {
+    return art::ElfWriterMclinker::Create(file, oat_writer, dex_files, android_root, is_host,
+                                          *this);
+  }
+  return art::ElfWriterQuick::Create(file, oat_writer, dex_files, android_root, is_host, *this);
 #else
   return art::ElfWriterQuick::Create(file, oat_writer, dex_files, android_root, is_host, *this);
 #endif
@@ -17,30 +17,34 @@
 #ifndef ART_COMPILER_DRIVER_COMPILER_DRIVER_H_
 #define ART_COMPILER_DRIVER_COMPILER_DRIVER_H_
 
+#include <iosfwd>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "base/arena_allocator.h"
 #include "base/mutex.h"
 #include "class_reference.h"
 #include "compiled_class.h"
 #include "compiled_method.h"
 #include "dex_file.h"
-#include "dex/arena_allocator.h"
 #include "instruction_set.h"
 #include "invoke_type.h"
 #include "method_reference.h"
+#include "oat_file.h"
 #include "os.h"
 #include "runtime.h"
 #include "safe_map.h"
 #include "thread_pool.h"
 #include "utils/dedupe_set.h"
+#include "utils/swap_space.h"
 
 namespace art {
 
 class AOTCompilationStats;
 class ParallelCompilationManager;
 class DexCompilationUnit;
+class MethodCompileStatsTable;
 class OatWriter;
 class TimingLogger;
 
@@ -70,29 +74,37 @@ enum DexToDexCompilationLevel {
 // Thread-local storage compiler worker threads
 class CompilerTls {
   public:
-    CompilerTls() : llvm_info_(NULL) {}
+    CompilerTls() : llvm_info_(NULL), llvm_compilation_unit_(NULL) {}
     ~CompilerTls() {}
 
     void* GetLLVMInfo() { return llvm_info_; }
 
     void SetLLVMInfo(void* llvm_info) { llvm_info_ = llvm_info; }
 
+    void* GetLlvmCompilationUnit() { return llvm_compilation_unit_; }
+
+    void SetLlvmCompilationUnit(void* cunit) { llvm_compilation_unit_ = cunit; }
+
   private:
     void* llvm_info_;
+    void* llvm_compilation_unit_;
 };
 
 class CompilerDriver {
  public:
   typedef std::set<std::string> DescriptorSet;
+  // Methods named as by PrettyMethod, with signature.
+  typedef std::set<std::string> MethodSet;
 
   // Create a compiler targeting the requested "instruction_set".
   // "image" should be true if image specific optimizations should be
   // enabled.  "image_classes" lets the compiler know what classes it
   // can assume will be in the image, with NULL implying all available
-  // classes.
+  // classes. If "swap_fd" isn't -1 the compiled code and tables are kept in the file it opens,
+  // which the driver takes ownership of, see SwapSpace.
   explicit CompilerDriver(CompilerBackend compiler_backend, InstructionSet instruction_set,
                           bool image, DescriptorSet* image_classes,
-                          size_t thread_count, bool dump_stats);
+                          size_t thread_count, bool dump_stats, int swap_fd = -1);
 
   ~CompilerDriver();
 
@@ -104,6 +116,11 @@ class CompilerDriver {
   void CompileOne(const mirror::ArtMethod* method, base::TimingLogger& timings)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Compile a single method of a running runtime for the JIT. Returns NULL if the method isn't
+  // compiled, the caller owns the result.
+  CompiledMethod* CompileJitMethod(Thread* self, mirror::ArtMethod* method)
+      LOCKS_EXCLUDED(Locks::mutator_lock_, compiled_methods_lock_);
+
   InstructionSet GetInstructionSet() const {
     return instruction_set_;
   }
@@ -121,6 +138,41 @@ class CompilerDriver {
     return image_classes_.get();
   }
 
+  // Only compile the given methods with the compiler backend, others are left to the interpreter
+  // or DEX-to-DEX compiled. NULL, the default, compiles all methods. Takes ownership.
+  void SetProfiledMethods(MethodSet* profiled_methods) {
+    profiled_methods_.reset(profiled_methods);
+  }
+
+  const MethodSet* GetProfiledMethods() const {
+    return profiled_methods_.get();
+  }
+
+  // Copies the code of the methods of a previous compilation of the same dex files whose
+  // dependency hash didn't change rather than compiling them again. previous_oat_file must have
+  // been written by the same compiler against the same boot image. Takes ownership.
+  void SetPreviousOatFile(const OatFile* previous_oat_file);
+
+  // Hot methods to compile with the SEA IR optimizing backend in SEA IR builds, the backend
+  // falls back to compiler_ for those it can't handle. Takes ownership.
+  void SetHotMethods(MethodSet* hot_methods) {
+    hot_methods_.reset(hot_methods);
+  }
+
+  // Records the time of each quick compilation by pass, dumped by CompileAll with the
+  // max_slowest_methods slowest compilations.
+  void EnableMethodCompileStats(size_t max_slowest_methods);
+
+  // NULL unless enabled.
+  MethodCompileStatsTable* GetMethodCompileStats() const {
+    return method_compile_stats_.get();
+  }
+
+  // Dumps how well the compilation of each dex file kept the threads busy: its time, the time
+  // of its slowest method, which is the critical path nothing can compile faster than, and the
+  // time it would take with the work spread evenly over the threads.
+  void DumpCompileBalance(std::ostream& os) const;
+
   CompilerTls* GetTls();
 
   // Generate the trampolines that are invoked by unresolved direct methods.
@@ -169,16 +221,27 @@ class CompilerDriver {
                                               uint32_t type_idx)
      LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // May a new-instance of type_idx be removed when the object never escapes? True if the class
+  // is known, initialized and accessible to the referrer, and isn't finalizable or treated
+  // specially by the runtime, so that allocating it has no effect besides creating the object.
+  bool CanEliminateAllocation(const DexCompilationUnit* mUnit, uint32_t type_idx)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   // Can we fast path instance field access? Computes field's offset and volatility.
   bool ComputeInstanceFieldInfo(uint32_t field_idx, const DexCompilationUnit* mUnit,
                                 int& field_offset, bool& is_volatile, bool is_put)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   // Can we fastpath static field access? Computes field's offset, volatility and whether the
-  // field is within the referrer (which can avoid checking class initialization).
+  // field is within the referrer (which can avoid checking class initialization). If
+  // is_initialized is given, it is set when the field's class is known to be initialized whenever
+  // the code runs, so that its storage base needs no check, and then direct_storage is set to the
+  // address of the class if it is in the boot image, or to 0 if its entry in the static storage
+  // of the referrer's dex cache is filled in.
   bool ComputeStaticFieldInfo(uint32_t field_idx, const DexCompilationUnit* mUnit,
                               int& field_offset, int& ssb_index,
-                              bool& is_referrers_class, bool& is_volatile, bool is_put)
+                              bool& is_referrers_class, bool& is_volatile, bool is_put,
+                              bool* is_initialized = NULL, uintptr_t* direct_storage = NULL)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   // Can we fastpath a interface, super class or virtual method call? Computes method's vtable
@@ -188,8 +251,25 @@ class CompilerDriver {
                          uintptr_t& direct_code, uintptr_t& direct_method, bool update_stats)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // Is the target of a fast path virtual call, as computed by ComputeInvokeInfo, overridden by no
+  // class linked so far? If so, the call may go directly to the target provided the generated
+  // code falls back to the vtable once the runtime links a class overriding it.
+  bool IsLeafMethod(const DexCompilationUnit* mUnit, const MethodReference& target_method)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Returns the code item of the method called at dex_pc if it may be copied into the caller, NULL
+  // otherwise. The call must have a single possible target declared in the caller's dex file.
+  // Static targets must belong to the caller's class so no class initialization is skipped.
+  const DexFile::CodeItem* ComputeInlineTarget(const DexCompilationUnit* mUnit,
+                                               const uint32_t dex_pc, InvokeType type,
+                                               uint32_t method_idx)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   bool IsSafeCast(const MethodReference& mr, uint32_t dex_pc);
 
+  // Records whether the card mark of a reference store could be left out.
+  void RecordCardMark(bool eliminated);
+
   // Record patch information for later fix up.
   void AddCodePatch(const DexFile* dex_file,
                     uint16_t referrer_class_def_idx,
@@ -218,6 +298,29 @@ class CompilerDriver {
     support_boot_image_fixup_ = support_boot_image_fixup;
   }
 
+  bool GetSnapshotClassInitialization() const {
+    return snapshot_class_initialization_;
+  }
+
+  // When compiling an image, also tries to run the class initializers of classes that aren't
+  // image classes, and adds those that complete without rolling back to the image.
+  void SetSnapshotClassInitialization(bool snapshot_class_initialization) {
+    snapshot_class_initialization_ = snapshot_class_initialization;
+  }
+
+  // Called by InitializeClasses for a class it initialized under snapshotting.
+  void AddSnapshotInitializedClass(const char* descriptor);
+
+  const std::string& GetInstructionSetFeatures() const {
+    return instruction_set_features_;
+  }
+
+  // Comma separated features of the target cores, such as the "cortex-a15" core the ARM
+  // backend schedules for. Empty, the default, targets a generic core.
+  void SetInstructionSetFeatures(const std::string& instruction_set_features) {
+    instruction_set_features_ = instruction_set_features;
+  }
+
   ArenaPool& GetArenaPool() {
     return arena_pool_;
   }
@@ -313,12 +416,18 @@ class CompilerDriver {
   void RecordClassStatus(ClassReference ref, mirror::Class::Status status)
       LOCKS_EXCLUDED(compiled_classes_lock_);
 
-  std::vector<uint8_t>* DeduplicateCode(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateMappingTable(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateVMapTable(const std::vector<uint8_t>& code);
-  std::vector<uint8_t>* DeduplicateGCMap(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateCode(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateMappingTable(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateVMapTable(const std::vector<uint8_t>& code);
+  SwapVector<uint8_t>* DeduplicateGCMap(const std::vector<uint8_t>& code);
 
  private:
+  // Sets is_initialized, and direct_storage, as ComputeStaticFieldInfo describes.
+  void ComputeStaticStorageInitialized(mirror::Class* fields_class, mirror::DexCache* dex_cache,
+                                       int ssb_index, bool* is_initialized,
+                                       uintptr_t* direct_storage)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Compute constant code and method pointers when possible
   void GetCodeAndMethodForDirectCall(InvokeType type, InvokeType sharp_type,
                                      mirror::Class* referrer_class,
@@ -331,7 +440,8 @@ class CompilerDriver {
                   ThreadPool& thread_pool, base::TimingLogger& timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
-  void LoadImageClasses(base::TimingLogger& timings);
+  void LoadImageClasses(ThreadPool& thread_pool, base::TimingLogger& timings)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   // Attempt to resolve all type, methods, fields, and strings
   // referenced from code in the dex file following PathClassLoader
@@ -371,7 +481,73 @@ class CompilerDriver {
                      DexToDexCompilationLevel dex_to_dex_compilation_level)
       LOCKS_EXCLUDED(compiled_methods_lock_);
 
-  static void CompileClass(const ParallelCompilationManager* context, size_t class_def_index)
+  // Only the Quick code of apps is recorded with a dependency hash and reused.
+  bool RecordsDependencyHashes() const {
+    return !image_ && compiler_backend_ == kQuick;
+  }
+
+  // Hashes the code item of a method the backend is about to compile together with what the
+  // compilation may depend on outside of it: the classes, fields and methods it references as
+  // they resolve, the code of the methods it calls from its dex file, and what the verifier
+  // found. Resolves the references like the compilation would.
+  uint64_t ComputeDependencyHash(const DexFile::CodeItem* code_item, uint32_t access_flags,
+                                 uint16_t class_def_idx, uint32_t method_idx,
+                                 jobject class_loader, const DexFile& dex_file)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Returns a copy of the code of the method in the previous oat file if it was recorded with
+  // dependency_hash, NULL otherwise.
+  CompiledMethod* ReusePreviousCompiledMethod(uint16_t class_def_idx, uint32_t method_idx,
+                                              const DexFile& dex_file, uint64_t dependency_hash);
+
+  // Only Quick methods are compiled once for all the methods with the same dedupe key.
+  bool DeduplicatesMethods() const {
+    return compiler_backend_ == kQuick;
+  }
+
+  // Hashes what the compiled code of a method depends on like ComputeDependencyHash, but for the
+  // method itself and its class, into key. Returns false if the code could still differ in a
+  // method of another class: the method references what isn't public, calls a super method, or
+  // has a devirtualized call to another dex file.
+  bool ComputeDedupeKey(const DexFile::CodeItem* code_item, uint32_t access_flags,
+                        uint16_t class_def_idx, uint32_t method_idx, jobject class_loader,
+                        const DexFile& dex_file, uint64_t* key)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  // Returns a copy of the method compiled before with key and an identical code item, NULL if
+  // there is none.
+  CompiledMethod* FindDeduplicatedMethod(uint64_t key, const DexFile::CodeItem* code_item)
+      LOCKS_EXCLUDED(dedupe_methods_lock_);
+  void AddDeduplicatedMethod(uint64_t key, const DexFile::CodeItem* code_item,
+                             const CompiledMethod* compiled_method)
+      LOCKS_EXCLUDED(dedupe_methods_lock_);
+
+  // A method of the dex file being compiled, the unit of parallel work of Compile.
+  struct MethodToCompile {
+    const DexFile::CodeItem* code_item;
+    uint32_t access_flags;
+    InvokeType invoke_type;
+    uint16_t class_def_idx;
+    uint32_t method_idx;
+    DexToDexCompilationLevel dex_to_dex_compilation_level;
+    // Only written by the thread compiling the method.
+    uint64_t duration_ns;
+  };
+
+  struct CompileBalance {
+    std::string dex_file_location;
+    size_t num_methods;
+    uint64_t wall_ns;
+    uint64_t work_ns;
+    uint64_t slowest_method_ns;
+    std::string slowest_method;
+  };
+
+  // Collects the methods of a class that are compiled into class_methods_to_compile_.
+  static void CollectMethodsToCompile(const ParallelCompilationManager* context,
+                                      size_t class_def_index)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+  static void CompileMethodToCompile(const ParallelCompilationManager* context, size_t index)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   std::vector<const PatchInformation*> code_to_patch_;
@@ -395,6 +571,12 @@ class CompilerDriver {
   mutable Mutex compiled_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   MethodTable compiled_methods_ GUARDED_BY(compiled_methods_lock_);
 
+  typedef SafeMap<uint64_t, std::pair<const DexFile::CodeItem*, const CompiledMethod*> >
+      DedupeMethodTable;
+  // The first method compiled with each dedupe key, owned by compiled_methods_.
+  Mutex dedupe_methods_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  DedupeMethodTable dedupe_methods_ GUARDED_BY(dedupe_methods_lock_);
+
   const bool image_;
 
   // If image_ is true, specifies the classes that will be included in
@@ -402,13 +584,35 @@ class CompilerDriver {
   // included in the image.
   UniquePtr<DescriptorSet> image_classes_;
 
+  // If not NULL, the only methods compiled by compiler_.
+  UniquePtr<MethodSet> profiled_methods_;
+
+  // If not NULL, the methods tried with sea_ir_compiler_ first.
+  UniquePtr<MethodSet> hot_methods_;
+
+  // If not NULL, the oat file whose code is reused for the methods with unchanged dependency
+  // hashes, and its OatDexFiles with the dex files they were compiled from, which are owned, by
+  // dex file location.
+  UniquePtr<const OatFile> previous_oat_file_;
+  typedef SafeMap<std::string, std::pair<const OatFile::OatDexFile*, const DexFile*> >
+      PreviousDexFileTable;
+  PreviousDexFileTable previous_dex_files_;
+
   size_t thread_count_;
   uint64_t start_ns_;
 
+  // The methods of the dex file CompileDexFile is compiling, by class def index as they are
+  // collected, then largest first so that no thread is left with a large method at the end.
+  std::vector<std::vector<MethodToCompile> > class_methods_to_compile_;
+  std::vector<MethodToCompile> methods_to_compile_;
+  std::vector<CompileBalance> compile_balances_;
+
   UniquePtr<AOTCompilationStats> stats_;
 
   bool dump_stats_;
 
+  UniquePtr<MethodCompileStatsTable> method_compile_stats_;
+
   typedef void (*CompilerCallbackFn)(CompilerDriver& driver);
   typedef MutexLock* (*CompilerMutexLockFn)(CompilerDriver& driver);
 
@@ -454,31 +658,39 @@ class CompilerDriver {
 
   bool support_boot_image_fixup_;
 
+  // Classes initialized because of snapshot_class_initialization_, added to image_classes_ once
+  // InitializeClasses is done. Only touched while holding the class initialization ObjectLock.
+  bool snapshot_class_initialization_;
+  std::vector<std::string> snapshot_initialized_classes_;
+
+  std::string instruction_set_features_;
+
+  // Where the byte arrays below are allocated, NULL for the heap. Outlives them.
+  UniquePtr<SwapSpace> swap_space_;
+
   // DeDuplication data structures, these own the corresponding byte arrays.
   class DedupeHashFunc {
    public:
     size_t operator()(const std::vector<uint8_t>& array) const {
-      // Take a random sample of bytes.
-      static const size_t kSmallArrayThreshold = 16;
-      static const size_t kRandomHashCount = 16;
-      size_t hash = 0;
-      if (array.size() < kSmallArrayThreshold) {
-        for (auto c : array) {
-          hash = hash * 54 + c;
-        }
-      } else {
-        for (size_t i = 0; i < kRandomHashCount; ++i) {
-          size_t r = i * 1103515245 + 12345;
-          hash = hash * 54 + array[r % array.size()];
-        }
+      // FNV-1a over every byte, a sample of bytes collides for code differing in a few immediates.
+      // The final mix spreads the low bits into the top ones, which pick the shard.
+      uint32_t hash = 2166136261u;
+      for (uint8_t c : array) {
+        hash = (hash ^ c) * 16777619u;
       }
+      hash ^= hash >> 15;
+      hash *= 0x85ebca6bu;
+      hash ^= hash >> 13;
       return hash;
     }
   };
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc> dedupe_code_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc> dedupe_mapping_table_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc> dedupe_vmap_table_;
-  DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc> dedupe_gc_map_;
+  static const size_t kDedupeShards = 16;
+  typedef DedupeSet<std::vector<uint8_t>, size_t, DedupeHashFunc, kDedupeShards,
+                    SwapVector<uint8_t> > ByteArraySet;
+  ByteArraySet dedupe_code_;
+  ByteArraySet dedupe_mapping_table_;
+  ByteArraySet dedupe_vmap_table_;
+  ByteArraySet dedupe_gc_map_;
 
   DISALLOW_COPY_AND_ASSIGN(CompilerDriver);
 };
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "elf_object_linker.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <llvm/Support/ELF.h>
+
+#include "base/logging.h"
+#include "globals.h"
+#include "utils.h"
+
+namespace art {
+
+// Marks a section that isn't part of the linked code.
+static const uint32_t kNotLaidOut = 0xFFFFFFFF;
+
+static uint16_t ReadHalf(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+static void WriteHalf(uint8_t* p, uint16_t value) {
+  p[0] = value & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+}
+
+static uint32_t ReadWord(const uint8_t* p) {
+  return ReadHalf(p) | (static_cast<uint32_t>(ReadHalf(p + 2)) << 16);
+}
+
+static void WriteWord(uint8_t* p, uint32_t value) {
+  WriteHalf(p, value & 0xFFFF);
+  WriteHalf(p + 2, value >> 16);
+}
+
+static int32_t SignExtend(uint32_t value, int bits) {
+  uint32_t sign = 1U << (bits - 1);
+  return static_cast<int32_t>((value ^ sign) - sign);
+}
+
+static size_t MaxCodeAlignment(InstructionSet instruction_set) {
+  switch (instruction_set) {
+    case kArm:
+    case kThumb2:
+      return kArmAlignment;
+    case kMips:
+      return kMipsAlignment;
+    case kX86:
+      return kX86Alignment;
+    default:
+      return 0;
+  }
+}
+
+// Applies a relocation of the given type at location, where symbol and place are offsets from
+// the start of the linked code. The addend is the one held at location, all of the targets use
+// SHT_REL relocations.
+static bool ApplyRelocation(InstructionSet instruction_set, uint32_t type, uint8_t* location,
+                            uint32_t symbol, uint32_t place) {
+  switch (instruction_set) {
+    case kArm:
+    case kThumb2:
+      switch (type) {
+        case llvm::ELF::R_ARM_NONE:
+        case llvm::ELF::R_ARM_V4BX:
+          return true;
+        case llvm::ELF::R_ARM_REL32:
+          WriteWord(location, symbol + ReadWord(location) - place);
+          return true;
+        case llvm::ELF::R_ARM_CALL:
+        case llvm::ELF::R_ARM_JUMP24: {
+          // ARM code calling ARM code, a Thumb target would need the call changed to a BLX.
+          if (instruction_set != kArm) {
+            return false;
+          }
+          uint32_t insn = ReadWord(location);
+          int32_t addend = SignExtend(insn & 0xFFFFFF, 24) * 4;
+          int32_t value = symbol + addend - place;
+          if (!IsInt(26, value)) {
+            return false;
+          }
+          WriteWord(location, (insn & 0xFF000000) | ((value >> 2) & 0xFFFFFF));
+          return true;
+        }
+        case llvm::ELF::R_ARM_THM_CALL:
+        case llvm::ELF::R_ARM_THM_JUMP24: {
+          // Thumb code calling Thumb code, a BLX to ARM code isn't expected.
+          uint16_t upper = ReadHalf(location);
+          uint16_t lower = ReadHalf(location + 2);
+          if (instruction_set != kThumb2 || (lower & 0x1000) == 0) {
+            return false;
+          }
+          uint32_t s = (upper >> 10) & 1;
+          uint32_t i1 = ~((lower >> 13) ^ s) & 1;
+          uint32_t i2 = ~((lower >> 11) ^ s) & 1;
+          uint32_t offset = (s << 24) | (i1 << 23) | (i2 << 22) | ((upper & 0x3FF) << 12) |
+              ((lower & 0x7FF) << 1);
+          int32_t value = (symbol & ~1U) + SignExtend(offset, 25) - place;
+          if (!IsInt(25, value)) {
+            return false;
+          }
+          s = (value >> 24) & 1;
+          uint32_t j1 = (((value >> 23) & 1) ^ 1) ^ s;
+          uint32_t j2 = (((value >> 22) & 1) ^ 1) ^ s;
+          WriteHalf(location, (upper & 0xF800) | (s << 10) | ((value >> 12) & 0x3FF));
+          WriteHalf(location + 2,
+                    (lower & 0xD000) | (j1 << 13) | (j2 << 11) | ((value >> 1) & 0x7FF));
+          return true;
+        }
+        default:
+          return false;
+      }
+    case kX86:
+      switch (type) {
+        case llvm::ELF::R_386_NONE:
+          return true;
+        case llvm::ELF::R_386_PC32:
+        case llvm::ELF::R_386_PLT32:
+          WriteWord(location, symbol + ReadWord(location) - place);
+          return true;
+        default:
+          return false;
+      }
+    case kMips:
+      return type == llvm::ELF::R_MIPS_NONE;
+    default:
+      return false;
+  }
+}
+
+bool ElfObjectLinker::Link(const std::string& elf_object, const std::string& symbol,
+                           InstructionSet instruction_set, std::vector<uint8_t>* code) {
+  const uint8_t* begin = reinterpret_cast<const uint8_t*>(elf_object.data());
+  size_t size = elf_object.size();
+  if (size < sizeof(llvm::ELF::Elf32_Ehdr)) {
+    return false;
+  }
+  const llvm::ELF::Elf32_Ehdr& header = *reinterpret_cast<const llvm::ELF::Elf32_Ehdr*>(begin);
+  if (!header.checkMagic() ||
+      header.e_ident[llvm::ELF::EI_CLASS] != llvm::ELF::ELFCLASS32 ||
+      header.e_ident[llvm::ELF::EI_DATA] != llvm::ELF::ELFDATA2LSB ||
+      header.e_type != llvm::ELF::ET_REL ||
+      header.e_shentsize != sizeof(llvm::ELF::Elf32_Shdr) ||
+      header.e_shoff + header.e_shnum * sizeof(llvm::ELF::Elf32_Shdr) > size) {
+    LOG(WARNING) << "Unexpected ELF object for " << symbol;
+    return false;
+  }
+  const llvm::ELF::Elf32_Shdr* sections =
+      reinterpret_cast<const llvm::ELF::Elf32_Shdr*>(begin + header.e_shoff);
+  for (size_t i = 0; i < header.e_shnum; ++i) {
+    if (sections[i].sh_type != llvm::ELF::SHT_NOBITS &&
+        sections[i].sh_offset + sections[i].sh_size > size) {
+      LOG(WARNING) << "Truncated ELF object for " << symbol;
+      return false;
+    }
+  }
+
+  // Find the method's symbol.
+  const llvm::ELF::Elf32_Shdr* symtab = NULL;
+  for (size_t i = 0; i < header.e_shnum; ++i) {
+    if (sections[i].sh_type == llvm::ELF::SHT_SYMTAB) {
+      symtab = &sections[i];
+      break;
+    }
+  }
+  if (symtab == NULL || symtab->sh_link >= header.e_shnum) {
+    return false;
+  }
+  const llvm::ELF::Elf32_Sym* symbols =
+      reinterpret_cast<const llvm::ELF::Elf32_Sym*>(begin + symtab->sh_offset);
+  size_t num_symbols = symtab->sh_size / sizeof(llvm::ELF::Elf32_Sym);
+  const char* names = reinterpret_cast<const char*>(begin + sections[symtab->sh_link].sh_offset);
+  size_t names_size = sections[symtab->sh_link].sh_size;
+  const llvm::ELF::Elf32_Sym* method_symbol = NULL;
+  for (size_t i = 0; i < num_symbols; ++i) {
+    if (symbols[i].st_name < names_size && symbols[i].st_shndx != llvm::ELF::SHN_UNDEF &&
+        symbols[i].st_shndx < header.e_shnum && symbol == names + symbols[i].st_name) {
+      method_symbol = &symbols[i];
+      break;
+    }
+  }
+  // The code must start at the symbol, a Thumb symbol has the low bit set.
+  if (method_symbol == NULL || (method_symbol->st_value & ~1U) != 0) {
+    VLOG(compiler) << "Linking " << symbol << " with MCLinker, it doesn't start its section";
+    return false;
+  }
+
+  // Lay out the section holding the method followed by the other allocated sections, other than
+  // the unwinding tables the runtime doesn't use.
+  size_t max_alignment = MaxCodeAlignment(instruction_set);
+  std::vector<uint32_t> section_offsets(header.e_shnum, kNotLaidOut);
+  uint32_t code_size = 0;
+  for (size_t pass = 0; pass < 2; ++pass) {
+    for (size_t i = 0; i < header.e_shnum; ++i) {
+      const llvm::ELF::Elf32_Shdr& section = sections[i];
+      if ((pass == 0) != (i == method_symbol->st_shndx) ||
+          (section.sh_flags & llvm::ELF::SHF_ALLOC) == 0 ||
+          section.sh_type == llvm::ELF::SHT_ARM_EXIDX ||
+          section.sh_size == 0) {
+        continue;
+      }
+      if ((section.sh_flags & llvm::ELF::SHF_WRITE) != 0 ||
+          section.sh_type == llvm::ELF::SHT_NOBITS ||
+          section.sh_addralign > max_alignment) {
+        VLOG(compiler) << "Linking " << symbol << " with MCLinker, it needs section " << i;
+        return false;
+      }
+      section_offsets[i] = RoundUp(code_size, std::max(section.sh_addralign, 1U));
+      code_size = section_offsets[i] + section.sh_size;
+    }
+  }
+  if (section_offsets[method_symbol->st_shndx] != 0) {
+    return false;
+  }
+  code->assign(code_size, 0);
+  for (size_t i = 0; i < header.e_shnum; ++i) {
+    if (section_offsets[i] != kNotLaidOut) {
+      memcpy(&(*code)[section_offsets[i]], begin + sections[i].sh_offset, sections[i].sh_size);
+    }
+  }
+
+  // Apply the relocations of the sections laid out.
+  for (size_t i = 0; i < header.e_shnum; ++i) {
+    const llvm::ELF::Elf32_Shdr& section = sections[i];
+    if ((section.sh_type != llvm::ELF::SHT_REL && section.sh_type != llvm::ELF::SHT_RELA) ||
+        section.sh_info >= header.e_shnum || section_offsets[section.sh_info] == kNotLaidOut) {
+      continue;
+    }
+    if (section.sh_type == llvm::ELF::SHT_RELA) {
+      VLOG(compiler) << "Linking " << symbol << " with MCLinker, it has RELA relocations";
+      return false;
+    }
+    const llvm::ELF::Elf32_Rel* relocations =
+        reinterpret_cast<const llvm::ELF::Elf32_Rel*>(begin + section.sh_offset);
+    size_t num_relocations = section.sh_size / sizeof(llvm::ELF::Elf32_Rel);
+    uint32_t target_offset = section_offsets[section.sh_info];
+    uint32_t target_size = sections[section.sh_info].sh_size;
+    for (size_t j = 0; j < num_relocations; ++j) {
+      const llvm::ELF::Elf32_Rel& relocation = relocations[j];
+      if (relocation.getSymbol() >= num_symbols || relocation.r_offset + 4 > target_size) {
+        return false;
+      }
+      const llvm::ELF::Elf32_Sym& target = symbols[relocation.getSymbol()];
+      if (target.st_shndx == llvm::ELF::SHN_UNDEF || target.st_shndx >= header.e_shnum ||
+          section_offsets[target.st_shndx] == kNotLaidOut) {
+        VLOG(compiler) << "Linking " << symbol << " with MCLinker, it refers to "
+                       << (target.st_name < names_size ? names + target.st_name : "?");
+        return false;
+      }
+      uint32_t place = target_offset + relocation.r_offset;
+      if (!ApplyRelocation(instruction_set, relocation.getType(), &(*code)[place],
+                           section_offsets[target.st_shndx] + target.st_value, place)) {
+        VLOG(compiler) << "Linking " << symbol << " with MCLinker, it has relocation type "
+                       << static_cast<uint32_t>(relocation.getType());
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace art
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_ELF_OBJECT_LINKER_H_
+#define ART_COMPILER_ELF_OBJECT_LINKER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "instruction_set.h"
+
+namespace art {
+
+// Links the relocatable ELF object the portable compiler emits for a method without MCLinker.
+// The read-only sections are laid out after the one holding symbol and the PC relative
+// relocations between them are applied, which leaves code that can be written to the oat file
+// like Quick's. Objects referring to other symbols, such as the runtime support functions, or
+// needing absolute relocations or writable data are left to MCLinker.
+class ElfObjectLinker {
+ public:
+  // Returns true and the linked code starting at symbol in code on success.
+  static bool Link(const std::string& elf_object, const std::string& symbol,
+                   InstructionSet instruction_set, std::vector<uint8_t>* code);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ElfObjectLinker);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_ELF_OBJECT_LINKER_H_
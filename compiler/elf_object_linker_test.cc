@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "elf_object_linker.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <llvm/Support/ELF.h>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+// Symbols of the objects built below.
+enum {
+  kNullSymbol,
+  kMethodSymbol,   // "method" at the start of .text.
+  kHelperSymbol,   // "helper" at offset 0x100 of .text.
+  kExternalSymbol  // "external", undefined.
+};
+
+// Builds a relocatable object with a .text section holding text and one relocation of the given
+// type against the given symbol at reloc_offset.
+static std::string BuildObject(uint16_t machine, const std::vector<uint8_t>& text,
+                               uint32_t reloc_offset, uint32_t reloc_symbol, uint32_t reloc_type,
+                               bool thumb) {
+  const char strtab[] = "\0method\0helper\0external";
+  llvm::ELF::Elf32_Sym symbols[4];
+  memset(symbols, 0, sizeof(symbols));
+  symbols[kMethodSymbol].st_name = 1;
+  symbols[kMethodSymbol].st_value = thumb ? 1 : 0;
+  symbols[kMethodSymbol].st_shndx = 1;
+  symbols[kHelperSymbol].st_name = 8;
+  symbols[kHelperSymbol].st_value = 0x100 | (thumb ? 1 : 0);
+  symbols[kHelperSymbol].st_shndx = 1;
+  symbols[kExternalSymbol].st_name = 15;
+  llvm::ELF::Elf32_Rel relocation;
+  relocation.r_offset = reloc_offset;
+  relocation.r_info = (reloc_symbol << 8) | reloc_type;
+
+  // The header, then .text, .rel.text, .symtab and .strtab, then the section headers.
+  std::string object(sizeof(llvm::ELF::Elf32_Ehdr), '\0');
+  llvm::ELF::Elf32_Shdr sections[5];
+  memset(sections, 0, sizeof(sections));
+  sections[1].sh_type = llvm::ELF::SHT_PROGBITS;
+  sections[1].sh_flags = llvm::ELF::SHF_ALLOC | llvm::ELF::SHF_EXECINSTR;
+  sections[1].sh_addralign = 4;
+  sections[1].sh_offset = object.size();
+  sections[1].sh_size = text.size();
+  object.append(reinterpret_cast<const char*>(&text[0]), text.size());
+  sections[2].sh_type = llvm::ELF::SHT_REL;
+  sections[2].sh_link = 3;
+  sections[2].sh_info = 1;
+  sections[2].sh_offset = object.size();
+  sections[2].sh_size = sizeof(relocation);
+  object.append(reinterpret_cast<const char*>(&relocation), sizeof(relocation));
+  sections[3].sh_type = llvm::ELF::SHT_SYMTAB;
+  sections[3].sh_link = 4;
+  sections[3].sh_offset = object.size();
+  sections[3].sh_size = sizeof(symbols);
+  object.append(reinterpret_cast<const char*>(symbols), sizeof(symbols));
+  sections[4].sh_type = llvm::ELF::SHT_STRTAB;
+  sections[4].sh_offset = object.size();
+  sections[4].sh_size = sizeof(strtab);
+  object.append(strtab, sizeof(strtab));
+
+  llvm::ELF::Elf32_Ehdr header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.e_ident, llvm::ELF::ElfMagic, strlen(llvm::ELF::ElfMagic));
+  header.e_ident[llvm::ELF::EI_CLASS] = llvm::ELF::ELFCLASS32;
+  header.e_ident[llvm::ELF::EI_DATA] = llvm::ELF::ELFDATA2LSB;
+  header.e_ident[llvm::ELF::EI_VERSION] = llvm::ELF::EV_CURRENT;
+  header.e_type = llvm::ELF::ET_REL;
+  header.e_machine = machine;
+  header.e_version = llvm::ELF::EV_CURRENT;
+  header.e_ehsize = sizeof(header);
+  header.e_shentsize = sizeof(llvm::ELF::Elf32_Shdr);
+  header.e_shnum = 5;
+  header.e_shoff = object.size();
+  object.append(reinterpret_cast<const char*>(sections), sizeof(sections));
+  object.replace(0, sizeof(header), reinterpret_cast<const char*>(&header), sizeof(header));
+  return object;
+}
+
+TEST(ElfObjectLinkerTest, X86Call) {
+  // call helper, with the -4 addend of the displacement being PC relative to the next insn.
+  std::vector<uint8_t> text(0x104, 0x90);
+  text[0] = 0xE8;
+  text[1] = 0xFC;
+  text[2] = 0xFF;
+  text[3] = 0xFF;
+  text[4] = 0xFF;
+  std::string object = BuildObject(llvm::ELF::EM_386, text, 1, kHelperSymbol,
+                                   llvm::ELF::R_386_PC32, false);
+  std::vector<uint8_t> code;
+  ASSERT_TRUE(ElfObjectLinker::Link(object, "method", kX86, &code));
+  ASSERT_EQ(text.size(), code.size());
+  EXPECT_EQ(0xE8, code[0]);
+  EXPECT_EQ(0xFBU, code[1] | (code[2] << 8) | (code[3] << 16) | (code[4] << 24));
+  EXPECT_EQ(0x90, code[5]);
+
+  // An object calling out of itself is left to MCLinker.
+  object = BuildObject(llvm::ELF::EM_386, text, 1, kExternalSymbol, llvm::ELF::R_386_PC32, false);
+  EXPECT_FALSE(ElfObjectLinker::Link(object, "method", kX86, &code));
+
+  // As is one with absolute relocations.
+  object = BuildObject(llvm::ELF::EM_386, text, 1, kHelperSymbol, llvm::ELF::R_386_32, false);
+  EXPECT_FALSE(ElfObjectLinker::Link(object, "method", kX86, &code));
+
+  // The code must start at the symbol.
+  object = BuildObject(llvm::ELF::EM_386, text, 1, kHelperSymbol, llvm::ELF::R_386_PC32, false);
+  EXPECT_FALSE(ElfObjectLinker::Link(object, "helper", kX86, &code));
+}
+
+TEST(ElfObjectLinkerTest, Thumb2Call) {
+  // bl with the -4 addend.
+  std::vector<uint8_t> text(0x104, 0);
+  text[0] = 0xFF;
+  text[1] = 0xF7;
+  text[2] = 0xFE;
+  text[3] = 0xFF;
+  std::string object = BuildObject(llvm::ELF::EM_ARM, text, 0, kHelperSymbol,
+                                   llvm::ELF::R_ARM_THM_CALL, true);
+  std::vector<uint8_t> code;
+  ASSERT_TRUE(ElfObjectLinker::Link(object, "method", kThumb2, &code));
+  ASSERT_EQ(text.size(), code.size());
+  // bl +0x100
+  EXPECT_EQ(0xF000, code[0] | (code[1] << 8));
+  EXPECT_EQ(0xF87E, code[2] | (code[3] << 8));
+}
+
+}  // namespace art
@@ -243,7 +243,7 @@ void ElfWriterMclinker::AddMethodInputs(const std::vector<const DexFile*>& dex_f
     uint32_t method_idx = it.GetMemberIndex();
     const CompiledMethod* compiled_method =
       compiler_driver_->GetCompiledMethod(MethodReference(&dex_file, method_idx));
-    if (compiled_method != NULL) {
+    if (compiled_method != NULL && compiled_method->IsElfObject()) {
       AddCompiledCodeInput(*compiled_method);
     }
     it.Next();
@@ -262,7 +262,7 @@ void ElfWriterMclinker::AddCompiledCodeInput(const CompiledCode& compiled_code)
   added_symbols_.Put(&symbol, &symbol);
 
   // Add input to supply code for symbol
-  const std::vector<uint8_t>& code = compiled_code.GetCode();
+  const SwapVector<uint8_t>& code = compiled_code.GetCode();
   // TODO: ownership of code_input?
   // TODO: why does IRBuilder::ReadInput take a non-const pointer?
   mcld::Input* code_input = ir_builder_->ReadInput(symbol,
@@ -364,7 +364,8 @@ void ElfWriterMclinker::FixupOatMethodOffsets(const std::vector<const DexFile*>&
     }
     const CompiledMethod* compiled_method =
       compiler_driver_->GetCompiledMethod(MethodReference(&dex_file, method_idx));
-    if (compiled_method != NULL) {
+    // The OatWriter laid out the code ElfObjectLinker linked.
+    if (compiled_method != NULL && compiled_method->IsElfObject()) {
       uint32_t offset = FixupCompiledCodeOffset(*elf_file.get(), oatdata_address, *compiled_method);
       // Don't overwrite static method trampoline
       if (method != NULL &&
@@ -16,9 +16,14 @@
 
 #include "file_output_stream.h"
 
+#include <limits.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "base/unix_file/fd_file.h"
 
 namespace art {
@@ -29,6 +34,30 @@ bool FileOutputStream::WriteFully(const void* buffer, int64_t byte_count) {
   return file_->WriteFully(buffer, byte_count);
 }
 
+bool FileOutputStream::WriteFullyV(const struct iovec* iov, int iov_count) {
+  std::vector<struct iovec> remaining(iov, iov + iov_count);
+  size_t next = 0;
+  while (next < remaining.size()) {
+    ssize_t bytes_written = TEMP_FAILURE_RETRY(writev(file_->Fd(), &remaining[next],
+                                                      std::min(remaining.size() - next,
+                                                               static_cast<size_t>(IOV_MAX))));
+    if (bytes_written < 0) {
+      return false;
+    }
+    // Skip the buffers written completely and advance into the one written partially.
+    size_t written = bytes_written;
+    while (next < remaining.size() && written >= remaining[next].iov_len) {
+      written -= remaining[next].iov_len;
+      ++next;
+    }
+    if (written != 0) {
+      remaining[next].iov_base = reinterpret_cast<uint8_t*>(remaining[next].iov_base) + written;
+      remaining[next].iov_len -= written;
+    }
+  }
+  return true;
+}
+
 off_t FileOutputStream::Seek(off_t offset, Whence whence) {
   return lseek(file_->Fd(), offset, static_cast<int>(whence));
 }
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_GC_MAP_BUILDER_H_
+#define ART_COMPILER_GC_MAP_BUILDER_H_
+
+#include <string.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "gc_map.h"
+
+namespace art {
+
+// Builds the table read by NativePcOffsetToReferenceMap. The safepoints of a method mostly share
+// a few live sets, so the distinct bitmaps are put in a dictionary the entries index whenever
+// that is smaller than a bitmap per entry.
+class NativePcToReferenceMapBuilder {
+ public:
+  NativePcToReferenceMapBuilder(std::vector<uint8_t>* table,
+                                size_t entries, uint32_t max_native_offset,
+                                size_t references_width) : entries_(entries),
+                                references_width_(references_width), table_(table) {
+    // Compute width in bytes needed to hold max_native_offset, at least one as the header holds it
+    // less one.
+    native_offset_width_ = 1;
+    while ((max_native_offset >>= 8) != 0) {
+      native_offset_width_++;
+    }
+    CHECK_LT(references_width_, 1U << 13);
+    CHECK_LT(entries, 1U << 16);
+    native_offsets_.reserve(entries);
+    bitmap_indices_.reserve(entries);
+  }
+
+  void AddEntry(uint32_t native_offset, const uint8_t* references) {
+    std::vector<uint8_t> bitmap(references, references + references_width_);
+    std::map<std::vector<uint8_t>, size_t>::const_iterator it = dictionary_.find(bitmap);
+    size_t bitmap_index;
+    if (it != dictionary_.end()) {
+      bitmap_index = it->second;
+    } else {
+      bitmap_index = bitmaps_.size();
+      dictionary_.insert(std::make_pair(bitmap, bitmap_index));
+      bitmaps_.push_back(references);
+    }
+    native_offsets_.push_back(native_offset);
+    bitmap_indices_.push_back(bitmap_index);
+  }
+
+  // Writes the table once all the entries have been added.
+  void Finish() {
+    CHECK_EQ(native_offsets_.size(), entries_);
+    size_t index_width = bitmaps_.size() <= 256 ? 1 : 2;
+    size_t plain_size = sizeof(uint32_t) + entries_ * (native_offset_width_ + references_width_);
+    size_t dictionary_size = sizeof(uint32_t) + sizeof(uint16_t) +
+        entries_ * (native_offset_width_ + index_width) + bitmaps_.size() * references_width_;
+    bool use_dictionary = dictionary_size < plain_size;
+    size_t entry_width = native_offset_width_ + (use_dictionary ? index_width : references_width_);
+    size_t table_begin = sizeof(uint32_t) + (use_dictionary ? sizeof(uint16_t) : 0);
+
+    // Set up the header.
+    table_->assign(use_dictionary ? dictionary_size : plain_size, 0);
+    (*table_)[0] = (native_offset_width_ - 1) &
+        NativePcOffsetToReferenceMap::kNativeOffsetWidthMask;
+    if (use_dictionary) {
+      (*table_)[0] |= NativePcOffsetToReferenceMap::kDictionaryFlag;
+      (*table_)[4] = bitmaps_.size() & 0xFF;
+      (*table_)[5] = (bitmaps_.size() >> 8) & 0xFF;
+    }
+    (*table_)[0] |= (references_width_ << 3) & 0xFF;
+    (*table_)[1] = (references_width_ >> 5) & 0xFF;
+    (*table_)[2] = entries_ & 0xFF;
+    (*table_)[3] = (entries_ >> 8) & 0xFF;
+
+    // Hash the entries into the table.
+    std::vector<bool> in_use(entries_);
+    for (size_t i = 0; i < entries_; ++i) {
+      size_t table_index = NativePcOffsetToReferenceMap::Hash(native_offsets_[i]) % entries_;
+      while (in_use[table_index]) {
+        table_index = (table_index + 1) % entries_;
+      }
+      in_use[table_index] = true;
+      uint8_t* entry = &(*table_)[table_begin + table_index * entry_width];
+      for (size_t j = 0; j < native_offset_width_; ++j) {
+        entry[j] = (native_offsets_[i] >> (j * 8)) & 0xFF;
+      }
+      if (!use_dictionary) {
+        memcpy(entry + native_offset_width_, bitmaps_[bitmap_indices_[i]], references_width_);
+      } else {
+        entry[native_offset_width_] = bitmap_indices_[i] & 0xFF;
+        if (index_width == 2) {
+          entry[native_offset_width_ + 1] = (bitmap_indices_[i] >> 8) & 0xFF;
+        }
+      }
+    }
+
+    if (use_dictionary) {
+      uint8_t* dictionary = &(*table_)[table_begin + entries_ * entry_width];
+      for (size_t i = 0; i < bitmaps_.size(); ++i) {
+        memcpy(dictionary + i * references_width_, bitmaps_[i], references_width_);
+      }
+    }
+  }
+
+ private:
+  // Number of entries in the table.
+  const size_t entries_;
+  // Number of bytes used to encode the reference bitmap.
+  const size_t references_width_;
+  // Number of bytes used to encode a native offset.
+  size_t native_offset_width_;
+  // The native offset of each entry and the index of its bitmap, in the order added.
+  std::vector<uint32_t> native_offsets_;
+  std::vector<size_t> bitmap_indices_;
+  // The distinct bitmaps, which must live until Finish, and their indices.
+  std::vector<const uint8_t*> bitmaps_;
+  std::map<std::vector<uint8_t>, size_t> dictionary_;
+  // The table we're building.
+  std::vector<uint8_t>* const table_;
+
+  DISALLOW_COPY_AND_ASSIGN(NativePcToReferenceMapBuilder);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_GC_MAP_BUILDER_H_
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gc_map_builder.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+// Builds a map of num_entries safepoints at native pc offset 6 * i, with the bitmap of the entry
+// i % num_bitmaps, and checks every entry reads back.
+static void BuildAndCheck(size_t num_entries, size_t num_bitmaps, size_t reg_width,
+                          bool expect_dictionary) {
+  std::vector<std::vector<uint8_t> > bitmaps(num_bitmaps, std::vector<uint8_t>(reg_width));
+  for (size_t i = 0; i < num_bitmaps; ++i) {
+    for (size_t j = 0; j < reg_width; ++j) {
+      bitmaps[i][j] = (i >> (j * 8)) & 0xFF;
+    }
+  }
+  std::vector<uint8_t> table;
+  NativePcToReferenceMapBuilder builder(&table, num_entries, 6 * (num_entries - 1), reg_width);
+  for (size_t i = 0; i < num_entries; ++i) {
+    builder.AddEntry(6 * i, &bitmaps[i % num_bitmaps][0]);
+  }
+  builder.Finish();
+
+  NativePcOffsetToReferenceMap map(&table[0]);
+  EXPECT_EQ(expect_dictionary, map.HasDictionary());
+  EXPECT_EQ(num_entries, map.NumEntries());
+  EXPECT_EQ(reg_width, map.RegWidth());
+  EXPECT_EQ(table.size(), map.EncodedSize());
+  for (size_t i = 0; i < num_entries; ++i) {
+    ASSERT_TRUE(map.HasEntry(6 * i));
+    EXPECT_EQ(0, memcmp(&bitmaps[i % num_bitmaps][0], map.FindBitMap(6 * i), reg_width)) << i;
+  }
+}
+
+TEST(GcMapBuilder, DistinctBitmaps) {
+  BuildAndCheck(1, 1, 1, false);
+  BuildAndCheck(100, 100, 1, false);
+}
+
+TEST(GcMapBuilder, SharedBitmaps) {
+  BuildAndCheck(100, 3, 4, true);
+  BuildAndCheck(2000, 250, 2, true);
+}
+
+TEST(GcMapBuilder, WideDictionaryIndices) {
+  BuildAndCheck(5000, 1000, 8, true);
+}
+
+}  // namespace art
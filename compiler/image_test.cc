@@ -36,9 +36,14 @@ class ImageTest : public CommonTest {
     ReserveImageSpace();
     CommonTest::SetUp();
   }
+
+  // Compiles the boot class path into an image and starts a runtime from it. If relocate, the
+  // start of the address range the image was compiled for is taken first. If compress, the image
+  // is written compressed.
+  void TestWriteRead(bool relocate, bool compress);
 };
 
-TEST_F(ImageTest, WriteRead) {
+void ImageTest::TestWriteRead(bool relocate, bool compress) {
   ScratchFile tmp_elf;
   {
     {
@@ -74,9 +79,13 @@ TEST_F(ImageTest, WriteRead) {
   ScratchFile tmp_image;
   const uintptr_t requested_image_base = ART_BASE_ADDRESS;
   {
-    ImageWriter writer(*compiler_driver_.get());
+    ImageWriter writer(*compiler_driver_.get(),
+                       compress ? ImageWriter::kCompressedImageBlockSize : 0);
+    base::TimingLogger timings("ImageTest::WriteRead", false, false);
+    timings.StartSplit("ImageWriter");
     bool success_image = writer.Write(tmp_image.GetFilename(), requested_image_base,
-                                      tmp_oat->GetPath(), tmp_oat->GetPath());
+                                      tmp_oat->GetPath(), tmp_oat->GetPath(), timings);
+    timings.EndSplit();
     ASSERT_TRUE(success_image);
     bool success_fixup = ElfFixup::Fixup(tmp_oat.get(), writer.GetOatDataBegin());
     ASSERT_TRUE(success_fixup);
@@ -88,6 +97,7 @@ TEST_F(ImageTest, WriteRead) {
     ImageHeader image_header;
     file->ReadFully(&image_header, sizeof(image_header));
     ASSERT_TRUE(image_header.IsValid());
+    ASSERT_EQ(compress, image_header.IsCompressed());
     ASSERT_GE(image_header.GetImageBitmapOffset(), sizeof(image_header));
     ASSERT_NE(0U, image_header.GetImageBitmapSize());
 
@@ -115,6 +125,13 @@ TEST_F(ImageTest, WriteRead) {
 
   // Remove the reservation of the memory for use to load the image.
   UnreserveImageSpace();
+  UniquePtr<MemMap> collision;
+  if (relocate) {
+    collision.reset(MemMap::MapAnonymous("image collision",
+                                         reinterpret_cast<byte*>(requested_image_base),
+                                         kPageSize, PROT_NONE));
+    ASSERT_TRUE(collision.get() != NULL);
+  }
 
   Runtime::Options options;
   std::string image("-Ximage:");
@@ -144,7 +161,13 @@ TEST_F(ImageTest, WriteRead) {
   image_space->VerifyImageAllocations();
   byte* image_begin = image_space->Begin();
   byte* image_end = image_space->End();
-  CHECK_EQ(requested_image_base, reinterpret_cast<uintptr_t>(image_begin));
+  if (relocate) {
+    EXPECT_NE(0, image_space->GetRelocationDelta());
+    EXPECT_GT(requested_image_base, reinterpret_cast<uintptr_t>(image_begin));
+  } else {
+    EXPECT_EQ(0, image_space->GetRelocationDelta());
+    CHECK_EQ(requested_image_base, reinterpret_cast<uintptr_t>(image_begin));
+  }
   for (size_t i = 0; i < dex->NumClassDefs(); ++i) {
     const DexFile::ClassDef& class_def = dex->GetClassDef(i);
     const char* descriptor = dex->GetClassDescriptor(class_def);
@@ -162,11 +185,30 @@ TEST_F(ImageTest, WriteRead) {
   }
 }
 
+TEST_F(ImageTest, WriteRead) {
+  TestWriteRead(false, false);
+}
+
+TEST_F(ImageTest, WriteReadRelocated) {
+  TestWriteRead(true, false);
+}
+
+TEST_F(ImageTest, WriteReadCompressed) {
+  TestWriteRead(false, true);
+}
+
+TEST_F(ImageTest, WriteReadCompressedRelocated) {
+  TestWriteRead(true, true);
+}
+
 TEST_F(ImageTest, ImageHeaderIsValid) {
     uint32_t image_begin = ART_BASE_ADDRESS;
     uint32_t image_size_ = 16 * KB;
     uint32_t image_bitmap_offset = 0;
     uint32_t image_bitmap_size = 0;
+    uint32_t image_relocations_offset = 0;
+    uint32_t image_relocations_size = 0;
+    uint32_t oat_relocations_count = 0;
     uint32_t image_roots = ART_BASE_ADDRESS + (1 * KB);
     uint32_t oat_checksum = 0;
     uint32_t oat_file_begin = ART_BASE_ADDRESS + (4 * KB);  // page aligned
@@ -177,6 +219,10 @@ TEST_F(ImageTest, ImageHeaderIsValid) {
                              image_size_,
                              image_bitmap_offset,
                              image_bitmap_size,
+                             image_relocations_offset,
+                             image_relocations_size,
+                             oat_relocations_count,
+                             0,
                              image_roots,
                              oat_checksum,
                              oat_file_begin,
@@ -17,6 +17,7 @@
 #include "image_writer.h"
 
 #include <sys/stat.h>
+#include <zlib.h>
 
 #include <vector>
 
@@ -24,6 +25,7 @@
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
 #include "compiled_method.h"
+#include "cutils/atomic.h"
 #include "dex_file-inl.h"
 #include "driver/compiler_driver.h"
 #include "elf_writer.h"
@@ -44,12 +46,14 @@
 #include "mirror/dex_cache-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
+#include "monitor.h"
 #include "oat.h"
 #include "oat_file.h"
 #include "object_utils.h"
 #include "runtime.h"
 #include "scoped_thread_state_change.h"
 #include "sirt_ref.h"
+#include "thread_pool.h"
 #include "UniquePtr.h"
 #include "utils.h"
 
@@ -58,6 +62,7 @@ using ::art::mirror::ArtMethod;
 using ::art::mirror::Class;
 using ::art::mirror::DexCache;
 using ::art::mirror::EntryPointFromInterpreter;
+using ::art::mirror::IntArray;
 using ::art::mirror::Object;
 using ::art::mirror::ObjectArray;
 using ::art::mirror::String;
@@ -67,7 +72,8 @@ namespace art {
 bool ImageWriter::Write(const std::string& image_filename,
                         uintptr_t image_begin,
                         const std::string& oat_filename,
-                        const std::string& oat_location) {
+                        const std::string& oat_location,
+                        base::TimingLogger& timings) {
   CHECK(!image_filename.empty());
 
   CHECK_NE(image_begin, 0U);
@@ -105,6 +111,7 @@ bool ImageWriter::Write(const std::string& image_filename,
       oat_file_->GetOatHeader().GetQuickResolutionTrampolineOffset();
   quick_to_interpreter_bridge_offset_ =
       oat_file_->GetOatHeader().GetQuickToInterpreterBridgeOffset();
+  timings.NewSplit("ImageWriter PruneNonImageClasses");
   {
     Thread::Current()->TransitionFromSuspendedToRunnable();
     PruneNonImageClasses();  // Remove junk
@@ -134,13 +141,19 @@ bool ImageWriter::Write(const std::string& image_filename,
   size_t oat_loaded_size = 0;
   size_t oat_data_offset = 0;
   ElfWriter::GetOatElfInformation(oat_file.get(), oat_loaded_size, oat_data_offset);
+  timings.NewSplit("ImageWriter CalculateNewObjectOffsets");
   CalculateNewObjectOffsets(oat_loaded_size, oat_data_offset);
+  Thread::Current()->TransitionFromRunnableToSuspended(kNative);
+  timings.NewSplit("ImageWriter CopyAndFixupObjects");
   CopyAndFixupObjects();
+  Thread::Current()->TransitionFromSuspendedToRunnable();
+  timings.NewSplit("ImageWriter PatchOatCodeAndMethods");
   PatchOatCodeAndMethods();
   // Record allocations into the image bitmap.
   RecordImageAllocations();
   Thread::Current()->TransitionFromRunnableToSuspended(kNative);
 
+  timings.NewSplit("ImageWriter write image");
   UniquePtr<File> image_file(OS::CreateEmptyFile(image_filename.c_str()));
   ImageHeader* image_header = reinterpret_cast<ImageHeader*>(image_->Begin());
   if (image_file.get() == NULL) {
@@ -152,9 +165,9 @@ bool ImageWriter::Write(const std::string& image_filename,
     return EXIT_FAILURE;
   }
 
-  // Write out the image.
+  // Write out the image, or leave it to WriteImageBlocks once the offsets of its blocks are known.
   CHECK_EQ(image_end_, image_header->GetImageSize());
-  if (!image_file->WriteFully(image_->Begin(), image_end_)) {
+  if (!image_header->IsCompressed() && !image_file->WriteFully(image_->Begin(), image_end_)) {
     PLOG(ERROR) << "Failed to write image file " << image_filename;
     return false;
   }
@@ -168,9 +181,112 @@ bool ImageWriter::Write(const std::string& image_filename,
     return false;
   }
 
+  // Write out the relocations at the page aligned start of the bitmap end.
+  CHECK_ALIGNED(image_header->GetImageRelocationsOffset(), kPageSize);
+  CHECK_EQ(image_relocations_.size() * sizeof(int32_t), image_header->GetImageRelocationsSize());
+  CHECK_EQ(oat_relocations_.size(), image_header->GetOatRelocationsCount());
+  if (!image_file->Write(reinterpret_cast<char*>(image_relocations_.data()),
+                         image_header->GetImageRelocationsSize(),
+                         image_header->GetImageRelocationsOffset())) {
+    PLOG(ERROR) << "Failed to write image file " << image_filename;
+    return false;
+  }
+  if (!oat_relocations_.empty() &&
+      !image_file->Write(reinterpret_cast<char*>(oat_relocations_.data()),
+                         oat_relocations_.size() * sizeof(uint32_t),
+                         image_header->GetImageRelocationsOffset() +
+                             image_header->GetImageRelocationsSize())) {
+    PLOG(ERROR) << "Failed to write image file " << image_filename;
+    return false;
+  }
+
+  if (image_header->IsCompressed()) {
+    timings.NewSplit("ImageWriter compress image");
+    if (!WriteImageBlocks(image_file.get(), *image_header)) {
+      PLOG(ERROR) << "Failed to write image file " << image_filename;
+      return false;
+    }
+  }
   return true;
 }
 
+class CompressImageBlocksTask : public Task {
+ public:
+  CompressImageBlocksTask(const byte* image_begin, size_t image_size, size_t block_size,
+                          size_t begin, size_t end, std::vector<std::vector<uint8_t> >* blocks)
+      : image_begin_(image_begin), image_size_(image_size), block_size_(block_size),
+        begin_(begin), end_(end), blocks_(blocks) {}
+
+  virtual void Run(Thread* self) {
+    for (size_t i = begin_; i < end_; ++i) {
+      size_t offset = i * block_size_;
+      uLong size = std::min(block_size_, image_size_ - offset);
+      uLongf compressed_size = compressBound(size);
+      std::vector<uint8_t>& block = (*blocks_)[i];
+      block.resize(compressed_size);
+      int result = compress2(&block[0], &compressed_size, image_begin_ + offset, size,
+                             Z_BEST_COMPRESSION);
+      CHECK_EQ(result, Z_OK) << "Failed to compress image block " << i;
+      block.resize(compressed_size);
+    }
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  const byte* const image_begin_;
+  const size_t image_size_;
+  const size_t block_size_;
+  const size_t begin_;
+  const size_t end_;
+  std::vector<std::vector<uint8_t> >* const blocks_;
+};
+
+bool ImageWriter::WriteImageBlocks(File* image_file, const ImageHeader& image_header) {
+  static const size_t kBlocksPerTask = 16;
+  Thread* self = Thread::Current();
+  size_t num_blocks = image_header.GetNumImageBlocks();
+  std::vector<std::vector<uint8_t> > blocks(num_blocks);
+  ThreadPool thread_pool(compiler_driver_.GetThreadCount() - 1);
+  for (size_t begin = 0; begin < num_blocks; begin += kBlocksPerTask) {
+    thread_pool.AddTask(self, new CompressImageBlocksTask(image_->Begin(), image_end_,
+                                                          image_header.GetImageBlockSize(), begin,
+                                                          std::min(begin + kBlocksPerTask,
+                                                                   num_blocks),
+                                                          &blocks));
+  }
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, true, false);
+
+  std::vector<uint32_t> index;
+  size_t offset = image_header.GetImageRelocationsOffset() +
+      image_header.GetImageRelocationsSize() +
+      image_header.GetOatRelocationsCount() * sizeof(uint32_t);
+  for (const std::vector<uint8_t>& block : blocks) {
+    index.push_back(offset);
+    if (image_file->Write(reinterpret_cast<const char*>(&block[0]), block.size(), offset) !=
+        static_cast<int64_t>(block.size())) {
+      return false;
+    }
+    offset += block.size();
+  }
+  index.push_back(offset);
+  size_t index_size = index.size() * sizeof(uint32_t);
+  CHECK_LE(image_header.GetImageBlockIndexOffset() + index_size,
+           image_header.GetImageBitmapOffset());
+  if (image_file->Write(reinterpret_cast<const char*>(&index[0]), index_size,
+                        image_header.GetImageBlockIndexOffset()) !=
+      static_cast<int64_t>(index_size)) {
+    return false;
+  }
+  LOG(INFO) << "Compressed image of " << PrettySize(image_end_) << " into "
+            << PrettySize(offset - index[0]);
+  return image_file->Write(reinterpret_cast<const char*>(&image_header), sizeof(image_header), 0) ==
+      static_cast<int64_t>(sizeof(image_header));
+}
+
 void ImageWriter::RecordImageAllocations() {
   uint64_t start_time = NanoTime();
   CHECK(image_bitmap_.get() != nullptr);
@@ -362,17 +478,80 @@ void ImageWriter::CalculateNewObjectOffsetsCallback(Object* obj, void* arg) {
       return;
     }
     // else (obj == interned), nothing to do but fall through to the normal case
+  } else if (image_writer->IsImageOffsetAssigned(obj)) {
+    // Placed early by AssignHotObjectOffsets.
+    return;
   }
 
   image_writer->AssignImageOffset(obj);
 }
 
+bool ImageWriter::IsLikelyDirtiedAtRuntime(Object* obj) {
+  if (obj->IsClass()) {
+    // Initialization writes the status and static fields, and locking the class its lock word.
+    return true;
+  }
+  if (obj->IsArtMethod()) {
+    // The entry points of static methods are set when their class is initialized.
+    ArtMethod* method = obj->AsArtMethod();
+    return method->IsStatic() && !method->GetDeclaringClass()->IsInitialized();
+  }
+  // Strings, primitive arrays, fields, vtables and the like are only read.
+  return false;
+}
+
+void ImageWriter::AssignDirtyObjectOffsetsCallback(Object* obj, void* arg) {
+  ImageWriter* image_writer = reinterpret_cast<ImageWriter*>(arg);
+  if (!image_writer->IsImageOffsetAssigned(obj) && IsLikelyDirtiedAtRuntime(obj)) {
+    image_writer->AssignImageOffset(obj);
+  }
+}
+
+void ImageWriter::AssignImageOffsetIfUnassigned(Object* object) {
+  if (object != NULL && !IsImageOffsetAssigned(object)) {
+    AssignImageOffset(object);
+  }
+}
+
+void ImageWriter::AssignHotObjectOffsets() {
+  for (DexCache* dex_cache : dex_caches_) {
+    AssignImageOffsetIfUnassigned(dex_cache);
+    AssignImageOffsetIfUnassigned(dex_cache->GetResolvedMethods());
+    AssignImageOffsetIfUnassigned(dex_cache->GetResolvedTypes());
+    AssignImageOffsetIfUnassigned(dex_cache->GetResolvedFields());
+    AssignImageOffsetIfUnassigned(dex_cache->GetInitializedStaticStorage());
+    AssignImageOffsetIfUnassigned(dex_cache->GetStrings());
+  }
+  const CompilerDriver::MethodSet* profiled_methods = compiler_driver_.GetProfiledMethods();
+  if (profiled_methods == NULL) {
+    return;
+  }
+  for (DexCache* dex_cache : dex_caches_) {
+    ObjectArray<ArtMethod>* methods = dex_cache->GetResolvedMethods();
+    for (int32_t i = 0; i < methods->GetLength(); ++i) {
+      ArtMethod* method = methods->Get(i);
+      if (method != NULL && !method->IsRuntimeMethod() && !IsImageOffsetAssigned(method) &&
+          profiled_methods->find(PrettyMethod(method)) != profiled_methods->end()) {
+        AssignImageOffsetIfUnassigned(method->GetDeclaringClass());
+        AssignImageOffset(method);
+      }
+    }
+  }
+}
+
 ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
   Runtime* runtime = Runtime::Current();
   ClassLinker* class_linker = runtime->GetClassLinker();
   Class* object_array_class = class_linker->FindSystemClass("[Ljava/lang/Object;");
   Thread* self = Thread::Current();
 
+  // build the class table probed by ClassLinker::LookupClassFromImage
+  IntArray* class_table_hashes = NULL;
+  SirtRef<ObjectArray<Class> > class_table(self,
+                                           class_linker->CreateImageClassTable(self,
+                                                                               &class_table_hashes));
+  SirtRef<IntArray> class_table_hashes_ref(self, class_table_hashes);
+
   // build an Object[] of all the DexCaches used in the source_space_
   ObjectArray<Object>* dex_caches = ObjectArray<Object>::Alloc(self, object_array_class,
                                                                dex_caches_.size());
@@ -399,6 +578,8 @@ ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
                    dex_caches);
   image_roots->Set(ImageHeader::kClassRoots,
                    class_linker->GetClassRoots());
+  image_roots->Set(ImageHeader::kClassTable, class_table.get());
+  image_roots->Set(ImageHeader::kClassTableHashes, class_table_hashes_ref.get());
   for (int i = 0; i < ImageHeader::kImageRootsMax; i++) {
     CHECK(image_roots->Get(i) != NULL);
   }
@@ -426,6 +607,14 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
     // TODO: Add InOrderWalk to heap bitmap.
     const char* old = self->StartAssertNoThreadSuspension("ImageWriter");
     DCHECK(heap->GetLargeObjectsSpace()->GetLiveObjects()->IsEmpty());
+    AssignHotObjectOffsets();
+    // The objects the runtime writes to come next, then the rest from a new page, so that the
+    // pages every process dirties are packed together and the others stay shared with the file.
+    for (const auto& space : spaces) {
+      space->GetLiveBitmap()->InOrderWalk(AssignDirtyObjectOffsetsCallback, this);
+    }
+    image_end_ = RoundUp(image_end_, kPageSize);
+    VLOG(compiler) << "Image objects likely dirtied at runtime: " << PrettySize(image_end_);
     for (const auto& space : spaces) {
       space->GetLiveBitmap()->InOrderWalk(CalculateNewObjectOffsetsCallback, this);
       DCHECK_LT(image_end_, image_->Size());
@@ -436,6 +625,17 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
   // Create the image bitmap.
   image_bitmap_.reset(gc::accounting::SpaceBitmap::Create("image bitmap", image_->Begin(),
                                                           image_end_));
+  // One relocation bit for every 32-bit word of the image, set as the references are fixed up.
+  image_relocations_.resize(RoundUp(image_end_ / sizeof(uint32_t), kBitsPerWord) / kBitsPerWord);
+  // A compressed image only has its header and block index before the bitmap.
+  size_t image_bitmap_offset = RoundUp(image_end_, kPageSize);
+  if (image_block_size_ != 0) {
+    size_t num_blocks = RoundUp(image_end_, image_block_size_) / image_block_size_;
+    image_bitmap_offset = RoundUp(sizeof(ImageHeader) + (num_blocks + 1) * sizeof(uint32_t),
+                                  kPageSize);
+  }
+  size_t image_relocations_offset = RoundUp(image_bitmap_offset + image_bitmap_->Size(),
+                                            kPageSize);
   const byte* oat_file_begin = image_begin_ + RoundUp(image_end_, kPageSize);
   const byte* oat_file_end = oat_file_begin + oat_loaded_size;
   oat_data_begin_ = oat_file_begin + oat_data_offset;
@@ -445,8 +645,12 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
   // image_end_ is the size of the image (excluding bitmaps).
   ImageHeader image_header(reinterpret_cast<uint32_t>(image_begin_),
                            static_cast<uint32_t>(image_end_),
-                           RoundUp(image_end_, kPageSize),
+                           image_bitmap_offset,
                            image_bitmap_->Size(),
+                           image_relocations_offset,
+                           image_relocations_.size() * sizeof(int32_t),
+                           compiler_driver_.GetMethodsToPatch().size(),
+                           image_block_size_,
                            reinterpret_cast<uint32_t>(GetImageAddress(image_roots.get())),
                            oat_file_->GetOatHeader().GetChecksum(),
                            reinterpret_cast<uint32_t>(oat_file_begin),
@@ -458,42 +662,81 @@ void ImageWriter::CalculateNewObjectOffsets(size_t oat_loaded_size, size_t oat_d
   // Note that image_end_ is left at end of used space
 }
 
-void ImageWriter::CopyAndFixupObjects()
-    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+class CopyAndFixupObjectsTask : public Task {
+ public:
+  CopyAndFixupObjectsTask(ImageWriter* image_writer, Object* const* begin, Object* const* end)
+      : image_writer_(image_writer), begin_(begin), end_(end) {}
+
+  virtual void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    const char* old_cause = self->StartAssertNoThreadSuspension("ImageWriter");
+    for (Object* const* it = begin_; it != end_; ++it) {
+      image_writer_->CopyAndFixupObject(*it);
+    }
+    self->EndAssertNoThreadSuspension(old_cause);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  ImageWriter* const image_writer_;
+  Object* const* const begin_;
+  Object* const* const end_;
+};
+
+void ImageWriter::CopyAndFixupObjects() {
+  static const size_t kObjectsPerTask = 4096;
   Thread* self = Thread::Current();
-  const char* old_cause = self->StartAssertNoThreadSuspension("ImageWriter");
   gc::Heap* heap = Runtime::Current()->GetHeap();
   // TODO: heap validation can't handle this fix up pass
   heap->DisableObjectValidation();
-  // TODO: Image spaces only?
-  WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
-  heap->FlushAllocStack();
-  heap->GetLiveBitmap()->Walk(CopyAndFixupObjectsCallback, this);
-  self->EndAssertNoThreadSuspension(old_cause);
+  std::vector<Object*> objects;
+  {
+    ScopedObjectAccess soa(self);
+    // TODO: Image spaces only?
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    heap->FlushAllocStack();
+    heap->GetLiveBitmap()->Walk(CollectObjectsCallback, &objects);
+  }
+  // Nothing allocates from here on so the objects stay put while we are suspended.
+  ThreadPool thread_pool(compiler_driver_.GetThreadCount() - 1);
+  for (size_t begin = 0; begin < objects.size(); begin += kObjectsPerTask) {
+    size_t end = std::min(begin + kObjectsPerTask, objects.size());
+    thread_pool.AddTask(self, new CopyAndFixupObjectsTask(this, objects.data() + begin,
+                                                             objects.data() + end));
+  }
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, true, false);
 }
 
-void ImageWriter::CopyAndFixupObjectsCallback(Object* object, void* arg) {
-  DCHECK(object != NULL);
+void ImageWriter::CollectObjectsCallback(Object* obj, void* arg) {
+  DCHECK(obj != NULL);
   DCHECK(arg != NULL);
-  const Object* obj = object;
-  ImageWriter* image_writer = reinterpret_cast<ImageWriter*>(arg);
+  reinterpret_cast<std::vector<Object*>*>(arg)->push_back(obj);
+}
 
+void ImageWriter::CopyAndFixupObject(const Object* obj) {
   // see GetLocalAddress for similar computation
-  size_t offset = image_writer->GetImageOffset(obj);
-  byte* dst = image_writer->image_->Begin() + offset;
+  size_t offset = GetImageOffset(obj);
+  byte* dst = image_->Begin() + offset;
   const byte* src = reinterpret_cast<const byte*>(obj);
   size_t n = obj->SizeOf();
-  DCHECK_LT(offset + n, image_writer->image_->Size());
+  DCHECK_LT(offset + n, image_->Size());
   memcpy(dst, src, n);
   Object* copy = reinterpret_cast<Object*>(dst);
-  copy->SetField32(Object::MonitorOffset(), 0, false);  // We may have inflated the lock during compilation.
-  image_writer->FixupObject(obj, copy);
+  // We may have inflated the lock during compilation, the identity hash code is kept.
+  copy->SetField32(Object::MonitorOffset(), Monitor::GetUnlockedLockWord(const_cast<Object*>(obj)),
+                   false);
+  FixupObject(obj, copy);
 }
 
 void ImageWriter::FixupObject(const Object* orig, Object* copy) {
   DCHECK(orig != NULL);
   DCHECK(copy != NULL);
   copy->SetClass(down_cast<Class*>(GetImageAddress(orig->GetClass())));
+  RecordImageRelocation(copy, Object::ClassOffset());
   // TODO: special case init of pointers to malloc data (or removal of these pointers)
   if (orig->IsClass()) {
     FixupClass(orig->AsClass(), down_cast<Class*>(copy));
@@ -577,6 +820,11 @@ void ImageWriter::FixupObjectArray(const ObjectArray<Object>* orig, ObjectArray<
   for (int32_t i = 0; i < orig->GetLength(); ++i) {
     const Object* element = orig->Get(i);
     copy->SetPtrWithoutChecks(i, GetImageAddress(element));
+    if (element != NULL) {
+      size_t element_offset = mirror::Array::DataOffset(sizeof(Object*)).Uint32Value() +
+          i * sizeof(Object*);
+      RecordImageRelocation(copy, MemberOffset(element_offset));
+    }
   }
 }
 
@@ -612,6 +860,9 @@ void ImageWriter::FixupFields(const Object* orig,
       const Object* ref = orig->GetFieldObject<const Object*>(byte_offset, false);
       // Use SetFieldPtr to avoid card marking since we are writing to the image.
       copy->SetFieldPtr(byte_offset, GetImageAddress(ref), false);
+      if (ref != NULL) {
+        RecordImageRelocation(copy, byte_offset);
+      }
       ref_offsets &= ~(CLASS_HIGH_BIT >> right_shift);
     }
   } else {
@@ -633,6 +884,9 @@ void ImageWriter::FixupFields(const Object* orig,
         const Object* ref = orig->GetFieldObject<const Object*>(field_offset, false);
         // Use SetFieldPtr to avoid card marking since we are writing to the image.
         copy->SetFieldPtr(field_offset, GetImageAddress(ref), false);
+        if (ref != NULL) {
+          RecordImageRelocation(copy, field_offset);
+        }
       }
     }
   }
@@ -643,9 +897,22 @@ void ImageWriter::FixupFields(const Object* orig,
     const Object* ref = orig->GetFieldObject<const Object*>(field_offset, false);
     // Use SetFieldPtr to avoid card marking since we are writing to the image.
     copy->SetFieldPtr(field_offset, GetImageAddress(ref), false);
+    if (ref != NULL) {
+      RecordImageRelocation(copy, field_offset);
+    }
   }
 }
 
+void ImageWriter::RecordImageRelocation(const Object* copy, MemberOffset offset) {
+  const byte* location = reinterpret_cast<const byte*>(copy) + offset.Uint32Value();
+  size_t index = (location - image_->Begin()) / sizeof(uint32_t);
+  DCHECK_ALIGNED(location, sizeof(uint32_t));
+  DCHECK_LT(index / kBitsPerWord, image_relocations_.size());
+  // Objects are copied in parallel and neighbouring objects can share a word of the bitmap.
+  android_atomic_or(static_cast<int32_t>(1U << (index % kBitsPerWord)),
+                    &image_relocations_[index / kBitsPerWord]);
+}
+
 static ArtMethod* GetTargetMethod(const CompilerDriver::PatchInformation* patch)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
@@ -688,6 +955,10 @@ void ImageWriter::PatchOatCodeAndMethods() {
     const CompilerDriver::PatchInformation* patch = methods_to_patch[i];
     ArtMethod* target = GetTargetMethod(patch);
     SetPatchLocation(patch, reinterpret_cast<uint32_t>(GetImageAddress(target)));
+    // The code holds the address of an image method, record it for relocating the image.
+    const byte* patch_location = reinterpret_cast<const byte*>(GetPatchLocation(patch));
+    oat_relocations_.push_back(
+        patch_location - reinterpret_cast<const byte*>(&oat_file_->GetOatHeader()));
   }
 
   // Update the image header with the new checksum after patching
@@ -696,15 +967,19 @@ void ImageWriter::PatchOatCodeAndMethods() {
   self->EndAssertNoThreadSuspension(old_cause);
 }
 
-void ImageWriter::SetPatchLocation(const CompilerDriver::PatchInformation* patch, uint32_t value) {
+uint32_t* ImageWriter::GetPatchLocation(const CompilerDriver::PatchInformation* patch) const {
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   const void* oat_code = class_linker->GetOatCodeFor(patch->GetDexFile(),
                                                      patch->GetReferrerClassDefIdx(),
                                                      patch->GetReferrerMethodIdx());
-  OatHeader& oat_header = const_cast<OatHeader&>(oat_file_->GetOatHeader());
   // TODO: make this Thumb2 specific
   uint8_t* base = reinterpret_cast<uint8_t*>(reinterpret_cast<uint32_t>(oat_code) & ~0x1);
-  uint32_t* patch_location = reinterpret_cast<uint32_t*>(base + patch->GetLiteralOffset());
+  return reinterpret_cast<uint32_t*>(base + patch->GetLiteralOffset());
+}
+
+void ImageWriter::SetPatchLocation(const CompilerDriver::PatchInformation* patch, uint32_t value) {
+  OatHeader& oat_header = const_cast<OatHeader&>(oat_file_->GetOatHeader());
+  uint32_t* patch_location = GetPatchLocation(patch);
 #ifndef NDEBUG
   const DexFile::MethodId& id = patch->GetDexFile().GetMethodId(patch->GetTargetMethodIdx());
   uint32_t expected = reinterpret_cast<uint32_t>(&id);
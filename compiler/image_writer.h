@@ -22,7 +22,9 @@
 #include <cstddef>
 #include <set>
 #include <string>
+#include <vector>
 
+#include "base/timing_logger.h"
 #include "driver/compiler_driver.h"
 #include "mem_map.h"
 #include "oat_file.h"
@@ -37,8 +39,14 @@ namespace art {
 // Write a Space built during compilation for use during execution.
 class ImageWriter {
  public:
-  explicit ImageWriter(const CompilerDriver& compiler_driver)
-      : compiler_driver_(compiler_driver), oat_file_(NULL), image_end_(0), image_begin_(NULL),
+  // Images are compressed in blocks of this size when compressed, large enough for deflate to
+  // find repeats across objects, small enough to spread the inflation across cores.
+  static const size_t kCompressedImageBlockSize = 64 * KB;
+
+  // The image is compressed in blocks of image_block_size bytes unless it is 0.
+  ImageWriter(const CompilerDriver& compiler_driver, size_t image_block_size)
+      : compiler_driver_(compiler_driver), image_block_size_(image_block_size), oat_file_(NULL),
+        image_end_(0), image_begin_(NULL),
         oat_data_begin_(NULL), interpreter_to_interpreter_bridge_offset_(0),
         interpreter_to_compiled_code_bridge_offset_(0), portable_resolution_trampoline_offset_(0),
         quick_resolution_trampoline_offset_(0) {}
@@ -48,7 +56,8 @@ class ImageWriter {
   bool Write(const std::string& image_filename,
              uintptr_t image_begin,
              const std::string& oat_filename,
-             const std::string& oat_location)
+             const std::string& oat_location,
+             base::TimingLogger& timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_);
 
   uintptr_t GetOatDataBegin() {
@@ -148,10 +157,24 @@ class ImageWriter {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static void CalculateNewObjectOffsetsCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Places the objects touched by most compiled code at the start of the image: the dex caches
+  // and their resolution arrays, then the profiled methods and their classes, if any.
+  void AssignHotObjectOffsets()
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  void AssignImageOffsetIfUnassigned(mirror::Object* object)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Places the objects the runtime is expected to write to, after the hot ones.
+  static void AssignDirtyObjectOffsetsCallback(mirror::Object* obj, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static bool IsLikelyDirtiedAtRuntime(mirror::Object* obj)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  // Creates the contiguous image in memory and adjusts pointers.
-  void CopyAndFixupObjects();
-  static void CopyAndFixupObjectsCallback(mirror::Object* obj, void* arg)
+  // Creates the contiguous image in memory and adjusts pointers. Every object is copied to its
+  // own part of the image so this is spread over the compiler's number of threads.
+  void CopyAndFixupObjects()
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+  static void CollectObjectsCallback(mirror::Object* obj, void* arg);
+  void CopyAndFixupObject(const mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void FixupClass(const mirror::Class* orig, mirror::Class* copy)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -169,16 +192,26 @@ class ImageWriter {
   void FixupFields(const mirror::Object* orig, mirror::Object* copy, uint32_t ref_offsets,
                    bool is_static)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Records that the field at offset of the copy holds the address of an image object.
+  void RecordImageRelocation(const mirror::Object* copy, MemberOffset offset);
 
   // Patches references in OatFile to expect runtime addresses.
   void PatchOatCodeAndMethods()
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  uint32_t* GetPatchLocation(const CompilerDriver::PatchInformation* patch) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void SetPatchLocation(const CompilerDriver::PatchInformation* patch, uint32_t value)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
 
+  // Deflates the blocks of the image in parallel and writes them with their index after the
+  // oat relocations, then the header.
+  bool WriteImageBlocks(File* image_file, const ImageHeader& image_header);
+
   const CompilerDriver& compiler_driver_;
 
+  const size_t image_block_size_;
+
   // Map of Object to where it will be at runtime.
   SafeMap<const mirror::Object*, size_t> offsets_;
 
@@ -200,6 +233,12 @@ class ImageWriter {
   // Image bitmap which lets us know where the objects inside of the image reside.
   UniquePtr<gc::accounting::SpaceBitmap> image_bitmap_;
 
+  // Bitmap of the 32-bit words of the image that hold the address of an image object.
+  std::vector<int32_t> image_relocations_;
+
+  // Offsets from oat_data_begin_ of the words of compiled code holding an image method address.
+  std::vector<uint32_t> oat_relocations_;
+
   // Offset from oat_data_begin_ to the stubs.
   uint32_t interpreter_to_interpreter_bridge_offset_;
   uint32_t interpreter_to_compiled_code_bridge_offset_;
@@ -211,6 +250,8 @@ class ImageWriter {
 
   // DexCaches seen while scanning for fixing up CodeAndDirectMethods
   std::set<mirror::DexCache*> dex_caches_;
+
+  friend class CopyAndFixupObjectsTask;
 };
 
 }  // namespace art
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/logging.h"
+#include "compiled_method.h"
+#include "driver/compiler_driver.h"
+#include "jit/jit_code_cache.h"
+#include "oat_file.h"
+#include "thread.h"
+#include "UniquePtr.h"
+
+// The entry points the runtime's JIT looks up once it loads libart-compiler.
+
+namespace art {
+
+static InstructionSet RuntimeInstructionSet() {
+#if defined(__arm__)
+  return kThumb2;
+#elif defined(__mips__)
+  return kMips;
+#elif defined(__i386__)
+  return kX86;
+#else
+  return kNone;
+#endif
+}
+
+}  // namespace art
+
+extern "C" void* ArtJitCreateCompiler() {
+  art::InstructionSet instruction_set = art::RuntimeInstructionSet();
+  CHECK_NE(instruction_set, art::kNone);
+  return new art::CompilerDriver(art::kQuick, instruction_set, false, NULL, 1, false);
+}
+
+extern "C" void ArtJitDeleteCompiler(void* compiler) {
+  delete reinterpret_cast<art::CompilerDriver*>(compiler);
+}
+
+extern "C" art::OatFile::OatMethod* ArtJitCompileMethod(void* compiler, art::Thread* self,
+                                                        art::mirror::ArtMethod* method,
+                                                        art::jit::JitCodeCache* code_cache) {
+  art::CompilerDriver* driver = reinterpret_cast<art::CompilerDriver*>(compiler);
+  UniquePtr<art::CompiledMethod> compiled_method(driver->CompileJitMethod(self, method));
+  if (compiled_method.get() == NULL) {
+    return NULL;
+  }
+  uint32_t mapping_table_offset;
+  uint32_t vmap_table_offset;
+  uint32_t gc_map_offset;
+  // The JIT driver has no swap space, the arrays are copied out of the heap.
+  const art::SwapVector<uint8_t>& compiled_code = compiled_method->GetCode();
+  const art::SwapVector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
+  const art::SwapVector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
+  const art::SwapVector<uint8_t>& gc_map = compiled_method->GetGcMap();
+  const art::byte* code =
+      code_cache->CommitMethod(self, method,
+                               std::vector<uint8_t>(compiled_code.begin(), compiled_code.end()),
+                               std::vector<uint8_t>(mapping_table.begin(), mapping_table.end()),
+                               std::vector<uint8_t>(vmap_table.begin(), vmap_table.end()),
+                               std::vector<uint8_t>(gc_map.begin(), gc_map.end()),
+                               &mapping_table_offset, &vmap_table_offset, &gc_map_offset);
+  if (code == NULL) {
+    return NULL;
+  }
+  uint32_t code_offset = code - code_cache->Begin() + compiled_method->CodeDelta();
+  return new art::OatFile::OatMethod(code_cache->Begin(), code_offset,
+                                     compiled_method->GetFrameSizeInBytes(),
+                                     compiled_method->GetCoreSpillMask(),
+                                     compiled_method->GetFpSpillMask(),
+                                     mapping_table_offset, vmap_table_offset, gc_map_offset);
+}
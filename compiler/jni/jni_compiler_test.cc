@@ -383,6 +383,45 @@ TEST_F(JniCompilerTest, CompileAndRunStaticIntIntMethod) {
   EXPECT_EQ(1, gJava_MyClassNatives_fooSII_calls);
 }
 
+int gJava_MyClassNatives_fastFooSII_calls = 0;
+jint Java_MyClassNatives_fastFooSII(JNIEnv* env, jclass klass, jint x, jint y) {
+  // 1 = klass
+  EXPECT_EQ(1U, Thread::Current()->NumStackReferences());
+  // Fast natives don't leave the runnable state.
+  EXPECT_EQ(kRunnable, Thread::Current()->GetState());
+  Locks::mutator_lock_->AssertSharedHeld(Thread::Current());
+  EXPECT_EQ(Thread::Current()->GetJniEnv(), env);
+  EXPECT_TRUE(klass != NULL);
+  EXPECT_TRUE(env->IsInstanceOf(JniCompilerTest::jobj_, klass));
+  gJava_MyClassNatives_fastFooSII_calls++;
+  return x + y;
+}
+
+TEST_F(JniCompilerTest, CompileAndRunStaticFastIntIntMethod) {
+  TEST_DISABLED_FOR_PORTABLE();
+  SetUpForTest(true, "fooSII", "(II)I",
+               reinterpret_cast<void*>(&Java_MyClassNatives_fooSII));
+  JNINativeMethod methods[] = {
+      { "fooSII", "!(II)I", reinterpret_cast<void*>(&Java_MyClassNatives_fastFooSII) } };
+  ASSERT_EQ(JNI_OK, env_->RegisterNatives(jklass_, methods, 1));
+
+  EXPECT_EQ(0, gJava_MyClassNatives_fastFooSII_calls);
+  jint result = env_->CallStaticIntMethod(jklass_, jmethod_, 20, 30);
+  EXPECT_EQ(50, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_fastFooSII_calls);
+  EXPECT_EQ(kNative, Thread::Current()->GetState());
+
+  // Registering without the '!' makes the method an ordinary native again.
+  int fooSII_calls = gJava_MyClassNatives_fooSII_calls;
+  methods[0].signature = "(II)I";
+  methods[0].fnPtr = reinterpret_cast<void*>(&Java_MyClassNatives_fooSII);
+  ASSERT_EQ(JNI_OK, env_->RegisterNatives(jklass_, methods, 1));
+  result = env_->CallStaticIntMethod(jklass_, jmethod_, 20, 30);
+  EXPECT_EQ(50, result);
+  EXPECT_EQ(1, gJava_MyClassNatives_fastFooSII_calls);
+  EXPECT_EQ(fooSII_calls + 1, gJava_MyClassNatives_fooSII_calls);
+}
+
 int gJava_MyClassNatives_fooSDD_calls = 0;
 jdouble Java_MyClassNatives_fooSDD(JNIEnv* env, jclass klass, jdouble x, jdouble y) {
   // 1 = klass
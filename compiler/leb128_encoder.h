@@ -41,6 +41,14 @@ class UnsignedLeb128EncodingVector {
     } while (!done);
   }
 
+  // Appends value as 4 little-endian bytes, for fixed width data such as lookup indices.
+  void PushBackFixed32(uint32_t value) {
+    data_.push_back(value & 0xff);
+    data_.push_back((value >> 8) & 0xff);
+    data_.push_back((value >> 16) & 0xff);
+    data_.push_back((value >> 24) & 0xff);
+  }
+
   template<typename It>
   void InsertBack(It cur, It end) {
     for (; cur != end; ++cur) {
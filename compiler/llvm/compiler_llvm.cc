@@ -116,6 +116,7 @@ CompilerLLVM::CompilerLLVM(CompilerDriver* driver, InstructionSet insn_set)
 
 
 CompilerLLVM::~CompilerLLVM() {
+  STLDeleteElements(&cunits_);
 }
 
 
@@ -127,13 +128,26 @@ LlvmCompilationUnit* CompilerLLVM::AllocateCompilationUnit() {
                                            bitcode_filename_.c_str(),
                                            cunit->GetCompilationUnitId()));
   }
+  cunits_.push_back(cunit);
+  return cunit;
+}
+
+
+LlvmCompilationUnit* CompilerLLVM::GetThreadCompilationUnit() {
+  CompilerTls* tls = compiler_driver_->GetTls();
+  CHECK(tls != NULL);
+  LlvmCompilationUnit* cunit = static_cast<LlvmCompilationUnit*>(tls->GetLlvmCompilationUnit());
+  if (cunit == NULL) {
+    cunit = AllocateCompilationUnit();
+    tls->SetLlvmCompilationUnit(cunit);
+  }
   return cunit;
 }
 
 
 CompiledMethod* CompilerLLVM::
 CompileDexMethod(DexCompilationUnit* dex_compilation_unit, InvokeType invoke_type) {
-  UniquePtr<LlvmCompilationUnit> cunit(AllocateCompilationUnit());
+  LlvmCompilationUnit* cunit = GetThreadCompilationUnit();
 
   cunit->SetDexCompilationUnit(dex_compilation_unit);
   cunit->SetCompilerDriver(compiler_driver_);
@@ -147,7 +161,7 @@ CompileDexMethod(DexCompilationUnit* dex_compilation_unit, InvokeType invoke_typ
                    dex_compilation_unit->GetDexMethodIndex(),
                    dex_compilation_unit->GetClassLoader(),
                    *dex_compilation_unit->GetDexFile(),
-                   cunit.get());
+                   cunit);
 
   cunit->Materialize();
 
@@ -161,10 +175,13 @@ CompileDexMethod(DexCompilationUnit* dex_compilation_unit, InvokeType invoke_typ
 
 CompiledMethod* CompilerLLVM::
 CompileNativeMethod(DexCompilationUnit* dex_compilation_unit) {
-  UniquePtr<LlvmCompilationUnit> cunit(AllocateCompilationUnit());
+  LlvmCompilationUnit* cunit = GetThreadCompilationUnit();
+  // The JNI stubs don't go through the GBC expander with a dex method.
+  cunit->SetDexCompilationUnit(NULL);
+  cunit->SetCompilerDriver(NULL);
 
   UniquePtr<JniCompiler> jni_compiler(
-      new JniCompiler(cunit.get(), *compiler_driver_, dex_compilation_unit));
+      new JniCompiler(cunit, *compiler_driver_, dex_compilation_unit));
 
   return jni_compiler->Compile();
 }
@@ -84,12 +84,18 @@ class CompilerLLVM {
  private:
   LlvmCompilationUnit* AllocateCompilationUnit();
 
+  // Returns the compilation unit of the calling worker thread. Each thread compiles all of its
+  // methods in one unit so that the LLVM context, the runtime declarations and the target machine
+  // are only set up once per thread, and threads never share LLVM state.
+  LlvmCompilationUnit* GetThreadCompilationUnit();
+
   CompilerDriver* const compiler_driver_;
 
   const InstructionSet insn_set_;
 
   Mutex next_cunit_id_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   size_t next_cunit_id_ GUARDED_BY(next_cunit_id_lock_);
+  std::vector<LlvmCompilationUnit*> cunits_ GUARDED_BY(next_cunit_id_lock_);
 
   std::string bitcode_filename_;
 
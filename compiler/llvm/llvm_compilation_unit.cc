@@ -97,7 +97,7 @@ CreateGBCExpanderPass(const IntrinsicHelper& intrinsic_helper, IRBuilder& irb,
 
 
 LlvmCompilationUnit::LlvmCompilationUnit(const CompilerLLVM* compiler_llvm, size_t cunit_id)
-    : compiler_llvm_(compiler_llvm), cunit_id_(cunit_id) {
+    : compiler_llvm_(compiler_llvm), cunit_id_(cunit_id), materialize_count_(0) {
   driver_ = NULL;
   dex_compilation_unit_ = NULL;
   llvm_info_.reset(new LLVMInfo());
@@ -173,7 +173,11 @@ bool LlvmCompilationUnit::Materialize() {
   }
 
   // Compile and prelink ::llvm::Module
-  if (!MaterializeToString(elf_object_)) {
+  elf_object_.clear();
+  bool success = MaterializeToString(elf_object_);
+  ++materialize_count_;
+  EraseMethods();
+  if (!success) {
     LOG(ERROR) << "Failed to materialize compilation unit " << cunit_id_;
     return false;
   }
@@ -191,6 +195,17 @@ bool LlvmCompilationUnit::Materialize() {
 }
 
 
+void LlvmCompilationUnit::EraseMethods() {
+  ::llvm::Module::iterator F = module_->begin();
+  while (F != module_->end()) {
+    ::llvm::Function* func = F++;
+    if (!func->isDeclaration()) {
+      func->eraseFromParent();
+    }
+  }
+}
+
+
 bool LlvmCompilationUnit::MaterializeToString(std::string& str_buffer) {
   ::llvm::raw_string_ostream str_os(str_buffer);
   return MaterializeToRawOStream(str_os);
@@ -204,29 +219,31 @@ bool LlvmCompilationUnit::MaterializeToRawOStream(::llvm::raw_ostream& out_strea
   std::string target_attr;
   CompilerDriver::InstructionSetToLLVMTarget(GetInstructionSet(), target_triple, target_cpu, target_attr);
 
-  std::string errmsg;
-  const ::llvm::Target* target =
-    ::llvm::TargetRegistry::lookupTarget(target_triple, errmsg);
+  if (target_machine_.get() == NULL) {
+    std::string errmsg;
+    const ::llvm::Target* target =
+      ::llvm::TargetRegistry::lookupTarget(target_triple, errmsg);
 
-  CHECK(target != NULL) << errmsg;
+    CHECK(target != NULL) << errmsg;
 
-  // Target options
-  ::llvm::TargetOptions target_options;
-  target_options.FloatABIType = ::llvm::FloatABI::Soft;
-  target_options.NoFramePointerElim = true;
-  target_options.UseSoftFloat = false;
-  target_options.EnableFastISel = false;
+    // Target options
+    ::llvm::TargetOptions target_options;
+    target_options.FloatABIType = ::llvm::FloatABI::Soft;
+    target_options.NoFramePointerElim = true;
+    target_options.UseSoftFloat = false;
+    target_options.EnableFastISel = false;
 
-  // Create the ::llvm::TargetMachine
-  ::llvm::OwningPtr< ::llvm::TargetMachine> target_machine(
-    target->createTargetMachine(target_triple, target_cpu, target_attr, target_options,
-                                ::llvm::Reloc::Static, ::llvm::CodeModel::Small,
-                                ::llvm::CodeGenOpt::Aggressive));
+    // Create the ::llvm::TargetMachine
+    target_machine_.reset(
+      target->createTargetMachine(target_triple, target_cpu, target_attr, target_options,
+                                  ::llvm::Reloc::Static, ::llvm::CodeModel::Small,
+                                  ::llvm::CodeGenOpt::Aggressive));
 
-  CHECK(target_machine.get() != NULL) << "Failed to create target machine";
+    CHECK(target_machine_.get() != NULL) << "Failed to create target machine";
+  }
 
   // Add target data
-  const ::llvm::DataLayout* data_layout = target_machine->getDataLayout();
+  const ::llvm::DataLayout* data_layout = target_machine_->getDataLayout();
 
   // PassManager for code generation passes
   ::llvm::PassManager pm;
@@ -256,7 +273,8 @@ bool LlvmCompilationUnit::MaterializeToRawOStream(::llvm::raw_ostream& out_strea
     std::string errmsg;
 
     ::llvm::OwningPtr< ::llvm::tool_output_file> out_file(
-      new ::llvm::tool_output_file(bitcode_filename_.c_str(), errmsg,
+      new ::llvm::tool_output_file(StringPrintf("%s-%zu", bitcode_filename_.c_str(),
+                                                materialize_count_).c_str(), errmsg,
                                  ::llvm::sys::fs::F_Binary));
 
 
@@ -280,14 +298,15 @@ bool LlvmCompilationUnit::MaterializeToRawOStream(::llvm::raw_ostream& out_strea
   pm_builder.DisableUnitAtATime = 1;
   pm_builder.populateFunctionPassManager(fpm);
   pm_builder.populateModulePassManager(pm);
-  pm.add(::llvm::createStripDeadPrototypesPass());
+  // Don't strip the unused prototypes, the runtime support and intrinsic helpers keep pointers
+  // to them for the methods the unit compiles next.
 
   // Add passes to emit ELF image
   {
     ::llvm::formatted_raw_ostream formatted_os(out_stream, false);
 
     // Ask the target to add backend passes as necessary.
-    if (target_machine->addPassesToEmitFile(pm,
+    if (target_machine_->addPassesToEmitFile(pm,
                                             formatted_os,
                                             ::llvm::TargetMachine::CGFT_ObjectFile,
                                             true)) {
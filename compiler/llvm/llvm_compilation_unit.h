@@ -40,6 +40,7 @@ namespace llvm {
   class Function;
   class LLVMContext;
   class Module;
+  class TargetMachine;
   class raw_ostream;
 }
 
@@ -88,6 +89,8 @@ class LlvmCompilationUnit {
     dex_compilation_unit_ = dex_compilation_unit;
   }
 
+  // Compiles the methods added to the module since the last call to an ELF object and then
+  // removes their bodies, leaving the runtime declarations for the next method.
   bool Materialize();
 
   bool IsMaterialized() const {
@@ -119,6 +122,12 @@ class LlvmCompilationUnit {
 
   std::string elf_object_;
 
+  // Created by the first Materialize and reused by the next ones.
+  UniquePtr< ::llvm::TargetMachine> target_machine_;
+
+  // Number of times the unit was materialized, to name the bitcode files.
+  size_t materialize_count_;
+
   SafeMap<const ::llvm::Function*, CompiledMethod*> compiled_methods_map_;
 
   void CheckCodeAlign(uint32_t offset) const;
@@ -129,6 +138,8 @@ class LlvmCompilationUnit {
   bool MaterializeToString(std::string& str_buffer);
   bool MaterializeToRawOStream(::llvm::raw_ostream& out_stream);
 
+  void EraseMethods();
+
   friend class CompilerLLVM;  // For LlvmCompilationUnit constructor
 };
 
@@ -221,11 +221,10 @@ void RuntimeSupportBuilder::EmitUnlockObject(::llvm::Value* object) {
                                 kTBAARuntimeInfo);
 
   Value* my_monitor = irb_.CreateShl(lock_id, LW_LOCK_OWNER_SHIFT);
-  Value* hash_state = irb_.CreateAnd(monitor, (LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT));
-  Value* real_monitor = irb_.CreateAnd(monitor, ~(LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT));
 
-  // Is thin lock, held by us and not recursively acquired
-  Value* is_fast_path = irb_.CreateICmpEQ(real_monitor, my_monitor);
+  // Is thin lock, held by us and not recursively acquired. A thin lock is never held on a hashed
+  // word.
+  Value* is_fast_path = irb_.CreateICmpEQ(monitor, my_monitor);
 
   Function* parent_func = irb_.GetInsertBlock()->getParent();
   BasicBlock* bb_fast = BasicBlock::Create(context_, "unlock_fast", parent_func);
@@ -234,10 +233,10 @@ void RuntimeSupportBuilder::EmitUnlockObject(::llvm::Value* object) {
   irb_.CreateCondBr(is_fast_path, bb_fast, bb_slow, kLikely);
 
   irb_.SetInsertPoint(bb_fast);
-  // Set all bits to zero (except hash state)
+  // Set all bits to zero
   irb_.StoreToObjectOffset(object,
                            mirror::Object::MonitorOffset().Int32Value(),
-                           hash_state,
+                           irb_.getInt32(0),
                            kTBAARuntimeInfo);
   irb_.CreateBr(bb_cont);
 
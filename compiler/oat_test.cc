@@ -50,7 +50,7 @@ class OatTest : public CommonTest {
       uintptr_t oat_code_aligned = RoundDown(reinterpret_cast<uintptr_t>(oat_code), 2);
       oat_code = reinterpret_cast<const void*>(oat_code_aligned);
 
-      const std::vector<uint8_t>& code = compiled_method->GetCode();
+      const SwapVector<uint8_t>& code = compiled_method->GetCode();
       size_t code_size = code.size() * sizeof(code[0]);
       EXPECT_EQ(0, memcmp(oat_code, &code[0], code_size))
           << PrettyMethod(method) << " " << code_size;
@@ -125,6 +125,10 @@ TEST_F(OatTest, WriteRead) {
     const char* descriptor = dex_file->GetClassDescriptor(class_def);
 
     UniquePtr<const OatFile::OatClass> oat_class(oat_dex_file->GetOatClass(i));
+    if (!compile) {
+      // Nothing was compiled, so no class should carry method offsets.
+      EXPECT_EQ(kOatClassNoneCompiled, oat_class->GetType()) << descriptor;
+    }
 
     mirror::Class* klass = class_linker->FindClass(descriptor, NULL);
 
@@ -143,7 +147,7 @@ TEST_F(OatTest, WriteRead) {
 TEST_F(OatTest, OatHeaderSizeCheck) {
   // If this test is failing and you have to update these constants,
   // it is time to update OatHeader::kOatVersion
-  EXPECT_EQ(64U, sizeof(OatHeader));
+  EXPECT_EQ(68U, sizeof(OatHeader));
   EXPECT_EQ(28U, sizeof(OatMethodOffsets));
 }
 
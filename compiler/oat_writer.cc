@@ -22,10 +22,12 @@
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
 #include "dex_file-inl.h"
+#include "gc/space/image_space.h"
 #include "gc/space/space.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/array.h"
 #include "mirror/class_loader.h"
+#include "mirror/dex_cache-inl.h"
 #include "mirror/object-inl.h"
 #include "os.h"
 #include "output_stream.h"
@@ -70,7 +72,12 @@ OatWriter::OatWriter(const std::vector<const DexFile*>& dex_files,
     size_oat_dex_file_location_checksum_(0),
     size_oat_dex_file_offset_(0),
     size_oat_dex_file_methods_offsets_(0),
+    size_oat_dex_file_dex_cache_entries_(0),
+    size_oat_dex_file_method_dependency_hashes_(0),
     size_oat_class_status_(0),
+    size_oat_class_type_(0),
+    size_oat_class_verification_dependencies_(0),
+    size_oat_class_method_bitmaps_(0),
     size_oat_class_method_offsets_(0) {
   size_t offset = InitOatHeader();
   offset = InitOatDexFiles(offset);
@@ -108,6 +115,11 @@ size_t OatWriter::InitOatDexFiles(size_t offset) {
     const DexFile* dex_file = (*dex_files_)[i];
     CHECK(dex_file != NULL);
     OatDexFile* oat_dex_file = new OatDexFile(offset, *dex_file);
+    if (!compiler_driver_->IsImage()) {
+      ScopedObjectAccess soa(Thread::Current());
+      oat_dex_file->CollectDexCacheEntries(*dex_file);
+    }
+    oat_dex_file->CollectMethodDependencyHashes(*compiler_driver_, *dex_file);
     oat_dex_files_.push_back(oat_dex_file);
     offset += oat_dex_file->SizeOf();
   }
@@ -142,12 +154,21 @@ size_t OatWriter::InitOatClasses(size_t offset) {
       oat_dex_files_[i]->methods_offsets_[class_def_index] = offset;
       const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
       const byte* class_data = dex_file->GetClassData(class_def);
-      uint32_t num_methods = 0;
+      std::vector<CompiledMethod*> compiled_methods;
       if (class_data != NULL) {  // ie not an empty class, such as a marker interface
         ClassDataItemIterator it(*dex_file, class_data);
-        size_t num_direct_methods = it.NumDirectMethods();
-        size_t num_virtual_methods = it.NumVirtualMethods();
-        num_methods = num_direct_methods + num_virtual_methods;
+        // Skip fields
+        while (it.HasNextStaticField()) {
+          it.Next();
+        }
+        while (it.HasNextInstanceField()) {
+          it.Next();
+        }
+        for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+          compiled_methods.push_back(
+              compiler_driver_->GetCompiledMethod(MethodReference(dex_file, it.GetMemberIndex())));
+        }
+        DCHECK(!it.HasNext());
       }
 
       ClassReference class_ref(dex_file, class_def_index);
@@ -161,7 +182,14 @@ size_t OatWriter::InitOatClasses(size_t offset) {
         status = mirror::Class::kStatusNotReady;
       }
 
-      OatClass* oat_class = new OatClass(offset, status, num_methods);
+      std::vector<uint32_t> unresolved_type_indices;
+      bool has_verification_dependencies =
+          status == mirror::Class::kStatusRetryVerificationAtRuntime &&
+          GetVerificationDependencies(class_ref, &unresolved_type_indices);
+
+      OatClass* oat_class = new OatClass(offset, compiled_methods, status,
+                                         has_verification_dependencies ? &unresolved_type_indices
+                                                                       : NULL);
       oat_classes_.push_back(oat_class);
       offset += oat_class->SizeOf();
     }
@@ -170,6 +198,26 @@ size_t OatWriter::InitOatClasses(size_t offset) {
   return offset;
 }
 
+bool OatWriter::GetVerificationDependencies(ClassReference class_ref,
+                                            std::vector<uint32_t>* type_indices) const {
+  std::vector<std::string> descriptors;
+  if (!verifier::MethodVerifier::GetVerificationDependencies(class_ref, &descriptors)) {
+    return false;
+  }
+  const DexFile& dex_file = *class_ref.first;
+  for (size_t i = 0; i < descriptors.size(); ++i) {
+    const DexFile::StringId* string_id = dex_file.FindStringId(descriptors[i].c_str());
+    const DexFile::TypeId* type_id =
+        (string_id == NULL) ? NULL : dex_file.FindTypeId(dex_file.GetIndexForStringId(*string_id));
+    if (type_id == NULL) {
+      // Only referenced through an array type, the runtime has no index to check it with.
+      return false;
+    }
+    type_indices->push_back(dex_file.GetIndexForTypeId(*type_id));
+  }
+  return true;
+}
+
 size_t OatWriter::InitOatCode(size_t offset) {
   // calculate the offsets within OatHeader to executable code
   size_t old_offset = offset;
@@ -207,25 +255,43 @@ size_t OatWriter::InitOatCode(size_t offset) {
   return offset;
 }
 
+bool OatWriter::IsHotMethod(uint32_t method_idx, const DexFile& dex_file) const {
+  const CompilerDriver::MethodSet* profiled_methods = compiler_driver_->GetProfiledMethods();
+  return profiled_methods != NULL &&
+      profiled_methods->find(PrettyMethod(method_idx, dex_file)) != profiled_methods->end();
+}
+
 size_t OatWriter::InitOatCodeDexFiles(size_t offset) {
-  size_t oat_class_index = 0;
-  for (size_t i = 0; i != dex_files_->size(); ++i) {
-    const DexFile* dex_file = (*dex_files_)[i];
-    CHECK(dex_file != NULL);
-    offset = InitOatCodeDexFile(offset, oat_class_index, *dex_file);
+  for (int pass = HasHotPass() ? 0 : 1; pass != 2; ++pass) {
+    bool hot = (pass == 0);
+    size_t oat_class_index = 0;
+    for (size_t i = 0; i != dex_files_->size(); ++i) {
+      const DexFile* dex_file = (*dex_files_)[i];
+      CHECK(dex_file != NULL);
+      offset = InitOatCodeDexFile(offset, oat_class_index, *dex_file, hot);
+    }
+    if (hot) {
+      // Everything up to the end of the hot code is expected to be touched during startup.
+      oat_header_->SetStartupSize(offset);
+    }
   }
   return offset;
 }
 
 size_t OatWriter::InitOatCodeDexFile(size_t offset,
                                      size_t& oat_class_index,
-                                     const DexFile& dex_file) {
+                                     const DexFile& dex_file,
+                                     bool hot) {
   for (size_t class_def_index = 0;
        class_def_index < dex_file.NumClassDefs();
        class_def_index++, oat_class_index++) {
     const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
-    offset = InitOatCodeClassDef(offset, oat_class_index, class_def_index, dex_file, class_def);
-    oat_classes_[oat_class_index]->UpdateChecksum(*oat_header_);
+    offset = InitOatCodeClassDef(offset, oat_class_index, class_def_index, dex_file, class_def,
+                                 hot);
+    if (!hot) {
+      // The cold pass is the last, all method offsets of the class are known now.
+      oat_classes_[oat_class_index]->UpdateChecksum(*oat_header_);
+    }
   }
   return offset;
 }
@@ -233,14 +299,15 @@ size_t OatWriter::InitOatCodeDexFile(size_t offset,
 size_t OatWriter::InitOatCodeClassDef(size_t offset,
                                       size_t oat_class_index, size_t class_def_index,
                                       const DexFile& dex_file,
-                                      const DexFile::ClassDef& class_def) {
+                                      const DexFile::ClassDef& class_def,
+                                      bool hot) {
   const byte* class_data = dex_file.GetClassData(class_def);
   if (class_data == NULL) {
     // empty class, such as a marker interface
     return offset;
   }
   ClassDataItemIterator it(dex_file, class_data);
-  CHECK_EQ(oat_classes_[oat_class_index]->method_offsets_.size(),
+  CHECK_EQ(oat_classes_[oat_class_index]->NumMethods(),
            it.NumDirectMethods() + it.NumVirtualMethods());
   // Skip fields
   while (it.HasNextStaticField()) {
@@ -252,18 +319,22 @@ size_t OatWriter::InitOatCodeClassDef(size_t offset,
   // Process methods
   size_t class_def_method_index = 0;
   while (it.HasNextDirectMethod()) {
-    bool is_native = (it.GetMemberAccessFlags() & kAccNative) != 0;
-    offset = InitOatCodeMethod(offset, oat_class_index, class_def_index, class_def_method_index,
-                               is_native, it.GetMethodInvokeType(class_def), it.GetMemberIndex(),
-                               &dex_file);
+    if (IsHotMethod(it.GetMemberIndex(), dex_file) == hot) {
+      bool is_native = (it.GetMemberAccessFlags() & kAccNative) != 0;
+      offset = InitOatCodeMethod(offset, oat_class_index, class_def_index, class_def_method_index,
+                                 is_native, it.GetMethodInvokeType(class_def),
+                                 it.GetMemberIndex(), &dex_file);
+    }
     class_def_method_index++;
     it.Next();
   }
   while (it.HasNextVirtualMethod()) {
-    bool is_native = (it.GetMemberAccessFlags() & kAccNative) != 0;
-    offset = InitOatCodeMethod(offset, oat_class_index, class_def_index, class_def_method_index,
-                               is_native, it.GetMethodInvokeType(class_def), it.GetMemberIndex(),
-                               &dex_file);
+    if (IsHotMethod(it.GetMemberIndex(), dex_file) == hot) {
+      bool is_native = (it.GetMemberAccessFlags() & kAccNative) != 0;
+      offset = InitOatCodeMethod(offset, oat_class_index, class_def_index, class_def_method_index,
+                                 is_native, it.GetMethodInvokeType(class_def),
+                                 it.GetMemberIndex(), &dex_file);
+    }
     class_def_method_index++;
     it.Next();
   }
@@ -287,47 +358,53 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
   uint32_t gc_map_offset = 0;
 
   OatClass* oat_class = oat_classes_[oat_class_index];
-#if defined(ART_USE_PORTABLE_COMPILER)
-  size_t oat_method_offsets_offset =
-      oat_class->GetOatMethodOffsetsOffsetFromOatHeader(class_def_method_index);
-#endif
 
   CompiledMethod* compiled_method =
       compiler_driver_->GetCompiledMethod(MethodReference(dex_file, method_idx));
   if (compiled_method != NULL) {
+    DCHECK(oat_class->IsCompiled(class_def_method_index));
+    bool is_elf_object = false;
 #if defined(ART_USE_PORTABLE_COMPILER)
-    compiled_method->AddOatdataOffsetToCompliledCodeOffset(
-        oat_method_offsets_offset + OFFSETOF_MEMBER(OatMethodOffsets, code_offset_));
-#else
-    const std::vector<uint8_t>& code = compiled_method->GetCode();
-    offset = compiled_method->AlignCode(offset);
-    DCHECK_ALIGNED(offset, kArmAlignment);
-    uint32_t code_size = code.size() * sizeof(code[0]);
-    CHECK_NE(code_size, 0U);
-    uint32_t thumb_offset = compiled_method->CodeDelta();
-    code_offset = offset + sizeof(code_size) + thumb_offset;
-
-    // Deduplicate code arrays
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator code_iter = code_offsets_.find(&code);
-    if (code_iter != code_offsets_.end()) {
-      code_offset = code_iter->second;
-    } else {
-      code_offsets_.Put(&code, code_offset);
-      offset += sizeof(code_size);  // code size is prepended before code
-      offset += code_size;
-      oat_header_->UpdateChecksum(&code[0], code_size);
+    // MCLinker places the code of ELF objects and the ElfWriter fixes up the offset.
+    is_elf_object = compiled_method->IsElfObject();
+    if (is_elf_object) {
+      size_t oat_method_offsets_offset =
+          oat_class->GetOatMethodOffsetsOffsetFromOatHeader(class_def_method_index);
+      compiled_method->AddOatdataOffsetToCompliledCodeOffset(
+          oat_method_offsets_offset + OFFSETOF_MEMBER(OatMethodOffsets, code_offset_));
     }
 #endif
+    if (!is_elf_object) {
+      const SwapVector<uint8_t>& code = compiled_method->GetCode();
+      offset = compiled_method->AlignCode(offset);
+      DCHECK_ALIGNED(offset, kArmAlignment);
+      uint32_t code_size = code.size() * sizeof(code[0]);
+      CHECK_NE(code_size, 0U);
+      uint32_t thumb_offset = compiled_method->CodeDelta();
+      code_offset = offset + sizeof(code_size) + thumb_offset;
+
+      // Deduplicate code arrays
+      SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator code_iter =
+          code_offsets_.find(&code);
+      if (code_iter != code_offsets_.end()) {
+        code_offset = code_iter->second;
+      } else {
+        code_offsets_.Put(&code, code_offset);
+        offset += sizeof(code_size);  // code size is prepended before code
+        offset += code_size;
+        oat_header_->UpdateChecksum(&code[0], code_size);
+      }
+    }
     frame_size_in_bytes = compiled_method->GetFrameSizeInBytes();
     core_spill_mask = compiled_method->GetCoreSpillMask();
     fp_spill_mask = compiled_method->GetFpSpillMask();
 
-    const std::vector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
+    const SwapVector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
     size_t mapping_table_size = mapping_table.size() * sizeof(mapping_table[0]);
     mapping_table_offset = (mapping_table_size == 0) ? 0 : offset;
 
     // Deduplicate mapping tables
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator mapping_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator mapping_iter =
         mapping_table_offsets_.find(&mapping_table);
     if (mapping_iter != mapping_table_offsets_.end()) {
       mapping_table_offset = mapping_iter->second;
@@ -337,12 +414,12 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
       oat_header_->UpdateChecksum(&mapping_table[0], mapping_table_size);
     }
 
-    const std::vector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
+    const SwapVector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
     size_t vmap_table_size = vmap_table.size() * sizeof(vmap_table[0]);
     vmap_table_offset = (vmap_table_size == 0) ? 0 : offset;
 
     // Deduplicate vmap tables
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator vmap_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator vmap_iter =
         vmap_table_offsets_.find(&vmap_table);
     if (vmap_iter != vmap_table_offsets_.end()) {
       vmap_table_offset = vmap_iter->second;
@@ -352,7 +429,7 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
       oat_header_->UpdateChecksum(&vmap_table[0], vmap_table_size);
     }
 
-    const std::vector<uint8_t>& gc_map = compiled_method->GetGcMap();
+    const SwapVector<uint8_t>& gc_map = compiled_method->GetGcMap();
     size_t gc_map_size = gc_map.size() * sizeof(gc_map[0]);
     gc_map_offset = (gc_map_size == 0) ? 0 : offset;
 
@@ -375,7 +452,7 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
 #endif
 
     // Deduplicate GC maps
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator gc_map_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator gc_map_iter =
         gc_map_offsets_.find(&gc_map);
     if (gc_map_iter != gc_map_offsets_.end()) {
       gc_map_offset = gc_map_iter->second;
@@ -384,16 +461,16 @@ size_t OatWriter::InitOatCodeMethod(size_t offset, size_t oat_class_index,
       offset += gc_map_size;
       oat_header_->UpdateChecksum(&gc_map[0], gc_map_size);
     }
-  }
 
-  oat_class->method_offsets_[class_def_method_index] =
-      OatMethodOffsets(code_offset,
-                       frame_size_in_bytes,
-                       core_spill_mask,
-                       fp_spill_mask,
-                       mapping_table_offset,
-                       vmap_table_offset,
-                       gc_map_offset);
+    oat_class->GetOatMethodOffsets(class_def_method_index) =
+        OatMethodOffsets(code_offset,
+                         frame_size_in_bytes,
+                         core_spill_mask,
+                         fp_spill_mask,
+                         mapping_table_offset,
+                         vmap_table_offset,
+                         gc_map_offset);
+  }
 
   if (compiler_driver_->IsImage()) {
     ClassLinker* linker = Runtime::Current()->GetClassLinker();
@@ -491,7 +568,12 @@ bool OatWriter::Write(OutputStream& out) {
     DO_STAT(size_oat_dex_file_location_checksum_);
     DO_STAT(size_oat_dex_file_offset_);
     DO_STAT(size_oat_dex_file_methods_offsets_);
+    DO_STAT(size_oat_dex_file_dex_cache_entries_);
+    DO_STAT(size_oat_dex_file_method_dependency_hashes_);
     DO_STAT(size_oat_class_status_);
+    DO_STAT(size_oat_class_type_);
+    DO_STAT(size_oat_class_verification_dependencies_);
+    DO_STAT(size_oat_class_method_bitmaps_);
     DO_STAT(size_oat_class_method_offsets_);
     #undef DO_STAT
 
@@ -582,14 +664,18 @@ size_t OatWriter::WriteCode(OutputStream& out, const size_t file_offset) {
 size_t OatWriter::WriteCodeDexFiles(OutputStream& out,
                                     const size_t file_offset,
                                     size_t relative_offset) {
-  size_t oat_class_index = 0;
-  for (size_t i = 0; i != oat_dex_files_.size(); ++i) {
-    const DexFile* dex_file = (*dex_files_)[i];
-    CHECK(dex_file != NULL);
-    relative_offset = WriteCodeDexFile(out, file_offset, relative_offset, oat_class_index,
-                                       *dex_file);
-    if (relative_offset == 0) {
-      return 0;
+  // Same order as InitOatCodeDexFiles.
+  for (int pass = HasHotPass() ? 0 : 1; pass != 2; ++pass) {
+    bool hot = (pass == 0);
+    size_t oat_class_index = 0;
+    for (size_t i = 0; i != oat_dex_files_.size(); ++i) {
+      const DexFile* dex_file = (*dex_files_)[i];
+      CHECK(dex_file != NULL);
+      relative_offset = WriteCodeDexFile(out, file_offset, relative_offset, oat_class_index,
+                                         *dex_file, hot);
+      if (relative_offset == 0) {
+        return 0;
+      }
     }
   }
   return relative_offset;
@@ -597,12 +683,12 @@ size_t OatWriter::WriteCodeDexFiles(OutputStream& out,
 
 size_t OatWriter::WriteCodeDexFile(OutputStream& out, const size_t file_offset,
                                    size_t relative_offset, size_t& oat_class_index,
-                                   const DexFile& dex_file) {
+                                   const DexFile& dex_file, bool hot) {
   for (size_t class_def_index = 0; class_def_index < dex_file.NumClassDefs();
       class_def_index++, oat_class_index++) {
     const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
     relative_offset = WriteCodeClassDef(out, file_offset, relative_offset, oat_class_index,
-                                        dex_file, class_def);
+                                        dex_file, class_def, hot);
     if (relative_offset == 0) {
       return 0;
     }
@@ -621,7 +707,8 @@ size_t OatWriter::WriteCodeClassDef(OutputStream& out,
                                     size_t relative_offset,
                                     size_t oat_class_index,
                                     const DexFile& dex_file,
-                                    const DexFile::ClassDef& class_def) {
+                                    const DexFile::ClassDef& class_def,
+                                    bool hot) {
   const byte* class_data = dex_file.GetClassData(class_def);
   if (class_data == NULL) {
     // ie. an empty class such as a marker interface
@@ -638,21 +725,26 @@ size_t OatWriter::WriteCodeClassDef(OutputStream& out,
   // Process methods
   size_t class_def_method_index = 0;
   while (it.HasNextDirectMethod()) {
-    bool is_static = (it.GetMemberAccessFlags() & kAccStatic) != 0;
-    relative_offset = WriteCodeMethod(out, file_offset, relative_offset, oat_class_index,
-                                      class_def_method_index, is_static, it.GetMemberIndex(),
-                                      dex_file);
-    if (relative_offset == 0) {
-      return 0;
+    if (IsHotMethod(it.GetMemberIndex(), dex_file) == hot) {
+      bool is_static = (it.GetMemberAccessFlags() & kAccStatic) != 0;
+      relative_offset = WriteCodeMethod(out, file_offset, relative_offset, oat_class_index,
+                                        class_def_method_index, is_static, it.GetMemberIndex(),
+                                        dex_file);
+      if (relative_offset == 0) {
+        return 0;
+      }
     }
     class_def_method_index++;
     it.Next();
   }
   while (it.HasNextVirtualMethod()) {
-    relative_offset = WriteCodeMethod(out, file_offset, relative_offset, oat_class_index,
-                                      class_def_method_index, false, it.GetMemberIndex(), dex_file);
-    if (relative_offset == 0) {
-      return 0;
+    if (IsHotMethod(it.GetMemberIndex(), dex_file) == hot) {
+      relative_offset = WriteCodeMethod(out, file_offset, relative_offset, oat_class_index,
+                                        class_def_method_index, false, it.GetMemberIndex(),
+                                        dex_file);
+      if (relative_offset == 0) {
+        return 0;
+      }
     }
     class_def_method_index++;
     it.Next();
@@ -667,61 +759,64 @@ size_t OatWriter::WriteCodeMethod(OutputStream& out, const size_t file_offset,
   const CompiledMethod* compiled_method =
       compiler_driver_->GetCompiledMethod(MethodReference(&dex_file, method_idx));
 
-  OatMethodOffsets method_offsets =
-      oat_classes_[oat_class_index]->method_offsets_[class_def_method_index];
-
-
   if (compiled_method != NULL) {  // ie. not an abstract method
-#if !defined(ART_USE_PORTABLE_COMPILER)
-    uint32_t aligned_offset = compiled_method->AlignCode(relative_offset);
-    uint32_t aligned_code_delta = aligned_offset - relative_offset;
-    if (aligned_code_delta != 0) {
-      off_t new_offset = out.Seek(aligned_code_delta, kSeekCurrent);
-      size_code_alignment_ += aligned_code_delta;
-      uint32_t expected_offset = file_offset + aligned_offset;
-      if (static_cast<uint32_t>(new_offset) != expected_offset) {
-        PLOG(ERROR) << "Failed to seek to align oat code. Actual: " << new_offset
-                    << " Expected: " << expected_offset << " File: " << out.GetLocation();
-        return 0;
+    const OatMethodOffsets& method_offsets =
+        oat_classes_[oat_class_index]->GetOatMethodOffsets(class_def_method_index);
+    bool is_elf_object = false;
+#if defined(ART_USE_PORTABLE_COMPILER)
+    is_elf_object = compiled_method->IsElfObject();
+#endif
+    if (!is_elf_object) {
+      uint32_t aligned_offset = compiled_method->AlignCode(relative_offset);
+      uint32_t aligned_code_delta = aligned_offset - relative_offset;
+      if (aligned_code_delta != 0) {
+        off_t new_offset = out.Seek(aligned_code_delta, kSeekCurrent);
+        size_code_alignment_ += aligned_code_delta;
+        uint32_t expected_offset = file_offset + aligned_offset;
+        if (static_cast<uint32_t>(new_offset) != expected_offset) {
+          PLOG(ERROR) << "Failed to seek to align oat code. Actual: " << new_offset
+                      << " Expected: " << expected_offset << " File: " << out.GetLocation();
+          return 0;
+        }
+        relative_offset += aligned_code_delta;
+        DCHECK_OFFSET();
       }
-      relative_offset += aligned_code_delta;
-      DCHECK_OFFSET();
-    }
-    DCHECK_ALIGNED(relative_offset, kArmAlignment);
-    const std::vector<uint8_t>& code = compiled_method->GetCode();
-    uint32_t code_size = code.size() * sizeof(code[0]);
-    CHECK_NE(code_size, 0U);
-
-    // Deduplicate code arrays
-    size_t code_offset = relative_offset + sizeof(code_size) + compiled_method->CodeDelta();
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator code_iter = code_offsets_.find(&code);
-    if (code_iter != code_offsets_.end() && code_offset != method_offsets.code_offset_) {
-      DCHECK(code_iter->second == method_offsets.code_offset_)
-          << PrettyMethod(method_idx, dex_file);
-    } else {
-      DCHECK(code_offset == method_offsets.code_offset_) << PrettyMethod(method_idx, dex_file);
-      if (!out.WriteFully(&code_size, sizeof(code_size))) {
-        ReportWriteFailure("method code size", method_idx, dex_file, out);
-        return 0;
+      DCHECK_ALIGNED(relative_offset, kArmAlignment);
+      const SwapVector<uint8_t>& code = compiled_method->GetCode();
+      uint32_t code_size = code.size() * sizeof(code[0]);
+      CHECK_NE(code_size, 0U);
+
+      // Deduplicate code arrays
+      size_t code_offset = relative_offset + sizeof(code_size) + compiled_method->CodeDelta();
+      SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator code_iter =
+          code_offsets_.find(&code);
+      if (code_iter != code_offsets_.end() && code_offset != method_offsets.code_offset_) {
+        DCHECK(code_iter->second == method_offsets.code_offset_)
+            << PrettyMethod(method_idx, dex_file);
+      } else {
+        DCHECK(code_offset == method_offsets.code_offset_) << PrettyMethod(method_idx, dex_file);
+        if (!out.WriteFully(&code_size, sizeof(code_size))) {
+          ReportWriteFailure("method code size", method_idx, dex_file, out);
+          return 0;
+        }
+        size_code_size_ += sizeof(code_size);
+        relative_offset += sizeof(code_size);
+        DCHECK_OFFSET();
+        if (!out.WriteFully(&code[0], code_size)) {
+          ReportWriteFailure("method code", method_idx, dex_file, out);
+          return 0;
+        }
+        size_code_ += code_size;
+        relative_offset += code_size;
       }
-      size_code_size_ += sizeof(code_size);
-      relative_offset += sizeof(code_size);
       DCHECK_OFFSET();
-      if (!out.WriteFully(&code[0], code_size)) {
-        ReportWriteFailure("method code", method_idx, dex_file, out);
-        return 0;
-      }
-      size_code_ += code_size;
-      relative_offset += code_size;
     }
-    DCHECK_OFFSET();
-#endif
 
-    const std::vector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
+    const SwapVector<uint8_t>& mapping_table = compiled_method->GetMappingTable();
     size_t mapping_table_size = mapping_table.size() * sizeof(mapping_table[0]);
 
     // Deduplicate mapping tables
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator mapping_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator mapping_iter =
         mapping_table_offsets_.find(&mapping_table);
     if (mapping_iter != mapping_table_offsets_.end() &&
         relative_offset != method_offsets.mapping_table_offset_) {
@@ -741,11 +836,11 @@ size_t OatWriter::WriteCodeMethod(OutputStream& out, const size_t file_offset,
     }
     DCHECK_OFFSET();
 
-    const std::vector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
+    const SwapVector<uint8_t>& vmap_table = compiled_method->GetVmapTable();
     size_t vmap_table_size = vmap_table.size() * sizeof(vmap_table[0]);
 
     // Deduplicate vmap tables
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator vmap_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator vmap_iter =
         vmap_table_offsets_.find(&vmap_table);
     if (vmap_iter != vmap_table_offsets_.end() &&
         relative_offset != method_offsets.vmap_table_offset_) {
@@ -765,11 +860,11 @@ size_t OatWriter::WriteCodeMethod(OutputStream& out, const size_t file_offset,
     }
     DCHECK_OFFSET();
 
-    const std::vector<uint8_t>& gc_map = compiled_method->GetGcMap();
+    const SwapVector<uint8_t>& gc_map = compiled_method->GetGcMap();
     size_t gc_map_size = gc_map.size() * sizeof(gc_map[0]);
 
     // Deduplicate GC maps
-    SafeMap<const std::vector<uint8_t>*, uint32_t>::iterator gc_map_iter =
+    SafeMap<const SwapVector<uint8_t>*, uint32_t>::iterator gc_map_iter =
         gc_map_offsets_.find(&gc_map);
     if (gc_map_iter != gc_map_offsets_.end() &&
         relative_offset != method_offsets.gc_map_offset_) {
@@ -803,12 +898,63 @@ OatWriter::OatDexFile::OatDexFile(size_t offset, const DexFile& dex_file) {
   methods_offsets_.resize(dex_file.NumClassDefs());
 }
 
+void OatWriter::OatDexFile::CollectDexCacheEntries(const DexFile& dex_file) {
+  Runtime* runtime = Runtime::Current();
+  gc::space::ImageSpace* image_space = runtime->GetHeap()->GetImageSpace();
+  if (image_space == NULL || !runtime->GetClassLinker()->IsDexFileRegistered(dex_file)) {
+    return;
+  }
+  mirror::DexCache* dex_cache = runtime->GetClassLinker()->FindDexCache(dex_file);
+  // Objects of the boot image keep their address in every process that maps the same image.
+  for (size_t i = 0; i < dex_cache->NumStrings(); ++i) {
+    mirror::String* string = dex_cache->GetResolvedString(i);
+    if (string != NULL && image_space->Contains(string)) {
+      dex_cache_entries_[kOatDexCacheStrings].push_back(i);
+      dex_cache_entries_[kOatDexCacheStrings].push_back(reinterpret_cast<uint32_t>(string));
+    }
+  }
+  for (size_t i = 0; i < dex_cache->NumResolvedTypes(); ++i) {
+    mirror::Class* klass = dex_cache->GetResolvedType(i);
+    if (klass != NULL && image_space->Contains(klass)) {
+      dex_cache_entries_[kOatDexCacheTypes].push_back(i);
+      dex_cache_entries_[kOatDexCacheTypes].push_back(reinterpret_cast<uint32_t>(klass));
+    }
+  }
+  for (size_t i = 0; i < dex_cache->NumResolvedMethods(); ++i) {
+    // Unresolved methods hold the resolution method, which is in the image too.
+    mirror::ArtMethod* method = dex_cache->GetResolvedMethod(i);
+    if (method != NULL && !method->IsRuntimeMethod() && image_space->Contains(method)) {
+      dex_cache_entries_[kOatDexCacheMethods].push_back(i);
+      dex_cache_entries_[kOatDexCacheMethods].push_back(reinterpret_cast<uint32_t>(method));
+    }
+  }
+}
+
+void OatWriter::OatDexFile::CollectMethodDependencyHashes(const CompilerDriver& compiler_driver,
+                                                          const DexFile& dex_file) {
+  for (size_t i = 0; i < dex_file.NumMethodIds(); ++i) {
+    MethodReference method_ref(&dex_file, i);
+    CompiledMethod* compiled_method = compiler_driver.GetCompiledMethod(method_ref);
+    if (compiled_method != NULL && compiled_method->GetDependencyHash() != 0) {
+      uint64_t hash = compiled_method->GetDependencyHash();
+      method_dependency_hashes_.push_back(i);
+      method_dependency_hashes_.push_back(static_cast<uint32_t>(hash));
+      method_dependency_hashes_.push_back(static_cast<uint32_t>(hash >> 32));
+    }
+  }
+}
+
 size_t OatWriter::OatDexFile::SizeOf() const {
-  return sizeof(dex_file_location_size_)
+  size_t size = sizeof(dex_file_location_size_)
           + dex_file_location_size_
           + sizeof(dex_file_location_checksum_)
           + sizeof(dex_file_offset_)
           + (sizeof(methods_offsets_[0]) * methods_offsets_.size());
+  for (size_t i = 0; i < kOatDexCacheEntryKinds; ++i) {
+    size += sizeof(uint32_t) + sizeof(uint32_t) * dex_cache_entries_[i].size();
+  }
+  size += sizeof(uint32_t) + sizeof(uint32_t) * method_dependency_hashes_.size();
+  return size;
 }
 
 void OatWriter::OatDexFile::UpdateChecksum(OatHeader& oat_header) const {
@@ -818,6 +964,20 @@ void OatWriter::OatDexFile::UpdateChecksum(OatHeader& oat_header) const {
   oat_header.UpdateChecksum(&dex_file_offset_, sizeof(dex_file_offset_));
   oat_header.UpdateChecksum(&methods_offsets_[0],
                             sizeof(methods_offsets_[0]) * methods_offsets_.size());
+  for (size_t i = 0; i < kOatDexCacheEntryKinds; ++i) {
+    uint32_t num_entries = dex_cache_entries_[i].size() / 2;
+    oat_header.UpdateChecksum(&num_entries, sizeof(num_entries));
+    if (num_entries != 0) {
+      oat_header.UpdateChecksum(&dex_cache_entries_[i][0],
+                                sizeof(uint32_t) * dex_cache_entries_[i].size());
+    }
+  }
+  uint32_t num_hashes = method_dependency_hashes_.size() / 3;
+  oat_header.UpdateChecksum(&num_hashes, sizeof(num_hashes));
+  if (num_hashes != 0) {
+    oat_header.UpdateChecksum(&method_dependency_hashes_[0],
+                              sizeof(uint32_t) * method_dependency_hashes_.size());
+  }
 }
 
 bool OatWriter::OatDexFile::Write(OatWriter* oat_writer,
@@ -851,13 +1011,84 @@ bool OatWriter::OatDexFile::Write(OatWriter* oat_writer,
   }
   oat_writer->size_oat_dex_file_methods_offsets_ +=
       sizeof(methods_offsets_[0]) * methods_offsets_.size();
+  for (size_t i = 0; i < kOatDexCacheEntryKinds; ++i) {
+    uint32_t num_entries = dex_cache_entries_[i].size() / 2;
+    if (!out.WriteFully(&num_entries, sizeof(num_entries))) {
+      PLOG(ERROR) << "Failed to write dex cache entry count to " << out.GetLocation();
+      return false;
+    }
+    if (num_entries != 0 &&
+        !out.WriteFully(&dex_cache_entries_[i][0],
+                        sizeof(uint32_t) * dex_cache_entries_[i].size())) {
+      PLOG(ERROR) << "Failed to write dex cache entries to " << out.GetLocation();
+      return false;
+    }
+    oat_writer->size_oat_dex_file_dex_cache_entries_ +=
+        sizeof(num_entries) + sizeof(uint32_t) * dex_cache_entries_[i].size();
+  }
+  uint32_t num_hashes = method_dependency_hashes_.size() / 3;
+  if (!out.WriteFully(&num_hashes, sizeof(num_hashes))) {
+    PLOG(ERROR) << "Failed to write method dependency hash count to " << out.GetLocation();
+    return false;
+  }
+  if (num_hashes != 0 &&
+      !out.WriteFully(&method_dependency_hashes_[0],
+                      sizeof(uint32_t) * method_dependency_hashes_.size())) {
+    PLOG(ERROR) << "Failed to write method dependency hashes to " << out.GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_dex_file_method_dependency_hashes_ +=
+      sizeof(num_hashes) + sizeof(uint32_t) * method_dependency_hashes_.size();
   return true;
 }
 
-OatWriter::OatClass::OatClass(size_t offset, mirror::Class::Status status, uint32_t methods_count) {
+OatWriter::OatClass::OatClass(size_t offset,
+                              const std::vector<CompiledMethod*>& compiled_methods,
+                              mirror::Class::Status status,
+                              const std::vector<uint32_t>* unresolved_type_indices) {
   offset_ = offset;
   status_ = status;
-  method_offsets_.resize(methods_count);
+  unresolved_types_count_ = kOatClassUnknownVerificationDependencies;
+  if (unresolved_type_indices != NULL) {
+    DCHECK_EQ(status, mirror::Class::kStatusRetryVerificationAtRuntime);
+    unresolved_types_ = *unresolved_type_indices;
+    unresolved_types_count_ = unresolved_types_.size();
+  }
+  method_offsets_index_.resize(compiled_methods.size(), kNotCompiled);
+  uint32_t num_compiled_methods = 0;
+  for (size_t i = 0; i < compiled_methods.size(); ++i) {
+    if (compiled_methods[i] != NULL) {
+      method_offsets_index_[i] = num_compiled_methods++;
+    }
+  }
+  method_offsets_.resize(num_compiled_methods);
+
+  method_bitmap_size_ = 0;
+  if (num_compiled_methods == 0) {
+    type_ = kOatClassNoneCompiled;
+  } else if (num_compiled_methods == compiled_methods.size()) {
+    type_ = kOatClassAllCompiled;
+  } else {
+    type_ = kOatClassSomeCompiled;
+    method_bitmap_.resize(RoundUp(compiled_methods.size(), 32) / 32, 0U);
+    method_bitmap_size_ = method_bitmap_.size() * sizeof(method_bitmap_[0]);
+    for (size_t i = 0; i < compiled_methods.size(); ++i) {
+      if (compiled_methods[i] != NULL) {
+        method_bitmap_[i / 32] |= 1U << (i % 32);
+      }
+    }
+  }
+}
+
+size_t OatWriter::OatClass::HeaderSize() const {
+  size_t size = sizeof(status_) + sizeof(type_);
+  if (status_ == mirror::Class::kStatusRetryVerificationAtRuntime) {
+    size += sizeof(unresolved_types_count_) + sizeof(uint32_t) * unresolved_types_.size();
+  }
+  if (type_ == kOatClassSomeCompiled) {
+    size += sizeof(method_bitmap_size_) + method_bitmap_size_;
+  }
+  return size;
 }
 
 size_t OatWriter::OatClass::GetOatMethodOffsetsOffsetFromOatHeader(
@@ -867,18 +1098,29 @@ size_t OatWriter::OatClass::GetOatMethodOffsetsOffsetFromOatHeader(
 
 size_t OatWriter::OatClass::GetOatMethodOffsetsOffsetFromOatClass(
     size_t class_def_method_index_) const {
-  return sizeof(status_)
-          + (sizeof(method_offsets_[0]) * class_def_method_index_);
+  DCHECK(IsCompiled(class_def_method_index_));
+  return HeaderSize()
+          + (sizeof(OatMethodOffsets) * method_offsets_index_[class_def_method_index_]);
 }
 
 size_t OatWriter::OatClass::SizeOf() const {
-  return GetOatMethodOffsetsOffsetFromOatClass(method_offsets_.size());
+  return HeaderSize() + (sizeof(OatMethodOffsets) * method_offsets_.size());
 }
 
 void OatWriter::OatClass::UpdateChecksum(OatHeader& oat_header) const {
   oat_header.UpdateChecksum(&status_, sizeof(status_));
-  oat_header.UpdateChecksum(&method_offsets_[0],
-                            sizeof(method_offsets_[0]) * method_offsets_.size());
+  oat_header.UpdateChecksum(&type_, sizeof(type_));
+  if (status_ == mirror::Class::kStatusRetryVerificationAtRuntime) {
+    oat_header.UpdateChecksum(&unresolved_types_count_, sizeof(unresolved_types_count_));
+    oat_header.UpdateChecksum(unresolved_types_.data(),
+                              sizeof(uint32_t) * unresolved_types_.size());
+  }
+  if (type_ == kOatClassSomeCompiled) {
+    oat_header.UpdateChecksum(&method_bitmap_size_, sizeof(method_bitmap_size_));
+    oat_header.UpdateChecksum(method_bitmap_.data(), method_bitmap_size_);
+  }
+  oat_header.UpdateChecksum(method_offsets_.data(),
+                            sizeof(OatMethodOffsets) * method_offsets_.size());
 }
 
 bool OatWriter::OatClass::Write(OatWriter* oat_writer,
@@ -890,16 +1132,45 @@ bool OatWriter::OatClass::Write(OatWriter* oat_writer,
     return false;
   }
   oat_writer->size_oat_class_status_ += sizeof(status_);
-  DCHECK_EQ(static_cast<off_t>(file_offset + GetOatMethodOffsetsOffsetFromOatHeader(0)),
+  if (!out.WriteFully(&type_, sizeof(type_))) {
+    PLOG(ERROR) << "Failed to write oat class type to " << out.GetLocation();
+    return false;
+  }
+  oat_writer->size_oat_class_type_ += sizeof(type_);
+  if (status_ == mirror::Class::kStatusRetryVerificationAtRuntime) {
+    if (!out.WriteFully(&unresolved_types_count_, sizeof(unresolved_types_count_))) {
+      PLOG(ERROR) << "Failed to write verification dependency count to " << out.GetLocation();
+      return false;
+    }
+    size_t unresolved_types_size = sizeof(uint32_t) * unresolved_types_.size();
+    if (unresolved_types_size != 0 &&
+        !out.WriteFully(unresolved_types_.data(), unresolved_types_size)) {
+      PLOG(ERROR) << "Failed to write verification dependencies to " << out.GetLocation();
+      return false;
+    }
+    oat_writer->size_oat_class_verification_dependencies_ +=
+        sizeof(unresolved_types_count_) + unresolved_types_size;
+  }
+  if (type_ == kOatClassSomeCompiled) {
+    if (!out.WriteFully(&method_bitmap_size_, sizeof(method_bitmap_size_))) {
+      PLOG(ERROR) << "Failed to write method bitmap size to " << out.GetLocation();
+      return false;
+    }
+    if (!out.WriteFully(method_bitmap_.data(), method_bitmap_size_)) {
+      PLOG(ERROR) << "Failed to write method bitmap to " << out.GetLocation();
+      return false;
+    }
+    oat_writer->size_oat_class_method_bitmaps_ += sizeof(method_bitmap_size_) + method_bitmap_size_;
+  }
+  DCHECK_EQ(static_cast<off_t>(file_offset + offset_ + HeaderSize()),
             out.Seek(0, kSeekCurrent));
-  if (!out.WriteFully(&method_offsets_[0],
-                      sizeof(method_offsets_[0]) * method_offsets_.size())) {
+  size_t method_offsets_size = sizeof(OatMethodOffsets) * method_offsets_.size();
+  if (method_offsets_size != 0 && !out.WriteFully(method_offsets_.data(), method_offsets_size)) {
     PLOG(ERROR) << "Failed to write method offsets to " << out.GetLocation();
     return false;
   }
-  oat_writer->size_oat_class_method_offsets_ += sizeof(method_offsets_[0]) * method_offsets_.size();
-  DCHECK_EQ(static_cast<off_t>(file_offset +
-                               GetOatMethodOffsetsOffsetFromOatHeader(method_offsets_.size())),
+  oat_writer->size_oat_class_method_offsets_ += method_offsets_size;
+  DCHECK_EQ(static_cast<off_t>(file_offset + offset_ + SizeOf()),
             out.Seek(0, kSeekCurrent));
   return true;
 }
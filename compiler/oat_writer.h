@@ -91,12 +91,14 @@ class OatWriter {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   size_t InitOatCodeDexFile(size_t offset,
                             size_t& oat_class_index,
-                            const DexFile& dex_file)
+                            const DexFile& dex_file,
+                            bool hot)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   size_t InitOatCodeClassDef(size_t offset,
                              size_t oat_class_index, size_t class_def_index,
                              const DexFile& dex_file,
-                             const DexFile::ClassDef& class_def)
+                             const DexFile::ClassDef& class_def,
+                             bool hot)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   size_t InitOatCodeMethod(size_t offset, size_t oat_class_index, size_t class_def_index,
                            size_t class_def_method_index, bool is_native, InvokeType type,
@@ -107,20 +109,39 @@ class OatWriter {
   size_t WriteCode(OutputStream& out, const size_t file_offset);
   size_t WriteCodeDexFiles(OutputStream& out, const size_t file_offset, size_t relative_offset);
   size_t WriteCodeDexFile(OutputStream& out, const size_t file_offset, size_t relative_offset,
-                          size_t& oat_class_index, const DexFile& dex_file);
+                          size_t& oat_class_index, const DexFile& dex_file, bool hot);
   size_t WriteCodeClassDef(OutputStream& out, const size_t file_offset, size_t relative_offset,
                            size_t oat_class_index, const DexFile& dex_file,
-                           const DexFile::ClassDef& class_def);
+                           const DexFile::ClassDef& class_def, bool hot);
   size_t WriteCodeMethod(OutputStream& out, const size_t file_offset, size_t relative_offset,
                          size_t oat_class_index, size_t class_def_method_index, bool is_static,
                          uint32_t method_idx, const DexFile& dex_file);
 
+  // With a profile the code of the profiled methods is laid out first, in class def order, so
+  // the pages touched at startup are contiguous. The layout runs in two passes, the first places
+  // the hot methods and the second the others; without a profile there is only the second.
+  bool HasHotPass() const {
+    return compiler_driver_->GetProfiledMethods() != NULL;
+  }
+  bool IsHotMethod(uint32_t method_idx, const DexFile& dex_file) const;
+
+  // Translates the verifier's dependencies of a class into type indices of its dex file, false
+  // if there are none to record.
+  bool GetVerificationDependencies(ClassReference class_ref,
+                                   std::vector<uint32_t>* type_indices) const;
+
   void ReportWriteFailure(const char* what, uint32_t method_idx, const DexFile& dex_file,
                           OutputStream& out) const;
 
   class OatDexFile {
    public:
     explicit OatDexFile(size_t offset, const DexFile& dex_file);
+    // Records the entries of the dex cache of dex_file that hold boot image objects.
+    void CollectDexCacheEntries(const DexFile& dex_file)
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+    // Records the dependency hashes of the methods of dex_file that were compiled.
+    void CollectMethodDependencyHashes(const CompilerDriver& compiler_driver,
+                                       const DexFile& dex_file);
     size_t SizeOf() const;
     void UpdateChecksum(OatHeader& oat_header) const;
     bool Write(OatWriter* oat_writer, OutputStream& out, const size_t file_offset) const;
@@ -135,6 +156,10 @@ class OatWriter {
     uint32_t dex_file_location_checksum_;
     uint32_t dex_file_offset_;
     std::vector<uint32_t> methods_offsets_;
+    // Pairs of dex index and boot image object address, by OatDexCacheEntryKind.
+    std::vector<uint32_t> dex_cache_entries_[kOatDexCacheEntryKinds];
+    // Triples of method index and low and high word of its dependency hash, by method index.
+    std::vector<uint32_t> method_dependency_hashes_;
 
    private:
     DISALLOW_COPY_AND_ASSIGN(OatDexFile);
@@ -142,7 +167,24 @@ class OatWriter {
 
   class OatClass {
    public:
-    explicit OatClass(size_t offset, mirror::Class::Status status, uint32_t methods_count);
+    // compiled_methods holds the CompiledMethod of each method of the class, NULL for the
+    // methods that weren't compiled. unresolved_type_indices lists the types that must still
+    // fail to resolve for the class to skip verification at runtime, NULL if it can't skip it.
+    // It is only written for classes with kStatusRetryVerificationAtRuntime.
+    OatClass(size_t offset, const std::vector<CompiledMethod*>& compiled_methods,
+             mirror::Class::Status status,
+             const std::vector<uint32_t>* unresolved_type_indices);
+    size_t NumMethods() const {
+      return method_offsets_index_.size();
+    }
+    bool IsCompiled(size_t class_def_method_index) const {
+      return method_offsets_index_[class_def_method_index] != kNotCompiled;
+    }
+    // Only valid for compiled methods, the others have no OatMethodOffsets.
+    OatMethodOffsets& GetOatMethodOffsets(size_t class_def_method_index) {
+      DCHECK(IsCompiled(class_def_method_index));
+      return method_offsets_[method_offsets_index_[class_def_method_index]];
+    }
     size_t GetOatMethodOffsetsOffsetFromOatHeader(size_t class_def_method_index_) const;
     size_t GetOatMethodOffsetsOffsetFromOatClass(size_t class_def_method_index_) const;
     size_t SizeOf() const;
@@ -157,10 +199,29 @@ class OatWriter {
     size_t offset_;
 
     // data to write
-    mirror::Class::Status status_;
+    int16_t status_;
+    uint16_t type_;
+    // Only written for kStatusRetryVerificationAtRuntime, kOatClassUnknownVerificationDependencies
+    // if the class must be verified again.
+    uint32_t unresolved_types_count_;
+    std::vector<uint32_t> unresolved_types_;
+    // Only written for kOatClassSomeCompiled. Bit i of word i / 32 is set if the method with
+    // class_def_method_index i was compiled.
+    uint32_t method_bitmap_size_;
+    std::vector<uint32_t> method_bitmap_;
+    // One entry per compiled method, in class_def_method_index order.
     std::vector<OatMethodOffsets> method_offsets_;
 
    private:
+    static const uint32_t kNotCompiled = 0xFFFFFFFF;
+
+    // Size of the status, type and, if present, verification dependencies and method bitmap
+    // that precede method_offsets_.
+    size_t HeaderSize() const;
+
+    // Index into method_offsets_ of each method, kNotCompiled if it has no code.
+    std::vector<uint32_t> method_offsets_index_;
+
     DISALLOW_COPY_AND_ASSIGN(OatClass);
   };
 
@@ -214,15 +275,20 @@ class OatWriter {
   uint32_t size_oat_dex_file_location_checksum_;
   uint32_t size_oat_dex_file_offset_;
   uint32_t size_oat_dex_file_methods_offsets_;
+  uint32_t size_oat_dex_file_dex_cache_entries_;
+  uint32_t size_oat_dex_file_method_dependency_hashes_;
   uint32_t size_oat_class_status_;
+  uint32_t size_oat_class_type_;
+  uint32_t size_oat_class_verification_dependencies_;
+  uint32_t size_oat_class_method_bitmaps_;
   uint32_t size_oat_class_method_offsets_;
 
   // Code mappings for deduplication. Deduplication is already done on a pointer basis by the
   // compiler driver, so we can simply compare the pointers to find out if things are duplicated.
-  SafeMap<const std::vector<uint8_t>*, uint32_t> code_offsets_;
-  SafeMap<const std::vector<uint8_t>*, uint32_t> vmap_table_offsets_;
-  SafeMap<const std::vector<uint8_t>*, uint32_t> mapping_table_offsets_;
-  SafeMap<const std::vector<uint8_t>*, uint32_t> gc_map_offsets_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> code_offsets_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> vmap_table_offsets_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> mapping_table_offsets_;
+  SafeMap<const SwapVector<uint8_t>*, uint32_t> gc_map_offsets_;
 
   DISALLOW_COPY_AND_ASSIGN(OatWriter);
 };
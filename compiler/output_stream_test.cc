@@ -86,6 +86,30 @@ TEST_F(OutputStreamTest, Buffered) {
   CheckTestOutput(actual);
 }
 
+TEST_F(OutputStreamTest, BufferedLargeWrite) {
+  ScratchFile tmp;
+  std::vector<uint8_t> expected(3 * MB);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    expected[i] = static_cast<uint8_t>(i * 7);
+  }
+  {
+    // A small write left in the buffer, a write larger than the buffer and a final small write.
+    BufferedOutputStream buffered_output_stream(new FileOutputStream(tmp.GetFile()));
+    EXPECT_TRUE(buffered_output_stream.WriteFully(&expected[0], 5));
+    EXPECT_TRUE(buffered_output_stream.WriteFully(&expected[5], expected.size() - 10));
+    EXPECT_TRUE(buffered_output_stream.WriteFully(&expected[expected.size() - 5], 5));
+    EXPECT_EQ(static_cast<off_t>(expected.size()),
+              buffered_output_stream.Seek(0, kSeekCurrent));
+  }
+  UniquePtr<File> in(OS::OpenFileForReading(tmp.GetFilename().c_str()));
+  EXPECT_TRUE(in.get() != NULL);
+  std::vector<uint8_t> actual(in->GetLength());
+  EXPECT_EQ(expected.size(), actual.size());
+  bool readSuccess = in->ReadFully(&actual[0], actual.size());
+  EXPECT_TRUE(readSuccess);
+  EXPECT_TRUE(expected == actual);
+}
+
 TEST_F(OutputStreamTest, Vector) {
   std::vector<uint8_t> output;
   VectorOutputStream output_stream("test vector output", output);
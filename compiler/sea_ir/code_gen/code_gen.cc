@@ -194,11 +194,10 @@ void CodeGenVisitor::Visit(MoveResultInstructionNode* instruction) {
 void CodeGenVisitor::Visit(InvokeStaticInstructionNode* invoke) {
   std::string instr = invoke->GetInstruction()->DumpString(NULL);
   std::cout << "6.Instruction: " << instr << std::endl;
-  // TODO: Build callee LLVM function name.
+  // Only calls of the method to itself are supported, so the callee is in the module.
   std::string symbol = "dex_";
   symbol += art::MangleForJni(PrettyMethod(invoke->GetCalledMethodIndex(), dex_file_));
-  std::string function_name = "dex_int_00020Main_fibonacci_00028int_00029";
-  llvm::Function *callee = llvm_data_->module_.getFunction(function_name);
+  llvm::Function *callee = llvm_data_->module_.getFunction(symbol);
   // TODO: Add proper checking of the matching between formal and actual signature.
   DCHECK(NULL != callee);
   std::vector<llvm::Value*> parameter_values;
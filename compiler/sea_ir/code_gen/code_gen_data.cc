@@ -96,6 +96,11 @@ std::string CodeGenData::GetElf(art::InstructionSet instruction_set) {
       LOG(FATAL) << "Unable to generate ELF for this target";
     }
 
+    // Run the per-function optimization
+    fpm.doInitialization();
+    fpm.run(*function_);
+    fpm.doFinalization();
+
     // Run the code generation passes
     pm.run(module_);
   }
@@ -20,6 +20,8 @@
 #include <llvm/Bitcode/ReaderWriter.h>
 
 #include "base/logging.h"
+#include "base/mutex.h"
+#include "dex_instruction-inl.h"
 #include "llvm/llvm_compilation_unit.h"
 #include "dex/portable/mir_to_gbc.h"
 #include "driver/compiler_driver.h"
@@ -29,6 +31,7 @@
 
 #include "runtime.h"
 #include "safe_map.h"
+#include "thread.h"
 
 #include "sea_ir/ir/sea.h"
 #include "sea_ir/debug/dot_gen.h"
@@ -37,6 +40,49 @@
 
 namespace art {
 
+// The SEA IR graph construction and code generation use LLVM's global context.
+static Mutex gSeaIrLock DEFAULT_MUTEX_ACQUIRED_AFTER("SEA IR compilation lock");
+
+// Returns true if the SEA IR code generator handles the whole method: a static method that
+// takes and returns ints, has no try blocks, only calls itself and only uses the instructions
+// lowered by sea_ir::CodeGenVisitor.
+static bool IsSupportedBySeaIr(const DexFile::CodeItem* code_item, uint32_t method_access_flags,
+                               uint32_t method_idx, const DexFile& dex_file) {
+  if ((method_access_flags & kAccStatic) == 0 || code_item->tries_size_ != 0) {
+    return false;
+  }
+  const char* shorty = dex_file.GetMethodShorty(dex_file.GetMethodId(method_idx));
+  for (; *shorty != '\0'; ++shorty) {
+    if (*shorty != 'I') {
+      return false;
+    }
+  }
+  size_t dex_pc = 0;
+  while (dex_pc < code_item->insns_size_in_code_units_) {
+    const Instruction* inst = Instruction::At(code_item->insns_ + dex_pc);
+    switch (inst->Opcode()) {
+      case Instruction::CONST_4:
+      case Instruction::RETURN:
+      case Instruction::IF_NE:
+      case Instruction::IF_EQZ:
+      case Instruction::GOTO:
+      case Instruction::ADD_INT:
+      case Instruction::ADD_INT_LIT8:
+      case Instruction::MOVE_RESULT:
+        break;
+      case Instruction::INVOKE_STATIC:
+        if (inst->VRegB_35c() != method_idx) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+    }
+    dex_pc += inst->SizeInCodeUnits();
+  }
+  return true;
+}
+
 static CompiledMethod* CompileMethodWithSeaIr(CompilerDriver& compiler,
                                      const CompilerBackend compiler_backend,
                                      const DexFile::CodeItem* code_item,
@@ -47,20 +93,27 @@ static CompiledMethod* CompileMethodWithSeaIr(CompilerDriver& compiler,
                                      , llvm::LlvmCompilationUnit* llvm_compilation_unit
 #endif
 ) {
-  LOG(INFO) << "Compiling " << PrettyMethod(method_idx, dex_file) << ".";
+  if (!IsSupportedBySeaIr(code_item, method_access_flags, method_idx, dex_file)) {
+    VLOG(compiler) << "SEA IR doesn't support " << PrettyMethod(method_idx, dex_file);
+    return NULL;
+  }
+  MutexLock mu(Thread::Current(), gSeaIrLock);
+  VLOG(compiler) << "Compiling " << PrettyMethod(method_idx, dex_file) << " with SEA IR.";
   sea_ir::SeaGraph* ir_graph = sea_ir::SeaGraph::GetGraph(dex_file);
   std::string symbol = "dex_" + MangleForJni(PrettyMethod(method_idx, dex_file));
   sea_ir::CodeGenData* llvm_data = ir_graph->CompileMethod(symbol,
           code_item, class_def_idx, method_idx, method_access_flags, dex_file);
-  sea_ir::DotConversion dc;
-  SafeMap<int, const sea_ir::Type*>*  types = ir_graph->ti_->GetTypeMap();
-  dc.DumpSea(ir_graph, "/tmp/temp.dot", types);
+  const bool kDumpSeaGraph = false;
+  if (kDumpSeaGraph) {
+    sea_ir::DotConversion dc;
+    SafeMap<int, const sea_ir::Type*>*  types = ir_graph->ti_->GetTypeMap();
+    dc.DumpSea(ir_graph, "/tmp/temp.dot", types);
+  }
   MethodReference mref(&dex_file, method_idx);
   std::string llvm_code = llvm_data->GetElf(compiler.GetInstructionSet());
   CompiledMethod* compiled_method =
       new CompiledMethod(compiler, compiler.GetInstructionSet(), llvm_code,
                          *verifier::MethodVerifier::GetDexGcMap(mref), symbol);
-  LOG(INFO) << "Compiled SEA IR method " << PrettyMethod(method_idx, dex_file) << ".";
   return compiled_method;
 }
 
@@ -88,8 +141,6 @@ extern "C" art::CompiledMethod*
                           uint32_t method_access_flags, art::InvokeType invoke_type,
                           uint16_t class_def_idx, uint32_t method_idx, jobject class_loader,
                           const art::DexFile& dex_file) {
-  // TODO: Check method fingerprint here to determine appropriate backend type.
-  //       Until then, use build default
   art::CompilerBackend backend = compiler.GetCompilerBackend();
   return art::SeaIrCompileOneMethod(compiler, backend, code_item, method_access_flags, invoke_type,
                                class_def_idx, method_idx, class_loader, dex_file,
@@ -31,7 +31,8 @@ class InstructionNode;
 // precise verification (which is the job of the verifier).
 class TypeInference {
  public:
-  TypeInference() : type_cache_(new art::verifier::RegTypeCache(false)) {
+  TypeInference() : arena_(art::Runtime::Current()->GetArenaPool()),
+      type_cache_(new art::verifier::RegTypeCache(false, &arena_)) {
   }
 
   // Computes the types for the method with SEA IR representation provided by @graph.
@@ -43,6 +44,7 @@ class TypeInference {
   // Returns true if @descriptor corresponds to a primitive type.
   static bool IsPrimitiveDescriptor(char descriptor);
   TypeData type_data_;    // TODO: Make private, add accessor and not publish a SafeMap above.
+  art::ArenaAllocator arena_;    // Backs the non primitive types of type_cache_.
   art::verifier::RegTypeCache* const type_cache_;    // TODO: Make private.
 };
 
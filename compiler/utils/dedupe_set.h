@@ -17,63 +17,104 @@
 #ifndef ART_COMPILER_UTILS_DEDUPE_SET_H_
 #define ART_COMPILER_UTILS_DEDUPE_SET_H_
 
-#include <set>
+#include <stdint.h>
 
+#include <algorithm>
+#include <string>
+
+#include "base/hash_set.h"
 #include "base/mutex.h"
-#include "base/stl_util.h"
+#include "base/stringprintf.h"
+#include "UniquePtr.h"
 
 namespace art {
 
-// A simple data structure to handle hashed deduplication. Add is thread safe.
-template <typename Key, typename HashType, typename HashFunc>
+// A simple data structure to handle hashed deduplication. Add is thread safe. The keys are spread
+// over kShard hash sets by the top bits of their hash, each with its own lock, so threads adding
+// different keys rarely contend. The keys kept are copies of type StoreKey, a container of the
+// elements of Key built with the allocator the set was given.
+template <typename Key, typename HashType, typename HashFunc, size_t kShard = 1,
+          typename StoreKey = Key>
 class DedupeSet {
-  typedef std::pair<HashType, Key*> HashedKey;
-
-  class Comparator {
-   public:
-    bool operator()(const HashedKey& a, const HashedKey& b) const {
-      if (a.first < b.first) return true;
-      if (a.first > b.first) return true;
-      return *a.second < *b.second;
+ public:
+  StoreKey* Add(Thread* self, const Key& key) {
+    const uint32_t hash = static_cast<uint32_t>(HashFunc()(key));
+    Shard& shard = shards_[(hash >> 24) % kShard];
+    MutexLock lock(self, *shard.lock);
+    ++shard.num_adds;
+    StoreKey* existing = shard.keys.Find(hash, KeyMatcher(key));
+    if (existing != NULL) {
+      ++shard.num_hits;
+      return existing;
     }
-  };
-
-  typedef std::set<HashedKey, Comparator> Keys;
+    StoreKey* new_key = new StoreKey(key.begin(), key.end(), alloc_);
+    shard.keys.Insert(new_key, hash);
+    return new_key;
+  }
 
- public:
-  typedef typename Keys::iterator iterator;
-  typedef typename Keys::const_iterator const_iterator;
-  typedef typename Keys::size_type size_type;
-  typedef typename Keys::value_type value_type;
-
-  iterator begin() { return keys_.begin(); }
-  const_iterator begin() const { return keys_.begin(); }
-  iterator end() { return keys_.end(); }
-  const_iterator end() const { return keys_.end(); }
-
-  Key* Add(Thread* self, const Key& key) {
-    HashType hash = HashFunc()(key);
-    HashedKey hashed_key(hash, const_cast<Key*>(&key));
-    MutexLock lock(self, lock_);
-    auto it = keys_.find(hashed_key);
-    if (it != keys_.end()) {
-      return it->second;
+  // Number of calls to Add and how many of them found an equal key.
+  std::string DumpStats(Thread* self) {
+    uint64_t num_adds = 0;
+    uint64_t num_hits = 0;
+    size_t num_keys = 0;
+    for (Shard& shard : shards_) {
+      MutexLock lock(self, *shard.lock);
+      num_adds += shard.num_adds;
+      num_hits += shard.num_hits;
+      num_keys += shard.keys.Size();
     }
-    hashed_key.second = new Key(key);
-    keys_.insert(hashed_key);
-    return hashed_key.second;
+    return StringPrintf("%zd unique of %llu added, %llu hits (%.1f%%)", num_keys,
+                        static_cast<unsigned long long>(num_adds),  // NOLINT(runtime/int)
+                        static_cast<unsigned long long>(num_hits),  // NOLINT(runtime/int)
+                        num_adds == 0 ? 0.0 : (100.0 * num_hits) / num_adds);
   }
 
-  DedupeSet() : lock_("dedupe lock") {
+  explicit DedupeSet(const char* name,
+                     const typename StoreKey::allocator_type& alloc =
+                         typename StoreKey::allocator_type())
+      : alloc_(alloc) {
+    for (size_t i = 0; i < kShard; ++i) {
+      shards_[i].lock_name = StringPrintf("%s lock %zd", name, i);
+      shards_[i].lock.reset(new Mutex(shards_[i].lock_name.c_str()));
+    }
   }
 
   ~DedupeSet() {
-    STLDeleteValues(&keys_);
+    for (Shard& shard : shards_) {
+      shard.keys.VisitAll(DeleteKey());
+    }
   }
 
  private:
-  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
-  Keys keys_;
+  class KeyMatcher {
+   public:
+    explicit KeyMatcher(const Key& key) : key_(key) {}
+    bool operator()(const StoreKey* other) const {
+      return other->size() == key_.size() && std::equal(key_.begin(), key_.end(), other->begin());
+    }
+
+   private:
+    const Key& key_;
+  };
+
+  struct DeleteKey {
+    void operator()(StoreKey* key) const {
+      delete key;
+    }
+  };
+
+  struct Shard {
+    Shard() : num_adds(0), num_hits(0) {}
+    std::string lock_name;
+    UniquePtr<Mutex> lock;
+    HashSet<StoreKey*> keys;
+    uint64_t num_adds;
+    uint64_t num_hits;
+  };
+
+  const typename StoreKey::allocator_type alloc_;
+  Shard shards_[kShard];
+
   DISALLOW_COPY_AND_ASSIGN(DedupeSet);
 };
 
@@ -38,7 +38,7 @@ class DedupeHashFunc {
 TEST_F(DedupeSetTest, Test) {
   Thread* self = Thread::Current();
   typedef std::vector<uint8_t> ByteArray;
-  DedupeSet<ByteArray, size_t, DedupeHashFunc> deduplicator;
+  DedupeSet<ByteArray, size_t, DedupeHashFunc> deduplicator("test");
   ByteArray* array1;
   {
     ByteArray test1;
@@ -75,4 +75,24 @@ TEST_F(DedupeSetTest, Test) {
   }
 }
 
+TEST_F(DedupeSetTest, Sharded) {
+  Thread* self = Thread::Current();
+  typedef std::vector<uint8_t> ByteArray;
+  DedupeSet<ByteArray, size_t, DedupeHashFunc, 16> deduplicator("test");
+  std::vector<ByteArray*> added;
+  for (size_t i = 0; i < 1000; ++i) {
+    ByteArray array;
+    array.push_back(i & 0xff);
+    array.push_back(i >> 8);
+    added.push_back(deduplicator.Add(self, array));
+  }
+  for (size_t i = 0; i < 1000; ++i) {
+    ByteArray array;
+    array.push_back(i & 0xff);
+    array.push_back(i >> 8);
+    ASSERT_EQ(added[i], deduplicator.Add(self, array));
+  }
+  EXPECT_EQ("1000 unique of 2000 added, 1000 hits (50.0%)", deduplicator.DumpStats(self));
+}
+
 }  // namespace art
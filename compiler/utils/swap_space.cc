@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "swap_space.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/stl_util.h"
+#include "globals.h"
+#include "mem_map.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+// Keeps the arrays aligned for the code and tables copied out of them.
+static const size_t kSwapAlignment = 8;
+
+SwapSpace::SwapSpace(int fd)
+    : fd_(fd), size_(0), lock_("swap space lock", kSwapSpaceLock) {
+  CHECK_NE(fd_, -1);
+}
+
+SwapSpace::~SwapSpace() {
+  STLDeleteElements(&maps_);
+  close(fd_);
+}
+
+void* SwapSpace::Alloc(size_t size) {
+  size = RoundUp(std::max(size, static_cast<size_t>(1)), kSwapAlignment);
+  MutexLock mu(Thread::Current(), lock_);
+  Chunk key = { NULL, size };
+  std::set<Chunk, ChunkBySize>::iterator it = free_by_size_.lower_bound(key);
+  if (it == free_by_size_.end()) {
+    MapChunk(size);
+    it = free_by_size_.lower_bound(key);
+    CHECK(it != free_by_size_.end());
+  }
+  Chunk chunk = *it;
+  free_by_size_.erase(it);
+  free_by_start_.erase(chunk);
+  if (chunk.size != size) {
+    Chunk rest = { chunk.ptr + size, chunk.size - size };
+    free_by_start_.insert(rest);
+    free_by_size_.insert(rest);
+  }
+  return chunk.ptr;
+}
+
+void SwapSpace::Free(void* ptr, size_t size) {
+  size = RoundUp(std::max(size, static_cast<size_t>(1)), kSwapAlignment);
+  MutexLock mu(Thread::Current(), lock_);
+  Chunk chunk = { reinterpret_cast<uint8_t*>(ptr), size };
+  // Drop the whole pages from the process, the file still holds what they had.
+  uintptr_t begin = RoundUp(chunk.Start(), kPageSize);
+  uintptr_t end = RoundDown(chunk.End(), kPageSize);
+  if (begin < end) {
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+  }
+  InsertFreeChunk(chunk);
+}
+
+size_t SwapSpace::GetSize() {
+  MutexLock mu(Thread::Current(), lock_);
+  return size_;
+}
+
+void SwapSpace::MapChunk(size_t min_size) {
+  size_t size = RoundUp(std::max(min_size, kMinimumMapSize), kPageSize);
+  if (ftruncate(fd_, size_ + size) != 0) {
+    PLOG(FATAL) << "Failed to extend swap file to " << (size_ + size) << " bytes";
+  }
+  MemMap* mem_map = MemMap::MapFile(size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, size_);
+  CHECK(mem_map != NULL) << "Failed to map " << size << " bytes of swap file at " << size_;
+  maps_.push_back(mem_map);
+  size_ += size;
+  VLOG(compiler) << "Swap file grown to " << PrettySize(size_);
+  Chunk chunk = { mem_map->Begin(), size };
+  InsertFreeChunk(chunk);
+}
+
+void SwapSpace::InsertFreeChunk(const Chunk& chunk) {
+  Chunk merged = chunk;
+  std::set<Chunk, ChunkByStart>::iterator next = free_by_start_.lower_bound(chunk);
+  if (next != free_by_start_.end() && next->Start() == chunk.End()) {
+    merged.size += next->size;
+    free_by_size_.erase(*next);
+    free_by_start_.erase(next++);
+  }
+  if (next != free_by_start_.begin()) {
+    std::set<Chunk, ChunkByStart>::iterator prev = next;
+    --prev;
+    DCHECK_LE(prev->End(), chunk.Start());
+    if (prev->End() == chunk.Start()) {
+      merged.ptr = prev->ptr;
+      merged.size += prev->size;
+      free_by_size_.erase(*prev);
+      free_by_start_.erase(prev);
+    }
+  }
+  free_by_start_.insert(merged);
+  free_by_size_.insert(merged);
+}
+
+}  // namespace art
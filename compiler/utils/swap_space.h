@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_UTILS_SWAP_SPACE_H_
+#define ART_COMPILER_UTILS_SWAP_SPACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class MemMap;
+
+// Memory allocated in a file mapped shared rather than in anonymous memory, for the compiled code
+// and tables dex2oat keeps until the oat file is written, enabled with --swap-file or --swap-fd.
+// The kernel writes the pages of the file back and drops them when memory runs low, instead of
+// the process being killed, and the oat writer reads them back in order. The file grows by
+// whole mappings of at least kMinimumMapSize and is never shrunk. Thread safe.
+class SwapSpace {
+ public:
+  static const size_t kMinimumMapSize = 16 * MB;
+
+  // Takes ownership of fd, which should be an empty file opened for reading and writing.
+  explicit SwapSpace(int fd);
+  ~SwapSpace();
+
+  void* Alloc(size_t size) LOCKS_EXCLUDED(lock_);
+  // size is the size given to Alloc.
+  void Free(void* ptr, size_t size) LOCKS_EXCLUDED(lock_);
+
+  size_t GetSize() LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct Chunk {
+    uint8_t* ptr;
+    size_t size;
+
+    uintptr_t Start() const {
+      return reinterpret_cast<uintptr_t>(ptr);
+    }
+    uintptr_t End() const {
+      return Start() + size;
+    }
+  };
+
+  struct ChunkByStart {
+    bool operator()(const Chunk& a, const Chunk& b) const {
+      return a.Start() < b.Start();
+    }
+  };
+
+  struct ChunkBySize {
+    bool operator()(const Chunk& a, const Chunk& b) const {
+      return a.size < b.size || (a.size == b.size && a.Start() < b.Start());
+    }
+  };
+
+  // Maps a new part of the file, at least min_size bytes, as a free chunk.
+  void MapChunk(size_t min_size) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void InsertFreeChunk(const Chunk& chunk) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const int fd_;
+  size_t size_ GUARDED_BY(lock_);
+  std::vector<MemMap*> maps_ GUARDED_BY(lock_);
+  // The free chunks, adjacent ones merged, by address to merge them and by size to find the
+  // smallest that fits.
+  std::set<Chunk, ChunkByStart> free_by_start_ GUARDED_BY(lock_);
+  std::set<Chunk, ChunkBySize> free_by_size_ GUARDED_BY(lock_);
+  Mutex lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(SwapSpace);
+};
+
+// Allocates from swap_space, or from the heap if it is NULL.
+template <typename T>
+class SwapAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef SwapAllocator<U> other;
+  };
+
+  explicit SwapAllocator(SwapSpace* swap_space) : swap_space_(swap_space) {}
+
+  template <typename U>
+  SwapAllocator(const SwapAllocator<U>& other) : swap_space_(other.swap_space_) {}  // NOLINT
+
+  size_type max_size() const {
+    return static_cast<size_type>(-1) / sizeof(T);
+  }
+
+  pointer allocate(size_type n, const void* hint = NULL) {
+    if (swap_space_ == NULL) {
+      return reinterpret_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+    return reinterpret_cast<pointer>(swap_space_->Alloc(n * sizeof(T)));
+  }
+
+  void deallocate(pointer p, size_type n) {
+    if (swap_space_ == NULL) {
+      ::operator delete(p);
+    } else {
+      swap_space_->Free(p, n * sizeof(T));
+    }
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template <typename U>
+  void destroy(U* p) {
+    p->~U();
+  }
+
+  bool operator==(const SwapAllocator& other) const {
+    return swap_space_ == other.swap_space_;
+  }
+
+  bool operator!=(const SwapAllocator& other) const {
+    return swap_space_ != other.swap_space_;
+  }
+
+ private:
+  SwapSpace* swap_space_;
+
+  template <typename U>
+  friend class SwapAllocator;
+};
+
+template <typename T>
+using SwapVector = std::vector<T, SwapAllocator<T> >;
+
+}  // namespace art
+
+#endif  // ART_COMPILER_UTILS_SWAP_SPACE_H_
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common_test.h"
+#include "swap_space.h"
+
+namespace art {
+
+class SwapSpaceTest : public CommonTest {
+};
+
+TEST_F(SwapSpaceTest, AllocFree) {
+  ScratchFile scratch;
+  SwapSpace swap_space(dup(scratch.GetFd()));
+  EXPECT_EQ(0U, swap_space.GetSize());
+
+  std::vector<uint8_t*> allocations;
+  for (size_t i = 1; i <= 100; ++i) {
+    uint8_t* ptr = reinterpret_cast<uint8_t*>(swap_space.Alloc(i * 100));
+    ASSERT_TRUE(ptr != NULL);
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(ptr) % 8);
+    memset(ptr, i, i * 100);
+    allocations.push_back(ptr);
+  }
+  EXPECT_EQ(SwapSpace::kMinimumMapSize, swap_space.GetSize());
+  for (size_t i = 1; i <= 100; ++i) {
+    uint8_t* ptr = allocations[i - 1];
+    EXPECT_EQ(static_cast<uint8_t>(i), ptr[0]);
+    EXPECT_EQ(static_cast<uint8_t>(i), ptr[i * 100 - 1]);
+  }
+
+  // Freeing every other allocation and then the rest merges them back into a single chunk.
+  for (size_t i = 0; i < allocations.size(); i += 2) {
+    swap_space.Free(allocations[i], (i + 1) * 100);
+  }
+  for (size_t i = 1; i < allocations.size(); i += 2) {
+    swap_space.Free(allocations[i], (i + 1) * 100);
+  }
+  void* all = swap_space.Alloc(SwapSpace::kMinimumMapSize);
+  EXPECT_EQ(allocations[0], all);
+  EXPECT_EQ(SwapSpace::kMinimumMapSize, swap_space.GetSize());
+
+  // Nothing fits, the file grows.
+  void* more = swap_space.Alloc(SwapSpace::kMinimumMapSize + 1);
+  ASSERT_TRUE(more != NULL);
+  EXPECT_LT(SwapSpace::kMinimumMapSize * 2, swap_space.GetSize());
+  swap_space.Free(more, SwapSpace::kMinimumMapSize + 1);
+  swap_space.Free(all, SwapSpace::kMinimumMapSize);
+}
+
+TEST_F(SwapSpaceTest, SwapVector) {
+  ScratchFile scratch;
+  SwapSpace swap_space(dup(scratch.GetFd()));
+  SwapAllocator<uint8_t> alloc(&swap_space);
+  std::vector<uint8_t> contents;
+  for (size_t i = 0; i < 10000; ++i) {
+    contents.push_back(i * 7);
+  }
+  SwapVector<uint8_t> array(contents.begin(), contents.end(), alloc);
+  EXPECT_TRUE(std::equal(contents.begin(), contents.end(), array.begin()));
+  EXPECT_NE(0U, swap_space.GetSize());
+
+  // Without a swap space the heap is used.
+  SwapVector<uint8_t> heap_array(contents.begin(), contents.end(), SwapAllocator<uint8_t>(NULL));
+  EXPECT_TRUE(std::equal(contents.begin(), contents.end(), heap_array.begin()));
+}
+
+}  // namespace art
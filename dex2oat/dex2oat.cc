@@ -14,9 +14,12 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <valgrind.h>
 
 #include <fstream>
@@ -25,6 +28,7 @@
 #include <string>
 #include <vector>
 
+#include "atomic_integer.h"
 #include "base/stl_util.h"
 #include "base/stringpiece.h"
 #include "base/timing_logger.h"
@@ -56,6 +60,9 @@
 
 namespace art {
 
+// The slowest methods --dump-method-stats displays, unless given.
+static const int kDefaultSlowestMethodsToDump = 20;
+
 static void UsageErrorV(const char* fmt, va_list ap) {
   std::string error;
   StringAppendV(&error, fmt, ap);
@@ -110,6 +117,28 @@ static void Usage(const char* fmt, ...) {
   UsageError("  --image-classes=<classname-file>: specifies classes to include in an image.");
   UsageError("      Example: --image=frameworks/base/preloaded-classes");
   UsageError("");
+  UsageError("  --snapshot-class-init: when creating an image, also run the static initializers");
+  UsageError("      of classes that aren't image classes, keeping the results of those that");
+  UsageError("      complete without unsupported operations in the image.");
+  UsageError("");
+  UsageError("  --compress-image: when creating an image, deflate it in blocks that the runtime");
+  UsageError("      inflates in parallel when it loads the image, for less storage and I/O.");
+  UsageError("");
+  UsageError("  --profile-file=<method-file>: only compile the methods listed in the file, one");
+  UsageError("      per line as printed by PrettyMethod, leave the others to the interpreter.");
+  UsageError("      A method may be followed by a tab and its sample count, which is ignored.");
+  UsageError("      Example: --profile-file=/data/dalvik-cache/profiles/com.android.calculator2");
+  UsageError("");
+  UsageError("  --hot-method-file=<method-file>: in builds with the SEA IR backend, compile the");
+  UsageError("      methods listed in the file, in the --profile-file format, with it. Methods it");
+  UsageError("      doesn't support and all others are compiled with the default backend.");
+  UsageError("      Example: --hot-method-file=/data/local/tmp/hot-methods");
+  UsageError("");
+  UsageError("  --previous-oat-file=<file.oat>: reuse the code of the methods of an earlier oat");
+  UsageError("      file of the app whose code and dependencies didn't change. The file must have");
+  UsageError("      been compiled by this dex2oat against the same boot image, or it is ignored.");
+  UsageError("      Example: --previous-oat-file=/data/local/tmp/previous.oat");
+  UsageError("");
   UsageError("  --base=<hex-address>: specifies the base address when creating a boot image.");
   UsageError("      Example: --base=0x50000000");
   UsageError("");
@@ -131,6 +160,13 @@ static void Usage(const char* fmt, ...) {
   UsageError("      Example: --instruction-set=x86");
   UsageError("      Default: arm");
   UsageError("");
+  UsageError("  --instruction-set-features=...: comma separated features of the target cores.");
+  UsageError("      The quick ARM backend schedules instructions for cortex-a9 or cortex-a15, and");
+  UsageError("      uses sdiv for div-int and rem-int with div, and NEON for int array sums");
+  UsageError("      with neon.");
+  UsageError("      Example: --instruction-set-features=cortex-a15,div,neon");
+  UsageError("      Default: a generic core");
+  UsageError("");
   UsageError("  --compiler-backend=(Quick|QuickGBC|Portable): select compiler backend");
   UsageError("      set.");
   UsageError("      Example: --instruction-set=Portable");
@@ -140,6 +176,20 @@ static void Usage(const char* fmt, ...) {
   UsageError("");
   UsageError("  --dump-timing: display a breakdown of where time was spent");
   UsageError("");
+  UsageError("  --swap-file=<file.swap>: keeps the compiled code and tables in the given file");
+  UsageError("      until the oat file is written, rather than in memory, for low memory devices.");
+  UsageError("      The file is unlinked once opened.");
+  UsageError("      Example: --swap-file=/data/dalvik-cache/dex2oat.swap");
+  UsageError("");
+  UsageError("  --swap-fd=<number>: same as --swap-file, with an open file descriptor.");
+  UsageError("      Example: --swap-fd=7");
+  UsageError("");
+  UsageError("  --dump-method-stats[=<n>]: display where the time of the quick compilations was");
+  UsageError("      spent by pass, and the n slowest methods with their MIR and LIR counts,");
+  UsageError("      assembler retries and arena memory.");
+  UsageError("      Example: --dump-method-stats=50");
+  UsageError("      Default: %d", kDefaultSlowestMethodsToDump);
+  UsageError("");
   UsageError("  --runtime-arg <argument>: used to specify various arguments for the runtime,");
   UsageError("      such as initial heap size, maximum heap size, and verbose output.");
   UsageError("      Use a separate --runtime-arg switch for each argument.");
@@ -223,6 +273,48 @@ class Dex2Oat {
     return ReadImageClasses(image_classes_stream);
   }
 
+  // Reads the method names (int java.lang.String.length()) of a profile, NULL if it can't be read.
+  CompilerDriver::MethodSet* ReadProfileFromFile(const char* profile_filename) {
+    std::ifstream profile_file(profile_filename, std::ifstream::in);
+    if (!profile_file.good()) {
+      LOG(ERROR) << "Failed to open profile file " << profile_filename;
+      return NULL;
+    }
+    UniquePtr<CompilerDriver::MethodSet> methods(new CompilerDriver::MethodSet);
+    while (profile_file.good()) {
+      std::string method;
+      std::getline(profile_file, method);
+      if (StartsWith(method, "#") || method.empty()) {
+        continue;
+      }
+      methods->insert(method.substr(0, method.find('\t')));
+    }
+    return methods.release();
+  }
+
+  // Returns NULL if the file can't be opened or its code can't be reused.
+  const OatFile* OpenPreviousOatFile(const std::string& filename) {
+    UniquePtr<const OatFile> oat_file(OatFile::Open(filename, filename, NULL, false));
+    if (oat_file.get() == NULL) {
+      LOG(WARNING) << "Ignoring previous oat file " << filename << " that failed to open";
+      return NULL;
+    }
+    const OatHeader& oat_header = oat_file->GetOatHeader();
+    gc::space::ImageSpace* image_space = Runtime::Current()->GetHeap()->GetImageSpace();
+    if (oat_header.GetInstructionSet() != instruction_set_) {
+      LOG(WARNING) << "Ignoring previous oat file " << filename << " compiled for "
+                   << oat_header.GetInstructionSet();
+      return NULL;
+    }
+    if (oat_header.GetImageFileLocationOatChecksum() !=
+        image_space->GetImageHeader().GetOatChecksum()) {
+      LOG(WARNING) << "Ignoring previous oat file " << filename
+                   << " compiled against another boot image";
+      return NULL;
+    }
+    return oat_file.release();
+  }
+
   const CompilerDriver* CreateOatFile(const std::string& boot_image_option,
                                       const std::string* host_prefix,
                                       const std::string& android_root,
@@ -232,7 +324,14 @@ class Dex2Oat {
                                       const std::string& bitcode_filename,
                                       bool image,
                                       UniquePtr<CompilerDriver::DescriptorSet>& image_classes,
+                                      UniquePtr<CompilerDriver::MethodSet>& profiled_methods,
+                                      UniquePtr<CompilerDriver::MethodSet>& hot_methods,
+                                      bool snapshot_class_init,
+                                      const std::string& instruction_set_features,
+                                      const std::string& previous_oat_filename,
                                       bool dump_stats,
+                                      int slowest_methods_to_dump,
+                                      int swap_fd,
                                       base::TimingLogger& timings) {
     // SirtRef and ClassLoader creation needs to come after Runtime::Create
     jobject class_loader = NULL;
@@ -257,11 +356,25 @@ class Dex2Oat {
                                                         image,
                                                         image_classes.release(),
                                                         thread_count_,
-                                                        dump_stats));
+                                                        dump_stats,
+                                                        swap_fd));
 
     if (compiler_backend_ == kPortable) {
       driver->SetBitcodeFileName(bitcode_filename);
     }
+    driver->SetProfiledMethods(profiled_methods.release());
+    driver->SetHotMethods(hot_methods.release());
+    driver->SetSnapshotClassInitialization(snapshot_class_init);
+    driver->SetInstructionSetFeatures(instruction_set_features);
+    if (slowest_methods_to_dump >= 0) {
+      driver->EnableMethodCompileStats(slowest_methods_to_dump);
+    }
+    if (!previous_oat_filename.empty() && !image && compiler_backend_ == kQuick) {
+      const OatFile* previous_oat_file = OpenPreviousOatFile(previous_oat_filename);
+      if (previous_oat_file != NULL) {
+        driver->SetPreviousOatFile(previous_oat_file);
+      }
+    }
 
     driver->CompileAll(class_loader, dex_files, timings);
 
@@ -272,8 +385,7 @@ class Dex2Oat {
     if (!driver->IsImage()) {
       gc::space::ImageSpace* image_space = Runtime::Current()->GetHeap()->GetImageSpace();
       image_file_location_oat_checksum = image_space->GetImageHeader().GetOatChecksum();
-      image_file_location_oat_data_begin =
-          reinterpret_cast<uint32_t>(image_space->GetImageHeader().GetOatDataBegin());
+      image_file_location_oat_data_begin = image_space->GetImageFileLocationOatDataBegin();
       image_file_location = image_space->GetImageFilename();
       if (host_prefix != NULL && StartsWith(image_file_location, host_prefix->c_str())) {
         image_file_location = image_file_location.substr(host_prefix->size());
@@ -286,6 +398,7 @@ class Dex2Oat {
                          image_file_location,
                          driver.get());
 
+    timings.NewSplit("dex2oat WriteElf");
     if (!driver->WriteElf(android_root, is_host, dex_files, oat_writer, oat_file)) {
       LOG(ERROR) << "Failed to write ELF file " << oat_file->GetPath();
       return NULL;
@@ -298,13 +411,16 @@ class Dex2Oat {
                        uintptr_t image_base,
                        const std::string& oat_filename,
                        const std::string& oat_location,
-                       const CompilerDriver& compiler)
+                       const CompilerDriver& compiler,
+                       bool compress_image,
+                       base::TimingLogger& timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_) {
     uintptr_t oat_data_begin;
     {
       // ImageWriter is scoped so it can free memory before doing FixupElf
-      ImageWriter image_writer(compiler);
-      if (!image_writer.Write(image_filename, image_base, oat_filename, oat_location)) {
+      ImageWriter image_writer(compiler,
+                               compress_image ? ImageWriter::kCompressedImageBlockSize : 0);
+      if (!image_writer.Write(image_filename, image_base, oat_filename, oat_location, timings)) {
         LOG(ERROR) << "Failed to create image file " << image_filename;
         return false;
       }
@@ -409,29 +525,112 @@ static bool ParseInt(const char* in, int* out) {
   return true;
 }
 
+// The dex files OpenDexFiles opens, in the order given, and the index of the next one to open.
+struct DexFilesToOpen {
+  std::vector<const char*> filenames;
+  std::vector<const char*> locations;
+  std::vector<const DexFile*> dex_files;
+  AtomicInteger next;
+};
+
+static void* OpenDexFilesThread(void* arg) {
+  DexFilesToOpen* to_open = reinterpret_cast<DexFilesToOpen*>(arg);
+  for (size_t i = static_cast<size_t>(to_open->next++); i < to_open->filenames.size();
+       i = static_cast<size_t>(to_open->next++)) {
+    to_open->dex_files[i] = DexFile::Open(to_open->filenames[i], to_open->locations[i]);
+  }
+  return NULL;
+}
+
+// Opens the dex files that exist, extracting and verifying several of them at once, and returns
+// how many failed to open.
 static size_t OpenDexFiles(const std::vector<const char*>& dex_filenames,
                            const std::vector<const char*>& dex_locations,
                            std::vector<const DexFile*>& dex_files) {
-  size_t failure_count = 0;
+  DexFilesToOpen to_open;
   for (size_t i = 0; i < dex_filenames.size(); i++) {
-    const char* dex_filename = dex_filenames[i];
-    const char* dex_location = dex_locations[i];
-    std::string error_msg;
-    if (!OS::FileExists(dex_filename)) {
-      LOG(WARNING) << "Skipping non-existent dex file '" << dex_filename << "'";
+    if (!OS::FileExists(dex_filenames[i])) {
+      LOG(WARNING) << "Skipping non-existent dex file '" << dex_filenames[i] << "'";
       continue;
     }
-    const DexFile* dex_file = DexFile::Open(dex_filename, dex_location);
-    if (dex_file == NULL) {
-      LOG(WARNING) << "Failed to open .dex from file '" << dex_filename << "'\n";
+    to_open.filenames.push_back(dex_filenames[i]);
+    to_open.locations.push_back(dex_locations[i]);
+  }
+  to_open.dex_files.resize(to_open.filenames.size());
+
+  // Nothing needs the threads to be attached, so plain threads are used rather than a ThreadPool,
+  // which also works before the runtime exists.
+  size_t thread_count = std::min(to_open.filenames.size(),
+                                 static_cast<size_t>(std::max(sysconf(_SC_NPROCESSORS_CONF), 1L)));
+  std::vector<pthread_t> threads(std::max(thread_count, static_cast<size_t>(1)) - 1);
+  for (size_t i = 0; i < threads.size(); ++i) {
+    CHECK_PTHREAD_CALL(pthread_create, (&threads[i], NULL, OpenDexFilesThread, &to_open),
+                       "dex file opening thread");
+  }
+  OpenDexFilesThread(&to_open);
+  for (size_t i = 0; i < threads.size(); ++i) {
+    CHECK_PTHREAD_CALL(pthread_join, (threads[i], NULL), "dex file opening thread");
+  }
+
+  size_t failure_count = 0;
+  for (size_t i = 0; i < to_open.dex_files.size(); i++) {
+    if (to_open.dex_files[i] == NULL) {
+      LOG(WARNING) << "Failed to open .dex from file '" << to_open.filenames[i] << "'\n";
       ++failure_count;
     } else {
-      dex_files.push_back(dex_file);
+      dex_files.push_back(to_open.dex_files[i]);
     }
   }
   return failure_count;
 }
 
+// Runs OpenDexFiles on another thread, so that opening the dex files to compile against a boot
+// image overlaps with creating the runtime, which doesn't need them.
+class BackgroundDexFileOpener {
+ public:
+  BackgroundDexFileOpener(const std::vector<const char*>& dex_filenames,
+                          const std::vector<const char*>& dex_locations)
+      : dex_filenames_(dex_filenames), dex_locations_(dex_locations), failure_count_(0),
+        joined_(false) {
+    CHECK_PTHREAD_CALL(pthread_create, (&pthread_, NULL, Run, this), "dex file opener");
+  }
+
+  ~BackgroundDexFileOpener() {
+    Join();
+  }
+
+  // Waits for the dex files to be opened, appends them to dex_files and returns how many failed.
+  size_t Finish(std::vector<const DexFile*>* dex_files) {
+    Join();
+    dex_files->insert(dex_files->end(), dex_files_.begin(), dex_files_.end());
+    return failure_count_;
+  }
+
+ private:
+  static void* Run(void* arg) {
+    BackgroundDexFileOpener* opener = reinterpret_cast<BackgroundDexFileOpener*>(arg);
+    opener->failure_count_ = OpenDexFiles(opener->dex_filenames_, opener->dex_locations_,
+                                          opener->dex_files_);
+    return NULL;
+  }
+
+  void Join() {
+    if (!joined_) {
+      CHECK_PTHREAD_CALL(pthread_join, (pthread_, NULL), "dex file opener");
+      joined_ = true;
+    }
+  }
+
+  const std::vector<const char*> dex_filenames_;
+  const std::vector<const char*> dex_locations_;
+  std::vector<const DexFile*> dex_files_;
+  size_t failure_count_;
+  pthread_t pthread_;
+  bool joined_;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundDexFileOpener);
+};
+
 // The primary goal of the watchdog is to prevent stuck build servers
 // during development when fatal aborts lead to a cascade of failures
 // that result in a deadlock.
@@ -584,9 +783,16 @@ static int dex2oat(int argc, char** argv) {
   std::string oat_symbols;
   std::string oat_location;
   int oat_fd = -1;
+  std::string swap_filename;
+  int swap_fd = -1;
   std::string bitcode_filename;
   const char* image_classes_zip_filename = NULL;
   const char* image_classes_filename = NULL;
+  bool snapshot_class_init = false;
+  bool compress_image = false;
+  const char* profile_filename = NULL;
+  const char* hot_method_filename = NULL;
+  std::string previous_oat_filename;
   std::string image_filename;
   std::string boot_image_filename;
   uintptr_t image_base = 0;
@@ -608,9 +814,12 @@ static int dex2oat(int argc, char** argv) {
 #else
 #error "Unsupported architecture"
 #endif
+  std::string instruction_set_features;
   bool is_host = false;
   bool dump_stats = kIsDebugBuild;
   bool dump_timing = false;
+  // -1 to not record the stats of the compilations.
+  int slowest_methods_to_dump = -1;
   bool dump_slow_timing = kIsDebugBuild;
   bool watch_dog_enabled = !kIsTargetBuild;
 
@@ -660,6 +869,16 @@ static int dex2oat(int argc, char** argv) {
       image_classes_filename = option.substr(strlen("--image-classes=")).data();
     } else if (option.starts_with("--image-classes-zip=")) {
       image_classes_zip_filename = option.substr(strlen("--image-classes-zip=")).data();
+    } else if (option == "--snapshot-class-init") {
+      snapshot_class_init = true;
+    } else if (option == "--compress-image") {
+      compress_image = true;
+    } else if (option.starts_with("--previous-oat-file=")) {
+      previous_oat_filename = option.substr(strlen("--previous-oat-file=")).data();
+    } else if (option.starts_with("--profile-file=")) {
+      profile_filename = option.substr(strlen("--profile-file=")).data();
+    } else if (option.starts_with("--hot-method-file=")) {
+      hot_method_filename = option.substr(strlen("--hot-method-file=")).data();
     } else if (option.starts_with("--base=")) {
       const char* image_base_str = option.substr(strlen("--base=")).data();
       char* end;
@@ -682,6 +901,8 @@ static int dex2oat(int argc, char** argv) {
       } else if (instruction_set_str == "x86") {
         instruction_set = kX86;
       }
+    } else if (option.starts_with("--instruction-set-features=")) {
+      instruction_set_features = option.substr(strlen("--instruction-set-features=")).data();
     } else if (option.starts_with("--compiler-backend=")) {
       StringPiece backend_str = option.substr(strlen("--compiler-backend=")).data();
       if (backend_str == "Quick") {
@@ -701,6 +922,20 @@ static int dex2oat(int argc, char** argv) {
       runtime_args.push_back(argv[i]);
     } else if (option == "--dump-timing") {
       dump_timing = true;
+    } else if (option.starts_with("--swap-file=")) {
+      swap_filename = option.substr(strlen("--swap-file=")).data();
+    } else if (option.starts_with("--swap-fd=")) {
+      const char* swap_fd_str = option.substr(strlen("--swap-fd=")).data();
+      if (!ParseInt(swap_fd_str, &swap_fd) || swap_fd < 0) {
+        Usage("Failed to parse --swap-fd argument '%s' as a file descriptor", swap_fd_str);
+      }
+    } else if (option == "--dump-method-stats") {
+      slowest_methods_to_dump = kDefaultSlowestMethodsToDump;
+    } else if (option.starts_with("--dump-method-stats=")) {
+      const char* count_str = option.substr(strlen("--dump-method-stats=")).data();
+      if (!ParseInt(count_str, &slowest_methods_to_dump) || slowest_methods_to_dump < 0) {
+        Usage("Failed to parse --dump-method-stats argument '%s' as a count", count_str);
+      }
     } else {
       Usage("Unknown argument %s", option.data());
     }
@@ -726,6 +961,10 @@ static int dex2oat(int argc, char** argv) {
     Usage("--oat-fd should not be used with --image");
   }
 
+  if (!swap_filename.empty() && swap_fd != -1) {
+    Usage("--swap-file should not be used with --swap-fd");
+  }
+
   if (host_prefix.get() == NULL) {
     const char* android_product_out = getenv("ANDROID_PRODUCT_OUT");
     if (android_product_out != NULL) {
@@ -769,6 +1008,14 @@ static int dex2oat(int argc, char** argv) {
     Usage("--image-classes-zip should be used with --image-classes");
   }
 
+  if (snapshot_class_init && !image) {
+    Usage("--snapshot-class-init should only be used with --image");
+  }
+
+  if (compress_image && !image) {
+    Usage("--compress-image should only be used with --image");
+  }
+
   if (dex_filenames.empty() && zip_fd == -1) {
     Usage("Input must be supplied with either --dex-file or --zip-fd");
   }
@@ -831,6 +1078,19 @@ static int dex2oat(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  // The swap file only lives as long as the compiler, unlink it so that it goes away with us.
+  if (!swap_filename.empty()) {
+    swap_fd = open(swap_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (swap_fd == -1) {
+      PLOG(ERROR) << "Failed to create swap file: " << swap_filename;
+      return EXIT_FAILURE;
+    }
+    unlink(swap_filename.c_str());
+  } else if (swap_fd != -1 && ftruncate(swap_fd, 0) != 0) {
+    PLOG(ERROR) << "Failed to truncate swap file descriptor " << swap_fd;
+    return EXIT_FAILURE;
+  }
+
   timings.StartSplit("dex2oat Setup");
   LOG(INFO) << "dex2oat: " << oat_location;
 
@@ -871,6 +1131,11 @@ static int dex2oat(int argc, char** argv) {
   options.push_back(std::make_pair("-sea_ir", reinterpret_cast<void*>(NULL)));
 #endif
 
+  UniquePtr<BackgroundDexFileOpener> dex_file_opener;
+  if (!boot_image_option.empty() && !dex_filenames.empty()) {
+    dex_file_opener.reset(new BackgroundDexFileOpener(dex_filenames, dex_locations));
+  }
+
   Dex2Oat* p_dex2oat;
   if (!Dex2Oat::Create(&p_dex2oat, options, compiler_backend, instruction_set, thread_count)) {
     LOG(ERROR) << "Failed to create dex2oat";
@@ -902,6 +1167,26 @@ static int dex2oat(int argc, char** argv) {
     }
   }
 
+  // If --profile-file was specified, only the methods in it are compiled.
+  UniquePtr<CompilerDriver::MethodSet> profiled_methods(NULL);
+  if (profile_filename != NULL) {
+    profiled_methods.reset(dex2oat->ReadProfileFromFile(profile_filename));
+    if (profiled_methods.get() == NULL) {
+      LOG(ERROR) << "Failed to read profile from " << profile_filename;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // If --hot-method-file was specified, the methods in it are tried with the SEA IR backend.
+  UniquePtr<CompilerDriver::MethodSet> hot_methods(NULL);
+  if (hot_method_filename != NULL) {
+    hot_methods.reset(dex2oat->ReadProfileFromFile(hot_method_filename));
+    if (hot_methods.get() == NULL) {
+      LOG(ERROR) << "Failed to read hot methods from " << hot_method_filename;
+      return EXIT_FAILURE;
+    }
+  }
+
   std::vector<const DexFile*> dex_files;
   if (boot_image_option.empty()) {
     dex_files = Runtime::Current()->GetClassLinker()->GetBootClassPath();
@@ -919,7 +1204,7 @@ static int dex2oat(int argc, char** argv) {
       }
       dex_files.push_back(dex_file);
     } else {
-      size_t failure_count = OpenDexFiles(dex_filenames, dex_locations, dex_files);
+      size_t failure_count = dex_file_opener->Finish(&dex_files);
       if (failure_count > 0) {
         LOG(ERROR) << "Failed to open some dex files: " << failure_count;
         return EXIT_FAILURE;
@@ -960,7 +1245,14 @@ static int dex2oat(int argc, char** argv) {
                                                                   bitcode_filename,
                                                                   image,
                                                                   image_classes,
+                                                                  profiled_methods,
+                                                                  hot_methods,
+                                                                  snapshot_class_init,
+                                                                  instruction_set_features,
+                                                                  previous_oat_filename,
                                                                   dump_stats,
+                                                                  slowest_methods_to_dump,
+                                                                  swap_fd,
                                                                   timings));
 
   if (compiler.get() == NULL) {
@@ -1026,7 +1318,9 @@ static int dex2oat(int argc, char** argv) {
                                                            image_base,
                                                            oat_unstripped,
                                                            oat_location,
-                                                           *compiler.get());
+                                                           *compiler.get(),
+                                                           compress_image,
+                                                           timings);
     if (!image_creation_success) {
       return EXIT_FAILURE;
     }
@@ -1036,6 +1330,11 @@ static int dex2oat(int argc, char** argv) {
   if (is_host) {
     if (dump_timing || (dump_slow_timing && timings.GetTotalNs() > MsToNs(1000))) {
       LOG(INFO) << Dumpable<base::TimingLogger>(timings);
+      if (dump_timing) {
+        std::ostringstream balance;
+        compiler->DumpCompileBalance(balance);
+        LOG(INFO) << balance.str();
+      }
     }
     return EXIT_SUCCESS;
   }
@@ -1077,6 +1376,11 @@ static int dex2oat(int argc, char** argv) {
 
   if (dump_timing || (dump_slow_timing && timings.GetTotalNs() > MsToNs(1000))) {
     LOG(INFO) << Dumpable<base::TimingLogger>(timings);
+    if (dump_timing) {
+      std::ostringstream balance;
+      compiler->DumpCompileBalance(balance);
+      LOG(INFO) << balance.str();
+    }
   }
 
   // Everything was successfully written, do an explicit exit here to avoid running Runtime
@@ -14,14 +14,20 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "base/stl_util.h"
 #include "base/stringpiece.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
@@ -81,6 +87,26 @@ static void usage() {
           "  --output=<file> may be used to send the output to a file.\n"
           "      Example: --output=/tmp/oatdump.txt\n"
           "\n");
+  fprintf(stderr,
+          "  --stats=(csv|json): dumps the sizes of the code and tables of the --oat-file,\n"
+          "      their deduplication and the estimated savings of delta encoding them, instead\n"
+          "      of the oat file itself.\n"
+          "      Example: --stats=csv\n"
+          "\n");
+  fprintf(stderr,
+          "  --stats-group=(package|class): the rows of the --stats output.\n"
+          "      Default: --stats-group=package\n"
+          "\n");
+  fprintf(stderr,
+          "  -j<number>: dumps the classes of the --oat-file with the given number of threads,\n"
+          "      the output being the same as with one.\n"
+          "      Example: -j8\n"
+          "      Default: -j1\n"
+          "\n");
+  fprintf(stderr,
+          "  --no-disassemble: only dumps the offsets, sizes and tables of the compiled code,\n"
+          "      not its instructions.\n"
+          "\n");
   exit(EXIT_FAILURE);
 }
 
@@ -92,15 +118,25 @@ const char* image_roots_descriptions_[] = {
   "kOatLocation",
   "kDexCaches",
   "kClassRoots",
+  "kClassTable",
+  "kClassTableHashes",
 };
 
 class OatDumper {
  public:
-  explicit OatDumper(const std::string& host_prefix, const OatFile& oat_file)
+  // thread_count above 1 requires that there is no runtime, the verifier dumps aren't thread safe.
+  explicit OatDumper(const std::string& host_prefix, const OatFile& oat_file,
+                     size_t thread_count = 1, bool disassemble = true)
     : host_prefix_(host_prefix),
       oat_file_(oat_file),
       oat_dex_files_(oat_file.GetOatDexFiles()),
-      disassembler_(Disassembler::Create(oat_file_.GetOatHeader().GetInstructionSet())) {
+      disassembler_(Disassembler::Create(oat_file_.GetOatHeader().GetInstructionSet())),
+      thread_count_(thread_count),
+      disassemble_(disassemble),
+      chunks_(NULL),
+      next_chunk_(0),
+      written_chunks_(0) {
+    CHECK(thread_count_ <= 1 || Runtime::Current() == NULL);
     AddAllOffsets();
   }
 
@@ -122,6 +158,9 @@ class OatDumper {
     os << "EXECUTABLE OFFSET:\n";
     os << StringPrintf("0x%08x\n\n", oat_header.GetExecutableOffset());
 
+    os << "STARTUP SIZE:\n";
+    os << StringPrintf("0x%08x\n\n", oat_header.GetStartupSize());
+
     os << "IMAGE FILE LOCATION OAT CHECKSUM:\n";
     os << StringPrintf("0x%08x\n\n", oat_header.GetImageFileLocationOatChecksum());
 
@@ -144,6 +183,10 @@ class OatDumper {
 
     os << std::flush;
 
+    if (thread_count_ > 1) {
+      DumpOatDexFilesParallel(os);
+      return;
+    }
     for (size_t i = 0; i < oat_dex_files_.size(); i++) {
       const OatFile::OatDexFile* oat_dex_file = oat_dex_files_[i];
       CHECK(oat_dex_file != NULL);
@@ -151,6 +194,73 @@ class OatDumper {
     }
   }
 
+  // Dumps one row of sizes per package, or per class, and a row of totals. The bytes of code and
+  // tables shared by methods through deduplication are counted in the row of the first method
+  // referencing them, the other references being counted as dedupe hits.
+  void DumpStats(std::ostream& os, bool json, bool by_class) {
+    typedef std::map<std::string, SizeStats> GroupMap;
+    GroupMap groups;
+    SizeStats total;
+    std::set<uint32_t> seen_offsets;
+    for (size_t i = 0; i < oat_dex_files_.size(); i++) {
+      const OatFile::OatDexFile* oat_dex_file = oat_dex_files_[i];
+      CHECK(oat_dex_file != NULL);
+      UniquePtr<const DexFile> dex_file(oat_dex_file->OpenDexFile());
+      if (dex_file.get() == NULL) {
+        continue;
+      }
+      for (size_t class_def_index = 0; class_def_index < dex_file->NumClassDefs();
+           class_def_index++) {
+        const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
+        const byte* class_data = dex_file->GetClassData(class_def);
+        if (class_data == NULL) {
+          continue;
+        }
+        std::string name(PrettyDescriptor(dex_file->GetClassDescriptor(class_def)));
+        if (!by_class) {
+          size_t last_dot = name.rfind('.');
+          name = (last_dot == std::string::npos) ? "<default>" : name.substr(0, last_dot);
+        }
+        SizeStats* stats = &groups[name];
+        UniquePtr<const OatFile::OatClass> oat_class(oat_dex_file->GetOatClass(class_def_index));
+        CHECK(oat_class.get() != NULL);
+        ClassDataItemIterator it(*dex_file, class_data);
+        SkipAllFields(it);
+        uint32_t class_method_index = 0;
+        while (it.HasNext()) {
+          AddMethodStats(oat_class->GetOatMethod(class_method_index++), &seen_offsets, stats);
+          it.Next();
+        }
+      }
+    }
+    for (GroupMap::const_iterator it = groups.begin(); it != groups.end(); ++it) {
+      total.Add(it->second);
+    }
+
+    if (json) {
+      os << "{\n  \"oat_file\": \"" << JsonEscape(oat_file_.GetLocation()) << "\",\n";
+      os << "  \"" << (by_class ? "classes" : "packages") << "\": [\n";
+      for (GroupMap::const_iterator it = groups.begin(); it != groups.end(); ++it) {
+        os << ((it == groups.begin()) ? "    " : ",\n    ");
+        DumpJsonStats(os, it->first, it->second);
+      }
+      os << "\n  ],\n  \"total\": ";
+      DumpJsonStats(os, "total", total);
+      os << "\n}\n";
+    } else {
+      os << (by_class ? "class" : "package");
+      for (size_t i = 0; i < SizeStats::kNumFields; ++i) {
+        os << "," << SizeStats::kFieldNames[i];
+      }
+      os << "\n";
+      for (GroupMap::const_iterator it = groups.begin(); it != groups.end(); ++it) {
+        DumpCsvStats(os, it->first, it->second);
+      }
+      DumpCsvStats(os, "total", total);
+    }
+    os << std::flush;
+  }
+
   size_t ComputeSize(const void* oat_data) {
     if (reinterpret_cast<const byte*>(oat_data) < oat_file_.Begin() ||
         reinterpret_cast<const byte*>(oat_data) > oat_file_.End()) {
@@ -241,28 +351,354 @@ class OatDumper {
     offsets_.insert(oat_method.GetNativeGcMapOffset());
   }
 
-  void DumpOatDexFile(std::ostream& os, const OatFile::OatDexFile& oat_dex_file) {
+  struct SizeStats {
+    size_t methods;
+    size_t compiled_methods;
+    size_t code_bytes;
+    size_t mapping_table_bytes;
+    size_t vmap_table_bytes;
+    size_t gc_map_bytes;
+    // References to code or tables, and those to code or tables already referenced.
+    size_t references;
+    size_t dedupe_hits;
+    size_t dedupe_bytes;
+    // Bytes saved by delta encoding the native pcs and dex pcs of the mapping tables, and the
+    // native pcs of the GC maps sorted, rather than hashed.
+    size_t mapping_table_delta_savings;
+    size_t gc_map_delta_savings;
+
+    static const size_t kNumFields = 12;
+    static const char* const kFieldNames[kNumFields];
+
+    SizeStats()
+        : methods(0), compiled_methods(0), code_bytes(0), mapping_table_bytes(0),
+          vmap_table_bytes(0), gc_map_bytes(0), references(0), dedupe_hits(0), dedupe_bytes(0),
+          mapping_table_delta_savings(0), gc_map_delta_savings(0) {}
+
+    void Add(const SizeStats& other) {
+      methods += other.methods;
+      compiled_methods += other.compiled_methods;
+      code_bytes += other.code_bytes;
+      mapping_table_bytes += other.mapping_table_bytes;
+      vmap_table_bytes += other.vmap_table_bytes;
+      gc_map_bytes += other.gc_map_bytes;
+      references += other.references;
+      dedupe_hits += other.dedupe_hits;
+      dedupe_bytes += other.dedupe_bytes;
+      mapping_table_delta_savings += other.mapping_table_delta_savings;
+      gc_map_delta_savings += other.gc_map_delta_savings;
+    }
+
+    // In the order of kFieldNames.
+    void GetFields(std::string* fields) const {
+      size_t values[] = {
+        methods, compiled_methods, code_bytes, mapping_table_bytes, vmap_table_bytes,
+        gc_map_bytes, references, dedupe_hits, 0, dedupe_bytes, mapping_table_delta_savings,
+        gc_map_delta_savings
+      };
+      COMPILE_ASSERT(arraysize(values) == kNumFields, field_count_mismatch);
+      for (size_t i = 0; i < kNumFields; ++i) {
+        fields[i] = StringPrintf("%zd", values[i]);
+      }
+      fields[8] = StringPrintf("%.2f", (references == 0) ? 0.0 : dedupe_hits * 100.0 / references);
+    }
+  };
+
+  // Returns whether offset is referenced for the first time, otherwise counts a dedupe hit.
+  static bool CountReference(uint32_t offset, size_t size, std::set<uint32_t>* seen_offsets,
+                             SizeStats* stats) {
+    if (offset == 0) {
+      return false;
+    }
+    stats->references++;
+    if (!seen_offsets->insert(offset).second) {
+      stats->dedupe_hits++;
+      stats->dedupe_bytes += size;
+      return false;
+    }
+    return true;
+  }
+
+  void AddMethodStats(const OatFile::OatMethod& oat_method, std::set<uint32_t>* seen_offsets,
+                      SizeStats* stats) {
+    stats->methods++;
+    if (oat_method.GetCode() == NULL) {
+      return;
+    }
+    stats->compiled_methods++;
+    uint32_t code_offset = oat_method.GetCodeOffset();
+    if (oat_file_.GetOatHeader().GetInstructionSet() == kThumb2) {
+      code_offset &= ~0x1;
+    }
+    size_t code_size = oat_method.GetCodeSize();
+    if (CountReference(code_offset, code_size, seen_offsets, stats)) {
+      stats->code_bytes += code_size;
+    }
+    const uint8_t* mapping_table = oat_method.GetMappingTable();
+    size_t mapping_table_size = ComputeSize(mapping_table);
+    if (CountReference(oat_method.GetMappingTableOffset(), mapping_table_size, seen_offsets,
+                       stats)) {
+      stats->mapping_table_bytes += mapping_table_size;
+      stats->mapping_table_delta_savings += MappingTableDeltaSavings(mapping_table);
+    }
+    size_t vmap_table_size = ComputeSize(oat_method.GetVmapTable());
+    if (CountReference(oat_method.GetVmapTableOffset(), vmap_table_size, seen_offsets, stats)) {
+      stats->vmap_table_bytes += vmap_table_size;
+    }
+    const uint8_t* gc_map = oat_method.GetNativeGcMap();
+    size_t gc_map_size = ComputeSize(gc_map);
+    if (CountReference(oat_method.GetNativeGcMapOffset(), gc_map_size, seen_offsets, stats)) {
+      stats->gc_map_bytes += gc_map_size;
+      stats->gc_map_delta_savings += GcMapDeltaSavings(gc_map);
+    }
+  }
+
+  static size_t SignedLeb128Size(int32_t data) {
+    // Zig-zag the sign into the low bit, the size is the same as the signed encoding's.
+    uint32_t zig_zag = (static_cast<uint32_t>(data) << 1) ^ static_cast<uint32_t>(data >> 31);
+    return UnsignedLeb128Size(zig_zag);
+  }
+
+  // Entries following a checkpoint are decoded from it, so checkpointed entries stay absolute.
+  template <typename Iterator>
+  static size_t MappingEntriesDeltaSavings(Iterator begin, Iterator end) {
+    size_t absolute_size = 0;
+    size_t delta_size = 0;
+    uint32_t prev_native_pc = 0;
+    uint32_t prev_dex_pc = 0;
+    uint32_t index = 0;
+    for (Iterator it = begin; it != end; ++it, ++index) {
+      if (index % MappingTable::kCheckpointInterval == 0) {
+        prev_native_pc = 0;
+        prev_dex_pc = 0;
+      }
+      absolute_size += UnsignedLeb128Size(it.NativePcOffset()) + UnsignedLeb128Size(it.DexPc());
+      delta_size += UnsignedLeb128Size(it.NativePcOffset() - prev_native_pc) +
+          SignedLeb128Size(it.DexPc() - prev_dex_pc);
+      prev_native_pc = it.NativePcOffset();
+      prev_dex_pc = it.DexPc();
+    }
+    return (absolute_size > delta_size) ? absolute_size - delta_size : 0;
+  }
+
+  static size_t MappingTableDeltaSavings(const uint8_t* mapping_table) {
+    if (mapping_table == NULL) {
+      return 0;
+    }
+    MappingTable table(mapping_table);
+    return MappingEntriesDeltaSavings(table.PcToDexBegin(), table.PcToDexEnd()) +
+        MappingEntriesDeltaSavings(table.DexToPcBegin(), table.DexToPcEnd());
+  }
+
+  // The native pcs sorted and delta encoded would be looked up by a linear search through the
+  // entries rather than by hash, as the 4 byte header would become the number of entries and the
+  // register width in uleb128.
+  static size_t GcMapDeltaSavings(const uint8_t* gc_map) {
+    if (gc_map == NULL) {
+      return 0;
+    }
+    NativePcOffsetToReferenceMap map(gc_map);
+    size_t num_entries = map.NumEntries();
+    if (num_entries == 0) {
+      return 0;
+    }
+    size_t hashed_size = map.EncodedSize();
+    std::vector<uint32_t> native_pcs;
+    for (size_t i = 0; i < num_entries; ++i) {
+      native_pcs.push_back(map.GetNativePcOffset(i));
+    }
+    std::sort(native_pcs.begin(), native_pcs.end());
+    size_t delta_size = UnsignedLeb128Size(num_entries) + UnsignedLeb128Size(map.RegWidth());
+    uint32_t prev_native_pc = 0;
+    for (size_t i = 0; i < num_entries; ++i) {
+      delta_size += UnsignedLeb128Size(native_pcs[i] - prev_native_pc) + map.RegWidth();
+      prev_native_pc = native_pcs[i];
+    }
+    return (hashed_size > delta_size) ? hashed_size - delta_size : 0;
+  }
+
+  static std::string JsonEscape(const std::string& s) {
+    std::string result;
+    for (size_t i = 0; i < s.size(); ++i) {
+      if (s[i] == '"' || s[i] == '\\') {
+        result += '\\';
+      }
+      result += s[i];
+    }
+    return result;
+  }
+
+  static void DumpCsvStats(std::ostream& os, const std::string& name, const SizeStats& stats) {
+    std::string fields[SizeStats::kNumFields];
+    stats.GetFields(fields);
+    os << name;
+    for (size_t i = 0; i < SizeStats::kNumFields; ++i) {
+      os << "," << fields[i];
+    }
+    os << "\n";
+  }
+
+  static void DumpJsonStats(std::ostream& os, const std::string& name, const SizeStats& stats) {
+    std::string fields[SizeStats::kNumFields];
+    stats.GetFields(fields);
+    os << "{\"name\": \"" << JsonEscape(name) << "\"";
+    for (size_t i = 0; i < SizeStats::kNumFields; ++i) {
+      os << ", \"" << SizeStats::kFieldNames[i] << "\": " << fields[i];
+    }
+    os << "}";
+  }
+
+  void DumpOatDexFileHeader(std::ostream& os, const OatFile::OatDexFile& oat_dex_file) {
     os << "OAT DEX FILE:\n";
     os << StringPrintf("location: %s\n", oat_dex_file.GetDexFileLocation().c_str());
     os << StringPrintf("checksum: 0x%08x\n", oat_dex_file.GetDexFileLocationChecksum());
+    const uint32_t* entries;
+    os << StringPrintf("pre-resolved strings: %u types: %u methods: %u\n",
+                       oat_dex_file.GetDexCacheEntries(kOatDexCacheStrings, &entries),
+                       oat_dex_file.GetDexCacheEntries(kOatDexCacheTypes, &entries),
+                       oat_dex_file.GetDexCacheEntries(kOatDexCacheMethods, &entries));
+    os << StringPrintf("method dependency hashes: %u\n", oat_dex_file.NumMethodDependencyHashes());
+  }
+
+  void DumpOatDexFile(std::ostream& os, const OatFile::OatDexFile& oat_dex_file) {
+    DumpOatDexFileHeader(os, oat_dex_file);
     UniquePtr<const DexFile> dex_file(oat_dex_file.OpenDexFile());
     if (dex_file.get() == NULL) {
       os << "NOT FOUND\n\n";
       return;
     }
-    for (size_t class_def_index = 0; class_def_index < dex_file->NumClassDefs(); class_def_index++) {
-      const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
-      const char* descriptor = dex_file->GetClassDescriptor(class_def);
+    DumpOatClasses(os, oat_dex_file, *dex_file.get(), 0, dex_file->NumClassDefs());
+    os << std::flush;
+  }
+
+  void DumpOatClasses(std::ostream& os, const OatFile::OatDexFile& oat_dex_file,
+                      const DexFile& dex_file, size_t class_def_begin, size_t class_def_end) {
+    for (size_t class_def_index = class_def_begin; class_def_index < class_def_end;
+         class_def_index++) {
+      const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
+      const char* descriptor = dex_file.GetClassDescriptor(class_def);
       UniquePtr<const OatFile::OatClass> oat_class(oat_dex_file.GetOatClass(class_def_index));
       CHECK(oat_class.get() != NULL);
       os << StringPrintf("%zd: %s (type_idx=%d) (", class_def_index, descriptor, class_def.class_idx_)
-         << oat_class->GetStatus() << ")\n";
+         << oat_class->GetStatus() << ")"
+         << " (" << oat_class->GetType() << ")\n";
       Indenter indent_filter(os.rdbuf(), kIndentChar, kIndentBy1Count);
       std::ostream indented_os(&indent_filter);
-      DumpOatClass(indented_os, *oat_class.get(), *(dex_file.get()), class_def);
+      DumpOatClass(indented_os, *oat_class.get(), dex_file, class_def);
     }
+  }
+
+  // The classes of an oat dex file dumped by a worker, with the header of the oat dex file if they
+  // are its first.
+  struct DumpChunk {
+    const OatFile::OatDexFile* oat_dex_file;
+    const DexFile* dex_file;  // NULL if it wasn't found.
+    size_t class_def_begin;
+    size_t class_def_end;
+    bool dump_header;
+    bool done;
+    std::string output;
+  };
 
+  static const size_t kClassesPerChunk = 32;
+  // How far the workers may get ahead of the chunk written, which bounds the output held.
+  static const size_t kMaxChunksAhead = 256;
+
+  // Splits the classes into chunks that the workers dump into strings, written to os in order as
+  // they complete so that the output is that of a serial dump.
+  void DumpOatDexFilesParallel(std::ostream& os) {
+    std::vector<const DexFile*> dex_files;
+    std::vector<DumpChunk> chunks;
+    for (const OatFile::OatDexFile* oat_dex_file : oat_dex_files_) {
+      CHECK(oat_dex_file != NULL);
+      const DexFile* dex_file = oat_dex_file->OpenDexFile();
+      dex_files.push_back(dex_file);
+      size_t num_class_defs = (dex_file == NULL) ? 0 : dex_file->NumClassDefs();
+      size_t class_def_begin = 0;
+      do {
+        DumpChunk chunk;
+        chunk.oat_dex_file = oat_dex_file;
+        chunk.dex_file = dex_file;
+        chunk.class_def_begin = class_def_begin;
+        chunk.class_def_end = std::min(class_def_begin + kClassesPerChunk, num_class_defs);
+        chunk.dump_header = (class_def_begin == 0);
+        chunk.done = false;
+        chunks.push_back(chunk);
+        class_def_begin = chunk.class_def_end;
+      } while (class_def_begin < num_class_defs);
+    }
+
+    chunks_ = &chunks;
+    next_chunk_ = 0;
+    written_chunks_ = 0;
+    CHECK_PTHREAD_CALL(pthread_mutex_init, (&chunks_lock_, NULL), "oatdump chunks lock");
+    CHECK_PTHREAD_CALL(pthread_cond_init, (&chunks_cond_, NULL), "oatdump chunks cond");
+    std::vector<pthread_t> threads(thread_count_);
+    for (size_t i = 0; i < thread_count_; ++i) {
+      CHECK_PTHREAD_CALL(pthread_create, (&threads[i], NULL, &RunDumpWorker, this),
+                         "oatdump worker");
+    }
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      std::string output;
+      CHECK_PTHREAD_CALL(pthread_mutex_lock, (&chunks_lock_), "oatdump chunks lock");
+      while (!chunks[i].done) {
+        CHECK_PTHREAD_CALL(pthread_cond_wait, (&chunks_cond_, &chunks_lock_), "oatdump chunk");
+      }
+      output.swap(chunks[i].output);
+      written_chunks_ = i + 1;
+      CHECK_PTHREAD_CALL(pthread_cond_broadcast, (&chunks_cond_), "oatdump chunk written");
+      CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&chunks_lock_), "oatdump chunks lock");
+      os << output;
+    }
     os << std::flush;
+    for (size_t i = 0; i < thread_count_; ++i) {
+      CHECK_PTHREAD_CALL(pthread_join, (threads[i], NULL), "oatdump worker");
+    }
+    CHECK_PTHREAD_CALL(pthread_cond_destroy, (&chunks_cond_), "oatdump chunks cond");
+    CHECK_PTHREAD_CALL(pthread_mutex_destroy, (&chunks_lock_), "oatdump chunks lock");
+    chunks_ = NULL;
+    STLDeleteElements(&dex_files);
+  }
+
+  static void* RunDumpWorker(void* arg) {
+    reinterpret_cast<OatDumper*>(arg)->DumpChunks();
+    return NULL;
+  }
+
+  void DumpChunks() {
+    while (true) {
+      CHECK_PTHREAD_CALL(pthread_mutex_lock, (&chunks_lock_), "oatdump chunks lock");
+      while (next_chunk_ < chunks_->size() && next_chunk_ >= written_chunks_ + kMaxChunksAhead) {
+        CHECK_PTHREAD_CALL(pthread_cond_wait, (&chunks_cond_, &chunks_lock_), "oatdump ahead");
+      }
+      size_t index = next_chunk_;
+      if (index < chunks_->size()) {
+        ++next_chunk_;
+      }
+      CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&chunks_lock_), "oatdump chunks lock");
+      if (index == chunks_->size()) {
+        return;
+      }
+
+      DumpChunk& chunk = (*chunks_)[index];
+      std::ostringstream oss;
+      if (chunk.dump_header) {
+        DumpOatDexFileHeader(oss, *chunk.oat_dex_file);
+        if (chunk.dex_file == NULL) {
+          oss << "NOT FOUND\n\n";
+        }
+      }
+      if (chunk.dex_file != NULL) {
+        DumpOatClasses(oss, *chunk.oat_dex_file, *chunk.dex_file, chunk.class_def_begin,
+                       chunk.class_def_end);
+      }
+
+      CHECK_PTHREAD_CALL(pthread_mutex_lock, (&chunks_lock_), "oatdump chunks lock");
+      chunk.output = oss.str();
+      chunk.done = true;
+      CHECK_PTHREAD_CALL(pthread_cond_broadcast, (&chunks_cond_), "oatdump chunk done");
+      CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&chunks_lock_), "oatdump chunks lock");
+    }
   }
 
   static void SkipAllFields(ClassDataItemIterator& it) {
@@ -636,6 +1072,9 @@ class OatDumper {
       os << "NO CODE!\n";
       return;
     }
+    if (!disassemble_) {
+      return;
+    }
     const uint8_t* native_pc = reinterpret_cast<const uint8_t*>(code);
     size_t offset = 0;
     const bool kDumpVRegs = (Runtime::Current() != NULL);
@@ -658,15 +1097,39 @@ class OatDumper {
   std::vector<const OatFile::OatDexFile*> oat_dex_files_;
   std::set<uint32_t> offsets_;
   UniquePtr<Disassembler> disassembler_;
+  const size_t thread_count_;
+  const bool disassemble_;
+
+  // The state of DumpOatDexFilesParallel, guarded by chunks_lock_.
+  std::vector<DumpChunk>* chunks_;
+  size_t next_chunk_;
+  size_t written_chunks_;
+  pthread_mutex_t chunks_lock_;
+  pthread_cond_t chunks_cond_;
+};
+
+const char* const OatDumper::SizeStats::kFieldNames[] = {
+  "methods",
+  "compiled_methods",
+  "code_bytes",
+  "mapping_table_bytes",
+  "vmap_table_bytes",
+  "gc_map_bytes",
+  "references",
+  "dedupe_hits",
+  "dedupe_hit_percent",
+  "dedupe_saved_bytes",
+  "mapping_table_delta_savings",
+  "gc_map_delta_savings",
 };
 
 class ImageDumper {
  public:
   explicit ImageDumper(std::ostream* os, const std::string& image_filename,
                        const std::string& host_prefix, gc::space::ImageSpace& image_space,
-                       const ImageHeader& image_header)
+                       const ImageHeader& image_header, bool disassemble)
       : os_(os), image_filename_(image_filename), host_prefix_(host_prefix),
-        image_space_(image_space), image_header_(image_header) {}
+        image_space_(image_space), image_header_(image_header), disassemble_(disassemble) {}
 
   void Dump() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     std::ostream& os = *os_;
@@ -674,6 +1137,10 @@ class ImageDumper {
 
     os << "IMAGE BEGIN: " << reinterpret_cast<void*>(image_header_.GetImageBegin()) << "\n\n";
 
+    if (image_header_.IsCompressed()) {
+      os << "IMAGE BLOCK SIZE: " << PrettySize(image_header_.GetImageBlockSize()) << "\n\n";
+    }
+
     os << "IMAGE BITMAP OFFSET: " << reinterpret_cast<void*>(image_header_.GetImageBitmapOffset())
        << " SIZE: " << reinterpret_cast<void*>(image_header_.GetImageBitmapSize()) << "\n\n";
 
@@ -736,7 +1203,7 @@ class ImageDumper {
 
     stats_.oat_file_bytes = oat_file->Size();
 
-    oat_dumper_.reset(new OatDumper(host_prefix_, *oat_file));
+    oat_dumper_.reset(new OatDumper(host_prefix_, *oat_file, 1, disassemble_));
 
     for (const OatFile::OatDexFile* oat_dex_file : oat_file->GetOatDexFiles()) {
       CHECK(oat_dex_file != NULL);
@@ -789,7 +1256,10 @@ class ImageDumper {
     stats_.header_bytes = header_bytes;
     size_t alignment_bytes = RoundUp(header_bytes, kObjectAlignment) - header_bytes;
     stats_.alignment_bytes += alignment_bytes;
-    stats_.alignment_bytes += image_header_.GetImageBitmapOffset() - image_header_.GetImageSize();
+    stats_.compressed = image_header_.IsCompressed();
+    if (!image_header_.IsCompressed()) {
+      stats_.alignment_bytes += image_header_.GetImageBitmapOffset() - image_header_.GetImageSize();
+    }
     stats_.bitmap_bytes += image_header_.GetImageBitmapSize();
     stats_.Dump(os);
     os << "\n";
@@ -1074,6 +1544,8 @@ class ImageDumper {
   struct Stats {
     size_t oat_file_bytes;
     size_t file_bytes;
+    // The objects of a compressed image don't take their size in the file.
+    bool compressed;
 
     size_t header_bytes;
     size_t object_bytes;
@@ -1102,6 +1574,7 @@ class ImageDumper {
     explicit Stats()
         : oat_file_bytes(0),
           file_bytes(0),
+          compressed(false),
           header_bytes(0),
           object_bytes(0),
           bitmap_bytes(0),
@@ -1270,7 +1743,11 @@ class ImageDumper {
                                   bitmap_bytes, PercentOfFileBytes(bitmap_bytes),
                                   alignment_bytes, PercentOfFileBytes(alignment_bytes))
             << std::flush;
-        CHECK_EQ(file_bytes, bitmap_bytes + header_bytes + object_bytes + alignment_bytes);
+        if (compressed) {
+          indent_os << "objects are compressed in the art file\n\n";
+        } else {
+          CHECK_EQ(file_bytes, bitmap_bytes + header_bytes + object_bytes + alignment_bytes);
+        }
       }
 
       os << "object_bytes breakdown:\n";
@@ -1344,6 +1821,7 @@ class ImageDumper {
   const std::string host_prefix_;
   gc::space::ImageSpace& image_space_;
   const ImageHeader& image_header_;
+  const bool disassemble_;
 
   DISALLOW_COPY_AND_ASSIGN(ImageDumper);
 };
@@ -1367,6 +1845,10 @@ static int oatdump(int argc, char** argv) {
   UniquePtr<std::string> host_prefix;
   std::ostream* os = &std::cout;
   UniquePtr<std::ofstream> out;
+  const char* stats_format = NULL;
+  bool stats_by_class = false;
+  int thread_count = 1;
+  bool disassemble = true;
 
   for (int i = 0; i < argc; i++) {
     const StringPiece option(argv[i]);
@@ -1386,6 +1868,30 @@ static int oatdump(int argc, char** argv) {
         usage();
       }
       os = out.get();
+    } else if (option.starts_with("--stats=")) {
+      stats_format = option.substr(strlen("--stats=")).data();
+      if (strcmp(stats_format, "csv") != 0 && strcmp(stats_format, "json") != 0) {
+        fprintf(stderr, "Unknown stats format %s\n", stats_format);
+        usage();
+      }
+    } else if (option.starts_with("--stats-group=")) {
+      const char* group = option.substr(strlen("--stats-group=")).data();
+      if (strcmp(group, "class") == 0) {
+        stats_by_class = true;
+      } else if (strcmp(group, "package") != 0) {
+        fprintf(stderr, "Unknown stats group %s\n", group);
+        usage();
+      }
+    } else if (option.starts_with("-j")) {
+      const char* thread_count_str = option.substr(strlen("-j")).data();
+      char* end;
+      thread_count = strtol(thread_count_str, &end, 10);
+      if (*thread_count_str == '\0' || *end != '\0' || thread_count < 1) {
+        fprintf(stderr, "Failed to parse -j argument '%s' as a thread count\n", thread_count_str);
+        usage();
+      }
+    } else if (option == "--no-disassemble") {
+      disassemble = false;
     } else {
       fprintf(stderr, "Unknown argument %s\n", option.data());
       usage();
@@ -1402,6 +1908,16 @@ static int oatdump(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  if (stats_format != NULL && oat_filename == NULL) {
+    fprintf(stderr, "--stats requires --oat-file\n");
+    return EXIT_FAILURE;
+  }
+
+  if (thread_count != 1 && oat_filename == NULL) {
+    fprintf(stderr, "-j requires --oat-file\n");
+    return EXIT_FAILURE;
+  }
+
   if (host_prefix.get() == NULL) {
     const char* android_product_out = getenv("ANDROID_PRODUCT_OUT");
     if (android_product_out != NULL) {
@@ -1418,8 +1934,12 @@ static int oatdump(int argc, char** argv) {
       fprintf(stderr, "Failed to open oat file from %s\n", oat_filename);
       return EXIT_FAILURE;
     }
-    OatDumper oat_dumper(*host_prefix.get(), *oat_file);
-    oat_dumper.Dump(*os);
+    OatDumper oat_dumper(*host_prefix.get(), *oat_file, thread_count, disassemble);
+    if (stats_format != NULL) {
+      oat_dumper.DumpStats(*os, strcmp(stats_format, "json") == 0, stats_by_class);
+    } else {
+      oat_dumper.Dump(*os);
+    }
     return EXIT_SUCCESS;
   }
 
@@ -1465,7 +1985,8 @@ static int oatdump(int argc, char** argv) {
     fprintf(stderr, "Invalid image header %s\n", image_filename);
     return EXIT_FAILURE;
   }
-  ImageDumper image_dumper(os, image_filename, *host_prefix.get(), *image_space, image_header);
+  ImageDumper image_dumper(os, image_filename, *host_prefix.get(), *image_space, image_header,
+                           disassemble);
   image_dumper.Dump();
   return EXIT_SUCCESS;
 }
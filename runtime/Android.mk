@@ -19,10 +19,13 @@ LOCAL_PATH := $(call my-dir)
 include art/build/Android.common.mk
 
 LIBART_COMMON_SRC_FILES := \
+	allocation_profiler.cc \
 	atomic.cc.arm \
 	barrier.cc \
+	base/arena_allocator.cc \
 	base/logging.cc \
 	base/mutex.cc \
+	base/sharded_histogram.cc \
 	base/stringpiece.cc \
 	base/stringprintf.cc \
 	base/timing_logger.cc \
@@ -31,6 +34,7 @@ LIBART_COMMON_SRC_FILES := \
 	base/unix_file/null_file.cc \
 	base/unix_file/random_access_file_utils.cc \
 	base/unix_file/string_file.cc \
+	catch_handler_cache.cc \
 	check_jni.cc \
 	class_linker.cc \
 	common_throws.cc \
@@ -43,6 +47,7 @@ LIBART_COMMON_SRC_FILES := \
 	disassembler_mips.cc \
 	disassembler_x86.cc \
 	elf_file.cc \
+	fault_handler.cc \
 	gc/allocator/dlmalloc.cc \
 	gc/accounting/card_table.cc \
 	gc/accounting/gc_allocator.cc \
@@ -53,14 +58,18 @@ LIBART_COMMON_SRC_FILES := \
 	gc/collector/mark_sweep.cc \
 	gc/collector/partial_mark_sweep.cc \
 	gc/collector/sticky_mark_sweep.cc \
+	gc/allocation_site_table.cc \
 	gc/heap.cc \
 	gc/space/dlmalloc_space.cc \
 	gc/space/image_space.cc \
 	gc/space/large_object_space.cc \
+	gc/space/rosalloc_space.cc \
 	gc/space/space.cc \
+	gc/string_deduplicator.cc \
 	hprof/hprof.cc \
 	image.cc \
 	indirect_reference_table.cc \
+	inline_cache.cc \
 	instrumentation.cc \
 	intern_table.cc \
 	interpreter/interpreter.cc \
@@ -71,10 +80,14 @@ LIBART_COMMON_SRC_FILES := \
 	jdwp/jdwp_request.cc \
 	jdwp/jdwp_socket.cc \
 	jdwp/object_registry.cc \
+	jit/jit.cc \
+	jit/jit_code_cache.cc \
 	jni_internal.cc \
 	jobject_comparator.cc \
+	lock_profiler.cc \
 	locks.cc \
 	mem_map.cc \
+	metrics.cc \
 	memory_region.cc \
 	mirror/art_field.cc \
 	mirror/art_method.cc \
@@ -109,6 +122,7 @@ LIBART_COMMON_SRC_FILES := \
 	native/org_apache_harmony_dalvik_ddmc_DdmServer.cc \
 	native/org_apache_harmony_dalvik_ddmc_DdmVmInternal.cc \
 	native/sun_misc_Unsafe.cc \
+	native_thread_pool.cc \
 	oat.cc \
 	oat_file.cc \
 	offsets.cc \
@@ -117,6 +131,7 @@ LIBART_COMMON_SRC_FILES := \
 	reference_table.cc \
 	reflection.cc \
 	runtime.cc \
+	sampling_profiler.cc \
 	signal_catcher.cc \
 	stack.cc \
 	thread.cc \
@@ -124,6 +139,7 @@ LIBART_COMMON_SRC_FILES := \
 	thread_pool.cc \
 	throw_location.cc \
 	trace.cc \
+	transaction.cc \
 	utf.cc \
 	utils.cc \
 	verifier/dex_gc_map.cc \
@@ -182,6 +198,7 @@ ifeq ($(TARGET_ARCH),arm)
 LIBART_TARGET_SRC_FILES += \
 	arch/arm/context_arm.cc.arm \
 	arch/arm/entrypoints_init_arm.cc \
+	arch/arm/fault_handler_arm.cc \
 	arch/arm/jni_entrypoints_arm.S \
 	arch/arm/portable_entrypoints_arm.S \
 	arch/arm/quick_entrypoints_arm.S \
@@ -191,6 +208,7 @@ ifeq ($(TARGET_ARCH),x86)
 LIBART_TARGET_SRC_FILES += \
 	arch/x86/context_x86.cc \
 	arch/x86/entrypoints_init_x86.cc \
+	arch/x86/fault_handler_x86.cc \
 	arch/x86/jni_entrypoints_x86.S \
 	arch/x86/portable_entrypoints_x86.S \
 	arch/x86/quick_entrypoints_x86.S \
@@ -200,6 +218,7 @@ ifeq ($(TARGET_ARCH),mips)
 LIBART_TARGET_SRC_FILES += \
 	arch/mips/context_mips.cc \
 	arch/mips/entrypoints_init_mips.cc \
+	arch/mips/fault_handler_mips.cc \
 	arch/mips/jni_entrypoints_mips.S \
 	arch/mips/portable_entrypoints_mips.S \
 	arch/mips/quick_entrypoints_mips.S \
@@ -222,6 +241,7 @@ ifeq ($(HOST_ARCH),x86)
 LIBART_HOST_SRC_FILES += \
 	arch/x86/context_x86.cc \
 	arch/x86/entrypoints_init_x86.cc \
+	arch/x86/fault_handler_x86.cc \
 	arch/x86/jni_entrypoints_x86.S \
 	arch/x86/portable_entrypoints_x86.S \
 	arch/x86/quick_entrypoints_x86.S \
@@ -245,6 +265,7 @@ LIBART_ENUM_OPERATOR_OUT_HEADER_FILES := \
 	jdwp/jdwp_constants.h \
 	locks.h \
 	mirror/class.h \
+	oat.h \
 	thread.h \
 	thread_state.h \
 	verifier/method_verifier.h
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_profiler.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/stringprintf.h"
+#include "mirror/art_method-inl.h"
+#include "safe_map.h"
+#include "stack.h"
+#include "utils.h"
+
+namespace art {
+
+volatile size_t AllocationProfiler::sample_interval_ = 0;
+
+// At most this many allocation sites are printed by Dump.
+static const size_t kMaxDumpedSites = 32;
+
+// The class and innermost frames of the sampled allocations, unused frames are zeroed.
+struct AllocationSite {
+  const mirror::Class* klass;
+  const mirror::ArtMethod* methods[AllocationProfiler::kMaxStackDepth];
+  uint32_t frame_pcs[AllocationProfiler::kMaxStackDepth];  // See StackVisitor::GetFramePc.
+
+  bool operator<(const AllocationSite& rhs) const {
+    return memcmp(this, &rhs, sizeof(*this)) < 0;
+  }
+};
+
+struct AllocationCounts {
+  size_t samples;
+  uint64_t bytes;  // Estimated bytes allocated at the site.
+};
+
+typedef SafeMap<AllocationSite, AllocationCounts> AllocationSites;
+
+static Mutex gAllocationSitesLock DEFAULT_MUTEX_ACQUIRED_AFTER("allocation sites lock");
+static AllocationSites gAllocationSites GUARDED_BY(gAllocationSitesLock);
+static uint32_t gRandomState GUARDED_BY(gAllocationSitesLock) = 0x2545f491;
+
+// Returns the distance to a thread's next sample, uniformly distributed around the interval.
+static size_t NextSampleDistance(size_t sample_interval)
+    EXCLUSIVE_LOCKS_REQUIRED(gAllocationSitesLock) {
+  // xorshift32, good enough to keep samples from locking onto allocation patterns.
+  gRandomState ^= gRandomState << 13;
+  gRandomState ^= gRandomState >> 17;
+  gRandomState ^= gRandomState << 5;
+  return sample_interval / 2 + 1 + gRandomState % sample_interval;
+}
+
+class AllocationSiteVisitor : public StackVisitor {
+ public:
+  AllocationSiteVisitor(Thread* thread, AllocationSite* site)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : StackVisitor(thread, NULL), site_(site), depth_(0) {}
+
+  bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    mirror::ArtMethod* m = GetMethod();
+    if (!m->IsRuntimeMethod()) {
+      site_->methods[depth_] = m;
+      site_->frame_pcs[depth_] = GetFramePc();
+      ++depth_;
+    }
+    return depth_ < AllocationProfiler::kMaxStackDepth;
+  }
+
+ private:
+  AllocationSite* const site_;
+  size_t depth_;
+};
+
+void AllocationProfiler::SampleAllocation(Thread* self, const mirror::Class* klass,
+                                          size_t byte_count, bool first) {
+  size_t sample_interval = sample_interval_;
+  if (sample_interval == 0) {
+    return;  // Disabled since the caller checked.
+  }
+  AllocationSite site;
+  memset(&site, 0, sizeof(site));
+  if (!first) {
+    site.klass = klass;
+    size_t depth;
+    if (!StackVisitor::WalkStackFast(self, kMaxStackDepth, site.methods, site.frame_pcs, &depth)) {
+      AllocationSiteVisitor visitor(self, &site);
+      visitor.WalkStack();
+    }
+  }
+  MutexLock mu(self, gAllocationSitesLock);
+  self->SetAllocationSampleBytesLeft(NextSampleDistance(sample_interval));
+  if (first) {
+    return;
+  }
+  // An allocation larger than the interval would have been sampled in any case, count all of it.
+  uint64_t bytes = std::max(byte_count, sample_interval);
+  auto it = gAllocationSites.find(site);
+  if (it != gAllocationSites.end()) {
+    ++it->second.samples;
+    it->second.bytes += bytes;
+  } else {
+    AllocationCounts counts = { 1, bytes };
+    gAllocationSites.Put(site, counts);
+  }
+}
+
+static bool CompareBytes(const std::pair<AllocationSite, AllocationCounts>& lhs,
+                         const std::pair<AllocationSite, AllocationCounts>& rhs) {
+  return lhs.second.bytes > rhs.second.bytes;
+}
+
+void AllocationProfiler::Dump(std::ostream& os) {
+  if (!IsEnabled()) {
+    return;
+  }
+  std::vector<std::pair<AllocationSite, AllocationCounts> > sites;
+  {
+    MutexLock mu(Thread::Current(), gAllocationSitesLock);
+    sites.assign(gAllocationSites.begin(), gAllocationSites.end());
+  }
+  std::sort(sites.begin(), sites.end(), CompareBytes);
+  os << "Sampled allocations (" << sites.size() << " sites, one sample per ~"
+     << PrettySize(sample_interval_) << "):\n";
+  for (size_t i = 0; i < sites.size() && i < kMaxDumpedSites; ++i) {
+    const AllocationSite& site = sites[i].first;
+    os << "  " << sites[i].second.samples << " samples, ~"
+       << PrettySize(static_cast<size_t>(sites[i].second.bytes)) << ", "
+       << PrettyDescriptor(site.klass) << "\n";
+    for (size_t depth = 0; depth < kMaxStackDepth && site.methods[depth] != NULL; ++depth) {
+      os << StringPrintf("    at %s:%u\n", PrettyMethod(site.methods[depth]).c_str(),
+                         StackVisitor::FramePcToDexPc(site.methods[depth],
+                                                      site.frame_pcs[depth]));
+    }
+  }
+}
+
+void AllocationProfiler::Reset() {
+  MutexLock mu(Thread::Current(), gAllocationSitesLock);
+  gAllocationSites.clear();
+}
+
+}  // namespace art
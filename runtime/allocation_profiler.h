@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_ALLOCATION_PROFILER_H_
+#define ART_RUNTIME_ALLOCATION_PROFILER_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+
+#include "base/macros.h"
+#include "locks.h"
+#include "thread.h"
+
+namespace art {
+
+namespace mirror {
+class Class;
+}  // namespace mirror
+
+// Optional sampled allocation accounting, enabled with -Xalloc-sample-bytes:N and dumped on
+// SIGQUIT. Each thread takes a sample about every N bytes it allocates, at randomized distances so
+// that regular allocation patterns don't skew the samples, recording the class and the innermost
+// frames of the allocating stack. Samples are aggregated per class and stack, each standing for the
+// N bytes allocated since the previous one. When sampling is off the cost of an allocation is a
+// flag check.
+class AllocationProfiler {
+ public:
+  // Number of frames recorded for a sample.
+  static const size_t kMaxStackDepth = 8;
+
+  // Sets the mean number of bytes between samples. 0 disables sampling.
+  static void SetSampleInterval(size_t sample_interval) {
+    sample_interval_ = sample_interval;
+  }
+
+  static bool IsEnabled() {
+    return sample_interval_ != 0;
+  }
+
+  // Counts an allocation of byte_count bytes by self, sampling it if self reached its next sample.
+  static void RecordAllocation(Thread* self, const mirror::Class* klass, size_t byte_count)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    size_t bytes_left = self->GetAllocationSampleBytesLeft();
+    if (LIKELY(byte_count < bytes_left)) {
+      self->SetAllocationSampleBytesLeft(bytes_left - byte_count);
+    } else {
+      SampleAllocation(self, klass, byte_count, bytes_left == 0);
+    }
+  }
+
+  // Prints the sampled allocation sites, the ones that account for the most bytes first.
+  static void Dump(std::ostream& os) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static void Reset();
+
+ private:
+  // If first is true self hadn't been sampling yet and only picks its next sample.
+  static void SampleAllocation(Thread* self, const mirror::Class* klass, size_t byte_count,
+                               bool first)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static volatile size_t sample_interval_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(AllocationProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_ALLOCATION_PROFILER_H_
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_profiler.h"
+
+#include <sstream>
+
+#include "common_test.h"
+#include "mirror/class.h"
+
+namespace art {
+
+class AllocationProfilerTest : public CommonTest {};
+
+TEST_F(AllocationProfilerTest, Dump) {
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  mirror::Class* object = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ASSERT_TRUE(object != NULL);
+
+  // With an interval of one byte every allocation after the thread's first one is sampled.
+  AllocationProfiler::SetSampleInterval(1);
+  self->SetAllocationSampleBytesLeft(0);
+  AllocationProfiler::RecordAllocation(self, object, 8);
+  EXPECT_EQ(1U, self->GetAllocationSampleBytesLeft());
+  AllocationProfiler::RecordAllocation(self, object, 8);
+  AllocationProfiler::RecordAllocation(self, object, 16);
+
+  std::ostringstream os;
+  AllocationProfiler::Dump(os);
+  std::string dump(os.str());
+  EXPECT_NE(std::string::npos, dump.find("Sampled allocations (1 sites")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("2 samples, ~24B, java.lang.Object")) << dump;
+
+  AllocationProfiler::Reset();
+  AllocationProfiler::SetSampleInterval(0);
+  self->SetAllocationSampleBytesLeft(0);
+  std::ostringstream empty;
+  AllocationProfiler::Dump(empty);
+  EXPECT_EQ("", empty.str());
+}
+
+}  // namespace art
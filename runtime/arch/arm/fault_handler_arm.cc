@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fault_handler.h"
+
+#include <sys/ucontext.h>
+
+#include "globals.h"
+#include "thread.h"
+
+extern "C" void art_quick_implicit_suspend();
+extern "C" void art_quick_throw_null_pointer_exception();
+extern "C" void art_quick_throw_stack_overflow();
+
+namespace art {
+
+// Makes the context resume in the Thumb2 entrypoint.
+static void ResumeThumb(struct sigcontext* sc, void (*entrypoint)()) {
+  sc->arm_pc = reinterpret_cast<uintptr_t>(entrypoint) & ~1;
+  sc->arm_cpsr |= (1 << 5);  // Thumb state.
+}
+
+static uint16_t HalfwordAt(uintptr_t address) {
+  return *reinterpret_cast<uint16_t*>(address);
+}
+
+bool FaultHandler::HandleImplicitCheck(siginfo_t* info, void* raw_context) {
+  struct ucontext* uc = reinterpret_cast<struct ucontext*>(raw_context);
+  struct sigcontext* sc = reinterpret_cast<struct sigcontext*>(&uc->uc_mcontext);
+  uintptr_t fault_address = reinterpret_cast<uintptr_t>(info->si_addr);
+
+  // The stack overflow probe of a method entry reads below the stack pointer before the frame is
+  // pushed, so the method is still in r0 and lr still returns to the caller. Like the explicit
+  // check, the throw entrypoint then reports the overflow at the caller's invoke.
+  if (fault_address == sc->arm_sp - Thread::kStackOverflowReservedBytes) {
+    if (!IsInCompiledCode(reinterpret_cast<mirror::ArtMethod*>(sc->arm_r0), sc->arm_pc)) {
+      return false;
+    }
+    ResumeThumb(sc, art_quick_throw_stack_overflow);
+    return true;
+  }
+
+  if (fault_address >= kPageSize) {
+    return false;
+  }
+  // Quick frames keep a fixed stack pointer past the entry sequence, with the method at the
+  // bottom of the frame.
+  mirror::ArtMethod* method = *reinterpret_cast<mirror::ArtMethod**>(sc->arm_sp);
+  if (!IsInCompiledCode(method, sc->arm_pc)) {
+    return false;
+  }
+
+  // An implicit suspend check is "ldr.w r12, [r9, #trigger]; ldr.w r12, [r12]", the second load
+  // faulting once the thread's trigger was cleared. The entrypoint preserves every register, so
+  // the code resumes after the check as if it had passed.
+  uint16_t trigger_offset = Thread::SuspendTriggerOffset().Int32Value();
+  if (HalfwordAt(sc->arm_pc) == 0xF8DC && HalfwordAt(sc->arm_pc + 2) == 0xC000 &&
+      HalfwordAt(sc->arm_pc - 4) == 0xF8D9 &&
+      HalfwordAt(sc->arm_pc - 2) == (0xC000 | trigger_offset)) {
+    sc->arm_lr = (sc->arm_pc + 4) | 1;
+    ResumeThumb(sc, art_quick_implicit_suspend);
+    return true;
+  }
+
+  // Make the entrypoint return to the instruction after the faulting one, whose native pc the
+  // compiler mapped to the dex pc of the access. Thumb2 32-bit instructions start with 0b11101,
+  // 0b11110 or 0b11111.
+  uint16_t first_half = *reinterpret_cast<uint16_t*>(sc->arm_pc);
+  uint32_t instruction_size = ((first_half & 0xF800) >= 0xE800) ? 4 : 2;
+  sc->arm_lr = (sc->arm_pc + instruction_size) | 1;
+  ResumeThumb(sc, art_quick_throw_null_pointer_exception);
+  return true;
+}
+
+}  // namespace art
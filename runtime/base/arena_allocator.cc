@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "arena_allocator.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <iomanip>
+
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "thread-inl.h"
+
+namespace art {
+
+static const char* alloc_names[ArenaAllocator::kNumAllocKinds] = {
+  "Misc       ",
+  "BasicBlock ",
+  "LIR        ",
+  "MIR        ",
+  "DataFlow   ",
+  "GrowList   ",
+  "GrowBitMap ",
+  "Dalvik2SSA ",
+  "DebugInfo  ",
+  "Successor  ",
+  "RegAlloc   ",
+  "Data       ",
+  "Preds      ",
+  "Verifier   ",
+  "STL        ",
+};
+
+Arena::Arena(size_t size)
+    : bytes_allocated_(0),
+      map_(nullptr),
+      next_(nullptr) {
+  map_ = MemMap::MapAnonymous("dalvik-arena", NULL, size, PROT_READ | PROT_WRITE);
+  CHECK(map_ != nullptr) << "Failed to map an arena of " << size << " bytes";
+  memory_ = map_->Begin();
+  size_ = map_->Size();
+}
+
+Arena::~Arena() {
+  delete map_;
+}
+
+bool Arena::Reset() {
+  bool released = false;
+  if (bytes_allocated_ > kMaxMemSetBytes) {
+    // Private pages given back read as zeroes, and no longer count in the footprint.
+    madvise(Begin(), RoundUp(bytes_allocated_, kPageSize), MADV_DONTNEED);
+    released = true;
+  } else if (bytes_allocated_ != 0) {
+    memset(Begin(), 0, bytes_allocated_);
+  }
+  bytes_allocated_ = 0;
+  return released;
+}
+
+ArenaPool::ArenaPool()
+    : lock_("Arena pool lock"),
+      free_arenas_(nullptr),
+      num_free_arenas_(0),
+      num_arenas_(0),
+      mapped_bytes_(0),
+      peak_mapped_bytes_(0),
+      num_unmapped_arenas_(0),
+      num_released_resets_(0),
+      num_memset_resets_(0) {
+  CHECK_PTHREAD_CALL(pthread_key_create, (&thread_cache_key_, ThreadCacheExitCallback),
+                     "arena pool thread cache key");
+}
+
+ArenaPool::~ArenaPool() {
+  // Threads that exit from now on don't call back with their caches.
+  CHECK_PTHREAD_CALL(pthread_key_delete, (thread_cache_key_), "arena pool thread cache key");
+  MutexLock lock(Thread::Current(), lock_);
+  for (ThreadCache* cache : thread_caches_) {
+    while (cache->arenas != nullptr) {
+      Arena* arena = cache->arenas;
+      cache->arenas = arena->next_;
+      DeleteArena(arena);
+    }
+    delete cache;
+  }
+  while (free_arenas_ != nullptr) {
+    Arena* arena = free_arenas_;
+    free_arenas_ = free_arenas_->next_;
+    DeleteArena(arena);
+  }
+}
+
+ArenaPool::ThreadCache* ArenaPool::GetThreadCache() {
+  ThreadCache* cache = reinterpret_cast<ThreadCache*>(pthread_getspecific(thread_cache_key_));
+  if (UNLIKELY(cache == nullptr)) {
+    cache = new ThreadCache;
+    cache->pool = this;
+    cache->arenas = nullptr;
+    cache->num_arenas = 0;
+    CHECK_PTHREAD_CALL(pthread_setspecific, (thread_cache_key_, cache),
+                       "arena pool thread cache");
+    MutexLock lock(Thread::Current(), lock_);
+    thread_caches_.push_back(cache);
+  }
+  return cache;
+}
+
+void ArenaPool::ThreadCacheExitCallback(void* arg) {
+  ThreadCache* cache = reinterpret_cast<ThreadCache*>(arg);
+  ArenaPool* pool = cache->pool;
+  // The thread may already be detached from the runtime, or be detaching.
+  MutexLock lock(nullptr, pool->lock_);
+  while (cache->arenas != nullptr) {
+    Arena* arena = cache->arenas;
+    cache->arenas = arena->next_;
+    pool->FreeArenaLocked(arena);
+  }
+  std::vector<ThreadCache*>& caches = pool->thread_caches_;
+  caches.erase(std::find(caches.begin(), caches.end(), cache));
+  delete cache;
+}
+
+Arena* ArenaPool::AllocArena(size_t size) {
+  size = RoundUp(size, kPageSize);
+  // Cached and free arenas all have the default size.
+  if (LIKELY(size == Arena::kDefaultSize)) {
+    ThreadCache* cache = GetThreadCache();
+    if (cache->arenas != nullptr) {
+      Arena* arena = cache->arenas;
+      cache->arenas = arena->next_;
+      --cache->num_arenas;
+      return arena;
+    }
+    MutexLock lock(Thread::Current(), lock_);
+    if (free_arenas_ != nullptr) {
+      Arena* arena = free_arenas_;
+      free_arenas_ = arena->next_;
+      --num_free_arenas_;
+      return arena;
+    }
+  }
+  Arena* arena = new Arena(size);
+  MutexLock lock(Thread::Current(), lock_);
+  ++num_arenas_;
+  mapped_bytes_ += arena->Size();
+  peak_mapped_bytes_ = std::max(peak_mapped_bytes_, mapped_bytes_);
+  return arena;
+}
+
+void ArenaPool::FreeArena(Arena* arena) {
+  // Zeroed as it is freed rather than as it is reused, so that the pages of big uses are released
+  // as soon as possible.
+  if (arena->Reset()) {
+    num_released_resets_.fetch_add(1);
+  } else {
+    num_memset_resets_.fetch_add(1);
+  }
+  if (LIKELY(arena->Size() == Arena::kDefaultSize)) {
+    ThreadCache* cache = GetThreadCache();
+    if (cache->num_arenas < kMaxThreadCachedArenas) {
+      arena->next_ = cache->arenas;
+      cache->arenas = arena;
+      ++cache->num_arenas;
+      return;
+    }
+  }
+  MutexLock lock(Thread::Current(), lock_);
+  FreeArenaLocked(arena);
+}
+
+void ArenaPool::FreeArenaLocked(Arena* arena) {
+  if (arena->Size() == Arena::kDefaultSize && num_free_arenas_ < kMaxFreeArenas) {
+    arena->next_ = free_arenas_;
+    free_arenas_ = arena;
+    ++num_free_arenas_;
+  } else {
+    DeleteArena(arena);
+    ++num_unmapped_arenas_;
+  }
+}
+
+void ArenaPool::DeleteArena(Arena* arena) {
+  --num_arenas_;
+  mapped_bytes_ -= arena->Size();
+  delete arena;
+}
+
+void ArenaPool::DumpMemStats(std::ostream& os) const {
+  MutexLock lock(Thread::Current(), lock_);
+  os << "Arena pool: " << num_arenas_ << " arenas mapped in " << mapped_bytes_
+     << " bytes, peak " << peak_mapped_bytes_ << " bytes, " << num_free_arenas_
+     << " free and " << (num_arenas_ - num_free_arenas_) << " cached or in use, "
+     << num_unmapped_arenas_ << " unmapped when freed, " << num_released_resets_.load()
+     << " reset by releasing their pages and " << num_memset_resets_.load() << " by memset\n";
+}
+
+size_t ArenaAllocator::BytesAllocated() const {
+  size_t total = 0;
+  for (int i = 0; i < kNumAllocKinds; i++) {
+    total += alloc_stats_[i];
+  }
+  return total;
+}
+
+size_t ArenaAllocator::BytesUsed() const {
+  size_t total = ptr_ - begin_;
+  if (arena_head_ != nullptr) {
+    for (Arena* arena = arena_head_->next_; arena != nullptr; arena = arena->next_) {
+      total += arena->bytes_allocated_;
+    }
+  }
+  return total;
+}
+
+ArenaAllocator::ArenaAllocator(ArenaPool* pool)
+  : pool_(pool),
+    begin_(nullptr),
+    end_(nullptr),
+    ptr_(nullptr),
+    arena_head_(nullptr),
+    num_allocations_(0) {
+  memset(&alloc_stats_[0], 0, sizeof(alloc_stats_));
+}
+
+void ArenaAllocator::UpdateBytesAllocated() {
+  if (arena_head_ != nullptr) {
+    // Update how many bytes we have allocated into the arena so that the arena pool knows how
+    // much memory to zero out.
+    arena_head_->bytes_allocated_ = ptr_ - begin_;
+  }
+}
+
+ArenaAllocator::~ArenaAllocator() {
+  // Reclaim all the arenas by giving them back to the thread pool.
+  UpdateBytesAllocated();
+  while (arena_head_ != nullptr) {
+    Arena* arena = arena_head_;
+    arena_head_ = arena_head_->next_;
+    pool_->FreeArena(arena);
+  }
+}
+
+void ArenaAllocator::ObtainNewArenaForAllocation(size_t allocation_size) {
+  UpdateBytesAllocated();
+  Arena* new_arena = pool_->AllocArena(std::max(Arena::kDefaultSize, allocation_size));
+  new_arena->next_ = arena_head_;
+  arena_head_ = new_arena;
+  // Update our internal data structures.
+  ptr_ = begin_ = new_arena->Begin();
+  end_ = new_arena->End();
+}
+
+// Dump memory usage stats.
+void ArenaAllocator::DumpMemStats(std::ostream& os) const {
+  size_t malloc_bytes = 0;
+  // Start out with how many lost bytes we have in the arena we are currently allocating into.
+  size_t lost_bytes(end_ - ptr_);
+  size_t num_arenas = 0;
+  for (Arena* arena = arena_head_; arena != nullptr; arena = arena->next_) {
+    malloc_bytes += arena->Size();
+    if (arena != arena_head_) {
+      lost_bytes += arena->RemainingSpace();
+    }
+    ++num_arenas;
+  }
+  const size_t bytes_allocated = BytesAllocated();
+  os << " MEM: used: " << bytes_allocated << ", allocated: " << malloc_bytes
+     << ", lost: " << lost_bytes << "\n";
+  if (num_allocations_ != 0) {
+    os << "Number of arenas allocated: " << num_arenas << ", Number of allocations: "
+       << num_allocations_ << ", avg size: " << bytes_allocated / num_allocations_ << "\n";
+  }
+  os << "===== Allocation by kind\n";
+  for (int i = 0; i < kNumAllocKinds; i++) {
+      os << alloc_names[i] << std::setw(10) << alloc_stats_[i] << "\n";
+  }
+  pool_->DumpMemStats(os);
+}
+
+}  // namespace art
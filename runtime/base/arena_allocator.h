@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_BASE_ARENA_ALLOCATOR_H_
+#define ART_RUNTIME_BASE_ARENA_ALLOCATOR_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <iosfwd>
+#include <new>
+#include <vector>
+
+#include "atomic_integer.h"
+#include "base/mutex.h"
+#include "mem_map.h"
+
+namespace art {
+
+class Arena;
+class ArenaPool;
+class ArenaAllocator;
+
+// Memory mapped for arena allocations. Its pages read as zeroes when mapped, so it only needs
+// zeroing when it is reused.
+class Arena {
+ public:
+  static constexpr size_t kDefaultSize = 128 * KB;
+  // Up to this many used bytes are zeroed with memset on reuse, the pages of larger uses are given
+  // back to the kernel, which zeroes them when they are touched again.
+  static constexpr size_t kMaxMemSetBytes = 16 * KB;
+
+  explicit Arena(size_t size = kDefaultSize);
+  ~Arena();
+  // Zeroes the memory used, returns whether its pages were released rather than memset.
+  bool Reset();
+  uint8_t* Begin() {
+    return memory_;
+  }
+
+  uint8_t* End() {
+    return memory_ + size_;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  size_t RemainingSpace() const {
+    return Size() - bytes_allocated_;
+  }
+
+ private:
+  size_t bytes_allocated_;
+  uint8_t* memory_;
+  size_t size_;
+  MemMap* map_;
+  Arena* next_;
+  friend class ArenaPool;
+  friend class ArenaAllocator;
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+// Arenas freed by allocators are zeroed and kept for the next allocators, first in a cache of the
+// freeing thread, taken from and given to without the lock, then in a list shared by the threads.
+// Arenas beyond what the caches and the list hold, and arenas bigger than the default size, which
+// only big methods need, are unmapped, so that they don't keep the footprint at its peak.
+class ArenaPool {
+ public:
+  static constexpr size_t kMaxThreadCachedArenas = 4;
+  static constexpr size_t kMaxFreeArenas = 32;
+
+  ArenaPool();
+  ~ArenaPool();
+  Arena* AllocArena(size_t size) LOCKS_EXCLUDED(lock_);
+  void FreeArena(Arena* arena) LOCKS_EXCLUDED(lock_);
+
+  void DumpMemStats(std::ostream& os) const LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct ThreadCache {
+    ArenaPool* pool;
+    Arena* arenas;
+    size_t num_arenas;
+  };
+
+  // Returns the cache of the calling thread, creating it if needed.
+  ThreadCache* GetThreadCache() LOCKS_EXCLUDED(lock_);
+  // Gives the arenas of an exiting thread's cache to the shared list.
+  static void ThreadCacheExitCallback(void* arg);
+
+  void FreeArenaLocked(Arena* arena) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void DeleteArena(Arena* arena) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  pthread_key_t thread_cache_key_;
+  std::vector<ThreadCache*> thread_caches_ GUARDED_BY(lock_);
+  Arena* free_arenas_ GUARDED_BY(lock_);
+  size_t num_free_arenas_ GUARDED_BY(lock_);
+
+  // Statistics.
+  size_t num_arenas_ GUARDED_BY(lock_);
+  size_t mapped_bytes_ GUARDED_BY(lock_);
+  size_t peak_mapped_bytes_ GUARDED_BY(lock_);
+  size_t num_unmapped_arenas_ GUARDED_BY(lock_);
+  // Arenas are also reset without the lock.
+  AtomicInteger num_released_resets_;
+  AtomicInteger num_memset_resets_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArenaPool);
+};
+
+class ArenaAllocator {
+ public:
+  // Type of allocation for memory tuning.
+  enum ArenaAllocKind {
+    kAllocMisc,
+    kAllocBB,
+    kAllocLIR,
+    kAllocMIR,
+    kAllocDFInfo,
+    kAllocGrowableArray,
+    kAllocGrowableBitMap,
+    kAllocDalvikToSSAMap,
+    kAllocDebugInfo,
+    kAllocSuccessor,
+    kAllocRegAlloc,
+    kAllocData,
+    kAllocPredecessors,
+    kAllocVerifier,
+    kAllocSTL,
+    kNumAllocKinds
+  };
+
+  static constexpr bool kCountAllocations = false;
+
+  explicit ArenaAllocator(ArenaPool* pool);
+  ~ArenaAllocator();
+
+  // Returns zeroed memory.
+  void* Alloc(size_t bytes, ArenaAllocKind kind) ALWAYS_INLINE {
+    bytes = (bytes + 3) & ~3;
+    if (UNLIKELY(ptr_ + bytes > end_)) {
+      // Obtain a new block.
+      ObtainNewArenaForAllocation(bytes);
+      if (UNLIKELY(ptr_ == nullptr)) {
+        return nullptr;
+      }
+    }
+    if (kCountAllocations) {
+      alloc_stats_[kind] += bytes;
+      ++num_allocations_;
+    }
+    uint8_t* ret = ptr_;
+    ptr_ += bytes;
+    return ret;
+  }
+
+  void ObtainNewArenaForAllocation(size_t allocation_size);
+  size_t BytesAllocated() const;
+  // Unlike BytesAllocated, also counted when allocations aren't.
+  size_t BytesUsed() const;
+  void DumpMemStats(std::ostream& os) const;
+
+ private:
+  void UpdateBytesAllocated();
+
+  ArenaPool* pool_;
+  uint8_t* begin_;
+  uint8_t* end_;
+  uint8_t* ptr_;
+  Arena* arena_head_;
+
+  // Statistics.
+  size_t num_allocations_;
+  size_t alloc_stats_[kNumAllocKinds];   // Bytes used by various allocation kinds.
+
+  DISALLOW_COPY_AND_ASSIGN(ArenaAllocator);
+};  // ArenaAllocator
+
+// Allocates the elements of standard containers from an arena, or from the heap if the arena is
+// NULL, which lets a container type be used both ways. Arena memory isn't reused when elements are
+// erased, so containers erasing as much as they insert are better left on the heap.
+template <typename T>
+class ArenaAllocatorAdapter {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef ArenaAllocatorAdapter<U> other;
+  };
+
+  explicit ArenaAllocatorAdapter(ArenaAllocator* arena) : arena_(arena) {}
+
+  template <typename U>
+  ArenaAllocatorAdapter(const ArenaAllocatorAdapter<U>& other)  // NOLINT, implicit like rebinds.
+      : arena_(other.GetArena()) {}
+
+  ArenaAllocator* GetArena() const {
+    return arena_;
+  }
+
+  pointer address(reference x) const {
+    return &x;
+  }
+  const_pointer address(const_reference x) const {
+    return &x;
+  }
+
+  pointer allocate(size_type n, const void* hint = NULL) {
+    if (arena_ == NULL) {
+      return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<pointer>(arena_->Alloc(n * sizeof(T), ArenaAllocator::kAllocSTL));
+  }
+
+  void deallocate(pointer p, size_type n) {
+    // Arena memory is only freed with the arena.
+    if (arena_ == NULL) {
+      ::operator delete(p);
+    }
+  }
+
+  size_type max_size() const {
+    return static_cast<size_type>(-1) / sizeof(T);
+  }
+
+  void construct(pointer p, const T& value) {
+    new (p) T(value);
+  }
+
+  void destroy(pointer p) {
+    p->~T();
+  }
+
+ private:
+  ArenaAllocator* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocatorAdapter<T>& lhs, const ArenaAllocatorAdapter<U>& rhs) {
+  return lhs.GetArena() == rhs.GetArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocatorAdapter<T>& lhs, const ArenaAllocatorAdapter<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+struct MemStats {
+   public:
+     void Dump(std::ostream& os) const {
+       arena_.DumpMemStats(os);
+     }
+     explicit MemStats(const ArenaAllocator &arena) : arena_(arena) {}
+  private:
+    const ArenaAllocator &arena_;
+};  // MemStats
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_ARENA_ALLOCATOR_H_
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "base/arena_allocator.h"
+
+#include <set>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+static void FillAndCheckZeroed(ArenaPool* pool, size_t bytes) {
+  ArenaAllocator arena(pool);
+  uint8_t* memory = reinterpret_cast<uint8_t*>(arena.Alloc(bytes, ArenaAllocator::kAllocMisc));
+  ASSERT_TRUE(memory != NULL);
+  for (size_t i = 0; i < bytes; ++i) {
+    ASSERT_EQ(0, memory[i]) << i;
+  }
+  memset(memory, 0xa5, bytes);
+}
+
+TEST(ArenaAllocator, ReusedArenasAreZeroed) {
+  ArenaPool pool;
+  // Once memset, then released, then from an arena bigger than the default one.
+  for (size_t bytes : { Arena::kMaxMemSetBytes / 2, Arena::kDefaultSize - 64,
+                        Arena::kDefaultSize * 2 }) {
+    FillAndCheckZeroed(&pool, bytes);
+    FillAndCheckZeroed(&pool, bytes);
+  }
+  std::ostringstream os;
+  pool.DumpMemStats(os);
+  // The big arena is unmapped when freed, the default one is cached.
+  EXPECT_EQ("Arena pool: 1 arenas mapped in 131072 bytes, peak 393216 bytes, 0 free and 1 "
+            "cached or in use, 2 unmapped when freed, 4 reset by releasing their pages and 2 by "
+            "memset\n", os.str());
+}
+
+TEST(ArenaAllocator, Adapter) {
+  ArenaPool pool;
+  ArenaAllocator arena(&pool);
+  typedef std::set<int, std::less<int>, ArenaAllocatorAdapter<int> > ArenaSet;
+  ArenaSet in_arena(std::less<int>(), (ArenaAllocatorAdapter<int>(&arena)));
+  ArenaSet on_heap(std::less<int>(), (ArenaAllocatorAdapter<int>(NULL)));
+  for (int i = 0; i < 100; ++i) {
+    in_arena.insert(i);
+    on_heap.insert(i);
+  }
+  EXPECT_TRUE(in_arena == on_heap);
+  EXPECT_TRUE(in_arena.get_allocator() != on_heap.get_allocator());
+  EXPECT_LE(100 * sizeof(int), arena.BytesUsed());
+  // Copies allocate like the original.
+  ArenaSet copy(in_arena);
+  EXPECT_TRUE(copy.get_allocator() == in_arena.get_allocator());
+}
+
+}  // namespace art
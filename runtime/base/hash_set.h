@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_BASE_HASH_SET_H_
+#define ART_RUNTIME_BASE_HASH_SET_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+
+namespace art {
+
+// An open addressing hash set with linear probing for pointer like elements, T() marks the empty
+// slots. The hash of every element is supplied by the caller and stored next to it, so probing
+// and resizing never touch the elements themselves. Equal elements may be inserted more than
+// once. Erasing shifts the following elements of the probe sequence back, there are no
+// tombstones.
+template <typename T>
+class HashSet {
+ public:
+  static constexpr size_t kMinBuckets = 16;
+
+  HashSet() : num_elements_(0), mask_(0) {}
+
+  size_t Size() const {
+    return num_elements_;
+  }
+
+  bool IsEmpty() const {
+    return num_elements_ == 0;
+  }
+
+  size_t NumBuckets() const {
+    return slots_.size();
+  }
+
+  void Clear() {
+    std::vector<Slot>().swap(slots_);
+    num_elements_ = 0;
+    mask_ = 0;
+  }
+
+  // Returns the first element with the given hash for which matches(element) is true, T() if there
+  // is none.
+  template <typename Matcher>
+  T Find(uint32_t hash, const Matcher& matches) const {
+    if (num_elements_ == 0) {
+      return T();
+    }
+    for (size_t i = hash & mask_; slots_[i].value != T(); i = (i + 1) & mask_) {
+      if (slots_[i].hash == hash && matches(slots_[i].value)) {
+        return slots_[i].value;
+      }
+    }
+    return T();
+  }
+
+  // Calls visitor(element) for every element with the given hash for which matches(element) is
+  // true.
+  template <typename Matcher, typename Visitor>
+  void FindAll(uint32_t hash, const Matcher& matches, const Visitor& visitor) const {
+    if (num_elements_ == 0) {
+      return;
+    }
+    for (size_t i = hash & mask_; slots_[i].value != T(); i = (i + 1) & mask_) {
+      if (slots_[i].hash == hash && matches(slots_[i].value)) {
+        visitor(slots_[i].value);
+      }
+    }
+  }
+
+  void Insert(const T& value, uint32_t hash) {
+    DCHECK(value != T());
+    // Keep the load factor below 3/4.
+    if ((num_elements_ + 1) * 4 > slots_.size() * 3) {
+      Resize(std::max(kMinBuckets, slots_.size() * 2));
+    }
+    InsertNoResize(value, hash);
+    ++num_elements_;
+  }
+
+  // Erase one occurrence of the exact element, returns false if it wasn't in the set.
+  bool Erase(const T& value, uint32_t hash) {
+    if (num_elements_ == 0) {
+      return false;
+    }
+    for (size_t i = hash & mask_; slots_[i].value != T(); i = (i + 1) & mask_) {
+      if (slots_[i].value == value) {
+        EraseSlot(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Calls visitor(element) for every element, in no particular order.
+  template <typename Visitor>
+  void VisitAll(const Visitor& visitor) const {
+    for (const Slot& slot : slots_) {
+      if (slot.value != T()) {
+        visitor(slot.value);
+      }
+    }
+  }
+
+  // Calls visitor(element) for every element until it returns false. Returns false if the visit
+  // was cut short.
+  template <typename Visitor>
+  bool VisitUntil(const Visitor& visitor) const {
+    for (const Slot& slot : slots_) {
+      if (slot.value != T() && !visitor(slot.value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Erase every element for which should_erase(element) is true and return how many were erased.
+  // should_erase may be called more than once for an element which is kept. Shrinks the table if it
+  // became mostly empty.
+  template <typename Predicate>
+  size_t EraseIf(const Predicate& should_erase) {
+    size_t erased = 0;
+    for (size_t i = 0; i < slots_.size();) {
+      // Erasing moves a later element of the probe sequence into the slot, so look at it again.
+      if (slots_[i].value != T() && should_erase(slots_[i].value)) {
+        EraseSlot(i);
+        ++erased;
+      } else {
+        ++i;
+      }
+    }
+    if (slots_.size() > kMinBuckets && num_elements_ * 8 < slots_.size()) {
+      size_t num_buckets = slots_.size();
+      while (num_buckets > kMinBuckets && num_elements_ * 4 < num_buckets) {
+        num_buckets /= 2;
+      }
+      Resize(num_buckets);
+    }
+    return erased;
+  }
+
+ private:
+  struct Slot {
+    Slot() : hash(0), value() {}
+    uint32_t hash;
+    T value;
+  };
+
+  void InsertNoResize(const T& value, uint32_t hash) {
+    size_t i = hash & mask_;
+    while (slots_[i].value != T()) {
+      i = (i + 1) & mask_;
+    }
+    slots_[i].hash = hash;
+    slots_[i].value = value;
+  }
+
+  void EraseSlot(size_t hole) {
+    DCHECK_GT(num_elements_, 0U);
+    --num_elements_;
+    // Move back each following element of the run whose home slot doesn't lie between the hole
+    // and itself, it would be unreachable otherwise.
+    for (size_t i = (hole + 1) & mask_; slots_[i].value != T(); i = (i + 1) & mask_) {
+      const size_t home = slots_[i].hash & mask_;
+      const bool reachable = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+      if (!reachable) {
+        slots_[hole] = slots_[i];
+        hole = i;
+      }
+    }
+    slots_[hole] = Slot();
+  }
+
+  void Resize(size_t num_buckets) {
+    DCHECK(IsPowerOfTwo(num_buckets)) << num_buckets;
+    DCHECK_LT(num_elements_, num_buckets);
+    std::vector<Slot> old_slots(num_buckets);
+    old_slots.swap(slots_);
+    mask_ = num_buckets - 1;
+    for (const Slot& slot : old_slots) {
+      if (slot.value != T()) {
+        InsertNoResize(slot.value, slot.hash);
+      }
+    }
+  }
+
+  static bool IsPowerOfTwo(size_t x) {
+    return (x & (x - 1)) == 0;
+  }
+
+  std::vector<Slot> slots_;
+  size_t num_elements_;
+  size_t mask_;
+
+  DISALLOW_COPY_AND_ASSIGN(HashSet);
+};
+
+template <typename T>
+constexpr size_t HashSet<T>::kMinBuckets;
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_HASH_SET_H_
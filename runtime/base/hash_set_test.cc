@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hash_set.h"
+
+#include <stdlib.h>
+
+#include <map>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+typedef HashSet<const int*> IntPtrSet;
+
+class PointsTo {
+ public:
+  explicit PointsTo(int value) : value_(value) {}
+
+  bool operator()(const int* element) const {
+    return *element == value_;
+  }
+
+ private:
+  const int value_;
+};
+
+class IsOdd {
+ public:
+  bool operator()(const int* element) const {
+    return (*element & 1) != 0;
+  }
+};
+
+TEST(HashSetTest, InsertFindErase) {
+  static const int kNumValues = 1000;
+  int values[kNumValues];
+  IntPtrSet set;
+  EXPECT_TRUE(set.IsEmpty());
+  EXPECT_TRUE(set.Find(0, PointsTo(0)) == NULL);
+  for (int i = 0; i < kNumValues; ++i) {
+    values[i] = i;
+    // Few distinct hashes so that the probe sequences are long and wrap around.
+    set.Insert(&values[i], i % 7);
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumValues), set.Size());
+  for (int i = 0; i < kNumValues; ++i) {
+    EXPECT_EQ(&values[i], set.Find(i % 7, PointsTo(i)));
+    EXPECT_TRUE(set.Find((i + 1) % 7, PointsTo(i)) == NULL);
+  }
+  for (int i = 0; i < kNumValues; i += 2) {
+    EXPECT_TRUE(set.Erase(&values[i], i % 7));
+    EXPECT_FALSE(set.Erase(&values[i], i % 7));
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumValues / 2), set.Size());
+  for (int i = 0; i < kNumValues; ++i) {
+    EXPECT_EQ(i % 2 == 0 ? NULL : &values[i], set.Find(i % 7, PointsTo(i)));
+  }
+  size_t visited = 0;
+  EXPECT_FALSE(set.VisitUntil([&visited](const int*) { return ++visited != 10; }));
+  EXPECT_EQ(10U, visited);
+  EXPECT_EQ(static_cast<size_t>(kNumValues / 2), set.EraseIf(IsOdd()));
+  EXPECT_TRUE(set.IsEmpty());
+  EXPECT_EQ(IntPtrSet::kMinBuckets, set.NumBuckets());
+}
+
+// Compare against a multimap with random inserts and erases.
+TEST(HashSetTest, Random) {
+  static const int kNumValues = 512;
+  static const int kNumOperations = 100000;
+  int values[kNumValues];
+  std::multimap<uint32_t, const int*> expected;
+  IntPtrSet set;
+  srand(42);
+  for (int i = 0; i < kNumValues; ++i) {
+    values[i] = i;
+  }
+  for (int op = 0; op < kNumOperations; ++op) {
+    const int i = rand() % kNumValues;
+    const uint32_t hash = static_cast<uint32_t>(i) * 37;
+    if (rand() % 3 != 0) {
+      set.Insert(&values[i], hash);
+      expected.insert(std::make_pair(hash, &values[i]));
+    } else {
+      auto it = expected.find(hash);
+      EXPECT_EQ(it != expected.end(), set.Erase(&values[i], hash));
+      if (it != expected.end()) {
+        expected.erase(it);
+      }
+    }
+    if (op % 1000 == 0) {
+      set.EraseIf(PointsTo(i));
+      expected.erase(hash);
+    }
+  }
+  ASSERT_EQ(expected.size(), set.Size());
+  for (int i = 0; i < kNumValues; ++i) {
+    const uint32_t hash = static_cast<uint32_t>(i) * 37;
+    size_t count = 0;
+    set.FindAll(hash, PointsTo(i), [&count](const int*) { ++count; });
+    EXPECT_EQ(expected.count(hash), count) << i;
+  }
+}
+
+}  // namespace art
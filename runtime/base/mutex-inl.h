@@ -23,6 +23,7 @@
 
 #include "cutils/atomic-inline.h"
 #include "cutils/trace.h"
+#include "lock_profiler.h"
 #include "runtime.h"
 #include "thread.h"
 
@@ -44,10 +45,11 @@ static inline int futex(volatile int *uaddr, int op, int val, const struct times
 class ScopedContentionRecorder {
  public:
   ScopedContentionRecorder(BaseMutex* mutex, uint64_t blocked_tid, uint64_t owner_tid)
-      : mutex_(kLogLockContentions ? mutex : NULL),
+      : mutex_(mutex),
         blocked_tid_(kLogLockContentions ? blocked_tid : 0),
         owner_tid_(kLogLockContentions ? owner_tid : 0),
-        start_nano_time_(kLogLockContentions ? NanoTime() : 0) {
+        profile_(LockProfiler::IsEnabled()),
+        start_nano_time_((kLogLockContentions || profile_) ? NanoTime() : 0) {
     std::string msg = StringPrintf("Lock contention on %s (owner tid: %llu)",
                                    mutex->GetName(), owner_tid);
     ATRACE_BEGIN(msg.c_str());
@@ -55,9 +57,14 @@ class ScopedContentionRecorder {
 
   ~ScopedContentionRecorder() {
     ATRACE_END();
-    if (kLogLockContentions) {
+    if (kLogLockContentions || profile_) {
       uint64_t end_nano_time = NanoTime();
-      mutex_->RecordContention(blocked_tid_, owner_tid_, end_nano_time - start_nano_time_);
+      if (kLogLockContentions) {
+        mutex_->RecordContention(blocked_tid_, owner_tid_, end_nano_time - start_nano_time_);
+      }
+      if (profile_) {
+        LockProfiler::RecordMutexContention(mutex_->GetName(), end_nano_time - start_nano_time_);
+      }
     }
   }
 
@@ -65,6 +72,7 @@ class ScopedContentionRecorder {
   BaseMutex* const mutex_;
   const uint64_t blocked_tid_;
   const uint64_t owner_tid_;
+  const bool profile_;
   const uint64_t start_nano_time_;
 };
 
@@ -135,11 +143,16 @@ inline void ReaderWriterMutex::SharedLock(Thread* self) {
   DCHECK(self == NULL || self == Thread::Current());
 #if ART_USE_FUTEXES
   bool done = false;
+  bool spun = false;
   do {
     int32_t cur_state = state_;
     if (LIKELY(cur_state >= 0)) {
       // Add as an extra reader.
       done = android_atomic_acquire_cas(cur_state, cur_state + 1, &state_) == 0;
+    } else if (!spun) {
+      // Give the owner a chance to release the lock before we hang up.
+      spun = true;
+      SpinWhileHeld(&state_, true);
     } else {
       // Owner holds it exclusively, hang up.
       ScopedContentionRecorder scr(this, GetExclusiveOwnerTid(), SafeGetTid(self));
@@ -185,6 +198,17 @@ inline void ReaderWriterMutex::SharedUnlock(Thread* self) {
 #endif
 }
 
+inline void ReaderWriterMutex::RegisterBiasedShare(Thread* self) {
+  DCHECK(self != NULL && self == Thread::Current());
+  RegisterAsLocked(self);
+}
+
+inline void ReaderWriterMutex::UnregisterBiasedShare(Thread* self) {
+  DCHECK(self != NULL && self == Thread::Current());
+  AssertSharedHeld(self);
+  RegisterAsUnlocked(self);
+}
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_BASE_MUTEX_INL_H_
@@ -18,6 +18,9 @@
 
 #include <errno.h>
 #include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
 
 #include "atomic.h"
 #include "base/logging.h"
@@ -120,7 +123,11 @@ class ScopedAllMutexesLock {
   const BaseMutex* const mutex_;
 };
 
-BaseMutex::BaseMutex(const char* name, LockLevel level) : level_(level), name_(name) {
+// Spinning can't help with a single CPU, as the owner of the lock doesn't run while we spin.
+static const bool gSpinOnContention = sysconf(_SC_NPROCESSORS_CONF) > 1;
+
+BaseMutex::BaseMutex(const char* name, LockLevel level)
+    : level_(level), name_(name), spin_budget_(kMinSpins) {
   if (kLogLockContentions) {
     ScopedAllMutexesLock mu(this);
     std::set<BaseMutex*>** all_mutexes_ptr = &all_mutex_data->all_mutexes;
@@ -237,6 +244,12 @@ void BaseMutex::DumpContention(std::ostream& os) const {
     const ContentionLogEntry* log = data->contention_log;
     uint64_t wait_time = data->wait_time;
     uint32_t contention_count = data->contention_count;
+    int32_t spin_success_count = data->spin_success_count;
+    int32_t spin_failure_count = data->spin_failure_count;
+    if (spin_success_count != 0 || spin_failure_count != 0) {
+      os << "spun " << spin_success_count << " times to acquire, " << spin_failure_count
+         << " times in vain, ";
+    }
     if (contention_count == 0) {
       os << "never contended";
     } else {
@@ -290,6 +303,28 @@ void BaseMutex::DumpContention(std::ostream& os) const {
   }
 }
 
+void BaseMutex::SpinWhileHeld(volatile int32_t* state, bool shared) {
+  if (!gSpinOnContention) {
+    return;
+  }
+  const uint32_t spins = spin_budget_;
+  for (uint32_t i = 0; i < spins; ++i) {
+    int32_t cur_state = *state;
+    if (shared ? cur_state >= 0 : cur_state == 0) {
+      spin_budget_ = std::min<uint32_t>(spins * 2, kMaxSpins);
+      if (kLogLockContentions) {
+        ++contetion_log_data_->spin_success_count;
+      }
+      return;
+    }
+    SpinPause();
+  }
+  spin_budget_ = std::max<uint32_t>(spins / 2, kMinSpins);
+  if (kLogLockContentions) {
+    ++contetion_log_data_->spin_failure_count;
+  }
+}
+
 
 Mutex::Mutex(const char* name, LockLevel level, bool recursive)
     : BaseMutex(name, level), recursive_(recursive), recursion_count_(0) {
@@ -344,11 +379,16 @@ void Mutex::ExclusiveLock(Thread* self) {
   if (!recursive_ || !IsExclusiveHeld(self)) {
 #if ART_USE_FUTEXES
     bool done = false;
+    bool spun = false;
     do {
       int32_t cur_state = state_;
       if (cur_state == 0) {
         // Change state from 0 to 1.
         done = android_atomic_acquire_cas(0, 1, &state_) == 0;
+      } else if (!spun) {
+        // Give the owner a chance to release the lock before we hang up.
+        spun = true;
+        SpinWhileHeld(&state_, false);
       } else {
         // Failed to acquire, hang up.
         ScopedContentionRecorder scr(this, SafeGetTid(self), GetExclusiveOwnerTid());
@@ -547,11 +587,16 @@ void ReaderWriterMutex::ExclusiveLock(Thread* self) {
   AssertNotExclusiveHeld(self);
 #if ART_USE_FUTEXES
   bool done = false;
+  bool spun = false;
   do {
     int32_t cur_state = state_;
     if (cur_state == 0) {
       // Change state from 0 to -1.
       done = android_atomic_acquire_cas(0, -1, &state_) == 0;
+    } else if (!spun) {
+      // Give the owners a chance to release the lock before we hang up.
+      spun = true;
+      SpinWhileHeld(&state_, false);
     } else {
       // Failed to acquire, hang up.
       ScopedContentionRecorder scr(this, SafeGetTid(self), GetExclusiveOwnerTid());
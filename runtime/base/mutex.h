@@ -90,9 +90,21 @@ class BaseMutex {
   void RecordContention(uint64_t blocked_tid, uint64_t owner_tid, uint64_t nano_time_blocked);
   void DumpContention(std::ostream& os) const;
 
+  // Spins while *state shows the lock held exclusively, or held at all unless shared is true, for
+  // at most the spin budget of the lock, so that locks held for short critical sections are waited
+  // for without sleeping on the futex and switching context. Returns early on a single CPU.
+  void SpinWhileHeld(volatile int32_t* state, bool shared);
+
+  static const uint16_t kMinSpins = 16;
+  static const uint16_t kMaxSpins = 1024;
+
   const LockLevel level_;  // Support for lock hierarchy.
   const char* const name_;
 
+  // Spin budget of the lock, which doubles when spinning saw the lock released and halves when it
+  // didn't. Updates are racy, which only costs some accuracy.
+  uint16_t spin_budget_;
+
   // A log entry that records contention but makes no guarantee that either tid will be held live.
   struct ContentionLogEntry {
     ContentionLogEntry() : blocked_tid(0), owner_tid(0) {}
@@ -109,6 +121,9 @@ class BaseMutex {
     AtomicInteger contention_count;
     // Sum of time waited by all contenders in ns.
     volatile uint64_t wait_time;
+    // Number of times a contender spinning saw the Mutex released, or gave up and slept.
+    AtomicInteger spin_success_count;
+    AtomicInteger spin_failure_count;
     void AddToWaitTime(uint64_t value);
     ContentionLogData() : wait_time(0) {}
   };
@@ -117,7 +132,8 @@ class BaseMutex {
  public:
   bool HasEverContended() const {
     if (kLogLockContentions) {
-      return contetion_log_data_->contention_count > 0;
+      return contetion_log_data_->contention_count > 0 ||
+          contetion_log_data_->spin_success_count > 0;
     }
     return false;
   }
@@ -251,6 +267,11 @@ class LOCKABLE ReaderWriterMutex : public BaseMutex {
   void SharedUnlock(Thread* self) UNLOCK_FUNCTION() ALWAYS_INLINE;
   void ReaderUnlock(Thread* self) UNLOCK_FUNCTION() { SharedUnlock(self); }
 
+  // Record that self holds, or no longer holds, a share that isn't counted by this lock, whose
+  // exclusive owners exclude it by other means. See Thread::TransitionFromSuspendedToRunnable.
+  void RegisterBiasedShare(Thread* self) SHARED_LOCK_FUNCTION() ALWAYS_INLINE;
+  void UnregisterBiasedShare(Thread* self) UNLOCK_FUNCTION() ALWAYS_INLINE;
+
   // Is the current thread the exclusive holder of the ReaderWriterMutex.
   bool IsExclusiveHeld(const Thread* self) const;
 
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sharded_histogram.h"
+
+#include <string.h>
+
+#include <ostream>
+
+#include "base/logging.h"
+
+namespace art {
+
+ShardedHistogram::ShardedHistogram(const char* name) : name_(name) {
+  memset(shards_, 0, sizeof(shards_));
+}
+
+void ShardedHistogram::Merge(MergedData* data) const {
+  data->sample_size_ = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    uint64_t count = 0;
+    for (size_t j = 0; j < kNumShards; ++j) {
+      // The counters wrap rather than overflow, a shard counting more than 2^32 values of a
+      // bucket loses them.
+      count += static_cast<uint32_t>(shards_[j].counts[i]);
+    }
+    data->freq_[i] = count;
+    data->sample_size_ += count;
+  }
+}
+
+void ShardedHistogram::Reset() {
+  for (size_t i = 0; i < kNumShards; ++i) {
+    for (size_t j = 0; j < kNumBuckets; ++j) {
+      android_atomic_release_store(0, &shards_[i].counts[j]);
+    }
+  }
+}
+
+uint64_t ShardedHistogram::Percentile(double per, const MergedData& data) const {
+  DCHECK_GE(per, 0.0);
+  DCHECK_LE(per, 1.0);
+  if (data.sample_size_ == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(per * data.sample_size_);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += data.freq_[i];
+    if (seen > rank) {
+      return BucketStart(i);
+    }
+  }
+  return BucketStart(LastBucket(data));
+}
+
+size_t ShardedHistogram::LastBucket(const MergedData& data) {
+  for (size_t i = kNumBuckets; i > 0; --i) {
+    if (data.freq_[i - 1] != 0) {
+      return i - 1;
+    }
+  }
+  return 0;
+}
+
+double ShardedHistogram::Mean(const MergedData& data) const {
+  if (data.sample_size_ == 0) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    if (data.freq_[i] != 0) {
+      double middle = (static_cast<double>(BucketStart(i)) + BucketEnd(i)) / 2;
+      sum += middle * data.freq_[i];
+    }
+  }
+  return sum / data.sample_size_;
+}
+
+void ShardedHistogram::Dump(std::ostream& os, const MergedData& data) const {
+  os << name_ << ": " << data.sample_size_ << " values";
+  if (data.sample_size_ != 0) {
+    size_t last_bucket = LastBucket(data);
+    os << ", mean " << Mean(data) << ", median " << Percentile(0.5, data)
+       << ", 90% " << Percentile(0.9, data) << ", 99% " << Percentile(0.99, data)
+       << ", max [" << BucketStart(last_bucket) << ", " << BucketEnd(last_bucket) << "]";
+  }
+  os << "\n";
+}
+
+}  // namespace art
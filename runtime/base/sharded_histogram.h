@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_BASE_SHARDED_HISTOGRAM_H_
+#define ART_RUNTIME_BASE_SHARDED_HISTOGRAM_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "cutils/atomic.h"
+#include "cutils/atomic-inline.h"
+
+namespace art {
+
+// A histogram of uint64_t values cheap enough to record from any thread at any time, without a
+// lock and without allocating: each value is one atomic increment of a counter. Unlike Histogram,
+// whose buckets grow with the values, the buckets are fixed and log-linear, each power of two
+// being split in kSubBuckets buckets, so that a value is known to within 1/kSubBuckets of itself
+// whatever its magnitude. The counters are sharded by thread so that threads recording at the same
+// time seldom share a cache line, and the shards are only summed when the histogram is dumped.
+class ShardedHistogram {
+ public:
+  static const size_t kSubBucketBits = 3;
+  static const size_t kSubBuckets = 1 << kSubBucketBits;
+  // Values below kSubBuckets have a bucket each, the powers of two above are split.
+  static const size_t kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+  static const size_t kShardBits = 3;
+  static const size_t kNumShards = 1 << kShardBits;
+
+  // The counts of the buckets summed over the shards.
+  class MergedData {
+   public:
+    MergedData() : freq_(kNumBuckets, 0), sample_size_(0) {}
+
+    uint64_t SampleSize() const {
+      return sample_size_;
+    }
+
+   private:
+    std::vector<uint64_t> freq_;
+    uint64_t sample_size_;
+
+    friend class ShardedHistogram;
+  };
+
+  explicit ShardedHistogram(const char* name);
+
+  void AddValue(uint64_t value) {
+    android_atomic_inc(&shards_[ShardIndex()].counts[BucketIndex(value)]);
+  }
+
+  // Values added while the shards are summed may or may not be counted.
+  void Merge(MergedData* data) const;
+  void Reset();
+
+  // Lower bound of the values, the first value of the bucket holding percentile per.
+  uint64_t Percentile(double per, const MergedData& data) const;
+  // Taking the middle of the buckets for their values.
+  double Mean(const MergedData& data) const;
+  // Prints the sample size, mean, median, 90th and 99th percentiles and the largest bucket used.
+  void Dump(std::ostream& os, const MergedData& data) const;
+
+  const std::string& Name() const {
+    return name_;
+  }
+
+  static size_t BucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+      return value;
+    }
+    size_t log2 = 63 - __builtin_clzll(value);
+    size_t sub_bucket = (value >> (log2 - kSubBucketBits)) & (kSubBuckets - 1);
+    return (log2 - kSubBucketBits + 1) * kSubBuckets + sub_bucket;
+  }
+
+  // Smallest value of a bucket.
+  static uint64_t BucketStart(size_t index) {
+    if (index < kSubBuckets) {
+      return index;
+    }
+    size_t log2 = index / kSubBuckets + kSubBucketBits - 1;
+    return static_cast<uint64_t>(kSubBuckets + index % kSubBuckets) << (log2 - kSubBucketBits);
+  }
+
+  // Largest value of a bucket.
+  static uint64_t BucketEnd(size_t index) {
+    if (index + 1 == kNumBuckets) {
+      return std::numeric_limits<uint64_t>::max();
+    }
+    return BucketStart(index + 1) - 1;
+  }
+
+ private:
+  struct Shard {
+    volatile int32_t counts[kNumBuckets];
+  };
+
+  // Spreads the threads over the shards. A pthread_t is the address of a block allocated with the
+  // thread's stack, and so a multiple of a large power of two apart from the others, hence the
+  // multiplicative hash.
+  static size_t ShardIndex() {
+    uint32_t hash = static_cast<uint32_t>(static_cast<uintptr_t>(pthread_self()) >> 4);
+    return (hash * 2654435761U) >> (32 - kShardBits);
+  }
+
+  // Index of the last bucket with values, 0 if there isn't any.
+  static size_t LastBucket(const MergedData& data);
+
+  const std::string name_;
+  Shard shards_[kNumShards];
+
+  DISALLOW_COPY_AND_ASSIGN(ShardedHistogram);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_SHARDED_HISTOGRAM_H_
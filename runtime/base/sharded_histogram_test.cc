@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "sharded_histogram.h"
+#include "UniquePtr.h"
+
+#include <sstream>
+
+namespace art {
+
+TEST(ShardedHistogramTest, Buckets) {
+  for (uint64_t value = 0; value < 4096; ++value) {
+    size_t index = ShardedHistogram::BucketIndex(value);
+    EXPECT_LE(ShardedHistogram::BucketStart(index), value);
+    EXPECT_GE(ShardedHistogram::BucketEnd(index), value);
+  }
+  // Buckets are contiguous and within 1/kSubBuckets of their values.
+  for (size_t index = 1; index < ShardedHistogram::kNumBuckets; ++index) {
+    uint64_t start = ShardedHistogram::BucketStart(index);
+    EXPECT_EQ(ShardedHistogram::BucketEnd(index - 1) + 1, start);
+    EXPECT_EQ(index, ShardedHistogram::BucketIndex(start));
+    EXPECT_LE(ShardedHistogram::BucketEnd(index) - start,
+              start / ShardedHistogram::kSubBuckets);
+  }
+  EXPECT_EQ(ShardedHistogram::kNumBuckets - 1,
+            ShardedHistogram::BucketIndex(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(ShardedHistogramTest, Percentiles) {
+  UniquePtr<ShardedHistogram> hist(new ShardedHistogram("Percentiles"));
+  for (uint64_t value = 0; value < 100; ++value) {
+    hist->AddValue(value);
+  }
+  ShardedHistogram::MergedData data;
+  hist->Merge(&data);
+  EXPECT_EQ(100U, data.SampleSize());
+  // 50 is in the bucket [48, 51], 90 in [88, 95] and 99 in [96, 103].
+  EXPECT_EQ(48U, hist->Percentile(0.5, data));
+  EXPECT_EQ(88U, hist->Percentile(0.9, data));
+  EXPECT_EQ(96U, hist->Percentile(0.99, data));
+  EXPECT_NEAR(49.5, hist->Mean(data), 49.5 / ShardedHistogram::kSubBuckets);
+
+  hist->Reset();
+  hist->Merge(&data);
+  EXPECT_EQ(0U, data.SampleSize());
+  EXPECT_EQ(0U, hist->Percentile(0.5, data));
+}
+
+TEST(ShardedHistogramTest, Dump) {
+  UniquePtr<ShardedHistogram> hist(new ShardedHistogram("Dump"));
+  hist->AddValue(1000);
+  ShardedHistogram::MergedData data;
+  hist->Merge(&data);
+  std::ostringstream os;
+  hist->Dump(os, data);
+  EXPECT_EQ("Dump: 1 values, mean 991.5, median 960, 90% 960, 99% 960, max [960, 1023]\n",
+            os.str());
+}
+
+}  // namespace art
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch_handler_cache.h"
+
+#include <vector>
+
+#include "cutils/atomic.h"
+#include "cutils/atomic-inline.h"
+#include "mirror/art_method.h"
+#include "mirror/class.h"
+
+namespace art {
+
+CatchHandlerCache::CatchHandlerCache() {
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    entries_[i] = 0;
+  }
+}
+
+CatchHandlerCache::~CatchHandlerCache() {
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    delete reinterpret_cast<Entry*>(entries_[i]);
+  }
+}
+
+uint32_t CatchHandlerCache::Hash(const mirror::ArtMethod* method, uintptr_t pc,
+                                 const mirror::Class* exception_type) {
+  // Objects are 8 byte aligned, drop the low bits before mixing.
+  uint32_t hash = (reinterpret_cast<uintptr_t>(method) >> 3) * 0x9E3779B1U;
+  hash ^= pc + (hash >> 16);
+  hash = hash * 0x9E3779B1U;
+  hash ^= (reinterpret_cast<uintptr_t>(exception_type) >> 3) + (hash >> 16);
+  return hash;
+}
+
+bool CatchHandlerCache::Lookup(const mirror::ArtMethod* method, uintptr_t pc,
+                               const mirror::Class* exception_type, CatchHandler* handler) const {
+  uint32_t hash = Hash(method, pc, exception_type);
+  for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+    const Entry* entry = reinterpret_cast<const Entry*>(
+        android_atomic_acquire_load(&entries_[(hash + probe) % kMaxEntries]));
+    if (entry == NULL) {
+      return false;
+    }
+    if (entry->method == method && entry->pc == pc && entry->exception_type == exception_type) {
+      *handler = entry->handler;
+      return true;
+    }
+  }
+  return false;
+}
+
+void CatchHandlerCache::Add(const mirror::ArtMethod* method, uintptr_t pc,
+                            const mirror::Class* exception_type, const CatchHandler& handler) {
+  uint32_t hash = Hash(method, pc, exception_type);
+  Entry* new_entry = NULL;
+  for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+    volatile int32_t* slot = &entries_[(hash + probe) % kMaxEntries];
+    const Entry* entry = reinterpret_cast<const Entry*>(android_atomic_acquire_load(slot));
+    if (entry == NULL) {
+      if (new_entry == NULL) {
+        new_entry = new Entry;
+        new_entry->method = method;
+        new_entry->pc = pc;
+        new_entry->exception_type = exception_type;
+        new_entry->handler = handler;
+      }
+      // Note: android_atomic_release_cas() returns 0 on success, not failure.
+      if (android_atomic_release_cas(0, reinterpret_cast<int32_t>(new_entry), slot) == 0) {
+        return;
+      }
+      // Another thread claimed the slot first, it may have added this very entry.
+      entry = reinterpret_cast<const Entry*>(android_atomic_acquire_load(slot));
+    }
+    if (entry->method == method && entry->pc == pc && entry->exception_type == exception_type) {
+      break;
+    }
+  }
+  delete new_entry;
+}
+
+size_t CatchHandlerCache::Size() const {
+  size_t size = 0;
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    if (android_atomic_acquire_load(&entries_[i]) != 0) {
+      ++size;
+    }
+  }
+  return size;
+}
+
+void CatchHandlerCache::Sweep(IsMarkedTester is_marked, void* arg) {
+  std::vector<Entry*> live_entries;
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    Entry* entry = reinterpret_cast<Entry*>(entries_[i]);
+    if (entry == NULL) {
+      continue;
+    }
+    entries_[i] = 0;
+    if (is_marked(entry->method, arg) && is_marked(entry->exception_type, arg)) {
+      live_entries.push_back(entry);
+    } else {
+      delete entry;
+    }
+  }
+  // Add the live entries again, the holes left by the others would end the probes for them.
+  for (Entry* entry : live_entries) {
+    uint32_t hash = Hash(entry->method, entry->pc, entry->exception_type);
+    size_t probe = 0;
+    while (probe < kMaxProbes && entries_[(hash + probe) % kMaxEntries] != 0) {
+      ++probe;
+    }
+    if (probe < kMaxProbes) {
+      entries_[(hash + probe) % kMaxEntries] = reinterpret_cast<int32_t>(entry);
+    } else {
+      delete entry;
+    }
+  }
+}
+
+}  // namespace art
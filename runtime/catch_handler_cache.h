@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CATCH_HANDLER_CACHE_H_
+#define ART_RUNTIME_CATCH_HANDLER_CACHE_H_
+
+#include <stdint.h>
+
+#include "base/macros.h"
+#include "root_visitor.h"
+
+namespace art {
+
+namespace mirror {
+class ArtMethod;
+class Class;
+}  // namespace mirror
+
+// The outcome of searching a quick frame for the catch block of an exception: the handler's dex
+// and native pc, or DexFile::kDexNoIndex if the frame doesn't catch the exception.
+struct CatchHandler {
+  uint32_t dex_pc;
+  uintptr_t native_pc;
+  // Whether the handler doesn't start with a move-exception, so the exception is cleared.
+  bool clear_exception;
+};
+
+// Remembers where exceptions thrown through a quick frame are caught, keyed by the method, the
+// frame's pc and the exception class. Delivering an exception then needs neither the frame's dex
+// pc nor a decode of the method's try items and catch handler lists, which matters for code that
+// uses exceptions for control flow. Entries are added once and only removed by the GC, with the
+// mutators suspended; lookups take no lock and nothing is cached once the table is full. The
+// entries hold no roots, the GC sweeps those of the classes and methods it unloads.
+class CatchHandlerCache {
+ public:
+  static constexpr size_t kMaxEntries = 4096;
+
+  CatchHandlerCache();
+  ~CatchHandlerCache();
+
+  // Copies the cached handler for exception_type thrown through method at pc to handler and
+  // returns true, false if it isn't cached.
+  bool Lookup(const mirror::ArtMethod* method, uintptr_t pc, const mirror::Class* exception_type,
+              CatchHandler* handler) const;
+
+  void Add(const mirror::ArtMethod* method, uintptr_t pc, const mirror::Class* exception_type,
+           const CatchHandler& handler);
+
+  size_t Size() const;
+
+  // Removes the entries of the methods and exception classes the GC didn't mark.
+  void Sweep(IsMarkedTester is_marked, void* arg);
+
+ private:
+  struct Entry {
+    const mirror::ArtMethod* method;
+    uintptr_t pc;
+    const mirror::Class* exception_type;
+    CatchHandler handler;
+  };
+
+  static constexpr size_t kMaxProbes = 8;
+
+  static uint32_t Hash(const mirror::ArtMethod* method, uintptr_t pc,
+                       const mirror::Class* exception_type);
+
+  // Entry pointers, set once with a release compare-and-swap.
+  volatile int32_t entries_[kMaxEntries];
+
+  DISALLOW_COPY_AND_ASSIGN(CatchHandlerCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CATCH_HANDLER_CACHE_H_
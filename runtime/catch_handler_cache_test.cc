@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "catch_handler_cache.h"
+
+#include "common_test.h"
+#include "dex_file.h"
+#include "mirror/art_method.h"
+#include "mirror/class.h"
+
+namespace art {
+
+class CatchHandlerCacheTest : public CommonTest {};
+
+TEST_F(CatchHandlerCacheTest, LookupAndAdd) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* object = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  mirror::Class* npe = class_linker_->FindSystemClass("Ljava/lang/NullPointerException;");
+  mirror::Class* oome = class_linker_->FindSystemClass("Ljava/lang/OutOfMemoryError;");
+  ASSERT_TRUE(object != NULL);
+  ASSERT_TRUE(npe != NULL);
+  ASSERT_TRUE(oome != NULL);
+  mirror::ArtMethod* hash_code = object->FindVirtualMethod("hashCode", "()I");
+  mirror::ArtMethod* to_string = object->FindVirtualMethod("toString", "()Ljava/lang/String;");
+  ASSERT_TRUE(hash_code != NULL);
+  ASSERT_TRUE(to_string != NULL);
+
+  CatchHandlerCache cache;
+  CatchHandler handler;
+  EXPECT_FALSE(cache.Lookup(hash_code, 0x1234, npe, &handler));
+  EXPECT_EQ(0U, cache.Size());
+
+  CatchHandler caught = { 0x10, 0x5678, true };
+  cache.Add(hash_code, 0x1234, npe, caught);
+  CatchHandler not_caught = { DexFile::kDexNoIndex, 0, false };
+  cache.Add(hash_code, 0x1234, oome, not_caught);
+  EXPECT_EQ(2U, cache.Size());
+
+  ASSERT_TRUE(cache.Lookup(hash_code, 0x1234, npe, &handler));
+  EXPECT_EQ(0x10U, handler.dex_pc);
+  EXPECT_EQ(0x5678U, handler.native_pc);
+  EXPECT_TRUE(handler.clear_exception);
+  ASSERT_TRUE(cache.Lookup(hash_code, 0x1234, oome, &handler));
+  EXPECT_TRUE(handler.dex_pc == DexFile::kDexNoIndex);
+
+  // Any part of the key differing misses.
+  EXPECT_FALSE(cache.Lookup(hash_code, 0x1238, npe, &handler));
+  EXPECT_FALSE(cache.Lookup(to_string, 0x1234, npe, &handler));
+
+  // Entries are added once.
+  cache.Add(hash_code, 0x1234, npe, not_caught);
+  EXPECT_EQ(2U, cache.Size());
+  ASSERT_TRUE(cache.Lookup(hash_code, 0x1234, npe, &handler));
+  EXPECT_EQ(0x10U, handler.dex_pc);
+
+  // Once the probed slots are taken additions are dropped.
+  const size_t max_entries = CatchHandlerCache::kMaxEntries;
+  for (uintptr_t pc = 0; pc < 4 * max_entries; ++pc) {
+    cache.Add(to_string, pc, npe, caught);
+  }
+  EXPECT_LE(cache.Size(), max_entries);
+  ASSERT_TRUE(cache.Lookup(hash_code, 0x1234, oome, &handler));
+  EXPECT_TRUE(handler.dex_pc == DexFile::kDexNoIndex);
+}
+
+}  // namespace art
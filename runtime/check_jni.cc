@@ -176,7 +176,7 @@ class ScopedCheck {
   }
 
   bool ForceCopy() {
-    return Runtime::Current()->GetJavaVM()->force_copy;
+    return !lite_ && Runtime::Current()->GetJavaVM()->force_copy;
   }
 
   // Checks that 'class_name' is a valid "fully-qualified" JNI class name, like "java/lang/Thread"
@@ -200,6 +200,9 @@ class ScopedCheck {
    */
   void CheckFieldType(jobject java_object, jfieldID fid, char prim, bool isStatic)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (lite_) {
+      return;
+    }
     mirror::ArtField* f = CheckFieldID(fid);
     if (f == NULL) {
       return;
@@ -247,6 +250,9 @@ class ScopedCheck {
    */
   void CheckInstanceFieldID(jobject java_object, jfieldID fid)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (lite_) {
+      return;
+    }
     mirror::Object* o = soa_.Decode<mirror::Object*>(java_object);
     if (o == NULL || !Runtime::Current()->GetHeap()->IsHeapAddress(o)) {
       Runtime::Current()->GetHeap()->DumpSpaces();
@@ -282,6 +288,9 @@ class ScopedCheck {
    */
   void CheckSig(jmethodID mid, const char* expectedType, bool isStatic)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (lite_) {
+      return;
+    }
     mirror::ArtMethod* m = CheckMethodID(mid);
     if (m == NULL) {
       return;
@@ -308,6 +317,9 @@ class ScopedCheck {
    */
   void CheckStaticFieldID(jclass java_class, jfieldID fid)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (lite_) {
+      return;
+    }
     mirror::Class* c = soa_.Decode<mirror::Class*>(java_class);
     const mirror::ArtField* f = CheckFieldID(fid);
     if (f == NULL) {
@@ -330,6 +342,9 @@ class ScopedCheck {
    */
   void CheckStaticMethod(jclass java_class, jmethodID mid)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (lite_) {
+      return;
+    }
     const mirror::ArtMethod* m = CheckMethodID(mid);
     if (m == NULL) {
       return;
@@ -350,6 +365,9 @@ class ScopedCheck {
    */
   void CheckVirtualMethod(jobject java_object, jmethodID mid)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (lite_) {
+      return;
+    }
     const mirror::ArtMethod* m = CheckMethodID(mid);
     if (m == NULL) {
       return;
@@ -562,6 +580,12 @@ class ScopedCheck {
         } else if (ch == 'u') {
           if ((flags_ & kFlag_Release) != 0) {
             CheckNonNull(va_arg(ap, const char*));
+          } else if (lite_) {
+            // Walking the whole string is too slow for the lite checks.
+            const char* utf = va_arg(ap, const char*);
+            if ((flags_ & kFlag_NullableUtf) == 0) {
+              CheckNonNull(utf);
+            }
           } else {
             bool nullable = ((flags_ & kFlag_NullableUtf) != 0);
             CheckUtfString(va_arg(ap, const char*), nullable);
@@ -667,6 +691,7 @@ class ScopedCheck {
     flags_ = flags;
     function_name_ = functionName;
     has_method_ = has_method;
+    lite_ = soa_.Vm()->check_jni_lite;
   }
 
   /*
@@ -889,6 +914,8 @@ class ScopedCheck {
   const char* function_name_;
   int flags_;
   bool has_method_;
+  // Whether only the reference kinds, the thread and pending exceptions are checked.
+  bool lite_;
   int indent_;
 
   DISALLOW_COPY_AND_ASSIGN(ScopedCheck);
@@ -22,7 +22,9 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <algorithm>
 #include <deque>
+#include <limits>
 #include <string>
 #include <utility>
 #include <vector>
@@ -40,7 +42,11 @@
 #include "gc/space/image_space.h"
 #include "intern_table.h"
 #include "interpreter/interpreter.h"
+#include "jit/jit.h"
+#include "jni_internal.h"
 #include "leb128.h"
+#include "lock_profiler.h"
+#include "metrics.h"
 #include "oat.h"
 #include "oat_file.h"
 #include "mirror/art_field-inl.h"
@@ -63,6 +69,9 @@
 #include "sirt_ref.h"
 #include "stack_indirect_reference_table.h"
 #include "thread.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "transaction.h"
 #include "UniquePtr.h"
 #include "utils.h"
 #include "verifier/method_verifier.h"
@@ -187,13 +196,13 @@ ClassLinker* ClassLinker::CreateFromImage(InternTable* intern_table) {
 ClassLinker::ClassLinker(InternTable* intern_table)
     // dex_lock_ is recursive as it may be used in stack dumping.
     : dex_lock_("ClassLinker dex lock", kDefaultMutexLevel),
-      dex_cache_image_class_lookup_required_(false),
-      failed_dex_cache_class_lookups_(0),
+      image_class_table_(NULL),
+      image_class_table_hashes_(NULL),
+      num_image_classes_(0),
       class_roots_(NULL),
       array_iftable_(NULL),
       init_done_(false),
       dex_caches_dirty_(false),
-      class_table_dirty_(false),
       intern_table_(intern_table),
       portable_resolution_trampoline_(NULL),
       quick_resolution_trampoline_(NULL) {
@@ -503,12 +512,35 @@ void ClassLinker::FinishInit() {
   CHECK_STREQ(fh.GetName(), "zombie");
   CHECK_STREQ(fh.GetTypeDescriptor(), "Ljava/lang/Object;");
 
+  mirror::ArtField* next = java_lang_ref_FinalizerReference->GetInstanceField(0);
+  fh.ChangeField(next);
+  CHECK_STREQ(fh.GetName(), "next");
+  CHECK_STREQ(fh.GetTypeDescriptor(), "Ljava/lang/ref/FinalizerReference;");
+
+  mirror::ArtField* prev = java_lang_ref_FinalizerReference->GetInstanceField(1);
+  fh.ChangeField(prev);
+  CHECK_STREQ(fh.GetName(), "prev");
+  CHECK_STREQ(fh.GetTypeDescriptor(), "Ljava/lang/ref/FinalizerReference;");
+
+  mirror::Class* finalizer_reference = java_lang_ref_FinalizerReference;
+  mirror::ArtField* list_lock =
+      finalizer_reference->FindDeclaredStaticField("LIST_LOCK", "Ljava/lang/Object;");
+  CHECK(list_lock != NULL);
+  mirror::ArtField* head =
+      finalizer_reference->FindDeclaredStaticField("head", "Ljava/lang/ref/FinalizerReference;");
+  CHECK(head != NULL);
+  mirror::ArtField* finalizer_queue =
+      finalizer_reference->FindDeclaredStaticField("queue", "Ljava/lang/ref/ReferenceQueue;");
+  CHECK(finalizer_queue != NULL);
+
   gc::Heap* heap = Runtime::Current()->GetHeap();
   heap->SetReferenceOffsets(referent->GetOffset(),
                             queue->GetOffset(),
                             queueNext->GetOffset(),
                             pendingNext->GetOffset(),
                             zombie->GetOffset());
+  heap->SetFinalizerReferenceMembers(java_lang_ref_FinalizerReference, list_lock, head,
+                                     finalizer_queue, prev->GetOffset(), next->GetOffset());
 
   // ensure all class_roots_ are initialized
   for (size_t i = 0; i < kClassRootsMax; i++) {
@@ -660,6 +692,11 @@ void ClassLinker::RegisterOatFileLocked(const OatFile& oat_file) {
   oat_files_.push_back(&oat_file);
 }
 
+std::vector<const OatFile*> ClassLinker::GetOatFiles() {
+  ReaderMutexLock mu(Thread::Current(), dex_lock_);
+  return oat_files_;
+}
+
 OatFile& ClassLinker::GetImageOatFile(gc::space::ImageSpace* space) {
   VLOG(startup) << "ClassLinker::GetImageOatFile entering";
   OatFile& oat_file = space->ReleaseOatFile();
@@ -699,7 +736,8 @@ const DexFile* ClassLinker::FindDexFileInOatLocation(const std::string& dex_loca
     return NULL;
   }
   Runtime* runtime = Runtime::Current();
-  const ImageHeader& image_header = runtime->GetHeap()->GetImageSpace()->GetImageHeader();
+  const gc::space::ImageSpace* image_space = runtime->GetHeap()->GetImageSpace();
+  const ImageHeader& image_header = image_space->GetImageHeader();
   uint32_t expected_image_oat_checksum = image_header.GetOatChecksum();
   uint32_t actual_image_oat_checksum = oat_file->GetOatHeader().GetImageFileLocationOatChecksum();
   if (expected_image_oat_checksum != actual_image_oat_checksum) {
@@ -709,7 +747,7 @@ const DexFile* ClassLinker::FindDexFileInOatLocation(const std::string& dex_loca
     return NULL;
   }
 
-  uint32_t expected_image_oat_offset = reinterpret_cast<uint32_t>(image_header.GetOatDataBegin());
+  uint32_t expected_image_oat_offset = image_space->GetImageFileLocationOatDataBegin();
   uint32_t actual_image_oat_offset = oat_file->GetOatHeader().GetImageFileLocationOatDataBegin();
   if (expected_image_oat_offset != actual_image_oat_offset) {
     VLOG(class_linker) << "Failed to find oat file at " << oat_location
@@ -849,9 +887,10 @@ bool ClassLinker::VerifyOatFileChecksums(const OatFile* oat_file,
                                          const std::string& dex_location,
                                          uint32_t dex_location_checksum) {
   Runtime* runtime = Runtime::Current();
-  const ImageHeader& image_header = runtime->GetHeap()->GetImageSpace()->GetImageHeader();
+  const gc::space::ImageSpace* image_space = runtime->GetHeap()->GetImageSpace();
+  const ImageHeader& image_header = image_space->GetImageHeader();
   uint32_t image_oat_checksum = image_header.GetOatChecksum();
-  uint32_t image_oat_data_begin = reinterpret_cast<uint32_t>(image_header.GetOatDataBegin());
+  uint32_t image_oat_data_begin = image_space->GetImageFileLocationOatDataBegin();
   bool image_check = ((oat_file->GetOatHeader().GetImageFileLocationOatChecksum() == image_oat_checksum)
                       && (oat_file->GetOatHeader().GetImageFileLocationOatDataBegin() == image_oat_data_begin));
 
@@ -1015,7 +1054,6 @@ void ClassLinker::InitFromImage() {
 
   gc::Heap* heap = Runtime::Current()->GetHeap();
   gc::space::ImageSpace* space = heap->GetImageSpace();
-  dex_cache_image_class_lookup_required_ = true;
   CHECK(space != NULL);
   OatFile& oat_file = GetImageOatFile(space);
   CHECK_EQ(oat_file.GetOatHeader().GetImageFileLocationOatChecksum(), 0U);
@@ -1031,6 +1069,18 @@ void ClassLinker::InitFromImage() {
       space->GetImageHeader().GetImageRoot(ImageHeader::kClassRoots)->AsObjectArray<mirror::Class>();
   class_roots_ = class_roots;
 
+  image_class_table_ = space->GetImageHeader().GetImageRoot(ImageHeader::kClassTable)
+      ->AsObjectArray<mirror::Class>();
+  image_class_table_hashes_ =
+      space->GetImageHeader().GetImageRoot(ImageHeader::kClassTableHashes)->AsIntArray();
+  CHECK(IsPowerOfTwo(image_class_table_->GetLength())) << image_class_table_->GetLength();
+  CHECK_EQ(image_class_table_->GetLength(), image_class_table_hashes_->GetLength());
+  for (int32_t i = 0; i < image_class_table_->GetLength(); ++i) {
+    if (image_class_table_->GetWithoutChecks(i) != NULL) {
+      ++num_image_classes_;
+    }
+  }
+
   // Special case of setting up the String class early so that we can test arbitrary objects
   // as being Strings or not
   mirror::String::SetClass(GetClassRoot(kJavaLangString));
@@ -1093,14 +1143,17 @@ void ClassLinker::InitFromImage() {
 // Keep in sync with InitCallback. Anything we visit, we need to
 // reinit references to when reinitializing a ClassLinker from a
 // mapped image.
-void ClassLinker::VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, bool clean_dirty) {
+void ClassLinker::VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, bool clean_dirty,
+                             bool unload_classes) {
   visitor(class_roots_, arg);
   Thread* self = Thread::Current();
   {
     ReaderMutexLock mu(self, dex_lock_);
     if (!only_dirty || dex_caches_dirty_) {
       for (mirror::DexCache* dex_cache : dex_caches_) {
-        visitor(dex_cache, arg);
+        if (!unload_classes || IsInBootClassPath(dex_cache->GetDexFile())) {
+          visitor(dex_cache, arg);
+        }
       }
       if (clean_dirty) {
         dex_caches_dirty_ = false;
@@ -1109,13 +1162,22 @@ void ClassLinker::VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, b
   }
 
   {
-    ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
-    if (!only_dirty || class_table_dirty_) {
-      for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-        visitor(it.second, arg);
+    // Exclusive so that the shards can be walked without their locks.
+    WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+    for (ClassTableShard& shard : class_table_shards_) {
+      if (only_dirty) {
+        for (mirror::Class* klass : shard.new_classes) {
+          visitor(klass, arg);
+        }
+      } else {
+        shard.classes.VisitAll([visitor, arg, unload_classes](mirror::Class* klass) {
+          if (!unload_classes || klass->GetClassLoader() == NULL) {
+            visitor(klass, arg);
+          }
+        });
       }
       if (clean_dirty) {
-        class_table_dirty_ = false;
+        shard.new_classes.clear();
       }
     }
 
@@ -1126,13 +1188,137 @@ void ClassLinker::VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, b
   visitor(array_iftable_, arg);
 }
 
+bool ClassLinker::IsInBootClassPath(const DexFile* dex_file) const {
+  return std::find(boot_class_path_.begin(), boot_class_path_.end(), dex_file) !=
+      boot_class_path_.end();
+}
+
+bool ClassLinker::CanUnloadClasses() const {
+  Runtime* runtime = Runtime::Current();
+  return !runtime->IsCompiler() &&
+      runtime->GetJit() == NULL &&
+      runtime->GetSamplingProfiler() == NULL &&
+      !Dbg::IsDebuggerActive() &&
+      Trace::GetMethodTracingMode() == kTracingInactive &&
+      !LockProfiler::IsEnabled() &&
+      class_unloading_blockers_.load() == 0;
+}
+
+size_t ClassLinker::MarkClassesOfMarkedLoaders(IsMarkedTester is_marked, RootVisitor* visitor,
+                                               void* arg) {
+  size_t marked = 0;
+  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  for (ClassTableShard& shard : class_table_shards_) {
+    shard.classes.VisitAll([is_marked, visitor, arg, &marked](mirror::Class* klass) {
+      const mirror::ClassLoader* class_loader = klass->GetClassLoader();
+      if (class_loader != NULL && !is_marked(klass, arg) && is_marked(class_loader, arg)) {
+        visitor(klass, arg);
+        ++marked;
+      }
+    });
+  }
+  return marked;
+}
+
+template <typename T>
+static size_t ArrayBytes(mirror::ObjectArray<T>* array, bool with_elements)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (array == NULL) {
+    return 0;
+  }
+  size_t bytes = array->SizeOf();
+  for (int32_t i = 0; with_elements && i < array->GetLength(); ++i) {
+    bytes += array->GetWithoutChecks(i)->SizeOf();
+  }
+  return bytes;
+}
+
+// The bytes of a class, of the methods and fields it declares and of their arrays.
+static size_t ClassBytes(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  size_t bytes = klass->SizeOf();
+  if (klass->IsLoaded() || klass->IsErroneous()) {
+    bytes += ArrayBytes(klass->GetDirectMethods(), true);
+    bytes += ArrayBytes(klass->GetVirtualMethods(), true);
+    bytes += ArrayBytes(klass->GetIFields(), true);
+    bytes += ArrayBytes(klass->GetSFields(), true);
+    bytes += ArrayBytes(klass->GetVTableDuringLinking(), false);
+  }
+  return bytes;
+}
+
+void ClassLinker::SweepClasses(IsMarkedTester is_marked, void* arg, size_t* classes,
+                               size_t* bytes) {
+  Thread* self = Thread::Current();
+  {
+    WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+    for (ClassTableShard& shard : class_table_shards_) {
+      shard.classes.EraseIf([is_marked, arg, classes, bytes](mirror::Class* klass) {
+        if (is_marked(klass, arg)) {
+          return false;
+        }
+        DCHECK(klass->GetClassLoader() != NULL) << PrettyClass(klass);
+        VLOG(class_linker) << "Unloading " << PrettyClass(klass);
+        ++*classes;
+        *bytes += ClassBytes(klass);
+        return true;
+      });
+      std::vector<mirror::Class*>& new_classes = shard.new_classes;
+      new_classes.erase(std::remove_if(new_classes.begin(), new_classes.end(),
+                                       [is_marked, arg](mirror::Class* klass) {
+                                         return !is_marked(klass, arg);
+                                       }),
+                        new_classes.end());
+    }
+  }
+
+  WriterMutexLock mu(self, dex_lock_);
+  for (size_t i = 0; i < dex_caches_.size();) {
+    mirror::DexCache* dex_cache = dex_caches_[i];
+    const DexFile* dex_file = dex_cache->GetDexFile();
+    if (is_marked(dex_cache, arg) || IsInBootClassPath(dex_file)) {
+      ++i;
+      continue;
+    }
+    // The order of the dex caches doesn't matter, FindDexCache matches their dex file.
+    dex_caches_[i] = dex_caches_.back();
+    dex_caches_.pop_back();
+    // A dex file which wasn't closed gets a new dex cache if it defines classes again.
+    if (closed_dex_files_.erase(dex_file) != 0) {
+      VLOG(class_linker) << "Unloading " << dex_file->GetLocation();
+      *bytes += dex_file->Size();
+      delete dex_file;
+    }
+  }
+}
+
+void ClassLinker::CloseDexFile(const DexFile* dex_file) {
+  {
+    WriterMutexLock mu(Thread::Current(), dex_lock_);
+    if (IsDexFileRegisteredLocked(*dex_file)) {
+      closed_dex_files_.insert(dex_file);
+      return;
+    }
+  }
+  delete dex_file;
+}
+
 void ClassLinker::VisitClasses(ClassVisitor* visitor, void* arg) {
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
+  if (image_class_table_ != NULL) {
+    for (int32_t i = 0; i < image_class_table_->GetLength(); ++i) {
+      mirror::Class* klass = image_class_table_->GetWithoutChecks(i);
+      if (klass != NULL && !visitor(klass, arg)) {
+        return;
+      }
+    }
   }
-  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-    if (!visitor(it.second, arg)) {
+  Thread* self = Thread::Current();
+  ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  for (ClassTableShard& shard : class_table_shards_) {
+    ReaderMutexLock shard_mu(self, shard.lock);
+    bool keep_going = shard.classes.VisitUntil([visitor, arg](mirror::Class* klass) {
+      return visitor(klass, arg);
+    });
+    if (!keep_going) {
       return;
     }
   }
@@ -1156,6 +1342,7 @@ void ClassLinker::VisitClassesWithoutClassesLock(ClassVisitor* visitor, void* ar
 
 
 ClassLinker::~ClassLinker() {
+  mirror::Class::ClearMemberIndexes();
   mirror::Class::ResetClass();
   mirror::String::ResetClass();
   mirror::ArtField::ResetClass();
@@ -1172,6 +1359,7 @@ ClassLinker::~ClassLinker() {
   mirror::StackTraceElement::ResetClass();
   STLDeleteElements(&boot_class_path_);
   STLDeleteElements(&oat_files_);
+  STLDeleteElements(&closed_dex_files_);
 }
 
 mirror::DexCache* ClassLinker::AllocDexCache(Thread* self, const DexFile& dex_file) {
@@ -1203,8 +1391,14 @@ mirror::DexCache* ClassLinker::AllocDexCache(Thread* self, const DexFile& dex_fi
   if (methods.get() == NULL) {
     return NULL;
   }
+  // Images and oat files are compiled against full arrays, only cap the fields of an app.
+  size_t num_field_slots = dex_file.NumFieldIds();
+  size_t max_field_slots = Runtime::Current()->GetDexCacheFieldSlots();
+  if (max_field_slots != 0 && !Runtime::Current()->IsCompiler()) {
+    num_field_slots = std::min(num_field_slots, max_field_slots);
+  }
   SirtRef<mirror::ObjectArray<mirror::ArtField> >
-      fields(self, AllocArtFieldArray(self, dex_file.NumFieldIds()));
+      fields(self, AllocArtFieldArray(self, num_field_slots));
   if (fields.get() == NULL) {
     return NULL;
   }
@@ -1410,6 +1604,9 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
     CHECK(self->IsExceptionPending());  // Expect an OOME.
     return NULL;
   }
+  // The GC unloads the dex caches which no class reaches, such as one registered by the caller
+  // before the class was allocated.
+  RegisterDexFile(dex_file);
   klass->SetDexCache(FindDexCache(dex_file));
   LoadClass(dex_file, dex_class_def, klass, class_loader);
   // Check for a pending exception during load
@@ -1715,6 +1912,27 @@ static void LinkCode(SirtRef<mirror::ArtMethod>& method, const OatFile::OatClass
                                                    method->GetEntryPointFromCompiledCode());
 }
 
+// Allocates on the tenured path of the heap for the lifetime of the object. Class loading comes
+// in bursts which allocate thousands of ArtField and ArtMethod objects, which otherwise the next
+// sticky collections would trace before finding them all live.
+class ScopedTenuredAllocation {
+ public:
+  explicit ScopedTenuredAllocation(Thread* self)
+      : self_(self), was_allocating_tenured_(self->IsAllocatingTenured()) {
+    self_->SetAllocatingTenured(true);
+  }
+
+  ~ScopedTenuredAllocation() {
+    self_->SetAllocatingTenured(was_allocating_tenured_);
+  }
+
+ private:
+  Thread* const self_;
+  const bool was_allocating_tenured_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTenuredAllocation);
+};
+
 void ClassLinker::LoadClass(const DexFile& dex_file,
                             const DexFile::ClassDef& dex_class_def,
                             SirtRef<mirror::Class>& klass,
@@ -1744,6 +1962,8 @@ void ClassLinker::LoadClass(const DexFile& dex_file,
   }
   ClassDataItemIterator it(dex_file, class_data);
   Thread* self = Thread::Current();
+  // The fields and methods live as long as their class, see ScopedTenuredAllocation.
+  ScopedTenuredAllocation tenured_allocation(self);
   if (it.NumStaticFields() != 0) {
     mirror::ObjectArray<mirror::ArtField>* statics = AllocArtFieldArray(self, it.NumStaticFields());
     if (UNLIKELY(statics == NULL)) {
@@ -1958,6 +2178,7 @@ void ClassLinker::RegisterDexFile(const DexFile& dex_file) {
   // get to a suspend point.
   SirtRef<mirror::DexCache> dex_cache(self, AllocDexCache(self, dex_file));
   CHECK(dex_cache.get() != NULL) << "Failed to allocate dex cache for " << dex_file.GetLocation();
+  PrepopulateDexCache(dex_file, dex_cache.get());
   {
     WriterMutexLock mu(self, dex_lock_);
     if (IsDexFileRegisteredLocked(dex_file)) {
@@ -1967,6 +2188,45 @@ void ClassLinker::RegisterDexFile(const DexFile& dex_file) {
   }
 }
 
+void ClassLinker::PrepopulateDexCache(const DexFile& dex_file, mirror::DexCache* dex_cache) {
+  const gc::space::ImageSpace* image_space = Runtime::Current()->GetHeap()->GetImageSpace();
+  const OatFile* oat_file = FindOpenedOatFileForDexFile(dex_file);
+  if (image_space == NULL || oat_file == NULL) {
+    return;
+  }
+  // The entries hold addresses within the boot image, boot oat files have none and the image
+  // checksum of app oat files no longer matches if the image was recompiled or relocated.
+  const OatHeader& oat_header = oat_file->GetOatHeader();
+  if (oat_header.GetImageFileLocationOatChecksum() != image_space->GetImageHeader().GetOatChecksum()
+      || oat_header.GetImageFileLocationOatDataBegin() !=
+          image_space->GetImageFileLocationOatDataBegin()) {
+    return;
+  }
+  uint32_t dex_location_checksum = dex_file.GetLocationChecksum();
+  const OatFile::OatDexFile* oat_dex_file = oat_file->GetOatDexFile(dex_file.GetLocation(),
+                                                                    &dex_location_checksum);
+  CHECK(oat_dex_file != NULL) << dex_file.GetLocation();
+  const uint32_t* entries;
+  uint32_t num_strings = oat_dex_file->GetDexCacheEntries(kOatDexCacheStrings, &entries);
+  for (uint32_t i = 0; i < num_strings; ++i) {
+    dex_cache->SetResolvedString(entries[2 * i],
+                                 reinterpret_cast<mirror::String*>(entries[2 * i + 1]));
+  }
+  uint32_t num_types = oat_dex_file->GetDexCacheEntries(kOatDexCacheTypes, &entries);
+  for (uint32_t i = 0; i < num_types; ++i) {
+    dex_cache->SetResolvedType(entries[2 * i],
+                               reinterpret_cast<mirror::Class*>(entries[2 * i + 1]));
+  }
+  uint32_t num_methods = oat_dex_file->GetDexCacheEntries(kOatDexCacheMethods, &entries);
+  for (uint32_t i = 0; i < num_methods; ++i) {
+    dex_cache->SetResolvedMethod(entries[2 * i],
+                                 reinterpret_cast<mirror::ArtMethod*>(entries[2 * i + 1]));
+  }
+  VLOG(class_linker) << "Prepopulated dex cache of " << dex_file.GetLocation() << " with "
+                     << num_strings << " strings, " << num_types << " types and "
+                     << num_methods << " methods";
+}
+
 void ClassLinker::RegisterDexFile(const DexFile& dex_file, SirtRef<mirror::DexCache>& dex_cache) {
   WriterMutexLock mu(Thread::Current(), dex_lock_);
   RegisterDexFileLocked(dex_file, dex_cache);
@@ -2201,198 +2461,168 @@ mirror::Class* ClassLinker::InsertClass(const char* descriptor, mirror::Class* k
     }
     LOG(INFO) << "Loaded class " << descriptor << source;
   }
-  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  Thread* self = Thread::Current();
+  ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  ClassTableShard& shard = GetClassTableShard(hash);
+  WriterMutexLock shard_mu(self, shard.lock);
   mirror::Class* existing =
       LookupClassFromTableLocked(descriptor, klass->GetClassLoader(), hash);
   if (existing != NULL) {
     return existing;
   }
-  if (kIsDebugBuild && klass->GetClassLoader() == NULL && dex_cache_image_class_lookup_required_) {
-    // Check a class loaded with the system class loader matches one in the image if the class
-    // is in the image.
-    existing = LookupClassFromImage(descriptor);
-    if (existing != NULL) {
-      CHECK(klass == existing);
-    }
+  if (kIsDebugBuild && klass->GetClassLoader() == NULL) {
+    // Image classes are found by LookupClass and never inserted.
+    CHECK(LookupClassFromImage(descriptor, hash) == NULL) << descriptor;
   }
   Runtime::Current()->GetHeap()->VerifyObject(klass);
-  class_table_.insert(std::make_pair(hash, klass));
-  class_table_dirty_ = true;
+  shard.classes.Insert(klass, hash);
+  shard.new_classes.push_back(klass);
+  Metrics* metrics = Runtime::Current()->GetMetrics();
+  if (metrics != NULL) {
+    metrics->Add(Metrics::kClassesLoaded, 1);
+  }
   return NULL;
 }
 
 bool ClassLinker::RemoveClass(const char* descriptor, const mirror::ClassLoader* class_loader) {
   size_t hash = Hash(descriptor);
-  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  ClassHelper kh;
-  for (auto it = class_table_.lower_bound(hash), end = class_table_.end(); it != end && it->first == hash;
-       ++it) {
-    mirror::Class* klass = it->second;
-    kh.ChangeClass(klass);
-    if (strcmp(kh.GetDescriptor(), descriptor) == 0 && klass->GetClassLoader() == class_loader) {
-      class_table_.erase(it);
-      return true;
-    }
+  Thread* self = Thread::Current();
+  ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  ClassTableShard& shard = GetClassTableShard(hash);
+  WriterMutexLock shard_mu(self, shard.lock);
+  mirror::Class* klass = LookupClassFromTableLocked(descriptor, class_loader, hash);
+  if (klass == NULL) {
+    return false;
   }
-  return false;
+  auto it = std::find(shard.new_classes.begin(), shard.new_classes.end(), klass);
+  if (it != shard.new_classes.end()) {
+    shard.new_classes.erase(it);
+  }
+  return shard.classes.Erase(klass, hash);
 }
 
 mirror::Class* ClassLinker::LookupClass(const char* descriptor,
                                         const mirror::ClassLoader* class_loader) {
   size_t hash = Hash(descriptor);
-  {
-    ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-    mirror::Class* result = LookupClassFromTableLocked(descriptor, class_loader, hash);
+  if (class_loader == NULL) {
+    // The image table is immutable, look there first and without the lock.
+    mirror::Class* result = LookupClassFromImage(descriptor, hash);
     if (result != NULL) {
       return result;
     }
   }
-  if (class_loader != NULL || !dex_cache_image_class_lookup_required_) {
-    return NULL;
-  } else {
-    // Lookup failed but need to search dex_caches_.
-    mirror::Class* result = LookupClassFromImage(descriptor);
-    if (result != NULL) {
-      InsertClass(descriptor, result, hash);
-    } else {
-      // Searching the image dex files/caches failed, we don't want to get into this situation
-      // often as map searches are faster, so after kMaxFailedDexCacheLookups move all image
-      // classes into the class table.
-      const int32_t kMaxFailedDexCacheLookups = 1000;
-      if (++failed_dex_cache_class_lookups_ > kMaxFailedDexCacheLookups) {
-        MoveImageClassesToClassTable();
-      }
-    }
-    return result;
-  }
+  Thread* self = Thread::Current();
+  ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  ReaderMutexLock shard_mu(self, GetClassTableShard(hash).lock);
+  return LookupClassFromTableLocked(descriptor, class_loader, hash);
 }
 
 mirror::Class* ClassLinker::LookupClassFromTableLocked(const char* descriptor,
                                                        const mirror::ClassLoader* class_loader,
                                                        size_t hash) {
   ClassHelper kh(NULL, this);
-  auto end = class_table_.end();
-  for (auto it = class_table_.lower_bound(hash); it != end && it->first == hash; ++it) {
-    mirror::Class* klass = it->second;
+  auto matches = [descriptor, class_loader, &kh](mirror::Class* klass)
+      NO_THREAD_SAFETY_ANALYSIS {
+    if (klass->GetClassLoader() != class_loader) {
+      return false;
+    }
     kh.ChangeClass(klass);
-    if (klass->GetClassLoader() == class_loader && strcmp(descriptor, kh.GetDescriptor()) == 0) {
-      if (kIsDebugBuild) {
-        // Check for duplicates in the table.
-        for (++it; it != end && it->first == hash; ++it) {
-          mirror::Class* klass2 = it->second;
-          kh.ChangeClass(klass2);
-          CHECK(!(strcmp(descriptor, kh.GetDescriptor()) == 0 && klass2->GetClassLoader() == class_loader))
+    return strcmp(descriptor, kh.GetDescriptor()) == 0;
+  };
+  const Table& table = GetClassTableShard(hash).classes;
+  mirror::Class* klass = table.Find(hash, matches);
+  if (kIsDebugBuild && klass != NULL) {
+    // Check for duplicates in the table.
+    table.FindAll(hash, matches, [klass](mirror::Class* klass2)
+        NO_THREAD_SAFETY_ANALYSIS {
+      CHECK(klass2 == klass)
           << PrettyClass(klass) << " " << klass << " " << klass->GetClassLoader() << " "
           << PrettyClass(klass2) << " " << klass2 << " " << klass2->GetClassLoader();
-        }
-      }
-      return klass;
-    }
+    });
   }
-  return NULL;
-}
-
-static mirror::ObjectArray<mirror::DexCache>* GetImageDexCaches()
-    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  gc::space::ImageSpace* image = Runtime::Current()->GetHeap()->GetImageSpace();
-  CHECK(image != NULL);
-  mirror::Object* root = image->GetImageHeader().GetImageRoot(ImageHeader::kDexCaches);
-  return root->AsObjectArray<mirror::DexCache>();
+  return klass;
 }
 
-void ClassLinker::MoveImageClassesToClassTable() {
-  Thread* self = Thread::Current();
-  WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
-  if (!dex_cache_image_class_lookup_required_) {
-    return;  // All dex cache classes are already in the class table.
+mirror::Class* ClassLinker::LookupClassFromImage(const char* descriptor, size_t hash) {
+  if (image_class_table_ == NULL) {
+    return NULL;
   }
-  const char* old_no_suspend_cause =
-      self->StartAssertNoThreadSuspension("Moving image classes to class table");
-  mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches();
+  const uint32_t hash32 = static_cast<uint32_t>(hash);
+  const uint32_t mask = image_class_table_->GetLength() - 1;
+  const int32_t* hashes = image_class_table_hashes_->GetData();
   ClassHelper kh(NULL, this);
-  for (int32_t i = 0; i < dex_caches->GetLength(); i++) {
-    mirror::DexCache* dex_cache = dex_caches->Get(i);
-    mirror::ObjectArray<mirror::Class>* types = dex_cache->GetResolvedTypes();
-    for (int32_t j = 0; j < types->GetLength(); j++) {
-      mirror::Class* klass = types->Get(j);
-      if (klass != NULL) {
-        kh.ChangeClass(klass);
-        DCHECK(klass->GetClassLoader() == NULL);
-        const char* descriptor = kh.GetDescriptor();
-        size_t hash = Hash(descriptor);
-        mirror::Class* existing = LookupClassFromTableLocked(descriptor, NULL, hash);
-        if (existing != NULL) {
-          CHECK(existing == klass) << PrettyClassAndClassLoader(existing) << " != "
-              << PrettyClassAndClassLoader(klass);
-        } else {
-          class_table_.insert(std::make_pair(hash, klass));
-        }
+  // The table is never full, so an empty slot ends every probe sequence.
+  for (uint32_t i = hash32 & mask; ; i = (i + 1) & mask) {
+    mirror::Class* klass = image_class_table_->GetWithoutChecks(i);
+    if (klass == NULL) {
+      return NULL;
+    }
+    if (static_cast<uint32_t>(hashes[i]) == hash32) {
+      kh.ChangeClass(klass);
+      if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
+        return klass;
       }
     }
   }
-  class_table_dirty_ = true;
-  dex_cache_image_class_lookup_required_ = false;
-  self->EndAssertNoThreadSuspension(old_no_suspend_cause);
 }
 
-mirror::Class* ClassLinker::LookupClassFromImage(const char* descriptor) {
-  Thread* self = Thread::Current();
-  const char* old_no_suspend_cause =
-      self->StartAssertNoThreadSuspension("Image class lookup");
-  mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches();
-  for (int32_t i = 0; i < dex_caches->GetLength(); ++i) {
-    mirror::DexCache* dex_cache = dex_caches->Get(i);
-    const DexFile* dex_file = dex_cache->GetDexFile();
-    // First search using the class def map, but don't bother for non-class types.
-    if (descriptor[0] == 'L') {
-      const DexFile::StringId* descriptor_string_id = dex_file->FindStringId(descriptor);
-      if (descriptor_string_id != NULL) {
-        const DexFile::TypeId* type_id =
-            dex_file->FindTypeId(dex_file->GetIndexForStringId(*descriptor_string_id));
-        if (type_id != NULL) {
-          mirror::Class* klass = dex_cache->GetResolvedType(dex_file->GetIndexForTypeId(*type_id));
-          if (klass != NULL) {
-            self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-            return klass;
-          }
-        }
-      }
-    }
-    // Now try binary searching the string/type index.
-    const DexFile::StringId* string_id = dex_file->FindStringId(descriptor);
-    if (string_id != NULL) {
-      const DexFile::TypeId* type_id =
-          dex_file->FindTypeId(dex_file->GetIndexForStringId(*string_id));
-      if (type_id != NULL) {
-        uint16_t type_idx = dex_file->GetIndexForTypeId(*type_id);
-        mirror::Class* klass = dex_cache->GetResolvedType(type_idx);
-        if (klass != NULL) {
-          self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-          return klass;
-        }
-      }
+mirror::ObjectArray<mirror::Class>* ClassLinker::CreateImageClassTable(Thread* self,
+                                                                     mirror::IntArray** hashes) {
+  std::vector<mirror::Class*> classes;
+  {
+    ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+    for (ClassTableShard& shard : class_table_shards_) {
+      ReaderMutexLock shard_mu(self, shard.lock);
+      shard.classes.VisitAll([&classes](mirror::Class* klass) {
+        classes.push_back(klass);
+      });
+    }
+  }
+  // Keep the load factor at or below 1/2 so that probe sequences stay short.
+  size_t num_buckets = Table::kMinBuckets;
+  while (num_buckets < classes.size() * 2) {
+    num_buckets *= 2;
+  }
+  SirtRef<mirror::ObjectArray<mirror::Class> > table(self, AllocClassArray(self, num_buckets));
+  CHECK(table.get() != NULL);
+  SirtRef<mirror::IntArray> table_hashes(self, mirror::IntArray::Alloc(self, num_buckets));
+  CHECK(table_hashes.get() != NULL);
+  const uint32_t mask = num_buckets - 1;
+  ClassHelper kh(NULL, this);
+  for (mirror::Class* klass : classes) {
+    CHECK(klass->GetClassLoader() == NULL) << PrettyClassAndClassLoader(klass);
+    kh.ChangeClass(klass);
+    const uint32_t hash = static_cast<uint32_t>(Hash(kh.GetDescriptor()));
+    uint32_t i = hash & mask;
+    while (table->GetWithoutChecks(i) != NULL) {
+      i = (i + 1) & mask;
     }
+    table->Set(i, klass);
+    table_hashes->Set(i, static_cast<int32_t>(hash));
   }
-  self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-  return NULL;
+  *hashes = table_hashes.get();
+  return table.get();
 }
 
 void ClassLinker::LookupClasses(const char* descriptor, std::vector<mirror::Class*>& result) {
   result.clear();
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
-  }
   size_t hash = Hash(descriptor);
-  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  mirror::Class* image_class = LookupClassFromImage(descriptor, hash);
+  if (image_class != NULL) {
+    result.push_back(image_class);
+  }
+  Thread* self = Thread::Current();
+  ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  ClassTableShard& shard = GetClassTableShard(hash);
+  ReaderMutexLock shard_mu(self, shard.lock);
   ClassHelper kh(NULL, this);
-  for (auto it = class_table_.lower_bound(hash), end = class_table_.end();
-      it != end && it->first == hash; ++it) {
-    mirror::Class* klass = it->second;
+  shard.classes.FindAll(hash, [descriptor, &kh](mirror::Class* klass)
+      NO_THREAD_SAFETY_ANALYSIS {
     kh.ChangeClass(klass);
-    if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
-      result.push_back(klass);
-    }
-  }
+    return strcmp(descriptor, kh.GetDescriptor()) == 0;
+  }, [&result](mirror::Class* klass) {
+    result.push_back(klass);
+  });
 }
 
 void ClassLinker::VerifyClass(mirror::Class* klass) {
@@ -2465,9 +2695,15 @@ void ClassLinker::VerifyClass(mirror::Class* klass) {
   verifier::MethodVerifier::FailureKind verifier_failure = verifier::MethodVerifier::kNoFailure;
   std::string error_msg;
   if (!preverified) {
-    verifier_failure = verifier::MethodVerifier::VerifyClass(klass,
-                                                             Runtime::Current()->IsCompiler(),
-                                                             &error_msg);
+    if (oat_file_class_status == mirror::Class::kStatusRetryVerificationAtRuntime &&
+        VerificationDependenciesHold(dex_file, klass)) {
+      verifier_failure = verifier::MethodVerifier::kSoftFailure;
+      error_msg = "the classes it failed to resolve at compile time still don't resolve";
+    } else {
+      verifier_failure = verifier::MethodVerifier::VerifyClass(klass,
+                                                               Runtime::Current()->IsCompiler(),
+                                                               &error_msg);
+    }
   }
   if (preverified || verifier_failure != verifier::MethodVerifier::kHardFailure) {
     if (!preverified && verifier_failure != verifier::MethodVerifier::kNoFailure) {
@@ -2519,6 +2755,81 @@ void ClassLinker::VerifyClass(mirror::Class* klass) {
   }
 }
 
+// Verification can load more classes, keep it off the threads that define them.
+static const size_t kVerificationThreads = 1;
+
+class VerifyClassTask : public Task {
+ public:
+  // Class unloading is blocked while the task is pending, so the pointer stays valid until it
+  // runs.
+  explicit VerifyClassTask(mirror::Class* klass) : klass_(klass) {
+    Runtime::Current()->GetClassLinker()->BlockClassUnloading();
+  }
+
+  virtual void Run(Thread* self) {
+    ScopedObjectAccess soa(self);
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    if (!klass_->IsVerified() && !klass_->IsErroneous()) {
+      class_linker->VerifyClass(klass_);
+    }
+    // A rejected class records its error and rethrows it for the thread that initializes it.
+    if (self->IsExceptionPending()) {
+      self->ClearException();
+    }
+  }
+
+  virtual void Finalize() {
+    Runtime::Current()->GetClassLinker()->UnblockClassUnloading();
+    delete this;
+  }
+
+ private:
+  mirror::Class* const klass_;
+};
+
+void ClassLinker::CreateVerificationThreadPool() {
+  CHECK(verification_thread_pool_.get() == NULL);
+  Thread* self = Thread::Current();
+  verification_thread_pool_.reset(new ThreadPool(kVerificationThreads));
+  Runtime::Current()->SetUpThreadScheduling(verification_thread_pool_.get(),
+                                            Runtime::kCompilerThreads);
+  verification_thread_pool_->StartWorkers(self);
+}
+
+void ClassLinker::DeleteVerificationThreadPool() {
+  if (verification_thread_pool_.get() != NULL) {
+    verification_thread_pool_->StopWorkers(Thread::Current());
+    verification_thread_pool_.reset(NULL);
+  }
+}
+
+void ClassLinker::VerifyClassInBackground(Thread* self, mirror::Class* klass) {
+  if (verification_thread_pool_.get() == NULL || klass->IsVerified() || klass->IsErroneous()) {
+    return;
+  }
+  verification_thread_pool_->AddTask(self, new VerifyClassTask(klass));
+}
+
+bool ClassLinker::VerificationDependenciesHold(const DexFile& dex_file, mirror::Class* klass) {
+  UniquePtr<const OatFile::OatClass> oat_class(GetOatClass(dex_file,
+                                                           klass->GetDexClassDefIndex()));
+  std::vector<uint16_t> type_indices;
+  if (!oat_class->GetVerificationDependencies(&type_indices)) {
+    return false;
+  }
+  Thread* self = Thread::Current();
+  for (size_t i = 0; i < type_indices.size(); ++i) {
+    if (ResolveType(dex_file, type_indices[i], klass) != NULL) {
+      VLOG(class_linker) << "Verifying " << PrettyDescriptor(klass) << " again as "
+          << dex_file.StringByTypeIdx(type_indices[i]) << " now resolves";
+      return false;
+    }
+    DCHECK(self->IsExceptionPending());
+    self->ClearException();
+  }
+  return true;
+}
+
 bool ClassLinker::VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class* klass,
                                           mirror::Class::Status& oat_file_class_status) {
   // If we're compiling, we can only verify the class using the oat file if
@@ -3002,6 +3313,20 @@ bool ClassLinker::InitializeClass(mirror::Class* klass, bool can_init_statics,
 
     CHECK_EQ(klass->GetStatus(), mirror::Class::kStatusVerified) << PrettyClass(klass);
 
+    Transaction* transaction = self->GetTransaction();
+    if (transaction != NULL) {
+      // A rollback leaves the class verified with its static fields at their defaults, as if no
+      // thread had started initializing it or found it erroneous.
+      transaction->RecordWrite(klass, mirror::Class::StatusOffset(), sizeof(uint32_t), false);
+      transaction->RecordWrite(klass, mirror::Class::ClinitThreadIdOffset(), sizeof(pid_t),
+                               false);
+      transaction->RecordWrite(klass, mirror::Class::VerifyErrorClassOffset(),
+                               sizeof(mirror::Class*), true);
+      for (size_t i = 0; i < klass->NumStaticFields(); ++i) {
+        transaction->RecordFieldWrite(klass, klass->GetStaticField(i));
+      }
+    }
+
     // From here out other threads may observe that we're initializing and so changes of state
     // require the a notification.
     klass->SetClinitThreadId(self->GetTid());
@@ -3065,6 +3390,11 @@ bool ClassLinker::InitializeClass(mirror::Class* klass, bool can_init_statics,
   // Opportunistically set static method trampolines to their destination.
   FixupStaticTrampolines(klass);
 
+  // Link the native methods in one batch, including those of the libraries loaded by <clinit>.
+  if (!self->IsExceptionPending() && Runtime::Current()->GetJavaVM() != NULL) {
+    Runtime::Current()->GetJavaVM()->LinkNativeMethods(self, klass);
+  }
+
   uint64_t t1 = NanoTime();
 
   bool success = true;
@@ -3095,10 +3425,18 @@ bool ClassLinker::InitializeClass(mirror::Class* klass, bool can_init_statics,
 
 bool ClassLinker::WaitForInitializeClass(mirror::Class* klass, Thread* self, ObjectLock& lock)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  RuntimeStats* global_stats = Runtime::Current()->GetStats();
+  RuntimeStats* thread_stats = self->GetStats();
+  ++global_stats->class_init_wait_count;
+  ++thread_stats->class_init_wait_count;
   while (true) {
     self->AssertNoPendingException();
     CHECK(!klass->IsInitialized());
+    uint64_t wait_start = NanoTime();
     lock.WaitIgnoringInterrupts();
+    uint64_t wait_time = NanoTime() - wait_start;
+    global_stats->class_init_wait_time_ns += wait_time;
+    thread_stats->class_init_wait_time_ns += wait_time;
 
     // When we wake up, repeat the test for init-in-progress.  If
     // there's an exception pending (only possible if
@@ -3393,6 +3731,38 @@ bool ClassLinker::LinkMethods(SirtRef<mirror::Class>& klass,
   return true;
 }
 
+// The slots of a vtable sorted by the hash of the names of their methods, so that finding the
+// slots of a method's name and signature only compares it against the methods whose name has the
+// same hash, rather than against every method of the vtable.
+class VTableNameIndex {
+ public:
+  typedef std::vector<std::pair<size_t, size_t> >::const_iterator Iterator;
+
+  VTableNameIndex(mirror::ObjectArray<mirror::ArtMethod>* vtable, size_t length,
+                  MethodHelper* mh) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    entries_.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+      mh->ChangeMethod(vtable->Get(i));
+      entries_.push_back(std::make_pair(Hash(mh->GetName()), i));
+    }
+    std::sort(entries_.begin(), entries_.end());
+  }
+
+  // The entries of the slots whose method name hashes to name_hash, by increasing slot.
+  std::pair<Iterator, Iterator> Find(size_t name_hash) const {
+    return std::make_pair(
+        std::lower_bound(entries_.begin(), entries_.end(), std::make_pair(name_hash, size_t(0))),
+        std::upper_bound(entries_.begin(), entries_.end(),
+                         std::make_pair(name_hash, std::numeric_limits<size_t>::max())));
+  }
+
+ private:
+  // Pairs of name hash and slot.
+  std::vector<std::pair<size_t, size_t> > entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(VTableNameIndex);
+};
+
 bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
   Thread* self = Thread::Current();
   if (klass->HasSuperClass()) {
@@ -3409,11 +3779,16 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
     // See if any of our virtual methods override the superclass.
     MethodHelper local_mh(NULL, this);
     MethodHelper super_mh(NULL, this);
+    // Only the superclass' slots need looking up, the class' own methods have distinct signatures.
+    VTableNameIndex super_index(vtable.get(), actual_count, &super_mh);
     for (size_t i = 0; i < klass->NumVirtualMethods(); ++i) {
       mirror::ArtMethod* local_method = klass->GetVirtualMethodDuringLinking(i);
       local_mh.ChangeMethod(local_method);
-      size_t j = 0;
-      for (; j < actual_count; ++j) {
+      std::pair<VTableNameIndex::Iterator, VTableNameIndex::Iterator> candidates =
+          super_index.Find(Hash(local_mh.GetName()));
+      bool overrides = false;
+      for (VTableNameIndex::Iterator it = candidates.first; it != candidates.second; ++it) {
+        size_t j = it->second;
         mirror::ArtMethod* super_method = vtable->Get(j);
         super_mh.ChangeMethod(super_method);
         if (local_mh.HasSameNameAndSignature(&super_mh)) {
@@ -3424,8 +3799,12 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
                                 super_mh.GetDeclaringClassDescriptor());
               return false;
             }
+            if (!super_method->IsOverridden()) {  // Avoids dirtying image pages.
+              super_method->SetOverridden();
+            }
             vtable->Set(j, local_method);
             local_method->SetMethodIndex(j);
+            overrides = true;
             break;
           } else {
             LOG(WARNING) << "Before Android 4.1, method " << PrettyMethod(local_method)
@@ -3434,7 +3813,7 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
           }
         }
       }
-      if (j == actual_count) {
+      if (!overrides) {
         // Not overriding, append.
         vtable->Set(actual_count, local_method);
         local_method->SetMethodIndex(actual_count);
@@ -3590,6 +3969,8 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
   std::vector<mirror::ArtMethod*> miranda_list;
   MethodHelper vtable_mh(NULL, this);
   MethodHelper interface_mh(NULL, this);
+  mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTableDuringLinking();
+  VTableNameIndex vtable_index(vtable, vtable->GetLength(), &vtable_mh);
   for (size_t i = 0; i < ifcount; ++i) {
     mirror::Class* interface = iftable->GetInterface(i);
     size_t num_methods = interface->NumVirtualMethods();
@@ -3601,11 +3982,12 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
         return false;
       }
       iftable->SetMethodArray(i, method_array);
-      mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTableDuringLinking();
       for (size_t j = 0; j < num_methods; ++j) {
         mirror::ArtMethod* interface_method = interface->GetVirtualMethod(j);
         interface_mh.ChangeMethod(interface_method);
-        int32_t k;
+        std::pair<VTableNameIndex::Iterator, VTableNameIndex::Iterator> candidates =
+            vtable_index.Find(Hash(interface_mh.GetName()));
+        bool found = false;
         // For each method listed in the interface's method list, find the
         // matching method in our class's method list.  We want to favor the
         // subclass over the superclass, which just requires walking
@@ -3614,8 +3996,9 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
         // it -- otherwise it would use the same vtable slot.  In .dex files
         // those don't end up in the virtual method table, so it shouldn't
         // matter which direction we go.  We walk it backward anyway.)
-        for (k = vtable->GetLength() - 1; k >= 0; --k) {
-          mirror::ArtMethod* vtable_method = vtable->Get(k);
+        for (VTableNameIndex::Iterator it = candidates.second; it != candidates.first; ) {
+          --it;
+          mirror::ArtMethod* vtable_method = vtable->Get(it->second);
           vtable_mh.ChangeMethod(vtable_method);
           if (interface_mh.HasSameNameAndSignature(&vtable_mh)) {
             if (!vtable_method->IsAbstract() && !vtable_method->IsPublic()) {
@@ -3626,10 +4009,11 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
               return false;
             }
             method_array->Set(j, vtable_method);
+            found = true;
             break;
           }
         }
-        if (k < 0) {
+        if (!found) {
           SirtRef<mirror::ArtMethod> miranda_method(self, NULL);
           for (size_t mir = 0; mir < miranda_list.size(); mir++) {
             mirror::ArtMethod* mir_method = miranda_list[mir];
@@ -3694,11 +4078,56 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
     klass->SetVTable(vtable.get());
   }
 
-  mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTableDuringLinking();
+  vtable = klass->GetVTableDuringLinking();
   for (int i = 0; i < vtable->GetLength(); ++i) {
     CHECK(vtable->Get(i) != NULL);
   }
 
+  return LinkImTable(self, klass, iftable);
+}
+
+// Fill in the interface method table so that most invoke-interface calls don't search the iftable.
+bool ClassLinker::LinkImTable(Thread* self, SirtRef<mirror::Class>& klass,
+                              SirtRef<mirror::IfTable>& iftable) {
+  const size_t ifcount = iftable->Count();
+  bool has_interface_methods = false;
+  for (size_t i = 0; i < ifcount; ++i) {
+    has_interface_methods |= iftable->GetMethodArrayCount(i) > 0;
+  }
+  if (!has_interface_methods) {
+    return true;
+  }
+  SirtRef<mirror::ObjectArray<mirror::ArtMethod> >
+      imt(self, AllocArtMethodArray(self, mirror::IfTable::kImtSize * 2));
+  if (UNLIKELY(imt.get() == NULL)) {
+    CHECK(self->IsExceptionPending());  // OOME.
+    return false;
+  }
+  for (size_t i = 0; i < ifcount; ++i) {
+    size_t num_methods = iftable->GetMethodArrayCount(i);
+    if (num_methods == 0) {
+      continue;
+    }
+    mirror::Class* interface = iftable->GetInterface(i);
+    mirror::ObjectArray<mirror::ArtMethod>* method_array = iftable->GetMethodArray(i);
+    for (size_t j = 0; j < num_methods; ++j) {
+      mirror::ArtMethod* interface_method = interface->GetVirtualMethod(j);
+      int32_t slot = (interface_method->GetDexMethodIndex() % mirror::IfTable::kImtSize) * 2;
+      if (imt->Get(slot) == NULL) {
+        imt->Set(slot, interface_method);
+        imt->Set(slot + 1, method_array->Get(j));
+      }
+    }
+  }
+  iftable.reset(down_cast<mirror::IfTable*>(
+      iftable->CopyOf(self, ifcount * mirror::IfTable::kMax + 1)));
+  if (UNLIKELY(iftable.get() == NULL)) {
+    CHECK(self->IsExceptionPending());  // OOME.
+    return false;
+  }
+  iftable->SetImTable(imt.get());
+  klass->SetIfTable(iftable.get());
+
 //  klass->DumpClass(std::cerr, Class::kDumpClassFullDetail);
 
   return true;
@@ -4224,39 +4653,163 @@ const char* ClassLinker::MethodShorty(uint32_t method_idx, mirror::ArtMethod* re
   return dex_file.GetMethodShorty(method_id, length);
 }
 
+static bool CollectClassesVisitor(mirror::Class* c, void* arg) {
+  reinterpret_cast<std::vector<mirror::Class*>*>(arg)->push_back(c);
+  return true;
+}
+
 void ClassLinker::DumpAllClasses(int flags) {
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
-  }
   // TODO: at the time this was written, it wasn't safe to call PrettyField with the ClassLinker
   // lock held, because it might need to resolve a field's type, which would try to take the lock.
   std::vector<mirror::Class*> all_classes;
-  {
-    ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-    for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-      all_classes.push_back(it.second);
-    }
-  }
+  VisitClasses(CollectClassesVisitor, &all_classes);
 
   for (size_t i = 0; i < all_classes.size(); ++i) {
     all_classes[i]->DumpClass(std::cerr, flags);
   }
 }
 
+// Appends the number of non-NULL elements on each page of array, including partial pages.
+template <typename T>
+static void CountResolvedPerPage(mirror::ObjectArray<T>* array, std::vector<uint32_t>* counts)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  uintptr_t data = reinterpret_cast<uintptr_t>(array->GetRawData(sizeof(mirror::Object*)));
+  uintptr_t first_page = data / kPageSize;
+  size_t begin = counts->size();
+  for (int32_t i = 0; i < array->GetLength(); ++i) {
+    size_t page = begin + (data + i * sizeof(mirror::Object*)) / kPageSize - first_page;
+    if (page == counts->size()) {
+      counts->push_back(0);
+    }
+    if (array->GetWithoutChecks(i) != NULL) {
+      ++(*counts)[page];
+    }
+  }
+}
+
+static void CountResolvedPerPage(const std::vector<const DexFile*>& boot_class_path,
+                                 const ClassLinker* class_linker, std::vector<uint32_t>* counts)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  counts->clear();
+  for (const DexFile* dex_file : boot_class_path) {
+    mirror::DexCache* dex_cache = class_linker->FindDexCache(*dex_file);
+    CountResolvedPerPage(dex_cache->GetStrings(), counts);
+    CountResolvedPerPage(dex_cache->GetResolvedTypes(), counts);
+    CountResolvedPerPage(dex_cache->GetResolvedMethods(), counts);
+    CountResolvedPerPage(dex_cache->GetResolvedFields(), counts);
+  }
+}
+
 void ClassLinker::DumpForSigQuit(std::ostream& os) {
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
+  os << "Loaded classes: " << num_image_classes_ << " image classes; "
+     << NumNonImageClasses() << " allocated classes\n";
+  RuntimeStats* stats = Runtime::Current()->GetStats();
+  os << "Class initialization: " << stats->class_init_count << " classes in "
+     << PrettyDuration(stats->class_init_time_ns) << "; " << stats->class_init_wait_count
+     << " waits for other threads in " << PrettyDuration(stats->class_init_wait_time_ns) << "\n";
+  if (!dex_cache_page_counts_.empty() && !Runtime::Current()->IsZygote()) {
+    std::vector<uint32_t> counts;
+    CountResolvedPerPage(boot_class_path_, this, &counts);
+    DCHECK_EQ(counts.size(), dex_cache_page_counts_.size());
+    size_t written_pages = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+      if (counts[i] != dex_cache_page_counts_[i]) {
+        ++written_pages;
+      }
+    }
+    os << "Boot dex caches: " << written_pages << " of " << counts.size()
+       << " pages of resolved entries written since the zygote fork ("
+       << PrettySize(written_pages * kPageSize) << " private dirty)\n";
   }
-  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  os << "Loaded classes: " << class_table_.size() << " allocated classes\n";
 }
 
-size_t ClassLinker::NumLoadedClasses() {
-  if (dex_cache_image_class_lookup_required_) {
-    MoveImageClassesToClassTable();
+void ClassLinker::RecordDexCachePages() {
+  CountResolvedPerPage(boot_class_path_, this, &dex_cache_page_counts_);
+}
+
+void ClassLinker::PreloadDexCaches() {
+  uint64_t start_time = NanoTime();
+  size_t num_types = 0;
+  size_t num_methods = 0;
+  size_t num_fields = 0;
+  for (const DexFile* dex_file : boot_class_path_) {
+    mirror::DexCache* dex_cache = FindDexCache(*dex_file);
+    for (size_t type_idx = 0; type_idx < dex_file->NumTypeIds(); ++type_idx) {
+      if (dex_cache->GetResolvedType(type_idx) != NULL) {
+        continue;
+      }
+      const char* descriptor = dex_file->StringByTypeIdx(type_idx);
+      mirror::Class* klass = LookupClass(descriptor, NULL);
+      if (klass != NULL && klass->IsResolved() && !klass->IsErroneous()) {
+        dex_cache->SetResolvedType(type_idx, klass);
+        ++num_types;
+      }
+    }
+    for (size_t method_idx = 0; method_idx < dex_file->NumMethodIds(); ++method_idx) {
+      if (dex_cache->GetResolvedMethod(method_idx) != NULL) {
+        continue;
+      }
+      const DexFile::MethodId& method_id = dex_file->GetMethodId(method_idx);
+      mirror::Class* klass = dex_cache->GetResolvedType(method_id.class_idx_);
+      if (klass == NULL) {
+        continue;
+      }
+      // What ResolveMethod finds for the invoke kinds the class allows.
+      mirror::ArtMethod* method;
+      if (klass->IsInterface()) {
+        method = klass->FindInterfaceMethod(dex_cache, method_idx);
+      } else {
+        method = klass->FindDirectMethod(dex_cache, method_idx);
+        if (method == NULL) {
+          method = klass->FindVirtualMethod(dex_cache, method_idx);
+        }
+      }
+      if (method != NULL) {
+        dex_cache->SetResolvedMethod(method_idx, method);
+        ++num_methods;
+      }
+    }
+    // Slots of hashed field arrays are shared by fields, preloading them would only churn them.
+    if (dex_cache->HasHashedResolvedFields()) {
+      continue;
+    }
+    for (size_t field_idx = 0; field_idx < dex_file->NumFieldIds(); ++field_idx) {
+      if (dex_cache->GetResolvedField(field_idx) != NULL) {
+        continue;
+      }
+      const DexFile::FieldId& field_id = dex_file->GetFieldId(field_idx);
+      mirror::Class* klass = dex_cache->GetResolvedType(field_id.class_idx_);
+      if (klass == NULL) {
+        continue;
+      }
+      mirror::ArtField* field = klass->FindInstanceField(dex_cache, field_idx);
+      if (field == NULL) {
+        field = klass->FindStaticField(dex_cache, field_idx);
+      }
+      if (field != NULL) {
+        dex_cache->SetResolvedField(field_idx, field);
+        ++num_fields;
+      }
+    }
+  }
+  VLOG(startup) << "Preloaded " << num_types << " types, " << num_methods << " methods and "
+                << num_fields << " fields in the boot dex caches in "
+                << PrettyDuration(NanoTime() - start_time);
+}
+
+size_t ClassLinker::NumNonImageClasses() {
+  Thread* self = Thread::Current();
+  ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+  size_t num_classes = 0;
+  for (ClassTableShard& shard : class_table_shards_) {
+    ReaderMutexLock shard_mu(self, shard.lock);
+    num_classes += shard.classes.Size();
   }
-  ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  return class_table_.size();
+  return num_classes;
+}
+
+size_t ClassLinker::NumLoadedClasses() {
+  return num_image_classes_ + NumNonImageClasses();
 }
 
 pid_t ClassLinker::GetClassesLockOwner() {
@@ -17,16 +17,20 @@
 #ifndef ART_RUNTIME_CLASS_LINKER_H_
 #define ART_RUNTIME_CLASS_LINKER_H_
 
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "atomic_integer.h"
+#include "base/hash_set.h"
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "dex_file.h"
 #include "gtest/gtest.h"
 #include "root_visitor.h"
 #include "oat_file.h"
+#include "UniquePtr.h"
 
 namespace art {
 namespace gc {
@@ -40,12 +44,15 @@ namespace mirror {
   class DexCacheTest_Open_Test;
   class IfTable;
   template<class T> class ObjectArray;
+  template<class T> class PrimitiveArray;
+  typedef PrimitiveArray<int32_t> IntArray;
   class StackTraceElement;
 }  // namespace mirror
 
 class InternTable;
 class ObjectLock;
 template<class T> class SirtRef;
+class ThreadPool;
 
 typedef bool (ClassVisitor)(mirror::Class* c, void* arg);
 
@@ -104,6 +111,21 @@ class ClassLinker {
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Resolves in the boot class path's dex caches the types, fields and methods that classes already
+  // loaded by the boot class loader provide, so that a zygote dirties those parts of the dex cache
+  // arrays once for all the processes it forks rather than each process dirtying private copies
+  // of the same pages as it resolves them. Nothing is loaded, initialized or allocated.
+  void PreloadDexCaches()
+      LOCKS_EXCLUDED(Locks::classlinker_classes_lock_, dex_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Counts the resolved entries on each page of the boot class path's dex cache arrays. Entries
+  // are only ever set, so DumpForSigQuit reports the pages with more since as the pages that a
+  // process forked from the zygote made private.
+  void RecordDexCachePages()
+      LOCKS_EXCLUDED(dex_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   size_t NumLoadedClasses()
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -218,6 +240,10 @@ class ClassLinker {
   void RegisterOatFile(const OatFile& oat_file)
       LOCKS_EXCLUDED(dex_lock_);
 
+  // Returns a snapshot of the registered oat files.
+  std::vector<const OatFile*> GetOatFiles()
+      LOCKS_EXCLUDED(dex_lock_);
+
   const std::vector<const DexFile*>& GetBootClassPath() {
     return boot_class_path_;
   }
@@ -231,9 +257,49 @@ class ClassLinker {
       LOCKS_EXCLUDED(dex_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  void VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, bool clean_dirty)
+  // Visits the roots, only the classes inserted since the class table was last cleaned if
+  // only_dirty. Image classes are never visited, see image_class_table_. A GC unloading classes
+  // passes unload_classes to leave out the classes of class loaders other than the boot class
+  // loader and the dex caches of the dex files outside of the boot class path: such a class is
+  // live while its class loader is, see MarkClassesOfMarkedLoaders, and such a dex cache while a
+  // class reaching it is.
+  void VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, bool clean_dirty,
+                  bool unload_classes)
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_, dex_lock_);
 
+  // Whether the GC may unload classes right now. Nothing else may keep classes or methods outside
+  // of the heap: not the JIT, the debugger, method tracing or the profilers, which all remember
+  // methods by address, nor the code blocking class unloading.
+  bool CanUnloadClasses() const;
+
+  // Keep the GC from unloading classes until the matching UnblockClassUnloading, for code
+  // holding classes or methods outside of the heap across suspend points.
+  void BlockClassUnloading() {
+    class_unloading_blockers_.fetch_add(1);
+  }
+  void UnblockClassUnloading() {
+    class_unloading_blockers_.fetch_sub(1);
+  }
+
+  // Passes the unmarked classes of marked class loaders to visitor, which marks them, and returns
+  // how many there were. The GC calls it until it returns 0, tracing from the classes in between.
+  size_t MarkClassesOfMarkedLoaders(IsMarkedTester is_marked, RootVisitor* visitor, void* arg)
+      LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, Locks::heap_bitmap_lock_);
+
+  // Removes the unmarked classes from the class table and the unmarked dex caches of the dex files
+  // outside of the boot class path from the registered ones, deleting the dex files which were
+  // closed. Adds the number of classes unloaded to *classes and the bytes of the classes, their
+  // members and the deleted dex files to *bytes. Called by the GC with the mutators suspended.
+  void SweepClasses(IsMarkedTester is_marked, void* arg, size_t* classes, size_t* bytes)
+      LOCKS_EXCLUDED(Locks::classlinker_classes_lock_, dex_lock_)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+
+  // Takes ownership of a dex file whose Java owner closed it. It is deleted right away if it isn't
+  // registered, else once the GC unloads its dex cache.
+  void CloseDexFile(const DexFile* dex_file) LOCKS_EXCLUDED(dex_lock_);
+
   mirror::DexCache* FindDexCache(const DexFile& dex_file) const
       LOCKS_EXCLUDED(dex_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -307,9 +373,21 @@ class ClassLinker {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void VerifyClass(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // With -Xbackground-verification classes defined by app class loaders are verified by a
+  // worker thread ahead of their initialization. The thread that initializes a class the worker
+  // is still verifying waits for it on the class lock instead of verifying it again.
+  void CreateVerificationThreadPool();
+  void DeleteVerificationThreadPool();
+  void VerifyClassInBackground(Thread* self, mirror::Class* klass)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool VerifyClassUsingOatFile(const DexFile& dex_file, mirror::Class* klass,
                                mirror::Class::Status& oat_file_class_status)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Returns true if the classes that didn't resolve when the class was verified at compile time
+  // still don't, in which case verifying it again would only find failures that throw at runtime.
+  bool VerificationDependenciesHold(const DexFile& dex_file, mirror::Class* klass)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void ResolveClassExceptionHandlerTypes(const DexFile& dex_file, mirror::Class* klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void ResolveMethodExceptionHandlerTypes(const DexFile& dex_file, mirror::ArtMethod* klass)
@@ -385,6 +463,11 @@ class ClassLinker {
   mirror::Class* AllocClass(Thread* self, size_t class_size) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::DexCache* AllocDexCache(Thread* self, const DexFile& dex_file)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Fills in the strings, types and methods that dex2oat resolved to boot image objects when
+  // dex_file comes from an oat file compiled against the mapped boot image.
+  void PrepopulateDexCache(const DexFile& dex_file, mirror::DexCache* dex_cache)
+      LOCKS_EXCLUDED(dex_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::ArtField* AllocArtField(Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   mirror::ArtMethod* AllocArtMethod(Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -434,6 +517,7 @@ class ClassLinker {
       EXCLUSIVE_LOCKS_REQUIRED(dex_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool IsDexFileRegisteredLocked(const DexFile& dex_file) const SHARED_LOCKS_REQUIRED(dex_lock_);
+  bool IsInBootClassPath(const DexFile* dex_file) const;
   void RegisterOatFileLocked(const OatFile& oat_file) EXCLUSIVE_LOCKS_REQUIRED(dex_lock_)
       EXCLUSIVE_LOCKS_REQUIRED(dex_lock_);
 
@@ -472,6 +556,8 @@ class ClassLinker {
   bool LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
                             mirror::ObjectArray<mirror::Class>* interfaces)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  bool LinkImTable(Thread* self, SirtRef<mirror::Class>& klass, SirtRef<mirror::IfTable>& iftable)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   bool LinkStaticFields(SirtRef<mirror::Class>& klass)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -494,6 +580,12 @@ class ClassLinker {
     return dex_caches_;
   }
 
+  // For use by ImageWriter, lay out the loaded classes as the image class table and store the
+  // descriptor hash of each slot in *hashes.
+  mirror::ObjectArray<mirror::Class>* CreateImageClassTable(Thread* self, mirror::IntArray** hashes)
+      LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   const OatFile* FindOpenedOatFileForDexFile(const DexFile& dex_file)
       LOCKS_EXCLUDED(dex_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -523,31 +615,56 @@ class ClassLinker {
 
   std::vector<const DexFile*> boot_class_path_;
 
+  // Resolved entries per page of the boot dex cache arrays as of the last RecordDexCachePages.
+  std::vector<uint32_t> dex_cache_page_counts_;
+
   mutable ReaderWriterMutex dex_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::vector<mirror::DexCache*> dex_caches_ GUARDED_BY(dex_lock_);
   std::vector<const OatFile*> oat_files_ GUARDED_BY(dex_lock_);
+  // Dex files closed while registered, deleted with their dex cache. Oat files stay open, as an
+  // app class loader created again opens the same ones.
+  std::set<const DexFile*> closed_dex_files_ GUARDED_BY(dex_lock_);
+
+
+  // Hash sets of the classes which aren't in the image, keyed by the string hash code of the class
+  // descriptor. Results should be compared for a matching Class::descriptor_ and
+  // Class::class_loader_. The classes are split into shards by the top bits of the hash so that
+  // only threads defining classes of the same shard contend. Lookups and inserts hold
+  // Locks::classlinker_classes_lock_ shared and then the lock of their shard, code that needs all
+  // of the shards unlocked holds classlinker_classes_lock_ exclusively instead.
+  typedef HashSet<mirror::Class*> Table;
+  static const size_t kClassTableShardBits = 4;
+  struct ClassTableShard {
+    ClassTableShard()
+        : lock("ClassLinker class table shard lock", kClassLinkerClassTableShardLock) {}
+
+    ReaderWriterMutex lock;
+    Table classes;
+    // The classes inserted since VisitRoots last cleaned the table.
+    std::vector<mirror::Class*> new_classes;
+  };
+  ClassTableShard class_table_shards_[1 << kClassTableShardBits];
 
+  ClassTableShard& GetClassTableShard(size_t hash) {
+    return class_table_shards_[static_cast<uint32_t>(hash) >> (32 - kClassTableShardBits)];
+  }
 
-  // multimap from a string hash code of a class descriptor to
-  // mirror::Class* instances. Results should be compared for a matching
-  // Class::descriptor_ and Class::class_loader_.
-  typedef std::multimap<size_t, mirror::Class*> Table;
-  Table class_table_ GUARDED_BY(Locks::classlinker_classes_lock_);
+  size_t NumNonImageClasses() LOCKS_EXCLUDED(Locks::classlinker_classes_lock_);
 
-  // Do we need to search dex caches to find image classes?
-  bool dex_cache_image_class_lookup_required_;
-  // Number of times we've searched dex caches for a class. After a certain number of misses we move
-  // the classes into the class_table_ to avoid dex cache based searches.
-  AtomicInteger failed_dex_cache_class_lookups_;
+  // The class table of the image, written by ImageWriter as an open addressing table of the image
+  // classes and their descriptor hashes which is probed like class_table_. Image objects never
+  // move so the table needs no lock and image classes are never inserted into class_table_. NULL
+  // when there is no image.
+  mirror::ObjectArray<mirror::Class>* image_class_table_;
+  mirror::IntArray* image_class_table_hashes_;
+  size_t num_image_classes_;
 
   mirror::Class* LookupClassFromTableLocked(const char* descriptor,
                                             const mirror::ClassLoader* class_loader,
                                             size_t hash)
       SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_, Locks::mutator_lock_);
 
-  void MoveImageClassesToClassTable() LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  mirror::Class* LookupClassFromImage(const char* descriptor)
+  mirror::Class* LookupClassFromImage(const char* descriptor, size_t hash)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // indexes into class_roots_.
@@ -614,13 +731,18 @@ class ClassLinker {
 
   bool init_done_;
   bool dex_caches_dirty_ GUARDED_BY(dex_lock_);
-  bool class_table_dirty_ GUARDED_BY(Locks::classlinker_classes_lock_);
 
   InternTable* intern_table_;
 
   const void* portable_resolution_trampoline_;
   const void* quick_resolution_trampoline_;
 
+  // NULL unless background verification is enabled.
+  UniquePtr<ThreadPool> verification_thread_pool_;
+
+  // See BlockClassUnloading.
+  AtomicInteger class_unloading_blockers_;
+
   friend class ImageWriter;  // for GetClassRoots
   FRIEND_TEST(ClassLinkerTest, ClassRootDescriptors);
   FRIEND_TEST(mirror::DexCacheTest, Open);
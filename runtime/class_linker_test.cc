@@ -223,6 +223,26 @@ class ClassLinkerTest : public CommonTest {
         EXPECT_EQ(interface->NumVirtualMethods(), iftable->GetMethodArrayCount(i));
       }
     }
+    const mirror::ObjectArray<mirror::ArtMethod>* imt = (iftable != NULL) ? iftable->GetImTable()
+                                                                          : NULL;
+    if (imt != NULL) {
+      EXPECT_FALSE(klass->IsInterface());
+      for (int i = 0; i < mirror::IfTable::kImtSize; i++) {
+        mirror::ArtMethod* interface_method = imt->Get(i * 2);
+        if (interface_method != NULL) {
+          EXPECT_EQ(i, static_cast<int>(interface_method->GetDexMethodIndex() %
+                                        mirror::IfTable::kImtSize));
+          mirror::Class* interface = interface_method->GetDeclaringClass();
+          mirror::ArtMethod* implementation = NULL;
+          for (int j = 0; j < klass->GetIfTableCount(); j++) {
+            if (iftable->GetInterface(j) == interface) {
+              implementation = iftable->GetMethodArray(j)->Get(interface_method->GetMethodIndex());
+            }
+          }
+          EXPECT_EQ(implementation, imt->Get(i * 2 + 1));
+        }
+      }
+    }
     if (klass->IsAbstract()) {
       EXPECT_FALSE(klass->IsFinal());
     } else {
@@ -269,8 +289,14 @@ class ClassLinkerTest : public CommonTest {
     // Confirm that all instances fields are packed together at the start
     EXPECT_GE(klass->NumInstanceFields(), klass->NumReferenceInstanceFields());
     FieldHelper fh;
+    // The GC scans the reference fields of classes without a reference offset bitmap as the run
+    // starting at the end of the superclass' fields.
+    mirror::Class* super_class = klass->GetSuperClass();
+    uint32_t reference_field_offset = super_class == NULL ? 0 : super_class->GetObjectSize();
     for (size_t i = 0; i < klass->NumReferenceInstanceFields(); i++) {
       mirror::ArtField* field = klass->GetInstanceField(i);
+      EXPECT_EQ(reference_field_offset + i * sizeof(mirror::Object*),
+                field->GetOffset().Uint32Value());
       fh.ChangeField(field);
       ASSERT_TRUE(!fh.IsPrimitiveType());
       mirror::Class* field_type = fh.GetType();
@@ -331,7 +357,7 @@ class ClassLinkerTest : public CommonTest {
       const char* descriptor = dex->GetTypeDescriptor(type_id);
       AssertDexFileClass(class_loader, descriptor);
     }
-    class_linker_->VisitRoots(TestRootVisitor, NULL, false, false);
+    class_linker_->VisitRoots(TestRootVisitor, NULL, false, false, false);
     // Verify the dex cache has resolution methods in all resolved method slots
     mirror::DexCache* dex_cache = class_linker_->FindDexCache(*dex);
     mirror::ObjectArray<mirror::ArtMethod>* resolved_methods = dex_cache->GetResolvedMethods();
@@ -981,6 +1007,27 @@ TEST_F(ClassLinkerTest, Interfaces) {
   EXPECT_EQ(Afoo, Kfoo);
 }
 
+TEST_F(ClassLinkerTest, OverriddenMethods) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* object = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  mirror::Class* string = class_linker_->FindSystemClass("Ljava/lang/String;");
+  mirror::ArtMethod* Object_toString = object->FindVirtualMethod("toString",
+                                                                 "()Ljava/lang/String;");
+  mirror::ArtMethod* String_toString = string->FindVirtualMethod("toString",
+                                                                 "()Ljava/lang/String;");
+  ASSERT_TRUE(Object_toString != NULL);
+  ASSERT_TRUE(String_toString != NULL);
+  EXPECT_TRUE(Object_toString->IsOverridden());
+  EXPECT_FALSE(String_toString->IsOverridden());
+
+  SirtRef<mirror::ClassLoader> class_loader(soa.Self(), soa.Decode<mirror::ClassLoader*>(LoadDex("Interfaces")));
+  mirror::Class* A = class_linker_->FindClass("LInterfaces$A;", class_loader.get());
+  ASSERT_TRUE(A != NULL);
+  mirror::ArtMethod* Ai = A->FindVirtualMethod("i", "()V");
+  ASSERT_TRUE(Ai != NULL);
+  EXPECT_FALSE(Ai->IsOverridden());
+}
+
 TEST_F(ClassLinkerTest, ResolveVerifyAndClinit) {
   // pretend we are trying to get the static storage for the StaticsFromCode class.
 
@@ -195,8 +195,8 @@ class CommonTest : public testing::Test {
                                                               method->GetDexMethodIndex()));
     }
     if (compiled_method != NULL) {
-      const std::vector<uint8_t>& code = compiled_method->GetCode();
-      MakeExecutable(code);
+      const SwapVector<uint8_t>& code = compiled_method->GetCode();
+      MakeExecutable(&code[0], code.size());
       const void* method_code = CompiledMethod::CodePointer(&code[0],
                                                             compiled_method->GetInstructionSet());
       LOG(INFO) << "MakeExecutable " << PrettyMethod(method) << " code=" << method_code;
@@ -194,6 +194,37 @@ static size_t gAllocRecordCount GUARDED_BY(gAllocTrackerLock) = 0;
 static std::vector<Breakpoint> gBreakpoints GUARDED_BY(Locks::breakpoint_lock_);
 static SingleStepControl gSingleStepControl GUARDED_BY(Locks::breakpoint_lock_);
 
+// Changes to what runs in the interpreter, requested when breakpoints and single-steps are set
+// and cleared. They are applied by ManageDeoptimization, which suspends all threads.
+struct DeoptimizationRequest {
+  enum Kind {
+    kDeoptimizeEverything,
+    kUndeoptimizeEverything,
+    kDeoptimizeMethod,
+    kUndeoptimizeMethod
+  };
+  Kind kind;
+  mirror::ArtMethod* method;
+};
+static std::vector<DeoptimizationRequest> gDeoptimizationRequests
+    GUARDED_BY(Locks::breakpoint_lock_);
+
+static void RequestDeoptimization(DeoptimizationRequest::Kind kind, mirror::ArtMethod* method)
+    EXCLUSIVE_LOCKS_REQUIRED(Locks::breakpoint_lock_) {
+  DeoptimizationRequest request = { kind, method };
+  gDeoptimizationRequests.push_back(request);
+}
+
+static bool HasBreakpointInMethod(const mirror::ArtMethod* m)
+    EXCLUSIVE_LOCKS_REQUIRED(Locks::breakpoint_lock_) {
+  for (size_t i = 0; i < gBreakpoints.size(); ++i) {
+    if (gBreakpoints[i].method == m) {
+      return true;
+    }
+  }
+  return false;
+}
+
 static bool IsBreakpoint(const mirror::ArtMethod* m, uint32_t dex_pc)
     LOCKS_EXCLUDED(Locks::breakpoint_lock_)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -471,6 +502,24 @@ void Dbg::StopJdwp() {
   gRegistry = NULL;
 }
 
+void Dbg::SweepObjectRegistry(IsMarkedTester is_marked, void* arg) {
+  if (gRegistry != NULL) {
+    gRegistry->SweepWeaks(is_marked, arg);
+  }
+}
+
+void Dbg::AllowNewObjectRegistryObjects() {
+  if (gRegistry != NULL) {
+    gRegistry->AllowNewObjects();
+  }
+}
+
+void Dbg::DisallowNewObjectRegistryObjects() {
+  if (gRegistry != NULL) {
+    gRegistry->DisallowNewObjects();
+  }
+}
+
 void Dbg::GcDidFinish() {
   if (gDdmHpifWhen != HPIF_WHEN_NEVER) {
     ScopedObjectAccess soa(Thread::Current());
@@ -539,6 +588,8 @@ void Dbg::GoActive() {
   Thread* self = Thread::Current();
   ThreadState old_state = self->SetStateUnsafe(kRunnable);
   CHECK_NE(old_state, kRunnable);
+  // Only methods with breakpoints, or everything while single-stepping, need the interpreter.
+  runtime->GetInstrumentation()->EnableDeoptimization();
   runtime->GetInstrumentation()->AddListener(&gDebugInstrumentationListener,
                                              instrumentation::Instrumentation::kMethodEntered |
                                              instrumentation::Instrumentation::kMethodExited |
@@ -563,6 +614,13 @@ void Dbg::Disconnected() {
   runtime->GetThreadList()->SuspendAll();
   Thread* self = Thread::Current();
   ThreadState old_state = self->SetStateUnsafe(kRunnable);
+  {
+    MutexLock mu(self, *Locks::breakpoint_lock_);
+    gDeoptimizationRequests.clear();
+  }
+  if (runtime->GetInstrumentation()->IsDeoptimizationEnabled()) {
+    runtime->GetInstrumentation()->DisableDeoptimization();
+  }
   runtime->GetInstrumentation()->RemoveListener(&gDebugInstrumentationListener,
                                                 instrumentation::Instrumentation::kMethodEntered |
                                                 instrumentation::Instrumentation::kMethodExited |
@@ -664,15 +722,16 @@ JDWP::JdwpError Dbg::GetMonitorInfo(JDWP::ObjectId object_id, JDWP::ExpandBuf* r
     return JDWP::ERR_INVALID_OBJECT;
   }
 
-  // Ensure all threads are suspended while we read objects' lock words.
+  // Ensure all threads are suspended while we read objects' lock words. Runnable threads may
+  // hold biased shares of the mutator lock, which only SuspendAll excludes.
   Thread* self = Thread::Current();
-  Locks::mutator_lock_->SharedUnlock(self);
-  Locks::mutator_lock_->ExclusiveLock(self);
+  self->TransitionFromRunnableToSuspended(kSuspended);
+  Runtime::Current()->GetThreadList()->SuspendAll();
 
   MonitorInfo monitor_info(o);
 
-  Locks::mutator_lock_->ExclusiveUnlock(self);
-  Locks::mutator_lock_->SharedLock(self);
+  Runtime::Current()->GetThreadList()->ResumeAll();
+  self->TransitionFromSuspendedToRunnable();
 
   if (monitor_info.owner != NULL) {
     expandBufAddObjectId(reply, gRegistry->Add(monitor_info.owner->GetPeer()));
@@ -786,9 +845,7 @@ JDWP::JdwpError Dbg::GetInstances(JDWP::RefTypeId class_id, int32_t max_count, s
 
   std::vector<mirror::Object*> raw_instances;
   Runtime::Current()->GetHeap()->GetInstances(c, max_count, raw_instances);
-  for (size_t i = 0; i < raw_instances.size(); ++i) {
-    instances.push_back(gRegistry->Add(raw_instances[i]));
-  }
+  gRegistry->Add(raw_instances, instances);
   return JDWP::ERR_NONE;
 }
 
@@ -802,9 +859,7 @@ JDWP::JdwpError Dbg::GetReferringObjects(JDWP::ObjectId object_id, int32_t max_c
 
   std::vector<mirror::Object*> raw_instances;
   Runtime::Current()->GetHeap()->GetReferringObjects(o, max_count, raw_instances);
-  for (size_t i = 0; i < raw_instances.size(); ++i) {
-    referring_objects.push_back(gRegistry->Add(raw_instances[i]));
-  }
+  gRegistry->Add(raw_instances, referring_objects);
   return JDWP::ERR_NONE;
 }
 
@@ -2373,6 +2428,9 @@ void Dbg::UpdateDebugger(Thread* thread, mirror::Object* this_object,
 void Dbg::WatchLocation(const JDWP::JdwpLocation* location) {
   MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
   mirror::ArtMethod* m = FromMethodId(location->method_id);
+  if (!HasBreakpointInMethod(m)) {
+    RequestDeoptimization(DeoptimizationRequest::kDeoptimizeMethod, m);
+  }
   gBreakpoints.push_back(Breakpoint(m, location->dex_pc));
   VLOG(jdwp) << "Set breakpoint #" << (gBreakpoints.size() - 1) << ": " << gBreakpoints[gBreakpoints.size() - 1];
 }
@@ -2384,11 +2442,54 @@ void Dbg::UnwatchLocation(const JDWP::JdwpLocation* location) {
     if (gBreakpoints[i].method == m && gBreakpoints[i].dex_pc == location->dex_pc) {
       VLOG(jdwp) << "Removed breakpoint #" << i << ": " << gBreakpoints[i];
       gBreakpoints.erase(gBreakpoints.begin() + i);
+      if (!HasBreakpointInMethod(m)) {
+        RequestDeoptimization(DeoptimizationRequest::kUndeoptimizeMethod, m);
+      }
       return;
     }
   }
 }
 
+void Dbg::ManageDeoptimization() {
+  Thread* self = Thread::Current();
+  std::vector<DeoptimizationRequest> requests;
+  {
+    MutexLock mu(self, *Locks::breakpoint_lock_);
+    requests.swap(gDeoptimizationRequests);
+  }
+  if (requests.empty()) {
+    return;
+  }
+  // Suspend all threads and exclusively acquire the mutator lock, as when going active.
+  Runtime* runtime = Runtime::Current();
+  runtime->GetThreadList()->SuspendAll();
+  ThreadState old_state = self->SetStateUnsafe(kRunnable);
+  CHECK_NE(old_state, kRunnable);
+  instrumentation::Instrumentation* instrumentation = runtime->GetInstrumentation();
+  if (instrumentation->IsDeoptimizationEnabled()) {
+    for (const DeoptimizationRequest& request : requests) {
+      switch (request.kind) {
+        case DeoptimizationRequest::kDeoptimizeEverything:
+          instrumentation->DeoptimizeEverything();
+          break;
+        case DeoptimizationRequest::kUndeoptimizeEverything:
+          instrumentation->UndeoptimizeEverything();
+          break;
+        case DeoptimizationRequest::kDeoptimizeMethod:
+          VLOG(jdwp) << "Deoptimizing " << PrettyMethod(request.method);
+          instrumentation->Deoptimize(request.method);
+          break;
+        case DeoptimizationRequest::kUndeoptimizeMethod:
+          VLOG(jdwp) << "Undeoptimizing " << PrettyMethod(request.method);
+          instrumentation->Undeoptimize(request.method);
+          break;
+      }
+    }
+  }
+  CHECK_EQ(self->SetStateUnsafe(old_state), kRunnable);
+  runtime->GetThreadList()->ResumeAll();
+}
+
 // Scoped utility class to suspend a thread so that we may do tasks such as walk its stack. Doesn't
 // cause suspension if the thread is the current thread.
 class ScopedThreadSuspension {
@@ -2563,6 +2664,9 @@ JDWP::JdwpError Dbg::ConfigureStep(JDWP::ObjectId thread_id, JDWP::JdwpStepSize
   // Everything else...
   //
 
+  if (!gSingleStepControl.is_active) {
+    RequestDeoptimization(DeoptimizationRequest::kDeoptimizeEverything, NULL);
+  }
   gSingleStepControl.thread = sts.GetThread();
   gSingleStepControl.step_size = step_size;
   gSingleStepControl.step_depth = step_depth;
@@ -2587,6 +2691,9 @@ JDWP::JdwpError Dbg::ConfigureStep(JDWP::ObjectId thread_id, JDWP::JdwpStepSize
 void Dbg::UnconfigureStep(JDWP::ObjectId /*thread_id*/) {
   MutexLock mu(Thread::Current(), *Locks::breakpoint_lock_);
 
+  if (gSingleStepControl.is_active) {
+    RequestDeoptimization(DeoptimizationRequest::kUndeoptimizeEverything, NULL);
+  }
   gSingleStepControl.is_active = false;
   gSingleStepControl.thread = NULL;
   gSingleStepControl.dex_pcs.clear();
@@ -92,6 +92,12 @@ class Dbg {
   // Invoked by the GC in case we need to keep DDMS informed.
   static void GcDidFinish() LOCKS_EXCLUDED(Locks::mutator_lock_);
 
+  // Invoked by the GC alongside the other system weaks, to let the object registry forget
+  // objects that have been collected.
+  static void SweepObjectRegistry(IsMarkedTester is_marked, void* arg);
+  static void AllowNewObjectRegistryObjects() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static void DisallowNewObjectRegistryObjects() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Return the DebugInvokeReq for the current thread.
   static DebugInvokeReq* GetInvokeReq();
 
@@ -357,6 +363,11 @@ class Dbg {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   static void UnconfigureStep(JDWP::ObjectId thread_id) LOCKS_EXCLUDED(Locks::breakpoint_lock_);
 
+  // Applies the deoptimization requested by setting and clearing breakpoints and single-steps.
+  // Suspends all threads, so it must be called without holding the mutator lock.
+  static void ManageDeoptimization()
+      LOCKS_EXCLUDED(Locks::breakpoint_lock_, Locks::mutator_lock_);
+
   static JDWP::JdwpError InvokeMethod(JDWP::ObjectId thread_id, JDWP::ObjectId object_id,
                                       JDWP::RefTypeId class_id, JDWP::MethodId method_id,
                                       uint32_t arg_count, uint64_t* arg_values,
@@ -24,6 +24,9 @@
 #include <sys/file.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "base/logging.h"
 #include "base/stringprintf.h"
 #include "class_linker.h"
@@ -274,6 +277,7 @@ DexFile::~DexFile() {
   // that's only called after DetachCurrentThread, which means there's no JNIEnv. We could
   // re-attach, but cleaning up these global references is not obviously useful. It's not as if
   // the global reference table is otherwise empty!
+  delete class_def_index_;
 }
 
 bool DexFile::Init() {
@@ -331,38 +335,67 @@ uint32_t DexFile::GetVersion() const {
   return atoi(version);
 }
 
-const DexFile::ClassDef* DexFile::FindClassDef(const char* descriptor) const {
-  size_t num_class_defs = NumClassDefs();
-  if (num_class_defs == 0) {
-    return NULL;
+static uint32_t DescriptorHash(const char* descriptor) {
+  // This is the java.lang.String hashcode for convenience, not interoperability.
+  uint32_t hash = 0;
+  for (; *descriptor != '\0'; ++descriptor) {
+    hash = hash * 31 + *descriptor;
   }
-  const StringId* string_id = FindStringId(descriptor);
-  if (string_id == NULL) {
-    return NULL;
+  return hash;
+}
+
+const HashSet<uint32_t>* DexFile::GetClassDefIndex() const {
+  HashSet<uint32_t>* index = class_def_index_;
+  if (LIKELY(index != NULL)) {
+    return index;
+  }
+  index = new HashSet<uint32_t>;
+  const size_t num_class_defs = NumClassDefs();
+  for (size_t i = 0; i < num_class_defs; ++i) {
+    index->Insert(i + 1, DescriptorHash(GetClassDescriptor(GetClassDef(i))));
+  }
+  // The CAS is a full barrier, the index is complete before other threads can see it.
+  if (!__sync_bool_compare_and_swap(&class_def_index_, NULL, index)) {
+    delete index;
+    index = class_def_index_;
   }
-  const TypeId* type_id = FindTypeId(GetIndexForStringId(*string_id));
-  if (type_id == NULL) {
+  return index;
+}
+
+class ClassDefDescriptorEquals {
+ public:
+  ClassDefDescriptorEquals(const DexFile& dex_file, const char* descriptor)
+      : dex_file_(dex_file), descriptor_(descriptor) {}
+
+  bool operator()(uint32_t class_def_index_plus_one) const {
+    const DexFile::ClassDef& class_def = dex_file_.GetClassDef(class_def_index_plus_one - 1);
+    return strcmp(descriptor_, dex_file_.GetClassDescriptor(class_def)) == 0;
+  }
+
+ private:
+  const DexFile& dex_file_;
+  const char* const descriptor_;
+};
+
+const DexFile::ClassDef* DexFile::FindClassDef(const char* descriptor) const {
+  if (NumClassDefs() == 0) {
     return NULL;
   }
-  uint16_t type_idx = GetIndexForTypeId(*type_id);
-  for (size_t i = 0; i < num_class_defs; ++i) {
-    const ClassDef& class_def = GetClassDef(i);
-    if (class_def.class_idx_ == type_idx) {
-      return &class_def;
-    }
+  uint32_t class_def_index_plus_one =
+      GetClassDefIndex()->Find(DescriptorHash(descriptor),
+                               ClassDefDescriptorEquals(*this, descriptor));
+  if (class_def_index_plus_one == 0) {
+    return NULL;
   }
-  return NULL;
+  return &GetClassDef(class_def_index_plus_one - 1);
 }
 
 const DexFile::ClassDef* DexFile::FindClassDef(uint16_t type_idx) const {
-  size_t num_class_defs = NumClassDefs();
-  for (size_t i = 0; i < num_class_defs; ++i) {
-    const ClassDef& class_def = GetClassDef(i);
-    if (class_def.class_idx_ == type_idx) {
-      return &class_def;
-    }
+  if (NumClassDefs() == 0) {
+    return NULL;
   }
-  return NULL;
+  // Descriptors are unique within a dex file, so this finds the class def of the type.
+  return FindClassDef(StringByTypeIdx(type_idx));
 }
 
 const DexFile::FieldId* DexFile::FindFieldId(const DexFile::TypeId& declaring_klass,
@@ -613,6 +646,17 @@ std::string DexFile::CreateMethodSignature(uint32_t proto_idx, int32_t* unicode_
   return descriptor;
 }
 
+// The line of the first position at rel_pc, or else of the last position before it, -1 if there
+// is none, as for a method without line number info. Positions are in address order.
+static int32_t FindLineNum(const std::vector<DexFile::Position>& positions, uint32_t rel_pc) {
+  std::vector<DexFile::Position>::const_iterator it =
+      std::lower_bound(positions.begin(), positions.end(), DexFile::Position(rel_pc, 0));
+  if (it != positions.end() && it->first == rel_pc) {
+    return it->second;
+  }
+  return (it == positions.begin()) ? -1 : (it - 1)->second;
+}
+
 int32_t DexFile::GetLineNumFromPC(const mirror::ArtMethod* method, uint32_t rel_pc) const {
   // For native method, lineno should be -2 to indicate it is native. Note that
   // "line number == -2" is how libcore tells from StackTraceElement.
@@ -623,11 +667,27 @@ int32_t DexFile::GetLineNumFromPC(const mirror::ArtMethod* method, uint32_t rel_
   const CodeItem* code_item = GetCodeItem(method->GetCodeItemOffset());
   DCHECK(code_item != NULL) << PrettyMethod(method) << " " << GetLocation();
 
-  // A method with no line number info should return -1
-  LineNumFromPcContext context(rel_pc, -1);
-  DecodeDebugInfo(code_item, method->IsStatic(), method->GetDexMethodIndex(), LineNumForPcCb,
-                  NULL, &context);
-  return context.line_num_;
+  Thread* self = Thread::Current();
+  uint32_t code_item_offset = method->GetCodeItemOffset();
+  size_t index = code_item_offset % kLineTableCacheSize;
+  {
+    MutexLock mu(self, line_table_lock_);
+    if (line_tables_.empty()) {
+      line_tables_.resize(kLineTableCacheSize);
+    }
+    if (line_tables_[index].code_item_offset == code_item_offset) {
+      return FindLineNum(line_tables_[index].positions, rel_pc);
+    }
+  }
+  // Decoded without the lock, the table another thread installs meanwhile is replaced.
+  std::vector<Position> positions;
+  DecodeDebugInfo(code_item, method->IsStatic(), method->GetDexMethodIndex(), AddPositionCb,
+                  NULL, &positions);
+  int32_t line_num = FindLineNum(positions, rel_pc);
+  MutexLock mu(self, line_table_lock_);
+  line_tables_[index].code_item_offset = code_item_offset;
+  line_tables_[index].positions.swap(positions);
+  return line_num;
 }
 
 int32_t DexFile::FindTryItem(const CodeItem &code_item, uint32_t address) {
@@ -840,34 +900,28 @@ void DexFile::DecodeDebugInfo(const CodeItem* code_item, bool is_static, uint32_
   }
 }
 
-bool DexFile::LineNumForPcCb(void* raw_context, uint32_t address, uint32_t line_num) {
-  LineNumFromPcContext* context = reinterpret_cast<LineNumFromPcContext*>(raw_context);
-
-  // We know that this callback will be called in
-  // ascending address order, so keep going until we find
-  // a match or we've just gone past it.
-  if (address > context->address_) {
-    // The line number from the previous positions callback
-    // wil be the final result.
-    return true;
-  } else {
-    context->line_num_ = line_num;
-    return address == context->address_;
-  }
+bool DexFile::AddPositionCb(void* context, uint32_t address, uint32_t line_num) {
+  // The callback is called in ascending address order, keep going to the end.
+  reinterpret_cast<std::vector<Position>*>(context)->push_back(Position(address, line_num));
+  return false;
 }
 
 // Decodes the header section from the class data bytes.
 void ClassDataItemIterator::ReadClassDataHeader() {
   CHECK(ptr_pos_ != NULL);
-  header_.static_fields_size_ = DecodeUnsignedLeb128(&ptr_pos_);
-  header_.instance_fields_size_ = DecodeUnsignedLeb128(&ptr_pos_);
-  header_.direct_methods_size_ = DecodeUnsignedLeb128(&ptr_pos_);
-  header_.virtual_methods_size_ = DecodeUnsignedLeb128(&ptr_pos_);
+  uint32_t sizes[4];
+  DecodeUnsignedLeb128Batch(&ptr_pos_, sizes, arraysize(sizes));
+  header_.static_fields_size_ = sizes[0];
+  header_.instance_fields_size_ = sizes[1];
+  header_.direct_methods_size_ = sizes[2];
+  header_.virtual_methods_size_ = sizes[3];
 }
 
 void ClassDataItemIterator::ReadClassDataField() {
-  field_.field_idx_delta_ = DecodeUnsignedLeb128(&ptr_pos_);
-  field_.access_flags_ = DecodeUnsignedLeb128(&ptr_pos_);
+  uint32_t values[2];
+  DecodeUnsignedLeb128Batch(&ptr_pos_, values, arraysize(values));
+  field_.field_idx_delta_ = values[0];
+  field_.access_flags_ = values[1];
   if (last_idx_ != 0 && field_.field_idx_delta_ == 0) {
     LOG(WARNING) << "Duplicate field " << PrettyField(GetMemberIndex(), dex_file_)
                  << " in " << dex_file_.GetLocation();
@@ -875,9 +929,11 @@ void ClassDataItemIterator::ReadClassDataField() {
 }
 
 void ClassDataItemIterator::ReadClassDataMethod() {
-  method_.method_idx_delta_ = DecodeUnsignedLeb128(&ptr_pos_);
-  method_.access_flags_ = DecodeUnsignedLeb128(&ptr_pos_);
-  method_.code_off_ = DecodeUnsignedLeb128(&ptr_pos_);
+  uint32_t values[3];
+  DecodeUnsignedLeb128Batch(&ptr_pos_, values, arraysize(values));
+  method_.method_idx_delta_ = values[0];
+  method_.access_flags_ = values[1];
+  method_.code_off_ = values[2];
   if (last_idx_ != 0 && method_.method_idx_delta_ == 0) {
     LOG(WARNING) << "Duplicate method " << PrettyMethod(GetMemberIndex(), dex_file_)
                  << " in " << dex_file_.GetLocation();
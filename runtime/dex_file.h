@@ -18,8 +18,10 @@
 #define ART_RUNTIME_DEX_FILE_H_
 
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "base/hash_set.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/stringpiece.h"
@@ -596,7 +598,8 @@ class DexFile {
     return StringByTypeIdx(class_def.class_idx_);
   }
 
-  // Looks up a class definition by its class descriptor.
+  // Looks up a class definition by its class descriptor. The first lookup builds a descriptor hash
+  // index of the class definitions.
   const ClassDef* FindClassDef(const char* descriptor) const;
 
   // Looks up a class definition by its type index.
@@ -723,7 +726,8 @@ class DexFile {
                                      const char* descriptor,
                                      const char* signature);
 
-  static bool LineNumForPcCb(void* context, uint32_t address, uint32_t line_num);
+  // Appends the position to the std::vector<Position> context.
+  static bool AddPositionCb(void* context, uint32_t address, uint32_t line_num);
 
   // Debug info opcodes and constants
   enum {
@@ -756,13 +760,15 @@ class DexFile {
     DISALLOW_COPY_AND_ASSIGN(LocalInfo);
   };
 
-  struct LineNumFromPcContext {
-    LineNumFromPcContext(uint32_t address, uint32_t line_num)
-        : address_(address), line_num_(line_num) {}
-    uint32_t address_;
-    uint32_t line_num_;
-   private:
-    DISALLOW_COPY_AND_ASSIGN(LineNumFromPcContext);
+  // A position of the debug info, the line of the code from address on.
+  typedef std::pair<uint32_t, uint32_t> Position;
+
+  // The positions of a method in address order, as decoded from its debug info.
+  struct LineTable {
+    LineTable() : code_item_offset(0) {}
+
+    uint32_t code_item_offset;
+    std::vector<Position> positions;
   };
 
   void InvokeLocalCbIfLive(void* context, int reg, uint32_t end_address,
@@ -850,7 +856,9 @@ class DexFile {
         field_ids_(0),
         method_ids_(0),
         proto_ids_(0),
-        class_defs_(0) {
+        class_defs_(0),
+        class_def_index_(NULL),
+        line_table_lock_("DEX line table lock") {
     CHECK(begin_ != NULL) << GetLocation();
     CHECK_GT(size_, 0U) << GetLocation();
   }
@@ -864,6 +872,9 @@ class DexFile {
   // Returns true if the header magic and version numbers are of the expected values.
   bool CheckMagicAndVersion() const;
 
+  // Builds class_def_index_ unless another thread beat us to it and returns it.
+  const HashSet<uint32_t>* GetClassDefIndex() const;
+
   void DecodeDebugInfo0(const CodeItem* code_item, bool is_static, uint32_t method_idx,
       DexDebugNewPositionCb position_cb, DexDebugNewLocalCb local_cb,
       void* context, const byte* stream, LocalInfo* local_in_reg) const;
@@ -910,6 +921,17 @@ class DexFile {
 
   // Points to the base of the class definition list.
   const ClassDef* class_defs_;
+
+  // Class definition indices plus one, keyed by the hash of the class descriptor. Built lazily and
+  // published with a CAS, never changed afterwards.
+  mutable HashSet<uint32_t>* volatile class_def_index_;
+
+  // Stack traces look the lines of the same methods up over and over, each decoding the method's
+  // debug info. The line tables of the methods looked up last are kept in a direct mapped cache
+  // indexed by code item offset, allocated on the first lookup.
+  static const size_t kLineTableCacheSize = 256;
+  mutable Mutex line_table_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  mutable std::vector<LineTable> line_tables_ GUARDED_BY(line_table_lock_);
 };
 
 // Iterate over a dex file's ProtoId's paramters
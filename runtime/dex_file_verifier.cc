@@ -16,6 +16,9 @@
 
 #include "dex_file_verifier.h"
 
+#include <pthread.h>
+
+#include "base/logging.h"
 #include "base/stringprintf.h"
 #include "dex_file-inl.h"
 #include "leb128.h"
@@ -27,6 +30,24 @@
 
 namespace art {
 
+// The checksum of dex files at least this large is computed in chunks on other threads while the
+// structure is checked, the chunk checksums are combined afterwards.
+static const size_t kParallelChecksumThreshold = 4 * MB;
+static const size_t kChecksumThreads = 2;
+
+struct ChecksumChunk {
+  const byte* begin;
+  size_t size;
+  uLong checksum;
+  pthread_t thread;
+};
+
+static void* ComputeChunkChecksum(void* arg) {
+  ChecksumChunk* chunk = reinterpret_cast<ChecksumChunk*>(arg);
+  chunk->checksum = adler32(adler32(0L, Z_NULL, 0), chunk->begin, chunk->size);
+  return NULL;
+}
+
 static uint32_t MapTypeToBitMask(uint32_t map_type) {
   switch (map_type) {
     case DexFile::kDexTypeHeaderItem:               return 1 << 0;
@@ -141,15 +162,7 @@ bool DexFileVerifier::CheckHeader() const {
     return false;
   }
 
-  // Compute and verify the checksum in the header.
-  uint32_t adler_checksum = adler32(0L, Z_NULL, 0);
-  const uint32_t non_sum = sizeof(header_->magic_) + sizeof(header_->checksum_);
-  const byte* non_sum_ptr = reinterpret_cast<const byte*>(header_) + non_sum;
-  adler_checksum = adler32(adler_checksum, non_sum_ptr, expected_size - non_sum);
-  if (adler_checksum != header_->checksum_) {
-    LOG(ERROR) << StringPrintf("Bad checksum (%08x, expected %08x)", adler_checksum, header_->checksum_);
-    return false;
-  }
+  // The checksum is verified by Verify, possibly concurrently with the other checks.
 
   // Check the contents of the header.
   if (header_->endian_tag_ != DexFile::kDexEndianConstant) {
@@ -1924,21 +1937,48 @@ bool DexFileVerifier::Verify() {
     return false;
   }
 
-  // Check the map section.
-  if (!CheckMap()) {
+  // Checksum everything after the checksum in the header. Large files are checksummed by other
+  // threads while the structure is checked below.
+  const uint32_t non_sum = sizeof(header_->magic_) + sizeof(header_->checksum_);
+  const byte* non_sum_ptr = reinterpret_cast<const byte*>(header_) + non_sum;
+  const size_t sum_size = size_ - non_sum;
+  ChecksumChunk chunks[kChecksumThreads];
+  const size_t num_chunks = (size_ >= kParallelChecksumThreshold) ? kChecksumThreads : 0;
+  for (size_t i = 0; i < num_chunks; ++i) {
+    const size_t chunk_size = sum_size / num_chunks;
+    chunks[i].begin = non_sum_ptr + i * chunk_size;
+    chunks[i].size = (i == num_chunks - 1) ? sum_size - i * chunk_size : chunk_size;
+    CHECK_PTHREAD_CALL(pthread_create,
+                       (&chunks[i].thread, NULL, ComputeChunkChecksum, &chunks[i]),
+                       "dex file checksum");
+  }
+  if (num_chunks == 0 && !CheckChecksum(adler32(adler32(0L, Z_NULL, 0), non_sum_ptr, sum_size))) {
     return false;
   }
 
-  // Check structure within remaining sections.
-  if (!CheckIntraSection()) {
-    return false;
+  // Check the map section, then the structure within remaining sections, then the references
+  // from one section to another.
+  bool structure_ok = CheckMap() && CheckIntraSection() && CheckInterSection();
+
+  if (num_chunks != 0) {
+    uLong adler_checksum = adler32(0L, Z_NULL, 0);
+    for (size_t i = 0; i < num_chunks; ++i) {
+      CHECK_PTHREAD_CALL(pthread_join, (chunks[i].thread, NULL), "dex file checksum");
+      adler_checksum = adler32_combine(adler_checksum, chunks[i].checksum, chunks[i].size);
+    }
+    if (!CheckChecksum(adler_checksum)) {
+      return false;
+    }
   }
 
-  // Check references from one section to another.
-  if (!CheckInterSection()) {
+  return structure_ok;
+}
+
+bool DexFileVerifier::CheckChecksum(uint32_t adler_checksum) const {
+  if (adler_checksum != header_->checksum_) {
+    LOG(ERROR) << StringPrintf("Bad checksum (%08x, expected %08x)", adler_checksum, header_->checksum_);
     return false;
   }
-
   return true;
 }
 
@@ -39,6 +39,7 @@ class DexFileVerifier {
   bool CheckIndex(uint32_t field, uint32_t limit, const char* label) const;
 
   bool CheckHeader() const;
+  bool CheckChecksum(uint32_t adler_checksum) const;
   bool CheckMap() const;
 
   uint32_t ReadUnsignedLittleEndian(uint32_t size);
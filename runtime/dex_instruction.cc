@@ -451,6 +451,16 @@ std::string Instruction::DumpString(const DexFile* file) const {
                << " // field@" << field_idx;
             break;
           }  // else fall-through
+        case SGET_QUICK:
+        case SGET_WIDE_QUICK:
+        case SGET_OBJECT_QUICK:
+        case SPUT_QUICK:
+        case SPUT_WIDE_QUICK:
+        case SPUT_OBJECT_QUICK:
+          if (file != NULL) {
+            os << opcode << " v" << static_cast<int>(VRegA_21c()) << ", // offset@" << VRegB_21c();
+            break;
+          }  // else fall-through
         default:
           os << StringPrintf("%s v%d, thing@%d", opcode, VRegA_21c(), VRegB_21c());
           break;
@@ -565,6 +575,7 @@ std::string Instruction::DumpString(const DexFile* file) const {
             break;
           }  // else fall-through
         case INVOKE_VIRTUAL_QUICK:
+        case INVOKE_SUPER_QUICK:
           if (file != NULL) {
             os << opcode << " {";
             uint32_t method_idx = VRegB_35c();
@@ -598,6 +609,7 @@ std::string Instruction::DumpString(const DexFile* file) const {
             break;
           }  // else fall-through
         case INVOKE_VIRTUAL_RANGE_QUICK:
+        case INVOKE_SUPER_RANGE_QUICK:
           if (file != NULL) {
             uint32_t method_idx = VRegB_3rc();
             os << StringPrintf("%s, {v%d .. v%d}, ", opcode, VRegC_3rc(), (VRegC_3rc() + VRegA_3rc() - 1))
@@ -296,6 +296,12 @@ class Instruction {
     insns[0] = (val << 8) | (insns[0] & 0x00ff);
   }
 
+  void SetVRegB_21c(uint16_t val) {
+    DCHECK(FormatOf(Opcode()) == k21c);
+    uint16_t* insns = reinterpret_cast<uint16_t*>(this);
+    insns[1] = val;
+  }
+
   void SetVRegB_3rc(uint16_t val) {
     DCHECK(FormatOf(Opcode()) == k3rc);
     uint16_t* insns = reinterpret_cast<uint16_t*>(this);
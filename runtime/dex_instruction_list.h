@@ -253,14 +253,14 @@
   V(0xE8, IPUT_OBJECT_QUICK, "iput-object-quick", k22c, false, kFieldRef, kContinue | kThrow, kVerifyRegA | kVerifyRegB) \
   V(0xE9, INVOKE_VIRTUAL_QUICK, "invoke-virtual-quick", k35c, false, kMethodRef, kContinue | kThrow | kInvoke, kVerifyVarArg) \
   V(0xEA, INVOKE_VIRTUAL_RANGE_QUICK, "invoke-virtual/range-quick", k3rc, false, kMethodRef, kContinue | kThrow | kInvoke, kVerifyVarArgRange) \
-  V(0xEB, UNUSED_EB, "unused-eb", k10x, false, kUnknown, 0, kVerifyError) \
-  V(0xEC, UNUSED_EC, "unused-ec", k10x, false, kUnknown, 0, kVerifyError) \
-  V(0xED, UNUSED_ED, "unused-ed", k10x, false, kUnknown, 0, kVerifyError) \
-  V(0xEE, UNUSED_EE, "unused-ee", k10x, false, kUnknown, 0, kVerifyError) \
-  V(0xEF, UNUSED_EF, "unused-ef", k10x, false, kUnknown, 0, kVerifyError) \
-  V(0xF0, UNUSED_F0, "unused-f0", k10x, false, kUnknown, 0, kVerifyError) \
-  V(0xF1, UNUSED_F1, "unused-f1", k10x, false, kUnknown, 0, kVerifyError) \
-  V(0xF2, UNUSED_F2, "unused-f2", k10x, false, kUnknown, 0, kVerifyError) \
+  V(0xEB, SGET_QUICK, "sget-quick", k21c, true, kFieldRef, kContinue, kVerifyRegA) \
+  V(0xEC, SGET_WIDE_QUICK, "sget-wide-quick", k21c, true, kFieldRef, kContinue, kVerifyRegAWide) \
+  V(0xED, SGET_OBJECT_QUICK, "sget-object-quick", k21c, true, kFieldRef, kContinue, kVerifyRegA) \
+  V(0xEE, SPUT_QUICK, "sput-quick", k21c, false, kFieldRef, kContinue, kVerifyRegA) \
+  V(0xEF, SPUT_WIDE_QUICK, "sput-wide-quick", k21c, false, kFieldRef, kContinue, kVerifyRegAWide) \
+  V(0xF0, SPUT_OBJECT_QUICK, "sput-object-quick", k21c, false, kFieldRef, kContinue, kVerifyRegA) \
+  V(0xF1, INVOKE_SUPER_QUICK, "invoke-super-quick", k35c, false, kMethodRef, kContinue | kThrow | kInvoke, kVerifyVarArg) \
+  V(0xF2, INVOKE_SUPER_RANGE_QUICK, "invoke-super/range-quick", k3rc, false, kMethodRef, kContinue | kThrow | kInvoke, kVerifyVarArgRange) \
   V(0xF3, UNUSED_F3, "unused-f3", k10x, false, kUnknown, 0, kVerifyError) \
   V(0xF4, UNUSED_F4, "unused-f4", k10x, false, kUnknown, 0, kVerifyError) \
   V(0xF5, UNUSED_F5, "unused-f5", k10x, false, kUnknown, 0, kVerifyError) \
@@ -315,8 +315,9 @@ JValue InvokeProxyInvocationHandler(ScopedObjectAccessUnchecked& soa, const char
     }
     for (size_t i = 0; i < args.size(); ++i) {
       if (shorty[i + 1] == 'L') {
-        jobject val = args.at(i).l;
-        soa.Env()->SetObjectArrayElement(args_jobj, i, val);
+        // The array was allocated for these, no need for the checks of SetObjectArrayElement.
+        mirror::Object* val = soa.Decode<mirror::Object*>(args[i].l);
+        soa.Decode<mirror::ObjectArray<mirror::Object>* >(args_jobj)->SetWithoutChecks(i, val);
       } else {
         JValue jv;
         jv.SetJ(args.at(i).j);
@@ -20,12 +20,14 @@
 #include "class_linker.h"
 #include "common_throws.h"
 #include "dex_file.h"
+#include "dex_instruction.h"
 #include "indirect_reference_table.h"
 #include "invoke_type.h"
 #include "jni_internal.h"
 #include "mirror/art_method.h"
 #include "mirror/array.h"
 #include "mirror/class-inl.h"
+#include "mirror/dex_cache-inl.h"
 #include "mirror/throwable.h"
 
 #include "thread.h"
@@ -112,6 +114,38 @@ extern mirror::Array* CheckAndAllocArrayFromCode(uint32_t type_idx, mirror::ArtM
                                                  Thread* self, bool access_check)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+// Returns the array a FILL_ARRAY_DATA fills with payload, or NULL with an exception pending if it
+// is null or shorter than the payload.
+static inline mirror::Array* CheckFillArrayData(Thread* self, mirror::Object* obj,
+                                                const Instruction::ArrayDataPayload* payload)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  DCHECK_EQ(payload->ident, static_cast<uint16_t>(Instruction::kArrayDataSignature));
+  if (UNLIKELY(obj == NULL)) {
+    ThrowNullPointerException(NULL, "null array in FILL_ARRAY_DATA");
+    return NULL;
+  }
+  mirror::Array* array = obj->AsArray();
+  DCHECK(array->IsArrayInstance() && !array->IsObjectArray());
+  if (UNLIKELY(static_cast<int32_t>(payload->element_count) > array->GetLength())) {
+    self->ThrowNewExceptionF(self->GetCurrentLocationForThrow(),
+                             "Ljava/lang/ArrayIndexOutOfBoundsException;",
+                             "failed FILL_ARRAY_DATA; length=%d, index=%d",
+                             array->GetLength(), payload->element_count - 1);
+    return NULL;
+  }
+  return array;
+}
+
+// Copies the payload of a FILL_ARRAY_DATA to an array CheckFillArrayData accepted. The dex file,
+// and the literal pools the Quick backends copy payloads to, hold the elements little-endian as
+// the array does, so they are copied in one go whatever their width.
+static inline void FillArrayData(mirror::Array* array,
+                                 const Instruction::ArrayDataPayload* payload)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  memcpy(array->GetRawData(payload->element_width), payload->data,
+         payload->element_count * payload->element_width);
+}
+
 // Type of find field operation for fast and slow case.
 enum FindFieldType {
   InstanceObjectRead,
@@ -324,7 +358,6 @@ static inline void CheckSuspend(Thread* thread) SHARED_LOCKS_REQUIRED(Locks::mut
   for (;;) {
     if (thread->ReadFlag(kCheckpointRequest)) {
       thread->RunCheckpointFunction();
-      thread->AtomicClearFlag(kCheckpointRequest);
     } else if (thread->ReadFlag(kSuspendRequest)) {
       thread->FullSuspendCheck();
     } else {
@@ -22,15 +22,21 @@
 #include "object_utils.h"
 #include "runtime.h"
 #include "stack.h"
+#include "thread.h"
 
 namespace art {
 
+#if !defined(ART_USE_PORTABLE_COMPILER)
+extern "C" void art_quick_invoke_stub(mirror::ArtMethod*, uint32_t*, uint32_t, Thread*, JValue*,
+                                      char);
+#endif
+
 extern "C" void artInterpreterToCompiledCodeBridge(Thread* self, MethodHelper& mh,
                                                    const DexFile::CodeItem* code_item,
                                                    ShadowFrame* shadow_frame, JValue* result) {
   mirror::ArtMethod* method = shadow_frame->GetMethod();
   // Ensure static methods are initialized.
-  if (method->IsStatic()) {
+  if (method->IsStatic() && UNLIKELY(!method->GetDeclaringClass()->IsInitialized())) {
     Runtime::Current()->GetClassLinker()->EnsureInitialized(method->GetDeclaringClass(), true, true);
   }
   uint16_t arg_offset = (code_item == NULL) ? 0 : code_item->registers_size_ - code_item->ins_size_;
@@ -39,9 +45,17 @@ extern "C" void artInterpreterToCompiledCodeBridge(Thread* self, MethodHelper& m
   arg_array.BuildArgArrayFromFrame(shadow_frame, arg_offset);
   method->Invoke(self, arg_array.GetArray(), arg_array.GetNumBytes(), result, mh.GetShorty()[0]);
 #else
-  method->Invoke(self, shadow_frame->GetVRegArgs(arg_offset),
-                 (shadow_frame->NumberOfVRegs() - arg_offset) * 4,
-                 result, mh.GetShorty()[0]);
+  // The interpreter only gets here once the runtime is started and the method has compiled code,
+  // so unlike ArtMethod::Invoke the ins are passed to the invoke stub without checks, as the
+  // words the stub copies to the argument registers and the out arguments.
+  DCHECK(Runtime::Current()->IsStarted());
+  DCHECK(method->GetEntryPointFromCompiledCode() != NULL);
+  ManagedStack fragment;
+  self->PushManagedStackFragment(&fragment);
+  art_quick_invoke_stub(method, shadow_frame->GetVRegArgs(arg_offset),
+                        (shadow_frame->NumberOfVRegs() - arg_offset) * 4, self, result,
+                        mh.GetShorty()[0]);
+  self->PopManagedStackFragment(fragment);
 #endif
 }
 
@@ -16,6 +16,9 @@
 
 #include "callee_save_frame.h"
 #include "entrypoints/entrypoint_utils.h"
+#include "gc/allocation_site_table.h"
+#include "gc/heap-inl.h"
+#include "gc/space/dlmalloc_space.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object_array-inl.h"
@@ -23,11 +26,63 @@
 
 namespace art {
 
+// Allocates with allocate(), on the tenured path if the site allocating type_idx in method is
+// tenured, and samples the allocation for the survival statistics of the site.
+template <typename T, typename Allocate>
+static inline T* AllocateAtSite(uint32_t type_idx, mirror::ArtMethod* method, Thread* self,
+                                const Allocate& allocate)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  gc::AllocationSiteTable* sites = Runtime::Current()->GetHeap()->GetAllocationSiteTable();
+  if (LIKELY(sites == NULL)) {
+    return allocate();
+  }
+  // Allocations made while resolving or initializing the class go the same way, which is harmless.
+  bool tenured = sites->IsTenured(method, type_idx);
+  self->SetAllocatingTenured(tenured);
+  T* result = allocate();
+  self->SetAllocatingTenured(false);
+  if (result != NULL && sites->ShouldSample()) {
+    sites->AddSample(self, method, type_idx, result, tenured);
+  }
+  return result;
+}
+
+// Allocates a small array of a class already in the dex cache from the thread's TLAB, skipping
+// the resolution, size overflow checks and accounting of the general path. Returns NULL when the
+// array needs the general path, which also throws.
+static inline mirror::Array* AllocArrayFast(uint32_t type_idx, mirror::ArtMethod* method,
+                                            int32_t component_count, Thread* self,
+                                            bool access_check)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  // Also rejects negative counts, and keeps the size computation from overflowing.
+  if (UNLIKELY(static_cast<uint32_t>(component_count) >
+               gc::space::DlMallocSpace::kMaxThreadLocalAllocSize)) {
+    return NULL;
+  }
+  mirror::Class* klass = method->GetDexCacheResolvedTypes()->Get(type_idx);
+  if (UNLIKELY(klass == NULL) ||
+      (access_check && UNLIKELY(!method->GetDeclaringClass()->CanAccess(klass)))) {
+    return NULL;
+  }
+  size_t component_size = klass->GetComponentSize();
+  size_t size = mirror::Array::DataOffset(component_size).Uint32Value() +
+      component_count * component_size;
+  mirror::Array* array =
+      down_cast<mirror::Array*>(Runtime::Current()->GetHeap()->AllocObjectFromTlab(self, klass,
+                                                                                   size));
+  if (LIKELY(array != NULL)) {
+    array->SetLength(component_count);
+  }
+  return array;
+}
+
 extern "C" mirror::Object* artAllocObjectFromCode(uint32_t type_idx, mirror::ArtMethod* method,
                                                   Thread* self, mirror::ArtMethod** sp)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsOnly);
-  return AllocObjectFromCode(type_idx, method, self, false);
+  return AllocateAtSite<mirror::Object>(type_idx, method, self, [&]() NO_THREAD_SAFETY_ANALYSIS {
+    return AllocObjectFromCode(type_idx, method, self, false);
+  });
 }
 
 extern "C" mirror::Object* artAllocObjectFromCodeWithAccessCheck(uint32_t type_idx,
@@ -36,7 +91,9 @@ extern "C" mirror::Object* artAllocObjectFromCodeWithAccessCheck(uint32_t type_i
                                                                  mirror::ArtMethod** sp)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsOnly);
-  return AllocObjectFromCode(type_idx, method, self, true);
+  return AllocateAtSite<mirror::Object>(type_idx, method, self, [&]() NO_THREAD_SAFETY_ANALYSIS {
+    return AllocObjectFromCode(type_idx, method, self, true);
+  });
 }
 
 extern "C" mirror::Array* artAllocArrayFromCode(uint32_t type_idx, mirror::ArtMethod* method,
@@ -44,7 +101,11 @@ extern "C" mirror::Array* artAllocArrayFromCode(uint32_t type_idx, mirror::ArtMe
                                                 mirror::ArtMethod** sp)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsOnly);
-  return AllocArrayFromCode(type_idx, method, component_count, self, false);
+  return AllocateAtSite<mirror::Array>(type_idx, method, self, [&]() NO_THREAD_SAFETY_ANALYSIS {
+    mirror::Array* array = AllocArrayFast(type_idx, method, component_count, self, false);
+    return LIKELY(array != NULL) ? array :
+        AllocArrayFromCode(type_idx, method, component_count, self, false);
+  });
 }
 
 extern "C" mirror::Array* artAllocArrayFromCodeWithAccessCheck(uint32_t type_idx,
@@ -54,7 +115,11 @@ extern "C" mirror::Array* artAllocArrayFromCodeWithAccessCheck(uint32_t type_idx
                                                                mirror::ArtMethod** sp)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsOnly);
-  return AllocArrayFromCode(type_idx, method, component_count, self, true);
+  return AllocateAtSite<mirror::Array>(type_idx, method, self, [&]() NO_THREAD_SAFETY_ANALYSIS {
+    mirror::Array* array = AllocArrayFast(type_idx, method, component_count, self, true);
+    return LIKELY(array != NULL) ? array :
+        AllocArrayFromCode(type_idx, method, component_count, self, true);
+  });
 }
 
 extern "C" mirror::Array* artCheckAndAllocArrayFromCode(uint32_t type_idx,
@@ -63,7 +128,11 @@ extern "C" mirror::Array* artCheckAndAllocArrayFromCode(uint32_t type_idx,
                                                         mirror::ArtMethod** sp)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsOnly);
-  return CheckAndAllocArrayFromCode(type_idx, method, component_count, self, false);
+  return AllocateAtSite<mirror::Array>(type_idx, method, self, [&]() NO_THREAD_SAFETY_ANALYSIS {
+    mirror::Array* array = AllocArrayFast(type_idx, method, component_count, self, false);
+    return LIKELY(array != NULL) ? array :
+        CheckAndAllocArrayFromCode(type_idx, method, component_count, self, false);
+  });
 }
 
 extern "C" mirror::Array* artCheckAndAllocArrayFromCodeWithAccessCheck(uint32_t type_idx,
@@ -73,7 +142,11 @@ extern "C" mirror::Array* artCheckAndAllocArrayFromCodeWithAccessCheck(uint32_t
                                                                        mirror::ArtMethod** sp)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsOnly);
-  return CheckAndAllocArrayFromCode(type_idx, method, component_count, self, true);
+  return AllocateAtSite<mirror::Array>(type_idx, method, self, [&]() NO_THREAD_SAFETY_ANALYSIS {
+    mirror::Array* array = AllocArrayFast(type_idx, method, component_count, self, true);
+    return LIKELY(array != NULL) ? array :
+        CheckAndAllocArrayFromCode(type_idx, method, component_count, self, true);
+  });
 }
 
 }  // namespace art
@@ -28,7 +28,12 @@ extern "C" uint32_t artIsAssignableFromCode(const mirror::Class* klass,
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   DCHECK(klass != NULL);
   DCHECK(ref_class != NULL);
-  return klass->IsAssignableFrom(ref_class) ? 1 : 0;
+  // Compiled code already missed the subtype check cache.
+  if (!klass->IsAssignableFrom(ref_class)) {
+    return 0;
+  }
+  Thread::Current()->AddToSubtypeCheckCache(ref_class, klass);
+  return 1;
 }
 
 // Check whether it is safe to cast one class to the other, throw exception and return -1 on failure
@@ -38,6 +43,7 @@ extern "C" int artCheckCastFromCode(mirror::Class* src_type, mirror::Class* dest
   DCHECK(src_type->IsClass()) << PrettyClass(src_type);
   DCHECK(dest_type->IsClass()) << PrettyClass(dest_type);
   if (LIKELY(dest_type->IsAssignableFrom(src_type))) {
+    self->AddToSubtypeCheckCache(src_type, dest_type);
     return 0;  // Success
   } else {
     FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsOnly);
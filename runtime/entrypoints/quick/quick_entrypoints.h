@@ -113,6 +113,7 @@ struct PACKED(4) QuickEntryPoints {
   int32_t (*pIndexOf)(void*, uint32_t, uint32_t, uint32_t);
   int32_t (*pMemcmp16)(void*, void*, int32_t);
   int32_t (*pStringCompareTo)(void*, void*);
+  int32_t (*pStringEquals)(void*, void*);
   void* (*pMemcpy)(void*, const void*, size_t);
 
   // Invocation
@@ -17,6 +17,7 @@
 #include "callee_save_frame.h"
 #include "common_throws.h"
 #include "dex_instruction.h"
+#include "entrypoints/entrypoint_utils.h"
 #include "mirror/array.h"
 #include "mirror/object-inl.h"
 
@@ -42,21 +43,10 @@ extern "C" int artHandleFillArrayDataFromCode(mirror::Array* array,
                                               Thread* self, mirror::ArtMethod** sp)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsOnly);
-  DCHECK_EQ(payload->ident, static_cast<uint16_t>(Instruction::kArrayDataSignature));
-  if (UNLIKELY(array == NULL)) {
-    ThrowNullPointerException(NULL, "null array in FILL_ARRAY_DATA");
+  if (UNLIKELY(CheckFillArrayData(self, array, payload) == NULL)) {
     return -1;  // Error
   }
-  DCHECK(array->IsArrayInstance() && !array->IsObjectArray());
-  if (UNLIKELY(static_cast<int32_t>(payload->element_count) > array->GetLength())) {
-    ThrowLocation throw_location = self->GetCurrentLocationForThrow();
-    self->ThrowNewExceptionF(throw_location, "Ljava/lang/ArrayIndexOutOfBoundsException;",
-                             "failed FILL_ARRAY_DATA; length=%d, index=%d",
-                             array->GetLength(), payload->element_count - 1);
-    return -1;  // Error
-  }
-  uint32_t size_in_bytes = payload->element_count * payload->element_width;
-  memcpy(array->GetRawData(payload->element_width), payload->data, size_in_bytes);
+  FillArrayData(array, payload);
   return 0;  // Success
 }
 
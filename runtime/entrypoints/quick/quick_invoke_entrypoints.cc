@@ -17,11 +17,13 @@
 #include "callee_save_frame.h"
 #include "dex_instruction-inl.h"
 #include "entrypoints/entrypoint_utils.h"
+#include "inline_cache.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/dex_cache-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
+#include "runtime.h"
 
 namespace art {
 
@@ -33,12 +35,25 @@ extern "C" uint64_t artInvokeInterfaceTrampoline(mirror::ArtMethod* interface_me
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   mirror::ArtMethod* method;
   if (LIKELY(interface_method->GetDexMethodIndex() != DexFile::kDexNoIndex)) {
-    method = this_object->GetClass()->FindVirtualMethodForInterface(interface_method);
+    mirror::Class* klass = this_object->GetClass();
+    method = klass->FindVirtualMethodForInterfaceInImt(interface_method);
     if (UNLIKELY(method == NULL)) {
-      FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsAndArgs);
-      ThrowIncompatibleClassChangeErrorClassForInterfaceDispatch(interface_method, this_object,
-                                                                 caller_method);
-      return 0;  // Failure.
+      // The interface method shares its table slot, fall back to the cache and the iftable.
+      InlineCacheTable* inline_caches = Runtime::Current()->GetInlineCaches();
+      InlineCache* cache = inline_caches->GetCache(caller_method, interface_method);
+      method = (cache != NULL) ? cache->Lookup(klass) : NULL;
+      if (method == NULL) {
+        method = klass->FindVirtualMethodForInterface(interface_method);
+        if (UNLIKELY(method == NULL)) {
+          FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsAndArgs);
+          ThrowIncompatibleClassChangeErrorClassForInterfaceDispatch(interface_method, this_object,
+                                                                     caller_method);
+          return 0;  // Failure.
+        }
+        if (cache != NULL) {
+          inline_caches->Update(self, cache, klass, method);
+        }
+      }
     }
   } else {
     FinishCalleeSaveFrameSetup(self, sp, Runtime::kRefsAndArgs);
@@ -159,6 +174,19 @@ static uint64_t artInvokeCommon(uint32_t method_idx, mirror::Object* this_object
     }
   }
   DCHECK(!self->IsExceptionPending());
+  if (type == kInterface) {
+    // Record the receiver class against the method named by the call, resolved by now, when the
+    // interface method table couldn't dispatch it.
+    mirror::ArtMethod* callee = caller_method->GetDexCacheResolvedMethods()->Get(method_idx);
+    mirror::Class* klass = this_object->GetClass();
+    if (klass->FindVirtualMethodForInterfaceInImt(callee) == NULL) {
+      InlineCacheTable* inline_caches = Runtime::Current()->GetInlineCaches();
+      InlineCache* cache = inline_caches->GetCache(caller_method, callee);
+      if (cache != NULL) {
+        inline_caches->Update(self, cache, klass, method);
+      }
+    }
+  }
   const void* code = method->GetEntryPointFromCompiledCode();
 
 #ifndef NDEBUG
@@ -32,6 +32,8 @@ extern "C" void artTestSuspendFromCode(Thread* thread, mirror::ArtMethod** sp)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   // Called when suspend count check value is 0 and thread->suspend_count_ != 0
   FinishCalleeSaveFrameSetup(thread, sp, Runtime::kRefsOnly);
+  // Requests made from now on trigger the implicit suspend checks again.
+  thread->RemoveSuspendTrigger();
   CheckSuspend(thread);
 }
 
@@ -221,50 +221,36 @@ class QuickArgumentVisitor {
   bool is_split_long_or_double_;
 };
 
-// Visits arguments on the stack placing them into the shadow frame.
-class BuildQuickShadowFrameVisitor : public QuickArgumentVisitor {
- public:
-  BuildQuickShadowFrameVisitor(mirror::ArtMethod** sp,
-      bool is_static, const char* shorty,
-       uint32_t shorty_len, ShadowFrame& sf, size_t first_arg_reg) :
-    QuickArgumentVisitor(sp, is_static, shorty, shorty_len), sf_(sf), cur_reg_(first_arg_reg) {}
-
-  virtual void Visit() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    Primitive::Type type = GetParamPrimitiveType();
-    switch (type) {
-      case Primitive::kPrimLong:  // Fall-through.
-      case Primitive::kPrimDouble:
-        if (IsSplitLongOrDouble()) {
-          sf_.SetVRegLong(cur_reg_, ReadSplitLongParam());
-        } else {
-          sf_.SetVRegLong(cur_reg_, *reinterpret_cast<jlong*>(GetParamAddress()));
-        }
-        ++cur_reg_;
-        break;
-      case Primitive::kPrimNot:
-        sf_.SetVRegReference(cur_reg_, *reinterpret_cast<mirror::Object**>(GetParamAddress()));
-        break;
-      case Primitive::kPrimBoolean:  // Fall-through.
-      case Primitive::kPrimByte:     // Fall-through.
-      case Primitive::kPrimChar:     // Fall-through.
-      case Primitive::kPrimShort:    // Fall-through.
-      case Primitive::kPrimInt:      // Fall-through.
-      case Primitive::kPrimFloat:
-        sf_.SetVReg(cur_reg_, *reinterpret_cast<jint*>(GetParamAddress()));
-        break;
-      case Primitive::kPrimVoid:
-        LOG(FATAL) << "UNREACHABLE";
-        break;
+// Copies the arguments saved to the stack by a Runtime::kRefAndArgs callee save frame into the
+// shadow frame. Quick passes the arguments as consecutive words, the first three in the registers
+// the callee save frame spills next to each other and the others in the caller's out arguments,
+// so the words are copied as they are and the shorty only tells the references apart.
+static void CopyQuickArgumentsToShadowFrame(mirror::ArtMethod** sp, bool is_static,
+                                            const char* shorty, uint32_t shorty_len,
+                                            ShadowFrame* shadow_frame, size_t first_arg_reg)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  byte* reg_args = reinterpret_cast<byte*>(sp) + QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__R1_OFFSET;
+  byte* stack_args = reinterpret_cast<byte*>(sp) +
+      QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__FRAME_SIZE + QUICK_STACK_ARG_SKIP;
+  const size_t kNumRegArgWords = 3;
+  size_t word = 0;
+  size_t reg = first_arg_reg;
+  for (size_t i = is_static ? 1 : 0; i < shorty_len; ++i) {
+    // The receiver takes the place of the return type.
+    char type = (i == 0) ? 'L' : shorty[i];
+    size_t num_words = (type == 'J' || type == 'D') ? 2 : 1;
+    for (size_t end = word + num_words; word < end; ++word, ++reg) {
+      byte* address = (word < kNumRegArgWords)
+          ? reg_args + word * sizeof(uint32_t)
+          : stack_args + (word - kNumRegArgWords) * sizeof(uint32_t);
+      if (type == 'L') {
+        shadow_frame->SetVRegReference(reg, *reinterpret_cast<mirror::Object**>(address));
+      } else {
+        shadow_frame->SetVReg(reg, *reinterpret_cast<int32_t*>(address));
+      }
     }
-    ++cur_reg_;
   }
-
- private:
-  ShadowFrame& sf_;
-  size_t cur_reg_;
-
-  DISALLOW_COPY_AND_ASSIGN(BuildQuickShadowFrameVisitor);
-};
+}
 
 extern "C" uint64_t artQuickToInterpreterBridge(mirror::ArtMethod* method, Thread* self,
                                                 mirror::ArtMethod** sp)
@@ -285,10 +271,8 @@ extern "C" uint64_t artQuickToInterpreterBridge(mirror::ArtMethod* method, Threa
     ShadowFrame* shadow_frame(ShadowFrame::Create(num_regs, NULL,  // No last shadow coming from quick.
                                                   method, 0, memory));
     size_t first_arg_reg = code_item->registers_size_ - code_item->ins_size_;
-    BuildQuickShadowFrameVisitor shadow_frame_builder(sp, mh.IsStatic(), mh.GetShorty(),
-                                                 mh.GetShortyLength(),
-                                                 *shadow_frame, first_arg_reg);
-    shadow_frame_builder.VisitArguments();
+    CopyQuickArgumentsToShadowFrame(sp, mh.IsStatic(), mh.GetShorty(), mh.GetShortyLength(),
+                                    shadow_frame, first_arg_reg);
     // Push a transition back into managed code onto the linked list in thread.
     ManagedStack fragment;
     self->PushManagedStackFragment(&fragment);
@@ -312,54 +296,47 @@ extern "C" uint64_t artQuickToInterpreterBridge(mirror::ArtMethod* method, Threa
   }
 }
 
-// Visits arguments on the stack placing them into the args vector, Object* arguments are converted
-// to jobjects.
-class BuildQuickArgumentVisitor : public QuickArgumentVisitor {
- public:
-  BuildQuickArgumentVisitor(mirror::ArtMethod** sp, bool is_static, const char* shorty,
-                            uint32_t shorty_len, ScopedObjectAccessUnchecked* soa,
-                            std::vector<jvalue>* args) :
-    QuickArgumentVisitor(sp, is_static, shorty, shorty_len), soa_(soa), args_(args) {}
-
-  virtual void Visit() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    jvalue val;
-    Primitive::Type type = GetParamPrimitiveType();
-    switch (type) {
-      case Primitive::kPrimNot: {
-        mirror::Object* obj = *reinterpret_cast<mirror::Object**>(GetParamAddress());
-        val.l = soa_->AddLocalReference<jobject>(obj);
-        break;
+// Reads the arguments of a proxy method but its receiver from the Runtime::kRefAndArgs callee save
+// frame into args, a word at a time as CopyQuickArgumentsToShadowFrame does rather than through a
+// QuickArgumentVisitor and its virtual call per argument. References become jobjects so that they
+// survive GC.
+static void BuildQuickProxyArguments(mirror::ArtMethod** sp, const char* shorty,
+                                     uint32_t shorty_len, ScopedObjectAccessUnchecked* soa,
+                                     std::vector<jvalue>* args)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  byte* reg_args = reinterpret_cast<byte*>(sp) + QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__R1_OFFSET;
+  byte* stack_args = reinterpret_cast<byte*>(sp) +
+      QUICK_CALLEE_SAVE_FRAME__REF_AND_ARGS__FRAME_SIZE + QUICK_STACK_ARG_SKIP;
+  const size_t kNumRegArgWords = 3;
+  args->reserve(shorty_len - 1);
+  size_t word = 1;  // Skip the receiver.
+  for (size_t i = 1; i < shorty_len; ++i) {
+    char type = shorty[i];
+    size_t num_words = (type == 'J' || type == 'D') ? 2 : 1;
+    uint32_t words[2] = { 0, 0 };
+    mirror::Object* ref = NULL;
+    for (size_t j = 0; j < num_words; ++j, ++word) {
+      byte* address = (word < kNumRegArgWords)
+          ? reg_args + word * sizeof(uint32_t)
+          : stack_args + (word - kNumRegArgWords) * sizeof(uint32_t);
+      if (type == 'L') {
+        ref = *reinterpret_cast<mirror::Object**>(address);
+      } else {
+        words[j] = *reinterpret_cast<uint32_t*>(address);
       }
-      case Primitive::kPrimLong:  // Fall-through.
-      case Primitive::kPrimDouble:
-        if (IsSplitLongOrDouble()) {
-          val.j = ReadSplitLongParam();
-        } else {
-          val.j = *reinterpret_cast<jlong*>(GetParamAddress());
-        }
-        break;
-      case Primitive::kPrimBoolean:  // Fall-through.
-      case Primitive::kPrimByte:     // Fall-through.
-      case Primitive::kPrimChar:     // Fall-through.
-      case Primitive::kPrimShort:    // Fall-through.
-      case Primitive::kPrimInt:      // Fall-through.
-      case Primitive::kPrimFloat:
-        val.i =  *reinterpret_cast<jint*>(GetParamAddress());
-        break;
-      case Primitive::kPrimVoid:
-        LOG(FATAL) << "UNREACHABLE";
-        val.j = 0;
-        break;
     }
-    args_->push_back(val);
+    jvalue val;
+    if (type == 'L') {
+      val.l = soa->AddLocalReference<jobject>(ref);
+    } else if (num_words == 2) {
+      // The low word comes first, even when the value straddles the registers and the stack.
+      val.j = static_cast<int64_t>(words[0] | (static_cast<uint64_t>(words[1]) << 32));
+    } else {
+      val.i = words[0];
+    }
+    args->push_back(val);
   }
-
- private:
-  ScopedObjectAccessUnchecked* soa_;
-  std::vector<jvalue>* args_;
-
-  DISALLOW_COPY_AND_ASSIGN(BuildQuickArgumentVisitor);
-};
+}
 
 // Handler for invocation on proxy methods. On entry a frame will exist for the proxy object method
 // which is responsible for recording callee save registers. We explicitly place into jobjects the
@@ -388,16 +365,12 @@ extern "C" uint64_t artQuickProxyInvokeHandler(mirror::ArtMethod* proxy_method,
   // Create local ref. copies of proxy method and the receiver.
   jobject rcvr_jobj = soa.AddLocalReference<jobject>(receiver);
 
-  // Placing arguments into args vector and remove the receiver.
+  // Placing arguments but the receiver into args vector.
   MethodHelper proxy_mh(proxy_method);
   DCHECK(!proxy_mh.IsStatic()) << PrettyMethod(proxy_method);
+  const char* shorty = proxy_mh.GetShorty();
   std::vector<jvalue> args;
-  BuildQuickArgumentVisitor local_ref_visitor(sp, proxy_mh.IsStatic(), proxy_mh.GetShorty(),
-                                              proxy_mh.GetShortyLength(), &soa, &args);
-
-  local_ref_visitor.VisitArguments();
-  DCHECK_GT(args.size(), 0U) << PrettyMethod(proxy_method);
-  args.erase(args.begin());
+  BuildQuickProxyArguments(sp, shorty, proxy_mh.GetShortyLength(), &soa, &args);
 
   // Convert proxy method into expected interface method.
   mirror::ArtMethod* interface_method = proxy_method->FindOverriddenMethod();
@@ -408,8 +381,8 @@ extern "C" uint64_t artQuickProxyInvokeHandler(mirror::ArtMethod* proxy_method,
   // All naked Object*s should now be in jobjects, so its safe to go into the main invoke code
   // that performs allocations.
   self->EndAssertNoThreadSuspension(old_cause);
-  JValue result = InvokeProxyInvocationHandler(soa, proxy_mh.GetShorty(),
-                                               rcvr_jobj, interface_method_jobj, args);
+  JValue result = InvokeProxyInvocationHandler(soa, shorty, rcvr_jobj, interface_method_jobj,
+                                               args);
   return result.GetJ();
 }
 
@@ -54,9 +54,10 @@ class ExceptionTest : public CommonTest {
       fake_code_.push_back(0x70 | i);
     }
 
-    fake_mapping_data_.PushBack(4);  // first element is count
-    fake_mapping_data_.PushBack(4);  // total (non-length) elements
-    fake_mapping_data_.PushBack(2);  // count of pc to dex elements
+    fake_mapping_data_.PushBack(2);  // total elements
+    fake_mapping_data_.PushBack(1);  // count of pc to dex elements
+    fake_mapping_data_.PushBack(0);  // count of pc to dex checkpoints
+    fake_mapping_data_.PushBack(0);  // count of dex to pc checkpoints
                                       // ---  pc to dex table
     fake_mapping_data_.PushBack(3);  // offset 3
     fake_mapping_data_.PushBack(3);  // maps to dex offset 3
@@ -102,6 +103,15 @@ class ExceptionTest : public CommonTest {
   mirror::Class* my_klass_;
 };
 
+TEST_F(ExceptionTest, GetLineNumFromPC) {
+  ScopedObjectAccess soa(Thread::Current());
+  // The second lookups of each method find its line table cached.
+  for (size_t i = 0; i < 2; ++i) {
+    EXPECT_EQ(37, dex_->GetLineNumFromPC(method_g_, 3));
+    EXPECT_EQ(22, dex_->GetLineNumFromPC(method_f_, 3));
+  }
+}
+
 TEST_F(ExceptionTest, FindCatchHandler) {
   const DexFile::CodeItem* code_item = dex_->GetCodeItem(method_f_->GetCodeItemOffset());
 
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fault_handler.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "gc/heap.h"
+#include "globals.h"
+#include "mirror/art_method-inl.h"
+#include "runtime.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+struct sigaction FaultHandler::old_action_;
+
+void FaultHandler::Init() {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_sigaction = HandleSignal;
+  // Use the three-argument sa_sigaction handler.
+  action.sa_flags |= SA_SIGINFO;
+  // Use the alternate signal stack so we can catch stack overflows.
+  action.sa_flags |= SA_ONSTACK;
+  CHECK_EQ(sigaction(SIGSEGV, &action, &old_action_), 0);
+}
+
+void FaultHandler::HandleSignal(int signal_number, siginfo_t* info, void* raw_context) {
+  if (HandleImplicitCheck(info, raw_context)) {
+    return;
+  }
+  if ((old_action_.sa_flags & SA_SIGINFO) != 0) {
+    old_action_.sa_sigaction(signal_number, info, raw_context);
+  } else if (old_action_.sa_handler != SIG_DFL && old_action_.sa_handler != SIG_IGN) {
+    old_action_.sa_handler(signal_number);
+  } else {
+    // Restore the default action, the faulting instruction then kills us when it's retried.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_handler = SIG_DFL;
+    sigaction(signal_number, &action, NULL);
+  }
+}
+
+bool FaultHandler::IsInCompiledCode(mirror::ArtMethod* method, uintptr_t pc)
+    NO_THREAD_SAFETY_ANALYSIS {
+  // Compiled code only runs in runnable threads, which share the mutator lock.
+  Thread* self = Thread::Current();
+  if (self == NULL || self->GetState() != kRunnable) {
+    return false;
+  }
+  Runtime* runtime = Runtime::Current();
+  if (runtime == NULL || runtime->GetHeap() == NULL || method == NULL ||
+      !IsAligned<kObjectAlignment>(method) ||
+      runtime->GetHeap()->FindContinuousSpaceFromObject(method, true) == NULL) {
+    return false;
+  }
+  if (method->GetClass() == NULL ||
+      method->GetClass() != mirror::ArtMethod::GetJavaLangReflectArtMethod()) {
+    return false;
+  }
+  if (method->IsNative() || method->IsRuntimeMethod() || method->IsProxyMethod()) {
+    return false;
+  }
+  return method->IsWithinCode(pc);
+}
+
+}  // namespace art
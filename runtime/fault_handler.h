@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_FAULT_HANDLER_H_
+#define ART_RUNTIME_FAULT_HANDLER_H_
+
+#include <signal.h>
+#include <stdint.h>
+
+#include "base/macros.h"
+
+namespace art {
+
+namespace mirror {
+class ArtMethod;
+}  // namespace mirror
+
+// Turns the segmentation faults of compiled code into the checks the compiler left to them: null
+// checks of accesses within the first page, stack overflow probes that hit the guard page of the
+// thread's stack, and suspend checks that read through a cleared thread trigger. Other faults
+// go to the handler installed before, debuggerd's on a device and the runtime's unexpected
+// signal handler on the host.
+class FaultHandler {
+ public:
+  // Installs the SIGSEGV handler, once the platform signal handlers are installed.
+  static void Init();
+
+ private:
+  static void HandleSignal(int signal_number, siginfo_t* info, void* raw_context);
+
+  // Architecture specific. If the fault is an implicit check of compiled code, makes the context
+  // resume in the entrypoint of the check as if the faulting instruction had called it and
+  // returns true.
+  static bool HandleImplicitCheck(siginfo_t* info, void* raw_context);
+
+  // Is pc in the compiled code of method, which was read from the bottom of the faulting frame?
+  // Nothing here is known to be valid, so everything is checked before it is dereferenced.
+  static bool IsInCompiledCode(mirror::ArtMethod* method, uintptr_t pc);
+
+  static struct sigaction old_action_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(FaultHandler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_FAULT_HANDLER_H_
@@ -23,6 +23,12 @@
 #include "space_bitmap.h"
 #include "utils.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 namespace art {
 namespace gc {
 namespace accounting {
@@ -41,6 +47,51 @@ static inline bool byte_cas(byte old_value, byte new_value, byte* address) {
   return success;
 }
 
+inline byte* CardTable::SkipCleanCardsScalar(byte* card_begin, byte* card_end) {
+  byte* card_cur = card_begin;
+  while (!IsAligned<sizeof(uintptr_t)>(card_cur) && card_cur < card_end) {
+    if (*card_cur != kCardClean) {
+      return card_cur;
+    }
+    ++card_cur;
+  }
+  while (static_cast<size_t>(card_end - card_cur) >= sizeof(uintptr_t) &&
+         *reinterpret_cast<uintptr_t*>(card_cur) == 0) {
+    card_cur += sizeof(uintptr_t);
+  }
+  while (card_cur < card_end && *card_cur == kCardClean) {
+    ++card_cur;
+  }
+  return card_cur;
+}
+
+inline byte* CardTable::SkipCleanCards(byte* card_begin, byte* card_end) {
+  byte* card_cur = card_begin;
+  if (card_cur < card_end && *card_cur != kCardClean) {
+    return card_cur;  // Scanning a run of dirty cards.
+  }
+#if defined(__SSE2__)
+  const __m128i clean = _mm_setzero_si128();
+  while (card_end - card_cur >= 16) {
+    __m128i cards = _mm_loadu_si128(reinterpret_cast<const __m128i*>(card_cur));
+    int not_clean = _mm_movemask_epi8(_mm_cmpeq_epi8(cards, clean)) ^ 0xFFFF;
+    if (not_clean != 0) {
+      return card_cur + CTZ(not_clean);
+    }
+    card_cur += 16;
+  }
+#elif defined(__ARM_NEON__)
+  while (card_end - card_cur >= 16) {
+    uint64x2_t cards = vreinterpretq_u64_u8(vld1q_u8(card_cur));
+    if ((vgetq_lane_u64(cards, 0) | vgetq_lane_u64(cards, 1)) != 0) {
+      break;  // Let the scalar loop find the card.
+    }
+    card_cur += 16;
+  }
+#endif
+  return SkipCleanCardsScalar(card_cur, card_end);
+}
+
 template <typename Visitor>
 inline size_t CardTable::Scan(SpaceBitmap* bitmap, byte* scan_begin, byte* scan_end,
                               const Visitor& visitor, const byte minimum_age) const {
@@ -52,57 +103,16 @@ inline size_t CardTable::Scan(SpaceBitmap* bitmap, byte* scan_begin, byte* scan_
   CheckCardValid(card_end);
   size_t cards_scanned = 0;
 
-  // Handle any unaligned cards at the start.
-  while (!IsAligned<sizeof(word)>(card_cur) && card_cur < card_end) {
+  // Most cards are clean, skip over them in bulk and look at the others one at a time.
+  // TODO: Investigate if processing continuous runs of dirty cards with a single bitmap visit is
+  // more efficient.
+  for (card_cur = SkipCleanCards(card_cur, card_end); card_cur < card_end;
+       card_cur = SkipCleanCards(card_cur + 1, card_end)) {
     if (*card_cur >= minimum_age) {
       uintptr_t start = reinterpret_cast<uintptr_t>(AddrFromCard(card_cur));
       bitmap->VisitMarkedRange(start, start + kCardSize, visitor);
       ++cards_scanned;
     }
-    ++card_cur;
-  }
-
-  byte* aligned_end = card_end -
-      (reinterpret_cast<uintptr_t>(card_end) & (sizeof(uintptr_t) - 1));
-
-  uintptr_t* word_end = reinterpret_cast<uintptr_t*>(aligned_end);
-  for (uintptr_t* word_cur = reinterpret_cast<uintptr_t*>(card_cur); word_cur < word_end;
-      ++word_cur) {
-    while (LIKELY(*word_cur == 0)) {
-      ++word_cur;
-      if (UNLIKELY(word_cur >= word_end)) {
-        goto exit_for;
-      }
-    }
-
-    // Find the first dirty card.
-    uintptr_t start_word = *word_cur;
-    uintptr_t start = reinterpret_cast<uintptr_t>(AddrFromCard(reinterpret_cast<byte*>(word_cur)));
-    // TODO: Investigate if processing continuous runs of dirty cards with a single bitmap visit is
-    // more efficient.
-    for (size_t i = 0; i < sizeof(uintptr_t); ++i) {
-      if (static_cast<byte>(start_word) >= minimum_age) {
-        auto* card = reinterpret_cast<byte*>(word_cur) + i;
-        DCHECK(*card == static_cast<byte>(start_word) || *card == kCardDirty)
-            << "card " << static_cast<size_t>(*card) << " word " << (start_word & 0xFF);
-        bitmap->VisitMarkedRange(start, start + kCardSize, visitor);
-        ++cards_scanned;
-      }
-      start_word >>= 8;
-      start += kCardSize;
-    }
-  }
-  exit_for:
-
-  // Handle any unaligned cards at the end.
-  card_cur = reinterpret_cast<byte*>(word_end);
-  while (card_cur < card_end) {
-    if (*card_cur >= minimum_age) {
-      uintptr_t start = reinterpret_cast<uintptr_t>(AddrFromCard(card_cur));
-      bitmap->VisitMarkedRange(start, start + kCardSize, visitor);
-      ++cards_scanned;
-    }
-    ++card_cur;
   }
 
   return cards_scanned;
@@ -146,7 +156,7 @@ inline void CardTable::ModifyCardsAtomic(byte* scan_begin, byte* scan_end, const
       new_value = visitor(expected);
     } while (expected != new_value && UNLIKELY(!byte_cas(expected, new_value, card_end)));
     if (expected != new_value) {
-      modified(card_cur, expected, new_value);
+      modified(card_end, expected, new_value);
     }
   }
 
@@ -158,6 +168,13 @@ inline void CardTable::ModifyCardsAtomic(byte* scan_begin, byte* scan_end, const
 
   // TODO: Parallelize.
   while (word_cur < word_end) {
+    // The visitor leaves clean cards clean, skip to the word holding the next card that isn't.
+    byte* card = SkipCleanCards(reinterpret_cast<byte*>(word_cur), card_end);
+    word_cur = reinterpret_cast<uintptr_t*>(RoundDown(reinterpret_cast<uintptr_t>(card),
+                                                      sizeof(uintptr_t)));
+    if (word_cur >= word_end) {
+      break;
+    }
     while ((expected_word = *word_cur) != 0) {
       new_word =
           (visitor((expected_word >> 0) & 0xFF) << 0) |
@@ -50,12 +50,17 @@ namespace accounting {
  * byte is equal to GC_DIRTY_CARD. See CardTable::Create for details.
  */
 
-CardTable* CardTable::Create(const byte* heap_begin, size_t heap_capacity) {
+CardTable* CardTable::Create(const byte* heap_begin, size_t heap_capacity,
+                             MemMap* reservation) {
   /* Set up the card table */
-  size_t capacity = heap_capacity / kCardSize;
-  /* Allocate an extra 256 bytes to allow fixed low-byte of base */
-  UniquePtr<MemMap> mem_map(MemMap::MapAnonymous("card table", NULL,
-                                                 capacity + 256, PROT_READ | PROT_WRITE));
+  size_t size = ComputeSize(heap_capacity);
+  UniquePtr<MemMap> mem_map;
+  if (reservation != NULL) {
+    mem_map.reset(reservation->CarveAnonymous("card table", size, PROT_READ | PROT_WRITE));
+  }
+  if (mem_map.get() == NULL) {
+    mem_map.reset(MemMap::MapAnonymous("card table", NULL, size, PROT_READ | PROT_WRITE));
+  }
   CHECK(mem_map.get() != NULL) << "couldn't allocate card table";
   // All zeros is the correct initial value; all clean. Anonymous mmaps are initialized to zero, we
   // don't clear the card table to avoid unnecessary pages being allocated
@@ -50,7 +50,15 @@ class CardTable {
   static const uint8_t kCardClean = 0x0;
   static const uint8_t kCardDirty = 0x70;
 
-  static CardTable* Create(const byte* heap_begin, size_t heap_capacity);
+  // The card table is carved from reservation if it isn't NULL and has room for it.
+  static CardTable* Create(const byte* heap_begin, size_t heap_capacity,
+                           MemMap* reservation = NULL);
+
+  // Size in bytes of the card table of a heap of heap_capacity bytes.
+  static size_t ComputeSize(size_t heap_capacity) {
+    // An extra 256 bytes allow the fixed low byte of the biased begin.
+    return heap_capacity / kCardSize + 256;
+  }
 
   // Set the card associated with the given address to GC_CARD_DIRTY.
   void MarkCard(const void *addr) {
@@ -107,6 +115,13 @@ class CardTable {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Returns the first card between card_begin and card_end that isn't clean, card_end if all are.
+  // Checks 16 cards at a time with SSE2 or NEON when the runtime is built for them.
+  static byte* SkipCleanCards(byte* card_begin, byte* card_end);
+
+  // SkipCleanCards a word at a time, for the tail of the vector loop and for comparison in tests.
+  static byte* SkipCleanCardsScalar(byte* card_begin, byte* card_end);
+
   // Assertion used to check the given address is covered by the card table
   void CheckAddrIsInCardTable(const byte* addr) const;
 
@@ -124,6 +139,15 @@ class CardTable {
 
   bool AddrIsInCardTable(const void* addr) const;
 
+  // The first card of the table and the end of the table.
+  byte* Begin() const {
+    return mem_map_->Begin() + offset_;
+  }
+
+  byte* End() const {
+    return mem_map_->End();
+  }
+
  private:
   CardTable(MemMap* begin, byte* biased_begin, size_t offset);
 
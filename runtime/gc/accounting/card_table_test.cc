@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "card_table.h"
+
+#include <set>
+
+#include "card_table-inl.h"
+#include "common_test.h"
+#include "gc/heap.h"
+#include "globals.h"
+#include "space_bitmap-inl.h"
+#include "UniquePtr.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+class CardTableTest : public CommonTest {
+ public:
+};
+
+TEST_F(CardTableTest, SkipCleanCards) {
+  static const size_t kNumCards = 96;
+  byte cards[kNumCards + 16];
+  // Every dirty card position, at every alignment of the range start, must be found by the vector
+  // kernels exactly where the scalar loop finds it.
+  for (size_t dirty = 0; dirty <= kNumCards; ++dirty) {
+    memset(cards, CardTable::kCardClean, sizeof(cards));
+    if (dirty < kNumCards) {
+      cards[dirty] = CardTable::kCardDirty - (dirty % 2);
+    }
+    for (size_t begin = 0; begin < 16; ++begin) {
+      for (size_t end = begin; end <= kNumCards; end += 7) {
+        byte* expected = CardTable::SkipCleanCardsScalar(cards + begin, cards + end);
+        EXPECT_EQ(expected, CardTable::SkipCleanCards(cards + begin, cards + end))
+            << "dirty " << dirty << " begin " << begin << " end " << end;
+        if (dirty >= begin && dirty < end) {
+          EXPECT_EQ(cards + dirty, expected);
+        } else {
+          EXPECT_EQ(cards + end, expected);
+        }
+      }
+    }
+  }
+}
+
+class RecordModifiedCards {
+ public:
+  explicit RecordModifiedCards(std::set<byte*>* cards) : cards_(cards) {}
+
+  void operator()(byte* card, byte expected_value, byte new_value) const {
+    EXPECT_NE(expected_value, new_value);
+    EXPECT_TRUE(cards_->insert(card).second);
+  }
+
+ private:
+  std::set<byte*>* const cards_;
+};
+
+TEST_F(CardTableTest, AgeCards) {
+  byte* heap_begin = reinterpret_cast<byte*>(0x10000000);
+  size_t heap_capacity = 1 * MB;
+  UniquePtr<CardTable> card_table(CardTable::Create(heap_begin, heap_capacity));
+  ASSERT_TRUE(card_table.get() != NULL);
+
+  // Dirty a scattered set of cards, some of them already aged, leaving long clean runs.
+  const size_t num_cards = heap_capacity / CardTable::kCardSize;
+  std::set<byte*> dirty_cards;
+  std::set<byte*> aged_cards;
+  for (size_t i = 3; i < num_cards - 1; i += (i % 5 == 0) ? 61 : 1) {
+    byte* card = card_table->CardFromAddr(heap_begin + i * CardTable::kCardSize);
+    if (i % 3 == 0) {
+      *card = CardTable::kCardDirty - 1;
+      aged_cards.insert(card);
+    } else {
+      *card = CardTable::kCardDirty;
+      dirty_cards.insert(card);
+    }
+  }
+
+  // Start and end off word alignment.
+  byte* begin = heap_begin + CardTable::kCardSize;
+  byte* end = heap_begin + heap_capacity - CardTable::kCardSize;
+  std::set<byte*> modified_cards;
+  card_table->ModifyCardsAtomic(begin, end, AgeCardVisitor(),
+                                RecordModifiedCards(&modified_cards));
+
+  EXPECT_EQ(dirty_cards.size() + aged_cards.size(), modified_cards.size());
+  for (size_t i = 0; i < num_cards; ++i) {
+    byte* card = card_table->CardFromAddr(heap_begin + i * CardTable::kCardSize);
+    if (dirty_cards.find(card) != dirty_cards.end()) {
+      EXPECT_EQ(static_cast<byte>(CardTable::kCardDirty - 1), *card) << i;
+      EXPECT_TRUE(modified_cards.find(card) != modified_cards.end()) << i;
+    } else {
+      EXPECT_EQ(static_cast<byte>(CardTable::kCardClean), *card) << i;
+      EXPECT_EQ(aged_cards.find(card) != aged_cards.end(),
+                modified_cards.find(card) != modified_cards.end()) << i;
+    }
+  }
+}
+
+class CountObjects {
+ public:
+  explicit CountObjects(size_t* count) : count_(count) {}
+
+  void operator()(const mirror::Object* /* obj */) const {
+    ++*count_;
+  }
+
+ private:
+  size_t* const count_;
+};
+
+TEST_F(CardTableTest, Scan) {
+  byte* heap_begin = reinterpret_cast<byte*>(0x10000000);
+  size_t heap_capacity = 1 * MB;
+  UniquePtr<CardTable> card_table(CardTable::Create(heap_begin, heap_capacity));
+  UniquePtr<SpaceBitmap> bitmap(SpaceBitmap::Create("test bitmap", heap_begin, heap_capacity));
+  ASSERT_TRUE(card_table.get() != NULL);
+  ASSERT_TRUE(bitmap.get() != NULL);
+
+  // One marked object on every card, every 37th card dirty and every 74th of those aged.
+  const size_t num_cards = heap_capacity / CardTable::kCardSize;
+  size_t expected_dirty = 0;
+  size_t expected_aged = 0;
+  for (size_t i = 0; i < num_cards; ++i) {
+    byte* addr = heap_begin + i * CardTable::kCardSize;
+    bitmap->Set(reinterpret_cast<const mirror::Object*>(addr));
+    if (i % 37 == 0) {
+      if (i % 74 == 0) {
+        *card_table->CardFromAddr(addr) = CardTable::kCardDirty - 1;
+        ++expected_aged;
+      } else {
+        *card_table->CardFromAddr(addr) = CardTable::kCardDirty;
+        ++expected_dirty;
+      }
+    }
+  }
+
+  ScopedObjectAccess soa(Thread::Current());
+  WriterMutexLock mu(soa.Self(), *Locks::heap_bitmap_lock_);
+  size_t visited = 0;
+  EXPECT_EQ(expected_dirty, card_table->Scan(bitmap.get(), heap_begin, heap_begin + heap_capacity,
+                                             CountObjects(&visited)));
+  EXPECT_EQ(expected_dirty, visited);
+  visited = 0;
+  EXPECT_EQ(expected_dirty + expected_aged,
+            card_table->Scan(bitmap.get(), heap_begin, heap_begin + heap_capacity,
+                             CountObjects(&visited), CardTable::kCardDirty - 1));
+  EXPECT_EQ(expected_dirty + expected_aged, visited);
+}
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
@@ -20,11 +20,27 @@
 #include "mod_union_table.h"
 
 #include "gc/space/space.h"
+#include "space_bitmap-inl.h"
+#include "utils.h"
 
 namespace art {
 namespace gc {
 namespace accounting {
 
+template <typename Visitor>
+inline void ModUnionTable::CardBitmap::VisitSetCards(const Visitor& visitor) const {
+  for (size_t i = SpaceBitmap::FindNonZeroWord(bitmap_begin_, words_begin_, words_end_);
+       i < words_end_; i = SpaceBitmap::FindNonZeroWord(bitmap_begin_, i + 1, words_end_)) {
+    uword w = bitmap_begin_[i];
+    byte* const card_base = cards_begin_ + i * kBitsPerWord;
+    do {
+      const size_t shift = CTZ(w);
+      visitor(card_base + shift);
+      w &= w - 1;
+    } while (w != 0);
+  }
+}
+
 // A mod-union table to record image references to the Zygote and alloc space.
 class ModUnionTableToZygoteAllocspace : public ModUnionTableReferenceCache {
  public:
@@ -16,6 +16,8 @@
 
 #include "mod_union_table.h"
 
+#include <sys/mman.h>
+
 #include "base/stl_util.h"
 #include "card_table-inl.h"
 #include "heap_bitmap.h"
@@ -26,9 +28,11 @@
 #include "mirror/object-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object_array-inl.h"
+#include "mod_union_table-inl.h"
 #include "space_bitmap-inl.h"
 #include "thread.h"
 #include "UniquePtr.h"
+#include "utils.h"
 
 using ::art::mirror::Object;
 
@@ -36,20 +40,69 @@ namespace art {
 namespace gc {
 namespace accounting {
 
+ModUnionTable::CardBitmap::CardBitmap(CardTable* card_table)
+    : cards_begin_(card_table->Begin()),
+      mem_map_(MemMap::MapAnonymous("mod-union table card bitmap", NULL,
+                                    RoundUp(card_table->End() - card_table->Begin(),
+                                            kBitsPerWord) / kBitsPerByte,
+                                    PROT_READ | PROT_WRITE)),
+      bitmap_begin_(mem_map_.get() != NULL ? reinterpret_cast<word*>(mem_map_->Begin()) : NULL),
+      num_words_(RoundUp(card_table->End() - card_table->Begin(), kBitsPerWord) / kBitsPerWord),
+      words_begin_(num_words_),
+      words_end_(0) {
+  CHECK(bitmap_begin_ != NULL) << "Failed to allocate mod-union table card bitmap";
+}
+
+size_t ModUnionTable::CardBitmap::Count() const {
+  size_t count = 0;
+  for (size_t i = words_begin_; i < words_end_; ++i) {
+    count += CountOneBits(bitmap_begin_[i]);
+  }
+  return count;
+}
+
+void ModUnionTable::CardBitmap::ClearAll() {
+  if (words_begin_ < words_end_) {
+    // Give the pages back rather than zeroing them, most tables are touched in a few places.
+    uintptr_t begin = reinterpret_cast<uintptr_t>(&bitmap_begin_[words_begin_]);
+    uintptr_t end = reinterpret_cast<uintptr_t>(&bitmap_begin_[words_end_]);
+    uintptr_t page_begin = RoundUp(begin, kPageSize);
+    uintptr_t page_end = RoundDown(end, kPageSize);
+    if (page_begin < page_end) {
+      memset(reinterpret_cast<void*>(begin), 0, page_begin - begin);
+      madvise(reinterpret_cast<void*>(page_begin), page_end - page_begin, MADV_DONTNEED);
+      memset(reinterpret_cast<void*>(page_end), 0, end - page_end);
+    } else {
+      memset(reinterpret_cast<void*>(begin), 0, end - begin);
+    }
+  }
+  words_begin_ = num_words_;
+  words_end_ = 0;
+}
+
+size_t ModUnionTable::CardBitmap::GetMemoryUsage() const {
+  if (words_begin_ >= words_end_) {
+    return 0;
+  }
+  uintptr_t begin = reinterpret_cast<uintptr_t>(&bitmap_begin_[words_begin_]);
+  uintptr_t end = reinterpret_cast<uintptr_t>(&bitmap_begin_[words_end_]);
+  return RoundUp(end, kPageSize) - RoundDown(begin, kPageSize);
+}
+
 class ModUnionClearCardSetVisitor {
  public:
-  explicit ModUnionClearCardSetVisitor(ModUnionTable::CardSet* const cleared_cards)
+  explicit ModUnionClearCardSetVisitor(ModUnionTable::CardBitmap* const cleared_cards)
     : cleared_cards_(cleared_cards) {
   }
 
   inline void operator()(byte* card, byte expected_value, byte new_value) const {
     if (expected_value == CardTable::kCardDirty) {
-      cleared_cards_->insert(card);
+      cleared_cards_->Set(card);
     }
   }
 
  private:
-  ModUnionTable::CardSet* const cleared_cards_;
+  ModUnionTable::CardBitmap* const cleared_cards_;
 };
 
 class ModUnionClearCardVisitor {
@@ -83,6 +136,10 @@ class ModUnionScanImageRootVisitor {
   collector::MarkSweep* const mark_sweep_;
 };
 
+ModUnionTableReferenceCache::ModUnionTableReferenceCache(Heap* heap)
+    : ModUnionTable(heap), cleared_cards_(heap->GetCardTable()) {
+}
+
 void ModUnionTableReferenceCache::ClearCards(space::ContinuousSpace* space) {
   CardTable* card_table = GetHeap()->GetCardTable();
   ModUnionClearCardSetVisitor visitor(&cleared_cards_);
@@ -215,11 +272,11 @@ void ModUnionTableReferenceCache::Verify() {
 void ModUnionTableReferenceCache::Dump(std::ostream& os) {
   CardTable* card_table = heap_->GetCardTable();
   os << "ModUnionTable cleared cards: [";
-  for (byte* card_addr : cleared_cards_) {
+  cleared_cards_.VisitSetCards([card_table, &os](const byte* card_addr) {
     uintptr_t start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card_addr));
     uintptr_t end = start + CardTable::kCardSize;
     os << reinterpret_cast<void*>(start) << "-" << reinterpret_cast<void*>(end) << ",";
-  }
+  });
   os << "]\nModUnionTable references: [";
   for (const std::pair<const byte*, std::vector<const Object*> >& it : references_) {
     const byte* card_addr = it.first;
@@ -233,6 +290,15 @@ void ModUnionTableReferenceCache::Dump(std::ostream& os) {
   }
 }
 
+size_t ModUnionTableReferenceCache::GetMemoryUsage() const {
+  // Approximates each map node as the entry plus the three links and the color of the tree.
+  size_t usage = cleared_cards_.GetMemoryUsage();
+  for (const std::pair<const byte*, std::vector<const Object*> >& it : references_) {
+    usage += sizeof(it) + 4 * sizeof(void*) + it.second.capacity() * sizeof(const Object*);
+  }
+  return usage;
+}
+
 void ModUnionTableReferenceCache::Update() {
   Heap* heap = GetHeap();
   CardTable* card_table = heap->GetCardTable();
@@ -240,7 +306,7 @@ void ModUnionTableReferenceCache::Update() {
   std::vector<const Object*> cards_references;
   ModUnionReferenceVisitor visitor(this, &cards_references);
 
-  for (const auto& card : cleared_cards_) {
+  cleared_cards_.VisitSetCards([&](const byte* card) NO_THREAD_SAFETY_ANALYSIS {
     // Clear and re-compute alloc space references associated with this card.
     cards_references.clear();
     uintptr_t start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card));
@@ -255,14 +321,14 @@ void ModUnionTableReferenceCache::Update() {
     if (found == references_.end()) {
       if (cards_references.empty()) {
         // No reason to add empty array.
-        continue;
+        return;
       }
       references_.Put(card, cards_references);
     } else {
       found->second = cards_references;
     }
-  }
-  cleared_cards_.clear();
+  });
+  cleared_cards_.ClearAll();
 }
 
 void ModUnionTableReferenceCache::MarkReferences(collector::MarkSweep* mark_sweep) {
@@ -279,6 +345,10 @@ void ModUnionTableReferenceCache::MarkReferences(collector::MarkSweep* mark_swee
   }
 }
 
+ModUnionTableCardCache::ModUnionTableCardCache(Heap* heap)
+    : ModUnionTable(heap), cleared_cards_(heap->GetCardTable()) {
+}
+
 void ModUnionTableCardCache::ClearCards(space::ContinuousSpace* space) {
   CardTable* card_table = GetHeap()->GetCardTable();
   ModUnionClearCardSetVisitor visitor(&cleared_cards_);
@@ -292,7 +362,7 @@ void ModUnionTableCardCache::MarkReferences(collector::MarkSweep* mark_sweep) {
   ModUnionScanImageRootVisitor visitor(mark_sweep);
   space::ContinuousSpace* space = nullptr;
   SpaceBitmap* bitmap = nullptr;
-  for (const byte* card_addr : cleared_cards_) {
+  cleared_cards_.VisitSetCards([&](const byte* card_addr) NO_THREAD_SAFETY_ANALYSIS {
     auto start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card_addr));
     auto end = start + CardTable::kCardSize;
     auto obj_start = reinterpret_cast<Object*>(start);
@@ -303,20 +373,24 @@ void ModUnionTableCardCache::MarkReferences(collector::MarkSweep* mark_sweep) {
       DCHECK(bitmap != nullptr);
     }
     bitmap->VisitMarkedRange(start, end, visitor);
-  }
+  });
 }
 
 void ModUnionTableCardCache::Dump(std::ostream& os) {
   CardTable* card_table = heap_->GetCardTable();
   os << "ModUnionTable dirty cards: [";
-  for (const byte* card_addr : cleared_cards_) {
+  cleared_cards_.VisitSetCards([card_table, &os](const byte* card_addr) {
     auto start = reinterpret_cast<uintptr_t>(card_table->AddrFromCard(card_addr));
     auto end = start + CardTable::kCardSize;
     os << reinterpret_cast<void*>(start) << "-" << reinterpret_cast<void*>(end) << ",";
-  }
+  });
   os << "]";
 }
 
+size_t ModUnionTableCardCache::GetMemoryUsage() const {
+  return cleared_cards_.GetMemoryUsage();
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
@@ -17,10 +17,14 @@
 #ifndef ART_RUNTIME_GC_ACCOUNTING_MOD_UNION_TABLE_H_
 #define ART_RUNTIME_GC_ACCOUNTING_MOD_UNION_TABLE_H_
 
+#include "base/logging.h"
 #include "gc_allocator.h"
 #include "globals.h"
+#include "mem_map.h"
 #include "safe_map.h"
+#include "UniquePtr.h"
 
+#include <algorithm>
 #include <set>
 #include <vector>
 
@@ -43,6 +47,7 @@ class Heap;
 
 namespace accounting {
 
+class CardTable;
 class SpaceBitmap;
 class HeapBitmap;
 
@@ -50,7 +55,51 @@ class HeapBitmap;
 // cleared between GC phases, reducing the number of dirty cards that need to be scanned.
 class ModUnionTable {
  public:
-  typedef std::set<byte*, std::less<byte*>, GCAllocator<byte*> > CardSet;
+  // A bit for each card of the card table, used in place of a CardSet for the cards a table has to
+  // look at again. The bitmap is an anonymous mapping so only the pages covering the cards that
+  // were set get committed, these are tracked to bound visits and report the memory used.
+  class CardBitmap {
+   public:
+    explicit CardBitmap(CardTable* card_table);
+
+    void Set(const byte* card) {
+      const size_t index = card - cards_begin_;
+      DCHECK_LT(index / kBitsPerWord, num_words_);
+      const size_t word_index = index / kBitsPerWord;
+      bitmap_begin_[word_index] |= static_cast<word>(1) << (index % kBitsPerWord);
+      words_begin_ = std::min(words_begin_, word_index);
+      words_end_ = std::max(words_end_, word_index + 1);
+    }
+
+    bool Test(const byte* card) const {
+      const size_t index = card - cards_begin_;
+      DCHECK_LT(index / kBitsPerWord, num_words_);
+      const word mask = static_cast<word>(1) << (index % kBitsPerWord);
+      return (bitmap_begin_[index / kBitsPerWord] & mask) != 0;
+    }
+
+    // Calls visitor with every set card in address order.
+    template <typename Visitor>
+    void VisitSetCards(const Visitor& visitor) const;
+
+    size_t Count() const;
+
+    void ClearAll();
+
+    // The bytes of the bitmap that got committed for the cards that were set.
+    size_t GetMemoryUsage() const;
+
+   private:
+    byte* const cards_begin_;
+    UniquePtr<MemMap> mem_map_;
+    word* const bitmap_begin_;
+    const size_t num_words_;
+    // The range of words with bits set since the last ClearAll.
+    size_t words_begin_;
+    size_t words_end_;
+
+    DISALLOW_COPY_AND_ASSIGN(CardBitmap);
+  };
 
   explicit ModUnionTable(Heap* heap) : heap_(heap) {}
 
@@ -76,6 +125,9 @@ class ModUnionTable {
 
   virtual void Dump(std::ostream& os) = 0;
 
+  // Bytes used by the bookkeeping of the table.
+  virtual size_t GetMemoryUsage() const = 0;
+
   Heap* GetHeap() const {
     return heap_;
   }
@@ -87,7 +139,7 @@ class ModUnionTable {
 // Reference caching implementation. Caches references pointing to alloc space(s) for each card.
 class ModUnionTableReferenceCache : public ModUnionTable {
  public:
-  explicit ModUnionTableReferenceCache(Heap* heap) : ModUnionTable(heap) {}
+  explicit ModUnionTableReferenceCache(Heap* heap);
   virtual ~ModUnionTableReferenceCache() {}
 
   // Clear and store cards for a space.
@@ -112,9 +164,11 @@ class ModUnionTableReferenceCache : public ModUnionTable {
 
   void Dump(std::ostream& os);
 
+  size_t GetMemoryUsage() const;
+
  protected:
-  // Cleared card array, used to update the mod-union table.
-  ModUnionTable::CardSet cleared_cards_;
+  // Cleared cards, used to update the mod-union table.
+  CardBitmap cleared_cards_;
 
   // Maps from dirty cards to their corresponding alloc space references.
   SafeMap<const byte*, std::vector<const mirror::Object*>, std::less<const byte*>,
@@ -124,7 +178,7 @@ class ModUnionTableReferenceCache : public ModUnionTable {
 // Card caching implementation. Keeps track of which cards we cleared and only this information.
 class ModUnionTableCardCache : public ModUnionTable {
  public:
-  explicit ModUnionTableCardCache(Heap* heap) : ModUnionTable(heap) {}
+  explicit ModUnionTableCardCache(Heap* heap);
   virtual ~ModUnionTableCardCache() {}
 
   // Clear and store cards for a space.
@@ -143,9 +197,11 @@ class ModUnionTableCardCache : public ModUnionTable {
 
   void Dump(std::ostream& os);
 
+  size_t GetMemoryUsage() const;
+
  protected:
-  // Cleared card array, used to update the mod-union table.
-  CardSet cleared_cards_;
+  // Cleared cards, used to update the mod-union table.
+  CardBitmap cleared_cards_;
 };
 
 }  // namespace accounting
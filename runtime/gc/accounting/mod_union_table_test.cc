@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mod_union_table.h"
+
+#include <vector>
+
+#include "card_table.h"
+#include "common_test.h"
+#include "gc/heap.h"
+#include "globals.h"
+#include "mod_union_table-inl.h"
+#include "UniquePtr.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+class ModUnionTableTest : public CommonTest {
+ public:
+};
+
+TEST_F(ModUnionTableTest, CardBitmap) {
+  byte* heap_begin = reinterpret_cast<byte*>(0x10000000);
+  size_t heap_capacity = 64 * MB;
+  UniquePtr<CardTable> card_table(CardTable::Create(heap_begin, heap_capacity));
+  ASSERT_TRUE(card_table.get() != NULL);
+  ModUnionTable::CardBitmap cleared_cards(card_table.get());
+  EXPECT_EQ(0U, cleared_cards.Count());
+  EXPECT_EQ(0U, cleared_cards.GetMemoryUsage());
+
+  // Cards at both ends of the table, on both sides of word and page boundaries, out of order.
+  std::vector<byte*> expected;
+  const size_t offsets[] = { 0, 31, 32, 33, 1000, 4095, 4096, 40000 };
+  for (size_t i = 0; i < arraysize(offsets); ++i) {
+    expected.push_back(card_table->CardFromAddr(heap_begin + offsets[i] * CardTable::kCardSize));
+  }
+  expected.push_back(card_table->CardFromAddr(heap_begin + heap_capacity - 1));
+  for (size_t i = expected.size(); i != 0; --i) {
+    cleared_cards.Set(expected[i - 1]);
+  }
+  cleared_cards.Set(expected[3]);  // Setting a card twice has no effect.
+  EXPECT_EQ(expected.size(), cleared_cards.Count());
+  std::vector<byte*> visited;
+  cleared_cards.VisitSetCards([&visited](byte* card) {
+    visited.push_back(card);
+  });
+  EXPECT_TRUE(visited == expected);
+  EXPECT_TRUE(cleared_cards.Test(expected[4]));
+  EXPECT_FALSE(cleared_cards.Test(expected[4] + 1));
+  EXPECT_NE(0U, cleared_cards.GetMemoryUsage());
+
+  cleared_cards.ClearAll();
+  EXPECT_EQ(0U, cleared_cards.Count());
+  EXPECT_EQ(0U, cleared_cards.GetMemoryUsage());
+  for (byte* card : expected) {
+    EXPECT_FALSE(cleared_cards.Test(card));
+  }
+}
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
@@ -21,10 +21,73 @@
 #include "cutils/atomic-inline.h"
 #include "utils.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 namespace art {
 namespace gc {
 namespace accounting {
 
+// Bitmap words covered by one 16 byte vector.
+static const size_t kWordsPerVector = 16 / kWordSize;
+
+inline size_t SpaceBitmap::FindNonZeroWord(const word* bitmap, size_t begin, size_t end) {
+  size_t i = begin;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + kWordsPerVector <= end; i += kWordsPerVector) {
+    __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&bitmap[i]));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(words, zero)) != 0xFFFF) {
+      break;  // Let the scalar loop find the word.
+    }
+  }
+#elif defined(__ARM_NEON__)
+  for (; i + kWordsPerVector <= end; i += kWordsPerVector) {
+    uint64x2_t words =
+        vreinterpretq_u64_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(&bitmap[i])));
+    if ((vgetq_lane_u64(words, 0) | vgetq_lane_u64(words, 1)) != 0) {
+      break;
+    }
+  }
+#endif
+  while (i < end && bitmap[i] == 0) {
+    ++i;
+  }
+  return i;
+}
+
+inline size_t SpaceBitmap::FindGarbageWord(const word* live, const word* mark, size_t begin,
+                                           size_t end) {
+  size_t i = begin;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + kWordsPerVector <= end; i += kWordsPerVector) {
+    __m128i live_words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&live[i]));
+    __m128i mark_words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mark[i]));
+    __m128i garbage = _mm_andnot_si128(mark_words, live_words);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(garbage, zero)) != 0xFFFF) {
+      break;
+    }
+  }
+#elif defined(__ARM_NEON__)
+  for (; i + kWordsPerVector <= end; i += kWordsPerVector) {
+    uint8x16_t live_words = vld1q_u8(reinterpret_cast<const uint8_t*>(&live[i]));
+    uint8x16_t mark_words = vld1q_u8(reinterpret_cast<const uint8_t*>(&mark[i]));
+    uint64x2_t garbage = vreinterpretq_u64_u8(vbicq_u8(live_words, mark_words));
+    if ((vgetq_lane_u64(garbage, 0) | vgetq_lane_u64(garbage, 1)) != 0) {
+      break;
+    }
+  }
+#endif
+  while (i < end && (live[i] & ~mark[i]) == 0) {
+    ++i;
+  }
+  return i;
+}
+
 inline bool SpaceBitmap::AtomicTestAndSet(const mirror::Object* obj) {
   uintptr_t addr = reinterpret_cast<uintptr_t>(obj);
   DCHECK_GE(addr, heap_begin_);
@@ -85,17 +148,17 @@ void SpaceBitmap::VisitMarkedRange(uintptr_t visit_begin, uintptr_t visit_end,
   }
   word_start++;
 
-  for (size_t i = word_start; i < word_end; i++) {
+  // Marked objects are sparse in most ranges, skip the empty words in bulk.
+  for (size_t i = FindNonZeroWord(bitmap_begin_, word_start, word_end); i < word_end;
+       i = FindNonZeroWord(bitmap_begin_, i + 1, word_end)) {
     size_t w = bitmap_begin_[i];
-    if (w != 0) {
-      uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
-      do {
-        const size_t shift = CLZ(w);
-        mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-        visitor(obj);
-        w ^= static_cast<size_t>(kWordHighBitMask) >> shift;
-      } while (w != 0);
-    }
+    uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
+    do {
+      const size_t shift = CLZ(w);
+      mirror::Object* obj = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
+      visitor(obj);
+      w ^= static_cast<size_t>(kWordHighBitMask) >> shift;
+    } while (w != 0);
   }
 
   // Handle the right edge, and also the left edge if both edges are on the same word.
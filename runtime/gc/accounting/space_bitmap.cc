@@ -54,15 +54,26 @@ SpaceBitmap* SpaceBitmap::CreateFromMemMap(const std::string& name, MemMap* mem_
                                            byte* heap_begin, size_t heap_capacity) {
   CHECK(mem_map != nullptr);
   word* bitmap_begin = reinterpret_cast<word*>(mem_map->Begin());
-  size_t bitmap_size = OffsetToIndex(RoundUp(heap_capacity, kAlignment * kBitsPerWord)) * kWordSize;
+  size_t bitmap_size = ComputeSize(heap_capacity);
   return new SpaceBitmap(name, mem_map, bitmap_begin, bitmap_size, heap_begin);
 }
 
-SpaceBitmap* SpaceBitmap::Create(const std::string& name, byte* heap_begin, size_t heap_capacity) {
-  CHECK(heap_begin != NULL);
+size_t SpaceBitmap::ComputeSize(size_t heap_capacity) {
   // Round up since heap_capacity is not necessarily a multiple of kAlignment * kBitsPerWord.
-  size_t bitmap_size = OffsetToIndex(RoundUp(heap_capacity, kAlignment * kBitsPerWord)) * kWordSize;
-  UniquePtr<MemMap> mem_map(MemMap::MapAnonymous(name.c_str(), NULL, bitmap_size, PROT_READ | PROT_WRITE));
+  return OffsetToIndex(RoundUp(heap_capacity, kAlignment * kBitsPerWord)) * kWordSize;
+}
+
+SpaceBitmap* SpaceBitmap::Create(const std::string& name, byte* heap_begin, size_t heap_capacity,
+                                 MemMap* reservation) {
+  CHECK(heap_begin != NULL);
+  size_t bitmap_size = ComputeSize(heap_capacity);
+  UniquePtr<MemMap> mem_map;
+  if (reservation != NULL) {
+    mem_map.reset(reservation->CarveAnonymous(name.c_str(), bitmap_size, PROT_READ | PROT_WRITE));
+  }
+  if (mem_map.get() == NULL) {
+    mem_map.reset(MemMap::MapAnonymous(name.c_str(), NULL, bitmap_size, PROT_READ | PROT_WRITE));
+  }
   if (mem_map.get() == NULL) {
     LOG(ERROR) << "Failed to allocate bitmap " << name;
     return NULL;
@@ -142,7 +153,9 @@ void SpaceBitmap::SweepWalk(const SpaceBitmap& live_bitmap,
   }
 
   // TODO: rewrite the callbacks to accept a std::vector<mirror::Object*> rather than a mirror::Object**?
-  const size_t buffer_size = kWordSize * kBitsPerWord;
+  // Each callback takes the space's lock to free its batch, so make the batches a few hundred
+  // objects long.
+  const size_t buffer_size = 16 * kBitsPerWord;
   mirror::Object* pointer_buf[buffer_size];
   mirror::Object** pb = &pointer_buf[0];
   size_t start = OffsetToIndex(sweep_begin - live_bitmap.heap_begin_);
@@ -150,21 +163,21 @@ void SpaceBitmap::SweepWalk(const SpaceBitmap& live_bitmap,
   CHECK_LT(end, live_bitmap.Size() / kWordSize);
   word* live = live_bitmap.bitmap_begin_;
   word* mark = mark_bitmap.bitmap_begin_;
-  for (size_t i = start; i <= end; i++) {
+  // Most of the space survives or was never allocated, skip words without garbage in bulk.
+  for (size_t i = FindGarbageWord(live, mark, start, end + 1); i <= end;
+       i = FindGarbageWord(live, mark, i + 1, end + 1)) {
     word garbage = live[i] & ~mark[i];
-    if (UNLIKELY(garbage != 0)) {
-      uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
-      do {
-        const size_t shift = CLZ(garbage);
-        garbage ^= static_cast<size_t>(kWordHighBitMask) >> shift;
-        *pb++ = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
-      } while (garbage != 0);
-      // Make sure that there are always enough slots available for an
-      // entire word of one bits.
-      if (pb >= &pointer_buf[buffer_size - kBitsPerWord]) {
-        (*callback)(pb - &pointer_buf[0], &pointer_buf[0], arg);
-        pb = &pointer_buf[0];
-      }
+    uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
+    do {
+      const size_t shift = CLZ(garbage);
+      garbage ^= static_cast<size_t>(kWordHighBitMask) >> shift;
+      *pb++ = reinterpret_cast<mirror::Object*>(ptr_base + shift * kAlignment);
+    } while (garbage != 0);
+    // Make sure that there are always enough slots available for an
+    // entire word of one bits.
+    if (pb >= &pointer_buf[buffer_size - kBitsPerWord]) {
+      (*callback)(pb - &pointer_buf[0], &pointer_buf[0], arg);
+      pb = &pointer_buf[0];
     }
   }
   if (pb > &pointer_buf[0]) {
@@ -50,7 +50,12 @@ class SpaceBitmap {
 
   // Initialize a space bitmap so that it points to a bitmap large enough to cover a heap at
   // heap_begin of heap_capacity bytes, where objects are guaranteed to be kAlignment-aligned.
-  static SpaceBitmap* Create(const std::string& name, byte* heap_begin, size_t heap_capacity);
+  // The bitmap is carved from reservation if it isn't NULL and has room for it.
+  static SpaceBitmap* Create(const std::string& name, byte* heap_begin, size_t heap_capacity,
+                             MemMap* reservation = NULL);
+
+  // Size in bytes of the bitmap of a heap of heap_capacity bytes.
+  static size_t ComputeSize(size_t heap_capacity);
 
   // Initialize a space bitmap using the provided mem_map as the live bits. Takes ownership of the
   // mem map. The address range covered starts at heap_begin and is of size equal to heap_capacity.
@@ -138,6 +143,14 @@ class SpaceBitmap {
   static void SweepWalk(const SpaceBitmap& live, const SpaceBitmap& mark, uintptr_t base,
                         uintptr_t max, SweepCallback* thunk, void* arg);
 
+  // Returns the index of the first word in [begin, end) of bitmap with a bit set, end if there is
+  // none. Checks 16 bytes at a time with SSE2 or NEON when the runtime is built for them.
+  static size_t FindNonZeroWord(const word* bitmap, size_t begin, size_t end);
+
+  // Returns the index of the first word in [begin, end) with a bit set in live but not in mark,
+  // end if there is none. Vectorized like FindNonZeroWord.
+  static size_t FindGarbageWord(const word* live, const word* mark, size_t begin, size_t end);
+
   void CopyFrom(SpaceBitmap* source_bitmap);
 
   // Starting address of our internal storage.
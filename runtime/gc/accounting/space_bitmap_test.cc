@@ -22,6 +22,7 @@
 #include "UniquePtr.h"
 
 #include <stdint.h>
+#include <vector>
 
 namespace art {
 namespace gc {
@@ -88,6 +89,107 @@ TEST_F(SpaceBitmapTest, ScanRange) {
   }
 }
 
+class CountVisitor {
+ public:
+  explicit CountVisitor(std::vector<const mirror::Object*>* visited) : visited_(visited) {}
+
+  void operator()(const mirror::Object* obj) const {
+    visited_->push_back(obj);
+  }
+
+  std::vector<const mirror::Object*>* const visited_;
+};
+
+TEST_F(SpaceBitmapTest, VisitSparseMarkedRange) {
+  byte* heap_begin = reinterpret_cast<byte*>(0x10000000);
+  size_t heap_capacity = 16 * MB;
+  UniquePtr<SpaceBitmap> space_bitmap(SpaceBitmap::Create("test bitmap",
+                                                          heap_begin, heap_capacity));
+  ASSERT_TRUE(space_bitmap.get() != NULL);
+
+  // Marks spread out so that whole vectors of words are empty, with some next to the edges.
+  std::vector<const mirror::Object*> expected;
+  const size_t offsets[] = { 8, 1000, 1008, 4096, 64 * KB - 8, 64 * KB, 1 * MB + 24, 2 * MB - 8 };
+  for (size_t i = 0; i < arraysize(offsets); ++i) {
+    const mirror::Object* obj = reinterpret_cast<mirror::Object*>(heap_begin + offsets[i]);
+    space_bitmap->Set(obj);
+    expected.push_back(obj);
+  }
+  std::vector<const mirror::Object*> visited;
+  space_bitmap->VisitMarkedRange(reinterpret_cast<uintptr_t>(heap_begin),
+                                 reinterpret_cast<uintptr_t>(heap_begin + 2 * MB),
+                                 CountVisitor(&visited));
+  EXPECT_TRUE(visited == expected);
+
+  // Ranges that start and end in the middle of words.
+  visited.clear();
+  space_bitmap->VisitMarkedRange(reinterpret_cast<uintptr_t>(heap_begin + 1008),
+                                 reinterpret_cast<uintptr_t>(heap_begin + 64 * KB),
+                                 CountVisitor(&visited));
+  ASSERT_EQ(3U, visited.size());
+  EXPECT_EQ(expected[2], visited[0]);
+  EXPECT_EQ(expected[4], visited[2]);
+}
+
+TEST_F(SpaceBitmapTest, FindGarbageWord) {
+  const size_t kNumWords = 64;
+  word live[kNumWords];
+  word mark[kNumWords];
+  for (size_t i = 0; i < kNumWords; ++i) {
+    live[i] = static_cast<word>(0x5A5A5A5A);
+    mark[i] = static_cast<word>(0x5A5A5A5A);
+  }
+  EXPECT_EQ(kNumWords, SpaceBitmap::FindGarbageWord(live, mark, 0, kNumWords));
+  EXPECT_EQ(kNumWords, SpaceBitmap::FindNonZeroWord(mark, kNumWords, kNumWords));
+  // Marked objects that aren't live aren't garbage.
+  mark[3] |= 1;
+  EXPECT_EQ(kNumWords, SpaceBitmap::FindGarbageWord(live, mark, 0, kNumWords));
+  for (size_t garbage = 0; garbage < kNumWords; ++garbage) {
+    mark[garbage] &= ~static_cast<word>(0x40);
+    for (size_t begin = 0; begin <= garbage; ++begin) {
+      ASSERT_EQ(garbage, SpaceBitmap::FindGarbageWord(live, mark, begin, kNumWords));
+    }
+    EXPECT_EQ(garbage, SpaceBitmap::FindGarbageWord(live, mark, 0, garbage));
+    mark[garbage] |= 0x40;
+  }
+}
+
+static void RecordSweptObjects(size_t ptr_count, mirror::Object** ptrs, void* arg) {
+  std::vector<mirror::Object*>* swept = reinterpret_cast<std::vector<mirror::Object*>*>(arg);
+  swept->insert(swept->end(), ptrs, ptrs + ptr_count);
+}
+
+TEST_F(SpaceBitmapTest, SweepWalk) {
+  byte* heap_begin = reinterpret_cast<byte*>(0x10000000);
+  size_t heap_capacity = 16 * MB;
+  UniquePtr<SpaceBitmap> live_bitmap(SpaceBitmap::Create("live bitmap",
+                                                         heap_begin, heap_capacity));
+  UniquePtr<SpaceBitmap> mark_bitmap(SpaceBitmap::Create("mark bitmap",
+                                                         heap_begin, heap_capacity));
+  ASSERT_TRUE(live_bitmap.get() != NULL);
+  ASSERT_TRUE(mark_bitmap.get() != NULL);
+
+  // Every object in the first 4MB is live, all but every 37th survives. Enough die to need
+  // several callbacks.
+  std::vector<mirror::Object*> expected;
+  const size_t num_objects = 4 * MB / SpaceBitmap::kAlignment;
+  for (size_t i = 0; i < num_objects; ++i) {
+    mirror::Object* obj =
+        reinterpret_cast<mirror::Object*>(heap_begin + i * SpaceBitmap::kAlignment);
+    live_bitmap->Set(obj);
+    if (i % 37 == 0) {
+      expected.push_back(obj);
+    } else {
+      mark_bitmap->Set(obj);
+    }
+  }
+  std::vector<mirror::Object*> swept;
+  SpaceBitmap::SweepWalk(*live_bitmap, *mark_bitmap, reinterpret_cast<uintptr_t>(heap_begin),
+                         reinterpret_cast<uintptr_t>(heap_begin + heap_capacity),
+                         RecordSweptObjects, &swept);
+  EXPECT_TRUE(swept == expected);
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
+#define ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
+
+#include <string>
+
+#include "atomic_integer.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "cutils/atomic-inline.h"
+#include "UniquePtr.h"
+#include "mem_map.h"
+#include "utils.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+// A fixed capacity Chase-Lev work stealing deque. The owning thread pushes and pops at the bottom
+// like a stack, any other thread may steal from the top. Storage is a circular buffer in an
+// anonymous mapping, like AtomicStack. The indices only grow, Reset must be called between uses.
+template <typename T>
+class WorkStealingDeque {
+ public:
+  // Capacity is how many elements the deque can hold and must be a power of two.
+  static WorkStealingDeque* Create(const std::string& name, size_t capacity) {
+    CHECK(IsPowerOfTwo(capacity)) << capacity;
+    UniquePtr<WorkStealingDeque> deque(new WorkStealingDeque(name, capacity));
+    deque->Init();
+    return deque.release();
+  }
+
+  ~WorkStealingDeque() {}
+
+  // Not safe to call while other threads access the deque.
+  void Reset() {
+    top_ = 0;
+    bottom_ = 0;
+  }
+
+  // Owner only. Returns false if the deque is full.
+  bool PushBottom(const T& value) {
+    const int32_t bottom = bottom_.load();
+    if (UNLIKELY(static_cast<size_t>(bottom - top_.load()) >= capacity_)) {
+      return false;
+    }
+    begin_[bottom & mask_] = value;
+    // Publish the element before thieves can see the new bottom.
+    android_memory_barrier();
+    bottom_ = bottom + 1;
+    return true;
+  }
+
+  // Owner only. Returns false if the deque is empty or a thief took the last element.
+  bool PopBottom(T* value) {
+    const int32_t bottom = bottom_.load() - 1;
+    bottom_ = bottom;
+    // The store to bottom must be visible before we read top, otherwise a thief and the owner may
+    // both take the last element.
+    android_memory_barrier();
+    const int32_t top = top_.load();
+    if (top > bottom) {
+      bottom_ = top;
+      return false;
+    }
+    *value = begin_[bottom & mask_];
+    if (top != bottom) {
+      return true;
+    }
+    // Last element, race the thieves for it.
+    const bool won = top_.compare_and_swap(top, top + 1);
+    bottom_ = top + 1;
+    return won;
+  }
+
+  // Any thread. Returns false if the deque is empty or we lost a race with another thread.
+  bool Steal(T* value) {
+    const int32_t top = top_.load();
+    android_memory_barrier();
+    const int32_t bottom = bottom_.load();
+    if (top >= bottom) {
+      return false;
+    }
+    T result = begin_[top & mask_];
+    if (!top_.compare_and_swap(top, top + 1)) {
+      return false;
+    }
+    *value = result;
+    return true;
+  }
+
+  // Approximate when other threads are accessing the deque.
+  size_t Size() const {
+    const int32_t size = bottom_.load() - top_.load();
+    return size > 0 ? static_cast<size_t>(size) : 0;
+  }
+
+  bool IsEmpty() const {
+    return Size() == 0;
+  }
+
+  size_t Capacity() const {
+    return capacity_;
+  }
+
+ private:
+  WorkStealingDeque(const std::string& name, const size_t capacity)
+      : name_(name),
+        top_(0),
+        bottom_(0),
+        begin_(NULL),
+        capacity_(capacity),
+        mask_(capacity - 1) {
+  }
+
+  void Init() {
+    mem_map_.reset(MemMap::MapAnonymous(name_.c_str(), NULL, capacity_ * sizeof(T),
+                                        PROT_READ | PROT_WRITE));
+    CHECK(mem_map_.get() != NULL) << "couldn't allocate work stealing deque";
+    begin_ = reinterpret_cast<T*>(mem_map_->Begin());
+    CHECK(begin_ != NULL);
+    Reset();
+  }
+
+  // Name of the deque.
+  std::string name_;
+
+  // Memory mapping of the deque.
+  UniquePtr<MemMap> mem_map_;
+
+  // Index of the oldest element, advanced by thieves and by the owner taking the last element.
+  AtomicInteger top_;
+
+  // Index after the newest element, only written by the owner.
+  AtomicInteger bottom_;
+
+  // Base of the circular buffer.
+  T* begin_;
+
+  // Maximum number of elements.
+  const size_t capacity_;
+  const size_t mask_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingDeque);
+};
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "work_stealing_deque.h"
+
+#include <vector>
+
+#include "atomic_integer.h"
+#include "common_test.h"
+#include "thread_pool.h"
+#include "UniquePtr.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+typedef WorkStealingDeque<size_t> SizeDeque;
+
+class WorkStealingDequeTest : public CommonTest {
+};
+
+TEST_F(WorkStealingDequeTest, OwnerIsLifo) {
+  UniquePtr<SizeDeque> deque(SizeDeque::Create("test deque", 4));
+  ASSERT_TRUE(deque.get() != NULL);
+  size_t value = 0;
+  EXPECT_FALSE(deque->PopBottom(&value));
+  EXPECT_FALSE(deque->Steal(&value));
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_TRUE(deque->PushBottom(i));
+  }
+  // Full.
+  EXPECT_FALSE(deque->PushBottom(4));
+  EXPECT_EQ(4U, deque->Size());
+  // Thieves take the oldest element, the owner the newest.
+  EXPECT_TRUE(deque->Steal(&value));
+  EXPECT_EQ(0U, value);
+  EXPECT_TRUE(deque->PopBottom(&value));
+  EXPECT_EQ(3U, value);
+  // The freed slot wraps around.
+  EXPECT_TRUE(deque->PushBottom(5));
+  EXPECT_TRUE(deque->PushBottom(6));
+  EXPECT_FALSE(deque->PushBottom(7));
+  EXPECT_TRUE(deque->PopBottom(&value));
+  EXPECT_EQ(6U, value);
+  EXPECT_TRUE(deque->PopBottom(&value));
+  EXPECT_EQ(5U, value);
+  EXPECT_TRUE(deque->PopBottom(&value));
+  EXPECT_EQ(2U, value);
+  EXPECT_TRUE(deque->PopBottom(&value));
+  EXPECT_EQ(1U, value);
+  EXPECT_FALSE(deque->PopBottom(&value));
+  EXPECT_TRUE(deque->IsEmpty());
+}
+
+class StealTask : public Task {
+ public:
+  StealTask(SizeDeque* deque, AtomicInteger* done, std::vector<size_t>* stolen)
+      : deque_(deque), done_(done), stolen_(stolen) {}
+
+  void Run(Thread* self) {
+    size_t value;
+    while (done_->load() == 0 || !deque_->IsEmpty()) {
+      if (deque_->Steal(&value)) {
+        stolen_->push_back(value);
+      }
+    }
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  SizeDeque* const deque_;
+  AtomicInteger* const done_;
+  std::vector<size_t>* const stolen_;
+};
+
+// Every element pushed is taken exactly once, either by the owner or by one of the thieves.
+TEST_F(WorkStealingDequeTest, ConcurrentSteal) {
+  static const size_t kNumThieves = 4;
+  static const size_t kNumElements = 100000;
+  Thread* self = Thread::Current();
+  UniquePtr<SizeDeque> deque(SizeDeque::Create("test deque", 256));
+  ThreadPool thread_pool(kNumThieves);
+  AtomicInteger done(0);
+  std::vector<size_t> stolen[kNumThieves];
+  for (size_t i = 0; i < kNumThieves; ++i) {
+    thread_pool.AddTask(self, new StealTask(deque.get(), &done, &stolen[i]));
+  }
+  thread_pool.StartWorkers(self);
+  std::vector<size_t> taken_counts(kNumElements, 0);
+  size_t value;
+  for (size_t i = 0; i < kNumElements; ++i) {
+    while (!deque->PushBottom(i)) {
+      if (deque->PopBottom(&value)) {
+        ++taken_counts[value];
+      }
+    }
+    if (i % 3 == 0 && deque->PopBottom(&value)) {
+      ++taken_counts[value];
+    }
+  }
+  while (deque->PopBottom(&value)) {
+    ++taken_counts[value];
+  }
+  done = 1;
+  thread_pool.Wait(self, false, false);
+  for (size_t i = 0; i < kNumThieves; ++i) {
+    for (size_t stolen_value : stolen[i]) {
+      ++taken_counts[stolen_value];
+    }
+  }
+  for (size_t i = 0; i < kNumElements; ++i) {
+    EXPECT_EQ(1U, taken_counts[i]) << i;
+  }
+}
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_site_table.h"
+
+#include <string.h>
+
+#include <ostream>
+
+#include "thread.h"
+
+namespace art {
+namespace gc {
+
+AllocationSiteTable::AllocationSiteTable()
+    : lock_("allocation site table lock"),
+      epoch_(0),
+      allocation_count_(0),
+      tenured_count_(0),
+      untenured_count_(0) {
+  memset(sites_, 0, sizeof(sites_));
+}
+
+void AllocationSiteTable::AddSample(Thread* self, const mirror::ArtMethod* method,
+                                    uint32_t type_idx, mirror::Object* obj, bool tenured) {
+  MutexLock mu(self, lock_);
+  if (pending_samples_.size() >= kMaxPendingSamples) {
+    return;
+  }
+  Site& site = sites_[SiteIndex(method, type_idx)];
+  if (site.method != method || site.type_idx != type_idx) {
+    if (site.tenured) {
+      return;  // A colliding site can only take the slot over once it's no longer tenured.
+    }
+    site.method = method;
+    site.type_idx = type_idx;
+    site.samples = 0;
+    site.survivors = 0;
+  }
+  Sample sample = { obj, method, type_idx, epoch_, tenured };
+  pending_samples_.push_back(sample);
+}
+
+void AllocationSiteTable::StartCollection(Thread* self) {
+  MutexLock mu(self, lock_);
+  ++epoch_;
+}
+
+void AllocationSiteTable::ResolveSamples(Thread* self, IsMarkedTester* is_marked, void* arg,
+                                         bool sticky) {
+  MutexLock mu(self, lock_);
+  // Samples are only tested against the mark bits and never dereferenced, so a sample whose
+  // object was freed without being resolved can only skew the statistics.
+  size_t kept = 0;
+  for (size_t i = 0; i < pending_samples_.size(); ++i) {
+    const Sample& sample = pending_samples_[i];
+    if (sample.epoch >= epoch_ || (sample.tenured && sticky)) {
+      pending_samples_[kept++] = sample;
+    } else {
+      RecordSurvival(sample, is_marked(sample.obj, arg));
+    }
+  }
+  pending_samples_.resize(kept);
+}
+
+void AllocationSiteTable::RecordSurvival(const Sample& sample, bool survived) {
+  Site& site = sites_[SiteIndex(sample.method, sample.type_idx)];
+  if (site.method != sample.method || site.type_idx != sample.type_idx) {
+    return;  // Another site took the slot over.
+  }
+  ++site.samples;
+  if (survived) {
+    ++site.survivors;
+  }
+  if (site.samples < kMinSamples) {
+    return;
+  }
+  uint32_t survival_percent = site.survivors * 100 / site.samples;
+  if (!site.tenured && survival_percent >= kTenurePercent) {
+    site.tenured = true;
+    ++tenured_count_;
+  } else if (site.tenured && survival_percent < kUntenurePercent) {
+    site.tenured = false;
+    ++untenured_count_;
+  }
+  // Decay the history so that sites whose objects change lifetime get re-decided.
+  site.samples /= 2;
+  site.survivors /= 2;
+}
+
+void AllocationSiteTable::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  size_t tenured_sites = 0;
+  for (size_t i = 0; i < kNumSites; ++i) {
+    if (sites_[i].tenured) {
+      ++tenured_sites;
+    }
+  }
+  os << "Pretenuring: " << tenured_sites << " tenured allocation sites, " << tenured_count_
+     << " tenured and " << untenured_count_ << " untenured so far, " << pending_samples_.size()
+     << " pending samples\n";
+}
+
+}  // namespace gc
+}  // namespace art
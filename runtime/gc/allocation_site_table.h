@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ALLOCATION_SITE_TABLE_H_
+#define ART_RUNTIME_GC_ALLOCATION_SITE_TABLE_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "root_visitor.h"
+
+namespace art {
+
+namespace mirror {
+class ArtMethod;
+class Object;
+}  // namespace mirror
+
+class Thread;
+
+namespace gc {
+
+// Survival statistics of allocation sites, enabled with -XX:Pretenure. A site is an allocating
+// instruction of compiled code, identified by its method and the type index it allocates. The
+// quick allocation entrypoints sample one allocation in kSampleInterval and the first GC that
+// starts after a sample records whether the sampled object survived it. Sites whose samples
+// mostly survive are tenured: their allocations bypass the allocation stack, so that sticky GCs
+// treat them as old objects and only partial and full GCs trace and sweep them. A tenured site
+// whose samples stop surviving partial GCs goes back to regular allocation.
+//
+// The allocation path reads the sites without a lock. A racy read can only misdirect an
+// allocation, which changes which kind of GC reclaims it but not whether it is reclaimed.
+class AllocationSiteTable {
+ public:
+  static const size_t kNumSites = 1024;
+  static const size_t kSampleInterval = 32;
+  // Samples taken while this many are waiting for a GC are dropped.
+  static const size_t kMaxPendingSamples = 4096;
+  // Samples a site needs before it is tenured or untenured.
+  static const uint32_t kMinSamples = 16;
+  // Percentages of surviving samples at or above which a site is tenured, and below which a
+  // tenured site no longer is.
+  static const uint32_t kTenurePercent = 90;
+  static const uint32_t kUntenurePercent = 50;
+
+  AllocationSiteTable();
+
+  bool IsTenured(const mirror::ArtMethod* method, uint32_t type_idx) const {
+    const Site& site = sites_[SiteIndex(method, type_idx)];
+    return site.tenured && site.method == method && site.type_idx == type_idx;
+  }
+
+  // Returns true if the allocation being made should be sampled. The count is racy, lost updates
+  // just make samples a little rarer.
+  bool ShouldSample() {
+    return ++allocation_count_ % kSampleInterval == 0;
+  }
+
+  // Records that obj was allocated at the site of method and type_idx, tenured if it was
+  // allocated on the tenured path.
+  void AddSample(Thread* self, const mirror::ArtMethod* method, uint32_t type_idx,
+                 mirror::Object* obj, bool tenured)
+      LOCKS_EXCLUDED(lock_);
+
+  // Called when a GC starts, samples taken from now on are resolved by the next GC.
+  void StartCollection(Thread* self) LOCKS_EXCLUDED(lock_);
+
+  // Resolves the samples taken before the current GC started, before it sweeps, is_marked
+  // telling whether they survived. A sticky GC keeps the samples of tenured sites for the next
+  // partial or full GC since it doesn't collect tenured objects.
+  void ResolveSamples(Thread* self, IsMarkedTester* is_marked, void* arg, bool sticky)
+      SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      LOCKS_EXCLUDED(lock_);
+
+  void Dump(std::ostream& os) LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct Site {
+    const mirror::ArtMethod* method;
+    uint32_t type_idx;
+    uint32_t samples;
+    uint32_t survivors;
+    bool tenured;
+  };
+
+  struct Sample {
+    mirror::Object* obj;
+    const mirror::ArtMethod* method;
+    uint32_t type_idx;
+    uint32_t epoch;  // Number of GCs started before the sample was taken.
+    bool tenured;
+  };
+
+  static size_t SiteIndex(const mirror::ArtMethod* method, uint32_t type_idx) {
+    return ((reinterpret_cast<uintptr_t>(method) >> 3) * 31 + type_idx) % kNumSites;
+  }
+
+  // Counts a resolved sample and re-decides whether its site is tenured.
+  void RecordSurvival(const Sample& sample, bool survived) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  Mutex lock_;
+
+  // Written with lock_ held, read without it by IsTenured.
+  Site sites_[kNumSites];
+
+  std::vector<Sample> pending_samples_ GUARDED_BY(lock_);
+  uint32_t epoch_ GUARDED_BY(lock_);
+  size_t allocation_count_;
+
+  // Times a site was tenured and untenured.
+  uint64_t tenured_count_ GUARDED_BY(lock_);
+  uint64_t untenured_count_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationSiteTable);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ALLOCATION_SITE_TABLE_H_
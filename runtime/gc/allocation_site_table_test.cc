@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_site_table.h"
+
+#include <sstream>
+
+#include "common_test.h"
+
+namespace art {
+namespace gc {
+
+class AllocationSiteTableTest : public CommonTest {};
+
+static bool AllMarked(const mirror::Object*, void*) {
+  return true;
+}
+
+static bool NoneMarked(const mirror::Object*, void*) {
+  return false;
+}
+
+TEST_F(AllocationSiteTableTest, TenureAndUntenure) {
+  Thread* self = Thread::Current();
+  ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  AllocationSiteTable table;
+  // The table only compares these, it never dereferences them.
+  const mirror::ArtMethod* method = reinterpret_cast<const mirror::ArtMethod*>(0x1000);
+  mirror::Object* obj = reinterpret_cast<mirror::Object*>(0x2000);
+
+  for (uint32_t i = 0; i < AllocationSiteTable::kMinSamples; ++i) {
+    table.AddSample(self, method, 7, obj, false);
+  }
+  // Samples taken since the current GC started are left for the next one.
+  table.ResolveSamples(self, AllMarked, NULL, true);
+  EXPECT_FALSE(table.IsTenured(method, 7));
+  table.StartCollection(self);
+  table.ResolveSamples(self, AllMarked, NULL, true);
+  EXPECT_TRUE(table.IsTenured(method, 7));
+  EXPECT_FALSE(table.IsTenured(method, 8));
+
+  for (uint32_t i = 0; i < AllocationSiteTable::kMinSamples; ++i) {
+    table.AddSample(self, method, 7, obj, true);
+  }
+  table.StartCollection(self);
+  // A sticky GC doesn't collect tenured objects, so it can't tell about their samples.
+  table.ResolveSamples(self, NoneMarked, NULL, true);
+  EXPECT_TRUE(table.IsTenured(method, 7));
+  table.ResolveSamples(self, NoneMarked, NULL, false);
+  EXPECT_FALSE(table.IsTenured(method, 7));
+
+  std::ostringstream os;
+  table.Dump(os);
+  EXPECT_EQ("Pretenuring: 0 tenured allocation sites, 1 tenured and 1 untenured so far, "
+            "0 pending samples\n", os.str());
+}
+
+}  // namespace gc
+}  // namespace art
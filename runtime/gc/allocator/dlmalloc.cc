@@ -50,6 +50,68 @@ static void art_heap_usage_error(const char* function, void* p) {
 #include "utils.h"
 #include <sys/mman.h>
 
+extern "C" void* MspaceInspectSome(void* msp, void* from, bool from_is_chunk, size_t max_bytes,
+                                   void(*handler)(void*, void*, size_t, void*), void* arg) {
+  ensure_initialization();
+  mstate m = reinterpret_cast<mstate>(msp);
+  if (!ok_magic(m)) {
+    USAGE_ERROR_ACTION(m, m);
+    return NULL;
+  }
+  void* resume = NULL;
+  if (!PREACTION(m)) {
+    if (is_initialized(m)) {
+      // The mspaces grow by morecore, which keeps them one contiguous segment.
+      msegmentptr s = &m->seg;
+      mchunkptr top = m->top;
+      mchunkptr q = align_as_chunk(s->base);
+      if (from != NULL) {
+        if (from_is_chunk) {
+          q = reinterpret_cast<mchunkptr>(from);
+        } else {
+          while (segment_holds(s, q) && q->head != FENCEPOST_HEAD && q != top &&
+                 reinterpret_cast<void*>(q) < from) {
+            q = next_chunk(q);
+          }
+        }
+      }
+      // The same visit as internal_inspect_all's.
+      size_t visited = 0;
+      while (segment_holds(s, q) && q->head != FENCEPOST_HEAD) {
+        if (visited >= max_bytes) {
+          resume = q;
+          break;
+        }
+        mchunkptr next = next_chunk(q);
+        size_t sz = chunksize(q);
+        size_t used;
+        void* start;
+        if (is_inuse(q)) {
+          used = sz - CHUNK_OVERHEAD;
+          start = chunk2mem(q);
+        } else {
+          used = 0;
+          if (is_small(sz)) {
+            start = reinterpret_cast<char*>(q) + sizeof(struct malloc_chunk);
+          } else {
+            start = reinterpret_cast<char*>(q) + sizeof(struct malloc_tree_chunk);
+          }
+        }
+        if (start < reinterpret_cast<void*>(next)) {
+          handler(start, next, used, arg);
+        }
+        visited += sz;
+        if (q == top) {
+          break;
+        }
+        q = next;
+      }
+    }
+    POSTACTION(m);
+  }
+  return resume;
+}
+
 extern "C" void DlmallocMadviseCallback(void* start, void* end, size_t used_bytes, void* arg) {
   // Is this chunk in use?
   if (used_bytes != 0) {
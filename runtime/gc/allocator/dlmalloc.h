@@ -37,4 +37,12 @@ extern "C" int  dlmalloc_trim(size_t);
 // pages back to the kernel.
 extern "C" void DlmallocMadviseCallback(void* start, void* end, size_t used_bytes, void* /*arg*/);
 
+// Like mspace_inspect_all, but stops before the first chunk past max_bytes of visited chunks and
+// returns it, or returns NULL when it reached the end of the space. The walk starts at the first
+// chunk of the space when from is NULL, at the chunk from if from_is_chunk, and otherwise at the
+// first chunk at or after the address from. A chunk returned earlier is only still a chunk if
+// nothing was freed into the mspace since, as freeing coalesces chunks.
+extern "C" void* MspaceInspectSome(void* msp, void* from, bool from_is_chunk, size_t max_bytes,
+                                   void(*handler)(void*, void*, size_t, void*), void* arg);
+
 #endif  // ART_RUNTIME_GC_ALLOCATOR_DLMALLOC_H_
@@ -130,19 +130,34 @@ inline void MarkSweep::VisitFieldsReferences(const mirror::Object* obj, uint32_t
     }
   } else {
     // There is no reference offset bitmap.  In the non-static case,
-    // walk up the class inheritance hierarchy and find reference
-    // offsets the hard way. In the static case, just consider this
-    // class.
+    // walk up the class inheritance hierarchy, in the static case, just
+    // consider this class. LinkFields lays the reference fields of a
+    // class out first and back to back, from the start of the static
+    // fields or from the end of the superclass' instance fields, so the
+    // offsets follow from the counts without reading the ArtFields.
     for (const mirror::Class* klass = is_static ? obj->AsClass() : obj->GetClass();
          klass != NULL;
          klass = is_static ? NULL : klass->GetSuperClass()) {
       size_t num_reference_fields = (is_static
                                      ? klass->NumReferenceStaticFields()
                                      : klass->NumReferenceInstanceFields());
+      if (num_reference_fields == 0) {
+        continue;
+      }
+      uint32_t first_offset;
+      if (is_static) {
+        first_offset = mirror::Class::FieldsOffset().Uint32Value();
+      } else {
+        const mirror::Class* super_class = klass->GetSuperClass();
+        first_offset = super_class == NULL ? 0 : super_class->GetObjectSize();
+      }
       for (size_t i = 0; i < num_reference_fields; ++i) {
-        mirror::ArtField* field = (is_static ? klass->GetStaticField(i)
-                                   : klass->GetInstanceField(i));
-        MemberOffset field_offset = field->GetOffset();
+        MemberOffset field_offset(first_offset + i * sizeof(mirror::Object*));
+        if (kIsDebugBuild) {
+          mirror::ArtField* field = is_static ? klass->GetStaticField(i)
+                                              : klass->GetInstanceField(i);
+          DCHECK_EQ(field_offset.Uint32Value(), field->GetOffset().Uint32Value());
+        }
         const mirror::Object* ref = obj->GetFieldObject<const mirror::Object*>(field_offset, false);
         visitor(obj, ref, field_offset, is_static);
       }
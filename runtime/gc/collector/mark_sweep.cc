@@ -16,6 +16,7 @@
 
 #include "mark_sweep.h"
 
+#include <algorithm>
 #include <functional>
 #include <numeric>
 #include <climits>
@@ -25,15 +26,23 @@
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/mutex-inl.h"
+#include "base/stl_util.h"
 #include "base/timing_logger.h"
+#include "catch_handler_cache.h"
+#include "class_linker.h"
+#include "debugger.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/accounting/work_stealing_deque.h"
+#include "gc/allocation_site_table.h"
 #include "gc/heap.h"
 #include "gc/space/image_space.h"
 #include "gc/space/large_object_space.h"
 #include "gc/space/space-inl.h"
+#include "gc/string_deduplicator.h"
 #include "indirect_reference_table.h"
+#include "inline_cache.h"
 #include "intern_table.h"
 #include "jni_internal.h"
 #include "monitor.h"
@@ -46,6 +55,8 @@
 #include "mirror/object-inl.h"
 #include "mirror/object_array.h"
 #include "mirror/object_array-inl.h"
+#include "mirror/string.h"
+#include "reflection.h"
 #include "runtime.h"
 #include "thread-inl.h"
 #include "thread_list.h"
@@ -55,6 +66,7 @@ using ::art::mirror::ArtField;
 using ::art::mirror::Class;
 using ::art::mirror::Object;
 using ::art::mirror::ObjectArray;
+using ::art::mirror::String;
 
 namespace art {
 namespace gc {
@@ -64,6 +76,9 @@ namespace collector {
 constexpr bool kUseRecursiveMark = false;
 constexpr bool kUseMarkStackPrefetch = true;
 constexpr size_t kSweepArrayChunkFreeSize = 1024;
+// Concurrent passes over the cards dirtied during concurrent marking, each leaving only the cards
+// dirtied while it ran for the next one and, after the last, for the pause.
+constexpr size_t kConcurrentPreCleanPasses = 2;
 
 // Parallelism options.
 constexpr bool kParallelCardScan = true;
@@ -74,6 +89,16 @@ constexpr bool kParallelRecursiveMark = true;
 // ProcessMarkStack with very small mark stacks.
 constexpr size_t kMinimumParallelMarkStackSize = 128;
 constexpr bool kParallelProcessMarkStack = true;
+// Number of objects each worker's work stealing deque holds, objects beyond that are kept in a
+// private overflow list of the worker.
+constexpr size_t kWorkStealingDequeSize = 16 * KB;
+constexpr bool kParallelSweep = true;
+// Smallest range of a space swept by one task.
+constexpr size_t kMinimumParallelSweepStripeSize = 256 * KB;
+constexpr bool kParallelClearReferences = true;
+// Smallest number of references whose referents are cleared by one task.
+constexpr size_t kMinimumParallelReferenceChunkSize = 4 * KB;
+constexpr bool kParallelStringDeduplication = true;
 
 // Profiling and information flags.
 constexpr bool kCountClassesMarked = false;
@@ -145,10 +170,36 @@ MarkSweep::MarkSweep(Heap* heap, bool is_concurrent, const std::string& name_pre
       gc_barrier_(new Barrier(0)),
       large_object_lock_("mark sweep large object lock", kMarkSweepLargeObjectLock),
       mark_stack_lock_("mark sweep mark stack lock", kMarkSweepMarkStackLock),
+      total_work_steals_(0),
+      unchanged_thread_roots_(0),
+      unload_classes_(false),
+      unloaded_classes_(0),
+      unloaded_class_bytes_(0),
+      total_unloaded_classes_(0),
+      total_unloaded_class_bytes_(0),
+      deduplicate_strings_(false),
+      deduplicated_strings_(0),
+      deduplicated_string_bytes_(0),
+      total_deduplicated_strings_(0),
+      total_deduplicated_string_bytes_(0),
       is_concurrent_(is_concurrent),
       clear_soft_references_(false) {
 }
 
+MarkSweep::~MarkSweep() {
+  STLDeleteElements(&work_deques_);
+}
+
+void MarkSweep::ResetCumulativeStatistics() {
+  GarbageCollector::ResetCumulativeStatistics();
+  total_work_steals_ = 0;
+  total_worker_idle_ns_.clear();
+  total_unloaded_classes_ = 0;
+  total_unloaded_class_bytes_ = 0;
+  total_deduplicated_strings_ = 0;
+  total_deduplicated_string_bytes_ = 0;
+}
+
 void MarkSweep::InitializePhase() {
   timings_.Reset();
   base::TimingLogger::ScopedSplit split("InitializePhase", &timings_);
@@ -174,11 +225,29 @@ void MarkSweep::InitializePhase() {
   work_chunks_created_ = 0;
   work_chunks_deleted_ = 0;
   reference_count_ = 0;
+  work_steals_ = 0;
+  worker_idle_ns_.clear();
+  unloaded_classes_ = 0;
+  unloaded_class_bytes_ = 0;
+  // A sticky collection doesn't mark the old class loaders, it can't tell whether they are live.
+  unload_classes_ = heap_->IsUnloadingClasses() && GetGcType() != kGcTypeSticky &&
+      Runtime::Current()->GetClassLinker()->CanUnloadClasses();
+  deduplicated_strings_ = 0;
+  deduplicated_string_bytes_ = 0;
+  // Walking the alloc space would lengthen the pause of the other collections, and the sticky
+  // ones mostly see young strings.
+  deduplicate_strings_ = heap_->IsDeduplicatingStrings() && IsConcurrent() &&
+      GetGcType() != kGcTypeSticky;
   java_lang_Class_ = Class::GetJavaLangClass();
   CHECK(java_lang_Class_ != nullptr);
 
   FindDefaultMarkBitmap();
 
+  AllocationSiteTable* allocation_sites = heap_->GetAllocationSiteTable();
+  if (allocation_sites != NULL) {
+    allocation_sites->StartCollection(Thread::Current());
+  }
+
   // Do any pre GC verification.
   timings_.NewSplit("PreGcVerification");
   heap_->PreGcVerification(this);
@@ -187,8 +256,61 @@ void MarkSweep::InitializePhase() {
 void MarkSweep::ProcessReferences(Thread* self) {
   base::TimingLogger::ScopedSplit split("ProcessReferences", &timings_);
   WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  if (unload_classes_ && !Runtime::Current()->GetClassLinker()->CanUnloadClasses()) {
+    // Something started keeping classes or methods outside of the heap since the roots were
+    // marked, keep all the classes it could see.
+    unload_classes_ = false;
+    timings_.StartSplit("MarkAllClasses");
+    Runtime::Current()->GetClassLinker()->VisitRoots(MarkObjectCallback, this, false, false, false);
+    timings_.EndSplit();
+    ProcessMarkStack(true);
+  }
   ProcessReferences(&soft_reference_list_, clear_soft_references_, &weak_reference_list_,
                     &finalizer_reference_list_, &phantom_reference_list_);
+  if (unload_classes_) {
+    UnloadClasses();
+  }
+}
+
+void MarkSweep::MarkClassesOfMarkedLoaders() {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  // Marking the classes of a loader can mark other loaders, the classes of those are marked by
+  // the next pass.
+  for (;;) {
+    timings_.StartSplit("MarkClassesOfMarkedLoaders");
+    size_t marked = class_linker->MarkClassesOfMarkedLoaders(IsMarkedCallback, MarkObjectCallback,
+                                                              this);
+    timings_.EndSplit();
+    if (marked == 0) {
+      break;
+    }
+    ProcessMarkStack(true);
+  }
+}
+
+static void ClearClassCachesCallback(Thread* thread, void*) {
+  thread->ClearClassCaches();
+}
+
+void MarkSweep::UnloadClasses() {
+  timings_.StartSplit("UnloadClasses");
+  Runtime* runtime = Runtime::Current();
+  runtime->GetClassLinker()->SweepClasses(IsMarkedCallback, this, &unloaded_classes_,
+                                          &unloaded_class_bytes_);
+  if (unloaded_classes_ != 0) {
+    // The caches keyed by the addresses of classes and methods would otherwise match the objects
+    // allocated at the same addresses later.
+    {
+      MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
+      runtime->GetThreadList()->ForEach(ClearClassCachesCallback, NULL);
+    }
+    Class::SweepMemberIndexes(IsMarkedCallback, this);
+    SweepInvokePlans(IsMarkedCallback, this);
+    runtime->GetInlineCaches()->Sweep(IsMarkedCallback, this);
+    runtime->GetCatchHandlerCache()->Sweep(IsMarkedCallback, this);
+    runtime->GetJavaVM()->SweepLibraries(IsMarkedCallback, this);
+  }
+  timings_.EndSplit();
 }
 
 bool MarkSweep::HandleDirtyObjectsPhase() {
@@ -196,6 +318,8 @@ bool MarkSweep::HandleDirtyObjectsPhase() {
   Thread* self = Thread::Current();
   Locks::mutator_lock_->AssertExclusiveHeld(self);
 
+  DeflateMonitors();
+
   {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
 
@@ -248,8 +372,12 @@ void MarkSweep::MarkingPhase() {
   heap_->ProcessCards(timings_);
 
   // Need to do this before the checkpoint since we don't want any threads to add references to
-  // the live stack during the recursive mark.
+  // the live stack during the recursive mark. The threads' segments of the allocation stack are
+  // dropped at the checkpoint, or here if they are suspended already.
   timings_.NewSplit("SwapStacks");
+  if (Locks::mutator_lock_->IsExclusiveHeld(self)) {
+    heap_->RevokeAllThreadLocalAllocationStacks(self);
+  }
   heap_->SwapStacks();
 
   WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
@@ -266,19 +394,61 @@ void MarkSweep::MarkingPhase() {
 
   heap_->UpdateAndMarkModUnion(this, timings_, GetGcType());
   MarkReachableObjects();
+  PreCleanCards();
+}
+
+void MarkSweep::PreCleanCards() {
+  // The mutators of a non concurrent collection are suspended, no card gets dirtied.
+  if (!IsConcurrent()) {
+    return;
+  }
+  Thread* self = Thread::Current();
+  CHECK(!Locks::mutator_lock_->IsExclusiveHeld(self));
+  for (size_t i = 0; i < kConcurrentPreCleanPasses; ++i) {
+    base::TimingLogger::ScopedSplit split("PreCleanCards", &timings_);
+    // Age the cards dirtied since they were last aged, ModifyCardsAtomic racing with the write
+    // barrier never loses a card dirtied again.
+    heap_->ProcessCards(timings_);
+    // A mutator may have dirtied a card before its reference store is visible to us, the locks
+    // taken by the checkpoint make both visible before the cards are scanned. Marking the thread
+    // roots again also lets the pause skip those of the threads that stay suspended.
+    MarkRootsCheckpoint(self);
+    RecursiveMarkDirtyObjects(false, accounting::CardTable::kCardDirty - 1);
+  }
 }
 
 void MarkSweep::MarkThreadRoots(Thread* self) {
   MarkRootsCheckpoint(self);
 }
 
+void MarkSweep::MarkTenuredStackAsLive() {
+  timings_.StartSplit("MarkTenuredStackAsLive");
+  accounting::ObjectStack* tenured_live_stack = heap_->GetTenuredLiveStack();
+  heap_->MarkAllocStack(heap_->alloc_space_->GetLiveBitmap(),
+                        heap_->large_object_space_->GetLiveObjects(), tenured_live_stack);
+  tenured_live_stack->Reset();
+  timings_.EndSplit();
+}
+
 void MarkSweep::MarkReachableObjects() {
+  MarkTenuredStackAsLive();
   // Mark everything allocated since the last as GC live so that we can sweep concurrently,
   // knowing that new allocations won't be marked as live.
   timings_.StartSplit("MarkStackAsLive");
   accounting::ObjectStack* live_stack = heap_->GetLiveStack();
   heap_->MarkAllocStack(heap_->alloc_space_->GetLiveBitmap(),
                         heap_->large_object_space_->GetLiveObjects(), live_stack);
+  if (deduplicate_strings_) {
+    // Most strings die young, only those which survived the previous collection are deduplicated.
+    young_strings_.clear();
+    Class* java_lang_String = String::GetJavaLangString();
+    for (Object** it = live_stack->Begin(); it != live_stack->End(); ++it) {
+      if (*it != NULL && (*it)->GetClass() == java_lang_String) {
+        young_strings_.push_back(*it);
+      }
+    }
+    std::sort(young_strings_.begin(), young_strings_.end());
+  }
   live_stack->Reset();
   timings_.EndSplit();
   // Recursively mark all the non-image bits set in the mark bitmap.
@@ -291,6 +461,7 @@ void MarkSweep::ReclaimPhase() {
 
   if (!IsConcurrent()) {
     ProcessReferences(self);
+    DeflateMonitors();
   }
 
   {
@@ -331,6 +502,19 @@ void MarkSweep::ReclaimPhase() {
   {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
 
+    // The sampled objects must be tested before they can be freed.
+    AllocationSiteTable* allocation_sites = heap_->GetAllocationSiteTable();
+    if (allocation_sites != NULL) {
+      timings_.StartSplit("ResolveAllocationSiteSamples");
+      allocation_sites->ResolveSamples(self, IsMarkedCallback, this,
+                                       GetGcType() == kGcTypeSticky);
+      timings_.EndSplit();
+    }
+
+    if (deduplicate_strings_) {
+      DeduplicateStrings();
+    }
+
     // Reclaim unmarked objects.
     Sweep(false);
 
@@ -346,6 +530,146 @@ void MarkSweep::ReclaimPhase() {
   }
 }
 
+// Adds the marked strings of a range of the alloc space which can share an array and aren't young
+// to candidates.
+static void CollectStringCandidates(const accounting::SpaceBitmap* mark_bitmap,
+                                    const std::vector<const Object*>& young_strings,
+                                    uintptr_t begin, uintptr_t end,
+                                    std::vector<String*>* candidates) NO_THREAD_SAFETY_ANALYSIS {
+  mark_bitmap->VisitMarkedRange(begin, end, [&young_strings, candidates](const Object* obj)
+      NO_THREAD_SAFETY_ANALYSIS {
+    if (obj->GetClass()->IsStringClass() &&
+        !std::binary_search(young_strings.begin(), young_strings.end(), obj)) {
+      String* string = const_cast<Object*>(obj)->AsString();
+      if (StringDeduplicator::CanShareArray(string)) {
+        candidates->push_back(string);
+      }
+    }
+  });
+}
+
+// Collects the string candidates of one stripe of the alloc space on behalf of the GC thread,
+// which holds heap_bitmap_lock_ exclusively.
+class StringCandidatesTask : public Task {
+ public:
+  StringCandidatesTask(const accounting::SpaceBitmap* mark_bitmap,
+                       const std::vector<const Object*>* young_strings, uintptr_t begin,
+                       uintptr_t end, std::vector<String*>* candidates)
+      : mark_bitmap_(mark_bitmap), young_strings_(young_strings), begin_(begin), end_(end),
+        candidates_(candidates) {
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    CollectStringCandidates(mark_bitmap_, *young_strings_, begin_, end_, candidates_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  const accounting::SpaceBitmap* const mark_bitmap_;
+  const std::vector<const Object*>* const young_strings_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  std::vector<String*>* const candidates_;
+};
+
+// Deduplicates the candidates of all the stripes whose hash codes are partition modulo
+// num_partitions, so that equal strings meet in the same task.
+class DeduplicateStringsTask : public Task {
+ public:
+  DeduplicateStringsTask(space::ContinuousSpace* space,
+                         const std::vector<std::vector<String*> >* candidates, size_t partition,
+                         size_t num_partitions, size_t* deduplicated, size_t* deduplicated_bytes)
+      : space_(space), candidates_(candidates), partition_(partition),
+        num_partitions_(num_partitions), deduplicated_(deduplicated),
+        deduplicated_bytes_(deduplicated_bytes) {
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    StringDeduplicator deduplicator(space_);
+    for (const std::vector<String*>& stripe : *candidates_) {
+      for (String* string : stripe) {
+        uint32_t hash_code = string->GetField32(String::HashCodeOffset(), false);
+        if (hash_code % num_partitions_ == partition_) {
+          deduplicator.Deduplicate(string);
+        }
+      }
+    }
+    *deduplicated_ = deduplicator.GetNumDeduplicated();
+    *deduplicated_bytes_ = deduplicator.GetDeduplicatedBytes();
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  space::ContinuousSpace* const space_;
+  const std::vector<std::vector<String*> >* const candidates_;
+  const size_t partition_;
+  const size_t num_partitions_;
+  size_t* const deduplicated_;
+  size_t* const deduplicated_bytes_;
+};
+
+void MarkSweep::DeduplicateStrings() {
+  base::TimingLogger::ScopedSplit split("DeduplicateStrings", &timings_);
+  space::ContinuousSpace* space = heap_->GetAllocSpace();
+  const accounting::SpaceBitmap* mark_bitmap = space->GetMarkBitmap();
+  uintptr_t begin = reinterpret_cast<uintptr_t>(space->Begin());
+  uintptr_t end = reinterpret_cast<uintptr_t>(space->End());
+  // The mutators are running.
+  const size_t thread_count = GetThreadCount(false);
+  if (!kParallelStringDeduplication || thread_count <= 1) {
+    std::vector<String*> candidates;
+    CollectStringCandidates(mark_bitmap, young_strings_, begin, end, &candidates);
+    StringDeduplicator deduplicator(space);
+    for (String* string : candidates) {
+      deduplicator.Deduplicate(string);
+    }
+    deduplicated_strings_ = deduplicator.GetNumDeduplicated();
+    deduplicated_string_bytes_ = deduplicator.GetDeduplicatedBytes();
+  } else {
+    // A couple of stripes per thread to collect the candidates, then a range of hash codes per
+    // thread to deduplicate them.
+    Thread* self = Thread::Current();
+    ThreadPool* thread_pool = heap_->GetThreadPool();
+    const size_t stripe_size = std::max(RoundUp((end - begin) / (thread_count * 2), KB),
+                                        kMinimumParallelSweepStripeSize);
+    std::vector<std::vector<String*> > candidates((end - begin + stripe_size - 1) / stripe_size);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      uintptr_t stripe_begin = begin + i * stripe_size;
+      thread_pool->AddTask(self, new StringCandidatesTask(mark_bitmap, &young_strings_,
+                                                          stripe_begin,
+                                                          std::min(stripe_begin + stripe_size, end),
+                                                          &candidates[i]));
+    }
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+
+    std::vector<size_t> deduplicated(thread_count);
+    std::vector<size_t> deduplicated_bytes(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+      thread_pool->AddTask(self, new DeduplicateStringsTask(space, &candidates, i, thread_count,
+                                                            &deduplicated[i],
+                                                            &deduplicated_bytes[i]));
+    }
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+    deduplicated_strings_ = std::accumulate(deduplicated.begin(), deduplicated.end(),
+                                            static_cast<size_t>(0));
+    deduplicated_string_bytes_ = std::accumulate(deduplicated_bytes.begin(),
+                                                 deduplicated_bytes.end(),
+                                                 static_cast<size_t>(0));
+  }
+  std::vector<const Object*>().swap(young_strings_);
+}
+
 void MarkSweep::SetImmuneRange(Object* begin, Object* end) {
   immune_begin_ = begin;
   immune_end_ = end;
@@ -575,9 +899,16 @@ void MarkSweep::MarkNonThreadRoots() {
 }
 
 void MarkSweep::MarkConcurrentRoots() {
-  timings_.StartSplit("MarkConcurrentRoots");
-  // Visit all runtime roots and clear dirty flags.
-  Runtime::Current()->VisitConcurrentRoots(MarkObjectCallback, this, false, true);
+  Runtime* runtime = Runtime::Current();
+  // The roots added before the last GC were marked by it, and a sticky GC treats the objects
+  // allocated before the last GC as marked, so it only visits the roots added since.
+  bool only_new_roots = GetGcType() == kGcTypeSticky;
+  // Visit the runtime roots and clean the tables.
+  timings_.StartSplit("MarkInternTableRoots");
+  runtime->GetInternTable()->VisitRoots(MarkObjectCallback, this, only_new_roots, true);
+  timings_.NewSplit("MarkClassLinkerRoots");
+  runtime->GetClassLinker()->VisitRoots(MarkObjectCallback, this, only_new_roots, true,
+                                        unload_classes_);
   timings_.EndSplit();
 }
 
@@ -999,10 +1330,30 @@ void MarkSweep::RecursiveMarkDirtyObjects(bool paused, byte minimum_age) {
   ProcessMarkStack(paused);
 }
 
+void MarkSweep::ReMarkThreadRootsCallback(Thread* thread, void* arg) {
+  MarkSweep* mark_sweep = reinterpret_cast<MarkSweep*>(arg);
+  if (thread->AreRootsMarkedWhileSuspended()) {
+    ++mark_sweep->unchanged_thread_roots_;
+  } else {
+    thread->VisitRoots(ReMarkObjectVisitor, mark_sweep);
+  }
+}
+
 void MarkSweep::ReMarkRoots() {
   timings_.StartSplit("ReMarkRoots");
-  Runtime::Current()->VisitRoots(ReMarkObjectVisitor, this, true, true);
+  Runtime* runtime = Runtime::Current();
+  runtime->VisitConcurrentRoots(ReMarkObjectVisitor, this, true, true);
+  runtime->VisitNonThreadRoots(ReMarkObjectVisitor, this);
+  // Only threads which ran since the marking checkpoint can hold new references, the paused GC
+  // doesn't need to visit every stack.
+  unchanged_thread_roots_ = 0;
+  {
+    MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
+    runtime->GetThreadList()->ForEach(ReMarkThreadRootsCallback, this);
+  }
   timings_.EndSplit();
+  VLOG(heap) << "Skipped re-marking the roots of " << unchanged_thread_roots_
+             << " suspended threads";
 }
 
 void MarkSweep::SweepJniWeakGlobals(IsMarkedTester is_marked, void* arg) {
@@ -1033,9 +1384,17 @@ void MarkSweep::SweepSystemWeaks() {
   runtime->GetInternTable()->SweepInternTableWeaks(IsMarkedCallback, this);
   runtime->GetMonitorList()->SweepMonitorList(IsMarkedCallback, this);
   SweepJniWeakGlobals(IsMarkedCallback, this);
+  Dbg::SweepObjectRegistry(IsMarkedCallback, this);
   timings_.EndSplit();
 }
 
+void MarkSweep::DeflateMonitors() {
+  timings_.StartSplit("DeflateMonitors");
+  size_t deflated = Runtime::Current()->GetMonitorList()->DeflateMonitors();
+  timings_.EndSplit();
+  VLOG(heap) << "Deflated " << deflated << " monitors";
+}
+
 bool MarkSweep::VerifyIsLiveCallback(const Object* obj, void* arg) {
   reinterpret_cast<MarkSweep*>(arg)->VerifyIsLive(obj);
   // We don't actually want to sweep the object, so lets return "marked"
@@ -1048,7 +1407,10 @@ void MarkSweep::VerifyIsLive(const Object* obj) {
     space::LargeObjectSpace* large_object_space = GetHeap()->GetLargeObjectsSpace();
     if (!large_object_space->GetLiveObjects()->Test(obj)) {
       if (std::find(heap->allocation_stack_->Begin(), heap->allocation_stack_->End(), obj) ==
-          heap->allocation_stack_->End()) {
+              heap->allocation_stack_->End() &&
+          std::find(heap->tenured_allocation_stack_->Begin(),
+                    heap->tenured_allocation_stack_->End(), obj) ==
+              heap->tenured_allocation_stack_->End()) {
         // Object not found!
         heap->DumpSpaces();
         LOG(FATAL) << "Found dead object " << obj;
@@ -1063,6 +1425,7 @@ void MarkSweep::VerifySystemWeaks() {
   runtime->GetInternTable()->SweepInternTableWeaks(VerifyIsLiveCallback, this);
   runtime->GetMonitorList()->SweepMonitorList(VerifyIsLiveCallback, this);
   runtime->GetJavaVM()->SweepWeakGlobals(VerifyIsLiveCallback, this);
+  Dbg::SweepObjectRegistry(VerifyIsLiveCallback, this);
 }
 
 struct SweepCallbackContext {
@@ -1082,6 +1445,11 @@ class CheckpointMarkThreadRoots : public Closure {
     CHECK(thread == self || thread->IsSuspended() || thread->GetState() == kWaitingPerformingGc)
         << thread->GetState() << " thread " << thread << " self " << self;
     thread->VisitRoots(MarkSweep::MarkRootParallelCallback, mark_sweep_);
+    // Its next allocations go to a segment of the new allocation stack.
+    thread->RevokeThreadLocalAllocationStack();
+    // A suspended thread is held suspended while we run on its behalf, its roots stay marked
+    // until it becomes runnable again.
+    thread->SetRootsMarkedWhileSuspended(thread != self);
     ATRACE_END();
     mark_sweep_->GetBarrier().Pass(self);
   }
@@ -1116,7 +1484,6 @@ void MarkSweep::SweepCallback(size_t num_ptrs, Object** ptrs, void* arg) {
   Heap* heap = mark_sweep->GetHeap();
   space::AllocSpace* space = context->space;
   Thread* self = context->self;
-  Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
   // Use a bulk free, that merges consecutive objects before freeing or free per object?
   // Documentation suggests better free performance with merging, but this may be at the expensive
   // of allocation.
@@ -1130,7 +1497,6 @@ void MarkSweep::SweepCallback(size_t num_ptrs, Object** ptrs, void* arg) {
 
 void MarkSweep::ZygoteSweepCallback(size_t num_ptrs, Object** ptrs, void* arg) {
   SweepCallbackContext* context = static_cast<SweepCallbackContext*>(arg);
-  Locks::heap_bitmap_lock_->AssertExclusiveHeld(context->self);
   Heap* heap = context->mark_sweep->GetHeap();
   // We don't free any actual memory to avoid dirtying the shared zygote pages.
   for (size_t i = 0; i < num_ptrs; ++i) {
@@ -1168,6 +1534,10 @@ void MarkSweep::SweepArray(accounting::ObjectStack* allocations, bool swap_bitma
   Thread* self = Thread::Current();
   for (size_t i = 0; i < count; ++i) {
     Object* obj = objects[i];
+    // Slots of the threads' segments that weren't used are NULL.
+    if (UNLIKELY(obj == NULL)) {
+      continue;
+    }
     // There should only be objects in the AllocSpace/LargeObjectSpace in the allocation stack.
     if (LIKELY(mark_bitmap->HasAddress(obj))) {
       if (!mark_bitmap->Test(obj)) {
@@ -1218,14 +1588,77 @@ void MarkSweep::SweepArray(accounting::ObjectStack* allocations, bool swap_bitma
   timings_.EndSplit();
 }
 
+// Sweeps one stripe of a space on behalf of the GC thread, which holds heap_bitmap_lock_
+// exclusively. Stripes cover whole bitmap words, so workers never write the same word of the live
+// bitmap, and each worker frees its garbage in its own batches.
+class SweepTask : public Task {
+ public:
+  SweepTask(MarkSweep* mark_sweep, space::ContinuousSpace* space,
+            accounting::SpaceBitmap* live_bitmap, accounting::SpaceBitmap* mark_bitmap,
+            uintptr_t begin, uintptr_t end)
+      : mark_sweep_(mark_sweep), space_(space), live_bitmap_(live_bitmap),
+        mark_bitmap_(mark_bitmap), begin_(begin), end_(end) {
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    SweepCallbackContext scc;
+    scc.mark_sweep = mark_sweep_;
+    scc.space = space_->AsDlMallocSpace();
+    scc.self = self;
+    accounting::SpaceBitmap::SweepWalk(*live_bitmap_, *mark_bitmap_, begin_, end_,
+                                       space_->IsZygoteSpace() ? &MarkSweep::ZygoteSweepCallback
+                                                               : &MarkSweep::SweepCallback,
+                                       reinterpret_cast<void*>(&scc));
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  MarkSweep* const mark_sweep_;
+  space::ContinuousSpace* const space_;
+  accounting::SpaceBitmap* const live_bitmap_;
+  accounting::SpaceBitmap* const mark_bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+};
+
+// Frees the unmarked large objects while the workers sweep the continuous spaces.
+class SweepLargeObjectsTask : public Task {
+ public:
+  SweepLargeObjectsTask(MarkSweep* mark_sweep, bool swap_bitmaps)
+      : mark_sweep_(mark_sweep), swap_bitmaps_(swap_bitmaps) {
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    mark_sweep_->FreeUnmarkedLargeObjects(self, swap_bitmaps_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  MarkSweep* const mark_sweep_;
+  const bool swap_bitmaps_;
+};
+
 void MarkSweep::Sweep(bool swap_bitmaps) {
   DCHECK(mark_stack_->IsEmpty());
   base::TimingLogger::ScopedSplit("Sweep", &timings_);
 
   const bool partial = (GetGcType() == kGcTypePartial);
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  const size_t thread_count = GetThreadCount(!IsConcurrent());
+  // Heap::RecordFree updates the runtime stats without synchronization, so only sweep in parallel
+  // when they are off.
+  const bool parallel = kParallelSweep && thread_count > 1 &&
+      !Runtime::Current()->HasStatsEnabled();
   SweepCallbackContext scc;
   scc.mark_sweep = this;
-  scc.self = Thread::Current();
+  scc.self = self;
   for (const auto& space : GetHeap()->GetContinuousSpaces()) {
     // We always sweep always collect spaces.
     bool sweep_space = (space->GetGcRetentionPolicy() == space::kGcRetentionPolicyAlwaysCollect);
@@ -1242,7 +1675,17 @@ void MarkSweep::Sweep(bool swap_bitmaps) {
       if (swap_bitmaps) {
         std::swap(live_bitmap, mark_bitmap);
       }
-      if (!space->IsZygoteSpace()) {
+      if (parallel) {
+        // A couple of stripes per thread, aligned so that no two share a bitmap word.
+        const size_t stripe_size = std::max(RoundUp((end - begin) / (thread_count * 2), KB),
+                                            kMinimumParallelSweepStripeSize);
+        while (begin < end) {
+          uintptr_t stripe_end = std::min(begin + stripe_size, end);
+          thread_pool->AddTask(self, new SweepTask(this, space, live_bitmap, mark_bitmap, begin,
+                                                   stripe_end));
+          begin = stripe_end;
+        }
+      } else if (!space->IsZygoteSpace()) {
         base::TimingLogger::ScopedSplit split("SweepAllocSpace", &timings_);
         // Bitmaps are pre-swapped for optimization which enables sweeping with the heap unlocked.
         accounting::SpaceBitmap::SweepWalk(*live_bitmap, *mark_bitmap, begin, end,
@@ -1257,12 +1700,24 @@ void MarkSweep::Sweep(bool swap_bitmaps) {
     }
   }
 
-  SweepLargeObjects(swap_bitmaps);
+  if (parallel) {
+    base::TimingLogger::ScopedSplit split("ParallelSweep", &timings_);
+    thread_pool->AddTask(self, new SweepLargeObjectsTask(this, swap_bitmaps));
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+  } else {
+    SweepLargeObjects(swap_bitmaps);
+  }
 }
 
 void MarkSweep::SweepLargeObjects(bool swap_bitmaps) {
   base::TimingLogger::ScopedSplit("SweepLargeObjects", &timings_);
-  // Sweep large objects
+  FreeUnmarkedLargeObjects(Thread::Current(), swap_bitmaps);
+}
+
+void MarkSweep::FreeUnmarkedLargeObjects(Thread* self, bool swap_bitmaps) {
   space::LargeObjectSpace* large_object_space = GetHeap()->GetLargeObjectsSpace();
   accounting::SpaceSetMap* large_live_objects = large_object_space->GetLiveObjects();
   accounting::SpaceSetMap* large_mark_objects = large_object_space->GetMarkObjects();
@@ -1272,7 +1727,6 @@ void MarkSweep::SweepLargeObjects(bool swap_bitmaps) {
   // O(n*log(n)) but hopefully there are not too many large objects.
   size_t freed_objects = 0;
   size_t freed_bytes = 0;
-  Thread* self = Thread::Current();
   for (const Object* obj : large_live_objects->GetObjects()) {
     if (!large_mark_objects->Test(obj)) {
       freed_bytes += large_object_space->Free(self, const_cast<Object*>(obj));
@@ -1399,23 +1853,180 @@ void MarkSweep::ScanObject(const Object* obj) {
   ScanObjectVisit(obj, visitor);
 }
 
+// Drains the mark stack together with the other workers. Each worker scans the objects of its
+// own deque and, once that runs dry, steals from the deques of the other workers so a single
+// long chain of objects doesn't leave the rest of the workers idle.
+class WorkStealingMarkTask : public Task {
+ public:
+  // State shared by all the workers of one ProcessMarkStackParallel.
+  struct SharedState {
+    SharedState(std::vector<accounting::WorkStealingDeque<const Object*>*>* deques,
+                size_t num_workers)
+        : deques(deques), num_workers(num_workers), started_workers(0), idle_workers(0),
+          idle_ns(num_workers, 0) {
+    }
+
+    std::vector<accounting::WorkStealingDeque<const Object*>*>* const deques;
+    const size_t num_workers;
+    // Workers which have started running, tasks may still be waiting in the thread pool.
+    AtomicInteger started_workers;
+    // Workers which have run out of work.
+    AtomicInteger idle_workers;
+    // Time each worker spent looking for work, written by the worker itself.
+    std::vector<uint64_t> idle_ns;
+  };
+
+  WorkStealingMarkTask(MarkSweep* mark_sweep, SharedState* state, size_t index)
+      : mark_sweep_(mark_sweep), state_(state), index_(index),
+        deque_((*state->deques)[index]), steals_(0) {
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    ++state_->started_workers;
+    uint64_t idle_ns = 0;
+    for (;;) {
+      const Object* obj;
+      while (Pop(&obj)) {
+        ScanObject(obj);
+      }
+      const uint64_t idle_start = NanoTime();
+      const bool found_work = WaitForWork(&obj);
+      idle_ns += NanoTime() - idle_start;
+      if (!found_work) {
+        break;
+      }
+      ScanObject(obj);
+    }
+    DCHECK(overflow_.empty());
+    state_->idle_ns[index_] = idle_ns;
+    mark_sweep_->work_steals_.fetch_add(steals_);
+  }
+
+ private:
+  MarkSweep* const mark_sweep_;
+  SharedState* const state_;
+  const size_t index_;
+  accounting::WorkStealingDeque<const Object*>* const deque_;
+  // Objects which didn't fit in the deque, only visible to this worker.
+  std::vector<const Object*> overflow_;
+  size_t steals_;
+
+  void Push(const Object* obj) {
+    if (UNLIKELY(!deque_->PushBottom(obj))) {
+      overflow_.push_back(obj);
+    }
+  }
+
+  bool Pop(const Object** obj) {
+    if (deque_->PopBottom(obj)) {
+      return true;
+    }
+    if (overflow_.empty()) {
+      return false;
+    }
+    // Move a batch of the overflow into the deque so other workers can steal it.
+    const size_t count = std::min(overflow_.size(), deque_->Capacity() / 2);
+    for (size_t i = 0; i < count; ++i) {
+      deque_->PushBottom(overflow_.back());
+      overflow_.pop_back();
+    }
+    return deque_->PopBottom(obj);
+  }
+
+  bool TrySteal(const Object** obj) {
+    for (size_t i = 1; i < state_->num_workers; ++i) {
+      accounting::WorkStealingDeque<const Object*>* victim =
+          (*state_->deques)[(index_ + i) % state_->num_workers];
+      if (victim->Steal(obj)) {
+        ++steals_;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns false once every worker is idle and all deques are empty.
+  bool WaitForWork(const Object** obj) {
+    if (TrySteal(obj)) {
+      return true;
+    }
+    ++state_->idle_workers;
+    for (size_t spins = 0; ; ++spins) {
+      bool all_empty = true;
+      for (size_t i = 0; i < state_->num_workers; ++i) {
+        all_empty = all_empty && (*state_->deques)[i]->IsEmpty();
+      }
+      if (!all_empty) {
+        // Idle workers don't produce work, so leave the idle state before taking some.
+        --state_->idle_workers;
+        if (TrySteal(obj)) {
+          return true;
+        }
+        ++state_->idle_workers;
+      } else if (state_->idle_workers.load() == state_->started_workers.load()) {
+        // Every worker that has started is idle and there is nothing left to steal, workers which
+        // haven't started will find their deque empty.
+        return false;
+      }
+      if (spins > 16) {
+        sched_yield();
+      }
+    }
+  }
+
+  void ScanObject(const Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+    DCHECK(obj != NULL);
+    MarkSweep* mark_sweep = mark_sweep_;
+    mark_sweep->ScanObjectVisit(obj,
+        [mark_sweep, this](const Object* /* obj */, const Object* ref,
+            const MemberOffset& /* offset */, bool /* is_static */) ALWAYS_INLINE {
+      if (ref != nullptr && mark_sweep->MarkObjectParallel(ref)) {
+        Push(ref);
+      }
+    });
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingMarkTask);
+};
+
 void MarkSweep::ProcessMarkStackParallel(size_t thread_count) {
   Thread* self = Thread::Current();
   ThreadPool* thread_pool = GetHeap()->GetThreadPool();
-  const size_t chunk_size = std::min(mark_stack_->Size() / thread_count + 1,
-                                     static_cast<size_t>(MarkStackTask<false>::kMaxSize));
-  CHECK_GT(chunk_size, 0U);
-  // Split the current mark stack up into work tasks.
-  for (mirror::Object **it = mark_stack_->Begin(), **end = mark_stack_->End(); it < end; ) {
-    const size_t delta = std::min(static_cast<size_t>(end - it), chunk_size);
-    thread_pool->AddTask(self, new MarkStackTask<false>(thread_pool, this, delta,
-                                                        const_cast<const mirror::Object**>(it)));
-    it += delta;
+  while (work_deques_.size() < thread_count) {
+    work_deques_.push_back(accounting::WorkStealingDeque<const Object*>::Create(
+        "mark sweep work stealing deque", kWorkStealingDequeSize));
+  }
+  if (worker_idle_ns_.size() < thread_count) {
+    worker_idle_ns_.resize(thread_count, 0);
+  }
+  while (!mark_stack_->IsEmpty()) {
+    WorkStealingMarkTask::SharedState state(&work_deques_, thread_count);
+    // Deal the mark stack out to the workers, anything that doesn't fit is handled next round.
+    for (size_t i = 0; i < thread_count; ++i) {
+      work_deques_[i]->Reset();
+    }
+    for (size_t i = 0; !mark_stack_->IsEmpty(); i = (i + 1) % thread_count) {
+      Object* obj = mark_stack_->PopBack();
+      if (!work_deques_[i]->PushBottom(obj)) {
+        mark_stack_->PushBack(obj);
+        break;
+      }
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+      thread_pool->AddTask(self, new WorkStealingMarkTask(this, &state, i));
+    }
+    thread_pool->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+    for (size_t i = 0; i < thread_count; ++i) {
+      worker_idle_ns_[i] += state.idle_ns[i];
+    }
   }
-  thread_pool->SetMaxActiveWorkers(thread_count - 1);
-  thread_pool->StartWorkers(self);
-  thread_pool->Wait(self, true, true);
-  thread_pool->StopWorkers(self);
   mark_stack_->Reset();
   CHECK_EQ(work_chunks_created_, work_chunks_deleted_) << " some of the work chunks were leaked";
 }
@@ -1507,23 +2118,95 @@ inline bool MarkSweep::IsMarked(const Object* object) const
   return heap_->GetMarkBitmap()->Test(object);
 }
 
-// Unlink the reference list clearing references objects with white
-// referents.  Cleared references registered to a reference queue are
-// scheduled for appending by the heap worker thread.
-void MarkSweep::ClearWhiteReferences(Object** list) {
-  DCHECK(list != NULL);
-  while (*list != NULL) {
-    Object* ref = heap_->DequeuePendingReference(list);
+size_t MarkSweep::ClearWhiteReferents(Object** references, size_t count) {
+  size_t enqueue_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    Object* ref = references[i];
     Object* referent = heap_->GetReferenceReferent(ref);
     if (referent != NULL && !IsMarked(referent)) {
       // Referent is white, clear it.
       heap_->ClearReferenceReferent(ref);
       if (heap_->IsEnqueuable(ref)) {
-        heap_->EnqueueReference(ref, &cleared_reference_list_);
+        references[enqueue_count++] = ref;
       }
     }
   }
+  return enqueue_count;
+}
+
+// Clears the white referents of a chunk of a reference list on behalf of the GC thread, which holds
+// heap_bitmap_lock_ exclusively. Chunks don't share references, the GC thread links the references
+// each chunk leaves to enqueue onto the cleared list afterwards.
+class ClearWhiteReferencesTask : public Task {
+ public:
+  ClearWhiteReferencesTask(MarkSweep* mark_sweep, Object** references, size_t count,
+                           size_t* enqueue_count)
+      : mark_sweep_(mark_sweep), references_(references), count_(count),
+        enqueue_count_(enqueue_count) {
+  }
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    *enqueue_count_ = mark_sweep_->ClearWhiteReferents(references_, count_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  MarkSweep* const mark_sweep_;
+  Object** const references_;
+  const size_t count_;
+  size_t* const enqueue_count_;
+};
+
+// Unlink the reference list clearing references objects with white
+// referents.  Cleared references registered to a reference queue are
+// scheduled for appending by the heap worker thread.
+void MarkSweep::ClearWhiteReferences(Object** list) {
+  DCHECK(list != NULL);
+  // Unlinking is serial, the referents are then checked and cleared in chunks.
+  std::vector<Object*> references;
+  while (*list != NULL) {
+    references.push_back(heap_->DequeuePendingReference(list));
+  }
   DCHECK(*list == NULL);
+  const size_t count = references.size();
+  // References are processed while the mutators are paused.
+  const size_t thread_count = GetThreadCount(true);
+  if (!kParallelClearReferences || thread_count <= 1 ||
+      count < 2 * kMinimumParallelReferenceChunkSize) {
+    size_t enqueue_count = (count != 0) ? ClearWhiteReferents(&references[0], count) : 0;
+    for (size_t i = 0; i < enqueue_count; ++i) {
+      heap_->EnqueueReference(references[i], &cleared_reference_list_);
+    }
+    return;
+  }
+
+  // A couple of chunks per thread.
+  const size_t chunk_size = std::max(count / (thread_count * 2),
+                                     kMinimumParallelReferenceChunkSize);
+  const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+  std::vector<size_t> enqueue_counts(chunk_count);
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  for (size_t i = 0; i < chunk_count; ++i) {
+    size_t begin = i * chunk_size;
+    thread_pool->AddTask(self, new ClearWhiteReferencesTask(this, &references[begin],
+                                                            std::min(chunk_size, count - begin),
+                                                            &enqueue_counts[i]));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  // Enqueue in list order, as the serial version does.
+  for (size_t i = 0; i < chunk_count; ++i) {
+    Object** chunk = &references[i * chunk_size];
+    for (size_t j = 0; j < enqueue_counts[i]; ++j) {
+      heap_->EnqueueReference(chunk[j], &cleared_reference_list_);
+    }
+  }
 }
 
 // Enqueues finalizer references with white referents.  White
@@ -1533,7 +2216,7 @@ void MarkSweep::EnqueueFinalizerReferences(Object** list) {
   DCHECK(list != NULL);
   timings_.StartSplit("EnqueueFinalizerReferences");
   MemberOffset zombie_offset = heap_->GetFinalizerReferenceZombieOffset();
-  bool has_enqueued = false;
+  size_t enqueued = 0;
   while (*list != NULL) {
     Object* ref = heap_->DequeuePendingReference(list);
     Object* referent = heap_->GetReferenceReferent(ref);
@@ -1544,11 +2227,12 @@ void MarkSweep::EnqueueFinalizerReferences(Object** list) {
       ref->SetFieldObject(zombie_offset, referent, false);
       heap_->ClearReferenceReferent(ref);
       heap_->EnqueueReference(ref, &cleared_reference_list_);
-      has_enqueued = true;
+      ++enqueued;
     }
   }
   timings_.EndSplit();
-  if (has_enqueued) {
+  if (enqueued != 0) {
+    heap_->RecordEnqueuedFinalizers(enqueued);
     ProcessMarkStack(true);
   }
   DCHECK(*list == NULL);
@@ -1571,6 +2255,11 @@ void MarkSweep::ProcessReferences(Object** soft_references, bool clear_soft,
     PreserveSomeSoftReferences(soft_references);
   }
 
+  // The classes of the loaders marked so far are strongly reachable, through the loaders.
+  if (unload_classes_) {
+    MarkClassesOfMarkedLoaders();
+  }
+
   timings_.StartSplit("ProcessReferences");
   // Clear all remaining soft and weak references with white
   // referents.
@@ -1581,6 +2270,9 @@ void MarkSweep::ProcessReferences(Object** soft_references, bool clear_soft,
   // Preserve all white objects with finalize methods and schedule
   // them for finalization.
   EnqueueFinalizerReferences(finalizer_references);
+  if (unload_classes_) {
+    MarkClassesOfMarkedLoaders();
+  }
 
   timings_.StartSplit("ProcessReferences");
   // Clear all f-reachable soft and weak references with white
@@ -1628,7 +2320,10 @@ void MarkSweep::FinishPhase() {
   heap->PostGcVerification(this);
 
   timings_.NewSplit("GrowForUtilization");
-  heap->GrowForUtilization(GetGcType(), GetDurationNs());
+  const std::vector<uint64_t>& pauses = GetPauseTimes();
+  heap->GrowForUtilization(GetGcType(), GetDurationNs(),
+                           pauses.empty() ? 0 : *std::max_element(pauses.begin(), pauses.end()),
+                           GetFreedBytes() + GetFreedLargeObjectBytes());
 
   timings_.NewSplit("RequestHeapTrim");
   heap->RequestHeapTrim();
@@ -1639,6 +2334,18 @@ void MarkSweep::FinishPhase() {
                                            std::plus<uint64_t>());
   total_freed_objects_ += GetFreedObjects() + GetFreedLargeObjects();
   total_freed_bytes_ += GetFreedBytes() + GetFreedLargeObjectBytes();
+  total_unloaded_classes_ += unloaded_classes_;
+  total_unloaded_class_bytes_ += unloaded_class_bytes_;
+  total_deduplicated_strings_ += deduplicated_strings_;
+  total_deduplicated_string_bytes_ += deduplicated_string_bytes_;
+  if (deduplicated_strings_ != 0) {
+    VLOG(gc) << GetName() << " deduplicated " << deduplicated_strings_ << " strings, "
+             << PrettySize(deduplicated_string_bytes_);
+  }
+  if (unloaded_classes_ != 0) {
+    VLOG(gc) << GetName() << " unloaded " << unloaded_classes_ << " classes, "
+             << PrettySize(unloaded_class_bytes_);
+  }
 
   // Ensure that the mark stack is empty.
   CHECK(mark_stack_->IsEmpty());
@@ -1656,6 +2363,19 @@ void MarkSweep::FinishPhase() {
     VLOG(gc) << "Overhead time " << PrettyDuration(overhead_time_);
   }
 
+  if (!worker_idle_ns_.empty()) {
+    std::ostringstream idle_times;
+    for (size_t i = 0; i < worker_idle_ns_.size(); ++i) {
+      idle_times << (i != 0 ? ", " : "") << PrettyDuration(worker_idle_ns_[i]);
+      if (i >= total_worker_idle_ns_.size()) {
+        total_worker_idle_ns_.push_back(0);
+      }
+      total_worker_idle_ns_[i] += worker_idle_ns_[i];
+    }
+    VLOG(gc) << "Mark stack steals " << work_steals_ << " worker idle times " << idle_times.str();
+  }
+  total_work_steals_ += work_steals_;
+
   if (kProfileLargeObjects) {
     VLOG(gc) << "Large objects tested " << large_object_test_ << " marked " << large_object_mark_;
   }
@@ -48,6 +48,7 @@ namespace accounting {
   class MarkStackChunk;
   typedef AtomicStack<mirror::Object*> ObjectStack;
   class SpaceBitmap;
+  template <typename T> class WorkStealingDeque;
 }  // namespace accounting
 
 namespace space {
@@ -62,7 +63,7 @@ class MarkSweep : public GarbageCollector {
  public:
   explicit MarkSweep(Heap* heap, bool is_concurrent, const std::string& name_prefix = "");
 
-  ~MarkSweep() {}
+  ~MarkSweep();
 
   virtual void InitializePhase();
   virtual bool IsConcurrent() const;
@@ -98,6 +99,12 @@ class MarkSweep : public GarbageCollector {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Scans the cards dirtied during concurrent marking while the mutators run, so that the pause
+  // only scans those dirtied during the last pass.
+  void PreCleanCards()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Verify that image roots point to only marked objects within the alloc space.
   void VerifyImageRoots()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
@@ -143,6 +150,11 @@ class MarkSweep : public GarbageCollector {
   // Sweeps unmarked objects to complete the garbage collection.
   void SweepLargeObjects(bool swap_bitmaps) EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
+  // SweepLargeObjects without the timing split, for the worker that sweeps large objects while
+  // Sweep runs in parallel.
+  void FreeUnmarkedLargeObjects(Thread* self, bool swap_bitmaps)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+
   // Sweep only pointers within an array. WARNING: Trashes objects.
   void SweepArray(accounting::ObjectStack* allocation_stack_, bool swap_bitmaps)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
@@ -198,12 +210,60 @@ class MarkSweep : public GarbageCollector {
     return total_freed_bytes_;
   }
 
+  // Classes unloaded by this collection, and the bytes of their objects and dex files.
+  size_t GetUnloadedClasses() const {
+    return unloaded_classes_;
+  }
+
+  size_t GetUnloadedClassBytes() const {
+    return unloaded_class_bytes_;
+  }
+
+  uint64_t GetTotalUnloadedClasses() const {
+    return total_unloaded_classes_;
+  }
+
+  uint64_t GetTotalUnloadedClassBytes() const {
+    return total_unloaded_class_bytes_;
+  }
+
+  // Strings this collection pointed at the char array of an equal string, and the size of the
+  // arrays they left.
+  size_t GetDeduplicatedStrings() const {
+    return deduplicated_strings_;
+  }
+
+  uint64_t GetTotalDeduplicatedStrings() const {
+    return total_deduplicated_strings_;
+  }
+
+  uint64_t GetTotalDeduplicatedStringBytes() const {
+    return total_deduplicated_string_bytes_;
+  }
+
+  // Number of objects parallel mark stack processing stole from other workers, cumulative.
+  uint64_t GetTotalWorkSteals() const {
+    return total_work_steals_;
+  }
+
+  // Time each parallel mark stack worker spent looking for work, cumulative.
+  const std::vector<uint64_t>& GetTotalWorkerIdleTimes() const {
+    return total_worker_idle_ns_;
+  }
+
+  virtual void ResetCumulativeStatistics();
+
   // Everything inside the immune range is assumed to be marked.
   void SetImmuneRange(mirror::Object* begin, mirror::Object* end);
 
   void SweepSystemWeaks()
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
+  // Frees the monitors of objects which are no longer locked or waited on, requires the mutators
+  // to be suspended.
+  void DeflateMonitors()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   static bool VerifyIsLiveCallback(const mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
@@ -242,6 +302,11 @@ class MarkSweep : public GarbageCollector {
   // Returns true if the object has its bit set in the mark bitmap.
   bool IsMarked(const mirror::Object* object) const;
 
+  // Marks the tenured allocations made before the GC started as live, so that a sticky GC treats
+  // them as old objects. Called by MarkReachableObjects.
+  void MarkTenuredStackAsLive()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+
   static bool IsMarkedCallback(const mirror::Object* object, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
@@ -252,6 +317,11 @@ class MarkSweep : public GarbageCollector {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
+  // Re-marks the roots of a thread unless they are unchanged since the marking checkpoint.
+  static void ReMarkThreadRootsCallback(Thread* thread, void* arg)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+
   static void VerifyImageRootVisitor(mirror::Object* root, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_,
                             Locks::mutator_lock_);
@@ -383,6 +453,12 @@ class MarkSweep : public GarbageCollector {
   void ClearWhiteReferences(mirror::Object** list)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_);
 
+  // Clears the white referents of references[0, count) and moves the references that then need to
+  // be enqueued to the front, returning how many there are. Workers may run this on disjoint
+  // ranges in parallel.
+  size_t ClearWhiteReferents(mirror::Object** references, size_t count)
+      SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_);
+
   void ProcessReferences(mirror::Object** soft_references, bool clear_soft_references,
                          mirror::Object** weak_references,
                          mirror::Object** finalizer_references,
@@ -393,6 +469,22 @@ class MarkSweep : public GarbageCollector {
   void SweepJniWeakGlobals(IsMarkedTester is_marked, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
 
+  // Marks the classes of the marked class loaders, and what they reach, until there are no more.
+  void MarkClassesOfMarkedLoaders()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Removes the unmarked classes and dex caches from the class linker, and what the runtime
+  // remembers about them outside of the heap. Requires the mutators to be suspended.
+  void UnloadClasses()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_, Locks::mutator_lock_);
+
+  // Points the marked strings of the alloc space which survived the previous collection at the
+  // char array of an equal string, in parallel with the mutators, see StringDeduplicator.
+  void DeduplicateStrings()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Whether or not we count how many of each type of object were scanned.
   static const bool kCountScannedTypes = false;
 
@@ -439,10 +531,42 @@ class MarkSweep : public GarbageCollector {
   AtomicInteger work_chunks_deleted_;
   AtomicInteger reference_count_;
   AtomicInteger cards_scanned_;
+  // Number of objects stolen from other workers' deques while processing the mark stack.
+  AtomicInteger work_steals_;
+  // Time each worker spent looking for work while processing the mark stack, in this collection.
+  std::vector<uint64_t> worker_idle_ns_;
+
+  // One deque per worker for work stealing mark stack processing, created on first use.
+  std::vector<accounting::WorkStealingDeque<const mirror::Object*>*> work_deques_;
+
+  // Cumulative work stealing statistics.
+  uint64_t total_work_steals_;
+  std::vector<uint64_t> total_worker_idle_ns_;
 
   // Verification.
   size_t live_stack_freeze_size_;
 
+  // Threads whose roots ReMarkRoots skipped.
+  size_t unchanged_thread_roots_;
+
+  // Whether this collection unloads the classes of the unreachable class loaders, in which case
+  // the class linker roots leave those classes out, see ClassLinker::VisitRoots.
+  bool unload_classes_;
+  size_t unloaded_classes_;
+  size_t unloaded_class_bytes_;
+  uint64_t total_unloaded_classes_;
+  uint64_t total_unloaded_class_bytes_;
+
+  // Whether this collection deduplicates strings, with -XX:DeduplicateStrings in the concurrent
+  // collections which aren't sticky.
+  bool deduplicate_strings_;
+  // The strings allocated since the previous collection, sorted, which aren't deduplicated yet.
+  std::vector<const mirror::Object*> young_strings_;
+  size_t deduplicated_strings_;
+  size_t deduplicated_string_bytes_;
+  uint64_t total_deduplicated_strings_;
+  uint64_t total_deduplicated_string_bytes_;
+
   UniquePtr<Barrier> gc_barrier_;
   Mutex large_object_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   Mutex mark_stack_lock_ ACQUIRED_AFTER(Locks::classlinker_classes_lock_);
@@ -456,6 +580,7 @@ class MarkSweep : public GarbageCollector {
   friend class CardScanTask;
   friend class CheckBitmapVisitor;
   friend class CheckReferenceVisitor;
+  friend class ClearWhiteReferencesTask;
   friend class art::gc::Heap;
   friend class InternTableEntryIsUnmarked;
   friend class MarkIfReachesAllocspaceVisitor;
@@ -468,8 +593,11 @@ class MarkSweep : public GarbageCollector {
   friend class ModUnionScanImageRootVisitor;
   friend class ScanBitmapVisitor;
   friend class ScanImageRootVisitor;
+  friend class SweepLargeObjectsTask;
+  friend class SweepTask;
   template<bool kUseFinger> friend class MarkStackTask;
   friend class FifoMarkStackChunk;
+  friend class WorkStealingMarkTask;
 
   DISALLOW_COPY_AND_ASSIGN(MarkSweep);
 };
@@ -51,6 +51,7 @@ void StickyMarkSweep::MarkReachableObjects() {
   // stack here since all objects in the mark stack will get scanned by the card scanning anyways.
   // TODO: Not put these objects in the mark stack in the first place.
   mark_stack_->Reset();
+  MarkTenuredStackAsLive();
   RecursiveMarkDirtyObjects(false, accounting::CardTable::kCardDirty - 1);
 }
 
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_HEAP_INL_H_
+#define ART_RUNTIME_GC_HEAP_INL_H_
+
+#include "heap.h"
+
+#include "allocation_profiler.h"
+#include "debugger.h"
+#include "gc/accounting/atomic_stack.h"
+#include "gc/space/dlmalloc_space-inl.h"
+#include "runtime.h"
+#include "runtime_stats.h"
+#include "thread.h"
+
+namespace art {
+namespace gc {
+
+inline void Heap::RecordAllocation(Thread* self, size_t size, mirror::Object* obj) {
+  DCHECK(obj != NULL);
+  DCHECK_GT(size, 0u);
+  num_bytes_allocated_.fetch_add(size);
+
+  if (Runtime::Current()->HasStatsEnabled()) {
+    RuntimeStats* thread_stats = self->GetStats();
+    ++thread_stats->allocated_objects;
+    thread_stats->allocated_bytes += size;
+
+    // TODO: Update these atomically.
+    RuntimeStats* global_stats = Runtime::Current()->GetStats();
+    ++global_stats->allocated_objects;
+    global_stats->allocated_bytes += size;
+  }
+
+  // This is safe to do since the GC will never free objects which are neither in the allocation
+  // stack or the live bitmap.
+  if (UNLIKELY(kGCALotMode || self->IsAllocatingTenured())) {
+    // GC-a-lot collects every time the small allocation stack is full, so it pushes one by one.
+    accounting::ObjectStack* stack = self->IsAllocatingTenured() ? tenured_allocation_stack_.get()
+                                                                 : allocation_stack_.get();
+    while (!stack->AtomicPushBack(obj)) {
+      CollectGarbageInternal(collector::kGcTypeSticky, kGcCauseForAlloc, false);
+    }
+    if (self->IsAllocatingTenured()) {
+      // Sticky GCs treat tenured objects as old and only scan them through dirty cards, but
+      // compiled code elides the card marks of stores into objects it has just allocated.
+      card_table_->MarkCard(obj);
+    }
+    return;
+  }
+  // Threads reserve the slots in bulk, so that pushing doesn't have them all hammer the cache line
+  // of the back index.
+  while (!self->PushOnThreadLocalAllocationStack(obj)) {
+    mirror::Object** start;
+    mirror::Object** end;
+    if (allocation_stack_->AtomicBumpBack(kThreadLocalAllocationStackSize, &start, &end)) {
+      self->SetThreadLocalAllocationStack(start, end);
+    } else {
+      CollectGarbageInternal(collector::kGcTypeSticky, kGcCauseForAlloc, false);
+    }
+  }
+}
+
+inline mirror::Object* Heap::AllocObjectFromTlab(Thread* self, mirror::Class* c,
+                                                 size_t byte_count) {
+  DCHECK_GE(byte_count, sizeof(mirror::Object));
+  DCHECK_EQ(self->GetState(), kRunnable);
+  if (!use_tlab_ || byte_count > space::DlMallocSpace::kMaxThreadLocalAllocSize ||
+      Dbg::IsAllocTrackingEnabled() || AllocationProfiler::IsEnabled() ||
+      kDesiredHeapVerification > kNoHeapVerification) {
+    return NULL;
+  }
+  // Starting a collection or growing the heap is left to AllocObject.
+  size_t new_num_bytes_allocated = static_cast<size_t>(num_bytes_allocated_) + byte_count;
+  if (UNLIKELY(new_num_bytes_allocated >= concurrent_start_bytes_ ||
+               new_num_bytes_allocated > max_allowed_footprint_)) {
+    return NULL;
+  }
+  size_t bytes_allocated;
+  mirror::Object* obj = alloc_space_->AllocThreadLocal(self, byte_count, &bytes_allocated);
+  if (UNLIKELY(obj == NULL)) {
+    return NULL;
+  }
+  obj->SetClass(c);
+  RecordAllocation(self, bytes_allocated, obj);
+  return obj;
+}
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_HEAP_INL_H_
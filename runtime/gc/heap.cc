@@ -19,10 +19,17 @@
 #define ATRACE_TAG ATRACE_TAG_DALVIK
 #include <cutils/trace.h>
 
+#include <stdio.h>
+#include <string.h>
+
 #include <limits>
+#include <sstream>
 #include <vector>
 #include <valgrind.h>
 
+#include "allocation_profiler.h"
+#include "atomic_integer.h"
+#include "base/histogram-inl.h"
 #include "base/stl_util.h"
 #include "common_throws.h"
 #include "cutils/sched_policy.h"
@@ -32,45 +39,64 @@
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/mod_union_table-inl.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/allocation_site_table.h"
 #include "gc/collector/mark_sweep-inl.h"
 #include "gc/collector/partial_mark_sweep.h"
 #include "gc/collector/sticky_mark_sweep.h"
+#include "gc/heap-inl.h"
 #include "gc/space/dlmalloc_space-inl.h"
 #include "gc/space/image_space.h"
 #include "gc/space/large_object_space.h"
 #include "gc/space/space-inl.h"
+#include "gc/string_deduplicator.h"
 #include "image.h"
 #include "invoke_arg_array_builder.h"
+#include "metrics.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
+#include "mirror/string.h"
 #include "object_utils.h"
 #include "os.h"
 #include "ScopedLocalRef.h"
 #include "scoped_thread_state_change.h"
 #include "sirt_ref.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "UniquePtr.h"
 #include "well_known_classes.h"
 
 namespace art {
 namespace gc {
 
-static constexpr bool kGCALotMode = false;
 static constexpr size_t kGcAlotInterval = KB;
 static constexpr bool kDumpGcPerformanceOnShutdown = false;
 // Minimum amount of remaining bytes before a concurrent GC is triggered.
 static constexpr size_t kMinConcurrentRemainingBytes = 128 * KB;
 // If true, measure the total allocation time.
 static constexpr bool kMeasureAllocationTime = false;
+// Sticky GCs only pay off while most objects allocated since the previous GC die young. Once a
+// sticky GC frees less than this fraction of them, the next GC is a partial GC.
+static constexpr double kMinStickyGcFreedRatio = 0.25;
+// How far the ergonomics move the utilization after a GC, and the range they keep it in, the same
+// as -XX:HeapTargetUtilization's.
+static constexpr double kErgonomicUtilizationStep = 0.05;
+static constexpr double kMinErgonomicUtilization = 0.1;
+static constexpr double kMaxErgonomicUtilization = 0.9;
+// The most the ergonomics scale the bytes left when a concurrent GC starts.
+static constexpr double kMaxConcurrentStartScale = 8.0;
 
 Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max_free,
            double target_utilization, size_t capacity, const std::string& original_image_file_name,
            bool concurrent_gc, size_t parallel_gc_threads, size_t conc_gc_threads,
            bool low_memory_mode, size_t long_pause_log_threshold, size_t long_gc_log_threshold,
-           bool ignore_max_footprint)
+           bool ignore_max_footprint, bool use_tlab, bool use_rosalloc, size_t pause_goal,
+           double throughput_goal, bool pretenure, bool deduplicate_strings,
+           bool class_unloading, bool huge_pages, bool verify_pre_gc_heap, bool verify_post_gc_heap,
+           bool verify_missing_card_marks, size_t verify_sample_percent,
+           bool track_instance_counts)
     : alloc_space_(NULL),
       card_table_(NULL),
       concurrent_gc_(concurrent_gc),
@@ -80,11 +106,23 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       long_pause_log_threshold_(long_pause_log_threshold),
       long_gc_log_threshold_(long_gc_log_threshold),
       ignore_max_footprint_(ignore_max_footprint),
+      // RosAlloc has its own thread-local runs, so it doesn't combine with TLABs.
+      use_tlab_(use_tlab && !use_rosalloc && !RUNNING_ON_VALGRIND),
+      use_rosalloc_(use_rosalloc && !RUNNING_ON_VALGRIND),
+      pause_goal_(pause_goal),
+      throughput_goal_(throughput_goal),
+      deduplicate_strings_(deduplicate_strings),
+      class_unloading_(class_unloading),
+      track_instance_counts_(track_instance_counts),
+      instance_counts_lock_(NULL),
+      have_instance_counts_(false),
+      total_tlab_wasted_bytes_(0),
       have_zygote_space_(false),
       soft_ref_queue_lock_(NULL),
       weak_ref_queue_lock_(NULL),
       finalizer_ref_queue_lock_(NULL),
       phantom_ref_queue_lock_(NULL),
+      native_blocking_lock_(NULL),
       is_gc_running_(false),
       last_gc_type_(collector::kGcTypeNone),
       next_gc_type_(collector::kGcTypePartial),
@@ -93,6 +131,7 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       max_allowed_footprint_(initial_size),
       native_footprint_gc_watermark_(initial_size),
       native_footprint_limit_(2 * initial_size),
+      native_concurrent_start_bytes_(initial_size),
       activity_thread_class_(NULL),
       application_thread_class_(NULL),
       activity_thread_(NULL),
@@ -109,15 +148,24 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       num_bytes_allocated_(0),
       native_bytes_allocated_(0),
       gc_memory_overhead_(0),
-      verify_missing_card_marks_(false),
+      verify_missing_card_marks_(verify_missing_card_marks),
       verify_system_weaks_(false),
-      verify_pre_gc_heap_(false),
-      verify_post_gc_heap_(false),
+      verify_pre_gc_heap_(verify_pre_gc_heap),
+      verify_post_gc_heap_(verify_post_gc_heap),
       verify_mod_union_table_(false),
+      verify_sample_percent_(verify_sample_percent),
+      verify_sample_seed_(0),
       min_alloc_space_size_for_sticky_gc_(2 * MB),
       min_remaining_space_for_sticky_gc_(1 * MB),
       last_trim_time_ms_(0),
+      bytes_allocated_since_last_gc_(0),
+      total_sticky_gc_young_bytes_(0),
+      total_sticky_gc_freed_bytes_(0),
       allocation_rate_(0),
+      native_allocation_rate_(0),
+      native_bytes_after_last_gc_(0),
+      last_gc_duration_ns_(0),
+      native_blocking_histogram_("RegisterNativeAllocation blocking", 10),
       /* For GC a lot mode, we limit the allocations stacks to be kGcAlotInterval allocations. This
        * causes a lot of GC since we do a GC for alloc whenever the stack is full. When heap
        * verification is enabled, we limit the size of allocation stacks to speed up their
@@ -130,9 +178,22 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
       reference_queueNext_offset_(0),
       reference_pendingNext_offset_(0),
       finalizer_reference_zombie_offset_(0),
+      finalizer_reference_class_(NULL),
+      finalizer_reference_list_lock_(NULL),
+      finalizer_reference_head_(NULL),
+      finalizer_reference_queue_(NULL),
+      finalizer_reference_prev_offset_(0),
+      finalizer_reference_next_offset_(0),
+      total_finalizers_enqueued_(0),
       min_free_(min_free),
       max_free_(max_free),
       target_utilization_(target_utilization),
+      ergonomic_utilization_(target_utilization),
+      concurrent_start_scale_(1.0),
+      last_gc_cause_(kGcCauseBackground),
+      total_trims_(0),
+      total_trimmed_bytes_(0),
+      total_trim_time_ns_(0),
       total_wait_time_(0),
       total_allocation_time_(0),
       verify_object_mode_(kHeapVerificationNotPermitted),
@@ -162,17 +223,50 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
     }
   }
 
+  // With huge pages, the alloc space, its bitmaps and the card table, which marking and the write
+  // barrier touch all over, are carved one after the other from a single range advised to use huge
+  // pages. The reservation is sized for the card table to cover the image spaces too, anything
+  // left of it is unmapped once the heap is set up.
+  UniquePtr<MemMap> reservation;
+  if (huge_pages) {
+    size_t alloc_space_capacity = RoundUp(capacity, kPageSize);
+    size_t card_table_capacity = alloc_space_capacity;
+    if (!continuous_spaces_.empty()) {
+      card_table_capacity += requested_alloc_space_begin - continuous_spaces_.front()->Begin();
+    }
+    size_t reservation_size = alloc_space_capacity +
+        2 * RoundUp(accounting::SpaceBitmap::ComputeSize(alloc_space_capacity), kPageSize) +
+        RoundUp(accounting::CardTable::ComputeSize(card_table_capacity), kPageSize);
+    reservation.reset(MemMap::ReserveAddressSpace("heap reservation", requested_alloc_space_begin,
+                                                  reservation_size, true));
+    if (reservation.get() == NULL) {
+      LOG(WARNING) << "Failed to reserve " << PrettySize(reservation_size)
+                   << " for the heap, mapping its regions separately";
+    } else if (requested_alloc_space_begin != NULL &&
+               reservation->Begin() != requested_alloc_space_begin) {
+      // The card table then spans the gap to the image and only it is mapped separately.
+      LOG(WARNING) << "Heap reserved at " << reinterpret_cast<void*>(reservation->Begin())
+                   << " instead of " << reinterpret_cast<void*>(requested_alloc_space_begin);
+    }
+  }
+
   alloc_space_ = space::DlMallocSpace::Create(Runtime::Current()->IsZygote() ? "zygote space" : "alloc space",
                                               initial_size,
                                               growth_limit, capacity,
-                                              requested_alloc_space_begin);
+                                              requested_alloc_space_begin, use_rosalloc_,
+                                              reservation.get());
   CHECK(alloc_space_ != NULL) << "Failed to create alloc space";
   alloc_space_->SetFootprintLimit(alloc_space_->Capacity());
   AddContinuousSpace(alloc_space_);
 
   // Allocate the large object space.
   const bool kUseFreeListSpaceForLOS = false;
-  if (kUseFreeListSpaceForLOS) {
+  // Reuses freed runs without a system call, but reserves capacity bytes of address space.
+  const bool kUseSegregatedFreeListSpaceForLOS = false;
+  if (kUseSegregatedFreeListSpaceForLOS) {
+    large_object_space_ = space::SegregatedFreeListSpace::Create("large object space", NULL,
+                                                                 capacity);
+  } else if (kUseFreeListSpaceForLOS) {
     large_object_space_ = space::FreeListSpace::Create("large object space", NULL, capacity);
   } else {
     large_object_space_ = space::LargeObjectMapSpace::Create("large object space");
@@ -188,7 +282,7 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
   }
 
   // Allocate the card table.
-  card_table_.reset(accounting::CardTable::Create(heap_begin, heap_capacity));
+  card_table_.reset(accounting::CardTable::Create(heap_begin, heap_capacity, reservation.get()));
   CHECK(card_table_.get() != NULL) << "Failed to create card table";
 
   image_mod_union_table_.reset(new accounting::ModUnionTableToZygoteAllocspace(this));
@@ -207,6 +301,13 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
                                                           max_allocation_stack_size_));
   live_stack_.reset(accounting::ObjectStack::Create("live stack",
                                                     max_allocation_stack_size_));
+  tenured_allocation_stack_.reset(accounting::ObjectStack::Create("tenured allocation stack",
+                                                                  max_allocation_stack_size_));
+  tenured_live_stack_.reset(accounting::ObjectStack::Create("tenured live stack",
+                                                            max_allocation_stack_size_));
+  if (pretenure) {
+    allocation_site_table_.reset(new AllocationSiteTable);
+  }
 
   // It's still too early to take a lock because there are no threads yet, but we can create locks
   // now. We don't create it earlier to make it clear that you can't use locks during heap
@@ -220,6 +321,8 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
   weak_ref_queue_lock_ = new Mutex("Weak reference queue lock");
   finalizer_ref_queue_lock_ = new Mutex("Finalizer reference queue lock");
   phantom_ref_queue_lock_ = new Mutex("Phantom reference queue lock");
+  native_blocking_lock_ = new Mutex("Native allocation blocking lock");
+  instance_counts_lock_ = new Mutex("Instance counts lock");
 
   last_gc_time_ns_ = NanoTime();
   last_gc_size_ = GetBytesAllocated();
@@ -246,7 +349,8 @@ Heap::Heap(size_t initial_size, size_t growth_limit, size_t min_free, size_t max
 void Heap::CreateThreadPool() {
   const size_t num_threads = std::max(parallel_gc_threads_, conc_gc_threads_);
   if (num_threads != 0) {
-    thread_pool_.reset(new ThreadPool(num_threads));
+    thread_pool_.reset(new ThreadPool(num_threads, true));
+    Runtime::Current()->SetUpThreadScheduling(thread_pool_.get(), Runtime::kGcThreads);
   }
 }
 
@@ -450,6 +554,25 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
          << " objects with total size " << PrettySize(freed_bytes) << "\n"
          << collector->GetName() << " throughput: " << freed_objects / seconds << "/s / "
          << PrettySize(freed_bytes / seconds) << "/s\n";
+      if (collector->GetTotalUnloadedClasses() != 0) {
+        os << collector->GetName() << " unloaded: " << collector->GetTotalUnloadedClasses()
+           << " classes with total size " << PrettySize(collector->GetTotalUnloadedClassBytes())
+           << "\n";
+      }
+      if (collector->GetTotalDeduplicatedStrings() != 0) {
+        os << collector->GetName() << " deduplicated: " << collector->GetTotalDeduplicatedStrings()
+           << " strings leaving arrays of total size "
+           << PrettySize(collector->GetTotalDeduplicatedStringBytes()) << "\n";
+      }
+      const std::vector<uint64_t>& idle_times = collector->GetTotalWorkerIdleTimes();
+      if (!idle_times.empty()) {
+        os << collector->GetName() << " mark stack steals: " << collector->GetTotalWorkSteals()
+           << "\n" << collector->GetName() << " mark stack worker idle times:";
+        for (uint64_t idle_time : idle_times) {
+          os << " " << PrettyDuration(idle_time);
+        }
+        os << "\n";
+      }
       total_duration += total_ns;
       total_paused_time += total_pause_ns;
     }
@@ -472,8 +595,53 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
     os << "Mean allocation time: " << PrettyDuration(allocation_time / total_objects_allocated)
        << "\n";
   }
+  if (use_tlab_) {
+    uint64_t total_tlab_refills = 0;
+    for (const auto& space : continuous_spaces_) {
+      if (space->IsDlMallocSpace()) {
+        total_tlab_refills += space->AsDlMallocSpace()->GetTotalThreadLocalRefills();
+      }
+    }
+    os << "Total TLAB refills: " << total_tlab_refills << "\n";
+    os << "Total TLAB wasted bytes: " << PrettySize(total_tlab_wasted_bytes_) << "\n";
+  }
   os << "Total mutator paused time: " << PrettyDuration(total_paused_time) << "\n";
+  if (total_sticky_gc_young_bytes_ != 0) {
+    os << "Sticky GC freed " << PrettySize(total_sticky_gc_freed_bytes_) << " of "
+       << PrettySize(total_sticky_gc_young_bytes_) << " allocated since the previous GC\n";
+  }
+  // The thread list is gone by the time the heap is deleted during shutdown.
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  if (thread_list != NULL) {
+    thread_list->DumpSuspendAllTimings(os);
+  }
   os << "Total time waiting for GC to complete: " << PrettyDuration(total_wait_time_) << "\n";
+  if (total_trims_ != 0) {
+    os << "Heap trims: " << total_trims_ << ", advised " << PrettySize(total_trimmed_bytes_)
+       << " back to the kernel in " << PrettyDuration(total_trim_time_ns_) << "\n";
+  }
+  if (allocation_site_table_.get() != NULL) {
+    allocation_site_table_->Dump(os);
+  }
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, *native_blocking_lock_);
+    if (native_blocking_histogram_.SampleSize() != 0) {
+      Histogram<uint64_t>::CumulativeData cumulative_data;
+      native_blocking_histogram_.CreateHistogram(cumulative_data);
+      os << "Threads blocked " << native_blocking_histogram_.SampleSize()
+         << " times in RegisterNativeAllocation, "
+         << PrettyDuration(native_blocking_histogram_.Sum() * 1000) << " in total\n";
+      native_blocking_histogram_.PrintConfidenceIntervals(os, 0.99, cumulative_data);
+    }
+  }
+  // The list can only be walked safely when nothing else runs, as on SIGQUIT.
+  if (finalizer_reference_class_ != NULL && self != NULL &&
+      Locks::mutator_lock_->IsExclusiveHeld(self)) {
+    DumpFinalizerBacklog(os);
+  }
+  os << "Mod-union table memory: image " << PrettySize(image_mod_union_table_->GetMemoryUsage())
+     << ", zygote " << PrettySize(zygote_mod_union_table_->GetMemoryUsage()) << "\n";
   os << "Approximate GC data structures memory overhead: " << gc_memory_overhead_;
 }
 
@@ -487,6 +655,8 @@ Heap::~Heap() {
   // If we don't reset then the mark stack complains in it's destructor.
   allocation_stack_->Reset();
   live_stack_->Reset();
+  tenured_allocation_stack_->Reset();
+  tenured_live_stack_->Reset();
 
   VLOG(heap) << "~Heap()";
   // We can't take the heap lock here because there might be a daemon thread suspended with the
@@ -500,6 +670,8 @@ Heap::~Heap() {
   delete weak_ref_queue_lock_;
   delete finalizer_ref_queue_lock_;
   delete phantom_ref_queue_lock_;
+  delete native_blocking_lock_;
+  delete instance_counts_lock_;
 }
 
 space::ContinuousSpace* Heap::FindContinuousSpaceFromObject(const mirror::Object* obj,
@@ -591,11 +763,14 @@ mirror::Object* Heap::AllocObject(Thread* self, mirror::Class* c, size_t byte_co
 
     // Record allocation after since we want to use the atomic add for the atomic fence to guard
     // the SetClass since we do not want the class to appear NULL in another thread.
-    RecordAllocation(bytes_allocated, obj);
+    RecordAllocation(self, bytes_allocated, obj);
 
     if (Dbg::IsAllocTrackingEnabled()) {
       Dbg::RecordAllocation(c, byte_count);
     }
+    if (UNLIKELY(AllocationProfiler::IsEnabled())) {
+      AllocationProfiler::RecordAllocation(self, c, byte_count);
+    }
     if (UNLIKELY(static_cast<size_t>(num_bytes_allocated_) >= concurrent_start_bytes_)) {
       // The SirtRef is necessary since the calls in RequestConcurrentGC are a safepoint.
       SirtRef<mirror::Object> ref(self, obj);
@@ -631,6 +806,53 @@ mirror::Object* Heap::AllocObject(Thread* self, mirror::Class* c, size_t byte_co
   }
 }
 
+mirror::Object* Heap::AllocObjectPair(Thread* self, mirror::Class* first_class,
+                                      size_t first_num_bytes, mirror::Class* second_class,
+                                      size_t second_num_bytes, mirror::Object** second) {
+  DCHECK_GE(first_num_bytes, sizeof(mirror::Object));
+  DCHECK_GE(second_num_bytes, sizeof(mirror::Object));
+  DCHECK_EQ(self->GetState(), kRunnable);
+  // Only the dlmalloc space places chunks side by side, large objects go to their own space.
+  size_t num_bytes = first_num_bytes + second_num_bytes;
+  if (UNLIKELY(running_on_valgrind_ || use_rosalloc_ || num_bytes >= large_object_threshold_ ||
+               IsOutOfMemoryOnAllocation(num_bytes, false))) {
+    return NULL;
+  }
+  mirror::Object* first;
+  size_t first_bytes_allocated;
+  size_t second_bytes_allocated;
+  if (!alloc_space_->AllocPair(self, first_num_bytes, second_num_bytes, &first, second,
+                               &first_bytes_allocated, &second_bytes_allocated)) {
+    return NULL;
+  }
+  first->SetClass(first_class);
+  (*second)->SetClass(second_class);
+  RecordAllocation(self, first_bytes_allocated, first);
+  {
+    // Recording the second allocation may collect, which would free the first if unreferenced.
+    SirtRef<mirror::Object> first_ref(self, first);
+    RecordAllocation(self, second_bytes_allocated, *second);
+  }
+  if (Dbg::IsAllocTrackingEnabled()) {
+    Dbg::RecordAllocation(first_class, first_num_bytes);
+    Dbg::RecordAllocation(second_class, second_num_bytes);
+  }
+  if (UNLIKELY(AllocationProfiler::IsEnabled())) {
+    AllocationProfiler::RecordAllocation(self, first_class, first_num_bytes);
+    AllocationProfiler::RecordAllocation(self, second_class, second_num_bytes);
+  }
+  if (UNLIKELY(static_cast<size_t>(num_bytes_allocated_) >= concurrent_start_bytes_)) {
+    SirtRef<mirror::Object> first_ref(self, first);
+    SirtRef<mirror::Object> second_ref(self, *second);
+    RequestConcurrentGC(self);
+  }
+  if (kDesiredHeapVerification > kNoHeapVerification) {
+    VerifyObject(first);
+    VerifyObject(*second);
+  }
+  return first;
+}
+
 bool Heap::IsHeapAddress(const mirror::Object* obj) {
   // Note: we deliberately don't take the lock here, and mustn't test anything that would
   // require taking the lock.
@@ -677,6 +899,10 @@ bool Heap::IsLiveObjectLocked(const mirror::Object* obj, bool search_allocation_
       } else if (allocation_stack_->Contains(const_cast<mirror::Object*>(obj))) {
         return true;
       }
+      // The tenured stacks are never sorted.
+      if (tenured_allocation_stack_->Contains(const_cast<mirror::Object*>(obj))) {
+        return true;
+      }
     }
 
     if (search_live_stack) {
@@ -687,6 +913,9 @@ bool Heap::IsLiveObjectLocked(const mirror::Object* obj, bool search_allocation_
       } else if (live_stack_->Contains(const_cast<mirror::Object*>(obj))) {
         return true;
       }
+      if (tenured_live_stack_->Contains(const_cast<mirror::Object*>(obj))) {
+        return true;
+      }
     }
   }
   // We need to check the bitmaps again since there is a race where we mark something as live and
@@ -771,29 +1000,6 @@ void Heap::VerifyHeap() {
   GetLiveBitmap()->Walk(Heap::VerificationCallback, this);
 }
 
-inline void Heap::RecordAllocation(size_t size, mirror::Object* obj) {
-  DCHECK(obj != NULL);
-  DCHECK_GT(size, 0u);
-  num_bytes_allocated_.fetch_add(size);
-
-  if (Runtime::Current()->HasStatsEnabled()) {
-    RuntimeStats* thread_stats = Thread::Current()->GetStats();
-    ++thread_stats->allocated_objects;
-    thread_stats->allocated_bytes += size;
-
-    // TODO: Update these atomically.
-    RuntimeStats* global_stats = Runtime::Current()->GetStats();
-    ++global_stats->allocated_objects;
-    global_stats->allocated_bytes += size;
-  }
-
-  // This is safe to do since the GC will never free objects which are neither in the allocation
-  // stack or the live bitmap.
-  while (!allocation_stack_->AtomicPushBack(obj)) {
-    CollectGarbageInternal(collector::kGcTypeSticky, kGcCauseForAlloc, false);
-  }
-}
-
 void Heap::RecordFree(size_t freed_objects, size_t freed_bytes) {
   DCHECK_LE(freed_bytes, static_cast<size_t>(num_bytes_allocated_));
   num_bytes_allocated_.fetch_sub(freed_bytes);
@@ -841,7 +1047,13 @@ inline mirror::Object* Heap::TryToAllocate(Thread* self, space::DlMallocSpace* s
   if (UNLIKELY(IsOutOfMemoryOnAllocation(alloc_size, grow))) {
     return NULL;
   }
-  if (LIKELY(!running_on_valgrind_)) {
+  if (LIKELY(!running_on_valgrind_ && !use_rosalloc_)) {
+    if (use_tlab_) {
+      mirror::Object* obj = space->AllocThreadLocal(self, alloc_size, bytes_allocated);
+      if (LIKELY(obj != NULL)) {
+        return obj;
+      }
+    }
     return space->AllocNonvirtual(self, alloc_size, bytes_allocated);
   } else {
     return space->Alloc(self, alloc_size, bytes_allocated);
@@ -938,6 +1150,7 @@ void Heap::SetTargetHeapUtilization(float target) {
   DCHECK_GT(target, 0.0f);  // asserted in Java code
   DCHECK_LT(target, 1.0f);
   target_utilization_ = target;
+  ergonomic_utilization_ = target;
 }
 
 void Heap::SetTargetHeapMinFree(size_t bytes) {
@@ -999,58 +1212,205 @@ size_t Heap::GetBytesAllocatedEver() const {
   return total;
 }
 
-class InstanceCounter {
+// Visits the live objects of a stripe of a bitmap with the visitor of the stripe.
+template <typename Visitor>
+class LiveObjectsVisitTask : public Task {
  public:
-  InstanceCounter(const std::vector<mirror::Class*>& classes, bool use_is_assignable_from, uint64_t* counts)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
-      : classes_(classes), use_is_assignable_from_(use_is_assignable_from), counts_(counts) {
+  LiveObjectsVisitTask(accounting::SpaceBitmap* bitmap, uintptr_t begin, uintptr_t end,
+                       Visitor* visitor)
+      : bitmap_(bitmap), begin_(begin), end_(end), visitor_(visitor) {}
+
+  virtual void Run(Thread* self) NO_THREAD_SAFETY_ANALYSIS {
+    bitmap_->VisitMarkedRange(begin_, end_, *visitor_);
   }
 
-  void operator()(const mirror::Object* o) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    for (size_t i = 0; i < classes_.size(); ++i) {
-      const mirror::Class* instance_class = o->GetClass();
-      if (use_is_assignable_from_) {
-        if (instance_class != NULL && classes_[i]->IsAssignableFrom(instance_class)) {
-          ++counts_[i];
-        }
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  accounting::SpaceBitmap* const bitmap_;
+  const uintptr_t begin_;
+  const uintptr_t end_;
+  Visitor* const visitor_;
+};
+
+template <typename Visitor>
+void Heap::VisitLiveObjectsInParallel(Thread* self, const Visitor& prototype,
+                                      std::vector<Visitor>* visitors) {
+  size_t thread_count = (thread_pool_.get() != nullptr) ? parallel_gc_threads_ + 1 : 1;
+  struct Stripe {
+    accounting::SpaceBitmap* bitmap;
+    uintptr_t begin;
+    uintptr_t end;
+  };
+  std::vector<Stripe> stripes;
+  for (const auto& bitmap : live_bitmap_->continuous_space_bitmaps_) {
+    // A few stripes per thread even out the uneven density of live objects across a space.
+    size_t stripe_size = RoundUp(bitmap->HeapSize() / (thread_count * 4) + 1, kPageSize);
+    for (uintptr_t begin = bitmap->HeapBegin(); begin < bitmap->HeapLimit(); begin += stripe_size) {
+      Stripe stripe = { bitmap, begin, std::min(begin + stripe_size, bitmap->HeapLimit()) };
+      stripes.push_back(stripe);
+    }
+  }
+  visitors->clear();
+  visitors->reserve(stripes.size() + 1);
+  for (size_t i = 0; i <= stripes.size(); ++i) {
+    visitors->push_back(prototype);
+  }
+  for (size_t i = 0; i < stripes.size(); ++i) {
+    auto* task = new LiveObjectsVisitTask<Visitor>(stripes[i].bitmap, stripes[i].begin,
+                                                   stripes[i].end, &(*visitors)[i]);
+    if (thread_count > 1) {
+      thread_pool_->AddTask(self, task);
+    } else {
+      task->Run(self);
+      task->Finalize();
+    }
+  }
+  if (thread_count > 1) {
+    thread_pool_->SetMaxActiveWorkers(thread_count - 1);
+    thread_pool_->StartWorkers(self);
+    thread_pool_->Wait(self, true, true);
+    thread_pool_->StopWorkers(self);
+  }
+  // Large objects are few, the last visitor sees them on this thread.
+  for (const auto& space_set : live_bitmap_->discontinuous_space_sets_) {
+    space_set->Visit(visitors->back());
+  }
+}
+
+void Heap::StartHeapWalk(Thread* self) {
+  ScopedThreadStateChange tsc(self, kWaitingPerformingGc);
+  while (true) {
+    {
+      MutexLock mu(self, *gc_complete_lock_);
+      if (!is_gc_running_) {
+        is_gc_running_ = true;
+        return;
+      }
+    }
+    WaitForConcurrentGcToComplete(self);
+  }
+}
+
+void Heap::FinishHeapWalk(Thread* self) {
+  MutexLock mu(self, *gc_complete_lock_);
+  is_gc_running_ = false;
+  gc_complete_cond_->Broadcast(self);
+}
+
+// Counts the live instances of every class, the objects of a class often being next to each other.
+class ClassInstanceCounter {
+ public:
+  ClassInstanceCounter() : last_class_(NULL), last_count_(0) {}
+
+  void operator()(const mirror::Object* o) const NO_THREAD_SAFETY_ANALYSIS {
+    const mirror::Class* instance_class = o->GetClass();
+    if (instance_class != last_class_) {
+      Flush();
+      last_class_ = instance_class;
+    }
+    ++last_count_;
+  }
+
+  // Adds the counts to counts.
+  void AddTo(SafeMap<const mirror::Class*, uint64_t>* counts) const {
+    Flush();
+    for (const auto& entry : counts_) {
+      auto it = counts->find(entry.first);
+      if (it == counts->end()) {
+        counts->Put(entry.first, entry.second);
       } else {
-        if (instance_class == classes_[i]) {
-          ++counts_[i];
-        }
+        it->second += entry.second;
       }
     }
   }
 
  private:
-  const std::vector<mirror::Class*>& classes_;
-  bool use_is_assignable_from_;
-  uint64_t* const counts_;
+  void Flush() const {
+    if (last_count_ != 0) {
+      auto it = counts_.find(last_class_);
+      if (it == counts_.end()) {
+        counts_.Put(last_class_, last_count_);
+      } else {
+        it->second += last_count_;
+      }
+      last_count_ = 0;
+    }
+  }
 
-  DISALLOW_COPY_AND_ASSIGN(InstanceCounter);
+  mutable SafeMap<const mirror::Class*, uint64_t> counts_;
+  mutable const mirror::Class* last_class_;
+  mutable uint64_t last_count_;
 };
 
+void Heap::UpdateInstanceCounts(Thread* self) {
+  std::vector<ClassInstanceCounter> counters;
+  {
+    ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    VisitLiveObjectsInParallel(self, ClassInstanceCounter(), &counters);
+  }
+  SafeMap<const mirror::Class*, uint64_t> counts;
+  for (const auto& counter : counters) {
+    counter.AddTo(&counts);
+  }
+  MutexLock mu(self, *instance_counts_lock_);
+  instance_counts_ = counts;
+  have_instance_counts_ = true;
+}
+
 void Heap::CountInstances(const std::vector<mirror::Class*>& classes, bool use_is_assignable_from,
                           uint64_t* counts) {
-  // We only want reachable instances, so do a GC. This also ensures that the alloc stack
-  // is empty, so the live bitmap is the only place we need to look.
   Thread* self = Thread::Current();
-  self->TransitionFromRunnableToSuspended(kNative);
-  CollectGarbage(false);
-  self->TransitionFromSuspendedToRunnable();
+  SafeMap<const mirror::Class*, uint64_t> instance_counts;
+  bool have_instance_counts = false;
+  if (track_instance_counts_) {
+    // Counted at the end of the last collection, without walking the heap again.
+    MutexLock mu(self, *instance_counts_lock_);
+    instance_counts = instance_counts_;
+    have_instance_counts = have_instance_counts_;
+  }
+  if (!have_instance_counts) {
+    // We only want reachable instances, so do a GC. This also ensures that the alloc stack
+    // is empty, so the live bitmap is the only place we need to look.
+    self->TransitionFromRunnableToSuspended(kNative);
+    CollectGarbage(false);
+    self->TransitionFromSuspendedToRunnable();
+
+    StartHeapWalk(self);
+    std::vector<ClassInstanceCounter> counters;
+    {
+      ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+      VisitLiveObjectsInParallel(self, ClassInstanceCounter(), &counters);
+    }
+    FinishHeapWalk(self);
+    for (const auto& counter : counters) {
+      counter.AddTo(&instance_counts);
+    }
+  }
 
-  InstanceCounter counter(classes, use_is_assignable_from, counts);
-  ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-  GetLiveBitmap()->Visit(counter);
+  for (const auto& entry : instance_counts) {
+    for (size_t i = 0; i < classes.size(); ++i) {
+      if (use_is_assignable_from) {
+        if (entry.first != NULL && classes[i]->IsAssignableFrom(entry.first)) {
+          counts[i] += entry.second;
+        }
+      } else if (entry.first == classes[i]) {
+        counts[i] += entry.second;
+      }
+    }
+  }
 }
 
 class InstanceCollector {
  public:
-  InstanceCollector(mirror::Class* c, int32_t max_count, std::vector<mirror::Object*>& instances)
+  InstanceCollector(mirror::Class* c, int32_t max_count)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
-      : class_(c), max_count_(max_count), instances_(instances) {
+      : class_(c), max_count_(max_count) {
   }
 
-  void operator()(const mirror::Object* o) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  void operator()(const mirror::Object* o) const NO_THREAD_SAFETY_ANALYSIS {
     const mirror::Class* instance_class = o->GetClass();
     if (instance_class == class_) {
       if (max_count_ == 0 || instances_.size() < max_count_) {
@@ -1059,14 +1419,30 @@ class InstanceCollector {
     }
   }
 
+  const std::vector<mirror::Object*>& GetInstances() const {
+    return instances_;
+  }
+
  private:
   mirror::Class* class_;
   uint32_t max_count_;
-  std::vector<mirror::Object*>& instances_;
-
-  DISALLOW_COPY_AND_ASSIGN(InstanceCollector);
+  mutable std::vector<mirror::Object*> instances_;
 };
 
+// Appends the objects each visitor found, in address order, up to max_count of them if it isn't 0.
+template <typename Visitor>
+static void MergeFoundObjects(const std::vector<Visitor>& visitors, int32_t max_count,
+                              std::vector<mirror::Object*>* objects) {
+  for (const auto& visitor : visitors) {
+    for (mirror::Object* object : visitor.GetInstances()) {
+      if (max_count != 0 && objects->size() >= static_cast<uint32_t>(max_count)) {
+        return;
+      }
+      objects->push_back(object);
+    }
+  }
+}
+
 void Heap::GetInstances(mirror::Class* c, int32_t max_count,
                         std::vector<mirror::Object*>& instances) {
   // We only want reachable instances, so do a GC. This also ensures that the alloc stack
@@ -1076,17 +1452,21 @@ void Heap::GetInstances(mirror::Class* c, int32_t max_count,
   CollectGarbage(false);
   self->TransitionFromSuspendedToRunnable();
 
-  InstanceCollector collector(c, max_count, instances);
-  ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-  GetLiveBitmap()->Visit(collector);
+  StartHeapWalk(self);
+  std::vector<InstanceCollector> collectors;
+  {
+    ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    VisitLiveObjectsInParallel(self, InstanceCollector(c, max_count), &collectors);
+  }
+  FinishHeapWalk(self);
+  MergeFoundObjects(collectors, max_count, &instances);
 }
 
 class ReferringObjectsFinder {
  public:
-  ReferringObjectsFinder(mirror::Object* object, int32_t max_count,
-                         std::vector<mirror::Object*>& referring_objects)
+  ReferringObjectsFinder(mirror::Object* object, int32_t max_count)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
-      : object_(object), max_count_(max_count), referring_objects_(referring_objects) {
+      : object_(object), max_count_(max_count) {
   }
 
   // For bitmap Visit.
@@ -1104,12 +1484,14 @@ class ReferringObjectsFinder {
     }
   }
 
+  const std::vector<mirror::Object*>& GetInstances() const {
+    return referring_objects_;
+  }
+
  private:
   mirror::Object* object_;
   uint32_t max_count_;
-  std::vector<mirror::Object*>& referring_objects_;
-
-  DISALLOW_COPY_AND_ASSIGN(ReferringObjectsFinder);
+  mutable std::vector<mirror::Object*> referring_objects_;
 };
 
 void Heap::GetReferringObjects(mirror::Object* o, int32_t max_count,
@@ -1121,9 +1503,52 @@ void Heap::GetReferringObjects(mirror::Object* o, int32_t max_count,
   CollectGarbage(false);
   self->TransitionFromSuspendedToRunnable();
 
-  ReferringObjectsFinder finder(o, max_count, referring_objects);
-  ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-  GetLiveBitmap()->Visit(finder);
+  StartHeapWalk(self);
+  std::vector<ReferringObjectsFinder> finders;
+  {
+    ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    VisitLiveObjectsInParallel(self, ReferringObjectsFinder(o, max_count), &finders);
+  }
+  FinishHeapWalk(self);
+  MergeFoundObjects(finders, max_count, &referring_objects);
+}
+
+size_t Heap::DeduplicateStrings(Thread* self) {
+  if (!deduplicate_strings_) {
+    return 0;
+  }
+  // Run as a collection would, with no collection under way and every other thread suspended, so
+  // that no string is half built and no bitmap changes during the walk.
+  ScopedThreadStateChange tsc(self, kWaitingPerformingGc);
+  while (true) {
+    {
+      MutexLock mu(self, *gc_complete_lock_);
+      if (!is_gc_running_) {
+        is_gc_running_ = true;
+        break;
+      }
+    }
+    WaitForConcurrentGcToComplete(self);
+  }
+  uint64_t start_ns = NanoTime();
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll();
+  // Strings are only changed in the alloc space, the pages of the image and zygote spaces stay
+  // clean. Their arrays are seen first and shared, since the live bitmap visits spaces in order.
+  StringDeduplicator deduplicator(alloc_space_);
+  {
+    ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    GetLiveBitmap()->Visit(deduplicator);
+  }
+  thread_list->ResumeAll();
+  {
+    MutexLock mu(self, *gc_complete_lock_);
+    is_gc_running_ = false;
+    gc_complete_cond_->Broadcast(self);
+  }
+  VLOG(heap) << "Deduplicated " << deduplicator.GetNumDeduplicated() << " strings in "
+             << PrettyDuration(NanoTime() - start_ns);
+  return deduplicator.GetNumDeduplicated();
 }
 
 void Heap::CollectGarbage(bool clear_soft_references) {
@@ -1134,11 +1559,37 @@ void Heap::CollectGarbage(bool clear_soft_references) {
   CollectGarbageInternal(collector::kGcTypeFull, kGcCauseExplicit, clear_soft_references);
 }
 
+struct ZygotePages {
+  size_t live_bytes;
+  size_t num_pages;
+  // The last page counted, chunks being walked in address order.
+  uintptr_t last_page;
+};
+
+static void CountZygotePages(void* start, void* end, size_t num_bytes, void* arg) {
+  ZygotePages* pages = reinterpret_cast<ZygotePages*>(arg);
+  if (start == NULL || num_bytes == 0) {
+    return;  // The end of the space or a free chunk.
+  }
+  pages->live_bytes += num_bytes;
+  uintptr_t first_page = RoundDown(reinterpret_cast<uintptr_t>(start), kPageSize);
+  uintptr_t last_page = RoundDown(reinterpret_cast<uintptr_t>(end) - 1, kPageSize);
+  pages->num_pages += (last_page - first_page) / kPageSize + 1;
+  if (first_page == pages->last_page) {
+    --pages->num_pages;
+  }
+  pages->last_page = last_page;
+}
+
 void Heap::PreZygoteFork() {
   static Mutex zygote_creation_lock_("zygote creation lock", kZygoteCreationLock);
+  Thread* self = Thread::Current();
+  if (!have_zygote_space_) {
+    // The children share the zygote's arrays, the collection below frees the duplicates.
+    DeduplicateStrings(self);
+  }
   // Do this before acquiring the zygote creation lock so that we don't get lock order violations.
   CollectGarbage(false);
-  Thread* self = Thread::Current();
   MutexLock mu(self, zygote_creation_lock_);
 
   // Try to see if we have any Zygote spaces.
@@ -1148,12 +1599,27 @@ void Heap::PreZygoteFork() {
 
   VLOG(heap) << "Starting PreZygoteFork with alloc space size " << PrettySize(alloc_space_->Size());
 
+  // Chunks cached in allocation buffers belong to the space which is about to become the zygote
+  // space, hand them back so we don't keep allocating into it.
+  RevokeAllThreadLocalBuffers();
+
   {
     // Flush the alloc stack.
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
     FlushAllocStack();
   }
 
+  // Objects can't move, their identity hash codes are their addresses, so the zygote's objects
+  // stay where they were allocated. Report how many more pages they span than they would packed,
+  // which the children may dirty.
+  if (VLOG_IS_ON(heap)) {
+    ZygotePages pages = { 0, 0, 0 };
+    alloc_space_->Walk(CountZygotePages, &pages);
+    VLOG(heap) << "Zygote objects: " << PrettySize(pages.live_bytes) << " on "
+               << pages.num_pages << " pages, "
+               << RoundUp(pages.live_bytes, kPageSize) / kPageSize << " if packed";
+  }
+
   // Turns the current alloc space into a Zygote space and obtain the new alloc space composed
   // of the remaining available heap memory.
   space::DlMallocSpace* zygote_space = alloc_space_;
@@ -1171,10 +1637,44 @@ void Heap::PreZygoteFork() {
   }
 }
 
+void Heap::RevokeThreadLocalBuffers(Thread* thread) {
+  space::DlMallocSpace* space = thread->GetTlabSpace();
+  if (space != NULL) {
+    total_tlab_wasted_bytes_.fetch_add(space->RevokeThreadLocalBuffers(thread));
+  }
+}
+
+void Heap::RevokeAllThreadLocalBuffers() {
+  // Other threads bump allocate from their buffers without any lock, suspend them while we take
+  // the buffers away.
+  Thread* self = Thread::Current();
+  ScopedThreadStateChange tsc(self, kWaitingPerformingGc);
+  ThreadList* thread_list = Runtime::Current()->GetThreadList();
+  thread_list->SuspendAll();
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    for (Thread* thread : thread_list->GetList()) {
+      RevokeThreadLocalBuffers(thread);
+    }
+  }
+  thread_list->ResumeAll();
+}
+
+void Heap::RevokeAllThreadLocalAllocationStacks(Thread* self) {
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  for (Thread* thread : Runtime::Current()->GetThreadList()->GetList()) {
+    thread->RevokeThreadLocalAllocationStack();
+  }
+}
+
 void Heap::FlushAllocStack() {
+  RevokeAllThreadLocalAllocationStacks(Thread::Current());
   MarkAllocStack(alloc_space_->GetLiveBitmap(), large_object_space_->GetLiveObjects(),
                  allocation_stack_.get());
   allocation_stack_->Reset();
+  MarkAllocStack(alloc_space_->GetLiveBitmap(), large_object_space_->GetLiveObjects(),
+                 tenured_allocation_stack_.get());
+  tenured_allocation_stack_->Reset();
 }
 
 void Heap::MarkAllocStack(accounting::SpaceBitmap* bitmap, accounting::SpaceSetMap* large_objects,
@@ -1182,7 +1682,10 @@ void Heap::MarkAllocStack(accounting::SpaceBitmap* bitmap, accounting::SpaceSetM
   mirror::Object** limit = stack->End();
   for (mirror::Object** it = stack->Begin(); it != limit; ++it) {
     const mirror::Object* obj = *it;
-    DCHECK(obj != NULL);
+    // Slots of the threads' segments that weren't used are NULL.
+    if (UNLIKELY(obj == NULL)) {
+      continue;
+    }
     if (LIKELY(bitmap->HasAddress(obj))) {
       bitmap->Set(obj);
     } else {
@@ -1239,10 +1742,16 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
   if (UNLIKELY(gc_start_time_ns == last_gc_time_ns_)) {
     LOG(WARNING) << "Timers are broken (gc_start_time == last_gc_time_).";
   }
+  bytes_allocated_since_last_gc_ =
+      gc_start_size > last_gc_size_ ? gc_start_size - last_gc_size_ : 0;
   uint64_t ms_delta = NsToMs(gc_start_time_ns - last_gc_time_ns_);
   if (ms_delta != 0) {
     allocation_rate_ = ((gc_start_size - last_gc_size_) * 1000) / ms_delta;
     VLOG(heap) << "Allocation rate: " << PrettySize(allocation_rate_) << "/s";
+    const size_t native_start_size = native_bytes_allocated_;
+    native_allocation_rate_ = native_start_size > native_bytes_after_last_gc_
+        ? ((native_start_size - native_bytes_after_last_gc_) * 1000) / ms_delta : 0;
+    VLOG(heap) << "Native allocation rate: " << PrettySize(native_allocation_rate_) << "/s";
   }
 
   if (gc_type == collector::kGcTypeSticky &&
@@ -1268,9 +1777,29 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type, GcCaus
       << " and type=" << gc_type;
 
   collector->clear_soft_references_ = clear_soft_references;
+  last_gc_cause_ = gc_cause;
   collector->Run();
+  if (track_instance_counts_ && gc_type != collector::kGcTypeSticky) {
+    // Sticky collections leave the older garbage in the live bitmap.
+    UpdateInstanceCounts(self);
+  }
   total_objects_freed_ever_ += collector->GetFreedObjects();
   total_bytes_freed_ever_ += collector->GetFreedBytes();
+  Metrics* metrics = Runtime::Current()->GetMetrics();
+  if (metrics != NULL) {
+    metrics->Add(Metrics::kGcCount, 1);
+    metrics->Add(Metrics::kGcTimeNs, collector->GetDurationNs());
+    const std::vector<uint64_t>& pauses = collector->GetPauseTimes();
+    for (size_t i = 0; i < pauses.size(); ++i) {
+      metrics->Add(Metrics::kGcPauseTimeNs, pauses[i]);
+      metrics->RecordValue(Metrics::kGcPauseHistogram, pauses[i]);
+    }
+    metrics->Add(Metrics::kHeapBytesFreed, collector->GetFreedBytes());
+    metrics->Add(Metrics::kHeapObjectsFreed, collector->GetFreedObjects());
+    metrics->Set(Metrics::kHeapBytesAllocated, GetBytesAllocated());
+    metrics->Add(Metrics::kClassesUnloaded, collector->GetUnloadedClasses());
+    metrics->Add(Metrics::kClassBytesUnloaded, collector->GetUnloadedClassBytes());
+  }
   if (care_about_pause_times_) {
     const size_t duration = collector->GetDurationNs();
     std::vector<uint64_t> pauses = collector->GetPauseTimes();
@@ -1502,6 +2031,51 @@ class VerifyObjectVisitor {
   mutable bool failed_;
 };
 
+// Passes a sample of the objects on to a verification visitor, picked by hashing their address
+// with a seed.
+template <typename Visitor>
+class SampledObjectVisitor {
+ public:
+  SampledObjectVisitor(const Visitor& visitor, size_t sample_percent, uint32_t seed)
+      : visitor_(visitor), sample_percent_(sample_percent), seed_(seed) {}
+
+  void operator()(const mirror::Object* obj) const NO_THREAD_SAFETY_ANALYSIS {
+    if (sample_percent_ >= 100 || IsSampled(obj)) {
+      visitor_(obj);
+    }
+  }
+
+  bool Failed() const {
+    return visitor_.Failed();
+  }
+
+ private:
+  bool IsSampled(const mirror::Object* obj) const {
+    uint32_t hash = (static_cast<uint32_t>(reinterpret_cast<uintptr_t>(obj)) / kObjectAlignment) ^
+        seed_;
+    hash *= 0x9E3779B1U;
+    return (hash >> 16) % 100 < sample_percent_;
+  }
+
+  Visitor visitor_;
+  size_t sample_percent_;
+  uint32_t seed_;
+};
+
+template <typename Visitor>
+bool Heap::VerifyLiveObjects() {
+  SampledObjectVisitor<Visitor> prototype(Visitor(this), verify_sample_percent_,
+                                          verify_sample_seed_++);
+  std::vector<SampledObjectVisitor<Visitor> > visitors;
+  VisitLiveObjectsInParallel(Thread::Current(), prototype, &visitors);
+  for (const auto& visitor : visitors) {
+    if (visitor.Failed()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Must do this with mutators suspended since we are directly accessing the allocation stacks.
 bool Heap::VerifyHeapReferences() {
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
@@ -1511,16 +2085,22 @@ bool Heap::VerifyHeapReferences() {
   // Perform the verification.
   VerifyObjectVisitor visitor(this);
   Runtime::Current()->VisitRoots(VerifyReferenceVisitor::VerifyRoots, &visitor, false, false);
-  GetLiveBitmap()->Visit(visitor);
+  bool live_objects_verified = VerifyLiveObjects<VerifyObjectVisitor>();
   // Verify objects in the allocation stack since these will be objects which were:
   // 1. Allocated prior to the GC (pre GC verification).
   // 2. Allocated during the GC (pre sweep GC verification).
   for (mirror::Object** it = allocation_stack_->Begin(); it != allocation_stack_->End(); ++it) {
+    if (*it != NULL) {
+      visitor(*it);
+    }
+  }
+  for (mirror::Object** it = tenured_allocation_stack_->Begin();
+       it != tenured_allocation_stack_->End(); ++it) {
     visitor(*it);
   }
   // We don't want to verify the objects in the live stack since they themselves may be
   // pointing to dead objects if they are not reachable.
-  if (visitor.Failed()) {
+  if (visitor.Failed() || !live_objects_verified) {
     // Dump mod-union tables.
     image_mod_union_table_->Dump(LOG(ERROR) << "Image mod-union table: ");
     zygote_mod_union_table_->Dump(LOG(ERROR) << "Zygote mod-union table: ");
@@ -1628,14 +2208,16 @@ bool Heap::VerifyMissingCardMarks() {
   // We need to sort the live stack since we binary search it.
   live_stack_->Sort();
   VerifyLiveStackReferences visitor(this);
-  GetLiveBitmap()->Visit(visitor);
+  bool live_objects_verified = VerifyLiveObjects<VerifyLiveStackReferences>();
 
   // We can verify objects in the live stack since none of these should reference dead objects.
   for (mirror::Object** it = live_stack_->Begin(); it != live_stack_->End(); ++it) {
-    visitor(*it);
+    if (*it != NULL) {
+      visitor(*it);
+    }
   }
 
-  if (visitor.Failed()) {
+  if (visitor.Failed() || !live_objects_verified) {
     DumpSpaces();
     return false;
   }
@@ -1644,6 +2226,7 @@ bool Heap::VerifyMissingCardMarks() {
 
 void Heap::SwapStacks() {
   allocation_stack_.swap(live_stack_);
+  tenured_allocation_stack_.swap(tenured_live_stack_);
 }
 
 void Heap::ProcessCards(base::TimingLogger& timings) {
@@ -1769,6 +2352,72 @@ void Heap::DumpForSigQuit(std::ostream& os) {
   os << "Heap: " << GetPercentFree() << "% free, " << PrettySize(GetBytesAllocated()) << "/"
      << PrettySize(GetTotalMemory()) << "; " << GetObjectsAllocated() << " objects\n";
   DumpGcPerformanceInfo(os);
+  DumpPageSharing(os);
+}
+
+// The resident pages of a mapping of /proc/self/smaps, in kB.
+struct SmapsEntry {
+  uintptr_t begin;
+  size_t shared_clean;
+  size_t shared_dirty;
+  size_t private_clean;
+  size_t private_dirty;
+};
+
+static bool ReadSmaps(std::vector<SmapsEntry>* entries) {
+  std::string smaps;
+  if (!ReadFileToString("/proc/self/smaps", &smaps)) {
+    return false;
+  }
+  std::istringstream is(smaps);
+  std::string line;
+  while (std::getline(is, line)) {
+    unsigned long begin;  // NOLINT(runtime/int) sscanf's type.
+    unsigned long end;  // NOLINT(runtime/int)
+    unsigned long kb;  // NOLINT(runtime/int)
+    char field[32];
+    if (sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2) {
+      SmapsEntry entry = { begin, 0, 0, 0, 0 };
+      entries->push_back(entry);
+    } else if (!entries->empty() && sscanf(line.c_str(), "%31[^:]: %lu kB", field, &kb) == 2) {
+      SmapsEntry& entry = entries->back();
+      if (strcmp(field, "Shared_Clean") == 0) {
+        entry.shared_clean = kb;
+      } else if (strcmp(field, "Shared_Dirty") == 0) {
+        entry.shared_dirty = kb;
+      } else if (strcmp(field, "Private_Clean") == 0) {
+        entry.private_clean = kb;
+      } else if (strcmp(field, "Private_Dirty") == 0) {
+        entry.private_dirty = kb;
+      }
+    }
+  }
+  return true;
+}
+
+void Heap::DumpPageSharing(std::ostream& os) {
+  std::vector<SmapsEntry> entries;
+  if (!ReadSmaps(&entries)) {
+    return;
+  }
+  for (const auto& space : continuous_spaces_) {
+    // The mappings of a space start in its range, past its end are only reserved pages.
+    uintptr_t begin = reinterpret_cast<uintptr_t>(space->Begin());
+    uintptr_t end = RoundUp(reinterpret_cast<uintptr_t>(space->End()), kPageSize);
+    SmapsEntry sum = { begin, 0, 0, 0, 0 };
+    for (const SmapsEntry& entry : entries) {
+      if (entry.begin >= begin && entry.begin < end) {
+        sum.shared_clean += entry.shared_clean;
+        sum.shared_dirty += entry.shared_dirty;
+        sum.private_clean += entry.private_clean;
+        sum.private_dirty += entry.private_dirty;
+      }
+    }
+    os << space->GetName() << ": " << PrettySize((sum.shared_clean + sum.shared_dirty) * KB)
+       << " shared (" << PrettySize(sum.shared_dirty * KB) << " dirty), "
+       << PrettySize((sum.private_clean + sum.private_dirty) * KB) << " private ("
+       << PrettySize(sum.private_dirty * KB) << " dirty)\n";
+  }
 }
 
 size_t Heap::GetPercentFree() {
@@ -1795,37 +2444,89 @@ void Heap::UpdateMaxNativeFootprint() {
   }
   native_footprint_gc_watermark_ = target_size;
   native_footprint_limit_ = 2 * target_size - native_size;
-}
-
-void Heap::GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration) {
+  // Start the concurrent GC early enough that it completes before the native allocations made
+  // while it runs hit the limit, just as concurrent_start_bytes_ is paced for the java heap.
+  // Whichever of the two runs out first requests the next GC.
+  uint64_t remaining_bytes = native_allocation_rate_ * NsToMs(last_gc_duration_ns_) / 1000;
+  remaining_bytes = std::min<uint64_t>(remaining_bytes, native_footprint_limit_ - native_size);
+  native_concurrent_start_bytes_ = std::min(native_footprint_gc_watermark_,
+                                            native_footprint_limit_ -
+                                                static_cast<size_t>(remaining_bytes));
+}
+
+void Heap::UpdateErgonomics(uint64_t max_pause, double gc_time_ratio) {
+  // The pause goal comes first. Pauses are mostly spent on the objects allocated and cards dirtied
+  // since the previous GC, so a smaller heap collected more often pauses for less time.
+  double utilization = ergonomic_utilization_;
+  if (pause_goal_ != 0 && max_pause > pause_goal_) {
+    utilization += kErgonomicUtilizationStep;
+  } else if (throughput_goal_ != 0 && gc_time_ratio > 1.0 - throughput_goal_) {
+    utilization -= kErgonomicUtilizationStep;
+  } else if (throughput_goal_ != 0 && gc_time_ratio < (1.0 - throughput_goal_) / 2) {
+    // Comfortably within the goals, give memory back.
+    utilization += kErgonomicUtilizationStep;
+  }
+  ergonomic_utilization_ = std::min(std::max(utilization, kMinErgonomicUtilization),
+                                    kMaxErgonomicUtilization);
+  // A mutator had to wait for this GC, so the concurrent GC started too late or not at all. Start
+  // it earlier from now on, and go back toward the estimate while concurrent GCs keep up.
+  if (last_gc_cause_ == kGcCauseForAlloc) {
+    concurrent_start_scale_ = std::min(concurrent_start_scale_ * 2, kMaxConcurrentStartScale);
+  } else if (last_gc_cause_ == kGcCauseBackground) {
+    concurrent_start_scale_ = std::max(concurrent_start_scale_ * 0.9, 1.0);
+  }
+  VLOG(heap) << "GC ergonomics: max pause " << PrettyDuration(max_pause) << ", "
+             << static_cast<int>(gc_time_ratio * 100) << "% of time in GC, utilization "
+             << ergonomic_utilization_ << ", concurrent start scale " << concurrent_start_scale_;
+}
+
+void Heap::GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration, uint64_t max_pause,
+                              size_t freed_bytes) {
   // We know what our utilization is at this moment.
   // This doesn't actually resize any memory. It just lets the heap grow more when necessary.
   const size_t bytes_allocated = GetBytesAllocated();
   last_gc_size_ = bytes_allocated;
-  last_gc_time_ns_ = NanoTime();
+  const uint64_t now = NanoTime();
+  const uint64_t cycle_duration = now - last_gc_time_ns_;
+  last_gc_time_ns_ = now;
+
+  double utilization = GetTargetHeapUtilization();
+  size_t max_free = max_free_;
+  if (IsErgonomic()) {
+    UpdateErgonomics(max_pause, cycle_duration == 0 ? 1.0
+                     : std::min(static_cast<double>(gc_duration) / cycle_duration, 1.0));
+    // Let the heap grow past max_free_ in proportion when the ergonomics want it bigger.
+    max_free = std::max(static_cast<size_t>(max_free_ * utilization / ergonomic_utilization_),
+                        min_free_);
+    utilization = ergonomic_utilization_;
+  }
 
   size_t target_size;
   if (gc_type != collector::kGcTypeSticky) {
     // Grow the heap for non sticky GC.
-    target_size = bytes_allocated / GetTargetHeapUtilization();
-    if (target_size > bytes_allocated + max_free_) {
-      target_size = bytes_allocated + max_free_;
+    target_size = bytes_allocated / utilization;
+    if (target_size > bytes_allocated + max_free) {
+      target_size = bytes_allocated + max_free;
     } else if (target_size < bytes_allocated + min_free_) {
       target_size = bytes_allocated + min_free_;
     }
     next_gc_type_ = collector::kGcTypeSticky;
   } else {
-    // Based on how close the current heap size is to the target size, decide
-    // whether or not to do a partial or sticky GC next.
-    if (bytes_allocated + min_free_ <= max_allowed_footprint_) {
+    // Based on how close the current heap size is to the target size and on how much of the
+    // young objects this GC freed, decide whether or not to do a partial or sticky GC next.
+    total_sticky_gc_young_bytes_ += bytes_allocated_since_last_gc_;
+    total_sticky_gc_freed_bytes_ += freed_bytes;
+    const bool young_objects_died =
+        freed_bytes >= bytes_allocated_since_last_gc_ * kMinStickyGcFreedRatio;
+    if (bytes_allocated + min_free_ <= max_allowed_footprint_ && young_objects_died) {
       next_gc_type_ = collector::kGcTypeSticky;
     } else {
       next_gc_type_ = collector::kGcTypePartial;
     }
 
     // If we have freed enough memory, shrink the heap back down.
-    if (bytes_allocated + max_free_ < max_allowed_footprint_) {
-      target_size = bytes_allocated + max_free_;
+    if (bytes_allocated + max_free < max_allowed_footprint_) {
+      target_size = bytes_allocated + max_free;
     } else {
       target_size = std::max(bytes_allocated, max_allowed_footprint_);
     }
@@ -1840,7 +2541,7 @@ void Heap::GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration) {
       // Calculate the estimated GC duration.
       double gc_duration_seconds = NsToMs(gc_duration) / 1000.0;
       // Estimate how many remaining bytes we will have when we need to start the next GC.
-      size_t remaining_bytes = allocation_rate_ * gc_duration_seconds;
+      size_t remaining_bytes = allocation_rate_ * gc_duration_seconds * concurrent_start_scale_;
       remaining_bytes = std::max(remaining_bytes, kMinConcurrentRemainingBytes);
       if (UNLIKELY(remaining_bytes > max_allowed_footprint_)) {
         // A never going to happen situation that from the estimated allocation rate we will exceed
@@ -1858,6 +2559,8 @@ void Heap::GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration) {
     }
   }
 
+  last_gc_duration_ns_ = gc_duration;
+  native_bytes_after_last_gc_ = native_bytes_allocated_;
   UpdateMaxNativeFootprint();
 }
 
@@ -1883,6 +2586,20 @@ void Heap::SetReferenceOffsets(MemberOffset reference_referent_offset,
   CHECK_NE(finalizer_reference_zombie_offset_.Uint32Value(), 0U);
 }
 
+void Heap::SetFinalizerReferenceMembers(mirror::Class* finalizer_reference_class,
+                                        mirror::ArtField* list_lock, mirror::ArtField* head,
+                                        mirror::ArtField* queue, MemberOffset prev_offset,
+                                        MemberOffset next_offset) {
+  finalizer_reference_class_ = finalizer_reference_class;
+  finalizer_reference_list_lock_ = list_lock;
+  finalizer_reference_head_ = head;
+  finalizer_reference_queue_ = queue;
+  finalizer_reference_prev_offset_ = prev_offset;
+  finalizer_reference_next_offset_ = next_offset;
+  CHECK_NE(finalizer_reference_prev_offset_.Uint32Value(), 0U);
+  CHECK_NE(finalizer_reference_next_offset_.Uint32Value(), 0U);
+}
+
 mirror::Object* Heap::GetReferenceReferent(mirror::Object* reference) {
   DCHECK(reference != NULL);
   DCHECK_NE(reference_referent_offset_.Uint32Value(), 0U);
@@ -1957,11 +2674,75 @@ mirror::Object* Heap::DequeuePendingReference(mirror::Object** list) {
 
 void Heap::AddFinalizerReference(Thread* self, mirror::Object* object) {
   ScopedObjectAccess soa(self);
-  JValue result;
-  ArgArray arg_array(NULL, 0);
-  arg_array.Append(reinterpret_cast<uint32_t>(object));
-  soa.DecodeMethod(WellKnownClasses::java_lang_ref_FinalizerReference_add)->Invoke(self,
-      arg_array.GetArray(), arg_array.GetNumBytes(), &result, 'V');
+  SirtRef<mirror::Object> referent(self, object);
+  mirror::Class* klass = finalizer_reference_class_;
+  DCHECK(klass != NULL);
+  // FinalizerReference's static initializer creates the list lock and the queue.
+  if (UNLIKELY(!klass->IsInitialized()) &&
+      !Runtime::Current()->GetClassLinker()->EnsureInitialized(klass, true, true)) {
+    DCHECK(self->IsExceptionPending());
+    return;
+  }
+  // The equivalent of new FinalizerReference<Object>(referent, queue).
+  SirtRef<mirror::Object> ref(self, klass->AllocObject(self));
+  if (ref.get() == NULL) {
+    DCHECK(self->IsExceptionPending());
+    return;
+  }
+  ref->SetFieldObject(reference_referent_offset_, referent.get(), true);
+  ref->SetFieldObject(reference_queue_offset_, finalizer_reference_queue_->GetObj(klass), true);
+  // Push it on the list under LIST_LOCK, which FinalizerReference.remove also synchronizes on.
+  ObjectLock lock(self, finalizer_reference_list_lock_->GetObj(klass));
+  mirror::Object* head = finalizer_reference_head_->GetObj(klass);
+  ref->SetFieldObject(finalizer_reference_next_offset_, head, false);
+  if (head != NULL) {
+    head->SetFieldObject(finalizer_reference_prev_offset_, ref.get(), false);
+  }
+  finalizer_reference_head_->SetObj(klass, ref.get());
+}
+
+void Heap::RecordEnqueuedFinalizers(size_t count) {
+  // Bounds the batches kept when nothing dumps the backlog. Merging the oldest two batches keeps
+  // the oldest time, so the lag reported afterwards can only be overestimated.
+  static const size_t kMaxFinalizerBatches = 256;
+  if (count == 0) {
+    return;
+  }
+  MutexLock mu(Thread::Current(), *finalizer_ref_queue_lock_);
+  total_finalizers_enqueued_ += count;
+  if (finalizer_batches_.size() == kMaxFinalizerBatches) {
+    uint64_t oldest_time = finalizer_batches_.front().first;
+    finalizer_batches_.pop_front();
+    finalizer_batches_.front().first = oldest_time;
+  }
+  finalizer_batches_.push_back(std::make_pair(NanoTime(), total_finalizers_enqueued_));
+}
+
+void Heap::DumpFinalizerBacklog(std::ostream& os) {
+  mirror::Class* klass = finalizer_reference_class_;
+  // References whose zombie is set were found unreachable and wait for the finalizer daemon,
+  // which unlinks them just before it runs their finalizer.
+  size_t live = 0;
+  size_t pending = 0;
+  for (mirror::Object* ref = finalizer_reference_head_->GetObj(klass); ref != NULL;
+       ref = ref->GetFieldObject<mirror::Object*>(finalizer_reference_next_offset_, false)) {
+    ++live;
+    if (ref->GetFieldObject<mirror::Object*>(finalizer_reference_zombie_offset_, false) != NULL) {
+      ++pending;
+    }
+  }
+  MutexLock mu(Thread::Current(), *finalizer_ref_queue_lock_);
+  os << "Finalizable objects: " << live - pending << ", pending finalization: " << pending
+     << ", enqueued for finalization ever: " << total_finalizers_enqueued_ << "\n";
+  const uint64_t finalized = total_finalizers_enqueued_ - std::min<uint64_t>(pending,
+      total_finalizers_enqueued_);
+  while (!finalizer_batches_.empty() && finalizer_batches_.front().second <= finalized) {
+    finalizer_batches_.pop_front();
+  }
+  if (pending != 0 && !finalizer_batches_.empty()) {
+    os << "Finalizer lag: oldest pending finalizer enqueued "
+       << PrettyDuration(NanoTime() - finalizer_batches_.front().first) << " ago\n";
+  }
 }
 
 void Heap::EnqueueClearedReferences(mirror::Object** cleared) {
@@ -2037,15 +2818,6 @@ void Heap::RequestHeapTrim() {
   // to utilization (which is probably inversely proportional to how much benefit we can expect).
   // We could try mincore(2) but that's only a measure of how many pages we haven't given away,
   // not how much use we're making of those pages.
-  uint64_t ms_time = MilliTime();
-  float utilization =
-      static_cast<float>(alloc_space_->GetBytesAllocated()) / alloc_space_->Size();
-  if ((utilization > 0.75f && !IsLowMemoryMode()) || ((ms_time - last_trim_time_ms_) < 2 * 1000)) {
-    // Don't bother trimming the alloc space if it's more than 75% utilized and low memory mode is
-    // not enabled, or if a heap trim occurred in the last two seconds.
-    return;
-  }
-
   Thread* self = Thread::Current();
   {
     MutexLock mu(self, *Locks::runtime_shutdown_lock_);
@@ -2058,10 +2830,21 @@ void Heap::RequestHeapTrim() {
     }
   }
 
-  last_trim_time_ms_ = ms_time;
+  // Moving to a process state that doesn't care about pause times, such as going to the
+  // background, is when trimming pays off most, so it isn't held back by a recent trim.
+  const bool cared_about_pause_times = care_about_pause_times_;
   ListenForProcessStateChange();
+  const bool stopped_caring = cared_about_pause_times && !care_about_pause_times_;
+  uint64_t ms_time = MilliTime();
+  if (!stopped_caring && (ms_time - last_trim_time_ms_) < 2 * 1000) {
+    // Don't bother trimming the alloc space if a heap trim occurred in the last two seconds.
+    return;
+  }
+  last_trim_time_ms_ = ms_time;
 
-  // Trim only if we do not currently care about pause times.
+  // Trim only if we do not currently care about pause times. Objects never move, so handing the
+  // free pages between live objects back to the kernel is all we can do about a fragmented heap.
+  // Nobody notices the cost of doing so in the background, so trim regardless of utilization.
   if (!care_about_pause_times_) {
     JNIEnv* env = self->GetJniEnv();
     DCHECK(WellKnownClasses::java_lang_Daemons != NULL);
@@ -2074,7 +2857,12 @@ void Heap::RequestHeapTrim() {
 
 size_t Heap::Trim() {
   // Handle a requested heap trim on a thread outside of the main GC thread.
-  return alloc_space_->Trim();
+  const uint64_t start_time = NanoTime();
+  const size_t reclaimed = alloc_space_->Trim();
+  ++total_trims_;
+  total_trimmed_bytes_ += reclaimed;
+  total_trim_time_ns_ += NanoTime() - start_time;
+  return reclaimed;
 }
 
 bool Heap::IsGCRequestPending() const {
@@ -2085,10 +2873,11 @@ void Heap::RegisterNativeAllocation(int bytes) {
   // Total number of native bytes allocated.
   native_bytes_allocated_.fetch_add(bytes);
   Thread* self = Thread::Current();
-  if (static_cast<size_t>(native_bytes_allocated_) > native_footprint_gc_watermark_) {
+  if (static_cast<size_t>(native_bytes_allocated_) > native_concurrent_start_bytes_) {
     // The second watermark is higher than the gc watermark. If you hit this it means you are
     // allocating native objects faster than the GC can keep up with.
     if (static_cast<size_t>(native_bytes_allocated_) > native_footprint_limit_) {
+        const uint64_t wait_start = NanoTime();
         JNIEnv* env = self->GetJniEnv();
         // Can't do this in WellKnownClasses::Init since System is not properly set up at that
         // point.
@@ -2098,8 +2887,9 @@ void Heap::RegisterNativeAllocation(int bytes) {
               CacheMethod(env, WellKnownClasses::java_lang_System, true, "runFinalization", "()V");
           assert(WellKnownClasses::java_lang_System_runFinalization != NULL);
         }
-        if (WaitForConcurrentGcToComplete(self) != collector::kGcTypeNone) {
-          // Just finished a GC, attempt to run finalizers.
+        if (WaitForConcurrentGcToComplete(self) != collector::kGcTypeNone &&
+            static_cast<size_t>(native_bytes_allocated_) > native_footprint_limit_) {
+          // Just finished a GC and it wasn't enough, attempt to run finalizers.
           env->CallStaticVoidMethod(WellKnownClasses::java_lang_System,
                                     WellKnownClasses::java_lang_System_runFinalization);
           CHECK(!env->ExceptionCheck());
@@ -2115,6 +2905,8 @@ void Heap::RegisterNativeAllocation(int bytes) {
         // We have just run finalizers, update the native watermark since it is very likely that
         // finalizers released native managed allocations.
         UpdateMaxNativeFootprint();
+        MutexLock mu(self, *native_blocking_lock_);
+        native_blocking_histogram_.AddValue((NanoTime() - wait_start) / 1000);
     } else {
       if (!IsGCRequestPending()) {
         RequestConcurrentGC(self);
@@ -17,11 +17,14 @@
 #ifndef ART_RUNTIME_GC_HEAP_H_
 #define ART_RUNTIME_GC_HEAP_H_
 
+#include <deque>
 #include <iosfwd>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "atomic_integer.h"
+#include "base/histogram.h"
 #include "base/timing_logger.h"
 #include "gc/accounting/atomic_stack.h"
 #include "gc/accounting/card_table.h"
@@ -43,6 +46,7 @@ class Thread;
 class TimingLogger;
 
 namespace mirror {
+  class ArtField;
   class Class;
   class Object;
 }  // namespace mirror
@@ -59,6 +63,8 @@ namespace collector {
   class MarkSweep;
 }  // namespace collector
 
+class AllocationSiteTable;
+
 namespace space {
   class AllocSpace;
   class DiscontinuousSpace;
@@ -101,6 +107,9 @@ enum HeapVerificationMode {
 };
 static constexpr HeapVerificationMode kDesiredHeapVerification = kNoHeapVerification;
 
+// If true, collect every kGcAlotInterval allocations.
+static constexpr bool kGCALotMode = false;
+
 class Heap {
  public:
   static constexpr size_t kDefaultInitialSize = 2 * MB;
@@ -116,6 +125,9 @@ class Heap {
   // Used so that we don't overflow the allocation time atomic integer.
   static constexpr size_t kTimeAdjust = 1024;
 
+  // Number of slots of the allocation stack a thread reserves at a time.
+  static constexpr size_t kThreadLocalAllocationStackSize = 128;
+
   // Create a heap with the requested sizes. The possible empty
   // image_file_names names specify Spaces to load based on
   // ImageWriter output.
@@ -123,7 +135,11 @@ class Heap {
                 size_t max_free, double target_utilization, size_t capacity,
                 const std::string& original_image_file_name, bool concurrent_gc,
                 size_t parallel_gc_threads, size_t conc_gc_threads, bool low_memory_mode,
-                size_t long_pause_threshold, size_t long_gc_threshold, bool ignore_max_footprint);
+                size_t long_pause_threshold, size_t long_gc_threshold, bool ignore_max_footprint,
+                bool use_tlab, bool use_rosalloc, size_t pause_goal, double throughput_goal,
+                bool pretenure, bool deduplicate_strings, bool class_unloading, bool huge_pages,
+                bool verify_pre_gc_heap, bool verify_post_gc_heap, bool verify_missing_card_marks,
+                size_t verify_sample_percent, bool track_instance_counts);
 
   ~Heap();
 
@@ -131,6 +147,20 @@ class Heap {
   mirror::Object* AllocObject(Thread* self, mirror::Class* klass, size_t num_bytes)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Allocates a small object from the thread's TLAB, in gc/heap-inl.h for the allocation
+  // entrypoints. Returns NULL without collecting or throwing whenever the object needs
+  // AllocObject: TLABs off, too large, allocations tracked or verified, or a collection due.
+  mirror::Object* AllocObjectFromTlab(Thread* self, mirror::Class* klass, size_t num_bytes)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Allocates two objects placed one right after the other, for objects that are always used
+  // together. Returns the first and sets second, or returns NULL without collecting or throwing
+  // when they can't be allocated together, in which case the caller allocates them apart.
+  mirror::Object* AllocObjectPair(Thread* self, mirror::Class* first_class, size_t first_num_bytes,
+                                  mirror::Class* second_class, size_t second_num_bytes,
+                                  mirror::Object** second)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void RegisterNativeAllocation(int bytes)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void RegisterNativeFree(int bytes) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -151,6 +181,26 @@ class Heap {
   bool VerifyMissingCardMarks()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Visits the live objects with a Visitor per stripe of the heap, on the GC threads when there
+  // are any, and returns false if any of them failed. Only a sample of the objects is visited when
+  // verify_sample_percent_ is below 100.
+  template <typename Visitor>
+  bool VerifyLiveObjects()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::heap_bitmap_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Visits the live objects with a copy of prototype per stripe of the continuous spaces, on the
+  // GC threads when there are any, and one more for the large objects. The visitors are left in
+  // address order. The caller must keep a collection from using the GC threads meanwhile.
+  template <typename Visitor>
+  void VisitLiveObjectsInParallel(Thread* self, const Visitor& prototype,
+                                  std::vector<Visitor>* visitors)
+      SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
+  // Keep a collection from starting while the heap is walked outside of one.
+  void StartHeapWalk(Thread* self) LOCKS_EXCLUDED(gc_complete_lock_);
+  void FinishHeapWalk(Thread* self) LOCKS_EXCLUDED(gc_complete_lock_);
+  // Counts the instances of each class at the end of a collection, for CountInstances.
+  void UpdateInstanceCounts(Thread* self)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_, instance_counts_lock_);
 
   // A weaker test than IsLiveObject or VerifyObject that doesn't require the heap lock,
   // and doesn't abort on error, allowing the caller to report more
@@ -171,7 +221,8 @@ class Heap {
   void ConcurrentGC(Thread* self) LOCKS_EXCLUDED(Locks::runtime_shutdown_lock_);
 
   // Implements VMDebug.countInstancesOfClass and JDWP VM_InstanceCount.
-  // The boolean decides whether to use IsAssignableFrom or == when comparing classes.
+  // The boolean decides whether to use IsAssignableFrom or == when comparing classes. When the
+  // instance counts are tracked the counts of the last collection are used, without a walk.
   void CountInstances(const std::vector<mirror::Class*>& classes, bool use_is_assignable_from,
                       uint64_t* counts)
       LOCKS_EXCLUDED(Locks::heap_bitmap_lock_)
@@ -243,6 +294,13 @@ class Heap {
                            MemberOffset reference_pendingNext_offset,
                            MemberOffset finalizer_reference_zombie_offset);
 
+  // Members of java.lang.ref.FinalizerReference used to link finalizer references into its list
+  // without calling FinalizerReference.add.
+  void SetFinalizerReferenceMembers(mirror::Class* finalizer_reference_class,
+                                    mirror::ArtField* list_lock, mirror::ArtField* head,
+                                    mirror::ArtField* queue, MemberOffset prev_offset,
+                                    MemberOffset next_offset);
+
   mirror::Object* GetReferenceReferent(mirror::Object* reference);
   void ClearReferenceReferent(mirror::Object* reference) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -308,8 +366,14 @@ class Heap {
     return card_table_.get();
   }
 
+  // Creates the FinalizerReference for object and links it into FinalizerReference's list the
+  // way FinalizerReference.add does, without calling into Java.
   void AddFinalizerReference(Thread* self, mirror::Object* object);
 
+  // Called by the collectors after they enqueued count finalizer references for the finalizer
+  // daemon, to account for the finalizer backlog.
+  void RecordEnqueuedFinalizers(size_t count) LOCKS_EXCLUDED(finalizer_ref_queue_lock_);
+
   // Returns the number of bytes currently allocated.
   size_t GetBytesAllocated() const {
     return num_bytes_allocated_;
@@ -361,8 +425,29 @@ class Heap {
 
   void DumpForSigQuit(std::ostream& os);
 
+  // Dumps how much of each continuous space is in pages shared with other processes, such as the
+  // zygote and its children, and how much is private to this process.
+  void DumpPageSharing(std::ostream& os);
+
   size_t Trim();
 
+  // Points the live strings of the alloc space at the char array of another live string with the
+  // same contents, if there is one, and returns how many strings were changed. The arrays they
+  // leave are freed by a later collection if nothing else refers to them. Does nothing unless
+  // enabled with -XX:DeduplicateStrings.
+  size_t DeduplicateStrings(Thread* self)
+      LOCKS_EXCLUDED(gc_complete_lock_, Locks::mutator_lock_, Locks::heap_bitmap_lock_);
+
+  bool IsDeduplicatingStrings() const {
+    return deduplicate_strings_;
+  }
+
+  // Whether the non-sticky collections unload the classes of unreachable class loaders, enabled
+  // with -XX:ClassUnloading.
+  bool IsUnloadingClasses() const {
+    return class_unloading_;
+  }
+
   accounting::HeapBitmap* GetLiveBitmap() SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
     return live_bitmap_.get();
   }
@@ -375,6 +460,16 @@ class Heap {
     return live_stack_.get();
   }
 
+  // Tenured allocations made before the current GC started, see AllocationSiteTable.
+  accounting::ObjectStack* GetTenuredLiveStack() SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_) {
+    return tenured_live_stack_.get();
+  }
+
+  // Returns the survival statistics of allocation sites, NULL unless pretenuring is enabled.
+  AllocationSiteTable* GetAllocationSiteTable() const {
+    return allocation_site_table_.get();
+  }
+
   void PreZygoteFork() LOCKS_EXCLUDED(Locks::heap_bitmap_lock_);
 
   // Mark and empty stack.
@@ -432,6 +527,24 @@ class Heap {
     return care_about_pause_times_;
   }
 
+  // Returns true if small objects are allocated from thread-local allocation buffers.
+  bool IsUsingTlab() const {
+    return use_tlab_;
+  }
+
+  // Return the unused chunks of the thread's allocation buffer to the space they came from. The
+  // thread must either be the caller or suspended.
+  void RevokeThreadLocalBuffers(Thread* thread);
+
+  // Revoke the allocation buffers of every thread, suspending all the other threads meanwhile.
+  void RevokeAllThreadLocalBuffers()
+      LOCKS_EXCLUDED(Locks::mutator_lock_, Locks::thread_list_lock_);
+
+  // Drop the allocation stack segments of every thread, so that the allocation stack can be
+  // swapped or reset. Other threads must be suspended or not allocating.
+  void RevokeAllThreadLocalAllocationStacks(Thread* self)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_);
+
   // Thread pool.
   void CreateThreadPool();
   void DeleteThreadPool();
@@ -480,7 +593,9 @@ class Heap {
   void RequestConcurrentGC(Thread* self) LOCKS_EXCLUDED(Locks::runtime_shutdown_lock_);
   bool IsGCRequestPending() const;
 
-  void RecordAllocation(size_t size, mirror::Object* object)
+  // Pushes object on the tenured allocation stack and dirties its card if self is allocating
+  // tenured, pushes it on self's segment of the allocation stack otherwise.
+  void RecordAllocation(Thread* self, size_t size, mirror::Object* object)
       LOCKS_EXCLUDED(GlobalSynchronization::heap_bitmap_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -503,8 +618,18 @@ class Heap {
 
   // Given the current contents of the alloc space, increase the allowed heap footprint to match
   // the target utilization ratio.  This should only be called immediately after a full garbage
-  // collection.
-  void GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration);
+  // collection. freed_bytes is how much the collection freed, used to decide whether sticky GCs
+  // are still worth running.
+  void GrowForUtilization(collector::GcType gc_type, uint64_t gc_duration, uint64_t max_pause,
+                          size_t freed_bytes);
+
+  // Moves ergonomic_utilization_ and concurrent_start_scale_ toward the pause and throughput goals
+  // given the longest pause of the GC that just finished and the share of time it took.
+  void UpdateErgonomics(uint64_t max_pause, double gc_time_ratio);
+
+  bool IsErgonomic() const {
+    return pause_goal_ != 0 || throughput_goal_ != 0;
+  }
 
   size_t GetPercentFree();
 
@@ -519,6 +644,11 @@ class Heap {
   static void VerificationCallback(mirror::Object* obj, void* arg)
       SHARED_LOCKS_REQUIRED(GlobalSychronization::heap_bitmap_lock_);
 
+  // Prints how many finalizable objects are live and how far the finalizer daemon is behind.
+  // Walks FinalizerReference's list, so every other thread must be suspended.
+  void DumpFinalizerBacklog(std::ostream& os) EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(finalizer_ref_queue_lock_);
+
   // Swap the allocation stack with the live stack.
   void SwapStacks();
 
@@ -571,6 +701,38 @@ class Heap {
   // useful for benchmarking since it reduces time spent in GC to a low %.
   const bool ignore_max_footprint_;
 
+  // If true, small objects are allocated from per-thread buffers of pre-allocated chunks which
+  // avoids acquiring the alloc space lock on the allocation fast path.
+  const bool use_tlab_;
+
+  // If true, the alloc space is a RosAllocSpace which serves small objects from runs of slots.
+  const bool use_rosalloc_;
+
+  // Ergonomics goals, 0 when not set: the longest GC pause to aim for in ns, and the fraction of
+  // time to leave to the mutators rather than to GCs. With either set, GrowForUtilization adjusts
+  // the utilization it grows the heap for and when concurrent GCs start after every GC.
+  const size_t pause_goal_;
+  const double throughput_goal_;
+
+  // If true, strings of the alloc space share the char arrays of equal strings after the zygote
+  // forks, when the heap is trimmed and in the concurrent partial and full collections, see
+  // DeduplicateStrings and MarkSweep::DeduplicateStrings.
+  const bool deduplicate_strings_;
+
+  // If true, see IsUnloadingClasses.
+  const bool class_unloading_;
+
+  // Whether the live instances of each class are counted after every non-sticky collection, and
+  // the counts of the last one.
+  const bool track_instance_counts_;
+  Mutex* instance_counts_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  SafeMap<const mirror::Class*, uint64_t> instance_counts_ GUARDED_BY(instance_counts_lock_);
+  bool have_instance_counts_ GUARDED_BY(instance_counts_lock_);
+
+  // Bytes handed back to the alloc space from revoked thread-local allocation buffers, ie chunks
+  // that were pre-allocated but never used.
+  AtomicInteger total_tlab_wasted_bytes_;
+
   // If we have a zygote space.
   bool have_zygote_space_;
 
@@ -586,6 +748,9 @@ class Heap {
   Mutex* finalizer_ref_queue_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   Mutex* phantom_ref_queue_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
+  // Guards native_blocking_histogram_.
+  Mutex* native_blocking_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+
   // True while the garbage collector is running.
   volatile bool is_gc_running_ GUARDED_BY(gc_complete_lock_);
 
@@ -604,12 +769,18 @@ class Heap {
   // a GC should be triggered.
   size_t max_allowed_footprint_;
 
-  // The watermark at which a concurrent GC is requested by registerNativeAllocation.
+  // The watermark at which native allocations should be collected, the native counterpart of
+  // max_allowed_footprint_.
   size_t native_footprint_gc_watermark_;
 
   // The watermark at which a GC is performed inside of registerNativeAllocation.
   size_t native_footprint_limit_;
 
+  // The watermark at which a concurrent GC is requested by registerNativeAllocation. Paced like
+  // concurrent_start_bytes_, so that at the native allocation rate the GC finishes before
+  // native_footprint_limit_ is reached, and never above native_footprint_gc_watermark_.
+  size_t native_concurrent_start_bytes_;
+
   // Activity manager members.
   jclass activity_thread_class_;
   jclass application_thread_class_;
@@ -651,6 +822,10 @@ class Heap {
   const bool verify_pre_gc_heap_;
   const bool verify_post_gc_heap_;
   const bool verify_mod_union_table_;
+  // The percentage of objects whose references the heap verification checks, and the seed that
+  // picks a different sample for each verification.
+  const size_t verify_sample_percent_;
+  uint32_t verify_sample_seed_;
 
   // Parallel GC data structures.
   UniquePtr<ThreadPool> thread_pool_;
@@ -672,10 +847,27 @@ class Heap {
   // How many bytes were allocated at the end of the last GC.
   uint64_t last_gc_size_;
 
+  // How many bytes were allocated between the end of the last GC and the start of the current
+  // one, the young objects that a sticky GC collects.
+  uint64_t bytes_allocated_since_last_gc_;
+
+  // The young bytes seen by all sticky GCs and how many of them they freed.
+  uint64_t total_sticky_gc_young_bytes_;
+  uint64_t total_sticky_gc_freed_bytes_;
+
   // Estimated allocation rate (bytes / second). Computed between the time of the last GC cycle
   // and the start of the current one.
   uint64_t allocation_rate_;
 
+  // The same for native allocations, along with the native bytes allocated at the end of the last
+  // GC and how long that GC took.
+  uint64_t native_allocation_rate_;
+  size_t native_bytes_after_last_gc_;
+  uint64_t last_gc_duration_ns_;
+
+  // Time threads spent blocked in RegisterNativeAllocation, in microseconds.
+  Histogram<uint64_t> native_blocking_histogram_ GUARDED_BY(native_blocking_lock_);
+
   // For a GC cycle, a bitmap that is set corresponding to the
   UniquePtr<accounting::HeapBitmap> live_bitmap_ GUARDED_BY(Locks::heap_bitmap_lock_);
   UniquePtr<accounting::HeapBitmap> mark_bitmap_ GUARDED_BY(Locks::heap_bitmap_lock_);
@@ -692,6 +884,16 @@ class Heap {
   // Second allocation stack so that we can process allocation with the heap unlocked.
   UniquePtr<accounting::ObjectStack> live_stack_;
 
+  // Allocation and live stacks of the allocations of tenured allocation sites. GCs mark the
+  // tenured live stack as live before tracing, so sticky GCs treat its objects as old and never
+  // sweep them, while partial and full GCs collect them like any other object.
+  UniquePtr<accounting::ObjectStack> tenured_allocation_stack_;
+  UniquePtr<accounting::ObjectStack> tenured_live_stack_;
+
+  // Allocation site survival statistics deciding which sites are tenured, NULL unless pretenuring
+  // is enabled.
+  UniquePtr<AllocationSiteTable> allocation_site_table_;
+
   // offset of java.lang.ref.Reference.referent
   MemberOffset reference_referent_offset_;
 
@@ -707,6 +909,23 @@ class Heap {
   // offset of java.lang.ref.FinalizerReference.zombie
   MemberOffset finalizer_reference_zombie_offset_;
 
+  // java.lang.ref.FinalizerReference and the members AddFinalizerReference uses.
+  mirror::Class* finalizer_reference_class_;
+  mirror::ArtField* finalizer_reference_list_lock_;
+  mirror::ArtField* finalizer_reference_head_;
+  mirror::ArtField* finalizer_reference_queue_;
+  MemberOffset finalizer_reference_prev_offset_;
+  MemberOffset finalizer_reference_next_offset_;
+
+  // Number of finalizer references the collectors have enqueued.
+  uint64_t total_finalizers_enqueued_ GUARDED_BY(finalizer_ref_queue_lock_);
+
+  // The time in ns at which recent collections enqueued finalizer references, each with the value
+  // of total_finalizers_enqueued_ after it. Finalizers run in the order they are enqueued, so the
+  // first batch not yet finalized tells how long the oldest pending finalizer has waited.
+  std::deque<std::pair<uint64_t, uint64_t> > finalizer_batches_
+      GUARDED_BY(finalizer_ref_queue_lock_);
+
   // Minimum free guarantees that you always have at least min_free_ free bytes after growing for
   // utilization, regardless of target utilization ratio.
   size_t min_free_;
@@ -717,6 +936,19 @@ class Heap {
   // Target ideal heap utilization ratio
   double target_utilization_;
 
+  // The utilization the ergonomics settled on, starting from target_utilization_, and the factor
+  // they apply to the bytes left when a concurrent GC starts.
+  double ergonomic_utilization_;
+  double concurrent_start_scale_;
+
+  // Why the GC in progress, or the last one, was started.
+  GcCause last_gc_cause_;
+
+  // Heap trims done, the bytes they advised back to the kernel and the time they took.
+  uint64_t total_trims_;
+  uint64_t total_trimmed_bytes_;
+  uint64_t total_trim_time_ns_;
+
   // Total time which mutators are paused or waiting for GC to complete.
   uint64_t total_wait_time_;
 
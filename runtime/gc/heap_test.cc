@@ -14,9 +14,16 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <sstream>
+
 #include "common_test.h"
 #include "gc/accounting/card_table-inl.h"
+#include "gc/accounting/heap_bitmap.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/heap-inl.h"
+#include "gc/space/dlmalloc_space.h"
+#include "mirror/array-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
@@ -55,6 +62,99 @@ TEST_F(HeapTest, GarbageCollectClassLinkerInit) {
   Runtime::Current()->GetHeap()->CollectGarbage(false);
 }
 
+TEST_F(HeapTest, AllocObjectFromTlab) {
+  ScopedObjectAccess soa(Thread::Current());
+  Heap* heap = Runtime::Current()->GetHeap();
+  mirror::Class* c = class_linker_->FindSystemClass("[I");
+  size_t size = mirror::Array::DataOffset(sizeof(int32_t)).Uint32Value() + 4 * sizeof(int32_t);
+  SirtRef<mirror::Object> obj(soa.Self(), heap->AllocObjectFromTlab(soa.Self(), c, size));
+  if (!heap->IsUsingTlab()) {
+    EXPECT_TRUE(obj.get() == NULL);
+    return;
+  }
+  ASSERT_TRUE(obj.get() != NULL);
+  EXPECT_EQ(c, obj->GetClass());
+  EXPECT_TRUE(heap->GetAllocSpace()->Contains(obj.get()));
+  EXPECT_TRUE(heap->AllocObjectFromTlab(soa.Self(), c,
+                                        space::DlMallocSpace::kMaxThreadLocalAllocSize + 8) == NULL);
+}
+
+TEST_F(HeapTest, DumpPageSharing) {
+  Heap* heap = Runtime::Current()->GetHeap();
+  std::ostringstream os;
+  heap->DumpPageSharing(os);
+  std::string dump(os.str());
+  EXPECT_EQ(heap->GetContinuousSpaces().size(),
+            static_cast<size_t>(std::count(dump.begin(), dump.end(), '\n'))) << dump;
+  EXPECT_NE(std::string::npos, dump.find(heap->GetAllocSpace()->GetName())) << dump;
+}
+
+TEST_F(HeapTest, AtomicStackBumpBack) {
+  UniquePtr<accounting::ObjectStack> stack(accounting::ObjectStack::Create("test stack", 8));
+  mirror::Object** start;
+  mirror::Object** end;
+  ASSERT_TRUE(stack->AtomicBumpBack(3, &start, &end));
+  EXPECT_EQ(stack->Begin(), start);
+  EXPECT_EQ(start + 3, end);
+  EXPECT_TRUE(start[0] == NULL);
+  ASSERT_TRUE(stack->AtomicBumpBack(5, &start, &end));
+  EXPECT_EQ(stack->End(), end);
+  EXPECT_EQ(8U, stack->Size());
+  EXPECT_FALSE(stack->AtomicBumpBack(1, &start, &end));
+  EXPECT_FALSE(stack->AtomicPushBack(NULL));
+}
+
+TEST_F(HeapTest, RecordAllocationOnThreadLocalAllocationStack) {
+  ScopedObjectAccess soa(Thread::Current());
+  Heap* heap = Runtime::Current()->GetHeap();
+  heap->RevokeAllThreadLocalAllocationStacks(soa.Self());
+  mirror::Class* c = class_linker_->FindSystemClass("[I");
+  SirtRef<mirror::Object> first(soa.Self(), mirror::IntArray::Alloc(soa.Self(), 4));
+  SirtRef<mirror::Object> second(soa.Self(), mirror::IntArray::Alloc(soa.Self(), 4));
+  ASSERT_TRUE(first.get() != NULL);
+  ASSERT_TRUE(second.get() != NULL);
+  EXPECT_EQ(c, first->GetClass());
+  // Both went to the segment reserved by the first, which a collection must mark live.
+  heap->CollectGarbage(false);
+  EXPECT_TRUE(heap->GetLiveBitmap()->Test(first.get()));
+  EXPECT_TRUE(heap->GetLiveBitmap()->Test(second.get()));
+}
+
+TEST_F(HeapTest, CountAndGetInstances) {
+  ScopedObjectAccess soa(Thread::Current());
+  Heap* heap = Runtime::Current()->GetHeap();
+  mirror::Class* c = class_linker_->FindSystemClass("[I");
+  mirror::Class* object_class = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  SirtRef<mirror::ObjectArray<mirror::Object> > arrays(soa.Self(),
+      class_linker_->AllocObjectArray<mirror::Object>(soa.Self(), 100));
+  for (int32_t i = 0; i < arrays->GetLength(); ++i) {
+    arrays->Set(i, mirror::IntArray::Alloc(soa.Self(), i));
+  }
+
+  std::vector<mirror::Class*> classes;
+  classes.push_back(c);
+  classes.push_back(object_class);
+  uint64_t exact_counts[] = { 0, 0 };
+  heap->CountInstances(classes, false, exact_counts);
+  EXPECT_LE(100U, exact_counts[0]);
+  uint64_t assignable_counts[] = { 0, 0 };
+  heap->CountInstances(classes, true, assignable_counts);
+  EXPECT_EQ(exact_counts[0], assignable_counts[0]);
+  EXPECT_LT(assignable_counts[0], assignable_counts[1]);
+
+  std::vector<mirror::Object*> instances;
+  heap->GetInstances(c, 0, instances);
+  EXPECT_EQ(exact_counts[0], instances.size());
+  instances.clear();
+  heap->GetInstances(c, 10, instances);
+  EXPECT_EQ(10U, instances.size());
+
+  std::vector<mirror::Object*> referring_objects;
+  heap->GetReferringObjects(arrays->Get(42), 0, referring_objects);
+  ASSERT_EQ(1U, referring_objects.size());
+  EXPECT_EQ(arrays.get(), referring_objects[0]);
+}
+
 TEST_F(HeapTest, HeapBitmapCapacityTest) {
   byte* heap_begin = reinterpret_cast<byte*>(0x1000);
   const size_t heap_capacity = accounting::SpaceBitmap::kAlignment * (sizeof(intptr_t) * 8 + 1);
@@ -18,6 +18,7 @@
 #define ART_RUNTIME_GC_SPACE_DLMALLOC_SPACE_INL_H_
 
 #include "dlmalloc_space.h"
+#include "thread.h"
 
 namespace art {
 namespace gc {
@@ -37,6 +38,37 @@ inline mirror::Object* DlMallocSpace::AllocNonvirtual(Thread* self, size_t num_b
   return obj;
 }
 
+inline mirror::Object* DlMallocSpace::AllocThreadLocal(Thread* self, size_t num_bytes,
+                                                       size_t* bytes_allocated) {
+  if (UNLIKELY(num_bytes > kMaxThreadLocalAllocSize)) {
+    return NULL;
+  }
+  DCHECK_GT(num_bytes, 0U);
+  const size_t size_class = (num_bytes - 1) / kObjectAlignment;
+  if (UNLIKELY(self->GetTlabSpace() != this)) {
+    // The buffer holds chunks of a different space, for example the space we were allocating
+    // into before the zygote fork.
+    if (self->GetTlabSpace() != NULL) {
+      self->GetTlabSpace()->RevokeThreadLocalBuffers(self);
+    }
+    self->SetTlabSpace(this);
+  }
+  void* chunk = self->PopTlabChunk(size_class);
+  if (UNLIKELY(chunk == NULL)) {
+    if (!RefillThreadLocalBuffer(self, size_class)) {
+      return NULL;
+    }
+    chunk = self->PopTlabChunk(size_class);
+    DCHECK(chunk != NULL);
+  }
+  mirror::Object* result = reinterpret_cast<mirror::Object*>(chunk);
+  DCHECK(bytes_allocated != NULL);
+  *bytes_allocated = AllocationSizeNonvirtual(result);
+  // The chunk was accounted to the space when it was carved out, the heap accounts for it now.
+  memset(result, 0, num_bytes);
+  return result;
+}
+
 inline mirror::Object* DlMallocSpace::AllocWithoutGrowthLocked(size_t num_bytes, size_t* bytes_allocated) {
   mirror::Object* result = reinterpret_cast<mirror::Object*>(mspace_malloc(mspace_, num_bytes));
   if (result != NULL) {
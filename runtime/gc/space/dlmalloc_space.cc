@@ -18,6 +18,7 @@
 #include "gc/accounting/card_table.h"
 #include "gc/heap.h"
 #include "mirror/object-inl.h"
+#include "rosalloc_space.h"
 #include "runtime.h"
 #include "thread.h"
 #include "utils.h"
@@ -41,6 +42,10 @@ namespace space {
 
 static const bool kPrefetchDuringDlMallocFreeList = true;
 
+// Trim hands pages back this many bytes of chunks at a time, letting go of the space lock in
+// between so that allocations don't wait for the whole walk.
+static const size_t kTrimSliceBytes = 4 * MB;
+
 // Number of bytes to use as a red zone (rdz). A red zone of this size will be placed before and
 // after each allocation. 8 bytes provides long/double alignment.
 const size_t kValgrindRedZoneBytes = 8;
@@ -120,25 +125,14 @@ DlMallocSpace::DlMallocSpace(const std::string& name, MemMap* mem_map, void* msp
                        byte* end, size_t growth_limit)
     : MemMapSpace(name, mem_map, end - begin, kGcRetentionPolicyAlwaysCollect),
       recent_free_pos_(0), num_bytes_allocated_(0), num_objects_allocated_(0),
-      total_bytes_allocated_(0), total_objects_allocated_(0),
-      lock_("allocation space lock", kAllocSpaceLock), mspace_(mspace),
+      total_bytes_allocated_(0), total_objects_allocated_(0), total_thread_local_refills_(0),
+      num_frees_(0), lock_("allocation space lock", kAllocSpaceLock), mspace_(mspace),
       growth_limit_(growth_limit) {
   CHECK(mspace != NULL);
 
-  size_t bitmap_index = bitmap_index_++;
-
   static const uintptr_t kGcCardSize = static_cast<uintptr_t>(accounting::CardTable::kCardSize);
   CHECK(IsAligned<kGcCardSize>(reinterpret_cast<uintptr_t>(mem_map->Begin())));
   CHECK(IsAligned<kGcCardSize>(reinterpret_cast<uintptr_t>(mem_map->End())));
-  live_bitmap_.reset(accounting::SpaceBitmap::Create(
-      StringPrintf("allocspace %s live-bitmap %d", name.c_str(), static_cast<int>(bitmap_index)),
-      Begin(), Capacity()));
-  DCHECK(live_bitmap_.get() != NULL) << "could not create allocspace live bitmap #" << bitmap_index;
-
-  mark_bitmap_.reset(accounting::SpaceBitmap::Create(
-      StringPrintf("allocspace %s mark-bitmap %d", name.c_str(), static_cast<int>(bitmap_index)),
-      Begin(), Capacity()));
-  DCHECK(live_bitmap_.get() != NULL) << "could not create allocspace mark bitmap #" << bitmap_index;
 
   for (auto& freed : recent_freed_objects_) {
     freed.first = nullptr;
@@ -146,8 +140,22 @@ DlMallocSpace::DlMallocSpace(const std::string& name, MemMap* mem_map, void* msp
   }
 }
 
+void DlMallocSpace::InitBitmaps(MemMap* reservation) {
+  size_t bitmap_index = bitmap_index_++;
+  live_bitmap_.reset(accounting::SpaceBitmap::Create(
+      StringPrintf("allocspace %s live-bitmap %d", GetName(), static_cast<int>(bitmap_index)),
+      Begin(), Capacity(), reservation));
+  DCHECK(live_bitmap_.get() != NULL) << "could not create allocspace live bitmap #" << bitmap_index;
+
+  mark_bitmap_.reset(accounting::SpaceBitmap::Create(
+      StringPrintf("allocspace %s mark-bitmap %d", GetName(), static_cast<int>(bitmap_index)),
+      Begin(), Capacity(), reservation));
+  DCHECK(mark_bitmap_.get() != NULL) << "could not create allocspace mark bitmap #" << bitmap_index;
+}
+
 DlMallocSpace* DlMallocSpace::Create(const std::string& name, size_t initial_size, size_t
-                                     growth_limit, size_t capacity, byte* requested_begin) {
+                                     growth_limit, size_t capacity, byte* requested_begin,
+                                     bool use_rosalloc, MemMap* reservation) {
   // Memory we promise to dlmalloc before it asks for morecore.
   // Note: making this value large means that large allocations are unlikely to succeed as dlmalloc
   // will ask for this memory from sys_alloc which will fail as the footprint (this value plus the
@@ -184,8 +192,13 @@ DlMallocSpace* DlMallocSpace::Create(const std::string& name, size_t initial_siz
   growth_limit = RoundUp(growth_limit, kPageSize);
   capacity = RoundUp(capacity, kPageSize);
 
-  UniquePtr<MemMap> mem_map(MemMap::MapAnonymous(name.c_str(), requested_begin, capacity,
-                                                 PROT_READ | PROT_WRITE));
+  UniquePtr<MemMap> mem_map;
+  if (reservation != NULL) {
+    mem_map.reset(reservation->CarveAnonymous(name.c_str(), capacity, PROT_READ | PROT_WRITE));
+  } else {
+    mem_map.reset(MemMap::MapAnonymous(name.c_str(), requested_begin, capacity,
+                                       PROT_READ | PROT_WRITE));
+  }
   if (mem_map.get() == NULL) {
     LOG(ERROR) << "Failed to allocate pages for alloc space (" << name << ") of size "
         << PrettySize(capacity);
@@ -210,9 +223,12 @@ DlMallocSpace* DlMallocSpace::Create(const std::string& name, size_t initial_siz
   if (RUNNING_ON_VALGRIND > 0) {
     space = new ValgrindDlMallocSpace(name, mem_map_ptr, mspace, mem_map_ptr->Begin(), end,
                                       growth_limit, initial_size);
+  } else if (use_rosalloc) {
+    space = new RosAllocSpace(name, mem_map_ptr, mspace, mem_map_ptr->Begin(), end, growth_limit);
   } else {
     space = new DlMallocSpace(name, mem_map_ptr, mspace, mem_map_ptr->Begin(), end, growth_limit);
   }
+  space->InitBitmaps(reservation);
   if (VLOG_IS_ON(heap) || VLOG_IS_ON(startup)) {
     LOG(INFO) << "Space::CreateAllocSpace exiting (" << PrettyDuration(NanoTime() - start_time)
         << " ) " << *space;
@@ -270,6 +286,33 @@ mirror::Object* DlMallocSpace::AllocWithGrowth(Thread* self, size_t num_bytes, s
   return result;
 }
 
+bool DlMallocSpace::AllocPair(Thread* self, size_t first_num_bytes, size_t second_num_bytes,
+                              mirror::Object** first, mirror::Object** second,
+                              size_t* first_bytes_allocated, size_t* second_bytes_allocated) {
+  size_t sizes[2] = { first_num_bytes, second_num_bytes };
+  void* chunks[2];
+  {
+    MutexLock mu(self, lock_);
+    // Carves both chunks out of one, so they are adjacent.
+    if (mspace_independent_comalloc(mspace_, 2, sizes, chunks) == NULL) {
+      return false;
+    }
+    *first = reinterpret_cast<mirror::Object*>(chunks[0]);
+    *second = reinterpret_cast<mirror::Object*>(chunks[1]);
+    *first_bytes_allocated = AllocationSizeNonvirtual(*first);
+    *second_bytes_allocated = AllocationSizeNonvirtual(*second);
+    num_bytes_allocated_ += *first_bytes_allocated + *second_bytes_allocated;
+    total_bytes_allocated_ += *first_bytes_allocated + *second_bytes_allocated;
+    total_objects_allocated_ += 2;
+    num_objects_allocated_ += 2;
+  }
+  CHECK(!kDebugSpaces || (Contains(*first) && Contains(*second)));
+  // Zero freshly allocated memory, done while not holding the space's lock.
+  memset(*first, 0, first_num_bytes);
+  memset(*second, 0, second_num_bytes);
+  return true;
+}
+
 void DlMallocSpace::SetGrowthLimit(size_t growth_limit) {
   growth_limit = RoundUp(growth_limit, kPageSize);
   growth_limit_ = growth_limit;
@@ -316,7 +359,8 @@ DlMallocSpace* DlMallocSpace::CreateZygoteSpace(const char* alloc_space_name) {
     CHECK_MEMORY_CALL(mprotect, (end, capacity - initial_size, PROT_NONE), alloc_space_name);
   }
   DlMallocSpace* alloc_space =
-      new DlMallocSpace(alloc_space_name, mem_map.release(), mspace, end_, end, growth_limit);
+      CreateInstance(alloc_space_name, mem_map.release(), mspace, end_, end, growth_limit);
+  alloc_space->InitBitmaps(NULL);
   live_bitmap_->SetHeapLimit(reinterpret_cast<uintptr_t>(End()));
   CHECK_EQ(live_bitmap_->HeapLimit(), reinterpret_cast<uintptr_t>(End()));
   mark_bitmap_->SetHeapLimit(reinterpret_cast<uintptr_t>(End()));
@@ -325,6 +369,12 @@ DlMallocSpace* DlMallocSpace::CreateZygoteSpace(const char* alloc_space_name) {
   return alloc_space;
 }
 
+DlMallocSpace* DlMallocSpace::CreateInstance(const std::string& name, MemMap* mem_map,
+                                             void* mspace, byte* begin, byte* end,
+                                             size_t growth_limit) {
+  return new DlMallocSpace(name, mem_map, mspace, begin, end, growth_limit);
+}
+
 mirror::Class* DlMallocSpace::FindRecentFreedObject(const mirror::Object* obj) {
   size_t pos = recent_free_pos_;
   // Start at the most recently freed object and work our way back since there may be duplicates
@@ -358,6 +408,7 @@ size_t DlMallocSpace::Free(Thread* self, mirror::Object* ptr) {
   if (kRecentFreeCount > 0) {
     RegisterRecentFree(ptr);
   }
+  ++num_frees_;
   mspace_free(mspace_, ptr);
   return bytes_freed;
 }
@@ -402,11 +453,56 @@ size_t DlMallocSpace::FreeList(Thread* self, size_t num_ptrs, mirror::Object** p
     MutexLock mu(self, lock_);
     num_bytes_allocated_ -= bytes_freed;
     num_objects_allocated_ -= num_ptrs;
+    ++num_frees_;
     mspace_bulk_free(mspace_, reinterpret_cast<void**>(ptrs), num_ptrs);
     return bytes_freed;
   }
 }
 
+bool DlMallocSpace::RefillThreadLocalBuffer(Thread* self, size_t size_class) {
+  COMPILE_ASSERT(kMaxThreadLocalAllocSize == Thread::kTlabSizeClassCount * kObjectAlignment,
+                 tlab_size_classes_do_not_cover_max_thread_local_alloc_size);
+  DCHECK_EQ(self->GetTlabSpace(), this);
+  const size_t chunk_size = (size_class + 1) * kObjectAlignment;
+  const size_t num_chunks = kThreadLocalRefillBytes / chunk_size;
+  size_t num_allocated = 0;
+  {
+    MutexLock mu(self, lock_);
+    for (; num_allocated < num_chunks; ++num_allocated) {
+      size_t bytes_allocated;
+      mirror::Object* chunk = AllocWithoutGrowthLocked(chunk_size, &bytes_allocated);
+      if (chunk == NULL) {
+        break;
+      }
+      self->PushTlabChunk(size_class, chunk);
+    }
+    if (num_allocated != 0) {
+      ++total_thread_local_refills_;
+    }
+  }
+  return num_allocated != 0;
+}
+
+size_t DlMallocSpace::RevokeThreadLocalBuffers(Thread* thread) {
+  DCHECK_EQ(thread->GetTlabSpace(), this);
+  size_t bytes_freed = 0;
+  MutexLock mu(Thread::Current(), lock_);
+  for (size_t size_class = 0; size_class < Thread::kTlabSizeClassCount; ++size_class) {
+    for (void* chunk = thread->PopTlabChunk(size_class); chunk != NULL;
+         chunk = thread->PopTlabChunk(size_class)) {
+      const size_t chunk_bytes =
+          InternalAllocationSize(reinterpret_cast<const mirror::Object*>(chunk));
+      bytes_freed += chunk_bytes;
+      num_bytes_allocated_ -= chunk_bytes;
+      --num_objects_allocated_;
+      ++num_frees_;
+      mspace_free(mspace_, chunk);
+    }
+  }
+  thread->SetTlabSpace(NULL);
+  return bytes_freed;
+}
+
 // Callback from dlmalloc when it needs to increase the footprint
 extern "C" void* art_heap_morecore(void* mspace, intptr_t increment) {
   Heap* heap = Runtime::Current()->GetHeap();
@@ -454,12 +550,24 @@ size_t DlMallocSpace::AllocationSize(const mirror::Object* obj) {
 }
 
 size_t DlMallocSpace::Trim() {
-  MutexLock mu(Thread::Current(), lock_);
-  // Trim to release memory at the end of the space.
-  mspace_trim(mspace_, 0);
-  // Visit space looking for page-sized holes to advise the kernel we don't need.
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, lock_);
+    // Trim to release memory at the end of the space.
+    mspace_trim(mspace_, 0);
+  }
+  // Visit space looking for page-sized holes to advise the kernel we don't need, a slice at a
+  // time. The chunk a slice stopped at may have been coalesced by a free while the lock was
+  // released, in which case the next slice finds its place again by address.
   size_t reclaimed = 0;
-  mspace_inspect_all(mspace_, DlmallocMadviseCallback, &reclaimed);
+  void* resume = NULL;
+  uint64_t frees_at_resume = 0;
+  do {
+    MutexLock mu(self, lock_);
+    resume = MspaceInspectSome(mspace_, resume, frees_at_resume == num_frees_, kTrimSliceBytes,
+                               DlmallocMadviseCallback, &reclaimed);
+    frees_at_resume = num_frees_;
+  } while (resume != NULL);
   return reclaimed;
 }
 
@@ -45,9 +45,12 @@ class DlMallocSpace : public MemMapSpace, public AllocSpace {
   // Create a AllocSpace with the requested sizes. The requested
   // base address is not guaranteed to be granted, if it is required,
   // the caller should call Begin on the returned space to confirm
-  // the request was granted.
+  // the request was granted. If use_rosalloc is set, small objects are allocated from runs of
+  // slots, see RosAllocSpace. If reservation isn't NULL, the space and its bitmaps are carved from
+  // it rather than mapped at requested_begin.
   static DlMallocSpace* Create(const std::string& name, size_t initial_size, size_t growth_limit,
-                               size_t capacity, byte* requested_begin);
+                               size_t capacity, byte* requested_begin, bool use_rosalloc = false,
+                               MemMap* reservation = NULL);
 
   // Allocate num_bytes without allowing the underlying mspace to grow.
   virtual mirror::Object* AllocWithGrowth(Thread* self, size_t num_bytes,
@@ -63,6 +66,30 @@ class DlMallocSpace : public MemMapSpace, public AllocSpace {
 
   mirror::Object* AllocNonvirtual(Thread* self, size_t num_bytes, size_t* bytes_allocated);
 
+  // Allocate two chunks with one lock acquisition and without allowing the mspace to grow, the
+  // second starting right after the first so that objects used together share cache lines. Each
+  // chunk is freed on its own. Returns false if the mspace doesn't have room for both.
+  bool AllocPair(Thread* self, size_t first_num_bytes, size_t second_num_bytes,
+                 mirror::Object** first, mirror::Object** second,
+                 size_t* first_bytes_allocated, size_t* second_bytes_allocated)
+      LOCKS_EXCLUDED(lock_);
+
+  // Largest allocation which may be satisfied from a thread-local allocation buffer (TLAB).
+  static constexpr size_t kMaxThreadLocalAllocSize = 128;
+
+  // Number of bytes worth of chunks that are carved out of the mspace when a thread's buffer for
+  // a size class runs dry.
+  static constexpr size_t kThreadLocalRefillBytes = 2 * KB;
+
+  // Allocate num_bytes from the calling thread's TLAB without acquiring the space's lock. The lock
+  // is only taken to refill the buffer with a batch of chunks once it is exhausted. Returns NULL if
+  // the request is too large for a TLAB or the mspace is full.
+  mirror::Object* AllocThreadLocal(Thread* self, size_t num_bytes, size_t* bytes_allocated);
+
+  // Return the unused chunks held in the thread's TLAB to the mspace. The thread must either be
+  // the caller or suspended. Returns the number of bytes given back.
+  virtual size_t RevokeThreadLocalBuffers(Thread* thread) LOCKS_EXCLUDED(lock_);
+
   size_t AllocationSizeNonvirtual(const mirror::Object* obj) {
     return mspace_usable_size(const_cast<void*>(reinterpret_cast<const void*>(obj))) +
         kChunkOverhead;
@@ -74,8 +101,9 @@ class DlMallocSpace : public MemMapSpace, public AllocSpace {
     return mspace_;
   }
 
-  // Hands unused pages back to the system.
-  size_t Trim();
+  // Hands unused pages back to the system. Takes the space lock for a slice of the space at a
+  // time, so allocations can go on while the space is trimmed.
+  size_t Trim() LOCKS_EXCLUDED(lock_);
 
   // Perform a mspace_inspect_all which calls back for each allocation chunk. The chunk may not be
   // in use, indicated by num_bytes equaling zero.
@@ -143,6 +171,11 @@ class DlMallocSpace : public MemMapSpace, public AllocSpace {
     return total_objects_allocated_;
   }
 
+  // Number of times a thread-local allocation buffer was refilled from this space.
+  uint64_t GetTotalThreadLocalRefills() const {
+    return total_thread_local_refills_;
+  }
+
   // Returns the class of a recently freed object.
   mirror::Class* FindRecentFreedObject(const mirror::Object* obj);
 
@@ -150,11 +183,20 @@ class DlMallocSpace : public MemMapSpace, public AllocSpace {
   DlMallocSpace(const std::string& name, MemMap* mem_map, void* mspace, byte* begin, byte* end,
                 size_t growth_limit);
 
+  // Create a space of the same kind as this one, used when splitting off the zygote space.
+  virtual DlMallocSpace* CreateInstance(const std::string& name, MemMap* mem_map, void* mspace,
+                                        byte* begin, byte* end, size_t growth_limit);
+
  private:
   size_t InternalAllocationSize(const mirror::Object* obj);
   mirror::Object* AllocWithoutGrowthLocked(size_t num_bytes, size_t* bytes_allocated)
       EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Carve a batch of chunks of the given size class out of the mspace and push them onto the
+  // thread's TLAB. Returns false if not even a single chunk could be allocated.
+  bool RefillThreadLocalBuffer(Thread* self, size_t size_class) LOCKS_EXCLUDED(lock_);
   bool Init(size_t initial_size, size_t maximum_size, size_t growth_size, byte* requested_base);
+  // Creates the live and mark bitmaps, carved from reservation if it isn't NULL.
+  void InitBitmaps(MemMap* reservation);
   void RegisterRecentFree(mirror::Object* ptr);
   static void* CreateMallocSpace(void* base, size_t morecore_start, size_t initial_size);
 
@@ -173,18 +215,26 @@ class DlMallocSpace : public MemMapSpace, public AllocSpace {
   size_t num_objects_allocated_;
   size_t total_bytes_allocated_;
   size_t total_objects_allocated_;
+  size_t total_thread_local_refills_;
+
+  // How many times chunks were freed into the mspace, guarded by lock_. Lets Trim tell whether the
+  // chunk it stopped at can still be trusted.
+  uint64_t num_frees_;
 
   static size_t bitmap_index_;
 
   // The boundary tag overhead.
   static const size_t kChunkOverhead = kWordSize;
 
+ protected:
   // Used to ensure mutual exclusion when the allocation spaces data structures are being modified.
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
   // Underlying malloc space
   void* const mspace_;
 
+ private:
+
   // The capacity of the alloc space until such time that ClearGrowthLimit is called.
   // The underlying mem_map_ controls the maximum size we allow the heap to grow to. The growth
   // limit is a value <= to the mem_map_ capacity used for ergonomic reasons because of the zygote.
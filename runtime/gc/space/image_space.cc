@@ -16,8 +16,14 @@
 
 #include "image_space.h"
 
+#include <pthread.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <vector>
 
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
@@ -37,9 +43,17 @@ namespace space {
 
 AtomicInteger ImageSpace::bitmap_index_(0);
 
+// A relocated image is moved down in steps of its size so that it stays below its oat file and
+// the alloc space, giving up after this many steps.
+static const size_t kMaxRelocationAttempts = 16;
+
+// Upper bound on the threads sharing the relocation or the decompression of an image.
+static const size_t kMaxRelocationThreads = 4;
+
 ImageSpace::ImageSpace(const std::string& name, MemMap* mem_map,
                        accounting::SpaceBitmap* live_bitmap)
-    : MemMapSpace(name, mem_map, mem_map->Size(), kGcRetentionPolicyNeverCollect) {
+    : MemMapSpace(name, mem_map, mem_map->Size(), kGcRetentionPolicyNeverCollect),
+      relocation_delta_(0) {
   DCHECK(live_bitmap != NULL);
   live_bitmap_.reset(live_bitmap);
 }
@@ -160,6 +174,227 @@ void ImageSpace::VerifyImageAllocations() {
   }
 }
 
+// Returns true if nothing is mapped in [begin, begin + size). Asks for a mapping there without
+// MAP_FIXED, which the kernel only places at begin if the whole range is free.
+static bool IsAddressRangeFree(byte* begin, size_t size) {
+  void* actual = mmap(begin, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (actual == MAP_FAILED) {
+    return false;
+  }
+  munmap(actual, size);
+  return actual == begin;
+}
+
+// A range of the words of the image relocation bitmap, relocated by one thread.
+struct ImageRelocationStripe {
+  uint32_t* image_begin;
+  const word* relocations;
+  size_t begin;
+  size_t end;
+  ptrdiff_t delta;
+};
+
+static void* RelocateImageStripe(void* arg) {
+  const ImageRelocationStripe* stripe = reinterpret_cast<ImageRelocationStripe*>(arg);
+  const word* relocations = stripe->relocations;
+  for (size_t i = accounting::SpaceBitmap::FindNonZeroWord(relocations, stripe->begin, stripe->end);
+       i < stripe->end;
+       i = accounting::SpaceBitmap::FindNonZeroWord(relocations, i + 1, stripe->end)) {
+    uint32_t* words = stripe->image_begin + i * kBitsPerWord;
+    word w = relocations[i];
+    do {
+      words[CTZ(w)] += stripe->delta;
+      w &= w - 1;
+    } while (w != 0);
+  }
+  return NULL;
+}
+
+// Adds delta to every word of the image with a bit set in relocations. The words are independent
+// so the bitmap is split into a stripe per thread.
+static void RelocateImage(byte* image_begin, const word* relocations, size_t num_words,
+                          ptrdiff_t delta) {
+  size_t thread_count = std::min(kMaxRelocationThreads,
+                                 static_cast<size_t>(std::max(sysconf(_SC_NPROCESSORS_CONF), 1L)));
+  size_t stripe_words = RoundUp(num_words, thread_count) / thread_count;
+  std::vector<ImageRelocationStripe> stripes(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    stripes[i].image_begin = reinterpret_cast<uint32_t*>(image_begin);
+    stripes[i].relocations = relocations;
+    stripes[i].begin = std::min(i * stripe_words, num_words);
+    stripes[i].end = std::min(stripes[i].begin + stripe_words, num_words);
+    stripes[i].delta = delta;
+  }
+  // Nothing else runs this early in startup, so plain threads are used rather than a ThreadPool
+  // whose workers need to attach to the runtime.
+  std::vector<pthread_t> threads(thread_count - 1);
+  for (size_t i = 1; i < thread_count; ++i) {
+    CHECK_PTHREAD_CALL(pthread_create, (&threads[i - 1], NULL, RelocateImageStripe, &stripes[i]),
+                       "image relocation thread");
+  }
+  RelocateImageStripe(&stripes[0]);
+  for (pthread_t thread : threads) {
+    CHECK_PTHREAD_CALL(pthread_join, (thread, NULL), "image relocation thread");
+  }
+}
+
+// The blocks of a compressed image, inflated by threads taking the next block until none is left.
+struct ImageDecompression {
+  byte* image_begin;
+  size_t image_size;
+  size_t block_size;
+  size_t num_blocks;
+  // File offsets of the blocks, the first of which is mapped at compressed_begin.
+  const uint32_t* index;
+  const byte* compressed_begin;
+  AtomicInteger next_block;
+  AtomicInteger failed_block;
+};
+
+static void* DecompressImageBlocks(void* arg) {
+  ImageDecompression* decompression = reinterpret_cast<ImageDecompression*>(arg);
+  const uint32_t* index = decompression->index;
+  for (size_t i = decompression->next_block.fetch_add(1); i < decompression->num_blocks;
+       i = decompression->next_block.fetch_add(1)) {
+    size_t offset = i * decompression->block_size;
+    uLongf size = std::min(decompression->block_size, decompression->image_size - offset);
+    uLongf expected_size = size;
+    int result = uncompress(decompression->image_begin + offset, &size,
+                            decompression->compressed_begin + (index[i] - index[0]),
+                            index[i + 1] - index[i]);
+    if (result != Z_OK || size != expected_size) {
+      decompression->failed_block = static_cast<int32_t>(i);
+    }
+  }
+  return NULL;
+}
+
+// Inflates the blocks of a compressed image into [image_begin, image_begin + image size).
+static bool DecompressImage(const std::string& image_file_name, int fd,
+                            const ImageHeader& image_header, byte* image_begin) {
+  uint64_t start_time = NanoTime();
+  size_t num_blocks = image_header.GetNumImageBlocks();
+  std::vector<uint32_t> index(num_blocks + 1);
+  size_t index_size = index.size() * sizeof(uint32_t);
+  if (TEMP_FAILURE_RETRY(pread(fd, &index[0], index_size,
+                               image_header.GetImageBlockIndexOffset())) !=
+      static_cast<ssize_t>(index_size)) {
+    PLOG(ERROR) << "Failed to read the block index of " << image_file_name;
+    return false;
+  }
+  for (size_t i = 0; i < num_blocks; ++i) {
+    if (index[i] > index[i + 1]) {
+      LOG(ERROR) << "Invalid block index of " << image_file_name << " at block " << i;
+      return false;
+    }
+  }
+  UniquePtr<MemMap> compressed(MemMap::MapFileAtAddress(nullptr, index[num_blocks] - index[0],
+                                                        PROT_READ, MAP_PRIVATE, fd, index[0],
+                                                        false));
+  if (compressed.get() == NULL) {
+    LOG(ERROR) << "Failed to map the compressed blocks of " << image_file_name;
+    return false;
+  }
+
+  ImageDecompression decompression;
+  decompression.image_begin = image_begin;
+  decompression.image_size = image_header.GetImageSize();
+  decompression.block_size = image_header.GetImageBlockSize();
+  decompression.num_blocks = num_blocks;
+  decompression.index = &index[0];
+  decompression.compressed_begin = compressed->Begin();
+  decompression.next_block = 0;
+  decompression.failed_block = -1;
+  // As for the relocation, plain threads as the runtime isn't up yet.
+  size_t thread_count = std::min(std::min(kMaxRelocationThreads, num_blocks),
+                                 static_cast<size_t>(std::max(sysconf(_SC_NPROCESSORS_CONF), 1L)));
+  std::vector<pthread_t> threads(thread_count - 1);
+  for (size_t i = 1; i < thread_count; ++i) {
+    CHECK_PTHREAD_CALL(pthread_create,
+                       (&threads[i - 1], NULL, DecompressImageBlocks, &decompression),
+                       "image decompression thread");
+  }
+  DecompressImageBlocks(&decompression);
+  for (pthread_t thread : threads) {
+    CHECK_PTHREAD_CALL(pthread_join, (thread, NULL), "image decompression thread");
+  }
+  if (decompression.failed_block != -1) {
+    LOG(ERROR) << "Failed to decompress block " << decompression.failed_block << " of "
+               << image_file_name;
+    return false;
+  }
+  VLOG(startup) << "Decompressed " << PrettySize(compressed->Size()) << " of " << image_file_name
+                << " into " << PrettySize(decompression.image_size) << " in "
+                << PrettyDuration(NanoTime() - start_time);
+  return true;
+}
+
+MemMap* ImageSpace::MapImage(const std::string& image_file_name, int fd,
+                             const ImageHeader& image_header, ptrdiff_t* delta) {
+  byte* requested_begin = image_header.GetImageBegin();
+  size_t image_size = RoundUp(image_header.GetImageSize(), kPageSize);
+  byte* image_begin = requested_begin;
+  for (size_t i = 1; !IsAddressRangeFree(image_begin, image_size); ++i) {
+    if (i > kMaxRelocationAttempts ||
+        i * image_size >= reinterpret_cast<uintptr_t>(requested_begin)) {
+      LOG(ERROR) << "Failed to find a free address range to map " << image_file_name << " below "
+                 << reinterpret_cast<void*>(requested_begin);
+      return NULL;
+    }
+    image_begin = requested_begin - i * image_size;
+  }
+
+  UniquePtr<MemMap> map;
+  if (image_header.IsCompressed()) {
+    // The range is free, so the kernel takes the hint.
+    map.reset(MemMap::MapAnonymous(image_file_name.c_str(), image_begin,
+                                   image_header.GetImageSize(), PROT_READ | PROT_WRITE));
+    if (map.get() == NULL) {
+      return NULL;
+    }
+    CHECK_EQ(image_begin, map->Begin());
+    if (!DecompressImage(image_file_name, fd, image_header, map->Begin())) {
+      return NULL;
+    }
+  } else {
+    // Note: The image header is part of the image due to mmap page alignment required of offset.
+    map.reset(MemMap::MapFileAtAddress(image_begin,
+                                       image_header.GetImageSize(),
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_FIXED,
+                                       fd,
+                                       0,
+                                       false));
+    if (map.get() == NULL) {
+      return NULL;
+    }
+    CHECK_EQ(image_begin, map->Begin());
+  }
+  DCHECK_EQ(0, memcmp(&image_header, map->Begin(), sizeof(ImageHeader)));
+
+  *delta = image_begin - requested_begin;
+  if (*delta != 0) {
+    uint64_t start_time = NanoTime();
+    UniquePtr<MemMap> relocations(MemMap::MapFileAtAddress(nullptr,
+                                                           image_header.GetImageRelocationsSize(),
+                                                           PROT_READ, MAP_PRIVATE, fd,
+                                                           image_header.GetImageRelocationsOffset(),
+                                                           false));
+    if (relocations.get() == NULL) {
+      LOG(ERROR) << "Failed to map relocations of " << image_file_name;
+      return NULL;
+    }
+    RelocateImage(map->Begin(), reinterpret_cast<const word*>(relocations->Begin()),
+                  relocations->Size() / kWordSize, *delta);
+    reinterpret_cast<ImageHeader*>(map->Begin())->RelocateImage(*delta);
+    LOG(INFO) << "Relocated " << image_file_name << " from "
+              << reinterpret_cast<void*>(requested_begin) << " to "
+              << reinterpret_cast<void*>(image_begin) << " in "
+              << PrettyDuration(NanoTime() - start_time);
+  }
+  return map.release();
+}
+
 ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_oat_file) {
   CHECK(!image_file_name.empty());
 
@@ -181,25 +416,27 @@ ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_o
     return NULL;
   }
 
-  // Note: The image header is part of the image due to mmap page alignment required of offset.
-  UniquePtr<MemMap> map(MemMap::MapFileAtAddress(image_header.GetImageBegin(),
-                                                 image_header.GetImageSize(),
-                                                 PROT_READ | PROT_WRITE,
-                                                 MAP_PRIVATE | MAP_FIXED,
-                                                 file->Fd(),
-                                                 0,
-                                                 false));
+  ptrdiff_t relocation_delta = 0;
+  UniquePtr<MemMap> map(MapImage(image_file_name, file->Fd(), image_header, &relocation_delta));
   if (map.get() == NULL) {
     LOG(ERROR) << "Failed to map " << image_file_name;
     return NULL;
   }
-  CHECK_EQ(image_header.GetImageBegin(), map->Begin());
-  DCHECK_EQ(0, memcmp(&image_header, map->Begin(), sizeof(ImageHeader)));
+  image_header = *reinterpret_cast<ImageHeader*>(map->Begin());  // Picks up any relocation.
+
+  // The oat file is still loaded at its fixed address, make sure it doesn't clobber a mapping.
+  if (!IsAddressRangeFree(image_header.GetOatFileBegin(),
+                          image_header.GetOatFileEnd() - image_header.GetOatFileBegin())) {
+    LOG(ERROR) << "Oat file address range "
+               << reinterpret_cast<void*>(image_header.GetOatFileBegin()) << "-"
+               << reinterpret_cast<void*>(image_header.GetOatFileEnd()) << " of " << image_file_name
+               << " is in use";
+    return NULL;
+  }
 
   UniquePtr<MemMap> image_map(MemMap::MapFileAtAddress(nullptr, image_header.GetImageBitmapSize(),
-                                                       PROT_READ, MAP_PRIVATE,
-                                                       file->Fd(), image_header.GetBitmapOffset(),
-                                                       false));
+                                                       PROT_READ, MAP_PRIVATE, file->Fd(),
+                                                       image_header.GetImageBitmapOffset(), false));
   CHECK(image_map.get() != nullptr) << "failed to map image bitmap";
   size_t bitmap_index = bitmap_index_.fetch_add(1);
   std::string bitmap_name(StringPrintf("imagespace %s live-bitmap %u", image_file_name.c_str(),
@@ -222,6 +459,7 @@ ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_o
   runtime->SetCalleeSaveMethod(down_cast<mirror::ArtMethod*>(callee_save_method), Runtime::kRefsAndArgs);
 
   UniquePtr<ImageSpace> space(new ImageSpace(image_file_name, map.release(), bitmap.release()));
+  space->relocation_delta_ = relocation_delta;
   if (kIsDebugBuild) {
     space->VerifyImageAllocations();
   }
@@ -232,6 +470,11 @@ ImageSpace* ImageSpace::Init(const std::string& image_file_name, bool validate_o
     return NULL;
   }
 
+  if (relocation_delta != 0 && !space->RelocateOatFile(file->Fd())) {
+    LOG(ERROR) << "Failed to relocate oat file for image: " << image_file_name;
+    return NULL;
+  }
+
   if (validate_oat_file && !space->ValidateOatFile()) {
     LOG(WARNING) << "Failed to validate oat file for image: " << image_file_name;
     return NULL;
@@ -271,6 +514,54 @@ OatFile* ImageSpace::OpenOatFile() const {
   return oat_file;
 }
 
+bool ImageSpace::RelocateOatFile(int fd) const {
+  const ImageHeader& image_header = GetImageHeader();
+  size_t count = image_header.GetOatRelocationsCount();
+  if (count == 0) {
+    return true;
+  }
+  UniquePtr<MemMap> relocations(MemMap::MapFileAtAddress(nullptr, count * sizeof(uint32_t),
+                                                         PROT_READ, MAP_PRIVATE, fd,
+                                                         image_header.GetImageRelocationsOffset() +
+                                                             image_header.GetImageRelocationsSize(),
+                                                         false));
+  if (relocations.get() == NULL) {
+    LOG(ERROR) << "Failed to map oat relocations of " << GetImageFilename();
+    return false;
+  }
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(relocations->Begin());
+  uint32_t min_offset = *std::min_element(offsets, offsets + count);
+  uint32_t max_offset = *std::max_element(offsets, offsets + count);
+  if (max_offset + sizeof(uint32_t) > oat_file_->Size()) {
+    // Portable code lives outside of the oat data and can't be relocated this way.
+    LOG(ERROR) << "Oat relocation at offset " << max_offset << " is outside of "
+               << oat_file_->GetLocation();
+    return false;
+  }
+
+  // Only the pages of code holding an image method address are written, and so copied, the rest
+  // of the oat file stays clean.
+  uintptr_t oat_begin = reinterpret_cast<uintptr_t>(&oat_file_->GetOatHeader());
+  byte* pages_begin = reinterpret_cast<byte*>(RoundDown(oat_begin + min_offset, kPageSize));
+  byte* pages_end = reinterpret_cast<byte*>(RoundUp(oat_begin + max_offset + sizeof(uint32_t),
+                                                    kPageSize));
+  size_t length = pages_end - pages_begin;
+  if (mprotect(pages_begin, length, PROT_READ | PROT_WRITE) != 0) {
+    PLOG(ERROR) << "Failed to make the code of " << oat_file_->GetLocation() << " writable";
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    *reinterpret_cast<uint32_t*>(oat_begin + offsets[i]) += relocation_delta_;
+  }
+  int prot = Runtime::Current()->IsCompiler() ? PROT_READ : PROT_READ | PROT_EXEC;
+  if (mprotect(pages_begin, length, prot) != 0) {
+    PLOG(ERROR) << "Failed to restore the protection of the code of " << oat_file_->GetLocation();
+    return false;
+  }
+  __builtin___clear_cache(reinterpret_cast<char*>(pages_begin), reinterpret_cast<char*>(pages_end));
+  return true;
+}
+
 bool ImageSpace::ValidateOatFile() const {
   CHECK(oat_file_.get() != NULL);
   for (const OatFile::OatDexFile* oat_dex_file : oat_file_->GetOatDexFiles()) {
@@ -64,6 +64,19 @@ class ImageSpace : public MemMapSpace {
     return GetName();
   }
 
+  // Bytes between the base address the image was compiled for and the one it is mapped at, zero
+  // unless the requested range was taken and the image had to be relocated.
+  ptrdiff_t GetRelocationDelta() const {
+    return relocation_delta_;
+  }
+
+  // The image oat data begin to record in, and expect from, oat files compiled against this
+  // image. Compiled code embeds the addresses of image methods, so this includes the relocation
+  // delta to keep code compiled for one placement of the image from running with another.
+  uint32_t GetImageFileLocationOatDataBegin() const {
+    return reinterpret_cast<uint32_t>(GetImageHeader().GetOatDataBegin()) + relocation_delta_;
+  }
+
   accounting::SpaceBitmap* GetLiveBitmap() const {
     return live_bitmap_.get();
   }
@@ -87,9 +100,18 @@ class ImageSpace : public MemMapSpace {
   static ImageSpace* Init(const std::string& image, bool validate_oat_file)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Maps the image at the base address it was compiled for or, if something else was mapped
+  // there, below it and applies the image relocations. Sets delta to the distance moved. A
+  // compressed image is inflated into anonymous memory instead of mapping the file.
+  static MemMap* MapImage(const std::string& image_file_name, int fd,
+                          const ImageHeader& image_header, ptrdiff_t* delta);
+
   OatFile* OpenOatFile() const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Moves the addresses of image methods held by compiled code by the relocation delta.
+  bool RelocateOatFile(int fd) const;
+
   bool ValidateOatFile() const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -106,6 +128,8 @@ class ImageSpace : public MemMapSpace {
   // the ClassLinker during it's initialization.
   UniquePtr<OatFile> oat_file_;
 
+  ptrdiff_t relocation_delta_;
+
   DISALLOW_COPY_AND_ASSIGN(ImageSpace);
 };
 
@@ -326,6 +326,229 @@ void FreeListSpace::Dump(std::ostream& os) const {
   }
 }
 
+SegregatedFreeListSpace* SegregatedFreeListSpace::Create(const std::string& name,
+                                                         byte* requested_begin, size_t capacity) {
+  CHECK_EQ(capacity % kPageSize, 0U);
+  MemMap* mem_map = MemMap::MapAnonymous(name.c_str(), requested_begin, capacity,
+                                         PROT_READ | PROT_WRITE);
+  CHECK(mem_map != NULL) << "Failed to allocate large object space mem map";
+  size_t page_table_size = RoundUp((capacity / kPageSize) * sizeof(PageInfo), kPageSize);
+  MemMap* page_table = MemMap::MapAnonymous((name + " page table").c_str(), NULL,
+                                            page_table_size, PROT_READ | PROT_WRITE);
+  CHECK(page_table != NULL) << "Failed to allocate large object space page table";
+  return new SegregatedFreeListSpace(name, mem_map, page_table);
+}
+
+SegregatedFreeListSpace::SegregatedFreeListSpace(const std::string& name, MemMap* mem_map,
+                                                 MemMap* page_table)
+    : LargeObjectSpace(name),
+      mem_map_(mem_map),
+      page_table_(page_table),
+      pages_(reinterpret_cast<PageInfo*>(page_table->Begin())),
+      num_pages_(mem_map->Size() / kPageSize),
+      lock_("segregated free list space lock", kAllocSpaceLock),
+      dirty_pages_(0) {
+  for (size_t i = 0; i < kNumFreeLists; ++i) {
+    free_lists_[i] = kNoPage;
+  }
+  MutexLock mu(Thread::Current(), lock_);
+  InsertFreeRun(0, num_pages_, false);
+}
+
+size_t SegregatedFreeListSpace::FreeListIndex(size_t num_pages) {
+  DCHECK_NE(num_pages, 0U);
+  if (num_pages <= kNumExactFreeLists) {
+    return num_pages - 1;
+  }
+  // 17 to 31 pages share the first power of two list.
+  size_t index = kNumExactFreeLists + (31 - CLZ(num_pages)) - 4;
+  DCHECK_LT(index, kNumFreeLists);
+  return index;
+}
+
+void SegregatedFreeListSpace::SetRun(size_t first_page, size_t num_pages, PageState state) {
+  DCHECK_LE(first_page + num_pages, num_pages_);
+  pages_[first_page].run_pages = num_pages;
+  pages_[first_page].state = state;
+  pages_[first_page + num_pages - 1].run_pages = num_pages;
+  pages_[first_page + num_pages - 1].state = state;
+}
+
+void SegregatedFreeListSpace::InsertFreeRun(size_t first_page, size_t num_pages, bool dirty) {
+  SetRun(first_page, num_pages, dirty ? kPageFreeDirty : kPageFree);
+  uint32_t* head = &free_lists_[FreeListIndex(num_pages)];
+  pages_[first_page].prev_free = kNoPage;
+  pages_[first_page].next_free = *head;
+  if (*head != kNoPage) {
+    pages_[*head].prev_free = first_page;
+  }
+  *head = first_page;
+  if (dirty) {
+    dirty_pages_ += num_pages;
+  }
+}
+
+void SegregatedFreeListSpace::RemoveFreeRun(size_t first_page) {
+  PageInfo* info = &pages_[first_page];
+  DCHECK_NE(info->state, static_cast<uint32_t>(kPageAllocated));
+  if (info->prev_free != kNoPage) {
+    pages_[info->prev_free].next_free = info->next_free;
+  } else {
+    free_lists_[FreeListIndex(info->run_pages)] = info->next_free;
+  }
+  if (info->next_free != kNoPage) {
+    pages_[info->next_free].prev_free = info->prev_free;
+  }
+  if (info->state == kPageFreeDirty) {
+    DCHECK_GE(dirty_pages_, info->run_pages);
+    dirty_pages_ -= info->run_pages;
+  }
+}
+
+mirror::Object* SegregatedFreeListSpace::Alloc(Thread* self, size_t num_bytes,
+                                               size_t* bytes_allocated) {
+  const size_t num_pages = RoundUp(num_bytes, kPageSize) / kPageSize;
+  if (UNLIKELY(num_pages == 0 || num_pages > num_pages_)) {
+    return NULL;
+  }
+  MutexLock mu(self, lock_);
+  // Every run on the exact lists and the lists above the one of num_pages fits. Runs on a power
+  // of two list may be shorter than num_pages.
+  size_t first_page = kNoPage;
+  for (size_t i = FreeListIndex(num_pages); i < kNumFreeLists && first_page == kNoPage; ++i) {
+    for (uint32_t page = free_lists_[i]; page != kNoPage; page = pages_[page].next_free) {
+      if (pages_[page].run_pages >= num_pages) {
+        first_page = page;
+        break;
+      }
+    }
+  }
+  if (first_page == kNoPage) {
+    return NULL;
+  }
+  const size_t run_pages = pages_[first_page].run_pages;
+  const bool dirty = pages_[first_page].state == kPageFreeDirty;
+  RemoveFreeRun(first_page);
+  if (run_pages > num_pages) {
+    InsertFreeRun(first_page + num_pages, run_pages - num_pages, dirty);
+  }
+  SetRun(first_page, num_pages, kPageAllocated);
+
+  const size_t allocation_size = num_pages * kPageSize;
+  byte* obj = PageAddress(first_page);
+  if (dirty) {
+    // Cheaper than faulting in zero pages again, the run was in use a moment ago.
+    memset(obj, 0, allocation_size);
+  }
+  DCHECK(bytes_allocated != NULL);
+  *bytes_allocated = allocation_size;
+  ++num_objects_allocated_;
+  ++total_objects_allocated_;
+  num_bytes_allocated_ += allocation_size;
+  total_bytes_allocated_ += allocation_size;
+  return reinterpret_cast<mirror::Object*>(obj);
+}
+
+size_t SegregatedFreeListSpace::Free(Thread* self, mirror::Object* obj) {
+  MutexLock mu(self, lock_);
+  DCHECK(Contains(obj));
+  DCHECK(IsAligned<kPageSize>(obj));
+  size_t first_page = PageIndex(obj);
+  CHECK_EQ(pages_[first_page].state, static_cast<uint32_t>(kPageAllocated))
+      << "Attempted to free large object which was not live";
+  const size_t allocation_size = pages_[first_page].run_pages * kPageSize;
+  size_t num_pages = pages_[first_page].run_pages;
+  // Coalesce with the free runs on either side.
+  if (first_page != 0 && pages_[first_page - 1].state != kPageAllocated) {
+    size_t prev_pages = pages_[first_page - 1].run_pages;
+    first_page -= prev_pages;
+    num_pages += prev_pages;
+    RemoveFreeRun(first_page);
+  }
+  size_t next_page = first_page + num_pages;
+  if (next_page != num_pages_ && pages_[next_page].state != kPageAllocated) {
+    num_pages += pages_[next_page].run_pages;
+    RemoveFreeRun(next_page);
+  }
+  if (num_pages * kPageSize > kMaxDirtyBytes) {
+    // Too big to keep around, the neighbours are released along with it.
+    madvise(PageAddress(first_page), num_pages * kPageSize, MADV_DONTNEED);
+    InsertFreeRun(first_page, num_pages, false);
+  } else {
+    InsertFreeRun(first_page, num_pages, true);
+    if (dirty_pages_ * kPageSize > kMaxDirtyBytes) {
+      ReleaseDirtyRunsLocked();
+    }
+  }
+  --num_objects_allocated_;
+  DCHECK_LE(allocation_size, num_bytes_allocated_);
+  num_bytes_allocated_ -= allocation_size;
+  return allocation_size;
+}
+
+void SegregatedFreeListSpace::ReleaseDirtyRunsLocked() {
+  for (size_t i = 0; i < kNumFreeLists; ++i) {
+    for (uint32_t page = free_lists_[i]; page != kNoPage; page = pages_[page].next_free) {
+      if (pages_[page].state == kPageFreeDirty) {
+        const size_t run_pages = pages_[page].run_pages;
+        madvise(PageAddress(page), run_pages * kPageSize, MADV_DONTNEED);
+        // Only the tags change, the run keeps its place on the list.
+        pages_[page].state = kPageFree;
+        pages_[page + run_pages - 1].state = kPageFree;
+        dirty_pages_ -= run_pages;
+      }
+    }
+  }
+  DCHECK_EQ(dirty_pages_, 0U);
+}
+
+void SegregatedFreeListSpace::ReleaseDirtyRuns(Thread* self) {
+  MutexLock mu(self, lock_);
+  ReleaseDirtyRunsLocked();
+}
+
+size_t SegregatedFreeListSpace::GetDirtyBytes() {
+  MutexLock mu(Thread::Current(), lock_);
+  return dirty_pages_ * kPageSize;
+}
+
+bool SegregatedFreeListSpace::Contains(const mirror::Object* obj) const {
+  return mem_map_->HasAddress(obj);
+}
+
+size_t SegregatedFreeListSpace::AllocationSize(const mirror::Object* obj) {
+  DCHECK(Contains(obj));
+  MutexLock mu(Thread::Current(), lock_);
+  const PageInfo& info = pages_[PageIndex(obj)];
+  DCHECK_EQ(info.state, static_cast<uint32_t>(kPageAllocated));
+  return info.run_pages * kPageSize;
+}
+
+void SegregatedFreeListSpace::Walk(DlMallocSpace::WalkCallback callback, void* arg) {
+  MutexLock mu(Thread::Current(), lock_);
+  for (size_t page = 0; page < num_pages_; page += pages_[page].run_pages) {
+    if (pages_[page].state == kPageAllocated) {
+      byte* start = PageAddress(page);
+      size_t size = pages_[page].run_pages * kPageSize;
+      callback(start, start + size, size, arg);
+      callback(NULL, NULL, 0, arg);
+    }
+  }
+}
+
+void SegregatedFreeListSpace::Dump(std::ostream& os) const {
+  MutexLock mu(Thread::Current(), lock_);
+  os << GetName() << " -"
+     << " begin: " << reinterpret_cast<void*>(Begin())
+     << " end: " << reinterpret_cast<void*>(End())
+     << " dirty free: " << PrettySize(dirty_pages_ * kPageSize) << "\n";
+  for (size_t page = 0; page < num_pages_; page += pages_[page].run_pages) {
+    os << (pages_[page].state == kPageAllocated ? "Large object" : "Free block")
+       << " at address: " << reinterpret_cast<const void*>(PageAddress(page))
+       << " of length " << pages_[page].run_pages * kPageSize << " bytes\n";
+  }
+}
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
@@ -230,6 +230,94 @@ class FreeListSpace : public LargeObjectSpace {
   FreeBlocks free_blocks_ GUARDED_BY(lock_);
 };
 
+// A continuous large object space which hands out runs of pages from segregated free lists, one
+// list per run length up to kNumExactFreeLists pages and one per power of two above that. Runs
+// are described by a page table outside of the space so objects start at page boundaries. Freed
+// runs stay committed and are reused first, zeroed on reuse, until more than kMaxDirtyBytes of
+// them accumulate; then they are given back with madvise.
+class SegregatedFreeListSpace : public LargeObjectSpace {
+ public:
+  virtual ~SegregatedFreeListSpace() {}
+  static SegregatedFreeListSpace* Create(const std::string& name, byte* requested_begin,
+                                         size_t capacity);
+
+  size_t AllocationSize(const mirror::Object* obj) LOCKS_EXCLUDED(lock_);
+  mirror::Object* Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated)
+      LOCKS_EXCLUDED(lock_);
+  size_t Free(Thread* self, mirror::Object* obj) LOCKS_EXCLUDED(lock_);
+  bool Contains(const mirror::Object* obj) const;
+  void Walk(DlMallocSpace::WalkCallback callback, void* arg) LOCKS_EXCLUDED(lock_);
+
+  byte* Begin() const {
+    return mem_map_->Begin();
+  }
+
+  byte* End() const {
+    return mem_map_->End();
+  }
+
+  // Bytes of freed runs which are still committed.
+  size_t GetDirtyBytes() LOCKS_EXCLUDED(lock_);
+
+  // Gives all of the freed runs back to the kernel.
+  void ReleaseDirtyRuns(Thread* self) LOCKS_EXCLUDED(lock_);
+
+  void Dump(std::ostream& os) const;
+
+ private:
+  static const size_t kNumExactFreeLists = 16;
+  static const size_t kNumFreeLists = kNumExactFreeLists + 32;
+  static const size_t kMaxDirtyBytes = 8 * MB;
+  static const uint32_t kNoPage = 0xFFFFFFFF;
+
+  enum PageState {
+    kPageAllocated,
+    kPageFree,
+    kPageFreeDirty,
+  };
+
+  // Tags the first and the last page of every run, the links are only valid for free runs.
+  struct PageInfo {
+    uint32_t run_pages;
+    uint32_t state;
+    uint32_t prev_free;
+    uint32_t next_free;
+  };
+
+  SegregatedFreeListSpace(const std::string& name, MemMap* mem_map, MemMap* page_table);
+
+  static size_t FreeListIndex(size_t num_pages);
+
+  size_t PageIndex(const void* addr) const {
+    return (reinterpret_cast<const byte*>(addr) - Begin()) / kPageSize;
+  }
+
+  byte* PageAddress(size_t page) const {
+    return Begin() + page * kPageSize;
+  }
+
+  // Writes the run tags at both ends of the run.
+  void SetRun(size_t first_page, size_t num_pages, PageState state)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  void InsertFreeRun(size_t first_page, size_t num_pages, bool dirty)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  void RemoveFreeRun(size_t first_page) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  void ReleaseDirtyRunsLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  UniquePtr<MemMap> mem_map_;
+  // A PageInfo for every page of the space.
+  UniquePtr<MemMap> page_table_;
+  PageInfo* const pages_;
+  const size_t num_pages_;
+  mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // Heads of the free lists, the most recently freed run first.
+  uint32_t free_lists_[kNumFreeLists] GUARDED_BY(lock_);
+  size_t dirty_pages_ GUARDED_BY(lock_);
+};
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
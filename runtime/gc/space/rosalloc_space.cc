@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rosalloc_space.h"
+
+#include "cutils/atomic.h"
+#include "cutils/atomic-inline.h"
+#include "dlmalloc_space-inl.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+namespace gc {
+namespace space {
+
+static constexpr uint8_t kRunMagic = 0x42;
+static constexpr size_t kBitMapWords = RosAllocSpace::kMaxSlotsPerRun / 32;
+
+RosAllocSpace::RosAllocSpace(const std::string& name, MemMap* mem_map, void* mspace, byte* begin,
+                             byte* end, size_t growth_limit)
+    : DlMallocSpace(name, mem_map, mspace, begin, end, growth_limit),
+      page_map_(mem_map->Size() / kPageSize, kPageMapNone), num_runs_(0),
+      total_run_bytes_freed_(0), total_run_objects_freed_(0) {
+  COMPILE_ASSERT(kNumThreadLocalBrackets <= kNumBrackets, too_many_thread_local_brackets);
+  COMPILE_ASSERT(kMaxBracketSize % kBracketQuantum == 0, max_bracket_size_not_quantized);
+  COMPILE_ASSERT(kBracketQuantum % kObjectAlignment == 0, bracket_quantum_breaks_alignment);
+  for (size_t i = 0; i < kNumBrackets; ++i) {
+    bracket_locks_[i] = new Mutex("rosalloc bracket lock", kRosAllocBracketLock);
+    current_runs_[i] = NULL;
+    non_full_runs_[i] = NULL;
+  }
+}
+
+RosAllocSpace::~RosAllocSpace() {
+  for (size_t i = 0; i < kNumBrackets; ++i) {
+    delete bracket_locks_[i];
+  }
+}
+
+DlMallocSpace* RosAllocSpace::CreateInstance(const std::string& name, MemMap* mem_map,
+                                             void* mspace, byte* begin, byte* end,
+                                             size_t growth_limit) {
+  return new RosAllocSpace(name, mem_map, mspace, begin, end, growth_limit);
+}
+
+size_t RosAllocSpace::NumPagesOfRun(size_t bracket_idx) {
+  // Keep the number of slots per run roughly constant so big brackets don't have tiny runs.
+  const size_t bracket_size = BracketSize(bracket_idx);
+  if (bracket_size <= 64) {
+    return 1;
+  } else if (bracket_size <= 128) {
+    return 2;
+  } else if (bracket_size <= 256) {
+    return 4;
+  }
+  return 8;
+}
+
+size_t RosAllocSpace::RunHeaderSize() {
+  return RoundUp(sizeof(Run), kBracketQuantum);
+}
+
+size_t RosAllocSpace::NumSlotsOfRun(size_t bracket_idx) {
+  const size_t slots = (NumPagesOfRun(bracket_idx) * kPageSize - RunHeaderSize()) /
+      BracketSize(bracket_idx);
+  return std::min(slots, kMaxSlotsPerRun);
+}
+
+RosAllocSpace::Run* RosAllocSpace::RunOf(const void* ptr) const {
+  size_t page_idx = (reinterpret_cast<uintptr_t>(ptr) - reinterpret_cast<uintptr_t>(Begin())) /
+      kPageSize;
+  DCHECK_LT(page_idx, page_map_.size());
+  if (page_map_[page_idx] == kPageMapNone) {
+    return NULL;
+  }
+  while (page_map_[page_idx] == kPageMapRunPart) {
+    DCHECK_GT(page_idx, 0U);
+    --page_idx;
+  }
+  DCHECK_EQ(page_map_[page_idx], kPageMapRun);
+  Run* run = reinterpret_cast<Run*>(Begin() + page_idx * kPageSize);
+  DCHECK_EQ(run->magic_, kRunMagic);
+  return run;
+}
+
+byte* RosAllocSpace::AllocSlot(Run* run) {
+  for (size_t i = 0; i < kBitMapWords; ++i) {
+    volatile int32_t* word_addr = &run->alloc_bit_map_[i];
+    int32_t word = *word_addr;
+    while (~word != 0) {
+      // Frees may clear bits concurrently, so claim the slot with a CAS and retry on failure.
+      const size_t bit = CTZ(~word);
+      if (android_atomic_cas(word, word | static_cast<int32_t>(1U << bit), word_addr) == 0) {
+        const size_t slot_idx = i * 32 + bit;
+        return reinterpret_cast<byte*>(run) + RunHeaderSize() +
+            slot_idx * BracketSize(run->bracket_idx_);
+      }
+      word = *word_addr;
+    }
+  }
+  return NULL;
+}
+
+size_t RosAllocSpace::FreeSlot(Run* run, const void* ptr) {
+  const size_t bracket_size = BracketSize(run->bracket_idx_);
+  const size_t offset = reinterpret_cast<const byte*>(ptr) - reinterpret_cast<byte*>(run) -
+      RunHeaderSize();
+  DCHECK_EQ(offset % bracket_size, 0U) << ptr;
+  const size_t slot_idx = offset / bracket_size;
+  DCHECK_LT(slot_idx, NumSlotsOfRun(run->bracket_idx_));
+  const int32_t mask = static_cast<int32_t>(1U << (slot_idx % 32));
+  const int32_t old_word = android_atomic_and(~mask, &run->alloc_bit_map_[slot_idx / 32]);
+  DCHECK_NE(old_word & mask, 0) << "Double free of " << ptr;
+  return bracket_size;
+}
+
+bool RosAllocSpace::IsRunFull(const Run* run) {
+  for (size_t i = 0; i < kBitMapWords; ++i) {
+    if (~run->alloc_bit_map_[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t RosAllocSpace::NumAllocatedSlots(const Run* run) {
+  size_t set_bits = 0;
+  for (size_t i = 0; i < kBitMapWords; ++i) {
+    set_bits += __builtin_popcount(run->alloc_bit_map_[i]);
+  }
+  // Discount the bits past the last slot which are always set.
+  return set_bits - (kMaxSlotsPerRun - NumSlotsOfRun(run->bracket_idx_));
+}
+
+bool RosAllocSpace::IsRunEmpty(const Run* run) {
+  return NumAllocatedSlots(run) == 0;
+}
+
+RosAllocSpace::Run* RosAllocSpace::AllocRun(Thread* self, size_t bracket_idx, bool grow) {
+  const size_t num_pages = NumPagesOfRun(bracket_idx);
+  Run* run;
+  {
+    MutexLock mu(self, lock_);
+    if (grow) {
+      // Like DlMallocSpace::AllocWithGrowth, the footprint limit is only raised while we hold the
+      // lock so that other threads' allocations still fail at the target footprint.
+      mspace_set_footprint_limit(mspace_, Capacity());
+    }
+    run = reinterpret_cast<Run*>(mspace_memalign(mspace_, kPageSize, num_pages * kPageSize));
+    if (grow) {
+      mspace_set_footprint_limit(mspace_, mspace_footprint(mspace_));
+    }
+    if (run == NULL) {
+      return NULL;
+    }
+    const size_t page_idx = (reinterpret_cast<byte*>(run) - Begin()) / kPageSize;
+    page_map_[page_idx] = kPageMapRun;
+    for (size_t i = 1; i < num_pages; ++i) {
+      page_map_[page_idx + i] = kPageMapRunPart;
+    }
+    ++num_runs_;
+  }
+  run->magic_ = kRunMagic;
+  run->bracket_idx_ = bracket_idx;
+  run->is_thread_local_ = false;
+  run->in_non_full_list_ = false;
+  run->prev_ = NULL;
+  run->next_ = NULL;
+  const size_t num_slots = NumSlotsOfRun(bracket_idx);
+  for (size_t i = 0; i < kBitMapWords; ++i) {
+    // Mark the bits which don't correspond to a slot as allocated.
+    const size_t first_slot = i * 32;
+    uint32_t word = 0;
+    if (first_slot >= num_slots) {
+      word = ~0U;
+    } else if (num_slots - first_slot < 32) {
+      word = ~((1U << (num_slots - first_slot)) - 1);
+    }
+    run->alloc_bit_map_[i] = static_cast<int32_t>(word);
+  }
+  return run;
+}
+
+void RosAllocSpace::FreeRun(Thread* self, Run* run) {
+  DCHECK(!run->in_non_full_list_);
+  DCHECK(!run->is_thread_local_);
+  const size_t num_pages = NumPagesOfRun(run->bracket_idx_);
+  run->magic_ = 0;
+  MutexLock mu(self, lock_);
+  const size_t page_idx = (reinterpret_cast<byte*>(run) - Begin()) / kPageSize;
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_map_[page_idx + i] = kPageMapNone;
+  }
+  --num_runs_;
+  mspace_free(mspace_, run);
+}
+
+void RosAllocSpace::AddToNonFullRunsLocked(Run* run) {
+  DCHECK(!run->in_non_full_list_);
+  Run*& head = non_full_runs_[run->bracket_idx_];
+  run->prev_ = NULL;
+  run->next_ = head;
+  if (head != NULL) {
+    head->prev_ = run;
+  }
+  head = run;
+  run->in_non_full_list_ = true;
+}
+
+void RosAllocSpace::RemoveFromNonFullRunsLocked(Run* run) {
+  DCHECK(run->in_non_full_list_);
+  if (run->prev_ != NULL) {
+    run->prev_->next_ = run->next_;
+  } else {
+    DCHECK_EQ(non_full_runs_[run->bracket_idx_], run);
+    non_full_runs_[run->bracket_idx_] = run->next_;
+  }
+  if (run->next_ != NULL) {
+    run->next_->prev_ = run->prev_;
+  }
+  run->prev_ = NULL;
+  run->next_ = NULL;
+  run->in_non_full_list_ = false;
+}
+
+RosAllocSpace::Run* RosAllocSpace::ObtainRunLocked(Thread* self, size_t bracket_idx, bool grow) {
+  Run* run = non_full_runs_[bracket_idx];
+  if (run != NULL) {
+    RemoveFromNonFullRunsLocked(run);
+    return run;
+  }
+  return AllocRun(self, bracket_idx, grow);
+}
+
+void RosAllocSpace::RecycleRunLocked(Thread* self, Run* run) {
+  if (run->is_thread_local_ || run == current_runs_[run->bracket_idx_]) {
+    // Still being allocated from, re-examined when it is given up.
+    return;
+  }
+  if (IsRunEmpty(run)) {
+    if (run->in_non_full_list_) {
+      RemoveFromNonFullRunsLocked(run);
+    }
+    FreeRun(self, run);
+  } else if (!run->in_non_full_list_ && !IsRunFull(run)) {
+    AddToNonFullRunsLocked(run);
+  }
+}
+
+byte* RosAllocSpace::AllocFromThreadLocalRun(Thread* self, size_t bracket_idx, bool grow) {
+  if (UNLIKELY(self->GetTlabSpace() != this)) {
+    // The runs belong to a different space, for example the space we were allocating into
+    // before the zygote fork.
+    if (self->GetTlabSpace() != NULL) {
+      self->GetTlabSpace()->RevokeThreadLocalBuffers(self);
+    }
+    self->SetTlabSpace(this);
+  }
+  Run* run = reinterpret_cast<Run*>(self->GetRosAllocRun(bracket_idx));
+  if (LIKELY(run != NULL)) {
+    byte* slot = AllocSlot(run);
+    if (LIKELY(slot != NULL)) {
+      return slot;
+    }
+  }
+  // The run is full, hand it back to the bracket and take another one.
+  MutexLock mu(self, *bracket_locks_[bracket_idx]);
+  if (run != NULL) {
+    run->is_thread_local_ = false;
+    RecycleRunLocked(self, run);
+  }
+  run = ObtainRunLocked(self, bracket_idx, grow);
+  if (run == NULL) {
+    self->SetRosAllocRun(bracket_idx, NULL);
+    return NULL;
+  }
+  run->is_thread_local_ = true;
+  self->SetRosAllocRun(bracket_idx, run);
+  byte* slot = AllocSlot(run);
+  DCHECK(slot != NULL);
+  return slot;
+}
+
+byte* RosAllocSpace::AllocFromCurrentRunLocked(Thread* self, size_t bracket_idx, bool grow) {
+  Run* run = current_runs_[bracket_idx];
+  if (LIKELY(run != NULL)) {
+    byte* slot = AllocSlot(run);
+    if (LIKELY(slot != NULL)) {
+      return slot;
+    }
+    // The full run is owned by no list, frees put it back onto the non-full list.
+    current_runs_[bracket_idx] = NULL;
+    RecycleRunLocked(self, run);
+  }
+  run = ObtainRunLocked(self, bracket_idx, grow);
+  if (run == NULL) {
+    return NULL;
+  }
+  current_runs_[bracket_idx] = run;
+  byte* slot = AllocSlot(run);
+  DCHECK(slot != NULL);
+  return slot;
+}
+
+mirror::Object* RosAllocSpace::AllocNonvirtual(Thread* self, size_t num_bytes,
+                                               size_t* bytes_allocated) {
+  return AllocInternal(self, num_bytes, bytes_allocated, false);
+}
+
+mirror::Object* RosAllocSpace::AllocInternal(Thread* self, size_t num_bytes,
+                                             size_t* bytes_allocated, bool grow) {
+  if (UNLIKELY(num_bytes > kMaxBracketSize)) {
+    return grow ? DlMallocSpace::AllocWithGrowth(self, num_bytes, bytes_allocated)
+                : DlMallocSpace::AllocNonvirtual(self, num_bytes, bytes_allocated);
+  }
+  DCHECK_GT(num_bytes, 0U);
+  const size_t bracket_idx = BracketIndex(num_bytes);
+  byte* slot;
+  if (bracket_idx < kNumThreadLocalBrackets) {
+    slot = AllocFromThreadLocalRun(self, bracket_idx, grow);
+  } else {
+    MutexLock mu(self, *bracket_locks_[bracket_idx]);
+    slot = AllocFromCurrentRunLocked(self, bracket_idx, grow);
+  }
+  if (UNLIKELY(slot == NULL)) {
+    // There was no room for a whole run, a plain chunk may still fit.
+    return grow ? DlMallocSpace::AllocWithGrowth(self, num_bytes, bytes_allocated)
+                : DlMallocSpace::AllocNonvirtual(self, num_bytes, bytes_allocated);
+  }
+  DCHECK(bytes_allocated != NULL);
+  *bytes_allocated = BracketSize(bracket_idx);
+  // Slots are recycled without being cleared.
+  memset(slot, 0, num_bytes);
+  return reinterpret_cast<mirror::Object*>(slot);
+}
+
+mirror::Object* RosAllocSpace::Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated) {
+  return AllocNonvirtual(self, num_bytes, bytes_allocated);
+}
+
+mirror::Object* RosAllocSpace::AllocWithGrowth(Thread* self, size_t num_bytes,
+                                               size_t* bytes_allocated) {
+  mirror::Object* result = AllocInternal(self, num_bytes, bytes_allocated, true);
+  CHECK(!kDebugSpaces || result == NULL || Contains(result));
+  return result;
+}
+
+size_t RosAllocSpace::AllocationSize(const mirror::Object* obj) {
+  Run* run = RunOf(obj);
+  if (run == NULL) {
+    return DlMallocSpace::AllocationSize(obj);
+  }
+  return BracketSize(run->bracket_idx_);
+}
+
+size_t RosAllocSpace::Free(Thread* self, mirror::Object* ptr) {
+  if (kDebugSpaces) {
+    CHECK(ptr != NULL);
+    CHECK(Contains(ptr)) << "Free (" << ptr << ") not in bounds of heap " << *this;
+  }
+  Run* run = RunOf(ptr);
+  if (run == NULL) {
+    return DlMallocSpace::Free(self, ptr);
+  }
+  size_t bytes_freed;
+  {
+    // Hold the bracket lock so the run can't be given back to the mspace by another thread once
+    // its last slot is released.
+    MutexLock mu(self, *bracket_locks_[run->bracket_idx_]);
+    bytes_freed = FreeSlot(run, ptr);
+    RecycleRunLocked(self, run);
+  }
+  MutexLock mu(self, lock_);
+  total_run_bytes_freed_ += bytes_freed;
+  ++total_run_objects_freed_;
+  return bytes_freed;
+}
+
+size_t RosAllocSpace::FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) {
+  DCHECK(ptrs != NULL);
+  size_t run_bytes_freed = 0;
+  size_t run_objects_freed = 0;
+  // Pointers into the mspace are compacted to the front of ptrs and freed in bulk.
+  size_t num_mspace_ptrs = 0;
+  size_t i = 0;
+  while (i < num_ptrs) {
+    Run* run = RunOf(ptrs[i]);
+    if (run == NULL) {
+      ptrs[num_mspace_ptrs++] = ptrs[i++];
+      continue;
+    }
+    // The sweep visits objects in address order, so free all the slots of a run in one go.
+    MutexLock mu(self, *bracket_locks_[run->bracket_idx_]);
+    do {
+      run_bytes_freed += FreeSlot(run, ptrs[i++]);
+      ++run_objects_freed;
+    } while (i < num_ptrs && RunOf(ptrs[i]) == run);
+    RecycleRunLocked(self, run);
+  }
+  if (run_objects_freed != 0) {
+    MutexLock mu(self, lock_);
+    total_run_bytes_freed_ += run_bytes_freed;
+    total_run_objects_freed_ += run_objects_freed;
+  }
+  if (num_mspace_ptrs != 0) {
+    run_bytes_freed += DlMallocSpace::FreeList(self, num_mspace_ptrs, ptrs);
+  }
+  return run_bytes_freed;
+}
+
+size_t RosAllocSpace::RevokeThreadLocalBuffers(Thread* thread) {
+  DCHECK_EQ(thread->GetTlabSpace(), this);
+  Thread* self = Thread::Current();
+  for (size_t i = 0; i < kNumThreadLocalBrackets; ++i) {
+    Run* run = reinterpret_cast<Run*>(thread->GetRosAllocRun(i));
+    if (run != NULL) {
+      MutexLock mu(self, *bracket_locks_[i]);
+      run->is_thread_local_ = false;
+      RecycleRunLocked(self, run);
+      // A full run isn't on any list, it is picked up again once slots are freed.
+      thread->SetRosAllocRun(i, NULL);
+    }
+  }
+  thread->SetTlabSpace(NULL);
+  return 0;
+}
+
+uint64_t RosAllocSpace::GetBytesAllocated() const {
+  RosAllocSpace* space = const_cast<RosAllocSpace*>(this);
+  uint64_t bytes = DlMallocSpace::GetBytesAllocated();
+  MutexLock mu(Thread::Current(), space->lock_);
+  for (size_t i = 0; i < page_map_.size(); ++i) {
+    if (page_map_[i] == kPageMapRun) {
+      const Run* run = reinterpret_cast<const Run*>(Begin() + i * kPageSize);
+      bytes += NumAllocatedSlots(run) * BracketSize(run->bracket_idx_);
+    }
+  }
+  return bytes;
+}
+
+uint64_t RosAllocSpace::GetObjectsAllocated() const {
+  RosAllocSpace* space = const_cast<RosAllocSpace*>(this);
+  uint64_t objects = DlMallocSpace::GetObjectsAllocated();
+  MutexLock mu(Thread::Current(), space->lock_);
+  for (size_t i = 0; i < page_map_.size(); ++i) {
+    if (page_map_[i] == kPageMapRun) {
+      objects += NumAllocatedSlots(reinterpret_cast<const Run*>(Begin() + i * kPageSize));
+    }
+  }
+  return objects;
+}
+
+uint64_t RosAllocSpace::GetTotalBytesAllocated() const {
+  const uint64_t mspace_bytes = DlMallocSpace::GetTotalBytesAllocated();
+  const uint64_t run_bytes = GetBytesAllocated() - DlMallocSpace::GetBytesAllocated();
+  MutexLock mu(Thread::Current(), const_cast<RosAllocSpace*>(this)->lock_);
+  return mspace_bytes + run_bytes + total_run_bytes_freed_;
+}
+
+uint64_t RosAllocSpace::GetTotalObjectsAllocated() const {
+  const uint64_t mspace_objects = DlMallocSpace::GetTotalObjectsAllocated();
+  const uint64_t run_objects = GetObjectsAllocated() - DlMallocSpace::GetObjectsAllocated();
+  MutexLock mu(Thread::Current(), const_cast<RosAllocSpace*>(this)->lock_);
+  return mspace_objects + run_objects + total_run_objects_freed_;
+}
+
+size_t RosAllocSpace::GetNumRuns() const {
+  MutexLock mu(Thread::Current(), const_cast<RosAllocSpace*>(this)->lock_);
+  return num_runs_;
+}
+
+}  // namespace space
+}  // namespace gc
+}  // namespace art
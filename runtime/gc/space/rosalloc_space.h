@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_SPACE_ROSALLOC_SPACE_H_
+#define ART_RUNTIME_GC_SPACE_ROSALLOC_SPACE_H_
+
+#include <vector>
+
+#include "base/mutex.h"
+#include "dlmalloc_space.h"
+#include "thread.h"
+
+namespace art {
+namespace gc {
+namespace space {
+
+// An alloc space which serves small objects out of runs of slots (a "runs of slots" allocator).
+// A run is a page aligned block carved out of the mspace that holds equally sized slots of one
+// size bracket, plus a bitmap of the slots in use. Slots are claimed and released with atomic
+// bitmap operations, so allocating only takes the lock of the object's size bracket and, for the
+// smallest brackets, each thread owns a run and takes no lock at all. Objects larger than the
+// biggest bracket are allocated from the mspace as in DlMallocSpace.
+class RosAllocSpace : public DlMallocSpace {
+ public:
+  // Size brackets are multiples of kBracketQuantum up to and including kMaxBracketSize.
+  static constexpr size_t kBracketQuantum = 16;
+  static constexpr size_t kMaxBracketSize = 512;
+  static constexpr size_t kNumBrackets = kMaxBracketSize / kBracketQuantum;
+  // The smallest brackets are served from runs owned by the allocating thread.
+  static constexpr size_t kNumThreadLocalBrackets = Thread::kRosAllocThreadLocalBracketCount;
+  static constexpr size_t kMaxSlotsPerRun = 256;
+
+  virtual mirror::Object* AllocWithGrowth(Thread* self, size_t num_bytes,
+                                          size_t* bytes_allocated) LOCKS_EXCLUDED(lock_);
+  virtual mirror::Object* Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated);
+  virtual size_t AllocationSize(const mirror::Object* obj);
+  virtual size_t Free(Thread* self, mirror::Object* ptr);
+  virtual size_t FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs);
+
+  mirror::Object* AllocNonvirtual(Thread* self, size_t num_bytes, size_t* bytes_allocated);
+
+  // Give the thread's runs back to their size brackets so other threads may allocate from them.
+  // The thread must either be the caller or suspended. Runs are not wasted so this returns 0.
+  virtual size_t RevokeThreadLocalBuffers(Thread* thread);
+
+  // The current counts are recomputed from the run bitmaps, this is slow.
+  virtual uint64_t GetBytesAllocated() const;
+  virtual uint64_t GetObjectsAllocated() const;
+  virtual uint64_t GetTotalBytesAllocated() const;
+  virtual uint64_t GetTotalObjectsAllocated() const;
+
+  // Number of runs currently carved out of the mspace.
+  size_t GetNumRuns() const;
+
+  static size_t BracketSize(size_t bracket_idx) {
+    return (bracket_idx + 1) * kBracketQuantum;
+  }
+
+  virtual ~RosAllocSpace();
+
+ protected:
+  virtual DlMallocSpace* CreateInstance(const std::string& name, MemMap* mem_map, void* mspace,
+                                        byte* begin, byte* end, size_t growth_limit);
+
+ private:
+  // Header at the start of the first page of every run, followed by the slots.
+  struct Run {
+    uint8_t magic_;
+    uint8_t bracket_idx_;
+    // Set while a thread owns the run, only the owner allocates from it.
+    bool is_thread_local_;
+    // Set while the run is linked into the non-full list of its bracket.
+    bool in_non_full_list_;
+    Run* prev_;
+    Run* next_;
+    // One bit per slot, set when the slot is allocated. Bits past the last slot are always set.
+    volatile int32_t alloc_bit_map_[kMaxSlotsPerRun / 32];
+  };
+
+  enum PageMapKind {
+    kPageMapNone = 0,    // Not part of a run, either free or part of an mspace allocation.
+    kPageMapRun,         // First page of a run.
+    kPageMapRunPart,     // Subsequent page of a run.
+  };
+
+  RosAllocSpace(const std::string& name, MemMap* mem_map, void* mspace, byte* begin, byte* end,
+                size_t growth_limit);
+
+  static size_t BracketIndex(size_t num_bytes) {
+    return (num_bytes - 1) / kBracketQuantum;
+  }
+  static size_t NumPagesOfRun(size_t bracket_idx);
+  static size_t NumSlotsOfRun(size_t bracket_idx);
+  static size_t RunHeaderSize();
+
+  // Returns the run containing ptr or NULL if ptr was allocated from the mspace.
+  Run* RunOf(const void* ptr) const;
+  // Claim a free slot of the run, returns NULL if the run is full.
+  static byte* AllocSlot(Run* run);
+  // Release the slot and return its size.
+  static size_t FreeSlot(Run* run, const void* ptr);
+  static bool IsRunFull(const Run* run);
+  static bool IsRunEmpty(const Run* run);
+  static size_t NumAllocatedSlots(const Run* run);
+
+  // When grow is set, runs and chunks may be carved out past the footprint limit, up to the
+  // capacity of the space.
+  mirror::Object* AllocInternal(Thread* self, size_t num_bytes, size_t* bytes_allocated,
+                                bool grow);
+  byte* AllocFromThreadLocalRun(Thread* self, size_t bracket_idx, bool grow);
+  byte* AllocFromCurrentRunLocked(Thread* self, size_t bracket_idx, bool grow);
+
+  // Find a run with free slots for the bracket: a non-full one or a fresh one from the mspace.
+  Run* ObtainRunLocked(Thread* self, size_t bracket_idx, bool grow);
+  Run* AllocRun(Thread* self, size_t bracket_idx, bool grow) LOCKS_EXCLUDED(lock_);
+  void FreeRun(Thread* self, Run* run) LOCKS_EXCLUDED(lock_);
+  void AddToNonFullRunsLocked(Run* run);
+  void RemoveFromNonFullRunsLocked(Run* run);
+
+  // A run which has lost its owner or had slots freed goes back to its bracket's non-full list,
+  // empty runs are given back to the mspace. Requires the lock of the run's bracket.
+  void RecycleRunLocked(Thread* self, Run* run);
+
+  // Guards current_runs_ and non_full_runs_ of a bracket.
+  Mutex* bracket_locks_[kNumBrackets];
+  // The run shared threads allocate from for brackets which aren't thread-local.
+  Run* current_runs_[kNumBrackets];
+  // Doubly linked lists of runs with free slots which are neither current nor thread-local.
+  Run* non_full_runs_[kNumBrackets];
+
+  // One PageMapKind per page of the space, written with lock_ held. A page of a run which has an
+  // allocated slot can't change kind so lookups of live objects need no lock.
+  std::vector<uint8_t> page_map_;
+  size_t num_runs_ GUARDED_BY(lock_);
+  uint64_t total_run_bytes_freed_ GUARDED_BY(lock_);
+  uint64_t total_run_objects_freed_ GUARDED_BY(lock_);
+
+  friend class DlMallocSpace;
+
+  DISALLOW_COPY_AND_ASSIGN(RosAllocSpace);
+};
+
+}  // namespace space
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_SPACE_ROSALLOC_SPACE_H_
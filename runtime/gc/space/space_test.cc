@@ -15,13 +15,16 @@
  */
 
 #include "dlmalloc_space.h"
+#include "dlmalloc_space-inl.h"
 #include "large_object_space.h"
+#include "rosalloc_space.h"
 
 #include "common_test.h"
 #include "globals.h"
 #include "UniquePtr.h"
 
 #include <stdint.h>
+#include <valgrind.h>
 
 namespace art {
 namespace gc {
@@ -204,15 +207,128 @@ TEST_F(SpaceTest, AllocAndFree) {
   EXPECT_LE(1U * MB, free1);
 }
 
+TEST_F(SpaceTest, AllocThreadLocal) {
+  DlMallocSpace* space(DlMallocSpace::Create("test", 4 * MB, 16 * MB, 16 * MB, NULL));
+  ASSERT_TRUE(space != NULL);
+  Thread* self = Thread::Current();
+
+  // Make space findable to the heap, will also delete space when runtime is cleaned up
+  AddContinuousSpace(space);
+
+  // Too large for a thread-local allocation buffer.
+  size_t bytes_allocated = 0;
+  EXPECT_TRUE(space->AllocThreadLocal(self, DlMallocSpace::kMaxThreadLocalAllocSize + 1,
+                                      &bytes_allocated) == NULL);
+
+  // The first allocation refills the buffer, the rest of the batch is served without the lock.
+  const uint64_t refills_before = space->GetTotalThreadLocalRefills();
+  const uint64_t bytes_before = space->GetBytesAllocated();
+  std::vector<mirror::Object*> objects;
+  for (size_t i = 0; i < 8; ++i) {
+    mirror::Object* obj = space->AllocThreadLocal(self, 24, &bytes_allocated);
+    ASSERT_TRUE(obj != NULL);
+    EXPECT_TRUE(space->Contains(obj));
+    EXPECT_EQ(bytes_allocated, space->AllocationSize(obj));
+    EXPECT_GE(bytes_allocated, 24U);
+    for (size_t j = 0; j < 24; ++j) {
+      EXPECT_EQ(0, reinterpret_cast<const byte*>(obj)[j]);
+    }
+    objects.push_back(obj);
+  }
+  EXPECT_EQ(refills_before + 1, space->GetTotalThreadLocalRefills());
+  EXPECT_EQ(space, self->GetTlabSpace());
+
+  // Revoking hands the unused chunks back, leaving only the objects we allocated.
+  size_t objects_bytes = 0;
+  for (mirror::Object* obj : objects) {
+    objects_bytes += space->AllocationSize(obj);
+  }
+  EXPECT_LT(0U, space->RevokeThreadLocalBuffers(self));
+  EXPECT_TRUE(self->GetTlabSpace() == NULL);
+  EXPECT_EQ(bytes_before + objects_bytes, space->GetBytesAllocated());
+
+  // Final clean up.
+  EXPECT_EQ(objects_bytes, space->FreeList(self, objects.size(), &objects[0]));
+  EXPECT_EQ(bytes_before, space->GetBytesAllocated());
+}
+
+TEST_F(SpaceTest, RosAlloc) {
+  DlMallocSpace* space(DlMallocSpace::Create("test", 4 * MB, 16 * MB, 16 * MB, NULL, true));
+  ASSERT_TRUE(space != NULL);
+  Thread* self = Thread::Current();
+
+  // Make space findable to the heap, will also delete space when runtime is cleaned up
+  AddContinuousSpace(space);
+  if (RUNNING_ON_VALGRIND) {
+    // Valgrind always gets a plain DlMallocSpace.
+    return;
+  }
+  RosAllocSpace* rosalloc_space = down_cast<RosAllocSpace*>(space);
+  EXPECT_EQ(0U, rosalloc_space->GetNumRuns());
+
+  // Sizes served from thread-local runs, shared runs and the mspace.
+  static const size_t kSizes[] = { 8, 24, 128, 200, 512, 513, 4 * KB };
+  const uint64_t bytes_before = space->GetBytesAllocated();
+  const uint64_t objects_before = space->GetObjectsAllocated();
+  std::vector<mirror::Object*> objects;
+  size_t objects_bytes = 0;
+  for (size_t round = 0; round < 300; ++round) {
+    for (size_t size : kSizes) {
+      size_t bytes_allocated = 0;
+      mirror::Object* obj = space->Alloc(self, size, &bytes_allocated);
+      ASSERT_TRUE(obj != NULL);
+      EXPECT_TRUE(space->Contains(obj));
+      EXPECT_TRUE(IsAligned<kObjectAlignment>(obj));
+      EXPECT_EQ(bytes_allocated, space->AllocationSize(obj));
+      if (size <= RosAllocSpace::kMaxBracketSize) {
+        EXPECT_EQ(RoundUp(size, RosAllocSpace::kBracketQuantum), bytes_allocated);
+      }
+      for (size_t j = 0; j < size; ++j) {
+        EXPECT_EQ(0, reinterpret_cast<const byte*>(obj)[j]);
+      }
+      memset(obj, 0xAB, size);
+      objects_bytes += bytes_allocated;
+      objects.push_back(obj);
+    }
+  }
+  EXPECT_EQ(space, self->GetTlabSpace());
+  EXPECT_LT(0U, rosalloc_space->GetNumRuns());
+  EXPECT_EQ(bytes_before + objects_bytes, space->GetBytesAllocated());
+  EXPECT_EQ(objects_before + objects.size(), space->GetObjectsAllocated());
+
+  // Freeing everything gives back all runs except the thread-local and current ones.
+  const size_t num_objects = objects.size();
+  EXPECT_EQ(objects_bytes, space->FreeList(self, num_objects, &objects[0]));
+  EXPECT_EQ(bytes_before, space->GetBytesAllocated());
+  EXPECT_EQ(objects_before, space->GetObjectsAllocated());
+  EXPECT_EQ(0U, space->RevokeThreadLocalBuffers(self));
+  EXPECT_TRUE(self->GetTlabSpace() == NULL);
+  // Only the current runs of the 200 and 512 byte brackets are left.
+  EXPECT_EQ(2U, rosalloc_space->GetNumRuns());
+
+  // Freed slots are reused.
+  size_t bytes_allocated = 0;
+  mirror::Object* obj = space->Alloc(self, 200, &bytes_allocated);
+  ASSERT_TRUE(obj != NULL);
+  EXPECT_EQ(2U, rosalloc_space->GetNumRuns());
+  EXPECT_EQ(bytes_allocated, space->Free(self, obj));
+}
+
+static LargeObjectSpace* CreateLargeObjectSpace(size_t type) {
+  switch (type) {
+    case 0:
+      return space::LargeObjectMapSpace::Create("large object space");
+    case 1:
+      return space::FreeListSpace::Create("large object space", NULL, 128 * MB);
+    default:
+      return space::SegregatedFreeListSpace::Create("large object space", NULL, 128 * MB);
+  }
+}
+
 TEST_F(SpaceTest, LargeObjectTest) {
   size_t rand_seed = 0;
-  for (size_t i = 0; i < 2; ++i) {
-    LargeObjectSpace* los = NULL;
-    if (i == 0) {
-      los = space::LargeObjectMapSpace::Create("large object space");
-    } else {
-      los = space::FreeListSpace::Create("large object space", NULL, 128 * MB);
-    }
+  for (size_t i = 0; i < 3; ++i) {
+    LargeObjectSpace* los = CreateLargeObjectSpace(i);
 
     static const size_t num_allocations = 64;
     static const size_t max_allocation_size = 0x100000;
@@ -265,6 +381,92 @@ TEST_F(SpaceTest, LargeObjectTest) {
   }
 }
 
+TEST_F(SpaceTest, LargeObjectReuse) {
+  Thread* self = Thread::Current();
+  UniquePtr<SegregatedFreeListSpace> los(
+      SegregatedFreeListSpace::Create("large object space", NULL, 64 * MB));
+  ASSERT_TRUE(los.get() != NULL);
+
+  // A freed run is reused as is for the next allocation of its size, and cleared first.
+  size_t bytes_allocated = 0;
+  mirror::Object* obj = los->Alloc(self, 64 * KB, &bytes_allocated);
+  ASSERT_TRUE(obj != NULL);
+  EXPECT_EQ(64 * KB, bytes_allocated);
+  memset(obj, 0xAB, 64 * KB);
+  mirror::Object* neighbour = los->Alloc(self, 100 * KB, &bytes_allocated);
+  ASSERT_TRUE(neighbour != NULL);
+  EXPECT_EQ(los->Free(self, obj), 64 * KB);
+  EXPECT_EQ(64 * KB, los->GetDirtyBytes());
+  mirror::Object* reused = los->Alloc(self, 64 * KB - 8, &bytes_allocated);
+  EXPECT_EQ(obj, reused);
+  EXPECT_EQ(0U, los->GetDirtyBytes());
+  for (size_t i = 0; i < 64 * KB; ++i) {
+    ASSERT_EQ(0, reinterpret_cast<const byte*>(reused)[i]);
+  }
+
+  los->Free(self, reused);
+  EXPECT_EQ(64 * KB, los->GetDirtyBytes());
+  los->ReleaseDirtyRuns(self);
+  EXPECT_EQ(0U, los->GetDirtyBytes());
+  los->Free(self, neighbour);
+  EXPECT_EQ(0U, los->GetDirtyBytes());  // Coalesced with the rest of the space.
+
+  // Freed runs coalesce and are given back once there are too many of them.
+  std::vector<mirror::Object*> objects;
+  for (size_t i = 0; i < 8; ++i) {
+    objects.push_back(los->Alloc(self, 2 * MB, &bytes_allocated));
+    ASSERT_TRUE(objects.back() != NULL);
+  }
+  los->Free(self, objects[0]);
+  los->Free(self, objects[2]);
+  EXPECT_EQ(4 * MB, los->GetDirtyBytes());
+  los->Free(self, objects[1]);
+  EXPECT_EQ(6 * MB, los->GetDirtyBytes());
+  los->Free(self, objects[4]);
+  EXPECT_EQ(8 * MB, los->GetDirtyBytes());
+  los->Free(self, objects[6]);
+  EXPECT_EQ(0U, los->GetDirtyBytes());
+  for (size_t i = 3; i < objects.size(); i += 2) {
+    los->Free(self, objects[i]);
+  }
+  EXPECT_EQ(0U, los->GetObjectsAllocated());
+  EXPECT_EQ(0U, los->GetDirtyBytes());
+}
+
+// Compares the large object spaces on a churn of arrays between 64KB and 4MB.
+TEST_F(SpaceTest, LargeObjectChurn) {
+  Thread* self = Thread::Current();
+  for (size_t i = 0; i < 3; ++i) {
+    UniquePtr<LargeObjectSpace> los(CreateLargeObjectSpace(i));
+    ASSERT_TRUE(los.get() != NULL);
+    size_t rand_seed = 0;
+    std::vector<mirror::Object*> objects(16, NULL);
+    uint64_t start_ns = NanoTime();
+    for (size_t j = 0; j < 2000; ++j) {
+      mirror::Object*& obj = objects[test_rand(&rand_seed) % objects.size()];
+      if (obj != NULL) {
+        los->Free(self, obj);
+      }
+      size_t request_size = 64 * KB << (test_rand(&rand_seed) % 7);
+      size_t bytes_allocated = 0;
+      obj = los->Alloc(self, request_size, &bytes_allocated);
+      ASSERT_TRUE(obj != NULL);
+      // Touch every page like an array being filled in.
+      for (size_t k = 0; k < request_size; k += kPageSize) {
+        reinterpret_cast<byte*>(obj)[k] = 1;
+      }
+    }
+    for (mirror::Object* obj : objects) {
+      if (obj != NULL) {
+        los->Free(self, obj);
+      }
+    }
+    LOG(INFO) << "Large object space " << i << " churn: "
+              << PrettyDuration(NanoTime() - start_ns);
+    EXPECT_EQ(0U, los->GetObjectsAllocated());
+  }
+}
+
 TEST_F(SpaceTest, AllocAndFreeList) {
   DlMallocSpace* space(DlMallocSpace::Create("test", 4 * MB, 16 * MB, 16 * MB, NULL));
   ASSERT_TRUE(space != NULL);
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string_deduplicator.h"
+
+#include <string.h>
+
+#include "gc/space/space.h"
+#include "mirror/array-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "mirror/string.h"
+
+namespace art {
+namespace gc {
+
+bool StringDeduplicator::CanShareArray(const mirror::String* string) {
+  const mirror::CharArray* array = string->GetCharArray();
+  return string->GetField32(mirror::String::HashCodeOffset(), false) != 0 && array != NULL &&
+      string->GetOffset() == 0 && string->GetLength() == array->GetLength();
+}
+
+void StringDeduplicator::operator()(const mirror::Object* o) const {
+  if (!o->GetClass()->IsStringClass()) {
+    return;
+  }
+  mirror::String* string = const_cast<mirror::Object*>(o)->AsString();
+  if (CanShareArray(string)) {
+    Deduplicate(string);
+  }
+}
+
+void StringDeduplicator::Deduplicate(mirror::String* string) const {
+  int32_t hash_code = string->GetField32(mirror::String::HashCodeOffset(), false);
+  mirror::CharArray* array = const_cast<mirror::CharArray*>(string->GetCharArray());
+  typedef std::multimap<int32_t, mirror::CharArray*>::const_iterator It;
+  std::pair<It, It> range = arrays_.equal_range(hash_code);
+  for (It it = range.first; it != range.second; ++it) {
+    mirror::CharArray* other = it->second;
+    if (other == array) {
+      return;
+    }
+    if (other->GetLength() == array->GetLength() &&
+        memcmp(other->GetData(), array->GetData(), array->GetLength() * sizeof(uint16_t)) == 0) {
+      if (space_->Contains(string)) {
+        string->ShareArray(other);
+        ++num_deduplicated_;
+        deduplicated_bytes_ += array->SizeOf();
+      }
+      return;
+    }
+  }
+  arrays_.insert(std::make_pair(hash_code, array));
+}
+
+}  // namespace gc
+}  // namespace art
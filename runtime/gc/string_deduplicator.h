@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_STRING_DEDUPLICATOR_H_
+#define ART_RUNTIME_GC_STRING_DEDUPLICATOR_H_
+
+#include <stdint.h>
+
+#include <map>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+namespace mirror {
+class Object;
+template<class T> class PrimitiveArray;
+typedef PrimitiveArray<uint16_t> CharArray;
+class String;
+}  // namespace mirror
+
+namespace gc {
+
+namespace space {
+class ContinuousSpace;
+}  // namespace space
+
+// Remembers the first string seen with each contents and points the others of space at its char
+// array, for a later collection to free the arrays they leave. Strings are matched by the hash
+// codes String.hashCode computed, with ComputeUtf16Hash, and then by their chars.
+//
+// An instance isn't thread safe, the collector gives each of its workers the strings of a range of
+// hash codes so that equal strings meet in the same instance.
+class StringDeduplicator {
+ public:
+  explicit StringDeduplicator(space::ContinuousSpace* space)
+      : space_(space), num_deduplicated_(0), deduplicated_bytes_(0) {
+  }
+
+  // Whether string is complete and uses the whole of its array. A string constructor may still be
+  // filling in the chars of an array it already stored, but a string whose hash code has been
+  // computed is complete. Strings using part of a larger array are left alone, so only the array
+  // changes and code that loaded it before still finds the chars at the offset it loaded.
+  static bool CanShareArray(const mirror::String* string)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Visits the strings among the objects of a bitmap walk.
+  void operator()(const mirror::Object* o) const NO_THREAD_SAFETY_ANALYSIS;
+
+  // Requires CanShareArray(string).
+  void Deduplicate(mirror::String* string) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  size_t GetNumDeduplicated() const {
+    return num_deduplicated_;
+  }
+
+  // The size of the arrays the strings left, an upper bound of what they free since other strings
+  // may still use them.
+  size_t GetDeduplicatedBytes() const {
+    return deduplicated_bytes_;
+  }
+
+ private:
+  space::ContinuousSpace* const space_;
+  // The arrays of the strings seen so far, by hash code.
+  mutable std::multimap<int32_t, mirror::CharArray*> arrays_;
+  mutable size_t num_deduplicated_;
+  mutable size_t deduplicated_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringDeduplicator);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_STRING_DEDUPLICATOR_H_
@@ -24,7 +24,12 @@
 
 namespace art {
 
-// Lightweight wrapper for native PC offset to reference bit maps.
+// Lightweight wrapper for native PC offset to reference bit maps. The header holds the width of
+// the native offsets less one in bits 0-1, whether the bitmaps are in a dictionary in bit 2, the
+// width of the bitmaps in bits 3-15 and the number of entries in bits 16-31. The entries are
+// hashed by native offset into the table that follows. Without a dictionary each entry holds its
+// bitmap, with one the entry holds the index of its bitmap in the distinct bitmaps of the method,
+// whose count follows the header in 16 bits and which follow the table.
 class NativePcOffsetToReferenceMap {
  public:
   explicit NativePcOffsetToReferenceMap(const uint8_t* data) : data_(data) {
@@ -39,7 +44,15 @@ class NativePcOffsetToReferenceMap {
   // Return address of bitmap encoding what are live references.
   const uint8_t* GetBitMap(size_t index) const {
     size_t entry_offset = index * EntryWidth();
-    return &Table()[entry_offset + NativeOffsetWidth()];
+    if (!HasDictionary()) {
+      return &Table()[entry_offset + NativeOffsetWidth()];
+    }
+    const uint8_t* entry_index = &Table()[entry_offset + NativeOffsetWidth()];
+    size_t bitmap_index = entry_index[0];
+    if (DictionaryIndexWidth() == 2) {
+      bitmap_index |= entry_index[1] << 8;
+    }
+    return &Dictionary()[bitmap_index * RegWidth()];
   }
 
   // Get the native PC encoded in the table at the given index.
@@ -87,20 +100,52 @@ class NativePcOffsetToReferenceMap {
     return (static_cast<size_t>(data_[0]) | (static_cast<size_t>(data_[1]) << 8)) >> 3;
   }
 
+  // Whether the entries index a dictionary of the distinct bitmaps.
+  bool HasDictionary() const {
+    return (data_[0] & kDictionaryFlag) != 0;
+  }
+
+  // The number of distinct bitmaps in the dictionary, if there is one.
+  size_t NumDictionaryEntries() const {
+    DCHECK(HasDictionary());
+    return data_[4] | (data_[5] << 8);
+  }
+
+  // The size in bytes of the header, the table and the dictionary.
+  size_t EncodedSize() const {
+    size_t size = (Table() - data_) + NumEntries() * EntryWidth();
+    if (HasDictionary()) {
+      size += NumDictionaryEntries() * RegWidth();
+    }
+    return size;
+  }
+
+  static const uint8_t kNativeOffsetWidthMask = 3;
+  static const uint8_t kDictionaryFlag = 4;
+
  private:
   // Skip the size information at the beginning of data.
   const uint8_t* Table() const {
-    return data_ + 4;
+    return data_ + (HasDictionary() ? 6 : 4);
+  }
+
+  const uint8_t* Dictionary() const {
+    return Table() + NumEntries() * EntryWidth();
   }
 
   // Number of bytes used to encode a native offset.
   size_t NativeOffsetWidth() const {
-    return data_[0] & 7;
+    return (data_[0] & kNativeOffsetWidthMask) + 1;
+  }
+
+  // Number of bytes used to encode an index into the dictionary.
+  size_t DictionaryIndexWidth() const {
+    return NumDictionaryEntries() <= 256 ? 1 : 2;
   }
 
   // The width of an entry in the table.
   size_t EntryWidth() const {
-    return NativeOffsetWidth() + RegWidth();
+    return NativeOffsetWidth() + (HasDictionary() ? DictionaryIndexWidth() : RegWidth());
   }
 
   const uint8_t* const data_;  // The header and table data
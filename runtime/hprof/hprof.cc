@@ -15,11 +15,12 @@
  */
 
 /*
- * Preparation and completion of hprof data generation.  The output is
- * written into two files and then combined.  This is necessary because
- * we generate some of the data (strings and classes) while we dump the
- * heap, and some analysis tools require that the class and string data
- * appear first.
+ * Preparation and completion of hprof data generation.  The heap is
+ * walked twice.  This is necessary because we generate some of the data
+ * (strings and classes) while we dump the heap, and some analysis tools
+ * require that the class and string data appear first.  The first walk
+ * only collects the strings and classes, the second one streams the heap
+ * dump records to the output after them.
  */
 
 #include "hprof.h"
@@ -31,9 +32,11 @@
 #include <string.h>
 #include <sys/time.h>
 #include <sys/uio.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <time.h>
 #include <unistd.h>
+#include <zlib.h>
 
 #include <set>
 
@@ -177,6 +180,108 @@ typedef SafeMap<std::string, size_t> StringMap;
 typedef SafeMap<std::string, size_t>::iterator StringMapIterator;
 
 // Represents a top-level hprof record, whose serialized format is:
+// Size of the stdio buffer of the output file, the only buffering of a heap dump written to a file.
+static const size_t kOutputBufferSize = 64 * KB;
+
+// Where the records of a heap dump are written to.
+class HprofOutput {
+ public:
+  HprofOutput() : size_(0), ok_(true) {}
+
+  virtual ~HprofOutput() {}
+
+  void Write(const void* data, size_t size) {
+    size_ += size;
+    if (ok_ && size != 0) {
+      ok_ = DoWrite(data, size);
+    }
+  }
+
+  // Flushes and closes the output. Returns false if anything failed to be written.
+  virtual bool Finish() = 0;
+
+  bool IsOk() const {
+    return ok_;
+  }
+
+  uint64_t Size() const {
+    return size_;
+  }
+
+ protected:
+  virtual bool DoWrite(const void* data, size_t size) = 0;
+
+ private:
+  uint64_t size_;
+  bool ok_;
+};
+
+// Discards the records, used by the walk that collects the strings and classes.
+class HprofNullOutput : public HprofOutput {
+ public:
+  bool Finish() {
+    return true;
+  }
+
+ protected:
+  bool DoWrite(const void* data, size_t size) {
+    return true;
+  }
+};
+
+// Writes to a stdio stream, either the output file or an in-memory stream for DDMS.
+class HprofFileOutput : public HprofOutput {
+ public:
+  explicit HprofFileOutput(FILE* fp) : fp_(fp) {}
+
+  ~HprofFileOutput() {
+    if (fp_ != NULL) {
+      fclose(fp_);
+    }
+  }
+
+  bool Finish() {
+    bool ok = IsOk() && fflush(fp_) == 0 && !ferror(fp_);
+    ok = (fclose(fp_) == 0) && ok;
+    fp_ = NULL;
+    return ok;
+  }
+
+ protected:
+  bool DoWrite(const void* data, size_t size) {
+    return fwrite(data, 1, size, fp_) == size;
+  }
+
+ private:
+  FILE* fp_;
+};
+
+// Writes gzip compressed data, used when the name of the output file ends in ".gz".
+class HprofGzipOutput : public HprofOutput {
+ public:
+  explicit HprofGzipOutput(gzFile gz) : gz_(gz) {}
+
+  ~HprofGzipOutput() {
+    if (gz_ != NULL) {
+      gzclose(gz_);
+    }
+  }
+
+  bool Finish() {
+    bool ok = (gzclose(gz_) == Z_OK) && IsOk();
+    gz_ = NULL;
+    return ok;
+  }
+
+ protected:
+  bool DoWrite(const void* data, size_t size) {
+    return gzwrite(gz_, data, size) == static_cast<int>(size);
+  }
+
+ private:
+  gzFile gz_;
+};
+
 // U1  TAG: denoting the type of the record
 // U4  TIME: number of microseconds since the time stamp in the header
 // U4  LENGTH: number of bytes that follow this uint32_t field and belong to this record
@@ -187,20 +292,20 @@ class HprofRecord {
     dirty_ = false;
     alloc_length_ = 128;
     body_ = reinterpret_cast<unsigned char*>(malloc(alloc_length_));
-    fp_ = NULL;
+    out_ = NULL;
   }
 
   ~HprofRecord() {
     free(body_);
   }
 
-  int StartNewRecord(FILE* fp, uint8_t tag, uint32_t time) {
+  int StartNewRecord(HprofOutput* out, uint8_t tag, uint32_t time) {
     int rc = Flush();
     if (rc != 0) {
       return rc;
     }
 
-    fp_ = fp;
+    out_ = out;
     tag_ = tag;
     time_ = time;
     length_ = 0;
@@ -216,12 +321,9 @@ class HprofRecord {
       U4_TO_BUF_BE(headBuf, 1, time_);
       U4_TO_BUF_BE(headBuf, 5, length_);
 
-      int nb = fwrite(headBuf, 1, sizeof(headBuf), fp_);
-      if (nb != sizeof(headBuf)) {
-        return UNIQUE_ERROR;
-      }
-      nb = fwrite(body_, 1, length_, fp_);
-      if (nb != static_cast<int>(length_)) {
+      out_->Write(headBuf, sizeof(headBuf));
+      out_->Write(body_, length_);
+      if (!out_->IsOk()) {
         return UNIQUE_ERROR;
       }
 
@@ -355,7 +457,7 @@ class HprofRecord {
   size_t alloc_length_;
   unsigned char* body_;
 
-  FILE* fp_;
+  HprofOutput* out_;
   uint8_t tag_;
   uint32_t time_;
   size_t length_;
@@ -376,77 +478,38 @@ class Hprof {
         gc_scan_state_(0),
         current_heap_(HPROF_HEAP_DEFAULT),
         objects_in_segment_(0),
-        header_fp_(NULL),
-        header_data_ptr_(NULL),
-        header_data_size_(0),
-        body_fp_(NULL),
-        body_data_ptr_(NULL),
-        body_data_size_(0),
+        out_(NULL),
         next_string_id_(0x400000) {
     LOG(INFO) << "hprof: heap dump \"" << filename_ << "\" starting...";
-
-    header_fp_ = open_memstream(&header_data_ptr_, &header_data_size_);
-    if (header_fp_ == NULL) {
-      PLOG(FATAL) << "header open_memstream failed";
-    }
-
-    body_fp_ = open_memstream(&body_data_ptr_, &body_data_size_);
-    if (body_fp_ == NULL) {
-      PLOG(FATAL) << "body open_memstream failed";
-    }
-  }
-
-  ~Hprof() {
-    if (header_fp_ != NULL) {
-      fclose(header_fp_);
-    }
-    if (body_fp_ != NULL) {
-      fclose(body_fp_);
-    }
-    free(header_data_ptr_);
-    free(body_data_ptr_);
   }
 
   void Dump()
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
-    // Walk the roots and the heap.
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
-    Runtime::Current()->VisitRoots(RootVisitor, this, false, false);
-    Thread* self = Thread::Current();
     {
-      WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+      WriterMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
       Runtime::Current()->GetHeap()->FlushAllocStack();
     }
-    {
-      ReaderMutexLock mu(self, *Locks::heap_bitmap_lock_);
-      Runtime::Current()->GetHeap()->GetLiveBitmap()->Walk(HeapBitmapCallback, this);
-    }
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_END, HPROF_TIME);
-    current_record_.Flush();
-    fflush(body_fp_);
-
-    // Write the header.
-    WriteFixedHeader();
-    // Write the string and class tables, and any stack traces, to the header.
-    // (jhat requires that these appear before any of the data in the body that refers to them.)
-    WriteStringTable();
-    WriteClassTable();
-    WriteStackTraces();
-    current_record_.Flush();
-    fflush(header_fp_);
 
-    bool okay = true;
+    // Collect the strings and classes the heap dump refers to.
+    HprofNullOutput null_output;
+    out_ = &null_output;
+    WriteHeapDump();
+    const size_t num_strings = strings_.size();
+    const size_t num_classes = classes_.size();
+
+    // Where exactly are we writing to? Only DDMS needs the whole dump in memory, it is sent as a
+    // single chunk.
+    UniquePtr<HprofOutput> output;
+    char* ddms_data = NULL;
+    size_t ddms_data_size = 0;
     if (direct_to_ddms_) {
-      // Send the data off to DDMS.
-      iovec iov[2];
-      iov[0].iov_base = header_data_ptr_;
-      iov[0].iov_len = header_data_size_;
-      iov[1].iov_base = body_data_ptr_;
-      iov[1].iov_len = body_data_size_;
-      Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 2);
+      FILE* fp = open_memstream(&ddms_data, &ddms_data_size);
+      if (fp == NULL) {
+        PLOG(FATAL) << "open_memstream failed";
+      }
+      output.reset(new HprofFileOutput(fp));
     } else {
-      // Where exactly are we writing to?
       int out_fd;
       if (fd_ >= 0) {
         out_fd = dup(fd_);
@@ -463,22 +526,62 @@ class Hprof {
         }
       }
 
-      UniquePtr<File> file(new File(out_fd, filename_));
-      okay = file->WriteFully(header_data_ptr_, header_data_size_) &&
-          file->WriteFully(body_data_ptr_, body_data_size_);
-      if (!okay) {
-        std::string msg(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
-                                     filename_.c_str(), strerror(errno)));
-        ThrowRuntimeException("%s", msg.c_str());
-        LOG(ERROR) << msg;
+      if (EndsWith(filename_, ".gz")) {
+        gzFile gz = gzdopen(out_fd, "wb");
+        if (gz == NULL) {
+          close(out_fd);
+          ThrowRuntimeException("Couldn't dump heap; gzdopen(\"%s\") failed",
+                                filename_.c_str());
+          return;
+        }
+        output.reset(new HprofGzipOutput(gz));
+      } else {
+        FILE* fp = fdopen(out_fd, "w");
+        if (fp == NULL) {
+          close(out_fd);
+          ThrowRuntimeException("Couldn't dump heap; fdopen(\"%s\") failed: %s",
+                                filename_.c_str(), strerror(errno));
+          return;
+        }
+        setvbuf(fp, NULL, _IOFBF, kOutputBufferSize);
+        output.reset(new HprofFileOutput(fp));
       }
     }
+    out_ = output.get();
+
+    // Write the header.
+    WriteFixedHeader();
+    // Write the string and class tables, and any stack traces, to the header.
+    // (jhat requires that these appear before any of the data in the body that refers to them.)
+    WriteStringTable();
+    WriteClassTable();
+    WriteStackTraces();
+    // Then walk the heap again, writing the records as they are generated.
+    WriteHeapDump();
+    CHECK_EQ(strings_.size(), num_strings) << "heap changed while being dumped";
+    CHECK_EQ(classes_.size(), num_classes) << "heap changed while being dumped";
+    uint64_t size = output->Size();
+    bool okay = output->Finish();
+    out_ = NULL;
+
+    if (direct_to_ddms_) {
+      // Send the data off to DDMS.
+      iovec iov[1];
+      iov[0].iov_base = ddms_data;
+      iov[0].iov_len = ddms_data_size;
+      Dbg::DdmSendChunkV(CHUNK_TYPE("HPDS"), iov, 1);
+      free(ddms_data);
+    } else if (!okay) {
+      std::string msg(StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
+                                   filename_.c_str(), strerror(errno)));
+      ThrowRuntimeException("%s", msg.c_str());
+      LOG(ERROR) << msg;
+    }
 
     // Throw out a log message for the benefit of "runhat".
     if (okay) {
       uint64_t duration = NanoTime() - start_ns_;
-      LOG(INFO) << "hprof: heap dump completed ("
-          << PrettySize(header_data_size_ + body_data_size_ + 1023)
+      LOG(INFO) << "hprof: heap dump completed (" << PrettySize(size + 1023)
           << ") in " << PrettyDuration(duration);
     }
   }
@@ -503,7 +606,19 @@ class Hprof {
 
   int DumpHeapObject(mirror::Object* obj) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  void Finish() {
+  // Writes the roots and the heap to out_, starting from the default heap.
+  void WriteHeapDump() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::heap_bitmap_lock_) {
+    objects_in_segment_ = 0;
+    current_heap_ = HPROF_HEAP_DEFAULT;
+    current_record_.StartNewRecord(out_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
+    Runtime::Current()->VisitRoots(RootVisitor, this, false, false);
+    {
+      ReaderMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
+      Runtime::Current()->GetHeap()->GetLiveBitmap()->Walk(HeapBitmapCallback, this);
+    }
+    current_record_.StartNewRecord(out_, HPROF_TAG_HEAP_DUMP_END, HPROF_TIME);
+    current_record_.Flush();
   }
 
   int WriteClassTable() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -514,7 +629,7 @@ class Hprof {
       const mirror::Class* c = *it;
       CHECK(c != NULL);
 
-      int err = current_record_.StartNewRecord(header_fp_, HPROF_TAG_LOAD_CLASS, HPROF_TIME);
+      int err = current_record_.StartNewRecord(out_, HPROF_TAG_LOAD_CLASS, HPROF_TIME);
       if (err != 0) {
         return err;
       }
@@ -540,7 +655,7 @@ class Hprof {
       std::string string((*it).first);
       size_t id = (*it).second;
 
-      int err = current_record_.StartNewRecord(header_fp_, HPROF_TAG_STRING, HPROF_TIME);
+      int err = current_record_.StartNewRecord(out_, HPROF_TAG_STRING, HPROF_TIME);
       if (err != 0) {
         return err;
       }
@@ -564,7 +679,7 @@ class Hprof {
 
   void StartNewHeapDumpSegment() {
     // This flushes the old segment and starts a new one.
-    current_record_.StartNewRecord(body_fp_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
+    current_record_.StartNewRecord(out_, HPROF_TAG_HEAP_DUMP_SEGMENT, HPROF_TIME);
     objects_in_segment_ = 0;
 
     // Starting a new HEAP_DUMP resets the heap to default.
@@ -619,11 +734,11 @@ class Hprof {
 
     // Write the file header.
     // U1: NUL-terminated magic string.
-    fwrite(magic, 1, sizeof(magic), header_fp_);
+    out_->Write(magic, sizeof(magic));
 
     // U4: size of identifiers.  We're using addresses as IDs, so make sure a pointer fits.
     U4_TO_BUF_BE(buf, 0, sizeof(void*));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);
+    out_->Write(buf, sizeof(uint32_t));
 
     // The current time, in milliseconds since 0:00 GMT, 1/1/70.
     timeval now;
@@ -636,16 +751,16 @@ class Hprof {
 
     // U4: high word of the 64-bit time.
     U4_TO_BUF_BE(buf, 0, (uint32_t)(nowMs >> 32));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);
+    out_->Write(buf, sizeof(uint32_t));
 
     // U4: low word of the 64-bit time.
     U4_TO_BUF_BE(buf, 0, (uint32_t)(nowMs & 0xffffffffULL));
-    fwrite(buf, 1, sizeof(uint32_t), header_fp_);  // xxx fix the time
+    out_->Write(buf, sizeof(uint32_t));  // xxx fix the time
   }
 
   void WriteStackTraces() {
     // Write a dummy stack trace record so the analysis tools don't freak out.
-    current_record_.StartNewRecord(header_fp_, HPROF_TAG_STACK_TRACE, HPROF_TIME);
+    current_record_.StartNewRecord(out_, HPROF_TAG_STACK_TRACE, HPROF_TIME);
     current_record_.AddU4(HPROF_NULL_STACK_TRACE);
     current_record_.AddU4(HPROF_NULL_THREAD);
     current_record_.AddU4(0);    // no frames
@@ -667,13 +782,8 @@ class Hprof {
   HprofHeapId current_heap_;  // Which heap we're currently dumping.
   size_t objects_in_segment_;
 
-  FILE* header_fp_;
-  char* header_data_ptr_;
-  size_t header_data_size_;
-
-  FILE* body_fp_;
-  char* body_data_ptr_;
-  size_t body_data_size_;
+  // Where the records currently go.
+  HprofOutput* out_;
 
   ClassSet classes_;
   size_t next_string_id_;
@@ -1071,16 +1181,66 @@ void Hprof::VisitRoot(const mirror::Object* obj) {
   gc_thread_serial_number_ = 0;
 }
 
+// How long a forked heap dump may take before the child is killed, in case it deadlocked on a lock
+// held by a thread that didn't survive the fork.
+static const unsigned int kForkedDumpTimeoutSeconds = 10 * 60;
+
+// Forks a child that dumps its copy-on-write snapshot of the heap while the caller resumes. The
+// child forks again and exits so that the dumping grandchild, reparented to init, needn't be
+// waited for.
+static void ForkAndDumpHeap(const char* filename, int fd)
+    EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  pid_t pid;
+  {
+    // Flush the allocation stack here so the child sees every live object in the bitmaps, and
+    // keep the bitmaps from being changed by a thread that isn't suspended while forking.
+    WriterMutexLock mu(Thread::Current(), *Locks::heap_bitmap_lock_);
+    Runtime::Current()->GetHeap()->FlushAllocStack();
+    pid = fork();
+    if (pid == 0) {
+      pid = fork();
+      if (pid != 0) {
+        _exit(pid < 0 ? 1 : 0);
+      }
+    }
+  }
+  if (pid < 0) {
+    ThrowRuntimeException("Couldn't dump heap; fork failed: %s", strerror(errno));
+    return;
+  }
+  if (pid != 0) {
+    int status;
+    if (TEMP_FAILURE_RETRY(waitpid(pid, &status, 0)) != pid ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      ThrowRuntimeException("Couldn't dump heap; fork of the dumping process failed");
+    } else {
+      LOG(INFO) << "hprof: heap dump \"" << filename << "\" forked";
+    }
+    return;
+  }
+  // Only this thread exists in the child, and the mutator lock is still held exclusively.
+  alarm(kForkedDumpTimeoutSeconds);
+  Hprof hprof(filename, fd, false);
+  hprof.Dump();
+  _exit(Thread::Current()->IsExceptionPending() ? 1 : 0);
+}
+
 // If "direct_to_ddms" is true, the other arguments are ignored, and data is
 // sent directly to DDMS.
 // If "fd" is >= 0, the output will be written to that file descriptor.
 // Otherwise, "filename" is used to create an output file.
+// With -Xhprof-fork, dumps to a file are written by a forked process and may
+// complete after this returns.
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms) {
   CHECK(filename != NULL);
 
   Runtime::Current()->GetThreadList()->SuspendAll();
-  Hprof hprof(filename, fd, direct_to_ddms);
-  hprof.Dump();
+  if (!direct_to_ddms && Runtime::Current()->ForkHeapDumps()) {
+    ForkAndDumpHeap(filename, fd);
+  } else {
+    Hprof hprof(filename, fd, direct_to_ddms);
+    hprof.Dump();
+  }
   Runtime::Current()->GetThreadList()->ResumeAll();
 }
 
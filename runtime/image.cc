@@ -24,12 +24,16 @@
 namespace art {
 
 const byte ImageHeader::kImageMagic[] = { 'a', 'r', 't', '\n' };
-const byte ImageHeader::kImageVersion[] = { '0', '0', '5', '\0' };
+const byte ImageHeader::kImageVersion[] = { '0', '0', '8', '\0' };
 
 ImageHeader::ImageHeader(uint32_t image_begin,
                          uint32_t image_size,
                          uint32_t image_bitmap_offset,
                          uint32_t image_bitmap_size,
+                         uint32_t image_relocations_offset,
+                         uint32_t image_relocations_size,
+                         uint32_t oat_relocations_count,
+                         uint32_t image_block_size,
                          uint32_t image_roots,
                          uint32_t oat_checksum,
                          uint32_t oat_file_begin,
@@ -40,6 +44,10 @@ ImageHeader::ImageHeader(uint32_t image_begin,
     image_size_(image_size),
     image_bitmap_offset_(image_bitmap_offset),
     image_bitmap_size_(image_bitmap_size),
+    image_relocations_offset_(image_relocations_offset),
+    image_relocations_size_(image_relocations_size),
+    oat_relocations_count_(oat_relocations_count),
+    image_block_size_(image_block_size),
     oat_checksum_(oat_checksum),
     oat_file_begin_(oat_file_begin),
     oat_data_begin_(oat_data_begin),
@@ -73,6 +81,12 @@ const char* ImageHeader::GetMagic() const {
   return reinterpret_cast<const char*>(magic_);
 }
 
+void ImageHeader::RelocateImage(ptrdiff_t delta) {
+  CHECK_ALIGNED(delta, kPageSize);
+  image_begin_ += delta;
+  image_roots_ += delta;
+}
+
 mirror::Object* ImageHeader::GetImageRoot(ImageRoot image_root) const {
   return GetImageRoots()->Get(image_root);
 }
@@ -34,6 +34,10 @@ class PACKED(4) ImageHeader {
               uint32_t image_size_,
               uint32_t image_bitmap_offset,
               uint32_t image_bitmap_size,
+              uint32_t image_relocations_offset,
+              uint32_t image_relocations_size,
+              uint32_t oat_relocations_count,
+              uint32_t image_block_size,
               uint32_t image_roots,
               uint32_t oat_checksum,
               uint32_t oat_file_begin,
@@ -60,6 +64,43 @@ class PACKED(4) ImageHeader {
     return image_bitmap_size_;
   }
 
+  size_t GetImageRelocationsOffset() const {
+    return image_relocations_offset_;
+  }
+
+  size_t GetImageRelocationsSize() const {
+    return image_relocations_size_;
+  }
+
+  size_t GetOatRelocationsCount() const {
+    return oat_relocations_count_;
+  }
+
+  // An image is stored compressed when it has a block size. Each block of that many bytes of
+  // the image, the last one possibly shorter, is deflated on its own so that they can be
+  // inflated in parallel.
+  bool IsCompressed() const {
+    return image_block_size_ != 0;
+  }
+
+  size_t GetImageBlockSize() const {
+    return image_block_size_;
+  }
+
+  size_t GetNumImageBlocks() const {
+    return RoundUp(image_size_, image_block_size_) / image_block_size_;
+  }
+
+  // The header of a compressed image is followed in the file by the index of its blocks, the
+  // file offset of each block followed by the end of the last one.
+  size_t GetImageBlockIndexOffset() const {
+    return sizeof(ImageHeader);
+  }
+
+  // Moves the image addresses held by the header by delta bytes, for an image mapped delta bytes
+  // from its requested base address. The addresses of the oat file are unchanged.
+  void RelocateImage(ptrdiff_t delta);
+
   uint32_t GetOatChecksum() const {
     return oat_checksum_;
   }
@@ -84,10 +125,6 @@ class PACKED(4) ImageHeader {
     return reinterpret_cast<byte*>(oat_file_end_);
   }
 
-  size_t GetBitmapOffset() const {
-    return RoundUp(image_size_, kPageSize);
-  }
-
   enum ImageRoot {
     kResolutionMethod,
     kCalleeSaveMethod,
@@ -96,6 +133,8 @@ class PACKED(4) ImageHeader {
     kOatLocation,
     kDexCaches,
     kClassRoots,
+    kClassTable,
+    kClassTableHashes,
     kImageRootsMax,
   };
 
@@ -123,6 +162,22 @@ class PACKED(4) ImageHeader {
   // Size of the image bitmap.
   uint32_t image_bitmap_size_;
 
+  // Offset in the file of the relocations, a bitmap with a bit set for each 32-bit word of the
+  // image that holds the address of an image object. The bitmap is followed by the offsets from
+  // oat_data_begin_ of the words of compiled code that hold the address of an image method.
+  uint32_t image_relocations_offset_;
+
+  // Size of the bitmap of image relocations.
+  uint32_t image_relocations_size_;
+
+  // Number of compiled code relocations following the bitmap.
+  uint32_t oat_relocations_count_;
+
+  // Size of the blocks of a compressed image, 0 for an image stored as it is mapped. The blocks
+  // of a compressed image follow the oat relocations, the bitmap and relocations being mapped
+  // from the file either way.
+  uint32_t image_block_size_;
+
   // Checksum of the oat file we link to for load time sanity check.
   uint32_t oat_checksum_;
 
@@ -40,17 +40,16 @@ IndirectReferenceTable::IndirectReferenceTable(size_t initialCount,
   CHECK_LE(initialCount, maxCount);
   CHECK_NE(desiredKind, kSirtOrInvalid);
 
-  table_ = reinterpret_cast<const mirror::Object**>(malloc(initialCount * sizeof(const mirror::Object*)));
-  CHECK(table_ != NULL);
-  memset(table_, 0xd1, initialCount * sizeof(const mirror::Object*));
-
-  slot_data_ = reinterpret_cast<IndirectRefSlot*>(calloc(initialCount, sizeof(IndirectRefSlot)));
-  CHECK(slot_data_ != NULL);
+  // The table is allocated by the first Add, most threads never use their local references.
+  table_ = NULL;
+  slot_data_ = NULL;
 
   segment_state_.all = IRT_FIRST_SEGMENT;
-  alloc_entries_ = initialCount;
+  initial_entries_ = initialCount;
+  alloc_entries_ = 0;
   max_entries_ = maxCount;
   kind_ = desiredKind;
+  stale_reference_checks_ = true;
 }
 
 IndirectReferenceTable::~IndirectReferenceTable() {
@@ -63,6 +62,9 @@ IndirectReferenceTable::~IndirectReferenceTable() {
 
 // Make sure that the entry at "idx" is correctly paired with "iref".
 bool IndirectReferenceTable::CheckEntry(const char* what, IndirectRef iref, int idx) const {
+  if (!stale_reference_checks_) {
+    return true;
+  }
   const mirror::Object* obj = table_[idx];
   IndirectRef checkRef = ToIndirectRef(obj, idx);
   if (UNLIKELY(checkRef != iref)) {
@@ -75,7 +77,7 @@ bool IndirectReferenceTable::CheckEntry(const char* what, IndirectRef iref, int
   return true;
 }
 
-IndirectRef IndirectReferenceTable::Add(uint32_t cookie, const mirror::Object* obj) {
+IndirectRef IndirectReferenceTable::AddSlow(uint32_t cookie, const mirror::Object* obj) {
   IRTSegmentState prevState;
   prevState.all = cookie;
   size_t topIndex = segment_state_.parts.topIndex;
@@ -83,7 +85,6 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, const mirror::Object* o
   DCHECK(obj != NULL);
   // TODO: stronger sanity check on the object (such as in heap)
   DCHECK_ALIGNED(reinterpret_cast<uintptr_t>(obj), 8);
-  DCHECK(table_ != NULL);
   DCHECK_LE(alloc_entries_, max_entries_);
   DCHECK_GE(segment_state_.parts.numHoles, prevState.parts.numHoles);
 
@@ -95,7 +96,7 @@ IndirectRef IndirectReferenceTable::Add(uint32_t cookie, const mirror::Object* o
                  << MutatorLockedDumpable<IndirectReferenceTable>(*this);
     }
 
-    size_t newSize = alloc_entries_ * 2;
+    size_t newSize = (alloc_entries_ == 0) ? initial_entries_ : alloc_entries_ * 2;
     if (newSize > max_entries_) {
       newSize = max_entries_;
     }
@@ -221,7 +222,6 @@ bool IndirectReferenceTable::Remove(uint32_t cookie, IndirectRef iref) {
   int topIndex = segment_state_.parts.topIndex;
   int bottomIndex = prevState.parts.topIndex;
 
-  DCHECK(table_ != NULL);
   DCHECK_LE(alloc_entries_, max_entries_);
   DCHECK_GE(segment_state_.parts.numHoles, prevState.parts.numHoles);
 
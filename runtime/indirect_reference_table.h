@@ -144,6 +144,9 @@ static const uint32_t IRT_FIRST_SEGMENT = 0;
  * most-recently-added entry).  For JNI local references, the common
  * operations are adding a new entry and removing an entire table segment.
  *
+ * The table is only allocated, with "initial_entries_" entries, when the
+ * first entry is added.
+ *
  * If "alloc_entries_" is not equal to "max_entries_", the table may expand
  * when entries are added, which means the memory may move.  If you want
  * to keep pointers into "table" rather than offsets, you must use a
@@ -259,7 +262,23 @@ class IndirectReferenceTable {
    * failed during expansion).
    */
   IndirectRef Add(uint32_t cookie, const mirror::Object* obj)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    IRTSegmentState prevState;
+    prevState.all = cookie;
+    size_t topIndex = segment_state_.parts.topIndex;
+    // Without holes in the current segment the entry goes on top, which is the common case as
+    // local references are mostly released in LIFO order by popping their frame.
+    if (LIKELY(segment_state_.parts.numHoles == prevState.parts.numHoles &&
+               topIndex < alloc_entries_)) {
+      DCHECK(obj != NULL);
+      UpdateSlotAdd(obj, topIndex);
+      IndirectRef result = ToIndirectRef(obj, topIndex);
+      table_[topIndex] = obj;
+      segment_state_.parts.topIndex = topIndex + 1;
+      return result;
+    }
+    return AddSlow(cookie, obj);
+  }
 
   /*
    * Given an IndirectRef in the table, return the Object it refers to.
@@ -267,12 +286,39 @@ class IndirectReferenceTable {
    * Returns kInvalidIndirectRefObject if iref is invalid.
    */
   const mirror::Object* Get(IndirectRef iref) const {
+    const mirror::Object* obj = TryGet(iref);
+    if (LIKELY(obj != NULL)) {
+      return obj;
+    }
     if (!GetChecked(iref)) {
       return kInvalidIndirectRefObject;
     }
     return table_[ExtractIndex(iref)];
   }
 
+  /*
+   * The lookup of Get without stale reference checks, for inlining into callers. Returns NULL if
+   * iref doesn't name a live entry or stale reference checks are enabled, in which case callers
+   * must use Get.
+   */
+  const mirror::Object* TryGet(IndirectRef iref) const {
+    uint32_t idx = ExtractIndex(iref);
+    if (LIKELY(!stale_reference_checks_ && iref != NULL && GetIndirectRefKind(iref) == kind_ &&
+               idx < segment_state_.parts.topIndex)) {
+      return table_[idx];
+    }
+    return NULL;
+  }
+
+  /*
+   * Serial numbers that detect the use of a reference after its slot was reused are only
+   * maintained while stale reference checks are enabled, they are on by default and follow
+   * CheckJNI for local references.
+   */
+  void SetStaleReferenceChecks(bool enabled) {
+    stale_reference_checks_ = enabled;
+  }
+
   // TODO: remove when we remove work_around_app_jni_bugs support.
   bool ContainsDirectPointer(mirror::Object* direct_pointer) const;
 
@@ -341,6 +387,9 @@ class IndirectReferenceTable {
     return (IndirectRef) uref;
   }
 
+  IndirectRef AddSlow(uint32_t cookie, const mirror::Object* obj)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   /*
    * Update extended debug info when an entry is added.
    *
@@ -348,7 +397,7 @@ class IndirectReferenceTable {
    * this slot.
    */
   void UpdateSlotAdd(const mirror::Object* obj, int slot) {
-    if (slot_data_ != NULL) {
+    if (stale_reference_checks_) {
       IndirectRefSlot* pSlot = &slot_data_[slot];
       pSlot->serial++;
       pSlot->previous[pSlot->serial % kIRTPrevCount] = obj;
@@ -368,10 +417,14 @@ class IndirectReferenceTable {
   IndirectRefKind kind_;
   /* extended debugging info */
   IndirectRefSlot* slot_data_;
+  /* #of entries allocated by the first Add */
+  size_t initial_entries_;
   /* #of entries we have space for */
   size_t alloc_entries_;
   /* max #of entries allowed */
   size_t max_entries_;
+  /* whether serial numbers are maintained and checked */
+  bool stale_reference_checks_;
 };
 
 }  // namespace art
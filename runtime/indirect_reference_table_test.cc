@@ -249,4 +249,63 @@ TEST_F(IndirectReferenceTableTest, BasicTest) {
   CheckDump(&irt, 0, 0);
 }
 
+TEST_F(IndirectReferenceTableTest, WithoutStaleReferenceChecks) {
+  ScopedObjectAccess soa(Thread::Current());
+  static const size_t kTableInitial = 4;
+  static const size_t kTableMax = 8;
+  IndirectReferenceTable irt(kTableInitial, kTableMax, kLocal);
+  irt.SetStaleReferenceChecks(false);
+
+  mirror::Class* c = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ASSERT_TRUE(c != NULL);
+  mirror::Object* obj0 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj0 != NULL);
+  mirror::Object* obj1 = c->AllocObject(soa.Self());
+  ASSERT_TRUE(obj1 != NULL);
+
+  const uint32_t cookie = IRT_FIRST_SEGMENT;
+
+  // Add and remove in LIFO order.
+  IndirectRef iref0 = irt.Add(cookie, obj0);
+  EXPECT_TRUE(iref0 != NULL);
+  IndirectRef iref1 = irt.Add(cookie, obj1);
+  EXPECT_TRUE(iref1 != NULL);
+  EXPECT_EQ(obj0, irt.TryGet(iref0));
+  EXPECT_EQ(obj1, irt.Get(iref1));
+  ASSERT_TRUE(irt.Remove(cookie, iref1));
+  ASSERT_TRUE(irt.Remove(cookie, iref0));
+  ASSERT_EQ(0U, irt.Capacity());
+
+  // Lookups beyond the top still fail.
+  EXPECT_TRUE(irt.TryGet(iref0) == NULL);
+  EXPECT_EQ(kInvalidIndirectRefObject, irt.Get(iref0));
+
+  // Popping a segment releases its entries.
+  iref0 = irt.Add(cookie, obj0);
+  uint32_t segment_cookie = irt.GetSegmentState();
+  iref1 = irt.Add(segment_cookie, obj1);
+  EXPECT_EQ(2U, irt.Capacity());
+  irt.SetSegmentState(segment_cookie);
+  EXPECT_EQ(1U, irt.Capacity());
+  EXPECT_EQ(obj0, irt.Get(iref0));
+
+  // Without serial numbers a reference to a reused slot reads the new entry.
+  ASSERT_TRUE(irt.Remove(cookie, iref0));
+  iref1 = irt.Add(cookie, obj1);
+  EXPECT_EQ(iref0, iref1);
+  EXPECT_EQ(obj1, irt.Get(iref0));
+
+  // Growing the table keeps the entries.
+  IndirectRef manyRefs[kTableMax - 1];
+  for (size_t i = 0; i < kTableMax - 1; i++) {
+    manyRefs[i] = irt.Add(cookie, obj0);
+    ASSERT_TRUE(manyRefs[i] != NULL) << "Failed adding " << i;
+  }
+  EXPECT_EQ(kTableMax, irt.Capacity());
+  EXPECT_EQ(obj1, irt.Get(iref1));
+  for (size_t i = 0; i < kTableMax - 1; i++) {
+    EXPECT_EQ(obj0, irt.Get(manyRefs[i]));
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "inline_cache.h"
+
+#include <vector>
+
+#include "cutils/atomic.h"
+#include "cutils/atomic-inline.h"
+#include "mirror/art_method.h"
+#include "mirror/class.h"
+#include "thread.h"
+
+namespace art {
+
+InlineCache::InlineCache(const mirror::ArtMethod* caller, const mirror::ArtMethod* callee)
+    : caller_(caller), callee_(callee), megamorphic_(false) {
+  for (size_t i = 0; i < kMaxReceivers; ++i) {
+    classes_[i] = 0;
+    targets_[i] = NULL;
+  }
+}
+
+mirror::ArtMethod* InlineCache::Lookup(const mirror::Class* klass) const {
+  for (size_t i = 0; i < kMaxReceivers; ++i) {
+    int32_t cached_class = android_atomic_acquire_load(&classes_[i]);
+    if (cached_class == 0) {
+      break;
+    }
+    if (cached_class == reinterpret_cast<int32_t>(klass)) {
+      return targets_[i];
+    }
+  }
+  return NULL;
+}
+
+size_t InlineCache::NumReceivers() const {
+  size_t num_receivers = 0;
+  while (num_receivers < kMaxReceivers &&
+         android_atomic_acquire_load(&classes_[num_receivers]) != 0) {
+    ++num_receivers;
+  }
+  return num_receivers;
+}
+
+InlineCacheTable::InlineCacheTable() : update_lock_("inline cache update lock") {
+  for (size_t i = 0; i < kMaxCaches; ++i) {
+    caches_[i] = 0;
+  }
+}
+
+InlineCacheTable::~InlineCacheTable() {
+  for (size_t i = 0; i < kMaxCaches; ++i) {
+    delete reinterpret_cast<InlineCache*>(caches_[i]);
+  }
+}
+
+uint32_t InlineCacheTable::Hash(const mirror::ArtMethod* caller,
+                                const mirror::ArtMethod* callee) {
+  // Methods are 8 byte aligned, drop the low bits before mixing.
+  uint32_t hash = (reinterpret_cast<uintptr_t>(caller) >> 3) * 0x9E3779B1U;
+  hash ^= (reinterpret_cast<uintptr_t>(callee) >> 3) + (hash >> 16);
+  return hash;
+}
+
+InlineCache* InlineCacheTable::GetCache(const mirror::ArtMethod* caller,
+                                        const mirror::ArtMethod* callee) {
+  uint32_t hash = Hash(caller, callee);
+  InlineCache* new_cache = NULL;
+  for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+    volatile int32_t* slot = &caches_[(hash + probe) % kMaxCaches];
+    InlineCache* cache = reinterpret_cast<InlineCache*>(android_atomic_acquire_load(slot));
+    if (cache == NULL) {
+      if (new_cache == NULL) {
+        new_cache = new InlineCache(caller, callee);
+      }
+      // Note: android_atomic_release_cas() returns 0 on success, not failure.
+      if (android_atomic_release_cas(0, reinterpret_cast<int32_t>(new_cache), slot) == 0) {
+        return new_cache;
+      }
+      // Another thread claimed the slot first, it may have added this very cache.
+      cache = reinterpret_cast<InlineCache*>(android_atomic_acquire_load(slot));
+    }
+    if (cache->caller_ == caller && cache->callee_ == callee) {
+      delete new_cache;
+      return cache;
+    }
+  }
+  delete new_cache;
+  return NULL;
+}
+
+void InlineCacheTable::Update(Thread* self, InlineCache* cache, const mirror::Class* klass,
+                              mirror::ArtMethod* target) {
+  if (cache->IsMegamorphic()) {
+    return;
+  }
+  MutexLock mu(self, update_lock_);
+  for (size_t i = 0; i < InlineCache::kMaxReceivers; ++i) {
+    int32_t cached_class = cache->classes_[i];
+    if (cached_class == reinterpret_cast<int32_t>(klass)) {
+      return;  // Added by another thread.
+    }
+    if (cached_class == 0) {
+      cache->targets_[i] = target;
+      android_atomic_release_store(reinterpret_cast<int32_t>(klass), &cache->classes_[i]);
+      return;
+    }
+  }
+  cache->megamorphic_ = true;
+}
+
+void InlineCacheTable::DumpForSigQuit(std::ostream& os) const {
+  size_t num_caches = 0;
+  size_t num_monomorphic = 0;
+  size_t num_polymorphic = 0;
+  size_t num_megamorphic = 0;
+  for (size_t i = 0; i < kMaxCaches; ++i) {
+    const InlineCache* cache =
+        reinterpret_cast<const InlineCache*>(android_atomic_acquire_load(&caches_[i]));
+    if (cache != NULL) {
+      ++num_caches;
+      if (cache->IsMegamorphic()) {
+        ++num_megamorphic;
+      } else if (cache->NumReceivers() == 1) {
+        ++num_monomorphic;
+      } else if (cache->NumReceivers() > 1) {
+        ++num_polymorphic;
+      }
+    }
+  }
+  os << "Inline caches: " << num_caches << " call sites; " << num_monomorphic << " monomorphic; "
+     << num_polymorphic << " polymorphic; " << num_megamorphic << " megamorphic\n";
+}
+
+void InlineCacheTable::Sweep(IsMarkedTester is_marked, void* arg) {
+  std::vector<InlineCache*> live_caches;
+  for (size_t i = 0; i < kMaxCaches; ++i) {
+    InlineCache* cache = reinterpret_cast<InlineCache*>(caches_[i]);
+    if (cache == NULL) {
+      continue;
+    }
+    caches_[i] = 0;
+    if (!is_marked(cache->caller_, arg) || !is_marked(cache->callee_, arg)) {
+      delete cache;
+      continue;
+    }
+    // The target of a marked receiver class is one of its methods, so it is marked too.
+    size_t num_receivers = 0;
+    for (size_t j = 0; j < InlineCache::kMaxReceivers && cache->classes_[j] != 0; ++j) {
+      if (is_marked(reinterpret_cast<const mirror::Class*>(cache->classes_[j]), arg)) {
+        cache->classes_[num_receivers] = cache->classes_[j];
+        cache->targets_[num_receivers] = cache->targets_[j];
+        ++num_receivers;
+      }
+    }
+    for (size_t j = num_receivers; j < InlineCache::kMaxReceivers; ++j) {
+      cache->classes_[j] = 0;
+      cache->targets_[j] = NULL;
+    }
+    live_caches.push_back(cache);
+  }
+  // Add the live caches again, the holes left by the others would end the probes for them.
+  for (InlineCache* cache : live_caches) {
+    uint32_t hash = Hash(cache->caller_, cache->callee_);
+    size_t probe = 0;
+    while (probe < kMaxProbes && caches_[(hash + probe) % kMaxCaches] != 0) {
+      ++probe;
+    }
+    if (probe < kMaxProbes) {
+      caches_[(hash + probe) % kMaxCaches] = reinterpret_cast<int32_t>(cache);
+    } else {
+      delete cache;
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INLINE_CACHE_H_
+#define ART_RUNTIME_INLINE_CACHE_H_
+
+#include <stdint.h>
+
+#include <ostream>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "root_visitor.h"
+
+namespace art {
+
+namespace mirror {
+class ArtMethod;
+class Class;
+}  // namespace mirror
+class InlineCacheTable;
+class Thread;
+
+// The receiver classes seen by the calls from one method to a virtual or interface method and
+// what they dispatched to. Caches are monomorphic with one receiver class, polymorphic with up to
+// kMaxReceivers and megamorphic once another class was seen. Receiver slots are written once, so
+// Lookup needs no lock.
+class InlineCache {
+ public:
+  static constexpr size_t kMaxReceivers = 4;
+
+  const mirror::ArtMethod* GetCaller() const {
+    return caller_;
+  }
+
+  const mirror::ArtMethod* GetCallee() const {
+    return callee_;
+  }
+
+  // The cached target for receivers of the given class, NULL if it isn't cached.
+  mirror::ArtMethod* Lookup(const mirror::Class* klass) const;
+
+  size_t NumReceivers() const;
+
+  bool IsMonomorphic() const {
+    return !IsMegamorphic() && NumReceivers() == 1;
+  }
+
+  bool IsMegamorphic() const {
+    return megamorphic_;
+  }
+
+ private:
+  InlineCache(const mirror::ArtMethod* caller, const mirror::ArtMethod* callee);
+
+  const mirror::ArtMethod* const caller_;
+  const mirror::ArtMethod* const callee_;
+  // The receiver classes, set with a release store after the matching target.
+  volatile int32_t classes_[kMaxReceivers];
+  mirror::ArtMethod* targets_[kMaxReceivers];
+  volatile bool megamorphic_;
+
+  friend class InlineCacheTable;
+  DISALLOW_COPY_AND_ASSIGN(InlineCache);
+};
+
+// The inline caches of the runtime, populated by the invoke trampolines on the interface calls
+// whose method shares its interface method table slot. The table has a fixed size and caches are
+// never removed; calls are no longer cached once it is full. Classes and methods aren't unloaded,
+// so the caches hold no roots.
+class InlineCacheTable {
+ public:
+  static constexpr size_t kMaxCaches = 8192;
+
+  InlineCacheTable();
+  ~InlineCacheTable();
+
+  // The cache for calls from caller to callee, created if needed. NULL if the table is full.
+  InlineCache* GetCache(const mirror::ArtMethod* caller, const mirror::ArtMethod* callee);
+
+  // Record that receivers of klass dispatch to target.
+  void Update(Thread* self, InlineCache* cache, const mirror::Class* klass,
+              mirror::ArtMethod* target) LOCKS_EXCLUDED(update_lock_);
+
+  void DumpForSigQuit(std::ostream& os) const;
+
+  // Removes the caches of the methods and the receivers of the classes the GC didn't mark. Called
+  // with the mutators suspended, none of them is then using a cache.
+  void Sweep(IsMarkedTester is_marked, void* arg);
+
+ private:
+  static constexpr size_t kMaxProbes = 16;
+
+  static uint32_t Hash(const mirror::ArtMethod* caller, const mirror::ArtMethod* callee);
+
+  // InlineCache pointers, set once with a release compare-and-swap.
+  volatile int32_t caches_[kMaxCaches];
+  // Serializes writers of the receiver slots of the caches.
+  Mutex update_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+
+  DISALLOW_COPY_AND_ASSIGN(InlineCacheTable);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_INLINE_CACHE_H_
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "inline_cache.h"
+
+#include <sstream>
+
+#include "common_test.h"
+#include "mirror/art_method.h"
+#include "mirror/class.h"
+
+namespace art {
+
+class InlineCacheTest : public CommonTest {};
+
+TEST_F(InlineCacheTest, Receivers) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* object = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  mirror::Class* string = class_linker_->FindSystemClass("Ljava/lang/String;");
+  ASSERT_TRUE(object != NULL);
+  ASSERT_TRUE(string != NULL);
+  mirror::ArtMethod* hash_code = object->FindVirtualMethod("hashCode", "()I");
+  mirror::ArtMethod* init = object->FindDirectMethod("<init>", "()V");
+  mirror::ArtMethod* string_hash_code = string->FindVirtualMethod("hashCode", "()I");
+  ASSERT_TRUE(hash_code != NULL);
+  ASSERT_TRUE(init != NULL);
+  ASSERT_TRUE(string_hash_code != NULL);
+
+  InlineCacheTable table;
+  InlineCache* cache = table.GetCache(init, hash_code);
+  ASSERT_TRUE(cache != NULL);
+  EXPECT_EQ(cache, table.GetCache(init, hash_code));
+  EXPECT_NE(cache, table.GetCache(hash_code, init));
+  EXPECT_EQ(0U, cache->NumReceivers());
+  EXPECT_TRUE(cache->Lookup(string) == NULL);
+
+  table.Update(soa.Self(), cache, string, string_hash_code);
+  table.Update(soa.Self(), cache, string, string_hash_code);
+  EXPECT_TRUE(cache->IsMonomorphic());
+  EXPECT_EQ(string_hash_code, cache->Lookup(string));
+  EXPECT_TRUE(cache->Lookup(object) == NULL);
+
+  table.Update(soa.Self(), cache, object, hash_code);
+  EXPECT_FALSE(cache->IsMonomorphic());
+  EXPECT_EQ(2U, cache->NumReceivers());
+  EXPECT_EQ(hash_code, cache->Lookup(object));
+
+  const char* descriptors[] = { "Ljava/lang/Integer;", "Ljava/lang/Long;", "Ljava/lang/Short;" };
+  for (size_t i = 0; i < arraysize(descriptors); ++i) {
+    mirror::Class* klass = class_linker_->FindSystemClass(descriptors[i]);
+    ASSERT_TRUE(klass != NULL);
+    table.Update(soa.Self(), cache, klass, klass->FindVirtualMethod("hashCode", "()I"));
+  }
+  EXPECT_TRUE(cache->IsMegamorphic());
+  const size_t max_receivers = InlineCache::kMaxReceivers;
+  EXPECT_EQ(max_receivers, cache->NumReceivers());
+  EXPECT_EQ(string_hash_code, cache->Lookup(string));
+
+  std::ostringstream os;
+  table.DumpForSigQuit(os);
+  EXPECT_EQ("Inline caches: 2 call sites; 0 monomorphic; 0 polymorphic; 1 megamorphic\n",
+            os.str());
+}
+
+}  // namespace art
@@ -19,6 +19,7 @@
 #include <sys/uio.h>
 
 #include "atomic_integer.h"
+#include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
 #include "debugger.h"
@@ -47,66 +48,78 @@ static bool InstallStubsClassVisitor(mirror::Class* klass, void* arg)
   return instrumentation->InstallStubsForClass(klass);
 }
 
-bool Instrumentation::InstallStubsForClass(mirror::Class* klass) {
-  bool uninstall = !entry_exit_stubs_installed_ && !interpreter_stubs_installed_;
-  ClassLinker* class_linker = NULL;
-  if (uninstall) {
-    class_linker = Runtime::Current()->GetClassLinker();
+Instrumentation::~Instrumentation() {
+  delete method_entry_listeners_;
+  delete method_exit_listeners_;
+  delete method_unwind_listeners_;
+  delete dex_pc_listeners_;
+  delete exception_caught_listeners_;
+  STLDeleteElements(&retired_listeners_);
+}
+
+void Instrumentation::SetMethodFilter(const std::string& class_descriptor_prefix) {
+  CHECK(!instrumentation_stubs_installed_);
+  method_filter_ = class_descriptor_prefix;
+}
+
+bool Instrumentation::MatchesMethodFilter(const mirror::ArtMethod* method) const {
+  if (method_filter_.empty()) {
+    return true;
+  }
+  ClassHelper kh(method->GetDeclaringClass());
+  return StartsWith(kh.GetDescriptor(), method_filter_.c_str());
+}
+
+bool Instrumentation::IsFilteredOut(const mirror::ArtMethod* method) const {
+  return filter_methods_ && !method->IsInstrumented();
+}
+
+void Instrumentation::InstallStubsForMethod(mirror::ArtMethod* method, bool is_initialized) {
+  if (method->IsAbstract() || method->IsProxyMethod()) {
+    return;
+  }
+  bool install = entry_exit_stubs_installed_ || interpreter_stubs_installed_;
+  bool selected = install && (!filter_methods_ || MatchesMethodFilter(method));
+  method->SetInstrumented(selected);
+  const void* new_code;
+  if (!selected && !interpreter_stubs_installed_) {
+    ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+    if (forced_interpret_only_ && !method->IsNative()) {
+      new_code = GetCompiledCodeToInterpreterBridge();
+    } else if (is_initialized || !method->IsStatic() || method->IsConstructor()) {
+      new_code = class_linker->GetOatCodeFor(method);
+    } else {
+      new_code = GetResolutionTrampoline(class_linker);
+    }
+  } else if ((!interpreter_stubs_installed_ && !IsDeoptimized(method)) || method->IsNative()) {
+    new_code = GetQuickInstrumentationEntryPoint();
+  } else {
+    new_code = GetCompiledCodeToInterpreterBridge();
   }
+  method->SetEntryPointFromCompiledCode(new_code);
+}
+
+bool Instrumentation::InstallStubsForClass(mirror::Class* klass) {
   bool is_initialized = klass->IsInitialized();
   for (size_t i = 0; i < klass->NumDirectMethods(); i++) {
-    mirror::ArtMethod* method = klass->GetDirectMethod(i);
-    if (!method->IsAbstract() && !method->IsProxyMethod()) {
-      const void* new_code;
-      if (uninstall) {
-        if (forced_interpret_only_ && !method->IsNative()) {
-          new_code = GetCompiledCodeToInterpreterBridge();
-        } else if (is_initialized || !method->IsStatic() || method->IsConstructor()) {
-          new_code = class_linker->GetOatCodeFor(method);
-        } else {
-          new_code = GetResolutionTrampoline(class_linker);
-        }
-      } else {  // !uninstall
-        if (!interpreter_stubs_installed_ || method->IsNative()) {
-          new_code = GetQuickInstrumentationEntryPoint();
-        } else {
-          new_code = GetCompiledCodeToInterpreterBridge();
-        }
-      }
-      method->SetEntryPointFromCompiledCode(new_code);
-    }
+    InstallStubsForMethod(klass->GetDirectMethod(i), is_initialized);
   }
   for (size_t i = 0; i < klass->NumVirtualMethods(); i++) {
-    mirror::ArtMethod* method = klass->GetVirtualMethod(i);
-    if (!method->IsAbstract() && !method->IsProxyMethod()) {
-      const void* new_code;
-      if (uninstall) {
-        if (forced_interpret_only_ && !method->IsNative()) {
-          new_code = GetCompiledCodeToInterpreterBridge();
-        } else {
-          new_code = class_linker->GetOatCodeFor(method);
-        }
-      } else {  // !uninstall
-        if (!interpreter_stubs_installed_ || method->IsNative()) {
-          new_code = GetQuickInstrumentationEntryPoint();
-        } else {
-          new_code = GetCompiledCodeToInterpreterBridge();
-        }
-      }
-      method->SetEntryPointFromCompiledCode(new_code);
-    }
+    InstallStubsForMethod(klass->GetVirtualMethod(i), is_initialized);
   }
   return true;
 }
 
-// Places the instrumentation exit pc as the return PC for every quick frame. This also allows
-// deoptimization of quick frames to interpreter frames.
+// Places the instrumentation exit pc as the return PC for every quick frame that doesn't have it
+// yet. This also allows deoptimization of quick frames to interpreter frames.
 static void InstrumentationInstallStack(Thread* thread, void* arg)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   struct InstallStackVisitor : public StackVisitor {
-    InstallStackVisitor(Thread* thread, Context* context, uintptr_t instrumentation_exit_pc)
+    InstallStackVisitor(Thread* thread, Context* context, uintptr_t instrumentation_exit_pc,
+                        Instrumentation* instrumentation)
         : StackVisitor(thread, context),  instrumentation_stack_(thread->GetInstrumentationStack()),
-          instrumentation_exit_pc_(instrumentation_exit_pc), last_return_pc_(0) {}
+          instrumentation_exit_pc_(instrumentation_exit_pc), instrumentation_(instrumentation),
+          instrumentation_depth_(0), last_return_pc_(0) {}
 
     virtual bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
       mirror::ArtMethod* m = GetMethod();
@@ -124,33 +137,53 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
         last_return_pc_ = 0;
         return true;  // Ignore upcalls.
       }
+      uintptr_t return_pc = GetReturnPc();
+      if (return_pc == instrumentation_exit_pc_) {
+        // Installed by an earlier configuration or an entry stub. The instrumentation stack holds
+        // the frames with exit stubs in the order they are walked.
+        CHECK_LT(instrumentation_depth_, instrumentation_stack_->size());
+        if (kVerboseInstrumentation) {
+          LOG(INFO) << "  Keeping exit stub in " << DescribeLocation();
+        }
+        last_return_pc_ = instrumentation_stack_->at(instrumentation_depth_).return_pc_;
+        ++instrumentation_depth_;
+        return true;
+      }
       if (m->IsRuntimeMethod()) {
         if (kVerboseInstrumentation) {
           LOG(INFO) << "  Skipping runtime method. Frame " << GetFrameId();
         }
-        last_return_pc_ = GetReturnPc();
+        last_return_pc_ = return_pc;
         return true;  // Ignore unresolved methods since they will be instrumented after resolution.
       }
+      if (instrumentation_->IsFilteredOut(m)) {
+        last_return_pc_ = return_pc;
+        return true;  // Only methods with entry stubs get exit stubs.
+      }
       if (kVerboseInstrumentation) {
         LOG(INFO) << "  Installing exit stub in " << DescribeLocation();
       }
-      uintptr_t return_pc = GetReturnPc();
-      CHECK_NE(return_pc, instrumentation_exit_pc_);
       CHECK_NE(return_pc, 0U);
       InstrumentationStackFrame instrumentation_frame(GetThisObject(), m, return_pc, GetFrameId(),
                                                       false);
       if (kVerboseInstrumentation) {
         LOG(INFO) << "Pushing frame " << instrumentation_frame.Dump();
       }
-      instrumentation_stack_->push_back(instrumentation_frame);
+      instrumentation_stack_->insert(instrumentation_stack_->begin() + instrumentation_depth_,
+                                     instrumentation_frame);
+      ++instrumentation_depth_;
+      new_frames_.push_back(instrumentation_frame);
       dex_pcs_.push_back(m->ToDexPc(last_return_pc_));
       SetReturnPc(instrumentation_exit_pc_);
       last_return_pc_ = return_pc;
       return true;  // Continue.
     }
     std::deque<InstrumentationStackFrame>* const instrumentation_stack_;
+    std::vector<InstrumentationStackFrame> new_frames_;
     std::vector<uint32_t> dex_pcs_;
     const uintptr_t instrumentation_exit_pc_;
+    const Instrumentation* const instrumentation_;
+    size_t instrumentation_depth_;
     uintptr_t last_return_pc_;
   };
   if (kVerboseInstrumentation) {
@@ -158,21 +191,17 @@ static void InstrumentationInstallStack(Thread* thread, void* arg)
     thread->GetThreadName(thread_name);
     LOG(INFO) << "Installing exit stubs in " << thread_name;
   }
+  Instrumentation* instrumentation = reinterpret_cast<Instrumentation*>(arg);
   UniquePtr<Context> context(Context::Create());
   uintptr_t instrumentation_exit_pc = GetQuickInstrumentationExitPc();
-  InstallStackVisitor visitor(thread, context.get(), instrumentation_exit_pc);
+  InstallStackVisitor visitor(thread, context.get(), instrumentation_exit_pc, instrumentation);
   visitor.WalkStack(true);
 
-  // Create method enter events for all methods current on the thread's stack.
-  Instrumentation* instrumentation = reinterpret_cast<Instrumentation*>(arg);
-  typedef std::deque<InstrumentationStackFrame>::const_reverse_iterator It;
-  for (It it = thread->GetInstrumentationStack()->rbegin(),
-       end = thread->GetInstrumentationStack()->rend(); it != end; ++it) {
-    mirror::Object* this_object = (*it).this_object_;
-    mirror::ArtMethod* method = (*it).method_;
-    uint32_t dex_pc = visitor.dex_pcs_.back();
-    visitor.dex_pcs_.pop_back();
-    instrumentation->MethodEnterEvent(thread, this_object, method, dex_pc);
+  // Create method enter events for the methods that just got exit stubs, outermost first.
+  for (size_t i = visitor.new_frames_.size(); i > 0; --i) {
+    const InstrumentationStackFrame& frame = visitor.new_frames_[i - 1];
+    instrumentation->MethodEnterEvent(thread, frame.this_object_, frame.method_,
+                                      visitor.dex_pcs_[i - 1]);
   }
   thread->VerifyStack();
 }
@@ -258,80 +287,75 @@ static void InstrumentationRestoreStack(Thread* thread, void* arg)
   }
 }
 
+bool Instrumentation::UpdateListeners(const Listeners** listeners,
+                                      InstrumentationListener* listener, bool add) {
+  Listeners* new_listeners = new Listeners(**listeners);
+  if (add) {
+    new_listeners->push_back(listener);
+  } else {
+    new_listeners->erase(std::remove(new_listeners->begin(), new_listeners->end(), listener),
+                         new_listeners->end());
+  }
+  retired_listeners_.push_back(*listeners);
+  *listeners = new_listeners;
+  return !new_listeners->empty();
+}
+
 void Instrumentation::AddListener(InstrumentationListener* listener, uint32_t events) {
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
-  bool require_entry_exit_stubs = false;
-  bool require_interpreter = false;
   if ((events & kMethodEntered) != 0) {
-    method_entry_listeners_.push_back(listener);
-    require_entry_exit_stubs = true;
-    have_method_entry_listeners_ = true;
+    have_method_entry_listeners_ = UpdateListeners(&method_entry_listeners_, listener, true);
   }
   if ((events & kMethodExited) != 0) {
-    method_exit_listeners_.push_back(listener);
-    require_entry_exit_stubs = true;
-    have_method_exit_listeners_ = true;
+    have_method_exit_listeners_ = UpdateListeners(&method_exit_listeners_, listener, true);
   }
   if ((events & kMethodUnwind) != 0) {
-    method_unwind_listeners_.push_back(listener);
-    have_method_unwind_listeners_ = true;
+    have_method_unwind_listeners_ = UpdateListeners(&method_unwind_listeners_, listener, true);
   }
   if ((events & kDexPcMoved) != 0) {
-    dex_pc_listeners_.push_back(listener);
-    require_interpreter = true;
-    have_dex_pc_listeners_ = true;
+    have_dex_pc_listeners_ = UpdateListeners(&dex_pc_listeners_, listener, true);
   }
   if ((events & kExceptionCaught) != 0) {
-    exception_caught_listeners_.push_back(listener);
-    have_exception_caught_listeners_ = true;
+    have_exception_caught_listeners_ =
+        UpdateListeners(&exception_caught_listeners_, listener, true);
   }
-  ConfigureStubs(require_entry_exit_stubs, require_interpreter);
+  UpdateStubs();
 }
 
 void Instrumentation::RemoveListener(InstrumentationListener* listener, uint32_t events) {
   Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
-  bool require_entry_exit_stubs = false;
-  bool require_interpreter = false;
-
   if ((events & kMethodEntered) != 0) {
-    bool contains = std::find(method_entry_listeners_.begin(), method_entry_listeners_.end(),
-                              listener) != method_entry_listeners_.end();
-    if (contains) {
-      method_entry_listeners_.remove(listener);
-    }
-    have_method_entry_listeners_ = method_entry_listeners_.size() > 0;
-    require_entry_exit_stubs |= have_method_entry_listeners_;
+    have_method_entry_listeners_ = UpdateListeners(&method_entry_listeners_, listener, false);
   }
   if ((events & kMethodExited) != 0) {
-    bool contains = std::find(method_exit_listeners_.begin(), method_exit_listeners_.end(),
-                              listener) != method_exit_listeners_.end();
-    if (contains) {
-      method_exit_listeners_.remove(listener);
-    }
-    have_method_exit_listeners_ = method_exit_listeners_.size() > 0;
-    require_entry_exit_stubs |= have_method_exit_listeners_;
+    have_method_exit_listeners_ = UpdateListeners(&method_exit_listeners_, listener, false);
   }
   if ((events & kMethodUnwind) != 0) {
-    method_unwind_listeners_.remove(listener);
+    have_method_unwind_listeners_ = UpdateListeners(&method_unwind_listeners_, listener, false);
   }
   if ((events & kDexPcMoved) != 0) {
-    bool contains = std::find(dex_pc_listeners_.begin(), dex_pc_listeners_.end(),
-                              listener) != dex_pc_listeners_.end();
-    if (contains) {
-      dex_pc_listeners_.remove(listener);
-    }
-    have_dex_pc_listeners_ = dex_pc_listeners_.size() > 0;
-    require_interpreter |= have_dex_pc_listeners_;
+    have_dex_pc_listeners_ = UpdateListeners(&dex_pc_listeners_, listener, false);
   }
   if ((events & kExceptionCaught) != 0) {
-    exception_caught_listeners_.remove(listener);
-    have_exception_caught_listeners_ = exception_caught_listeners_.size() > 0;
+    have_exception_caught_listeners_ =
+        UpdateListeners(&exception_caught_listeners_, listener, false);
   }
+  UpdateStubs();
+}
+
+void Instrumentation::UpdateStubs() {
+  bool require_entry_exit_stubs = have_method_entry_listeners_ || have_method_exit_listeners_ ||
+      !deoptimized_methods_.empty();
+  bool require_interpreter = deoptimization_enabled_ ? deoptimized_everything_
+                                                     : have_dex_pc_listeners_;
   ConfigureStubs(require_entry_exit_stubs, require_interpreter);
 }
 
 void Instrumentation::ConfigureStubs(bool require_entry_exit_stubs, bool require_interpreter) {
   interpret_only_ = require_interpreter || forced_interpret_only_;
+  // Frames returning to deoptimized methods must all have exit stubs.
+  bool filter_methods = !method_filter_.empty() && require_entry_exit_stubs &&
+      !require_interpreter && deoptimized_methods_.empty();
   // Compute what level of instrumentation is required and compare to current.
   int desired_level, current_level;
   if (require_interpreter) {
@@ -348,22 +372,21 @@ void Instrumentation::ConfigureStubs(bool require_entry_exit_stubs, bool require
   } else {
     current_level = 0;
   }
-  if (desired_level == current_level) {
+  if (desired_level == current_level && filter_methods == filter_methods_) {
     // We're already set.
     return;
   }
+  filter_methods_ = filter_methods;
   Thread* self = Thread::Current();
   Runtime* runtime = Runtime::Current();
   Locks::thread_list_lock_->AssertNotHeld(self);
   if (desired_level > 0) {
-    if (require_interpreter) {
-      interpreter_stubs_installed_ = true;
-    } else {
-      CHECK(require_entry_exit_stubs);
-      entry_exit_stubs_installed_ = true;
-    }
+    interpreter_stubs_installed_ = require_interpreter;
+    entry_exit_stubs_installed_ = !require_interpreter;
     runtime->GetClassLinker()->VisitClasses(InstallStubsClassVisitor, this);
     instrumentation_stubs_installed_ = true;
+    // Frames that already have exit stubs keep them, so this also serves to lower the level or to
+    // drop the method filter.
     MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
     runtime->GetThreadList()->ForEach(InstrumentationInstallStack, this);
   } else {
@@ -376,11 +399,82 @@ void Instrumentation::ConfigureStubs(bool require_entry_exit_stubs, bool require
   }
 }
 
+void Instrumentation::EnableDeoptimization() {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  CHECK(!deoptimization_enabled_);
+  deoptimization_enabled_ = true;
+  UpdateStubs();
+}
+
+void Instrumentation::DisableDeoptimization() {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  CHECK(deoptimization_enabled_);
+  deoptimization_enabled_ = false;
+  deoptimized_everything_ = false;
+  std::set<const mirror::ArtMethod*> deoptimized_methods;
+  deoptimized_methods.swap(deoptimized_methods_);
+  UpdateStubs();
+  if (entry_exit_stubs_installed_) {
+    // Unless the level changed, the formerly deoptimized methods still enter the interpreter.
+    for (const mirror::ArtMethod* method : deoptimized_methods) {
+      mirror::ArtMethod* m = const_cast<mirror::ArtMethod*>(method);
+      InstallStubsForMethod(m, m->GetDeclaringClass()->IsInitialized());
+    }
+  }
+}
+
+void Instrumentation::DeoptimizeEverything() {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  CHECK(deoptimization_enabled_);
+  CHECK(!deoptimized_everything_);
+  deoptimized_everything_ = true;
+  UpdateStubs();
+}
+
+void Instrumentation::UndeoptimizeEverything() {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  CHECK(deoptimized_everything_);
+  deoptimized_everything_ = false;
+  UpdateStubs();
+}
+
+void Instrumentation::Deoptimize(mirror::ArtMethod* method) {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  CHECK(deoptimization_enabled_);
+  CHECK(!method->IsNative() && !method->IsProxyMethod() && !method->IsAbstract())
+      << PrettyMethod(method);
+  bool inserted = deoptimized_methods_.insert(method).second;
+  CHECK(inserted) << PrettyMethod(method) << " is already deoptimized";
+  UpdateStubs();
+  if (!interpreter_stubs_installed_) {
+    method->SetEntryPointFromCompiledCode(GetCompiledCodeToInterpreterBridge());
+  }
+}
+
+void Instrumentation::Undeoptimize(mirror::ArtMethod* method) {
+  Locks::mutator_lock_->AssertExclusiveHeld(Thread::Current());
+  size_t erased = deoptimized_methods_.erase(method);
+  CHECK_EQ(erased, 1U) << PrettyMethod(method) << " isn't deoptimized";
+  UpdateStubs();
+  if (entry_exit_stubs_installed_) {
+    InstallStubsForMethod(method, method->GetDeclaringClass()->IsInitialized());
+  }
+}
+
+bool Instrumentation::IsDeoptimized(const mirror::ArtMethod* method) const {
+  return !deoptimized_methods_.empty() &&
+      deoptimized_methods_.find(method) != deoptimized_methods_.end();
+}
+
 void Instrumentation::UpdateMethodsCode(mirror::ArtMethod* method, const void* code) const {
   if (LIKELY(!instrumentation_stubs_installed_)) {
     method->SetEntryPointFromCompiledCode(code);
+  } else if (filter_methods_ && !MatchesMethodFilter(method)) {
+    method->SetInstrumented(false);
+    method->SetEntryPointFromCompiledCode(code);
   } else {
-    if (!interpreter_stubs_installed_ || method->IsNative()) {
+    method->SetInstrumented(true);
+    if ((!interpreter_stubs_installed_ && !IsDeoptimized(method)) || method->IsNative()) {
       method->SetEntryPointFromCompiledCode(GetQuickInstrumentationEntryPoint());
     } else {
       method->SetEntryPointFromCompiledCode(GetCompiledCodeToInterpreterBridge());
@@ -404,36 +498,33 @@ const void* Instrumentation::GetQuickCodeFor(const mirror::ArtMethod* method) co
 void Instrumentation::MethodEnterEventImpl(Thread* thread, mirror::Object* this_object,
                                            const mirror::ArtMethod* method,
                                            uint32_t dex_pc) const {
-  auto it = method_entry_listeners_.begin();
-  bool is_end = (it == method_entry_listeners_.end());
-  // Implemented this way to prevent problems caused by modification of the list while iterating.
-  while (!is_end) {
-    InstrumentationListener* cur = *it;
-    ++it;
-    is_end = (it == method_entry_listeners_.end());
-    cur->MethodEntered(thread, this_object, method, dex_pc);
+  if (IsFilteredOut(method)) {
+    return;
+  }
+  const Listeners* listeners = method_entry_listeners_;
+  for (InstrumentationListener* listener : *listeners) {
+    listener->MethodEntered(thread, this_object, method, dex_pc);
   }
 }
 
 void Instrumentation::MethodExitEventImpl(Thread* thread, mirror::Object* this_object,
                                           const mirror::ArtMethod* method,
                                           uint32_t dex_pc, const JValue& return_value) const {
-  auto it = method_exit_listeners_.begin();
-  bool is_end = (it == method_exit_listeners_.end());
-  // Implemented this way to prevent problems caused by modification of the list while iterating.
-  while (!is_end) {
-    InstrumentationListener* cur = *it;
-    ++it;
-    is_end = (it == method_exit_listeners_.end());
-    cur->MethodExited(thread, this_object, method, dex_pc, return_value);
+  if (IsFilteredOut(method)) {
+    return;
+  }
+  const Listeners* listeners = method_exit_listeners_;
+  for (InstrumentationListener* listener : *listeners) {
+    listener->MethodExited(thread, this_object, method, dex_pc, return_value);
   }
 }
 
 void Instrumentation::MethodUnwindEvent(Thread* thread, mirror::Object* this_object,
                                         const mirror::ArtMethod* method,
                                         uint32_t dex_pc) const {
-  if (have_method_unwind_listeners_) {
-    for (InstrumentationListener* listener : method_unwind_listeners_) {
+  if (have_method_unwind_listeners_ && !IsFilteredOut(method)) {
+    const Listeners* listeners = method_unwind_listeners_;
+    for (InstrumentationListener* listener : *listeners) {
       listener->MethodUnwind(thread, method, dex_pc);
     }
   }
@@ -442,12 +533,8 @@ void Instrumentation::MethodUnwindEvent(Thread* thread, mirror::Object* this_obj
 void Instrumentation::DexPcMovedEventImpl(Thread* thread, mirror::Object* this_object,
                                           const mirror::ArtMethod* method,
                                           uint32_t dex_pc) const {
-  // TODO: STL copy-on-write collection? The copy below is due to the debug listener having an
-  // action where it can remove itself as a listener and break the iterator. The copy only works
-  // around the problem and in general we may have to move to something like reference counting to
-  // ensure listeners are deleted correctly.
-  std::list<InstrumentationListener*> copy(dex_pc_listeners_);
-  for (InstrumentationListener* listener : copy) {
+  const Listeners* listeners = dex_pc_listeners_;
+  for (InstrumentationListener* listener : *listeners) {
     listener->DexPcMoved(thread, this_object, method, dex_pc);
   }
 }
@@ -459,7 +546,8 @@ void Instrumentation::ExceptionCaughtEvent(Thread* thread, const ThrowLocation&
   if (have_exception_caught_listeners_) {
     DCHECK_EQ(thread->GetException(NULL), exception_object);
     thread->ClearException();
-    for (InstrumentationListener* listener : exception_caught_listeners_) {
+    const Listeners* listeners = exception_caught_listeners_;
+    for (InstrumentationListener* listener : *listeners) {
       listener->ExceptionCaught(thread, throw_location, catch_method, catch_dex_pc, exception_object);
     }
     thread->SetException(throw_location, exception_object);
@@ -523,11 +611,13 @@ uint64_t Instrumentation::PopInstrumentationStackFrame(Thread* self, uintptr_t*
   MethodExitEvent(self, this_object, instrumentation_frame.method_, dex_pc, return_value);
 
   bool deoptimize = false;
-  if (interpreter_stubs_installed_) {
-    // Deoptimize unless we're returning to an upcall.
+  if (interpreter_stubs_installed_ || !deoptimized_methods_.empty()) {
+    // Deoptimize unless we're returning to an upcall or, when only some methods are deoptimized,
+    // to another method.
     NthCallerVisitor visitor(self, 1, true);
     visitor.WalkStack(true);
-    deoptimize = visitor.caller != NULL;
+    deoptimize = visitor.caller != NULL &&
+        (interpreter_stubs_installed_ || IsDeoptimized(visitor.caller));
     if (deoptimize && kVerboseInstrumentation) {
       LOG(INFO) << "Deoptimizing into " << PrettyMethod(visitor.caller);
     }
@@ -21,7 +21,9 @@
 #include "locks.h"
 
 #include <stdint.h>
-#include <list>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace art {
 namespace mirror {
@@ -95,7 +97,13 @@ class Instrumentation {
       interpret_only_(false), forced_interpret_only_(false),
       have_method_entry_listeners_(false), have_method_exit_listeners_(false),
       have_method_unwind_listeners_(false), have_dex_pc_listeners_(false),
-      have_exception_caught_listeners_(false) {}
+      have_exception_caught_listeners_(false), filter_methods_(false),
+      deoptimization_enabled_(false), deoptimized_everything_(false),
+      method_entry_listeners_(new Listeners), method_exit_listeners_(new Listeners),
+      method_unwind_listeners_(new Listeners), dex_pc_listeners_(new Listeners),
+      exception_caught_listeners_(new Listeners) {}
+
+  ~Instrumentation();
 
   // Add a listener to be notified of the masked together sent of instrumentation events. This
   // suspend the runtime to install stubs. You are expected to hold the mutator lock as a proxy
@@ -110,6 +118,57 @@ class Instrumentation {
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
 
+  // Enables targeted deoptimization for the debugger. Dex pc listeners then no longer need every
+  // method to be interpreted, only methods passed to Deoptimize are, or all of them between
+  // DeoptimizeEverything and UndeoptimizeEverything. Entry and exit stubs are installed while
+  // any method is deoptimized, so that compiled frames returning to a deoptimized method
+  // continue in the interpreter.
+  void EnableDeoptimization()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
+
+  // Undoes all deoptimization and returns to every dex pc listener requiring the interpreter.
+  void DisableDeoptimization()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
+
+  bool IsDeoptimizationEnabled() const {
+    return deoptimization_enabled_;
+  }
+
+  // Runs every method in the interpreter, as single stepping requires.
+  void DeoptimizeEverything()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
+
+  void UndeoptimizeEverything()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
+
+  // Runs method in the interpreter, including its activations on thread stacks once their
+  // callees return. Used for methods containing breakpoints.
+  void Deoptimize(mirror::ArtMethod* method)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
+
+  void Undeoptimize(mirror::ArtMethod* method)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
+
+  bool IsDeoptimized(const mirror::ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Restricts entry and exit stubs, and so method entry, exit and unwind events, to the methods of
+  // classes whose descriptor starts with class_descriptor_prefix, so that tracing some classes
+  // doesn't slow down all the others. An empty prefix selects every method. The filter doesn't
+  // apply while a listener requires the interpreter, so the debugger still sees every method.
+  // Must be changed while no stubs are installed.
+  void SetMethodFilter(const std::string& class_descriptor_prefix);
+
+  // Are stubs and events for method suppressed by the method filter?
+  bool IsFilteredOut(const mirror::ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Update the code of a method respecting any installed stubs.
   void UpdateMethodsCode(mirror::ArtMethod* method, const void* code) const;
 
@@ -210,11 +269,33 @@ class Instrumentation {
   bool InstallStubsForClass(mirror::Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
+  // The listeners for an event. Arrays are never modified once published, adding or removing a
+  // listener publishes a copy. Event dispatch can then iterate without copying even when a
+  // listener removes itself from within its call-back.
+  typedef std::vector<InstrumentationListener*> Listeners;
+
+  void InstallStubsForMethod(mirror::ArtMethod* method, bool is_initialized)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Does method belong to a class selected by the method filter?
+  bool MatchesMethodFilter(const mirror::ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Publishes a copy of *listeners with listener added or removed. Returns whether the new array
+  // is non-empty.
+  bool UpdateListeners(const Listeners** listeners, InstrumentationListener* listener, bool add)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Does the job of installing or removing instrumentation code within methods.
   void ConfigureStubs(bool require_entry_exit_stubs, bool require_interpreter)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
       LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
 
+  // Configures the stubs required by the current listeners and deoptimization requests.
+  void UpdateStubs()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, Locks::classlinker_classes_lock_);
+
   void MethodEnterEventImpl(Thread* thread, mirror::Object* this_object,
                             const mirror::ArtMethod* method, uint32_t dex_pc) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -260,12 +341,31 @@ class Instrumentation {
   // Do we have any exception caught listeners? Short-cut to avoid taking the instrumentation_lock_.
   bool have_exception_caught_listeners_;
 
-  // The event listeners, written to with the mutator_lock_ exclusively held.
-  std::list<InstrumentationListener*> method_entry_listeners_ GUARDED_BY(Locks::mutator_lock_);
-  std::list<InstrumentationListener*> method_exit_listeners_ GUARDED_BY(Locks::mutator_lock_);
-  std::list<InstrumentationListener*> method_unwind_listeners_ GUARDED_BY(Locks::mutator_lock_);
-  std::list<InstrumentationListener*> dex_pc_listeners_ GUARDED_BY(Locks::mutator_lock_);
-  std::list<InstrumentationListener*> exception_caught_listeners_ GUARDED_BY(Locks::mutator_lock_);
+  // Prefix of the class descriptors selected by the method filter, empty if there's no filter.
+  std::string method_filter_;
+
+  // Are entry and exit stubs only installed for methods selected by the method filter?
+  bool filter_methods_;
+
+  // Has the debugger enabled targeted deoptimization?
+  bool deoptimization_enabled_;
+
+  // Should every method be interpreted while deoptimization is enabled?
+  bool deoptimized_everything_;
+
+  // The methods to run in the interpreter while deoptimization is enabled.
+  std::set<const mirror::ArtMethod*> deoptimized_methods_ GUARDED_BY(Locks::mutator_lock_);
+
+  // The event listeners, swapped with the mutator_lock_ exclusively held.
+  const Listeners* method_entry_listeners_ GUARDED_BY(Locks::mutator_lock_);
+  const Listeners* method_exit_listeners_ GUARDED_BY(Locks::mutator_lock_);
+  const Listeners* method_unwind_listeners_ GUARDED_BY(Locks::mutator_lock_);
+  const Listeners* dex_pc_listeners_ GUARDED_BY(Locks::mutator_lock_);
+  const Listeners* exception_caught_listeners_ GUARDED_BY(Locks::mutator_lock_);
+
+  // Listener arrays that have been replaced. A call-back may still be iterating over one, they're
+  // freed with the instrumentation. Listeners change rarely so this is little memory.
+  std::vector<const Listeners*> retired_listeners_ GUARDED_BY(Locks::mutator_lock_);
 
   DISALLOW_COPY_AND_ASSIGN(Instrumentation);
 };
@@ -282,9 +382,9 @@ struct InstrumentationStackFrame {
 
   mirror::Object* this_object_;
   mirror::ArtMethod* method_;
-  const uintptr_t return_pc_;
-  const size_t frame_id_;
-  const bool interpreter_entry_;
+  uintptr_t return_pc_;
+  size_t frame_id_;
+  bool interpreter_entry_;
 };
 
 }  // namespace instrumentation
@@ -28,64 +28,81 @@
 namespace art {
 
 InternTable::InternTable()
-    : intern_table_lock_("InternTable lock"), is_dirty_(false), allow_new_interns_(true),
+    : intern_table_lock_("InternTable lock"), allow_new_interns_(true),
       new_intern_condition_("New intern condition", intern_table_lock_) {
 }
 
 size_t InternTable::Size() const {
   MutexLock mu(Thread::Current(), intern_table_lock_);
-  return strong_interns_.size() + weak_interns_.size();
+  return strong_interns_.Size() + weak_interns_.Size() + image_interns_.Size();
 }
 
 void InternTable::DumpForSigQuit(std::ostream& os) const {
   MutexLock mu(Thread::Current(), intern_table_lock_);
-  os << "Intern table: " << strong_interns_.size() << " strong; "
-     << weak_interns_.size() << " weak\n";
+  os << "Intern table: " << strong_interns_.Size() << " strong; "
+     << weak_interns_.Size() << " weak; " << image_interns_.Size() << " image\n";
 }
 
+class VisitRootsAdapter {
+ public:
+  VisitRootsAdapter(RootVisitor* visitor, void* arg) : visitor_(visitor), arg_(arg) {}
+
+  void operator()(mirror::String* string) const {
+    visitor_(string, arg_);
+  }
+
+ private:
+  RootVisitor* const visitor_;
+  void* const arg_;
+};
+
 void InternTable::VisitRoots(RootVisitor* visitor, void* arg,
                              bool only_dirty, bool clean_dirty) {
   MutexLock mu(Thread::Current(), intern_table_lock_);
-  if (!only_dirty || is_dirty_) {
-    for (const auto& strong_intern : strong_interns_) {
-      visitor(strong_intern.second, arg);
-    }
-    if (clean_dirty) {
-      is_dirty_ = false;
+  if (only_dirty) {
+    for (mirror::String* string : new_strong_interns_) {
+      visitor(string, arg);
     }
+  } else {
+    strong_interns_.VisitAll(VisitRootsAdapter(visitor, arg));
+  }
+  if (clean_dirty) {
+    new_strong_interns_.clear();
   }
   // Note: we deliberately don't visit the weak_interns_ table and the immutable
   // image roots.
 }
 
+class StringEquals {
+ public:
+  explicit StringEquals(mirror::String* s) : s_(s) {}
+
+  bool operator()(mirror::String* existing_string) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    return existing_string->Equals(s_);
+  }
+
+ private:
+  mirror::String* const s_;
+};
+
 mirror::String* InternTable::Lookup(Table& table, mirror::String* s,
                                     uint32_t hash_code) {
   intern_table_lock_.AssertHeld(Thread::Current());
-  for (auto it = table.find(hash_code), end = table.end(); it != end; ++it) {
-    mirror::String* existing_string = it->second;
-    if (existing_string->Equals(s)) {
-      return existing_string;
-    }
-  }
-  return NULL;
+  return table.Find(hash_code, StringEquals(s));
 }
 
 mirror::String* InternTable::Insert(Table& table, mirror::String* s,
                                     uint32_t hash_code) {
   intern_table_lock_.AssertHeld(Thread::Current());
-  table.insert(std::make_pair(hash_code, s));
+  table.Insert(s, hash_code);
   return s;
 }
 
 void InternTable::Remove(Table& table, const mirror::String* s,
                          uint32_t hash_code) {
   intern_table_lock_.AssertHeld(Thread::Current());
-  for (auto it = table.find(hash_code), end = table.end(); it != end; ++it) {
-    if (it->second == s) {
-      table.erase(it);
-      return;
-    }
-  }
+  table.Erase(const_cast<mirror::String*>(s), hash_code);
 }
 
 static mirror::String* LookupStringFromImage(mirror::String* s)
@@ -137,45 +154,37 @@ mirror::String* InternTable::Insert(mirror::String* s, bool is_strong) {
     new_intern_condition_.WaitHoldingLocks(self);
   }
 
-  if (is_strong) {
-    // Check the strong table for a match.
-    mirror::String* strong = Lookup(strong_interns_, s, hash_code);
-    if (strong != NULL) {
-      return strong;
-    }
-
-    // Mark as dirty so that we rescan the roots.
-    is_dirty_ = true;
+  // Check the strong table for a match.
+  mirror::String* strong = Lookup(strong_interns_, s, hash_code);
+  if (strong != NULL) {
+    return strong;
+  }
 
-    // Check the image for a match.
-    mirror::String* image = LookupStringFromImage(s);
-    if (image != NULL) {
-      return Insert(strong_interns_, image, hash_code);
-    }
+  // Check the image strings we already found, then the image itself. Image strings are neither
+  // strong nor weak roots so they don't dirty the table.
+  mirror::String* image = Lookup(image_interns_, s, hash_code);
+  if (image != NULL) {
+    return image;
+  }
+  image = LookupStringFromImage(s);
+  if (image != NULL) {
+    return Insert(image_interns_, image, hash_code);
+  }
 
+  if (is_strong) {
     // There is no match in the strong table, check the weak table.
     mirror::String* weak = Lookup(weak_interns_, s, hash_code);
     if (weak != NULL) {
       // A match was found in the weak table. Promote to the strong table.
       Remove(weak_interns_, weak, hash_code);
-      return Insert(strong_interns_, weak, hash_code);
+      s = weak;
     }
 
-    // No match in the strong table or the weak table. Insert into the strong
-    // table.
+    // Record the new root so that we rescan it.
+    new_strong_interns_.push_back(s);
     return Insert(strong_interns_, s, hash_code);
   }
 
-  // Check the strong table for a match.
-  mirror::String* strong = Lookup(strong_interns_, s, hash_code);
-  if (strong != NULL) {
-    return strong;
-  }
-  // Check the image for a match.
-  mirror::String* image = LookupStringFromImage(s);
-  if (image != NULL) {
-    return Insert(weak_interns_, image, hash_code);
-  }
   // Check the weak table for a match.
   mirror::String* weak = Lookup(weak_interns_, s, hash_code);
   if (weak != NULL) {
@@ -216,17 +225,22 @@ bool InternTable::ContainsWeak(mirror::String* s) {
   return found == s;
 }
 
+class IsUnmarked {
+ public:
+  IsUnmarked(IsMarkedTester* is_marked, void* arg) : is_marked_(is_marked), arg_(arg) {}
+
+  bool operator()(mirror::String* string) const {
+    return !is_marked_(string, arg_);
+  }
+
+ private:
+  IsMarkedTester* const is_marked_;
+  void* const arg_;
+};
+
 void InternTable::SweepInternTableWeaks(IsMarkedTester is_marked, void* arg) {
   MutexLock mu(Thread::Current(), intern_table_lock_);
-  // TODO: std::remove_if + lambda.
-  for (auto it = weak_interns_.begin(), end = weak_interns_.end(); it != end;) {
-    mirror::Object* object = it->second;
-    if (!is_marked(object, arg)) {
-      weak_interns_.erase(it++);
-    } else {
-      ++it;
-    }
-  }
+  weak_interns_.EraseIf(IsUnmarked(is_marked, arg));
 }
 
 }  // namespace art
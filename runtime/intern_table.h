@@ -17,11 +17,12 @@
 #ifndef ART_RUNTIME_INTERN_TABLE_H_
 #define ART_RUNTIME_INTERN_TABLE_H_
 
+#include <vector>
+
+#include "base/hash_set.h"
 #include "base/mutex.h"
 #include "root_visitor.h"
 
-#include <map>
-
 namespace art {
 namespace mirror {
 class String;
@@ -36,6 +37,9 @@ class String;
  * String.intern. Some code (XML parsers being a prime example) relies on being able to intern
  * arbitrarily many strings for the duration of a parse without permanently increasing the memory
  * footprint.
+ *
+ * Strings of the boot image are found lazily through the image's dex caches and remembered in a
+ * third table, which is neither swept nor visited since image objects never move or die.
  */
 class InternTable {
  public:
@@ -62,6 +66,7 @@ class InternTable {
 
   size_t Size() const;
 
+  // Visits the strong interns, only those inserted since the table was last cleaned if only_dirty.
   void VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, bool clean_dirty);
 
   void DumpForSigQuit(std::ostream& os) const;
@@ -70,7 +75,7 @@ class InternTable {
   void AllowNewInterns() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
-  typedef std::multimap<int32_t, mirror::String*> Table;
+  typedef HashSet<mirror::String*> Table;
 
   mirror::String* Insert(mirror::String* s, bool is_strong)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -81,11 +86,14 @@ class InternTable {
   void Remove(Table& table, const mirror::String* s, uint32_t hash_code);
 
   mutable Mutex intern_table_lock_;
-  bool is_dirty_ GUARDED_BY(intern_table_lock_);
+  // The strong interns inserted since VisitRoots last cleaned the table. Strong interns are never
+  // removed.
+  std::vector<mirror::String*> new_strong_interns_ GUARDED_BY(intern_table_lock_);
   bool allow_new_interns_ GUARDED_BY(intern_table_lock_);
   ConditionVariable new_intern_condition_ GUARDED_BY(intern_table_lock_);
   Table strong_interns_ GUARDED_BY(intern_table_lock_);
   Table weak_interns_ GUARDED_BY(intern_table_lock_);
+  Table image_interns_ GUARDED_BY(intern_table_lock_);
 };
 
 }  // namespace art
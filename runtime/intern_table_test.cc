@@ -117,6 +117,38 @@ TEST_F(InternTableTest, SweepInternTableWeaks) {
   EXPECT_EQ(3U, t.Size());
 }
 
+static void CountRootVisitor(const mirror::Object* root, void* arg) {
+  EXPECT_TRUE(root != NULL);
+  ++*reinterpret_cast<size_t*>(arg);
+}
+
+TEST_F(InternTableTest, VisitRootsOnlyDirty) {
+  ScopedObjectAccess soa(Thread::Current());
+  InternTable t;
+  t.InternStrong(3, "foo");
+  t.InternStrong(3, "bar");
+  size_t count = 0;
+  t.VisitRoots(CountRootVisitor, &count, true, false);
+  EXPECT_EQ(2U, count);
+  count = 0;
+  t.VisitRoots(CountRootVisitor, &count, true, true);
+  EXPECT_EQ(2U, count);
+  // Cleaned, only the roots added since are visited.
+  count = 0;
+  t.VisitRoots(CountRootVisitor, &count, true, true);
+  EXPECT_EQ(0U, count);
+  t.InternStrong(3, "foo");
+  SirtRef<mirror::String> baz(soa.Self(), mirror::String::AllocFromModifiedUtf8(soa.Self(), "baz"));
+  t.InternWeak(baz.get());
+  t.InternStrong(3, "baz");
+  count = 0;
+  t.VisitRoots(CountRootVisitor, &count, true, true);
+  EXPECT_EQ(1U, count);
+  count = 0;
+  t.VisitRoots(CountRootVisitor, &count, false, false);
+  EXPECT_EQ(3U, count);
+}
+
 TEST_F(InternTableTest, ContainsWeak) {
   ScopedObjectAccess soa(Thread::Current());
   {
@@ -0,0 +1,2092 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_INTERPRETER_INTERPRETER_INSTRUCTIONS_H_
+#define ART_RUNTIME_INTERPRETER_INTERPRETER_INSTRUCTIONS_H_
+
+// The handlers of the dex instructions, included in the dispatch loops of both ExecuteImpl and
+// ExecuteGotoImpl. The includer defines how a handler starts and how it moves on to the next
+// instruction:
+//   INSTRUCTION_CASE(code)            starts the handler of Instruction::code.
+//   NEXT_INSTRUCTION()                runs the instruction inst now points to.
+//   NEXT_INSTRUCTION_CHECK_SUSPEND()  same, after a branch or an invoke.
+
+  INSTRUCTION_CASE(NOP)
+    PREAMBLE();
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_12x(),
+                         shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_FROM16)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22x(),
+                         shadow_frame.GetVReg(inst->VRegB_22x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_16)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_32x(),
+                         shadow_frame.GetVReg(inst->VRegB_32x()));
+    inst = inst->Next_3xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_WIDE)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_12x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_WIDE_FROM16)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_22x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_22x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_WIDE_16)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_32x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_32x()));
+    inst = inst->Next_3xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_OBJECT)
+    PREAMBLE();
+    shadow_frame.SetVRegReference(inst->VRegA_12x(),
+                                  shadow_frame.GetVRegReference(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_OBJECT_FROM16)
+    PREAMBLE();
+    shadow_frame.SetVRegReference(inst->VRegA_22x(),
+                                  shadow_frame.GetVRegReference(inst->VRegB_22x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_OBJECT_16)
+    PREAMBLE();
+    shadow_frame.SetVRegReference(inst->VRegA_32x(),
+                                  shadow_frame.GetVRegReference(inst->VRegB_32x()));
+    inst = inst->Next_3xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_RESULT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_11x(), result_register.GetI());
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_RESULT_WIDE)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_11x(), result_register.GetJ());
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_RESULT_OBJECT)
+    PREAMBLE();
+    shadow_frame.SetVRegReference(inst->VRegA_11x(), result_register.GetL());
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MOVE_EXCEPTION) {
+    PREAMBLE();
+    Throwable* exception = self->GetException(NULL);
+    self->ClearException();
+    shadow_frame.SetVRegReference(inst->VRegA_11x(), exception);
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(RETURN_VOID) {
+    PREAMBLE();
+    JValue result;
+    if (UNLIKELY(instrumentation->HasMethodExitListeners())) {
+      instrumentation->MethodExitEvent(self, this_object_ref.get(),
+                                       shadow_frame.GetMethod(), inst->GetDexPc(insns),
+                                       result);
+    }
+    return result;
+  }
+  INSTRUCTION_CASE(RETURN_VOID_BARRIER) {
+    PREAMBLE();
+    ANDROID_MEMBAR_STORE();
+    JValue result;
+    if (UNLIKELY(instrumentation->HasMethodExitListeners())) {
+      instrumentation->MethodExitEvent(self, this_object_ref.get(),
+                                       shadow_frame.GetMethod(), inst->GetDexPc(insns),
+                                       result);
+    }
+    return result;
+  }
+  INSTRUCTION_CASE(RETURN) {
+    PREAMBLE();
+    JValue result;
+    result.SetJ(0);
+    result.SetI(shadow_frame.GetVReg(inst->VRegA_11x()));
+    if (UNLIKELY(instrumentation->HasMethodExitListeners())) {
+      instrumentation->MethodExitEvent(self, this_object_ref.get(),
+                                       shadow_frame.GetMethod(), inst->GetDexPc(insns),
+                                       result);
+    }
+    return result;
+  }
+  INSTRUCTION_CASE(RETURN_WIDE) {
+    PREAMBLE();
+    JValue result;
+    result.SetJ(shadow_frame.GetVRegLong(inst->VRegA_11x()));
+    if (UNLIKELY(instrumentation->HasMethodExitListeners())) {
+      instrumentation->MethodExitEvent(self, this_object_ref.get(),
+                                       shadow_frame.GetMethod(), inst->GetDexPc(insns),
+                                       result);
+    }
+    return result;
+  }
+  INSTRUCTION_CASE(RETURN_OBJECT) {
+    PREAMBLE();
+    JValue result;
+    Object* obj_result = shadow_frame.GetVRegReference(inst->VRegA_11x());
+    result.SetJ(0);
+    result.SetL(obj_result);
+    if (do_assignability_check && obj_result != NULL) {
+      Class* return_type = MethodHelper(shadow_frame.GetMethod()).GetReturnType();
+      if (return_type == NULL) {
+        // Return the pending exception.
+        HANDLE_PENDING_EXCEPTION();
+      }
+      if (!obj_result->VerifierInstanceOf(return_type)) {
+        // This should never happen.
+        self->ThrowNewExceptionF(self->GetCurrentLocationForThrow(),
+                                 "Ljava/lang/VirtualMachineError;",
+                                 "Returning '%s' that is not instance of return type '%s'",
+                                 ClassHelper(obj_result->GetClass()).GetDescriptor(),
+                                 ClassHelper(return_type).GetDescriptor());
+        HANDLE_PENDING_EXCEPTION();
+      }
+    }
+    if (UNLIKELY(instrumentation->HasMethodExitListeners())) {
+      instrumentation->MethodExitEvent(self, this_object_ref.get(),
+                                       shadow_frame.GetMethod(), inst->GetDexPc(insns),
+                                       result);
+    }
+    return result;
+  }
+  INSTRUCTION_CASE(CONST_4) {
+    PREAMBLE();
+    uint4_t dst = inst->VRegA_11n();
+    int4_t val = inst->VRegB_11n();
+    shadow_frame.SetVReg(dst, val);
+    if (val == 0) {
+      shadow_frame.SetVRegReference(dst, NULL);
+    }
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CONST_16) {
+    PREAMBLE();
+    uint8_t dst = inst->VRegA_21s();
+    int16_t val = inst->VRegB_21s();
+    shadow_frame.SetVReg(dst, val);
+    if (val == 0) {
+      shadow_frame.SetVRegReference(dst, NULL);
+    }
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CONST) {
+    PREAMBLE();
+    uint8_t dst = inst->VRegA_31i();
+    int32_t val = inst->VRegB_31i();
+    shadow_frame.SetVReg(dst, val);
+    if (val == 0) {
+      shadow_frame.SetVRegReference(dst, NULL);
+    }
+    inst = inst->Next_3xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CONST_HIGH16) {
+    PREAMBLE();
+    uint8_t dst = inst->VRegA_21h();
+    int32_t val = static_cast<int32_t>(inst->VRegB_21h() << 16);
+    shadow_frame.SetVReg(dst, val);
+    if (val == 0) {
+      shadow_frame.SetVRegReference(dst, NULL);
+    }
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CONST_WIDE_16)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_21s(), inst->VRegB_21s());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(CONST_WIDE_32)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_31i(), inst->VRegB_31i());
+    inst = inst->Next_3xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(CONST_WIDE)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_51l(), inst->VRegB_51l());
+    inst = inst->Next_51l();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(CONST_WIDE_HIGH16)
+    shadow_frame.SetVRegLong(inst->VRegA_21h(),
+                             static_cast<uint64_t>(inst->VRegB_21h()) << 48);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(CONST_STRING) {
+    PREAMBLE();
+    String* s = ResolveString(self, mh,  inst->VRegB_21c());
+    if (UNLIKELY(s == NULL)) {
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      shadow_frame.SetVRegReference(inst->VRegA_21c(), s);
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CONST_STRING_JUMBO) {
+    PREAMBLE();
+    String* s = ResolveString(self, mh,  inst->VRegB_31c());
+    if (UNLIKELY(s == NULL)) {
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      shadow_frame.SetVRegReference(inst->VRegA_31c(), s);
+      inst = inst->Next_3xx();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CONST_CLASS) {
+    PREAMBLE();
+    Class* c = ResolveVerifyAndClinit(inst->VRegB_21c(), shadow_frame.GetMethod(),
+                                      self, false, do_access_check);
+    if (UNLIKELY(c == NULL)) {
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      shadow_frame.SetVRegReference(inst->VRegA_21c(), c);
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(MONITOR_ENTER) {
+    PREAMBLE();
+    Object* obj = shadow_frame.GetVRegReference(inst->VRegA_11x());
+    if (UNLIKELY(obj == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      DoMonitorEnter(self, obj);
+      POSSIBLY_HANDLE_PENDING_EXCEPTION(self->IsExceptionPending(), Next_1xx);
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(MONITOR_EXIT) {
+    PREAMBLE();
+    Object* obj = shadow_frame.GetVRegReference(inst->VRegA_11x());
+    if (UNLIKELY(obj == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      DoMonitorExit(self, obj);
+      POSSIBLY_HANDLE_PENDING_EXCEPTION(self->IsExceptionPending(), Next_1xx);
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CHECK_CAST) {
+    PREAMBLE();
+    Class* c = ResolveVerifyAndClinit(inst->VRegB_21c(), shadow_frame.GetMethod(),
+                                      self, false, do_access_check);
+    if (UNLIKELY(c == NULL)) {
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      Object* obj = shadow_frame.GetVRegReference(inst->VRegA_21c());
+      if (UNLIKELY(obj != NULL && !InstanceOf(self, obj, c))) {
+        ThrowClassCastException(c, obj->GetClass());
+        HANDLE_PENDING_EXCEPTION();
+      } else {
+        inst = inst->Next_2xx();
+      }
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(INSTANCE_OF) {
+    PREAMBLE();
+    Class* c = ResolveVerifyAndClinit(inst->VRegC_22c(), shadow_frame.GetMethod(),
+                                      self, false, do_access_check);
+    if (UNLIKELY(c == NULL)) {
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      Object* obj = shadow_frame.GetVRegReference(inst->VRegB_22c());
+      shadow_frame.SetVReg(inst->VRegA_22c(), (obj != NULL && InstanceOf(self, obj, c)) ? 1 : 0);
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(ARRAY_LENGTH) {
+    PREAMBLE();
+    Object* array = shadow_frame.GetVRegReference(inst->VRegB_12x());
+    if (UNLIKELY(array == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      shadow_frame.SetVReg(inst->VRegA_12x(), array->AsArray()->GetLength());
+      inst = inst->Next_1xx();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(NEW_INSTANCE) {
+    PREAMBLE();
+    Object* obj = AllocObjectFromCode(inst->VRegB_21c(), shadow_frame.GetMethod(),
+                                      self, do_access_check);
+    if (UNLIKELY(obj == NULL)) {
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      shadow_frame.SetVRegReference(inst->VRegA_21c(), obj);
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(NEW_ARRAY) {
+    PREAMBLE();
+    int32_t length = shadow_frame.GetVReg(inst->VRegB_22c());
+    Object* obj = AllocArrayFromCode(inst->VRegC_22c(), shadow_frame.GetMethod(),
+                                     length, self, do_access_check);
+    if (UNLIKELY(obj == NULL)) {
+      HANDLE_PENDING_EXCEPTION();
+    } else {
+      shadow_frame.SetVRegReference(inst->VRegA_22c(), obj);
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(FILLED_NEW_ARRAY) {
+    PREAMBLE();
+    bool success = DoFilledNewArray<false, do_access_check>(inst, shadow_frame,
+                                                            self, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(FILLED_NEW_ARRAY_RANGE) {
+    PREAMBLE();
+    bool success = DoFilledNewArray<true, do_access_check>(inst, shadow_frame,
+                                                           self, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(FILL_ARRAY_DATA) {
+    PREAMBLE();
+    const uint16_t* payload_addr = reinterpret_cast<const uint16_t*>(inst) + inst->VRegB_31t();
+    const Instruction::ArrayDataPayload* payload =
+        reinterpret_cast<const Instruction::ArrayDataPayload*>(payload_addr);
+    Array* array =
+        CheckFillArrayData(self, shadow_frame.GetVRegReference(inst->VRegA_31t()), payload);
+    if (UNLIKELY(array == NULL)) {
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    RecordArrayWrite(self, array, 0, payload->element_count);
+    FillArrayData(array, payload);
+    inst = inst->Next_3xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(THROW) {
+    PREAMBLE();
+    Object* exception = shadow_frame.GetVRegReference(inst->VRegA_11x());
+    if (UNLIKELY(exception == NULL)) {
+      ThrowNullPointerException(NULL, "throw with null exception");
+    } else if (do_assignability_check && !exception->GetClass()->IsThrowableClass()) {
+      // This should never happen.
+      self->ThrowNewExceptionF(self->GetCurrentLocationForThrow(),
+                               "Ljava/lang/VirtualMachineError;",
+                               "Throwing '%s' that is not instance of Throwable",
+                               ClassHelper(exception->GetClass()).GetDescriptor());
+    } else {
+      self->SetException(shadow_frame.GetCurrentLocationForThrow(), exception->AsThrowable());
+    }
+    HANDLE_PENDING_EXCEPTION();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(GOTO) {
+    PREAMBLE();
+    inst = inst->RelativeAt(inst->VRegA_10t());
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(GOTO_16) {
+    PREAMBLE();
+    inst = inst->RelativeAt(inst->VRegA_20t());
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(GOTO_32) {
+    PREAMBLE();
+    inst = inst->RelativeAt(inst->VRegA_30t());
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(PACKED_SWITCH) {
+    PREAMBLE();
+    const uint16_t* switch_data = reinterpret_cast<const uint16_t*>(inst) + inst->VRegB_31t();
+    int32_t test_val = shadow_frame.GetVReg(inst->VRegA_31t());
+    DCHECK_EQ(switch_data[0], static_cast<uint16_t>(Instruction::kPackedSwitchSignature));
+    uint16_t size = switch_data[1];
+    DCHECK_GT(size, 0);
+    const int32_t* keys = reinterpret_cast<const int32_t*>(&switch_data[2]);
+    DCHECK(IsAligned<4>(keys));
+    int32_t first_key = keys[0];
+    const int32_t* targets = reinterpret_cast<const int32_t*>(&switch_data[4]);
+    DCHECK(IsAligned<4>(targets));
+    int32_t index = test_val - first_key;
+    if (index >= 0 && index < size) {
+      inst = inst->RelativeAt(targets[index]);
+    } else {
+      inst = inst->Next_3xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(SPARSE_SWITCH) {
+    PREAMBLE();
+    inst = DoSparseSwitch(inst, shadow_frame);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(CMPL_FLOAT) {
+    PREAMBLE();
+    float val1 = shadow_frame.GetVRegFloat(inst->VRegB_23x());
+    float val2 = shadow_frame.GetVRegFloat(inst->VRegC_23x());
+    int32_t result;
+    if (val1 > val2) {
+      result = 1;
+    } else if (val1 == val2) {
+      result = 0;
+    } else {
+      result = -1;
+    }
+    shadow_frame.SetVReg(inst->VRegA_23x(), result);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CMPG_FLOAT) {
+    PREAMBLE();
+    float val1 = shadow_frame.GetVRegFloat(inst->VRegB_23x());
+    float val2 = shadow_frame.GetVRegFloat(inst->VRegC_23x());
+    int32_t result;
+    if (val1 < val2) {
+      result = -1;
+    } else if (val1 == val2) {
+      result = 0;
+    } else {
+      result = 1;
+    }
+    shadow_frame.SetVReg(inst->VRegA_23x(), result);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CMPL_DOUBLE) {
+    PREAMBLE();
+    double val1 = shadow_frame.GetVRegDouble(inst->VRegB_23x());
+    double val2 = shadow_frame.GetVRegDouble(inst->VRegC_23x());
+    int32_t result;
+    if (val1 > val2) {
+      result = 1;
+    } else if (val1 == val2) {
+      result = 0;
+    } else {
+      result = -1;
+    }
+    shadow_frame.SetVReg(inst->VRegA_23x(), result);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  }
+
+  INSTRUCTION_CASE(CMPG_DOUBLE) {
+    PREAMBLE();
+    double val1 = shadow_frame.GetVRegDouble(inst->VRegB_23x());
+    double val2 = shadow_frame.GetVRegDouble(inst->VRegC_23x());
+    int32_t result;
+    if (val1 < val2) {
+      result = -1;
+    } else if (val1 == val2) {
+      result = 0;
+    } else {
+      result = 1;
+    }
+    shadow_frame.SetVReg(inst->VRegA_23x(), result);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(CMP_LONG) {
+    PREAMBLE();
+    int64_t val1 = shadow_frame.GetVRegLong(inst->VRegB_23x());
+    int64_t val2 = shadow_frame.GetVRegLong(inst->VRegC_23x());
+    int32_t result;
+    if (val1 > val2) {
+      result = 1;
+    } else if (val1 == val2) {
+      result = 0;
+    } else {
+      result = -1;
+    }
+    shadow_frame.SetVReg(inst->VRegA_23x(), result);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IF_EQ) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_22t()) == shadow_frame.GetVReg(inst->VRegB_22t())) {
+      inst = inst->RelativeAt(inst->VRegC_22t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_NE) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_22t()) != shadow_frame.GetVReg(inst->VRegB_22t())) {
+      inst = inst->RelativeAt(inst->VRegC_22t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_LT) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_22t()) < shadow_frame.GetVReg(inst->VRegB_22t())) {
+      inst = inst->RelativeAt(inst->VRegC_22t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_GE) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_22t()) >= shadow_frame.GetVReg(inst->VRegB_22t())) {
+      inst = inst->RelativeAt(inst->VRegC_22t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_GT) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_22t()) > shadow_frame.GetVReg(inst->VRegB_22t())) {
+      inst = inst->RelativeAt(inst->VRegC_22t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_LE) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_22t()) <= shadow_frame.GetVReg(inst->VRegB_22t())) {
+      inst = inst->RelativeAt(inst->VRegC_22t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_EQZ) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_21t()) == 0) {
+      inst = inst->RelativeAt(inst->VRegB_21t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_NEZ) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_21t()) != 0) {
+      inst = inst->RelativeAt(inst->VRegB_21t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_LTZ) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_21t()) < 0) {
+      inst = inst->RelativeAt(inst->VRegB_21t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_GEZ) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_21t()) >= 0) {
+      inst = inst->RelativeAt(inst->VRegB_21t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_GTZ) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_21t()) > 0) {
+      inst = inst->RelativeAt(inst->VRegB_21t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(IF_LEZ) {
+    PREAMBLE();
+    if (shadow_frame.GetVReg(inst->VRegA_21t()) <= 0) {
+      inst = inst->RelativeAt(inst->VRegB_21t());
+    } else {
+      inst = inst->Next_2xx();
+    }
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(AGET_BOOLEAN) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    BooleanArray* array = a->AsBooleanArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      shadow_frame.SetVReg(inst->VRegA_23x(), array->GetData()[index]);
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AGET_BYTE) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    ByteArray* array = a->AsByteArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      shadow_frame.SetVReg(inst->VRegA_23x(), array->GetData()[index]);
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AGET_CHAR) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    CharArray* array = a->AsCharArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      shadow_frame.SetVReg(inst->VRegA_23x(), array->GetData()[index]);
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AGET_SHORT) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    ShortArray* array = a->AsShortArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      shadow_frame.SetVReg(inst->VRegA_23x(), array->GetData()[index]);
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AGET) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    IntArray* array = a->AsIntArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      shadow_frame.SetVReg(inst->VRegA_23x(), array->GetData()[index]);
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AGET_WIDE) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    LongArray* array = a->AsLongArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      shadow_frame.SetVRegLong(inst->VRegA_23x(), array->GetData()[index]);
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AGET_OBJECT) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    ObjectArray<Object>* array = a->AsObjectArray<Object>();
+    if (LIKELY(array->IsValidIndex(index))) {
+      shadow_frame.SetVRegReference(inst->VRegA_23x(), array->GetWithoutChecks(index));
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(APUT_BOOLEAN) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    uint8_t val = shadow_frame.GetVReg(inst->VRegA_23x());
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    BooleanArray* array = a->AsBooleanArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      RecordArrayWrite(self, array, index, 1);
+      array->GetData()[index] = val;
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(APUT_BYTE) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int8_t val = shadow_frame.GetVReg(inst->VRegA_23x());
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    ByteArray* array = a->AsByteArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      RecordArrayWrite(self, array, index, 1);
+      array->GetData()[index] = val;
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(APUT_CHAR) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    uint16_t val = shadow_frame.GetVReg(inst->VRegA_23x());
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    CharArray* array = a->AsCharArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      RecordArrayWrite(self, array, index, 1);
+      array->GetData()[index] = val;
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(APUT_SHORT) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int16_t val = shadow_frame.GetVReg(inst->VRegA_23x());
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    ShortArray* array = a->AsShortArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      RecordArrayWrite(self, array, index, 1);
+      array->GetData()[index] = val;
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(APUT) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t val = shadow_frame.GetVReg(inst->VRegA_23x());
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    IntArray* array = a->AsIntArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      RecordArrayWrite(self, array, index, 1);
+      array->GetData()[index] = val;
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(APUT_WIDE) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int64_t val = shadow_frame.GetVRegLong(inst->VRegA_23x());
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    LongArray* array = a->AsLongArray();
+    if (LIKELY(array->IsValidIndex(index))) {
+      RecordArrayWrite(self, array, index, 1);
+      array->GetData()[index] = val;
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(APUT_OBJECT) {
+    PREAMBLE();
+    Object* a = shadow_frame.GetVRegReference(inst->VRegB_23x());
+    if (UNLIKELY(a == NULL)) {
+      ThrowNullPointerExceptionFromDexPC(shadow_frame.GetCurrentLocationForThrow());
+      HANDLE_PENDING_EXCEPTION();
+      NEXT_INSTRUCTION();
+    }
+    int32_t index = shadow_frame.GetVReg(inst->VRegC_23x());
+    Object* val = shadow_frame.GetVRegReference(inst->VRegA_23x());
+    ObjectArray<Object>* array = a->AsObjectArray<Object>();
+    if (LIKELY(array->IsValidIndex(index) && array->CheckAssignable(val))) {
+      RecordArrayWrite(self, array, index, 1);
+      array->SetWithoutChecks(index, val);
+      inst = inst->Next_2xx();
+    } else {
+      HANDLE_PENDING_EXCEPTION();
+    }
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_BOOLEAN) {
+    PREAMBLE();
+    bool success = DoFieldGet<InstancePrimitiveRead, Primitive::kPrimBoolean, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_BYTE) {
+    PREAMBLE();
+    bool success = DoFieldGet<InstancePrimitiveRead, Primitive::kPrimByte, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_CHAR) {
+    PREAMBLE();
+    bool success = DoFieldGet<InstancePrimitiveRead, Primitive::kPrimChar, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_SHORT) {
+    PREAMBLE();
+    bool success = DoFieldGet<InstancePrimitiveRead, Primitive::kPrimShort, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET) {
+    PREAMBLE();
+    bool success = DoFieldGet<InstancePrimitiveRead, Primitive::kPrimInt, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_WIDE) {
+    PREAMBLE();
+    bool success = DoFieldGet<InstancePrimitiveRead, Primitive::kPrimLong, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_OBJECT) {
+    PREAMBLE();
+    bool success = DoFieldGet<InstanceObjectRead, Primitive::kPrimNot, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_QUICK) {
+    PREAMBLE();
+    bool success = DoIGetQuick<Primitive::kPrimInt>(self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_WIDE_QUICK) {
+    PREAMBLE();
+    bool success = DoIGetQuick<Primitive::kPrimLong>(self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IGET_OBJECT_QUICK) {
+    PREAMBLE();
+    bool success = DoIGetQuick<Primitive::kPrimNot>(self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SGET_QUICK)
+    PREAMBLE();
+    DoStaticFieldAccessQuick<Primitive::kPrimInt, false>(shadow_frame, inst);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SGET_WIDE_QUICK)
+    PREAMBLE();
+    DoStaticFieldAccessQuick<Primitive::kPrimLong, false>(shadow_frame, inst);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SGET_OBJECT_QUICK)
+    PREAMBLE();
+    DoStaticFieldAccessQuick<Primitive::kPrimNot, false>(shadow_frame, inst);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SGET_BOOLEAN) {
+    PREAMBLE();
+    bool success = DoFieldGet<StaticPrimitiveRead, Primitive::kPrimBoolean, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SGET_BYTE) {
+    PREAMBLE();
+    bool success = DoFieldGet<StaticPrimitiveRead, Primitive::kPrimByte, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SGET_CHAR) {
+    PREAMBLE();
+    bool success = DoFieldGet<StaticPrimitiveRead, Primitive::kPrimChar, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SGET_SHORT) {
+    PREAMBLE();
+    bool success = DoFieldGet<StaticPrimitiveRead, Primitive::kPrimShort, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SGET) {
+    PREAMBLE();
+    bool success = DoFieldGet<StaticPrimitiveRead, Primitive::kPrimInt, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SGET_WIDE) {
+    PREAMBLE();
+    bool success = DoFieldGet<StaticPrimitiveRead, Primitive::kPrimLong, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SGET_OBJECT) {
+    PREAMBLE();
+    bool success = DoFieldGet<StaticObjectRead, Primitive::kPrimNot, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_BOOLEAN) {
+    PREAMBLE();
+    bool success = DoFieldPut<InstancePrimitiveWrite, Primitive::kPrimBoolean, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_BYTE) {
+    PREAMBLE();
+    bool success = DoFieldPut<InstancePrimitiveWrite, Primitive::kPrimByte, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_CHAR) {
+    PREAMBLE();
+    bool success = DoFieldPut<InstancePrimitiveWrite, Primitive::kPrimChar, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_SHORT) {
+    PREAMBLE();
+    bool success = DoFieldPut<InstancePrimitiveWrite, Primitive::kPrimShort, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT) {
+    PREAMBLE();
+    bool success = DoFieldPut<InstancePrimitiveWrite, Primitive::kPrimInt, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_WIDE) {
+    PREAMBLE();
+    bool success = DoFieldPut<InstancePrimitiveWrite, Primitive::kPrimLong, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_OBJECT) {
+    PREAMBLE();
+    bool success = DoFieldPut<InstanceObjectWrite, Primitive::kPrimNot, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_QUICK) {
+    PREAMBLE();
+    bool success = DoIPutQuick<Primitive::kPrimInt>(self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_WIDE_QUICK) {
+    PREAMBLE();
+    bool success = DoIPutQuick<Primitive::kPrimLong>(self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(IPUT_OBJECT_QUICK) {
+    PREAMBLE();
+    bool success = DoIPutQuick<Primitive::kPrimNot>(self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SPUT_QUICK)
+    PREAMBLE();
+    DoStaticFieldAccessQuick<Primitive::kPrimInt, true>(shadow_frame, inst);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SPUT_WIDE_QUICK)
+    PREAMBLE();
+    DoStaticFieldAccessQuick<Primitive::kPrimLong, true>(shadow_frame, inst);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SPUT_OBJECT_QUICK)
+    PREAMBLE();
+    DoStaticFieldAccessQuick<Primitive::kPrimNot, true>(shadow_frame, inst);
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SPUT_BOOLEAN) {
+    PREAMBLE();
+    bool success = DoFieldPut<StaticPrimitiveWrite, Primitive::kPrimBoolean, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SPUT_BYTE) {
+    PREAMBLE();
+    bool success = DoFieldPut<StaticPrimitiveWrite, Primitive::kPrimByte, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SPUT_CHAR) {
+    PREAMBLE();
+    bool success = DoFieldPut<StaticPrimitiveWrite, Primitive::kPrimChar, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SPUT_SHORT) {
+    PREAMBLE();
+    bool success = DoFieldPut<StaticPrimitiveWrite, Primitive::kPrimShort, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SPUT) {
+    PREAMBLE();
+    bool success = DoFieldPut<StaticPrimitiveWrite, Primitive::kPrimInt, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SPUT_WIDE) {
+    PREAMBLE();
+    bool success = DoFieldPut<StaticPrimitiveWrite, Primitive::kPrimLong, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SPUT_OBJECT) {
+    PREAMBLE();
+    bool success = DoFieldPut<StaticObjectWrite, Primitive::kPrimNot, do_access_check>(
+        self, shadow_frame, inst);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(INVOKE_VIRTUAL) {
+    PREAMBLE();
+    bool success = DoInvoke<kVirtual, false, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_VIRTUAL_RANGE) {
+    PREAMBLE();
+    bool success = DoInvoke<kVirtual, true, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_SUPER) {
+    PREAMBLE();
+    bool success = DoInvoke<kSuper, false, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_SUPER_RANGE) {
+    PREAMBLE();
+    bool success = DoInvoke<kSuper, true, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_DIRECT) {
+    PREAMBLE();
+    bool success = DoInvoke<kDirect, false, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_DIRECT_RANGE) {
+    PREAMBLE();
+    bool success = DoInvoke<kDirect, true, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_INTERFACE) {
+    PREAMBLE();
+    bool success = DoInvoke<kInterface, false, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_INTERFACE_RANGE) {
+    PREAMBLE();
+    bool success = DoInvoke<kInterface, true, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_STATIC) {
+    PREAMBLE();
+    bool success = DoInvoke<kStatic, false, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_STATIC_RANGE) {
+    PREAMBLE();
+    bool success = DoInvoke<kStatic, true, do_access_check>(
+        self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_VIRTUAL_QUICK) {
+    PREAMBLE();
+    bool success = DoInvokeVirtualQuick<false, false>(self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_VIRTUAL_RANGE_QUICK) {
+    PREAMBLE();
+    bool success = DoInvokeVirtualQuick<true, false>(self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_SUPER_QUICK) {
+    PREAMBLE();
+    bool success = DoInvokeVirtualQuick<false, true>(self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(INVOKE_SUPER_RANGE_QUICK) {
+    PREAMBLE();
+    bool success = DoInvokeVirtualQuick<true, true>(self, shadow_frame, inst, &result_register);
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_3xx);
+    NEXT_INSTRUCTION_CHECK_SUSPEND();
+  }
+  INSTRUCTION_CASE(NEG_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_12x(), -shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(NOT_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_12x(), ~shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(NEG_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_12x(), -shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(NOT_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_12x(), ~shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(NEG_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_12x(), -shadow_frame.GetVRegFloat(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(NEG_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_12x(), -shadow_frame.GetVRegDouble(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(INT_TO_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_12x(), shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(INT_TO_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_12x(), shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(INT_TO_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_12x(), shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(LONG_TO_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_12x(), shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(LONG_TO_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_12x(), shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(LONG_TO_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_12x(), shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(FLOAT_TO_INT) {
+    PREAMBLE();
+    float val = shadow_frame.GetVRegFloat(inst->VRegB_12x());
+    int32_t result;
+    if (val != val) {
+      result = 0;
+    } else if (val > static_cast<float>(kMaxInt)) {
+      result = kMaxInt;
+    } else if (val < static_cast<float>(kMinInt)) {
+      result = kMinInt;
+    } else {
+      result = val;
+    }
+    shadow_frame.SetVReg(inst->VRegA_12x(), result);
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(FLOAT_TO_LONG) {
+    PREAMBLE();
+    float val = shadow_frame.GetVRegFloat(inst->VRegB_12x());
+    int64_t result;
+    if (val != val) {
+      result = 0;
+    } else if (val > static_cast<float>(kMaxLong)) {
+      result = kMaxLong;
+    } else if (val < static_cast<float>(kMinLong)) {
+      result = kMinLong;
+    } else {
+      result = val;
+    }
+    shadow_frame.SetVRegLong(inst->VRegA_12x(), result);
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(FLOAT_TO_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_12x(), shadow_frame.GetVRegFloat(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(DOUBLE_TO_INT) {
+    PREAMBLE();
+    double val = shadow_frame.GetVRegDouble(inst->VRegB_12x());
+    int32_t result;
+    if (val != val) {
+      result = 0;
+    } else if (val > static_cast<double>(kMaxInt)) {
+      result = kMaxInt;
+    } else if (val < static_cast<double>(kMinInt)) {
+      result = kMinInt;
+    } else {
+      result = val;
+    }
+    shadow_frame.SetVReg(inst->VRegA_12x(), result);
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(DOUBLE_TO_LONG) {
+    PREAMBLE();
+    double val = shadow_frame.GetVRegDouble(inst->VRegB_12x());
+    int64_t result;
+    if (val != val) {
+      result = 0;
+    } else if (val > static_cast<double>(kMaxLong)) {
+      result = kMaxLong;
+    } else if (val < static_cast<double>(kMinLong)) {
+      result = kMinLong;
+    } else {
+      result = val;
+    }
+    shadow_frame.SetVRegLong(inst->VRegA_12x(), result);
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(DOUBLE_TO_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_12x(), shadow_frame.GetVRegDouble(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(INT_TO_BYTE)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_12x(),
+                         static_cast<int8_t>(shadow_frame.GetVReg(inst->VRegB_12x())));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(INT_TO_CHAR)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_12x(),
+                         static_cast<uint16_t>(shadow_frame.GetVReg(inst->VRegB_12x())));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(INT_TO_SHORT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_12x(),
+                         static_cast<int16_t>(shadow_frame.GetVReg(inst->VRegB_12x())));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(ADD_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         shadow_frame.GetVReg(inst->VRegB_23x()) +
+                         shadow_frame.GetVReg(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SUB_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         shadow_frame.GetVReg(inst->VRegB_23x()) -
+                         shadow_frame.GetVReg(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MUL_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         shadow_frame.GetVReg(inst->VRegB_23x()) *
+                         shadow_frame.GetVReg(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(DIV_INT) {
+    PREAMBLE();
+    bool success = DoIntDivide(shadow_frame, inst->VRegA_23x(),
+                               shadow_frame.GetVReg(inst->VRegB_23x()),
+                               shadow_frame.GetVReg(inst->VRegC_23x()));
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(REM_INT) {
+    PREAMBLE();
+    bool success = DoIntRemainder(shadow_frame, inst->VRegA_23x(),
+                                  shadow_frame.GetVReg(inst->VRegB_23x()),
+                                  shadow_frame.GetVReg(inst->VRegC_23x()));
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SHL_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         shadow_frame.GetVReg(inst->VRegB_23x()) <<
+                         (shadow_frame.GetVReg(inst->VRegC_23x()) & 0x1f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SHR_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         shadow_frame.GetVReg(inst->VRegB_23x()) >>
+                         (shadow_frame.GetVReg(inst->VRegC_23x()) & 0x1f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(USHR_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         static_cast<uint32_t>(shadow_frame.GetVReg(inst->VRegB_23x())) >>
+                         (shadow_frame.GetVReg(inst->VRegC_23x()) & 0x1f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(AND_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         shadow_frame.GetVReg(inst->VRegB_23x()) &
+                         shadow_frame.GetVReg(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(OR_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         shadow_frame.GetVReg(inst->VRegB_23x()) |
+                         shadow_frame.GetVReg(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(XOR_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_23x(),
+                         shadow_frame.GetVReg(inst->VRegB_23x()) ^
+                         shadow_frame.GetVReg(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(ADD_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_23x()) +
+                             shadow_frame.GetVRegLong(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SUB_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_23x()) -
+                             shadow_frame.GetVRegLong(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MUL_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_23x()) *
+                             shadow_frame.GetVRegLong(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(DIV_LONG)
+    PREAMBLE();
+    DoLongDivide(shadow_frame, inst->VRegA_23x(),
+                 shadow_frame.GetVRegLong(inst->VRegB_23x()),
+                shadow_frame.GetVRegLong(inst->VRegC_23x()));
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(self->IsExceptionPending(), Next_2xx);
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(REM_LONG)
+    PREAMBLE();
+    DoLongRemainder(shadow_frame, inst->VRegA_23x(),
+                    shadow_frame.GetVRegLong(inst->VRegB_23x()),
+                    shadow_frame.GetVRegLong(inst->VRegC_23x()));
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(self->IsExceptionPending(), Next_2xx);
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(AND_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_23x()) &
+                             shadow_frame.GetVRegLong(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(OR_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_23x()) |
+                             shadow_frame.GetVRegLong(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(XOR_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_23x()) ^
+                             shadow_frame.GetVRegLong(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SHL_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_23x()) <<
+                             (shadow_frame.GetVReg(inst->VRegC_23x()) & 0x3f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SHR_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             shadow_frame.GetVRegLong(inst->VRegB_23x()) >>
+                             (shadow_frame.GetVReg(inst->VRegC_23x()) & 0x3f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(USHR_LONG)
+    PREAMBLE();
+    shadow_frame.SetVRegLong(inst->VRegA_23x(),
+                             static_cast<uint64_t>(shadow_frame.GetVRegLong(inst->VRegB_23x())) >>
+                             (shadow_frame.GetVReg(inst->VRegC_23x()) & 0x3f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(ADD_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_23x(),
+                              shadow_frame.GetVRegFloat(inst->VRegB_23x()) +
+                              shadow_frame.GetVRegFloat(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SUB_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_23x(),
+                              shadow_frame.GetVRegFloat(inst->VRegB_23x()) -
+                              shadow_frame.GetVRegFloat(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MUL_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_23x(),
+                              shadow_frame.GetVRegFloat(inst->VRegB_23x()) *
+                              shadow_frame.GetVRegFloat(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(DIV_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_23x(),
+                              shadow_frame.GetVRegFloat(inst->VRegB_23x()) /
+                              shadow_frame.GetVRegFloat(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(REM_FLOAT)
+    PREAMBLE();
+    shadow_frame.SetVRegFloat(inst->VRegA_23x(),
+                              fmodf(shadow_frame.GetVRegFloat(inst->VRegB_23x()),
+                                    shadow_frame.GetVRegFloat(inst->VRegC_23x())));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(ADD_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_23x(),
+                               shadow_frame.GetVRegDouble(inst->VRegB_23x()) +
+                               shadow_frame.GetVRegDouble(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SUB_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_23x(),
+                               shadow_frame.GetVRegDouble(inst->VRegB_23x()) -
+                               shadow_frame.GetVRegDouble(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MUL_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_23x(),
+                               shadow_frame.GetVRegDouble(inst->VRegB_23x()) *
+                               shadow_frame.GetVRegDouble(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(DIV_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_23x(),
+                               shadow_frame.GetVRegDouble(inst->VRegB_23x()) /
+                               shadow_frame.GetVRegDouble(inst->VRegC_23x()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(REM_DOUBLE)
+    PREAMBLE();
+    shadow_frame.SetVRegDouble(inst->VRegA_23x(),
+                               fmod(shadow_frame.GetVRegDouble(inst->VRegB_23x()),
+                                    shadow_frame.GetVRegDouble(inst->VRegC_23x())));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(ADD_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         shadow_frame.GetVReg(vregA) +
+                         shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SUB_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         shadow_frame.GetVReg(vregA) -
+                         shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(MUL_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         shadow_frame.GetVReg(vregA) *
+                         shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(DIV_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    bool success = DoIntDivide(shadow_frame, vregA, shadow_frame.GetVReg(vregA),
+                               shadow_frame.GetVReg(inst->VRegB_12x()));
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_1xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(REM_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    bool success = DoIntRemainder(shadow_frame, vregA, shadow_frame.GetVReg(vregA),
+                                  shadow_frame.GetVReg(inst->VRegB_12x()));
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_1xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SHL_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         shadow_frame.GetVReg(vregA) <<
+                         (shadow_frame.GetVReg(inst->VRegB_12x()) & 0x1f));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SHR_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         shadow_frame.GetVReg(vregA) >>
+                         (shadow_frame.GetVReg(inst->VRegB_12x()) & 0x1f));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(USHR_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         static_cast<uint32_t>(shadow_frame.GetVReg(vregA)) >>
+                         (shadow_frame.GetVReg(inst->VRegB_12x()) & 0x1f));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AND_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         shadow_frame.GetVReg(vregA) &
+                         shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(OR_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         shadow_frame.GetVReg(vregA) |
+                         shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(XOR_INT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVReg(vregA,
+                         shadow_frame.GetVReg(vregA) ^
+                         shadow_frame.GetVReg(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(ADD_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             shadow_frame.GetVRegLong(vregA) +
+                             shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SUB_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             shadow_frame.GetVRegLong(vregA) -
+                             shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(MUL_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             shadow_frame.GetVRegLong(vregA) *
+                             shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(DIV_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    DoLongDivide(shadow_frame, vregA, shadow_frame.GetVRegLong(vregA),
+                shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(self->IsExceptionPending(), Next_1xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(REM_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    DoLongRemainder(shadow_frame, vregA, shadow_frame.GetVRegLong(vregA),
+                    shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(self->IsExceptionPending(), Next_1xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AND_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             shadow_frame.GetVRegLong(vregA) &
+                             shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(OR_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             shadow_frame.GetVRegLong(vregA) |
+                             shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(XOR_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             shadow_frame.GetVRegLong(vregA) ^
+                             shadow_frame.GetVRegLong(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SHL_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             shadow_frame.GetVRegLong(vregA) <<
+                             (shadow_frame.GetVReg(inst->VRegB_12x()) & 0x3f));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SHR_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             shadow_frame.GetVRegLong(vregA) >>
+                             (shadow_frame.GetVReg(inst->VRegB_12x()) & 0x3f));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(USHR_LONG_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegLong(vregA,
+                             static_cast<uint64_t>(shadow_frame.GetVRegLong(vregA)) >>
+                             (shadow_frame.GetVReg(inst->VRegB_12x()) & 0x3f));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(ADD_FLOAT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegFloat(vregA,
+                              shadow_frame.GetVRegFloat(vregA) +
+                              shadow_frame.GetVRegFloat(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SUB_FLOAT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegFloat(vregA,
+                              shadow_frame.GetVRegFloat(vregA) -
+                              shadow_frame.GetVRegFloat(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(MUL_FLOAT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegFloat(vregA,
+                              shadow_frame.GetVRegFloat(vregA) *
+                              shadow_frame.GetVRegFloat(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(DIV_FLOAT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegFloat(vregA,
+                              shadow_frame.GetVRegFloat(vregA) /
+                              shadow_frame.GetVRegFloat(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(REM_FLOAT_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegFloat(vregA,
+                              fmodf(shadow_frame.GetVRegFloat(vregA),
+                                    shadow_frame.GetVRegFloat(inst->VRegB_12x())));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(ADD_DOUBLE_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegDouble(vregA,
+                               shadow_frame.GetVRegDouble(vregA) +
+                               shadow_frame.GetVRegDouble(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(SUB_DOUBLE_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegDouble(vregA,
+                               shadow_frame.GetVRegDouble(vregA) -
+                               shadow_frame.GetVRegDouble(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(MUL_DOUBLE_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegDouble(vregA,
+                               shadow_frame.GetVRegDouble(vregA) *
+                               shadow_frame.GetVRegDouble(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(DIV_DOUBLE_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegDouble(vregA,
+                               shadow_frame.GetVRegDouble(vregA) /
+                               shadow_frame.GetVRegDouble(inst->VRegB_12x()));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(REM_DOUBLE_2ADDR) {
+    PREAMBLE();
+    uint4_t vregA = inst->VRegA_12x();
+    shadow_frame.SetVRegDouble(vregA,
+                               fmod(shadow_frame.GetVRegDouble(vregA),
+                                    shadow_frame.GetVRegDouble(inst->VRegB_12x())));
+    inst = inst->Next_1xx();
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(ADD_INT_LIT16)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22s(),
+                         shadow_frame.GetVReg(inst->VRegB_22s()) +
+                         inst->VRegC_22s());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(RSUB_INT)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22s(),
+                         inst->VRegC_22s() -
+                         shadow_frame.GetVReg(inst->VRegB_22s()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MUL_INT_LIT16)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22s(),
+                         shadow_frame.GetVReg(inst->VRegB_22s()) *
+                         inst->VRegC_22s());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(DIV_INT_LIT16) {
+    PREAMBLE();
+    bool success = DoIntDivide(shadow_frame, inst->VRegA_22s(),
+                               shadow_frame.GetVReg(inst->VRegB_22s()), inst->VRegC_22s());
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(REM_INT_LIT16) {
+    PREAMBLE();
+    bool success = DoIntRemainder(shadow_frame, inst->VRegA_22s(),
+                                  shadow_frame.GetVReg(inst->VRegB_22s()), inst->VRegC_22s());
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AND_INT_LIT16)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22s(),
+                         shadow_frame.GetVReg(inst->VRegB_22s()) &
+                         inst->VRegC_22s());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(OR_INT_LIT16)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22s(),
+                         shadow_frame.GetVReg(inst->VRegB_22s()) |
+                         inst->VRegC_22s());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(XOR_INT_LIT16)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22s(),
+                         shadow_frame.GetVReg(inst->VRegB_22s()) ^
+                         inst->VRegC_22s());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(ADD_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         shadow_frame.GetVReg(inst->VRegB_22b()) +
+                         inst->VRegC_22b());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(RSUB_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         inst->VRegC_22b() -
+                         shadow_frame.GetVReg(inst->VRegB_22b()));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(MUL_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         shadow_frame.GetVReg(inst->VRegB_22b()) *
+                         inst->VRegC_22b());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(DIV_INT_LIT8) {
+    PREAMBLE();
+    bool success = DoIntDivide(shadow_frame, inst->VRegA_22b(),
+                               shadow_frame.GetVReg(inst->VRegB_22b()), inst->VRegC_22b());
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(REM_INT_LIT8) {
+    PREAMBLE();
+    bool success = DoIntRemainder(shadow_frame, inst->VRegA_22b(),
+                                  shadow_frame.GetVReg(inst->VRegB_22b()), inst->VRegC_22b());
+    POSSIBLY_HANDLE_PENDING_EXCEPTION(!success, Next_2xx);
+    NEXT_INSTRUCTION();
+  }
+  INSTRUCTION_CASE(AND_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         shadow_frame.GetVReg(inst->VRegB_22b()) &
+                         inst->VRegC_22b());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(OR_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         shadow_frame.GetVReg(inst->VRegB_22b()) |
+                         inst->VRegC_22b());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(XOR_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         shadow_frame.GetVReg(inst->VRegB_22b()) ^
+                         inst->VRegC_22b());
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SHL_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         shadow_frame.GetVReg(inst->VRegB_22b()) <<
+                         (inst->VRegC_22b() & 0x1f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(SHR_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         shadow_frame.GetVReg(inst->VRegB_22b()) >>
+                         (inst->VRegC_22b() & 0x1f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(USHR_INT_LIT8)
+    PREAMBLE();
+    shadow_frame.SetVReg(inst->VRegA_22b(),
+                         static_cast<uint32_t>(shadow_frame.GetVReg(inst->VRegB_22b())) >>
+                         (inst->VRegC_22b() & 0x1f));
+    inst = inst->Next_2xx();
+    NEXT_INSTRUCTION();
+  INSTRUCTION_CASE(UNUSED_3E)
+  INSTRUCTION_CASE(UNUSED_3F)
+  INSTRUCTION_CASE(UNUSED_40)
+  INSTRUCTION_CASE(UNUSED_41)
+  INSTRUCTION_CASE(UNUSED_42)
+  INSTRUCTION_CASE(UNUSED_43)
+  INSTRUCTION_CASE(UNUSED_79)
+  INSTRUCTION_CASE(UNUSED_7A)
+  INSTRUCTION_CASE(UNUSED_F3)
+  INSTRUCTION_CASE(UNUSED_F4)
+  INSTRUCTION_CASE(UNUSED_F5)
+  INSTRUCTION_CASE(UNUSED_F6)
+  INSTRUCTION_CASE(UNUSED_F7)
+  INSTRUCTION_CASE(UNUSED_F8)
+  INSTRUCTION_CASE(UNUSED_F9)
+  INSTRUCTION_CASE(UNUSED_FA)
+  INSTRUCTION_CASE(UNUSED_FB)
+  INSTRUCTION_CASE(UNUSED_FC)
+  INSTRUCTION_CASE(UNUSED_FD)
+  INSTRUCTION_CASE(UNUSED_FE)
+  INSTRUCTION_CASE(UNUSED_FF)
+    UnexpectedOpcode(inst, mh);
+
+#endif  // ART_RUNTIME_INTERPRETER_INTERPRETER_INSTRUCTIONS_H_
+// The guard in this file is just for cpplint.
+#undef ART_RUNTIME_INTERPRETER_INTERPRETER_INSTRUCTIONS_H_
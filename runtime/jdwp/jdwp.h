@@ -280,6 +280,7 @@ struct JdwpState {
       EXCLUSIVE_LOCKS_REQUIRED(event_list_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void EventFinish(ExpandBuf* pReq);
+  void SetEventHeader(ExpandBuf* pReq);
   void FindMatchingEvents(JdwpEventKind eventKind,
                           ModBasket* basket,
                           JdwpEvent** match_list,
@@ -323,10 +324,11 @@ struct JdwpState {
   AtomicInteger request_serial_;
   AtomicInteger event_serial_;
 
-  // Linked list of events requested by the debugger (breakpoints, class prep, etc).
+  // Events requested by the debugger (breakpoints, class prep, etc), in one linked list per
+  // event kind so that posting an event only looks at the requests it could match.
   Mutex event_list_lock_;
-  JdwpEvent* event_list_ GUARDED_BY(event_list_lock_);
-  int event_list_size_ GUARDED_BY(event_list_lock_);  // Number of elements in event_list_.
+  JdwpEvent* event_lists_[EK_VM_DISCONNECTED + 1] GUARDED_BY(event_list_lock_);
+  int event_list_size_ GUARDED_BY(event_list_lock_);  // Number of elements in event_lists_.
 
   // Used to synchronize suspension of the event thread (to avoid receiving "resume"
   // events before the thread has finished suspending itself).
@@ -334,6 +334,13 @@ bool JdwpAdbState::ProcessIncoming() {
       } else {
         LOG(INFO) << "NOTE: entering select w/o wakepipe";
       }
+      fd = flush_pipe_[0];
+      if (fd >= 0) {
+        FD_SET(fd, &readfds);
+        if (maxfd < fd) {
+          maxfd = fd;
+        }
+      }
 
       if (maxfd < 0) {
         VLOG(jdwp) << "+++ all fds are closed";
@@ -365,6 +372,9 @@ bool JdwpAdbState::ProcessIncoming() {
         LOG(DEBUG) << "Got wake-up signal, bailing out of select";
         goto fail;
       }
+      if (flush_pipe_[0] >= 0 && FD_ISSET(flush_pipe_[0], &readfds)) {
+        FlushQueuedPackets();
+      }
       if (control_sock_ >= 0 && FD_ISSET(control_sock_, &readfds)) {
         int  sock = ReceiveClientFd();
         if (sock >= 0) {
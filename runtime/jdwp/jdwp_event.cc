@@ -107,11 +107,24 @@ namespace JDWP {
  * The rest will be zeroed.
  */
 struct ModBasket {
-  ModBasket() : pLoc(NULL), threadId(0), classId(0), excepClassId(0),
+  ModBasket() : pLoc(NULL), haveClassName(false), threadId(0), classId(0), excepClassId(0),
                 caught(false), field(0), thisPtr(0) { }
 
+  /*
+   * The name of the class "classId", which is only looked up once a
+   * ClassMatch or ClassExclude mod needs it.
+   */
+  const std::string& GetClassName() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (!haveClassName) {
+      className = Dbg::GetClassName(classId);
+      haveClassName = true;
+    }
+    return className;
+  }
+
   const JdwpLocation* pLoc;           /* LocationOnly */
   std::string         className;      /* ClassMatch/ClassExclude */
+  bool                haveClassName;
   ObjectId            threadId;       /* ThreadOnly */
   RefTypeId           classId;        /* ClassOnly */
   RefTypeId           excepClassId;   /* ExceptionOnly */
@@ -174,11 +187,12 @@ JdwpError JdwpState::RegisterEvent(JdwpEvent* pEvent) {
    * Add to list.
    */
   MutexLock mu(Thread::Current(), event_list_lock_);
-  if (event_list_ != NULL) {
-    pEvent->next = event_list_;
-    event_list_->prev = pEvent;
+  JdwpEvent*& event_list = event_lists_[pEvent->eventKind];
+  if (event_list != NULL) {
+    pEvent->next = event_list;
+    event_list->prev = pEvent;
   }
-  event_list_ = pEvent;
+  event_list = pEvent;
   ++event_list_size_;
 
   return ERR_NONE;
@@ -195,9 +209,9 @@ JdwpError JdwpState::RegisterEvent(JdwpEvent* pEvent) {
 void JdwpState::UnregisterEvent(JdwpEvent* pEvent) {
   if (pEvent->prev == NULL) {
     /* head of the list */
-    CHECK(event_list_ == pEvent);
+    CHECK(event_lists_[pEvent->eventKind] == pEvent);
 
-    event_list_ = pEvent->next;
+    event_lists_[pEvent->eventKind] = pEvent->next;
   } else {
     pEvent->prev->next = pEvent->next;
   }
@@ -224,7 +238,6 @@ void JdwpState::UnregisterEvent(JdwpEvent* pEvent) {
   }
 
   --event_list_size_;
-  CHECK(event_list_size_ != 0 || event_list_ == NULL);
 }
 
 /*
@@ -237,15 +250,17 @@ void JdwpState::UnregisterEvent(JdwpEvent* pEvent) {
 void JdwpState::UnregisterEventById(uint32_t requestId) {
   MutexLock mu(Thread::Current(), event_list_lock_);
 
-  JdwpEvent* pEvent = event_list_;
-  while (pEvent != NULL) {
-    if (pEvent->requestId == requestId) {
-      UnregisterEvent(pEvent);
-      EventFree(pEvent);
-      return;      /* there can be only one with a given ID */
-    }
+  for (size_t kind = 0; kind < arraysize(event_lists_); ++kind) {
+    JdwpEvent* pEvent = event_lists_[kind];
+    while (pEvent != NULL) {
+      if (pEvent->requestId == requestId) {
+        UnregisterEvent(pEvent);
+        EventFree(pEvent);
+        return;      /* there can be only one with a given ID */
+      }
 
-    pEvent = pEvent->next;
+      pEvent = pEvent->next;
+    }
   }
 
   // ALOGD("Odd: no match when removing event reqId=0x%04x", requestId);
@@ -257,16 +272,17 @@ void JdwpState::UnregisterEventById(uint32_t requestId) {
 void JdwpState::UnregisterAll() {
   MutexLock mu(Thread::Current(), event_list_lock_);
 
-  JdwpEvent* pEvent = event_list_;
-  while (pEvent != NULL) {
-    JdwpEvent* pNextEvent = pEvent->next;
+  for (size_t kind = 0; kind < arraysize(event_lists_); ++kind) {
+    JdwpEvent* pEvent = event_lists_[kind];
+    while (pEvent != NULL) {
+      JdwpEvent* pNextEvent = pEvent->next;
 
-    UnregisterEvent(pEvent);
-    EventFree(pEvent);
-    pEvent = pNextEvent;
+      UnregisterEvent(pEvent);
+      EventFree(pEvent);
+      pEvent = pNextEvent;
+    }
   }
-
-  event_list_ = NULL;
+  CHECK_EQ(event_list_size_, 0);
 }
 
 /*
@@ -399,12 +415,12 @@ static bool ModsMatch(JdwpEvent* pEvent, ModBasket* basket)
       }
       break;
     case MK_CLASS_MATCH:
-      if (!PatternMatch(pMod->classMatch.classPattern, basket->className)) {
+      if (!PatternMatch(pMod->classMatch.classPattern, basket->GetClassName())) {
         return false;
       }
       break;
     case MK_CLASS_EXCLUDE:
-      if (PatternMatch(pMod->classMatch.classPattern, basket->className)) {
+      if (PatternMatch(pMod->classMatch.classPattern, basket->GetClassName())) {
         return false;
       }
       break;
@@ -459,9 +475,9 @@ void JdwpState::FindMatchingEvents(JdwpEventKind eventKind, ModBasket* basket,
   /* start after the existing entries */
   match_list += *pMatchCount;
 
-  JdwpEvent* pEvent = event_list_;
+  JdwpEvent* pEvent = event_lists_[eventKind];
   while (pEvent != NULL) {
-    if (pEvent->eventKind == eventKind && ModsMatch(pEvent, basket)) {
+    if (ModsMatch(pEvent, basket)) {
       *match_list++ = pEvent;
       (*pMatchCount)++;
     }
@@ -548,6 +564,15 @@ void JdwpState::SendRequestAndPossiblySuspend(ExpandBuf* pReq, JdwpSuspendPolicy
                                               ObjectId threadId) {
   Thread* self = Thread::Current();
   self->AssertThreadSuspensionIsAllowable();
+  if (pReq != NULL && suspend_policy == SP_NONE) {
+    /*
+     * Nothing waits for the debugger to see this, so leave the write to
+     * the JDWP thread rather than blocking on the socket here.
+     */
+    SetEventHeader(pReq);
+    netState->QueuePacket(pReq);
+    return;
+  }
   /* send request and possibly suspend ourselves */
   if (pReq != NULL) {
     JDWP::ObjectId thread_self_id = Dbg::GetThreadSelfId();
@@ -640,11 +665,9 @@ static ExpandBuf* eventPrep() {
 }
 
 /*
- * Write the header into the buffer and send the packet off to the debugger.
- *
- * Takes ownership of "pReq" (currently discards it).
+ * Write the header into the buffer.
  */
-void JdwpState::EventFinish(ExpandBuf* pReq) {
+void JdwpState::SetEventHeader(ExpandBuf* pReq) {
   uint8_t* buf = expandBufGetBuffer(pReq);
 
   Set4BE(buf, expandBufGetLength(pReq));
@@ -652,6 +675,16 @@ void JdwpState::EventFinish(ExpandBuf* pReq) {
   Set1(buf+8, 0);     /* flags */
   Set1(buf+9, kJdwpEventCommandSet);
   Set1(buf+10, kJdwpCompositeCommand);
+}
+
+/*
+ * Write the header into the buffer and send the packet off to the debugger.
+ * Any events still queued for the JDWP thread are sent first.
+ *
+ * Takes ownership of "pReq" (currently discards it).
+ */
+void JdwpState::EventFinish(ExpandBuf* pReq) {
+  SetEventHeader(pReq);
 
   SendRequest(pReq);
 
@@ -725,7 +758,6 @@ bool JdwpState::PostLocationEvent(const JdwpLocation* pLoc, ObjectId thisPtr, in
   basket.classId = pLoc->class_id;
   basket.thisPtr = thisPtr;
   basket.threadId = Dbg::GetThreadSelfId();
-  basket.className = Dbg::GetClassName(pLoc->class_id);
 
   /*
    * On rare occasions we may need to execute interpreted code in the VM
@@ -748,7 +780,7 @@ bool JdwpState::PostLocationEvent(const JdwpLocation* pLoc, ObjectId thisPtr, in
    * method invocation to complete.
    */
   if (InvokeInProgress()) {
-    VLOG(jdwp) << "Not checking breakpoints during invoke (" << basket.className << ")";
+    VLOG(jdwp) << "Not checking breakpoints during invoke (" << basket.GetClassName() << ")";
     return false;
   }
 
@@ -777,7 +809,7 @@ bool JdwpState::PostLocationEvent(const JdwpLocation* pLoc, ObjectId thisPtr, in
     }
     if (match_count != 0) {
       VLOG(jdwp) << "EVENT: " << match_list[0]->eventKind << "(" << match_count << " total) "
-                 << basket.className << "." << Dbg::GetMethodName(pLoc->method_id)
+                 << basket.GetClassName() << "." << Dbg::GetMethodName(pLoc->method_id)
                  << StringPrintf(" thread=%#llx dex_pc=%#llx)", basket.threadId, pLoc->dex_pc);
 
       suspend_policy = scanSuspendPolicy(match_list, match_count);
@@ -899,14 +931,13 @@ bool JdwpState::PostException(const JdwpLocation* pThrowLoc,
   basket.pLoc = pThrowLoc;
   basket.classId = pThrowLoc->class_id;
   basket.threadId = Dbg::GetThreadSelfId();
-  basket.className = Dbg::GetClassName(basket.classId);
   basket.excepClassId = exceptionClassId;
   basket.caught = (pCatchLoc->class_id != 0);
   basket.thisPtr = thisPtr;
 
   /* don't try to post an exception caused by the debugger */
   if (InvokeInProgress()) {
-    VLOG(jdwp) << "Not posting exception hit during invoke (" << basket.className << ")";
+    VLOG(jdwp) << "Not posting exception hit during invoke (" << basket.GetClassName() << ")";
     return false;
   }
 
@@ -969,11 +1000,10 @@ bool JdwpState::PostClassPrepare(JdwpTypeTag tag, RefTypeId refTypeId, const std
 
   basket.classId = refTypeId;
   basket.threadId = Dbg::GetThreadSelfId();
-  basket.className = Dbg::GetClassName(basket.classId);
 
   /* suppress class prep caused by debugger */
   if (InvokeInProgress()) {
-    VLOG(jdwp) << "Not posting class prep caused by invoke (" << basket.className << ")";
+    VLOG(jdwp) << "Not posting class prep caused by invoke (" << basket.GetClassName() << ")";
     return false;
   }
 
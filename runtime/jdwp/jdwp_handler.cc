@@ -1741,6 +1741,12 @@ void JdwpState::ProcessRequest(Request& request, ExpandBuf* pReply) {
 
   /* tell the VM that GC is okay again */
   self->TransitionFromRunnableToSuspended(old_state);
+
+  /*
+   * Breakpoints and single-steps set or cleared by the request only
+   * take effect once the methods involved are (un)deoptimized.
+   */
+  Dbg::ManageDeoptimization();
 }
 
 }  // namespace JDWP
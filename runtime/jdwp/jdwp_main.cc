@@ -36,10 +36,13 @@ static void* StartJdwpThread(void* arg);
  * JdwpNetStateBase class implementation
  */
 JdwpNetStateBase::JdwpNetStateBase(JdwpState* state)
-    : state_(state), socket_lock_("JdwpNetStateBase lock", kJdwpSocketLock) {
+    : state_(state), socket_lock_("JdwpNetStateBase lock", kJdwpSocketLock),
+      queue_lock_("JdwpNetStateBase packet queue lock", kJdwpPacketQueueLock) {
   clientSock = -1;
   wake_pipe_[0] = -1;
   wake_pipe_[1] = -1;
+  flush_pipe_[0] = -1;
+  flush_pipe_[1] = -1;
   input_count_ = 0;
   awaiting_handshake_ = false;
 }
@@ -53,6 +56,15 @@ JdwpNetStateBase::~JdwpNetStateBase() {
     close(wake_pipe_[1]);
     wake_pipe_[1] = -1;
   }
+  if (flush_pipe_[0] != -1) {
+    close(flush_pipe_[0]);
+    flush_pipe_[0] = -1;
+  }
+  if (flush_pipe_[1] != -1) {
+    close(flush_pipe_[1]);
+    flush_pipe_[1] = -1;
+  }
+  DiscardQueuedPackets();
 }
 
 bool JdwpNetStateBase::MakePipe() {
@@ -60,6 +72,10 @@ bool JdwpNetStateBase::MakePipe() {
     PLOG(ERROR) << "pipe failed";
     return false;
   }
+  if (flush_pipe_[0] == -1 && pipe(flush_pipe_) == -1) {
+    PLOG(ERROR) << "pipe failed";
+    return false;
+  }
   return true;
 }
 
@@ -119,6 +135,9 @@ void JdwpNetStateBase::Close() {
 
   close(clientSock);
   clientSock = -1;
+
+  // Events queued for this debugger mean nothing to the next one.
+  DiscardQueuedPackets();
 }
 
 /*
@@ -126,6 +145,7 @@ void JdwpNetStateBase::Close() {
  */
 ssize_t JdwpNetStateBase::WritePacket(ExpandBuf* pReply) {
   MutexLock mu(Thread::Current(), socket_lock_);
+  WriteQueuedPacketsLocked();
   return TEMP_FAILURE_RETRY(write(clientSock, expandBufGetBuffer(pReply), expandBufGetLength(pReply)));
 }
 
@@ -134,9 +154,63 @@ ssize_t JdwpNetStateBase::WritePacket(ExpandBuf* pReply) {
  */
 ssize_t JdwpNetStateBase::WriteBufferedPacket(const std::vector<iovec>& iov) {
   MutexLock mu(Thread::Current(), socket_lock_);
+  WriteQueuedPacketsLocked();
   return TEMP_FAILURE_RETRY(writev(clientSock, &iov[0], iov.size()));
 }
 
+void JdwpNetStateBase::QueuePacket(ExpandBuf* pReq) {
+  if (clientSock < 0) {
+    VLOG(jdwp) << "Not queueing JDWP packet: no debugger attached!";
+    expandBufFree(pReq);
+    return;
+  }
+
+  bool was_empty;
+  {
+    MutexLock mu(Thread::Current(), queue_lock_);
+    was_empty = queued_packets_.empty();
+    queued_packets_.push_back(pReq);
+  }
+  // Only the first packet of a batch needs to wake the JDWP thread.
+  if (was_empty && flush_pipe_[1] != -1) {
+    TEMP_FAILURE_RETRY(write(flush_pipe_[1], "", 1));
+  }
+}
+
+void JdwpNetStateBase::FlushQueuedPackets() {
+  // Drain the pipe before taking the packets, so a packet queued after we look gets a new wake.
+  char buf[64];
+  TEMP_FAILURE_RETRY(read(flush_pipe_[0], buf, sizeof(buf)));
+  MutexLock mu(Thread::Current(), socket_lock_);
+  WriteQueuedPacketsLocked();
+}
+
+void JdwpNetStateBase::WriteQueuedPacketsLocked() {
+  std::vector<ExpandBuf*> packets;
+  {
+    MutexLock mu(Thread::Current(), queue_lock_);
+    packets.swap(queued_packets_);
+  }
+  for (size_t i = 0; i < packets.size(); ++i) {
+    ExpandBuf* pReq = packets[i];
+    ssize_t actual = TEMP_FAILURE_RETRY(write(clientSock, expandBufGetBuffer(pReq),
+                                              expandBufGetLength(pReq)));
+    if (static_cast<size_t>(actual) != expandBufGetLength(pReq)) {
+      PLOG(ERROR) << StringPrintf("Failed to send queued JDWP packet to debugger (%d of %d)",
+                                  actual, expandBufGetLength(pReq));
+    }
+    expandBufFree(pReq);
+  }
+}
+
+void JdwpNetStateBase::DiscardQueuedPackets() {
+  MutexLock mu(Thread::Current(), queue_lock_);
+  for (size_t i = 0; i < queued_packets_.size(); ++i) {
+    expandBufFree(queued_packets_[i]);
+  }
+  queued_packets_.clear();
+}
+
 bool JdwpState::IsConnected() {
   return netState != NULL && netState->IsConnected();
 }
@@ -212,7 +286,7 @@ JdwpState::JdwpState(const JdwpOptions* options)
       request_serial_(0x10000000),
       event_serial_(0x20000000),
       event_list_lock_("JDWP event list lock", kJdwpEventListLock),
-      event_list_(NULL),
+      event_lists_(),
       event_list_size_(0),
       event_thread_lock_("JDWP event thread lock"),
       event_thread_cond_("JDWP event thread condition variable", event_thread_lock_),
@@ -325,7 +399,7 @@ void JdwpState::ResetState() {
   UnregisterAll();
   {
     MutexLock mu(Thread::Current(), event_list_lock_);
-    CHECK(event_list_ == NULL);
+    CHECK_EQ(event_list_size_, 0);
   }
 
   /*
@@ -419,6 +493,7 @@ void JdwpState::Run() {
    * we're running.
    */
   thread_ = Thread::Current();
+  runtime->SetUpThreadScheduling(thread_, Runtime::kJdwpThread);
   run = true;
 
   {
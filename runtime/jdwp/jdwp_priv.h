@@ -72,9 +72,15 @@ class JdwpNetStateBase {
   ssize_t WritePacket(ExpandBuf* pReply);
   ssize_t WriteBufferedPacket(const std::vector<iovec>& iov);
 
+  // Hands a packet to the JDWP thread to write, so that the caller doesn't block on the socket.
+  // Packets are written in order, before any packet written with WritePacket or
+  // WriteBufferedPacket later. Takes ownership of "pReq".
+  void QueuePacket(ExpandBuf* pReq);
+
   int clientSock;  // Active connection to debugger.
 
   int wake_pipe_[2];  // Used to break out of select.
+  int flush_pipe_[2];  // Used to wake select when packets are queued.
 
   uint8_t input_buffer_[8192];
   size_t input_count_;
@@ -85,14 +91,23 @@ class JdwpNetStateBase {
   bool MakePipe();
   void WakePipe();
 
+  // Writes the queued packets, called by the JDWP thread when flush_pipe_ is readable.
+  void FlushQueuedPackets();
+
   void SetAwaitingHandshake(bool new_state);
 
   JdwpState* state_;
 
  private:
+  void WriteQueuedPacketsLocked() EXCLUSIVE_LOCKS_REQUIRED(socket_lock_);
+  void DiscardQueuedPackets();
+
   // Used to serialize writes to the socket.
   Mutex socket_lock_;
 
+  Mutex queue_lock_ ACQUIRED_AFTER(socket_lock_);
+  std::vector<ExpandBuf*> queued_packets_ GUARDED_BY(queue_lock_);
+
   // Are we waiting for the JDWP handshake?
   bool awaiting_handshake_;
 };
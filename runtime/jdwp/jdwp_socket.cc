@@ -385,6 +385,13 @@ bool JdwpSocketState::ProcessIncoming() {
       } else {
         LOG(INFO) << "NOTE: entering select w/o wakepipe";
       }
+      fd = flush_pipe_[0];
+      if (fd >= 0) {
+        FD_SET(fd, &readfds);
+        if (maxfd < fd) {
+          maxfd = fd;
+        }
+      }
 
       if (maxfd < 0) {
         VLOG(jdwp) << "+++ all fds are closed";
@@ -420,6 +427,9 @@ bool JdwpSocketState::ProcessIncoming() {
         }
         goto fail;
       }
+      if (flush_pipe_[0] >= 0 && FD_ISSET(flush_pipe_[0], &readfds)) {
+        FlushQueuedPackets();
+      }
       if (listenSock >= 0 && FD_ISSET(listenSock, &readfds)) {
         LOG(INFO) << "Ignoring second debugger -- accepting and dropping";
         union {
@@ -16,12 +16,20 @@
 
 #include "object_registry.h"
 
+#include "base/stl_util.h"
+#include "jni_internal.h"
 #include "scoped_thread_state_change.h"
 
 namespace art {
 
 mirror::Object* const ObjectRegistry::kInvalidObject = reinterpret_cast<mirror::Object*>(1);
 
+// Objects don't move, so their address identifies them. Their identity hash code could block the
+// debugger on the thin lock of a suspended thread.
+static int32_t ObjectKey(const mirror::Object* o) {
+  return static_cast<int32_t>(reinterpret_cast<uintptr_t>(o));
+}
+
 std::ostream& operator<<(std::ostream& os, const ObjectRegistryEntry& rhs) {
   os << "ObjectRegistryEntry[" << rhs.jni_reference_type
      << ",reference=" << rhs.jni_reference
@@ -31,7 +39,12 @@ std::ostream& operator<<(std::ostream& os, const ObjectRegistryEntry& rhs) {
 }
 
 ObjectRegistry::ObjectRegistry()
-    : lock_("ObjectRegistry lock", kJdwpObjectRegistryLock), next_id_(1) {
+    : lock_("ObjectRegistry lock", kJdwpObjectRegistryLock), allow_new_objects_(true),
+      new_object_condition_("ObjectRegistry new object condition", lock_), next_id_(1) {
+}
+
+ObjectRegistry::~ObjectRegistry() {
+  STLDeleteValues(&id_to_entry_);
 }
 
 JDWP::RefTypeId ObjectRegistry::AddRefType(mirror::Class* c) {
@@ -42,77 +55,108 @@ JDWP::ObjectId ObjectRegistry::Add(mirror::Object* o) {
   return InternalAdd(o);
 }
 
+void ObjectRegistry::Add(const std::vector<mirror::Object*>& objects,
+                         std::vector<JDWP::ObjectId>& ids) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  WaitForNewObjectsLocked(self);
+  ids.reserve(ids.size() + objects.size());
+  for (size_t i = 0; i < objects.size(); ++i) {
+    ids.push_back(AddLocked(self, objects[i]));
+  }
+}
+
 JDWP::ObjectId ObjectRegistry::InternalAdd(mirror::Object* o) {
   if (o == NULL) {
     return 0;
   }
 
-  ScopedObjectAccessUnchecked soa(Thread::Current());
-  MutexLock mu(soa.Self(), lock_);
-  ObjectRegistryEntry dummy;
-  dummy.jni_reference_type = JNIWeakGlobalRefType;
-  dummy.jni_reference = NULL;
-  dummy.reference_count = 0;
-  dummy.id = 0;
-  std::pair<object_iterator, bool> result = object_to_entry_.insert(std::make_pair(o, dummy));
-  ObjectRegistryEntry& entry = result.first->second;
-  if (!result.second) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  WaitForNewObjectsLocked(self);
+  return AddLocked(self, o);
+}
+
+JDWP::ObjectId ObjectRegistry::AddLocked(Thread* self, mirror::Object* o) {
+  if (o == NULL) {
+    return 0;
+  }
+
+  ObjectRegistryEntry* entry = LookupObject(o);
+  if (entry != NULL) {
     // This object was already in our map.
-    entry.reference_count += 1;
-    return entry.id;
+    entry->reference_count += 1;
+    return entry->id;
   }
 
   // This object isn't in the registry yet, so add it.
-  JNIEnv* env = soa.Env();
-
-  jobject local_reference = soa.AddLocalReference<jobject>(o);
+  entry = new ObjectRegistryEntry;
+  entry->jni_reference_type = JNIWeakGlobalRefType;
+  entry->jni_reference = Runtime::Current()->GetJavaVM()->AddWeakGlobalReference(self, o);
+  entry->object = o;
+  entry->reference_count = 1;
+  entry->id = next_id_++;
 
-  entry.jni_reference_type = JNIWeakGlobalRefType;
-  entry.jni_reference = env->NewWeakGlobalRef(local_reference);
-  entry.reference_count = 1;
-  entry.id = next_id_++;
+  object_to_entry_.insert(std::make_pair(ObjectKey(o), entry));
+  id_to_entry_.insert(std::make_pair(entry->id, entry));
 
-  id_to_entry_.Put(entry.id, &entry);
+  return entry->id;
+}
 
-  env->DeleteLocalRef(local_reference);
+ObjectRegistryEntry* ObjectRegistry::LookupObject(mirror::Object* o) {
+  std::pair<ObjectToEntryMap::iterator, ObjectToEntryMap::iterator> range =
+      object_to_entry_.equal_range(ObjectKey(o));
+  for (ObjectToEntryMap::iterator it = range.first; it != range.second; ++it) {
+    if (it->second->object == o) {
+      return it->second;
+    }
+  }
+  return NULL;
+}
 
-  return entry.id;
+void ObjectRegistry::WaitForNewObjectsLocked(Thread* self) {
+  while (UNLIKELY(!allow_new_objects_)) {
+    new_object_condition_.WaitHoldingLocks(self);
+  }
 }
 
 bool ObjectRegistry::Contains(mirror::Object* o) {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  return (object_to_entry_.find(o) != object_to_entry_.end());
+  // Entries of dead objects may linger until they're swept, but no live object can share their
+  // address before then.
+  return LookupObject(o) != NULL;
 }
 
 void ObjectRegistry::Clear() {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  VLOG(jdwp) << "Object registry contained " << object_to_entry_.size() << " entries";
+  VLOG(jdwp) << "Object registry contained " << id_to_entry_.size() << " entries";
 
   // Delete all the JNI references.
   JNIEnv* env = self->GetJniEnv();
-  for (object_iterator it = object_to_entry_.begin(); it != object_to_entry_.end(); ++it) {
-    ObjectRegistryEntry& entry = (it->second);
-    if (entry.jni_reference_type == JNIWeakGlobalRefType) {
-      env->DeleteWeakGlobalRef(entry.jni_reference);
+  for (IdToEntryMap::iterator it = id_to_entry_.begin(); it != id_to_entry_.end(); ++it) {
+    ObjectRegistryEntry* entry = it->second;
+    if (entry->jni_reference_type == JNIWeakGlobalRefType) {
+      env->DeleteWeakGlobalRef(entry->jni_reference);
     } else {
-      env->DeleteGlobalRef(entry.jni_reference);
+      env->DeleteGlobalRef(entry->jni_reference);
     }
   }
 
   // Clear the maps.
   object_to_entry_.clear();
-  id_to_entry_.clear();
+  STLDeleteValues(&id_to_entry_);
 }
 
 mirror::Object* ObjectRegistry::InternalGet(JDWP::ObjectId id) {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  id_iterator it = id_to_entry_.find(id);
+  IdToEntryMap::iterator it = id_to_entry_.find(id);
   if (it == id_to_entry_.end()) {
     return kInvalidObject;
   }
+  WaitForNewObjectsLocked(self);
   ObjectRegistryEntry& entry = *(it->second);
   return self->DecodeJObject(entry.jni_reference);
 }
@@ -120,7 +164,7 @@ mirror::Object* ObjectRegistry::InternalGet(JDWP::ObjectId id) {
 jobject ObjectRegistry::GetJObject(JDWP::ObjectId id) {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  id_iterator it = id_to_entry_.find(id);
+  IdToEntryMap::iterator it = id_to_entry_.find(id);
   CHECK(it != id_to_entry_.end()) << id;
   ObjectRegistryEntry& entry = *(it->second);
   return entry.jni_reference;
@@ -129,20 +173,22 @@ jobject ObjectRegistry::GetJObject(JDWP::ObjectId id) {
 void ObjectRegistry::DisableCollection(JDWP::ObjectId id) {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  id_iterator it = id_to_entry_.find(id);
+  IdToEntryMap::iterator it = id_to_entry_.find(id);
   if (it == id_to_entry_.end()) {
     return;
   }
+  WaitForNewObjectsLocked(self);
   Promote(*(it->second));
 }
 
 void ObjectRegistry::EnableCollection(JDWP::ObjectId id) {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  id_iterator it = id_to_entry_.find(id);
+  IdToEntryMap::iterator it = id_to_entry_.find(id);
   if (it == id_to_entry_.end()) {
     return;
   }
+  WaitForNewObjectsLocked(self);
   Demote(*(it->second));
 }
 
@@ -171,41 +217,75 @@ void ObjectRegistry::Promote(ObjectRegistryEntry& entry) {
 bool ObjectRegistry::IsCollected(JDWP::ObjectId id) {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  id_iterator it = id_to_entry_.find(id);
+  IdToEntryMap::iterator it = id_to_entry_.find(id);
   if (it == id_to_entry_.end()) {
     return true;  // TODO: can we report that this was an invalid id?
   }
 
-  ObjectRegistryEntry& entry = *(it->second);
-  if (entry.jni_reference_type == JNIWeakGlobalRefType) {
-    JNIEnv* env = self->GetJniEnv();
-    return env->IsSameObject(entry.jni_reference, NULL);  // Has the jweak been collected?
-  } else {
-    return false;  // We hold a strong reference, so we know this is live.
-  }
+  // Wait for a running GC to sweep the registry, the object is cleared if it's been collected.
+  WaitForNewObjectsLocked(self);
+  return it->second->object == NULL;
 }
 
 void ObjectRegistry::DisposeObject(JDWP::ObjectId id, uint32_t reference_count) {
   Thread* self = Thread::Current();
   MutexLock mu(self, lock_);
-  id_iterator it = id_to_entry_.find(id);
+  IdToEntryMap::iterator it = id_to_entry_.find(id);
   if (it == id_to_entry_.end()) {
     return;
   }
 
-  ObjectRegistryEntry& entry = *(it->second);
-  entry.reference_count -= reference_count;
-  if (entry.reference_count <= 0) {
+  ObjectRegistryEntry* entry = it->second;
+  entry->reference_count -= reference_count;
+  if (entry->reference_count <= 0) {
     JNIEnv* env = self->GetJniEnv();
-    mirror::Object* object = self->DecodeJObject(entry.jni_reference);
-    if (entry.jni_reference_type == JNIWeakGlobalRefType) {
-      env->DeleteWeakGlobalRef(entry.jni_reference);
+    if (entry->jni_reference_type == JNIWeakGlobalRefType) {
+      env->DeleteWeakGlobalRef(entry->jni_reference);
     } else {
-      env->DeleteGlobalRef(entry.jni_reference);
+      env->DeleteGlobalRef(entry->jni_reference);
+    }
+    // The object is NULL if it's been collected, and its entry already dropped by SweepWeaks.
+    if (entry->object != NULL) {
+      std::pair<ObjectToEntryMap::iterator, ObjectToEntryMap::iterator> range =
+          object_to_entry_.equal_range(ObjectKey(entry->object));
+      for (ObjectToEntryMap::iterator object_it = range.first; object_it != range.second;
+           ++object_it) {
+        if (object_it->second == entry) {
+          object_to_entry_.erase(object_it);
+          break;
+        }
+      }
     }
-    object_to_entry_.erase(object);
-    id_to_entry_.erase(id);
+    id_to_entry_.erase(it);
+    delete entry;
   }
 }
 
+void ObjectRegistry::SweepWeaks(IsMarkedTester is_marked, void* arg) {
+  MutexLock mu(Thread::Current(), lock_);
+  for (ObjectToEntryMap::iterator it = object_to_entry_.begin(); it != object_to_entry_.end();) {
+    ObjectRegistryEntry* entry = it->second;
+    // Objects we hold globally are roots, so only weak entries can refer to dead objects.
+    if (entry->jni_reference_type == JNIWeakGlobalRefType && !is_marked(entry->object, arg)) {
+      entry->object = NULL;
+      it = object_to_entry_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ObjectRegistry::AllowNewObjects() {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  allow_new_objects_ = true;
+  new_object_condition_.Broadcast(self);
+}
+
+void ObjectRegistry::DisallowNewObjects() {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  allow_new_objects_ = false;
+}
+
 }  // namespace art
@@ -19,14 +19,15 @@
 
 #include <stdint.h>
 
-#include <map>
+#include <unordered_map>
+#include <vector>
 
 #include "jdwp/jdwp.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/class.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
-#include "safe_map.h"
+#include "root_visitor.h"
 
 namespace art {
 
@@ -37,6 +38,10 @@ struct ObjectRegistryEntry {
   // The reference itself.
   jobject jni_reference;
 
+  // The object jni_reference refers to, used only to compare identities without decoding the
+  // reference. Cleared when the GC sweeps a weakly held object.
+  mirror::Object* object;
+
   // A reference count, so we can implement DisposeObject.
   int32_t reference_count;
 
@@ -50,11 +55,19 @@ std::ostream& operator<<(std::ostream& os, const ObjectRegistryEntry& rhs);
 // still be garbage collected. The debugger can ask us to retain objects, though, so we can
 // also promote references to regular JNI global references (and demote them back again if
 // the debugger tells us that's okay).
+//
+// Objects are found by identity hash code and entries by id, both in hash tables, since the
+// interpreter asks whether an object is known on every instruction while a debugger is attached.
 class ObjectRegistry {
  public:
   ObjectRegistry();
+  ~ObjectRegistry();
 
   JDWP::ObjectId Add(mirror::Object* o) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Adds all of objects under a single acquisition of the registry lock, appending their ids to
+  // ids in the same order.
+  void Add(const std::vector<mirror::Object*>& objects, std::vector<JDWP::ObjectId>& ids)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   JDWP::RefTypeId AddRefType(mirror::Class* c) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   template<typename T> T Get(JDWP::ObjectId id) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -83,19 +96,40 @@ class ObjectRegistry {
   // Avoid using this and use standard Get when possible.
   jobject GetJObject(JDWP::ObjectId id) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Forgets the objects of weak entries that is_marked says are dead, so that their addresses
+  // can't be confused with new objects. Called by the GC while it sweeps system weaks.
+  void SweepWeaks(IsMarkedTester is_marked, void* arg) LOCKS_EXCLUDED(lock_);
+
+  // No weak entries are created or decoded between the GC's marking and its sweeping. Since
+  // new objects are allowed after new JNI weak globals, waiting here means the JNI weak globals
+  // never block while we hold lock_, which SweepWeaks needs.
+  void AllowNewObjects() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(lock_);
+  void DisallowNewObjects() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_) LOCKS_EXCLUDED(lock_);
+
  private:
+  typedef std::unordered_multimap<int32_t, ObjectRegistryEntry*> ObjectToEntryMap;
+  typedef std::unordered_map<JDWP::ObjectId, ObjectRegistryEntry*> IdToEntryMap;
+
   JDWP::ObjectId InternalAdd(mirror::Object* o) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  ObjectRegistryEntry* LookupObject(mirror::Object* o) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Adds o or bumps its reference count, returning its id. The caller has waited for
+  // allow_new_objects_.
+  JDWP::ObjectId AddLocked(Thread* self, mirror::Object* o)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void WaitForNewObjectsLocked(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(lock_);
   mirror::Object* InternalGet(JDWP::ObjectId id) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void Demote(ObjectRegistryEntry& entry) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, lock_);
   void Promote(ObjectRegistryEntry& entry) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_, lock_);
 
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  bool allow_new_objects_ GUARDED_BY(lock_);
+  ConditionVariable new_object_condition_ GUARDED_BY(lock_);
 
-  typedef std::map<mirror::Object*, ObjectRegistryEntry>::iterator object_iterator;
-  std::map<mirror::Object*, ObjectRegistryEntry> object_to_entry_ GUARDED_BY(lock_);
+  // Entries whose objects are still known to be live, by the identity hash code of the object.
+  ObjectToEntryMap object_to_entry_ GUARDED_BY(lock_);
 
-  typedef SafeMap<JDWP::ObjectId, ObjectRegistryEntry*>::iterator id_iterator;
-  SafeMap<JDWP::ObjectId, ObjectRegistryEntry*> id_to_entry_ GUARDED_BY(lock_);
+  // All entries, including those of collected objects. Owns the entries.
+  IdToEntryMap id_to_entry_ GUARDED_BY(lock_);
 
   size_t next_id_ GUARDED_BY(lock_);
 };
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit.h"
+
+#include <dlfcn.h>
+#include <string.h>
+
+#include <ostream>
+
+#include "base/stringprintf.h"
+#include "cutils/atomic-inline.h"
+#include "instrumentation.h"
+#include "interpreter/interpreter.h"
+#include "metrics.h"
+#include "mirror/art_method-inl.h"
+#include "mirror/class-inl.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+namespace jit {
+
+// Compilations are queued in the order methods get hot, one thread keeps them off the threads
+// that run the app.
+static const size_t kJitThreads = 1;
+
+class JitCompileTask : public Task {
+ public:
+  // Classes aren't unloaded with the JIT, see ClassLinker::CanUnloadClasses, so the pointer stays
+  // valid until the task runs.
+  explicit JitCompileTask(mirror::ArtMethod* method) : method_(method) {}
+
+  virtual void Run(Thread* self) {
+    Runtime::Current()->GetJit()->CompileMethod(self, method_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  mirror::ArtMethod* const method_;
+};
+
+Jit* Jit::Create(size_t threshold, size_t code_cache_capacity, std::string* error_msg) {
+  const char* library = kIsDebugBuild ? "libartd-compiler.so" : "libart-compiler.so";
+  void* compiler_library = dlopen(library, RTLD_NOW);
+  if (compiler_library == NULL) {
+    *error_msg = StringPrintf("Failed to load %s: %s", library, dlerror());
+    return NULL;
+  }
+  CreateCompilerFn create_compiler =
+      reinterpret_cast<CreateCompilerFn>(dlsym(compiler_library, "ArtJitCreateCompiler"));
+  DeleteCompilerFn delete_compiler =
+      reinterpret_cast<DeleteCompilerFn>(dlsym(compiler_library, "ArtJitDeleteCompiler"));
+  CompileMethodFn compile_method =
+      reinterpret_cast<CompileMethodFn>(dlsym(compiler_library, "ArtJitCompileMethod"));
+  if (create_compiler == NULL || delete_compiler == NULL || compile_method == NULL) {
+    *error_msg = StringPrintf("%s doesn't have a JIT compiler", library);
+    dlclose(compiler_library);
+    return NULL;
+  }
+  JitCodeCache* code_cache = JitCodeCache::Create(code_cache_capacity);
+  if (code_cache == NULL) {
+    *error_msg = StringPrintf("Failed to map a JIT code cache of %s",
+                              PrettySize(code_cache_capacity).c_str());
+    dlclose(compiler_library);
+    return NULL;
+  }
+  UniquePtr<Jit> jit(new Jit(threshold, code_cache));
+  jit->compiler_library_ = compiler_library;
+  jit->compiler_ = create_compiler();
+  jit->delete_compiler_ = delete_compiler;
+  jit->compile_method_ = compile_method;
+  return jit.release();
+}
+
+Jit::Jit(size_t threshold, JitCodeCache* code_cache)
+    : threshold_(threshold),
+      code_cache_(code_cache),
+      compiler_library_(NULL),
+      compiler_(NULL),
+      delete_compiler_(NULL),
+      compile_method_(NULL),
+      methods_compiled_(0),
+      methods_not_compiled_(0),
+      compile_time_ns_(0) {
+  memset(counters_, 0, sizeof(counters_));
+}
+
+Jit::~Jit() {
+  DeleteThreadPool();
+  delete_compiler_(compiler_);
+  dlclose(compiler_library_);
+}
+
+void Jit::CreateThreadPool() {
+  CHECK(thread_pool_.get() == NULL);
+  thread_pool_.reset(new ThreadPool(kJitThreads));
+  Runtime::Current()->SetUpThreadScheduling(thread_pool_.get(), Runtime::kCompilerThreads);
+  thread_pool_->StartWorkers(Thread::Current());
+}
+
+void Jit::DeleteThreadPool() {
+  if (thread_pool_.get() != NULL) {
+    thread_pool_->StopWorkers(Thread::Current());
+    thread_pool_.reset(NULL);
+  }
+}
+
+void Jit::AddSamples(Thread* self, mirror::ArtMethod* method, uint32_t count) {
+  Counter& counter = counters_[CounterIndex(method)];
+  if (UNLIKELY(counter.method != method)) {
+    counter.method = method;
+    counter.samples = 0;
+  }
+  counter.samples += count;
+  // Methods getting hot in the zygote are queued by their next sample after the fork.
+  if (UNLIKELY(counter.samples >= threshold_ && counter.samples < kQueuedSamples) &&
+      thread_pool_.get() != NULL) {
+    counter.samples = kQueuedSamples;
+    thread_pool_->AddTask(self, new JitCompileTask(method));
+  }
+}
+
+void Jit::ResetSamples(const mirror::ArtMethod* method) {
+  Counter& counter = counters_[CounterIndex(method)];
+  if (counter.method == method) {
+    counter.samples = 0;
+  }
+}
+
+void Jit::CompileMethod(Thread* self, mirror::ArtMethod* method) {
+  {
+    ScopedObjectAccess soa(self);
+    // The compiler relies on the verifier, methods that need access checks stay interpreted.
+    if (method->IsNative() || method->IsAbstract() || method->IsProxyMethod() ||
+        !method->IsPreverified() ||
+        method->GetEntryPointFromInterpreter() == artInterpreterToCompiledCodeBridge) {
+      return;
+    }
+  }
+  uint64_t start_ns = NanoTime();
+  UniquePtr<OatFile::OatMethod> oat_method(compile_method_(compiler_, self, method,
+                                                           code_cache_.get()));
+  uint64_t compile_time_ns = NanoTime() - start_ns;
+  compile_time_ns_ += compile_time_ns;
+  Metrics* metrics = Runtime::Current()->GetMetrics();
+  if (metrics != NULL) {
+    metrics->Add(Metrics::kJitCompileTimeNs, compile_time_ns);
+    metrics->RecordValue(Metrics::kJitCompileTimeHistogram, compile_time_ns);
+  }
+  if (oat_method.get() == NULL) {
+    ++methods_not_compiled_;
+    if (metrics != NULL) {
+      metrics->Add(Metrics::kJitMethodsDeclined, 1);
+    }
+    return;
+  }
+  ScopedObjectAccess soa(self);
+  if (!InstallCode(method, *oat_method)) {
+    code_cache_->FreeMethod(self, method);
+    ++methods_not_compiled_;
+    if (metrics != NULL) {
+      metrics->Add(Metrics::kJitMethodsDeclined, 1);
+    }
+    return;
+  }
+  ++methods_compiled_;
+  if (metrics != NULL) {
+    metrics->Add(Metrics::kJitMethodsCompiled, 1);
+  }
+  VLOG(compiler) << "JIT compiled " << PrettyMethod(method) << " in "
+                 << PrettyDuration(NanoTime() - start_ns);
+}
+
+bool Jit::InstallCode(mirror::ArtMethod* method, const OatFile::OatMethod& oat_method) {
+  // The code stays in the cache but isn't run if debugging or tracing needs the method
+  // interpreted, or if it's a static method of a class still initializing, whose entry points the
+  // class linker sets once the initialization ends.
+  instrumentation::Instrumentation* instrumentation = Runtime::Current()->GetInstrumentation();
+  if (instrumentation->InterpretOnly() || instrumentation->IsDeoptimized(method) ||
+      (method->IsStatic() && !method->GetDeclaringClass()->IsInitialized())) {
+    return false;
+  }
+  method->SetFrameSizeInBytes(oat_method.GetFrameSizeInBytes());
+  method->SetCoreSpillMask(oat_method.GetCoreSpillMask());
+  method->SetFpSpillMask(oat_method.GetFpSpillMask());
+  method->SetMappingTable(oat_method.GetMappingTable());
+  method->SetVmapTable(oat_method.GetVmapTable());
+  method->SetNativeGcMap(oat_method.GetNativeGcMap());
+  // Threads that see the new entry points must also see the tables of the frames it creates.
+  ANDROID_MEMBAR_STORE();
+  instrumentation->UpdateMethodsCode(method, oat_method.GetCode());
+  method->SetEntryPointFromInterpreter(artInterpreterToCompiledCodeBridge);
+  return true;
+}
+
+void Jit::DumpForSigQuit(std::ostream& os) {
+  os << "JIT: " << methods_compiled_ << " methods compiled and " << methods_not_compiled_
+     << " declined in " << PrettyDuration(compile_time_ns_) << "\n";
+  code_cache_->Dump(os);
+}
+
+}  // namespace jit
+}  // namespace art
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_JIT_H_
+#define ART_RUNTIME_JIT_JIT_H_
+
+#include <iosfwd>
+#include <string>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "jit_code_cache.h"
+#include "oat_file.h"
+#include "thread_pool.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+namespace mirror {
+class ArtMethod;
+}  // namespace mirror
+
+class Thread;
+
+namespace jit {
+
+// Compiles the methods the interpreter runs the most, enabled with -Xjit. The interpreter counts
+// the invocations and back-edges of the methods it runs and, once a method has threshold of them,
+// queues it for a background thread that compiles it with the Quick compiler of libart-compiler
+// into the code cache. The compiled code then replaces the method's interpreter entry points, so
+// that its next invocations run compiled. A method stays interpreted for the invocations already
+// running it, there's no on-stack replacement of the interpreter frames of long loops.
+//
+// Counters are kept in a hashed table rather than in the methods, which Java mirrors. A method
+// colliding with another only loses their samples, which delays its compilation.
+class Jit {
+ public:
+  static const size_t kDefaultThreshold = 10000;
+
+  // Loads the compiler and maps the code cache. Returns NULL with error_msg set on failure.
+  static Jit* Create(size_t threshold, size_t code_cache_capacity, std::string* error_msg);
+
+  ~Jit();
+
+  // Compilation only starts once the thread pool is created, after forking from the zygote.
+  void CreateThreadPool();
+  void DeleteThreadPool();
+
+  // Counts count invocations or back-edges of method run by the interpreter.
+  void AddSamples(Thread* self, mirror::ArtMethod* method, uint32_t count)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Lets the interpreter count a method evicted from the code cache afresh.
+  void ResetSamples(const mirror::ArtMethod* method)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Compiles method on the JIT thread and installs its code, unless the method can't run compiled
+  // code at this point.
+  void CompileMethod(Thread* self, mirror::ArtMethod* method)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
+  JitCodeCache* GetCodeCache() const {
+    return code_cache_.get();
+  }
+
+  void DumpForSigQuit(std::ostream& os);
+
+ private:
+  typedef void* (*CreateCompilerFn)();
+  typedef void (*DeleteCompilerFn)(void* compiler);
+  // Returns the compiled method described by offsets from the start of the code cache, or NULL.
+  typedef OatFile::OatMethod* (*CompileMethodFn)(void* compiler, Thread* self,
+                                                 mirror::ArtMethod* method,
+                                                 JitCodeCache* code_cache);
+
+  struct Counter {
+    const mirror::ArtMethod* method;
+    uint32_t samples;
+  };
+
+  static const size_t kNumCounters = 4096;
+  // Samples of a queued method are set to this, so that it is only queued once.
+  static const uint32_t kQueuedSamples = 0x80000000;
+
+  Jit(size_t threshold, JitCodeCache* code_cache);
+
+  static size_t CounterIndex(const mirror::ArtMethod* method) {
+    return (reinterpret_cast<uintptr_t>(method) >> 3) % kNumCounters;
+  }
+
+  // Points the method's entry points at its compiled code, returns false if it can't run it.
+  bool InstallCode(mirror::ArtMethod* method, const OatFile::OatMethod& oat_method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  const size_t threshold_;
+
+  UniquePtr<JitCodeCache> code_cache_;
+
+  void* compiler_library_;
+  void* compiler_;
+  DeleteCompilerFn delete_compiler_;
+  CompileMethodFn compile_method_;
+
+  UniquePtr<ThreadPool> thread_pool_;
+
+  // Incremented without synchronization by the interpreter threads, lost updates only delay
+  // compilations.
+  Counter counters_[kNumCounters];
+
+  // Only written by the JIT thread.
+  size_t methods_compiled_;
+  size_t methods_not_compiled_;
+  uint64_t compile_time_ns_;
+
+  DISALLOW_COPY_AND_ASSIGN(Jit);
+};
+
+}  // namespace jit
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_JIT_H_
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit_code_cache.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <cutils/ashmem.h>
+
+#include <ostream>
+#include <set>
+
+#include "entrypoints/entrypoint_utils.h"
+#include "instrumentation.h"
+#include "interpreter/interpreter.h"
+#include "jit.h"
+#include "mirror/art_method-inl.h"
+#include "runtime.h"
+#include "ScopedFd.h"
+#include "stack.h"
+#include "thread.h"
+#include "thread_list.h"
+#include "utils.h"
+
+namespace art {
+namespace jit {
+
+JitCodeCache* JitCodeCache::Create(size_t capacity) {
+  capacity = RoundUp(capacity, kPageSize);
+  ScopedFd fd(ashmem_create_region("dalvik-jit-code-cache", capacity));
+  if (fd.get() == -1) {
+    PLOG(WARNING) << "ashmem_create_region failed for the JIT code cache";
+    // Without a region to map twice, the cache is mapped once writable and executable.
+    MemMap* mem_map = MemMap::MapAnonymous("jit-code-cache", NULL, capacity,
+                                           PROT_READ | PROT_WRITE | PROT_EXEC);
+    return (mem_map == NULL) ? NULL : new JitCodeCache(mem_map, NULL);
+  }
+  UniquePtr<MemMap> exec_map(MemMap::MapFile(capacity, PROT_READ | PROT_EXEC, MAP_SHARED,
+                                             fd.get(), 0));
+  if (exec_map.get() == NULL) {
+    return NULL;
+  }
+  MemMap* writable_map = MemMap::MapFile(capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+  if (writable_map == NULL) {
+    return NULL;
+  }
+  return new JitCodeCache(exec_map.release(), writable_map);
+}
+
+JitCodeCache::JitCodeCache(MemMap* exec_map, MemMap* writable_map)
+    : exec_map_(exec_map),
+      writable_map_(writable_map),
+      writable_begin_((writable_map != NULL) ? writable_map->Begin() : exec_map->Begin()),
+      lock_("jit code cache lock"),
+      used_bytes_(0),
+      num_evictions_(0),
+      num_methods_evicted_(0) {
+  free_blocks_[0] = exec_map->Size();
+}
+
+bool JitCodeCache::AllocateBlock(size_t size, size_t* offset) {
+  // First fit, the cache is small enough that a linear search doesn't matter next to compiling.
+  for (std::map<size_t, size_t>::iterator it = free_blocks_.begin(); it != free_blocks_.end();
+       ++it) {
+    if (it->second >= size) {
+      *offset = it->first;
+      if (it->second > size) {
+        free_blocks_[it->first + size] = it->second - size;
+      }
+      free_blocks_.erase(it);
+      used_bytes_ += size;
+      return true;
+    }
+  }
+  return false;
+}
+
+void JitCodeCache::FreeBlock(size_t offset, size_t size) {
+  used_bytes_ -= size;
+  std::map<size_t, size_t>::iterator next = free_blocks_.lower_bound(offset);
+  if (next != free_blocks_.end() && offset + size == next->first) {
+    size += next->second;
+    free_blocks_.erase(next++);
+  }
+  if (next != free_blocks_.begin()) {
+    std::map<size_t, size_t>::iterator prev = next;
+    --prev;
+    if (prev->first + prev->second == offset) {
+      prev->second += size;
+      return;
+    }
+  }
+  free_blocks_[offset] = size;
+}
+
+static void CopyTable(const std::vector<uint8_t>& table, byte* writable_begin, size_t* offset,
+                      uint32_t* table_offset) {
+  if (table.empty()) {
+    *table_offset = 0;
+    return;
+  }
+  memcpy(writable_begin + *offset, &table[0], table.size());
+  *table_offset = *offset;
+  *offset += table.size();
+}
+
+const byte* JitCodeCache::CommitMethod(Thread* self, mirror::ArtMethod* method,
+                                       const std::vector<uint8_t>& code,
+                                       const std::vector<uint8_t>& mapping_table,
+                                       const std::vector<uint8_t>& vmap_table,
+                                       const std::vector<uint8_t>& gc_map,
+                                       uint32_t* mapping_table_offset,
+                                       uint32_t* vmap_table_offset, uint32_t* gc_map_offset) {
+  DCHECK(!code.empty());
+  uint32_t code_size = code.size();
+  size_t tables_size = mapping_table.size() + vmap_table.size() + gc_map.size();
+  // The size goes in the word before the code, as ArtMethod::GetCodeSize expects.
+  size_t code_offset = RoundUp(tables_size + sizeof(code_size), kCodeAlignment);
+  size_t block_size = RoundUp(code_offset + code_size, kCodeAlignment);
+  size_t offset;
+  bool allocated;
+  {
+    MutexLock mu(self, lock_);
+    allocated = AllocateBlock(block_size, &offset);
+  }
+  if (!allocated) {
+    EvictColdMethods(self);
+    MutexLock mu(self, lock_);
+    if (!AllocateBlock(block_size, &offset)) {
+      return NULL;
+    }
+  }
+  // The block is only reachable from method once its code is installed, so it is filled in
+  // without the lock.
+  size_t table_offset = offset;
+  CopyTable(mapping_table, writable_begin_, &table_offset, mapping_table_offset);
+  CopyTable(vmap_table, writable_begin_, &table_offset, vmap_table_offset);
+  CopyTable(gc_map, writable_begin_, &table_offset, gc_map_offset);
+  byte* writable_code = writable_begin_ + offset + code_offset;
+  memcpy(writable_code - sizeof(code_size), &code_size, sizeof(code_size));
+  memcpy(writable_code, &code[0], code_size);
+  // Write the code back from the data cache through the writable view, and drop any stale
+  // instructions of an evicted method from the instruction cache through the executable one.
+  const byte* exec_code = exec_map_->Begin() + offset + code_offset;
+  __builtin___clear_cache(reinterpret_cast<char*>(writable_code),
+                          reinterpret_cast<char*>(writable_code + code_size));
+  __builtin___clear_cache(reinterpret_cast<char*>(const_cast<byte*>(exec_code)),
+                          reinterpret_cast<char*>(const_cast<byte*>(exec_code + code_size)));
+  MutexLock mu(self, lock_);
+  DCHECK(methods_.find(method) == methods_.end()) << PrettyMethod(method);
+  Block block = { offset, block_size, true };
+  methods_.Put(method, block);
+  return exec_code;
+}
+
+void JitCodeCache::FreeMethod(Thread* self, const mirror::ArtMethod* method) {
+  MutexLock mu(self, lock_);
+  SafeMap<mirror::ArtMethod*, Block>::iterator it =
+      methods_.find(const_cast<mirror::ArtMethod*>(method));
+  CHECK(it != methods_.end()) << PrettyMethod(method);
+  FreeBlock(it->second.offset, it->second.size);
+  methods_.erase(it);
+}
+
+static void CollectOnStackMethods(Thread* thread, void* arg)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  struct OnStackVisitor : public StackVisitor {
+    OnStackVisitor(Thread* thread, std::set<mirror::ArtMethod*>* methods)
+        : StackVisitor(thread, NULL), methods_(methods) {}
+
+    virtual bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+      // Shadow frames run in the interpreter whatever the method's code.
+      if (GetCurrentQuickFrame() != NULL && GetMethod() != NULL) {
+        methods_->insert(GetMethod());
+      }
+      return true;
+    }
+
+    std::set<mirror::ArtMethod*>* const methods_;
+  };
+  OnStackVisitor visitor(thread, reinterpret_cast<std::set<mirror::ArtMethod*>*>(arg));
+  visitor.WalkStack();
+}
+
+void JitCodeCache::EvictColdMethods(Thread* self) {
+  Runtime* runtime = Runtime::Current();
+  ThreadList* thread_list = runtime->GetThreadList();
+  instrumentation::Instrumentation* instrumentation = runtime->GetInstrumentation();
+  // With all threads suspended, a method that isn't on a stack can't be running, nor about to run
+  // its code from an entry point loaded before the eviction.
+  thread_list->SuspendAll();
+  std::set<mirror::ArtMethod*> on_stack;
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    thread_list->ForEach(CollectOnStackMethods, &on_stack);
+  }
+  {
+    MutexLock mu(self, lock_);
+    ++num_evictions_;
+    for (SafeMap<mirror::ArtMethod*, Block>::iterator it = methods_.begin();
+         it != methods_.end();) {
+      if (on_stack.find(it->first) != on_stack.end()) {
+        it->second.referenced = true;
+        ++it;
+      } else if (it->second.referenced) {
+        it->second.referenced = false;
+        ++it;
+      } else {
+        // Back to the state of a method without code in its oat file.
+        mirror::ArtMethod* method = it->first;
+        method->SetEntryPointFromInterpreter(interpreter::artInterpreterToInterpreterBridge);
+        instrumentation->UpdateMethodsCode(method, GetCompiledCodeToInterpreterBridge());
+        method->SetFrameSizeInBytes(kStackAlignment);
+        method->SetCoreSpillMask(0);
+        method->SetFpSpillMask(0);
+        method->SetMappingTable(NULL);
+        method->SetVmapTable(NULL);
+        method->SetNativeGcMap(NULL);
+        runtime->GetJit()->ResetSamples(method);
+        FreeBlock(it->second.offset, it->second.size);
+        ++num_methods_evicted_;
+        methods_.erase(it++);
+      }
+    }
+  }
+  thread_list->ResumeAll();
+}
+
+void JitCodeCache::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  size_t largest_free_block = 0;
+  for (std::map<size_t, size_t>::const_iterator it = free_blocks_.begin();
+       it != free_blocks_.end(); ++it) {
+    largest_free_block = std::max(largest_free_block, it->second);
+  }
+  os << "JIT code cache: " << methods_.size() << " methods in " << PrettySize(used_bytes_)
+     << " of " << PrettySize(exec_map_->Size()) << ", largest free block "
+     << PrettySize(largest_free_block) << ", " << num_methods_evicted_ << " methods evicted in "
+     << num_evictions_ << " evictions\n";
+}
+
+}  // namespace jit
+}  // namespace art
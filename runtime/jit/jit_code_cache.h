@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_JIT_CODE_CACHE_H_
+#define ART_RUNTIME_JIT_JIT_CODE_CACHE_H_
+
+#include <iosfwd>
+#include <map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "globals.h"
+#include "mem_map.h"
+#include "safe_map.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+namespace mirror {
+class ArtMethod;
+}  // namespace mirror
+
+class Thread;
+
+namespace jit {
+
+// Executable memory holding the code and tables of the methods compiled by the JIT, the size of
+// which is fixed when it is created. Each method gets one block with its tables followed by its
+// code, laid out as the oat writer lays code out, behind its size, so that the code of a method
+// looks the same to stack walks whether it came from an oat file or from here.
+//
+// The memory is mapped twice, writable to copy methods in and executable to run them, so that no
+// page is ever both. When the cache is full, the methods that weren't on any stack at the last two
+// evictions are evicted: they go back to the interpreter, which counts them afresh.
+class JitCodeCache {
+ public:
+  static const size_t kDefaultCapacity = 4 * MB;
+  // Strictest of the instruction set code alignments, also the size blocks are rounded to.
+  static const size_t kCodeAlignment = 16;
+
+  // Returns NULL if the cache couldn't be mapped.
+  static JitCodeCache* Create(size_t capacity);
+
+  // Copies the code and tables of method to a block of the cache, evicting cold methods if there
+  // isn't enough room. Returns the start of the code, aligned to kCodeAlignment, and sets the
+  // offsets of the tables from Begin(), zero for empty tables. Returns NULL if the method doesn't
+  // fit even after the eviction.
+  const byte* CommitMethod(Thread* self, mirror::ArtMethod* method,
+                           const std::vector<uint8_t>& code,
+                           const std::vector<uint8_t>& mapping_table,
+                           const std::vector<uint8_t>& vmap_table,
+                           const std::vector<uint8_t>& gc_map,
+                           uint32_t* mapping_table_offset, uint32_t* vmap_table_offset,
+                           uint32_t* gc_map_offset)
+      LOCKS_EXCLUDED(lock_, Locks::mutator_lock_);
+
+  // Frees the block of a method whose code couldn't be installed.
+  void FreeMethod(Thread* self, const mirror::ArtMethod* method) LOCKS_EXCLUDED(lock_);
+
+  // Methods are described like oat methods, by offsets from the start of the cache.
+  const byte* Begin() const {
+    return exec_map_->Begin();
+  }
+
+  bool Contains(const void* address) const {
+    return exec_map_->HasAddress(address);
+  }
+
+  void Dump(std::ostream& os) LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct Block {
+    size_t offset;
+    size_t size;
+    // Whether the method was on a stack at the last eviction, or committed since.
+    bool referenced;
+  };
+
+  JitCodeCache(MemMap* exec_map, MemMap* writable_map);
+
+  // Finds a free block of size bytes, returns false if there isn't any.
+  bool AllocateBlock(size_t size, size_t* offset) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void FreeBlock(size_t offset, size_t size) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Points the cold methods back to the interpreter and frees their blocks.
+  void EvictColdMethods(Thread* self) LOCKS_EXCLUDED(lock_, Locks::mutator_lock_);
+
+  // Executable view of the cache, and its writable view when they are different mappings.
+  UniquePtr<MemMap> exec_map_;
+  UniquePtr<MemMap> writable_map_;
+  byte* writable_begin_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+
+  // The blocks of the methods in the cache and the free ones, by offset, adjacent free blocks
+  // being merged.
+  SafeMap<mirror::ArtMethod*, Block> methods_ GUARDED_BY(lock_);
+  std::map<size_t, size_t> free_blocks_ GUARDED_BY(lock_);
+
+  size_t used_bytes_ GUARDED_BY(lock_);
+  size_t num_evictions_ GUARDED_BY(lock_);
+  size_t num_methods_evicted_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(JitCodeCache);
+};
+
+}  // namespace jit
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_JIT_CODE_CACHE_H_
@@ -17,6 +17,7 @@
 #include "jni_internal.h"
 
 #include <dlfcn.h>
+#include <link.h>
 
 #include <cstdarg>
 #include <utility>
@@ -45,6 +46,7 @@
 #include "scoped_thread_state_change.h"
 #include "ScopedLocalRef.h"
 #include "thread.h"
+#include "thread_list.h"
 #include "utf.h"
 #include "UniquePtr.h"
 #include "well_known_classes.h"
@@ -141,7 +143,7 @@ void InvokeWithArgArray(const ScopedObjectAccess& soa, ArtMethod* method,
                         ArgArray* arg_array, JValue* result, char result_type)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   uint32_t* args = arg_array->GetArray();
-  if (UNLIKELY(soa.Env()->check_jni)) {
+  if (UNLIKELY(soa.Env()->check_jni) && !soa.Vm()->check_jni_lite) {
     CheckMethodArguments(method, args);
   }
   method->Invoke(soa.Self(), args, arg_array->GetNumBytes(), result, result_type);
@@ -326,16 +328,41 @@ static jfieldID FindFieldID(const ScopedObjectAccess& soa, jclass jni_class, con
 
 static void PinPrimitiveArray(const ScopedObjectAccess& soa, const Array* array)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  JavaVMExt* vm = soa.Vm();
-  MutexLock mu(soa.Self(), vm->pins_lock);
-  vm->pin_table.Add(array);
+  JNIEnvExt* env = soa.Env();
+  MutexLock mu(soa.Self(), env->pins_lock);
+  env->pins.Add(array);
+}
+
+struct UnpinArgs {
+  Thread* self;
+  const Array* array;
+  bool unpinned;
+};
+
+static void UnpinFromThread(Thread* thread, void* arg) {
+  UnpinArgs* args = reinterpret_cast<UnpinArgs*>(arg);
+  JNIEnvExt* env = thread->GetJniEnv();
+  // Threads still attaching have no JNIEnv yet.
+  if (args->unpinned || env == NULL) {
+    return;
+  }
+  MutexLock mu(args->self, env->pins_lock);
+  args->unpinned = env->pins.Remove(args->array);
 }
 
 static void UnpinPrimitiveArray(const ScopedObjectAccess& soa, const Array* array)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-  JavaVMExt* vm = soa.Vm();
-  MutexLock mu(soa.Self(), vm->pins_lock);
-  vm->pin_table.Remove(array);
+  JNIEnvExt* env = soa.Env();
+  {
+    MutexLock mu(soa.Self(), env->pins_lock);
+    if (env->pins.Remove(array)) {
+      return;
+    }
+  }
+  // Elements may be released by another thread than the one that got them.
+  UnpinArgs args = { soa.Self(), array, false };
+  MutexLock mu(soa.Self(), *Locks::thread_list_lock_);
+  Runtime::Current()->GetThreadList()->ForEach(UnpinFromThread, &args);
 }
 
 static void ThrowAIOOBE(ScopedObjectAccess& soa, Array* array, jsize start,
@@ -451,7 +478,8 @@ class SharedLibrary {
         jni_on_load_lock_("JNI_OnLoad lock"),
         jni_on_load_cond_("JNI_OnLoad condition variable", jni_on_load_lock_),
         jni_on_load_thread_id_(Thread::Current()->GetThinLockId()),
-        jni_on_load_result_(kPending) {
+        jni_on_load_result_(kPending),
+        jni_symbols_state_(kJniSymbolsNotIndexed) {
   }
 
   Object* GetClassLoader() {
@@ -506,7 +534,17 @@ class SharedLibrary {
     jni_on_load_cond_.Broadcast(self);
   }
 
+  // Looks JNI symbols up in an index of the library's own JNI symbols, built on the first lookup,
+  // rather than one dlsym each, as a class may call for hundreds of them. Falls back to dlsym for
+  // the libraries whose dynamic symbol table can't be read. Callers hold libraries_lock.
   void* FindSymbol(const std::string& symbol_name) {
+    if (jni_symbols_state_ == kJniSymbolsNotIndexed) {
+      jni_symbols_state_ = IndexJniSymbols() ? kJniSymbolsIndexed : kJniSymbolsNotIndexable;
+    }
+    if (jni_symbols_state_ == kJniSymbolsIndexed && StartsWith(symbol_name, kJniSymbolPrefix)) {
+      auto it = jni_symbols_.find(symbol_name);
+      return (it == jni_symbols_.end()) ? NULL : it->second;
+    }
     return dlsym(handle_, symbol_name.c_str());
   }
 
@@ -517,6 +555,101 @@ class SharedLibrary {
     kOkay,
   };
 
+  enum JniSymbolsState {
+    kJniSymbolsNotIndexed,
+    kJniSymbolsIndexed,
+    kJniSymbolsNotIndexable,
+  };
+
+  static constexpr const char* kJniSymbolPrefix = "Java_";
+
+  // The loaded objects named like the library, there should be exactly one.
+  struct LoadedObjects {
+    const char* name;
+    size_t count;
+    dl_phdr_info info;
+  };
+
+  static int FindLoadedObject(dl_phdr_info* info, size_t, void* data) {
+    LoadedObjects* objects = reinterpret_cast<LoadedObjects*>(data);
+    // Bionic only keeps the base names of the libraries it loads.
+    const char* name = (info->dlpi_name != NULL) ? strrchr(info->dlpi_name, '/') : NULL;
+    name = (name != NULL) ? name + 1 : info->dlpi_name;
+    if (name != NULL && strcmp(name, objects->name) == 0) {
+      objects->info = *info;
+      ++objects->count;
+    }
+    return 0;
+  }
+
+  // Reads the JNI symbols the library defines from the dynamic symbol table the loader mapped,
+  // sized by the .hash section. Returns false, leaving the index empty, if the library has no
+  // .hash section, only one of the GNU style, or if the index doesn't agree with dlsym.
+  bool IndexJniSymbols() {
+    LoadedObjects objects;
+    objects.name = strrchr(path_.c_str(), '/');
+    objects.name = (objects.name != NULL) ? objects.name + 1 : path_.c_str();
+    objects.count = 0;
+    dl_iterate_phdr(FindLoadedObject, &objects);
+    if (objects.count != 1) {
+      return false;
+    }
+    ElfW(Addr) load_bias = objects.info.dlpi_addr;
+    const ElfW(Dyn)* dynamic = NULL;
+    for (size_t i = 0; i < objects.info.dlpi_phnum; ++i) {
+      if (objects.info.dlpi_phdr[i].p_type == PT_DYNAMIC) {
+        dynamic = reinterpret_cast<const ElfW(Dyn)*>(load_bias + objects.info.dlpi_phdr[i].p_vaddr);
+      }
+    }
+    if (dynamic == NULL) {
+      return false;
+    }
+    ElfW(Addr) hash = 0;
+    ElfW(Addr) symtab = 0;
+    ElfW(Addr) strtab = 0;
+    for (; dynamic->d_tag != DT_NULL; ++dynamic) {
+      if (dynamic->d_tag == DT_HASH) {
+        hash = dynamic->d_un.d_ptr;
+      } else if (dynamic->d_tag == DT_SYMTAB) {
+        symtab = dynamic->d_un.d_ptr;
+      } else if (dynamic->d_tag == DT_STRTAB) {
+        strtab = dynamic->d_un.d_ptr;
+      }
+    }
+    if (hash == 0 || symtab == 0 || strtab == 0) {
+      return false;
+    }
+    // glibc relocates the addresses of the dynamic section when loading, bionic doesn't.
+    if (hash < load_bias) {
+      hash += load_bias;
+      symtab += load_bias;
+      strtab += load_bias;
+    }
+    // The second word of the .hash section is the number of symbols.
+    size_t num_symbols = reinterpret_cast<const ElfW(Word)*>(hash)[1];
+    const ElfW(Sym)* symbols = reinterpret_cast<const ElfW(Sym)*>(symtab);
+    const char* strings = reinterpret_cast<const char*>(strtab);
+    size_t prefix_length = strlen(kJniSymbolPrefix);
+    for (size_t i = 0; i < num_symbols; ++i) {
+      const char* name = strings + symbols[i].st_name;
+      if (symbols[i].st_shndx != SHN_UNDEF &&
+          strncmp(name, kJniSymbolPrefix, prefix_length) == 0) {
+        jni_symbols_.Put(name, reinterpret_cast<void*>(load_bias + symbols[i].st_value));
+      }
+    }
+    // Checks that the loaded object found is the library opened.
+    if (!jni_symbols_.empty()) {
+      auto first = jni_symbols_.begin();
+      if (dlsym(handle_, first->first.c_str()) != first->second) {
+        LOG(WARNING) << "Failed to index the JNI symbols of \"" << path_ << "\"";
+        jni_symbols_.clear();
+        return false;
+      }
+    }
+    VLOG(jni) << "[Indexed " << jni_symbols_.size() << " JNI symbols of \"" << path_ << "\"]";
+    return true;
+  }
+
   // Path to library "/system/lib/libjni.so".
   std::string path_;
 
@@ -534,6 +667,11 @@ class SharedLibrary {
   uint32_t jni_on_load_thread_id_ GUARDED_BY(jni_on_load_lock_);
   // Result of earlier JNI_OnLoad call.
   JNI_OnLoadState jni_on_load_result_ GUARDED_BY(jni_on_load_lock_);
+
+  // Guarded by libraries_lock, as FindSymbol.
+  JniSymbolsState jni_symbols_state_;
+  // The addresses of the JNI symbols the library defines, by name.
+  SafeMap<std::string, void*> jni_symbols_;
 };
 
 // This exists mainly to keep implementation details out of the header file.
@@ -574,7 +712,73 @@ class Libraries {
   void* FindNativeMethod(const ArtMethod* m, std::string& detail)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     std::string jni_short_name(JniShortName(m));
-    std::string jni_long_name(JniLongName(m));
+    std::string jni_long_name;
+    void* fn = FindNativeMethod(m, jni_short_name, &jni_long_name);
+    if (fn != NULL) {
+      return fn;
+    }
+    if (jni_long_name.empty()) {
+      jni_long_name = JniLongName(m);
+    }
+    detail += "No implementation found for ";
+    detail += PrettyMethod(m);
+    detail += " (tried " + jni_short_name + " and " + jni_long_name + ")";
+    LOG(ERROR) << detail;
+    return NULL;
+  }
+
+  // Registers the native methods of c not registered yet whose code the libraries loaded so far
+  // define, so that their first calls don't each come to FindNativeMethod.
+  void LinkNativeMethods(Thread* self, Class* c) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    const ClassLoader* class_loader = c->GetClassLoader();
+    bool has_library = false;
+    for (const auto& lib : libraries_) {
+      if (lib.second->GetClassLoader() == class_loader) {
+        has_library = true;
+        break;
+      }
+    }
+    if (!has_library) {
+      return;
+    }
+    size_t num_direct_methods = c->NumDirectMethods();
+    size_t num_methods = num_direct_methods + c->NumVirtualMethods();
+    for (size_t i = 0; i < num_methods; ++i) {
+      ArtMethod* m = (i < num_direct_methods) ? c->GetDirectMethod(i)
+                                              : c->GetVirtualMethod(i - num_direct_methods);
+      if (m->IsNative() && !m->IsRegistered()) {
+        std::string jni_long_name;
+        void* fn = FindNativeMethod(m, JniShortName(m), &jni_long_name);
+        if (fn != NULL) {
+          m->RegisterNative(self, fn);
+        }
+      }
+    }
+  }
+
+  // Forgets the libraries of the class loaders the GC didn't mark. They stay open, a class loader
+  // loading one again gets a new entry and runs its JNI_OnLoad again. Only the thread loading a
+  // library uses its entry outside of libraries_lock, and that thread keeps the class loader of
+  // the library live.
+  void Sweep(IsMarkedTester is_marked, void* arg) {
+    for (auto it = libraries_.begin(); it != libraries_.end();) {
+      Object* class_loader = it->second->GetClassLoader();
+      if (class_loader == NULL || is_marked(class_loader, arg)) {
+        ++it;
+      } else {
+        VLOG(jni) << "[Unloaded the class loader of shared library \"" << it->first << "\"]";
+        delete it->second;
+        libraries_.erase(it++);
+      }
+    }
+  }
+
+ private:
+  // Tries the short name then the long name in each library of the method's class loader. The
+  // long name is only computed, into jni_long_name, once a library lacks the short name.
+  void* FindNativeMethod(const ArtMethod* m, const std::string& jni_short_name,
+                         std::string* jni_long_name)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     const ClassLoader* declaring_class_loader = m->GetDeclaringClass()->GetClassLoader();
     for (const auto& lib : libraries_) {
       SharedLibrary* library = lib.second;
@@ -585,7 +789,10 @@ class Libraries {
       // Try the short name then the long name...
       void* fn = library->FindSymbol(jni_short_name);
       if (fn == NULL) {
-        fn = library->FindSymbol(jni_long_name);
+        if (jni_long_name->empty()) {
+          *jni_long_name = JniLongName(m);
+        }
+        fn = library->FindSymbol(*jni_long_name);
       }
       if (fn != NULL) {
         VLOG(jni) << "[Found native code for " << PrettyMethod(m)
@@ -593,14 +800,9 @@ class Libraries {
         return fn;
       }
     }
-    detail += "No implementation found for ";
-    detail += PrettyMethod(m);
-    detail += " (tried " + jni_short_name + " and " + jni_long_name + ")";
-    LOG(ERROR) << detail;
     return NULL;
   }
 
- private:
   SafeMap<std::string, SharedLibrary*> libraries_;
 };
 
@@ -2010,10 +2212,14 @@ class JNI {
     return chars->GetData() + s->GetOffset();
   }
 
-  static void ReleaseStringChars(JNIEnv* env, jstring java_string, const jchar*) {
+  static void ReleaseStringChars(JNIEnv* env, jstring java_string, const jchar* chars) {
     CHECK_NON_NULL_ARGUMENT(GetStringUTFRegion, java_string);
     ScopedObjectAccess soa(env);
-    UnpinPrimitiveArray(soa, soa.Decode<String*>(java_string)->GetCharArray());
+    // The collector may have pointed the string at an equal array since, unpin the array the chars
+    // are in. Only strings at offset 0 change arrays, so the offset is still the one returned.
+    const jchar* data = chars - soa.Decode<String*>(java_string)->GetOffset();
+    UnpinPrimitiveArray(soa, reinterpret_cast<const CharArray*>(
+        reinterpret_cast<const byte*>(data) - CharArray::DataOffset(sizeof(jchar)).Int32Value()));
   }
 
   static const jchar* GetStringCritical(JNIEnv* env, jstring java_string, jboolean* is_copy) {
@@ -2360,8 +2566,9 @@ class JNI {
       const char* name = methods[i].name;
       const char* sig = methods[i].signature;
 
+      bool is_fast = false;
       if (*sig == '!') {
-        // TODO: fast jni. it's too noisy to log all these.
+        is_fast = true;
         ++sig;
       }
 
@@ -2382,9 +2589,10 @@ class JNI {
         return JNI_ERR;
       }
 
-      VLOG(jni) << "[Registering JNI native method " << PrettyMethod(m) << "]";
+      VLOG(jni) << "[Registering JNI native method " << PrettyMethod(m)
+                << (is_fast ? " (fast)" : "") << "]";
 
-      m->RegisterNative(soa.Self(), methods[i].fnPtr);
+      m->RegisterNative(soa.Self(), methods[i].fnPtr, is_fast);
     }
     return JNI_OK;
   }
@@ -2460,21 +2668,43 @@ class JNI {
     // At the moment, the Java side is limited to 32 bits.
     CHECK_LE(reinterpret_cast<uintptr_t>(address), 0xffffffff);
     CHECK_LE(capacity, 0xffffffff);
-    jlong address_arg = reinterpret_cast<jlong>(address);
-    jint capacity_arg = static_cast<jint>(capacity);
+    jvalue args[2];
+    args[0].j = reinterpret_cast<jlong>(address);
+    args[1].i = static_cast<jint>(capacity);
 
-    jobject result = env->NewObject(WellKnownClasses::java_nio_DirectByteBuffer,
-                                    WellKnownClasses::java_nio_DirectByteBuffer_init,
-                                    address_arg, capacity_arg);
-    return static_cast<JNIEnvExt*>(env)->self->IsExceptionPending() ? NULL : result;
+    // As NewObjectA, without going back through the function table and its argument checks.
+    ScopedObjectAccess soa(env);
+    Class* c = soa.Decode<Class*>(WellKnownClasses::java_nio_DirectByteBuffer);
+    if (UNLIKELY(!c->IsInitialized()) &&
+        !Runtime::Current()->GetClassLinker()->EnsureInitialized(c, true, true)) {
+      return NULL;
+    }
+    Object* buffer = c->AllocObject(soa.Self());
+    if (buffer == NULL) {
+      return NULL;
+    }
+    jobject result = soa.AddLocalReference<jobject>(buffer);
+    InvokeWithJValues(soa, result, WellKnownClasses::java_nio_DirectByteBuffer_init, args);
+    return soa.Self()->IsExceptionPending() ? NULL : result;
   }
 
+  // The fields are read directly at the offsets of the cached ArtFields, buffers being commonly
+  // inspected for every packet or frame.
   static void* GetDirectBufferAddress(JNIEnv* env, jobject java_buffer) {
-    return reinterpret_cast<void*>(env->GetLongField(java_buffer, WellKnownClasses::java_nio_DirectByteBuffer_effectiveDirectAddress));
+    CHECK_NON_NULL_ARGUMENT(GetDirectBufferAddress, java_buffer);
+    ScopedObjectAccess soa(env);
+    Object* buffer = soa.Decode<Object*>(java_buffer);
+    ArtField* f =
+        soa.DecodeField(WellKnownClasses::java_nio_DirectByteBuffer_effectiveDirectAddress);
+    return reinterpret_cast<void*>(f->GetLong(buffer));
   }
 
   static jlong GetDirectBufferCapacity(JNIEnv* env, jobject java_buffer) {
-    return static_cast<jlong>(env->GetIntField(java_buffer, WellKnownClasses::java_nio_DirectByteBuffer_capacity));
+    CHECK_NON_NULL_ARGUMENT(GetDirectBufferCapacity, java_buffer);
+    ScopedObjectAccess soa(env);
+    Object* buffer = soa.Decode<Object*>(java_buffer);
+    ArtField* f = soa.DecodeField(WellKnownClasses::java_nio_DirectByteBuffer_capacity);
+    return static_cast<jlong>(f->GetInt(buffer));
   }
 
   static jobjectRefType GetObjectRefType(JNIEnv* env, jobject java_object) {
@@ -2842,11 +3072,11 @@ JNIEnvExt::JNIEnvExt(Thread* self, JavaVMExt* vm)
       locals(kLocalsInitial, kLocalsMax, kLocal),
       check_jni(false),
       critical(false),
-      monitors("monitors", kMonitorsInitial, kMonitorsMax) {
+      monitors("monitors", kMonitorsInitial, kMonitorsMax),
+      pins_lock("JNI pin table lock", kPinTableLock),
+      pins("pin table", kPinTableInitial, kPinTableMax) {
   functions = unchecked_functions = &gJniNativeInterface;
-  if (vm->check_jni) {
-    SetCheckJniEnabled(true);
-  }
+  SetCheckJniEnabled(vm->check_jni);
   // The JniEnv local reference values must be at a consistent offset or else cross-compilation
   // errors will ensue.
   CHECK_EQ(JNIEnvExt::LocalRefCookieOffset().Int32Value(), 12);
@@ -2858,12 +3088,15 @@ JNIEnvExt::~JNIEnvExt() {
 
 void JNIEnvExt::SetCheckJniEnabled(bool enabled) {
   check_jni = enabled;
+  locals.SetStaleReferenceChecks(enabled);
   functions = enabled ? GetCheckJniNativeInterface() : &gJniNativeInterface;
 }
 
 void JNIEnvExt::DumpReferenceTables(std::ostream& os) {
   locals.Dump(os);
   monitors.Dump(os);
+  MutexLock mu(Thread::Current(), pins_lock);
+  pins.Dump(os);
 }
 
 void JNIEnvExt::PushFrame(int /*capacity*/) {
@@ -2995,11 +3228,10 @@ JavaVMExt::JavaVMExt(Runtime* runtime, Runtime::ParsedOptions* options)
       check_jni_abort_hook(NULL),
       check_jni_abort_hook_data(NULL),
       check_jni(false),
+      check_jni_lite(options->check_jni_lite_),
       force_copy(false),  // TODO: add a way to enable this
       trace(options->jni_trace_),
       work_around_app_jni_bugs(false),
-      pins_lock("JNI pin table lock", kPinTableLock),
-      pin_table("pin table", kPinTableInitial, kPinTableMax),
       globals_lock("JNI global reference table lock"),
       globals(gGlobalsInitial, gGlobalsMax, kGlobal),
       libraries_lock("JNI shared libraries map lock", kLoadLibraryLock),
@@ -3043,16 +3275,26 @@ void JavaVMExt::SetCheckJniEnabled(bool enabled) {
   functions = enabled ? GetCheckJniInvokeInterface() : &gJniInvokeInterface;
 }
 
+static void CountPins(Thread* thread, void* arg) {
+  JNIEnvExt* env = thread->GetJniEnv();
+  if (env != NULL) {
+    MutexLock mu(Thread::Current(), env->pins_lock);
+    *reinterpret_cast<size_t*>(arg) += env->pins.Size();
+  }
+}
+
 void JavaVMExt::DumpForSigQuit(std::ostream& os) {
-  os << "JNI: CheckJNI is " << (check_jni ? "on" : "off");
+  os << "JNI: CheckJNI is " << (check_jni ? (check_jni_lite ? "lite" : "on") : "off");
   if (force_copy) {
     os << " (with forcecopy)";
   }
   os << "; workarounds are " << (work_around_app_jni_bugs ? "on" : "off");
   Thread* self = Thread::Current();
   {
-    MutexLock mu(self, pins_lock);
-    os << "; pins=" << pin_table.Size();
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    size_t pins = 0;
+    runtime->GetThreadList()->ForEach(CountPins, &pins);
+    os << "; pins=" << pins;
   }
   {
     ReaderMutexLock mu(self, globals_lock);
@@ -3111,10 +3353,6 @@ void JavaVMExt::DumpReferenceTables(std::ostream& os) {
     MutexLock mu(self, weak_globals_lock_);
     weak_globals_.Dump(os);
   }
-  {
-    MutexLock mu(self, pins_lock);
-    pin_table.Dump(os);
-  }
 }
 
 bool JavaVMExt::LoadNativeLibrary(const std::string& path, ClassLoader* class_loader,
@@ -3160,9 +3398,9 @@ bool JavaVMExt::LoadNativeLibrary(const std::string& path, ClassLoader* class_lo
   // Failures here are expected when java.library.path has several entries
   // and we have to hunt for the lib.
 
-  // Below we dlopen but there is no paired dlclose, this would be necessary if we supported
-  // class unloading. Libraries will only be unloaded when the reference count (incremented by
-  // dlopen) becomes zero from dlclose.
+  // Below we dlopen but there is no paired dlclose, a library stays open after its class loader
+  // is unloaded, see Libraries::Sweep. Libraries will only be unloaded when the reference count
+  // (incremented by dlopen) becomes zero from dlclose.
 
   // This can execute slowly for a large library on a busy system, so we
   // want to switch from kRunnable while it executes.  This allows the GC to ignore us.
@@ -3274,16 +3512,22 @@ void* JavaVMExt::FindCodeForNativeMethod(ArtMethod* m) {
   return native_method;
 }
 
+void JavaVMExt::LinkNativeMethods(Thread* self, Class* c) {
+  MutexLock mu(self, libraries_lock);
+  libraries->LinkNativeMethods(self, c);
+}
+
+void JavaVMExt::SweepLibraries(IsMarkedTester is_marked, void* arg) {
+  MutexLock mu(Thread::Current(), libraries_lock);
+  libraries->Sweep(is_marked, arg);
+}
+
 void JavaVMExt::VisitRoots(RootVisitor* visitor, void* arg) {
   Thread* self = Thread::Current();
   {
     ReaderMutexLock mu(self, globals_lock);
     globals.VisitRoots(visitor, arg);
   }
-  {
-    MutexLock mu(self, pins_lock);
-    pin_table.VisitRoots(visitor, arg);
-  }
   // The weak_globals table is visited by the GC itself (because it mutates the table).
 }
 
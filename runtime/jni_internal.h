@@ -40,6 +40,7 @@ namespace art {
 namespace mirror {
   class ArtField;
   class ArtMethod;
+  class Class;
   class ClassLoader;
 }  // namespace mirror
 class ArgArray;
@@ -83,6 +84,13 @@ class JavaVMExt : public JavaVM {
   void* FindCodeForNativeMethod(mirror::ArtMethod* m)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  /**
+   * Registers the native methods of 'c' found in the native libraries
+   * loaded so far, at the end of its initialization.
+   */
+  void LinkNativeMethods(Thread* self, mirror::Class* c)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void DumpForSigQuit(std::ostream& os);
 
   void DumpReferenceTables(std::ostream& os)
@@ -99,6 +107,8 @@ class JavaVMExt : public JavaVM {
   void DeleteWeakGlobalRef(Thread* self, jweak obj)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void SweepWeakGlobals(IsMarkedTester is_marked, void* arg);
+  // Forgets the libraries loaded by the class loaders the GC unloads.
+  void SweepLibraries(IsMarkedTester is_marked, void* arg) LOCKS_EXCLUDED(libraries_lock);
   mirror::Object* DecodeWeakGlobal(Thread* self, IndirectRef ref);
 
   Runtime* runtime;
@@ -109,6 +119,9 @@ class JavaVMExt : public JavaVM {
 
   // Extra checking.
   bool check_jni;
+  // With check_jni, only checks the kinds of references, the thread and pending exceptions, as
+  // cheap enough for production: -Xcheck:jni:lite.
+  bool check_jni_lite;
   bool force_copy;
 
   // Extra diagnostics.
@@ -117,10 +130,6 @@ class JavaVMExt : public JavaVM {
   // Used to provide compatibility for apps that assumed direct references.
   bool work_around_app_jni_bugs;
 
-  // Used to hold references to pinned primitive arrays.
-  Mutex pins_lock DEFAULT_MUTEX_ACQUIRED_AFTER;
-  ReferenceTable pin_table GUARDED_BY(pins_lock);
-
   // JNI global references.
   ReaderWriterMutex globals_lock DEFAULT_MUTEX_ACQUIRED_AFTER;
   IndirectReferenceTable globals GUARDED_BY(globals_lock);
@@ -185,6 +194,12 @@ struct JNIEnvExt : public JNIEnv {
   // Entered JNI monitors, for bulk exit on thread detach.
   ReferenceTable monitors;
 
+  // Primitive arrays pinned by this thread's Get*ArrayElements, GetStringChars and Get*Critical
+  // calls. Only a release on another thread than the one that pinned the array contends for the
+  // lock.
+  Mutex pins_lock DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ReferenceTable pins GUARDED_BY(pins_lock);
+
   // Used by -Xcheck:jni.
   const JNINativeInterface* unchecked_functions;
 };
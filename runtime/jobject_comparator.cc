@@ -40,7 +40,7 @@ bool JobjectComparator::operator()(jobject jobj1, jobject jobj2) const {
   }
   // Sort by class...
   if (obj1->GetClass() != obj2->GetClass()) {
-    return obj1->GetClass()->IdentityHashCode() < obj2->IdentityHashCode();
+    return obj1->GetClass() < obj2->GetClass();
   } else {
     // ...then by size...
     size_t count1 = obj1->SizeOf();
@@ -48,8 +48,8 @@ bool JobjectComparator::operator()(jobject jobj1, jobject jobj2) const {
     if (count1 != count2) {
       return count1 < count2;
     } else {
-      // ...and finally by identity hash code.
-      return obj1->IdentityHashCode() < obj2->IdentityHashCode();
+      // ...and finally by address, which unlike the identity hash code is there without locking.
+      return obj1 < obj2;
     }
   }
 }
@@ -93,6 +93,40 @@ static inline int32_t DecodeSignedLeb128(const uint8_t** data) {
   return result;
 }
 
+// Batch decoding, for the runs of values in class data items and mapping tables. The values are
+// still decoded a byte at a time, which keeps the lengths of the values to the branch predictor.
+// Decoding eight bytes at a time with masks measured slower, the loads of a word then depend on
+// the lengths decoded from the previous one.
+
+// Reads count unsigned LEB128 values into out, updating the given pointer to point just past the
+// end of the last value.
+static inline void DecodeUnsignedLeb128Batch(const uint8_t** data, uint32_t* out, size_t count) {
+  const uint8_t* ptr = *data;
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = DecodeUnsignedLeb128(&ptr);
+  }
+  *data = ptr;
+}
+
+// Reads count signed LEB128 values into out, updating the given pointer to point just past the
+// end of the last value.
+static inline void DecodeSignedLeb128Batch(const uint8_t** data, int32_t* out, size_t count) {
+  const uint8_t* ptr = *data;
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = DecodeSignedLeb128(&ptr);
+  }
+  *data = ptr;
+}
+
+// Moves the given pointer past count LEB128 values, signed or unsigned, without decoding them.
+static inline void SkipLeb128(const uint8_t** data, size_t count) {
+  const uint8_t* ptr = *data;
+  for (size_t i = 0; i < count; ++i) {
+    DecodeUnsignedLeb128(&ptr);
+  }
+  *data = ptr;
+}
+
 // Returns the number of bytes needed to encode the value in unsigned LEB128.
 static inline uint32_t UnsignedLeb128Size(uint32_t data) {
   uint32_t count = 0;
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "leb128.h"
+
+#include <vector>
+
+#include "common_test.h"
+#include "utils.h"
+
+namespace art {
+
+class Leb128Test : public CommonTest {};
+
+static void EncodeUnsignedLeb128(std::vector<uint8_t>* out, uint32_t value) {
+  while (value > 0x7f) {
+    out->push_back((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out->push_back(value);
+}
+
+static void EncodeSignedLeb128(std::vector<uint8_t>* out, int32_t value) {
+  bool more = true;
+  while (more) {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    more = !((value == 0 && (byte & 0x40) == 0) || (value == -1 && (byte & 0x40) != 0));
+    out->push_back(more ? (byte | 0x80) : byte);
+  }
+}
+
+// Values of every encoded length, mixed so that they end at every position of a word.
+static std::vector<uint32_t> MixedValues(size_t count) {
+  static const uint32_t kValues[] = {
+    0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 0x1fffff, 0x200000, 0xfffffff, 0x10000000, 0xffffffff,
+    0x12345678, 0x40, 0xffffffc0, 0xfffff000, 0x80000000,
+  };
+  std::vector<uint32_t> values;
+  for (size_t i = 0; i < count; ++i) {
+    values.push_back(kValues[(i * 7 + i / 3) % arraysize(kValues)]);
+  }
+  return values;
+}
+
+TEST_F(Leb128Test, UnsignedBatch) {
+  for (size_t count = 0; count < 100; ++count) {
+    std::vector<uint32_t> values(MixedValues(count));
+    std::vector<uint8_t> encoded;
+    for (size_t i = 0; i < count; ++i) {
+      EncodeUnsignedLeb128(&encoded, values[i]);
+    }
+    // A trailing byte checks that decoding stops at the last value.
+    encoded.push_back(0xff);
+    std::vector<uint32_t> decoded(count + 1, 0xdeadbeef);
+    const uint8_t* ptr = &encoded[0];
+    DecodeUnsignedLeb128Batch(&ptr, &decoded[0], count);
+    EXPECT_EQ(&encoded[encoded.size() - 1], ptr);
+    for (size_t i = 0; i < count; ++i) {
+      EXPECT_EQ(values[i], decoded[i]) << count << " " << i;
+    }
+    EXPECT_EQ(0xdeadbeefU, decoded[count]);
+    ptr = &encoded[0];
+    SkipLeb128(&ptr, count);
+    EXPECT_EQ(&encoded[encoded.size() - 1], ptr);
+  }
+}
+
+TEST_F(Leb128Test, SignedBatch) {
+  for (size_t count = 0; count < 100; ++count) {
+    std::vector<uint32_t> values(MixedValues(count));
+    std::vector<uint8_t> encoded;
+    for (size_t i = 0; i < count; ++i) {
+      EncodeSignedLeb128(&encoded, values[i]);
+    }
+    std::vector<int32_t> decoded(count + 1);
+    const uint8_t* ptr = encoded.empty() ? NULL : &encoded[0];
+    DecodeSignedLeb128Batch(&ptr, &decoded[0], count);
+    EXPECT_EQ(encoded.empty() ? NULL : &encoded[0] + encoded.size(), ptr);
+    for (size_t i = 0; i < count; ++i) {
+      EXPECT_EQ(static_cast<int32_t>(values[i]), decoded[i]) << count << " " << i;
+    }
+  }
+}
+
+// The fifth byte ends a value whatever its high bits, one at a time or in a batch.
+TEST_F(Leb128Test, FifthByte) {
+  std::vector<uint8_t> encoded;
+  for (size_t i = 0; i < 16; ++i) {
+    const uint8_t value[] = { 0x81, 0x82, 0x83, 0x84, 0xf5 };
+    encoded.insert(encoded.end(), value, value + arraysize(value));
+    encoded.push_back(i);
+  }
+  std::vector<uint32_t> expected;
+  const uint8_t* ptr = &encoded[0];
+  for (size_t i = 0; i < 32; ++i) {
+    expected.push_back(DecodeUnsignedLeb128(&ptr));
+  }
+  const uint8_t* end = ptr;
+  std::vector<uint32_t> decoded(32);
+  ptr = &encoded[0];
+  DecodeUnsignedLeb128Batch(&ptr, &decoded[0], 32);
+  EXPECT_EQ(end, ptr);
+  EXPECT_TRUE(expected == decoded);
+  ptr = &encoded[0];
+  SkipLeb128(&ptr, 32);
+  EXPECT_EQ(end, ptr);
+}
+
+// Not a check, logs how fast mapping table like values decode.
+TEST_F(Leb128Test, DecodeBenchmark) {
+  const size_t kCount = 1 << 20;
+  const size_t kIterations = 20;
+  std::vector<uint8_t> encoded;
+  for (size_t i = 0; i < kCount / 2; ++i) {
+    EncodeUnsignedLeb128(&encoded, i * 6);  // Native pc offset.
+    EncodeUnsignedLeb128(&encoded, i % 100);  // Dex pc.
+  }
+  std::vector<uint32_t> decoded(kCount);
+  uint64_t start_ns = NanoTime();
+  uint64_t sum = 0;
+  for (size_t i = 0; i < kIterations; ++i) {
+    const uint8_t* ptr = &encoded[0];
+    for (size_t j = 0; j < kCount; ++j) {
+      decoded[j] = DecodeUnsignedLeb128(&ptr);
+    }
+    sum += decoded[kCount - 1];
+  }
+  uint64_t one_at_a_time_ns = NanoTime() - start_ns;
+  start_ns = NanoTime();
+  for (size_t i = 0; i < kIterations; ++i) {
+    const uint8_t* ptr = &encoded[0];
+    DecodeUnsignedLeb128Batch(&ptr, &decoded[0], kCount);
+    sum += decoded[kCount - 1];
+  }
+  uint64_t batch_ns = NanoTime() - start_ns;
+  EXPECT_EQ(2 * kIterations * ((kCount / 2 - 1) % 100), sum);
+  LOG(INFO) << "Decoding " << kCount << " values: "
+            << PrettyDuration(one_at_a_time_ns / kIterations) << " one at a time, "
+            << PrettyDuration(batch_ns / kIterations) << " in batches";
+}
+
+}  // namespace art
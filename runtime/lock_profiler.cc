@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lock_profiler.h"
+
+#include <string>
+#include <utility>
+
+#include "atomic_integer.h"
+#include "base/histogram-inl.h"
+#include "base/stl_util.h"
+#include "base/stringprintf.h"
+#include "safe_map.h"
+#include "utils.h"
+
+namespace art {
+
+volatile bool LockProfiler::enabled_ = false;
+
+// Wait times are recorded in microseconds, the unit Histogram prints.
+static const uint64_t kInitialBucketWidthUs = 10;
+
+typedef SafeMap<std::string, Histogram<uint64_t>*> MutexHistograms;
+typedef SafeMap<std::pair<const mirror::ArtMethod*, uint32_t>, Histogram<uint64_t>*>
+    MonitorHistograms;
+
+// The histograms are leaked to avoid ordering issues with locks destroyed during shutdown.
+static MutexHistograms* gMutexHistograms = NULL;
+static MonitorHistograms* gMonitorHistograms = NULL;
+
+// Contention is recorded from within Mutex, so the histograms can't be guarded by one.
+static AtomicInteger gHistogramsGuard;
+
+class ScopedHistogramsLock {
+ public:
+  ScopedHistogramsLock() {
+    while (!gHistogramsGuard.compare_and_swap(0, 1)) {
+      NanoSleep(100);
+    }
+    if (gMutexHistograms == NULL) {
+      gMutexHistograms = new MutexHistograms;
+      gMonitorHistograms = new MonitorHistograms;
+    }
+  }
+
+  ~ScopedHistogramsLock() {
+    while (!gHistogramsGuard.compare_and_swap(1, 0)) {
+      NanoSleep(100);
+    }
+  }
+};
+
+void LockProfiler::RecordMutexContention(const char* lock_name, uint64_t wait_ns) {
+  ScopedHistogramsLock lock;
+  std::string name(lock_name);
+  Histogram<uint64_t>* histogram;
+  auto it = gMutexHistograms->find(name);
+  if (it != gMutexHistograms->end()) {
+    histogram = it->second;
+  } else {
+    histogram = new Histogram<uint64_t>(lock_name, kInitialBucketWidthUs);
+    gMutexHistograms->Put(name, histogram);
+  }
+  histogram->AddValue(wait_ns / 1000);
+}
+
+void LockProfiler::RecordMonitorContention(const mirror::ArtMethod* owner_method,
+                                           uint32_t owner_dex_pc, uint64_t wait_ns) {
+  std::pair<const mirror::ArtMethod*, uint32_t> location(owner_method, owner_dex_pc);
+  Histogram<uint64_t>* histogram = NULL;
+  {
+    ScopedHistogramsLock lock;
+    auto it = gMonitorHistograms->find(location);
+    if (it != gMonitorHistograms->end()) {
+      histogram = it->second;
+      histogram->AddValue(wait_ns / 1000);
+      return;
+    }
+  }
+  // Name the histogram after the owner's location outside of the guard, this may take locks.
+  std::string name(owner_method == NULL
+                   ? std::string("monitor with unknown owner location")
+                   : StringPrintf("monitor owned at %s:%u", PrettyMethod(owner_method).c_str(),
+                                  owner_dex_pc));
+  histogram = new Histogram<uint64_t>(name.c_str(), kInitialBucketWidthUs);
+  ScopedHistogramsLock lock;
+  auto it = gMonitorHistograms->find(location);
+  if (it == gMonitorHistograms->end()) {
+    gMonitorHistograms->Put(location, histogram);
+  } else {
+    delete histogram;  // Another thread got here first.
+    histogram = it->second;
+  }
+  histogram->AddValue(wait_ns / 1000);
+}
+
+template <typename Histograms>
+static void DumpHistograms(std::ostream& os, const Histograms& histograms) {
+  for (const auto& entry : histograms) {
+    Histogram<uint64_t>* histogram = entry.second;
+    Histogram<uint64_t>::CumulativeData cumulative_data;
+    histogram->CreateHistogram(cumulative_data);
+    os << "  " << histogram->SampleSize() << " waits, ";
+    histogram->PrintConfidenceIntervals(os, 0.99, cumulative_data);
+  }
+}
+
+void LockProfiler::Dump(std::ostream& os) {
+  if (!enabled_) {
+    return;
+  }
+  ScopedHistogramsLock lock;
+  os << "Lock contention (" << gMutexHistograms->size() << " runtime locks, "
+     << gMonitorHistograms->size() << " monitor owner locations):\n";
+  DumpHistograms(os, *gMutexHistograms);
+  DumpHistograms(os, *gMonitorHistograms);
+}
+
+void LockProfiler::Reset() {
+  ScopedHistogramsLock lock;
+  STLDeleteValues(gMutexHistograms);
+  STLDeleteValues(gMonitorHistograms);
+}
+
+}  // namespace art
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_LOCK_PROFILER_H_
+#define ART_RUNTIME_LOCK_PROFILER_H_
+
+#include <stdint.h>
+
+#include <iosfwd>
+
+#include "base/macros.h"
+
+namespace art {
+
+namespace mirror {
+class ArtMethod;
+}  // namespace mirror
+
+// Optional contention accounting for runtime locks and Java monitors, enabled with -Xlockprofiler
+// and dumped on SIGQUIT. Every wait for a contended lock adds its duration to a histogram, one
+// per runtime lock name and one per location at which the owner of a Java monitor acquired it.
+// Nothing is recorded for uncontended acquisitions, so the cost when locks don't contend is a
+// flag check.
+class LockProfiler {
+ public:
+  static void SetEnabled(bool enabled) {
+    enabled_ = enabled;
+  }
+
+  static bool IsEnabled() {
+    return enabled_;
+  }
+
+  // Records that a thread waited wait_ns for the runtime lock called lock_name.
+  static void RecordMutexContention(const char* lock_name, uint64_t wait_ns);
+
+  // Records that a thread waited wait_ns for a Java monitor whose owner acquired it in
+  // owner_method at owner_dex_pc. owner_method is NULL if the owner's location is unknown.
+  static void RecordMonitorContention(const mirror::ArtMethod* owner_method, uint32_t owner_dex_pc,
+                                      uint64_t wait_ns);
+
+  // Prints the wait time distribution of every contended lock.
+  static void Dump(std::ostream& os);
+
+  static void Reset();
+
+ private:
+  static volatile bool enabled_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(LockProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_LOCK_PROFILER_H_
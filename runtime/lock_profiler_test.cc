@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lock_profiler.h"
+
+#include <sstream>
+
+#include "common_test.h"
+#include "mirror/art_method.h"
+#include "mirror/class.h"
+
+namespace art {
+
+class LockProfilerTest : public CommonTest {};
+
+TEST_F(LockProfilerTest, Dump) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* object = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ASSERT_TRUE(object != NULL);
+  mirror::ArtMethod* init = object->FindDirectMethod("<init>", "()V");
+  ASSERT_TRUE(init != NULL);
+
+  LockProfiler::SetEnabled(true);
+  LockProfiler::RecordMutexContention("test lock", 2 * 1000 * 1000);
+  LockProfiler::RecordMutexContention("test lock", 4 * 1000 * 1000);
+  LockProfiler::RecordMonitorContention(init, 1, 1000 * 1000);
+  LockProfiler::RecordMonitorContention(NULL, 0, 1000 * 1000);
+
+  std::ostringstream os;
+  LockProfiler::Dump(os);
+  std::string dump(os.str());
+  EXPECT_NE(std::string::npos, dump.find("2 waits, test lock:")) << dump;
+  EXPECT_NE(std::string::npos, dump.find("1 waits, monitor owned at void java.lang.Object.<init>():1"))
+      << dump;
+  EXPECT_NE(std::string::npos, dump.find("1 waits, monitor with unknown owner location")) << dump;
+
+  LockProfiler::Reset();
+  LockProfiler::SetEnabled(false);
+  std::ostringstream empty;
+  LockProfiler::Dump(empty);
+  EXPECT_EQ("", empty.str());
+}
+
+}  // namespace art
@@ -36,14 +36,18 @@ enum LockLevel {
   kUnexpectedSignalLock,
   kThreadSuspendCountLock,
   kAbortLock,
+  kJdwpPacketQueueLock,
   kJdwpSocketLock,
   kAllocSpaceLock,
+  kRosAllocBracketLock,
   kMarkSweepMarkStackLock,
+  kSwapSpaceLock,
   kDefaultMutexLevel,
   kMarkSweepLargeObjectLock,
   kPinTableLock,
   kLoadLibraryLock,
   kJdwpObjectRegistryLock,
+  kClassLinkerClassTableShardLock,
   kClassLinkerClassesLock,
   kBreakpointLock,
   kThreadListLock,
@@ -23,8 +23,26 @@
 namespace art {
 
 // A utility for processing the raw uleb128 encoded mapping table created by the quick compiler.
+//
+// Table format:
+//     uleb128  total number of entries
+//     uleb128  number of pc to dex entries
+//     uleb128  number of pc to dex checkpoints
+//     uleb128  number of dex to pc checkpoints
+//     checkpoints, pc to dex ones first, each
+//         u4       native pc offset of the checkpointed entry
+//         u4       offset of the entry from the first pc to dex entry
+//     entries, pc to dex ones first, each
+//         uleb128  native pc offset
+//         uleb128  dex pc
+//
+// Both lists are sorted by native pc offset. Every kCheckpointInterval-th entry of a list, but
+// the first one, is checkpointed, so that a lookup by native pc offset only decodes the entries
+// following the checkpoint found by a binary search. The u4s are little-endian.
 class MappingTable {
  public:
+  static const uint32_t kCheckpointInterval = 16;
+
   explicit MappingTable(const uint8_t* encoded_map) : encoded_table_(encoded_map) {
   }
 
@@ -49,14 +67,17 @@ class MappingTable {
   }
 
   const uint8_t* FirstDexToPcPtr() const {
-    const uint8_t* table = encoded_table_;
+    const uint8_t* table = FirstPcToDexPtr();
     if (table != NULL) {
-      DecodeUnsignedLeb128(&table);  // Total_size, unused.
-      uint32_t pc_to_dex_size = DecodeUnsignedLeb128(&table);
-      for (uint32_t i = 0; i < pc_to_dex_size; ++i) {
-        DecodeUnsignedLeb128(&table);  // Move ptr past native PC.
-        DecodeUnsignedLeb128(&table);  // Move ptr past dex PC.
+      // Start from the last pc to dex checkpoint, if any.
+      uint32_t pc_to_dex_size = PcToDexSize();
+      uint32_t num_checkpoints = NumPcToDexCheckpoints();
+      uint32_t first = num_checkpoints * kCheckpointInterval;
+      if (num_checkpoints != 0) {
+        table += ReadU4(Checkpoint(num_checkpoints - 1) + 4);
       }
+      // Move ptr past the native and dex PCs of the remaining entries.
+      SkipLeb128(&table, 2 * (pc_to_dex_size - first));
     }
     return table;
   }
@@ -68,12 +89,18 @@ class MappingTable {
         native_pc_offset_(0), dex_pc_(0) {
       if (element == 0) {
         encoded_table_ptr_ = table_->FirstDexToPcPtr();
-        native_pc_offset_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
-        dex_pc_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
+        DecodeEntry(&encoded_table_ptr_, &native_pc_offset_, &dex_pc_);
       } else {
         DCHECK_EQ(table_->DexToPcSize(), element);
       }
     }
+    // Starts at the given element, encoded at encoded_table_ptr.
+    DexToPcIterator(const MappingTable* table, uint32_t element,
+                    const uint8_t* encoded_table_ptr) :
+        table_(table), element_(element), end_(table_->DexToPcSize()),
+        encoded_table_ptr_(encoded_table_ptr), native_pc_offset_(0), dex_pc_(0) {
+      DecodeEntry(&encoded_table_ptr_, &native_pc_offset_, &dex_pc_);
+    }
     uint32_t NativePcOffset() const {
       return native_pc_offset_;
     }
@@ -83,8 +110,7 @@ class MappingTable {
     void operator++() {
       ++element_;
       if (element_ != end_) {  // Avoid reading beyond the end of the table.
-        native_pc_offset_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
-        dex_pc_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
+        DecodeEntry(&encoded_table_ptr_, &native_pc_offset_, &dex_pc_);
       }
     }
     bool operator==(const DexToPcIterator& rhs) const {
@@ -114,6 +140,19 @@ class MappingTable {
     return DexToPcIterator(this, size);
   }
 
+  // Returns an iterator at or before the first dex to pc entry for native_pc_offset, at most
+  // kCheckpointInterval entries before it.
+  DexToPcIterator DexToPcFrom(uint32_t native_pc_offset) const {
+    uint32_t checkpoint;
+    if (!FindCheckpoint(NumPcToDexCheckpoints(), NumDexToPcCheckpoints(), native_pc_offset,
+                        &checkpoint)) {
+      return DexToPcBegin();
+    }
+    return DexToPcIterator(this, (checkpoint + 1) * kCheckpointInterval,
+                           FirstPcToDexPtr() + ReadU4(Checkpoint(NumPcToDexCheckpoints() +
+                                                                 checkpoint) + 4));
+  }
+
   uint32_t PcToDexSize() const PURE {
     const uint8_t* table = encoded_table_;
     if (table == NULL) {
@@ -126,10 +165,9 @@ class MappingTable {
   }
 
   const uint8_t* FirstPcToDexPtr() const {
-    const uint8_t* table = encoded_table_;
+    const uint8_t* table = Checkpoint(0);
     if (table != NULL) {
-      DecodeUnsignedLeb128(&table);  // Total_size, unused.
-      DecodeUnsignedLeb128(&table);  // PC to Dex size, unused.
+      table += (NumPcToDexCheckpoints() + NumDexToPcCheckpoints()) * 8;
     }
     return table;
   }
@@ -141,12 +179,18 @@ class MappingTable {
         native_pc_offset_(0), dex_pc_(0) {
       if (element == 0) {
         encoded_table_ptr_ = table_->FirstPcToDexPtr();
-        native_pc_offset_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
-        dex_pc_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
+        DecodeEntry(&encoded_table_ptr_, &native_pc_offset_, &dex_pc_);
       } else {
         DCHECK_EQ(table_->PcToDexSize(), element);
       }
     }
+    // Starts at the given element, encoded at encoded_table_ptr.
+    PcToDexIterator(const MappingTable* table, uint32_t element,
+                    const uint8_t* encoded_table_ptr) :
+        table_(table), element_(element), end_(table_->PcToDexSize()),
+        encoded_table_ptr_(encoded_table_ptr), native_pc_offset_(0), dex_pc_(0) {
+      DecodeEntry(&encoded_table_ptr_, &native_pc_offset_, &dex_pc_);
+    }
     uint32_t NativePcOffset() const {
       return native_pc_offset_;
     }
@@ -156,8 +200,7 @@ class MappingTable {
     void operator++() {
       ++element_;
       if (element_ != end_) {  // Avoid reading beyond the end of the table.
-        native_pc_offset_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
-        dex_pc_ = DecodeUnsignedLeb128(&encoded_table_ptr_);
+        DecodeEntry(&encoded_table_ptr_, &native_pc_offset_, &dex_pc_);
       }
     }
     bool operator==(const PcToDexIterator& rhs) const {
@@ -178,6 +221,16 @@ class MappingTable {
     uint32_t dex_pc_;  // The current value of dex pc.
   };
 
+  // The size in bytes of the encoded table, 0 if there is none.
+  size_t EncodedSize() const {
+    const uint8_t* table = FirstPcToDexPtr();
+    if (table == NULL) {
+      return 0;
+    }
+    SkipLeb128(&table, 2 * TotalSize());  // Move ptr past the native and dex PCs.
+    return table - encoded_table_;
+  }
+
   PcToDexIterator PcToDexBegin() const {
     return PcToDexIterator(this, 0);
   }
@@ -187,7 +240,83 @@ class MappingTable {
     return PcToDexIterator(this, size);
   }
 
+  // Returns an iterator at or before the first pc to dex entry for native_pc_offset, at most
+  // kCheckpointInterval entries before it.
+  PcToDexIterator PcToDexFrom(uint32_t native_pc_offset) const {
+    uint32_t checkpoint;
+    if (!FindCheckpoint(0, NumPcToDexCheckpoints(), native_pc_offset, &checkpoint)) {
+      return PcToDexBegin();
+    }
+    return PcToDexIterator(this, (checkpoint + 1) * kCheckpointInterval,
+                           FirstPcToDexPtr() + ReadU4(Checkpoint(checkpoint) + 4));
+  }
+
  private:
+  static uint32_t ReadU4(const uint8_t* ptr) {
+    return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (ptr[3] << 24);
+  }
+
+  // Decodes the entry at *ptr and moves ptr past it.
+  static void DecodeEntry(const uint8_t** ptr, uint32_t* native_pc_offset, uint32_t* dex_pc) {
+    uint32_t entry[2];
+    DecodeUnsignedLeb128Batch(ptr, entry, arraysize(entry));
+    *native_pc_offset = entry[0];
+    *dex_pc = entry[1];
+  }
+
+  uint32_t NumPcToDexCheckpoints() const {
+    const uint8_t* table = encoded_table_;
+    if (table == NULL) {
+      return 0;
+    }
+    DecodeUnsignedLeb128(&table);  // Total_size, unused.
+    DecodeUnsignedLeb128(&table);  // PC to Dex size, unused.
+    return DecodeUnsignedLeb128(&table);
+  }
+
+  uint32_t NumDexToPcCheckpoints() const {
+    const uint8_t* table = encoded_table_;
+    if (table == NULL) {
+      return 0;
+    }
+    DecodeUnsignedLeb128(&table);  // Total_size, unused.
+    DecodeUnsignedLeb128(&table);  // PC to Dex size, unused.
+    DecodeUnsignedLeb128(&table);  // PC to Dex checkpoints, unused.
+    return DecodeUnsignedLeb128(&table);
+  }
+
+  // The checkpoint at the given index, counting the pc to dex ones first.
+  const uint8_t* Checkpoint(uint32_t index) const {
+    const uint8_t* table = encoded_table_;
+    if (table == NULL) {
+      return NULL;
+    }
+    SkipLeb128(&table, 4);  // Move ptr past the sizes.
+    return table + index * 8;
+  }
+
+  // Finds the last of the num_checkpoints checkpoints starting at first whose native pc offset is
+  // less than native_pc_offset, returning its index relative to first.
+  bool FindCheckpoint(uint32_t first, uint32_t num_checkpoints, uint32_t native_pc_offset,
+                      uint32_t* checkpoint) const {
+    const uint8_t* checkpoints = Checkpoint(first);
+    uint32_t lo = 0;
+    uint32_t hi = num_checkpoints;
+    while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (ReadU4(checkpoints + mid * 8) < native_pc_offset) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo == 0) {
+      return false;
+    }
+    *checkpoint = lo - 1;
+    return true;
+  }
+
   const uint8_t* const encoded_table_;
 };
 
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mapping_table.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leb128_encoder.h"
+
+namespace art {
+
+// Encodes num_pc_to_dex and num_dex_to_pc entries mapping native pc offset 4 * i to dex pc i, with
+// checkpoints as the quick compiler emits them.
+static void EncodeTable(uint32_t num_pc_to_dex, uint32_t num_dex_to_pc,
+                        UnsignedLeb128EncodingVector* encoded) {
+  std::vector<uint32_t> checkpoints;
+  uint32_t entry_offset = 0;
+  uint32_t num_entries[] = { num_pc_to_dex, num_dex_to_pc };
+  for (size_t list = 0; list < 2; ++list) {
+    for (uint32_t i = 0; i < num_entries[list]; ++i) {
+      if (i != 0 && i % MappingTable::kCheckpointInterval == 0) {
+        checkpoints.push_back(4 * i);
+        checkpoints.push_back(entry_offset);
+      }
+      entry_offset += UnsignedLeb128Size(4 * i) + UnsignedLeb128Size(i);
+    }
+  }
+  uint32_t num_pc_to_dex_checkpoints =
+      num_pc_to_dex == 0 ? 0 : (num_pc_to_dex - 1) / MappingTable::kCheckpointInterval;
+  encoded->PushBack(num_pc_to_dex + num_dex_to_pc);
+  encoded->PushBack(num_pc_to_dex);
+  encoded->PushBack(num_pc_to_dex_checkpoints);
+  encoded->PushBack(checkpoints.size() / 2 - num_pc_to_dex_checkpoints);
+  for (size_t i = 0; i < checkpoints.size(); ++i) {
+    encoded->PushBackFixed32(checkpoints[i]);
+  }
+  for (size_t list = 0; list < 2; ++list) {
+    for (uint32_t i = 0; i < num_entries[list]; ++i) {
+      encoded->PushBack(4 * i);
+      encoded->PushBack(i);
+    }
+  }
+}
+
+TEST(MappingTableTest, Iterate) {
+  UnsignedLeb128EncodingVector encoded;
+  EncodeTable(100, 40, &encoded);
+  MappingTable table(&encoded.GetData()[0]);
+  EXPECT_EQ(140U, table.TotalSize());
+  EXPECT_EQ(100U, table.PcToDexSize());
+  EXPECT_EQ(40U, table.DexToPcSize());
+
+  uint32_t i = 0;
+  for (MappingTable::PcToDexIterator it = table.PcToDexBegin(), end = table.PcToDexEnd();
+       it != end; ++it, ++i) {
+    EXPECT_EQ(4 * i, it.NativePcOffset());
+    EXPECT_EQ(i, it.DexPc());
+  }
+  EXPECT_EQ(100U, i);
+  i = 0;
+  for (MappingTable::DexToPcIterator it = table.DexToPcBegin(), end = table.DexToPcEnd();
+       it != end; ++it, ++i) {
+    EXPECT_EQ(4 * i, it.NativePcOffset());
+    EXPECT_EQ(i, it.DexPc());
+  }
+  EXPECT_EQ(40U, i);
+}
+
+TEST(MappingTableTest, LookupFromCheckpoint) {
+  UnsignedLeb128EncodingVector encoded;
+  EncodeTable(100, 40, &encoded);
+  MappingTable table(&encoded.GetData()[0]);
+
+  for (uint32_t i = 0; i < 100; ++i) {
+    MappingTable::PcToDexIterator it = table.PcToDexFrom(4 * i);
+    EXPECT_LE(it.NativePcOffset(), 4 * i);
+    EXPECT_LE(4 * i - it.NativePcOffset(), 4 * MappingTable::kCheckpointInterval);
+    MappingTable::PcToDexIterator end = table.PcToDexEnd();
+    while (it != end && it.NativePcOffset() < 4 * i) {
+      ++it;
+    }
+    ASSERT_TRUE(it != end);
+    EXPECT_EQ(i, it.DexPc());
+  }
+  for (uint32_t i = 0; i < 40; ++i) {
+    MappingTable::DexToPcIterator it = table.DexToPcFrom(4 * i);
+    EXPECT_LE(it.NativePcOffset(), 4 * i);
+    EXPECT_LE(4 * i - it.NativePcOffset(), 4 * MappingTable::kCheckpointInterval);
+    MappingTable::DexToPcIterator end = table.DexToPcEnd();
+    while (it != end && it.NativePcOffset() < 4 * i) {
+      ++it;
+    }
+    ASSERT_TRUE(it != end);
+    EXPECT_EQ(i, it.DexPc());
+  }
+}
+
+TEST(MappingTableTest, SmallTable) {
+  UnsignedLeb128EncodingVector encoded;
+  EncodeTable(3, 1, &encoded);
+  MappingTable table(&encoded.GetData()[0]);
+  EXPECT_EQ(0U, table.PcToDexFrom(8).NativePcOffset());
+  EXPECT_EQ(0U, table.DexToPcFrom(0).NativePcOffset());
+  EXPECT_TRUE(table.DexToPcBegin() != table.DexToPcEnd());
+}
+
+TEST(MappingTableTest, EncodedSize) {
+  UnsignedLeb128EncodingVector encoded;
+  EncodeTable(100, 40, &encoded);
+  EXPECT_EQ(encoded.GetData().size(), MappingTable(&encoded.GetData()[0]).EncodedSize());
+  UnsignedLeb128EncodingVector empty;
+  EncodeTable(0, 0, &empty);
+  EXPECT_EQ(empty.GetData().size(), MappingTable(&empty.GetData()[0]).EncodedSize());
+  EXPECT_EQ(0U, MappingTable(NULL).EncodedSize());
+}
+
+}  // namespace art
@@ -102,6 +102,74 @@ MemMap* MemMap::MapAnonymous(const char* name, byte* addr, size_t byte_count, in
   return new MemMap(name, actual, byte_count, actual, page_aligned_byte_count, prot);
 }
 
+MemMap* MemMap::ReserveAddressSpace(const char* name, byte* addr, size_t byte_count,
+                                    bool huge_pages) {
+  CHECK_NE(byte_count, 0U);
+  size_t page_aligned_byte_count = RoundUp(byte_count, kPageSize);
+  CheckMapRequest(addr, page_aligned_byte_count);
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+  byte* actual = reinterpret_cast<byte*>(mmap(addr, page_aligned_byte_count, PROT_NONE, flags, -1,
+                                              0));
+  if (actual == MAP_FAILED) {
+    PLOG(ERROR) << "mmap(" << reinterpret_cast<void*>(addr) << ", " << page_aligned_byte_count
+                << ", PROT_NONE, " << flags << ", -1, 0) failed for " << name;
+    return NULL;
+  }
+  MemMap* reservation = new MemMap(name, actual, page_aligned_byte_count, actual,
+                                   page_aligned_byte_count, PROT_NONE);
+  reservation->huge_pages_ = huge_pages;
+  return reservation;
+}
+
+MemMap* MemMap::CarveAnonymous(const char* name, size_t byte_count, int prot) {
+  if (byte_count == 0) {
+    return new MemMap(name, NULL, 0, NULL, 0, prot);
+  }
+  DCHECK_EQ(begin_, base_begin_) << "not a reservation: " << name_;
+  size_t page_aligned_byte_count = RoundUp(byte_count, kPageSize);
+  if (page_aligned_byte_count > base_size_) {
+    return NULL;
+  }
+  // Replaces the first pages of the reservation, which the kernel won't hand out in between.
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+  byte* actual = reinterpret_cast<byte*>(mmap(begin_, page_aligned_byte_count, prot, flags, -1, 0));
+  if (actual == MAP_FAILED) {
+    PLOG(ERROR) << "mmap(" << reinterpret_cast<void*>(begin_) << ", " << page_aligned_byte_count
+                << ", " << prot << ", " << flags << ", -1, 0) failed for " << name
+                << " in " << name_;
+    return NULL;
+  }
+  CHECK_EQ(actual, begin_);
+  base_size_ -= page_aligned_byte_count;
+  size_ = base_size_;
+  if (base_size_ == 0) {
+    begin_ = NULL;
+    base_begin_ = NULL;
+  } else {
+    begin_ += page_aligned_byte_count;
+    base_begin_ = begin_;
+  }
+  MemMap* carved = new MemMap(name, actual, byte_count, actual, page_aligned_byte_count, prot);
+  if (huge_pages_) {
+    carved->AdviseHugePages();
+  }
+  return carved;
+}
+
+bool MemMap::AdviseHugePages() {
+  if (base_size_ == 0) {
+    return true;
+  }
+#if defined(MADV_HUGEPAGE)
+  if (madvise(base_begin_, base_size_, MADV_HUGEPAGE) == 0) {
+    return true;
+  }
+  PLOG(WARNING) << "madvise(" << base_begin_ << ", " << base_size_
+                << ", MADV_HUGEPAGE) failed for " << name_;
+#endif
+  return false;
+}
+
 MemMap* MemMap::MapFileAtAddress(byte* addr, size_t byte_count,
                                  int prot, int flags, int fd, off_t start, bool reuse) {
   CHECK_NE(0, prot);
@@ -156,7 +224,7 @@ MemMap::~MemMap() {
 MemMap::MemMap(const std::string& name, byte* begin, size_t size, void* base_begin,
                size_t base_size, int prot)
     : name_(name), begin_(begin), size_(size), base_begin_(base_begin), base_size_(base_size),
-      prot_(prot) {
+      prot_(prot), huge_pages_(false) {
   if (size_ == 0) {
     CHECK(begin_ == NULL);
     CHECK(base_begin_ == NULL);
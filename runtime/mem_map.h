@@ -40,6 +40,25 @@ class MemMap {
   // On success, returns returns a MemMap instance.  On failure, returns a NULL;
   static MemMap* MapAnonymous(const char* ashmem_name, byte* addr, size_t byte_count, int prot);
 
+  // Reserve byte_count bytes of address space, at addr if possible, without committing any memory,
+  // so that regions carved from it with CarveAnonymous are adjacent. If huge_pages is set, the
+  // carved regions are advised to use transparent huge pages.
+  //
+  // On success, returns a MemMap instance.  On failure, returns a NULL;
+  static MemMap* ReserveAddressSpace(const char* name, byte* addr, size_t byte_count,
+                                     bool huge_pages);
+
+  // Map the first byte_count bytes, page aligned, left in a reservation as an anonymous region.
+  // The region is then owned by the returned MemMap and no longer by the reservation. Unlike the
+  // regions of MapAnonymous, carved regions aren't backed by ashmem.
+  //
+  // On success, returns a MemMap instance.  Returns NULL if there aren't enough bytes left.
+  MemMap* CarveAnonymous(const char* name, size_t byte_count, int prot);
+
+  // Ask the kernel to back the map with transparent huge pages, which it may do for the parts of
+  // the map that are huge page aligned. Returns false if the kernel doesn't support it.
+  bool AdviseHugePages();
+
   // Map part of a file, taking care of non-page aligned offsets.  The
   // "start" offset is absolute, not relative.
   //
@@ -89,12 +108,15 @@ class MemMap {
          int prot);
 
   std::string name_;
-  byte* const begin_;  // Start of data.
+  byte* begin_;  // Start of data, only moves as regions are carved from a reservation.
   size_t size_;  // Length of data.
 
-  void* const base_begin_;  // Page-aligned base address.
-  const size_t base_size_;  // Length of mapping.
+  void* base_begin_;  // Page-aligned base address.
+  size_t base_size_;  // Length of mapping.
   int prot_;  // Protection of the map.
+
+  // If true, the regions carved from this reservation are advised to use huge pages.
+  bool huge_pages_;
 };
 
 }  // namespace art
@@ -31,4 +31,36 @@ TEST_F(MemMapTest, MapAnonymousEmpty) {
   ASSERT_TRUE(map.get() != NULL);
 }
 
+TEST_F(MemMapTest, CarveAnonymous) {
+  UniquePtr<MemMap> reservation(MemMap::ReserveAddressSpace("CarveAnonymous", NULL,
+                                                            4 * kPageSize, true));
+  ASSERT_TRUE(reservation.get() != NULL);
+  byte* begin = reservation->Begin();
+  EXPECT_EQ(4 * kPageSize, reservation->Size());
+
+  UniquePtr<MemMap> first(reservation->CarveAnonymous("first", kPageSize + 1,
+                                                      PROT_READ | PROT_WRITE));
+  ASSERT_TRUE(first.get() != NULL);
+  EXPECT_EQ(begin, first->Begin());
+  EXPECT_EQ(kPageSize + 1, first->Size());
+  EXPECT_EQ(begin + 2 * kPageSize, reservation->Begin());
+  EXPECT_EQ(2 * kPageSize, reservation->Size());
+  first->Begin()[kPageSize] = 42;
+
+  // Too large for what is left.
+  EXPECT_TRUE(reservation->CarveAnonymous("too large", 3 * kPageSize, PROT_READ) == NULL);
+
+  UniquePtr<MemMap> second(reservation->CarveAnonymous("second", 2 * kPageSize,
+                                                       PROT_READ | PROT_WRITE));
+  ASSERT_TRUE(second.get() != NULL);
+  EXPECT_EQ(begin + 2 * kPageSize, second->Begin());
+  EXPECT_EQ(0U, reservation->Size());
+  second->Begin()[0] = 42;
+
+  // The carved regions outlive the reservation.
+  reservation.reset(NULL);
+  EXPECT_EQ(42, first->Begin()[kPageSize]);
+  EXPECT_EQ(42, second->Begin()[0]);
+}
+
 }  // namespace art
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "atomic.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "cutils/atomic-inline.h"
+#include "globals.h"
+#include "ScopedFd.h"
+#include "utils.h"
+
+namespace art {
+
+struct MetricInfo {
+  const char* name;
+  Metrics::Kind kind;
+};
+
+// Names never change once published, new metrics go at the end.
+static const MetricInfo kMetricInfos[] = {
+  { "gc.count", Metrics::kCounter },
+  { "gc.time_ns", Metrics::kCounter },
+  { "gc.pause_time_ns", Metrics::kCounter },
+  { "heap.bytes_allocated", Metrics::kGauge },
+  { "heap.bytes_freed", Metrics::kCounter },
+  { "heap.objects_freed", Metrics::kCounter },
+  { "class.loaded", Metrics::kCounter },
+  { "thread.count", Metrics::kGauge },
+  { "monitor.contentions", Metrics::kCounter },
+  { "jit.methods_compiled", Metrics::kCounter },
+  { "jit.methods_declined", Metrics::kCounter },
+  { "jit.compile_time_ns", Metrics::kCounter },
+  { "class.unloaded", Metrics::kCounter },
+  { "class.unloaded_bytes", Metrics::kCounter },
+};
+
+static const char* kHistogramNames[] = {
+  "gc.pause_ns",
+  "jit.compile_time_ns",
+};
+
+COMPILE_ASSERT(arraysize(kMetricInfos) == Metrics::kNumMetrics, metric_infos_missing);
+COMPILE_ASSERT(arraysize(kHistogramNames) == Metrics::kNumHistograms, histogram_names_missing);
+COMPILE_ASSERT(sizeof(Metrics::Header) <= Metrics::kHeaderSize, header_too_large);
+COMPILE_ASSERT(sizeof(Metrics::Metric) == 64, metric_size_changed);
+COMPILE_ASSERT(sizeof(Metrics::Histogram) == 64, histogram_size_changed);
+
+Metrics* Metrics::Create(const std::string& filename, std::string* error_msg) {
+  ScopedFd fd(open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0640));
+  if (fd.get() == -1) {
+    *error_msg = StringPrintf("Failed to open %s: %s", filename.c_str(), strerror(errno));
+    return NULL;
+  }
+  size_t size = RoundUp(kHeaderSize + kNumMetrics * sizeof(Metric) +
+                        kNumHistograms * HistogramSize(), kPageSize);
+  if (ftruncate(fd.get(), size) != 0) {
+    *error_msg = StringPrintf("Failed to extend %s to %zd bytes: %s", filename.c_str(), size,
+                              strerror(errno));
+    return NULL;
+  }
+  MemMap* mem_map = MemMap::MapFile(size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+  if (mem_map == NULL) {
+    *error_msg = StringPrintf("Failed to map %s", filename.c_str());
+    return NULL;
+  }
+  return new Metrics(filename, mem_map);
+}
+
+Metrics::Metrics(const std::string& filename, MemMap* mem_map)
+    : filename_(filename), mem_map_(mem_map) {
+  // The file was truncated, everything but the header and the names starts at zero.
+  for (size_t i = 0; i < kNumMetrics; ++i) {
+    Metric* metric = GetMetric(static_cast<MetricId>(i));
+    strncpy(metric->name, kMetricInfos[i].name, kNameLength - 1);
+    metric->kind = kMetricInfos[i].kind;
+  }
+  for (size_t i = 0; i < kNumHistograms; ++i) {
+    strncpy(GetHistogram(static_cast<HistogramId>(i))->name, kHistogramNames[i], kNameLength - 1);
+  }
+  Header* header = reinterpret_cast<Header*>(mem_map_->Begin());
+  header->version = kVersion;
+  header->num_metrics = kNumMetrics;
+  header->num_histograms = kNumHistograms;
+  header->num_buckets = ShardedHistogram::kNumBuckets;
+  header->pid = getpid();
+  // Readers seeing the magic see the rest of the header and the names.
+  ANDROID_MEMBAR_STORE();
+  header->magic = kMagic;
+}
+
+Metrics::Metric* Metrics::GetMetric(MetricId id) const {
+  DCHECK_LT(static_cast<size_t>(id), static_cast<size_t>(kNumMetrics));
+  return reinterpret_cast<Metric*>(mem_map_->Begin() + kHeaderSize) + id;
+}
+
+Metrics::Histogram* Metrics::GetHistogram(HistogramId id) const {
+  DCHECK_LT(static_cast<size_t>(id), static_cast<size_t>(kNumHistograms));
+  byte* histograms = mem_map_->Begin() + kHeaderSize + kNumMetrics * sizeof(Metric);
+  return reinterpret_cast<Histogram*>(histograms + id * HistogramSize());
+}
+
+volatile int64_t* Metrics::GetBuckets(HistogramId id) const {
+  return reinterpret_cast<volatile int64_t*>(GetHistogram(id) + 1);
+}
+
+static void AtomicAdd64(volatile int64_t* addr, int64_t delta) {
+  int64_t old_value;
+  do {
+    old_value = QuasiAtomic::Read64(addr);
+  } while (!QuasiAtomic::Cas64(old_value, old_value + delta, addr));
+}
+
+void Metrics::Add(MetricId id, int64_t delta) {
+  AtomicAdd64(&GetMetric(id)->value, delta);
+}
+
+void Metrics::Set(MetricId id, int64_t value) {
+  QuasiAtomic::Write64(&GetMetric(id)->value, value);
+}
+
+int64_t Metrics::Get(MetricId id) const {
+  return QuasiAtomic::Read64(&GetMetric(id)->value);
+}
+
+void Metrics::RecordValue(HistogramId id, uint64_t value) {
+  Histogram* histogram = GetHistogram(id);
+  AtomicAdd64(&GetBuckets(id)[ShardedHistogram::BucketIndex(value)], 1);
+  AtomicAdd64(&histogram->sum, value);
+  AtomicAdd64(&histogram->count, 1);
+}
+
+}  // namespace art
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_METRICS_H_
+#define ART_RUNTIME_METRICS_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/macros.h"
+#include "base/sharded_histogram.h"
+#include "mem_map.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+// Runtime statistics kept in a file mapped shared, enabled with -Xmetrics:<directory>, so that a
+// monitoring agent can map <directory>/<pid>.metrics and read them at any time without stopping
+// or signaling the process. The code updating a statistic writes it to the file directly, readers
+// don't synchronize with the runtime, nor the runtime with them: each value is written without
+// tearing, but values written at the same time may be seen in any order.
+//
+// The layout, in native byte order, is versioned by the header. Version 1 is:
+//   Header, kHeaderSize bytes.
+//   num_metrics Metric entries.
+//   num_histograms Histogram entries, each followed by the counts of its num_buckets buckets as
+//   int64_t, the buckets of ShardedHistogram.
+// A reader should check the magic and version, and skip the metrics and buckets it doesn't know
+// using the counts of the header, as later versions only append.
+class Metrics {
+ public:
+  static const uint32_t kMagic = 0x4d545241;  // "ARTM".
+  static const uint32_t kVersion = 1;
+  static const size_t kHeaderSize = 64;
+  static const size_t kNameLength = 48;
+
+  enum Kind {
+    kCounter = 1,  // Only goes up.
+    kGauge = 2,    // The current value of a quantity.
+  };
+
+  // Heap figures are as of the end of the last GC.
+  enum MetricId {
+    kGcCount,
+    kGcTimeNs,
+    kGcPauseTimeNs,
+    kHeapBytesAllocated,
+    kHeapBytesFreed,
+    kHeapObjectsFreed,
+    kClassesLoaded,
+    kThreads,
+    kMonitorContentions,
+    kJitMethodsCompiled,
+    kJitMethodsDeclined,
+    kJitCompileTimeNs,
+    kClassesUnloaded,
+    kClassBytesUnloaded,
+    kNumMetrics
+  };
+
+  enum HistogramId {
+    kGcPauseHistogram,
+    kJitCompileTimeHistogram,
+    kNumHistograms
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_metrics;
+    uint32_t num_histograms;
+    uint32_t num_buckets;
+    uint32_t pid;
+  };
+
+  struct Metric {
+    char name[kNameLength];
+    uint32_t kind;
+    uint32_t reserved;
+    volatile int64_t value;
+  };
+
+  struct Histogram {
+    char name[kNameLength];
+    volatile int64_t count;
+    volatile int64_t sum;
+  };
+
+  // Maps the file, creating or truncating it. Returns NULL with error_msg set on failure.
+  static Metrics* Create(const std::string& filename, std::string* error_msg);
+
+  // Safe from any thread.
+  void Add(MetricId id, int64_t delta);
+  void Set(MetricId id, int64_t value);
+  void RecordValue(HistogramId id, uint64_t value);
+
+  int64_t Get(MetricId id) const;
+
+  const std::string& GetFilename() const {
+    return filename_;
+  }
+
+ private:
+  Metrics(const std::string& filename, MemMap* mem_map);
+
+  Metric* GetMetric(MetricId id) const;
+  Histogram* GetHistogram(HistogramId id) const;
+  volatile int64_t* GetBuckets(HistogramId id) const;
+
+  static size_t HistogramSize() {
+    return sizeof(Histogram) + ShardedHistogram::kNumBuckets * sizeof(int64_t);
+  }
+
+  const std::string filename_;
+  UniquePtr<MemMap> mem_map_;
+
+  DISALLOW_COPY_AND_ASSIGN(Metrics);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_METRICS_H_
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "common_test.h"
+
+namespace art {
+
+class MetricsTest : public CommonTest {};
+
+TEST_F(MetricsTest, Layout) {
+  ScratchFile file;
+  std::string error_msg;
+  UniquePtr<Metrics> metrics(Metrics::Create(file.GetFilename(), &error_msg));
+  ASSERT_TRUE(metrics.get() != NULL) << error_msg;
+  metrics->Add(Metrics::kGcCount, 2);
+  metrics->Add(Metrics::kGcCount, 1);
+  metrics->Set(Metrics::kHeapBytesAllocated, 1234);
+  metrics->RecordValue(Metrics::kGcPauseHistogram, 1000);
+  metrics->RecordValue(Metrics::kGcPauseHistogram, 1000);
+  EXPECT_EQ(3, metrics->Get(Metrics::kGcCount));
+
+  // Read back as an agent would, through the file.
+  std::vector<byte> contents(kPageSize);
+  ASSERT_EQ(static_cast<ssize_t>(contents.size()),
+            pread(file.GetFd(), &contents[0], contents.size(), 0));
+  const Metrics::Header* header = reinterpret_cast<const Metrics::Header*>(&contents[0]);
+  EXPECT_EQ(Metrics::kMagic, header->magic);
+  EXPECT_EQ(Metrics::kVersion, header->version);
+  ASSERT_EQ(static_cast<uint32_t>(Metrics::kNumMetrics), header->num_metrics);
+  ASSERT_EQ(static_cast<uint32_t>(Metrics::kNumHistograms), header->num_histograms);
+  ASSERT_EQ(ShardedHistogram::kNumBuckets, header->num_buckets);
+  EXPECT_EQ(static_cast<uint32_t>(getpid()), header->pid);
+
+  const Metrics::Metric* entries =
+      reinterpret_cast<const Metrics::Metric*>(&contents[Metrics::kHeaderSize]);
+  EXPECT_STREQ("gc.count", entries[Metrics::kGcCount].name);
+  EXPECT_EQ(static_cast<uint32_t>(Metrics::kCounter), entries[Metrics::kGcCount].kind);
+  EXPECT_EQ(3, entries[Metrics::kGcCount].value);
+  EXPECT_STREQ("heap.bytes_allocated", entries[Metrics::kHeapBytesAllocated].name);
+  EXPECT_EQ(static_cast<uint32_t>(Metrics::kGauge), entries[Metrics::kHeapBytesAllocated].kind);
+  EXPECT_EQ(1234, entries[Metrics::kHeapBytesAllocated].value);
+  EXPECT_EQ(0, entries[Metrics::kClassesLoaded].value);
+
+  const Metrics::Histogram* histogram =
+      reinterpret_cast<const Metrics::Histogram*>(entries + Metrics::kNumMetrics);
+  EXPECT_STREQ("gc.pause_ns", histogram->name);
+  EXPECT_EQ(2, histogram->count);
+  EXPECT_EQ(2000, histogram->sum);
+  const int64_t* buckets = reinterpret_cast<const int64_t*>(histogram + 1);
+  EXPECT_EQ(2, buckets[ShardedHistogram::BucketIndex(1000)]);
+  EXPECT_EQ(0, buckets[ShardedHistogram::BucketIndex(2000)]);
+}
+
+}  // namespace art
@@ -136,6 +136,11 @@ class MANAGED PrimitiveArray : public Array {
     array_class_ = NULL;
   }
 
+  static Class* GetArrayClass() {
+    DCHECK(array_class_ != NULL);
+    return array_class_;
+  }
+
  private:
   static Class* array_class_;
 
@@ -118,9 +118,10 @@ ArtMethod* ArtMethod::FindOverriddenMethod() const {
   } else {
     // Method didn't override superclass method so search interfaces
     if (IsProxyMethod()) {
+      // Proxy invocations come here, FindMethodForProxy searches all the dex caches.
       result = GetDexCacheResolvedMethods()->Get(GetDexMethodIndex());
-      CHECK_EQ(result,
-               Runtime::Current()->GetClassLinker()->FindMethodForProxy(GetDeclaringClass(), this));
+      DCHECK_EQ(result, Runtime::Current()->GetClassLinker()->FindMethodForProxy(
+          GetDeclaringClass(), this));
     } else {
       MethodHelper mh(this);
       MethodHelper interface_mh;
@@ -152,35 +153,40 @@ uintptr_t ArtMethod::NativePcOffset(const uintptr_t pc) const {
 
 uint32_t ArtMethod::ToDexPc(const uintptr_t pc) const {
 #if !defined(ART_USE_PORTABLE_COMPILER)
+  return NativePcOffsetToDexPc(NativePcOffset(pc));
+#else
+  // Compiler LLVM doesn't use the machine pc, we just use dex pc instead.
+  return static_cast<uint32_t>(pc);
+#endif
+}
+
+uint32_t ArtMethod::NativePcOffsetToDexPc(const uint32_t sought_offset) const {
   MappingTable table(GetMappingTable());
   if (table.TotalSize() == 0) {
     DCHECK(IsNative() || IsCalleeSaveMethod() || IsProxyMethod()) << PrettyMethod(this);
     return DexFile::kDexNoIndex;   // Special no mapping case
   }
-  const void* code = Runtime::Current()->GetInstrumentation()->GetQuickCodeFor(this);
-  uint32_t sought_offset = pc - reinterpret_cast<uintptr_t>(code);
-  // Assume the caller wants a pc-to-dex mapping so check here first.
+  // Assume the caller wants a pc-to-dex mapping so check here first. Both lists are sorted by
+  // native pc offset, so start from the nearest checkpoint and stop once past sought_offset.
   typedef MappingTable::PcToDexIterator It;
-  for (It cur = table.PcToDexBegin(), end = table.PcToDexEnd(); cur != end; ++cur) {
+  for (It cur = table.PcToDexFrom(sought_offset), end = table.PcToDexEnd();
+       cur != end && cur.NativePcOffset() <= sought_offset; ++cur) {
     if (cur.NativePcOffset() == sought_offset) {
       return cur.DexPc();
     }
   }
   // Now check dex-to-pc mappings.
   typedef MappingTable::DexToPcIterator It2;
-  for (It2 cur = table.DexToPcBegin(), end = table.DexToPcEnd(); cur != end; ++cur) {
+  for (It2 cur = table.DexToPcFrom(sought_offset), end = table.DexToPcEnd();
+       cur != end && cur.NativePcOffset() <= sought_offset; ++cur) {
     if (cur.NativePcOffset() == sought_offset) {
       return cur.DexPc();
     }
   }
   LOG(FATAL) << "Failed to find Dex offset for PC offset " << reinterpret_cast<void*>(sought_offset)
-             << "(PC " << reinterpret_cast<void*>(pc) << ", code=" << code
+             << "(code=" << Runtime::Current()->GetInstrumentation()->GetQuickCodeFor(this)
              << ") in " << PrettyMethod(this);
   return DexFile::kDexNoIndex;
-#else
-  // Compiler LLVM doesn't use the machine pc, we just use dex pc instead.
-  return static_cast<uint32_t>(pc);
-#endif
 }
 
 uintptr_t ArtMethod::ToNativePc(const uint32_t dex_pc) const {
@@ -306,10 +312,15 @@ bool ArtMethod::IsRegistered() const {
 }
 
 extern "C" void art_work_around_app_jni_bugs(JNIEnv*, jobject);
-void ArtMethod::RegisterNative(Thread* self, const void* native_method) {
+void ArtMethod::RegisterNative(Thread* self, const void* native_method, bool is_fast) {
   DCHECK(Thread::Current() == self);
   CHECK(IsNative()) << PrettyMethod(this);
   CHECK(native_method != NULL) << PrettyMethod(this);
+  if (is_fast) {
+    SetAccessFlags(GetAccessFlags() | kAccFastNative);
+  } else {
+    SetAccessFlags(GetAccessFlags() & ~kAccFastNative);
+  }
   if (!self->GetJniEnv()->vm->work_around_app_jni_bugs) {
     SetNativeMethod(native_method);
   } else {
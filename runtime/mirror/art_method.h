@@ -56,6 +56,10 @@ class MANAGED ArtMethod : public Object {
     return MemberOffset(OFFSETOF_MEMBER(ArtMethod, entry_point_from_compiled_code_));
   }
 
+  static MemberOffset AccessFlagsOffset() {
+    return MemberOffset(OFFSETOF_MEMBER(ArtMethod, access_flags_));
+  }
+
   uint32_t GetAccessFlags() const;
 
   void SetAccessFlags(uint32_t new_access_flags) {
@@ -112,6 +116,12 @@ class MANAGED ArtMethod : public Object {
     return (GetAccessFlags() & kAccNative) != 0;
   }
 
+  // Fast natives are called without leaving the runnable state. They must be short and must not
+  // block, as they hold off suspension for the duration of the call.
+  bool IsFastNative() const {
+    return (GetAccessFlags() & kAccFastNative) != 0;
+  }
+
   bool IsAbstract() const {
     return (GetAccessFlags() & kAccAbstract) != 0;
   }
@@ -122,6 +132,27 @@ class MANAGED ArtMethod : public Object {
 
   bool IsProxyMethod() const;
 
+  bool IsInstrumented() const {
+    return (GetAccessFlags() & kAccInstrumented) != 0;
+  }
+
+  void SetInstrumented(bool instrumented) {
+    uint32_t access_flags = GetAccessFlags();
+    SetAccessFlags(instrumented ? access_flags | kAccInstrumented
+                                : access_flags & ~kAccInstrumented);
+  }
+
+  // Returns true once a linked class overrides the method. Compiled code calls virtual methods
+  // which weren't overridden when it was compiled directly, and checks this to fall back to the
+  // vtable.
+  bool IsOverridden() const {
+    return (GetAccessFlags() & kAccOverridden) != 0;
+  }
+
+  void SetOverridden() {
+    SetAccessFlags(GetAccessFlags() | kAccOverridden);
+  }
+
   bool IsPreverified() const {
     return (GetAccessFlags() & kAccPreverified) != 0;
   }
@@ -307,7 +338,7 @@ class MANAGED ArtMethod : public Object {
 
   bool IsRegistered() const;
 
-  void RegisterNative(Thread* self, const void* native_method)
+  void RegisterNative(Thread* self, const void* native_method, bool is_fast = false)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void UnregisterNative(Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -358,6 +389,10 @@ class MANAGED ArtMethod : public Object {
   // Converts a native PC to a dex PC.
   uint32_t ToDexPc(const uintptr_t pc) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Converts an offset into the method's quick code, as returned by NativePcOffset, to a dex PC.
+  uint32_t NativePcOffsetToDexPc(const uint32_t native_pc_offset) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Converts a dex PC to a native PC.
   uintptr_t ToNativePc(const uint32_t dex_pc) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -212,7 +212,10 @@ inline ArtMethod* Class::FindVirtualMethodForInterface(ArtMethod* method) const
   Class* declaring_class = method->GetDeclaringClass();
   DCHECK(declaring_class != NULL) << PrettyClass(this);
   DCHECK(declaring_class->IsInterface()) << PrettyMethod(method);
-  // TODO cache to improve lookup speed
+  ArtMethod* imt_method = FindVirtualMethodForInterfaceInImt(method);
+  if (LIKELY(imt_method != NULL)) {
+    return imt_method;
+  }
   int32_t iftable_count = GetIfTableCount();
   IfTable* iftable = GetIfTable();
   for (int32_t i = 0; i < iftable_count; i++) {
@@ -223,6 +226,18 @@ inline ArtMethod* Class::FindVirtualMethodForInterface(ArtMethod* method) const
   return NULL;
 }
 
+inline ArtMethod* Class::FindVirtualMethodForInterfaceInImt(ArtMethod* method) const {
+  IfTable* iftable = GetIfTable();
+  ObjectArray<ArtMethod>* imt = (iftable != NULL) ? iftable->GetImTable() : NULL;
+  if (LIKELY(imt != NULL)) {
+    int32_t slot = (method->GetDexMethodIndex() % IfTable::kImtSize) * 2;
+    if (imt->Get(slot) == method) {
+      return imt->Get(slot + 1);
+    }
+  }
+  return NULL;
+}
+
 inline ArtMethod* Class::FindVirtualMethodForVirtual(ArtMethod* method) const
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   DCHECK(!method->GetDeclaringClass()->IsInterface() || method->IsMiranda());
@@ -16,8 +16,13 @@
 
 #include "class.h"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "art_field-inl.h"
 #include "art_method-inl.h"
+#include "base/stl_util.h"
 #include "class-inl.h"
 #include "class_linker.h"
 #include "class_loader.h"
@@ -28,6 +33,7 @@
 #include "object_array-inl.h"
 #include "object_utils.h"
 #include "runtime.h"
+#include "safe_map.h"
 #include "sirt_ref.h"
 #include "thread.h"
 #include "throwable.h"
@@ -371,7 +377,140 @@ ArtMethod* Class::FindInterfaceMethod(const DexCache* dex_cache, uint32_t dex_me
 }
 
 
+// The declared members of a class sorted by the hash of their name, so that lookups by name compare
+// the names of a few candidates instead of fetching every member's name from the dex file.
+struct MemberIndex {
+  std::vector<std::pair<uint32_t, ArtMethod*> > direct_methods;
+  std::vector<std::pair<uint32_t, ArtMethod*> > virtual_methods;
+  std::vector<std::pair<uint32_t, ArtField*> > instance_fields;
+  std::vector<std::pair<uint32_t, ArtField*> > static_fields;
+};
+
+// Classes with fewer members are searched linearly.
+static const size_t kMinMembersToIndex = 16;
+
+// Indexes are built on the first lookup by name once a class is resolved and its member arrays are
+// final. Classes don't move, the GC sweeps the indexes of the classes it unloads and the class
+// linker clears the others when it goes.
+static Mutex gMemberIndexesLock DEFAULT_MUTEX_ACQUIRED_AFTER("class member indexes lock");
+static SafeMap<const Class*, const MemberIndex*> gMemberIndexes GUARDED_BY(gMemberIndexesLock);
+
+static uint32_t HashMemberName(const StringPiece& name) {
+  uint32_t hash = 0;
+  for (int i = 0; i < name.size(); ++i) {
+    hash = hash * 31 + static_cast<uint8_t>(name[i]);
+  }
+  return hash;
+}
+
+static bool HasNameAndType(ArtMethod* method, const StringPiece& name,
+                           const StringPiece& signature)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  MethodHelper mh(method);
+  return name == mh.GetName() && signature == mh.GetSignature();
+}
+
+static bool HasNameAndType(ArtField* field, const StringPiece& name, const StringPiece& type)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  FieldHelper fh(field);
+  return name == fh.GetName() && type == fh.GetTypeDescriptor();
+}
+
+template <typename Member>
+static Member* FindIndexedMember(const std::vector<std::pair<uint32_t, Member*> >& members,
+                                 const StringPiece& name, const StringPiece& type)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  uint32_t hash = HashMemberName(name);
+  typename std::vector<std::pair<uint32_t, Member*> >::const_iterator it =
+      std::lower_bound(members.begin(), members.end(),
+                       std::make_pair(hash, static_cast<Member*>(NULL)));
+  for (; it != members.end() && it->first == hash; ++it) {
+    if (HasNameAndType(it->second, name, type)) {
+      return it->second;
+    }
+  }
+  return NULL;
+}
+
+// Returns the member index of klass, NULL if klass should be searched linearly.
+static const MemberIndex* GetMemberIndex(const Class* klass)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (!klass->IsResolved()) {
+    return NULL;
+  }
+  size_t num_members = klass->NumDirectMethods() + klass->NumVirtualMethods() +
+      klass->NumInstanceFields() + klass->NumStaticFields();
+  if (num_members < kMinMembersToIndex) {
+    return NULL;
+  }
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, gMemberIndexesLock);
+    SafeMap<const Class*, const MemberIndex*>::const_iterator it = gMemberIndexes.find(klass);
+    if (it != gMemberIndexes.end()) {
+      return it->second;
+    }
+  }
+  // Fetching the names reads the dex file, build the index without the lock.
+  UniquePtr<MemberIndex> index(new MemberIndex);
+  MethodHelper mh;
+  for (size_t i = 0; i < klass->NumDirectMethods(); ++i) {
+    ArtMethod* method = klass->GetDirectMethod(i);
+    mh.ChangeMethod(method);
+    index->direct_methods.push_back(std::make_pair(HashMemberName(mh.GetName()), method));
+  }
+  for (size_t i = 0; i < klass->NumVirtualMethods(); ++i) {
+    ArtMethod* method = klass->GetVirtualMethod(i);
+    mh.ChangeMethod(method);
+    index->virtual_methods.push_back(std::make_pair(HashMemberName(mh.GetName()), method));
+  }
+  FieldHelper fh;
+  for (size_t i = 0; i < klass->NumInstanceFields(); ++i) {
+    ArtField* field = klass->GetInstanceField(i);
+    fh.ChangeField(field);
+    index->instance_fields.push_back(std::make_pair(HashMemberName(fh.GetName()), field));
+  }
+  for (size_t i = 0; i < klass->NumStaticFields(); ++i) {
+    ArtField* field = klass->GetStaticField(i);
+    fh.ChangeField(field);
+    index->static_fields.push_back(std::make_pair(HashMemberName(fh.GetName()), field));
+  }
+  std::sort(index->direct_methods.begin(), index->direct_methods.end());
+  std::sort(index->virtual_methods.begin(), index->virtual_methods.end());
+  std::sort(index->instance_fields.begin(), index->instance_fields.end());
+  std::sort(index->static_fields.begin(), index->static_fields.end());
+
+  MutexLock mu(self, gMemberIndexesLock);
+  SafeMap<const Class*, const MemberIndex*>::const_iterator it = gMemberIndexes.find(klass);
+  if (it != gMemberIndexes.end()) {
+    return it->second;  // Another thread got here first.
+  }
+  gMemberIndexes.Put(klass, index.get());
+  return index.release();
+}
+
+void Class::ClearMemberIndexes() {
+  MutexLock mu(Thread::Current(), gMemberIndexesLock);
+  STLDeleteValues(&gMemberIndexes);
+}
+
+void Class::SweepMemberIndexes(IsMarkedTester is_marked, void* arg) {
+  MutexLock mu(Thread::Current(), gMemberIndexesLock);
+  for (auto it = gMemberIndexes.begin(); it != gMemberIndexes.end();) {
+    if (is_marked(it->first, arg)) {
+      ++it;
+    } else {
+      delete it->second;
+      gMemberIndexes.erase(it++);
+    }
+  }
+}
+
 ArtMethod* Class::FindDeclaredDirectMethod(const StringPiece& name, const StringPiece& signature) const {
+  const MemberIndex* index = GetMemberIndex(this);
+  if (index != NULL) {
+    return FindIndexedMember(index->direct_methods, name, signature);
+  }
   MethodHelper mh;
   for (size_t i = 0; i < NumDirectMethods(); ++i) {
     ArtMethod* method = GetDirectMethod(i);
@@ -417,6 +556,10 @@ ArtMethod* Class::FindDirectMethod(const DexCache* dex_cache, uint32_t dex_metho
 
 ArtMethod* Class::FindDeclaredVirtualMethod(const StringPiece& name,
                                          const StringPiece& signature) const {
+  const MemberIndex* index = GetMemberIndex(this);
+  if (index != NULL) {
+    return FindIndexedMember(index->virtual_methods, name, signature);
+  }
   MethodHelper mh;
   for (size_t i = 0; i < NumVirtualMethods(); ++i) {
     ArtMethod* method = GetVirtualMethod(i);
@@ -463,6 +606,10 @@ ArtMethod* Class::FindVirtualMethod(const DexCache* dex_cache, uint32_t dex_meth
 ArtField* Class::FindDeclaredInstanceField(const StringPiece& name, const StringPiece& type) {
   // Is the field in this class?
   // Interfaces are not relevant because they can't contain instance fields.
+  const MemberIndex* index = GetMemberIndex(this);
+  if (index != NULL) {
+    return FindIndexedMember(index->instance_fields, name, type);
+  }
   FieldHelper fh;
   for (size_t i = 0; i < NumInstanceFields(); ++i) {
     ArtField* f = GetInstanceField(i);
@@ -512,6 +659,10 @@ ArtField* Class::FindInstanceField(const DexCache* dex_cache, uint32_t dex_field
 
 ArtField* Class::FindDeclaredStaticField(const StringPiece& name, const StringPiece& type) {
   DCHECK(type != NULL);
+  const MemberIndex* index = GetMemberIndex(this);
+  if (index != NULL) {
+    return FindIndexedMember(index->static_fields, name, type);
+  }
   FieldHelper fh;
   for (size_t i = 0; i < NumStaticFields(); ++i) {
     ArtField* f = GetStaticField(i);
@@ -20,6 +20,7 @@
 #include "modifiers.h"
 #include "object.h"
 #include "primitive.h"
+#include "root_visitor.h"
 
 /*
  * A magic value for refOffsets. Ignore the bits and walk the super
@@ -130,6 +131,10 @@ class MANAGED Class : public StaticStorageBase {
 
   void SetStatus(Status new_status, Thread* self) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  static MemberOffset StatusOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(Class, status_);
+  }
+
   // Returns true if the class has failed to link.
   bool IsErroneous() const {
     return GetStatus() == kStatusError;
@@ -266,6 +271,10 @@ class MANAGED Class : public StaticStorageBase {
     return (access_flags & kAccClassIsProxy) != 0;
   }
 
+  static MemberOffset PrimitiveTypeOffset() {
+    return MemberOffset(OFFSETOF_MEMBER(Class, primitive_type_));
+  }
+
   Primitive::Type GetPrimitiveType() const {
     DCHECK_EQ(sizeof(Primitive::Type), sizeof(int32_t));
     return static_cast<Primitive::Type>(
@@ -345,6 +354,10 @@ class MANAGED Class : public StaticStorageBase {
 
   bool IsArtMethodClass() const;
 
+  static MemberOffset ComponentTypeOffset() {
+    return MemberOffset(OFFSETOF_MEMBER(Class, component_type_));
+  }
+
   Class* GetComponentType() const {
     return GetFieldObject<Class*>(OFFSET_OF_OBJECT_MEMBER(Class, component_type_), false);
   }
@@ -560,6 +573,11 @@ class MANAGED Class : public StaticStorageBase {
   ArtMethod* FindVirtualMethodForInterface(ArtMethod* method) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) ALWAYS_INLINE;
 
+  // Same as FindVirtualMethodForInterface but only looks in the interface method table, returns
+  // NULL if method shares its slot with another interface method.
+  ArtMethod* FindVirtualMethodForInterfaceInImt(ArtMethod* method) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) ALWAYS_INLINE;
+
   ArtMethod* FindInterfaceMethod(const StringPiece& name, const StringPiece& descriptor) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -721,6 +739,14 @@ class MANAGED Class : public StaticStorageBase {
     SetField32(OFFSET_OF_OBJECT_MEMBER(Class, clinit_thread_id_), new_clinit_thread_id, false);
   }
 
+  static MemberOffset ClinitThreadIdOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(Class, clinit_thread_id_);
+  }
+
+  static MemberOffset VerifyErrorClassOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(Class, verify_error_class_);
+  }
+
   Class* GetVerifyErrorClass() const {
     // DCHECK(IsErroneous());
     return GetFieldObject<Class*>(OFFSET_OF_OBJECT_MEMBER(Class, verify_error_class_), false);
@@ -751,6 +777,11 @@ class MANAGED Class : public StaticStorageBase {
   static void SetClassClass(Class* java_lang_Class);
   static void ResetClass();
 
+  // Frees the indexes that speed up the Find*Method and Find*Field lookups by name.
+  static void ClearMemberIndexes();
+  // Frees those of the classes the GC didn't mark.
+  static void SweepMemberIndexes(IsMarkedTester is_marked, void* arg);
+
   // When class is verified, set the kAccPreverified flag on each method.
   void SetPreverifiedFlagOnAllMethods() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
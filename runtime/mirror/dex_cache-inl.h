@@ -19,6 +19,9 @@
 
 #include "dex_cache.h"
 
+#include "dex_file.h"
+#include "runtime.h"
+
 namespace art {
 namespace mirror {
 
@@ -34,6 +37,27 @@ inline ArtMethod* DexCache::GetResolvedMethod(uint32_t method_idx) const
   }
 }
 
+inline bool DexCache::HasHashedResolvedFields() const {
+  return static_cast<size_t>(GetResolvedFields()->GetLength()) < GetDexFile()->NumFieldIds();
+}
+
+inline ArtField* DexCache::GetResolvedField(uint32_t field_idx) const
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (UNLIKELY(HasHashedResolvedFields())) {
+    return GetHashedResolvedField(field_idx);
+  }
+  return GetResolvedFields()->Get(field_idx);
+}
+
+inline void DexCache::SetResolvedField(uint32_t field_idx, ArtField* resolved)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (UNLIKELY(HasHashedResolvedFields())) {
+    SetHashedResolvedField(field_idx, resolved);
+    return;
+  }
+  GetResolvedFields()->Set(field_idx, resolved);
+}
+
 }  // namespace mirror
 }  // namespace art
 
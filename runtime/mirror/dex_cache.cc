@@ -16,6 +16,7 @@
 
 #include "dex_cache.h"
 
+#include "art_field-inl.h"
 #include "art_method-inl.h"
 #include "base/logging.h"
 #include "class_linker.h"
@@ -78,5 +79,24 @@ void DexCache::Fixup(ArtMethod* trampoline) {
   }
 }
 
+ArtField* DexCache::GetHashedResolvedField(uint32_t field_idx) const {
+  ArtField* field = GetResolvedFields()->Get(field_idx % GetResolvedFields()->GetLength());
+  // The slot is shared with every field_idx of the same remainder.
+  if (field == NULL || field->GetDexFieldIndex() != field_idx ||
+      field->GetDeclaringClass()->GetDexCache() != this) {
+    return NULL;
+  }
+  return field;
+}
+
+void DexCache::SetHashedResolvedField(uint32_t field_idx, ArtField* resolved) {
+  // Fields declared in another dex file could never hit, don't let them evict an entry that can.
+  if (resolved != NULL && (resolved->GetDexFieldIndex() != field_idx ||
+                           resolved->GetDeclaringClass()->GetDexCache() != this)) {
+    return;
+  }
+  GetResolvedFields()->Set(field_idx % GetResolvedFields()->GetLength(), resolved);
+}
+
 }  // namespace mirror
 }  // namespace art
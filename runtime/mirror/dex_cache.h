@@ -118,15 +118,16 @@ class MANAGED DexCache : public Object {
     GetResolvedMethods()->Set(method_idx, resolved);
   }
 
+  // The resolved fields array may be shorter than the dex file's field ids, see
+  // -Xdexcache-field-slots. It is then a hash table indexed by field_idx modulo its length and
+  // a lookup only hits if the slot holds the field this dex file's field_idx refers to.
   ArtField* GetResolvedField(uint32_t field_idx) const
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    return GetResolvedFields()->Get(field_idx);
-  }
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void SetResolvedField(uint32_t field_idx, ArtField* resolved)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    GetResolvedFields()->Set(field_idx, resolved);
-  }
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  bool HasHashedResolvedFields() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   ObjectArray<String>* GetStrings() const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
@@ -164,6 +165,12 @@ class MANAGED DexCache : public Object {
   }
 
  private:
+  ArtField* GetHashedResolvedField(uint32_t field_idx) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  void SetHashedResolvedField(uint32_t field_idx, ArtField* resolved)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   Object* dex_;
   ObjectArray<StaticStorageBase>* initialized_static_storage_;
   String* location_;
@@ -60,6 +60,25 @@ class MANAGED IfTable : public ObjectArray<Object> {
     return GetLength() / kMax;
   }
 
+  // The interface method table, stored after the interface and method array pairs of classes which
+  // implement interface methods. Slot i holds an interface method whose dex method index modulo
+  // kImtSize is i at 2 * i and its implementation at 2 * i + 1. Only the first interface method
+  // for a slot is in the table, the others are found by searching the method arrays.
+  ObjectArray<ArtMethod>* GetImTable() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    if (GetLength() % kMax == 0) {
+      return NULL;
+    }
+    return down_cast<ObjectArray<ArtMethod>*>(Get(GetLength() - 1));
+  }
+
+  void SetImTable(ObjectArray<ArtMethod>* imt) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    DCHECK_EQ(GetLength() % kMax, 1);
+    DCHECK(imt != NULL);
+    Set(GetLength() - 1, imt);
+  }
+
+  static const int32_t kImtSize = 64;
+
   enum {
     // Points to the interface class.
     kInterface   = 0,
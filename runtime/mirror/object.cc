@@ -37,6 +37,10 @@
 namespace art {
 namespace mirror {
 
+int32_t Object::IdentityHashCode() const {
+  return Monitor::IdentityHashCode(Thread::Current(), const_cast<Object*>(this));
+}
+
 Object* Object::Clone(Thread* self) {
   Class* c = GetClass();
   DCHECK(!c->IsClassClass());
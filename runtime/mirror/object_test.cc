@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <valgrind.h>
 
 #include "array-inl.h"
 #include "art_field-inl.h"
@@ -30,6 +31,7 @@
 #include "entrypoints/entrypoint_utils.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/heap.h"
+#include "gc/space/dlmalloc_space.h"
 #include "iftable-inl.h"
 #include "art_method-inl.h"
 #include "object-inl.h"
@@ -71,6 +73,8 @@ class ObjectTest : public CommonTest {
 
 // Keep the assembly code in sync
 TEST_F(ObjectTest, AsmConstants) {
+  ASSERT_EQ(CLASS_OFFSET, Object::ClassOffset().Int32Value());
+
   ASSERT_EQ(STRING_VALUE_OFFSET, String::ValueOffset().Int32Value());
   ASSERT_EQ(STRING_COUNT_OFFSET, String::CountOffset().Int32Value());
   ASSERT_EQ(STRING_OFFSET_OFFSET, String::OffsetOffset().Int32Value());
@@ -337,6 +341,21 @@ TEST_F(ObjectTest, StringEqualsUtf8) {
   EXPECT_FALSE(empty->Equals("a"));
 }
 
+TEST_F(ObjectTest, StringCharsFollowString) {
+  ScopedObjectAccess soa(Thread::Current());
+  if (RUNNING_ON_VALGRIND) {
+    // The Valgrind space puts red zones around each object.
+    return;
+  }
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  SirtRef<String> string(soa.Self(), String::AllocFromModifiedUtf8(soa.Self(), "android"));
+  ASSERT_TRUE(string.get() != NULL);
+  const byte* chars_begin = reinterpret_cast<const byte*>(string->GetCharArray());
+  EXPECT_EQ(reinterpret_cast<byte*>(string.get()) +
+                heap->GetAllocSpace()->AllocationSize(string.get()), chars_begin);
+  EXPECT_TRUE(string->Equals("android"));
+}
+
 TEST_F(ObjectTest, StringEquals) {
   ScopedObjectAccess soa(Thread::Current());
   SirtRef<String> string(soa.Self(), String::AllocFromModifiedUtf8(soa.Self(), "android"));
@@ -525,6 +544,43 @@ TEST_F(ObjectTest, IsAssignableFrom) {
   }
 }
 
+TEST_F(ObjectTest, SubtypeCheckCache) {
+  ScopedObjectAccess soa(Thread::Current());
+  Thread* self = soa.Self();
+  Class* string = class_linker_->FindSystemClass("Ljava/lang/String;");
+  Class* charseq = class_linker_->FindSystemClass("Ljava/lang/CharSequence;");
+  Class* comparable = class_linker_->FindSystemClass("Ljava/lang/Comparable;");
+
+  EXPECT_FALSE(self->InSubtypeCheckCache(string, charseq));
+  self->AddToSubtypeCheckCache(string, charseq);
+  EXPECT_TRUE(self->InSubtypeCheckCache(string, charseq));
+  // Entries are for ordered pairs.
+  EXPECT_FALSE(self->InSubtypeCheckCache(charseq, string));
+  self->AddToSubtypeCheckCache(string, comparable);
+  EXPECT_TRUE(self->InSubtypeCheckCache(string, comparable));
+}
+
+TEST_F(ObjectTest, InterpreterCache) {
+  ScopedObjectAccess soa(Thread::Current());
+  Thread* self = soa.Self();
+  Class* string = class_linker_->FindSystemClass("Ljava/lang/String;");
+  Class* object = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ArtMethod* hash_code = string->FindVirtualMethod("hashCode", "()I");
+  ASSERT_TRUE(hash_code != NULL);
+  uint16_t code[2] = { 0, 0 };
+
+  EXPECT_TRUE(self->FindInInterpreterCache(&code[0], string) == NULL);
+  self->AddToInterpreterCache(&code[0], string, hash_code);
+  EXPECT_EQ(hash_code, self->FindInInterpreterCache(&code[0], string));
+  // Entries are for an instruction and a receiver class.
+  EXPECT_TRUE(self->FindInInterpreterCache(&code[0], object) == NULL);
+  EXPECT_TRUE(self->FindInInterpreterCache(&code[1], string) == NULL);
+  // The next instruction has the next entry, adding it doesn't evict the first.
+  self->AddToInterpreterCache(&code[1], NULL, hash_code);
+  EXPECT_EQ(hash_code, self->FindInInterpreterCache(&code[1], NULL));
+  EXPECT_EQ(hash_code, self->FindInInterpreterCache(&code[0], string));
+}
+
 TEST_F(ObjectTest, IsAssignableFromArray) {
   ScopedObjectAccess soa(Thread::Current());
   jobject jclass_loader = LoadDex("XandY");
@@ -638,5 +694,46 @@ TEST_F(ObjectTest, FindStaticField) {
   // TODO: test that interfaces trump superclasses.
 }
 
+TEST_F(ObjectTest, FindDeclaredMembers) {
+  ScopedObjectAccess soa(Thread::Current());
+  // String has enough members, many of them overloads, to be looked up through its member index.
+  Class* c = class_linker_->FindSystemClass("Ljava/lang/String;");
+  ASSERT_TRUE(c != NULL);
+
+  MethodHelper mh;
+  for (size_t i = 0; i < c->NumDirectMethods(); ++i) {
+    ArtMethod* m = c->GetDirectMethod(i);
+    mh.ChangeMethod(m);
+    EXPECT_EQ(m, c->FindDeclaredDirectMethod(mh.GetName(), mh.GetSignature()));
+    EXPECT_TRUE(c->FindDeclaredVirtualMethod(mh.GetName(), mh.GetSignature()) == NULL);
+  }
+  for (size_t i = 0; i < c->NumVirtualMethods(); ++i) {
+    ArtMethod* m = c->GetVirtualMethod(i);
+    mh.ChangeMethod(m);
+    EXPECT_EQ(m, c->FindDeclaredVirtualMethod(mh.GetName(), mh.GetSignature()));
+    EXPECT_TRUE(c->FindDeclaredDirectMethod(mh.GetName(), mh.GetSignature()) == NULL);
+  }
+  FieldHelper fh;
+  for (size_t i = 0; i < c->NumInstanceFields(); ++i) {
+    ArtField* f = c->GetInstanceField(i);
+    fh.ChangeField(f);
+    EXPECT_EQ(f, c->FindDeclaredInstanceField(fh.GetName(), fh.GetTypeDescriptor()));
+  }
+  for (size_t i = 0; i < c->NumStaticFields(); ++i) {
+    ArtField* f = c->GetStaticField(i);
+    fh.ChangeField(f);
+    EXPECT_EQ(f, c->FindDeclaredStaticField(fh.GetName(), fh.GetTypeDescriptor()));
+  }
+
+  // Overloads differ only in their signature.
+  ArtMethod* index_of_char = c->FindDeclaredVirtualMethod("indexOf", "(I)I");
+  ArtMethod* index_of_string = c->FindDeclaredVirtualMethod("indexOf", "(Ljava/lang/String;)I");
+  ASSERT_TRUE(index_of_char != NULL);
+  ASSERT_TRUE(index_of_string != NULL);
+  EXPECT_NE(index_of_char, index_of_string);
+  EXPECT_TRUE(c->FindDeclaredVirtualMethod("indexOf", "(J)I") == NULL);
+  EXPECT_TRUE(c->FindDeclaredVirtualMethod("indexof", "(I)I") == NULL);
+}
+
 }  // namespace mirror
 }  // namespace art
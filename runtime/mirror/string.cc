@@ -18,6 +18,7 @@
 
 #include "array.h"
 #include "gc/accounting/card_table-inl.h"
+#include "gc/heap.h"
 #include "intern_table.h"
 #include "object-inl.h"
 #include "runtime.h"
@@ -63,6 +64,12 @@ void String::SetArray(CharArray* new_array) SHARED_LOCKS_REQUIRED(Locks::mutator
   SetFieldObject(OFFSET_OF_OBJECT_MEMBER(String, array_), new_array, false);
 }
 
+void String::ShareArray(CharArray* array) {
+  DCHECK_EQ(0, GetOffset());
+  DCHECK_EQ(GetLength(), array->GetLength());
+  SetArray(array);
+}
+
 // TODO: get global references for these
 Class* String::java_lang_String_ = NULL;
 
@@ -158,7 +165,28 @@ String* String::AllocFromModifiedUtf8(Thread* self, int32_t utf16_length,
   return string;
 }
 
+// Longer strings are past the large object threshold, so their chars go to the large object space
+// whatever the string's layout.
+static const int32_t kMaxPairedLength = 64 * KB;
+
 String* String::Alloc(Thread* self, Class* java_lang_String, int32_t utf16_length) {
+  // Where there's room, place the chars right after the string so that both are allocated at once
+  // and share cache lines, otherwise allocate the array first and the string after it.
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  if (LIKELY(utf16_length >= 0 && utf16_length < kMaxPairedLength)) {
+    size_t array_size = CharArray::DataOffset(sizeof(uint16_t)).Uint32Value() +
+        utf16_length * sizeof(uint16_t);
+    Object* array = NULL;
+    String* string = down_cast<String*>(
+        heap->AllocObjectPair(self, java_lang_String, java_lang_String->GetObjectSize(),
+                              CharArray::GetArrayClass(), array_size, &array));
+    if (LIKELY(string != NULL)) {
+      array->AsCharArray()->SetLength(utf16_length);
+      string->SetArray(array->AsCharArray());
+      string->SetCount(utf16_length);
+      return string;
+    }
+  }
   SirtRef<CharArray> array(self, CharArray::Alloc(self, utf16_length));
   if (array.get() == NULL) {
     return NULL;
@@ -43,6 +43,10 @@ class MANAGED String : public Object {
     return OFFSET_OF_OBJECT_MEMBER(String, offset_);
   }
 
+  static MemberOffset HashCodeOffset() {
+    return OFFSET_OF_OBJECT_MEMBER(String, hash_code_);
+  }
+
   const CharArray* GetCharArray() const;
 
   int32_t GetOffset() const {
@@ -106,6 +110,10 @@ class MANAGED String : public Object {
 
   int32_t CompareTo(String* other) const;
 
+  // Points a string using all of its array at another array with the same chars, so that the
+  // string's own array can be freed.
+  void ShareArray(CharArray* array) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   static Class* GetJavaLangString() {
     DCHECK(java_lang_String_ != NULL);
     return java_lang_String_;
@@ -24,6 +24,7 @@
 #include "object_array.h"
 #include "object_array-inl.h"
 #include "object_utils.h"
+#include "stack.h"
 #include "utils.h"
 #include "well_known_classes.h"
 
@@ -67,7 +68,7 @@ std::string Throwable::Dump() const {
     for (int32_t i = 0; i < depth; ++i) {
       ArtMethod* method = down_cast<ArtMethod*>(method_trace->Get(i));
       mh.ChangeMethod(method);
-      uint32_t dex_pc = pc_trace->Get(i);
+      uint32_t dex_pc = StackVisitor::FramePcToDexPc(method, pc_trace->Get(i));
       int32_t line_number = mh.GetLineNumFromDexPC(dex_pc);
       const char* source_file = mh.GetDeclaringClassSourceFile();
       result += StringPrintf("  at %s (%s:%d)\n", PrettyMethod(method, true).c_str(),
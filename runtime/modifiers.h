@@ -48,6 +48,9 @@ static const uint32_t kAccClassIsProxy = 0x00040000;  // class (dex only)
 static const uint32_t kAccPreverified = 0x00080000;  // method (dex only)
 
 // Special runtime-only flags.
+static const uint32_t kAccFastNative = 0x00100000;  // method (registered with a '!' signature)
+static const uint32_t kAccInstrumented = 0x00200000;  // method (matches the instrumentation filter)
+static const uint32_t kAccOverridden = 0x00400000;  // method (a linked class overrides it)
 // Note: if only kAccClassIsReference is set, we have a soft reference.
 static const uint32_t kAccClassIsFinalizable        = 0x80000000;  // class/ancestor overrides finalize()
 static const uint32_t kAccClassIsReference          = 0x08000000;  // class is a soft/weak/phantom ref
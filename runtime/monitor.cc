@@ -16,6 +16,7 @@
 
 #include "monitor.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "base/mutex.h"
@@ -23,6 +24,8 @@
 #include "class_linker.h"
 #include "dex_file-inl.h"
 #include "dex_instruction.h"
+#include "lock_profiler.h"
+#include "metrics.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
@@ -59,12 +62,20 @@ namespace art {
  *    [31 ---- 19] [18 ---- 3] [2 ---- 1] [0]
  *     lock count   thread id  hash state  0
  *
+ * Once the identity hash code of an unlocked object is exposed, its
+ * thin lock holds it instead of the owner and count:
+ *
+ *    [31 ---- 3] [2 ---- 1] [0]
+ *     hash code  hash state  0
+ *
  * When set, the lock is in the "fat" state and its bits are formatted
  * as follows:
  *
  *    [31 ---- 3] [2 ---- 1] [0]
  *      pointer   hash state  1
  *
+ * The hash code of a fat lock is kept in the monitor.
+ *
  * For an in-depth description of the mechanics of thin-vs-fat locking,
  * read the paper referred to above.
  *
@@ -102,6 +113,12 @@ namespace art {
 
 bool (*Monitor::is_sensitive_thread_hook_)() = NULL;
 uint32_t Monitor::lock_profiling_threshold_ = 0;
+uint16_t Monitor::spin_budgets_[Monitor::kSpinBudgetEntries];
+AtomicInteger Monitor::hash_code_seed_(static_cast<int32_t>(0x2a2a2a2a));
+AtomicInteger Monitor::num_inflations_;
+AtomicInteger Monitor::num_contended_thin_locks_;
+AtomicInteger Monitor::num_spin_acquired_thin_locks_;
+AtomicInteger Monitor::num_contended_fat_locks_;
 
 bool Monitor::IsSensitiveThread() {
   if (is_sensitive_thread_hook_ != NULL) {
@@ -115,24 +132,29 @@ void Monitor::Init(uint32_t lock_profiling_threshold, bool (*is_sensitive_thread
   is_sensitive_thread_hook_ = is_sensitive_thread_hook;
 }
 
-Monitor::Monitor(Thread* owner, mirror::Object* obj)
+Monitor::Monitor(Thread* owner, mirror::Object* obj, uint32_t thin)
     : monitor_lock_("a monitor lock", kMonitorLock),
       owner_(owner),
       lock_count_(0),
       obj_(obj),
+      hash_code_(0),
       wait_set_(NULL),
+      wake_set_(NULL),
+      num_waiters_(0),
       locking_method_(NULL),
       locking_dex_pc_(0) {
   monitor_lock_.Lock(owner);
   // Propagate the lock state.
-  uint32_t thin = *obj->GetRawLockWordAddress();
-  lock_count_ = LW_LOCK_COUNT(thin);
-  thin &= LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT;
-  thin |= reinterpret_cast<uint32_t>(this) | LW_SHAPE_FAT;
-  // Publish the updated lock word.
-  android_atomic_release_store(thin, obj->GetRawLockWordAddress());
+  if (LW_HAS_HASH_CODE(thin)) {
+    hash_code_ = LW_HASH_CODE(thin);
+  } else {
+    lock_count_ = LW_LOCK_COUNT(thin);
+    if (LW_HASH_STATE(thin) == LW_HASH_STATE_HASHED_LOCKED) {
+      hash_code_ = AddressHashCode(obj);
+    }
+  }
   // Lock profiling.
-  if (lock_profiling_threshold_ != 0) {
+  if (lock_profiling_threshold_ != 0 || LockProfiler::IsEnabled()) {
     locking_method_ = owner->GetCurrentMethod(&locking_dex_pc_);
   }
 }
@@ -164,29 +186,58 @@ void Monitor::AppendToWaitSet(Thread* thread) {
 }
 
 /*
- * Unlinks a thread from a monitor's wait set.  The monitor lock must
- * be held by the caller of this routine.
+ * Links a notified thread into a monitor's wake set, after the threads
+ * notified before it.  The monitor lock must be held by the caller of this
+ * routine.
+ */
+void Monitor::AppendToWakeSet(Thread* thread) {
+  DCHECK(owner_ == Thread::Current());
+  DCHECK(thread != NULL);
+  DCHECK(thread->wait_next_ == NULL) << thread->wait_next_;
+  Thread** tail = &wake_set_;
+  while (*tail != NULL) {
+    tail = &(*tail)->wait_next_;
+  }
+  *tail = thread;
+}
+
+/*
+ * Unlinks a thread from a monitor's wait set or wake set, whichever it is
+ * still on.  The monitor lock must be held by the caller of this routine.
  */
 void Monitor::RemoveFromWaitSet(Thread *thread) {
   DCHECK(owner_ == Thread::Current());
   DCHECK(thread != NULL);
-  if (wait_set_ == NULL) {
-    return;
+  Thread** sets[] = { &wait_set_, &wake_set_ };
+  for (size_t i = 0; i < arraysize(sets); ++i) {
+    for (Thread** link = sets[i]; *link != NULL; link = &(*link)->wait_next_) {
+      if (*link == thread) {
+        *link = thread->wait_next_;
+        thread->wait_next_ = NULL;
+        return;
+      }
+    }
   }
-  if (wait_set_ == thread) {
-    wait_set_ = thread->wait_next_;
+}
+
+/*
+ * Wakes the first thread of the wake set that is still waiting.  Called
+ * as the monitor is released, so the woken thread finds it free rather than
+ * all the notified threads contending for it at once; each of them wakes
+ * the next one as it releases the monitor in turn.
+ */
+void Monitor::SignalWokenThread(Thread* self) {
+  while (wake_set_ != NULL) {
+    Thread* thread = wake_set_;
+    wake_set_ = thread->wait_next_;
     thread->wait_next_ = NULL;
-    return;
-  }
 
-  Thread* t = wait_set_;
-  while (t->wait_next_ != NULL) {
-    if (t->wait_next_ == thread) {
-      t->wait_next_ = thread->wait_next_;
-      thread->wait_next_ = NULL;
+    // Check to see if the thread is still waiting.
+    MutexLock mu(self, *thread->wait_mutex_);
+    if (thread->wait_monitor_ != NULL) {
+      thread->wait_cond_->Signal(self);
       return;
     }
-    t = t->wait_next_;
   }
 }
 
@@ -194,6 +245,13 @@ mirror::Object* Monitor::GetObject() {
   return obj_;
 }
 
+static void RecordContentionMetric() {
+  Metrics* metrics = Runtime::Current()->GetMetrics();
+  if (metrics != NULL) {
+    metrics->Add(Metrics::kMonitorContentions, 1);
+  }
+}
+
 void Monitor::Lock(Thread* self) {
   if (owner_ == self) {
     lock_count_++;
@@ -201,24 +259,34 @@ void Monitor::Lock(Thread* self) {
   }
 
   if (!monitor_lock_.TryLock(self)) {
+    ++num_contended_fat_locks_;
+    RecordContentionMetric();
+    ++num_waiters_;
     uint64_t waitStart = 0;
     uint64_t waitEnd = 0;
     uint32_t wait_threshold = lock_profiling_threshold_;
+    const bool profile = LockProfiler::IsEnabled();
     const mirror::ArtMethod* current_locking_method = NULL;
     uint32_t current_locking_dex_pc = 0;
     {
       ScopedThreadStateChange tsc(self, kBlocked);
-      if (wait_threshold != 0) {
+      if (wait_threshold != 0 || profile) {
         waitStart = NanoTime() / 1000;
       }
       current_locking_method = locking_method_;
       current_locking_dex_pc = locking_dex_pc_;
 
       monitor_lock_.Lock(self);
-      if (wait_threshold != 0) {
+      if (wait_threshold != 0 || profile) {
         waitEnd = NanoTime() / 1000;
       }
     }
+    --num_waiters_;
+
+    if (profile) {
+      LockProfiler::RecordMonitorContention(current_locking_method, current_locking_dex_pc,
+                                            (waitEnd - waitStart) * 1000);
+    }
 
     if (wait_threshold != 0) {
       uint64_t wait_ms = (waitEnd - waitStart) / 1000;
@@ -242,7 +310,7 @@ void Monitor::Lock(Thread* self) {
 
   // When debugging, save the current monitor holder for future
   // acquisition failures to use in sampled logging.
-  if (lock_profiling_threshold_ != 0) {
+  if (lock_profiling_threshold_ != 0 || LockProfiler::IsEnabled()) {
     locking_method_ = self->GetCurrentMethod(&locking_dex_pc_);
   }
 }
@@ -344,12 +412,14 @@ bool Monitor::Unlock(Thread* self, bool for_wait) {
       owner_ = NULL;
       locking_method_ = NULL;
       locking_dex_pc_ = 0;
+      SignalWokenThread(self);
       monitor_lock_.Unlock(self);
     } else {
       --lock_count_;
     }
   } else if (for_wait) {
-    // Wait should have already cleared the fields.
+    // Wait should have already cleared the fields and woken the next thread of the wake set, it
+    // can't while holding its own wait_mutex_.
     DCHECK_EQ(lock_count_, 0);
     DCHECK(owner == NULL);
     DCHECK(locking_method_ == NULL);
@@ -430,6 +500,7 @@ void Monitor::WaitWithLock(Thread* self, int64_t ms, int32_t ns,
    * not order sensitive as we hold the pthread mutex.
    */
   AppendToWaitSet(self);
+  ++num_waiters_;
   int prev_lock_count = lock_count_;
   lock_count_ = 0;
   owner_ = NULL;
@@ -445,6 +516,9 @@ void Monitor::WaitWithLock(Thread* self, int64_t ms, int32_t ns,
    */
   self->TransitionFromRunnableToSuspended(why);
 
+  // Hand the monitor over to a notified thread, if any, as Unlock would.
+  SignalWokenThread(self);
+
   bool was_interrupted = false;
   {
     // Pseudo-atomically wait on self's wait_cond_ and release the monitor lock.
@@ -492,6 +566,7 @@ void Monitor::WaitWithLock(Thread* self, int64_t ms, int32_t ns,
 
   // Re-acquire the monitor lock.
   Lock(self);
+  --num_waiters_;
 
   self->wait_mutex_->AssertNotHeld(self);
 
@@ -538,7 +613,8 @@ void Monitor::Notify(Thread* self) {
 }
 
 void Monitor::NotifyWithLock(Thread* self) {
-  // Signal the first waiting thread in the wait set.
+  // Move the first waiting thread in the wait set to the wake set, it is signalled once we release
+  // the monitor.
   while (wait_set_ != NULL) {
     Thread* thread = wait_set_;
     wait_set_ = thread->wait_next_;
@@ -547,7 +623,7 @@ void Monitor::NotifyWithLock(Thread* self) {
     // Check to see if the thread is still waiting.
     MutexLock mu(self, *thread->wait_mutex_);
     if (thread->wait_monitor_ != NULL) {
-      thread->wait_cond_->Signal(self);
+      AppendToWakeSet(thread);
       return;
     }
   }
@@ -565,13 +641,17 @@ void Monitor::NotifyAll(Thread* self) {
 }
 
 void Monitor::NotifyAllWithLock() {
-  // Signal all threads in the wait set.
-  while (wait_set_ != NULL) {
-    Thread* thread = wait_set_;
-    wait_set_ = thread->wait_next_;
-    thread->wait_next_ = NULL;
-    thread->Notify();
+  // Move all threads in the wait set to the wake set. Rather than all of them waking up only to
+  // block on the monitor we hold, they are signalled one at a time as the monitor is released.
+  if (wait_set_ == NULL) {
+    return;
   }
+  Thread** tail = &wake_set_;
+  while (*tail != NULL) {
+    tail = &(*tail)->wait_next_;
+  }
+  *tail = wait_set_;
+  wait_set_ = NULL;
 }
 
 /*
@@ -585,10 +665,153 @@ void Monitor::Inflate(Thread* self, mirror::Object* obj) {
   DCHECK_EQ(LW_LOCK_OWNER(*obj->GetRawLockWordAddress()), static_cast<int32_t>(self->GetThinLockId()));
 
   // Allocate and acquire a new monitor.
-  Monitor* m = new Monitor(self, obj);
+  Monitor* m = new Monitor(self, obj, *obj->GetRawLockWordAddress());
+  // Publish the updated lock word. Owning the thin lock, no other thread changes it.
+  android_atomic_release_store(m->GetFatLockWord(), obj->GetRawLockWordAddress());
   VLOG(monitor) << "monitor: thread " << self->GetThinLockId()
                 << " created monitor " << m << " for object " << obj;
   Runtime::Current()->GetMonitorList()->Add(m);
+  ++num_inflations_;
+}
+
+bool Monitor::InflateHashed(Thread* self, mirror::Object* obj, uint32_t thin) {
+  DCHECK_EQ(LW_SHAPE(thin), LW_SHAPE_THIN);
+  DCHECK(LW_HAS_HASH_CODE(thin));
+  Monitor* m = new Monitor(self, obj, thin);
+  // Other threads locking the object race to replace the hashed thin lock.
+  if (android_atomic_release_cas(thin, m->GetFatLockWord(), obj->GetRawLockWordAddress()) != 0) {
+    m->owner_ = NULL;
+    m->monitor_lock_.Unlock(self);
+    delete m;
+    return false;
+  }
+  VLOG(monitor) << "monitor: thread " << self->GetThinLockId()
+                << " created monitor " << m << " for hashed object " << obj;
+  Runtime::Current()->GetMonitorList()->Add(m);
+  ++num_inflations_;
+  return true;
+}
+
+int32_t Monitor::GenerateHashCode() {
+  while (true) {
+    int32_t seed = hash_code_seed_;
+    int32_t new_seed = static_cast<int32_t>(static_cast<uint32_t>(seed) * 1103515245 + 12345);
+    // The low bits of the generator have short periods, the hash code takes the high ones.
+    int32_t hash = static_cast<uint32_t>(new_seed) >> LW_HASH_CODE_SHIFT;
+    if (hash_code_seed_.compare_and_swap(seed, new_seed) && hash != 0) {
+      return hash;
+    }
+  }
+}
+
+int32_t Monitor::GetHashCode() {
+  while (hash_code_ == 0) {
+    hash_code_.compare_and_swap(0, GenerateHashCode());
+  }
+  return hash_code_;
+}
+
+int32_t Monitor::AddressHashCode(mirror::Object* obj) {
+  // Objects don't move while they are locked, the owner stores the hash code when it unlocks.
+  int32_t hash = (reinterpret_cast<uintptr_t>(obj) / kObjectAlignment) & LW_HASH_CODE_MASK;
+  return (hash != 0) ? hash : 1;
+}
+
+static uint32_t HashedLockWord(int32_t hash) {
+  return (static_cast<uint32_t>(hash) << LW_HASH_CODE_SHIFT) |
+      (LW_HASH_STATE_HASHED << LW_HASH_STATE_SHIFT) | LW_SHAPE_THIN;
+}
+
+int32_t Monitor::IdentityHashCode(Thread* self, mirror::Object* obj) {
+  volatile int32_t* thinp = obj->GetRawLockWordAddress();
+  while (true) {
+    uint32_t thin = *thinp;
+    if (LW_SHAPE(thin) == LW_SHAPE_FAT) {
+      return LW_MONITOR(thin)->GetHashCode();
+    } else if (LW_HAS_HASH_CODE(thin)) {
+      return LW_HASH_CODE(thin);
+    } else if (LW_HASH_STATE(thin) == LW_HASH_STATE_HASHED_LOCKED) {
+      return AddressHashCode(obj);
+    } else if (thin == 0) {
+      int32_t hash = GenerateHashCode();
+      if (android_atomic_release_cas(0, HashedLockWord(hash), thinp) == 0) {
+        return hash;
+      }
+      // Locked or hashed by another thread meanwhile, try again.
+    } else if (LW_LOCK_OWNER(thin) == self->GetThinLockId()) {
+      // A held thin lock has no room for the hash code, the monitor holds it.
+      Inflate(self, obj);
+    } else {
+      // Only its owner inflates a thin lock, and waiting for the lock could deadlock with the
+      // owner. The owner doesn't touch its lock word while suspended, so the hash state can be
+      // set under it.
+      ThreadList* thread_list = Runtime::Current()->GetThreadList();
+      bool timed_out = false;
+      {
+        ScopedThreadStateChange tsc(self, kBlocked);
+        Thread* owner = thread_list->SuspendThreadByThinLockId(LW_LOCK_OWNER(thin), &timed_out);
+        if (owner != NULL) {
+          thin = *thinp;
+          if (LW_SHAPE(thin) == LW_SHAPE_THIN && LW_HASH_STATE(thin) == LW_HASH_STATE_UNHASHED &&
+              LW_LOCK_OWNER(thin) == owner->GetThinLockId()) {
+            uint32_t hashed_thin = thin | (LW_HASH_STATE_HASHED_LOCKED << LW_HASH_STATE_SHIFT);
+            android_atomic_release_cas(thin, hashed_thin, thinp);
+          }
+          thread_list->Resume(owner);
+        }
+      }
+      if (timed_out) {
+        // The owner couldn't be suspended. Wait for the lock instead, holding it we inflate the
+        // lock ourselves.
+        MonitorEnter(self, obj);
+        int32_t hash = IdentityHashCode(self, obj);
+        MonitorExit(self, obj);
+        return hash;
+      }
+      // Released, hashed or inflated meanwhile, try again.
+    }
+  }
+}
+
+int32_t Monitor::GetUnlockedLockWord(mirror::Object* obj) {
+  uint32_t lock_word = *obj->GetRawLockWordAddress();
+  int32_t hash;
+  if (LW_SHAPE(lock_word) == LW_SHAPE_FAT) {
+    hash = LW_MONITOR(lock_word)->hash_code_;
+  } else if (LW_HAS_HASH_CODE(lock_word)) {
+    hash = LW_HASH_CODE(lock_word);
+  } else if (LW_HASH_STATE(lock_word) == LW_HASH_STATE_HASHED_LOCKED) {
+    hash = AddressHashCode(obj);
+  } else {
+    return 0;
+  }
+  return (hash == 0) ? 0 : HashedLockWord(hash);
+}
+
+bool Monitor::SpinOnThinLock(Thread* self, mirror::Object* obj, uint32_t thread_id) {
+  volatile int32_t* thinp = obj->GetRawLockWordAddress();
+  uint16_t& budget = spin_budgets_[(reinterpret_cast<uintptr_t>(obj) >> 3) % kSpinBudgetEntries];
+  const uint32_t spins = (budget == 0) ? kMinSpins : budget;
+  for (uint32_t i = 0; i < spins; ++i) {
+    uint32_t thin = *thinp;
+    if (LW_SHAPE(thin) != LW_SHAPE_THIN || LW_HASH_STATE(thin) != LW_HASH_STATE_UNHASHED) {
+      return false;  // Inflated by the owner or to be inflated, no point in spinning on it.
+    }
+    if (thin == 0) {
+      uint32_t newThin = thread_id << LW_LOCK_OWNER_SHIFT;
+      if (android_atomic_acquire_cas(thin, newThin, thinp) == 0) {
+        budget = std::min<uint32_t>(spins * 2, kMaxSpins);
+        ++num_spin_acquired_thin_locks_;
+        return true;
+      }
+    } else if (self->ReadFlag(kSuspendRequest) || self->ReadFlag(kCheckpointRequest)) {
+      // Don't hold up a suspension or checkpoint while runnable.
+      break;
+    }
+    SpinPause();
+  }
+  budget = std::max<uint32_t>(spins / 2, kMinSpins);
+  return false;
 }
 
 void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
@@ -622,19 +845,31 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
          */
         Inflate(self, obj);
       }
-    } else if (LW_LOCK_OWNER(thin) == 0) {
+    } else if (thin == 0) {
       // The lock is unowned. Install the thread id of the calling thread into the owner field.
       // This is the common case: compiled code will have tried this before calling back into
       // the runtime.
-      newThin = thin | (threadId << LW_LOCK_OWNER_SHIFT);
+      newThin = threadId << LW_LOCK_OWNER_SHIFT;
       if (android_atomic_acquire_cas(thin, newThin, thinp) != 0) {
         // The acquire failed. Try again.
         goto retry;
       }
+    } else if (LW_HAS_HASH_CODE(thin)) {
+      // The lock word holds the hash code, which moves into a monitor acquired by this thread.
+      if (!InflateHashed(self, obj, thin)) {
+        goto retry;
+      }
     } else {
+      ++num_contended_thin_locks_;
+      RecordContentionMetric();
+      // Short critical sections end sooner than a trip through the scheduler, spin first.
+      if (SpinOnThinLock(self, obj, threadId)) {
+        return;
+      }
       VLOG(monitor) << StringPrintf("monitor: thread %d spin on lock %p (a %s) owned by %d",
                                     threadId, thinp, PrettyTypeOf(obj).c_str(), LW_LOCK_OWNER(thin));
       // The lock is owned by another thread. Notify the runtime that we are about to wait.
+      const uint64_t wait_start_ns = LockProfiler::IsEnabled() ? NanoTime() : 0;
       self->monitor_enter_object_ = obj;
       self->TransitionFromRunnableToSuspended(kBlocked);
       // Spin until the thin lock is released or inflated.
@@ -643,11 +878,11 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
         thin = *thinp;
         // Check the shape of the lock word. Another thread
         // may have inflated the lock while we were waiting.
-        if (LW_SHAPE(thin) == LW_SHAPE_THIN) {
-          if (LW_LOCK_OWNER(thin) == 0) {
+        if (LW_SHAPE(thin) == LW_SHAPE_THIN && !LW_HAS_HASH_CODE(thin)) {
+          if (thin == 0) {
             // The lock has been released. Install the thread id of the
             // calling thread into the owner field.
-            newThin = thin | (threadId << LW_LOCK_OWNER_SHIFT);
+            newThin = threadId << LW_LOCK_OWNER_SHIFT;
             if (android_atomic_acquire_cas(thin, newThin, thinp) == 0) {
               // The acquire succeed. Break out of the loop and proceed to inflate the lock.
               break;
@@ -668,8 +903,8 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
             }
           }
         } else {
-          // The thin lock was inflated by another thread. Let the runtime know we are no longer
-          // waiting and try again.
+          // The thin lock was inflated by another thread, or released and hashed. Let the runtime
+          // know we are no longer waiting and try again.
           VLOG(monitor) << StringPrintf("monitor: thread %d found lock %p surprise-fattened by another thread", threadId, thinp);
           self->monitor_enter_object_ = NULL;
           self->TransitionFromSuspendedToRunnable();
@@ -677,6 +912,10 @@ void Monitor::MonitorEnter(Thread* self, mirror::Object* obj) {
         }
       }
       VLOG(monitor) << StringPrintf("monitor: thread %d spin on lock %p done", threadId, thinp);
+      if (wait_start_ns != 0) {
+        // Owners of thin locks don't record where they acquired them.
+        LockProfiler::RecordMonitorContention(NULL, 0, NanoTime() - wait_start_ns);
+      }
       // We have acquired the thin lock. Let the runtime know that we are no longer waiting.
       self->monitor_enter_object_ = NULL;
       self->TransitionFromSuspendedToRunnable();
@@ -719,11 +958,15 @@ bool Monitor::MonitorExit(Thread* self, mirror::Object* obj) {
       if (LW_LOCK_COUNT(thin) == 0) {
         /*
          * The lock was not recursively acquired, the common
-         * case.  Unlock by clearing all bits except for the
-         * hash state.
+         * case.  Unlock by clearing all bits, unless the
+         * object got hashed while locked: its hash code goes
+         * in the lock word.
          */
-        thin &= (LW_HASH_STATE_MASK << LW_HASH_STATE_SHIFT);
-        android_atomic_release_store(thin, thinp);
+        if (LW_HASH_STATE(thin) == LW_HASH_STATE_HASHED_LOCKED) {
+          android_atomic_release_store(HashedLockWord(AddressHashCode(obj)), thinp);
+        } else {
+          android_atomic_release_store(0, thinp);
+        }
       } else {
         /*
          * The object was recursively acquired.  Decrement the
@@ -990,7 +1233,7 @@ void Monitor::TranslateLocation(const mirror::ArtMethod* method, uint32_t dex_pc
 }
 
 MonitorList::MonitorList()
-    : allow_new_monitors_(true), monitor_list_lock_("MonitorList lock"),
+    : allow_new_monitors_(true), num_deflated_(0), monitor_list_lock_("MonitorList lock"),
       monitor_add_condition_("MonitorList disallow condition", monitor_list_lock_) {
 }
 
@@ -1011,6 +1254,21 @@ void MonitorList::AllowNewMonitors() {
   monitor_add_condition_.Broadcast(self);
 }
 
+void MonitorList::DumpForSigQuit(std::ostream& os) {
+  size_t num_monitors;
+  uint64_t num_deflated;
+  {
+    MutexLock mu(Thread::Current(), monitor_list_lock_);
+    num_monitors = list_.size();
+    num_deflated = num_deflated_;
+  }
+  os << "Monitors: " << num_monitors << " live; " << Monitor::num_inflations_ << " inflations; "
+     << num_deflated << " deflations; "
+     << Monitor::num_contended_thin_locks_ << " contended thin locks, "
+     << Monitor::num_spin_acquired_thin_locks_ << " acquired by spinning; "
+     << Monitor::num_contended_fat_locks_ << " contended fat locks\n";
+}
+
 void MonitorList::Add(Monitor* m) {
   Thread* self = Thread::Current();
   MutexLock mu(self, monitor_list_lock_);
@@ -1020,6 +1278,29 @@ void MonitorList::Add(Monitor* m) {
   list_.push_front(m);
 }
 
+size_t MonitorList::DeflateMonitors() {
+  Thread* self = Thread::Current();
+  Locks::mutator_lock_->AssertExclusiveHeld(self);
+  MutexLock mu(self, monitor_list_lock_);
+  size_t deflated = 0;
+  for (auto it = list_.begin(); it != list_.end(); ) {
+    Monitor* m = *it;
+    if (m->IsIdle()) {
+      volatile int32_t* thinp = m->GetObject()->GetRawLockWordAddress();
+      // An unowned thin lock, keeping the hash code.
+      int32_t thin = Monitor::GetUnlockedLockWord(m->GetObject());
+      delete m;
+      *thinp = thin;
+      it = list_.erase(it);
+      ++deflated;
+    } else {
+      ++it;
+    }
+  }
+  num_deflated_ += deflated;
+  return deflated;
+}
+
 void MonitorList::SweepMonitorList(IsMarkedTester is_marked, void* arg) {
   MutexLock mu(Thread::Current(), monitor_list_lock_);
   for (auto it = list_.begin(); it != list_.end(); ) {
@@ -1051,6 +1332,9 @@ MonitorInfo::MonitorInfo(mirror::Object* o) : owner(NULL), entry_count(0) {
     for (Thread* waiter = monitor->wait_set_; waiter != NULL; waiter = waiter->wait_next_) {
       waiters.push_back(waiter);
     }
+    for (Thread* waiter = monitor->wake_set_; waiter != NULL; waiter = waiter->wait_next_) {
+      waiters.push_back(waiter);
+    }
   }
 }
 
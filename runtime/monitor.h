@@ -24,6 +24,7 @@
 #include <list>
 #include <vector>
 
+#include "atomic_integer.h"
 #include "base/mutex.h"
 #include "root_visitor.h"
 #include "thread_state.h"
@@ -38,22 +39,38 @@ namespace art {
 
 /*
  * Hash state field.  Used to signify that an object has had its
- * identity hash code exposed or relocated.
+ * identity hash code exposed or relocated.  Only unlocked thin locks
+ * and monitors hold hash codes, locking a hashed thin lock inflates it.
+ * A thin lock held when another thread hashes its object keeps its
+ * owner and count, its hash code is derived from the object's address
+ * until the owner releases the lock and stores the hash code.
  */
 #define LW_HASH_STATE_UNHASHED 0
 #define LW_HASH_STATE_HASHED 1
+#define LW_HASH_STATE_HASHED_LOCKED 2
 #define LW_HASH_STATE_HASHED_AND_MOVED 3
 #define LW_HASH_STATE_MASK 0x3
 #define LW_HASH_STATE_SHIFT 1
 #define LW_HASH_STATE(x) (((x) >> LW_HASH_STATE_SHIFT) & LW_HASH_STATE_MASK)
+#define LW_HAS_HASH_CODE(x) ((LW_HASH_STATE(x) & LW_HASH_STATE_HASHED) != 0)
 
 /*
  * Lock owner field.  Contains the thread id of the thread currently
- * holding the lock.
+ * holding the lock, zero for a thin lock holding a hash code, which is
+ * never held.
  */
 #define LW_LOCK_OWNER_MASK 0xffff
 #define LW_LOCK_OWNER_SHIFT 3
-#define LW_LOCK_OWNER(x) (((x) >> LW_LOCK_OWNER_SHIFT) & LW_LOCK_OWNER_MASK)
+#define LW_LOCK_OWNER(x) \
+  (LW_HAS_HASH_CODE(x) ? 0 : (((x) >> LW_LOCK_OWNER_SHIFT) & LW_LOCK_OWNER_MASK))
+
+/*
+ * Hash code field of a hashed thin lock, in place of the owner and
+ * count.  Generated hash codes are never zero.
+ */
+#define LW_HASH_CODE_MASK 0x1fffffff
+#define LW_HASH_CODE_SHIFT 3
+#define LW_HASH_CODE(x) (((x) >> LW_HASH_CODE_SHIFT) & LW_HASH_CODE_MASK)
 
 namespace mirror {
   class ArtMethod;
@@ -102,18 +119,61 @@ class Monitor {
 
   static bool IsValidLockWord(int32_t lock_word);
 
+  // Returns the identity hash code of obj, generating it on first use. The hash code stays in the
+  // lock word while the object is unlocked and moves into the monitor when the lock is inflated.
+  // Hashing an object thin locked by another thread suspends the owner to mark the lock hashed,
+  // it never waits for the lock.
+  static int32_t IdentityHashCode(Thread* self, mirror::Object* obj)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns the lock word of obj unlocked and deflated, which keeps its hash code.
+  static int32_t GetUnlockedLockWord(mirror::Object* obj);
+
   mirror::Object* GetObject();
 
+  // Whether the monitor is unowned with no thread blocked on it or waiting on it. Only meaningful
+  // while all mutators are suspended.
+  bool IsIdle() const {
+    return owner_ == NULL && wait_set_ == NULL && wake_set_ == NULL && num_waiters_ == 0;
+  }
+
  private:
-  explicit Monitor(Thread* owner, mirror::Object* obj)
+  // Takes the lock count or the hash code of the thin lock word the monitor replaces, which the
+  // caller publishes.
+  Monitor(Thread* owner, mirror::Object* obj, uint32_t thin)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  uint32_t GetFatLockWord() const {
+    return reinterpret_cast<uint32_t>(this) | LW_SHAPE_FAT;
+  }
+
+  int32_t GetHashCode();
+
+  static int32_t GenerateHashCode();
+
+  // The hash code of an object whose thin lock got hashed while held, see
+  // LW_HASH_STATE_HASHED_LOCKED.
+  static int32_t AddressHashCode(mirror::Object* obj);
+
   void AppendToWaitSet(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
+  void AppendToWakeSet(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
   void RemoveFromWaitSet(Thread* thread) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
+  // Signals the first thread of the wake set still waiting, before monitor_lock_ is released.
+  void SignalWokenThread(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(monitor_lock_);
 
   static void Inflate(Thread* self, mirror::Object* obj)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Inflates the hashed thin lock of obj to a monitor owned by self. Returns false if another
+  // thread inflated it first.
+  static bool InflateHashed(Thread* self, mirror::Object* obj, uint32_t thin)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Spins while another thread holds the thin lock of obj, for at most the spin budget of the
+  // lock. Returns true if the calling thread acquired the thin lock.
+  static bool SpinOnThinLock(Thread* self, mirror::Object* obj, uint32_t thread_id)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   void LogContentionEvent(Thread* self, uint32_t wait_ms, uint32_t sample_percent,
                           const char* owner_filename, uint32_t owner_line_number)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -150,6 +210,24 @@ class Monitor {
   static bool (*is_sensitive_thread_hook_)();
   static uint32_t lock_profiling_threshold_;
 
+  // Spin budgets of thin locks, shared by the locks whose objects hash to the same entry. A budget
+  // doubles when spinning acquired the lock and halves when it didn't, so locks held for short
+  // critical sections are spun on and long held ones go to sleep and inflate quickly. Updates are
+  // racy, which only costs some accuracy.
+  static const size_t kSpinBudgetEntries = 256;
+  static const uint16_t kMinSpins = 16;
+  static const uint16_t kMaxSpins = 4096;
+  static uint16_t spin_budgets_[kSpinBudgetEntries];
+
+  // Linear congruential generator state of the identity hash codes.
+  static AtomicInteger hash_code_seed_;
+
+  // Counters for DumpForSigQuit.
+  static AtomicInteger num_inflations_;
+  static AtomicInteger num_contended_thin_locks_;
+  static AtomicInteger num_spin_acquired_thin_locks_;
+  static AtomicInteger num_contended_fat_locks_;
+
   Mutex monitor_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
   // Which thread currently owns the lock?
@@ -161,9 +239,20 @@ class Monitor {
   // What object are we part of (for debugging).
   mirror::Object* const obj_;
 
+  // Identity hash code of obj_, zero until generated.
+  AtomicInteger hash_code_;
+
   // Threads currently waiting on this monitor.
   Thread* wait_set_ GUARDED_BY(monitor_lock_);
 
+  // Threads notified but still waiting to be signalled, in the order they were notified. One is
+  // signalled each time the monitor is released.
+  Thread* wake_set_ GUARDED_BY(monitor_lock_);
+
+  // Threads blocked acquiring monitor_lock_ or between waiting on the monitor and reacquiring it,
+  // which hold on to the monitor.
+  AtomicInteger num_waiters_;
+
   // Method and dex pc where the lock owner acquired the lock, used when lock
   // sampling is enabled. locking_method_ may be null if the lock is currently
   // unlocked, or if the lock is acquired by the system when the stack is empty.
@@ -186,8 +275,18 @@ class MonitorList {
       SHARED_LOCKS_REQUIRED(Locks::heap_bitmap_lock_);
   void DisallowNewMonitors();
   void AllowNewMonitors();
+
+  void DumpForSigQuit(std::ostream& os) LOCKS_EXCLUDED(monitor_list_lock_);
+
+  // Turns the locks of idle monitors back into thin locks and frees the monitors. All mutators
+  // must be suspended. Returns the number of monitors deflated.
+  size_t DeflateMonitors()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(monitor_list_lock_);
+
  private:
   bool allow_new_monitors_ GUARDED_BY(monitor_list_lock_);
+  uint64_t num_deflated_ GUARDED_BY(monitor_list_lock_);
   Mutex monitor_list_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   ConditionVariable monitor_add_condition_ GUARDED_BY(monitor_list_lock_);
   std::list<Monitor*> list_ GUARDED_BY(monitor_list_lock_);
@@ -14,9 +14,12 @@
  * limitations under the License.
  */
 
+#include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "base/logging.h"
+#include "base/unix_file/fd_file.h"
 #include "class_linker.h"
 #include "common_throws.h"
 #include "dex_file-inl.h"
@@ -34,6 +37,7 @@
 #include "ScopedLocalRef.h"
 #include "ScopedUtfChars.h"
 #include "toStringArray.h"
+#include "UniquePtr.h"
 #include "zip_archive.h"
 
 namespace art {
@@ -140,10 +144,7 @@ static void DexFile_closeDexFile(JNIEnv* env, jclass, jint cookie) {
   if (dex_file == NULL) {
     return;
   }
-  if (Runtime::Current()->GetClassLinker()->IsDexFileRegistered(*dex_file)) {
-    return;
-  }
-  delete dex_file;
+  Runtime::Current()->GetClassLinker()->CloseDexFile(dex_file);
 }
 
 static jclass DexFile_defineClassNative(JNIEnv* env, jclass, jstring javaName, jobject javaLoader,
@@ -170,6 +171,9 @@ static jclass DexFile_defineClassNative(JNIEnv* env, jclass, jstring javaName, j
   mirror::ClassLoader* class_loader = soa.Decode<mirror::ClassLoader*>(javaLoader);
   mirror::Class* result = class_linker->DefineClass(descriptor.c_str(), class_loader, *dex_file,
                                                     *dex_class_def);
+  if (result != NULL) {
+    class_linker->VerifyClassInBackground(soa.Self(), result);
+  }
   VLOG(class_linker) << "DexFile_defineClassNative returning " << result;
   return soa.AddLocalReference<jclass>(result);
 }
@@ -193,6 +197,83 @@ static jobjectArray DexFile_getClassNameList(JNIEnv* env, jclass, jint cookie) {
   return toStringArray(env, class_names);
 }
 
+// What a cache file was found up-to-date against, recorded next to it so that later checks of an
+// unchanged dex file and cache file only need to stat them, rather than to open the cache file and
+// the dex file's zip archive. A file is taken as unchanged if its inode, size and modification
+// time are.
+struct DexOptStamp {
+  static const uint32_t kMagic = 0x4d545344;  // "DSTM".
+  static const uint32_t kVersion = 1;
+
+  uint32_t magic;
+  uint32_t version;
+  uint64_t dex_inode;
+  uint64_t dex_size;
+  uint64_t dex_mtime;
+  uint64_t oat_inode;
+  uint64_t oat_size;
+  uint64_t oat_mtime;
+  uint32_t image_oat_checksum;
+  uint32_t image_oat_data_begin;
+};
+
+static std::string GetDexOptStampFilename(const std::string& cache_location) {
+  return cache_location + ".stamp";
+}
+
+// Fills stamp for the files as they are now, returns false if one of them can't be stat'ed.
+static bool MakeDexOptStamp(const char* filename, const std::string& cache_location,
+                            DexOptStamp* stamp) {
+  struct stat dex_stat;
+  struct stat oat_stat;
+  if (stat(filename, &dex_stat) != 0 || stat(cache_location.c_str(), &oat_stat) != 0) {
+    return false;
+  }
+  // Cleared so that stamps compare with memcmp.
+  memset(stamp, 0, sizeof(*stamp));
+  stamp->magic = DexOptStamp::kMagic;
+  stamp->version = DexOptStamp::kVersion;
+  stamp->dex_inode = dex_stat.st_ino;
+  stamp->dex_size = dex_stat.st_size;
+  stamp->dex_mtime = dex_stat.st_mtime;
+  stamp->oat_inode = oat_stat.st_ino;
+  stamp->oat_size = oat_stat.st_size;
+  stamp->oat_mtime = oat_stat.st_mtime;
+  for (const auto& space : Runtime::Current()->GetHeap()->GetContinuousSpaces()) {
+    if (space->IsImageSpace()) {
+      // TODO: Ensure this works with multiple image spaces.
+      const gc::space::ImageSpace* image_space = space->AsImageSpace();
+      stamp->image_oat_checksum = image_space->GetImageHeader().GetOatChecksum();
+      stamp->image_oat_data_begin = image_space->GetImageFileLocationOatDataBegin();
+      break;
+    }
+  }
+  return true;
+}
+
+static bool IsDexOptStampCurrent(const std::string& cache_location, const DexOptStamp& stamp) {
+  UniquePtr<File> file(OS::OpenFileForReading(GetDexOptStampFilename(cache_location).c_str()));
+  if (file.get() == NULL) {
+    return false;
+  }
+  DexOptStamp recorded;
+  return file->ReadFully(&recorded, sizeof(recorded)) &&
+      memcmp(&recorded, &stamp, sizeof(stamp)) == 0;
+}
+
+// Failing to write the stamp only costs the next check the full validation, as does reading a
+// stamp being written.
+static void WriteDexOptStamp(const std::string& cache_location, const DexOptStamp& stamp) {
+  std::string stamp_filename(GetDexOptStampFilename(cache_location));
+  UniquePtr<File> file(OS::CreateEmptyFile(stamp_filename.c_str()));
+  if (file.get() == NULL || !file->WriteFully(&stamp, sizeof(stamp))) {
+    VLOG(class_linker) << "Failed to write " << stamp_filename;
+    if (file.get() != NULL) {
+      unlink(stamp_filename.c_str());
+    }
+  }
+}
+
 static jboolean DexFile_isDexOptNeeded(JNIEnv* env, jclass, jstring javaFilename) {
   bool debug_logging = false;
 
@@ -255,8 +336,22 @@ static jboolean DexFile_isDexOptNeeded(JNIEnv* env, jclass, jstring javaFilename
     }
   }
 
-  // Check if we have an oat file in the cache
+  // Only look for the dalvik-cache once the odex file didn't answer, it may be missing or
+  // unwritable when there's a valid odex file. An up-to-date stamp saves checking the cache file
+  // again. The files are stat'ed before being checked, so that a stamp written after the checks
+  // doesn't cover changes made in between.
   std::string cache_location(GetDalvikCacheFilenameOrDie(filename.c_str()));
+  DexOptStamp stamp;
+  bool have_stamp = MakeDexOptStamp(filename.c_str(), cache_location, &stamp);
+  if (have_stamp && IsDexOptStampCurrent(cache_location, stamp)) {
+    if (debug_logging) {
+      LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
+                << " is up-to-date for " << filename.c_str() << " as stamped";
+    }
+    return JNI_FALSE;
+  }
+
+  // Check if we have an oat file in the cache
   oat_file.reset(OatFile::Open(cache_location, filename.c_str(), NULL, false));
   if (oat_file.get() == NULL) {
     LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
@@ -267,7 +362,8 @@ static jboolean DexFile_isDexOptNeeded(JNIEnv* env, jclass, jstring javaFilename
   for (const auto& space : runtime->GetHeap()->GetContinuousSpaces()) {
     if (space->IsImageSpace()) {
       // TODO: Ensure this works with multiple image spaces.
-      const ImageHeader& image_header = space->AsImageSpace()->GetImageHeader();
+      const gc::space::ImageSpace* image_space = space->AsImageSpace();
+      const ImageHeader& image_header = image_space->GetImageHeader();
       if (oat_file->GetOatHeader().GetImageFileLocationOatChecksum() != image_header.GetOatChecksum()) {
         ScopedObjectAccess soa(env);
         LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
@@ -276,7 +372,7 @@ static jboolean DexFile_isDexOptNeeded(JNIEnv* env, jclass, jstring javaFilename
         return JNI_TRUE;
       }
       if (oat_file->GetOatHeader().GetImageFileLocationOatDataBegin()
-          != reinterpret_cast<uint32_t>(image_header.GetOatDataBegin())) {
+          != image_space->GetImageFileLocationOatDataBegin()) {
         ScopedObjectAccess soa(env);
         LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
                   << " has out-of-date oat begin compared to "
@@ -303,6 +399,9 @@ static jboolean DexFile_isDexOptNeeded(JNIEnv* env, jclass, jstring javaFilename
     LOG(INFO) << "DexFile_isDexOptNeeded cache file " << cache_location
               << " is up-to-date for " << filename.c_str();
   }
+  if (have_stamp) {
+    WriteDexOptStamp(cache_location, stamp);
+  }
   return JNI_FALSE;
 }
 
@@ -61,6 +61,8 @@ static void VMRuntime_startJitCompilation(JNIEnv*, jobject) {
 static void VMRuntime_disableJitCompilation(JNIEnv*, jobject) {
 }
 
+// Arrays of primitives whose data keeps its address for as long as they live, for native code to
+// read and write in place with the addressOf below, as direct buffers do.
 static jobject VMRuntime_newNonMovableArray(JNIEnv* env, jobject, jclass javaElementClass, jint length) {
   ScopedObjectAccess soa(env);
 #ifdef MOVING_GARBAGE_COLLECTOR
@@ -75,6 +77,10 @@ static jobject VMRuntime_newNonMovableArray(JNIEnv* env, jobject, jclass javaEle
     ThrowNullPointerException(NULL, "element class == null");
     return NULL;
   }
+  if (!element_class->IsPrimitive() || element_class->IsPrimitiveVoid()) {
+    ThrowIllegalArgumentException(NULL, "not a primitive class");
+    return NULL;
+  }
   if (length < 0) {
     ThrowNegativeArraySizeException(length);
     return NULL;
@@ -99,7 +105,11 @@ static jlong VMRuntime_addressOf(JNIEnv* env, jobject, jobject javaArray) {
     ThrowIllegalArgumentException(NULL, "not an array");
     return 0;
   }
-  // TODO: we should also check that this is a non-movable array.
+  if (!array->GetClass()->GetComponentType()->IsPrimitive()) {
+    ThrowIllegalArgumentException(NULL, "not a primitive array");
+    return 0;
+  }
+  // TODO: we should also check that this is a non-movable array, once arrays may move.
   return reinterpret_cast<uintptr_t>(array->GetRawData(array->GetClass()->GetComponentSize()));
 }
 
@@ -176,11 +186,15 @@ static void VMRuntime_registerNativeFree(JNIEnv* env, jobject, jint bytes) {
   Runtime::Current()->GetHeap()->RegisterNativeFree(bytes);
 }
 
-static void VMRuntime_trimHeap(JNIEnv*, jobject) {
+static void VMRuntime_trimHeap(JNIEnv* env, jobject) {
+  Runtime::Current()->SetUpThreadScheduling(static_cast<JNIEnvExt*>(env)->self,
+                                            Runtime::kGcThreads);
   uint64_t start_ns = NanoTime();
 
-  // Trim the managed heap.
+  // Point equal strings at the same array, for the next collection to free the others, then trim
+  // the managed heap.
   gc::Heap* heap = Runtime::Current()->GetHeap();
+  heap->DeduplicateStrings(Thread::Current());
   gc::space::DlMallocSpace* alloc_space = heap->GetAllocSpace();
   size_t alloc_space_size = alloc_space->Size();
   float managed_utilization =
@@ -205,6 +219,7 @@ static void VMRuntime_trimHeap(JNIEnv*, jobject) {
 
 static void VMRuntime_concurrentGC(JNIEnv* env, jobject) {
   Thread* self = static_cast<JNIEnvExt*>(env)->self;
+  Runtime::Current()->SetUpThreadScheduling(self, Runtime::kGcThreads);
   Runtime::Current()->GetHeap()->ConcurrentGC(self);
 }
 
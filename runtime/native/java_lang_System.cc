@@ -319,7 +319,7 @@ static void System_arraycopy(JNIEnv* env, jclass, jobject javaSrc, jint srcPos,
 static jint System_identityHashCode(JNIEnv* env, jclass, jobject javaObject) {
   ScopedObjectAccess soa(env);
   mirror::Object* o = soa.Decode<mirror::Object*>(javaObject);
-  return static_cast<jint>(o->IdentityHashCode());
+  return (o == NULL) ? 0 : static_cast<jint>(o->IdentityHashCode());
 }
 
 static JNINativeMethod gMethods[] = {
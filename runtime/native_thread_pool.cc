@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "native_thread_pool.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+
+#ifdef HAVE_ANDROID_OS
+#include "cutils/sched_policy.h"
+#endif
+
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+NativeThreadPool::NativeThreadPool(uint64_t idle_timeout_ms)
+    : idle_timeout_ms_(idle_timeout_ms),
+      lock_("native thread pool lock"),
+      cond_("native thread pool condition", lock_),
+      num_threads_(0),
+      num_reuses_(0),
+      shutting_down_(false) {
+}
+
+NativeThreadPool::~NativeThreadPool() {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  shutting_down_ = true;
+  cond_.Broadcast(self);
+  while (num_threads_ != 0) {
+    cond_.Wait(self);
+  }
+}
+
+NativeThreadPool::Work NativeThreadPool::MakeWork(Function function, void* arg) {
+  Work work;
+  work.function = function;
+  work.arg = arg;
+  errno = 0;
+  work.priority = getpriority(PRIO_PROCESS, 0);
+  if (work.priority == -1 && errno != 0) {
+    PLOG(WARNING) << "getpriority failed";
+    work.priority = 0;
+  }
+#ifdef HAVE_ANDROID_OS
+  SchedPolicy sched_policy;
+  work.sched_policy = (get_sched_policy(0, &sched_policy) == 0) ? sched_policy : SP_DEFAULT;
+#endif
+  return work;
+}
+
+void NativeThreadPool::RunWork(const Work& work) {
+  // A new pthread inherits the priority of the thread creating it, a reused one gets it here.
+  if (setpriority(PRIO_PROCESS, 0, work.priority) != 0) {
+    PLOG(WARNING) << "setpriority(PRIO_PROCESS, 0, " << work.priority << ") failed";
+  }
+#ifdef HAVE_ANDROID_OS
+  set_sched_policy(GetTid(), static_cast<SchedPolicy>(work.sched_policy));
+#endif
+  work.function(work.arg);
+}
+
+int NativeThreadPool::Start(Function function, void* arg, size_t stack_size) {
+  Work work = MakeWork(function, arg);
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, lock_);
+    for (auto it = idle_threads_.begin(); it != idle_threads_.end(); ++it) {
+      IdleThread* idle_thread = *it;
+      if (idle_thread->stack_size == stack_size) {
+        idle_thread->work = work;
+        idle_thread->has_work = true;
+        idle_threads_.erase(it);
+        ++num_reuses_;
+        cond_.Broadcast(self);
+        return 0;
+      }
+    }
+    ++num_threads_;
+  }
+  NewThread* new_thread = new NewThread;
+  new_thread->pool = this;
+  new_thread->stack_size = stack_size;
+  new_thread->work = work;
+  pthread_t pthread;
+  pthread_attr_t attr;
+  CHECK_PTHREAD_CALL(pthread_attr_init, (&attr), "native thread pool thread");
+  CHECK_PTHREAD_CALL(pthread_attr_setdetachstate, (&attr, PTHREAD_CREATE_DETACHED),
+                     "PTHREAD_CREATE_DETACHED");
+  CHECK_PTHREAD_CALL(pthread_attr_setstacksize, (&attr, stack_size), stack_size);
+  int result = pthread_create(&pthread, &attr, &Run, new_thread);
+  CHECK_PTHREAD_CALL(pthread_attr_destroy, (&attr), "native thread pool thread");
+  if (result != 0) {
+    delete new_thread;
+    MutexLock mu(self, lock_);
+    --num_threads_;
+    cond_.Broadcast(self);
+  }
+  return result;
+}
+
+void* NativeThreadPool::Run(void* arg) {
+  NewThread* new_thread = reinterpret_cast<NewThread*>(arg);
+  NativeThreadPool* pool = new_thread->pool;
+  size_t stack_size = new_thread->stack_size;
+  Work work = new_thread->work;
+  delete new_thread;
+  do {
+    RunWork(work);
+  } while (pool->WaitForWork(stack_size, &work));
+  return NULL;
+}
+
+bool NativeThreadPool::WaitForWork(size_t stack_size, Work* work) {
+  // Work normally detaches its thread from the runtime before returning.
+  Thread* self = Thread::Current();
+  IdleThread idle_thread;
+  idle_thread.stack_size = stack_size;
+  idle_thread.has_work = false;
+  MutexLock mu(self, lock_);
+  if (!shutting_down_ && idle_threads_.size() < kMaxIdleThreads) {
+    idle_threads_.push_back(&idle_thread);
+    uint64_t deadline_ms = MilliTime() + idle_timeout_ms_;
+    while (!idle_thread.has_work && !shutting_down_) {
+      uint64_t now_ms = MilliTime();
+      if (now_ms >= deadline_ms) {
+        break;
+      }
+      cond_.TimedWait(self, deadline_ms - now_ms, 0);
+    }
+    if (idle_thread.has_work) {
+      *work = idle_thread.work;
+      return true;
+    }
+    idle_threads_.erase(std::find(idle_threads_.begin(), idle_threads_.end(), &idle_thread));
+  }
+  --num_threads_;
+  cond_.Broadcast(self);
+  return false;
+}
+
+size_t NativeThreadPool::GetIdleThreadCount() {
+  MutexLock mu(Thread::Current(), lock_);
+  return idle_threads_.size();
+}
+
+size_t NativeThreadPool::GetReuseCount() {
+  MutexLock mu(Thread::Current(), lock_);
+  return num_reuses_;
+}
+
+}  // namespace art
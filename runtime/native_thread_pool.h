@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_NATIVE_THREAD_POOL_H_
+#define ART_RUNTIME_NATIVE_THREAD_POOL_H_
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+// Runs functions on detached native threads. Once its function returns, a thread waits for
+// idle_timeout_ms to run the next function started with the same stack size before exiting, which
+// saves creating a pthread and mapping its stack for processes that start many short-lived
+// threads. A reused thread gets the priority of the thread starting it, as a new thread would, but
+// keeps the values of its pthread keys: their destructors only run once the thread exits.
+class NativeThreadPool {
+ public:
+  typedef void* (*Function)(void* arg);
+
+  static const uint64_t kDefaultIdleTimeoutMs = 2000;
+  static const size_t kMaxIdleThreads = 8;
+
+  explicit NativeThreadPool(uint64_t idle_timeout_ms);
+  // Waits for the threads, which must all be idle or about to be, to exit.
+  ~NativeThreadPool();
+
+  // Runs function with arg on an idle thread with a stack of stack_size bytes, or on a new thread
+  // if there's none. Returns 0, or the pthread_create error if the new thread couldn't be created.
+  int Start(Function function, void* arg, size_t stack_size) LOCKS_EXCLUDED(lock_);
+
+  size_t GetIdleThreadCount() LOCKS_EXCLUDED(lock_);
+  size_t GetReuseCount() LOCKS_EXCLUDED(lock_);
+
+ private:
+  struct Work {
+    Function function;
+    void* arg;
+    int priority;
+#ifdef HAVE_ANDROID_OS
+    int sched_policy;
+#endif
+  };
+
+  struct IdleThread {
+    size_t stack_size;
+    Work work;
+    bool has_work;
+  };
+
+  struct NewThread {
+    NativeThreadPool* pool;
+    size_t stack_size;
+    Work work;
+  };
+
+  static void* Run(void* arg);
+  static Work MakeWork(Function function, void* arg);
+  static void RunWork(const Work& work);
+
+  // Returns false if no work came before the idle timeout.
+  bool WaitForWork(size_t stack_size, Work* work) LOCKS_EXCLUDED(lock_);
+
+  const uint64_t idle_timeout_ms_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable cond_ GUARDED_BY(lock_);
+  std::vector<IdleThread*> idle_threads_ GUARDED_BY(lock_);
+  // All the threads of the pool, idle or running work.
+  size_t num_threads_ GUARDED_BY(lock_);
+  size_t num_reuses_ GUARDED_BY(lock_);
+  bool shutting_down_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(NativeThreadPool);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_NATIVE_THREAD_POOL_H_
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "native_thread_pool.h"
+
+#include <sched.h>
+
+#include "atomic_integer.h"
+#include "common_test.h"
+#include "utils.h"
+
+namespace art {
+
+class NativeThreadPoolTest : public CommonTest {};
+
+struct StartLatency {
+  uint64_t start_ns;
+  uint64_t latency_ns;
+  AtomicInteger done;
+};
+
+static void* RecordLatency(void* arg) {
+  StartLatency* latency = reinterpret_cast<StartLatency*>(arg);
+  latency->latency_ns = NanoTime() - latency->start_ns;
+  ++latency->done;
+  return NULL;
+}
+
+static void WaitForIdleThreads(NativeThreadPool* pool, size_t count) {
+  while (pool->GetIdleThreadCount() != count) {
+    sched_yield();
+  }
+}
+
+// Starts count functions one after the other, each once the previous one's thread is idle, and
+// returns their mean start latency.
+static uint64_t MeasureStartLatency(NativeThreadPool* pool, size_t count, size_t idle_threads) {
+  uint64_t total_ns = 0;
+  for (size_t i = 0; i < count; ++i) {
+    StartLatency latency;
+    latency.start_ns = NanoTime();
+    latency.done = 0;
+    CHECK_EQ(0, pool->Start(RecordLatency, &latency, 256 * KB));
+    while (latency.done == 0) {
+      sched_yield();
+    }
+    total_ns += latency.latency_ns;
+    WaitForIdleThreads(pool, idle_threads);
+  }
+  return total_ns / count;
+}
+
+TEST_F(NativeThreadPoolTest, ReusesIdleThreads) {
+  NativeThreadPool pool(60 * 1000);
+  MeasureStartLatency(&pool, 10, 1);
+  EXPECT_EQ(9U, pool.GetReuseCount());
+  // Threads with another stack size aren't reused.
+  StartLatency latency;
+  latency.start_ns = NanoTime();
+  latency.done = 0;
+  ASSERT_EQ(0, pool.Start(RecordLatency, &latency, 512 * KB));
+  WaitForIdleThreads(&pool, 2);
+  EXPECT_EQ(9U, pool.GetReuseCount());
+}
+
+TEST_F(NativeThreadPoolTest, IdleThreadsExit) {
+  NativeThreadPool pool(0);
+  MeasureStartLatency(&pool, 10, 0);
+  EXPECT_EQ(0U, pool.GetReuseCount());
+}
+
+// Not a check, logs how long a new thread and a reused one take to start running.
+TEST_F(NativeThreadPoolTest, StartLatencyBenchmark) {
+  const size_t kIterations = 200;
+  NativeThreadPool new_threads(0);
+  uint64_t new_thread_ns = MeasureStartLatency(&new_threads, kIterations, 0);
+  NativeThreadPool reused_threads(60 * 1000);
+  uint64_t reused_thread_ns = MeasureStartLatency(&reused_threads, kIterations, 1);
+  LOG(INFO) << "Thread start latency: " << PrettyDuration(new_thread_ns) << " new, "
+            << PrettyDuration(reused_thread_ns) << " reused";
+}
+
+}  // namespace art
@@ -22,7 +22,7 @@
 namespace art {
 
 const uint8_t OatHeader::kOatMagic[] = { 'o', 'a', 't', '\n' };
-const uint8_t OatHeader::kOatVersion[] = { '0', '0', '8', '\0' };
+const uint8_t OatHeader::kOatVersion[] = { '0', '1', '6', '\0' };
 
 OatHeader::OatHeader() {
   memset(this, 0, sizeof(*this));
@@ -64,6 +64,7 @@ OatHeader::OatHeader(InstructionSet instruction_set,
   portable_to_interpreter_bridge_offset_ = 0;
   quick_resolution_trampoline_offset_ = 0;
   quick_to_interpreter_bridge_offset_ = 0;
+  startup_size_ = 0;
 }
 
 bool OatHeader::IsValid() const {
@@ -114,6 +115,19 @@ void OatHeader::SetExecutableOffset(uint32_t executable_offset) {
   UpdateChecksum(&executable_offset_, sizeof(executable_offset));
 }
 
+uint32_t OatHeader::GetStartupSize() const {
+  DCHECK(IsValid());
+  return startup_size_;
+}
+
+void OatHeader::SetStartupSize(uint32_t startup_size) {
+  DCHECK(IsValid());
+  DCHECK_EQ(startup_size_, 0U);
+
+  startup_size_ = startup_size;
+  UpdateChecksum(&startup_size_, sizeof(startup_size));
+}
+
 const void* OatHeader::GetInterpreterToInterpreterBridge() const {
   return reinterpret_cast<const uint8_t*>(this) + GetInterpreterToInterpreterBridgeOffset();
 }
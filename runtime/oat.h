@@ -48,6 +48,12 @@ class PACKED(4) OatHeader {
   uint32_t GetExecutableOffset() const;
   void SetExecutableOffset(uint32_t executable_offset);
 
+  // Size of the prefix of the oat data that is expected to be touched during startup, 0 if
+  // unknown. Only set when the code was laid out from a profile, the prefix then covers the
+  // tables and the code of the profiled methods.
+  uint32_t GetStartupSize() const;
+  void SetStartupSize(uint32_t startup_size);
+
   const void* GetInterpreterToInterpreterBridge() const;
   uint32_t GetInterpreterToInterpreterBridgeOffset() const;
   void SetInterpreterToInterpreterBridgeOffset(uint32_t offset);
@@ -95,6 +101,7 @@ class PACKED(4) OatHeader {
   uint32_t portable_to_interpreter_bridge_offset_;
   uint32_t quick_resolution_trampoline_offset_;
   uint32_t quick_to_interpreter_bridge_offset_;
+  uint32_t startup_size_;
 
   uint32_t image_file_location_oat_checksum_;
   uint32_t image_file_location_oat_data_begin_;
@@ -127,6 +134,41 @@ class PACKED(4) OatMethodOffsets {
   uint32_t gc_map_offset_;
 };
 
+// How the OatMethodOffsets of a class are stored after its status, type and, for classes with
+// kStatusRetryVerificationAtRuntime, verification dependencies. Most classes have all or none of
+// their methods compiled, only the rest pay for a bitmap of the compiled methods.
+enum OatClassType {
+  kOatClassAllCompiled = 0,   // An OatMethodOffsets for every method of the class follows.
+  kOatClassSomeCompiled = 1,  // The bitmap size, a bitmap of the compiled methods and their
+                              // OatMethodOffsets follow.
+  kOatClassNoneCompiled = 2,  // Nothing follows, all methods are interpreted.
+  kOatClassMax = 3,
+};
+
+std::ostream& operator<<(std::ostream& os, const OatClassType& rhs);
+
+// A class that failed verification at compile time only because of classes that didn't resolve
+// or weren't accessible records the type indices of the classes that didn't resolve, preceded by
+// their count. Runtime verification can't fail differently while they still don't resolve. This
+// is stored instead of the count when the class has to be verified again.
+static const uint32_t kOatClassUnknownVerificationDependencies = 0xFFFFFFFF;
+
+// The dex cache entries an OatDexFile of an app oat file pre-resolves to objects of the boot image
+// it was compiled against. Each kind is stored as a count followed by that many pairs of dex index
+// and object address, after the OatClass offsets.
+enum OatDexCacheEntryKind {
+  kOatDexCacheStrings = 0,
+  kOatDexCacheTypes = 1,
+  kOatDexCacheMethods = 2,
+  kOatDexCacheEntryKinds = 3,
+};
+
+// An OatDexFile of an app oat file also records a hash of the code item and of what the compiler
+// resolved for each method it compiled, so that compiling a new version of the app can keep the
+// code of the methods whose hash didn't change. They are stored as a count followed by that many
+// triples of method index and low and high word of the hash, by method index, after the dex cache
+// entries.
+
 }  // namespace art
 
 #endif  // ART_RUNTIME_OAT_H_
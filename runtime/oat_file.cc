@@ -17,6 +17,7 @@
 #include "oat_file.h"
 
 #include <dlfcn.h>
+#include <sys/mman.h>
 
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
@@ -300,11 +301,39 @@ bool OatFile::Setup() {
       return false;
     }
 
+    const uint32_t* dex_cache_entries_pointer = reinterpret_cast<const uint32_t*>(oat);
+    for (size_t kind = 0; kind < kOatDexCacheEntryKinds; ++kind) {
+      const byte* entries_end = oat + sizeof(uint32_t);
+      if (entries_end <= End()) {
+        entries_end += 2 * sizeof(uint32_t) * *reinterpret_cast<const uint32_t*>(oat);
+      }
+      oat = entries_end;
+      if (oat > End()) {
+        LOG(ERROR) << "In oat file " << GetLocation() << " found OatDexFile # " << i
+                   << " for "<< dex_file_location
+                   << " with truncated dex cache entries";
+        return false;
+      }
+    }
+
+    const byte* hashes_end = oat + sizeof(uint32_t);
+    if (hashes_end <= End()) {
+      hashes_end += 3 * sizeof(uint32_t) * *reinterpret_cast<const uint32_t*>(oat);
+    }
+    oat = hashes_end;
+    if (oat > End()) {
+      LOG(ERROR) << "In oat file " << GetLocation() << " found OatDexFile # " << i
+                 << " for "<< dex_file_location
+                 << " with truncated method dependency hashes";
+      return false;
+    }
+
     oat_dex_files_.Put(dex_file_location, new OatDexFile(this,
                                                          dex_file_location,
                                                          dex_file_checksum,
                                                          dex_file_pointer,
-                                                         methods_offsets_pointer));
+                                                         methods_offsets_pointer,
+                                                         dex_cache_entries_pointer));
   }
   return true;
 }
@@ -323,6 +352,23 @@ const byte* OatFile::End() const {
   return end_;
 }
 
+void OatFile::AdviseStartupPages() const {
+  size_t startup_size = std::min<size_t>(GetOatHeader().GetStartupSize(), Size());
+  if (startup_size == 0) {
+    return;
+  }
+  byte* begin = reinterpret_cast<byte*>(RoundDown(reinterpret_cast<uintptr_t>(Begin()),
+                                                  kPageSize));
+  byte* end = reinterpret_cast<byte*>(RoundUp(reinterpret_cast<uintptr_t>(Begin() + startup_size),
+                                              kPageSize));
+  if (madvise(begin, end - begin, MADV_WILLNEED) != 0) {
+    PLOG(WARNING) << "Failed to madvise startup pages of " << GetLocation();
+    return;
+  }
+  VLOG(startup) << "Advised " << PrettySize(end - begin) << " of startup pages of "
+                << GetLocation();
+}
+
 const OatFile::OatDexFile* OatFile::GetOatDexFile(const std::string& dex_location,
                                                   const uint32_t* const dex_location_checksum,
                                                   bool warn_if_not_found) const {
@@ -360,12 +406,21 @@ OatFile::OatDexFile::OatDexFile(const OatFile* oat_file,
                                 const std::string& dex_file_location,
                                 uint32_t dex_file_location_checksum,
                                 const byte* dex_file_pointer,
-                                const uint32_t* oat_class_offsets_pointer)
+                                const uint32_t* oat_class_offsets_pointer,
+                                const uint32_t* dex_cache_entries_pointer)
     : oat_file_(oat_file),
       dex_file_location_(dex_file_location),
       dex_file_location_checksum_(dex_file_location_checksum),
       dex_file_pointer_(dex_file_pointer),
-      oat_class_offsets_pointer_(oat_class_offsets_pointer) {}
+      oat_class_offsets_pointer_(oat_class_offsets_pointer) {
+  // The kinds follow each other, Setup checked that they are all within the oat file.
+  const uint32_t* entries = dex_cache_entries_pointer;
+  for (size_t kind = 0; kind < kOatDexCacheEntryKinds; ++kind) {
+    dex_cache_entries_[kind] = entries;
+    entries += 1 + 2 * entries[0];
+  }
+  method_dependency_hashes_ = entries;
+}
 
 OatFile::OatDexFile::~OatDexFile() {}
 
@@ -378,25 +433,77 @@ const DexFile* OatFile::OatDexFile::OpenDexFile() const {
                        dex_file_location_checksum_);
 }
 
+bool OatFile::OatDexFile::FindMethodDependencyHash(uint32_t method_idx, uint64_t* hash) const {
+  const uint32_t* hashes = method_dependency_hashes_ + 1;
+  uint32_t lo = 0;
+  uint32_t hi = method_dependency_hashes_[0];
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (hashes[3 * mid] < method_idx) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == method_dependency_hashes_[0] || hashes[3 * lo] != method_idx) {
+    return false;
+  }
+  *hash = hashes[3 * lo + 1] | (static_cast<uint64_t>(hashes[3 * lo + 2]) << 32);
+  return true;
+}
+
 const OatFile::OatClass* OatFile::OatDexFile::GetOatClass(uint16_t class_def_index) const {
   uint32_t oat_class_offset = oat_class_offsets_pointer_[class_def_index];
 
   const byte* oat_class_pointer = oat_file_->Begin() + oat_class_offset;
   CHECK_LT(oat_class_pointer, oat_file_->End()) << oat_file_->GetLocation();
-  mirror::Class::Status status = *reinterpret_cast<const mirror::Class::Status*>(oat_class_pointer);
-
-  const byte* methods_pointer = oat_class_pointer + sizeof(status);
-  CHECK_LT(methods_pointer, oat_file_->End()) << oat_file_->GetLocation();
+  const byte* status_pointer = oat_class_pointer;
+  mirror::Class::Status status =
+      static_cast<mirror::Class::Status>(*reinterpret_cast<const int16_t*>(status_pointer));
+  CHECK_LE(status, mirror::Class::kStatusInitialized) << oat_file_->GetLocation();
+
+  const byte* type_pointer = status_pointer + sizeof(int16_t);
+  OatClassType type = static_cast<OatClassType>(*reinterpret_cast<const uint16_t*>(type_pointer));
+  CHECK_LT(type, kOatClassMax) << oat_file_->GetLocation();
+
+  const byte* after_type_pointer = type_pointer + sizeof(uint16_t);
+  const uint32_t* unresolved_types_pointer = NULL;
+  if (status == mirror::Class::kStatusRetryVerificationAtRuntime) {
+    unresolved_types_pointer = reinterpret_cast<const uint32_t*>(after_type_pointer);
+    uint32_t unresolved_types_count = *unresolved_types_pointer;
+    after_type_pointer += sizeof(unresolved_types_count);
+    if (unresolved_types_count != kOatClassUnknownVerificationDependencies) {
+      after_type_pointer += unresolved_types_count * sizeof(uint32_t);
+    }
+  }
+  const uint32_t* bitmap_pointer = NULL;
+  const byte* methods_pointer = after_type_pointer;
+  if (type == kOatClassSomeCompiled) {
+    uint32_t bitmap_size = *reinterpret_cast<const uint32_t*>(after_type_pointer);
+    bitmap_pointer = reinterpret_cast<const uint32_t*>(after_type_pointer + sizeof(bitmap_size));
+    methods_pointer = reinterpret_cast<const byte*>(bitmap_pointer) + bitmap_size;
+  }
+  CHECK_LE(methods_pointer, oat_file_->End()) << oat_file_->GetLocation();
 
   return new OatClass(oat_file_,
                       status,
+                      type,
+                      unresolved_types_pointer,
+                      bitmap_pointer,
                       reinterpret_cast<const OatMethodOffsets*>(methods_pointer));
 }
 
 OatFile::OatClass::OatClass(const OatFile* oat_file,
                             mirror::Class::Status status,
+                            OatClassType type,
+                            const uint32_t* unresolved_types_pointer,
+                            const uint32_t* bitmap_pointer,
                             const OatMethodOffsets* methods_pointer)
-    : oat_file_(oat_file), status_(status), methods_pointer_(methods_pointer) {}
+    : oat_file_(oat_file), status_(status), type_(type),
+      unresolved_types_(unresolved_types_pointer), bitmap_(bitmap_pointer),
+      methods_pointer_(methods_pointer) {
+  DCHECK_EQ(bitmap_ != NULL, type_ == kOatClassSomeCompiled);
+}
 
 OatFile::OatClass::~OatClass() {}
 
@@ -404,17 +511,59 @@ mirror::Class::Status OatFile::OatClass::GetStatus() const {
   return status_;
 }
 
+OatClassType OatFile::OatClass::GetType() const {
+  return type_;
+}
+
+bool OatFile::OatClass::GetVerificationDependencies(std::vector<uint16_t>* type_indices) const {
+  if (unresolved_types_ == NULL ||
+      unresolved_types_[0] == kOatClassUnknownVerificationDependencies) {
+    return false;
+  }
+  type_indices->assign(&unresolved_types_[1], &unresolved_types_[1] + unresolved_types_[0]);
+  return true;
+}
+
+const OatMethodOffsets* OatFile::OatClass::GetOatMethodOffsets(uint32_t method_index) const {
+  switch (type_) {
+    case kOatClassAllCompiled:
+      return &methods_pointer_[method_index];
+    case kOatClassNoneCompiled:
+      return NULL;
+    case kOatClassSomeCompiled: {
+      const size_t word_index = method_index / 32;
+      const uint32_t mask = 1U << (method_index % 32);
+      if ((bitmap_[word_index] & mask) == 0) {
+        return NULL;
+      }
+      // Only compiled methods have offsets, count the ones before this method.
+      size_t offsets_index = __builtin_popcount(bitmap_[word_index] & (mask - 1));
+      for (size_t i = 0; i < word_index; ++i) {
+        offsets_index += __builtin_popcount(bitmap_[i]);
+      }
+      return &methods_pointer_[offsets_index];
+    }
+    default:
+      LOG(FATAL) << "Unknown oat class type " << type_;
+      return NULL;
+  }
+}
+
 const OatFile::OatMethod OatFile::OatClass::GetOatMethod(uint32_t method_index) const {
-  const OatMethodOffsets& oat_method_offsets = methods_pointer_[method_index];
+  const OatMethodOffsets* oat_method_offsets = GetOatMethodOffsets(method_index);
+  if (oat_method_offsets == NULL) {
+    // What OatWriter used to write for methods without code.
+    return OatMethod(oat_file_->Begin(), 0, kStackAlignment, 0, 0, 0, 0, 0);
+  }
   return OatMethod(
       oat_file_->Begin(),
-      oat_method_offsets.code_offset_,
-      oat_method_offsets.frame_size_in_bytes_,
-      oat_method_offsets.core_spill_mask_,
-      oat_method_offsets.fp_spill_mask_,
-      oat_method_offsets.mapping_table_offset_,
-      oat_method_offsets.vmap_table_offset_,
-      oat_method_offsets.gc_map_offset_);
+      oat_method_offsets->code_offset_,
+      oat_method_offsets->frame_size_in_bytes_,
+      oat_method_offsets->core_spill_mask_,
+      oat_method_offsets->fp_spill_mask_,
+      oat_method_offsets->mapping_table_offset_,
+      oat_method_offsets->vmap_table_offset_,
+      oat_method_offsets->gc_map_offset_);
 }
 
 OatFile::OatMethod::OatMethod(const byte* base,
@@ -145,6 +145,12 @@ class OatFile {
    public:
     mirror::Class::Status GetStatus() const;
 
+    OatClassType GetType() const;
+
+    // Returns true if verification of this kStatusRetryVerificationAtRuntime class can be
+    // skipped as long as the classes of type_indices still fail to resolve.
+    bool GetVerificationDependencies(std::vector<uint16_t>* type_indices) const;
+
     // get the OatMethod entry based on its index into the class
     // defintion. direct methods come first, followed by virtual
     // methods. note that runtime created methods such as miranda
@@ -155,10 +161,21 @@ class OatFile {
    private:
     OatClass(const OatFile* oat_file,
              mirror::Class::Status status,
+             OatClassType type,
+             const uint32_t* unresolved_types_pointer,
+             const uint32_t* bitmap_pointer,
              const OatMethodOffsets* methods_pointer);
 
+    // Returns the OatMethodOffsets of the method, NULL if the method wasn't compiled.
+    const OatMethodOffsets* GetOatMethodOffsets(uint32_t method_index) const;
+
     const OatFile* oat_file_;
     const mirror::Class::Status status_;
+    const OatClassType type_;
+    // Count followed by type indices, only for kStatusRetryVerificationAtRuntime.
+    const uint32_t* unresolved_types_;
+    // Bit per method set if the method was compiled, only for kOatClassSomeCompiled.
+    const uint32_t* bitmap_;
     const OatMethodOffsets* methods_pointer_;
 
     friend class OatDexFile;
@@ -185,6 +202,22 @@ class OatFile {
     // Returns the OatClass for the class specified by the given DexFile class_def_index.
     const OatClass* GetOatClass(uint16_t class_def_index) const;
 
+    // Returns the number of dex cache entries of the given kind that were resolved to boot image
+    // objects, and points *entries at their pairs of dex index and object address. Only valid
+    // while the boot image the oat file was compiled against is mapped at its original address.
+    uint32_t GetDexCacheEntries(OatDexCacheEntryKind kind, const uint32_t** entries) const {
+      *entries = dex_cache_entries_[kind] + 1;
+      return dex_cache_entries_[kind][0];
+    }
+
+    uint32_t NumMethodDependencyHashes() const {
+      return method_dependency_hashes_[0];
+    }
+
+    // Sets *hash to the dependency hash recorded for the compiled method, returns false if there
+    // is none.
+    bool FindMethodDependencyHash(uint32_t method_idx, uint64_t* hash) const;
+
     ~OatDexFile();
 
    private:
@@ -192,13 +225,18 @@ class OatFile {
                const std::string& dex_file_location,
                uint32_t dex_file_checksum,
                const byte* dex_file_pointer,
-               const uint32_t* oat_class_offsets_pointer);
+               const uint32_t* oat_class_offsets_pointer,
+               const uint32_t* dex_cache_entries_pointer);
 
     const OatFile* oat_file_;
     std::string dex_file_location_;
     uint32_t dex_file_location_checksum_;
     const byte* dex_file_pointer_;
     const uint32_t* oat_class_offsets_pointer_;
+    // The count of each kind of dex cache entries, followed by the entries.
+    const uint32_t* dex_cache_entries_[kOatDexCacheEntryKinds];
+    // The count of method dependency hashes, followed by the hashes.
+    const uint32_t* method_dependency_hashes_;
 
     friend class OatFile;
     DISALLOW_COPY_AND_ASSIGN(OatDexFile);
@@ -214,6 +252,10 @@ class OatFile {
     return End() - Begin();
   }
 
+  // Asks the kernel to read in the pages recorded as touched during startup, see
+  // OatHeader::GetStartupSize. This may wait for I/O, so call it from a background thread.
+  void AdviseStartupPages() const;
+
  private:
   static void CheckLocation(const std::string& location);
 
@@ -47,14 +47,15 @@ void ReferenceTable::Add(const mirror::Object* obj) {
   entries_.push_back(obj);
 }
 
-void ReferenceTable::Remove(const mirror::Object* obj) {
+bool ReferenceTable::Remove(const mirror::Object* obj) {
   // We iterate backwards on the assumption that references are LIFO.
   for (int i = entries_.size() - 1; i >= 0; --i) {
     if (entries_[i] == obj) {
       entries_.erase(entries_.begin() + i);
-      return;
+      return true;
     }
   }
+  return false;
 }
 
 // If "obj" is an array, return the number of elements in the array.
@@ -85,7 +86,7 @@ struct ObjectComparator {
 
     // Sort by class...
     if (obj1->GetClass() != obj2->GetClass()) {
-      return obj1->GetClass()->IdentityHashCode() < obj2->IdentityHashCode();
+      return obj1->GetClass() < obj2->GetClass();
     } else {
       // ...then by size...
       size_t count1 = obj1->SizeOf();
@@ -93,8 +94,8 @@ struct ObjectComparator {
       if (count1 != count2) {
         return count1 < count2;
       } else {
-        // ...and finally by identity hash code.
-        return obj1->IdentityHashCode() < obj2->IdentityHashCode();
+        // ...and finally by address, which unlike the identity hash code is there without locking.
+        return obj1 < obj2;
       }
     }
   }
@@ -41,7 +41,8 @@ class ReferenceTable {
 
   void Add(const mirror::Object* obj);
 
-  void Remove(const mirror::Object* obj);
+  // Returns false if obj isn't in the table.
+  bool Remove(const mirror::Object* obj);
 
   size_t Size() const;
 
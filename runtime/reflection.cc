@@ -16,6 +16,12 @@
 
 #include "reflection.h"
 
+#include <string.h>
+
+#include <vector>
+
+#include "base/mutex.h"
+#include "base/stl_util.h"
 #include "class_linker.h"
 #include "common_throws.h"
 #include "dex_file-inl.h"
@@ -28,15 +34,120 @@
 #include "mirror/object_array.h"
 #include "mirror/object_array-inl.h"
 #include "object_utils.h"
+#include "safe_map.h"
 #include "scoped_thread_state_change.h"
 #include "well_known_classes.h"
 
 namespace art {
 
+// How to marshal a reflective call to a method, worked out the first time the method is invoked
+// rather than on every Method.invoke.
+struct InvokePlan {
+  const char* shorty;
+  uint32_t shorty_len;
+  // The resolved parameter types. Classes don't move, and the dex cache of the method keeps
+  // these loaded as long as the method is.
+  std::vector<mirror::Class*> param_classes;
+  Primitive::Type return_type;
+};
+
+typedef SafeMap<const mirror::ArtMethod*, const InvokePlan*> InvokePlans;
+
+// Plans live as long as the methods they describe, see SweepInvokePlans.
+static Mutex gInvokePlansLock DEFAULT_MUTEX_ACQUIRED_AFTER("reflective invoke plans lock");
+static InvokePlans gInvokePlans GUARDED_BY(gInvokePlansLock);
+
+// Returns the plan for invoking m, or NULL with an exception pending if one of its parameter types
+// can't be resolved.
+static const InvokePlan* GetInvokePlan(Thread* self, mirror::ArtMethod* m)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  {
+    MutexLock mu(self, gInvokePlansLock);
+    InvokePlans::const_iterator it = gInvokePlans.find(m);
+    if (it != gInvokePlans.end()) {
+      return it->second;
+    }
+  }
+  // Resolving the parameter types may allocate and throw, so build the plan without the lock.
+  MethodHelper mh(m);
+  UniquePtr<InvokePlan> plan(new InvokePlan);
+  plan->shorty = mh.GetShorty();
+  plan->shorty_len = mh.GetShortyLength();
+  plan->return_type = Primitive::GetType(plan->shorty[0]);
+  const DexFile::TypeList* classes = mh.GetParameterTypeList();
+  uint32_t classes_size = classes == NULL ? 0 : classes->Size();
+  for (uint32_t i = 0; i < classes_size; ++i) {
+    mirror::Class* param_class = mh.GetClassFromTypeIdx(classes->GetTypeItem(i).type_idx_);
+    if (param_class == NULL) {
+      DCHECK(self->IsExceptionPending());
+      return NULL;
+    }
+    plan->param_classes.push_back(param_class);
+  }
+  MutexLock mu(self, gInvokePlansLock);
+  InvokePlans::const_iterator it = gInvokePlans.find(m);
+  if (it != gInvokePlans.end()) {
+    return it->second;  // Another thread got here first.
+  }
+  gInvokePlans.Put(m, plan.get());
+  return plan.release();
+}
+
+void ClearInvokePlans() {
+  MutexLock mu(Thread::Current(), gInvokePlansLock);
+  STLDeleteValues(&gInvokePlans);
+}
+
+void SweepInvokePlans(IsMarkedTester is_marked, void* arg) {
+  MutexLock mu(Thread::Current(), gInvokePlansLock);
+  for (InvokePlans::iterator it = gInvokePlans.begin(); it != gInvokePlans.end();) {
+    if (is_marked(it->first, arg)) {
+      ++it;
+    } else {
+      delete it->second;
+      gInvokePlans.erase(it++);
+    }
+  }
+}
+
+// Appends an unboxed argument of the type shorty_type to arg_array.
+static void AppendArgument(ArgArray& arg_array, char shorty_type, const JValue& value)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  switch (shorty_type) {
+    case 'Z':
+      arg_array.Append(value.GetZ());
+      break;
+    case 'B':
+      arg_array.Append(value.GetB());
+      break;
+    case 'C':
+      arg_array.Append(value.GetC());
+      break;
+    case 'S':
+      arg_array.Append(value.GetS());
+      break;
+    case 'I':
+    case 'F':
+      arg_array.Append(value.GetI());
+      break;
+    case 'L':
+      arg_array.Append(reinterpret_cast<int32_t>(value.GetL()));
+      break;
+    case 'D':
+    case 'J':
+      arg_array.AppendWide(value.GetJ());
+      break;
+    default:
+      LOG(FATAL) << "Unexpected shorty type " << shorty_type;
+  }
+}
+
 jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject javaReceiver,
                      jobject javaArgs) {
-  jmethodID mid = soa.Env()->FromReflectedMethod(javaMethod);
-  mirror::ArtMethod* m = soa.DecodeMethod(mid);
+  mirror::ArtField* art_method_field =
+      soa.DecodeField(WellKnownClasses::java_lang_reflect_AbstractMethod_artMethod);
+  mirror::ArtMethod* m =
+      art_method_field->GetObject(soa.Decode<mirror::Object*>(javaMethod))->AsArtMethod();
 
   mirror::Class* declaring_class = m->GetDeclaringClass();
   if (!Runtime::Current()->GetClassLinker()->EnsureInitialized(declaring_class, true, true)) {
@@ -53,15 +164,17 @@ jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject
 
     // Find the actual implementation of the virtual method.
     m = receiver->GetClass()->FindVirtualMethodForVirtualOrInterface(m);
-    mid = soa.EncodeMethod(m);
   }
 
-  // Get our arrays of arguments and their types, and check they're the same size.
+  const InvokePlan* plan = GetInvokePlan(soa.Self(), m);
+  if (plan == NULL) {
+    return NULL;
+  }
+
+  // Get our arrays of arguments and check it is the same size as the parameter list.
   mirror::ObjectArray<mirror::Object>* objects =
       soa.Decode<mirror::ObjectArray<mirror::Object>*>(javaArgs);
-  MethodHelper mh(m);
-  const DexFile::TypeList* classes = mh.GetParameterTypeList();
-  uint32_t classes_size = classes == NULL ? 0 : classes->Size();
+  uint32_t classes_size = plan->param_classes.size();
   uint32_t arg_count = (objects != NULL) ? objects->GetLength() : 0;
   if (arg_count != classes_size) {
     ThrowIllegalArgumentException(NULL,
@@ -70,22 +183,22 @@ jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject
     return NULL;
   }
 
-  // Translate javaArgs to a jvalue[].
-  UniquePtr<jvalue[]> args(new jvalue[arg_count]);
-  JValue* decoded_args = reinterpret_cast<JValue*>(args.get());
+  // Unbox javaArgs straight into the arguments of the call, no jvalue[] or local references.
+  ArgArray arg_array(plan->shorty, plan->shorty_len);
+  if (receiver != NULL) {
+    arg_array.Append(reinterpret_cast<int32_t>(receiver));
+  }
   for (uint32_t i = 0; i < arg_count; ++i) {
-    mirror::Object* arg = objects->Get(i);
-    mirror::Class* dst_class = mh.GetClassFromTypeIdx(classes->GetTypeItem(i).type_idx_);
-    if (!UnboxPrimitiveForArgument(arg, dst_class, decoded_args[i], m, i)) {
+    JValue unboxed_arg;
+    if (!UnboxPrimitiveForArgument(objects->Get(i), plan->param_classes[i], unboxed_arg, m, i)) {
       return NULL;
     }
-    if (!dst_class->IsPrimitive()) {
-      args[i].l = soa.AddLocalReference<jobject>(arg);
-    }
+    AppendArgument(arg_array, plan->shorty[i + 1], unboxed_arg);
   }
 
   // Invoke the method.
-  JValue value(InvokeWithJValues(soa, javaReceiver, mid, args.get()));
+  JValue value;
+  InvokeWithArgArray(soa, m, &arg_array, &value, plan->shorty[0]);
 
   // Wrap any exception with "Ljava/lang/reflect/InvocationTargetException;" and return early.
   if (soa.Self()->IsExceptionPending()) {
@@ -99,7 +212,7 @@ jobject InvokeMethod(const ScopedObjectAccess& soa, jobject javaMethod, jobject
   }
 
   // Box if necessary and return.
-  return soa.AddLocalReference<jobject>(BoxPrimitive(mh.GetReturnType()->GetPrimitiveType(), value));
+  return soa.AddLocalReference<jobject>(BoxPrimitive(plan->return_type, value));
 }
 
 bool VerifyObjectInClass(mirror::Object* o, mirror::Class* c) {
@@ -323,32 +436,32 @@ static bool UnboxPrimitive(const ThrowLocation* throw_location, mirror::Object*
   }
 
   JValue boxed_value;
-  std::string src_descriptor(ClassHelper(o->GetClass()).GetDescriptor());
+  const char* src_descriptor = ClassHelper(o->GetClass()).GetDescriptor();
   mirror::Class* src_class = NULL;
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   mirror::ArtField* primitive_field = o->GetClass()->GetIFields()->Get(0);
-  if (src_descriptor == "Ljava/lang/Boolean;") {
+  if (strcmp(src_descriptor, "Ljava/lang/Boolean;") == 0) {
     src_class = class_linker->FindPrimitiveClass('Z');
     boxed_value.SetZ(primitive_field->GetBoolean(o));
-  } else if (src_descriptor == "Ljava/lang/Byte;") {
+  } else if (strcmp(src_descriptor, "Ljava/lang/Byte;") == 0) {
     src_class = class_linker->FindPrimitiveClass('B');
     boxed_value.SetB(primitive_field->GetByte(o));
-  } else if (src_descriptor == "Ljava/lang/Character;") {
+  } else if (strcmp(src_descriptor, "Ljava/lang/Character;") == 0) {
     src_class = class_linker->FindPrimitiveClass('C');
     boxed_value.SetC(primitive_field->GetChar(o));
-  } else if (src_descriptor == "Ljava/lang/Float;") {
+  } else if (strcmp(src_descriptor, "Ljava/lang/Float;") == 0) {
     src_class = class_linker->FindPrimitiveClass('F');
     boxed_value.SetF(primitive_field->GetFloat(o));
-  } else if (src_descriptor == "Ljava/lang/Double;") {
+  } else if (strcmp(src_descriptor, "Ljava/lang/Double;") == 0) {
     src_class = class_linker->FindPrimitiveClass('D');
     boxed_value.SetD(primitive_field->GetDouble(o));
-  } else if (src_descriptor == "Ljava/lang/Integer;") {
+  } else if (strcmp(src_descriptor, "Ljava/lang/Integer;") == 0) {
     src_class = class_linker->FindPrimitiveClass('I');
     boxed_value.SetI(primitive_field->GetInt(o));
-  } else if (src_descriptor == "Ljava/lang/Long;") {
+  } else if (strcmp(src_descriptor, "Ljava/lang/Long;") == 0) {
     src_class = class_linker->FindPrimitiveClass('J');
     boxed_value.SetJ(primitive_field->GetLong(o));
-  } else if (src_descriptor == "Ljava/lang/Short;") {
+  } else if (strcmp(src_descriptor, "Ljava/lang/Short;") == 0) {
     src_class = class_linker->FindPrimitiveClass('S');
     boxed_value.SetS(primitive_field->GetShort(o));
   } else {
@@ -356,7 +469,7 @@ static bool UnboxPrimitive(const ThrowLocation* throw_location, mirror::Object*
                                   StringPrintf("%s has type %s, got %s",
                                                UnboxingFailureKind(m, index, f).c_str(),
                                                PrettyDescriptor(dst_class).c_str(),
-                                               PrettyDescriptor(src_descriptor.c_str()).c_str()).c_str());
+                                               PrettyDescriptor(src_descriptor).c_str()).c_str());
     return false;
   }
 
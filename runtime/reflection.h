@@ -19,6 +19,7 @@
 
 #include "jni.h"
 #include "primitive.h"
+#include "root_visitor.h"
 
 namespace art {
 namespace mirror {
@@ -51,6 +52,12 @@ bool ConvertPrimitiveValue(const ThrowLocation* throw_location, bool unbox_for_r
 jobject InvokeMethod(const ScopedObjectAccess& soa, jobject method, jobject receiver, jobject args)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+// Frees what InvokeMethod has cached about the methods it invoked.
+void ClearInvokePlans();
+
+// Frees what InvokeMethod has cached about the methods the GC didn't mark.
+void SweepInvokePlans(IsMarkedTester is_marked, void* arg);
+
 bool VerifyObjectInClass(mirror::Object* o, mirror::Class* c)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -20,6 +20,7 @@
 #include <sys/mount.h>
 #include <linux/fs.h>
 
+#include <sched.h>
 #include <signal.h>
 #include <sys/syscall.h>
 
@@ -28,20 +29,29 @@
 #include <limits>
 #include <vector>
 
+#include "allocation_profiler.h"
 #include "arch/arm/registers_arm.h"
 #include "arch/mips/registers_mips.h"
 #include "arch/x86/registers_x86.h"
 #include "atomic.h"
+#include "base/arena_allocator.h"
+#include "base/timing_logger.h"
+#include "catch_handler_cache.h"
 #include "class_linker.h"
 #include "debugger.h"
+#include "fault_handler.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/heap.h"
 #include "gc/space/space.h"
 #include "image.h"
+#include "inline_cache.h"
 #include "instrumentation.h"
 #include "intern_table.h"
 #include "invoke_arg_array_builder.h"
+#include "jit/jit.h"
 #include "jni_internal.h"
+#include "lock_profiler.h"
+#include "metrics.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/array.h"
@@ -49,14 +59,18 @@
 #include "mirror/class_loader.h"
 #include "mirror/throwable.h"
 #include "monitor.h"
+#include "native_thread_pool.h"
 #include "oat_file.h"
+#include "reflection.h"
 #include "ScopedLocalRef.h"
 #include "scoped_thread_state_change.h"
+#include "sampling_profiler.h"
 #include "signal_catcher.h"
 #include "signal_set.h"
 #include "sirt_ref.h"
 #include "thread.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "trace.h"
 #include "UniquePtr.h"
 #include "verifier/method_verifier.h"
@@ -78,8 +92,23 @@ Runtime::Runtime()
       monitor_list_(NULL),
       thread_list_(NULL),
       intern_table_(NULL),
+      arena_pool_(NULL),
+      inline_caches_(NULL),
+      catch_handler_cache_(NULL),
       class_linker_(NULL),
       signal_catcher_(NULL),
+      preload_oat_(false),
+      background_verification_(false),
+      dex_cache_field_slots_(0),
+      fork_heap_dumps_(false),
+      checkpoint_thread_dumps_(false),
+      preload_dex_caches_(false),
+      startup_timings_(false),
+      sampling_profiler_(NULL),
+      sampling_profile_period_ms_(0),
+      metrics_(NULL),
+      jit_(NULL),
+      native_thread_pool_(NULL),
       java_vm_(NULL),
       pre_allocated_OutOfMemoryError_(NULL),
       resolution_method_(NULL),
@@ -120,17 +149,26 @@ Runtime::~Runtime() {
   // Make sure to let the GC complete if it is running.
   heap_->WaitForConcurrentGcToComplete(self);
   heap_->DeleteThreadPool();
+  class_linker_->DeleteVerificationThreadPool();
 
   // Make sure our internal threads are dead before we start tearing down things they're using.
   Dbg::StopJdwp();
   delete signal_catcher_;
+  delete sampling_profiler_;
+  delete jit_;
+  delete metrics_;
 
   // Make sure all other non-daemon threads have terminated, and all daemon threads are suspended.
   delete thread_list_;
+  thread_list_ = NULL;  // Checked by Heap::DumpGcPerformanceInfo.
   delete monitor_list_;
+  ClearInvokePlans();
   delete class_linker_;
   delete heap_;
   delete intern_table_;
+  delete arena_pool_;
+  delete inline_caches_;
+  delete catch_handler_cache_;
   delete java_vm_;
   Thread::Shutdown();
   QuasiAtomic::Shutdown();
@@ -227,6 +265,15 @@ void Runtime::Abort() {
 }
 
 bool Runtime::PreZygoteFork() {
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    if (preload_dex_caches_) {
+      // Once, the zygote has loaded the classes it preloads by its first fork.
+      preload_dex_caches_ = false;
+      class_linker_->PreloadDexCaches();
+    }
+    class_linker_->RecordDexCachePages();
+  }
   heap_->PreZygoteFork();
   return true;
 }
@@ -319,6 +366,56 @@ size_t ParseIntegerOrDie(const std::string& s) {
   return result;
 }
 
+static const char* const kThreadClassNames[] = { "gc", "compiler", "signal-catcher", "jdwp" };
+
+// Parses the thread class of -Xthread-priority:<class>:<value> or -Xthread-cpus:<class>:<value>
+// and returns the value.
+static Runtime::ThreadClass ParseThreadClassOrDie(const std::string& option, std::string* value) {
+  COMPILE_ASSERT(arraysize(kThreadClassNames) == Runtime::kThreadClassCount,
+                 thread_class_names_mismatch);
+  std::string::size_type begin = option.find(':') + 1;
+  std::string::size_type colon = option.find(':', begin);
+  if (colon == std::string::npos) {
+    LOG(FATAL) << "Missing thread class: " << option;
+  }
+  std::string name(option.substr(begin, colon - begin));
+  *value = option.substr(colon + 1);
+  for (size_t i = 0; i < arraysize(kThreadClassNames); ++i) {
+    if (name == kThreadClassNames[i]) {
+      return static_cast<Runtime::ThreadClass>(i);
+    }
+  }
+  LOG(FATAL) << "Unknown thread class '" << name << "' in: " << option;
+  return Runtime::kGcThreads;
+}
+
+// Parses a list of CPUs such as "0-3,6".
+static std::vector<int> ParseCpuListOrDie(const std::string& option, const std::string& list) {
+  std::vector<int> cpus;
+  std::vector<std::string> ranges;
+  Split(list, ',', ranges);
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    const char* begin = ranges[i].c_str();
+    char* end;
+    long first = strtol(begin, &end, 10);  // NOLINT(runtime/int)
+    long last = first;  // NOLINT(runtime/int)
+    if (begin != end && *end == '-') {
+      begin = end + 1;
+      last = strtol(begin, &end, 10);
+    }
+    if (begin == end || *end != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+      LOG(FATAL) << "Failed to parse CPU list in: " << option;
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {  // NOLINT(runtime/int)
+      cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty()) {
+    LOG(FATAL) << "Empty CPU list in: " << option;
+  }
+  return cpus;
+}
+
 Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, bool ignore_unrecognized) {
   UniquePtr<ParsedOptions> parsed(new ParsedOptions());
   const char* boot_class_path_string = getenv("BOOTCLASSPATH");
@@ -331,6 +428,7 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   }
   // -Xcheck:jni is off by default for regular builds but on by default in debug builds.
   parsed->check_jni_ = kIsDebugBuild;
+  parsed->check_jni_lite_ = false;
 
   parsed->heap_initial_size_ = gc::Heap::kDefaultInitialSize;
   parsed->heap_maximum_size_ = gc::Heap::kDefaultMaximumSize;
@@ -354,8 +452,37 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   parsed->long_pause_log_threshold_ = gc::Heap::kDefaultLongPauseLogThreshold;
   parsed->long_gc_log_threshold_ = gc::Heap::kDefaultLongGCLogThreshold;
   parsed->ignore_max_footprint_ = false;
+  parsed->use_tlab_ = false;
+  parsed->use_rosalloc_ = false;
+  parsed->gc_pause_goal_ = 0;  // 0 means no goal.
+  parsed->gc_throughput_goal_ = 0;
+  parsed->pretenure_ = false;
+  parsed->deduplicate_strings_ = false;
+  parsed->class_unloading_ = false;
+  parsed->huge_pages_ = false;
+  parsed->verify_pre_gc_heap_ = false;
+  parsed->verify_post_gc_heap_ = false;
+  parsed->verify_missing_card_marks_ = false;
+  parsed->verify_sample_percent_ = 100;
+  parsed->track_instance_counts_ = false;
 
   parsed->lock_profiling_threshold_ = 0;
+  parsed->lock_profiler_ = false;
+  parsed->alloc_sample_bytes_ = 0;
+  parsed->preload_oat_ = false;
+  parsed->background_verification_ = false;
+  parsed->dex_cache_field_slots_ = 0;
+  parsed->fork_heap_dumps_ = false;
+  parsed->checkpoint_thread_dumps_ = false;
+  parsed->preload_dex_caches_ = false;
+  parsed->startup_timings_ = false;
+  parsed->use_jit_ = false;
+  parsed->jit_threshold_ = jit::Jit::kDefaultThreshold;
+  parsed->jit_code_cache_capacity_ = jit::JitCodeCache::kDefaultCapacity;
+  parsed->reuse_native_threads_ = false;
+  for (size_t i = 0; i < kThreadClassCount; ++i) {
+    parsed->thread_priorities_[i] = 0;
+  }
   parsed->hook_is_sensitive_thread_ = NULL;
 
   parsed->hook_vfprintf_ = vfprintf;
@@ -385,6 +512,9 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
   parsed->method_trace_ = false;
   parsed->method_trace_file_ = "/data/method-trace-file.bin";
   parsed->method_trace_file_size_ = 10 * MB;
+  parsed->method_trace_stream_ = false;
+  parsed->method_trace_filter_ = "";
+  parsed->sampling_profile_period_ms_ = 20;
 
   for (size_t i = 0; i < options.size(); ++i) {
     const std::string option(options[i].first);
@@ -408,8 +538,13 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
           = reinterpret_cast<const std::vector<const DexFile*>*>(options[i].second);
     } else if (StartsWith(option, "-Ximage:")) {
       parsed->image_ = option.substr(strlen("-Ximage:")).data();
+    } else if (option == "-Xcheck:jni:lite") {
+      // Only the checks cheap enough to leave on in production.
+      parsed->check_jni_ = true;
+      parsed->check_jni_lite_ = true;
     } else if (StartsWith(option, "-Xcheck:jni")) {
       parsed->check_jni_ = true;
+      parsed->check_jni_lite_ = false;
     } else if (StartsWith(option, "-Xrunjdwp:") || StartsWith(option, "-agentlib:jdwp=")) {
       std::string tail(option.substr(option[1] == 'X' ? 10 : 15));
       if (tail == "help" || !Dbg::ParseJdwpOptions(tail)) {
@@ -486,6 +621,33 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
         return NULL;
       }
       parsed->heap_target_utilization_ = value;
+    } else if (StartsWith(option, "-XX:GCPauseGoal=")) {
+      std::istringstream iss(option.substr(strlen("-XX:GCPauseGoal=")));
+      size_t value;
+      iss >> value;
+      // The goal is given in milliseconds.
+      if (!iss.eof() || value == 0) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        LOG(FATAL) << "Invalid option '" << option << "'";
+        return NULL;
+      }
+      parsed->gc_pause_goal_ = MsToNs(value);
+    } else if (StartsWith(option, "-XX:GCThroughputGoal=")) {
+      std::istringstream iss(option.substr(strlen("-XX:GCThroughputGoal=")));
+      double value;
+      iss >> value;
+      // The fraction of time left to the mutators, at least half of it and never all of it.
+      const bool sane_val = iss.eof() && (value >= 0.5) && (value <= 0.99);
+      if (!sane_val) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        LOG(FATAL) << "Invalid option '" << option << "'";
+        return NULL;
+      }
+      parsed->gc_throughput_goal_ = value;
     } else if (StartsWith(option, "-XX:ParallelGCThreads=")) {
       parsed->parallel_gc_threads_ =
           ParseMemoryOption(option.substr(strlen("-XX:ParallelGCThreads=")).c_str(), 1024);
@@ -513,6 +675,20 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
       parsed->ignore_max_footprint_ = true;
     } else if (option == "-XX:LowMemoryMode") {
       parsed->low_memory_mode_ = true;
+    } else if (option == "-XX:UseTLAB") {
+      parsed->use_tlab_ = true;
+    } else if (option == "-XX:UseRosAlloc") {
+      parsed->use_rosalloc_ = true;
+    } else if (option == "-XX:Pretenure") {
+      parsed->pretenure_ = true;
+    } else if (option == "-XX:DeduplicateStrings") {
+      parsed->deduplicate_strings_ = true;
+    } else if (option == "-XX:ClassUnloading") {
+      parsed->class_unloading_ = true;
+    } else if (option == "-XX:HugePages") {
+      parsed->huge_pages_ = true;
+    } else if (option == "-XX:TrackInstanceCounts") {
+      parsed->track_instance_counts_ = true;
     } else if (StartsWith(option, "-D")) {
       parsed->properties_.push_back(option.substr(strlen("-D")));
     } else if (StartsWith(option, "-Xjnitrace:")) {
@@ -531,6 +707,18 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
           parsed->is_concurrent_gc_enabled_ = false;
         } else if (gc_options[i] == "concurrent") {
           parsed->is_concurrent_gc_enabled_ = true;
+        } else if (gc_options[i] == "preverify") {
+          parsed->verify_pre_gc_heap_ = true;
+        } else if (gc_options[i] == "postverify") {
+          parsed->verify_post_gc_heap_ = true;
+        } else if (gc_options[i] == "verifycardtable") {
+          parsed->verify_missing_card_marks_ = true;
+        } else if (StartsWith(gc_options[i], "verifysample:")) {
+          // The percentage of objects the verification checks at each GC.
+          parsed->verify_sample_percent_ = ParseIntegerOrDie(gc_options[i]);
+          if (parsed->verify_sample_percent_ == 0 || parsed->verify_sample_percent_ > 100) {
+            LOG(FATAL) << "Invalid -Xgc option, expected a percentage: " << gc_options[i];
+          }
         } else {
           LOG(WARNING) << "Ignoring unknown -Xgc option: " << gc_options[i];
         }
@@ -571,6 +759,46 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
       // Silently ignored for backwards compatibility.
     } else if (StartsWith(option, "-Xlockprofthreshold:")) {
       parsed->lock_profiling_threshold_ = ParseIntegerOrDie(option);
+    } else if (option == "-Xlockprofiler") {
+      parsed->lock_profiler_ = true;
+    } else if (StartsWith(option, "-Xalloc-sample-bytes:")) {
+      parsed->alloc_sample_bytes_ = ParseIntegerOrDie(option);
+    } else if (option == "-Xpreload-oat") {
+      parsed->preload_oat_ = true;
+    } else if (option == "-Xbackground-verification") {
+      parsed->background_verification_ = true;
+    } else if (option == "-Xhprof-fork") {
+      parsed->fork_heap_dumps_ = true;
+    } else if (option == "-Xsigquit-checkpoint") {
+      parsed->checkpoint_thread_dumps_ = true;
+    } else if (option == "-Xpreload-dex-caches") {
+      parsed->preload_dex_caches_ = true;
+    } else if (option == "-Xstartup-timings") {
+      parsed->startup_timings_ = true;
+    } else if (option == "-Xreuse-native-threads") {
+      parsed->reuse_native_threads_ = true;
+    } else if (option == "-Xjit") {
+      parsed->use_jit_ = true;
+    } else if (StartsWith(option, "-Xjitthreshold:")) {
+      parsed->jit_threshold_ = ParseIntegerOrDie(option);
+      if (parsed->jit_threshold_ == 0) {
+        LOG(FATAL) << "Invalid JIT threshold: " << option;
+      }
+    } else if (StartsWith(option, "-Xjitcodecachesize:")) {
+      size_t size = ParseMemoryOption(option.substr(strlen("-Xjitcodecachesize:")).c_str(), 1024);
+      if (size == 0) {
+        if (ignore_unrecognized) {
+          continue;
+        }
+        LOG(FATAL) << "Failed to parse " << option;
+        return NULL;
+      }
+      parsed->jit_code_cache_capacity_ = size;
+    } else if (StartsWith(option, "-Xdexcache-field-slots:")) {
+      parsed->dex_cache_field_slots_ = ParseIntegerOrDie(option);
+      if (parsed->dex_cache_field_slots_ == 0) {
+        LOG(FATAL) << "Invalid dex cache field slot count: " << option;
+      }
     } else if (StartsWith(option, "-Xstacktracefile:")) {
       parsed->stack_trace_file_ = option.substr(strlen("-Xstacktracefile:"));
     } else if (option == "sensitiveThread") {
@@ -592,12 +820,41 @@ Runtime::ParsedOptions* Runtime::ParsedOptions::Create(const Options& options, b
       parsed->method_trace_file_ = option.substr(strlen("-Xmethod-trace-file:"));
     } else if (StartsWith(option, "-Xmethod-trace-file-size:")) {
       parsed->method_trace_file_size_ = ParseIntegerOrDie(option);
+    } else if (option == "-Xmethod-trace-stream") {
+      parsed->method_trace_stream_ = true;
+    } else if (StartsWith(option, "-Xmethod-trace-filter:")) {
+      parsed->method_trace_filter_ = option.substr(strlen("-Xmethod-trace-filter:"));
+    } else if (StartsWith(option, "-Xsampling-profile-dir:")) {
+      parsed->sampling_profile_dir_ = option.substr(strlen("-Xsampling-profile-dir:"));
+    } else if (StartsWith(option, "-Xsampling-profile-period-ms:")) {
+      parsed->sampling_profile_period_ms_ = ParseIntegerOrDie(option);
+      if (parsed->sampling_profile_period_ms_ == 0) {
+        LOG(FATAL) << "Invalid sampling profile period: " << option;
+      }
+    } else if (StartsWith(option, "-Xmetrics:")) {
+      parsed->metrics_dir_ = option.substr(strlen("-Xmetrics:"));
+    } else if (StartsWith(option, "-Xthread-priority:")) {
+      std::string value;
+      ThreadClass thread_class = ParseThreadClassOrDie(option, &value);
+      char* end;
+      long priority = strtol(value.c_str(), &end, 10);  // NOLINT(runtime/int)
+      if (value.empty() || *end != '\0' || priority < kMinThreadPriority ||
+          priority > kMaxThreadPriority) {
+        LOG(FATAL) << "Invalid thread priority in: " << option;
+      }
+      parsed->thread_priorities_[thread_class] = priority;
+    } else if (StartsWith(option, "-Xthread-cpus:")) {
+      std::string value;
+      ThreadClass thread_class = ParseThreadClassOrDie(option, &value);
+      parsed->thread_cpus_[thread_class] = ParseCpuListOrDie(option, value);
     } else if (option == "-Xprofile:threadcpuclock") {
       Trace::SetDefaultClockSource(kProfilerClockSourceThreadCpu);
     } else if (option == "-Xprofile:wallclock") {
       Trace::SetDefaultClockSource(kProfilerClockSourceWall);
     } else if (option == "-Xprofile:dualclock") {
       Trace::SetDefaultClockSource(kProfilerClockSourceDual);
+    } else if (option == "-Xprofile:cycleclock") {
+      Trace::SetDefaultClockSource(kProfilerClockSourceCycles);
     } else if (option == "-compiler-filter:interpret-only") {
       parsed->compiler_filter_ = kInterpretOnly;
     } else if (option == "-compiler-filter:space") {
@@ -709,6 +966,7 @@ bool Runtime::Start() {
   VLOG(startup) << "Runtime::Start entering";
 
   CHECK(host_prefix_.empty()) << host_prefix_;
+  base::TimingLogger timings("Runtime::Start", true, false);
 
   // Restore main thread state to kNative as expected by native code.
   Thread* self = Thread::Current();
@@ -716,15 +974,21 @@ bool Runtime::Start() {
 
   started_ = true;
 
+  // Get the startup pages of the oat files read in while the rest of startup runs.
+  StartOatPreload();
+
   // InitNativeMethods needs to be after started_ so that the classes
   // it touches will have methods linked to the oat file if necessary.
+  timings.StartSplit("Native methods");
   InitNativeMethods();
 
   // Initialize well known thread group values that may be accessed threads while attaching.
+  timings.NewSplit("Thread groups");
   InitThreadGroups(self);
 
   Thread::FinishStartup();
 
+  timings.NewSplit(is_zygote_ ? "Zygote" : "Runtime threads");
   if (is_zygote_) {
     if (!InitZygote()) {
       return false;
@@ -733,12 +997,19 @@ bool Runtime::Start() {
     DidForkFromZygote();
   }
 
+  timings.NewSplit("Daemon threads");
   StartDaemonThreads();
 
+  timings.NewSplit("System class loader");
   system_class_loader_ = CreateSystemClassLoader();
 
   self->GetJniEnv()->locals.AssertEmpty();
 
+  timings.EndSplit();
+  if (startup_timings_) {
+    LOG(INFO) << Dumpable<base::TimingLogger>(timings);
+  }
+
   VLOG(startup) << "Runtime::Start exiting";
 
   finished_starting_ = true;
@@ -791,10 +1062,20 @@ bool Runtime::InitZygote() {
 void Runtime::DidForkFromZygote() {
   is_zygote_ = false;
 
+  // Before the threads are created, which it counts.
+  StartMetrics();
+
   // Create the thread pool.
   heap_->CreateThreadPool();
+  if (background_verification_) {
+    class_linker_->CreateVerificationThreadPool();
+  }
 
   StartSignalCatcher();
+  StartSamplingProfiler();
+  if (jit_ != NULL) {
+    jit_->CreateThreadPool();
+  }
 
   // Start the JDWP thread. If the command-line debugger flags specified "suspend=y",
   // this will pause the runtime, so we probably want this to come last.
@@ -807,6 +1088,52 @@ void Runtime::StartSignalCatcher() {
   }
 }
 
+void Runtime::StartMetrics() {
+  if (!metrics_dir_.empty()) {
+    std::string filename(StringPrintf("%s/%d.metrics", metrics_dir_.c_str(), getpid()));
+    std::string error_msg;
+    Metrics* metrics = Metrics::Create(filename, &error_msg);
+    if (metrics == NULL) {
+      LOG(WARNING) << "Not publishing metrics: " << error_msg;
+      return;
+    }
+    // Threads count themselves in and out with the lock held.
+    MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
+    metrics->Set(Metrics::kThreads, thread_list_->GetList().size());
+    metrics_ = metrics;
+  }
+}
+
+void Runtime::StartSamplingProfiler() {
+  if (!is_zygote_ && !sampling_profile_dir_.empty()) {
+    sampling_profiler_ = new SamplingProfiler(sampling_profile_dir_, sampling_profile_period_ms_);
+    sampling_profiler_->Start();
+  }
+}
+
+static void* PreloadOatFiles(void* arg) {
+  UniquePtr<std::vector<const OatFile*> > oat_files(
+      reinterpret_cast<std::vector<const OatFile*>*>(arg));
+  // Oat files are never unloaded, so they can be used without holding the dex lock.
+  for (size_t i = 0; i < oat_files->size(); ++i) {
+    (*oat_files)[i]->AdviseStartupPages();
+  }
+  return NULL;
+}
+
+void Runtime::StartOatPreload() {
+  if (!preload_oat_) {
+    return;
+  }
+  // The thread only issues madvise calls, it never needs to be attached.
+  std::vector<const OatFile*>* oat_files =
+      new std::vector<const OatFile*>(class_linker_->GetOatFiles());
+  pthread_t pthread;
+  CHECK_PTHREAD_CALL(pthread_create, (&pthread, NULL, PreloadOatFiles, oat_files),
+                     "oat preload thread");
+  CHECK_PTHREAD_CALL(pthread_detach, (pthread), "oat preload thread");
+}
+
 void Runtime::StartDaemonThreads() {
   VLOG(startup) << "Runtime::StartDaemonThreads entering";
 
@@ -835,10 +1162,14 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
     return false;
   }
   VLOG(startup) << "Runtime::Init -verbose:startup enabled";
+  base::TimingLogger timings("Runtime::Init", true, false);
+  timings.StartSplit("Options");
 
   QuasiAtomic::Startup();
 
   Monitor::Init(options->lock_profiling_threshold_, options->hook_is_sensitive_thread_);
+  LockProfiler::SetEnabled(options->lock_profiler_);
+  AllocationProfiler::SetSampleInterval(options->alloc_sample_bytes_);
 
   host_prefix_ = options->host_prefix_;
   boot_class_path_string_ = options->boot_class_path_string_;
@@ -864,16 +1195,34 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
 
   default_stack_size_ = options->stack_size_;
   stack_trace_file_ = options->stack_trace_file_;
+  preload_oat_ = options->preload_oat_;
+  background_verification_ = options->background_verification_;
+  dex_cache_field_slots_ = options->dex_cache_field_slots_;
+  fork_heap_dumps_ = options->fork_heap_dumps_;
+  checkpoint_thread_dumps_ = options->checkpoint_thread_dumps_;
+  preload_dex_caches_ = options->preload_dex_caches_;
+  startup_timings_ = options->startup_timings_;
+  sampling_profile_dir_ = options->sampling_profile_dir_;
+  sampling_profile_period_ms_ = options->sampling_profile_period_ms_;
+  metrics_dir_ = options->metrics_dir_;
+  for (size_t i = 0; i < kThreadClassCount; ++i) {
+    thread_priorities_[i] = options->thread_priorities_[i];
+    thread_cpus_[i] = options->thread_cpus_[i];
+  }
 
   monitor_list_ = new MonitorList;
   thread_list_ = new ThreadList;
   intern_table_ = new InternTable;
+  arena_pool_ = new ArenaPool;
+  inline_caches_ = new InlineCacheTable;
+  catch_handler_cache_ = new CatchHandlerCache;
 
 
   if (options->interpreter_only_) {
     GetInstrumentation()->ForceInterpretOnly();
   }
 
+  timings.NewSplit("Heap");
   heap_ = new gc::Heap(options->heap_initial_size_,
                        options->heap_growth_limit_,
                        options->heap_min_free_,
@@ -887,10 +1236,25 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
                        options->low_memory_mode_,
                        options->long_pause_log_threshold_,
                        options->long_gc_log_threshold_,
-                       options->ignore_max_footprint_);
-
+                       options->ignore_max_footprint_,
+                       options->use_tlab_,
+                       options->use_rosalloc_,
+                       options->gc_pause_goal_,
+                       options->gc_throughput_goal_,
+                       options->pretenure_,
+                       options->deduplicate_strings_,
+                       options->class_unloading_,
+                       options->huge_pages_,
+                       options->verify_pre_gc_heap_,
+                       options->verify_post_gc_heap_,
+                       options->verify_missing_card_marks_,
+                       options->verify_sample_percent_,
+                       options->track_instance_counts_);
+
+  timings.NewSplit("Signals and main thread");
   BlockSignals();
   InitPlatformSignalHandlers();
+  FaultHandler::Init();
 
   java_vm_ = new JavaVMExt(this, options.get());
 
@@ -909,6 +1273,7 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   // Now we're attached, we can take the heap locks and validate the heap.
   GetHeap()->EnableObjectValidation();
 
+  timings.NewSplit("ClassLinker");
   CHECK_GE(GetHeap()->GetContinuousSpaces().size(), 1U);
   if (GetHeap()->GetContinuousSpaces()[0]->IsImageSpace()) {
     class_linker_ = ClassLinker::CreateFromImage(intern_table_);
@@ -918,15 +1283,32 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
     class_linker_ = ClassLinker::CreateFromCompiler(*options->boot_class_path_, intern_table_);
   }
   CHECK(class_linker_ != NULL);
+
+  timings.NewSplit("JIT and verifier");
+  // Created before the verifier is initialized, which keeps compiler information for the JIT.
+  if (options->use_jit_ && !is_compiler_ && !options->interpreter_only_) {
+    std::string error_msg;
+    jit_ = jit::Jit::Create(options->jit_threshold_, options->jit_code_cache_capacity_,
+                            &error_msg);
+    if (jit_ == NULL) {
+      LOG(WARNING) << "Not using the JIT: " << error_msg;
+    }
+  }
   verifier::MethodVerifier::Init();
 
+  timings.NewSplit("Tracing and threads");
+  if (options->reuse_native_threads_) {
+    native_thread_pool_ = new NativeThreadPool(NativeThreadPool::kDefaultIdleTimeoutMs);
+  }
+
   method_trace_ = options->method_trace_;
   method_trace_file_ = options->method_trace_file_;
   method_trace_file_size_ = options->method_trace_file_size_;
+  instrumentation_.SetMethodFilter(options->method_trace_filter_);
 
   if (options->method_trace_) {
-    Trace::Start(options->method_trace_file_.c_str(), -1, options->method_trace_file_size_, 0,
-                 false, false, 0);
+    Trace::Start(options->method_trace_file_.c_str(), -1, options->method_trace_file_size_,
+                 options->method_trace_stream_ ? Trace::kTraceStreaming : 0, false, false, 0);
   }
 
   // Pre-allocate an OutOfMemoryError for the double-OOME case.
@@ -935,6 +1317,10 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   pre_allocated_OutOfMemoryError_ = self->GetException(NULL);
   self->ClearException();
 
+  timings.EndSplit();
+  if (startup_timings_) {
+    LOG(INFO) << Dumpable<base::TimingLogger>(timings);
+  }
   VLOG(startup) << "Runtime::Init exiting";
   return true;
 }
@@ -1034,12 +1420,22 @@ void Runtime::RegisterRuntimeNativeMethods(JNIEnv* env) {
 void Runtime::DumpForSigQuit(std::ostream& os) {
   GetClassLinker()->DumpForSigQuit(os);
   GetInternTable()->DumpForSigQuit(os);
+  GetInlineCaches()->DumpForSigQuit(os);
+  if (jit_ != NULL) {
+    jit_->DumpForSigQuit(os);
+  }
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
+  GetMonitorList()->DumpForSigQuit(os);
   os << "\n";
 
-  thread_list_->DumpForSigQuit(os);
+  // Otherwise the signal catcher dumps the threads once they are resumed.
+  if (!checkpoint_thread_dumps_) {
+    thread_list_->DumpForSigQuit(os);
+  }
   BaseMutex::DumpAll(os);
+  LockProfiler::Dump(os);
+  AllocationProfiler::Dump(os);
 }
 
 void Runtime::DumpLockHolders(std::ostream& os) {
@@ -1094,6 +1490,10 @@ int32_t Runtime::GetStat(int kind) {
   case KIND_CLASS_INIT_TIME:
     // Convert ns to us, reduce to 32 bits.
     return static_cast<int>(stats->class_init_time_ns / 1000);
+  case KIND_CLASS_INIT_WAIT_COUNT:
+    return stats->class_init_wait_count;
+  case KIND_CLASS_INIT_WAIT_TIME:
+    return static_cast<int>(stats->class_init_wait_time_ns / 1000);
   case KIND_EXT_ALLOCATED_OBJECTS:
   case KIND_EXT_ALLOCATED_BYTES:
   case KIND_EXT_FREED_OBJECTS:
@@ -1145,7 +1545,7 @@ void Runtime::DetachCurrentThread() {
 void Runtime::VisitConcurrentRoots(RootVisitor* visitor, void* arg, bool only_dirty,
                                    bool clean_dirty) {
   intern_table_->VisitRoots(visitor, arg, only_dirty, clean_dirty);
-  class_linker_->VisitRoots(visitor, arg, only_dirty, clean_dirty);
+  class_linker_->VisitRoots(visitor, arg, only_dirty, clean_dirty, false);
 }
 
 void Runtime::VisitNonThreadRoots(RootVisitor* visitor, void* arg) {
@@ -1253,12 +1653,16 @@ void Runtime::DisallowNewSystemWeaks() {
   monitor_list_->DisallowNewMonitors();
   intern_table_->DisallowNewInterns();
   java_vm_->DisallowNewWeakGlobals();
+  Dbg::DisallowNewObjectRegistryObjects();
 }
 
 void Runtime::AllowNewSystemWeaks() {
   monitor_list_->AllowNewMonitors();
   intern_table_->AllowNewInterns();
   java_vm_->AllowNewWeakGlobals();
+  // The registry waits for new objects before creating or decoding JNI weak globals while
+  // holding its lock, so it must only be allowed once they are.
+  Dbg::AllowNewObjectRegistryObjects();
 }
 
 void Runtime::SetCalleeSaveMethod(mirror::ArtMethod* method, CalleeSaveType type) {
@@ -1282,4 +1686,19 @@ void Runtime::SetCompileTimeClassPath(jobject class_loader, std::vector<const De
   compile_time_class_paths_.Put(class_loader, class_path);
 }
 
+void Runtime::SetUpThreadScheduling(Thread* thread, ThreadClass thread_class) const {
+  if (thread_priorities_[thread_class] != 0) {
+    thread->SetNativePriority(thread_priorities_[thread_class]);
+  }
+  if (!thread_cpus_[thread_class].empty()) {
+    thread->SetAffinity(thread_cpus_[thread_class]);
+  }
+}
+
+void Runtime::SetUpThreadScheduling(ThreadPool* thread_pool, ThreadClass thread_class) const {
+  for (size_t i = 0; i < thread_pool->GetThreadCount(); ++i) {
+    SetUpThreadScheduling(thread_pool->GetWorkerThread(i), thread_class);
+  }
+}
+
 }  // namespace art
@@ -42,6 +42,9 @@ namespace art {
 namespace gc {
   class Heap;
 }
+namespace jit {
+  class Jit;
+}
 namespace mirror {
   class ArtMethod;
   class ClassLoader;
@@ -50,13 +53,20 @@ namespace mirror {
   class String;
   class Throwable;
 }  // namespace mirror
+class ArenaPool;
+class CatchHandlerCache;
 class ClassLinker;
 class DexFile;
+class InlineCacheTable;
 class InternTable;
 struct JavaVMExt;
 class MonitorList;
+class NativeThreadPool;
+class Metrics;
+class SamplingProfiler;
 class SignalCatcher;
 class ThreadList;
+class ThreadPool;
 class Trace;
 
 class Runtime {
@@ -71,6 +81,16 @@ class Runtime {
     kEverything           // Force compilation (Note: excludes compilaton of class initializers).
   };
 
+  // Classes of runtime threads whose scheduling is set with -Xthread-priority:<class>:<priority>
+  // and -Xthread-cpus:<class>:<cpus>.
+  enum ThreadClass {
+    kGcThreads,             // "gc": the heap's thread pool and the GC and heap trimming daemons.
+    kCompilerThreads,       // "compiler": the compiler, verification and JIT thread pools.
+    kSignalCatcherThread,   // "signal-catcher".
+    kJdwpThread,            // "jdwp".
+    kThreadClassCount
+  };
+
   // Guide heuristics to determine whether to compile method if profile data not available.
 #if ART_SMALL_MODE
   static const CompilerFilter kDefaultCompilerFilter = kInterpretOnly;
@@ -94,6 +114,7 @@ class Runtime {
     std::string host_prefix_;
     std::string image_;
     bool check_jni_;
+    bool check_jni_lite_;
     std::string jni_trace_;
     bool is_compiler_;
     bool is_zygote_;
@@ -103,6 +124,19 @@ class Runtime {
     size_t long_pause_log_threshold_;
     size_t long_gc_log_threshold_;
     bool ignore_max_footprint_;
+    bool use_tlab_;
+    bool use_rosalloc_;
+    size_t gc_pause_goal_;
+    double gc_throughput_goal_;
+    bool pretenure_;
+    bool deduplicate_strings_;
+    bool class_unloading_;
+    bool huge_pages_;
+    bool verify_pre_gc_heap_;
+    bool verify_post_gc_heap_;
+    bool verify_missing_card_marks_;
+    size_t verify_sample_percent_;
+    bool track_instance_counts_;
     size_t heap_initial_size_;
     size_t heap_maximum_size_;
     size_t heap_growth_limit_;
@@ -114,16 +148,36 @@ class Runtime {
     size_t stack_size_;
     bool low_memory_mode_;
     size_t lock_profiling_threshold_;
+    bool lock_profiler_;
+    size_t alloc_sample_bytes_;
+    bool preload_oat_;
+    bool background_verification_;
+    size_t dex_cache_field_slots_;
+    bool fork_heap_dumps_;
+    bool checkpoint_thread_dumps_;
+    bool preload_dex_caches_;
+    bool startup_timings_;
     std::string stack_trace_file_;
     bool method_trace_;
     std::string method_trace_file_;
     size_t method_trace_file_size_;
+    bool method_trace_stream_;
+    std::string method_trace_filter_;
+    std::string sampling_profile_dir_;
+    size_t sampling_profile_period_ms_;
+    std::string metrics_dir_;
+    bool use_jit_;
+    size_t jit_threshold_;
+    size_t jit_code_cache_capacity_;
+    bool reuse_native_threads_;
     bool (*hook_is_sensitive_thread_)();
     jint (*hook_vfprintf_)(FILE* stream, const char* format, va_list ap);
     void (*hook_exit_)(jint status);
     void (*hook_abort_)();
     std::vector<std::string> properties_;
     CompilerFilter compiler_filter_;
+    int thread_priorities_[kThreadClassCount];
+    std::vector<int> thread_cpus_[kThreadClassCount];
     size_t huge_method_threshold_;
     size_t large_method_threshold_;
     size_t small_method_threshold_;
@@ -193,6 +247,18 @@ class Runtime {
       return num_dex_methods_threshold_;
   }
 
+  size_t GetDexCacheFieldSlots() const {
+    return dex_cache_field_slots_;
+  }
+
+  bool ForkHeapDumps() const {
+    return fork_heap_dumps_;
+  }
+
+  bool CheckpointThreadDumps() const {
+    return checkpoint_thread_dumps_;
+  }
+
   const std::string& GetHostPrefix() const {
     DCHECK(!IsStarted());
     return host_prefix_;
@@ -282,6 +348,44 @@ class Runtime {
     return intern_table_;
   }
 
+  // Arenas for the short lived allocations of the method verifier.
+  ArenaPool* GetArenaPool() const {
+    return arena_pool_;
+  }
+
+  InlineCacheTable* GetInlineCaches() const {
+    return inline_caches_;
+  }
+
+  CatchHandlerCache* GetCatchHandlerCache() const {
+    return catch_handler_cache_;
+  }
+
+  // NULL unless -Xsampling-profile-dir: is given, and in the zygote.
+  SamplingProfiler* GetSamplingProfiler() const {
+    return sampling_profiler_;
+  }
+
+  // NULL unless -Xjit is given.
+  jit::Jit* GetJit() const {
+    return jit_;
+  }
+
+  // NULL unless -Xmetrics: is given, and in the zygote.
+  Metrics* GetMetrics() const {
+    return metrics_;
+  }
+
+  // NULL unless -Xreuse-native-threads is given.
+  NativeThreadPool* GetNativeThreadPool() const {
+    return native_thread_pool_;
+  }
+
+  // Applies the priority and CPUs given for thread_class to thread, or to the workers of
+  // thread_pool. Threads keep the default scheduling unless they were given.
+  void SetUpThreadScheduling(Thread* thread, ThreadClass thread_class) const;
+  void SetUpThreadScheduling(ThreadPool* thread_pool, ThreadClass thread_class) const;
+
   JavaVMExt* GetJavaVM() const {
     return java_vm_;
   }
@@ -308,8 +412,9 @@ class Runtime {
   void DisallowNewSystemWeaks() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_);
   void AllowNewSystemWeaks() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  // Visit all the roots. If only_dirty is true then non-dirty roots won't be visited. If
-  // clean_dirty is true then dirty roots will be marked as non-dirty after visiting.
+  // Visit all the roots. If only_dirty is true then only the roots added to the class linker and
+  // intern tables since they were last cleaned are visited of theirs. If clean_dirty is true then
+  // the tables are cleaned after visiting.
   void VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, bool clean_dirty)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -411,7 +516,10 @@ class Runtime {
   void RegisterRuntimeNativeMethods(JNIEnv* env);
 
   void StartDaemonThreads();
+  void StartOatPreload();
   void StartSignalCatcher();
+  void StartSamplingProfiler();
+  void StartMetrics();
 
   // A pointer to the active runtime or NULL.
   static Runtime* instance_;
@@ -457,11 +565,63 @@ class Runtime {
 
   InternTable* intern_table_;
 
+  ArenaPool* arena_pool_;
+
+  InlineCacheTable* inline_caches_;
+
+  CatchHandlerCache* catch_handler_cache_;
+
   ClassLinker* class_linker_;
 
   SignalCatcher* signal_catcher_;
   std::string stack_trace_file_;
 
+  // With -Xpreload-oat the startup pages of the oat files are read in by a background thread
+  // during Start.
+  bool preload_oat_;
+
+  // With -Xbackground-verification app classes are verified ahead of use by class linker
+  // workers, started after forking from the zygote.
+  bool background_verification_;
+
+  // Caps the resolved fields array of dex caches allocated at runtime, 0 if uncapped.
+  size_t dex_cache_field_slots_;
+
+  // With -Xhprof-fork heap dumps to a file are written by a forked child from a snapshot of the
+  // heap, so that the threads are only suspended for the fork.
+  bool fork_heap_dumps_;
+
+  // With -Xsigquit-checkpoint the threads of SIGQUIT dumps are captured at a checkpoint and
+  // printed after the other threads are resumed rather than with all of them suspended.
+  bool checkpoint_thread_dumps_;
+
+  // With -Xpreload-dex-caches the zygote resolves the boot dex caches before its first fork.
+  bool preload_dex_caches_;
+
+  // With -Xstartup-timings the phases of Init and Start are timed and logged.
+  bool startup_timings_;
+
+  // Started after forking from the zygote when -Xsampling-profile-dir: is given.
+  SamplingProfiler* sampling_profiler_;
+  std::string sampling_profile_dir_;
+  size_t sampling_profile_period_ms_;
+
+  // Created after forking from the zygote when -Xmetrics: is given, so that each process gets its
+  // own file.
+  Metrics* metrics_;
+  std::string metrics_dir_;
+
+  // Created with -Xjit, compiles on a thread started after forking from the zygote.
+  jit::Jit* jit_;
+
+  // Runs the native threads of Java threads with -Xreuse-native-threads. Never deleted, as daemon
+  // threads may still be running on its threads when the runtime is destroyed.
+  NativeThreadPool* native_thread_pool_;
+
+  // From -Xthread-priority: and -Xthread-cpus:, a priority of 0 or no CPUs if not given.
+  int thread_priorities_[kThreadClassCount];
+  std::vector<int> thread_cpus_[kThreadClassCount];
+
   JavaVMExt* java_vm_;
 
   mirror::Throwable* pre_allocated_OutOfMemoryError_;
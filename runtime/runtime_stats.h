@@ -30,6 +30,9 @@ enum StatKinds {
   KIND_GC_INVOCATIONS         = 1<<4,
   KIND_CLASS_INIT_COUNT       = 1<<5,
   KIND_CLASS_INIT_TIME        = 1<<6,
+  // ART additions, not part of dalvik.system.VMDebug.
+  KIND_CLASS_INIT_WAIT_COUNT  = 1<<7,
+  KIND_CLASS_INIT_WAIT_TIME   = 1<<8,
 
   // These values exist for backward compatibility.
   KIND_EXT_ALLOCATED_OBJECTS = 1<<12,
@@ -86,6 +89,12 @@ struct PACKED(4) RuntimeStats {
     if ((flags & KIND_CLASS_INIT_TIME) != 0) {
       class_init_time_ns = 0;
     }
+    if ((flags & KIND_CLASS_INIT_WAIT_COUNT) != 0) {
+      class_init_wait_count = 0;
+    }
+    if ((flags & KIND_CLASS_INIT_WAIT_TIME) != 0) {
+      class_init_wait_time_ns = 0;
+    }
   }
 
   // Number of objects allocated.
@@ -106,6 +115,11 @@ struct PACKED(4) RuntimeStats {
   // Cumulative time spent in class initialization.
   uint64_t class_init_time_ns;
 
+  // Number of times a thread waited for another thread to initialize a class.
+  int class_init_wait_count;
+  // Cumulative time spent in those waits.
+  uint64_t class_init_wait_time_ns;
+
   DISALLOW_COPY_AND_ASSIGN(RuntimeStats);
 };
 
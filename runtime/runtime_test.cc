@@ -47,6 +47,8 @@ TEST_F(RuntimeTest, ParsedOptions) {
   options.push_back(std::make_pair("-Xmx4k", null));
   options.push_back(std::make_pair("-Xss1m", null));
   options.push_back(std::make_pair("-XX:HeapTargetUtilization=0.75", null));
+  options.push_back(std::make_pair("-XX:GCPauseGoal=10", null));
+  options.push_back(std::make_pair("-XX:GCThroughputGoal=0.95", null));
   options.push_back(std::make_pair("-Dfoo=bar", null));
   options.push_back(std::make_pair("-Dbaz=qux", null));
   options.push_back(std::make_pair("-verbose:gc,class,jni", null));
@@ -61,10 +63,13 @@ TEST_F(RuntimeTest, ParsedOptions) {
   EXPECT_EQ(lib_core, parsed->class_path_string_);
   EXPECT_EQ(std::string("boot_image"), parsed->image_);
   EXPECT_EQ(true, parsed->check_jni_);
+  EXPECT_EQ(false, parsed->check_jni_lite_);
   EXPECT_EQ(2048U, parsed->heap_initial_size_);
   EXPECT_EQ(4 * KB, parsed->heap_maximum_size_);
   EXPECT_EQ(1 * MB, parsed->stack_size_);
   EXPECT_EQ(0.75, parsed->heap_target_utilization_);
+  EXPECT_EQ(MsToNs(10), parsed->gc_pause_goal_);
+  EXPECT_EQ(0.95, parsed->gc_throughput_goal_);
   EXPECT_EQ("host_prefix", parsed->host_prefix_);
   EXPECT_TRUE(test_vfprintf == parsed->hook_vfprintf_);
   EXPECT_TRUE(test_exit == parsed->hook_exit_);
@@ -84,4 +89,53 @@ TEST_F(RuntimeTest, ParsedOptions) {
   EXPECT_EQ("baz=qux", parsed->properties_[1]);
 }
 
+TEST_F(RuntimeTest, ParsedOptionsCheckJniLite) {
+  void* null = reinterpret_cast<void*>(NULL);
+  Runtime::Options options;
+  options.push_back(std::make_pair("-Xcheck:jni:lite", null));
+  UniquePtr<Runtime::ParsedOptions> parsed(Runtime::ParsedOptions::Create(options, false));
+  ASSERT_TRUE(parsed.get() != NULL);
+  EXPECT_TRUE(parsed->check_jni_);
+  EXPECT_TRUE(parsed->check_jni_lite_);
+
+  options.push_back(std::make_pair("-Xcheck:jni", null));
+  parsed.reset(Runtime::ParsedOptions::Create(options, false));
+  ASSERT_TRUE(parsed.get() != NULL);
+  EXPECT_TRUE(parsed->check_jni_);
+  EXPECT_FALSE(parsed->check_jni_lite_);
+}
+
+TEST_F(RuntimeTest, ParsedOptionsThreadScheduling) {
+  void* null = reinterpret_cast<void*>(NULL);
+  Runtime::Options options;
+  options.push_back(std::make_pair("-Xthread-priority:gc:3", null));
+  options.push_back(std::make_pair("-Xthread-cpus:gc:0-2,5", null));
+  options.push_back(std::make_pair("-Xthread-cpus:signal-catcher:1", null));
+  UniquePtr<Runtime::ParsedOptions> parsed(Runtime::ParsedOptions::Create(options, false));
+  ASSERT_TRUE(parsed.get() != NULL);
+  EXPECT_EQ(3, parsed->thread_priorities_[Runtime::kGcThreads]);
+  EXPECT_EQ(0, parsed->thread_priorities_[Runtime::kCompilerThreads]);
+  const std::vector<int>& gc_cpus = parsed->thread_cpus_[Runtime::kGcThreads];
+  ASSERT_EQ(4U, gc_cpus.size());
+  EXPECT_EQ(0, gc_cpus[0]);
+  EXPECT_EQ(2, gc_cpus[2]);
+  EXPECT_EQ(5, gc_cpus[3]);
+  ASSERT_EQ(1U, parsed->thread_cpus_[Runtime::kSignalCatcherThread].size());
+  EXPECT_EQ(1, parsed->thread_cpus_[Runtime::kSignalCatcherThread][0]);
+  EXPECT_TRUE(parsed->thread_cpus_[Runtime::kJdwpThread].empty());
+}
+
+TEST_F(RuntimeTest, ParsedOptionsHeapVerification) {
+  void* null = reinterpret_cast<void*>(NULL);
+  Runtime::Options options;
+  options.push_back(std::make_pair("-Xgc:preverify,verifycardtable,verifysample:10", null));
+  UniquePtr<Runtime::ParsedOptions> parsed(Runtime::ParsedOptions::Create(options, false));
+  ASSERT_TRUE(parsed.get() != NULL);
+  EXPECT_TRUE(parsed->is_concurrent_gc_enabled_);
+  EXPECT_TRUE(parsed->verify_pre_gc_heap_);
+  EXPECT_FALSE(parsed->verify_post_gc_heap_);
+  EXPECT_TRUE(parsed->verify_missing_card_marks_);
+  EXPECT_EQ(10U, parsed->verify_sample_percent_);
+}
+
 }  // namespace art
@@ -33,10 +33,15 @@ class SafeMap {
   typedef SafeMap<K, V, Comparator, Allocator> Self;
 
  public:
-  typedef typename ::std::map<K, V, Comparator>::iterator iterator;
-  typedef typename ::std::map<K, V, Comparator>::const_iterator const_iterator;
-  typedef typename ::std::map<K, V, Comparator>::size_type size_type;
-  typedef typename ::std::map<K, V, Comparator>::value_type value_type;
+  typedef typename ::std::map<K, V, Comparator, Allocator>::iterator iterator;
+  typedef typename ::std::map<K, V, Comparator, Allocator>::const_iterator const_iterator;
+  typedef typename ::std::map<K, V, Comparator, Allocator>::size_type size_type;
+  typedef typename ::std::map<K, V, Comparator, Allocator>::value_type value_type;
+
+  SafeMap() {}
+  // For allocators without a default constructor, such as ArenaAllocatorAdapter.
+  explicit SafeMap(const Allocator& allocator, const Comparator& comparator = Comparator())
+      : map_(comparator, allocator) {}
 
   Self& operator=(const Self& rhs) {
     map_ = rhs.map_;
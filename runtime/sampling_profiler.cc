@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampling_profiler.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "os.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread.h"
+#include "thread_list.h"
+#include "UniquePtr.h"
+#include "utils.h"
+
+namespace art {
+
+void SamplingProfiler::SampleCheckpoint::Run(Thread* thread) {
+  Thread* self = Thread::Current();
+  // Threads which were executing Java code run the checkpoint themselves, the profiler runs it on
+  // behalf of the suspended ones. Those, and the profiler itself, aren't sampled.
+  if (thread == self && thread != profiler_->thread_) {
+    mirror::ArtMethod* method = thread->GetCurrentMethod(NULL);
+    if (method != NULL) {
+      profiler_->AddSample(method);
+    }
+  }
+  profiler_->barrier_.Pass(self);
+}
+
+SamplingProfiler::SamplingProfiler(const std::string& profile_dir, uint32_t period_ms)
+    : profile_dir_(profile_dir),
+      period_ms_(period_ms),
+      checkpoint_(this),
+      barrier_(0),
+      lock_("SamplingProfiler lock"),
+      cond_("SamplingProfiler::cond_", lock_),
+      halt_(false),
+      started_(false),
+      thread_(NULL),
+      sample_count_(0) {
+  CHECK_GT(period_ms, 0U);
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, lock_);
+    if (!started_) {
+      return;
+    }
+    halt_ = true;
+    cond_.Broadcast(self);
+  }
+  CHECK_PTHREAD_CALL(pthread_join, (pthread_, NULL), "sampling profiler shutdown");
+}
+
+void SamplingProfiler::Start() {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, lock_);
+  CHECK(!started_);
+  started_ = true;
+  // Create a raw pthread; its start routine will attach to the runtime.
+  CHECK_PTHREAD_CALL(pthread_create, (&pthread_, NULL, &Run, this), "sampling profiler thread");
+  while (thread_ == NULL) {
+    cond_.Wait(self);
+  }
+}
+
+void* SamplingProfiler::Run(void* arg) {
+  SamplingProfiler* profiler = reinterpret_cast<SamplingProfiler*>(arg);
+  CHECK(profiler != NULL);
+
+  Runtime* runtime = Runtime::Current();
+  CHECK(runtime->AttachCurrentThread("Sampling Profiler", true, runtime->GetSystemThreadGroup(),
+                                     !runtime->IsCompiler()));
+
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, profiler->lock_);
+    profiler->thread_ = self;
+    profiler->cond_.Broadcast(self);
+  }
+
+  uint64_t last_write_ns = NanoTime();
+  while (!profiler->WaitForNextSample(self)) {
+    profiler->SampleAllThreads(self);
+    if (NanoTime() - last_write_ns >= MsToNs(kWritePeriodMs)) {
+      profiler->WriteProfileFile(self);
+      last_write_ns = NanoTime();
+    }
+  }
+  profiler->WriteProfileFile(self);
+  runtime->DetachCurrentThread();
+  return NULL;
+}
+
+bool SamplingProfiler::WaitForNextSample(Thread* self) {
+  MutexLock mu(self, lock_);
+  if (!halt_) {
+    cond_.TimedWait(self, period_ms_, 0);
+  }
+  return halt_;
+}
+
+void SamplingProfiler::SampleAllThreads(Thread* self) {
+  barrier_.Init(self, 0);
+  size_t barrier_count = Runtime::Current()->GetThreadList()->RunCheckpoint(&checkpoint_);
+  // The checkpoint refers to the barrier, wait until every thread has passed it.
+  ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+  barrier_.Increment(self, barrier_count);
+}
+
+void SamplingProfiler::AddSample(const mirror::ArtMethod* method) {
+  MutexLock mu(Thread::Current(), lock_);
+  ++sample_count_;
+  auto it = samples_.find(method);
+  if (it == samples_.end()) {
+    samples_.Put(method, 1);
+  } else {
+    ++it->second;
+  }
+}
+
+size_t SamplingProfiler::GetSampleCount() {
+  MutexLock mu(Thread::Current(), lock_);
+  return sample_count_;
+}
+
+void SamplingProfiler::TakeSamples(MethodCounts* counts) {
+  SafeMap<const mirror::ArtMethod*, uint32_t> samples;
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    samples = samples_;
+    samples_.clear();
+    sample_count_ = 0;
+  }
+  for (const auto& sample : samples) {
+    (*counts)[PrettyMethod(sample.first)] += sample.second;
+  }
+}
+
+void SamplingProfiler::ReadProfile(std::istream& is, MethodCounts* counts) {
+  while (is.good()) {
+    std::string line;
+    std::getline(is, line);
+    if (StartsWith(line, "#") || line.empty()) {
+      continue;
+    }
+    size_t tab = line.find('\t');
+    uint32_t count = 1;
+    if (tab != std::string::npos) {
+      count = std::max(strtoul(line.c_str() + tab + 1, NULL, 10), 1UL);
+    }
+    (*counts)[line.substr(0, tab)] += count;
+  }
+}
+
+// Returns the methods of counts with their counts, hottest first.
+static std::vector<std::pair<uint32_t, std::string> > SortByCount(
+    const SamplingProfiler::MethodCounts& counts) {
+  std::vector<std::pair<uint32_t, std::string> > methods;
+  methods.reserve(counts.size());
+  for (const auto& count : counts) {
+    methods.push_back(std::make_pair(count.second, count.first));
+  }
+  std::sort(methods.begin(), methods.end(), std::greater<std::pair<uint32_t, std::string> >());
+  return methods;
+}
+
+static uint64_t CountSamples(const SamplingProfiler::MethodCounts& counts) {
+  uint64_t sample_count = 0;
+  for (const auto& count : counts) {
+    sample_count += count.second;
+  }
+  return sample_count;
+}
+
+void SamplingProfiler::WriteProfile(std::ostream& os, const MethodCounts& counts) {
+  os << "# " << CountSamples(counts) << " samples of " << counts.size() << " methods\n";
+  for (const auto& method : SortByCount(counts)) {
+    os << method.second << "\t" << method.first << "\n";
+  }
+}
+
+SamplingProfiler::MethodCounts SamplingProfiler::GetHotMethods(const MethodCounts& counts) {
+  uint64_t hot_samples = CountSamples(counts) * kHotCoveragePercent / 100;
+  MethodCounts hot_methods;
+  uint64_t sample_count = 0;
+  for (const auto& method : SortByCount(counts)) {
+    if (sample_count >= hot_samples) {
+      break;
+    }
+    hot_methods[method.second] = method.first;
+    sample_count += method.first;
+  }
+  return hot_methods;
+}
+
+bool SamplingProfiler::HotMethodsChanged(const MethodCounts& old_hot_methods,
+                                         const MethodCounts& hot_methods) {
+  size_t new_methods = 0;
+  for (const auto& method : hot_methods) {
+    if (old_hot_methods.find(method.first) == old_hot_methods.end()) {
+      ++new_methods;
+    }
+  }
+  return new_methods * 100 > hot_methods.size() * kRecompileChangePercent;
+}
+
+std::string SamplingProfiler::GetProfileName() {
+  std::string name;
+  std::string cmd_line;
+  if (ReadFileToString("/proc/self/cmdline", &cmd_line)) {
+    // Only the first argument, which zygote children rewrite to their package name.
+    name = cmd_line.substr(0, cmd_line.find('\0'));
+  }
+  size_t start = name.find_first_not_of('/');
+  if (start == std::string::npos) {
+    return StringPrintf("pid-%d", getpid());
+  }
+  name = name.substr(start);
+  std::replace(name.begin(), name.end(), '/', '@');
+  return name;
+}
+
+// Writes to a temporary file and renames it so that dex2oat never reads a partial profile.
+static bool WriteProfileAtomically(const std::string& file_name,
+                                   const SamplingProfiler::MethodCounts& counts) {
+  std::ostringstream os;
+  SamplingProfiler::WriteProfile(os, counts);
+  std::string profile(os.str());
+  std::string temp_name(file_name + ".tmp");
+  UniquePtr<File> file(OS::CreateEmptyFile(temp_name.c_str()));
+  if (file.get() == NULL) {
+    PLOG(WARNING) << "Failed to create profile '" << temp_name << "'";
+    return false;
+  }
+  if (!file->WriteFully(profile.data(), profile.size()) || file->Close() != 0) {
+    PLOG(WARNING) << "Failed to write profile '" << temp_name << "'";
+    unlink(temp_name.c_str());
+    return false;
+  }
+  if (rename(temp_name.c_str(), file_name.c_str()) != 0) {
+    PLOG(WARNING) << "Failed to rename profile '" << temp_name << "' to '" << file_name << "'";
+    unlink(temp_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+void SamplingProfiler::WriteProfileFile(Thread* self) {
+  MethodCounts counts;
+  {
+    ScopedObjectAccess soa(self);
+    TakeSamples(&counts);
+  }
+  if (counts.empty()) {
+    return;
+  }
+  // Other runs of the app have the same profile, add to it.
+  std::string file_name(profile_dir_ + "/" + GetProfileName());
+  std::ifstream profile_file(file_name.c_str(), std::ifstream::in);
+  if (profile_file.good()) {
+    ReadProfile(profile_file, &counts);
+  }
+  profile_file.close();
+  if (CountSamples(counts) > kMaxProfileSamples) {
+    for (auto it = counts.begin(); it != counts.end();) {
+      it->second /= 2;
+      if (it->second == 0) {
+        counts.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+  if (WriteProfileAtomically(file_name, counts)) {
+    WriteHotMethodsFile(file_name + ".hot", counts);
+  }
+}
+
+void SamplingProfiler::WriteHotMethodsFile(const std::string& file_name,
+                                           const MethodCounts& counts) {
+  if (CountSamples(counts) < kMinRecompileSamples) {
+    return;
+  }
+  MethodCounts hot_methods(GetHotMethods(counts));
+  MethodCounts old_hot_methods;
+  std::ifstream hot_file(file_name.c_str(), std::ifstream::in);
+  if (hot_file.good()) {
+    ReadProfile(hot_file, &old_hot_methods);
+  }
+  hot_file.close();
+  if (!HotMethodsChanged(old_hot_methods, hot_methods)) {
+    return;
+  }
+  if (WriteProfileAtomically(file_name, hot_methods)) {
+    LOG(INFO) << "Profile of " << GetProfileName() << " has " << hot_methods.size()
+              << " hot methods, wrote " << file_name;
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_SAMPLING_PROFILER_H_
+#define ART_RUNTIME_SAMPLING_PROFILER_H_
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "barrier.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "closure.h"
+#include "safe_map.h"
+
+namespace art {
+
+namespace mirror {
+class ArtMethod;
+}  // namespace mirror
+class Thread;
+
+// A daemon thread that periodically runs a checkpoint on every thread and counts the method each
+// thread executing Java code is in. Threads which are suspended or blocked aren't sampled. Every
+// kWritePeriodMs and when the profiler is stopped, the samples taken since the last write are
+// added to the profile of the process, a file named after it in the profile directory, so that
+// the profile covers all the runs of an app. The profile is in the format read by dex2oat's
+// --profile-file, with the most sampled methods first.
+//
+// Once the profile has kMinRecompileSamples, its hot methods, those which account for
+// kHotCoveragePercent of the samples, are written to the profile's ".hot" file. The file is only
+// rewritten when more than kRecompileChangePercent of the hot methods weren't in it, which is the
+// signal for the installer to run dex2oat again in the background with the file as profile.
+class SamplingProfiler {
+ public:
+  // Sample counts by method, as printed by PrettyMethod.
+  typedef std::map<std::string, uint32_t> MethodCounts;
+
+  static constexpr uint32_t kWritePeriodMs = 30 * 1000;
+  static constexpr uint32_t kHotCoveragePercent = 90;
+  static constexpr uint32_t kRecompileChangePercent = 10;
+  static constexpr uint32_t kMinRecompileSamples = 1000;
+  // Counts are halved when a profile gets more samples, so that the profile follows the app's
+  // recent runs.
+  static constexpr uint32_t kMaxProfileSamples = 1 << 20;
+
+  SamplingProfiler(const std::string& profile_dir, uint32_t period_ms);
+  // Stops the sampling thread if it was started and writes the profile a last time.
+  ~SamplingProfiler();
+
+  void Start() LOCKS_EXCLUDED(lock_);
+
+  void AddSample(const mirror::ArtMethod* method) LOCKS_EXCLUDED(lock_);
+  size_t GetSampleCount() LOCKS_EXCLUDED(lock_);
+
+  // Moves the samples taken since the last call to counts.
+  void TakeSamples(MethodCounts* counts) LOCKS_EXCLUDED(lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Adds the counts of a profile to counts. Methods without a count count once.
+  static void ReadProfile(std::istream& is, MethodCounts* counts);
+  static void WriteProfile(std::ostream& os, const MethodCounts& counts);
+
+  // Returns the fewest methods of counts which account for kHotCoveragePercent of its samples.
+  static MethodCounts GetHotMethods(const MethodCounts& counts);
+  // Whether more than kRecompileChangePercent of hot_methods aren't in old_hot_methods.
+  static bool HotMethodsChanged(const MethodCounts& old_hot_methods,
+                                const MethodCounts& hot_methods);
+
+  // The profile name for this process, its name with '/' replaced by '@'.
+  static std::string GetProfileName();
+
+ private:
+  class SampleCheckpoint : public Closure {
+   public:
+    explicit SampleCheckpoint(SamplingProfiler* profiler) : profiler_(profiler) {}
+    virtual void Run(Thread* thread) NO_THREAD_SAFETY_ANALYSIS;
+
+   private:
+    SamplingProfiler* const profiler_;
+  };
+
+  static void* Run(void* arg);
+
+  void SampleAllThreads(Thread* self);
+  void WriteProfileFile(Thread* self) LOCKS_EXCLUDED(lock_, Locks::mutator_lock_);
+  void WriteHotMethodsFile(const std::string& file_name, const MethodCounts& counts);
+  // Sleeps for the sampling period, returns true if the profiler should stop.
+  bool WaitForNextSample(Thread* self) LOCKS_EXCLUDED(lock_);
+
+  const std::string profile_dir_;
+  const uint32_t period_ms_;
+  SampleCheckpoint checkpoint_;
+  Barrier barrier_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable cond_ GUARDED_BY(lock_);
+  bool halt_ GUARDED_BY(lock_);
+  bool started_ GUARDED_BY(lock_);
+  pthread_t pthread_ GUARDED_BY(lock_);
+  Thread* thread_ GUARDED_BY(lock_);
+  size_t sample_count_ GUARDED_BY(lock_);
+  SafeMap<const mirror::ArtMethod*, uint32_t> samples_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_SAMPLING_PROFILER_H_
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampling_profiler.h"
+
+#include <sstream>
+
+#include "common_test.h"
+#include "mirror/art_method.h"
+#include "mirror/class.h"
+#include "UniquePtr.h"
+
+namespace art {
+
+class SamplingProfilerTest : public CommonTest {};
+
+TEST_F(SamplingProfilerTest, HottestMethodFirst) {
+  ScopedObjectAccess soa(Thread::Current());
+  mirror::Class* object = class_linker_->FindSystemClass("Ljava/lang/Object;");
+  ASSERT_TRUE(object != NULL);
+  mirror::ArtMethod* init = object->FindDirectMethod("<init>", "()V");
+  mirror::ArtMethod* hash_code = object->FindVirtualMethod("hashCode", "()I");
+  ASSERT_TRUE(init != NULL);
+  ASSERT_TRUE(hash_code != NULL);
+
+  SamplingProfiler profiler(getenv("ANDROID_DATA"), 10);
+  profiler.AddSample(init);
+  profiler.AddSample(hash_code);
+  profiler.AddSample(hash_code);
+  EXPECT_EQ(3U, profiler.GetSampleCount());
+
+  SamplingProfiler::MethodCounts counts;
+  profiler.TakeSamples(&counts);
+  EXPECT_EQ(0U, profiler.GetSampleCount());
+  std::ostringstream os;
+  SamplingProfiler::WriteProfile(os, counts);
+  EXPECT_EQ("# 3 samples of 2 methods\n"
+            "int java.lang.Object.hashCode()\t2\n"
+            "void java.lang.Object.<init>()\t1\n", os.str());
+}
+
+// Counts read from a profile add to the ones already taken, lines without a count count once.
+TEST_F(SamplingProfilerTest, MergeProfiles) {
+  SamplingProfiler::MethodCounts counts;
+  counts["int java.lang.Object.hashCode()"] = 2;
+  std::istringstream is("# 4 samples of 2 methods\n"
+                        "void java.lang.Object.<init>()\t3\n"
+                        "int java.lang.Object.hashCode()\n");
+  SamplingProfiler::ReadProfile(is, &counts);
+  EXPECT_EQ(2U, counts.size());
+  EXPECT_EQ(3U, counts["void java.lang.Object.<init>()"]);
+  EXPECT_EQ(3U, counts["int java.lang.Object.hashCode()"]);
+}
+
+TEST_F(SamplingProfilerTest, HotMethods) {
+  SamplingProfiler::MethodCounts counts;
+  counts["a"] = 60;
+  counts["b"] = 25;
+  counts["c"] = 10;
+  counts["d"] = 5;
+  SamplingProfiler::MethodCounts hot_methods(SamplingProfiler::GetHotMethods(counts));
+  EXPECT_EQ(3U, hot_methods.size());
+  EXPECT_TRUE(hot_methods.find("d") == hot_methods.end());
+
+  EXPECT_TRUE(SamplingProfiler::HotMethodsChanged(SamplingProfiler::MethodCounts(), hot_methods));
+  EXPECT_FALSE(SamplingProfiler::HotMethodsChanged(hot_methods, hot_methods));
+  // One new hot method out of three is more than kRecompileChangePercent.
+  SamplingProfiler::MethodCounts old_hot_methods(hot_methods);
+  old_hot_methods.erase("c");
+  EXPECT_TRUE(SamplingProfiler::HotMethodsChanged(old_hot_methods, hot_methods));
+}
+
+// The sampling thread runs checkpoints on the other threads and shuts down cleanly.
+TEST_F(SamplingProfilerTest, StartAndStop) {
+  UniquePtr<SamplingProfiler> profiler(new SamplingProfiler(getenv("ANDROID_DATA"), 1));
+  profiler->Start();
+  usleep(50 * 1000);
+  profiler.reset();
+  std::string profile(StringPrintf("%s/%s", getenv("ANDROID_DATA"),
+                                   SamplingProfiler::GetProfileName().c_str()));
+  unlink(profile.c_str());
+}
+
+}  // namespace art
@@ -199,6 +199,15 @@ class ScopedObjectAccessUnchecked : public ScopedThreadStateChange {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     Locks::mutator_lock_->AssertSharedHeld(Self());
     DCHECK_EQ(thread_state_, kRunnable);  // Don't work with raw objects in non-runnable states.
+    // Decode local references inline. Debug builds verify every decoded object so they always
+    // take the slow path.
+    IndirectRef ref = reinterpret_cast<IndirectRef>(obj);
+    if (!kIsDebugBuild && LIKELY(GetIndirectRefKind(ref) == kLocal)) {
+      const mirror::Object* result = Env()->locals.TryGet(ref);
+      if (LIKELY(result != NULL)) {
+        return down_cast<T>(const_cast<mirror::Object*>(result));
+      }
+    }
     return down_cast<T>(Self()->DecodeJObject(obj));
   }
 
@@ -143,15 +143,19 @@ void SignalCatcher::HandleSigQuit() {
       os << "/proc/self/maps:\n" << maps;
     }
   }
-  os << "----- end " << getpid() << " -----\n";
   CHECK_EQ(self->SetStateUnsafe(old_state), kRunnable);
   if (self->ReadFlag(kCheckpointRequest)) {
     self->RunCheckpointFunction();
-    self->AtomicClearFlag(kCheckpointRequest);
   }
   self->EndAssertNoThreadSuspension(old_cause);
   thread_list->ResumeAll();
 
+  if (runtime->CheckpointThreadDumps()) {
+    os << "\n";
+    thread_list->DumpForSigQuitWithCheckpoint(os);
+  }
+  os << "----- end " << getpid() << " -----\n";
+
   Output(os.str());
 }
 
@@ -190,6 +194,7 @@ void* SignalCatcher::Run(void* arg) {
 
   Thread* self = Thread::Current();
   DCHECK_NE(self->GetState(), kRunnable);
+  runtime->SetUpThreadScheduling(self, Runtime::kSignalCatcherThread);
   {
     MutexLock mu(self, signal_catcher->lock_);
     signal_catcher->thread_ = self;
@@ -86,7 +86,8 @@ bool ManagedStack::ShadowFramesContain(mirror::Object** shadow_frame_entry) cons
 StackVisitor::StackVisitor(Thread* thread, Context* context)
     : thread_(thread), cur_shadow_frame_(NULL),
       cur_quick_frame_(NULL), cur_quick_frame_pc_(0), num_frames_(0), cur_depth_(0),
-      context_(context) {
+      vreg_registers_vmap_table_(NULL), vreg_registers_core_spills_(0),
+      vreg_registers_fp_spills_(0), context_(context) {
   DCHECK(thread == Thread::Current() || thread->IsSuspended()) << *thread;
 }
 
@@ -136,14 +137,10 @@ uint32_t StackVisitor::GetVReg(mirror::ArtMethod* m, uint16_t vreg, VRegKind kin
   if (cur_quick_frame_ != NULL) {
     DCHECK(context_ != NULL);  // You can't reliably read registers without a context.
     DCHECK(m == GetMethod());
-    const VmapTable vmap_table(m->GetVmapTable());
-    uint32_t vmap_offset;
-    // TODO: IsInContext stops before spotting floating point registers.
-    if (vmap_table.IsInContext(vreg, kind, &vmap_offset)) {
-      bool is_float = (kind == kFloatVReg) || (kind == kDoubleLoVReg) || (kind == kDoubleHiVReg);
-      uint32_t spill_mask = is_float ? m->GetFpSpillMask()
-                                     : m->GetCoreSpillMask();
-      return GetGPR(vmap_table.ComputeRegister(spill_mask, vmap_offset, kind));
+    uint32_t reg;
+    // TODO: floating point registers are read as GPRs.
+    if (GetVRegRegister(m, vreg, kind, &reg)) {
+      return GetGPR(reg);
     } else {
       const DexFile::CodeItem* code_item = MethodHelper(m).GetCodeItem();
       DCHECK(code_item != NULL) << PrettyMethod(m);  // Can't be NULL or how would we compile its instructions?
@@ -161,13 +158,9 @@ void StackVisitor::SetVReg(mirror::ArtMethod* m, uint16_t vreg, uint32_t new_val
   if (cur_quick_frame_ != NULL) {
     DCHECK(context_ != NULL);  // You can't reliably write registers without a context.
     DCHECK(m == GetMethod());
-    const VmapTable vmap_table(m->GetVmapTable());
-    uint32_t vmap_offset;
-    // TODO: IsInContext stops before spotting floating point registers.
-    if (vmap_table.IsInContext(vreg, kind, &vmap_offset)) {
-      bool is_float = (kind == kFloatVReg) || (kind == kDoubleLoVReg) || (kind == kDoubleHiVReg);
-      uint32_t spill_mask = is_float ? m->GetFpSpillMask() : m->GetCoreSpillMask();
-      const uint32_t reg = vmap_table.ComputeRegister(spill_mask, vmap_offset, kReferenceVReg);
+    uint32_t reg;
+    // TODO: floating point registers are written as GPRs.
+    if (GetVRegRegister(m, vreg, kind, &reg)) {
       SetGPR(reg, new_value);
     } else {
       const DexFile::CodeItem* code_item = MethodHelper(m).GetCodeItem();
@@ -184,6 +177,34 @@ void StackVisitor::SetVReg(mirror::ArtMethod* m, uint16_t vreg, uint32_t new_val
   }
 }
 
+bool StackVisitor::GetVRegRegister(mirror::ArtMethod* m, uint16_t vreg, VRegKind kind,
+                                   uint32_t* reg) const {
+  DCHECK(kind == kReferenceVReg || kind == kIntVReg || kind == kFloatVReg ||
+         kind == kLongLoVReg || kind == kLongHiVReg || kind == kDoubleLoVReg ||
+         kind == kDoubleHiVReg || kind == kImpreciseConstant);
+  const uint8_t* vmap_table = m->GetVmapTable();
+  uint32_t core_spills = m->GetCoreSpillMask();
+  uint32_t fp_spills = m->GetFpSpillMask();
+  // Deduplicated vmap tables may be shared by methods with other spill masks.
+  if (vmap_table != vreg_registers_vmap_table_ || core_spills != vreg_registers_core_spills_ ||
+      fp_spills != vreg_registers_fp_spills_) {
+    VmapTable(vmap_table).DecodeRegisters(core_spills, fp_spills, &core_vreg_registers_,
+                                          &fp_vreg_registers_);
+    vreg_registers_vmap_table_ = vmap_table;
+    vreg_registers_core_spills_ = core_spills;
+    vreg_registers_fp_spills_ = fp_spills;
+  }
+  // TODO: we treat kImpreciseConstant as an integer, need to ensure that such values are never
+  //       promoted to floating point registers.
+  bool is_float = (kind == kFloatVReg) || (kind == kDoubleLoVReg) || (kind == kDoubleHiVReg);
+  const std::vector<uint8_t>& registers = is_float ? fp_vreg_registers_ : core_vreg_registers_;
+  if (vreg >= registers.size() || registers[vreg] == VmapTable::kNoRegister) {
+    return false;
+  }
+  *reg = registers[vreg];
+  return true;
+}
+
 uintptr_t StackVisitor::GetGPR(uint32_t reg) const {
   DCHECK(cur_quick_frame_ != NULL) << "This is a quick frame routine";
   return context_->GetGPR(reg);
@@ -208,6 +229,77 @@ void StackVisitor::SetReturnPc(uintptr_t new_ret_pc) {
   *reinterpret_cast<uintptr_t*>(pc_addr) = new_ret_pc;
 }
 
+// Returns the frame PC of a compiled frame of method at pc.
+static uint32_t QuickFramePc(const mirror::ArtMethod* method, uintptr_t pc)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  if (method->IsProxyMethod()) {
+    return DexFile::kDexNoIndex;
+  }
+#if !defined(ART_USE_PORTABLE_COMPILER)
+  size_t native_pc_offset = method->NativePcOffset(pc);
+  DCHECK_EQ(native_pc_offset & StackVisitor::kNativePcOffsetFlag, 0U);
+  return native_pc_offset | StackVisitor::kNativePcOffsetFlag;
+#else
+  return method->ToDexPc(pc);
+#endif
+}
+
+uint32_t StackVisitor::GetFramePc() const {
+  if (cur_quick_frame_ != NULL) {
+    return QuickFramePc(GetMethod(), cur_quick_frame_pc_);
+  }
+  return GetMethod()->IsProxyMethod() ? DexFile::kDexNoIndex : GetDexPc();
+}
+
+uint32_t StackVisitor::FramePcToDexPc(const mirror::ArtMethod* method, uint32_t frame_pc) {
+  if ((frame_pc & kNativePcOffsetFlag) == 0 || frame_pc == DexFile::kDexNoIndex) {
+    return frame_pc;
+  }
+  return method->NativePcOffsetToDexPc(frame_pc & ~kNativePcOffsetFlag);
+}
+
+bool StackVisitor::WalkStackFast(Thread* thread, size_t max_depth,
+                                 const mirror::ArtMethod** methods, uint32_t* frame_pcs,
+                                 size_t* depth) {
+  DCHECK(thread == Thread::Current() || thread->IsSuspended());
+  *depth = 0;
+  if (Runtime::Current()->GetInstrumentation()->AreExitStubsInstalled()) {
+    return false;
+  }
+  size_t count = 0;
+  for (const ManagedStack* fragment = thread->GetManagedStack();
+       fragment != NULL && count < max_depth; fragment = fragment->GetLink()) {
+    mirror::ArtMethod** quick_frame = fragment->GetTopQuickFrame();
+    if (quick_frame != NULL) {
+      uintptr_t pc = fragment->GetTopQuickFramePc();
+      for (mirror::ArtMethod* method = *quick_frame; method != NULL && count < max_depth;
+           method = *quick_frame) {
+        if (!method->IsRuntimeMethod()) {
+          methods[count] = method;
+          frame_pcs[count] = QuickFramePc(method, pc);
+          ++count;
+        }
+        byte* frame = reinterpret_cast<byte*>(quick_frame);
+        pc = *reinterpret_cast<uintptr_t*>(frame + method->GetReturnPcOffsetInBytes());
+        quick_frame = reinterpret_cast<mirror::ArtMethod**>(frame + method->GetFrameSizeInBytes());
+      }
+    } else {
+      for (ShadowFrame* shadow_frame = fragment->GetTopShadowFrame();
+           shadow_frame != NULL && count < max_depth; shadow_frame = shadow_frame->GetLink()) {
+        mirror::ArtMethod* method = shadow_frame->GetMethod();
+        if (!method->IsRuntimeMethod()) {
+          methods[count] = method;
+          frame_pcs[count] = method->IsProxyMethod() ? DexFile::kDexNoIndex
+                                                     : shadow_frame->GetDexPC();
+          ++count;
+        }
+      }
+    }
+  }
+  *depth = count;
+  return true;
+}
+
 size_t StackVisitor::ComputeNumFrames(Thread* thread) {
   struct NumFramesVisitor : public StackVisitor {
     explicit NumFramesVisitor(Thread* thread)
@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace art {
 
@@ -162,6 +163,18 @@ class ShadowFrame {
     return &vregs_[i];
   }
 
+  // Copies count vregs of from starting at src to the vregs starting at dest, references included,
+  // whatever their types.
+  void CopyVRegs(size_t dest, const ShadowFrame& from, size_t src, size_t count) {
+    DCHECK_LE(dest + count, NumberOfVRegs());
+    DCHECK_LE(src + count, from.NumberOfVRegs());
+    DCHECK_EQ(HasReferenceArray(), from.HasReferenceArray());
+    memcpy(&vregs_[dest], &from.vregs_[src], count * sizeof(uint32_t));
+    if (HasReferenceArray()) {
+      memcpy(&References()[dest], &from.References()[src], count * sizeof(mirror::Object*));
+    }
+  }
+
   void SetVReg(size_t i, int32_t val) {
     DCHECK_LT(i, NumberOfVRegs());
     uint32_t* vreg = &vregs_[i];
@@ -422,6 +435,15 @@ class StackVisitor {
 
   size_t GetNativePcOffset() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Frame PCs are dex PCs, except for compiled frames which record their native PC offset tagged
+  // with kNativePcOffsetFlag. This leaves decoding the mapping table until the dex PC is needed.
+  static const uint32_t kNativePcOffsetFlag = 0x80000000;
+
+  uint32_t GetFramePc() const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  static uint32_t FramePcToDexPc(const mirror::ArtMethod* method, uint32_t frame_pc)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   uintptr_t* CalleeSaveAddress(int num, size_t frame_size) const {
     // Callee saves are held at the top of the frame
     DCHECK(GetMethod() != NULL);
@@ -459,6 +481,12 @@ class StackVisitor {
   uintptr_t GetGPR(uint32_t reg) const;
   void SetGPR(uint32_t reg, uintptr_t value);
 
+  // Whether the vreg of m, the method of the current quick frame, is in a register rather than on
+  // the stack, setting reg to it. The vmap table of the method is decoded on the first call for
+  // its frame, rather than scanned for every vreg.
+  bool GetVRegRegister(mirror::ArtMethod* m, uint16_t vreg, VRegKind kind, uint32_t* reg) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   uint32_t GetVReg(mirror::ArtMethod** cur_quick_frame, const DexFile::CodeItem* code_item,
                    uint32_t core_spills, uint32_t fp_spills, size_t frame_size,
                    uint16_t vreg) const {
@@ -553,6 +581,15 @@ class StackVisitor {
 
   static void DescribeStack(Thread* thread) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Records the methods and frame PCs of at most max_depth of the innermost frames of thread,
+  // skipping runtime methods, and sets depth to the number recorded. Meant for samplers, this
+  // only follows the frame sizes and return PCs of compiled frames and the links of shadow frames,
+  // without a context or a virtual call per frame. Returns false, having recorded nothing, when
+  // instrumentation exit stubs hide the return PCs and WalkStack has to be used instead.
+  static bool WalkStackFast(Thread* thread, size_t max_depth, const mirror::ArtMethod** methods,
+                            uint32_t* frame_pcs, size_t* depth)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
  private:
   instrumentation::InstrumentationStackFrame GetInstrumentationStackFrame(uint32_t depth) const;
 
@@ -566,6 +603,12 @@ class StackVisitor {
   size_t num_frames_;
   // Depth of the frame we're currently at.
   size_t cur_depth_;
+  // The registers of the vregs for the last vmap table and spill masks GetVRegRegister was given.
+  mutable const uint8_t* vreg_registers_vmap_table_;
+  mutable uint32_t vreg_registers_core_spills_;
+  mutable uint32_t vreg_registers_fp_spills_;
+  mutable std::vector<uint8_t> core_vreg_registers_;
+  mutable std::vector<uint8_t> fp_vreg_registers_;
 
  protected:
   Context* const context_;
@@ -21,9 +21,17 @@
 
 #include "base/mutex-inl.h"
 #include "cutils/atomic-inline.h"
+#include "utils.h"
 
 namespace art {
 
+// The threads that revoke biased shares of mutator_lock_ wait for their release on a futex.
+#if ART_USE_FUTEXES
+static constexpr bool kUseBiasedMutatorLockShares = true;
+#else
+static constexpr bool kUseBiasedMutatorLockShares = false;
+#endif
+
 inline ThreadState Thread::SetState(ThreadState new_state) {
   // Cannot use this code to change into Runnable as changing to Runnable should fail if
   // old_state_and_flags.suspend_request is true.
@@ -78,8 +86,31 @@ inline void Thread::TransitionFromRunnableToSuspended(ThreadState new_state) {
   if (UNLIKELY((flag_change & kCheckpointRequest) != 0)) {
     RunCheckpointFunction();
   }
+  if (UNLIKELY((new_state_and_flags.as_struct.flags & kSuspendRequest) != 0)) {
+    suspend_request_honored_ns_ = NanoTime();
+  }
   // Release share on mutator_lock_.
-  Locks::mutator_lock_->SharedUnlock(this);
+  if (kUseBiasedMutatorLockShares) {
+    Locks::mutator_lock_->UnregisterBiasedShare(this);
+    ReleaseBiasedMutatorLockShare();
+  } else {
+    Locks::mutator_lock_->SharedUnlock(this);
+  }
+}
+
+inline void Thread::ReleaseBiasedMutatorLockShare() {
+#if ART_USE_FUTEXES
+  // Publishes the writes made while Runnable to the thread that sees the release.
+  int32_t share;
+  do {
+    share = biased_mutator_lock_share_;
+    DCHECK_NE(share, kNoBiasedShare);
+  } while (UNLIKELY(android_atomic_release_cas(share, kNoBiasedShare,
+                                               &biased_mutator_lock_share_) != 0));
+  if (UNLIKELY(share == kBiasedShareRevoked)) {
+    futex(&biased_mutator_lock_share_, FUTEX_WAKE, -1, NULL, NULL, 0);
+  }
+#endif
 }
 
 inline ThreadState Thread::TransitionFromSuspendedToRunnable() {
@@ -105,20 +136,44 @@ inline ThreadState Thread::TransitionFromSuspendedToRunnable() {
       DCHECK_EQ(GetSuspendCount(), 0);
     }
     // Re-acquire shared mutator_lock_ access.
-    Locks::mutator_lock_->SharedLock(this);
+    if (kUseBiasedMutatorLockShares) {
+      // Order the bias before the read of the suspend request by the CAS below. A thread requesting
+      // the suspension of this one orders its request before its read of the bias, so either this
+      // thread sees the request or that one sees the bias.
+      biased_mutator_lock_share_ = kBiasedShare;
+      ANDROID_MEMBAR_FULL();
+    } else {
+      Locks::mutator_lock_->SharedLock(this);
+    }
     // Atomically change from suspended to runnable if no suspend request pending.
     old_state_and_flags = state_and_flags_;
     DCHECK_EQ(old_state_and_flags.as_struct.state, old_state);
     if (LIKELY((old_state_and_flags.as_struct.flags & kSuspendRequest) == 0)) {
       union StateAndFlags new_state_and_flags = old_state_and_flags;
       new_state_and_flags.as_struct.state = kRunnable;
-      // CAS the value without a memory barrier, that occurred in the lock above.
-      done = android_atomic_cas(old_state_and_flags.as_int, new_state_and_flags.as_int,
-                                &state_and_flags_.as_int) == 0;
+      if (kUseBiasedMutatorLockShares) {
+        // Sees the writes of the last exclusive owner, which it published in releasing the lock.
+        done = android_atomic_acquire_cas(old_state_and_flags.as_int, new_state_and_flags.as_int,
+                                          &state_and_flags_.as_int) == 0;
+      } else {
+        // CAS the value without a memory barrier, that occurred in the lock above.
+        done = android_atomic_cas(old_state_and_flags.as_int, new_state_and_flags.as_int,
+                                  &state_and_flags_.as_int) == 0;
+      }
+    }
+    if (LIKELY(done)) {
+      roots_marked_while_suspended_ = false;
+      if (kUseBiasedMutatorLockShares) {
+        Locks::mutator_lock_->RegisterBiasedShare(this);
+      }
     }
     if (UNLIKELY(!done)) {
       // Failed to transition to Runnable. Release shared mutator_lock_ access and try again.
-      Locks::mutator_lock_->SharedUnlock(this);
+      if (kUseBiasedMutatorLockShares) {
+        ReleaseBiasedMutatorLockShare();
+      } else {
+        Locks::mutator_lock_->SharedUnlock(this);
+      }
     }
   } while (UNLIKELY(!done));
   return static_cast<ThreadState>(old_state);
@@ -20,6 +20,7 @@
 
 #include <cutils/trace.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <sys/resource.h>
 #include <sys/time.h>
@@ -29,9 +30,11 @@
 #include <cerrno>
 #include <iostream>
 #include <list>
+#include <sstream>
 
 #include "arch/context.h"
 #include "base/mutex.h"
+#include "catch_handler_cache.h"
 #include "class_linker.h"
 #include "class_linker-inl.h"
 #include "cutils/atomic.h"
@@ -52,6 +55,7 @@
 #include "mirror/object_array-inl.h"
 #include "mirror/stack_trace_element.h"
 #include "monitor.h"
+#include "native_thread_pool.h"
 #include "object_utils.h"
 #include "reflection.h"
 #include "runtime.h"
@@ -63,10 +67,10 @@
 #include "stack_indirect_reference_table.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "transaction.h"
 #include "utils.h"
 #include "verifier/dex_gc_map.h"
 #include "verifier/method_verifier.h"
-#include "vmap_table.h"
 #include "well_known_classes.h"
 
 namespace art {
@@ -257,13 +261,22 @@ void Thread::CreateNativeThread(JNIEnv* env, jobject java_peer, size_t stack_siz
   env->SetIntField(java_peer, WellKnownClasses::java_lang_Thread_nativePeer,
                    reinterpret_cast<jint>(child_thread));
 
-  pthread_t new_pthread;
-  pthread_attr_t attr;
-  CHECK_PTHREAD_CALL(pthread_attr_init, (&attr), "new thread");
-  CHECK_PTHREAD_CALL(pthread_attr_setdetachstate, (&attr, PTHREAD_CREATE_DETACHED), "PTHREAD_CREATE_DETACHED");
-  CHECK_PTHREAD_CALL(pthread_attr_setstacksize, (&attr, stack_size), stack_size);
-  int pthread_create_result = pthread_create(&new_pthread, &attr, Thread::CreateCallback, child_thread);
-  CHECK_PTHREAD_CALL(pthread_attr_destroy, (&attr), "new thread");
+  int pthread_create_result;
+  NativeThreadPool* native_thread_pool = runtime->GetNativeThreadPool();
+  if (native_thread_pool != NULL) {
+    pthread_create_result = native_thread_pool->Start(Thread::CreateCallback, child_thread,
+                                                      stack_size);
+  } else {
+    pthread_t new_pthread;
+    pthread_attr_t attr;
+    CHECK_PTHREAD_CALL(pthread_attr_init, (&attr), "new thread");
+    CHECK_PTHREAD_CALL(pthread_attr_setdetachstate, (&attr, PTHREAD_CREATE_DETACHED),
+                       "PTHREAD_CREATE_DETACHED");
+    CHECK_PTHREAD_CALL(pthread_attr_setstacksize, (&attr, stack_size), stack_size);
+    pthread_create_result = pthread_create(&new_pthread, &attr, Thread::CreateCallback,
+                                           child_thread);
+    CHECK_PTHREAD_CALL(pthread_attr_destroy, (&attr), "new thread");
+  }
 
   if (pthread_create_result != 0) {
     // pthread_create(3) failed, so clean up.
@@ -560,19 +573,87 @@ void Thread::ModifySuspendCount(Thread* self, int delta, bool for_debugger) {
     AtomicClearFlag(kSuspendRequest);
   } else {
     AtomicSetFlag(kSuspendRequest);
+    TriggerSuspend();
   }
 }
 
 void Thread::RunCheckpointFunction() {
-  CHECK(checkpoint_function_ != NULL);
+  Closure* checkpoints[kMaxCheckpoints];
+  // Take the pending checkpoints and clear the request flag under the lock, so a checkpoint
+  // requested while we run these isn't lost.
+  {
+    MutexLock mu(this, *Locks::thread_suspend_count_lock_);
+    for (size_t i = 0; i < kMaxCheckpoints; ++i) {
+      checkpoints[i] = checkpoint_functions_[i];
+      checkpoint_functions_[i] = NULL;
+    }
+    AtomicClearFlag(kCheckpointRequest);
+  }
+  bool found_checkpoint = false;
   ATRACE_BEGIN("Checkpoint function");
-  checkpoint_function_->Run(this);
+  for (size_t i = 0; i < kMaxCheckpoints; ++i) {
+    if (checkpoints[i] != NULL) {
+      checkpoints[i]->Run(this);
+      found_checkpoint = true;
+    }
+  }
   ATRACE_END();
+  CHECK(found_checkpoint);
+}
+
+bool Thread::WaitForBiasedMutatorLockShareRelease(uint64_t deadline_ns) {
+#if ART_USE_FUTEXES
+  while (true) {
+    int32_t share = biased_mutator_lock_share_;
+    if (share == kNoBiasedShare) {
+      // Sees the writes this thread made while Runnable.
+      ANDROID_MEMBAR_FULL();
+      return true;
+    }
+    if (share == kBiasedShare &&
+        android_atomic_cas(kBiasedShare, kBiasedShareRevoked, &biased_mutator_lock_share_) != 0) {
+      continue;  // Released or revoked in the meantime.
+    }
+    timespec timeout;
+    timespec* timeout_ptr = NULL;
+    if (deadline_ns != 0) {
+      uint64_t now_ns = NanoTime();
+      if (now_ns >= deadline_ns) {
+        return false;
+      }
+      uint64_t wait_ns = deadline_ns - now_ns;
+      InitTimeSpec(false, CLOCK_MONOTONIC, wait_ns / 1000000, wait_ns % 1000000, &timeout);
+      timeout_ptr = &timeout;
+    }
+    if (futex(&biased_mutator_lock_share_, FUTEX_WAIT, kBiasedShareRevoked, timeout_ptr, NULL,
+              0) != 0) {
+      if (errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+        PLOG(FATAL) << "futex wait failed for the biased mutator lock share of " << *this;
+      }
+    }
+  }
+#else
+  UNUSED(deadline_ns);
+  return true;
+#endif
 }
 
 bool Thread::RequestCheckpoint(Closure* function) {
-  CHECK(!ReadFlag(kCheckpointRequest)) << "Already have a pending checkpoint request";
-  checkpoint_function_ = function;
+  Locks::thread_suspend_count_lock_->AssertHeld(Thread::Current());
+  if (GetState() != kRunnable) {
+    return false;  // The thread is suspended and can't run a checkpoint.
+  }
+  size_t available_checkpoint = kMaxCheckpoints;
+  for (size_t i = 0; i < kMaxCheckpoints; ++i) {
+    if (checkpoint_functions_[i] == NULL) {
+      available_checkpoint = i;
+      break;
+    }
+  }
+  if (available_checkpoint == kMaxCheckpoints) {
+    return false;  // All slots are taken, the caller retries.
+  }
+  checkpoint_functions_[available_checkpoint] = function;
   union StateAndFlags old_state_and_flags = state_and_flags_;
   // We must be runnable to request a checkpoint.
   old_state_and_flags.as_struct.state = kRunnable;
@@ -580,6 +661,12 @@ bool Thread::RequestCheckpoint(Closure* function) {
   new_state_and_flags.as_struct.flags |= kCheckpointRequest;
   int succeeded = android_atomic_cmpxchg(old_state_and_flags.as_int, new_state_and_flags.as_int,
                                          &state_and_flags_.as_int);
+  if (UNLIKELY(succeeded != 0)) {
+    // The thread changed state or flags, take the function back.
+    checkpoint_functions_[available_checkpoint] = NULL;
+  } else {
+    TriggerSuspend();
+  }
   return succeeded == 0;
 }
 
@@ -775,62 +862,91 @@ void Thread::DumpState(std::ostream& os) const {
   Thread::DumpState(os, this, GetTid());
 }
 
-struct StackDumpVisitor : public StackVisitor {
-  StackDumpVisitor(std::ostream& os, Thread* thread, Context* context, bool can_allocate)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
-      : StackVisitor(thread, context), os(os), thread(thread), can_allocate(can_allocate),
-        last_method(NULL), last_line_number(0), repetition_count(0), frame_count(0) {
+// Prints the "at" lines of the managed frames of a stack, outermost last, eliding recursion.
+class StackFramePrinter {
+ public:
+  explicit StackFramePrinter(std::ostream& os)
+      : os_(os), last_method_(NULL), last_line_number_(0), repetition_count_(0), frame_count_(0) {
   }
 
-  virtual ~StackDumpVisitor() {
-    if (frame_count == 0) {
-      os << "  (no managed stack frames)\n";
+  ~StackFramePrinter() {
+    if (frame_count_ == 0) {
+      os_ << "  (no managed stack frames)\n";
     }
   }
 
-  bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    mirror::ArtMethod* m = GetMethod();
-    if (m->IsRuntimeMethod()) {
-      return true;
-    }
+  // Returns false if the frame is elided as a repetition of the previous ones.
+  bool PrintFrame(mirror::ArtMethod* m, uint32_t dex_pc)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     const int kMaxRepetition = 3;
     mirror::Class* c = m->GetDeclaringClass();
     const mirror::DexCache* dex_cache = c->GetDexCache();
     int line_number = -1;
     if (dex_cache != NULL) {  // be tolerant of bad input
       const DexFile& dex_file = *dex_cache->GetDexFile();
-      line_number = dex_file.GetLineNumFromPC(m, GetDexPc());
+      line_number = dex_file.GetLineNumFromPC(m, dex_pc);
     }
-    if (line_number == last_line_number && last_method == m) {
-      repetition_count++;
+    if (line_number == last_line_number_ && last_method_ == m) {
+      repetition_count_++;
     } else {
-      if (repetition_count >= kMaxRepetition) {
-        os << "  ... repeated " << (repetition_count - kMaxRepetition) << " times\n";
+      if (repetition_count_ >= kMaxRepetition) {
+        os_ << "  ... repeated " << (repetition_count_ - kMaxRepetition) << " times\n";
       }
-      repetition_count = 0;
-      last_line_number = line_number;
-      last_method = m;
-    }
-    if (repetition_count < kMaxRepetition) {
-      os << "  at " << PrettyMethod(m, false);
-      if (m->IsNative()) {
-        os << "(Native method)";
-      } else {
-        mh.ChangeMethod(m);
-        const char* source_file(mh.GetDeclaringClassSourceFile());
-        os << "(" << (source_file != NULL ? source_file : "unavailable")
-           << ":" << line_number << ")";
-      }
-      os << "\n";
-      if (frame_count == 0) {
+      repetition_count_ = 0;
+      last_line_number_ = line_number;
+      last_method_ = m;
+    }
+    ++frame_count_;
+    if (repetition_count_ >= kMaxRepetition) {
+      return false;
+    }
+    os_ << "  at " << PrettyMethod(m, false);
+    if (m->IsNative()) {
+      os_ << "(Native method)";
+    } else {
+      mh_.ChangeMethod(m);
+      const char* source_file(mh_.GetDeclaringClassSourceFile());
+      os_ << "(" << (source_file != NULL ? source_file : "unavailable")
+          << ":" << line_number << ")";
+    }
+    os_ << "\n";
+    return true;
+  }
+
+  int FrameCount() const {
+    return frame_count_;
+  }
+
+ private:
+  std::ostream& os_;
+  MethodHelper mh_;
+  mirror::ArtMethod* last_method_;
+  int last_line_number_;
+  int repetition_count_;
+  int frame_count_;
+};
+
+struct StackDumpVisitor : public StackVisitor {
+  StackDumpVisitor(std::ostream& os, Thread* thread, Context* context, bool can_allocate)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : StackVisitor(thread, context), os(os), thread(thread), can_allocate(can_allocate),
+        printer(os) {
+  }
+
+  bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    mirror::ArtMethod* m = GetMethod();
+    if (m->IsRuntimeMethod()) {
+      return true;
+    }
+    bool first_frame = printer.FrameCount() == 0;
+    if (printer.PrintFrame(m, GetDexPc())) {
+      if (first_frame) {
         Monitor::DescribeWait(os, thread);
       }
       if (can_allocate) {
         Monitor::VisitLocks(this, DumpLockedObject, &os);
       }
     }
-
-    ++frame_count;
     return true;
   }
 
@@ -843,11 +959,24 @@ struct StackDumpVisitor : public StackVisitor {
   std::ostream& os;
   const Thread* thread;
   const bool can_allocate;
-  MethodHelper mh;
-  mirror::ArtMethod* last_method;
-  int last_line_number;
-  int repetition_count;
-  int frame_count;
+  StackFramePrinter printer;
+};
+
+struct StackCaptureVisitor : public StackVisitor {
+  StackCaptureVisitor(Thread* thread, CapturedThreadDump* dump)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
+      : StackVisitor(thread, NULL), dump(dump) {
+  }
+
+  bool VisitFrame() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    mirror::ArtMethod* m = GetMethod();
+    if (!m->IsRuntimeMethod()) {
+      dump->frames.push_back(std::make_pair(m, GetDexPc()));
+    }
+    return true;
+  }
+
+  CapturedThreadDump* const dump;
 };
 
 static bool ShouldShowNativeStack(const Thread* thread)
@@ -892,6 +1021,36 @@ void Thread::DumpStack(std::ostream& os) const {
   }
 }
 
+void Thread::CaptureForDump(CapturedThreadDump* dump) const {
+  DCHECK(this == Thread::Current() || IsSuspended());
+  dump->thin_lock_id = GetThinLockId();
+  dump->tid = GetTid();
+  std::ostringstream state;
+  DumpState(state);
+  dump->state = state.str();
+  std::ostringstream wait;
+  Monitor::DescribeWait(wait, this);
+  dump->wait = wait.str();
+  dump->dump_native_stack = ShouldShowNativeStack(this);
+  StackCaptureVisitor visitor(const_cast<Thread*>(this), dump);
+  visitor.WalkStack();
+}
+
+void Thread::DumpCaptured(std::ostream& os, const CapturedThreadDump& dump) {
+  os << dump.state;
+  // The native stack has moved on since the capture, it is as of now.
+  if (dump.dump_native_stack) {
+    DumpKernelStack(os, dump.tid, "  kernel: ", false);
+    DumpNativeStack(os, dump.tid, "  native: ", false);
+  }
+  StackFramePrinter printer(os);
+  for (size_t i = 0; i < dump.frames.size(); ++i) {
+    if (printer.PrintFrame(dump.frames[i].first, dump.frames[i].second) && i == 0) {
+      os << dump.wait;
+    }
+  }
+}
+
 void Thread::ThreadExitCallback(void* arg) {
   Thread* self = reinterpret_cast<Thread*>(arg);
   if (self->thread_exit_check_count_ == 0) {
@@ -955,6 +1114,7 @@ Thread::Thread(bool daemon)
       card_table_(NULL),
       exception_(NULL),
       stack_end_(NULL),
+      suspend_trigger_(reinterpret_cast<uintptr_t*>(&suspend_trigger_)),
       managed_stack_(),
       jni_env_(NULL),
       self_(NULL),
@@ -986,12 +1146,45 @@ Thread::Thread(bool daemon)
       pthread_self_(0),
       no_thread_suspension_(0),
       last_no_thread_suspension_cause_(NULL),
-      checkpoint_function_(0),
-      thread_exit_check_count_(0) {
+      roots_marked_while_suspended_(false),
+      suspend_request_honored_ns_(0),
+      biased_mutator_lock_share_(kNoBiasedShare),
+      tlab_space_(NULL),
+      thread_local_alloc_stack_top_(NULL),
+      thread_local_alloc_stack_end_(NULL),
+      thread_exit_check_count_(0),
+      transaction_(NULL),
+      trace_buffer_(NULL),
+      allocation_sample_bytes_left_(0),
+      allocating_tenured_(false),
+      interpreter_cache_(NULL) {
   CHECK_EQ((sizeof(Thread) % 4), 0U) << sizeof(Thread);
   state_and_flags_.as_struct.flags = 0;
   state_and_flags_.as_struct.state = kNative;
   memset(&held_mutexes_[0], 0, sizeof(held_mutexes_));
+  memset(&checkpoint_functions_[0], 0, sizeof(checkpoint_functions_));
+  memset(&tlab_free_lists_[0], 0, sizeof(tlab_free_lists_));
+  memset(&rosalloc_runs_[0], 0, sizeof(rosalloc_runs_));
+  memset(&subtype_check_cache_[0], 0, sizeof(subtype_check_cache_));
+}
+
+void Thread::AddToInterpreterCache(const void* dex_instruction,
+                                   const mirror::Class* receiver_class, void* resolved) {
+  if (UNLIKELY(interpreter_cache_ == NULL)) {
+    interpreter_cache_ = new InterpreterCacheEntry[kInterpreterCacheSize];
+    memset(interpreter_cache_, 0, kInterpreterCacheSize * sizeof(InterpreterCacheEntry));
+  }
+  InterpreterCacheEntry& entry = interpreter_cache_[InterpreterCacheIndex(dex_instruction)];
+  entry.dex_instruction = dex_instruction;
+  entry.receiver_class = receiver_class;
+  entry.resolved = resolved;
+}
+
+void Thread::ClearClassCaches() {
+  memset(&subtype_check_cache_[0], 0, sizeof(subtype_check_cache_));
+  if (interpreter_cache_ != NULL) {
+    memset(interpreter_cache_, 0, kInterpreterCacheSize * sizeof(InterpreterCacheEntry));
+  }
 }
 
 bool Thread::IsStillStarting() const {
@@ -1053,6 +1246,9 @@ void Thread::Destroy() {
   if (jni_env_ != NULL) {
     jni_env_->monitors.VisitRoots(MonitorExitVisitor, self);
   }
+
+  // Hand the unused chunks of our thread-local allocation buffer back to the heap.
+  Runtime::Current()->GetHeap()->RevokeThreadLocalBuffers(self);
 }
 
 Thread::~Thread() {
@@ -1081,6 +1277,7 @@ Thread::~Thread() {
   delete instrumentation_stack_;
   delete name_;
   delete stack_trace_sample_;
+  delete[] interpreter_cache_;
 
   TearDownAlternateSignalStack();
 }
@@ -1219,6 +1416,24 @@ bool Thread::IsInterrupted() {
   return interrupted_;
 }
 
+bool Thread::SetAffinity(const std::vector<int>& cpus) {
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    CPU_SET(cpus[i], &cpu_set);
+  }
+  if (sched_setaffinity(GetTid(), sizeof(cpu_set), &cpu_set) != 0) {
+    PLOG(WARNING) << *this << " sched_setaffinity failed";
+    return false;
+  }
+  return true;
+#else
+  LOG(WARNING) << "Ignoring CPU affinity of " << *this;
+  return false;
+#endif
+}
+
 void Thread::Interrupt() {
   Thread* self = Thread::Current();
   MutexLock mu(self, *wait_mutex_);
@@ -1229,12 +1444,6 @@ void Thread::Interrupt() {
   NotifyLocked(self);
 }
 
-void Thread::Notify() {
-  Thread* self = Thread::Current();
-  MutexLock mu(self, *wait_mutex_);
-  NotifyLocked(self);
-}
-
 void Thread::NotifyLocked(Thread* self) {
   if (wait_monitor_ != NULL) {
     wait_cond_->Signal(self);
@@ -1332,7 +1541,8 @@ class BuildInternalStackTraceVisitor : public StackVisitor {
       return true;  // Ignore runtime frames (in particular callee save).
     }
     method_trace_->Set(count_, m);
-    dex_pc_trace_->Set(count_, m->IsProxyMethod() ? DexFile::kDexNoIndex : GetDexPc());
+    // Only decoded to a dex PC if the trace is looked at, most never are.
+    dex_pc_trace_->Set(count_, GetFramePc());
     ++count_;
     return true;
   }
@@ -1347,7 +1557,7 @@ class BuildInternalStackTraceVisitor : public StackVisitor {
   int32_t skip_depth_;
   // Current position down stack trace.
   uint32_t count_;
-  // Array of dex PC values.
+  // Array of frame PC values, see StackVisitor::GetFramePc.
   mirror::IntArray* dex_pc_trace_;
   // An array of the methods on the stack, the last entry is a reference to the PC trace.
   mirror::ObjectArray<mirror::Object>* method_trace_;
@@ -1422,7 +1632,7 @@ jobjectArray Thread::InternalStackTraceToStackTraceElementArray(JNIEnv* env, job
       // source_name_object intentionally left null for proxy methods
     } else {
       mirror::IntArray* pc_trace = down_cast<mirror::IntArray*>(method_trace->Get(depth));
-      uint32_t dex_pc = pc_trace->Get(i);
+      uint32_t dex_pc = StackVisitor::FramePcToDexPc(method, pc_trace->Get(i));
       line_number = mh.GetLineNumFromDexPC(dex_pc);
       // Allocate element, potentially triggering GC
       // TODO: reuse class_name_object via Class::name_?
@@ -1681,6 +1891,7 @@ static const EntryPointInfo gThreadEntryPointInfo[] = {
   QUICK_ENTRY_POINT_INFO(pIndexOf),
   QUICK_ENTRY_POINT_INFO(pMemcmp16),
   QUICK_ENTRY_POINT_INFO(pStringCompareTo),
+  QUICK_ENTRY_POINT_INFO(pStringEquals),
   QUICK_ENTRY_POINT_INFO(pMemcpy),
   QUICK_ENTRY_POINT_INFO(pQuickResolutionTrampoline),
   QUICK_ENTRY_POINT_INFO(pQuickToInterpreterBridge),
@@ -1716,6 +1927,7 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset, size_t size_of_
   DO_THREAD_OFFSET(jni_env_);
   DO_THREAD_OFFSET(self_);
   DO_THREAD_OFFSET(stack_end_);
+  DO_THREAD_OFFSET(suspend_trigger_);
   DO_THREAD_OFFSET(suspend_count_);
   DO_THREAD_OFFSET(thin_lock_id_);
   // DO_THREAD_OFFSET(top_of_managed_stack_);
@@ -1787,21 +1999,38 @@ class CatchBlockStackVisitor : public StackVisitor {
   }
 
   bool HandleTryItems(mirror::ArtMethod* method) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
-    uint32_t dex_pc = DexFile::kDexNoIndex;
     if (method->IsNative()) {
       native_method_count_++;
-    } else {
-      dex_pc = GetDexPc();
-    }
-    if (dex_pc != DexFile::kDexNoIndex) {
-      uint32_t found_dex_pc = method->FindCatchBlock(to_find_, dex_pc, &clear_exception_);
-      if (found_dex_pc != DexFile::kDexNoIndex) {
-        handler_dex_pc_ = found_dex_pc;
-        handler_quick_frame_pc_ = method->ToNativePc(found_dex_pc);
-        handler_quick_frame_ = GetCurrentQuickFrame();
-        return false;  // End stack walk.
+      return true;  // Continue stack walk.
+    }
+    // Handlers are cached per quick frame pc, skip the cache for shadow frames and while return
+    // pcs may be those of the instrumentation exit stub.
+    CatchHandlerCache* cache = Runtime::Current()->GetCatchHandlerCache();
+    const bool use_cache = GetCurrentQuickFrame() != NULL && !method_tracing_active_;
+    const uintptr_t pc = use_cache ? GetCurrentQuickFramePc() : 0;
+    CatchHandler handler;
+    if (!use_cache || !cache->Lookup(method, pc, to_find_, &handler)) {
+      handler.dex_pc = DexFile::kDexNoIndex;
+      handler.native_pc = 0;
+      handler.clear_exception = false;
+      uint32_t dex_pc = GetDexPc();
+      if (dex_pc != DexFile::kDexNoIndex) {
+        handler.dex_pc = method->FindCatchBlock(to_find_, dex_pc, &handler.clear_exception);
+        if (handler.dex_pc != DexFile::kDexNoIndex) {
+          handler.native_pc = method->ToNativePc(handler.dex_pc);
+        }
+      }
+      if (use_cache) {
+        cache->Add(method, pc, to_find_, handler);
       }
     }
+    if (handler.dex_pc != DexFile::kDexNoIndex) {
+      handler_dex_pc_ = handler.dex_pc;
+      handler_quick_frame_pc_ = handler.native_pc;
+      handler_quick_frame_ = GetCurrentQuickFrame();
+      clear_exception_ = handler.clear_exception;
+      return false;  // End stack walk.
+    }
     return true;  // Continue stack walk.
   }
 
@@ -2066,7 +2295,6 @@ class ReferenceMapVisitor : public StackVisitor {
         if (num_regs > 0) {
           const uint8_t* reg_bitmap = map.FindBitMap(GetNativePcOffset());
           DCHECK(reg_bitmap != NULL);
-          const VmapTable vmap_table(m->GetVmapTable());
           uint32_t core_spills = m->GetCoreSpillMask();
           uint32_t fp_spills = m->GetFpSpillMask();
           size_t frame_size = m->GetFrameSizeInBytes();
@@ -2076,12 +2304,10 @@ class ReferenceMapVisitor : public StackVisitor {
           for (size_t reg = 0; reg < num_regs; ++reg) {
             // Does this register hold a reference?
             if (TestBitmap(reg, reg_bitmap)) {
-              uint32_t vmap_offset;
+              uint32_t context_reg;
               mirror::Object* ref;
-              if (vmap_table.IsInContext(reg, kReferenceVReg, &vmap_offset)) {
-                uintptr_t val = GetGPR(vmap_table.ComputeRegister(core_spills, vmap_offset,
-                                                                  kReferenceVReg));
-                ref = reinterpret_cast<mirror::Object*>(val);
+              if (GetVRegRegister(m, reg, kReferenceVReg, &context_reg)) {
+                ref = reinterpret_cast<mirror::Object*>(GetGPR(context_reg));
               } else {
                 ref = reinterpret_cast<mirror::Object*>(GetVReg(cur_quick_frame, code_item,
                                                                 core_spills, fp_spills, frame_size,
@@ -2169,6 +2395,10 @@ void Thread::VerifyRoots(VerifyRootVisitor* visitor, void* arg) {
   }
   jni_env_->locals.VisitRoots(VerifyRootWrapperCallback, &wrapperArg);
   jni_env_->monitors.VisitRoots(VerifyRootWrapperCallback, &wrapperArg);
+  {
+    MutexLock mu(Thread::Current(), jni_env_->pins_lock);
+    jni_env_->pins.VisitRoots(VerifyRootWrapperCallback, &wrapperArg);
+  }
 
   SirtVisitRoots(VerifyRootWrapperCallback, &wrapperArg);
 
@@ -2204,6 +2434,10 @@ void Thread::VisitRoots(RootVisitor* visitor, void* arg) {
   }
   jni_env_->locals.VisitRoots(visitor, arg);
   jni_env_->monitors.VisitRoots(visitor, arg);
+  {
+    MutexLock mu(Thread::Current(), jni_env_->pins_lock);
+    jni_env_->pins.VisitRoots(visitor, arg);
+  }
 
   SirtVisitRoots(visitor, arg);
 
@@ -2222,6 +2456,9 @@ void Thread::VisitRoots(RootVisitor* visitor, void* arg) {
     mirror::ArtMethod* method = frame.method_;
     visitor(method, arg);
   }
+  if (transaction_ != NULL) {
+    transaction_->VisitRoots(visitor, arg);
+  }
 }
 
 static void VerifyObject(const mirror::Object* root, void* arg) {
@@ -24,6 +24,8 @@
 #include <iosfwd>
 #include <list>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/macros.h"
 #include "entrypoints/interpreter/interpreter_entrypoints.h"
@@ -57,6 +59,11 @@ namespace mirror {
   class StaticStorageBase;
   class Throwable;
 }  // namespace mirror
+namespace gc {
+namespace space {
+  class DlMallocSpace;
+}  // namespace space
+}  // namespace gc
 class BaseMutex;
 class ClassLinker;
 class Closure;
@@ -72,6 +79,7 @@ class ScopedObjectAccessUnchecked;
 class ShadowFrame;
 class Thread;
 class ThreadList;
+class Transaction;
 
 // Thread priorities. These must match the Thread.MIN_PRIORITY,
 // Thread.NORM_PRIORITY, and Thread.MAX_PRIORITY constants.
@@ -87,11 +95,30 @@ enum ThreadFlag {
   kCheckpointRequest = 2  // Request that the thread do some checkpoint work and then continue.
 };
 
+// What Thread::Dump prints of a thread, captured by CaptureForDump while the thread is stopped and
+// printed by DumpCaptured once it runs again, the expensive part of a dump being the printing.
+struct CapturedThreadDump {
+  uint32_t thin_lock_id;
+  pid_t tid;
+  // As printed by DumpState.
+  std::string state;
+  // As printed by Monitor::DescribeWait.
+  std::string wait;
+  bool dump_native_stack;
+  // The managed frames and their dex pcs, innermost first. Methods aren't unloaded while class
+  // unloading is blocked, see ClassLinker::BlockClassUnloading.
+  std::vector<std::pair<mirror::ArtMethod*, uint32_t> > frames;
+};
+
 class PACKED(4) Thread {
  public:
   // Space to throw a StackOverflowError in.
   static const size_t kStackOverflowReservedBytes = 16 * KB;
 
+  // Maximum number of checkpoint functions which may be pending at once, e.g. one from the GC and
+  // one from the sampling profiler.
+  static const size_t kMaxCheckpoints = 3;
+
   // Creates a new native thread corresponding to the given managed peer.
   // Used to implement Thread.start.
   static void CreateNativeThread(JNIEnv* env, jobject peer, size_t stack_size, bool daemon);
@@ -136,6 +163,14 @@ class PACKED(4) Thread {
       LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Captures what Dump prints, the thread being the current one or suspended. Unlike Dump, the
+  // objects locked by the frames aren't captured, finding them needs the verifier.
+  void CaptureForDump(CapturedThreadDump* dump) const
+      LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  static void DumpCaptured(std::ostream& os, const CapturedThreadDump& dump)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Dumps the SIGQUIT per-thread header. 'thread' can be NULL for a non-attached thread, in which
   // case we use 'tid' to identify the thread, and we'll include as much information as we can.
   static void DumpState(std::ostream& os, const Thread* thread, pid_t tid)
@@ -165,7 +200,8 @@ class PACKED(4) Thread {
   void ModifySuspendCount(Thread* self, int delta, bool for_debugger)
       EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_suspend_count_lock_);
 
-  bool RequestCheckpoint(Closure* function);
+  bool RequestCheckpoint(Closure* function)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_suspend_count_lock_);
 
   // Called when thread detected that the thread_suspend_count_ was non-zero. Gives up share of
   // mutator_lock_ and waits until it is resumed and thread_suspend_count_ is zero.
@@ -173,7 +209,10 @@ class PACKED(4) Thread {
       LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  // Transition from non-runnable to runnable state acquiring share on mutator_lock_.
+  // Transition from non-runnable to runnable state acquiring share on mutator_lock_. With futexes,
+  // the share is biased to this thread: it isn't counted by the lock word, which the runnable
+  // threads of a JNI-heavy app would otherwise all write to, and the exclusive owners are excluded
+  // by the suspend request they make instead, see ThreadList::WaitForBiasedMutatorLockShares.
   ThreadState TransitionFromSuspendedToRunnable()
       LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_)
       SHARED_LOCK_FUNCTION(Locks::mutator_lock_)
@@ -248,6 +287,10 @@ class PACKED(4) Thread {
    */
   static int GetNativePriority();
 
+  // Restricts this thread to run on the given CPUs. Returns false if the kernel refused, for
+  // example because none of the CPUs exist.
+  bool SetAffinity(const std::vector<int>& cpus);
+
   uint32_t GetThinLockId() const {
     return thin_lock_id_;
   }
@@ -283,6 +326,139 @@ class PACKED(4) Thread {
     return &stats_;
   }
 
+  // Number of size classes in the thread-local allocation buffer, see
+  // DlMallocSpace::AllocThreadLocal.
+  static constexpr size_t kTlabSizeClassCount = 16;
+
+  // The alloc space the chunks in the thread-local allocation buffer were carved from, or NULL if
+  // the buffer is empty.
+  gc::space::DlMallocSpace* GetTlabSpace() const {
+    return tlab_space_;
+  }
+
+  void SetTlabSpace(gc::space::DlMallocSpace* space) {
+    tlab_space_ = space;
+  }
+
+  // Pops a pre-allocated chunk of the given size class, returns NULL if there is none left.
+  void* PopTlabChunk(size_t size_class) {
+    DCHECK_LT(size_class, kTlabSizeClassCount);
+    void* chunk = tlab_free_lists_[size_class];
+    if (LIKELY(chunk != NULL)) {
+      tlab_free_lists_[size_class] = *reinterpret_cast<void**>(chunk);
+    }
+    return chunk;
+  }
+
+  // Pushes an unused chunk of the given size class onto the thread-local allocation buffer.
+  void PushTlabChunk(size_t size_class, void* chunk) {
+    DCHECK_LT(size_class, kTlabSizeClassCount);
+    *reinterpret_cast<void**>(chunk) = tlab_free_lists_[size_class];
+    tlab_free_lists_[size_class] = chunk;
+  }
+
+  // Pushes obj onto the segment of the allocation stack reserved for this thread, returns false
+  // once the segment is full.
+  bool PushOnThreadLocalAllocationStack(mirror::Object* obj) {
+    if (UNLIKELY(thread_local_alloc_stack_top_ >= thread_local_alloc_stack_end_)) {
+      return false;
+    }
+    *thread_local_alloc_stack_top_ = obj;
+    ++thread_local_alloc_stack_top_;
+    return true;
+  }
+
+  void SetThreadLocalAllocationStack(mirror::Object** start, mirror::Object** end) {
+    thread_local_alloc_stack_top_ = start;
+    thread_local_alloc_stack_end_ = end;
+  }
+
+  // Drops the segment, its unused slots stay NULL in the allocation stack. The thread must either
+  // be the caller or suspended.
+  void RevokeThreadLocalAllocationStack() {
+    SetThreadLocalAllocationStack(NULL, NULL);
+  }
+
+  // Number of size brackets for which a RosAllocSpace hands the thread its own run of slots, see
+  // RosAllocSpace::AllocNonvirtual.
+  static constexpr size_t kRosAllocThreadLocalBracketCount = 8;
+
+  // The thread-local run of the given size bracket, or NULL. The run belongs to the
+  // RosAllocSpace returned by GetTlabSpace.
+  void* GetRosAllocRun(size_t bracket_idx) const {
+    DCHECK_LT(bracket_idx, kRosAllocThreadLocalBracketCount);
+    return rosalloc_runs_[bracket_idx];
+  }
+
+  void SetRosAllocRun(size_t bracket_idx, void* run) {
+    DCHECK_LT(bracket_idx, kRosAllocThreadLocalBracketCount);
+    rosalloc_runs_[bracket_idx] = run;
+  }
+
+  // Positive results of the subtype checks of this thread, a direct-mapped cache which compiled
+  // code probes before calling the instanceof and check-cast entrypoints. Classes don't move and
+  // whether one is assignable from another never changes, so entries stay valid until the GC
+  // unloads classes, see ClearClassCaches.
+  struct SubtypeCheckCacheEntry {
+    const mirror::Class* sub_class;
+    const mirror::Class* super_class;
+  };
+
+  static constexpr size_t kSubtypeCheckCacheSize = 64;
+  // Class objects are 8-byte aligned, so the entry of a pair of classes is at the byte offset
+  // (sub_class ^ super_class) & kSubtypeCheckCacheMask, which compiled code computes inline.
+  static constexpr uint32_t kSubtypeCheckCacheMask =
+      (kSubtypeCheckCacheSize - 1) * sizeof(SubtypeCheckCacheEntry);
+
+  bool InSubtypeCheckCache(const mirror::Class* sub_class, const mirror::Class* super_class) const {
+    size_t index = SubtypeCheckCacheIndex(sub_class, super_class);
+    return subtype_check_cache_[index].sub_class == sub_class &&
+        subtype_check_cache_[index].super_class == super_class;
+  }
+
+  // Records that super_class is assignable from sub_class.
+  void AddToSubtypeCheckCache(const mirror::Class* sub_class, const mirror::Class* super_class) {
+    size_t index = SubtypeCheckCacheIndex(sub_class, super_class);
+    subtype_check_cache_[index].sub_class = sub_class;
+    subtype_check_cache_[index].super_class = super_class;
+  }
+
+  static ThreadOffset SubtypeCheckCacheOffset() {
+    return ThreadOffset(OFFSETOF_MEMBER(Thread, subtype_check_cache_));
+  }
+
+  // Fields and methods the field and invoke instructions interpreted by this thread resolved to, a
+  // direct-mapped cache keyed by the address of the instruction and, for virtual and interface
+  // invokes, by the class of the receiver. Classes don't move and a dex file stays mapped while
+  // its classes are loaded, so entries stay valid until the GC unloads classes, see
+  // ClearClassCaches. It is allocated by the first entry added, threads that only run compiled
+  // code don't have one.
+  struct InterpreterCacheEntry {
+    const void* dex_instruction;
+    const mirror::Class* receiver_class;
+    void* resolved;
+  };
+
+  static constexpr size_t kInterpreterCacheSize = 256;
+
+  // Returns what dex_instruction resolved to for receiver_class, NULL if it isn't cached.
+  void* FindInInterpreterCache(const void* dex_instruction,
+                               const mirror::Class* receiver_class) const {
+    if (interpreter_cache_ == NULL) {
+      return NULL;
+    }
+    const InterpreterCacheEntry& entry = interpreter_cache_[InterpreterCacheIndex(dex_instruction)];
+    return (entry.dex_instruction == dex_instruction && entry.receiver_class == receiver_class)
+        ? entry.resolved : NULL;
+  }
+
+  void AddToInterpreterCache(const void* dex_instruction, const mirror::Class* receiver_class,
+                             void* resolved);
+
+  // Empties the subtype check and interpreter caches, whose classes, methods and instructions may
+  // have been unloaded. Called by the GC with the thread suspended.
+  void ClearClassCaches();
+
   bool IsStillStarting() const;
 
   bool IsExceptionPending() const {
@@ -382,7 +558,6 @@ class PACKED(4) Thread {
   // Implements java.lang.Thread.isInterrupted.
   bool IsInterrupted();
   void Interrupt();
-  void Notify();
 
   mirror::ClassLoader* GetClassLoaderOverride() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     return class_loader_override_;
@@ -406,6 +581,17 @@ class PACKED(4) Thread {
 
   void VisitRoots(RootVisitor* visitor, void* arg) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Whether a GC checkpoint marked the roots of this thread on its behalf while it was suspended,
+  // and it hasn't been runnable since. Its roots are then still marked and the GC needn't visit
+  // them again. Cleared when the thread becomes runnable.
+  bool AreRootsMarkedWhileSuspended() const {
+    return roots_marked_while_suspended_;
+  }
+
+  void SetRootsMarkedWhileSuspended(bool marked) {
+    roots_marked_while_suspended_ = marked;
+  }
+
   void VerifyRoots(VerifyRootVisitor* visitor, void* arg)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
@@ -466,6 +652,21 @@ class PACKED(4) Thread {
     return ThreadOffset(OFFSETOF_MEMBER(Thread, stack_end_));
   }
 
+  // Makes the next implicit suspend check of compiled code fault, the fault handler then calls
+  // the suspend check entrypoint.
+  void TriggerSuspend() {
+    suspend_trigger_ = NULL;
+  }
+
+  // Lets implicit suspend checks pass again.
+  void RemoveSuspendTrigger() {
+    suspend_trigger_ = reinterpret_cast<uintptr_t*>(&suspend_trigger_);
+  }
+
+  static ThreadOffset SuspendTriggerOffset() {
+    return ThreadOffset(OFFSETOF_MEMBER(Thread, suspend_trigger_));
+  }
+
   static ThreadOffset JniEnvOffset() {
     return ThreadOffset(OFFSETOF_MEMBER(Thread, jni_env_));
   }
@@ -552,6 +753,14 @@ class PACKED(4) Thread {
     return instrumentation_stack_;
   }
 
+  Transaction* GetTransaction() const {
+    return transaction_;
+  }
+
+  void SetTransaction(Transaction* transaction) {
+    transaction_ = transaction;
+  }
+
   std::vector<mirror::ArtMethod*>* GetStackTraceSample() const {
     return stack_trace_sample_;
   }
@@ -560,6 +769,30 @@ class PACKED(4) Thread {
     stack_trace_sample_ = sample;
   }
 
+  std::vector<uint8_t>* GetTraceBuffer() const {
+    return trace_buffer_;
+  }
+
+  void SetTraceBuffer(std::vector<uint8_t>* buffer) {
+    trace_buffer_ = buffer;
+  }
+
+  size_t GetAllocationSampleBytesLeft() const {
+    return allocation_sample_bytes_left_;
+  }
+
+  void SetAllocationSampleBytesLeft(size_t bytes) {
+    allocation_sample_bytes_left_ = bytes;
+  }
+
+  bool IsAllocatingTenured() const {
+    return allocating_tenured_;
+  }
+
+  void SetAllocatingTenured(bool allocating_tenured) {
+    allocating_tenured_ = allocating_tenured;
+  }
+
   uint64_t GetTraceClockBase() const {
     return trace_clock_base_;
   }
@@ -596,8 +829,29 @@ class PACKED(4) Thread {
   typedef uint32_t bool32_t;
 
   explicit Thread(bool daemon);
+
+  static size_t SubtypeCheckCacheIndex(const mirror::Class* sub_class,
+                                       const mirror::Class* super_class) {
+    uintptr_t bits =
+        reinterpret_cast<uintptr_t>(sub_class) ^ reinterpret_cast<uintptr_t>(super_class);
+    return (bits & kSubtypeCheckCacheMask) / sizeof(SubtypeCheckCacheEntry);
+  }
+
+  // Dex instructions are 2-byte aligned.
+  static size_t InterpreterCacheIndex(const void* dex_instruction) {
+    return (reinterpret_cast<uintptr_t>(dex_instruction) >> 1) & (kInterpreterCacheSize - 1);
+  }
+
   ~Thread() LOCKS_EXCLUDED(Locks::mutator_lock_,
                            Locks::thread_suspend_count_lock_);
+
+  // Releases the biased share of mutator_lock_, waking a thread that revoked it.
+  void ReleaseBiasedMutatorLockShare() ALWAYS_INLINE;
+
+  // Called by a thread that requested the suspension of this one. Revokes the biased share of
+  // mutator_lock_ and waits for its release, returns false if it is still held at deadline_ns, 0
+  // for no deadline.
+  bool WaitForBiasedMutatorLockShareRelease(uint64_t deadline_ns);
   void Destroy();
   friend class ThreadList;  // For ~Thread and Destroy.
 
@@ -608,6 +862,9 @@ class PACKED(4) Thread {
   // Dbg::Disconnected.
   ThreadState SetStateUnsafe(ThreadState new_state) {
     ThreadState old_state = GetState();
+    if (new_state == kRunnable) {
+      roots_marked_while_suspended_ = false;
+    }
     state_and_flags_.as_struct.state = new_state;
     return old_state;
   }
@@ -692,6 +949,10 @@ class PACKED(4) Thread {
   // We leave extra space so there's room for the code that throws StackOverflowError.
   byte* stack_end_;
 
+  // Read through by the implicit suspend checks of compiled code. Points to itself, or is NULL
+  // when a suspend or checkpoint is requested so that the checks fault.
+  uintptr_t* suspend_trigger_;
+
   // The top of the managed stack often manipulated directly by compiler generated code.
   ManagedStack managed_stack_;
 
@@ -739,7 +1000,7 @@ class PACKED(4) Thread {
   Monitor* wait_monitor_ GUARDED_BY(wait_mutex_);
   // Thread "interrupted" status; stays raised until queried or thrown.
   bool32_t interrupted_ GUARDED_BY(wait_mutex_);
-  // The next thread in the wait set this thread is part of.
+  // The next thread in the wait set or wake set this thread is part of.
   Thread* wait_next_;
   // If we're blocked in MonitorEnter, this is the object we're trying to lock.
   mirror::Object* monitor_enter_object_;
@@ -797,8 +1058,41 @@ class PACKED(4) Thread {
   // Cause for last suspension.
   const char* last_no_thread_suspension_cause_;
 
-  // Pending checkpoint functions.
-  Closure* checkpoint_function_;
+  // See AreRootsMarkedWhileSuspended.
+  bool32_t roots_marked_while_suspended_;
+
+  // When this thread last released its share of the mutator_lock_ with a suspend request pending,
+  // read by ThreadList::SuspendAll to find the thread that was slowest to reach a safepoint.
+  uint64_t suspend_request_honored_ns_;
+
+  // Whether this thread holds its share of mutator_lock_ as a bias, and whether it was revoked by
+  // a thread waiting for it to be released. Only this thread takes and releases the bias.
+  enum BiasedShareState {
+    kNoBiasedShare = 0,
+    kBiasedShare = 1,
+    kBiasedShareRevoked = 2,
+  };
+  volatile int32_t biased_mutator_lock_share_;
+
+  // Pending checkpoint functions, guarded by thread_suspend_count_lock_.
+  Closure* checkpoint_functions_[kMaxCheckpoints];
+
+  // Thread-local allocation buffer. Chunks are allocated in bulk from tlab_space_ and linked
+  // through their first word into one free list per size class.
+  gc::space::DlMallocSpace* tlab_space_;
+  void* tlab_free_lists_[kTlabSizeClassCount];
+
+  // Runs of slots a RosAllocSpace reserved for this thread's allocations, one per small size
+  // bracket. Only this thread allocates out of them so no lock is needed on the fast path.
+  void* rosalloc_runs_[kRosAllocThreadLocalBracketCount];
+
+  // Segment of the heap's allocation stack this thread pushes its allocations onto, see
+  // Heap::RecordAllocation.
+  mirror::Object** thread_local_alloc_stack_top_;
+  mirror::Object** thread_local_alloc_stack_end_;
+
+  // Only this thread reads and writes its entries, see InSubtypeCheckCache.
+  SubtypeCheckCacheEntry subtype_check_cache_[kSubtypeCheckCacheSize];
 
  public:
   // Entrypoint function pointers
@@ -812,6 +1106,22 @@ class PACKED(4) Thread {
   // How many times has our pthread key's destructor been called?
   uint32_t thread_exit_check_count_;
 
+  // Records the stores of this thread while it runs code that may be rolled back, NULL otherwise.
+  // Kept after the entrypoints so that compiled code doesn't depend on it.
+  Transaction* transaction_;
+
+  // Buffer this thread's method trace records go to when the trace is streamed, owned by the Trace.
+  std::vector<uint8_t>* trace_buffer_;
+
+  // Bytes this thread allocates until its next allocation sample, 0 if it hasn't picked one yet.
+  size_t allocation_sample_bytes_left_;
+
+  // True while an allocation entrypoint allocates for a tenured allocation site.
+  bool allocating_tenured_;
+
+  // kInterpreterCacheSize entries, see FindInInterpreterCache.
+  InterpreterCacheEntry* interpreter_cache_;
+
   friend class ScopedThreadStateChange;
 
   DISALLOW_COPY_AND_ASSIGN(Thread);
@@ -20,9 +20,20 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <vector>
+
+#include "barrier.h"
+#include "base/histogram-inl.h"
 #include "base/mutex.h"
+#include "base/stringprintf.h"
 #include "base/timing_logger.h"
+#include "class_linker.h"
+#include "closure.h"
+#include "cutils/atomic-inline.h"
 #include "debugger.h"
+#include "metrics.h"
+#include "scoped_thread_state_change.h"
 #include "thread.h"
 #include "utils.h"
 
@@ -31,6 +42,9 @@ namespace art {
 ThreadList::ThreadList()
     : allocated_ids_lock_("allocated thread ids lock"),
       suspend_all_count_(0), debug_suspend_all_count_(0),
+      suspend_all_timings_lock_("suspend all timings lock"),
+      suspend_all_histogram_("time to safepoint", 50),
+      slowest_suspend_ns_(0),
       thread_exit_cond_("thread exit condition variable", *Locks::thread_list_lock_) {
 }
 
@@ -73,6 +87,74 @@ void ThreadList::DumpForSigQuit(std::ostream& os) {
   DumpUnattachedThreads(os);
 }
 
+class CaptureThreadDumpCheckpoint : public Closure {
+ public:
+  explicit CaptureThreadDumpCheckpoint(Thread* requester)
+      : requester_(requester), barrier_(0), lock_("thread dump capture lock") {}
+
+  virtual void Run(Thread* thread) NO_THREAD_SAFETY_ANALYSIS {
+    Thread* self = Thread::Current();
+    CapturedThreadDump dump;
+    if (self != requester_) {
+      // A thread that was runnable, at a suspend check.
+      thread->CaptureForDump(&dump);
+    } else {
+      // The requester itself or a thread it keeps suspended, a share of the mutator lock keeps
+      // the GC from running meanwhile.
+      ReaderMutexLock mu(self, *Locks::mutator_lock_);
+      thread->CaptureForDump(&dump);
+    }
+    {
+      MutexLock mu(self, lock_);
+      dumps_.push_back(CapturedThreadDump());
+      std::swap(dumps_.back(), dump);
+    }
+    barrier_.Pass(self);
+  }
+
+  // Returns once count threads have run the checkpoint.
+  void Wait(Thread* self, size_t count) {
+    ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+    barrier_.Increment(self, count);
+  }
+
+  // The captures, in the order of the thread list.
+  std::vector<CapturedThreadDump>* GetDumps() {
+    MutexLock mu(Thread::Current(), lock_);
+    std::sort(dumps_.begin(), dumps_.end(), OrderByThinLockId);
+    return &dumps_;
+  }
+
+ private:
+  static bool OrderByThinLockId(const CapturedThreadDump& lhs, const CapturedThreadDump& rhs) {
+    return lhs.thin_lock_id < rhs.thin_lock_id;
+  }
+
+  Thread* const requester_;
+  Barrier barrier_;
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::vector<CapturedThreadDump> dumps_ GUARDED_BY(lock_);
+};
+
+void ThreadList::DumpForSigQuitWithCheckpoint(std::ostream& os) {
+  Thread* self = Thread::Current();
+  // The captured frames keep the methods outside of the heap until they are printed.
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  class_linker->BlockClassUnloading();
+  CaptureThreadDumpCheckpoint checkpoint(self);
+  checkpoint.Wait(self, RunCheckpoint(&checkpoint));
+  std::vector<CapturedThreadDump>* dumps = checkpoint.GetDumps();
+  os << "DALVIK THREADS (" << dumps->size() << "):\n";
+  for (const auto& dump : *dumps) {
+    // Runnable one thread at a time, so that a GC isn't held up by the printing.
+    ScopedObjectAccess soa(self);
+    Thread::DumpCaptured(os, dump);
+    os << "\n";
+  }
+  class_linker->UnblockClassUnloading();
+  DumpUnattachedThreads(os);
+}
+
 static void DumpUnattachedThread(std::ostream& os, pid_t tid) NO_THREAD_SAFETY_ANALYSIS {
   // TODO: No thread safety analysis as DumpState with a NULL thread won't access fields, should
   // refactor DumpState to avoid skipping analysis.
@@ -162,14 +244,14 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
     for (const auto& thread : list_) {
       if (thread != self) {
         for (;;) {
+          MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
           if (thread->RequestCheckpoint(checkpoint_function)) {
             // This thread will run it's checkpoint some time in the near future.
             count++;
             break;
           } else {
             // We are probably suspended, try to make sure that we stay suspended.
-            MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
-            // The thread switched back to runnable.
+            // The thread switched back to runnable, or all its checkpoint slots are taken.
             if (thread->GetState() == kRunnable) {
               continue;
             }
@@ -203,7 +285,7 @@ size_t ThreadList::RunCheckpoint(Closure* checkpoint_function) {
       }
     }
     // We know for sure that the thread is suspended at this point.
-    thread->RunCheckpointFunction();
+    checkpoint_function->Run(thread);
     {
       MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
       thread->ModifySuspendCount(self, -1, false);
@@ -225,6 +307,7 @@ void ThreadList::SuspendAll() {
   Thread* self = Thread::Current();
 
   VLOG(threads) << *self << " SuspendAll starting...";
+  const uint64_t start_ns = NanoTime();
 
   if (kIsDebugBuild) {
     Locks::mutator_lock_->AssertNotHeld(self);
@@ -250,6 +333,7 @@ void ThreadList::SuspendAll() {
   }
 
   // Block on the mutator lock until all Runnable threads release their share of access.
+  WaitForBiasedMutatorLockShares(self, NULL);
 #if HAVE_TIMED_RWLOCK
   // Timeout if we wait more than 30 seconds.
   if (UNLIKELY(!Locks::mutator_lock_->ExclusiveLockWithTimeout(self, 30 * 1000, 0))) {
@@ -259,12 +343,82 @@ void ThreadList::SuspendAll() {
   Locks::mutator_lock_->ExclusiveLock(self);
 #endif
 
+  RecordSuspendAllTimings(self, start_ns);
+
   // Debug check that all threads are suspended.
   AssertThreadsAreSuspended(self, self);
 
   VLOG(threads) << *self << " SuspendAll complete";
 }
 
+void ThreadList::WaitForBiasedMutatorLockShares(Thread* self, Thread* ignore) {
+  std::vector<Thread*> biased_threads;
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    // Order the suspend requests before the reads of the biases, see
+    // Thread::TransitionFromSuspendedToRunnable.
+    ANDROID_MEMBAR_FULL();
+    for (const auto& thread : list_) {
+      if (thread != self && thread != ignore &&
+          thread->biased_mutator_lock_share_ != Thread::kNoBiasedShare) {
+        biased_threads.push_back(thread);
+      }
+    }
+  }
+  // The threads can't unregister while their suspension is requested, so they outlive the wait.
+  uint64_t deadline_ns = HAVE_TIMED_RWLOCK ? NanoTime() + 30 * 1000 * 1000 * 1000LL : 0;
+  for (Thread* thread : biased_threads) {
+    if (UNLIKELY(!thread->WaitForBiasedMutatorLockShareRelease(deadline_ns))) {
+#if HAVE_TIMED_RWLOCK
+      UnsafeLogFatalForThreadSuspendAllTimeout(self);
+#endif
+    }
+  }
+}
+
+void ThreadList::RecordSuspendAllTimings(Thread* self, uint64_t start_ns) {
+  const uint64_t end_ns = NanoTime();
+  MutexLock mu(self, *Locks::thread_list_lock_);
+  // Threads that were suspended when the request was made record no time after start_ns. The
+  // last of the others to honor the request is the one SuspendAll waited for.
+  Thread* slowest_thread = NULL;
+  uint64_t slowest_ns = 0;
+  for (const auto& thread : list_) {
+    if (thread != self && thread->suspend_request_honored_ns_ > start_ns &&
+        thread->suspend_request_honored_ns_ - start_ns > slowest_ns) {
+      slowest_thread = thread;
+      slowest_ns = thread->suspend_request_honored_ns_ - start_ns;
+    }
+  }
+  MutexLock mu2(self, suspend_all_timings_lock_);
+  suspend_all_histogram_.AddValue((end_ns - start_ns) / 1000);
+  if (slowest_thread != NULL && slowest_ns > slowest_suspend_ns_) {
+    // The thread is still where it reached the safepoint.
+    std::string name;
+    slowest_thread->GetThreadName(name);
+    uint32_t dex_pc = 0;
+    mirror::ArtMethod* method = slowest_thread->GetCurrentMethod(&dex_pc);
+    slowest_suspend_ns_ = slowest_ns;
+    slowest_suspend_location_ = StringPrintf("\"%s\" in %s at dex pc 0x%04x", name.c_str(),
+                                             PrettyMethod(method).c_str(), dex_pc);
+  }
+}
+
+void ThreadList::DumpSuspendAllTimings(std::ostream& os) {
+  MutexLock mu(Thread::Current(), suspend_all_timings_lock_);
+  if (suspend_all_histogram_.SampleSize() == 0) {
+    return;
+  }
+  Histogram<uint64_t>::CumulativeData cumulative_data;
+  suspend_all_histogram_.CreateHistogram(cumulative_data);
+  os << suspend_all_histogram_.SampleSize() << " SuspendAll calls, ";
+  suspend_all_histogram_.PrintConfidenceIntervals(os, 0.99, cumulative_data);
+  if (slowest_suspend_ns_ != 0) {
+    os << "Slowest thread to reach a safepoint: " << slowest_suspend_location_ << " after "
+       << PrettyDuration(slowest_suspend_ns_) << "\n";
+  }
+}
+
 void ThreadList::ResumeAll() {
   Thread* self = Thread::Current();
 
@@ -321,6 +475,59 @@ void ThreadList::Resume(Thread* thread, bool for_debugger) {
   VLOG(threads) << "Resume(" << *thread << ") complete";
 }
 
+Thread* ThreadList::SuspendThreadByThinLockId(uint32_t thin_lock_id, bool* timed_out) {
+  static const useconds_t kTimeoutUs = 30 * 1000000;  // 30s.
+  useconds_t total_delay_us = 0;
+  useconds_t delay_us = 0;
+  Thread* self = Thread::Current();
+  CHECK_NE(self->GetState(), kRunnable);
+  Thread* suspended_thread = NULL;
+  *timed_out = false;
+  while (true) {
+    {
+      MutexLock mu(self, *Locks::thread_list_lock_);
+      Thread* thread = NULL;
+      for (const auto& it : list_) {
+        if (it->GetThinLockId() == thin_lock_id) {
+          thread = it;
+          break;
+        }
+      }
+      if (thread == NULL || (suspended_thread != NULL && thread != suspended_thread)) {
+        // The thread exited, taking our suspend request with it.
+        return NULL;
+      }
+      CHECK_NE(thread, self) << "Attempt to suspend the current thread by its thin lock id";
+      MutexLock mu2(self, *Locks::thread_suspend_count_lock_);
+      if (suspended_thread == NULL) {
+        thread->ModifySuspendCount(self, +1, false);
+        suspended_thread = thread;
+      }
+      if (thread->IsSuspended()) {
+        return thread;
+      }
+      if (total_delay_us >= kTimeoutUs) {
+        LOG(ERROR) << "Thread suspension timed out: " << *thread;
+        thread->ModifySuspendCount(self, -1, false);
+        Thread::resume_cond_->Broadcast(self);
+        *timed_out = true;
+        return NULL;
+      }
+    }
+    if (delay_us == 0) {
+      sched_yield();
+      // Default to 1 milliseconds (note that this gets multiplied by 2 before the first sleep).
+      delay_us = 500;
+    } else {
+      usleep(delay_us);
+      total_delay_us += delay_us;
+    }
+    if (delay_us * 2 < 500000) {  // Don't sleep for more than 0.5s at a time.
+      delay_us *= 2;
+    }
+  }
+}
+
 void ThreadList::SuspendAllForDebugger() {
   Thread* self = Thread::Current();
   Thread* debug_thread = Dbg::GetDebugThread();
@@ -347,6 +554,7 @@ void ThreadList::SuspendAllForDebugger() {
 
   // Block on the mutator lock until all Runnable threads release their share of access then
   // immediately unlock again.
+  WaitForBiasedMutatorLockShares(self, debug_thread);
 #if HAVE_TIMED_RWLOCK
   // Timeout if we wait more than 30 seconds.
   if (!Locks::mutator_lock_->ExclusiveLockWithTimeout(self, 30 * 1000, 0)) {
@@ -516,6 +724,10 @@ void ThreadList::Register(Thread* self) {
   }
   CHECK(!Contains(self));
   list_.push_back(self);
+  Metrics* metrics = Runtime::Current()->GetMetrics();
+  if (metrics != NULL) {
+    metrics->Add(Metrics::kThreads, 1);
+  }
 }
 
 void ThreadList::Unregister(Thread* self) {
@@ -542,6 +754,10 @@ void ThreadList::Unregister(Thread* self) {
       list_.remove(self);
       delete self;
       self = NULL;
+      Metrics* metrics = Runtime::Current()->GetMetrics();
+      if (metrics != NULL) {
+        metrics->Add(Metrics::kThreads, -1);
+      }
     }
     Locks::thread_list_lock_->ExclusiveUnlock(self);
   }
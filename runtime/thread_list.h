@@ -17,11 +17,13 @@
 #ifndef ART_RUNTIME_THREAD_LIST_H_
 #define ART_RUNTIME_THREAD_LIST_H_
 
+#include "base/histogram.h"
 #include "base/mutex.h"
 #include "root_visitor.h"
 
 #include <bitset>
 #include <list>
+#include <string>
 
 namespace art {
 class Closure;
@@ -40,11 +42,22 @@ class ThreadList {
   void DumpForSigQuit(std::ostream& os)
       LOCKS_EXCLUDED(Locks::thread_list_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+  // Like DumpForSigQuit without stopping all threads at once nor for the length of the dump: each
+  // thread captures its stack at a checkpoint, or has it captured if suspended, and goes on. The
+  // stacks are printed once captured.
+  void DumpForSigQuitWithCheckpoint(std::ostream& os)
+      LOCKS_EXCLUDED(Locks::mutator_lock_,
+                     Locks::thread_list_lock_,
+                     Locks::thread_suspend_count_lock_);
   void DumpLocked(std::ostream& os)  // For thread suspend timeout dumps.
       EXCLUSIVE_LOCKS_REQUIRED(Locks::thread_list_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   pid_t GetLockOwner();  // For SignalCatcher.
 
+  // Prints how long SuspendAll waited for threads to reach a safepoint, and which thread was the
+  // slowest to get there.
+  void DumpSuspendAllTimings(std::ostream& os) LOCKS_EXCLUDED(suspend_all_timings_lock_);
+
   // Thread suspension support.
   void ResumeAll()
       UNLOCK_FUNCTION(Locks::mutator_lock_)
@@ -53,6 +66,14 @@ class ThreadList {
   void Resume(Thread* thread, bool for_debugger = false)
       LOCKS_EXCLUDED(Locks::thread_suspend_count_lock_);
 
+  // Suspends the thread with the given thin lock id and waits until it is suspended. Returns the
+  // thread, to be resumed with Resume, or NULL if it exited or didn't suspend in time, in which
+  // case *timed_out is set. The caller mustn't be runnable.
+  Thread* SuspendThreadByThinLockId(uint32_t thin_lock_id, bool* timed_out)
+      LOCKS_EXCLUDED(Locks::mutator_lock_,
+                     Locks::thread_list_lock_,
+                     Locks::thread_suspend_count_lock_);
+
   // Suspends all threads and gets exclusive access to the mutator_lock_.
   void SuspendAll()
       EXCLUSIVE_LOCK_FUNCTION(Locks::mutator_lock_)
@@ -122,6 +143,17 @@ class ThreadList {
       LOCKS_EXCLUDED(Locks::thread_list_lock_,
                      Locks::thread_suspend_count_lock_);
 
+  // Once the suspension of all threads but self and ignore has been requested, waits for those
+  // that held a biased share of mutator_lock_ to release it, as the ones holding a share counted
+  // by the lock are waited for by acquiring it.
+  void WaitForBiasedMutatorLockShares(Thread* self, Thread* ignore)
+      LOCKS_EXCLUDED(Locks::mutator_lock_, Locks::thread_list_lock_);
+
+  // Records the time to safepoint of a SuspendAll that requested suspension at start_ns.
+  void RecordSuspendAllTimings(Thread* self, uint64_t start_ns)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, suspend_all_timings_lock_);
+
   mutable Mutex allocated_ids_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::bitset<kMaxThreadId> allocated_ids_ GUARDED_BY(allocated_ids_lock_);
 
@@ -132,6 +164,13 @@ class ThreadList {
   int suspend_all_count_ GUARDED_BY(Locks::thread_suspend_count_lock_);
   int debug_suspend_all_count_ GUARDED_BY(Locks::thread_suspend_count_lock_);
 
+  // Time to safepoint of SuspendAll, in microseconds.
+  Mutex suspend_all_timings_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  Histogram<uint64_t> suspend_all_histogram_ GUARDED_BY(suspend_all_timings_lock_);
+  // The longest any thread took to reach a safepoint, and the thread and method it was running.
+  uint64_t slowest_suspend_ns_ GUARDED_BY(suspend_all_timings_lock_);
+  std::string slowest_suspend_location_ GUARDED_BY(suspend_all_timings_lock_);
+
   // Signaled when threads terminate. Used to determine when all non-daemons have terminated.
   ConditionVariable thread_exit_cond_ GUARDED_BY(Locks::thread_list_lock_);
 
@@ -16,6 +16,8 @@
 
 #include "thread_pool.h"
 
+#include <sched.h>
+
 #include "base/casts.h"
 #include "base/stl_util.h"
 #include "runtime.h"
@@ -25,11 +27,48 @@ namespace art {
 
 static constexpr bool kMeasureWaitTime = false;
 
+// Capacity of each worker's deque in work stealing mode, tasks which don't fit go onto the shared
+// queue.
+static constexpr size_t kWorkerDequeSize = 1024;
+// Upper bound on how many tasks a worker moves from the shared queue onto its deque at once.
+static constexpr size_t kMaxBatchSize = 32;
+// How many times an idle worker looks for work before blocking on the task queue condition.
+static constexpr size_t kIdleSpinCount = 64;
+
+static void IncrementCount(volatile int64_t* count) {
+  int64_t old_value;
+  do {
+    old_value = QuasiAtomic::Read64(count);
+  } while (!QuasiAtomic::Cas64(old_value, old_value + 1, count));
+}
+
+// Like MutexLock but counts the acquisitions which found the lock held.
+class SCOPED_LOCKABLE ContendedMutexLock {
+ public:
+  ContendedMutexLock(Thread* self, Mutex& mu, volatile int64_t* contention_count)
+      EXCLUSIVE_LOCK_FUNCTION(mu) : self_(self), mu_(mu) {
+    if (!mu_.ExclusiveTryLock(self_)) {
+      IncrementCount(contention_count);
+      mu_.ExclusiveLock(self_);
+    }
+  }
+
+  ~ContendedMutexLock() UNLOCK_FUNCTION() {
+    mu_.ExclusiveUnlock(self_);
+  }
+
+ private:
+  Thread* const self_;
+  Mutex& mu_;
+  DISALLOW_COPY_AND_ASSIGN(ContendedMutexLock);
+};
+
 ThreadPoolWorker::ThreadPoolWorker(ThreadPool* thread_pool, const std::string& name,
                                    size_t stack_size)
     : thread_pool_(thread_pool),
       name_(name),
-      stack_size_(stack_size) {
+      stack_size_(stack_size),
+      thread_(NULL) {
   const char* reason = "new thread pool worker thread";
   pthread_attr_t attr;
   CHECK_PTHREAD_CALL(pthread_attr_init, (&attr), reason);
@@ -56,6 +95,7 @@ void* ThreadPoolWorker::Callback(void* arg) {
   ThreadPoolWorker* worker = reinterpret_cast<ThreadPoolWorker*>(arg);
   Runtime* runtime = Runtime::Current();
   CHECK(runtime->AttachCurrentThread(worker->name_.c_str(), true, NULL, false));
+  worker->thread_ = Thread::Current();
   // Do work until its time to shut down.
   worker->Run();
   runtime->DetachCurrentThread();
@@ -63,7 +103,21 @@ void* ThreadPoolWorker::Callback(void* arg) {
 }
 
 void ThreadPool::AddTask(Thread* self, Task* task) {
-  MutexLock mu(self, task_queue_lock_);
+  if (work_stealing_) {
+    const size_t worker_index = WorkerIndex(self);
+    if (worker_index != kNotAWorker && deques_[worker_index]->PushBottom(task)) {
+      // Racy check for sleeping workers which could steal the task. Missing one only costs
+      // parallelism, the task is still run by its owner.
+      if (waiting_count_ != 0) {
+        MutexLock mu(self, task_queue_lock_);
+        if (started_ && waiting_count_ != 0) {
+          task_queue_condition_.Signal(self);
+        }
+      }
+      return;
+    }
+  }
+  ContendedMutexLock mu(self, task_queue_lock_, &queue_contention_count_);
   tasks_.push_back(task);
   // If we have any waiters, signal one.
   if (started_ && waiting_count_ != 0) {
@@ -71,7 +125,7 @@ void ThreadPool::AddTask(Thread* self, Task* task) {
   }
 }
 
-ThreadPool::ThreadPool(size_t num_threads)
+ThreadPool::ThreadPool(size_t num_threads, bool work_stealing)
   : task_queue_lock_("task queue lock"),
     task_queue_condition_("task queue condition", task_queue_lock_),
     completion_condition_("task completion condition", task_queue_lock_),
@@ -82,8 +136,18 @@ ThreadPool::ThreadPool(size_t num_threads)
     total_wait_time_(0),
     // Add one since the caller of constructor waits on the barrier too.
     creation_barier_(num_threads + 1),
-    max_active_workers_(num_threads) {
+    max_active_workers_(num_threads),
+    work_stealing_(work_stealing),
+    queue_contention_count_(0),
+    steal_count_(0) {
   Thread* self = Thread::Current();
+  // The deques must exist before the workers start looking for tasks.
+  if (work_stealing_) {
+    for (size_t i = 0; i < num_threads; ++i) {
+      const std::string name = StringPrintf("Thread pool worker deque %zu", i);
+      deques_.push_back(gc::accounting::WorkStealingDeque<Task*>::Create(name, kWorkerDequeSize));
+    }
+  }
   while (GetThreadCount() < num_threads) {
     const std::string name = StringPrintf("Thread pool worker %zu", GetThreadCount());
     threads_.push_back(new ThreadPoolWorker(this, name, ThreadPoolWorker::kDefaultStackSize));
@@ -110,6 +174,7 @@ ThreadPool::~ThreadPool() {
   }
   // Wait for the threads to finish.
   STLDeleteElements(&threads_);
+  STLDeleteElements(&deques_);
 }
 
 void ThreadPool::StartWorkers(Thread* self) {
@@ -118,6 +183,8 @@ void ThreadPool::StartWorkers(Thread* self) {
   task_queue_condition_.Broadcast(self);
   start_time_ = NanoTime();
   total_wait_time_ = 0;
+  QuasiAtomic::Write64(&queue_contention_count_, 0);
+  QuasiAtomic::Write64(&steal_count_, 0);
 }
 
 void ThreadPool::StopWorkers(Thread* self) {
@@ -126,21 +193,47 @@ void ThreadPool::StopWorkers(Thread* self) {
 }
 
 Task* ThreadPool::GetTask(Thread* self) {
-  MutexLock mu(self, task_queue_lock_);
+  const size_t worker_index = work_stealing_ ? WorkerIndex(self) : kNotAWorker;
+  if (worker_index != kNotAWorker) {
+    // Spin before blocking, waking up a sleeping worker is much more expensive than a few yields
+    // when new tasks are added at a high rate.
+    for (size_t i = 0; i < kIdleSpinCount; ++i) {
+      Task* task = TryGetOwnTask(self, worker_index);
+      if (task == NULL) {
+        task = TrySteal(worker_index);
+      }
+      if (task != NULL) {
+        return task;
+      }
+      sched_yield();
+    }
+  }
+  ContendedMutexLock mu(self, task_queue_lock_, &queue_contention_count_);
   while (!IsShuttingDown()) {
     const size_t thread_count = GetThreadCount();
     // Ensure that we don't use more threads than the maximum active workers.
     const size_t active_threads = thread_count - waiting_count_;
     // <= since self is considered an active worker.
     if (active_threads <= max_active_workers_) {
-      Task* task = TryGetTaskLocked(self);
+      Task* task = NULL;
+      if (worker_index != kNotAWorker && started_) {
+        // Our deque may still hold tasks if the workers were stopped while we were spinning.
+        if (!deques_[worker_index]->PopBottom(&task)) {
+          task = TakeBatchLocked(self, worker_index);
+        }
+        if (task == NULL) {
+          task = TrySteal(worker_index);
+        }
+      } else {
+        task = TryGetTaskLocked(self);
+      }
       if (task != NULL) {
         return task;
       }
     }
 
     ++waiting_count_;
-    if (waiting_count_ == GetThreadCount() && tasks_.empty()) {
+    if (waiting_count_ == GetThreadCount() && tasks_.empty() && DequesEmpty()) {
       // We may be done, lets broadcast to the completion condition.
       completion_condition_.Broadcast(self);
     }
@@ -158,8 +251,16 @@ Task* ThreadPool::GetTask(Thread* self) {
 }
 
 Task* ThreadPool::TryGetTask(Thread* self) {
-  MutexLock mu(self, task_queue_lock_);
-  return TryGetTaskLocked(self);
+  Task* task;
+  {
+    ContendedMutexLock mu(self, task_queue_lock_, &queue_contention_count_);
+    task = TryGetTaskLocked(self);
+  }
+  if (task == NULL && work_stealing_ && started_) {
+    // Help out the workers, such as when waiting with do_work.
+    task = TrySteal(WorkerIndex(self));
+  }
+  return task;
 }
 
 Task* ThreadPool::TryGetTaskLocked(Thread* self) {
@@ -171,6 +272,82 @@ Task* ThreadPool::TryGetTaskLocked(Thread* self) {
   return NULL;
 }
 
+size_t ThreadPool::WorkerIndex(Thread* self) const {
+  const size_t thread_count = GetThreadCount();
+  for (size_t i = 0; i < thread_count; ++i) {
+    if (threads_[i]->thread_ == self) {
+      return i;
+    }
+  }
+  return kNotAWorker;
+}
+
+Task* ThreadPool::TryGetOwnTask(Thread* self, size_t worker_index) {
+  if (!started_) {
+    return NULL;
+  }
+  Task* task;
+  if (deques_[worker_index]->PopBottom(&task)) {
+    return task;
+  }
+  // Don't wait for the lock while spinning, the holder is likely taking the tasks we want.
+  if (!task_queue_lock_.ExclusiveTryLock(self)) {
+    IncrementCount(&queue_contention_count_);
+    return NULL;
+  }
+  // Like GetTask, don't take new tasks while the pool is running more workers than allowed. The
+  // GC limits its pools to leave room for the thread which waits with do_work.
+  task = NULL;
+  if (GetThreadCount() - waiting_count_ <= max_active_workers_) {
+    task = TakeBatchLocked(self, worker_index);
+  }
+  task_queue_lock_.ExclusiveUnlock(self);
+  return task;
+}
+
+Task* ThreadPool::TakeBatchLocked(Thread* self, size_t worker_index) {
+  Task* task = TryGetTaskLocked(self);
+  if (task == NULL) {
+    return NULL;
+  }
+  // Take our share of the remaining tasks so that we don't come back for the lock for a while,
+  // the other workers may steal them if we fall behind.
+  size_t batch_size = std::min(tasks_.size() / GetThreadCount(), kMaxBatchSize);
+  gc::accounting::WorkStealingDeque<Task*>* deque = deques_[worker_index];
+  while (batch_size != 0 && deque->PushBottom(tasks_.front())) {
+    tasks_.pop_front();
+    --batch_size;
+  }
+  if (!deque->IsEmpty() && waiting_count_ != 0) {
+    task_queue_condition_.Signal(self);
+  }
+  return task;
+}
+
+Task* ThreadPool::TrySteal(size_t worker_index) {
+  const size_t thread_count = deques_.size();
+  // Start with the worker after us so that thieves spread over the victims.
+  const size_t start = worker_index == kNotAWorker ? 0 : worker_index + 1;
+  for (size_t i = 0; i < thread_count; ++i) {
+    const size_t victim = (start + i) % thread_count;
+    Task* task;
+    if (victim != worker_index && deques_[victim]->Steal(&task)) {
+      IncrementCount(&steal_count_);
+      return task;
+    }
+  }
+  return NULL;
+}
+
+bool ThreadPool::DequesEmpty() const {
+  for (gc::accounting::WorkStealingDeque<Task*>* deque : deques_) {
+    if (!deque->IsEmpty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void ThreadPool::Wait(Thread* self, bool do_work, bool may_hold_locks) {
   if (do_work) {
     Task* task = NULL;
@@ -181,7 +358,8 @@ void ThreadPool::Wait(Thread* self, bool do_work, bool may_hold_locks) {
   }
   // Wait until each thread is waiting and the task list is empty.
   MutexLock mu(self, task_queue_lock_);
-  while (!shutting_down_ && (waiting_count_ != GetThreadCount() || !tasks_.empty())) {
+  while (!shutting_down_ &&
+         (waiting_count_ != GetThreadCount() || !tasks_.empty() || !DequesEmpty())) {
     if (!may_hold_locks) {
       completion_condition_.Wait(self);
     } else {
@@ -192,7 +370,11 @@ void ThreadPool::Wait(Thread* self, bool do_work, bool may_hold_locks) {
 
 size_t ThreadPool::GetTaskCount(Thread* self) {
   MutexLock mu(self, task_queue_lock_);
-  return tasks_.size();
+  size_t count = tasks_.size();
+  for (gc::accounting::WorkStealingDeque<Task*>* deque : deques_) {
+    count += deque->Size();
+  }
+  return count;
 }
 
 WorkStealingWorker::WorkStealingWorker(ThreadPool* thread_pool, const std::string& name,
@@ -20,9 +20,11 @@
 #include <deque>
 #include <vector>
 
+#include "atomic.h"
 #include "barrier.h"
 #include "base/mutex.h"
 #include "closure.h"
+#include "gc/accounting/work_stealing_deque.h"
 #include "locks.h"
 
 namespace art {
@@ -54,6 +56,8 @@ class ThreadPoolWorker {
   const std::string name_;
   const size_t stack_size_;
   pthread_t pthread_;
+  // The attached thread, set before the worker waits on the creation barrier.
+  Thread* thread_;
 
  private:
   friend class ThreadPool;
@@ -67,6 +71,11 @@ class ThreadPool {
     return threads_.size();
   }
 
+  // Returns the attached thread of worker i, which lives as long as the thread pool.
+  Thread* GetWorkerThread(size_t i) const {
+    return threads_[i]->thread_;
+  }
+
   // Broadcast to the workers and tell them to empty out the work queue.
   void StartWorkers(Thread* self);
 
@@ -74,10 +83,15 @@ class ThreadPool {
   void StopWorkers(Thread* self);
 
   // Add a new task, the first available started worker will process it. Does not delete the task
-  // after running it, it is the caller's responsibility.
-  void AddTask(Thread* self, Task* task);
-
-  explicit ThreadPool(size_t num_threads);
+  // after running it, it is the caller's responsibility. In work stealing mode a task added by a
+  // worker goes onto that worker's own deque without taking the task queue lock.
+  void AddTask(Thread* self, Task* task)
+      NO_THREAD_SAFETY_ANALYSIS;  // Checking for waiters without the lock is racy.
+
+  // In work stealing mode every worker has its own lock free deque. Workers take tasks from the
+  // shared queue in batches, steal from each other when they run dry and spin for a while before
+  // blocking on the task queue condition.
+  explicit ThreadPool(size_t num_threads, bool work_stealing = false);
   virtual ~ThreadPool();
 
   // Wait for all tasks currently on queue to get completed.
@@ -90,6 +104,21 @@ class ThreadPool {
     return total_wait_time_;
   }
 
+  // Returns how many times the task queue lock was found held since the workers were started.
+  uint64_t GetQueueContentionCount() const {
+    return static_cast<uint64_t>(QuasiAtomic::Read64(&queue_contention_count_));
+  }
+
+  // Returns how many tasks were stolen from the deque of another worker since the workers were
+  // started.
+  uint64_t GetStealCount() const {
+    return static_cast<uint64_t>(QuasiAtomic::Read64(&steal_count_));
+  }
+
+  bool IsWorkStealing() const {
+    return work_stealing_;
+  }
+
   // Provides a way to bound the maximum number of worker threads, threads must be less the the
   // thread count of the thread pool.
   void SetMaxActiveWorkers(size_t threads);
@@ -99,9 +128,21 @@ class ThreadPool {
   virtual Task* GetTask(Thread* self);
 
   // Try to get a task, returning NULL if there is none available.
-  Task* TryGetTask(Thread* self);
+  Task* TryGetTask(Thread* self) NO_THREAD_SAFETY_ANALYSIS;  // Reads started_ without the lock.
   Task* TryGetTaskLocked(Thread* self) EXCLUSIVE_LOCKS_REQUIRED(task_queue_lock_);
 
+  // Work stealing mode helpers. A worker index of kNotAWorker is used for other threads.
+  static constexpr size_t kNotAWorker = static_cast<size_t>(-1);
+  size_t WorkerIndex(Thread* self) const;
+  // Pop from the worker's own deque or take a batch from the shared queue without blocking.
+  Task* TryGetOwnTask(Thread* self, size_t worker_index)
+      NO_THREAD_SAFETY_ANALYSIS;  // Reads started_ without the lock.
+  // Move a batch of tasks from the shared queue onto the worker's deque and return one of them.
+  Task* TakeBatchLocked(Thread* self, size_t worker_index)
+      EXCLUSIVE_LOCKS_REQUIRED(task_queue_lock_);
+  Task* TrySteal(size_t worker_index);
+  bool DequesEmpty() const;
+
   // Are we shutting down?
   bool IsShuttingDown() const EXCLUSIVE_LOCKS_REQUIRED(task_queue_lock_) {
     return shutting_down_;
@@ -122,6 +163,12 @@ class ThreadPool {
   uint64_t total_wait_time_;
   Barrier creation_barier_;
   size_t max_active_workers_ GUARDED_BY(task_queue_lock_);
+  const bool work_stealing_;
+  // One deque per worker, indexed like threads_. Empty unless work stealing.
+  std::vector<gc::accounting::WorkStealingDeque<Task*>*> deques_;
+  // Updated with QuasiAtomic so that they don't tear or wrap on 32-bit targets.
+  volatile int64_t queue_contention_count_;
+  volatile int64_t steal_count_;
 
  private:
   friend class ThreadPoolWorker;
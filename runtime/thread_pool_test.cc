@@ -138,4 +138,18 @@ TEST_F(ThreadPoolTest, RecursiveTest) {
   EXPECT_EQ((1 << depth) - 1, count);
 }
 
+// Tasks added by workers go onto their own deques and idle workers steal them.
+TEST_F(ThreadPoolTest, WorkStealingRecursiveTest) {
+  Thread* self = Thread::Current();
+  ThreadPool thread_pool(num_threads, true);
+  EXPECT_TRUE(thread_pool.IsWorkStealing());
+  AtomicInteger count(0);
+  static const int depth = 12;
+  thread_pool.AddTask(self, new TreeTask(&thread_pool, &count, depth));
+  thread_pool.StartWorkers(self);
+  thread_pool.Wait(self, true, false);
+  EXPECT_EQ((1 << depth) - 1, count);
+  EXPECT_EQ(0U, thread_pool.GetTaskCount(self));
+}
+
 }  // namespace art
@@ -17,6 +17,7 @@
 #include "trace.h"
 
 #include <sys/uio.h>
+#include <unistd.h>
 
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
@@ -115,6 +116,13 @@ static const uint16_t kTraceVersionDualClock      = 3;
 static const uint16_t kTraceRecordSizeSingleClock = 10;  // using v2
 static const uint16_t kTraceRecordSizeDualClock   = 14;  // using v3 with two timestamps
 
+// How long the cycle counter is measured against the monotonic clock when a trace starts.
+static const uint64_t kCycleCalibrationNs = 10 * 1000 * 1000;
+
+// Size of the buffers a streamed trace hands to threads and of the chunks the streamed data is
+// moved by to make room for the text header.
+static const size_t kStreamingBufferSize = 16 * KB;
+
 #if defined(HAVE_POSIX_CLOCKS)
 ProfilerClockSource Trace::default_clock_source_ = kProfilerClockSourceDual;
 #else
@@ -153,8 +161,45 @@ void Trace::FreeStackTrace(std::vector<mirror::ArtMethod*>* stack_trace) {
   temp_stack_trace_.reset(stack_trace);
 }
 
+// The cycle counter is read without a system call, making it the cheapest wall clock. x86 has
+// one readable from user space, the TSC, which we assume runs at a constant rate. The ARM cycle
+// counter is only readable from user space on kernels that enable it, which isn't the default.
+#if defined(__i386__) || defined(__x86_64__)
+static const bool kHaveCycleCounter = true;
+#else
+static const bool kHaveCycleCounter = false;
+#endif
+
+static inline uint64_t ReadCycleCounter() {
+#if defined(__i386__) || defined(__x86_64__)
+  uint32_t lo;
+  uint32_t hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return (static_cast<uint64_t>(hi) << 32) | lo;
+#else
+  LOG(FATAL) << "No cycle counter";
+  return 0;
+#endif
+}
+
+// Returns the microseconds per cycle of the cycle counter, measured against the monotonic clock.
+static double CalibrateCycleCounter() {
+  uint64_t start_ns = NanoTime();
+  uint64_t start_cycles = ReadCycleCounter();
+  uint64_t end_ns;
+  do {
+    end_ns = NanoTime();
+  } while (end_ns - start_ns < kCycleCalibrationNs);
+  uint64_t end_cycles = ReadCycleCounter();
+  return (end_ns - start_ns) / 1000.0 / (end_cycles - start_cycles);
+}
+
 void Trace::SetDefaultClockSource(ProfilerClockSource clock_source) {
 #if defined(HAVE_POSIX_CLOCKS)
+  if (clock_source == kProfilerClockSourceCycles && !kHaveCycleCounter) {
+    LOG(WARNING) << "No cycle counter, tracing with the wall clock.";
+    clock_source = kProfilerClockSourceWall;
+  }
   default_clock_source_ = clock_source;
 #else
   if (clock_source != kProfilerClockSourceWall) {
@@ -180,14 +225,21 @@ bool Trace::UseThreadCpuClock() {
 
 bool Trace::UseWallClock() {
   return (clock_source_ == kProfilerClockSourceWall) ||
-      (clock_source_ == kProfilerClockSourceDual);
+      (clock_source_ == kProfilerClockSourceDual) ||
+      (clock_source_ == kProfilerClockSourceCycles);
+}
+
+bool Trace::UseCycleCounter() {
+  return clock_source_ == kProfilerClockSourceCycles;
 }
 
 static void MeasureClockOverhead(Trace* trace) {
   if (trace->UseThreadCpuClock()) {
     Thread::Current()->GetCpuMicroTime();
   }
-  if (trace->UseWallClock()) {
+  if (trace->UseCycleCounter()) {
+    ReadCycleCounter();
+  } else if (trace->UseWallClock()) {
     MicroTime();
   }
 }
@@ -359,6 +411,15 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
     }
   }
 
+  // The text header is inserted in front of the streamed records at the end, which needs a file
+  // we can move data around in.
+  if ((flags & kTraceStreaming) != 0 &&
+      (trace_file.get() == NULL || lseek(trace_file->Fd(), 0, SEEK_CUR) == -1)) {
+    LOG(WARNING) << "Method trace streaming needs a seekable trace file, buffering the trace to '"
+                 << trace_filename << "' instead";
+    flags &= ~kTraceStreaming;
+  }
+
   // Create Trace object.
   {
     MutexLock mu(self, *Locks::trace_lock_);
@@ -368,11 +429,15 @@ void Trace::Start(const char* trace_filename, int trace_fd, int buffer_size, int
       the_trace_ = new Trace(trace_file.release(), buffer_size, flags, sampling_enabled);
 
       // Enable count of allocs if specified in the flags.
-      if ((flags && kTraceCountAllocs) != 0) {
+      if ((flags & kTraceCountAllocs) != 0) {
         runtime->SetStatsEnabled(true);
       }
 
-
+      if ((flags & kTraceStreaming) != 0) {
+        CHECK_PTHREAD_CALL(pthread_create, (&the_trace_->streaming_pthread_, NULL,
+                                            &RunStreamingThread, the_trace_),
+                                            "Trace streaming thread");
+      }
 
       if (sampling_enabled) {
         CHECK_PTHREAD_CALL(pthread_create, (&sampling_pthread_, NULL, &RunSamplingThread,
@@ -444,9 +509,18 @@ TracingMode Trace::GetMethodTracingMode() {
 }
 
 Trace::Trace(File* trace_file, int buffer_size, int flags, bool sampling_enabled)
-    : trace_file_(trace_file), buf_(new uint8_t[buffer_size]()), flags_(flags),
-      sampling_enabled_(sampling_enabled), clock_source_(default_clock_source_),
-      buffer_size_(buffer_size), start_time_(MicroTime()), cur_offset_(0),  overflow_(false) {
+    : trace_file_(trace_file),
+      buf_(new uint8_t[(flags & kTraceStreaming) != 0 ? kTraceHeaderLength : buffer_size]()),
+      flags_(flags), sampling_enabled_(sampling_enabled), clock_source_(default_clock_source_),
+      usec_per_cycle_(UseCycleCounter() ? CalibrateCycleCounter() : 0.0),
+      buffer_size_(buffer_size), start_time_(MicroTime()),
+      start_cycles_(UseCycleCounter() ? ReadCycleCounter() : 0), cur_offset_(0),  overflow_(false),
+      streaming_((flags & kTraceStreaming) != 0),
+      stream_start_offset_(streaming_ ? lseek(trace_file->Fd(), 0, SEEK_CUR) : 0),
+      streaming_lock_("trace streaming lock"),
+      streaming_cond_("trace streaming condition variable", streaming_lock_),
+      num_streaming_buffers_(0), streaming_finished_(false), streaming_pthread_(0U),
+      streamed_bytes_(0), stream_write_errno_(0) {
   // Set up the beginning of the trace.
   uint16_t trace_version = GetTraceVersion(clock_source_);
   memset(buf_.get(), 0, kTraceHeaderLength);
@@ -463,6 +537,136 @@ Trace::Trace(File* trace_file, int buffer_size, int flags, bool sampling_enabled
   cur_offset_ = kTraceHeaderLength;
 }
 
+Trace::~Trace() {
+  STLDeleteElements(&free_buffers_);
+  STLDeleteElements(&full_buffers_);
+  STLDeleteElements(&thread_buffers_);
+}
+
+void* Trace::RunStreamingThread(void* arg) {
+  // The writer only touches the trace file and the buffers, so it isn't attached to the runtime.
+  reinterpret_cast<Trace*>(arg)->WriteStreamedBuffers();
+  return NULL;
+}
+
+void Trace::WriteStreamedBuffers() {
+  if (!trace_file_->WriteFully(buf_.get(), kTraceHeaderLength)) {
+    stream_write_errno_ = errno;
+  }
+  while (true) {
+    std::vector<uint8_t>* buffer;
+    {
+      MutexLock mu(NULL, streaming_lock_);
+      while (full_buffers_.empty() && !streaming_finished_) {
+        streaming_cond_.Wait(NULL);
+      }
+      if (full_buffers_.empty()) {
+        return;
+      }
+      buffer = full_buffers_.front();
+      full_buffers_.pop_front();
+    }
+    GetVisitedMethods(&(*buffer)[0], &(*buffer)[0] + buffer->size(), &streamed_methods_);
+    // Keep consuming the buffers after a failed write so that the tracing threads don't stall.
+    if (stream_write_errno_ == 0) {
+      if (trace_file_->WriteFully(&(*buffer)[0], buffer->size())) {
+        streamed_bytes_ += buffer->size();
+      } else {
+        stream_write_errno_ = errno;
+      }
+    }
+    buffer->clear();
+    MutexLock mu(NULL, streaming_lock_);
+    free_buffers_.push_back(buffer);
+  }
+}
+
+std::vector<uint8_t>* Trace::ExchangeStreamingBuffer(Thread* thread,
+                                                     std::vector<uint8_t>* full) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, streaming_lock_);
+  if (full != NULL) {
+    thread_buffers_.erase(full);
+    full_buffers_.push_back(full);
+    streaming_cond_.Signal(self);
+  }
+  std::vector<uint8_t>* buffer = NULL;
+  if (!free_buffers_.empty()) {
+    buffer = free_buffers_.back();
+    free_buffers_.pop_back();
+  } else if (num_streaming_buffers_ < std::max<size_t>(buffer_size_ / kStreamingBufferSize, 2)) {
+    buffer = new std::vector<uint8_t>;
+    buffer->reserve(kStreamingBufferSize);
+    ++num_streaming_buffers_;
+  }
+  if (buffer != NULL) {
+    thread_buffers_.insert(buffer);
+  }
+  thread->SetTraceBuffer(buffer);
+  return buffer;
+}
+
+uint8_t* Trace::GetStreamingRecord(Thread* thread) {
+  const size_t record_size = GetRecordSize(clock_source_);
+  std::vector<uint8_t>* buffer = thread->GetTraceBuffer();
+  if (UNLIKELY(buffer == NULL || buffer->size() + record_size > kStreamingBufferSize)) {
+    buffer = ExchangeStreamingBuffer(thread, buffer);
+    if (buffer == NULL) {
+      return NULL;
+    }
+  }
+  size_t offset = buffer->size();
+  buffer->resize(offset + record_size);
+  return &(*buffer)[offset];
+}
+
+static void ClearThreadTraceBuffer(Thread* thread, void* arg) {
+  thread->SetTraceBuffer(NULL);
+}
+
+void Trace::FinishStreaming() {
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, *Locks::thread_list_lock_);
+    Runtime::Current()->GetThreadList()->ForEach(ClearThreadTraceBuffer, NULL);
+  }
+  {
+    MutexLock mu(self, streaming_lock_);
+    for (const auto& buffer : thread_buffers_) {
+      if (buffer->empty()) {
+        free_buffers_.push_back(buffer);
+      } else {
+        full_buffers_.push_back(buffer);
+      }
+    }
+    thread_buffers_.clear();
+    streaming_finished_ = true;
+    streaming_cond_.Signal(self);
+  }
+  CHECK_PTHREAD_CALL(pthread_join, (streaming_pthread_, NULL), "trace streaming thread shutdown");
+}
+
+// Moves the data from begin to the end of file up by the length of header and writes header in
+// the gap, a chunk at a time starting from the end.
+static bool InsertTraceHeader(File* file, int64_t begin, const std::string& header) {
+  int64_t end = lseek(file->Fd(), 0, SEEK_CUR);
+  if (end == -1) {
+    return false;
+  }
+  const int64_t header_length = header.length();
+  std::vector<char> chunk(kStreamingBufferSize);
+  for (int64_t pos = end; pos > begin;) {
+    int64_t count = std::min<int64_t>(pos - begin, chunk.size());
+    pos -= count;
+    if (file->Read(&chunk[0], count, pos) != count ||
+        file->Write(&chunk[0], count, pos + header_length) != count) {
+      return false;
+    }
+  }
+  return file->Write(header.c_str(), header_length, begin) == header_length &&
+      lseek(file->Fd(), end + header_length, SEEK_SET) != -1;
+}
+
 static void DumpBuf(uint8_t* buf, size_t buf_size, ProfilerClockSource clock_source)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   uint8_t* ptr = buf + kTraceHeaderLength;
@@ -489,7 +693,16 @@ void Trace::FinishTracing() {
   }
 
   std::set<mirror::ArtMethod*> visited_methods;
-  GetVisitedMethods(final_offset, &visited_methods);
+  size_t num_records;
+  if (streaming_) {
+    FinishStreaming();
+    visited_methods.swap(streamed_methods_);
+    num_records = streamed_bytes_ / GetRecordSize(clock_source_);
+  } else {
+    GetVisitedMethods(buf_.get() + kTraceHeaderLength, buf_.get() + final_offset,
+                      &visited_methods);
+    num_records = (final_offset - kTraceHeaderLength) / GetRecordSize(clock_source_);
+  }
 
   std::ostringstream os;
 
@@ -505,8 +718,12 @@ void Trace::FinishTracing() {
   } else {
     os << StringPrintf("clock=wall\n");
   }
+  if (UseCycleCounter()) {
+    // The records hold microseconds like the wall clock does, converted with this calibration.
+    os << StringPrintf("wall-clock-source=cycle-counter\n");
+    os << StringPrintf("cycles-per-usec=%.3f\n", 1.0 / usec_per_cycle_);
+  }
   os << StringPrintf("elapsed-time-usec=%llu\n", elapsed);
-  size_t num_records = (final_offset - kTraceHeaderLength) / GetRecordSize(clock_source_);
   os << StringPrintf("num-method-calls=%zd\n", num_records);
   os << StringPrintf("clock-call-overhead-nsec=%d\n", clock_overhead_ns);
   os << StringPrintf("vm=art\n");
@@ -534,6 +751,16 @@ void Trace::FinishTracing() {
       LOG(INFO) << "Trace sent:\n" << header;
       DumpBuf(buf_.get(), final_offset, clock_source_);
     }
+  } else if (streaming_) {
+    if (stream_write_errno_ != 0 ||
+        !InsertTraceHeader(trace_file_.get(), stream_start_offset_, header)) {
+      if (stream_write_errno_ != 0) {
+        errno = stream_write_errno_;
+      }
+      std::string detail(StringPrintf("Trace data write failed: %s", strerror(errno)));
+      PLOG(ERROR) << detail;
+      ThrowRuntimeException("%s", detail.c_str());
+    }
   } else {
     if (!trace_file_->WriteFully(header.c_str(), header.length()) ||
         !trace_file_->WriteFully(buf_.get(), final_offset)) {
@@ -596,7 +823,10 @@ void Trace::ReadClocks(Thread* thread, uint32_t* thread_clock_diff, uint32_t* wa
       *thread_clock_diff = thread->GetCpuMicroTime() - clock_base;
     }
   }
-  if (UseWallClock()) {
+  if (UseCycleCounter()) {
+    uint64_t cycles = ReadCycleCounter() - start_cycles_;
+    *wall_clock_diff = static_cast<uint32_t>(cycles * usec_per_cycle_);
+  } else if (UseWallClock()) {
     *wall_clock_diff = MicroTime() - start_time_;
   }
 }
@@ -604,17 +834,27 @@ void Trace::ReadClocks(Thread* thread, uint32_t* thread_clock_diff, uint32_t* wa
 void Trace::LogMethodTraceEvent(Thread* thread, const mirror::ArtMethod* method,
                                 instrumentation::Instrumentation::InstrumentationEvent event,
                                 uint32_t thread_clock_diff, uint32_t wall_clock_diff) {
-  // Advance cur_offset_ atomically.
-  int32_t new_offset;
-  int32_t old_offset;
-  do {
-    old_offset = cur_offset_;
-    new_offset = old_offset + GetRecordSize(clock_source_);
-    if (new_offset > buffer_size_) {
+  uint8_t* ptr;
+  if (streaming_) {
+    ptr = GetStreamingRecord(thread);
+    if (ptr == NULL) {
       overflow_ = true;
       return;
     }
-  } while (android_atomic_release_cas(old_offset, new_offset, &cur_offset_) != 0);
+  } else {
+    // Advance cur_offset_ atomically.
+    int32_t new_offset;
+    int32_t old_offset;
+    do {
+      old_offset = cur_offset_;
+      new_offset = old_offset + GetRecordSize(clock_source_);
+      if (new_offset > buffer_size_) {
+        overflow_ = true;
+        return;
+      }
+    } while (android_atomic_release_cas(old_offset, new_offset, &cur_offset_) != 0);
+    ptr = buf_.get() + old_offset;
+  }
 
   TraceAction action = kTraceMethodEnter;
   switch (event) {
@@ -634,7 +874,6 @@ void Trace::LogMethodTraceEvent(Thread* thread, const mirror::ArtMethod* method,
   uint32_t method_value = EncodeTraceMethodAndAction(method, action);
 
   // Write data
-  uint8_t* ptr = buf_.get() + old_offset;
   Append2LE(ptr, thread->GetTid());
   Append4LE(ptr + 2, method_value);
   ptr += 6;
@@ -648,11 +887,9 @@ void Trace::LogMethodTraceEvent(Thread* thread, const mirror::ArtMethod* method,
   }
 }
 
-void Trace::GetVisitedMethods(size_t buf_size,
+void Trace::GetVisitedMethods(const uint8_t* begin, const uint8_t* end,
                               std::set<mirror::ArtMethod*>* visited_methods) {
-  uint8_t* ptr = buf_.get() + kTraceHeaderLength;
-  uint8_t* end = buf_.get() + buf_size;
-
+  const uint8_t* ptr = begin;
   while (ptr < end) {
     uint32_t tmid = ptr[2] | (ptr[3] << 8) | (ptr[4] << 16) | (ptr[5] << 24);
     mirror::ArtMethod* method = DecodeTraceMethodId(tmid);
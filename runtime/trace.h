@@ -17,12 +17,14 @@
 #ifndef ART_RUNTIME_TRACE_H_
 #define ART_RUNTIME_TRACE_H_
 
+#include <deque>
 #include <ostream>
 #include <set>
 #include <string>
 #include <vector>
 
 #include "base/macros.h"
+#include "base/mutex.h"
 #include "globals.h"
 #include "instrumentation.h"
 #include "os.h"
@@ -40,6 +42,7 @@ enum ProfilerClockSource {
   kProfilerClockSourceThreadCpu,
   kProfilerClockSourceWall,
   kProfilerClockSourceDual,  // Both wall and thread CPU clocks.
+  kProfilerClockSourceCycles,  // Wall clock read from the CPU cycle counter.
 };
 
 enum TracingMode {
@@ -52,6 +55,9 @@ class Trace : public instrumentation::InstrumentationListener {
  public:
   enum TraceFlag {
     kTraceCountAllocs = 1,
+    // Have each thread buffer its records and a writer thread append them to the trace file
+    // while tracing, instead of keeping the whole trace in memory until it stops.
+    kTraceStreaming = 2,
   };
 
   static void SetDefaultClockSource(ProfilerClockSource clock_source);
@@ -68,6 +74,7 @@ class Trace : public instrumentation::InstrumentationListener {
 
   bool UseWallClock();
   bool UseThreadCpuClock();
+  bool UseCycleCounter();
 
   void CompareAndUpdateStackTrace(Thread* thread, std::vector<mirror::ArtMethod*>* stack_trace)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -97,9 +104,27 @@ class Trace : public instrumentation::InstrumentationListener {
  private:
   explicit Trace(File* trace_file, int buffer_size, int flags, bool sampling_enabled);
 
+  ~Trace();
+
   // The sampling interval in microseconds is passed as an argument.
   static void* RunSamplingThread(void* arg) LOCKS_EXCLUDED(Locks::trace_lock_);
 
+  // Writes the buffers threads have filled to the trace file until streaming is finished.
+  static void* RunStreamingThread(void* arg) LOCKS_EXCLUDED(streaming_lock_);
+  void WriteStreamedBuffers() LOCKS_EXCLUDED(streaming_lock_);
+
+  // Returns where the next record of thread goes when streaming, NULL if the writer thread is so
+  // far behind that buffer_size_ worth of buffers are in use.
+  uint8_t* GetStreamingRecord(Thread* thread) LOCKS_EXCLUDED(streaming_lock_);
+
+  // Queues the full buffer of thread, if any, and gives thread an empty one.
+  std::vector<uint8_t>* ExchangeStreamingBuffer(Thread* thread, std::vector<uint8_t>* full)
+      LOCKS_EXCLUDED(streaming_lock_);
+
+  // Queues what the suspended threads have buffered and waits for the writer thread to finish.
+  void FinishStreaming() EXCLUSIVE_LOCKS_REQUIRED(Locks::mutator_lock_)
+      LOCKS_EXCLUDED(Locks::thread_list_lock_, streaming_lock_);
+
   void FinishTracing() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void ReadClocks(Thread* thread, uint32_t* thread_clock_diff, uint32_t* wall_clock_diff);
@@ -109,7 +134,8 @@ class Trace : public instrumentation::InstrumentationListener {
                            uint32_t thread_clock_diff, uint32_t wall_clock_diff);
 
   // Methods to output traced methods and threads.
-  void GetVisitedMethods(size_t end_offset, std::set<mirror::ArtMethod*>* visited_methods);
+  void GetVisitedMethods(const uint8_t* begin, const uint8_t* end,
+                         std::set<mirror::ArtMethod*>* visited_methods);
   void DumpMethodList(std::ostream& os, const std::set<mirror::ArtMethod*>& visited_methods)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void DumpThreadList(std::ostream& os) LOCKS_EXCLUDED(Locks::thread_list_lock_);
@@ -140,18 +166,55 @@ class Trace : public instrumentation::InstrumentationListener {
 
   const ProfilerClockSource clock_source_;
 
+  // Calibration of the cycle counter when it is the clock source, 0 otherwise.
+  const double usec_per_cycle_;
+
   // Size of buf_.
   const int buffer_size_;
 
   // Time trace was created.
   const uint64_t start_time_;
 
+  // Cycle counter when the trace was created, if it is the clock source.
+  const uint64_t start_cycles_;
+
   // Offset into buf_.
   volatile int32_t cur_offset_;
 
   // Did we overflow the buffer recording traces?
   bool overflow_;
 
+  // True if records are written to trace_file_ while tracing, in which case buf_ only holds the
+  // binary header and buffer_size_ bounds the memory used by the threads' buffers.
+  const bool streaming_;
+
+  // Offset of the binary header in trace_file_ when streaming. The text header is inserted there
+  // once tracing finishes, so that the file has the same layout as a buffered trace.
+  int64_t stream_start_offset_;
+
+  Mutex streaming_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  ConditionVariable streaming_cond_ GUARDED_BY(streaming_lock_);
+
+  // Buffers waiting for the writer thread, in the order they filled up.
+  std::deque<std::vector<uint8_t>*> full_buffers_ GUARDED_BY(streaming_lock_);
+
+  // Written buffers ready to be handed to threads again.
+  std::vector<std::vector<uint8_t>*> free_buffers_ GUARDED_BY(streaming_lock_);
+
+  // Buffers currently handed to threads, including threads that have exited since.
+  std::set<std::vector<uint8_t>*> thread_buffers_ GUARDED_BY(streaming_lock_);
+
+  size_t num_streaming_buffers_ GUARDED_BY(streaming_lock_);
+  bool streaming_finished_ GUARDED_BY(streaming_lock_);
+
+  pthread_t streaming_pthread_;
+
+  // Only used by the writer thread until it has been joined.
+  std::set<mirror::ArtMethod*> streamed_methods_;
+  size_t streamed_bytes_;
+  // errno of the first failed write of streamed data, 0 if there was none.
+  int stream_write_errno_;
+
   DISALLOW_COPY_AND_ASSIGN(Trace);
 };
 
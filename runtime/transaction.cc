@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "transaction.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "mirror/array.h"
+#include "mirror/art_field-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "object_utils.h"
+
+namespace art {
+
+void Transaction::RecordWrite(mirror::Object* obj, MemberOffset offset, size_t size,
+                              bool is_reference) {
+  DCHECK(obj != NULL);
+  DCHECK(size == 1 || size == 2 || size == 4 || size == 8) << size;
+  std::pair<mirror::Object*, uint32_t> location(obj, offset.Uint32Value());
+  if (log_.find(location) != log_.end()) {
+    return;  // Only the value from before the transaction matters.
+  }
+  OldValue old_value;
+  old_value.value = 0;
+  memcpy(&old_value.value, reinterpret_cast<const byte*>(obj) + offset.Int32Value(), size);
+  old_value.size = size;
+  old_value.is_reference = is_reference;
+  log_.Put(location, old_value);
+}
+
+void Transaction::RecordFieldWrite(mirror::Object* obj, const mirror::ArtField* field) {
+  Primitive::Type type = FieldHelper(field).GetTypeAsPrimitiveType();
+  // Fields narrower than an int still occupy 32 bits.
+  size_t size = (type == Primitive::kPrimLong || type == Primitive::kPrimDouble) ? 8 : 4;
+  RecordWrite(obj, field->GetOffset(), size, type == Primitive::kPrimNot);
+}
+
+void Transaction::RecordArrayWrite(mirror::Array* array, int32_t index, int32_t count) {
+  mirror::Class* component_type = array->GetClass()->GetComponentType();
+  size_t component_size = array->GetClass()->GetComponentSize();
+  bool is_reference = !component_type->IsPrimitive();
+  int32_t data_offset = mirror::Array::DataOffset(component_size).Int32Value();
+  for (int32_t i = index; i < index + count; ++i) {
+    RecordWrite(array, MemberOffset(data_offset + i * component_size), component_size,
+                is_reference);
+  }
+}
+
+void Transaction::Abort(const std::string& reason) {
+  if (!aborted_) {
+    aborted_ = true;
+    abort_message_ = reason;
+  }
+}
+
+void Transaction::Rollback() {
+  for (const Log::value_type& entry : log_) {
+    mirror::Object* obj = entry.first.first;
+    MemberOffset offset(entry.first.second);
+    const OldValue& old_value = entry.second;
+    if (old_value.is_reference) {
+      // Go through the object so that the card is marked.
+      mirror::Object* old_ref =
+          reinterpret_cast<mirror::Object*>(static_cast<uintptr_t>(old_value.value));
+      obj->SetFieldObject(offset, old_ref, false);
+    } else {
+      memcpy(reinterpret_cast<byte*>(obj) + offset.Int32Value(), &old_value.value,
+             old_value.size);
+    }
+  }
+  log_.clear();
+}
+
+void Transaction::VisitRoots(RootVisitor* visitor, void* arg) {
+  // Objects don't move, the log only has to keep the objects it may write and restore alive.
+  for (const Log::value_type& entry : log_) {
+    visitor(entry.first.first, arg);
+    if (entry.second.is_reference && entry.second.value != 0) {
+      visitor(reinterpret_cast<mirror::Object*>(static_cast<uintptr_t>(entry.second.value)),
+              arg);
+    }
+  }
+}
+
+}  // namespace art
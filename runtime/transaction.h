@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_TRANSACTION_H_
+#define ART_RUNTIME_TRANSACTION_H_
+
+#include <string>
+#include <utility>
+
+#include "base/macros.h"
+#include "locks.h"
+#include "offsets.h"
+#include "root_visitor.h"
+#include "safe_map.h"
+
+namespace art {
+
+namespace mirror {
+class Array;
+class ArtField;
+class Object;
+}  // namespace mirror
+
+// Undo log for the stores a thread makes while running code whose effects may have to be thrown
+// away, such as a class initializer run by the compiler to snapshot its result in the image. The
+// owning thread records the old value of every field and array element before it stores to it,
+// the first record for a location wins. Operations that can't be undone abort the transaction,
+// the caller is then expected to call Rollback. Interned strings and writes to objects allocated
+// outside of the interpreter by runtime internals are not recorded.
+class Transaction {
+ public:
+  Transaction() : aborted_(false) {}
+
+  // Records the value of size bytes at offset in obj, a reference if is_reference.
+  void RecordWrite(mirror::Object* obj, MemberOffset offset, size_t size, bool is_reference)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  void RecordFieldWrite(mirror::Object* obj, const mirror::ArtField* field)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Records count elements of array starting at index.
+  void RecordArrayWrite(mirror::Array* array, int32_t index, int32_t count)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Marks the transaction as failed with the given reason, the first reason is kept.
+  void Abort(const std::string& reason);
+
+  bool IsAborted() const {
+    return aborted_;
+  }
+
+  const std::string& GetAbortMessage() const {
+    return abort_message_;
+  }
+
+  // Restores every recorded location to its value before the transaction.
+  void Rollback() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  size_t NumRecordedWrites() const {
+    return log_.size();
+  }
+
+  void VisitRoots(RootVisitor* visitor, void* arg);
+
+ private:
+  struct OldValue {
+    uint64_t value;
+    size_t size;
+    bool is_reference;
+  };
+  typedef SafeMap<std::pair<mirror::Object*, uint32_t>, OldValue> Log;
+
+  Log log_;
+  bool aborted_;
+  std::string abort_message_;
+
+  DISALLOW_COPY_AND_ASSIGN(Transaction);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_TRANSACTION_H_
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "transaction.h"
+
+#include "common_test.h"
+#include "mirror/array-inl.h"
+#include "mirror/art_field-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/string.h"
+#include "sirt_ref.h"
+
+namespace art {
+
+class TransactionTest : public CommonTest {};
+
+TEST_F(TransactionTest, ArrayRollback) {
+  ScopedObjectAccess soa(Thread::Current());
+  SirtRef<mirror::IntArray> ints(soa.Self(), mirror::IntArray::Alloc(soa.Self(), 4));
+  ASSERT_TRUE(ints.get() != NULL);
+  SirtRef<mirror::ObjectArray<mirror::Object> > objects(soa.Self(),
+      class_linker_->AllocObjectArray<mirror::Object>(soa.Self(), 2));
+  ASSERT_TRUE(objects.get() != NULL);
+  ints->Set(1, 7);
+
+  Transaction transaction;
+  transaction.RecordArrayWrite(ints.get(), 0, 4);
+  for (int32_t i = 0; i < 4; ++i) {
+    ints->Set(i, 100 + i);
+  }
+  transaction.RecordArrayWrite(objects.get(), 1, 1);
+  objects->Set(1, ints.get());
+  transaction.Rollback();
+
+  EXPECT_EQ(0, ints->Get(0));
+  EXPECT_EQ(7, ints->Get(1));
+  EXPECT_EQ(0, ints->Get(3));
+  EXPECT_TRUE(objects->Get(1) == NULL);
+  EXPECT_EQ(0U, transaction.NumRecordedWrites());
+}
+
+TEST_F(TransactionTest, FieldRollbackKeepsFirstValue) {
+  ScopedObjectAccess soa(Thread::Current());
+  SirtRef<mirror::String> string(soa.Self(),
+                                 mirror::String::AllocFromModifiedUtf8(soa.Self(), "abc"));
+  ASSERT_TRUE(string.get() != NULL);
+  mirror::ArtField* count = string->GetClass()->FindDeclaredInstanceField("count", "I");
+  ASSERT_TRUE(count != NULL);
+
+  Transaction transaction;
+  transaction.RecordFieldWrite(string.get(), count);
+  count->SetInt(string.get(), 1);
+  transaction.RecordFieldWrite(string.get(), count);
+  count->SetInt(string.get(), 2);
+  EXPECT_EQ(1U, transaction.NumRecordedWrites());
+  transaction.Rollback();
+  EXPECT_EQ(3, string->GetLength());
+}
+
+TEST_F(TransactionTest, ClassInitializationRollback) {
+  ScopedObjectAccess soa(Thread::Current());
+  SirtRef<mirror::ClassLoader> class_loader(soa.Self(),
+                                            soa.Decode<mirror::ClassLoader*>(LoadDex("Statics")));
+  SirtRef<mirror::Class> statics(soa.Self(),
+                                 class_linker_->FindClass("LStatics;", class_loader.get()));
+  ASSERT_TRUE(statics.get() != NULL);
+  class_linker_->VerifyClass(statics.get());
+  ASSERT_TRUE(statics->IsVerified());
+
+  Transaction transaction;
+  soa.Self()->SetTransaction(&transaction);
+  ASSERT_TRUE(class_linker_->EnsureInitialized(statics.get(), true, true));
+  soa.Self()->SetTransaction(NULL);
+  mirror::ArtField* s4 = statics->FindStaticField("s4", "I");
+  ASSERT_TRUE(s4 != NULL);
+  EXPECT_EQ(2000000000, s4->GetInt(statics.get()));
+  transaction.Rollback();
+
+  EXPECT_EQ(mirror::Class::kStatusVerified, statics->GetStatus());
+  EXPECT_EQ(0, statics->GetClinitThreadId());
+  EXPECT_EQ(0, s4->GetInt(statics.get()));
+}
+
+TEST_F(TransactionTest, Abort) {
+  Transaction transaction;
+  EXPECT_FALSE(transaction.IsAborted());
+  transaction.Abort("first");
+  transaction.Abort("second");
+  EXPECT_TRUE(transaction.IsAborted());
+  EXPECT_EQ("first", transaction.GetAbortMessage());
+}
+
+}  // namespace art
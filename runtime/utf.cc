@@ -16,16 +16,147 @@
 
 #include "utf.h"
 
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #include "base/logging.h"
 #include "mirror/array.h"
 #include "mirror/object-inl.h"
+#include "utils.h"
 
 namespace art {
 
+// Runs of ASCII, where modified UTF-8 and UTF-16 only differ in the width of their code units, are
+// converted a block at a time. NUL isn't part of a run, since modified UTF-8 encodes it in two
+// bytes and uses a 0 byte as terminator.
+static const size_t kAsciiBlockSize = 16;
+
+#if !defined(__SSE2__) && !defined(__ARM_NEON__)
+// Whether none of the bytes of word is 0 or has its top bit set: subtracting 1 from each byte only
+// sets the top bit of, or borrows from, the bytes that are 0.
+static inline bool IsAsciiWord(uint64_t word) {
+  const uint64_t kOnes = UINT64_C(0x0101010101010101);
+  const uint64_t kTopBits = UINT64_C(0x8080808080808080);
+  return ((word | (word - kOnes)) & kTopBits) == 0;
+}
+#endif
+
+// Whether the block of bytes at utf8 is a run of ASCII. Blocks are aligned, so that they never
+// cross from the page of a string's terminator into an unmapped one.
+static inline bool IsAsciiBlock(const char* utf8) {
+  DCHECK(IsAligned<kAsciiBlockSize>(utf8));
+#if defined(__SSE2__)
+  __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8));
+  int bad = _mm_movemask_epi8(bytes) |
+      _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()));
+  return bad == 0;
+#elif defined(__ARM_NEON__)
+  // 0 wraps around to 0xff, so only 1 to 0x7f end up below 0x7f.
+  uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(utf8));
+  uint8x16_t bad = vcgeq_u8(vsubq_u8(bytes, vdupq_n_u8(1)), vdupq_n_u8(0x7f));
+  uint64x2_t bad64 = vreinterpretq_u64_u8(bad);
+  return (vgetq_lane_u64(bad64, 0) | vgetq_lane_u64(bad64, 1)) == 0;
+#else
+  uint64_t words[kAsciiBlockSize / sizeof(uint64_t)];
+  memcpy(words, utf8, sizeof(words));
+  return IsAsciiWord(words[0]) && IsAsciiWord(words[1]);
+#endif
+}
+
+// Converts the aligned block of bytes at utf8 if it is a run of ASCII, returns false otherwise.
+static inline bool ConvertAsciiBlock(uint16_t* utf16_out, const char* utf8) {
+#if defined(__SSE2__)
+  DCHECK(IsAligned<kAsciiBlockSize>(utf8));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(utf8));
+  if ((_mm_movemask_epi8(bytes) | _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero))) != 0) {
+    return false;
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(utf16_out), _mm_unpacklo_epi8(bytes, zero));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(utf16_out + 8), _mm_unpackhi_epi8(bytes, zero));
+  return true;
+#elif defined(__ARM_NEON__)
+  if (!IsAsciiBlock(utf8)) {
+    return false;
+  }
+  uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(utf8));
+  vst1q_u16(utf16_out, vmovl_u8(vget_low_u8(bytes)));
+  vst1q_u16(utf16_out + 8, vmovl_u8(vget_high_u8(bytes)));
+  return true;
+#else
+  if (!IsAsciiBlock(utf8)) {
+    return false;
+  }
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    utf16_out[i] = static_cast<uint8_t>(utf8[i]);
+  }
+  return true;
+#endif
+}
+
+// Whether the block of chars at utf16 is a run of ASCII.
+static inline bool IsAsciiBlock(const uint16_t* utf16) {
+#if defined(__SSE2__)
+  // Chars from 0x100 saturate to 0xff and, being negative as signed values, those from 0x8000 to 0,
+  // so the packed bytes are a run of ASCII only if the chars are.
+  __m128i bytes = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(utf16)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf16 + 8)));
+  int bad = _mm_movemask_epi8(bytes) |
+      _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()));
+  return bad == 0;
+#elif defined(__ARM_NEON__)
+  // Chars from 0x100 saturate to 0xff.
+  uint8x16_t bytes = vcombine_u8(vqmovn_u16(vld1q_u16(utf16)), vqmovn_u16(vld1q_u16(utf16 + 8)));
+  uint8x16_t bad = vcgeq_u8(vsubq_u8(bytes, vdupq_n_u8(1)), vdupq_n_u8(0x7f));
+  uint64x2_t bad64 = vreinterpretq_u64_u8(bad);
+  return (vgetq_lane_u64(bad64, 0) | vgetq_lane_u64(bad64, 1)) == 0;
+#else
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    if (static_cast<uint16_t>(utf16[i] - 1) >= 0x7f) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+// Converts the block of chars at utf16 if it is a run of ASCII, returns false otherwise.
+static inline bool ConvertAsciiBlock(char* utf8_out, const uint16_t* utf16) {
+  if (!IsAsciiBlock(utf16)) {
+    return false;
+  }
+#if defined(__SSE2__)
+  __m128i bytes = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(utf16)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf16 + 8)));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(utf8_out), bytes);
+#elif defined(__ARM_NEON__)
+  vst1q_u8(reinterpret_cast<uint8_t*>(utf8_out),
+           vcombine_u8(vmovn_u16(vld1q_u16(utf16)), vmovn_u16(vld1q_u16(utf16 + 8))));
+#else
+  for (size_t i = 0; i < kAsciiBlockSize; ++i) {
+    utf8_out[i] = utf16[i];
+  }
+#endif
+  return true;
+}
+
 size_t CountModifiedUtf8Chars(const char* utf8) {
   size_t len = 0;
   int ic;
-  while ((ic = *utf8++) != '\0') {
+  while ((ic = *utf8) != '\0') {
+    if (IsAligned<kAsciiBlockSize>(utf8) && IsAsciiBlock(utf8)) {
+      len += kAsciiBlockSize;
+      utf8 += kAsciiBlockSize;
+      continue;
+    }
+    utf8++;
     len++;
     if ((ic & 0x80) == 0) {
       // one-byte encoding
@@ -45,23 +176,41 @@ size_t CountModifiedUtf8Chars(const char* utf8) {
 
 void ConvertModifiedUtf8ToUtf16(uint16_t* utf16_data_out, const char* utf8_data_in) {
   while (*utf8_data_in != '\0') {
+    if (IsAligned<kAsciiBlockSize>(utf8_data_in) &&
+        ConvertAsciiBlock(utf16_data_out, utf8_data_in)) {
+      utf16_data_out += kAsciiBlockSize;
+      utf8_data_in += kAsciiBlockSize;
+      continue;
+    }
     *utf16_data_out++ = GetUtf16FromUtf8(&utf8_data_in);
   }
 }
 
 void ConvertUtf16ToModifiedUtf8(char* utf8_out, const uint16_t* utf16_in, size_t char_count) {
-  while (char_count--) {
-    uint16_t ch = *utf16_in++;
-    if (ch > 0 && ch <= 0x7f) {
-      *utf8_out++ = ch;
-    } else {
-      if (ch > 0x07ff) {
-        *utf8_out++ = (ch >> 12) | 0xe0;
-        *utf8_out++ = ((ch >> 6) & 0x3f) | 0x80;
-        *utf8_out++ = (ch & 0x3f) | 0x80;
-      } else /*(ch > 0x7f || ch == 0)*/ {
-        *utf8_out++ = (ch >> 6) | 0xc0;
-        *utf8_out++ = (ch & 0x3f) | 0x80;
+  while (char_count != 0) {
+    if (char_count >= kAsciiBlockSize && ConvertAsciiBlock(utf8_out, utf16_in)) {
+      utf8_out += kAsciiBlockSize;
+      utf16_in += kAsciiBlockSize;
+      char_count -= kAsciiBlockSize;
+      continue;
+    }
+    // Chars a block isn't a run of ASCII are converted one at a time, so that text without much
+    // ASCII isn't tested a block per char.
+    size_t count = std::min(char_count, kAsciiBlockSize);
+    char_count -= count;
+    while (count--) {
+      uint16_t ch = *utf16_in++;
+      if (ch > 0 && ch <= 0x7f) {
+        *utf8_out++ = ch;
+      } else {
+        if (ch > 0x07ff) {
+          *utf8_out++ = (ch >> 12) | 0xe0;
+          *utf8_out++ = ((ch >> 6) & 0x3f) | 0x80;
+          *utf8_out++ = (ch & 0x3f) | 0x80;
+        } else /*(ch > 0x7f || ch == 0)*/ {
+          *utf8_out++ = (ch >> 6) | 0xc0;
+          *utf8_out++ = (ch & 0x3f) | 0x80;
+        }
       }
     }
   }
@@ -69,19 +218,24 @@ void ConvertUtf16ToModifiedUtf8(char* utf8_out, const uint16_t* utf16_in, size_t
 
 int32_t ComputeUtf16Hash(const mirror::CharArray* chars, int32_t offset,
                          size_t char_count) {
-  int32_t hash = 0;
-  for (size_t i = 0; i < char_count; i++) {
-    hash = hash * 31 + chars->Get(offset + i);
-  }
-  return hash;
+  DCHECK_LE(offset + char_count, static_cast<size_t>(chars->GetLength()));
+  return ComputeUtf16Hash(chars->GetData() + offset, char_count);
 }
 
 int32_t ComputeUtf16Hash(const uint16_t* chars, size_t char_count) {
-  int32_t hash = 0;
+  // Four chars a step, as hash * 31^4 + c0 * 31^3 + c1 * 31^2 + c2 * 31 + c3, which doesn't wait on
+  // the multiplication of the previous char. Unsigned so that it wraps around like Java's int.
+  uint32_t hash = 0;
+  while (char_count >= 4) {
+    hash = hash * (31 * 31 * 31 * 31) + chars[0] * (31u * 31 * 31) + chars[1] * (31u * 31) +
+        chars[2] * 31u + chars[3];
+    chars += 4;
+    char_count -= 4;
+  }
   while (char_count--) {
     hash = hash * 31 + *chars++;
   }
-  return hash;
+  return static_cast<int32_t>(hash);
 }
 
 
@@ -138,15 +292,26 @@ int CompareModifiedUtf8ToUtf16AsCodePointValues(const char* utf8_1, const uint16
 
 size_t CountUtf8Bytes(const uint16_t* chars, size_t char_count) {
   size_t result = 0;
-  while (char_count--) {
-    uint16_t ch = *chars++;
-    if (ch > 0 && ch <= 0x7f) {
-      ++result;
-    } else {
-      if (ch > 0x7ff) {
-        result += 3;
+  while (char_count != 0) {
+    if (char_count >= kAsciiBlockSize && IsAsciiBlock(chars)) {
+      result += kAsciiBlockSize;
+      chars += kAsciiBlockSize;
+      char_count -= kAsciiBlockSize;
+      continue;
+    }
+    // As in ConvertUtf16ToModifiedUtf8.
+    size_t count = std::min(char_count, kAsciiBlockSize);
+    char_count -= count;
+    while (count--) {
+      uint16_t ch = *chars++;
+      if (ch > 0 && ch <= 0x7f) {
+        ++result;
       } else {
-        result += 2;
+        if (ch > 0x7ff) {
+          result += 3;
+        } else {
+          result += 2;
+        }
       }
     }
   }
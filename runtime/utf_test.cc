@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utf.h"
+
+#include <string>
+#include <vector>
+
+#include "common_test.h"
+#include "utils.h"
+
+namespace art {
+
+class UtfTest : public CommonTest {};
+
+// ASCII runs long enough for the block conversions, broken by NULs and two- and three-byte chars
+// at every offset within a block.
+static std::vector<uint16_t> MixedChars(size_t length, size_t break_at) {
+  std::vector<uint16_t> chars;
+  for (size_t i = 0; i < length; ++i) {
+    if (i % 37 == break_at) {
+      chars.push_back(0);
+    } else if (i % 41 == break_at) {
+      chars.push_back(0x00e9);
+    } else if (i % 43 == break_at) {
+      chars.push_back(0x20ac);
+    } else {
+      chars.push_back('a' + i % 26);
+    }
+  }
+  return chars;
+}
+
+TEST_F(UtfTest, RoundTrip) {
+  for (size_t break_at = 0; break_at < 37; ++break_at) {
+    for (size_t length = 0; length < 100; ++length) {
+      std::vector<uint16_t> chars(MixedChars(length, break_at));
+      size_t utf8_length = CountUtf8Bytes(chars.data(), chars.size());
+      // Start the modified UTF-8 at every alignment.
+      std::string utf8(utf8_length + 16, '\0');
+      char* utf8_begin = &utf8[length % 16];
+      ConvertUtf16ToModifiedUtf8(utf8_begin, chars.data(), chars.size());
+      ASSERT_EQ(utf8_length, strlen(utf8_begin));
+      ASSERT_EQ(chars.size(), CountModifiedUtf8Chars(utf8_begin));
+      std::vector<uint16_t> converted(chars.size());
+      ConvertModifiedUtf8ToUtf16(converted.data(), utf8_begin);
+      EXPECT_TRUE(converted == chars) << PrintableString(utf8_begin);
+    }
+  }
+}
+
+TEST_F(UtfTest, Encodings) {
+  const uint16_t chars[] = { 'A', 0, 0x7f, 0x80, 0x7ff, 0x800, 0xffff };
+  const char expected[] = "A\xc0\x80\x7f\xc2\x80\xdf\xbf\xe0\xa0\x80\xef\xbf\xbf";
+  ASSERT_EQ(sizeof(expected) - 1, CountUtf8Bytes(chars, arraysize(chars)));
+  char utf8[sizeof(expected)] = {};
+  ConvertUtf16ToModifiedUtf8(utf8, chars, arraysize(chars));
+  EXPECT_STREQ(expected, utf8);
+}
+
+TEST_F(UtfTest, ComputeUtf16Hash) {
+  for (size_t length = 0; length < 20; ++length) {
+    std::vector<uint16_t> chars(MixedChars(length, 5));
+    chars.push_back(0xffff);
+    int32_t expected = 0;
+    for (size_t i = 0; i < chars.size(); ++i) {
+      expected = static_cast<int32_t>(static_cast<uint32_t>(expected) * 31 + chars[i]);
+    }
+    EXPECT_EQ(expected, ComputeUtf16Hash(chars.data(), chars.size()));
+  }
+}
+
+// Not a check, logs how fast ASCII text converts.
+TEST_F(UtfTest, AsciiBenchmark) {
+  const size_t kLength = 1 * MB;
+  const size_t kIterations = 20;
+  std::string utf8(kLength, 'x');
+  std::vector<uint16_t> utf16(kLength);
+  uint64_t start_ns = NanoTime();
+  size_t count = 0;
+  for (size_t i = 0; i < kIterations; ++i) {
+    count += CountModifiedUtf8Chars(utf8.c_str());
+    ConvertModifiedUtf8ToUtf16(utf16.data(), utf8.c_str());
+  }
+  uint64_t to_utf16_ns = NanoTime() - start_ns;
+  start_ns = NanoTime();
+  for (size_t i = 0; i < kIterations; ++i) {
+    count += CountUtf8Bytes(utf16.data(), kLength);
+    ConvertUtf16ToModifiedUtf8(&utf8[0], utf16.data(), kLength);
+  }
+  uint64_t to_utf8_ns = NanoTime() - start_ns;
+  EXPECT_EQ(2 * kIterations * kLength, count);
+  LOG(INFO) << "Counting and converting " << PrettySize(kLength) << " of ASCII: "
+            << PrettyDuration(to_utf16_ns / kIterations) << " to UTF-16, "
+            << PrettyDuration(to_utf8_ns / kIterations) << " to modified UTF-8";
+}
+
+}  // namespace art
@@ -306,6 +306,18 @@ static constexpr inline uint64_t MsToNs(uint64_t ns) {
 // Sleep for the given number of nanoseconds, a bad way to handle contention.
 void NanoSleep(uint64_t ns);
 
+// Tells the CPU we are in a spin loop, so that it can save power and give the core to a sibling
+// hardware thread.
+static inline void SpinPause() {
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("pause" ::: "memory");
+#elif defined(__ARM_ARCH_7A__)
+  __asm__ __volatile__("yield" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
 // Initialize a timespec to either an absolute or relative time.
 void InitTimeSpec(bool absolute, int clock, int64_t ms, int32_t ns, timespec* ts);
 
@@ -52,6 +52,7 @@ void PcToRegisterLineTable::Init(RegisterTrackingMode mode, InstructionFlags* fl
                                  MethodVerifier* verifier) {
   DCHECK_GT(insns_size, 0U);
 
+  pc_to_register_line_.resize(insns_size, NULL);
   for (uint32_t i = 0; i < insns_size; i++) {
     bool interesting = false;
     switch (mode) {
@@ -68,7 +69,7 @@ void PcToRegisterLineTable::Init(RegisterTrackingMode mode, InstructionFlags* fl
         break;
     }
     if (interesting) {
-      pc_to_register_line_.Put(i, new RegisterLine(registers_size, verifier));
+      pc_to_register_line_[i] = RegisterLine::Create(registers_size, verifier);
     }
   }
 }
@@ -129,6 +130,8 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
   }
   size_t error_count = 0;
   bool hard_fail = false;
+  std::set<std::string> unresolved_descriptors;
+  bool has_direct_soft_failure = false;
   ClassLinker* linker = Runtime::Current()->GetClassLinker();
   int64_t previous_direct_method_idx = -1;
   while (it.HasNextDirectMethod()) {
@@ -156,7 +159,9 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
                                                       it.GetMethodCodeItem(),
                                                       method,
                                                       it.GetMemberAccessFlags(),
-                                                      allow_soft_failures);
+                                                      allow_soft_failures,
+                                                      &unresolved_descriptors,
+                                                      &has_direct_soft_failure);
     if (result != kNoFailure) {
       if (result == kHardFailure) {
         hard_fail = true;
@@ -198,7 +203,9 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
                                                       it.GetMethodCodeItem(),
                                                       method,
                                                       it.GetMemberAccessFlags(),
-                                                      allow_soft_failures);
+                                                      allow_soft_failures,
+                                                      &unresolved_descriptors,
+                                                      &has_direct_soft_failure);
     if (result != kNoFailure) {
       if (result == kHardFailure) {
         hard_fail = true;
@@ -214,6 +221,10 @@ MethodVerifier::FailureKind MethodVerifier::VerifyClass(const DexFile* dex_file,
     }
     it.Next();
   }
+  if (!hard_fail && !has_direct_soft_failure && Runtime::Current()->IsCompiler()) {
+    ClassReference ref(dex_file, dex_file->GetIndexForClassDef(*class_def));
+    AddVerificationDependencies(ref, unresolved_descriptors);
+  }
   if (error_count == 0) {
     return kNoFailure;
   } else {
@@ -229,7 +240,10 @@ MethodVerifier::FailureKind MethodVerifier::VerifyMethod(uint32_t method_idx,
                                                          const DexFile::CodeItem* code_item,
                                                          mirror::ArtMethod* method,
                                                          uint32_t method_access_flags,
-                                                         bool allow_soft_failures) {
+                                                         bool allow_soft_failures,
+                                                         std::set<std::string>*
+                                                             unresolved_descriptors,
+                                                         bool* has_direct_soft_failure) {
   MethodVerifier::FailureKind result = kNoFailure;
   uint64_t start_ns = NanoTime();
 
@@ -239,6 +253,8 @@ MethodVerifier::FailureKind MethodVerifier::VerifyMethod(uint32_t method_idx,
     // Verification completed, however failures may be pending that didn't cause the verification
     // to hard fail.
     CHECK(!verifier_.have_pending_hard_failure_);
+    verifier_.reg_types_.GetUnresolvedDescriptors(unresolved_descriptors);
+    *has_direct_soft_failure |= verifier_.have_direct_soft_failure_;
     if (verifier_.failures_.size() != 0) {
       if (VLOG_IS_ON(verifier)) {
           verifier_.DumpFailures(VLOG_STREAM(verifier) << "Soft verification failures in "
@@ -288,7 +304,8 @@ MethodVerifier::MethodVerifier(const DexFile* dex_file, mirror::DexCache* dex_ca
                                uint32_t dex_method_idx, mirror::ArtMethod* method,
                                uint32_t method_access_flags, bool can_load_classes,
                                bool allow_soft_failures)
-    : reg_types_(can_load_classes),
+    : arena_(Runtime::Current()->GetArenaPool()),
+      reg_types_(can_load_classes, &arena_),
       work_insn_idx_(-1),
       dex_method_idx_(dex_method_idx),
       mirror_method_(method),
@@ -303,6 +320,7 @@ MethodVerifier::MethodVerifier(const DexFile* dex_file, mirror::DexCache* dex_ca
       monitor_enter_dex_pcs_(NULL),
       have_pending_hard_failure_(false),
       have_pending_runtime_throw_failure_(false),
+      have_direct_soft_failure_(false),
       new_instance_count_(0),
       monitor_enter_count_(0),
       can_load_classes_(can_load_classes),
@@ -387,7 +405,8 @@ mirror::ArtMethod* MethodVerifier::FindInvokedMethodAtDexPc(uint32_t dex_pc) {
     return NULL;
   }
   const Instruction* inst = Instruction::At(code_item_->insns_ + dex_pc);
-  const bool is_range = (inst->Opcode() == Instruction::INVOKE_VIRTUAL_RANGE_QUICK);
+  const bool is_range = (inst->Opcode() == Instruction::INVOKE_VIRTUAL_RANGE_QUICK ||
+                         inst->Opcode() == Instruction::INVOKE_SUPER_RANGE_QUICK);
   return GetQuickInvokedMethod(inst, register_line, is_range);
 }
 
@@ -449,6 +468,7 @@ std::ostream& MethodVerifier::Fail(VerifyError error) {
       if (!allow_soft_failures_) {
         have_pending_hard_failure_ = true;
       }
+      have_direct_soft_failure_ = true;
       break;
       // Hard verification failures at compile time will still fail at runtime, so the class is
       // marked as rejected to prevent it from being compiled.
@@ -1034,8 +1054,8 @@ bool MethodVerifier::VerifyCodeFlow() {
                   this);
 
 
-  work_line_.reset(new RegisterLine(registers_size, this));
-  saved_line_.reset(new RegisterLine(registers_size, this));
+  work_line_.reset(RegisterLine::Create(registers_size, this));
+  saved_line_.reset(RegisterLine::Create(registers_size, this));
 
   /* Initialize register types of method arguments. */
   if (!SetTypesFromSignature()) {
@@ -1052,7 +1072,7 @@ bool MethodVerifier::VerifyCodeFlow() {
   }
 
   // Compute information for compiler.
-  if (Runtime::Current()->IsCompiler()) {
+  if (keeps_compiler_info_) {
     MethodReference ref(dex_file_, dex_method_idx_);
     bool compile = IsCandidateForCompilation(ref, method_access_flags_);
     if (compile) {
@@ -1275,27 +1295,17 @@ bool MethodVerifier::CodeFlowVerifyMethod() {
   const uint32_t insns_size = code_item_->insns_size_in_code_units_;
 
   /* Begin by marking the first instruction as "changed". */
-  insn_flags_[0].SetChanged();
+  MarkChanged(0);
   uint32_t start_guess = 0;
 
   /* Continue until no instructions are marked "changed". */
-  while (true) {
-    // Find the first marked one. Use "start_guess" as a way to find one quickly.
-    uint32_t insn_idx = start_guess;
-    for (; insn_idx < insns_size; insn_idx++) {
-      if (insn_flags_[insn_idx].IsChanged())
-        break;
-    }
-    if (insn_idx == insns_size) {
-      if (start_guess != 0) {
-        /* try again, starting from the top */
-        start_guess = 0;
-        continue;
-      } else {
-        /* all flags are clear */
-        break;
-      }
+  while (!changed_insns_.empty()) {
+    // Take the first marked one at or after "start_guess", otherwise start again from the top.
+    std::set<uint32_t>::iterator next = changed_insns_.lower_bound(start_guess);
+    if (next == changed_insns_.end()) {
+      next = changed_insns_.begin();
     }
+    uint32_t insn_idx = *next;
     // We carry the working set of registers from instruction to instruction. If this address can
     // be the target of a branch (or throw) instruction, or if we're skipping around chasing
     // "changed" flags, we need to load the set of registers from the table.
@@ -1333,6 +1343,7 @@ bool MethodVerifier::CodeFlowVerifyMethod() {
     /* Clear "changed" and mark as visited. */
     insn_flags_[insn_idx].SetVisited();
     insn_flags_[insn_idx].ClearChanged();
+    changed_insns_.erase(insn_idx);
   }
 
   if (gDebugVerify) {
@@ -1935,7 +1946,7 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
 
         if (!cast_type.IsUnresolvedTypes() && !orig_type.IsUnresolvedTypes() &&
             !cast_type.GetClass()->IsInterface() && !cast_type.IsAssignableFrom(orig_type)) {
-          RegisterLine* update_line = new RegisterLine(code_item_->registers_size_, this);
+          RegisterLine* update_line = RegisterLine::Create(code_item_->registers_size_, this);
           if (inst->Opcode() == Instruction::IF_EQZ) {
             fallthrough_line.reset(update_line);
           } else {
@@ -2549,9 +2560,30 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
     case Instruction::IPUT_OBJECT_QUICK:
       VerifyIPutQuick(inst, reg_types_.JavaLangObject(false), false);
       break;
+    case Instruction::SGET_QUICK:
+      VerifyIGetQuick(inst, reg_types_.Integer(), true);
+      break;
+    case Instruction::SGET_WIDE_QUICK:
+      VerifyIGetQuick(inst, reg_types_.LongLo(), true);
+      break;
+    case Instruction::SGET_OBJECT_QUICK:
+      VerifyIGetQuick(inst, reg_types_.JavaLangObject(false), false);
+      break;
+    case Instruction::SPUT_QUICK:
+      VerifyIPutQuick(inst, reg_types_.Integer(), true);
+      break;
+    case Instruction::SPUT_WIDE_QUICK:
+      VerifyIPutQuick(inst, reg_types_.LongLo(), true);
+      break;
+    case Instruction::SPUT_OBJECT_QUICK:
+      VerifyIPutQuick(inst, reg_types_.JavaLangObject(false), false);
+      break;
     case Instruction::INVOKE_VIRTUAL_QUICK:
-    case Instruction::INVOKE_VIRTUAL_RANGE_QUICK: {
-      bool is_range = (inst->Opcode() == Instruction::INVOKE_VIRTUAL_RANGE_QUICK);
+    case Instruction::INVOKE_VIRTUAL_RANGE_QUICK:
+    case Instruction::INVOKE_SUPER_QUICK:
+    case Instruction::INVOKE_SUPER_RANGE_QUICK: {
+      bool is_range = (inst->Opcode() == Instruction::INVOKE_VIRTUAL_RANGE_QUICK ||
+                       inst->Opcode() == Instruction::INVOKE_SUPER_RANGE_QUICK);
       mirror::ArtMethod* called_method = VerifyInvokeVirtualQuickArgs(inst, is_range);
       if (called_method != NULL) {
         const char* descriptor = MethodHelper(called_method).GetReturnTypeDescriptor();
@@ -2575,14 +2607,6 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
     case Instruction::UNUSED_43:
     case Instruction::UNUSED_79:
     case Instruction::UNUSED_7A:
-    case Instruction::UNUSED_EB:
-    case Instruction::UNUSED_EC:
-    case Instruction::UNUSED_ED:
-    case Instruction::UNUSED_EE:
-    case Instruction::UNUSED_EF:
-    case Instruction::UNUSED_F0:
-    case Instruction::UNUSED_F1:
-    case Instruction::UNUSED_F2:
     case Instruction::UNUSED_F3:
     case Instruction::UNUSED_F4:
     case Instruction::UNUSED_F5:
@@ -2788,7 +2812,7 @@ bool MethodVerifier::CodeFlowVerifyInstruction(uint32_t* start_guess) {
        * We're not recording register data for the next instruction, so we don't know what the
        * prior state was. We have to assume that something has changed and re-evaluate it.
        */
-      insn_flags_[next_insn_idx].SetChanged();
+      MarkChanged(next_insn_idx);
     }
   }
 
@@ -3110,11 +3134,29 @@ mirror::ArtMethod* MethodVerifier::GetQuickInvokedMethod(const Instruction* inst
                                                               RegisterLine* reg_line,
                                                               bool is_range) {
   DCHECK(inst->Opcode() == Instruction::INVOKE_VIRTUAL_QUICK ||
-         inst->Opcode() == Instruction::INVOKE_VIRTUAL_RANGE_QUICK);
+         inst->Opcode() == Instruction::INVOKE_VIRTUAL_RANGE_QUICK ||
+         inst->Opcode() == Instruction::INVOKE_SUPER_QUICK ||
+         inst->Opcode() == Instruction::INVOKE_SUPER_RANGE_QUICK);
   const RegType& actual_arg_type = reg_line->GetInvocationThis(inst, is_range);
   if (actual_arg_type.IsConflict()) {  // GetInvocationThis failed.
     return NULL;
   }
+  uint16_t vtable_index = is_range ? inst->VRegB_3rc() : inst->VRegB_35c();
+  if (inst->Opcode() == Instruction::INVOKE_SUPER_QUICK ||
+      inst->Opcode() == Instruction::INVOKE_SUPER_RANGE_QUICK) {
+    // invoke-super-quick dispatches through the vtable of the superclass of the caller, whatever
+    // the class of the receiver.
+    const RegType& declaring_class = GetDeclaringClass();
+    if (!declaring_class.HasClass()) {
+      return NULL;
+    }
+    mirror::Class* super_class = declaring_class.GetClass()->GetSuperClass();
+    if (super_class == NULL || super_class->GetVTable() == NULL ||
+        vtable_index >= super_class->GetVTable()->GetLength()) {
+      return NULL;
+    }
+    return super_class->GetVTable()->Get(vtable_index);
+  }
   mirror::Class* this_class = NULL;
   if (!actual_arg_type.IsUnresolvedTypes()) {
     this_class = actual_arg_type.GetClass();
@@ -3133,7 +3175,6 @@ mirror::ArtMethod* MethodVerifier::GetQuickInvokedMethod(const Instruction* inst
   }
   mirror::ObjectArray<mirror::ArtMethod>* vtable = this_class->GetVTable();
   CHECK(vtable != NULL);
-  uint16_t vtable_index = is_range ? inst->VRegB_3rc() : inst->VRegB_35c();
   CHECK(vtable_index < vtable->GetLength());
   mirror::ArtMethod* res_method = vtable->Get(vtable_index);
   CHECK(!Thread::Current()->IsExceptionPending());
@@ -3616,7 +3657,22 @@ static mirror::ArtField* FindInstanceFieldWithOffset(const mirror::Class* klass,
   }
 }
 
-// Returns the access field of a quick field access (iget/iput-quick) or NULL
+static mirror::ArtField* FindStaticFieldWithOffset(const mirror::Class* klass,
+                                                uint32_t field_offset)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+  const mirror::ObjectArray<mirror::ArtField>* static_fields = klass->GetSFields();
+  if (static_fields != NULL) {
+    for (int32_t i = 0, e = static_fields->GetLength(); i < e; ++i) {
+      mirror::ArtField* field = static_fields->Get(i);
+      if (field->GetOffset().Uint32Value() == field_offset) {
+        return field;
+      }
+    }
+  }
+  return NULL;
+}
+
+// Returns the access field of a quick field access (iget/iput-quick or sget/sput-quick) or NULL
 // if it cannot be found.
 mirror::ArtField* MethodVerifier::GetQuickFieldAccess(const Instruction* inst,
                                                    RegisterLine* reg_line) {
@@ -3625,7 +3681,21 @@ mirror::ArtField* MethodVerifier::GetQuickFieldAccess(const Instruction* inst,
          inst->Opcode() == Instruction::IGET_OBJECT_QUICK ||
          inst->Opcode() == Instruction::IPUT_QUICK ||
          inst->Opcode() == Instruction::IPUT_WIDE_QUICK ||
-         inst->Opcode() == Instruction::IPUT_OBJECT_QUICK);
+         inst->Opcode() == Instruction::IPUT_OBJECT_QUICK ||
+         inst->Opcode() == Instruction::SGET_QUICK ||
+         inst->Opcode() == Instruction::SGET_WIDE_QUICK ||
+         inst->Opcode() == Instruction::SGET_OBJECT_QUICK ||
+         inst->Opcode() == Instruction::SPUT_QUICK ||
+         inst->Opcode() == Instruction::SPUT_WIDE_QUICK ||
+         inst->Opcode() == Instruction::SPUT_OBJECT_QUICK);
+  if (Instruction::FormatOf(inst->Opcode()) == Instruction::k21c) {
+    // sget/sput-quick only access static fields of the class declaring the method.
+    const RegType& declaring_class = GetDeclaringClass();
+    if (!declaring_class.HasClass()) {
+      return NULL;
+    }
+    return FindStaticFieldWithOffset(declaring_class.GetClass(), inst->VRegB_21c());
+  }
   const RegType& object_type = reg_line->GetRegisterType(inst->VRegB_22c());
   mirror::Class* object_class = NULL;
   if (!object_type.IsUnresolvedTypes()) {
@@ -3661,7 +3731,7 @@ void MethodVerifier::VerifyIGetQuick(const Instruction* inst, const RegType& ins
   const char* descriptor = FieldHelper(field).GetTypeDescriptor();
   mirror::ClassLoader* loader = field->GetDeclaringClass()->GetClassLoader();
   const RegType& field_type = reg_types_.FromDescriptor(loader, descriptor, false);
-  const uint32_t vregA = inst->VRegA_22c();
+  const uint32_t vregA = inst->VRegA();
   if (is_primitive) {
     if (field_type.Equals(insn_type) ||
         (field_type.IsFloat() && insn_type.IsIntegralTypes()) ||
@@ -3712,7 +3782,7 @@ void MethodVerifier::VerifyIPutQuick(const Instruction* inst, const RegType& ins
       return;
     }
   }
-  const uint32_t vregA = inst->VRegA_22c();
+  const uint32_t vregA = inst->VRegA();
   if (is_primitive) {
     // Primitive field assignability rules are weaker than regular assignability rules
     bool instruction_compatible;
@@ -3804,7 +3874,7 @@ bool MethodVerifier::UpdateRegisters(uint32_t next_insn, const RegisterLine* mer
     }
   } else {
     UniquePtr<RegisterLine> copy(gDebugVerify ?
-                                 new RegisterLine(target_line->NumRegs(), this) :
+                                 RegisterLine::Create(target_line->NumRegs(), this) :
                                  NULL);
     if (gDebugVerify) {
       copy->CopyFromLine(target_line);
@@ -3822,7 +3892,7 @@ bool MethodVerifier::UpdateRegisters(uint32_t next_insn, const RegisterLine* mer
     }
   }
   if (changed) {
-    insn_flags_[next_insn].SetChanged();
+    MarkChanged(next_insn);
   }
   return true;
 }
@@ -4076,7 +4146,7 @@ void MethodVerifier::VerifyGcMap(const std::vector<uint8_t>& data) {
 }
 
 void MethodVerifier::SetDexGcMap(MethodReference ref, const std::vector<uint8_t>& gc_map) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(keeps_compiler_info_);
   {
     WriterMutexLock mu(Thread::Current(), *dex_gc_maps_lock_);
     DexGcMapTable::iterator it = dex_gc_maps_->find(ref);
@@ -4091,7 +4161,7 @@ void MethodVerifier::SetDexGcMap(MethodReference ref, const std::vector<uint8_t>
 
 
 void  MethodVerifier::SetSafeCastMap(MethodReference ref, const MethodSafeCastSet* cast_set) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(keeps_compiler_info_);
   WriterMutexLock mu(Thread::Current(), *safecast_map_lock_);
   SafeCastMap::iterator it = safecast_map_->find(ref);
   if (it != safecast_map_->end()) {
@@ -4103,7 +4173,7 @@ void  MethodVerifier::SetSafeCastMap(MethodReference ref, const MethodSafeCastSe
 }
 
 bool MethodVerifier::IsSafeCast(MethodReference ref, uint32_t pc) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(keeps_compiler_info_);
   ReaderMutexLock mu(Thread::Current(), *safecast_map_lock_);
   SafeCastMap::const_iterator it = safecast_map_->find(ref);
   if (it == safecast_map_->end()) {
@@ -4116,7 +4186,7 @@ bool MethodVerifier::IsSafeCast(MethodReference ref, uint32_t pc) {
 }
 
 const std::vector<uint8_t>* MethodVerifier::GetDexGcMap(MethodReference ref) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(keeps_compiler_info_);
   ReaderMutexLock mu(Thread::Current(), *dex_gc_maps_lock_);
   DexGcMapTable::const_iterator it = dex_gc_maps_->find(ref);
   CHECK(it != dex_gc_maps_->end())
@@ -4127,7 +4197,7 @@ const std::vector<uint8_t>* MethodVerifier::GetDexGcMap(MethodReference ref) {
 
 void  MethodVerifier::SetDevirtMap(MethodReference ref,
                                    const PcToConcreteMethodMap* devirt_map) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(keeps_compiler_info_);
   WriterMutexLock mu(Thread::Current(), *devirt_maps_lock_);
   DevirtualizationMapTable::iterator it = devirt_maps_->find(ref);
   if (it != devirt_maps_->end()) {
@@ -4141,7 +4211,7 @@ void  MethodVerifier::SetDevirtMap(MethodReference ref,
 
 const MethodReference* MethodVerifier::GetDevirtMap(const MethodReference& ref,
                                                                     uint32_t dex_pc) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(keeps_compiler_info_);
   ReaderMutexLock mu(Thread::Current(), *devirt_maps_lock_);
   DevirtualizationMapTable::const_iterator it = devirt_maps_->find(ref);
   if (it == devirt_maps_->end()) {
@@ -4217,6 +4287,8 @@ bool MethodVerifier::IsCandidateForCompilation(MethodReference& method_ref,
   return (Runtime::Current()->GetCompilerFilter() != Runtime::kInterpretOnly);
 }
 
+bool MethodVerifier::keeps_compiler_info_ = false;
+
 ReaderWriterMutex* MethodVerifier::dex_gc_maps_lock_ = NULL;
 MethodVerifier::DexGcMapTable* MethodVerifier::dex_gc_maps_ = NULL;
 
@@ -4229,8 +4301,12 @@ MethodVerifier::DevirtualizationMapTable* MethodVerifier::devirt_maps_ = NULL;
 ReaderWriterMutex* MethodVerifier::rejected_classes_lock_ = NULL;
 MethodVerifier::RejectedClassesTable* MethodVerifier::rejected_classes_ = NULL;
 
+ReaderWriterMutex* MethodVerifier::verification_dependencies_lock_ = NULL;
+MethodVerifier::VerificationDependenciesTable* MethodVerifier::verification_dependencies_ = NULL;
+
 void MethodVerifier::Init() {
-  if (Runtime::Current()->IsCompiler()) {
+  keeps_compiler_info_ = Runtime::Current()->IsCompiler() || Runtime::Current()->GetJit() != NULL;
+  if (keeps_compiler_info_) {
     dex_gc_maps_lock_ = new ReaderWriterMutex("verifier GC maps lock");
     Thread* self = Thread::Current();
     {
@@ -4256,12 +4332,18 @@ void MethodVerifier::Init() {
       WriterMutexLock mu(self, *rejected_classes_lock_);
       rejected_classes_ = new MethodVerifier::RejectedClassesTable;
     }
+
+    verification_dependencies_lock_ = new ReaderWriterMutex("verifier dependencies lock");
+    {
+      WriterMutexLock mu(self, *verification_dependencies_lock_);
+      verification_dependencies_ = new MethodVerifier::VerificationDependenciesTable;
+    }
   }
   art::verifier::RegTypeCache::Init();
 }
 
 void MethodVerifier::Shutdown() {
-  if (Runtime::Current()->IsCompiler()) {
+  if (keeps_compiler_info_) {
     Thread* self = Thread::Current();
     {
       WriterMutexLock mu(self, *dex_gc_maps_lock_);
@@ -4297,12 +4379,20 @@ void MethodVerifier::Shutdown() {
     }
     delete rejected_classes_lock_;
     rejected_classes_lock_ = NULL;
+
+    {
+      WriterMutexLock mu(self, *verification_dependencies_lock_);
+      delete verification_dependencies_;
+      verification_dependencies_ = NULL;
+    }
+    delete verification_dependencies_lock_;
+    verification_dependencies_lock_ = NULL;
   }
   verifier::RegTypeCache::ShutDown();
 }
 
 void MethodVerifier::AddRejectedClass(ClassReference ref) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(keeps_compiler_info_);
   {
     WriterMutexLock mu(Thread::Current(), *rejected_classes_lock_);
     rejected_classes_->insert(ref);
@@ -4311,10 +4401,30 @@ void MethodVerifier::AddRejectedClass(ClassReference ref) {
 }
 
 bool MethodVerifier::IsClassRejected(ClassReference ref) {
-  DCHECK(Runtime::Current()->IsCompiler());
+  DCHECK(keeps_compiler_info_);
   ReaderMutexLock mu(Thread::Current(), *rejected_classes_lock_);
   return (rejected_classes_->find(ref) != rejected_classes_->end());
 }
 
+void MethodVerifier::AddVerificationDependencies(ClassReference ref,
+                                                 const std::set<std::string>& descriptors) {
+  DCHECK(Runtime::Current()->IsCompiler());
+  WriterMutexLock mu(Thread::Current(), *verification_dependencies_lock_);
+  verification_dependencies_->Overwrite(ref, std::vector<std::string>(descriptors.begin(),
+                                                                      descriptors.end()));
+}
+
+bool MethodVerifier::GetVerificationDependencies(ClassReference ref,
+                                                 std::vector<std::string>* descriptors) {
+  DCHECK(Runtime::Current()->IsCompiler());
+  ReaderMutexLock mu(Thread::Current(), *verification_dependencies_lock_);
+  VerificationDependenciesTable::const_iterator it = verification_dependencies_->find(ref);
+  if (it == verification_dependencies_->end()) {
+    return false;
+  }
+  *descriptors = it->second;
+  return true;
+}
+
 }  // namespace verifier
 }  // namespace art
@@ -20,6 +20,7 @@
 #include <set>
 #include <vector>
 
+#include "base/arena_allocator.h"
 #include "base/casts.h"
 #include "base/macros.h"
 #include "base/stl_util.h"
@@ -108,11 +109,14 @@ enum RegisterTrackingMode {
 
 // A mapping from a dex pc to the register line statuses as they are immediately prior to the
 // execution of that instruction.
+//
+// The lines are indexed directly by dex pc, the flow analysis looks one up for every instruction
+// it interprets and a map lookup dominated the verification of large methods.
 class PcToRegisterLineTable {
  public:
   PcToRegisterLineTable() {}
   ~PcToRegisterLineTable() {
-    STLDeleteValues(&pc_to_register_line_);
+    STLDeleteElements(&pc_to_register_line_);
   }
 
   // Initialize the RegisterTable. Every instruction address can have a different set of information
@@ -121,18 +125,13 @@ class PcToRegisterLineTable {
   void Init(RegisterTrackingMode mode, InstructionFlags* flags, uint32_t insns_size,
             uint16_t registers_size, MethodVerifier* verifier);
 
+  // Returns NULL if no registers are stored for the instruction at idx.
   RegisterLine* GetLine(size_t idx) {
-    auto result = pc_to_register_line_.find(idx);
-    if (result == pc_to_register_line_.end()) {
-      return NULL;
-    } else {
-      return result->second;
-    }
+    return (idx < pc_to_register_line_.size()) ? pc_to_register_line_[idx] : NULL;
   }
 
  private:
-  typedef SafeMap<int32_t, RegisterLine*> Table;
-  Table pc_to_register_line_;
+  std::vector<RegisterLine*> pc_to_register_line_;
 };
 
 // The verifier
@@ -171,6 +170,11 @@ class MethodVerifier {
     return &reg_types_;
   }
 
+  // Storage for the reg types and register lines, released when the verifier is destroyed.
+  ArenaAllocator* GetArena() {
+    return &arena_;
+  }
+
   // Log a verification failure.
   std::ostream& Fail(VerifyError error);
 
@@ -219,6 +223,15 @@ class MethodVerifier {
   static bool IsClassRejected(ClassReference ref)
       LOCKS_EXCLUDED(rejected_classes_lock_);
 
+  // Compile time only. Returns true if every failure found when verifying the class was for a
+  // class, field or method that couldn't be found or accessed, with descriptors set to the classes
+  // that failed to resolve. As long as those still fail to resolve, verifying the class at runtime
+  // gives the same result, where these failures only make the instructions throw. Returns false
+  // if the class had other failures or wasn't verified.
+  static bool GetVerificationDependencies(ClassReference ref,
+                                          std::vector<std::string>* descriptors)
+      LOCKS_EXCLUDED(verification_dependencies_lock_);
+
   bool CanLoadClasses() const {
     return can_load_classes_;
   }
@@ -268,7 +281,9 @@ class MethodVerifier {
                                   const DexFile::ClassDef* class_def_idx,
                                   const DexFile::CodeItem* code_item,
                                   mirror::ArtMethod* method, uint32_t method_access_flags,
-                                  bool allow_soft_failures)
+                                  bool allow_soft_failures,
+                                  std::set<std::string>* unresolved_descriptors,
+                                  bool* has_direct_soft_failure)
           SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   void FindLocksAtDexPc() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -465,6 +480,12 @@ class MethodVerifier {
    */
   bool CodeFlowVerifyMethod() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Flags the instruction at insn_idx to be (re-)interpreted by CodeFlowVerifyMethod.
+  void MarkChanged(uint32_t insn_idx) {
+    insn_flags_[insn_idx].SetChanged();
+    changed_insns_.insert(insn_idx);
+  }
+
   /*
    * Perform verification for a single instruction.
    *
@@ -631,6 +652,10 @@ class MethodVerifier {
 
   InstructionFlags* CurrentInsnFlags();
 
+  // Set by Init in dex2oat and when the runtime has a JIT. The verifier then keeps the GC maps,
+  // safe casts, devirtualization maps and rejected classes the compiler asks for.
+  static bool keeps_compiler_info_;
+
   // All the GC maps that the verifier has created
   typedef SafeMap<const MethodReference, const std::vector<uint8_t>*,
       MethodReferenceComparator> DexGcMapTable;
@@ -670,6 +695,18 @@ class MethodVerifier {
   static void AddRejectedClass(ClassReference ref)
       LOCKS_EXCLUDED(rejected_classes_lock_);
 
+  typedef SafeMap<ClassReference, std::vector<std::string> > VerificationDependenciesTable;
+  static ReaderWriterMutex* verification_dependencies_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  static VerificationDependenciesTable* verification_dependencies_
+      GUARDED_BY(verification_dependencies_lock_);
+
+  static void AddVerificationDependencies(ClassReference ref,
+                                          const std::set<std::string>& descriptors)
+      LOCKS_EXCLUDED(verification_dependencies_lock_);
+
+  // Declared ahead of the reg types and lines so that it outlives them.
+  ArenaAllocator arena_;
+
   RegTypeCache reg_types_;
 
   PcToRegisterLineTable reg_table_;
@@ -698,6 +735,9 @@ class MethodVerifier {
   const RegType* declaring_class_;  // Lazily computed reg type of the method's declaring class.
   // Instruction widths and flags, one entry per code unit.
   UniquePtr<InstructionFlags[]> insn_flags_;
+  // The instructions flagged as changed, in address order. CodeFlowVerifyMethod picks the next
+  // one from here rather than scanning the flags, which made it quadratic in the method size.
+  std::set<uint32_t> changed_insns_;
   // The dex PC of a FindLocksAtDexPc request, -1 otherwise.
   uint32_t interesting_dex_pc_;
   // The container into which FindLocksAtDexPc should write the registers containing held locks,
@@ -715,6 +755,8 @@ class MethodVerifier {
   // to be unreachable. This is set by Fail and used to ensure we don't process unreachable
   // instructions that would hard fail the verification.
   bool have_pending_runtime_throw_failure_;
+  // Is there a soft failure other than one Fail turned soft because it might not occur at runtime?
+  bool have_direct_soft_failure_;
 
   // Info message log use primarily for verifier diagnostics.
   std::ostringstream info_messages_;
@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_VERIFIER_REG_TYPE_H_
 #define ART_RUNTIME_VERIFIER_REG_TYPE_H_
 
+#include "base/arena_allocator.h"
 #include "base/macros.h"
 #include "globals.h"
 #include "primitive.h"
@@ -269,6 +270,16 @@ class RegType {
 
   virtual ~RegType() {}
 
+  // The primitive types are allocated once and shared, the others live in the arena of the
+  // RegTypeCache that created them which only runs their destructors.
+  static void* operator new(size_t size) {
+    return ::operator new(size);
+  }
+
+  static void* operator new(size_t size, ArenaAllocator* arena) {
+    return arena->Alloc(size, ArenaAllocator::kAllocVerifier);
+  }
+
  protected:
   RegType(mirror::Class* klass, const std::string& descriptor, uint16_t cache_id)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_)
@@ -182,9 +182,9 @@ const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descr
     if (klass->CannotBeAssignedFromOtherTypes() || precise) {
       DCHECK(!(klass->IsAbstract()) || klass->IsArrayClass());
       DCHECK(!klass->IsInterface());
-      entry = new PreciseReferenceType(klass, descriptor, entries_.size());
+      entry = new (arena_) PreciseReferenceType(klass, descriptor, entries_.size());
     } else {
-      entry = new ReferenceType(klass, descriptor, entries_.size());
+      entry = new (arena_) ReferenceType(klass, descriptor, entries_.size());
     }
     entries_.push_back(entry);
     return *entry;
@@ -193,7 +193,7 @@ const RegType& RegTypeCache::From(mirror::ClassLoader* loader, const char* descr
     // so we want to clear it before we go on.
     ClearException();
     if (IsValidDescriptor(descriptor)) {
-      RegType* entry = new UnresolvedReferenceType(descriptor, entries_.size());
+      RegType* entry = new (arena_) UnresolvedReferenceType(descriptor, entries_.size());
       entries_.push_back(entry);
       return *entry;
     } else {
@@ -220,25 +220,30 @@ const RegType& RegTypeCache::FromClass(const char* descriptor, mirror::Class* kl
     // No reference to the class was found, create new reference.
     RegType* entry;
     if (precise) {
-      entry = new PreciseReferenceType(klass, descriptor, entries_.size());
+      entry = new (arena_) PreciseReferenceType(klass, descriptor, entries_.size());
     } else {
-      entry = new ReferenceType(klass, descriptor, entries_.size());
+      entry = new (arena_) ReferenceType(klass, descriptor, entries_.size());
     }
     entries_.push_back(entry);
     return *entry;
   }
 }
 
+void RegTypeCache::GetUnresolvedDescriptors(std::set<std::string>* descriptors) const {
+  // The other unresolved types are derived from these.
+  for (size_t i = primitive_count_; i < entries_.size(); i++) {
+    if (entries_[i]->IsUnresolvedReference()) {
+      descriptors->insert(entries_[i]->GetDescriptor());
+    }
+  }
+}
+
 RegTypeCache::~RegTypeCache() {
   CHECK_LE(primitive_count_, entries_.size());
-  // Delete only the non primitive types.
-  if (entries_.size() == kNumPrimitives) {
-    // All entries are primitive, nothing to delete.
-    return;
+  // Destroy only the non primitive types, their storage goes away with the arena.
+  for (size_t i = kNumPrimitives; i < entries_.size(); ++i) {
+    entries_[i]->~RegType();
   }
-  std::vector<RegType*>::iterator non_primitive_begin = entries_.begin();
-  std::advance(non_primitive_begin, kNumPrimitives);
-  STLDeleteContainerPointers(non_primitive_begin, entries_.end());
 }
 
 void RegTypeCache::ShutDown() {
@@ -302,7 +307,8 @@ const RegType& RegTypeCache::FromUnresolvedMerge(const RegType& left, const RegT
     }
   }
   // Create entry.
-  RegType* entry = new UnresolvedMergedType(left.GetId(), right.GetId(), this, entries_.size());
+  RegType* entry = new (arena_) UnresolvedMergedType(left.GetId(), right.GetId(), this,
+                                                     entries_.size());
   entries_.push_back(entry);
   if (kIsDebugBuild) {
     UnresolvedMergedType* tmp_entry = down_cast<UnresolvedMergedType*>(entry);
@@ -326,7 +332,7 @@ const RegType& RegTypeCache::FromUnresolvedSuperClass(const RegType& child) {
       }
     }
   }
-  RegType* entry = new UnresolvedSuperClass(child.GetId(), this, entries_.size());
+  RegType* entry = new (arena_) UnresolvedSuperClass(child.GetId(), this, entries_.size());
   entries_.push_back(entry);
   return *entry;
 }
@@ -344,7 +350,7 @@ const RegType& RegTypeCache::Uninitialized(const RegType& type, uint32_t allocat
         return *cur_entry;
       }
     }
-    entry = new UnresolvedUninitializedRefType(descriptor, allocation_pc, entries_.size());
+    entry = new (arena_) UnresolvedUninitializedRefType(descriptor, allocation_pc, entries_.size());
   } else {
     mirror::Class* klass = type.GetClass();
     for (size_t i = primitive_count_; i < entries_.size(); i++) {
@@ -356,7 +362,8 @@ const RegType& RegTypeCache::Uninitialized(const RegType& type, uint32_t allocat
         return *cur_entry;
       }
     }
-    entry = new UninitializedReferenceType(klass, descriptor, allocation_pc, entries_.size());
+    entry = new (arena_) UninitializedReferenceType(klass, descriptor, allocation_pc,
+                                                    entries_.size());
   }
   entries_.push_back(entry);
   return *entry;
@@ -374,7 +381,7 @@ const RegType& RegTypeCache::FromUninitialized(const RegType& uninit_type) {
         return *cur_entry;
       }
     }
-    entry = new UnresolvedReferenceType(descriptor.c_str(), entries_.size());
+    entry = new (arena_) UnresolvedReferenceType(descriptor.c_str(), entries_.size());
   } else {
     mirror::Class* klass = uninit_type.GetClass();
     if (uninit_type.IsUninitializedThisReference() && !klass->IsFinal()) {
@@ -385,7 +392,7 @@ const RegType& RegTypeCache::FromUninitialized(const RegType& uninit_type) {
           return *cur_entry;
         }
       }
-      entry = new ReferenceType(klass, "", entries_.size());
+      entry = new (arena_) ReferenceType(klass, "", entries_.size());
     } else if (klass->IsInstantiable()) {
       // We're uninitialized because of allocation, look or create a precise type as allocations
       // may only create objects of that type.
@@ -395,7 +402,8 @@ const RegType& RegTypeCache::FromUninitialized(const RegType& uninit_type) {
           return *cur_entry;
         }
       }
-      entry = new PreciseReferenceType(klass, uninit_type.GetDescriptor(), entries_.size());
+      entry = new (arena_) PreciseReferenceType(klass, uninit_type.GetDescriptor(),
+                                                entries_.size());
     } else {
       return Conflict();
     }
@@ -427,7 +435,7 @@ const RegType& RegTypeCache::UninitializedThisArgument(const RegType& type) {
         return *cur_entry;
       }
     }
-    entry = new UnresolvedUninitializedThisRefType(descriptor, entries_.size());
+    entry = new (arena_) UnresolvedUninitializedThisRefType(descriptor, entries_.size());
   } else {
     mirror::Class* klass = type.GetClass();
     for (size_t i = primitive_count_; i < entries_.size(); i++) {
@@ -436,7 +444,7 @@ const RegType& RegTypeCache::UninitializedThisArgument(const RegType& type) {
         return *cur_entry;
       }
     }
-    entry = new UninitializedThisReferenceType(klass, descriptor, entries_.size());
+    entry = new (arena_) UninitializedThisReferenceType(klass, descriptor, entries_.size());
   }
   entries_.push_back(entry);
   return *entry;
@@ -453,9 +461,9 @@ const RegType& RegTypeCache::FromCat1Const(int32_t value, bool precise) {
   }
   RegType* entry;
   if (precise) {
-    entry = new PreciseConstType(value, entries_.size());
+    entry = new (arena_) PreciseConstType(value, entries_.size());
   } else {
-    entry = new ImpreciseConstType(value, entries_.size());
+    entry = new (arena_) ImpreciseConstType(value, entries_.size());
   }
   entries_.push_back(entry);
   return *entry;
@@ -471,9 +479,9 @@ const RegType& RegTypeCache::FromCat2ConstLo(int32_t value, bool precise) {
   }
   RegType* entry;
   if (precise) {
-    entry = new PreciseConstLoType(value, entries_.size());
+    entry = new (arena_) PreciseConstLoType(value, entries_.size());
   } else {
-    entry = new ImpreciseConstLoType(value, entries_.size());
+    entry = new (arena_) ImpreciseConstLoType(value, entries_.size());
   }
   entries_.push_back(entry);
   return *entry;
@@ -489,9 +497,9 @@ const RegType& RegTypeCache::FromCat2ConstHi(int32_t value, bool precise) {
   }
   RegType* entry;
   if (precise) {
-    entry = new PreciseConstHiType(value, entries_.size());
+    entry = new (arena_) PreciseConstHiType(value, entries_.size());
   } else {
-    entry = new ImpreciseConstHiType(value, entries_.size());
+    entry = new (arena_) ImpreciseConstHiType(value, entries_.size());
   }
   entries_.push_back(entry);
   return *entry;
@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_VERIFIER_REG_TYPE_CACHE_H_
 #define ART_RUNTIME_VERIFIER_REG_TYPE_CACHE_H_
 
+#include "base/arena_allocator.h"
 #include "base/casts.h"
 #include "base/macros.h"
 #include "base/stl_util.h"
@@ -24,6 +25,8 @@
 #include "runtime.h"
 
 #include <stdint.h>
+#include <set>
+#include <string>
 #include <vector>
 
 namespace art {
@@ -38,7 +41,10 @@ class RegType;
 const size_t kNumPrimitives = 12;
 class RegTypeCache {
  public:
-  explicit RegTypeCache(bool can_load_classes) : can_load_classes_(can_load_classes) {
+  // Reference and constant types are allocated from arena, which must outlive the cache. The
+  // primitive types are shared by all caches.
+  RegTypeCache(bool can_load_classes, ArenaAllocator* arena)
+      : arena_(arena), can_load_classes_(can_load_classes) {
     entries_.reserve(64);
     FillPrimitiveTypes();
   }
@@ -143,8 +149,11 @@ class RegTypeCache {
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   void Dump(std::ostream& os) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   const RegType& RegTypeFromPrimitiveType(Primitive::Type) const;
+  // Adds the descriptors of the classes that failed to resolve.
+  void GetUnresolvedDescriptors(std::set<std::string>* descriptors) const;
 
  private:
+  ArenaAllocator* const arena_;
   std::vector<RegType*> entries_;
   static bool primitive_initialized_;
   static uint16_t primitive_start_;
@@ -29,7 +29,8 @@ class RegTypeTest : public CommonTest {};
 TEST_F(RegTypeTest, ConstLoHi) {
   // Tests creating primitive types types.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
   const RegType& ref_type_const_0 = cache.FromCat1Const(10, true);
   const RegType& ref_type_const_1 = cache.FromCat1Const(10, true);
   const RegType& ref_type_const_2 = cache.FromCat1Const(30, true);
@@ -51,7 +52,8 @@ TEST_F(RegTypeTest, ConstLoHi) {
 
 TEST_F(RegTypeTest, Pairs) {
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
   int64_t val = static_cast<int32_t>(1234);
   const RegType& precise_lo = cache.FromCat2ConstLo(static_cast<int32_t>(val), true);
   const RegType& precise_hi = cache.FromCat2ConstHi(static_cast<int32_t>(val >> 32), true);
@@ -75,7 +77,8 @@ TEST_F(RegTypeTest, Pairs) {
 
 TEST_F(RegTypeTest, Primitives) {
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
 
   const RegType& bool_reg_type = cache.Boolean();
   EXPECT_FALSE(bool_reg_type.IsUndefined());
@@ -341,7 +344,8 @@ TEST_F(RegTypeReferenceTest, JavalangObjectImprecise) {
   // Tests matching precisions. A reference type that was created precise doesn't
   // match the one that is imprecise.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
   const RegType& imprecise_obj = cache.JavaLangObject(false);
   const RegType& precise_obj = cache.JavaLangObject(true);
   const RegType& precise_obj_2 = cache.FromDescriptor(NULL, "Ljava/lang/Object;", true);
@@ -356,7 +360,8 @@ TEST_F(RegTypeReferenceTest, UnresolvedType) {
   // Tests creating unresolved types. Miss for the first time asking the cache and
   // a hit second time.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
   const RegType& ref_type_0 = cache.FromDescriptor(NULL, "Ljava/lang/DoesNotExist;", true);
   EXPECT_TRUE(ref_type_0.IsUnresolvedReference());
   EXPECT_TRUE(ref_type_0.IsNonZeroReferenceTypes());
@@ -372,7 +377,8 @@ TEST_F(RegTypeReferenceTest, UnresolvedType) {
 TEST_F(RegTypeReferenceTest, UnresolvedUnintializedType) {
   // Tests creating types uninitialized types from unresolved types.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
   const RegType& ref_type_0 = cache.FromDescriptor(NULL, "Ljava/lang/DoesNotExist;", true);
   EXPECT_TRUE(ref_type_0.IsUnresolvedReference());
   const RegType& ref_type = cache.FromDescriptor(NULL, "Ljava/lang/DoesNotExist;", true);
@@ -394,7 +400,8 @@ TEST_F(RegTypeReferenceTest, UnresolvedUnintializedType) {
 TEST_F(RegTypeReferenceTest, Dump) {
   // Tests types for proper Dump messages.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
   const RegType& unresolved_ref = cache.FromDescriptor(NULL, "Ljava/lang/DoesNotExist;", true);
   const RegType& unresolved_ref_another = cache.FromDescriptor(NULL, "Ljava/lang/DoesNotExistEither;", true);
   const RegType& resolved_ref = cache.JavaLangString();
@@ -419,7 +426,8 @@ TEST_F(RegTypeReferenceTest, JavalangString) {
   // Hit the second time. Then check for the same effect when using
   // The JavaLangObject method instead of FromDescriptor. String class is final.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
   const RegType& ref_type = cache.JavaLangString();
   const RegType& ref_type_2 = cache.JavaLangString();
   const RegType& ref_type_3 = cache.FromDescriptor(NULL, "Ljava/lang/String;", true);
@@ -439,7 +447,8 @@ TEST_F(RegTypeReferenceTest, JavalangObject) {
   // Hit the second time. Then I am checking for the same effect when using
   // The JavaLangObject method instead of FromDescriptor. Object Class in not final.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache(true, &arena);
   const RegType& ref_type = cache.JavaLangObject(true);
   const RegType& ref_type_2 = cache.JavaLangObject(true);
   const RegType& ref_type_3 = cache.FromDescriptor(NULL, "Ljava/lang/Object;", true);
@@ -452,7 +461,8 @@ TEST_F(RegTypeReferenceTest, Merging) {
   // Tests merging logic
   // String and object , LUB is object.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache_new(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache_new(true, &arena);
   const RegType& string = cache_new.JavaLangString();
   const RegType& Object = cache_new.JavaLangObject(true);
   EXPECT_TRUE(string.Merge(Object, &cache_new).IsJavaLangObject());
@@ -475,7 +485,8 @@ TEST_F(RegTypeReferenceTest, Merging) {
 TEST_F(RegTypeTest, ConstPrecision) {
   // Tests creating primitive types types.
   ScopedObjectAccess soa(Thread::Current());
-  RegTypeCache cache_new(true);
+  ArenaAllocator arena(Runtime::Current()->GetArenaPool());
+  RegTypeCache cache_new(true, &arena);
   const RegType& imprecise_const = cache_new.FromCat1Const(10, false);
   const RegType& precise_const = cache_new.FromCat1Const(10, true);
 
@@ -23,6 +23,15 @@
 namespace art {
 namespace verifier {
 
+RegisterLine* RegisterLine::Create(size_t num_regs, MethodVerifier* verifier) {
+  // Arena memory is zeroed, which leaves every register undefined.
+  void* memory = verifier->GetArena()->Alloc(sizeof(RegisterLine) + num_regs * sizeof(uint16_t),
+                                             ArenaAllocator::kAllocVerifier);
+  uint16_t* line = reinterpret_cast<uint16_t*>(reinterpret_cast<byte*>(memory) +
+                                               sizeof(RegisterLine));
+  return new (memory) RegisterLine(num_regs, line, verifier);
+}
+
 bool RegisterLine::CheckConstructorReturn() const {
   for (size_t i = 0; i < num_regs_; i++) {
     if (GetRegisterType(i).IsUninitializedThisReference() ||
@@ -457,7 +466,7 @@ bool RegisterLine::VerifyMonitorStackEmpty() const {
 bool RegisterLine::MergeRegisters(const RegisterLine* incoming_line) {
   bool changed = false;
   CHECK(NULL != incoming_line);
-  CHECK(NULL != line_.get());
+  CHECK(NULL != line_);
   for (size_t idx = 0; idx < num_regs_; idx++) {
     if (line_[idx] != incoming_line->line_[idx]) {
       const RegType& incoming_reg_type = incoming_line->GetRegisterType(idx);
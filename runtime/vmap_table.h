@@ -17,6 +17,8 @@
 #ifndef ART_RUNTIME_VMAP_TABLE_H_
 #define ART_RUNTIME_VMAP_TABLE_H_
 
+#include <vector>
+
 #include "base/logging.h"
 #include "leb128.h"
 #include "stack.h"
@@ -25,6 +27,8 @@ namespace art {
 
 class VmapTable {
  public:
+  static const uint8_t kNoRegister = 0xff;
+
   explicit VmapTable(const uint8_t* table) : table_(table) {
   }
 
@@ -45,6 +49,15 @@ class VmapTable {
     return DecodeUnsignedLeb128(&table);
   }
 
+  // The size in bytes of the encoded table.
+  size_t EncodedSize() const {
+    const uint8_t* table = table_;
+    for (size_t i = 0, size = DecodeUnsignedLeb128(&table); i < size; ++i) {
+      DecodeUnsignedLeb128(&table);
+    }
+    return table - table_;
+  }
+
   // Is the dex register 'vreg' in the context or on the stack? Should not be called when the
   // 'kind' is unknown or constant.
   bool IsInContext(size_t vreg, VRegKind kind, uint32_t* vmap_offset) const {
@@ -106,6 +119,40 @@ class VmapTable {
     return spill_shifts;
   }
 
+  // Decodes the whole table into the registers IsInContext and ComputeRegister give one vreg at a
+  // time, indexed by vreg and kNoRegister for the vregs on the stack, for constant time lookups
+  // when many vregs of a frame are read.
+  void DecodeRegisters(uint32_t core_spill_mask, uint32_t fp_spill_mask,
+                       std::vector<uint8_t>* core_registers,
+                       std::vector<uint8_t>* fp_registers) const {
+    core_registers->clear();
+    fp_registers->clear();
+    std::vector<uint8_t>* registers = core_registers;
+    uint32_t spill_mask = core_spill_mask;
+    const uint8_t* table = table_;
+    size_t end = DecodeUnsignedLeb128(&table);
+    for (size_t i = 0; i < end; ++i) {
+      uint16_t entry = DecodeUnsignedLeb128(&table);
+      // The entries take the registers of the spill mask in order, lowest first.
+      DCHECK_NE(spill_mask, 0u);
+      uint8_t reg = __builtin_ctz(spill_mask);
+      spill_mask &= spill_mask - 1;
+      // 0xffff is the marker for LR (return PC on x86), following it are spilled float registers.
+      if (entry == 0xffff) {
+        registers = fp_registers;
+        spill_mask = fp_spill_mask;
+        continue;
+      }
+      if (entry >= registers->size()) {
+        registers->resize(entry + 1, static_cast<uint8_t>(kNoRegister));
+      }
+      // IsInContext finds the first entry.
+      if ((*registers)[entry] == kNoRegister) {
+        (*registers)[entry] = reg;
+      }
+    }
+  }
+
  private:
   const uint8_t* const table_;
 };
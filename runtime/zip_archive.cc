@@ -25,6 +25,7 @@
 
 #include "base/unix_file/fd_file.h"
 #include "UniquePtr.h"
+#include "utils.h"
 
 namespace art {
 
@@ -293,7 +294,32 @@ bool ZipEntry::ExtractToMemory(uint8_t* begin, size_t size) {
   }
 }
 
+MemMap* ZipEntry::MapDirectlyFromFile(const char* entry_filename) {
+  if (GetCompressionMethod() != kCompressStored ||
+      GetCompressedLength() != GetUncompressedLength()) {
+    return NULL;
+  }
+  off64_t data_offset = GetDataOffset();
+  if (data_offset == -1) {
+    return NULL;
+  }
+  // Callers such as DexFile need word aligned data, zipalign provides it for stored entries.
+  if (!IsAligned<4>(data_offset)) {
+    VLOG(startup) << "Zip: '" << entry_filename << "' is stored at unaligned offset "
+                  << data_offset << ", extracting it";
+    return NULL;
+  }
+  // A private mapping still allows the data to be made writable, changes are then copy on write.
+  return MemMap::MapFile(GetUncompressedLength(), PROT_READ, MAP_PRIVATE, zip_archive_->fd_,
+                         data_offset);
+}
+
 MemMap* ZipEntry::ExtractToMemMap(const char* entry_filename) {
+  UniquePtr<MemMap> direct_map(MapDirectlyFromFile(entry_filename));
+  if (direct_map.get() != NULL) {
+    return direct_map.release();
+  }
+
   std::string name(entry_filename);
   name += " extracted in memory from ";
   name += entry_filename;
@@ -60,6 +60,10 @@ class ZipEntry {
   // returns -1 on error
   off64_t GetDataOffset();
 
+  // Maps a stored entry read-only straight from the zip file, which avoids copying it into
+  // anonymous memory. Returns NULL if the entry is compressed or its data isn't word aligned.
+  MemMap* MapDirectlyFromFile(const char* entry_filename);
+
   const ZipArchive* zip_archive_;
 
   // pointer to zip entry within central directory
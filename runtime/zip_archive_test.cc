@@ -57,4 +57,18 @@ TEST_F(ZipArchiveTest, FindAndExtract) {
   EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
 }
 
+TEST_F(ZipArchiveTest, ExtractToMemMap) {
+  UniquePtr<ZipArchive> zip_archive(ZipArchive::Open(GetLibCoreDexFileName()));
+  ASSERT_TRUE(zip_archive.get() != NULL);
+  UniquePtr<ZipEntry> zip_entry(zip_archive->Find("classes.dex"));
+  ASSERT_TRUE(zip_entry.get() != NULL);
+
+  // Stored entries are mapped from the zip file, others are inflated, the contents must match.
+  UniquePtr<MemMap> map(zip_entry->ExtractToMemMap("classes.dex"));
+  ASSERT_TRUE(map.get() != NULL);
+  ASSERT_EQ(zip_entry->GetUncompressedLength(), map->Size());
+  uint32_t computed_crc = crc32(crc32(0L, Z_NULL, 0), map->Begin(), map->Size());
+  EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
+}
+
 }  // namespace art
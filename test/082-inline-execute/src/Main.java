@@ -32,6 +32,8 @@ public class Main {
     test_StrictMath_max();
     test_String_charAt();
     test_String_compareTo();
+    test_String_equals();
+    test_String_hashCode();
     test_String_indexOf();
     test_String_isEmpty();
     test_String_length();
@@ -149,6 +151,74 @@ public class Main {
       Assert.fail();
     } catch (NullPointerException expected) {
     }
+
+    // Matches on either side of the 8 char blocks the vector loops test.
+    String base = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx";
+    for (int length = 0; length <= 33; length++) {
+      String prefix = base.substring(7, 7 + length);
+      Assert.assertEquals(prefix.indexOf('y'), -1);
+      for (int i = 0; i < length; i++) {
+        String str = prefix.substring(0, i) + 'y' + prefix.substring(i + 1);
+        Assert.assertEquals(str.indexOf('y'), i);
+        Assert.assertEquals(str.indexOf('y', i), i);
+        Assert.assertEquals(str.indexOf('y', i + 1), -1);
+        Assert.assertEquals(str.substring(1).indexOf('y'), i - 1);
+      }
+    }
+  }
+
+  public static void test_String_equals() {
+    String base = "0123456789abcdefghijklmnopqrstuvwxyz";
+    String copy = new String(base);
+    Object blah = new Object();
+
+    // Lengths on either side of the 8 char blocks the vector loops compare.
+    for (int length = 0; length <= 33; length++) {
+      String str = base.substring(0, length);
+      String sameChars = copy.substring(0, length);
+      String shifted = ("-" + base).substring(1, length + 1);  // nonzero offset
+      Assert.assertTrue(str.equals(sameChars));
+      Assert.assertTrue(str.equals(shifted));
+      Assert.assertTrue(shifted.equals(str));
+      Assert.assertFalse(str.equals(base.substring(0, length + 1)));
+      Assert.assertFalse(str.equals(blah));
+      Assert.assertFalse(str.equals(null));
+      for (int i = 0; i < length; i++) {
+        String mismatch = str.substring(0, i) + '!' + str.substring(i + 1);
+        Assert.assertFalse(str.equals(mismatch));
+        Assert.assertFalse(mismatch.equals(shifted));
+        Assert.assertEquals(str.compareTo(mismatch), str.charAt(i) - '!');
+      }
+    }
+
+    String strNull = null;
+    try {
+      strNull.equals("x");
+      Assert.fail();
+    } catch (NullPointerException expected) {
+    }
+  }
+
+  public static void test_String_hashCode() {
+    String str0 = "";
+    String str10 = new String("0123456789");
+    int hash = 0;
+    for (int i = 0; i < str10.length(); i++) {
+      hash = 31 * hash + str10.charAt(i);
+    }
+
+    Assert.assertEquals(str0.hashCode(), 0);
+    // Computed by the library, then read back from the cache.
+    Assert.assertEquals(str10.hashCode(), hash);
+    Assert.assertEquals(str10.hashCode(), hash);
+    Assert.assertEquals(str10.substring(0).hashCode(), hash);
+
+    String strNull = null;
+    try {
+      strNull.hashCode();
+      Assert.fail();
+    } catch (NullPointerException expected) {
+    }
   }
 
   public static void test_String_compareTo() {
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class Main {
+    /** Lengths on either side of the 8 char blocks the vector loops compare. */
+    static final int[] LENGTHS = { 1, 7, 8, 9, 16, 31, 64, 100, 257, 1000, 0, 4 };
+
+    static final String[] STRINGS = new String[LENGTHS.length];
+    static final String[] COPIES = new String[LENGTHS.length];
+
+    static public void main(String[] args) {
+        boolean timing = (args.length >= 1) && args[0].equals("--timing");
+        for (int i = 0; i < LENGTHS.length; i++) {
+            StringBuilder sb = new StringBuilder();
+            for (int j = 0; j < LENGTHS[i]; j++) {
+                sb.append((char) ('a' + (j % 26)));
+            }
+            STRINGS[i] = sb.toString();
+            // Same chars at a nonzero offset in a different array.
+            COPIES[i] = ("-" + STRINGS[i] + "!").substring(1, LENGTHS[i] + 1);
+        }
+        run(timing);
+    }
+
+    static public void run(boolean timing) {
+        long time0 = System.nanoTime();
+        int count0 = basis(1000);
+        long time1 = System.nanoTime();
+        int count1 = testEquals(1000);
+        long time2 = System.nanoTime();
+        int count2 = testCompareTo(1000);
+        long time3 = System.nanoTime();
+        int count3 = testIndexOf(1000);
+        long time4 = System.nanoTime();
+        int count4 = testHashCode(1000);
+        long time5 = System.nanoTime();
+
+        System.out.println("basis: performed " + count0 + " comparisons");
+        System.out.println("equals: performed " + count1 + " comparisons");
+        System.out.println("compareTo: performed " + count2 + " comparisons");
+        System.out.println("indexOf: performed " + count3 + " comparisons");
+        System.out.println("hashCode: performed " + count4 + " comparisons");
+
+        double basisUsec = (time1 - time0) / (double) count0 / 1000;
+        double usec1 = (time2 - time1) / (double) count1 / 1000;
+        double usec2 = (time3 - time2) / (double) count2 / 1000;
+        double usec3 = (time4 - time3) / (double) count3 / 1000;
+        double usec4 = (time5 - time4) / (double) count4 / 1000;
+
+        double avg = (usec1 + usec2 + usec3 + usec4) / 4;
+        if (avg < (basisUsec * 2)) {
+            System.out.println("Timing is acceptable.");
+        } else {
+            System.out.println("Comparisons are taking too long!");
+            timing = true;
+        }
+
+        if (timing) {
+            System.out.printf("basis time: %.3g usec\n", basisUsec);
+            System.out.printf("equals: %.3g usec per comparison\n", usec1);
+            System.out.printf("compareTo: %.3g usec per comparison\n", usec2);
+            System.out.printf("indexOf: %.3g usec per comparison\n", usec3);
+            System.out.printf("hashCode: %.3g usec per comparison\n", usec4);
+        }
+    }
+
+    /** The work the intrinsics replace, done a char at a time. */
+    static public int basis(int iters) {
+        int result = 0;
+        for (int i = iters; i > 0; i--) {
+            for (int j = 0; j < STRINGS.length; j++) {
+                if (basisEquals(STRINGS[j], COPIES[j])) {
+                    result++;
+                }
+            }
+        }
+        check(result, iters * STRINGS.length);
+        return iters * STRINGS.length;
+    }
+
+    static private boolean basisEquals(String a, String b) {
+        int length = a.length();
+        if (length != b.length()) {
+            return false;
+        }
+        for (int i = 0; i < length; i++) {
+            if (a.charAt(i) != b.charAt(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static public int testEquals(int iters) {
+        int result = 0;
+        for (int i = iters; i > 0; i--) {
+            for (int j = 0; j < STRINGS.length; j++) {
+                if (STRINGS[j].equals(COPIES[j])) {
+                    result++;
+                }
+            }
+        }
+        check(result, iters * STRINGS.length);
+        return iters * STRINGS.length;
+    }
+
+    static public int testCompareTo(int iters) {
+        int result = 0;
+        for (int i = iters; i > 0; i--) {
+            for (int j = 0; j < STRINGS.length; j++) {
+                if (STRINGS[j].compareTo(COPIES[j]) == 0) {
+                    result++;
+                }
+            }
+        }
+        check(result, iters * STRINGS.length);
+        return iters * STRINGS.length;
+    }
+
+    static public int testIndexOf(int iters) {
+        int result = 0;
+        for (int i = iters; i > 0; i--) {
+            for (int j = 0; j < STRINGS.length; j++) {
+                // Never found, so every char is tested.
+                if (COPIES[j].indexOf('!') == -1) {
+                    result++;
+                }
+            }
+        }
+        check(result, iters * STRINGS.length);
+        return iters * STRINGS.length;
+    }
+
+    static public int testHashCode(int iters) {
+        int result = 0;
+        for (int i = iters; i > 0; i--) {
+            for (int j = 0; j < STRINGS.length; j++) {
+                if (STRINGS[j].hashCode() == COPIES[j].hashCode()) {
+                    result++;
+                }
+            }
+        }
+        check(result, iters * STRINGS.length);
+        return iters * STRINGS.length;
+    }
+
+    static private void check(int actual, int expected) {
+        if (actual != expected) {
+            throw new AssertionError("expected " + expected + " but got " + actual);
+        }
+    }
+}
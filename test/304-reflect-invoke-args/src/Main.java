@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
+
+public class Main {
+    private int base = 100;
+
+    public static void main(String[] args) throws Exception {
+        // Invoke twice, the second call uses what the first one worked out about the method.
+        for (int i = 0; i < 2; i++) {
+            System.out.println("pass " + i);
+            testArguments();
+            testResults();
+            testErrors();
+        }
+    }
+
+    static void testArguments() throws Exception {
+        Method m = Main.class.getDeclaredMethod("all", boolean.class, byte.class, char.class,
+                short.class, int.class, long.class, float.class, double.class, Object.class);
+        System.out.println(m.invoke(null, true, (byte) -1, 'x', (short) -2, -3, -4L, 0.5f, -0.25,
+                "obj"));
+        // Widening conversions.
+        System.out.println(m.invoke(null, false, (byte) 1, 'y', (byte) 2, 'a', 7, (short) 3, 8L,
+                null));
+
+        Method add = Main.class.getDeclaredMethod("add", int.class);
+        System.out.println(add.invoke(new Main(), -7));
+        System.out.println(add.invoke(new Sub(), -7));
+    }
+
+    static void testResults() throws Exception {
+        for (String name : new String[] { "getZ", "getB", "getC", "getS", "getI", "getJ", "getF",
+                "getD", "getV" }) {
+            Method m = Main.class.getDeclaredMethod(name);
+            Object result = m.invoke(null);
+            System.out.println(name + " " + result
+                    + (result == null ? "" : " " + result.getClass().getName()));
+        }
+    }
+
+    static void testErrors() throws Exception {
+        Method add = Main.class.getDeclaredMethod("add", int.class);
+        try {
+            add.invoke(new Main(), 1L);
+        } catch (IllegalArgumentException expected) {
+            System.out.println("long to int: " + expected.getMessage());
+        }
+        try {
+            add.invoke(new Main(), (Object) null);
+        } catch (IllegalArgumentException expected) {
+            System.out.println("null to int: " + expected.getMessage());
+        }
+        try {
+            add.invoke(new Main());
+        } catch (IllegalArgumentException expected) {
+            System.out.println("no args: " + expected.getMessage());
+        }
+        try {
+            add.invoke(null, 1);
+        } catch (NullPointerException expected) {
+            System.out.println("null receiver: " + expected.getMessage());
+        }
+        Method thrower = Main.class.getDeclaredMethod("thrower");
+        try {
+            thrower.invoke(null);
+        } catch (InvocationTargetException expected) {
+            System.out.println("wrapped: " + expected.getCause().getMessage());
+        }
+    }
+
+    static String all(boolean z, byte b, char c, short s, int i, long j, float f, double d,
+            Object l) {
+        return z + " " + b + " " + c + " " + s + " " + i + " " + j + " " + f + " " + d + " " + l;
+    }
+
+    int add(int i) {
+        return base + i;
+    }
+
+    static class Sub extends Main {
+        int add(int i) {
+            return 2 * i;
+        }
+    }
+
+    static boolean getZ() { return true; }
+    static byte getB() { return -8; }
+    static char getC() { return 'c'; }
+    static short getS() { return -16; }
+    static int getI() { return -32; }
+    static long getJ() { return 1L << 40; }
+    static float getF() { return 1.5f; }
+    static double getD() { return -2.5; }
+    static void getV() { }
+
+    static void thrower() {
+        throw new RuntimeException("thrown by thrower");
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.ref.PhantomReference;
+import java.lang.ref.ReferenceQueue;
+import java.lang.ref.WeakReference;
+import java.util.ArrayList;
+
+public class Main {
+    static final int COUNT = 20000;
+
+    public static void main(String[] args) throws Exception {
+        testWeak();
+        testPhantom();
+    }
+
+    static void testWeak() throws Exception {
+        ReferenceQueue<Object> queue = new ReferenceQueue<Object>();
+        ArrayList<Object> reachable = new ArrayList<Object>();
+        ArrayList<WeakReference<Object>> toReachable = new ArrayList<WeakReference<Object>>();
+        ArrayList<WeakReference<Object>> toUnreachable = new ArrayList<WeakReference<Object>>();
+        // Interleave the two kinds so every chunk of the GC's list has both.
+        for (int i = 0; i < COUNT; i++) {
+            Object o = new Object();
+            reachable.add(o);
+            toReachable.add(new WeakReference<Object>(o));
+            toUnreachable.add(new WeakReference<Object>(new Object(), queue));
+        }
+        Runtime.getRuntime().gc();
+
+        int reachableCleared = 0;
+        for (WeakReference<Object> ref : toReachable) {
+            if (ref.get() == null) {
+                reachableCleared++;
+            }
+        }
+        int unreachableCleared = 0;
+        for (WeakReference<Object> ref : toUnreachable) {
+            if (ref.get() == null) {
+                unreachableCleared++;
+            }
+        }
+        System.out.println("weak: " + reachableCleared + " reachable referents cleared, "
+                + unreachableCleared + " unreachable referents cleared, " + drain(queue)
+                + " enqueued");
+        reachable.clear();
+    }
+
+    static void testPhantom() throws Exception {
+        ReferenceQueue<Object> queue = new ReferenceQueue<Object>();
+        ArrayList<PhantomReference<Object>> refs = new ArrayList<PhantomReference<Object>>();
+        for (int i = 0; i < COUNT; i++) {
+            refs.add(new PhantomReference<Object>(new Object(), queue));
+        }
+        Runtime.getRuntime().gc();
+        System.out.println("phantom: " + drain(queue) + " enqueued");
+    }
+
+    // Waits for the reference queue daemon to move every cleared reference to the queue.
+    static int drain(ReferenceQueue<Object> queue) throws Exception {
+        int count = 0;
+        while (queue.remove(1000) != null) {
+            count++;
+        }
+        return count;
+    }
+}
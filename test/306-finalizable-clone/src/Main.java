@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.util.concurrent.atomic.AtomicInteger;
+
+public class Main {
+    static final int COUNT = 1000;
+
+    static final AtomicInteger finalizedOriginals = new AtomicInteger();
+    static final AtomicInteger finalizedClones = new AtomicInteger();
+
+    static class Resource implements Cloneable {
+        boolean isClone;
+
+        @Override
+        public Resource clone() {
+            try {
+                Resource copy = (Resource) super.clone();
+                copy.isClone = true;
+                return copy;
+            } catch (CloneNotSupportedException e) {
+                throw new AssertionError(e);
+            }
+        }
+
+        @Override
+        protected void finalize() {
+            if (isClone) {
+                finalizedClones.incrementAndGet();
+            } else {
+                finalizedOriginals.incrementAndGet();
+            }
+        }
+    }
+
+    public static void main(String[] args) {
+        allocate();
+        for (int i = 0; i < 10 && (finalizedOriginals.get() < COUNT
+                || finalizedClones.get() < COUNT); i++) {
+            Runtime.getRuntime().gc();
+            System.runFinalization();
+        }
+        System.out.println("originals finalized: " + finalizedOriginals.get());
+        System.out.println("clones finalized: " + finalizedClones.get());
+    }
+
+    // In its own method so that no reference stays live in main's frame.
+    static void allocate() {
+        Resource[] clones = new Resource[COUNT];
+        for (int i = 0; i < COUNT; i++) {
+            clones[i] = new Resource().clone();
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.ref.WeakReference;
+import java.lang.reflect.Constructor;
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
+
+/**
+ * Class unloading tests (ART-specific).
+ */
+public class Main {
+    private static final String DEX_LOCATION = System.getenv("DEX_LOCATION");
+    private static final String CLASS_PATH = DEX_LOCATION + "/307-class-unloading-ex.jar";
+    // A library which the runtime links against but never loads through JNI.
+    private static final String LIBRARY =
+        System.getenv("ANDROID_ROOT") + "/lib/libnativehelper.so";
+    private static final String LIB_DIR = "/nowhere/nothing/";
+    private static final int MAX_COLLECTIONS = 10;
+
+    private static ClassLoader reachableLoader;
+
+    public static void main(String[] args) throws Exception {
+        testUnreachableLoader();
+        testReachableLoader();
+        System.out.println("done");
+    }
+
+    private static void testUnreachableLoader() throws Exception {
+        WeakReference<Class<?>> unloadable = loadAndUse();
+        System.out.println("Unloaded the classes of an unreachable loader: " + collect(unloadable));
+
+        // The caches keyed by the unloaded classes and methods must not match the classes and
+        // methods loaded again, which may be allocated at the same addresses.
+        Class<?> reloaded = newLoader().loadClass("Unloadable");
+        System.out.println("Reloaded: " + use(reloaded));
+
+        // The library went away with the loader which loaded it, so another loader may load it.
+        try {
+            loadLibrary(reloaded);
+            System.out.println("Loaded the library of the unloaded loader again");
+        } catch (UnsatisfiedLinkError e) {
+            System.out.println("The library is still held by the unloaded loader");
+        }
+    }
+
+    private static void testReachableLoader() throws Exception {
+        reachableLoader = newLoader();
+        WeakReference<Class<?>> kept =
+            new WeakReference<Class<?>>(reachableLoader.loadClass("Unloadable"));
+        use(kept.get());
+        System.out.println("Kept the classes of a reachable loader: " + !collect(kept));
+        System.out.println("Reused: " + use(kept.get()));
+    }
+
+    // Loads and uses the class with a loader that is unreachable once we return.
+    private static WeakReference<Class<?>> loadAndUse() throws Exception {
+        Class<?> unloadable = newLoader().loadClass("Unloadable");
+        use(unloadable);
+        loadLibrary(unloadable);
+        return new WeakReference<Class<?>>(unloadable);
+    }
+
+    // Fills the inline cache of the interface call site and the plan of the reflective call.
+    private static String use(Class<?> unloadable) throws Exception {
+        Holder holder = (Holder) unloadable.newInstance();
+        int sum = 0;
+        for (int i = 0; i < 100; ++i) {
+            sum += holder.get();
+        }
+        Method twice = unloadable.getMethod("twice", int.class);
+        return sum + " " + twice.invoke(holder, 21);
+    }
+
+    private static void loadLibrary(Class<?> unloadable) throws Exception {
+        try {
+            unloadable.getMethod("loadLibrary", String.class).invoke(null, LIBRARY);
+        } catch (InvocationTargetException e) {
+            throw (Error) e.getCause();
+        }
+    }
+
+    // Returns whether the referent was collected. The finalizers close the dex files of the
+    // unreachable loaders, which are released by the next collection.
+    private static boolean collect(WeakReference<Class<?>> ref) throws Exception {
+        for (int i = 0; i < MAX_COLLECTIONS; ++i) {
+            Runtime.getRuntime().gc();
+            System.runFinalization();
+            if (ref.get() == null) {
+                return true;
+            }
+            // Class unloading waits for background verification to finish.
+            Thread.sleep(100);
+        }
+        return false;
+    }
+
+    /*
+     * Creates a DexClassLoader for the -ex jar. The test harness doesn't have visibility into
+     * dalvik.system.*, so we do this through reflection.
+     */
+    private static ClassLoader newLoader() throws Exception {
+        Class<?> dexClassLoader = Main.class.getClassLoader().loadClass(
+            "dalvik.system.DexClassLoader");
+        Constructor<?> ctor = dexClassLoader.getConstructor(String.class, String.class,
+            String.class, ClassLoader.class);
+        return (ClassLoader) ctor.newInstance(CLASS_PATH, DEX_LOCATION, LIB_DIR,
+            Main.class.getClassLoader());
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The objects allocated below never leave the method that allocates them, so the compiler may
+ * replace their fields by registers. The allocation's register then holds null, which the GC
+ * run at the safepoints after it must accept as a reference.
+ */
+public class Main {
+    static class Point {
+        int x;
+        int y;
+
+        Point(int x, int y) {
+            this.x = x;
+            this.y = y;
+        }
+    }
+
+    static class Fields {
+        int i;
+        long j;
+        Object o;
+
+        Fields() {
+        }
+    }
+
+    static class Wide {
+        long value;
+        int count;
+
+        Wide(long value, int count) {
+            this.value = value;
+            this.count = count;
+        }
+    }
+
+    static Object sink;
+
+    static void collect() {
+        Runtime.getRuntime().gc();
+    }
+
+    static int sum(int x, int y) {
+        Point p = new Point(x, y);
+        collect();
+        return p.x + p.y;
+    }
+
+    static String defaults() {
+        Fields f = new Fields();
+        collect();
+        return f.i + " " + f.j + " " + f.o;
+    }
+
+    static String overwritten(int x, int y) {
+        Point p = new Point(x, y);
+        p.x = 5;
+        collect();
+        p.y += 10;
+        return p.x + " " + p.y;
+    }
+
+    static String wide(long value) {
+        Wide w = new Wide(value, 3);
+        collect();
+        return w.value + " " + w.count;
+    }
+
+    static String afterGc() {
+        // Keep a garbage object in a register before the replaced allocation.
+        sink = new Object[1024];
+        sink = null;
+        Point p = new Point(10, 20);
+        for (int i = 0; i < 3; i++) {
+            collect();
+        }
+        return p.x + " " + p.y;
+    }
+
+    static int loop() {
+        int total = 0;
+        for (int i = 0; i < 100; i++) {
+            Point p = new Point(i, total);
+            total = p.x + p.y;
+        }
+        return total;
+    }
+
+    public static void main(String[] args) {
+        System.out.println("sum: " + sum(3, 4));
+        System.out.println("defaults: " + defaults());
+        System.out.println("overwritten: " + overwritten(1, 2));
+        System.out.println("wide: " + wide(12345678901L));
+        System.out.println("after gc: " + afterGc());
+        System.out.println("loop: " + loop());
+        System.out.println("done");
+    }
+}
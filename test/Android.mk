@@ -54,6 +54,10 @@ TEST_OAT_DIRECTORIES := \
 # TODO: Enable when the StackWalk2 tests are passing
 #	StackWalk2 \
 
+# subdirectories of which are used with test-art-target-benchmark, not part of test-art
+TEST_BENCHMARK_DIRECTORIES := \
+	Benchmarks
+
 ART_TEST_TARGET_DEX_FILES :=
 ART_TEST_HOST_DEX_FILES :=
 
@@ -93,6 +97,7 @@ define build-art-test-dex
 endef
 $(foreach dir,$(TEST_DEX_DIRECTORIES), $(eval $(call build-art-test-dex,art-test-dex,$(dir),$(ART_NATIVETEST_OUT))))
 $(foreach dir,$(TEST_OAT_DIRECTORIES), $(eval $(call build-art-test-dex,oat-test-dex,$(dir),$(ART_TEST_OUT))))
+$(foreach dir,$(TEST_BENCHMARK_DIRECTORIES), $(eval $(call build-art-test-dex,oat-test-dex,$(dir),$(ART_TEST_OUT))))
 
 ########################################################################
 
@@ -148,6 +153,41 @@ $(foreach dir,$(TEST_OAT_DIRECTORIES), $(eval $(call declare-test-art-oat-target
 
 ########################################################################
 
+ART_TEST_TARGET_BENCHMARK_TARGETS :=
+ART_TEST_HOST_BENCHMARK_TARGETS :=
+
+# Benchmarks run with the non-debug runtime and print their results, they don't fail on
+# regressions. Runtime options to compare results with can be given in ART_BENCHMARK_RUNTIME_ARGS,
+# eg ART_BENCHMARK_RUNTIME_ARGS=-XX:HugePages for the gc_ benchmarks.
+ART_BENCHMARK_RUNTIME_ARGS ?=
+# $(1): directory
+# $(2): arguments
+define declare-test-art-benchmark-targets
+.PHONY: test-art-target-benchmark-$(1)
+test-art-target-benchmark-$(1): $(ART_TEST_OUT)/oat-test-dex-$(1).jar test-art-target-sync
+	adb shell sh -c "dalvikvm -XXlib:libart.so -Ximage:$(ART_TEST_DIR)/core.art $(ART_BENCHMARK_RUNTIME_ARGS) -classpath $(ART_TEST_DIR)/oat-test-dex-$(1).jar $(1) $(2)"
+
+ifeq ($(filter $(1),$(TEST_OAT_DIRECTORIES)),)
+$(HOST_OUT_JAVA_LIBRARIES)/oat-test-dex-$(1).odex: $(HOST_OUT_JAVA_LIBRARIES)/oat-test-dex-$(1).jar $(HOST_CORE_IMG_OUT) | $(DEX2OAT)
+	$(DEX2OAT) --runtime-arg -Xms16m --runtime-arg -Xmx16m --boot-image=$(HOST_CORE_IMG_OUT) --dex-file=$(PWD)/$$< --oat-file=$(PWD)/$$@ --instruction-set=$(HOST_ARCH) --host --host-prefix="" --android-root=$(HOST_OUT)
+endif
+
+.PHONY: test-art-host-benchmark-$(1)
+test-art-host-benchmark-$(1): $(HOST_OUT_JAVA_LIBRARIES)/oat-test-dex-$(1).odex test-art-host-dependencies
+	mkdir -p /tmp/android-data/test-art-host-benchmark-$(1)
+	ANDROID_DATA=/tmp/android-data/test-art-host-benchmark-$(1) \
+	  ANDROID_ROOT=$(HOST_OUT) \
+	  LD_LIBRARY_PATH=$(HOST_OUT_SHARED_LIBRARIES) \
+	  dalvikvm -XXlib:libart.so -Ximage:$(shell pwd)/$(HOST_CORE_IMG_OUT) $(ART_BENCHMARK_RUNTIME_ARGS) -classpath $(HOST_OUT_JAVA_LIBRARIES)/oat-test-dex-$(1).jar $(1) $(2)
+	$(hide) rm -r /tmp/android-data/test-art-host-benchmark-$(1)
+
+ART_TEST_TARGET_BENCHMARK_TARGETS += test-art-target-benchmark-$(1)
+ART_TEST_HOST_BENCHMARK_TARGETS += test-art-host-benchmark-$(1)
+endef
+$(foreach dir,$(TEST_BENCHMARK_DIRECTORIES), $(eval $(call declare-test-art-benchmark-targets,$(dir))))
+
+########################################################################
+
 TEST_ART_RUN_TEST_MAKE_TARGETS :=
 
 # Helper to create individual build targets for tests.
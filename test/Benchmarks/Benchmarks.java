@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.reflect.Method;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+import dalvik.system.PathClassLoader;
+
+/**
+ * Benchmarks of the runtime's hot paths. Each result is printed on a line of its own as
+ *
+ *     BENCHMARK <name> <value> <unit>
+ *
+ * after a line giving the version of the format, so that results can be compared across runtime
+ * versions. Names and units don't change once added, new benchmarks get new names. The arguments,
+ * if any, are the names of the benchmarks to run.
+ */
+class Benchmarks {
+    private static final int FORMAT_VERSION = 1;
+
+    // Each timed run is at least this long, the result is the median of RUNS runs.
+    private static final long MIN_RUN_NS = 50 * 1000 * 1000L;
+    private static final int RUNS = 5;
+
+    private static final long GC_PAUSE_RUN_NS = 2000 * 1000 * 1000L;
+
+    // Written by the benchmarks so that their work can't be optimized away.
+    static int sink;
+    static Object objectSink;
+
+    abstract static class Benchmark {
+        final String name;
+
+        Benchmark(String name) {
+            this.name = name;
+        }
+
+        abstract void run(int iterations) throws Exception;
+    }
+
+    public static void main(String[] args) throws Exception {
+        List<String> selected = Arrays.asList(args);
+        System.out.println("BENCHMARKS FORMAT " + FORMAT_VERSION);
+        for (Benchmark benchmark : benchmarks()) {
+            if (selected.isEmpty() || selected.contains(benchmark.name)) {
+                report(benchmark.name, measure(benchmark), "ns/op");
+            }
+        }
+        if (selected.isEmpty() || selected.contains("gc_explicit_pause")) {
+            report("gc_explicit_pause", measureExplicitGc(), "ms");
+        }
+        if (selected.isEmpty() || selected.contains("gc_max_observed_pause")) {
+            report("gc_max_observed_pause", measureMaxObservedGcPause(), "ms");
+        }
+    }
+
+    private static void report(String name, double value, String unit) {
+        System.out.println(String.format("BENCHMARK %s %.2f %s", name, value, unit));
+    }
+
+    // Doubles the iterations until a run is long enough, which also warms the code up for the
+    // compiler, then returns the median time of an iteration.
+    private static double measure(Benchmark benchmark) throws Exception {
+        int iterations = 1;
+        while (time(benchmark, iterations) < MIN_RUN_NS && iterations < (1 << 30)) {
+            iterations *= 2;
+        }
+        double[] nsPerOp = new double[RUNS];
+        for (int i = 0; i < RUNS; ++i) {
+            nsPerOp[i] = (double) time(benchmark, iterations) / iterations;
+        }
+        Arrays.sort(nsPerOp);
+        return nsPerOp[RUNS / 2];
+    }
+
+    private static long time(Benchmark benchmark, int iterations) throws Exception {
+        long start = System.nanoTime();
+        benchmark.run(iterations);
+        return System.nanoTime() - start;
+    }
+
+    private static double measureExplicitGc() {
+        double[] ms = new double[RUNS];
+        for (int i = 0; i < RUNS; ++i) {
+            long start = System.nanoTime();
+            Runtime.getRuntime().gc();
+            ms[i] = (System.nanoTime() - start) / 1e6;
+        }
+        Arrays.sort(ms);
+        return ms[RUNS / 2];
+    }
+
+    // A thread watches the clock while the main thread allocates. The largest gap it sees is the
+    // longest time it was kept from running, which is the longest pause of the collections
+    // triggered by the allocations, give or take the scheduling of the watching thread.
+    private static double measureMaxObservedGcPause() throws Exception {
+        final long[] maxGapNs = new long[1];
+        final boolean[] done = new boolean[1];
+        Thread watcher = new Thread() {
+            public void run() {
+                long last = System.nanoTime();
+                while (true) {
+                    synchronized (done) {
+                        if (done[0]) {
+                            return;
+                        }
+                    }
+                    long now = System.nanoTime();
+                    maxGapNs[0] = Math.max(maxGapNs[0], now - last);
+                    last = now;
+                }
+            }
+        };
+        watcher.start();
+        Object[] live = new Object[1024];
+        long end = System.nanoTime() + GC_PAUSE_RUN_NS;
+        for (int i = 0; System.nanoTime() < end; ++i) {
+            // Keep some objects alive for the collector to trace.
+            live[i % live.length] = new byte[(i % 64) * 16];
+        }
+        synchronized (done) {
+            done[0] = true;
+        }
+        watcher.join();
+        objectSink = live;
+        return maxGapNs[0] / 1e6;
+    }
+
+    interface Shape {
+        int sides();
+    }
+
+    static class Triangle implements Shape {
+        public int sides() { return 3; }
+    }
+
+    static class Square implements Shape {
+        public int sides() { return 4; }
+    }
+
+    static class Pentagon implements Shape {
+        public int sides() { return 5; }
+    }
+
+    static class Hexagon implements Shape {
+        public int sides() { return 6; }
+    }
+
+    // Loaded afresh by each class loader of the class loading benchmark.
+    static class Loaded {
+        static int value = 42;
+    }
+
+    public static int reflected(int i) {
+        return i + 1;
+    }
+
+    private static List<Benchmark> benchmarks() throws Exception {
+        List<Benchmark> benchmarks = new ArrayList<Benchmark>();
+        benchmarks.add(new Benchmark("alloc_object") {
+            void run(int iterations) {
+                for (int i = 0; i < iterations; ++i) {
+                    objectSink = new Object();
+                }
+            }
+        });
+        benchmarks.add(new Benchmark("alloc_int_array_16") {
+            void run(int iterations) {
+                for (int i = 0; i < iterations; ++i) {
+                    objectSink = new int[16];
+                }
+            }
+        });
+        benchmarks.add(new Benchmark("monitor_enter_exit") {
+            void run(int iterations) {
+                Object lock = new Object();
+                int count = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    synchronized (lock) {
+                        count++;
+                    }
+                }
+                sink = count;
+            }
+        });
+        benchmarks.add(new Benchmark("jni_call") {
+            void run(int iterations) {
+                Object o = new Object();
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    sum += System.identityHashCode(o);
+                }
+                sink = sum;
+            }
+        });
+        final Shape[] shapes = { new Triangle(), new Square(), new Pentagon(), new Hexagon() };
+        benchmarks.add(new Benchmark("interface_call_monomorphic") {
+            void run(int iterations) {
+                Shape shape = shapes[0];
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    sum += shape.sides();
+                }
+                sink = sum;
+            }
+        });
+        benchmarks.add(new Benchmark("interface_call_megamorphic") {
+            void run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    sum += shapes[i & 3].sides();
+                }
+                sink = sum;
+            }
+        });
+        final Method reflected = Benchmarks.class.getMethod("reflected", int.class);
+        benchmarks.add(new Benchmark("reflection_invoke_static") {
+            void run(int iterations) throws Exception {
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    sum += (Integer) reflected.invoke(null, i);
+                }
+                sink = sum;
+            }
+        });
+        final String haystack = "The quick brown fox jumps over the lazy dog";
+        final String other = new String("The quick brown fox jumps over the lazy dog");
+        benchmarks.add(new Benchmark("string_char_at") {
+            void run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    sum += haystack.charAt(i % 43);
+                }
+                sink = sum;
+            }
+        });
+        benchmarks.add(new Benchmark("string_index_of") {
+            void run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    sum += haystack.indexOf('z');
+                }
+                sink = sum;
+            }
+        });
+        benchmarks.add(new Benchmark("string_compare_to") {
+            void run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    sum += haystack.compareTo(other);
+                }
+                sink = sum;
+            }
+        });
+        benchmarks.add(new Benchmark("string_equals") {
+            void run(int iterations) {
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    sum += haystack.equals(other) ? 1 : 0;
+                }
+                sink = sum;
+            }
+        });
+        final String classPath = System.getProperty("java.class.path");
+        final ClassLoader bootClassLoader = ClassLoader.getSystemClassLoader().getParent();
+        benchmarks.add(new Benchmark("class_load_and_initialize") {
+            void run(int iterations) throws Exception {
+                int sum = 0;
+                for (int i = 0; i < iterations; ++i) {
+                    ClassLoader loader = new PathClassLoader(classPath, bootClassLoader);
+                    Class<?> c = Class.forName("Benchmarks$Loaded", true, loader);
+                    sum += c.getDeclaredField("value").getInt(null);
+                }
+                sink = sum;
+            }
+        });
+        return benchmarks;
+    }
+}